@@ -32,6 +32,7 @@ Available operations and tasks:
         pthreads
         libcxx
         libcxx_noexcept
+        libcxx_clocale
         libcxxabi
         gl
         native_optimizer
@@ -52,6 +53,10 @@ Available operations and tasks:
 
 Issuing 'embuilder.py build ALL' causes each task to be built.
 
+Issuing 'embuilder.py build VARIANTS' builds every variant of the system
+libraries (default, no exceptions, pthreads, debug malloc and wasm). A
+single emcc run builds all the libraries of a variant, in parallel.
+
 It is also possible to build native_optimizer manually by using CMake. To
 do that, run
 
@@ -88,7 +93,25 @@ CXX_WITH_STDLIB = '''
         }
       '''
 
-SYSTEM_TASKS = ['compiler-rt', 'libc', 'libc-mt', 'dlmalloc', 'dlmalloc_threadsafe', 'pthreads', 'dlmalloc_debug', 'dlmalloc_threadsafe_debug', 'libcxx', 'libcxx_noexcept', 'libcxxabi', 'html5']
+CXX_WITH_ALL_SYSTEM_LIBS = '''
+        #include <iostream>
+        #include <stdlib.h>
+        #include "AL/al.h"
+        #include "emscripten/key_codes.h"
+        extern "C" { extern void* emscripten_GetProcAddress(const char *x); }
+        struct X { int x; virtual void a() {} };
+        struct Y : X { int y; virtual void a() { y = 10; }};
+        int main(int argc, char **argv) {
+          double _Complex a, b, c;
+          c = a / b;
+          std::cout << "hello";
+          Y* y = dynamic_cast<Y*>((X*)argv[1]);
+          alGetProcAddress(0);
+          return int(malloc(10)) + int(emscripten_GetProcAddress("waka waka")) + emscripten_compute_dom_pk_code(NULL) + y->y;
+        }
+      '''
+
+SYSTEM_TASKS = ['compiler-rt', 'libc', 'libc-mt', 'dlmalloc', 'dlmalloc_threadsafe', 'pthreads', 'dlmalloc_debug', 'dlmalloc_threadsafe_debug', 'libcxx', 'libcxx_noexcept', 'libcxx_clocale', 'libcxxabi', 'html5']
 USER_TASKS = ['al', 'gl', 'binaryen', 'bullet', 'freetype', 'libpng', 'ogg', 'sdl2', 'sdl2-image', 'sdl2-ttf', 'sdl2-net', 'vorbis', 'zlib']
 
 temp_files = shared.configuration.get_temp_files()
@@ -132,6 +155,16 @@ def build(src, result_libs, args=[]):
       assert os.path.exists(shared.Cache.get_path(lib)), 'not seeing that requested library %s has been built because file %s does not exist' % (lib, shared.Cache.get_path(lib))
 
 
+# each variant of the system libraries, and a program that needs all of them
+SYSTEM_VARIANTS = [
+  (CXX_WITH_ALL_SYSTEM_LIBS, ['libc.bc', 'dlmalloc.bc', 'libcxx.a', 'libcxxabi.bc', 'gl.bc', 'al.bc', 'html5.bc', 'compiler-rt.a'], []),
+  (CXX_WITH_STDLIB, ['libcxx_noexcept.a'], ['-s', 'DISABLE_EXCEPTION_CATCHING=1']),
+  (C_WITH_MALLOC, ['libc-mt.bc', 'dlmalloc_threadsafe.bc', 'pthreads.bc'], ['-s', 'USE_PTHREADS=1']),
+  (C_WITH_MALLOC, ['dlmalloc_debug.bc'], ['-g']),
+  (C_WITH_MALLOC, ['dlmalloc_threadsafe_debug.bc'], ['-g', '-s', 'USE_PTHREADS=1']),
+  (C_WITH_STDLIB, ['wasm-libc.bc'], ['-s', 'WASM=1']),
+]
+
 def build_port(port_name, lib_name, params):
   build(C_BARE, [os.path.join('ports-builds', port_name, lib_name)] if lib_name else None, params)
 
@@ -160,6 +193,14 @@ if operation == 'build':
       else:
         tasks += ['native_optimizer']
     print('Building targets: %s' % ' '.join(tasks))
+  if 'VARIANTS' in tasks:
+    tasks = [x for x in tasks if x != 'VARIANTS']
+    for src, result_libs, args in SYSTEM_VARIANTS:
+      if shared.Settings.WASM_BACKEND and 'USE_PTHREADS=1' in args:
+        continue
+      shared.logging.info('building and verifying ' + ' '.join(result_libs))
+      build(src, result_libs, args)
+      shared.logging.info('...success')
   for what in tasks:
     shared.logging.info('building and verifying ' + what)
     if what == 'compiler-rt':
@@ -184,6 +225,8 @@ if operation == 'build':
       build(CXX_WITH_STDLIB, ['libcxx.a'])
     elif what == 'libcxx_noexcept':
       build(CXX_WITH_STDLIB, ['libcxx_noexcept.a'], ['-s', 'DISABLE_EXCEPTION_CATCHING=1'])
+    elif what == 'libcxx_clocale':
+      build(CXX_WITH_STDLIB, ['libcxx_clocale.a'], ['-s', 'LIBCXX_C_LOCALE_ONLY=1'])
     elif what == 'libcxxabi':
       build('''
         struct X { int x; virtual void a() {} };
@@ -28,7 +28,7 @@ from tools.toolchain_profiler import ToolchainProfiler, exit
 if __name__ == '__main__':
   ToolchainProfiler.record_process_start()
 
-import os, sys, shutil, tempfile, subprocess, shlex, time, re, logging
+import os, sys, shutil, tempfile, subprocess, shlex, time, re, logging, json, hashlib, multiprocessing, multiprocessing.pool
 from subprocess import PIPE
 from tools import shared, jsrun, system_libs
 from tools.shared import execute, suffix, unsuffixed, unsuffixed_basename, WINDOWS, safe_copy, safe_move, run_process, asbytes
@@ -95,6 +95,11 @@ AUTODEBUG = os.environ.get('EMCC_AUTODEBUG') # If set to 1, we will run the auto
                                              # Note that this will disable inclusion of libraries. This is useful because including
                                              # dlmalloc makes it hard to compare native and js builds
 EMCC_CFLAGS = os.environ.get('EMCC_CFLAGS') # Additional compiler flags that we treat as if they were passed to us on the commandline
+COMPILE_CACHE = os.environ.get('EMCC_COMPILE_CACHE') # If set to 1, objects compiled from source are kept in the emscripten cache dir, and reused
+                                                     # when the same preprocessed source is compiled with the same flags, in any project. Any other
+                                                     # value is the directory to keep them in, which builds on several machines can share.
+if COMPILE_CACHE == '0':
+  COMPILE_CACHE = None
 
 # Target options
 final = None
@@ -104,6 +109,50 @@ def exit_with_error(message):
   logging.error(message)
   exit(1)
 
+def get_object_cache():
+  if COMPILE_CACHE == '1':
+    return shared.cache.ObjectCache(shared.Cache.get_path('objects'))
+  return shared.cache.ObjectCache(COMPILE_CACHE)
+
+clang_version_line = None
+
+# flags whose effect is all in the preprocessed source. they take a value, either in the same argument or the next one
+PREPROCESSOR_FLAGS = ('-I', '-D', '-U', '-include', '-imacros', '-isystem', '-iquote', '-idirafter')
+
+def get_object_cache_key(args, input_file):
+  """Returns the key of the object that args compile input_file to, or None
+  if it should not be cached.
+
+  args end with -emit-llvm -c -o OUTPUT. The preprocessed source stands for the
+  source file and everything it includes. The line markers in it name those
+  files, and are left out unless the object has debug info, which refers to
+  them. Preprocessor flags and paths into emscripten are left out of the
+  flags, so that builds in different directories share objects.
+  """
+  global clang_version_line
+  assert args[-4:-2] == ['-emit-llvm', '-c']
+  flags = args[:-4]
+  if any(arg.startswith('-M') for arg in flags):
+    return None # dependency files would not be written for cached objects
+  debug = any(arg.startswith('-g') for arg in flags)
+  proc = subprocess.Popen(flags + ['-E'] + ([] if debug else ['-P']), stdout=PIPE, stderr=PIPE)
+  preprocessed = proc.communicate()[0]
+  if proc.returncode != 0:
+    return None # let the compile report the errors
+  if clang_version_line is None:
+    clang_version_line = run_process([shared.CLANG, '--version'], stdout=PIPE).stdout.split('\n')[0]
+  key_flags = [os.path.basename(flags[0])]
+  skip_next = False
+  for arg in flags[1:]:
+    if skip_next:
+      skip_next = False
+    elif arg in PREPROCESSOR_FLAGS:
+      skip_next = True
+    elif not arg.startswith(PREPROCESSOR_FLAGS) and arg != input_file:
+      key_flags.append(arg.replace(shared.path_from_root(), '<emscripten>'))
+  salt = asbytes(json.dumps([shared.EMSCRIPTEN_VERSION, clang_version_line, key_flags]))
+  return hashlib.sha1(salt + preprocessed).hexdigest()
+
 class Intermediate(object):
   counter = 0
 # this method uses the global 'final' variable, which contains the current
@@ -218,7 +267,7 @@ class JSOptimizer(object):
 
       if DEBUG != '2' or len(passes) < 2:
         # by assumption, our input is JS, and our output is JS. If a pass is going to run in the native optimizer in C++, then we
-        # must give it JSON and receive from it JSON
+        # must give it an AST and receive from it an AST, which we do in the compact binary format both optimizers support
         chunks = []
         curr = []
         for p in passes:
@@ -230,9 +279,9 @@ class JSOptimizer(object):
             if native == last_native:
               curr.append(p)
             else:
-              curr.append('emitJSON')
+              curr.append('emitBinary')
               chunks.append(curr)
-              curr = ['receiveJSON', p]
+              curr = ['receiveBinary', p]
         if len(curr) > 0:
           chunks.append(curr)
         if len(chunks) == 1:
@@ -240,8 +289,8 @@ class JSOptimizer(object):
         else:
           for i, chunk in enumerate(chunks):
             self.run_passes(chunk, 'js_opts_' + str(i),
-                            just_split='receiveJSON' in chunk,
-                            just_concat='emitJSON' in chunk)
+                            just_split='receiveBinary' in chunk,
+                            just_concat='emitBinary' in chunk)
       else:
         # DEBUG 2, run each pass separately
         extra_info = self.extra_info
@@ -273,7 +322,7 @@ class JSOptimizer(object):
                                          just_concat=just_concat,
                                          output_filename=self.in_temp(os.path.basename(final) + '.jsopted.js'))
     self.js_transform_tempfiles.append(final)
-    if DEBUG: save_intermediate(title, suffix='js' if 'emitJSON' not in passes else 'json')
+    if DEBUG: save_intermediate(title, suffix='js' if 'emitBinary' not in passes else 'ast')
 
   def do_minify(self):
     """minifies the code.
@@ -957,7 +1006,7 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       assert not (shared.Settings.NO_DYNAMIC_EXECUTION and options.use_closure_compiler), 'cannot have both NO_DYNAMIC_EXECUTION and closure compiler enabled at the same time'
 
       if options.emrun:
-        shared.Settings.EXPORTED_RUNTIME_METHODS.append('addOnExit')
+        shared.Settings.EXPORTED_RUNTIME_METHODS += ['addOnExit', 'addOnPreMain']
 
       if options.use_closure_compiler:
         shared.Settings.USE_CLOSURE_COMPILER = options.use_closure_compiler
@@ -1005,6 +1054,7 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           shared.Settings.SAFE_SPLIT_MEMORY = 1 # we use our own infrastructure
         assert not shared.Settings.RELOCATABLE, 'no SPLIT_MEMORY with RELOCATABLE'
         assert not shared.Settings.USE_PTHREADS, 'no SPLIT_MEMORY with pthreads'
+        assert not shared.Settings.COMPACT_MALLOC, 'no SPLIT_MEMORY with COMPACT_MALLOC'
         if not options.js_opts:
           options.js_opts = True
           logging.debug('enabling js opts for SPLIT_MEMORY')
@@ -1023,6 +1073,16 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       if shared.Settings.ASMFS and final_suffix in JS_CONTAINING_SUFFIXES:
         input_files.append((next_arg_index, shared.path_from_root('system', 'lib', 'fetch', 'asmfs.cpp')))
         newargs.append('-D__EMSCRIPTEN_ASMFS__=1')
+        if shared.Settings.ASMFS_LAZY_LOAD:
+          newargs.append('-D__EMSCRIPTEN_ASMFS_LAZY_LOAD__=1')
+        if shared.Settings.ASMFS_TRACE:
+          newargs.append('-D__EMSCRIPTEN_ASMFS_TRACE__=%d' % shared.Settings.ASMFS_TRACE)
+        if shared.Settings.ASMFS_WRITEBACK:
+          newargs.append('-D__EMSCRIPTEN_ASMFS_WRITEBACK_DELAY__=%d' % shared.Settings.ASMFS_WRITEBACK_DELAY)
+        if options.embed_files:
+          exit_with_error('--embed-file is not supported with -s ASMFS=1, use --preload-file instead')
+        if options.preload_files:
+          shared.Settings.EXPORTED_FUNCTIONS += ['_emscripten_asmfs_import_package']
         next_arg_index += 1
         shared.Settings.NO_FILESYSTEM = 1
         shared.Settings.FETCH = 1
@@ -1034,6 +1094,28 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         next_arg_index += 1
         options.js_libraries.append(shared.path_from_root('src', 'library_fetch.js'))
 
+      if shared.Settings.GL_STATE_CACHE and shared.Settings.LEGACY_GL_EMULATION:
+        exit_with_error('-s GL_STATE_CACHE=1 is not supported with -s LEGACY_GL_EMULATION=1!')
+
+      if shared.Settings.HEAP_PROFILER:
+        if shared.Settings.USE_PTHREADS:
+          exit_with_error('-s HEAP_PROFILER is not supported with -s USE_PTHREADS>0!')
+        if shared.Settings.SPLIT_MEMORY:
+          exit_with_error('-s HEAP_PROFILER is not supported with -s SPLIT_MEMORY!')
+        if shared.Settings.COMPACT_MALLOC:
+          exit_with_error('-s HEAP_PROFILER is not supported with -s COMPACT_MALLOC=1!')
+        newargs.append('-D__EMSCRIPTEN_HEAP_PROFILER__=1')
+        options.js_libraries.append(shared.path_from_root('src', 'library_heap_profiler.js'))
+
+      if shared.Settings.SAMPLING_PROFILER:
+        if not shared.Settings.USE_PTHREADS:
+          exit_with_error('-s SAMPLING_PROFILER requires -s USE_PTHREADS=1 or -s USE_PTHREADS=2, since the sampler reads the shared heap!')
+        options.js_libraries.append(shared.path_from_root('src', 'library_sampling_profiler.js'))
+        shared.Settings.DEFAULT_LIBRARY_FUNCS_TO_INCLUDE += ['$SamplingProfiler']
+
+      if shared.Settings.TRACE_BUFFER and not shared.Settings.EMSCRIPTEN_TRACING:
+        exit_with_error('-s TRACE_BUFFER requires --tracing or --memoryprofiler!')
+
       forced_stdlibs = []
       if shared.Settings.DEMANGLE_SUPPORT:
         shared.Settings.EXPORTED_FUNCTIONS += ['___cxa_demangle']
@@ -1058,6 +1140,9 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         if not shared.Settings.SIDE_MODULE:
           shared.Settings.EXPORT_ALL = 1
 
+      if shared.Settings.ASYNCIFY_PRUNE_INDIRECT_CALLS and shared.Settings.RELOCATABLE:
+        exit_with_error('-s ASYNCIFY_PRUNE_INDIRECT_CALLS=1 is not supported with dynamic linking, as other modules can add functions that are called through function pointers')
+
       if shared.Settings.EMTERPRETIFY:
         shared.Settings.FINALIZE_ASM_JS = 0
         #shared.Settings.GLOBAL_BASE = 8*256 # keep enough space at the bottom for a full stack frame, for z-interpreter
@@ -1068,6 +1153,8 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           options.js_opts = True
         options.force_js_opts = True
         assert options.use_closure_compiler is not 2, 'EMTERPRETIFY requires valid asm.js, and is incompatible with closure 2 which disables that'
+        if shared.Settings.EMTERPRETIFY_FILE_SEGMENT_SIZE and not shared.Settings.EMTERPRETIFY_FILE:
+          exit_with_error('-s EMTERPRETIFY_FILE_SEGMENT_SIZE requires -s EMTERPRETIFY_FILE, as it splits that file')
 
       if shared.Settings.DEAD_FUNCTIONS:
         if not options.js_opts:
@@ -1075,6 +1162,18 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           options.js_opts = True
         options.force_js_opts = True
 
+      if shared.Settings.REMOVE_NOTHROW_INVOKES:
+        if not options.js_opts:
+          logging.debug('enabling js opts for REMOVE_NOTHROW_INVOKES')
+          options.js_opts = True
+        options.force_js_opts = True
+
+      if shared.Settings.DEVIRTUALIZE_CALLS:
+        if not options.js_opts:
+          logging.debug('enabling js opts for DEVIRTUALIZE_CALLS')
+          options.js_opts = True
+        options.force_js_opts = True
+
       if options.proxy_to_worker:
         shared.Settings.PROXY_TO_WORKER = 1
 
@@ -1134,9 +1233,17 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           exit_with_error('-s EMTERPRETIFY=1 is not supported with -s USE_PTHREADS>0!')
         if shared.Settings.PROXY_TO_WORKER:
           exit_with_error('--proxy-to-worker is not supported with -s USE_PTHREADS>0! Use the option -s PROXY_TO_PTHREAD=1 if you want to run the main thread of a multithreaded application in a web worker.')
+        if shared.Settings.COMPACT_MALLOC:
+          exit_with_error('-s COMPACT_MALLOC=1 is not supported with -s USE_PTHREADS>0!')
+        if shared.Settings.PTHREADS_MAIN_THREAD_ASYNC_WAIT:
+          if not shared.Settings.ASYNCIFY:
+            exit_with_error('-s PTHREADS_MAIN_THREAD_ASYNC_WAIT requires -s ASYNCIFY=1 to work!')
+          shared.Settings.ASYNCIFY_FUNCTIONS += ['emscripten_futex_wait']
       else:
         if shared.Settings.PROXY_TO_PTHREAD:
           exit_with_error('-s PROXY_TO_PTHREAD=1 requires -s USE_PTHREADS to work!')
+        if shared.Settings.MALLOC_THREAD_CACHE:
+          exit_with_error('-s MALLOC_THREAD_CACHE=1 requires -s USE_PTHREADS to work!')
 
       if shared.Settings.OUTLINING_LIMIT:
         if not options.js_opts:
@@ -1169,6 +1276,8 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         exit_with_error('WASM_MEM_MAX must be a multiple of 64KB, was ' + str(shared.Settings.WASM_MEM_MAX))
       if shared.Settings.USE_PTHREADS and shared.Settings.WASM and shared.Settings.ALLOW_MEMORY_GROWTH and shared.Settings.WASM_MEM_MAX == -1:
         exit_with_error('If pthreads and memory growth are enabled, WASM_MEM_MAX must be set')
+      if shared.Settings.USE_PTHREADS and not shared.Settings.WASM and shared.Settings.ALLOW_MEMORY_GROWTH:
+        exit_with_error('If pthreads and memory growth are enabled, WASM must be set, since a SharedArrayBuffer cannot grow')
 
       if shared.Settings.WASM_BACKEND:
         options.js_opts = None
@@ -1201,6 +1310,13 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         if shared.Settings.ELIMINATE_DUPLICATE_FUNCTIONS:
           logging.warning('for wasm there is no need to set ELIMINATE_DUPLICATE_FUNCTIONS, the binaryen optimizer does it automatically')
           shared.Settings.ELIMINATE_DUPLICATE_FUNCTIONS = 0
+        if shared.Settings.PROFILE_FUNCTION_ORDER or shared.Settings.FUNCTION_ORDER:
+          logging.warning('PROFILE_FUNCTION_ORDER and FUNCTION_ORDER only apply to asm.js output, ignoring')
+          shared.Settings.PROFILE_FUNCTION_ORDER = 0
+          shared.Settings.FUNCTION_ORDER = []
+        if shared.Settings.SAMPLING_PROFILER:
+          logging.warning('SAMPLING_PROFILER only applies to asm.js output, ignoring')
+          shared.Settings.SAMPLING_PROFILER = 0
         # default precise-f32 to on, since it works well in wasm
         # also always use f32s when asm.js is not in the picture
         if ('PRECISE_F32=0' not in settings_changes and 'PRECISE_F32=2' not in settings_changes) or 'asmjs' not in shared.Settings.BINARYEN_METHOD:
@@ -1243,6 +1359,16 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           logging.warning('output file "%s" has a wasm suffix, but we cannot emit wasm by itself, except as a dynamic library (see SIDE_MODULE option). specify an output file with suffix .js or .html, and a wasm file will be created on the side' % target)
           sys.exit(1)
 
+      if shared.Settings.SNAPSHOT:
+        if shared.Settings.BINARYEN or shared.Settings.MODULARIZE or shared.Settings.SINGLE_FILE or shared.Settings.USE_PTHREADS or shared.Settings.ALLOW_MEMORY_GROWTH:
+          exit_with_error('-s SNAPSHOT=1 is not supported with BINARYEN, MODULARIZE, SINGLE_FILE, USE_PTHREADS or ALLOW_MEMORY_GROWTH')
+        if not options.memory_init_file:
+          exit_with_error('-s SNAPSHOT=1 requires --memory-init-file 1, as the snapshot of memory becomes the memory init file')
+        if shared.Settings.MEM_INIT_COMPRESSION:
+          exit_with_error('-s SNAPSHOT=1 is not supported with MEM_INIT_COMPRESSION, as the snapshot is written over the memory init file')
+        # the snapshot includes what the ctors did
+        shared.Settings.EVAL_CTORS = 0
+
       if shared.Settings.EVAL_CTORS:
         if not shared.Settings.BINARYEN:
           # for asm.js: this option is not a js optimizer pass, but does run the js optimizer internally, so
@@ -1316,6 +1442,7 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       logging.debug('compiling to bitcode')
 
       temp_files = []
+      object_cache_keys = {} # bitcode files we compiled with the object cache => their keys
 
     # exit block 'parse arguments and setup'
     log_time('parse arguments and setup')
@@ -1381,15 +1508,36 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         logging.debug(('just preprocessor ' if '-E' in newargs else 'just dependencies: ') + ' '.join(cmd))
         exit(subprocess.call(cmd))
 
+      compile_jobs = [] # (input file, output file, compiler args, object cache key) of the source files to compile
+
       def compile_source_file(i, input_file):
         logging.debug('compiling source file: ' + input_file)
         output_file = get_bitcode_file(input_file)
         temp_files.append((i, output_file))
         args = get_bitcode_args([input_file]) + ['-emit-llvm', '-c', '-o', output_file]
         logging.debug("running: " + ' '.join(shared.Building.doublequote_spaces(args))) # NOTE: Printing this line here in this specific format is important, it is parsed to implement the "emcc --cflags" command
-        execute(args) # let compiler frontend print directly, so colors are saved (PIPE kills that)
-        if not os.path.exists(output_file):
-          exit_with_error('compiler frontend failed to generate LLVM bitcode, halting')
+        key = get_object_cache_key(args, input_file) if COMPILE_CACHE else None
+        if key:
+          object_cache_keys[output_file] = key
+        compile_jobs.append((input_file, output_file, args, key))
+
+      def run_compile_job(job, capture=False):
+        # Compiles a source file. If capture is set, returns what the compiler printed, as (stdout, stderr), or None if
+        # the object was cached.
+        input_file, output_file, args, key = job
+        output = [None]
+        def compile():
+          if capture:
+            # keep the colors that the compiler would use if it printed directly
+            output[0] = execute(args + (['-fcolor-diagnostics'] if sys.stderr.isatty() else []), stdout=PIPE, stderr=PIPE)
+          else:
+            execute(args) # let compiler frontend print directly, so colors are saved (PIPE kills that)
+        if key:
+          if get_object_cache().get(key, output_file, compile):
+            logging.debug('using cached object for ' + input_file)
+        else:
+          compile()
+        return output[0]
 
       # First, generate LLVM bitcode. For each input file, we get base.o with bitcode
       for i, input_file in input_files:
@@ -1415,6 +1563,30 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
             else:
               exit_with_error(input_file + ': Unknown file suffix when compiling to LLVM bitcode!')
 
+      # Compile the source files, in parallel if there are several. Unless they would write the same output file, as
+      # the last one should win then.
+      cores = min(len(compile_jobs), int(os.environ.get('EMCC_CORES') or multiprocessing.cpu_count()))
+      if cores > 1 and len(set(job[1] for job in compile_jobs)) == len(compile_jobs):
+        logging.debug('compiling %d source files on %d cores' % (len(compile_jobs), cores))
+        pool = multiprocessing.pool.ThreadPool(cores) # threads that wait on the compiler processes
+        outputs = pool.map_async(lambda job: run_compile_job(job, capture=True), compile_jobs, chunksize=1).get(999999)
+        pool.close()
+        # print what the compiler printed in the order of the inputs, the same as when compiling one by one
+        for output in outputs:
+          if output:
+            sys.stdout.write(output[0])
+            sys.stderr.write(output[1])
+        sys.stdout.flush()
+        sys.stderr.flush()
+      else:
+        for job in compile_jobs:
+          run_compile_job(job)
+          if not os.path.exists(job[1]):
+            break
+      for job in compile_jobs:
+        if not os.path.exists(job[1]):
+          exit_with_error('compiler frontend failed to generate LLVM bitcode, halting')
+
     # exit block 'bitcodeize inputs'
     log_time('bitcodeize inputs')
 
@@ -1431,7 +1603,13 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
               logging.debug('optimizing %s', input_file)
               #if DEBUG: shutil.copyfile(temp_file, os.path.join(shared.configuration.CANONICAL_TEMP_DIR, 'to_opt.bc')) # useful when LLVM opt aborts
               new_temp_file = in_temp(unsuffixed(uniquename(temp_file)) + '.o')
-              shared.Building.llvm_opt(temp_file, options.llvm_opts, new_temp_file)
+              key = object_cache_keys.get(temp_file)
+              if key:
+                # the optimized object is cached too, keyed on the unoptimized one and what llvm_opt() adds to the opts
+                opt_key = hashlib.sha1(asbytes(json.dumps([key, options.llvm_opts, shared.Settings.SIMD, shared.Settings.WASM_BACKEND]))).hexdigest()
+                get_object_cache().get(opt_key, new_temp_file, lambda: shared.Building.llvm_opt(temp_file, options.llvm_opts, new_temp_file))
+              else:
+                shared.Building.llvm_opt(temp_file, options.llvm_opts, new_temp_file)
               temp_files[pos] = (temp_files[pos][0], new_temp_file)
 
       # Decide what we will link
@@ -1674,6 +1852,8 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           file_args.append('--lz4')
         if options.use_preload_plugins:
           file_args.append('--use-preload-plugins')
+        if shared.Settings.ASMFS:
+          file_args.append('--asmfs')
         file_code = execute([shared.PYTHON, shared.FILE_PACKAGER, unsuffixed(target) + '.data'] + file_args, stdout=PIPE)[0]
         options.pre_js = file_code + options.pre_js
 
@@ -1719,11 +1899,13 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         def repl(m):
           # handle chunking of the memory initializer
           s = m.group(1)
-          if len(s) == 0: return '' # don't emit 0-size ones
-          membytes = [int(x or '0') for x in s.split(',')]
+          if len(s) == 0 and not shared.Settings.SNAPSHOT: return '' # don't emit 0-size ones, unless a snapshot will replace them
+          membytes = [int(x or '0') for x in s.split(',')] if s else []
           while membytes and membytes[-1] == 0:
             membytes.pop()
-          if not membytes: return ''
+          if not membytes and not shared.Settings.SNAPSHOT: return ''
+          if shared.Settings.MEM_INIT_COMPRESSION:
+            membytes = shared.JS.compress_memory_initializer(membytes)
           if shared.Settings.MEM_INIT_METHOD == 2:
             # memory initializer in a string literal
             return "memoryInitializer = '%s';" % shared.JS.generate_string_initializer(membytes)
@@ -1771,6 +1953,25 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         optimizer.queue += ['eliminateDeadFuncs']
         optimizer.extra_info['dead_functions'] = shared.Settings.DEAD_FUNCTIONS
 
+      if shared.Settings.REMOVE_NOTHROW_INVOKES and not shared.Settings.RELOCATABLE and not shared.Settings.EMULATED_FUNCTION_POINTERS:
+        # a whole-program analysis, on the code as it is before other passes inline or remove anything
+        optimizer.flush()
+        nothrow_invokes = shared.Building.find_nothrow_invokes(final)
+        if nothrow_invokes:
+          optimizer.queue += ['removeNothrowInvokes']
+          optimizer.extra_info['nothrowInvokes'] = nothrow_invokes
+
+      if shared.Settings.DEVIRTUALIZE_CALLS and not shared.Settings.RELOCATABLE and not shared.Settings.EMULATED_FUNCTION_POINTERS:
+        if shared.js_optimizer.use_native('devirtualize') and shared.js_optimizer.get_native_optimizer():
+          # a whole-program analysis of the function tables, early so that the direct calls can be inlined
+          optimizer.flush()
+          devirtualize = shared.Building.find_devirtualizable_tables(final, shared.Settings.DEVIRTUALIZE_CALLS)
+          if devirtualize:
+            optimizer.queue += ['devirtualize']
+            optimizer.extra_info['devirtualize'] = devirtualize
+        else:
+          logging.warning('DEVIRTUALIZE_CALLS requires the native optimizer, ignoring')
+
       if options.opt_level >= 1 and options.js_opts:
         logging.debug('running js post-opts')
 
@@ -1784,7 +1985,18 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
           else:
             return 'eliminate'
 
+        def can_run_natively(name):
+          # some passes exist only in the native optimizer
+          return shared.js_optimizer.use_native(name, source_map=options.debug_level >= 4) and shared.js_optimizer.get_native_optimizer()
+
         if options.opt_level >= 2:
+          if shared.Settings.INLINE_SMALL_FUNCTIONS:
+            if can_run_natively('inlineSmallFunctions'):
+              optimizer.queue += ['inlineSmallFunctions']
+              optimizer.extra_info['sizeToInline'] = shared.Settings.INLINE_SMALL_FUNCTIONS
+            else:
+              logging.warning('INLINE_SMALL_FUNCTIONS requires the native optimizer, ignoring')
+
           optimizer.queue += [get_eliminate()]
 
           if shared.Settings.AGGRESSIVE_VARIABLE_ELIMINATION:
@@ -1793,6 +2005,9 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
 
           optimizer.queue += ['simplifyExpressions']
 
+          if options.opt_level >= 3 and can_run_natively('hoistLoopInvariants'):
+            optimizer.queue += ['hoistLoopInvariants']
+
           if shared.Settings.EMTERPRETIFY:
             # emterpreter code will not run through a JS optimizing JIT, do more work ourselves
             optimizer.queue += ['localCSE']
@@ -1814,7 +2029,7 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
 
       if options.js_opts:
         if shared.Settings.SAFE_HEAP and not shared.Building.is_wasm_only():
-          optimizer.queue += ['safeHeap']
+          optimizer.queue += ['safeHeapSkipRedundant' if shared.Settings.SAFE_HEAP_SKIP_REDUNDANT and not shared.Settings.SAFE_HEAP_LOG else 'safeHeap']
 
         if shared.Settings.OUTLINING_LIMIT > 0:
           optimizer.queue += ['outline']
@@ -1829,13 +2044,45 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
         # NOTE: Important that this comes after registerize/registerizeHarder
         if shared.Settings.ELIMINATE_DUPLICATE_FUNCTIONS and options.opt_level >= 2:
           optimizer.flush()
-          shared.Building.eliminate_duplicate_funcs(final)
+          if can_run_natively('pruneFunctions') and not shared.Settings.ELIMINATE_DUPLICATE_FUNCTIONS_DUMP_EQUIVALENT_FUNCTIONS:
+            # one native pass over the call graph, which also removes unreachable functions
+            optimizer.queue += ['pruneFunctions']
+            optimizer.flush('prune_functions')
+          else:
+            shared.Building.eliminate_duplicate_funcs(final)
+
+      if shared.Settings.PROFILE_FUNCTION_ORDER:
+        # after everything that inlines or removes functions, so the profile is of the functions in the output
+        if shared.js_optimizer.use_native('instrumentFunctionOrder') and shared.js_optimizer.get_native_optimizer():
+          optimizer.queue += ['instrumentFunctionOrder']
+          optimizer.flush()
+        else:
+          logging.warning('PROFILE_FUNCTION_ORDER requires the native optimizer, ignoring')
+
+      if shared.Settings.SAMPLING_PROFILER:
+        # last, like PROFILE_FUNCTION_ORDER, so the profile is of the functions in the output
+        if shared.js_optimizer.use_native('instrumentShadowStack') and shared.js_optimizer.get_native_optimizer():
+          optimizer.queue += ['instrumentShadowStack']
+          optimizer.flush()
+        else:
+          logging.warning('SAMPLING_PROFILER requires the native optimizer, functions will not be sampled')
 
       if shared.Settings.EVAL_CTORS and options.memory_init_file and options.debug_level < 4 and not shared.Settings.BINARYEN:
         optimizer.flush()
         shared.Building.eval_ctors(final, memfile)
         if DEBUG: save_intermediate('eval-ctors', 'js')
 
+      # like the meta-DCE of wasm in minify_wasm_js, when optimizing a lot, and before minification, as it finds
+      # imports and exports by name. with wasm it runs later, on the wasm
+      if options.js_opts and (options.opt_level >= 3 or options.shrink_level > 0) and options.debug_level <= 2 and \
+         shared.Settings.FINALIZE_ASM_JS and not shared.Settings.BINARYEN and not shared.Settings.EMTERPRETIFY and \
+         not shared.Settings.RELOCATABLE and not shared.Settings.EMULATED_FUNCTION_POINTERS and \
+         not shared.Settings.SPLIT_MEMORY and options.use_closure_compiler != 2 and \
+         shared.js_optimizer.use_native('dumpCallGraph') and shared.js_optimizer.get_native_optimizer():
+        optimizer.flush()
+        final = shared.Building.asm_metadce(final)
+        if DEBUG: save_intermediate('metadce', 'js')
+
       if options.js_opts:
         # some compilation modes require us to minify later or not at all
         if not shared.Settings.EMTERPRETIFY and not shared.Settings.BINARYEN:
@@ -1894,6 +2141,9 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       # The JS is now final. Move it to its final location
       shutil.move(final, js_target)
 
+      if shared.Settings.SNAPSHOT:
+        shared.Building.snapshot(js_target, memfile)
+
       generated_text_files_with_native_eols += [js_target]
 
       # If we were asked to also generate HTML, do that
@@ -2216,6 +2466,12 @@ def emterpretify(js_target, optimizer, options):
       args += ['MEMORY_SAFE=1']
     if shared.Settings.EMTERPRETIFY_FILE:
       args += ['FILE="' + shared.Settings.EMTERPRETIFY_FILE + '"']
+    if shared.Settings.EMTERPRETIFY_SUPERINSTRUCTIONS:
+      args += ['SUPERINSTRUCTIONS=%d' % shared.Settings.EMTERPRETIFY_SUPERINSTRUCTIONS]
+    if shared.Settings.EMTERPRETIFY_PROFILE:
+      args += ['PROFILE=1']
+    if shared.Settings.EMTERPRETIFY_FILE_SEGMENT_SIZE:
+      args += ['SEGMENT_SIZE=%d' % shared.Settings.EMTERPRETIFY_FILE_SEGMENT_SIZE]
     execute(args)
     final = final + '.em.js'
   finally:
@@ -2530,8 +2786,9 @@ def generate_html(target, options, js_target, target_basename,
                                     separate_asm = options.separate_asm)
 
   if not shared.Settings.SINGLE_FILE:
-    if shared.Settings.EMTERPRETIFY_FILE:
+    if shared.Settings.EMTERPRETIFY_FILE and not shared.Settings.EMTERPRETIFY_FILE_SEGMENT_SIZE:
       # We need to load the emterpreter file before anything else, it has to be synchronously ready
+      # (unless it is split into segments, which are loaded as they are needed)
       script.un_src()
       script.inline = '''
           var emterpretURL = '%s';
@@ -2552,10 +2809,13 @@ def generate_html(target, options, js_target, target_basename,
           emterpretXHR.send(null);
 ''' % (shared.JS.get_subresource_location(shared.Settings.EMTERPRETIFY_FILE), script.inline)
 
+    # Requests for resources that do not need anything else to be loaded first. These start right away in the HTML,
+    # in parallel with each other and with the JS, before the loading steps below that must run in order.
+    fetches = ''
+
     if options.memory_init_file:
       # start to load the memory init file in the HTML, in parallel with the JS
-      script.un_src()
-      script.inline = ('''
+      fetches += ('''
           var memoryInitializer = '%s';
           if (typeof Module['locateFile'] === 'function') {
             memoryInitializer = Module['locateFile'](memoryInitializer);
@@ -2567,7 +2827,35 @@ def generate_html(target, options, js_target, target_basename,
           meminitXHR.open('GET', memoryInitializer, true);
           meminitXHR.responseType = 'arraybuffer';
           meminitXHR.send(null);
-''' % shared.JS.get_subresource_location(memfile)) + script.inline
+''' % shared.JS.get_subresource_location(memfile))
+
+    if options.preload_files and not options.use_preload_cache:
+      # the file packager code is in the JS, so it would only start the download once the JS has arrived
+      fetches += '''
+          var dataURL = '%s';
+          if (typeof Module['locateFile'] === 'function') {
+            dataURL = Module['locateFile'](dataURL);
+          } else if (Module['filePackagePrefixURL']) {
+            dataURL = Module['filePackagePrefixURL'] + dataURL;
+          }
+          if (!Module['dataFileRequests']) Module['dataFileRequests'] = {};
+          var dataXHR = Module['dataFileRequests'][dataURL] = new XMLHttpRequest();
+          dataXHR.open('GET', dataURL, true);
+          dataXHR.responseType = 'arraybuffer';
+          dataXHR.send(null);
+''' % os.path.basename(unsuffixed(target) + '.data')
+
+    if shared.Settings.BINARYEN and shared.Settings.BINARYEN_ASYNC_COMPILATION and 'native-wasm' in shared.Settings.BINARYEN_METHOD:
+      # the wasm is compiled as it streams in from this request (see createWasm() in preamble.js)
+      fetches += '''
+          if (typeof fetch === 'function') {
+            var wasmURL = '%s';
+            if (typeof Module['locateFile'] === 'function') {
+              wasmURL = Module['locateFile'](wasmURL);
+            }
+            Module['wasmBinaryRequest'] = fetch(wasmURL, { credentials: 'same-origin' });
+          }
+''' % shared.JS.get_subresource_location(wasm_binary_target)
 
     # Download .asm.js if --separate-asm was passed in an asm.js build, or if 'asmjs' is one
     # of the wasm run methods.
@@ -2648,6 +2936,10 @@ def generate_html(target, options, js_target, target_basename,
           wasmXHR.send(null);
 ''' % (shared.JS.get_subresource_location(wasm_binary_target), script.inline)
 
+    if fetches:
+      script.un_src()
+      script.inline = fetches + script.inline
+
   # when script.inline isn't empty, add required helper functions such as tryParseAsDataURI
   if script.inline:
     for file in ['arrayUtils.js', 'base64Utils.js', 'URIUtils.js']:
@@ -2697,6 +2989,7 @@ def worker_js_script(proxy_worker_filename):
     open(shared.path_from_root('src', 'proxyClient.js')).read()
     .replace('{{{ filename }}}', proxy_worker_filename)
     .replace('{{{ IDBStore.js }}}', idb_store_src)
+    .replace('{{{ OFFSCREENCANVAS_SUPPORT }}}', str(shared.Settings.OFFSCREENCANVAS_SUPPORT))
   )
 
   return web_gl_client_src + '\n' + proxy_client_src
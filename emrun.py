@@ -591,6 +591,10 @@ class HTTPHandler(SimpleHTTPRequestHandler):
 
       if data == '^pageload^': # Browser is just notifying that it has successfully launched the page.
         have_received_messages = True
+      elif data.startswith('^timing^'): # The page is about to exit, and reports how long it ran, as ^timing^(startup ms)^(main ms).
+        if emrun_options.report_timing:
+          startup, main = data[len('^timing^'):].split('^')
+          logi('emrun timing: startup %.3f ms, main %.3f ms' % (float(startup), float(main)))
       elif not is_exit:
         log = browser_loge if is_stderr else browser_logi
         self.server.handle_incoming_message(seq_num, log, data)
@@ -1311,6 +1315,12 @@ def run():
   parser.add_argument('--browser_args', dest='browser_args', default='',
     help='Specifies the arguments to the browser executable.')
 
+  parser.add_argument('--headless', dest='headless', action='store_true',
+    help='Runs the browser without a window, if it supports that (Firefox and Chrome).')
+
+  parser.add_argument('--report_timing', dest='report_timing', action='store_true',
+    help='When the page exit()s, prints when its main() started (since the page started loading) and how long it ran, in milliseconds. Requires a page built with --emrun.')
+
   parser.add_argument('--android', dest='android', action='store_true', default=False,
     help='Launches the page in a browser of an Android device connected to an USB on the local system. (via adb)')
 
@@ -1470,10 +1480,14 @@ def run():
       elif 'chrome' in browser_exe.lower():
         processname_killed_atexit = 'chrome'
         browser_args += ['--incognito', '--enable-nacl', '--enable-pnacl', '--disable-restore-session-state', '--enable-webgl', '--no-default-browser-check', '--no-first-run', '--allow-file-access-from-files']
+        if options.headless:
+          browser_args += ['--headless', '--disable-gpu']
     #    if options.no_server:
     #      browser_args += ['--disable-web-security']
       elif 'firefox' in browser_exe.lower():
         processname_killed_atexit = 'firefox'
+        if options.headless:
+          browser_args += ['-headless']
       elif 'iexplore' in browser_exe.lower():
         processname_killed_atexit = 'iexplore'
         browser_args += ['-private']
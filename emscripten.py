@@ -14,13 +14,13 @@ if __name__ == '__main__':
   ToolchainProfiler.record_process_start()
 
 import difflib
-import os, sys, json, argparse, subprocess, re, time, logging
+import os, sys, json, argparse, subprocess, re, time, logging, hashlib
 import shutil
 from collections import OrderedDict
 
 from tools import shared
 from tools import jsrun, cache as cache_module, tempfiles
-from tools.response_file import substitute_response_files
+from tools.response_file import substitute_response_files, create_response_file
 from tools.shared import WINDOWS, asstr
 
 __rootpath__ = os.path.abspath(os.path.dirname(__file__))
@@ -44,6 +44,10 @@ if STDERR_FILE:
   logging.info('logging stderr in js compiler phase into %s' % STDERR_FILE)
   STDERR_FILE = open(STDERR_FILE, 'w')
 
+# EMCC_JSLIB_CACHE=1 keeps the output of the JS compiler in the emscripten cache dir, and reuses it when linking again
+# with the same settings (which include the set of library symbols that are needed) and the same JS library sources.
+JSLIB_CACHE = os.environ.get('EMCC_JSLIB_CACHE') == '1'
+
 def quoter(settings):
   def quote(prop):
     if settings['USE_CLOSURE_COMPILER'] == 2:
@@ -410,6 +414,8 @@ def write_output_file(outfile, post, module):
 
 
 def write_cyberdwarf_data(outfile, metadata, settings):
+  # this is JSON, which tools/emdebug_cd_merger.py packs into the indexed format the debugger toolkit reads, after
+  # adding the symbol map
   if settings['CYBERDWARF']:
     assert('cyberdwarf_data' in metadata)
     cd_file_name = outfile.name + ".cd"
@@ -455,7 +461,13 @@ def create_backend_args(infile, temp_js, settings):
   if settings['ASYNCIFY']:
     args += ['-emscripten-asyncify']
     args += ['-emscripten-asyncify-functions=' + ','.join(settings['ASYNCIFY_FUNCTIONS'])]
-    args += ['-emscripten-asyncify-whitelist=' + ','.join(settings['ASYNCIFY_WHITELIST'])]
+    whitelist = settings['ASYNCIFY_WHITELIST']
+    if settings['ASYNCIFY_PRUNE_INDIRECT_CALLS']:
+      whitelist = whitelist + find_sync_functions(infile, settings)
+    whitelist_arg = '-emscripten-asyncify-whitelist=' + ','.join(whitelist)
+    if len(whitelist_arg) > 8192:
+      whitelist_arg = '@' + create_response_file([whitelist_arg], shared.get_emscripten_temp_dir())
+    args += [whitelist_arg]
   if settings['NO_EXIT_RUNTIME']:
     args += ['-emscripten-no-exit-runtime']
   if settings['BINARYEN']:
@@ -467,6 +479,23 @@ def create_backend_args(infile, temp_js, settings):
   return args
 
 
+def find_sync_functions(infile, settings):
+  """Returns the functions that asyncify would instrument because they can call
+  through function pointers, but that cannot reach an async function through
+  any function pointer of the right type."""
+  from tools import asyncify_analysis
+  with ToolchainProfiler.profile_block('asyncify_analysis'):
+    with get_configuration().get_temp_files().get_file('.ll') as temp_ll:
+      shared.Building.llvm_dis(infile, temp_ll)
+      ll = open(temp_ll).read()
+    # with emulated function pointers (casts), all tables are one, so any
+    # function whose address is taken can be called through any pointer
+    match_signatures = not settings['EMULATED_FUNCTION_POINTERS'] and not settings['EMULATE_FUNCTION_POINTER_CASTS']
+    sync = asyncify_analysis.analyze(ll, settings['ASYNCIFY_FUNCTIONS'], settings['ASYNCIFY_WHITELIST'], exported=settings['EXPORTED_FUNCTIONS'], match_signatures=match_signatures)
+  logging.debug('asyncify: %d functions cannot be on the stack during async calls, and will not be instrumented' % len(sync))
+  return sync
+
+
 def optimize_syscalls(declares, settings, DEBUG):
   """Disables filesystem if only a limited subset of syscalls is used.
 
@@ -529,7 +558,45 @@ def update_settings_glue(settings, metadata):
     settings['JSCALL_SIG_ORDER'] = sig2order
 
 
+def get_jslib_cache(compiler_engine, settings, libraries):
+  # The output depends on the JS sources, and on files that settings refer to, which the JS compiler reads
+  files = []
+  for root, dirs, filenames in os.walk(path_from_root('src')):
+    dirs.sort()
+    files += [os.path.join(root, f) for f in sorted(filenames)]
+  files += libraries
+  for key, value in sorted(settings.items()):
+    if isinstance(value, (str, type(u''))):
+      if value.startswith('@'): value = value[1:]
+      if value and os.path.isfile(value): files.append(value)
+  contents = hashlib.sha1()
+  for f in files:
+    contents.update(shared.asbytes(f))
+    if os.path.isfile(f):
+      with open(f, 'rb') as handle:
+        contents.update(handle.read())
+  salt = json.dumps([shared.EMSCRIPTEN_VERSION, compiler_engine, contents.hexdigest()])
+  return cache_module.FunctionCache(shared.Cache.get_path('jslib'), salt)
+
+
 def compile_settings(compiler_engine, settings, libraries, temp_files):
+  if JSLIB_CACHE:
+    jslib_cache = get_jslib_cache(compiler_engine, settings, libraries)
+    key = json.dumps(settings, sort_keys=True)
+    out = jslib_cache.get(key)
+    if out is not None:
+      logging.debug('emscript: reusing cached js compiler output')
+    else:
+      out = run_js_compiler(compiler_engine, settings, libraries, temp_files)
+      jslib_cache.put(key, out)
+  else:
+    out = run_js_compiler(compiler_engine, settings, libraries, temp_files)
+  assert '//FORWARDED_DATA:' in out, 'Did not receive forwarded data in pre output - process failed?'
+  glue, forwarded_data = out.split('//FORWARDED_DATA:')
+  return glue, forwarded_data
+
+
+def run_js_compiler(compiler_engine, settings, libraries, temp_files):
   # Save settings to a file to work around v8 issue 1579
   with temp_files.get_file('.txt') as settings_file:
     with open(settings_file, 'w') as s:
@@ -539,13 +606,15 @@ def compile_settings(compiler_engine, settings, libraries, temp_files):
     out = jsrun.run_js(path_from_root('src', 'compiler.js'), compiler_engine,
                        [settings_file] + libraries, stdout=subprocess.PIPE, stderr=STDERR_FILE,
                        cwd=path_from_root('src'), error_limit=300)
-  assert '//FORWARDED_DATA:' in out, 'Did not receive forwarded data in pre output - process failed?'
-  glue, forwarded_data = out.split('//FORWARDED_DATA:')
-  return glue, forwarded_data
+  return out
 
 
 def memory_and_global_initializers(pre, metadata, mem_init, settings):
-  global_initializers = str(', '.join(['{ func: function() { %s() } }' % i for i in metadata['initializers']]))
+  if settings['SNAPSHOT']:
+    # when starting from a snapshot, what the ctors did is already in memory
+    global_initializers = str(', '.join(['{ func: function() { if (!snapshotState) %s() } }' % i for i in metadata['initializers']]))
+  else:
+    global_initializers = str(', '.join(['{ func: function() { %s() } }' % i for i in metadata['initializers']]))
 
   if settings['SIMD'] == 1:
     pre = open(path_from_root(os.path.join('src', 'ecmascript_simd.js'))).read() + '\n\n' + pre
@@ -570,7 +639,7 @@ def memory_and_global_initializers(pre, metadata, mem_init, settings):
 
   if settings['SIDE_MODULE']:
     pre = pre.replace('GLOBAL_BASE', 'gb')
-  if settings['SIDE_MODULE'] or settings['BINARYEN']:
+  if settings['SIDE_MODULE'] or settings['BINARYEN'] or settings['POINTER_STRINGIFY_CACHE']:
     pre = pre.replace('{{{ STATIC_BUMP }}}', str(staticbump))
 
   return pre
@@ -644,6 +713,8 @@ def get_exported_implemented_functions(all_exported_functions, all_implemented,
       funcs += ['stackAlloc', 'stackSave', 'stackRestore', 'establishStackSpace']
     if settings['SAFE_HEAP']:
       funcs += ['setDynamicTop']
+    if settings['SAMPLING_PROFILER']:
+      funcs += ['setShadowStack']
     if not settings['RELOCATABLE']:
       funcs += ['setTempRet0', 'getTempRet0']
     if not (settings['BINARYEN'] and settings['SIDE_MODULE']):
@@ -1231,6 +1302,8 @@ def create_basic_funcs(function_table_sigs, settings):
       basic_funcs += ['nullFunc_' + sig]
   if settings['RELOCATABLE']:
     basic_funcs += ['setTempRet0', 'getTempRet0']
+  if settings['PROFILE_FUNCTION_ORDER']:
+    basic_funcs += ['profileFunctionCall']
 
   for sig in function_table_sigs:
     basic_funcs.append('invoke_%s' % sig)
@@ -1251,6 +1324,8 @@ def create_basic_vars(exported_implemented_functions, forwarded_json, metadata,
   else:
     if forwarded_json['Functions']['libraryFunctions'].get('_llvm_cttz_i32'):
       basic_vars += ['cttz_i8']
+  if settings['SAMPLING_PROFILER']:
+    basic_vars += ['shadowStack']
   if settings['RELOCATABLE']:
     if not (settings['BINARYEN'] and settings['SIDE_MODULE']):
       basic_vars += ['gb', 'fb']
@@ -1291,6 +1366,8 @@ def create_asm_runtime_funcs(settings):
     funcs += ['setTempRet0', 'getTempRet0']
   if settings['SAFE_HEAP']:
     funcs += ['setDynamicTop']
+  if settings['SAMPLING_PROFILER']:
+    funcs += ['setShadowStack']
   if settings['ONLY_MY_CODE']:
     funcs = []
   return funcs
@@ -1408,6 +1485,11 @@ function establishStackSpace(stackBase, stackMax) {
   STACK_MAX = stackMax;
 }
 ''' + ('''
+function setShadowStack(stack) {
+  stack = stack|0;
+  shadowStack = stack;
+}
+''' if settings['SAMPLING_PROFILER'] else '') + ('''
 function setAsync() {
   ___async = 1;
 }''' if need_asyncify(exports) else '') + ('''
@@ -1577,6 +1659,7 @@ def create_asm_runtime_thread_local_vars(settings):
   if settings['USE_PTHREADS']:
     return '''
   var __pthread_ptr = 0;
+  var __pthread_tsd = 0;
   var __pthread_is_main_runtime_thread = 0;
   var __pthread_is_main_browser_thread = 0;
 '''
@@ -14,6 +14,12 @@ var Fetch = {
   attr_t_offset_overriddenMimeType: 76,
   attr_t_offset_requestData: 80,
   attr_t_offset_requestDataSize: 84,
+  attr_t_offset_destinationBuffer: 88,
+  attr_t_offset_destinationBufferSize: 92,
+  attr_t_offset_priority: 96,
+  attr_t_offset_maxConcurrentRequests: 100,
+  attr_t_offset_rangeStart: 104,
+  attr_t_offset_rangeEnd: 112,
 
   fetch_t_offset_id: 0,
   fetch_t_offset_userData: 4,
@@ -27,19 +33,612 @@ var Fetch = {
   fetch_t_offset_statusText: 44,
   fetch_t_offset___proxyState: 108,
   fetch_t_offset___attributes: 112,
+  fetch_t_offset___timing: 232,
+
+  timing_t_offset_queuedMSecs: 0,
+  timing_t_offset_timeToFirstByteMSecs: 8,
+  timing_t_offset_downloadMSecs: 16,
+  timing_t_offset_totalMSecs: 24,
+  timing_t_offset_numBytesCopiedToHeap: 32,
+  timing_t_offset_cacheResult: 40,
 
   xhrs: [],
+  // The size of the Range requests that EMSCRIPTEN_FETCH_APPEND downloads files with.
+  resumeChunkSize: 8*1024*1024,
+  // XHRs that wait for their turn to be sent, and the number of XHRs that have been sent but not finished yet.
+  queuedRequests: [],
+  numActiveRequests: 0,
+  numScheduledRequests: 0,
+  // XHRs in flight that identical GET requests can share, by the URL and the attributes that affect the request.
+  coalescableRequests: {},
   // The web worker that runs proxied file I/O requests.
   worker: undefined,
   // Specifies an instance to the IndexedDB database. The database is opened
   // as a preload step before the Emscripten application starts.
   dbInstance: undefined,
+  // Functions that wait for a pthread to open its own connection to the database.
+  dbOpenWaiters: null,
 
   setu64: function(addr, val) {
     HEAPU32[addr >> 2] = val;
     HEAPU32[addr + 4 >> 2] = (val / 4294967296)|0;
   },
 
+  getu64: function(addr) {
+    return HEAPU32[addr >> 2] + HEAPU32[addr + 4 >> 2] * 4294967296;
+  },
+
+  // Copies bytes of the response body, which start at the given offset from the beginning of the response, to the
+  // heap. They go to the destination buffer in the fetch attributes if one was given, and otherwise to a new block
+  // that is malloc()ed here. That block has the same lifetime as the emscripten_fetch_t structure itself has, and is
+  // freed when emscripten_fetch_close() is called. Returns the address of the bytes, or 0 if they do not fit in the
+  // destination buffer.
+  copyToHeap: function(fetch, bytes, offset) {
+    var fetch_attr = fetch + Fetch.fetch_t_offset___attributes;
+    var destinationBuffer = HEAPU32[fetch_attr + Fetch.attr_t_offset_destinationBuffer >> 2];
+    var ptr;
+    if (destinationBuffer) {
+      var destinationBufferSize = HEAPU32[fetch_attr + Fetch.attr_t_offset_destinationBufferSize >> 2];
+      if (offset + bytes.byteLength > destinationBufferSize) return 0;
+      ptr = destinationBuffer + offset;
+    } else {
+      ptr = _malloc(bytes.byteLength);
+    }
+    HEAPU8.set(new Uint8Array(bytes), ptr);
+    var timing = fetch + Fetch.fetch_t_offset___timing;
+    Fetch.setu64(timing + Fetch.timing_t_offset_numBytesCopiedToHeap, Fetch.getu64(timing + Fetch.timing_t_offset_numBytesCopiedToHeap) + bytes.byteLength);
+    return ptr;
+  },
+
+  // The times at which the phases of the fetches in flight began, by the address of their emscripten_fetch_t. The
+  // durations in the emscripten_fetch_timing_t of each fetch are filled in as its phases end.
+  timings: {},
+
+  now: function() {
+    return (typeof performance !== 'undefined' && performance.now) ? performance.now() : Date.now();
+  },
+
+  timingStart: function(fetch) {
+    var id = HEAPU32[fetch + Fetch.fetch_t_offset_id >> 2];
+    var t = Fetch.timings[fetch];
+    if (t && t.id === id) return; // The fetch was restarted after the IndexedDB of the thread was opened.
+    Fetch.timings[fetch] = { id: id, start: Fetch.now(), sent: 0, firstByte: 0 };
+  },
+
+  // Called when the (first) XHR of the fetch is sent, and when its first bytes arrive.
+  timingSent: function(fetch) {
+    var t = Fetch.timings[fetch];
+    if (!t || t.sent) return;
+    t.sent = Fetch.now();
+    HEAPF64[fetch + Fetch.fetch_t_offset___timing + Fetch.timing_t_offset_queuedMSecs >> 3] = t.sent - t.start;
+  },
+
+  timingFirstByte: function(fetch) {
+    var t = Fetch.timings[fetch];
+    if (!t || !t.sent || t.firstByte) return;
+    t.firstByte = Fetch.now();
+    HEAPF64[fetch + Fetch.fetch_t_offset___timing + Fetch.timing_t_offset_timeToFirstByteMSecs >> 3] = t.firstByte - t.sent;
+  },
+
+  // Records whether the fetch found the file in IndexedDB, unless it has already looked it up there.
+  timingCacheResult: function(fetch, hit) {
+    var ptr = fetch + Fetch.fetch_t_offset___timing + Fetch.timing_t_offset_cacheResult >> 2;
+    if (!HEAPU32[ptr]) HEAPU32[ptr] = hit ? 1/*EMSCRIPTEN_FETCH_CACHE_HIT*/ : 2/*EMSCRIPTEN_FETCH_CACHE_MISS*/;
+  },
+
+  // Called right before the onsuccess() or onerror() handler of the fetch.
+  timingEnd: function(fetch) {
+    var t = Fetch.timings[fetch];
+    if (!t) return;
+    delete Fetch.timings[fetch];
+    var now = Fetch.now();
+    var timing = fetch + Fetch.fetch_t_offset___timing;
+    if (t.firstByte) HEAPF64[timing + Fetch.timing_t_offset_downloadMSecs >> 3] = now - t.firstByte;
+    HEAPF64[timing + Fetch.timing_t_offset_totalMSecs >> 3] = now - t.start;
+#if EMSCRIPTEN_TRACING
+    var cacheResults = ['not used', 'hit', 'miss'];
+    _emscripten_trace_js_log_message('fetch', Pointer_stringify(HEAPU32[fetch + Fetch.fetch_t_offset_url >> 2])
+      + ': status ' + HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1]
+      + ', IndexedDB ' + cacheResults[HEAPU32[timing + Fetch.timing_t_offset_cacheResult >> 2]]
+      + ', queued ' + HEAPF64[timing + Fetch.timing_t_offset_queuedMSecs >> 3].toFixed(2) + ' msecs'
+      + ', time to first byte ' + HEAPF64[timing + Fetch.timing_t_offset_timeToFirstByteMSecs >> 3].toFixed(2) + ' msecs'
+      + ', download ' + HEAPF64[timing + Fetch.timing_t_offset_downloadMSecs >> 3].toFixed(2) + ' msecs'
+      + ', total ' + HEAPF64[timing + Fetch.timing_t_offset_totalMSecs >> 3].toFixed(2) + ' msecs'
+      + ', ' + Fetch.getu64(timing + Fetch.timing_t_offset_numBytesCopiedToHeap) + ' bytes copied to the heap');
+#endif
+  },
+
+  // Fails a fetch whose response did not fit in the destination buffer that was given in the fetch attributes.
+  reportDestinationBufferTooSmall: function(fetch, totalBytes) {
+    HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = 0;
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, totalBytes);
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 413; // Mimic XHR HTTP status code 413 "Payload Too Large"
+    stringToUTF8("Destination buffer too small", fetch + Fetch.fetch_t_offset_statusText, 64);
+  },
+
+  // Fails a fetch whose response could not be decoded with the EMSCRIPTEN_FETCH_DECODE_* attribute it was started with.
+  reportDecodingFailed: function(fetch) {
+    HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = 0;
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 415; // Mimic XHR HTTP status code 415 "Unsupported Media Type"
+    stringToUTF8("Decoding failed", fetch + Fetch.fetch_t_offset_statusText, 64);
+  },
+
+  lz4: null,
+
+  // Returns a decoder for the EMSCRIPTEN_FETCH_DECODE_* attributes, or null if they do not ask for one. Encoded bytes are
+  // passed to its push() function as they arrive, and end() is called after the last of them. The decoded bytes are
+  // passed to ondata(Uint8Array), in order, and then ondone(error) is called once, with a null error on success. Either
+  // may be called back later than push() and end() return.
+  createDecoder: function(fetchAttributes, ondata, ondone) {
+    if (fetchAttributes & 256/*EMSCRIPTEN_FETCH_DECODE_LZ4*/) return Fetch.createLZ4Decoder(ondata, ondone);
+    if (fetchAttributes & 512/*EMSCRIPTEN_FETCH_DECODE_GZIP*/) return Fetch.createGzipDecoder(ondata, ondone);
+    return null;
+  },
+
+  // Decodes the whole body of a response, and calls ondone(error, decodedBytes).
+  decode: function(fetchAttributes, bytes, ondone) {
+    var chunks = [];
+    var size = 0;
+    var decoder = Fetch.createDecoder(fetchAttributes, function(chunk) {
+      chunks.push(chunk);
+      size += chunk.length;
+    }, function(error) {
+      if (error) {
+        ondone(error, null);
+        return;
+      }
+      var data = chunks.length == 1 ? chunks[0] : new Uint8Array(size);
+      if (chunks.length != 1) {
+        size = 0;
+        for(var i = 0; i < chunks.length; ++i) {
+          data.set(chunks[i], size);
+          size += chunks[i].length;
+        }
+      }
+      ondone(null, data);
+    });
+    decoder.push(bytes);
+    decoder.end();
+  },
+
+  // Decodes LZ4 frames with the block decoder of MiniLZ4. Each block is decoded once all of it has arrived. Linked
+  // blocks are decoded after the last 64KB of the output that precedes them, which their matches can refer back to.
+  createLZ4Decoder: function(ondata, ondone) {
+    if (!Fetch.lz4) {
+      Fetch.lz4 = (function() {
+#include "mini-lz4.js"
+        return MiniLZ4;
+      })();
+    }
+    var codec = Fetch.lz4;
+    var input = new Uint8Array(0); // The bytes that have arrived but have not been decoded yet.
+    var inFrame = false;
+    var atContentChecksum = false;
+    var blockIndependent, blockChecksum, contentChecksum, maxBlockSize;
+    var output, outputPos;
+    var finished = false;
+
+    var u32 = function(pos) {
+      return (input[pos] | (input[pos+1] << 8) | (input[pos+2] << 16) | (input[pos+3] << 24)) >>> 0;
+    };
+
+    var fail = function(error) {
+#if FETCH_DEBUG
+      console.error('fetch: LZ4 decoding failed: ' + error);
+#endif
+      finished = true;
+      ondone(error);
+    };
+
+    // Decodes the frame headers and blocks that have arrived in full.
+    var decodeAvailable = function() {
+      var pos = 0;
+      for(;;) {
+        var avail = input.length - pos;
+        if (avail < 4) break;
+        if (atContentChecksum) {
+          pos += 4;
+          atContentChecksum = false;
+        } else if (!inFrame) {
+          var magic = u32(pos);
+          if ((magic & 0xFFFFFFF0) >>> 0 == 0x184D2A50) { // A skippable frame
+            if (avail < 8 || avail < 8 + u32(pos + 4)) break;
+            pos += 8 + u32(pos + 4);
+            continue;
+          }
+          if (magic != 0x184D2204) return fail('not an LZ4 frame');
+          if (avail < 7) break;
+          var flg = input[pos+4];
+          var blockMaxSizeId = (input[pos+5] >> 4) & 7;
+          var headerSize = 7 + ((flg & 8) ? 8 : 0) + ((flg & 1) ? 4 : 0);
+          if (avail < headerSize) break;
+          if ((flg >> 6) != 1) return fail('unsupported LZ4 frame version');
+          if (flg & 1) return fail('LZ4 dictionaries are not supported');
+          if (blockMaxSizeId < 4) return fail('invalid LZ4 block maximum size');
+          blockIndependent = !!(flg & 0x20);
+          blockChecksum = !!(flg & 0x10);
+          contentChecksum = !!(flg & 4);
+          maxBlockSize = 1 << (2*blockMaxSizeId + 8); // 64KB, 256KB, 1MB or 4MB
+          output = new Uint8Array((blockIndependent ? 0 : 65536) + maxBlockSize);
+          outputPos = 0;
+          inFrame = true;
+          pos += headerSize;
+        } else {
+          var blockSize = u32(pos);
+          if (!blockSize) { // The end mark of the frame
+            pos += 4;
+            inFrame = false;
+            atContentChecksum = contentChecksum;
+            continue;
+          }
+          var stored = blockSize & 0x80000000;
+          blockSize &= 0x7FFFFFFF;
+          if (blockSize > maxBlockSize) return fail('invalid LZ4 block size');
+          var blockEnd = pos + 4 + blockSize;
+          if (avail < 4 + blockSize + (blockChecksum ? 4 : 0)) break;
+          var end;
+          if (stored) {
+            output.set(input.subarray(pos + 4, blockEnd), outputPos);
+            end = outputPos + blockSize;
+          } else {
+            end = codec.uncompress(input, output, pos + 4, blockEnd, outputPos);
+            if (end < outputPos || end > output.length) return fail('corrupt LZ4 block');
+          }
+          if (end > outputPos) ondata(output.slice(outputPos, end));
+          outputPos = 0;
+          if (!blockIndependent) {
+            // Keep the last 64KB of the output for the next block.
+            if (end > 65536) output.set(output.subarray(end - 65536, end), 0);
+            outputPos = Math.min(end, 65536);
+          }
+          pos = blockEnd + (blockChecksum ? 4 : 0);
+        }
+      }
+      input = input.slice(pos);
+    };
+
+    return {
+      push: function(bytes) {
+        if (finished) return;
+        bytes = new Uint8Array(bytes.buffer || bytes, bytes.byteOffset || 0, bytes.byteLength);
+        if (input.length) {
+          var joined = new Uint8Array(input.length + bytes.length);
+          joined.set(input, 0);
+          joined.set(bytes, input.length);
+          input = joined;
+        } else {
+          input = bytes;
+        }
+        decodeAvailable();
+      },
+      end: function() {
+        if (finished) return;
+        if (inFrame || atContentChecksum || input.length) {
+          fail('truncated LZ4 frame');
+          return;
+        }
+        finished = true;
+        ondone(null);
+      }
+    };
+  },
+
+  // Decodes gzip data with the DecompressionStream of the browser, which does the work asynchronously.
+  createGzipDecoder: function(ondata, ondone) {
+    var finished = false;
+    var ignore = function() {};
+    var done = function(error) {
+      if (finished) return;
+      finished = true;
+#if FETCH_DEBUG
+      if (error) console.error('fetch: gzip decoding failed: ' + error);
+#endif
+      ondone(error);
+    };
+    try {
+      var stream = new DecompressionStream('gzip');
+    } catch(e) {
+      // Not supported by this browser. The failure is reported once all of the data has been passed in.
+      return { push: ignore, end: function() { done(e); } };
+    }
+    var writer = stream.writable.getWriter();
+    var reader = stream.readable.getReader();
+    var read = function() {
+      reader.read().then(function(result) {
+        if (finished) return;
+        if (result.done) {
+          done(null);
+        } else {
+          ondata(result.value);
+          read();
+        }
+      }, function(e) { done(e || 'corrupt gzip data'); });
+    };
+    read();
+    return {
+      push: function(bytes) {
+        if (finished) return;
+        // Copy, since the stream may read the bytes later, and the decoder can not take views to shared memory.
+        // Write errors are reported by the reader.
+        writer.write(new Uint8Array(bytes.buffer || bytes, bytes.byteOffset || 0, bytes.byteLength).slice()).then(ignore, ignore);
+      },
+      end: function() {
+        if (finished) return;
+        writer.close().then(ignore, ignore);
+      }
+    };
+  },
+
+  // IndexedDB requests that are issued during the same tick, or between emscripten_fetch_batch_begin() and
+  // emscripten_fetch_batch_end(), share one transaction.
+  idbBatch: null,
+  idbBatchDepth: 0,
+  // Files that emscripten_fetch_preload_cached_data() has read from IndexedDB, by their paths. Each is handed out to the
+  // next fetch that loads it, and dropped when the file is stored or deleted.
+  preloadedData: {},
+  // The times at which files were loaded from IndexedDB since their access times were last written, by their paths.
+  cacheAccesses: null,
+
+  // Version 2 of the database adds the METADATA store, which holds the size and the last access time of each file in
+  // FILES, and the SETTINGS store, which holds the cache budget of emscripten_fetch_set_cache_budget().
+  dbVersion: 2,
+  dbStores: ['FILES', 'METADATA', 'SETTINGS'],
+
+  // Queues a request to the current batch. issue(filesStore, transaction) is called to issue it once the transaction of
+  // the batch is created, and onerror(exception) if that fails. onabort(error), if given, is called if the transaction is
+  // aborted after the request was issued.
+  idbRequest: function(db, mode, issue, onerror, onabort) {
+    if (Fetch.idbBatch && Fetch.idbBatch.db !== db) Fetch.idbFlush();
+    if (!Fetch.idbBatch) {
+      Fetch.idbBatch = { db: db, mode: 'readonly', requests: [] };
+      if (!Fetch.idbBatchDepth) setTimeout(function() { if (!Fetch.idbBatchDepth) Fetch.idbFlush(); }, 0);
+    }
+    if (mode == 'readwrite') Fetch.idbBatch.mode = mode;
+    Fetch.idbBatch.requests.push({ issue: issue, onerror: onerror, onabort: onabort });
+  },
+
+  idbFlush: function() {
+    var batch = Fetch.idbBatch;
+    if (!batch) return;
+    Fetch.idbBatch = null;
+#if FETCH_DEBUG
+    console.log('fetch: issuing ' + batch.requests.length + ' IndexedDB requests in one ' + batch.mode + ' transaction');
+#endif
+    try {
+      var transaction = batch.db.transaction(Fetch.dbStores, batch.mode);
+      var packages = transaction.objectStore('FILES');
+    } catch(e) {
+      batch.requests.forEach(function(r) { r.onerror(e); });
+      return;
+    }
+    transaction.onabort = function() {
+      batch.requests.forEach(function(r) { if (r.onabort) r.onabort(transaction.error); });
+    };
+    batch.requests.forEach(function(r) {
+      try {
+        r.issue(packages, transaction);
+      } catch(e) {
+        r.onerror(e);
+      }
+    });
+  },
+
+  batchBegin: function() {
+    ++Fetch.idbBatchDepth;
+  },
+
+  batchEnd: function() {
+    if (Fetch.idbBatchDepth > 0 && --Fetch.idbBatchDepth == 0) Fetch.idbFlush();
+  },
+
+  // Reads the given files from IndexedDB in one transaction, so that the fetches that load them afterwards do not need to
+  // access IndexedDB. Calls onfinished(numLoaded) with the number of files that were found.
+  preloadCachedData: function(db, paths, onfinished) {
+    var remaining = paths.length;
+    var numLoaded = 0;
+    if (!db || !remaining) {
+      onfinished(0);
+      return;
+    }
+    var done = function() {
+      if (--remaining == 0) onfinished(numLoaded);
+    };
+    Fetch.batchBegin();
+    paths.forEach(function(path) {
+      Fetch.idbRequest(db, 'readonly', function(packages) {
+        var getRequest = packages.get(path);
+        getRequest.onsuccess = function(event) {
+          if (event.target.result) {
+            Fetch.preloadedData[path] = event.target.result;
+            ++numLoaded;
+          }
+          done();
+        };
+        getRequest.onerror = function(error) {
+          error.preventDefault(); // Do not abort the other requests that share the transaction.
+          done();
+        };
+      }, done);
+    });
+    Fetch.batchEnd();
+  },
+
+  isQuotaExceeded: function(error) {
+    return !!error && (error.name == 'QuotaExceededError' || error.name == 'NS_ERROR_DOM_QUOTA_REACHED');
+  },
+
+  // Records that the file at path was loaded. The access times of the files that are loaded during a tick are written
+  // in one readwrite transaction afterwards, so that the loads themselves only need readonly transactions.
+  touchCachedData: function(db, path) {
+    if (!Fetch.cacheAccesses) {
+      Fetch.cacheAccesses = {};
+      setTimeout(function() {
+        var accesses = Fetch.cacheAccesses;
+        Fetch.cacheAccesses = null;
+        Fetch.idbRequest(db, 'readwrite', function(packages, transaction) {
+          var metadata = transaction.objectStore('METADATA');
+          Object.keys(accesses).forEach(function(path) {
+            var getRequest = metadata.get(path);
+            getRequest.onsuccess = function(event) {
+              var entry = event.target.result;
+              if (!entry) return; // The file has been deleted since.
+              entry.lastAccess = accesses[path];
+              metadata.put(entry, path).onerror = function(error) { error.preventDefault(); };
+            };
+            getRequest.onerror = function(error) { error.preventDefault(); };
+          });
+        }, function(e) {});
+      }, 0);
+    }
+    Fetch.cacheAccesses[path] = Date.now();
+  },
+
+  // Called in the transaction that stored a file: records its size and access time, and evicts other files if the cache
+  // has grown over its budget.
+  cacheDataStored: function(transaction, path, numBytes) {
+    transaction.objectStore('METADATA').put({ size: numBytes, lastAccess: Date.now() }, path).onerror = function(error) { error.preventDefault(); };
+    var budgetRequest = transaction.objectStore('SETTINGS').get('cacheBudget');
+    budgetRequest.onsuccess = function(event) {
+      var budget = event.target.result;
+      if (budget) Fetch.evictCachedData(transaction, budget, 0, path, function(usage) {});
+    };
+    budgetRequest.onerror = function(error) { error.preventDefault(); };
+  },
+
+  // Deletes the least recently loaded files, other than the file at keepPath, until the files take up at most maxBytes
+  // and at least bytesToFree bytes have been freed. Runs in the given readwrite transaction (or a readonly one if nothing
+  // needs to be deleted), and calls ondone({ numBytes, numFiles }) with what remains, or ondone(null) on failure.
+  evictCachedData: function(transaction, maxBytes, bytesToFree, keepPath, ondone) {
+    var metadata = transaction.objectStore('METADATA');
+    var entries = [];
+    var numBytes = 0;
+    var cursorRequest = metadata.openCursor();
+    cursorRequest.onsuccess = function(event) {
+      var cursor = event.target.result;
+      if (cursor) {
+        entries.push({ path: cursor.key, size: cursor.value.size, lastAccess: cursor.value.lastAccess });
+        numBytes += cursor.value.size;
+        cursor.continue();
+        return;
+      }
+      var numFiles = entries.length;
+      if (numBytes > maxBytes || bytesToFree > 0) {
+        entries.sort(function(a, b) { return a.lastAccess - b.lastAccess; });
+        var files = transaction.objectStore('FILES');
+        var numFreed = 0;
+        for(var i = 0; i < entries.length && (numBytes > maxBytes || numFreed < bytesToFree); ++i) {
+          var entry = entries[i];
+          if (entry.path === keepPath) continue;
+#if FETCH_DEBUG
+          console.log('fetch: Evicting file ' + entry.path + ' (' + entry.size + ' bytes) from IndexedDB cache.');
+#endif
+          files.delete(entry.path).onerror = function(error) { error.preventDefault(); };
+          metadata.delete(entry.path).onerror = function(error) { error.preventDefault(); };
+          delete Fetch.preloadedData[entry.path];
+          numBytes -= entry.size;
+          numFreed += entry.size;
+          --numFiles;
+        }
+      }
+      ondone({ numBytes: numBytes, numFiles: numFiles });
+    };
+    cursorRequest.onerror = function(error) {
+      error.preventDefault();
+      ondone(null);
+    };
+  },
+
+  // Sets the cache budget to the given number of bytes (0 for no budget) and evicts files to meet it, or if budget is
+  // undefined, only reads the usage. Calls onfinished({ numBytes, numFiles, budget }), or onfinished(null) on failure.
+  cacheBudget: function(db, budget, onfinished) {
+    if (!db) {
+      onfinished(null);
+      return;
+    }
+    var setting = budget !== undefined;
+    Fetch.idbRequest(db, setting ? 'readwrite' : 'readonly', function(packages, transaction) {
+      var settings = transaction.objectStore('SETTINGS');
+      var withBudget = function(budget) {
+        Fetch.evictCachedData(transaction, (setting && budget) || Infinity, 0, null, function(usage) {
+          if (usage) usage.budget = budget || 0;
+          onfinished(usage);
+        });
+      };
+      if (setting) {
+        settings.put(budget, 'cacheBudget').onerror = function(error) { error.preventDefault(); };
+        withBudget(budget);
+        return;
+      }
+      var budgetRequest = settings.get('cacheBudget');
+      budgetRequest.onsuccess = function(event) { withBudget(event.target.result); };
+      budgetRequest.onerror = function(error) {
+        error.preventDefault();
+        onfinished(null);
+      };
+    }, function(e) { onfinished(null); });
+  },
+
+  // Implements emscripten_fetch_set_cache_budget() and emscripten_fetch_get_cache_usage(): passes the usage to
+  // onfinished(userData, usage) as an emscripten_fetch_cache_usage_t, or a null pointer if IndexedDB is not available.
+  reportCacheUsage: function(budget, onfinished, userData) {
+    var run = function() {
+      Fetch.cacheBudget(Fetch.dbInstance, budget, function(usage) {
+        if (!onfinished) return;
+        var ptr = 0;
+        if (usage) {
+          ptr = _malloc(24);
+          Fetch.setu64(ptr, usage.numBytes);
+          Fetch.setu64(ptr + 8, usage.budget);
+          HEAPU32[ptr + 16 >> 2] = usage.numFiles;
+        }
+        Module['dynCall_vii'](onfinished, userData, ptr);
+        if (ptr) _free(ptr);
+      });
+    };
+#if USE_PTHREADS
+    if (ENVIRONMENT_IS_PTHREAD) {
+      Fetch.openThreadDatabase(run);
+      return;
+    }
+#endif
+    run();
+  },
+
+  // Sends the XHR of a request once every request of a higher priority has been sent, and once fewer XHRs are in
+  // flight than its maxConcurrentRequests attribute allows. Requests of the same priority are sent in order.
+  scheduleRequest: function(request) {
+    request.order = Fetch.numScheduledRequests++;
+    Fetch.queuedRequests.push(request);
+    Fetch.sendQueuedRequests();
+  },
+
+  sendQueuedRequests: function() {
+    Fetch.queuedRequests.sort(function(a, b) { return (b.priority - a.priority) || (a.order - b.order); });
+    while (Fetch.queuedRequests.length) {
+      var request = Fetch.queuedRequests[0];
+      if (request.maxConcurrentRequests && Fetch.numActiveRequests >= request.maxConcurrentRequests) break;
+      Fetch.queuedRequests.shift();
+      ++Fetch.numActiveRequests;
+      request.send();
+    }
+  },
+
+  // Called once the XHR of a request has finished, before its results are reported, so that fetches started from the
+  // callbacks do not share it anymore.
+  finishRequest: function(request) {
+    if (request.finished) return;
+    request.finished = true;
+    if (request.coalesceKey && Fetch.coalescableRequests[request.coalesceKey] === request) delete Fetch.coalescableRequests[request.coalesceKey];
+    --Fetch.numActiveRequests;
+    Fetch.sendQueuedRequests();
+  },
+
   openDatabase: function(dbname, dbversion, onsuccess, onerror) {
     try {
 #if FETCH_DEBUG
@@ -49,19 +648,63 @@ var Fetch = {
     } catch (e) { return onerror(e); }
 
     openRequest.onupgradeneeded = function(event) {
+      var db = event.target.result;
+      if (event.oldVersion == 1 && db.objectStoreNames.contains('FILES')) {
 #if FETCH_DEBUG
-      console.log('fetch: IndexedDB upgrade needed. Clearing database.');
+        console.log('fetch: IndexedDB upgrade needed. Adding cache metadata.');
 #endif
-      var db = event.target.result;
-      if (db.objectStoreNames.contains('FILES')) {
-        db.deleteObjectStore('FILES');
+        // Keep the files of version 1. They count as never loaded, so they are the first ones to be evicted.
+        var metadata = db.createObjectStore('METADATA');
+        db.createObjectStore('SETTINGS');
+        event.target.transaction.objectStore('FILES').openCursor().onsuccess = function(event) {
+          var cursor = event.target.result;
+          if (!cursor) return;
+          var value = cursor.value;
+          // Skip the records of interrupted resumable downloads.
+          if ((value instanceof ArrayBuffer || ArrayBuffer.isView(value)) && String(cursor.key).indexOf('\0partial') < 0) metadata.put({ size: value.byteLength, lastAccess: 0 }, cursor.key);
+          cursor.continue();
+        };
+        return;
       }
-      db.createObjectStore('FILES');
+#if FETCH_DEBUG
+      console.log('fetch: IndexedDB upgrade needed. Clearing database.');
+#endif
+      Fetch.dbStores.forEach(function(name) {
+        if (db.objectStoreNames.contains(name)) db.deleteObjectStore(name);
+        db.createObjectStore(name);
+      });
     };
     openRequest.onsuccess = function(event) { onsuccess(event.target.result); };
     openRequest.onerror = function(error) { onerror(error); };
   },
 
+#if USE_PTHREADS
+  // Each pthread opens its own connection to the database the first time one of its fetches needs it, so that the
+  // fetches that are started on the thread run on it from start to finish, without going through another thread.
+  // Calls onready() once Fetch.dbInstance is either open, or false if it could not be opened.
+  openThreadDatabase: function(onready) {
+    if (Fetch.dbInstance !== undefined) {
+      onready();
+      return;
+    }
+    if (Fetch.dbOpenWaiters) {
+      Fetch.dbOpenWaiters.push(onready);
+      return;
+    }
+    Fetch.dbOpenWaiters = [onready];
+    var opened = function(db) {
+#if FETCH_DEBUG
+      console.log('fetch: ' + (db ? 'opened' : 'failed to open') + ' IndexedDB on a pthread.');
+#endif
+      Fetch.dbInstance = db;
+      var waiters = Fetch.dbOpenWaiters;
+      Fetch.dbOpenWaiters = null;
+      waiters.forEach(function(f) { f(); });
+    };
+    Fetch.openDatabase('emscripten_filesystem', Fetch.dbVersion, opened, function() { opened(false); });
+  },
+
+#endif
   initFetchWorker: function() {
     var stackSize = 128*1024;
     var stack = allocate(stackSize>>2, "i32*", ALLOC_DYNAMIC);
@@ -103,7 +746,7 @@ var Fetch = {
       }
 #endif
     };
-    Fetch.openDatabase('emscripten_filesystem', 1, onsuccess, onerror);
+    Fetch.openDatabase('emscripten_filesystem', Fetch.dbVersion, onsuccess, onerror);
 
 #if USE_PTHREADS
     if (isMainThread) {
@@ -143,12 +786,13 @@ function __emscripten_fetch_delete_cached_data(db, fetch, onsuccess, onerror) {
   if (!path) path = HEAPU32[fetch + Fetch.fetch_t_offset_url >> 2];
   var pathStr = Pointer_stringify(path);
 
-  try {
-    var transaction = db.transaction(['FILES'], 'readwrite');
-    var packages = transaction.objectStore('FILES');
+  delete Fetch.preloadedData[pathStr];
+  Fetch.idbRequest(db, 'readwrite', function(packages, transaction) {
+    transaction.objectStore('METADATA').delete(pathStr).onerror = function(error) { error.preventDefault(); };
     var request = packages.delete(pathStr);
     request.onsuccess = function(event) {
       var value = event.target.result;
+      delete Fetch.preloadedData[pathStr];
 #if FETCH_DEBUG
       console.log('fetch: Deleted file ' + pathStr + ' from IndexedDB');
 #endif
@@ -165,17 +809,18 @@ function __emscripten_fetch_delete_cached_data(db, fetch, onsuccess, onerror) {
 #if FETCH_DEBUG
       console.error('fetch: Failed to delete file ' + pathStr + ' from IndexedDB! error: ' + error);
 #endif
+      error.preventDefault(); // Do not abort the other requests that share the transaction.
       HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
       HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 404; // Mimic XHR HTTP status code 404 "Not Found"
       stringToUTF8("Not Found", fetch + Fetch.fetch_t_offset_statusText, 64);
       onerror(fetch, 0, error);
     };
-  } catch(e) {
+  }, function(e) {
 #if FETCH_DEBUG
     console.error('fetch: Failed to load file ' + pathStr + ' from IndexedDB! Got exception ' + e);
 #endif
     onerror(fetch, 0, e);
-  }
+  });
 }
 
 function __emscripten_fetch_load_cached_data(db, fetch, onsuccess, onerror) {
@@ -192,56 +837,99 @@ function __emscripten_fetch_load_cached_data(db, fetch, onsuccess, onerror) {
   if (!path) path = HEAPU32[fetch + Fetch.fetch_t_offset_url >> 2];
   var pathStr = Pointer_stringify(path);
 
-  try {
-    var transaction = db.transaction(['FILES'], 'readonly');
-    var packages = transaction.objectStore('FILES');
-    var getRequest = packages.get(pathStr);
-    getRequest.onsuccess = function(event) {
-      if (event.target.result) {
-        var value = event.target.result;
-        var len = value.byteLength || value.length;
-#if FETCH_DEBUG
-        console.log('fetch: Loaded file ' + pathStr + ' from IndexedDB, length: ' + len);
-#endif
-
-        // The data pointer malloc()ed here has the same lifetime as the emscripten_fetch_t structure itself has, and is
-        // freed when emscripten_fetch_close() is called.
-        var ptr = _malloc(len);
-        HEAPU8.set(new Uint8Array(value), ptr);
-        HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = ptr;
-        Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, len);
-        Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
-        Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, len);
-        HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
-        HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 200; // Mimic XHR HTTP status code 200 "OK"
-        stringToUTF8("OK", fetch + Fetch.fetch_t_offset_statusText, 64);
-        onsuccess(fetch, 0, value);
-      } else {
-        // Succeeded to load, but the load came back with the value of undefined, treat that as an error since we never store undefined in db.
+  var rangeStart = Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeStart);
+  var rangeEnd = Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeEnd);
+  var ranged = rangeStart || rangeEnd;
+  var fetchAttributes = HEAPU32[fetch_attr + Fetch.attr_t_offset_attributes >> 2];
+  var decoding = fetchAttributes & (256/*EMSCRIPTEN_FETCH_DECODE_LZ4*/ | 512/*EMSCRIPTEN_FETCH_DECODE_GZIP*/);
+
+  var deliver = function(bytes, totalBytes, value) {
+    var numBytes = bytes.byteLength || bytes.length;
+    var ptr = Fetch.copyToHeap(fetch, bytes, 0);
+    if (!ptr) {
+      Fetch.reportDestinationBufferTooSmall(fetch, numBytes);
+      onerror(fetch, 0, 'destination buffer too small');
+      return;
+    }
+    HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = ptr;
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, numBytes);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, totalBytes);
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    if (ranged) {
+      HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 206; // Mimic XHR HTTP status code 206 "Partial Content"
+      stringToUTF8("Partial Content", fetch + Fetch.fetch_t_offset_statusText, 64);
+    } else {
+      HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 200; // Mimic XHR HTTP status code 200 "OK"
+      stringToUTF8("OK", fetch + Fetch.fetch_t_offset_statusText, 64);
+    }
+    onsuccess(fetch, 0, value);
+  };
+
+  var loaded = function(value) {
+    if (value) {
+      var len = value.byteLength || value.length;
 #if FETCH_DEBUG
-        console.error('fetch: File ' + pathStr + ' not found in IndexedDB');
+      console.log('fetch: Loaded file ' + pathStr + ' from IndexedDB, length: ' + len);
 #endif
-        HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
-        HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 404; // Mimic XHR HTTP status code 404 "Not Found"
-        stringToUTF8("Not Found", fetch + Fetch.fetch_t_offset_statusText, 64);
-        onerror(fetch, 0, 'no data');
+      Fetch.touchCachedData(db, pathStr);
+      Fetch.timingCacheResult(fetch, true);
+      var bytes = ranged ? value.slice(rangeStart, rangeEnd || len) : value;
+      if (!decoding) {
+        deliver(bytes, len, value);
+        return;
       }
+      // Files are stored as they were downloaded, so they are decoded each time they are loaded.
+      Fetch.decode(fetchAttributes, bytes, function(error, decoded) {
+        if (error) {
+          Fetch.reportDecodingFailed(fetch);
+          onerror(fetch, 0, error);
+        } else {
+          deliver(decoded, decoded.length, value);
+        }
+      });
+    } else {
+      // Succeeded to load, but the load came back with the value of undefined, treat that as an error since we never store undefined in db.
+#if FETCH_DEBUG
+      console.error('fetch: File ' + pathStr + ' not found in IndexedDB');
+#endif
+      Fetch.timingCacheResult(fetch, false);
+      HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+      HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 404; // Mimic XHR HTTP status code 404 "Not Found"
+      stringToUTF8("Not Found", fetch + Fetch.fetch_t_offset_statusText, 64);
+      onerror(fetch, 0, 'no data');
+    }
+  };
+
+  if (pathStr in Fetch.preloadedData) {
+    var value = Fetch.preloadedData[pathStr];
+    delete Fetch.preloadedData[pathStr];
+    loaded(value);
+    return;
+  }
+
+  Fetch.idbRequest(db, 'readonly', function(packages) {
+    var getRequest = packages.get(pathStr);
+    getRequest.onsuccess = function(event) {
+      loaded(event.target.result);
     };
     getRequest.onerror = function(error) {
 #if FETCH_DEBUG
       console.error('fetch: Failed to load file ' + pathStr + ' from IndexedDB!');
 #endif
+      error.preventDefault(); // Do not abort the other requests that share the transaction.
+      Fetch.timingCacheResult(fetch, false);
       HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
       HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 404; // Mimic XHR HTTP status code 404 "Not Found"
       stringToUTF8("Not Found", fetch + Fetch.fetch_t_offset_statusText, 64);
       onerror(fetch, 0, error);
     };
-  } catch(e) {
+  }, function(e) {
 #if FETCH_DEBUG
     console.error('fetch: Failed to load file ' + pathStr + ' from IndexedDB! Got exception ' + e);
 #endif
     onerror(fetch, 0, e);
-  }
+  });
 }
 
 function __emscripten_fetch_cache_data(db, fetch, data, onsuccess, onerror) {
@@ -258,37 +946,73 @@ function __emscripten_fetch_cache_data(db, fetch, data, onsuccess, onerror) {
   if (!destinationPath) destinationPath = HEAPU32[fetch + Fetch.fetch_t_offset_url >> 2];
   var destinationPathStr = Pointer_stringify(destinationPath);
 
-  try {
-    var transaction = db.transaction(['FILES'], 'readwrite');
-    var packages = transaction.objectStore('FILES');
-    var putRequest = packages.put(data, destinationPathStr);
-    putRequest.onsuccess = function(event) {
+  var numBytes = data.byteLength || data.length;
+  var reported = false;
+  var stored = function() {
+    if (reported) return;
+    reported = true;
 #if FETCH_DEBUG
-      console.log('fetch: Stored file "' + destinationPathStr + '" to IndexedDB cache.');
+    console.log('fetch: Stored file "' + destinationPathStr + '" to IndexedDB cache.');
 #endif
-      HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
-      HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 200; // Mimic XHR HTTP status code 200 "OK"
-      stringToUTF8("OK", fetch + Fetch.fetch_t_offset_statusText, 64);
-      onsuccess(fetch, 0, destinationPathStr);
-    };
-    putRequest.onerror = function(error) {
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 200; // Mimic XHR HTTP status code 200 "OK"
+    stringToUTF8("OK", fetch + Fetch.fetch_t_offset_statusText, 64);
+    onsuccess(fetch, 0, destinationPathStr);
+  };
+  var failed = function(error) {
+    if (reported) return;
+    reported = true;
 #if FETCH_DEBUG
-      console.error('fetch: Failed to store file "' + destinationPathStr + '" to IndexedDB cache!');
+    console.error('fetch: Failed to store file "' + destinationPathStr + '" to IndexedDB cache!');
 #endif
-      // Most likely we got an error if IndexedDB is unwilling to store any more data for this page.
-      // TODO: Can we identify and break down different IndexedDB-provided errors and convert those
-      // to more HTTP status codes for more information?
-      HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
-      HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 413; // Mimic XHR HTTP status code 413 "Payload Too Large"
-      stringToUTF8("Payload Too Large", fetch + Fetch.fetch_t_offset_statusText, 64);
-      onerror(fetch, 0, error);
-    };
-  } catch(e) {
+    // Most likely we got an error if IndexedDB is unwilling to store any more data for this page.
+    // TODO: Can we identify and break down different IndexedDB-provided errors and convert those
+    // to more HTTP status codes for more information?
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 413; // Mimic XHR HTTP status code 413 "Payload Too Large"
+    stringToUTF8("Payload Too Large", fetch + Fetch.fetch_t_offset_statusText, 64);
+    onerror(fetch, 0, error);
+  };
+
+  // If the browser is out of quota for the page, either when the file is put or when the transaction is committed,
+  // evict the least recently loaded files to make room for it, and try once more.
+  var retried = false;
+  var retry = function(error) {
+    if (retried || !Fetch.isQuotaExceeded(error)) return false;
+    retried = true;
+#if FETCH_DEBUG
+    console.log('fetch: IndexedDB quota exceeded while storing file "' + destinationPathStr + '". Evicting files to make room.');
+#endif
+    Fetch.idbRequest(db, 'readwrite', function(packages, transaction) {
+      Fetch.evictCachedData(transaction, Infinity, numBytes, destinationPathStr, function(usage) { store(); });
+    }, function(e) { failed(e); });
+    return true;
+  };
+
+  var store = function() {
+    delete Fetch.preloadedData[destinationPathStr];
+    Fetch.idbRequest(db, 'readwrite', function(packages, transaction) {
+      var putRequest = packages.put(data, destinationPathStr);
+      putRequest.onsuccess = function(event) {
+        delete Fetch.preloadedData[destinationPathStr];
+        Fetch.cacheDataStored(transaction, destinationPathStr, numBytes);
+        stored();
+      };
+      putRequest.onerror = function(error) {
+        error.preventDefault(); // Do not abort the other requests that share the transaction.
+        if (!retry(putRequest.error)) failed(error);
+      };
+    }, function(e) {
 #if FETCH_DEBUG
       console.error('fetch: Failed to store file "' + destinationPathStr + '" to IndexedDB cache! Exception: ' + e);
 #endif
-    onerror(fetch, 0, e);
-  }
+      failed(e);
+    }, function(error) {
+      // The fetch has already succeeded if the put did, but the file is not there unless it can be stored again.
+      if (!retry(error)) failed(error);
+    });
+  };
+  store();
 }
 
 function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
@@ -316,6 +1040,9 @@ function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
   var overriddenMimeType = HEAPU32[fetch_attr + Fetch.attr_t_offset_overriddenMimeType >> 2];
   var dataPtr = HEAPU32[fetch_attr + Fetch.attr_t_offset_requestData >> 2];
   var dataLength = HEAPU32[fetch_attr + Fetch.attr_t_offset_requestDataSize >> 2];
+  var destinationBuffer = HEAPU32[fetch_attr + Fetch.attr_t_offset_destinationBuffer >> 2];
+  var streamedBytes = 0;
+  var streamedBytesFit = true;
 
   var fetchAttrLoadToMemory = !!(fetchAttributes & 1/*EMSCRIPTEN_FETCH_LOAD_TO_MEMORY*/);
   var fetchAttrStreamData = !!(fetchAttributes & 2/*EMSCRIPTEN_FETCH_STREAM_DATA*/);
@@ -325,6 +1052,36 @@ function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
   var fetchAttrNoDownload = !!(fetchAttributes & 32/*EMSCRIPTEN_FETCH_NO_DOWNLOAD*/);
   var fetchAttrSynchronous = !!(fetchAttributes & 64/*EMSCRIPTEN_FETCH_SYNCHRONOUS*/);
   var fetchAttrWaitable = !!(fetchAttributes & 128/*EMSCRIPTEN_FETCH_WAITABLE*/);
+  var decoding = fetchAttributes & (256/*EMSCRIPTEN_FETCH_DECODE_LZ4*/ | 512/*EMSCRIPTEN_FETCH_DECODE_GZIP*/);
+
+  var priority = HEAP32[fetch_attr + Fetch.attr_t_offset_priority >> 2];
+  var maxConcurrentRequests = HEAPU32[fetch_attr + Fetch.attr_t_offset_maxConcurrentRequests >> 2];
+  var rangeStart = Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeStart);
+  var rangeEnd = Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeEnd);
+  var ranged = rangeStart || rangeEnd;
+
+  var listener = { fetch: fetch, onsuccess: onsuccess, onerror: onerror, onprogress: onprogress, loadToMemory: fetchAttrLoadToMemory, destinationBuffer: destinationBuffer };
+
+  // Plain GET requests for the same URL that are in flight at the same time share one XHR, and its response is
+  // delivered to each of the fetches.
+  var coalesceKey = (requestMethod == 'GET' && !fetchAttrSynchronous && !fetchAttrStreamData && !userName && !password && !requestHeaders && !overriddenMimeType && !(dataPtr && dataLength))
+    ? url_ + '\n' + withCredentials + ' ' + timeoutMsecs + ' ' + rangeStart + '-' + rangeEnd + ' ' + decoding : null;
+  var request = coalesceKey && Fetch.coalescableRequests[coalesceKey];
+  if (request) {
+#if FETCH_DEBUG
+    console.log('fetch: sharing the xhr of URL "' + url_ + '" that is already in flight');
+#endif
+    request.listeners.push(listener);
+    if (priority > request.priority) {
+      request.priority = priority;
+      if (!request.finished) Fetch.sendQueuedRequests();
+    }
+    Fetch.xhrs.push(request.xhr);
+    HEAPU32[fetch + Fetch.fetch_t_offset_id >> 2] = Fetch.xhrs.length;
+    if (request.sent) Fetch.timingSent(fetch);
+    if (request.receiving) Fetch.timingFirstByte(fetch);
+    return;
+  }
 
   var userNameStr = userName ? Pointer_stringify(userName) : undefined;
   var passwordStr = password ? Pointer_stringify(password) : undefined;
@@ -362,34 +1119,73 @@ function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
       xhr.setRequestHeader(keyStr, valueStr);
     }
   }
+  if (ranged) {
+    var range = 'bytes=' + rangeStart + '-' + (rangeEnd ? rangeEnd - 1 : ''); // The end of an HTTP byte range is inclusive.
+#if FETCH_DEBUG
+    console.log('fetch: xhr.setRequestHeader("Range", "' + range + '");');
+#endif
+    xhr.setRequestHeader('Range', range);
+  }
   Fetch.xhrs.push(xhr);
   var id = Fetch.xhrs.length;
   HEAPU32[fetch + Fetch.fetch_t_offset_id >> 2] = id;
   var data = (dataPtr && dataLength) ? HEAPU8.slice(dataPtr, dataPtr + dataLength) : null;
-  // TODO: Support specifying custom headers to the request.
 
-  xhr.onload = function(e) {
+  request = {
+    xhr: xhr,
+    listeners: [listener],
+    priority: priority,
+    maxConcurrentRequests: maxConcurrentRequests,
+    coalesceKey: coalesceKey,
+    send: function() {
+#if FETCH_DEBUG
+      console.log('fetch: xhr.send(data=' + data + ')');
+#endif
+      request.sent = true;
+      request.listeners.forEach(function(l) { Fetch.timingSent(l.fetch); });
+      try {
+        xhr.send(data);
+      } catch(e) {
+#if FETCH_DEBUG
+        console.error('fetch: xhr failed with exception: ' + e);
+#endif
+        Fetch.finishRequest(request);
+        request.listeners.forEach(function(l) { if (l.onerror) l.onerror(l.fetch, xhr, e); });
+      }
+    }
+  };
+
+  // Reports the body of the response, which has been cut to the requested range and decoded, and the size of the whole
+  // file, if known.
+  function loaded(l, e, response, totalBytes) {
+    var fetch = l.fetch;
     var len = xhr.response ? xhr.response.byteLength : 0;
     var ptr = 0;
     var ptrLen = 0;
-    if (fetchAttrLoadToMemory && !fetchAttrStreamData) {
-      ptrLen = len;
+    if (l.loadToMemory && !fetchAttrStreamData) {
+      ptrLen = response.byteLength;
 #if FETCH_DEBUG
-      console.log('fetch: allocating ' + ptrLen + ' bytes in Emscripten heap for xhr data');
+      console.log('fetch: copying ' + ptrLen + ' bytes to Emscripten heap for xhr data');
 #endif
-      // The data pointer malloc()ed here has the same lifetime as the emscripten_fetch_t structure itself has, and is
-      // freed when emscripten_fetch_close() is called.
-      ptr = _malloc(ptrLen);
-      HEAPU8.set(new Uint8Array(xhr.response), ptr);
+      ptr = Fetch.copyToHeap(fetch, response, 0);
+    } else if (l.loadToMemory && l.destinationBuffer) {
+      // The streamed chunks have already been placed in the destination buffer, report all of them together.
+      ptr = streamedBytesFit ? l.destinationBuffer : 0;
+      ptrLen = streamedBytes;
     }
     HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = ptr;
     Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, ptrLen);
     Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
-    if (len) {
+    if (totalBytes) {
       // If the final XHR.onload handler receives the bytedata to compute total length, report that,
       // otherwise don't write anything out here, which will retain the latest byte size reported in
       // the most recent XHR.onprogress handler.
-      Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, len);
+      Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, totalBytes);
+    }
+    if (xhr.status == 206 && !decoding) {
+      // A response to a Range request reports the size of the whole resource in the Content-Range header, e.g. "bytes 0-1023/4096".
+      var contentRange = /\/(\d+)$/.exec(xhr.getResponseHeader('Content-Range') || '');
+      if (contentRange) Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, parseInt(contentRange[1]));
     }
     HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = xhr.readyState;
     if (xhr.readyState === 4 && xhr.status === 0) {
@@ -398,19 +1194,26 @@ function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
     }
     HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = xhr.status;
     if (xhr.statusText) stringToUTF8(xhr.statusText, fetch + Fetch.fetch_t_offset_statusText, 64);
-    if (xhr.status == 200) {
+    if (l.loadToMemory && !ptr && l.destinationBuffer && (xhr.status == 200 || xhr.status == 206)) {
 #if FETCH_DEBUG
-      console.log('fetch: xhr of URL "' + xhr.url_ + '" / responseURL "' + xhr.responseURL + '" succeeded with status 200');
+      console.error('fetch: xhr of URL "' + xhr.url_ + '" did not fit in the destination buffer');
 #endif
-      if (onsuccess) onsuccess(fetch, xhr, e);
+      Fetch.reportDestinationBufferTooSmall(fetch, fetchAttrStreamData ? streamedBytes : response.byteLength);
+      if (l.onerror) l.onerror(fetch, xhr, e);
+    } else if (xhr.status == 200 || xhr.status == 206) {
+#if FETCH_DEBUG
+      console.log('fetch: xhr of URL "' + xhr.url_ + '" / responseURL "' + xhr.responseURL + '" succeeded with status ' + xhr.status);
+#endif
+      if (l.onsuccess) l.onsuccess(fetch, xhr, e);
     } else {
 #if FETCH_DEBUG
       console.error('fetch: xhr of URL "' + xhr.url_ + '" / responseURL "' + xhr.responseURL + '" failed with status ' + xhr.status);
 #endif
-      if (onerror) onerror(fetch, xhr, e);
+      if (l.onerror) l.onerror(fetch, xhr, e);
     }
   }
-  xhr.onerror = function(e) {
+  function failed(l, e) {
+    var fetch = l.fetch;
     var status = xhr.status; // XXX TODO: Overwriting xhr.status doesn't work here, so don't override anywhere else either.
     if (xhr.readyState == 4 && status == 0) status = 404; // If no error recorded, pretend it was 404 Not Found.
 #if FETCH_DEBUG
@@ -422,51 +1225,391 @@ function __emscripten_fetch_xhr(fetch, onsuccess, onerror, onprogress) {
     Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, 0);
     HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = xhr.readyState;
     HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = status;
-    if (onerror) onerror(fetch, xhr, e);
+    if (l.onerror) l.onerror(fetch, xhr, e);
   }
-  xhr.ontimeout = function(e) {
+  function timedOut(l, e) {
 #if FETCH_DEBUG
     console.error('fetch: xhr of URL "' + xhr.url_ + '" / responseURL "' + xhr.responseURL + '" timed out, readyState ' + xhr.readyState + ' and status ' + xhr.status);
 #endif
-    if (onerror) onerror(fetch, xhr, e);
+    if (l.onerror) l.onerror(l.fetch, xhr, e);
   }
-  xhr.onprogress = function(e) {
-    var ptrLen = (fetchAttrLoadToMemory && fetchAttrStreamData && xhr.response) ? xhr.response.byteLength : 0;
+  // Reports a chunk of the response that starts at the given offset, and the size of the whole response, if known.
+  function progressed(l, e, chunk, offset, total) {
+    var fetch = l.fetch;
+    var ptrLen = (l.loadToMemory && fetchAttrStreamData && chunk) ? chunk.byteLength : 0;
     var ptr = 0;
-    if (fetchAttrLoadToMemory && fetchAttrStreamData) {
+    if (l.loadToMemory && fetchAttrStreamData) {
 #if FETCH_DEBUG
-      console.log('fetch: allocating ' + ptrLen + ' bytes in Emscripten heap for xhr data');
+      console.log('fetch: copying ' + ptrLen + ' bytes to Emscripten heap for xhr data');
 #endif
-      // The data pointer malloc()ed here has the same lifetime as the emscripten_fetch_t structure itself has, and is
-      // freed when emscripten_fetch_close() is called.
-      ptr = _malloc(ptrLen);
-      HEAPU8.set(new Uint8Array(xhr.response), ptr);
+      ptr = Fetch.copyToHeap(fetch, chunk || new ArrayBuffer(0), offset);
+      streamedBytes = offset + ptrLen;
+      if (!ptr) {
+        // Keep receiving progress reports, but the fetch fails once it finishes.
+        streamedBytesFit = false;
+        ptrLen = 0;
+      }
     }
     HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = ptr;
     Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, ptrLen);
-    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, e.loaded - ptrLen);
-    Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, e.total);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, offset);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, total);
     HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = xhr.readyState;
     if (xhr.readyState >= 3 && xhr.status === 0 && e.loaded > 0) xhr.status = 200; // If loading files from a source that does not give HTTP status code, assume success if we get data bytes
     HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = xhr.status;
     if (xhr.statusText) stringToUTF8(xhr.statusText, fetch + Fetch.fetch_t_offset_statusText, 64);
-    if (onprogress) onprogress(fetch, xhr, e);
+    if (l.onprogress) l.onprogress(fetch, xhr, e);
+  }
+
+  // Streamed chunks are decoded as they arrive, and the decoded bytes are reported in their place. The size of the
+  // decoded file is not known until all of it has been decoded.
+  var streamDecoder = null;
+  var streamDecodeFinished = false;
+  var streamDecodeError = null;
+  var onStreamDecodeFinished = null;
+  var decodedBytes = 0;
+  var lastProgressEvent = null;
+  if (decoding && fetchAttrStreamData) {
+    streamDecoder = Fetch.createDecoder(fetchAttributes, function(chunk) {
+      request.listeners.forEach(function(l) { progressed(l, lastProgressEvent, chunk, decodedBytes, 0); });
+      decodedBytes += chunk.length;
+    }, function(error) {
+      streamDecodeFinished = true;
+      streamDecodeError = error;
+      if (onStreamDecodeFinished) onStreamDecodeFinished();
+    });
+  }
+
+  // Called once the headers of the response have arrived.
+  function receiving() {
+    if (request.receiving) return;
+    request.receiving = true;
+    request.listeners.forEach(function(l) { Fetch.timingFirstByte(l.fetch); });
+  }
+
+  xhr.onreadystatechange = function() {
+    if (xhr.readyState >= 2/*HEADERS_RECEIVED*/) receiving();
+  }
+  xhr.onload = function(e) {
+    receiving();
+    Fetch.finishRequest(request);
+    var len = xhr.response ? xhr.response.byteLength : 0;
+    var response = xhr.response || new ArrayBuffer(0);
+    // A server that does not support Range requests sends the whole file.
+    if (ranged && xhr.status == 200 && !fetchAttrStreamData) response = response.slice(rangeStart, rangeEnd || len);
+    var deliver = function(error, body, totalBytes) {
+      request.listeners.forEach(function(l) {
+        if (!error) {
+          loaded(l, e, body, totalBytes);
+          return;
+        }
+        Fetch.reportDecodingFailed(l.fetch);
+        if (l.onerror) l.onerror(l.fetch, xhr, error);
+      });
+    };
+    if (!decoding || (xhr.status != 200 && xhr.status != 206 && xhr.status != 0)) {
+      deliver(null, response, len);
+    } else if (streamDecoder) {
+      onStreamDecodeFinished = function() { deliver(streamDecodeError, null, decodedBytes); };
+      if (streamDecodeFinished) onStreamDecodeFinished(); // Decoding has already failed.
+      else streamDecoder.end();
+    } else {
+      Fetch.decode(fetchAttributes, response, function(error, decoded) {
+        deliver(error, decoded, decoded ? decoded.length : 0);
+      });
+    }
+  }
+  xhr.onerror = function(e) {
+    Fetch.finishRequest(request);
+    request.listeners.forEach(function(l) { failed(l, e); });
+  }
+  xhr.ontimeout = function(e) {
+    Fetch.finishRequest(request);
+    request.listeners.forEach(function(l) { timedOut(l, e); });
+  }
+  xhr.onprogress = function(e) {
+    receiving();
+    if (streamDecoder) {
+      lastProgressEvent = e;
+      if (xhr.response) streamDecoder.push(xhr.response);
+      return;
+    }
+    request.listeners.forEach(function(l) {
+      var chunkLength = (l.loadToMemory && fetchAttrStreamData && xhr.response) ? xhr.response.byteLength : 0;
+      progressed(l, e, xhr.response, e.loaded - chunkLength, e.total);
+    });
   }
+
+  if (fetchAttrSynchronous) {
+    // A synchronous XHR can not wait for its turn, since the calling thread blocks on it.
+    request.finished = true;
+    request.send();
+  } else {
+    if (coalesceKey) Fetch.coalescableRequests[coalesceKey] = request;
+    Fetch.scheduleRequest(request);
+  }
+}
+
+// Downloads a file for EMSCRIPTEN_FETCH_APPEND in a sequence of Range requests, and stores each part to IndexedDB as
+// soon as it arrives, so that a download that was interrupted continues from the first missing part. The parts are
+// stored under the path of the file followed by '\0partial' and their index, together with a record under
+// path + '\0partial' that says how many of them there are, and which version of the file they belong to. Once the
+// download completes, the whole file replaces the parts.
+function __emscripten_fetch_resumable_xhr(fetch, onsuccess, onerror, onprogress) {
+  var db = Fetch.dbInstance;
+  var fetch_attr = fetch + Fetch.fetch_t_offset___attributes;
+  var url = HEAPU32[fetch + Fetch.fetch_t_offset_url >> 2];
+  var path = HEAPU32[fetch_attr + Fetch.attr_t_offset_destinationPath >> 2];
+  if (!path) path = url;
+  var url_ = Pointer_stringify(url);
+  var partialKey = Pointer_stringify(path) + '\0partial';
+  var fetchAttributes = HEAPU32[fetch_attr + Fetch.attr_t_offset_attributes >> 2];
+  var fetchAttrLoadToMemory = !!(fetchAttributes & 1/*EMSCRIPTEN_FETCH_LOAD_TO_MEMORY*/);
+  var decoding = fetchAttributes & (256/*EMSCRIPTEN_FETCH_DECODE_LZ4*/ | 512/*EMSCRIPTEN_FETCH_DECODE_GZIP*/);
+  var timeoutMsecs = HEAPU32[fetch_attr + Fetch.attr_t_offset_timeoutMSecs >> 2];
+  var withCredentials = !!HEAPU32[fetch_attr + Fetch.attr_t_offset_withCredentials >> 2];
+  var userName = HEAPU32[fetch_attr + Fetch.attr_t_offset_userName >> 2];
+  var password = HEAPU32[fetch_attr + Fetch.attr_t_offset_password >> 2];
+  var requestHeaders = HEAPU32[fetch_attr + Fetch.attr_t_offset_requestHeaders >> 2];
+  var priority = HEAP32[fetch_attr + Fetch.attr_t_offset_priority >> 2];
+  var maxConcurrentRequests = HEAPU32[fetch_attr + Fetch.attr_t_offset_maxConcurrentRequests >> 2];
+  var userNameStr = userName ? Pointer_stringify(userName) : undefined;
+  var passwordStr = password ? Pointer_stringify(password) : undefined;
+  var chunkSize = Fetch.resumeChunkSize;
+  var partial = { numChunks: 0, totalBytes: 0, validator: null };
+  var resumedChunks = 0; // The parts before this were stored by an earlier download.
+  var chunks = []; // The parts that have been downloaded.
+
+  var fail = function(xhr, e, status, statusText) {
+#if FETCH_DEBUG
+    console.error('fetch: resumable download of URL "' + url_ + '" failed with status ' + status + ' after ' + partial.numChunks + ' parts');
+#endif
+    HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = 0;
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
+    HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 4; // Mimic XHR readyState 4 === 'DONE: The operation is complete'
+    HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = status;
+    stringToUTF8(statusText || '', fetch + Fetch.fetch_t_offset_statusText, 64);
+    onerror(fetch, xhr, e);
+  };
+
+  var discardParts = function() {
+    Fetch.batchBegin();
+    for(var i = 0; i < partial.numChunks; ++i) {
+      (function(key) {
+        Fetch.idbRequest(db, 'readwrite', function(packages) {
+          packages.delete(key).onerror = function(error) { error.preventDefault(); };
+        }, function(e) {});
+      })(partialKey + i);
+    }
+    Fetch.idbRequest(db, 'readwrite', function(packages) {
+      packages.delete(partialKey).onerror = function(error) { error.preventDefault(); };
+    }, function(e) {});
+    Fetch.batchEnd();
+  };
+
+  var complete = function(data, xhr, e) {
+    discardParts();
+    if (decoding) {
+      // The file is stored as it was downloaded, and only its decoded form goes to the heap.
+      Fetch.decode(fetchAttributes, data, function(error, decoded) {
+        if (error) {
+          Fetch.reportDecodingFailed(fetch);
+          onerror(fetch, xhr, error);
+        } else {
+          completeWith(data, decoded, xhr, e);
+        }
+      });
+    } else {
+      completeWith(data, data, xhr, e);
+    }
+  };
+
+  var completeWith = function(data, bytes, xhr, e) {
+    var ptr = 0;
+    if (fetchAttrLoadToMemory) {
+      ptr = Fetch.copyToHeap(fetch, bytes, 0);
+      if (!ptr) {
+        Fetch.reportDestinationBufferTooSmall(fetch, bytes.byteLength);
+        onerror(fetch, xhr, e);
+        return;
+      }
+    }
+    HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = ptr;
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, ptr ? bytes.byteLength : 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, 0);
+    Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, bytes.byteLength);
+    // The file is complete even if it could not be stored.
+    var reportSuccess = function() { onsuccess(fetch, xhr, e); };
+    __emscripten_fetch_cache_data(db, fetch, data, reportSuccess, reportSuccess);
+  };
+
+  // Reads the parts that were stored by earlier downloads back, and puts the file together.
+  var assemble = function(xhr, e) {
+    var remaining = resumedChunks;
+    var missing = false;
+    var finish = function() {
+      if (missing) {
+        // Start over the next time.
+        discardParts();
+        fail(xhr, 'missing part', 404, 'Not Found');
+        return;
+      }
+      var size = 0;
+      for(var i = 0; i < chunks.length; ++i) size += chunks[i].byteLength;
+      var data = new Uint8Array(size);
+      size = 0;
+      for(var i = 0; i < chunks.length; ++i) {
+        data.set(new Uint8Array(chunks[i]), size);
+        size += chunks[i].byteLength;
+      }
+      complete(data, xhr, e);
+    };
+    if (!remaining) {
+      finish();
+      return;
+    }
+    var gotChunk = function(i, chunk) {
+      if (chunk) chunks[i] = chunk;
+      else missing = true;
+      if (--remaining == 0) finish();
+    };
+    Fetch.batchBegin();
+    for(var i = 0; i < resumedChunks; ++i) {
+      (function(i) {
+        Fetch.idbRequest(db, 'readonly', function(packages) {
+          var getRequest = packages.get(partialKey + i);
+          getRequest.onsuccess = function(event) {
+            gotChunk(i, event.target.result);
+          };
+          getRequest.onerror = function(error) {
+            error.preventDefault(); // Do not abort the other requests that share the transaction.
+            gotChunk(i, null);
+          };
+        }, function(e) {
+          gotChunk(i, null);
+        });
+      })(i);
+    }
+    Fetch.batchEnd();
+  };
+
+  var downloadChunk = function() {
+    var offset = partial.numChunks * chunkSize;
+    var xhr = new XMLHttpRequest();
+    xhr.withCredentials = withCredentials;
+    xhr.open('GET', url_, true, userNameStr, passwordStr);
+    xhr.timeout = timeoutMsecs;
+    xhr.url_ = url_;
+    xhr.responseType = 'arraybuffer';
+    for(var h = requestHeaders; h && HEAPU32[h >> 2] && HEAPU32[h + 4 >> 2]; h += 8) {
+      xhr.setRequestHeader(Pointer_stringify(HEAPU32[h >> 2]), Pointer_stringify(HEAPU32[h + 4 >> 2]));
+    }
+    xhr.setRequestHeader('Range', 'bytes=' + offset + '-' + (offset + chunkSize - 1));
+    // If the file has changed since the stored parts were downloaded, the server sends the whole new file instead.
+    if (partial.validator) xhr.setRequestHeader('If-Range', partial.validator);
 #if FETCH_DEBUG
-  console.log('fetch: xhr.send(data=' + data + ')');
+    console.log('fetch: downloading part ' + partial.numChunks + ' of URL "' + url_ + '" from offset ' + offset);
 #endif
-  try {
-    xhr.send(data);
-  } catch(e) {
+
+    var request = {
+      xhr: xhr,
+      priority: priority,
+      maxConcurrentRequests: maxConcurrentRequests,
+      send: function() {
+        Fetch.timingSent(fetch);
+        try {
+          xhr.send(null);
+        } catch(e) {
+          Fetch.finishRequest(request);
+          fail(xhr, e, 404, 'Not Found');
+        }
+      }
+    };
+    xhr.onreadystatechange = function() {
+      if (xhr.readyState >= 2/*HEADERS_RECEIVED*/) Fetch.timingFirstByte(fetch);
+    };
+    xhr.onload = function(e) {
+      Fetch.timingFirstByte(fetch);
+      Fetch.finishRequest(request);
+      var response = xhr.response || new ArrayBuffer(0);
+      if (xhr.status == 206) {
+        var contentRange = /\/(\d+)$/.exec(xhr.getResponseHeader('Content-Range') || '');
+        partial.totalBytes = contentRange ? parseInt(contentRange[1]) : 0;
+        if (!partial.validator) partial.validator = xhr.getResponseHeader('ETag') || xhr.getResponseHeader('Last-Modified');
+        var done = partial.totalBytes ? offset + response.byteLength >= partial.totalBytes : response.byteLength < chunkSize;
+        var index = partial.numChunks++;
+        chunks[index] = response;
+        // Without a validator there is no telling whether the parts of an interrupted download still belong to the same
+        // version of the file, so they are only kept in memory.
+        if (partial.validator && !done) {
+          var record = { numChunks: partial.numChunks, chunkSize: chunkSize, totalBytes: partial.totalBytes, validator: partial.validator };
+          Fetch.idbRequest(db, 'readwrite', function(packages) {
+            packages.put(response, partialKey + index).onerror = function(error) { error.preventDefault(); };
+            packages.put(record, partialKey).onerror = function(error) { error.preventDefault(); };
+          }, function(e) {});
+        }
+        HEAPU32[fetch + Fetch.fetch_t_offset_data >> 2] = 0;
+        Fetch.setu64(fetch + Fetch.fetch_t_offset_numBytes, 0);
+        Fetch.setu64(fetch + Fetch.fetch_t_offset_dataOffset, offset + response.byteLength);
+        Fetch.setu64(fetch + Fetch.fetch_t_offset_totalBytes, partial.totalBytes);
+        HEAPU16[fetch + Fetch.fetch_t_offset_readyState >> 1] = 3; // Mimic XHR readyState 3 === 'LOADING: Downloading; responseText holds partial data'
+        HEAPU16[fetch + Fetch.fetch_t_offset_status >> 1] = 206;
+        onprogress(fetch, xhr, e);
+        if (done) assemble(xhr, e);
+        else downloadChunk();
+      } else if (xhr.status == 200) {
+        // The server does not support Range requests, or the file has changed since the stored parts were downloaded.
+        complete(new Uint8Array(response), xhr, e);
+      } else {
+        fail(xhr, e, xhr.status, xhr.statusText);
+      }
+    };
+    xhr.onerror = function(e) {
+      Fetch.finishRequest(request);
+      fail(xhr, e, (xhr.readyState == 4 && xhr.status == 0) ? 404 : xhr.status, xhr.statusText);
+    };
+    xhr.ontimeout = function(e) {
+      Fetch.finishRequest(request);
+      fail(xhr, e, xhr.status, 'Timed out');
+    };
+    Fetch.scheduleRequest(request);
+  };
+
+  // Continue from the parts that have been stored earlier.
+  Fetch.idbRequest(db, 'readonly', function(packages) {
+    var getRequest = packages.get(partialKey);
+    getRequest.onsuccess = function(event) {
+      var record = event.target.result;
+      if (record) {
 #if FETCH_DEBUG
-    console.error('fetch: xhr failed with exception: ' + e);
+        console.log('fetch: resuming download of URL "' + url_ + '" from part ' + record.numChunks);
 #endif
-    if (onerror) onerror(fetch, xhr, e);
-  }
+        partial = record;
+        resumedChunks = record.numChunks;
+        chunkSize = record.chunkSize;
+      }
+      downloadChunk();
+    };
+    getRequest.onerror = function(error) {
+      error.preventDefault(); // Do not abort the other requests that share the transaction.
+      downloadChunk();
+    };
+  }, function(e) {
+    downloadChunk();
+  });
 }
 
 function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
   if (typeof Module !== 'undefined') Module['noExitRuntime'] = true; // If we are the main Emscripten runtime, we should not be closing down.
+  Fetch.timingStart(fetch);
+
+#if USE_PTHREADS
+  if (ENVIRONMENT_IS_PTHREAD && Fetch.dbInstance === undefined) {
+    Fetch.openThreadDatabase(function() { emscripten_start_fetch(fetch, successcb, errorcb, progresscb); });
+    return fetch;
+  }
+#endif
 
   var fetch_attr = fetch + Fetch.fetch_t_offset___attributes;
   var requestMethod = Pointer_stringify(fetch_attr);
@@ -480,11 +1623,13 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
   var fetchAttrAppend = !!(fetchAttributes & 8/*EMSCRIPTEN_FETCH_APPEND*/);
   var fetchAttrReplace = !!(fetchAttributes & 16/*EMSCRIPTEN_FETCH_REPLACE*/);
   var fetchAttrNoDownload = !!(fetchAttributes & 32/*EMSCRIPTEN_FETCH_NO_DOWNLOAD*/);
+  var ranged = Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeStart) || Fetch.getu64(fetch_attr + Fetch.attr_t_offset_rangeEnd);
 
   var reportSuccess = function(fetch, xhr, e) {
 #if FETCH_DEBUG
     console.log('fetch: operation success. e: ' + e);
 #endif
+    Fetch.timingEnd(fetch);
     if (onsuccess && typeof dynCall === 'function') Module['dynCall_vi'](onsuccess, fetch);
     else if (successcb) successcb(fetch);
   };
@@ -497,6 +1642,7 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
 #if FETCH_DEBUG
       console.log('fetch: IndexedDB store succeeded.');
 #endif
+      Fetch.timingEnd(fetch);
       if (onsuccess && typeof dynCall === 'function') Module['dynCall_vi'](onsuccess, fetch);
       else if (successcb) successcb(fetch);
     };
@@ -504,6 +1650,7 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
 #if FETCH_DEBUG
       console.error('fetch: IndexedDB store failed.');
 #endif
+      Fetch.timingEnd(fetch);
       if (onsuccess && typeof dynCall === 'function') Module['dynCall_vi'](onsuccess, fetch);
       else if (successcb) successcb(fetch);
     };
@@ -519,6 +1666,7 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
 #if FETCH_DEBUG
     console.error('fetch: operation failed: ' + e);
 #endif
+    Fetch.timingEnd(fetch);
     if (onerror && typeof dynCall === 'function') Module['dynCall_vi'](onerror, fetch);
     else if (errorcb) errorcb(fetch);
   };
@@ -534,7 +1682,15 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
 #if FETCH_DEBUG
     console.error('fetch: starting (cached) XHR: ' + e);
 #endif
-    __emscripten_fetch_xhr(fetch, cacheResultAndReportSuccess, reportError, reportProgress);
+    // Parts of files are not stored, since they would be taken for the whole file.
+    __emscripten_fetch_xhr(fetch, ranged ? reportSuccess : cacheResultAndReportSuccess, reportError, reportProgress);
+  };
+
+  var performResumableXhr = function(fetch, xhr, e) {
+#if FETCH_DEBUG
+    console.error('fetch: starting resumable XHR: ' + e);
+#endif
+    __emscripten_fetch_resumable_xhr(fetch, reportSuccess, reportError, reportProgress);
   };
 
   // Should we try IndexedDB first?
@@ -556,13 +1712,15 @@ function emscripten_start_fetch(fetch, successcb, errorcb, progresscb) {
       __emscripten_fetch_delete_cached_data(Fetch.dbInstance, fetch, reportSuccess, reportError);
     } else if (fetchAttrNoDownload) {
       __emscripten_fetch_load_cached_data(Fetch.dbInstance, fetch, reportSuccess, reportError);
+    } else if (fetchAttrAppend && !ranged && (!requestMethod || requestMethod == 'GET')) {
+      __emscripten_fetch_load_cached_data(Fetch.dbInstance, fetch, reportSuccess, performResumableXhr);
     } else if (fetchAttrPersistFile) {
       __emscripten_fetch_load_cached_data(Fetch.dbInstance, fetch, reportSuccess, performCachedXhr);        
     } else {
       __emscripten_fetch_load_cached_data(Fetch.dbInstance, fetch, reportSuccess, performUncachedXhr);        
     }
   } else if (!fetchAttrNoDownload) {
-    if (fetchAttrPersistFile) {
+    if (fetchAttrPersistFile && !ranged) {
       __emscripten_fetch_xhr(fetch, cacheResultAndReportSuccess, reportError, reportProgress);
     } else {
       __emscripten_fetch_xhr(fetch, reportSuccess, reportError, reportProgress);        
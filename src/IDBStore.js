@@ -85,6 +85,46 @@
       };
     });
   },
+  // Gets several files in one transaction. The callback receives an array with
+  // the data of each, or null for those that do not exist. A failed request
+  // reaches us through the transaction's onerror, once per request, and we
+  // report only the first.
+  getFiles: function(dbName, ids, callback) {
+    var failed = false;
+    IDBStore.getStore(dbName, 'readonly', function(err, store) {
+      if (err) {
+        if (!failed) callback(err);
+        failed = true;
+        return;
+      }
+      var results = new Array(ids.length);
+      var pending = ids.length;
+      if (!pending) return callback(null, results);
+      ids.forEach(function(id, i) {
+        store.get(id).onsuccess = function(event) {
+          results[i] = event.target.result || null;
+          if (--pending === 0 && !failed) callback(null, results);
+        };
+      });
+    });
+  },
+  // Sets several files in one transaction, calling back once all are written.
+  setFiles: function(dbName, ids, datas, callback) {
+    var failed = false;
+    IDBStore.getStore(dbName, 'readwrite', function(err, store) {
+      if (err) {
+        if (!failed) callback(err);
+        failed = true;
+        return;
+      }
+      for (var i = 0; i < ids.length; i++) {
+        store.put(datas[i], ids[i]);
+      }
+      store.transaction.oncomplete = function() {
+        if (!failed) callback();
+      };
+    });
+  },
   deleteFile: function(dbName, id, callback) {
     IDBStore.getStore(dbName, 'readwrite', function(err, store) {
       if (err) return callback(err);
@@ -4,7 +4,7 @@
 /*global _malloc, _free, _memcpy*/
 /*global FUNCTION_TABLE, HEAP8, HEAPU8, HEAP16, HEAPU16, HEAP32, HEAPU32, HEAPF32, HEAPF64*/
 /*global readLatin1String*/
-/*global __emval_register, emval_handle_array, __emval_decref*/
+/*global __emval_register, emval_values, __emval_decref*/
 /*global ___getTypeName*/
 /*global requireHandle*/
 /*jslint sub:true*/ /* The symbols 'fromWireType' and 'toWireType' must be accessed via array notation to be closure-safe since craftInvokerFunction crafts functions as strings that can't be closured. */
@@ -12,7 +12,7 @@
 // -- jshint doesn't understand library syntax, so we need to specifically tell it about the symbols we define
 /*global typeDependencies, flushPendingDeletes, getTypeName, getBasestPointer, throwBindingError, UnboundTypeError, _embind_repr, registeredInstances, registeredTypes, getShiftFromSize*/
 /*global ensureOverloadTable, embind__requireFunction, awaitingDependencies, makeLegalFunctionName, embind_charCodes:true, registerType, createNamedFunction, RegisteredPointer, throwInternalError*/
-/*global simpleReadValueFromPointer, floatReadValueFromPointer, integerReadValueFromPointer, enumReadValueFromPointer, replacePublicSymbol, craftInvokerFunction, tupleRegistrations*/
+/*global simpleReadValueFromPointer, floatReadValueFromPointer, integerReadValueFromPointer, enumReadValueFromPointer, replacePublicSymbol, craftInvokerFunction, createLazyInvoker, tupleRegistrations, makeValueFieldAccessors, integerWriteValueToPointer, floatWriteValueToPointer*/
 /*global ClassHandle, makeClassHandle, structRegistrations, whenDependentTypesAreResolved, BindingError, deletionQueue, delayFunction:true, upcastPointer*/
 /*global exposePublicSymbol, heap32VectorToArray, new_, RegisteredPointer_getPointee, RegisteredPointer_destructor, RegisteredPointer_deleteObject, char_0, char_9*/
 /*global getInheritedInstanceCount, getLiveInheritedInstances, setDelayFunction, InternalError, runDestructors*/
@@ -374,16 +374,90 @@ var LibraryEmbind = {
     embind_charCodes = codes;
   },
 
-  $readLatin1String__deps: ['$embind_charCodes'],
+  $readLatin1String__deps: ['$embind_latin1ToString'],
   $readLatin1String: function(ptr) {
+    var end = ptr;
+    while (HEAPU8[end]) {
+        ++end;
+    }
+    return embind_latin1ToString(ptr, end - ptr);
+  },
+
+  $embind_latin1ToString__deps: ['$embind_charCodes'],
+  $embind_latin1ToString: function(ptr, length) {
     var ret = "";
-    var c = ptr;
-    while (HEAPU8[c]) {
-        ret += embind_charCodes[HEAPU8[c++]];
+    if (length <= 16) {
+        // Not worth the garbage of a subarray.
+        for (var i = 0; i < length; ++i) {
+            ret += embind_charCodes[HEAPU8[ptr + i]];
+        }
+        return ret;
+    }
+    // A chunk of bytes at a time as the arguments to fromCharCode, few enough to stay within the limits that engines
+    // put on the number of arguments.
+    for (var i = 0; i < length; i += 1024) {
+        ret += String.fromCharCode.apply(null, HEAPU8.subarray(ptr + i, ptr + Math.min(i + 1024, length)));
     }
     return ret;
   },
 
+  // Returns the string in the length bytes at ptr of a std::string or std::string_view: Latin-1, or UTF-8 with
+  // EMBIND_STD_STRING_IS_UTF8.
+  $embind_readString__deps: ['$embind_latin1ToString'],
+  $embind_readString: function(ptr, length) {
+#if EMBIND_STD_STRING_IS_UTF8
+#if TEXTDECODER
+    if (UTF8Decoder) {
+        return UTF8Decoder.decode(HEAPU8.subarray(ptr, ptr + length));
+    }
+#endif
+    // Without TextDecoder, escape turns the bytes that are not ASCII into %XX, which decodeURIComponent decodes as
+    // UTF-8. Unlike UTF8ToString, this works for strings that have NULs in them.
+    return decodeURIComponent(escape(embind_latin1ToString(ptr, length)));
+#else
+    return embind_latin1ToString(ptr, length);
+#endif
+  },
+
+  // Allocates the memory of a std::string or std::string_view that is passed from JavaScript: headerSize bytes, of
+  // which the first 4 are the length, followed by the string, which is a string or an array of bytes. Throws a
+  // BindingError if it is something else, or if a character does not fit in a byte without EMBIND_STD_STRING_IS_UTF8.
+  $embind_allocString__deps: ['free', 'malloc', '$throwBindingError'],
+  $embind_allocString: function(value, headerSize, typeName) {
+    if (value instanceof ArrayBuffer) {
+        value = new Uint8Array(value);
+    }
+
+    var length, ptr;
+    if (value instanceof Uint8Array || value instanceof Uint8ClampedArray || value instanceof Int8Array) {
+        length = value.length;
+        ptr = _malloc(headerSize + length);
+        HEAPU8.set(value, ptr + headerSize);
+    } else if (typeof value === 'string') {
+#if EMBIND_STD_STRING_IS_UTF8
+        length = lengthBytesUTF8(value);
+        ptr = _malloc(headerSize + length + 1);
+        stringToUTF8(value, ptr + headerSize, length + 1);
+#else
+        length = value.length;
+        ptr = _malloc(headerSize + length);
+        for (var i = 0; i < length; ++i) {
+            var charCode = value.charCodeAt(i);
+            if (charCode > 255) {
+                _free(ptr);
+                throwBindingError('String has UTF-16 code units that do not fit in 8 bits');
+            }
+            HEAPU8[ptr + headerSize + i] = charCode;
+        }
+#endif
+    } else {
+        throwBindingError('Cannot pass non-string to ' + typeName);
+    }
+    // assumes 4-byte alignment
+    HEAPU32[ptr >> 2] = length;
+    return ptr;
+  },
+
   $getTypeName__deps: ['free', '$readLatin1String'],
   $getTypeName: function(type) {
     var ptr = ___getTypeName(type);
@@ -428,7 +502,7 @@ var LibraryEmbind = {
   },
 
   _embind_register_bool__deps: [
-    '$getShiftFromSize', '$readLatin1String', '$registerType'],
+    '$getShiftFromSize', '$integerWriteValueToPointer', '$readLatin1String', '$registerType'],
   _embind_register_bool: function(rawType, name, size, trueValue, falseValue) {
     var shift = getShiftFromSize(size);
 
@@ -458,6 +532,7 @@ var LibraryEmbind = {
             }
             return this['fromWireType'](heap[pointer >> shift]);
         },
+        'writeValueToPointer': integerWriteValueToPointer(name, shift),
         destructorFunction: null, // This type does not need a destructor
     });
   },
@@ -492,6 +567,19 @@ var LibraryEmbind = {
     }
   },
 
+  // Stores a wire value, as returned by toWireType, in a field of a value
+  // type. Signedness does not matter for the stores.
+  $integerWriteValueToPointer__deps: [],
+  $integerWriteValueToPointer: function(name, shift) {
+    switch (shift) {
+        case 0: return function writeI8ToPointer(pointer, value) { HEAP8[pointer] = value; };
+        case 1: return function writeI16ToPointer(pointer, value) { HEAP16[pointer >> 1] = value; };
+        case 2: return function writeI32ToPointer(pointer, value) { HEAP32[pointer >> 2] = value; };
+        default:
+            throw new TypeError("Unknown integer type: " + name);
+    }
+  },
+
   $enumReadValueFromPointer__deps: [],
   $enumReadValueFromPointer: function(name, shift, signed) {
     switch (shift) {
@@ -526,11 +614,21 @@ var LibraryEmbind = {
     }
   },
 
+  $floatWriteValueToPointer__deps: [],
+  $floatWriteValueToPointer: function(name, shift) {
+    switch (shift) {
+        case 2: return function writeF32ToPointer(pointer, value) { HEAPF32[pointer >> 2] = value; };
+        case 3: return function writeF64ToPointer(pointer, value) { HEAPF64[pointer >> 3] = value; };
+        default:
+            throw new TypeError("Unknown float type: " + name);
+    }
+  },
+
   // When converting a number from JS to C++ side, the valid range of the number is
   // [minRange, maxRange], inclusive.
   _embind_register_integer__deps: [
     'embind_repr', '$getShiftFromSize', '$integerReadValueFromPointer',
-    '$readLatin1String', '$registerType'],
+    '$integerWriteValueToPointer', '$readLatin1String', '$registerType'],
   _embind_register_integer: function(primitiveType, name, size, minRange, maxRange) {
     name = readLatin1String(name);
     if (maxRange === -1) { // LLVM doesn't have signed and unsigned 32-bit types, so u32 literals come out as 'i32 -1'. Always treat those as max u32.
@@ -568,14 +666,15 @@ var LibraryEmbind = {
         },
         'argPackAdvance': 8,
         'readValueFromPointer': integerReadValueFromPointer(name, shift, minRange !== 0),
+        'writeValueToPointer': integerWriteValueToPointer(name, shift),
         destructorFunction: null, // This type does not need a destructor
     });
   },
 
 
   _embind_register_float__deps: [
-    'embind_repr', '$floatReadValueFromPointer', '$getShiftFromSize',
-    '$readLatin1String', '$registerType'],
+    'embind_repr', '$floatReadValueFromPointer', '$floatWriteValueToPointer',
+    '$getShiftFromSize', '$readLatin1String', '$registerType'],
   _embind_register_float: function(rawType, name, size) {
     var shift = getShiftFromSize(size);
     name = readLatin1String(name);
@@ -594,6 +693,7 @@ var LibraryEmbind = {
         },
         'argPackAdvance': 8,
         'readValueFromPointer': floatReadValueFromPointer(name, shift),
+        'writeValueToPointer': floatWriteValueToPointer(name, shift),
         destructorFunction: null, // This type does not need a destructor
     });
   },
@@ -604,57 +704,47 @@ var LibraryEmbind = {
   },
 
   _embind_register_std_string__deps: [
-    'free', 'malloc', '$readLatin1String', '$registerType',
-    '$simpleReadValueFromPointer', '$throwBindingError'],
+    'free', '$embind_allocString', '$embind_readString', '$readLatin1String', '$registerType',
+    '$simpleReadValueFromPointer'],
   _embind_register_std_string: function(rawType, name) {
     name = readLatin1String(name);
     registerType(rawType, {
         name: name,
         'fromWireType': function(value) {
-            var length = HEAPU32[value >> 2];
-            var a = new Array(length);
-            for (var i = 0; i < length; ++i) {
-                a[i] = String.fromCharCode(HEAPU8[value + 4 + i]);
-            }
+            var str = embind_readString(value + 4, HEAPU32[value >> 2]);
             _free(value);
-            return a.join('');
+            return str;
         },
         'toWireType': function(destructors, value) {
-            if (value instanceof ArrayBuffer) {
-                value = new Uint8Array(value);
-            }
-
-            function getTAElement(ta, index) {
-                return ta[index];
-            }
-            function getStringElement(string, index) {
-                return string.charCodeAt(index);
-            }
-            var getElement;
-            if (value instanceof Uint8Array) {
-                getElement = getTAElement;
-            } else if (value instanceof Uint8ClampedArray) {
-                getElement = getTAElement;
-            } else if (value instanceof Int8Array) {
-                getElement = getTAElement;
-            } else if (typeof value === 'string') {
-                getElement = getStringElement;
-            } else {
-                throwBindingError('Cannot pass non-string to std::string');
+            var ptr = embind_allocString(value, 4, 'std::string');
+            if (destructors !== null) {
+                destructors.push(_free, ptr);
             }
+            return ptr;
+        },
+        'argPackAdvance': 8,
+        'readValueFromPointer': simpleReadValueFromPointer,
+        destructorFunction: function(ptr) { _free(ptr); },
+    });
+  },
 
-            // assumes 4-byte alignment
-            var length = value.length;
-            var ptr = _malloc(4 + length);
-            HEAPU32[ptr >> 2] = length;
-            for (var i = 0; i < length; ++i) {
-                var charCode = getElement(value, i);
-                if (charCode > 255) {
-                    _free(ptr);
-                    throwBindingError('String has UTF-16 code units that do not fit in 8 bits');
-                }
-                HEAPU8[ptr + 4 + i] = charCode;
-            }
+  _embind_register_std_string_view__deps: [
+    'free', '$embind_allocString', '$embind_readString', '$readLatin1String', '$registerType',
+    '$simpleReadValueFromPointer'],
+  _embind_register_std_string_view: function(rawType, name) {
+    name = readLatin1String(name);
+    registerType(rawType, {
+        name: name,
+        'fromWireType': function(value) {
+            // Only the {length, data} of the view was allocated, the string is read where it is.
+            var str = embind_readString(HEAPU32[(value >> 2) + 1], HEAPU32[value >> 2]);
+            _free(value);
+            return str;
+        },
+        'toWireType': function(destructors, value) {
+            // The string goes right after the view, and both are freed with it.
+            var ptr = embind_allocString(value, 8, 'std::string_view');
+            HEAPU32[(ptr >> 2) + 1] = ptr + 8;
             if (destructors !== null) {
                 destructors.push(_free, ptr);
             }
@@ -715,14 +805,14 @@ var LibraryEmbind = {
   },
 
   _embind_register_emval__deps: [
-    '_emval_decref', '$emval_handle_array', '_emval_register',
+    '_emval_decref', '$emval_values', '_emval_register',
     '$readLatin1String', '$registerType', '$simpleReadValueFromPointer'],
   _embind_register_emval: function(rawType, name) {
     name = readLatin1String(name);
     registerType(rawType, {
         name: name,
         'fromWireType': function(handle) {
-            var rv = emval_handle_array[handle].value;
+            var rv = emval_values[handle];
             __emval_decref(handle);
             return rv;
         },
@@ -813,10 +903,45 @@ var LibraryEmbind = {
     return (r instanceof Object) ? r : obj;
   },
 
+  // Crafting an invoker costs much more than registering the function, and most bound functions are not called early
+  // on, if at all, so invokers are only crafted when they are first called. install(invoker) puts the crafted invoker
+  // where the returned stub was, so that later calls go straight to it.
+  $createLazyInvoker__deps: ['$makeLegalFunctionName'],
+  $createLazyInvoker: function(humanName, makeInvoker, install) {
+    var invoker;
+    var stub = function() {
+        if (!invoker) {
+            invoker = makeInvoker();
+            install(invoker);
+        }
+        return invoker.apply(this, arguments);
+    };
+#if NO_DYNAMIC_EXECUTION == 0
+    // Give the stub the name that the invoker will have, where the engine allows it.
+    var nameDescriptor = Object.getOwnPropertyDescriptor(stub, 'name');
+    if (nameDescriptor && nameDescriptor.configurable) {
+        Object.defineProperty(stub, 'name', { value: makeLegalFunctionName(humanName) });
+    }
+#endif
+    return stub;
+  },
+
+#if NO_DYNAMIC_EXECUTION
+  // The invokers that craftInvokerFunction uses when it cannot generate them at runtime, by number of arguments. They
+  // are generated at compile time by makeEmbindStaticInvokers in parseTools.js.
+  $embindStaticInvokers__deps: ['$runDestructors', '$throwBindingError'],
+  $embindStaticInvokers: [
+{{{ makeEmbindStaticInvokers(8) }}}
+  ],
+
+#endif
   // The path to interop from JS code to C++ code:
   // (hand-written JS code) -> (autogenerated JS invoker) -> (template-generated C++ invoker) -> (target C++ function)
   // craftInvokerFunction generates the JS invoker function for each function exposed to JS through embind.
   $craftInvokerFunction__deps: [
+#if NO_DYNAMIC_EXECUTION
+    '$embindStaticInvokers',
+#endif
     '$makeLegalFunctionName', '$new_', '$runDestructors', '$throwBindingError'],
   $craftInvokerFunction: function(humanName, argTypes, classType, cppInvokerFunc, cppTargetFunc) {
     // humanName: a human-readable string name for the function to be generated.
@@ -856,6 +981,12 @@ var LibraryEmbind = {
     var returns = (argTypes[0].name !== "void");
 
 #if NO_DYNAMIC_EXECUTION
+    var staticInvoker = embindStaticInvokers[argCount - 2];
+    if (staticInvoker) {
+      return staticInvoker(humanName, argTypes, isClassMethodFunc, needsDestructorStack, returns, cppInvokerFunc, cppTargetFunc);
+    }
+
+    // Functions with more arguments than there are static invokers for use a generic one.
     var argsWired = new Array(argCount - 2);
     return function() {
       if (arguments.length !== argCount - 2) {
@@ -985,6 +1116,13 @@ var LibraryEmbind = {
 
     function makeDynCaller(dynCall) {
 #if NO_DYNAMIC_EXECUTION
+      // without new Function, avoid building an array of arguments on each call at least for the common arities
+      switch (signature.length) {
+        case 1: return function() { return dynCall(rawFunction); };
+        case 2: return function(a1) { return dynCall(rawFunction, a1); };
+        case 3: return function(a1, a2) { return dynCall(rawFunction, a1, a2); };
+        case 4: return function(a1, a2, a3) { return dynCall(rawFunction, a1, a2, a3); };
+      }
       return function() {
           var args = new Array(arguments.length + 1);
           args[0] = rawFunction;
@@ -1044,7 +1182,7 @@ var LibraryEmbind = {
   },
 
   _embind_register_function__deps: [
-    '$craftInvokerFunction', '$exposePublicSymbol', '$heap32VectorToArray',
+    '$craftInvokerFunction', '$createLazyInvoker', '$exposePublicSymbol', '$heap32VectorToArray',
     '$readLatin1String', '$replacePublicSymbol', '$embind__requireFunction',
     '$throwUnboundTypeError', '$whenDependentTypesAreResolved'],
   _embind_register_function: function(name, argCount, rawArgTypesAddr, signature, rawInvoker, fn) {
@@ -1059,7 +1197,12 @@ var LibraryEmbind = {
 
     whenDependentTypesAreResolved([], argTypes, function(argTypes) {
         var invokerArgsArray = [argTypes[0] /* return value */, null /* no class 'this'*/].concat(argTypes.slice(1) /* actual params */);
-        replacePublicSymbol(name, craftInvokerFunction(name, invokerArgsArray, null /* no class 'this'*/, rawInvoker, fn), argCount - 1);
+        function install(func) {
+            replacePublicSymbol(name, func, argCount - 1);
+        }
+        install(createLazyInvoker(name, function() {
+            return craftInvokerFunction(name, invokerArgsArray, null /* no class 'this'*/, rawInvoker, fn);
+        }, install));
         return [];
     });
   },
@@ -1095,7 +1238,8 @@ var LibraryEmbind = {
     setterArgumentType,
     setterSignature,
     setter,
-    setterContext
+    setterContext,
+    fieldOffset
   ) {
     tupleRegistrations[rawTupleType].elements.push({
         getterReturnType: getterReturnType,
@@ -1104,11 +1248,42 @@ var LibraryEmbind = {
         setterArgumentType: setterArgumentType,
         setter: embind__requireFunction(setterSignature, setter),
         setterContext: setterContext,
+        fieldOffset: fieldOffset,
     });
   },
 
+  // Arithmetic fields of trivially copyable value types are read and written in
+  // place in the heap, without calling into C++ or collecting destructors.
+  $makeValueFieldAccessors__deps: ['$runDestructors'],
+  $makeValueFieldAccessors: function(field, getterReturnType, setterArgumentType) {
+    var fieldOffset = field.fieldOffset;
+    if (fieldOffset >= 0 && getterReturnType === setterArgumentType &&
+        getterReturnType['writeValueToPointer']) {
+        var type = getterReturnType;
+        field.read = function(ptr) {
+            return type['readValueFromPointer'](ptr + fieldOffset);
+        };
+        field.write = function(ptr, o) {
+            type['writeValueToPointer'](ptr + fieldOffset, type['toWireType'](null, o));
+        };
+        return;
+    }
+    var getter = field.getter;
+    var getterContext = field.getterContext;
+    var setter = field.setter;
+    var setterContext = field.setterContext;
+    field.read = function(ptr) {
+        return getterReturnType['fromWireType'](getter(getterContext, ptr));
+    };
+    field.write = function(ptr, o) {
+        var destructors = [];
+        setter(setterContext, ptr, setterArgumentType['toWireType'](destructors, o));
+        runDestructors(destructors);
+    };
+  },
+
   _embind_finalize_value_array__deps: [
-    '$tupleRegistrations', '$runDestructors',
+    '$tupleRegistrations', '$makeValueFieldAccessors',
     '$simpleReadValueFromPointer', '$whenDependentTypesAreResolved'],
   _embind_finalize_value_array: function(rawTupleType) {
     var reg = tupleRegistrations[rawTupleType];
@@ -1123,20 +1298,7 @@ var LibraryEmbind = {
 
     whenDependentTypesAreResolved([rawTupleType], elementTypes, function(elementTypes) {
         elements.forEach(function(elt, i) {
-            var getterReturnType = elementTypes[i];
-            var getter = elt.getter;
-            var getterContext = elt.getterContext;
-            var setterArgumentType = elementTypes[i + elementsLength];
-            var setter = elt.setter;
-            var setterContext = elt.setterContext;
-            elt.read = function(ptr) {
-                return getterReturnType['fromWireType'](getter(getterContext, ptr));
-            };
-            elt.write = function(ptr, o) {
-                var destructors = [];
-                setter(setterContext, ptr, setterArgumentType['toWireType'](destructors, o));
-                runDestructors(destructors);
-            };
+            makeValueFieldAccessors(elt, elementTypes[i], elementTypes[i + elementsLength]);
         });
 
         return [{
@@ -1201,7 +1363,8 @@ var LibraryEmbind = {
     setterArgumentType,
     setterSignature,
     setter,
-    setterContext
+    setterContext,
+    fieldOffset
   ) {
     structRegistrations[structType].fields.push({
         fieldName: readLatin1String(fieldName),
@@ -1211,11 +1374,12 @@ var LibraryEmbind = {
         setterArgumentType: setterArgumentType,
         setter: embind__requireFunction(setterSignature, setter),
         setterContext: setterContext,
+        fieldOffset: fieldOffset,
     });
   },
 
   _embind_finalize_value_object__deps: [
-    '$structRegistrations', '$runDestructors',
+    '$structRegistrations', '$makeValueFieldAccessors',
     '$simpleReadValueFromPointer', '$whenDependentTypesAreResolved'],
   _embind_finalize_value_object: function(structType) {
     var reg = structRegistrations[structType];
@@ -1227,34 +1391,18 @@ var LibraryEmbind = {
     var fieldTypes = fieldRecords.map(function(field) { return field.getterReturnType; }).
               concat(fieldRecords.map(function(field) { return field.setterArgumentType; }));
     whenDependentTypesAreResolved([structType], fieldTypes, function(fieldTypes) {
-        var fields = {};
+        var fieldsLength = fieldRecords.length;
         fieldRecords.forEach(function(field, i) {
-            var fieldName = field.fieldName;
-            var getterReturnType = fieldTypes[i];
-            var getter = field.getter;
-            var getterContext = field.getterContext;
-            var setterArgumentType = fieldTypes[i + fieldRecords.length];
-            var setter = field.setter;
-            var setterContext = field.setterContext;
-            fields[fieldName] = {
-                read: function(ptr) {
-                    return getterReturnType['fromWireType'](
-                        getter(getterContext, ptr));
-                },
-                write: function(ptr, o) {
-                    var destructors = [];
-                    setter(setterContext, ptr, setterArgumentType['toWireType'](destructors, o));
-                    runDestructors(destructors);
-                }
-            };
+            makeValueFieldAccessors(field, fieldTypes[i], fieldTypes[i + fieldsLength]);
         });
 
         return [{
             name: reg.name,
             'fromWireType': function(ptr) {
                 var rv = {};
-                for (var i in fields) {
-                    rv[i] = fields[i].read(ptr);
+                for (var i = 0; i < fieldsLength; ++i) {
+                    var field = fieldRecords[i];
+                    rv[field.fieldName] = field.read(ptr);
                 }
                 rawDestructor(ptr);
                 return rv;
@@ -1262,14 +1410,15 @@ var LibraryEmbind = {
             'toWireType': function(destructors, o) {
                 // todo: Here we have an opportunity for -O3 level "unsafe" optimizations:
                 // assume all fields are present without checking.
-                for (var fieldName in fields) {
-                    if (!(fieldName in o)) {
+                for (var i = 0; i < fieldsLength; ++i) {
+                    if (!(fieldRecords[i].fieldName in o)) {
                         throw new TypeError('Missing field');
                     }
                 }
                 var ptr = rawConstructor();
-                for (fieldName in fields) {
-                    fields[fieldName].write(ptr, o[fieldName]);
+                for (i = 0; i < fieldsLength; ++i) {
+                    var field = fieldRecords[i];
+                    field.write(ptr, o[field.fieldName]);
                 }
                 if (destructors !== null) {
                     destructors.push(rawDestructor, ptr);
@@ -1979,7 +2128,7 @@ var LibraryEmbind = {
   },
 
   _embind_register_class_function__deps: [
-    '$craftInvokerFunction', '$heap32VectorToArray', '$readLatin1String',
+    '$craftInvokerFunction', '$createLazyInvoker', '$heap32VectorToArray', '$readLatin1String',
     '$embind__requireFunction', '$throwUnboundTypeError',
     '$whenDependentTypesAreResolved'],
   _embind_register_class_function: function(
@@ -2022,18 +2171,20 @@ var LibraryEmbind = {
         }
 
         whenDependentTypesAreResolved([], rawArgTypes, function(argTypes) {
-
-            var memberFunction = craftInvokerFunction(humanName, argTypes, classType, rawInvoker, context);
-
             // Replace the initial unbound-handler-stub function with the appropriate member function, now that all types
             // are resolved. If multiple overloads are registered for this function, the function goes into an overload table.
-            if (undefined === proto[methodName].overloadTable) {
-                // Set argCount in case an overload is registered later
-                memberFunction.argCount = argCount - 2;
-                proto[methodName] = memberFunction;
-            } else {
-                proto[methodName].overloadTable[argCount - 2] = memberFunction;
+            function install(memberFunction) {
+                if (undefined === proto[methodName].overloadTable) {
+                    // Set argCount in case an overload is registered later
+                    memberFunction.argCount = argCount - 2;
+                    proto[methodName] = memberFunction;
+                } else {
+                    proto[methodName].overloadTable[argCount - 2] = memberFunction;
+                }
             }
+            install(createLazyInvoker(humanName, function() {
+                return craftInvokerFunction(humanName, argTypes, classType, rawInvoker, context);
+            }, install));
 
             return [];
         });
@@ -2115,7 +2266,7 @@ var LibraryEmbind = {
   },
 
   _embind_register_class_class_function__deps: [
-    '$craftInvokerFunction', '$ensureOverloadTable', '$heap32VectorToArray',
+    '$craftInvokerFunction', '$createLazyInvoker', '$ensureOverloadTable', '$heap32VectorToArray',
     '$readLatin1String', '$embind__requireFunction', '$throwUnboundTypeError',
     '$whenDependentTypesAreResolved'],
   _embind_register_class_class_function: function(
@@ -2153,18 +2304,73 @@ var LibraryEmbind = {
             // Replace the initial unbound-types-handler stub with the proper function. If multiple overloads are registered,
             // the function handlers go into an overload table.
             var invokerArgsArray = [argTypes[0] /* return value */, null /* no class 'this'*/].concat(argTypes.slice(1) /* actual params */);
-            var func = craftInvokerFunction(humanName, invokerArgsArray, null /* no class 'this'*/, rawInvoker, fn);
-            if (undefined === proto[methodName].overloadTable) {
-                proto[methodName] = func;
-            } else {
-                proto[methodName].overloadTable[argCount-1] = func;
+            function install(func) {
+                if (undefined === proto[methodName].overloadTable) {
+                    proto[methodName] = func;
+                } else {
+                    proto[methodName].overloadTable[argCount-1] = func;
+                }
             }
+            install(createLazyInvoker(humanName, function() {
+                return craftInvokerFunction(humanName, invokerArgsArray, null /* no class 'this'*/, rawInvoker, fn);
+            }, install));
             return [];
         });
         return [];
     });
   },
 
+  _embind_register_class_batch_function__deps: [
+    'free', 'malloc', '$readLatin1String', '$embind__requireFunction', '$throwBindingError',
+    '$validateThis', '$whenDependentTypesAreResolved'],
+  _embind_register_class_batch_function: function(
+    rawClassType,
+    methodName,
+    argCount,
+    returnsValue,
+    invokerSignature,
+    rawInvoker,
+    context
+  ) {
+    methodName = readLatin1String(methodName);
+    rawInvoker = embind__requireFunction(invokerSignature, rawInvoker);
+    whenDependentTypesAreResolved([], [rawClassType], function(classType) {
+        classType = classType[0];
+        var humanName = classType.name + '.' + methodName;
+
+        classType.registeredClass.constructor[methodName] = function(objects, args) {
+            var count = objects.length;
+            var argsLength = argCount ? args.length : 0;
+            if (argsLength !== count * argCount) {
+                throwBindingError('function ' + humanName + ' called with ' + argsLength + ' arguments for ' + count + ' objects, expected ' + (count * argCount) + '!');
+            }
+            // The arguments and results as doubles, followed by the object pointers, in one allocation.
+            var argsPtr = _malloc(count * (argCount * 8 + (returnsValue ? 8 : 0) + 4));
+            var resultsPtr = argsPtr + count * argCount * 8;
+            var objectsPtr = resultsPtr + (returnsValue ? count * 8 : 0);
+            try {
+                for (var i = 0; i < count; ++i) {
+                    HEAPU32[(objectsPtr >> 2) + i] = validateThis(objects[i], classType, humanName);
+                }
+            } catch (e) {
+                _free(argsPtr);
+                throw e;
+            }
+            if (argCount) {
+                HEAPF64.set(args, argsPtr >> 3);
+            }
+            rawInvoker(context, count, objectsPtr, argsPtr, resultsPtr);
+            var results;
+            if (returnsValue) {
+                results = new Float64Array(HEAPF64.subarray(resultsPtr >> 3, (resultsPtr >> 3) + count));
+            }
+            _free(argsPtr);
+            return results;
+        };
+        return [];
+    });
+  },
+
   _embind_register_class_class_property__deps: [
     '$readLatin1String', '$embind__requireFunction', '$runDestructors',
     '$throwBindingError', '$throwUnboundTypeError',
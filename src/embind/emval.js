@@ -7,40 +7,44 @@
 /*jslint sub:true*/ /* The symbols 'fromWireType' and 'toWireType' must be accessed via array notation to be closure-safe since craftInvokerFunction crafts functions as strings that can't be closured. */
 
 // -- jshint doesn't understand library syntax, so we need to mark the symbols exposed here
-/*global getStringOrSymbol, emval_handle_array, __emval_register, __emval_unregister, requireHandle, count_emval_handles, emval_symbols, emval_free_list, get_first_emval, __emval_decref, emval_newers*/
+/*global getStringOrSymbol, emval_values, emval_refcounts, emval_first_free, __emval_register, __emval_unregister, requireHandle, count_emval_handles, emval_symbols, get_first_emval, __emval_decref, emval_newers*/
 /*global craftEmvalAllocator, __emval_addMethodCaller, emval_methodCallers, LibraryManager, mergeInto, __emval_allocateDestructors, global, __emval_lookupTypes, makeLegalFunctionName*/
 /*global emval_get_global*/
 
 var LibraryEmVal = {
-  $emval_handle_array: [{},
-    {value: undefined},{value: null},
-    {value: true},{value: false}], // reserve zero and special values
-  $emval_free_list: [],
+  // The values of handles, by handle, with zero and the special values reserved. Freed handles are set to undefined
+  // rather than deleted, so the array stays dense.
+  $emval_values: [undefined, undefined, null, true, false],
+  // The reference counts of handles, in a typed array so that handles need no object each. Freed handles are linked
+  // into a free list through it instead: theirs is minus the next free handle, or 0 at the end of the list.
+  $emval_refcounts: null,
+  $emval_first_free: 0,
   $emval_symbols: {}, // address -> string
 
-  $init_emval__deps: ['$count_emval_handles', '$get_first_emval'],
+  $init_emval__deps: ['$count_emval_handles', '$get_first_emval', '$emval_refcounts'],
   $init_emval__postset: 'init_emval();',
   $init_emval: function() {
+    emval_refcounts = new Int32Array(64);
     Module['count_emval_handles'] = count_emval_handles;
     Module['get_first_emval'] = get_first_emval;
   },
 
-  $count_emval_handles__deps: ['$emval_handle_array'],
+  $count_emval_handles__deps: ['$emval_refcounts', '$emval_values'],
   $count_emval_handles: function() {
     var count = 0;
-    for (var i = 5; i < emval_handle_array.length; ++i) {
-        if (emval_handle_array[i] !== undefined) {
+    for (var i = 5; i < emval_values.length; ++i) {
+        if (emval_refcounts[i] > 0) {
             ++count;
         }
     }
     return count;
   },
 
-  $get_first_emval__deps: ['$emval_handle_array'],
+  $get_first_emval__deps: ['$emval_refcounts', '$emval_values'],
   $get_first_emval: function() {
-    for (var i = 5; i < emval_handle_array.length; ++i) {
-        if (emval_handle_array[i] !== undefined) {
-            return emval_handle_array[i];
+    for (var i = 5; i < emval_values.length; ++i) {
+        if (emval_refcounts[i] > 0) {
+            return {refcount: emval_refcounts[i], value: emval_values[i]};
         }
     }
     return null;
@@ -61,15 +65,15 @@ var LibraryEmVal = {
     }
   },
 
-  $requireHandle__deps: ['$emval_handle_array', '$throwBindingError'],
+  $requireHandle__deps: ['$emval_values', '$throwBindingError'],
   $requireHandle: function(handle) {
     if (!handle) {
         throwBindingError('Cannot use deleted val. handle = ' + handle);
     }
-    return emval_handle_array[handle].value;
+    return emval_values[handle];
   },
 
-  _emval_register__deps: ['$emval_free_list', '$emval_handle_array', '$init_emval'],
+  _emval_register__deps: ['$emval_first_free', '$emval_refcounts', '$emval_values', '$init_emval'],
   _emval_register: function(value) {
 
     switch(value){
@@ -78,34 +82,53 @@ var LibraryEmVal = {
       case true :{ return 3; }
       case false :{ return 4; }
       default:{
-        var handle = emval_free_list.length ?
-            emval_free_list.pop() :
-            emval_handle_array.length;
-
-        emval_handle_array[handle] = {refcount: 1, value: value};
+        var handle = emval_first_free;
+        if (handle) {
+            emval_first_free = -emval_refcounts[handle];
+            emval_values[handle] = value;
+        } else {
+            handle = emval_values.length;
+            if (handle === emval_refcounts.length) {
+                var refcounts = new Int32Array(handle * 2);
+                refcounts.set(emval_refcounts);
+                emval_refcounts = refcounts;
+            }
+            emval_values.push(value);
+        }
+        emval_refcounts[handle] = 1;
         return handle;
         }
       }
   },
 
-  _emval_incref__deps: ['$emval_handle_array'],
+  _emval_incref__deps: ['$emval_refcounts'],
   _emval_incref: function(handle) {
     if (handle > 4) {
-        emval_handle_array[handle].refcount += 1;
+        emval_refcounts[handle] += 1;
     }
   },
 
-  _emval_decref__deps: ['$emval_free_list', '$emval_handle_array'],
+  _emval_decref__deps: ['$emval_first_free', '$emval_refcounts', '$emval_values'],
   _emval_decref: function(handle) {
-    if (handle > 4 && 0 === --emval_handle_array[handle].refcount) {
-        emval_handle_array[handle] = undefined;
-        emval_free_list.push(handle);
+    if (handle > 4 && 0 === --emval_refcounts[handle]) {
+        emval_values[handle] = undefined;
+        emval_refcounts[handle] = -emval_first_free;
+        emval_first_free = handle;
+    }
+  },
+
+  // Releases the handles that were deferred by an emscripten::val_scope, see val.h.
+  _emval_decref_all__deps: ['_emval_decref'],
+  _emval_decref_all: function(handles, count) {
+    handles >>= 2;
+    for (var i = 0; i < count; ++i) {
+        __emval_decref(HEAP32[handles + i]);
     }
   },
 
-  _emval_run_destructors__deps: ['_emval_decref', '$emval_handle_array', '$runDestructors'],
+  _emval_run_destructors__deps: ['_emval_decref', '$emval_values', '$runDestructors'],
   _emval_run_destructors: function(handle) {
-    var destructors = emval_handle_array[handle].value;
+    var destructors = emval_values[handle];
     runDestructors(destructors);
     __emval_decref(handle);
   },
@@ -255,10 +278,30 @@ var LibraryEmVal = {
     handle[key] = value;
   },
 
+  // The same for the names of emscripten::val_keys, which are registered symbols.
+  _emval_get_symbol_property__deps: ['_emval_register', '$getStringOrSymbol', '$requireHandle'],
+  _emval_get_symbol_property: function(handle, key) {
+    handle = requireHandle(handle);
+    key = getStringOrSymbol(key);
+    return __emval_register(handle[key]);
+  },
+
+  _emval_set_symbol_property__deps: ['$getStringOrSymbol', '$requireHandle'],
+  _emval_set_symbol_property: function(handle, key, value) {
+    handle = requireHandle(handle);
+    key = getStringOrSymbol(key);
+    value = requireHandle(value);
+    handle[key] = value;
+  },
+
   _emval_as__deps: ['_emval_register', '$requireHandle', '$requireRegisteredType'],
   _emval_as: function(handle, returnType, destructorsRef) {
     handle = requireHandle(handle);
     returnType = requireRegisteredType(returnType, 'emval::as');
+    // Without destructorsRef, the caller knows that the conversion allocates nothing.
+    if (!destructorsRef) {
+        return returnType['toWireType'](null, handle);
+    }
     var destructors = [];
     var rd = __emval_register(destructors);
     HEAP32[destructorsRef >> 2] = rd;
@@ -396,7 +439,9 @@ var LibraryEmVal = {
     caller = emval_methodCallers[caller];
     handle = requireHandle(handle);
     methodName = getStringOrSymbol(methodName);
-    return caller(handle, methodName, __emval_allocateDestructors(destructorsRef), args);
+    // destructorsRef is null for results that are converted without allocating anything.
+    var destructors = destructorsRef ? __emval_allocateDestructors(destructorsRef) : null;
+    return caller(handle, methodName, destructors, args);
   },
 
   _emval_call_void_method__deps: ['_emval_allocateDestructors', '$getStringOrSymbol', '$emval_methodCallers', '$requireHandle'],
@@ -35,7 +35,14 @@ if (typeof window === "object" && (typeof ENVIRONMENT_IS_PTHREAD === 'undefined'
       var emrun_http_sequence_number = 1;
       var prevPrint = Module['print'];
       var prevErr = Module['printErr'];
-      function emrun_exit() { if (emrun_num_post_messages_in_flight == 0) postExit('^exit^'+EXITSTATUS); else emrun_should_close_itself = true; };
+      // Report when main() started (since the page started loading) and how long it ran until exit, which
+      // emrun --report_timing shows, e.g. for benchmarks.
+      var emrun_main_start = 0;
+      Module['addOnPreMain'](function() { emrun_main_start = performance.now(); });
+      function emrun_exit() {
+        post('^timing^' + emrun_main_start + '^' + (performance.now() - emrun_main_start));
+        if (emrun_num_post_messages_in_flight == 0) postExit('^exit^'+EXITSTATUS); else emrun_should_close_itself = true;
+      };
       Module['addOnExit'](emrun_exit);
       Module['print'] = function emrun_print(text) { post('^out^'+(emrun_http_sequence_number++)+'^'+encodeURIComponent(text)); prevPrint(text); }
       Module['printErr'] = function emrun_printErr(text) { post('^err^'+(emrun_http_sequence_number++)+'^'+encodeURIComponent(text)); prevErr(text); }
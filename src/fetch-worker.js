@@ -96,39 +96,50 @@ var HEAP16 = null;
 var HEAPU16 = null;
 var HEAP32 = null;
 var HEAPU32 = null;
+var HEAPF64 = null;
 
+// Pops fetches from the ring buffer that emscripten_proxy_fetch() in emscripten_fetch.cpp pushes to. The layout is
+// { queuedOperations, head, tail, queueSize, numFinished }, and the slot of a fetch is cleared once it has been taken.
 function processWorkQueue() {
   if (!queuePtr) return;
-  var numQueuedItems = Atomics_load(HEAPU32, queuePtr + 4 >> 2);
-  if (numQueuedItems == 0) return;
-
   var queuedOperations = Atomics_load(HEAPU32, queuePtr >> 2);
-  var queueSize = Atomics_load(HEAPU32, queuePtr + 8 >> 2);
-  for(var i = 0; i < numQueuedItems; ++i) {
-    var fetch = Atomics_load(HEAPU32, (queuedOperations >> 2)+i);
-    function successcb(fetch) {
-      Atomics.compareExchange(HEAPU32, fetch + Fetch.fetch_t_offset___proxyState >> 2, 1, 2);
-      Atomics.wake(HEAP32, fetch + Fetch.fetch_t_offset___proxyState >> 2, 1);
-    }
-    function errorcb(fetch) {
-      Atomics.compareExchange(HEAPU32, fetch + Fetch.fetch_t_offset___proxyState >> 2, 1, 2);
-      Atomics.wake(HEAP32, fetch + Fetch.fetch_t_offset___proxyState >> 2, 1);
-    }
-    function progresscb(fetch) {
-    }
+  if (!queuedOperations) return;
+  var queueSize = Atomics_load(HEAPU32, queuePtr + 12 >> 2);
+  var tail = Atomics_load(HEAPU32, queuePtr + 8 >> 2);
+  var consumed = false;
+
+  // The handlers of the fetch are run by the thread that waits for it, in emscripten_fetch_wait(). The threads that wait
+  // for fetches sleep on numFinished.
+  function finished(fetch, proxyState) {
+    Atomics.compareExchange(HEAPU32, fetch + Fetch.fetch_t_offset___proxyState >> 2, 1, proxyState);
+    Atomics_add(HEAPU32, queuePtr + 16 >> 2, 1);
+    Atomics_wake(HEAP32, queuePtr + 16 >> 2, 0x7FFFFFFF);
+  }
+  function successcb(fetch) {
+    finished(fetch, 2);
+  }
+  function errorcb(fetch) {
+    finished(fetch, 3);
+  }
+  function progresscb(fetch) {
+  }
+
+  while (tail != Atomics_load(HEAPU32, queuePtr + 4 >> 2)) {
+    var slot = (queuedOperations >> 2) + (tail & (queueSize - 1));
+    var fetch = Atomics_load(HEAPU32, slot);
+    if (!fetch) break; // A producer has claimed this slot but not filled it in yet, pick it up on the next round.
+    Atomics_store(HEAPU32, slot, 0);
+    tail = (tail + 1) >>> 0;
+    Atomics_store(HEAPU32, queuePtr + 8 >> 2, tail);
+    consumed = true;
     try {
       emscripten_start_fetch(fetch, successcb, errorcb, progresscb);
     } catch(e) {
       console.error(e);
     }
-    /*
-    if (interval != undefined) {
-      clearInterval(interval);
-      interval = undefined;
-    }
-    */
   }
-  Atomics_store(HEAPU32, queuePtr + 4 >> 2, 0);
+  // Producers that found the queue full wait on tail.
+  if (consumed) Atomics_wake(HEAP32, queuePtr + 8 >> 2, 0x7FFFFFFF);
 }
 
 interval = 0;
@@ -146,6 +157,7 @@ this.onmessage = function(e) {
     HEAPU16 = new Uint16Array(buffer);
     HEAP32 = new Int32Array(buffer);
     HEAPU32 = new Uint32Array(buffer);
+    HEAPF64 = new Float64Array(buffer);
     interval = setInterval(processWorkQueue, 100);
   }
 }
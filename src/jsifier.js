@@ -440,6 +440,8 @@ function JSify(data, functionsOnly) {
           print('var STATIC_BUMP = {{{ STATIC_BUMP }}};');
           print('Module["STATIC_BASE"] = STATIC_BASE;');
           print('Module["STATIC_BUMP"] = STATIC_BUMP;');
+        } else if (POINTER_STRINGIFY_CACHE) {
+          print('var STATIC_BUMP = {{{ STATIC_BUMP }}};'); // the static data whose strings Pointer_stringify can cache
         }
       }
       var generated = itemsDict.function.concat(itemsDict.type).concat(itemsDict.GlobalVariableStub).concat(itemsDict.GlobalVariable);
@@ -485,6 +487,7 @@ function JSify(data, functionsOnly) {
           print('var tempDoublePtr = ' + makeStaticAlloc(8) + '\n');
         }
         if (ASSERTIONS) print('assert(tempDoublePtr % 8 == 0);\n');
+        if (SAMPLING_PROFILER) print('var shadowStack = 0; // the shadow stack of this thread, see library_sampling_profiler.js\n');
         print('function copyTempFloat(ptr) { // functions, because inlining this code increases code size too much\n');
         print('  HEAP8[tempDoublePtr] = HEAP8[ptr];\n');
         print('  HEAP8[tempDoublePtr+1] = HEAP8[ptr+1];\n');
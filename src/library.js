@@ -457,8 +457,14 @@ LibraryManager.library = {
     do {
       oldDynamicTop = Atomics_load(HEAP32, DYNAMICTOP_PTR>>2)|0;
       newDynamicTop = oldDynamicTop + increment | 0;
-      // Asking to increase dynamic top to a too high value? In pthreads builds we cannot
-      // enlarge memory, so this needs to fail.
+#if ALLOW_MEMORY_GROWTH
+      // Asking to increase dynamic top past the end of memory? Grow the shared memory first.
+      if ((increment|0) > 0 & (newDynamicTop|0) > (oldDynamicTop|0) & (newDynamicTop|0) > (totalMemory|0)) {
+        if (enlargeMemory(newDynamicTop|0)|0) totalMemory = getTotalMemory()|0;
+      }
+#endif
+      // Asking to increase dynamic top to a too high value? Without memory growth, in pthreads builds we
+      // cannot enlarge memory, so this needs to fail.
       if (((increment|0) > 0 & (newDynamicTop|0) < (oldDynamicTop|0)) // Detect and fail if we would wrap around signed 32-bit int.
         | (newDynamicTop|0) < 0 // Also underflow, sbrk() should be able to be used to subtract.
         | (newDynamicTop|0) > (totalMemory|0)) {
@@ -507,8 +513,13 @@ LibraryManager.library = {
     var totalMemory = 0;
 #if USE_PTHREADS
     totalMemory = getTotalMemory()|0;
-    // Asking to increase dynamic top to a too high value? In pthreads builds we cannot
-    // enlarge memory, so this needs to fail.
+#if ALLOW_MEMORY_GROWTH
+    if ((newDynamicTop|0) > (totalMemory|0)) {
+      if (enlargeMemory(newDynamicTop|0)|0) totalMemory = getTotalMemory()|0;
+    }
+#endif
+    // Asking to increase dynamic top to a too high value? Without memory growth, in pthreads builds we
+    // cannot enlarge memory, so this needs to fail.
     if ((newDynamicTop|0) < 0 | (newDynamicTop|0) > (totalMemory|0)) {
 #if ABORTING_MALLOC
       abortOnCannotGrowMemory()|0;
@@ -799,11 +810,27 @@ LibraryManager.library = {
     return ret;
   },
 
+  // Also correct when the ranges overlap, as both copyWithin() and set() on the same buffer copy as if through a
+  // temporary, which memmove relies on. copyWithin() is faster, as it does not create a view (split memory's HEAPU8
+  // only has set()).
   emscripten_memcpy_big: function(dest, src, num) {
-    HEAPU8.set(HEAPU8.subarray(src, src+num), dest);
+    if (HEAPU8.copyWithin) {
+      HEAPU8.copyWithin(dest, src, src+num);
+    } else {
+      HEAPU8.set(HEAPU8.subarray(src, src+num), dest);
+    }
     return dest;
   },
 
+  emscripten_memset_big: function(ptr, value, num) {
+    if (HEAPU8.fill) {
+      HEAPU8.fill(value, ptr, ptr+num);
+    } else {
+      for (var i = 0; i < num; i++) HEAPU8[ptr+i] = value;
+    }
+    return ptr;
+  },
+
   memcpy__asm: true,
   memcpy__sig: 'iiii',
   memcpy__deps: ['emscripten_memcpy_big'],
@@ -813,16 +840,20 @@ LibraryManager.library = {
     var aligned_dest_end = 0;
     var block_aligned_dest_end = 0;
     var dest_end = 0;
-    // Test against a benchmarked cutoff limit for when HEAPU8.set() becomes faster to use.
+    // Test against benchmarked cutoff limits for when emscripten_memcpy_big() becomes faster to use. That happens much
+    // sooner when the source and destination are not aligned the same way, as then this can only copy single bytes.
     if ((num|0) >=
 #if SIMD
       196608
 #else
-      8192
+      1024
 #endif
     ) {
       return _emscripten_memcpy_big(dest|0, src|0, num|0)|0;
     }
+    if ((((dest ^ src) & 3) != 0) & ((num|0) >= 256)) {
+      return _emscripten_memcpy_big(dest|0, src|0, num|0)|0;
+    }
 
     ret = dest|0;
     dest_end = (dest + num)|0;
@@ -897,15 +928,34 @@ LibraryManager.library = {
 
   memmove__sig: 'iiii',
   memmove__asm: true,
-  memmove__deps: ['memcpy'],
+  memmove__deps: ['memcpy', 'emscripten_memcpy_big'],
   memmove: function(dest, src, num) {
     dest = dest|0; src = src|0; num = num|0;
     var ret = 0;
     if (((src|0) < (dest|0)) & ((dest|0) < ((src + num)|0))) {
       // Unlikely case: Copy backwards in a safe manner
+      if ((num|0) >= 1024) {
+        return _emscripten_memcpy_big(dest|0, src|0, num|0)|0; // handles the overlap
+      }
       ret = dest;
       src = (src + num)|0;
       dest = (dest + num)|0;
+      if (((dest ^ src) & 3) == 0) {
+        // The unaligned end, then whole words. dest is at least 4 bytes after src, so a word is read before it is
+        // overwritten.
+        while (((dest & 3) != 0) & ((num|0) > 0)) {
+          dest = (dest - 1)|0;
+          src = (src - 1)|0;
+          num = (num - 1)|0;
+          {{{ makeSetValueAsm('dest', 0, makeGetValueAsm('src', 0, 'i8'), 'i8') }}};
+        }
+        while ((num|0) >= 4) {
+          dest = (dest - 4)|0;
+          src = (src - 4)|0;
+          num = (num - 4)|0;
+          {{{ makeSetValueAsm('dest', 0, makeGetValueAsm('src', 0, 'i32'), 'i32') }}};
+        }
+      }
       while ((num|0) > 0) {
         dest = (dest - 1)|0;
         src = (src - 1)|0;
@@ -928,6 +978,9 @@ LibraryManager.library = {
   },
   memset__sig: 'iiii',
   memset__asm: true,
+#if SPLIT_MEMORY == 0
+  memset__deps: ['emscripten_memset_big'],
+#endif
   memset: function(ptr, value, num) {
     ptr = ptr|0; value = value|0; num = num|0;
     var end = 0, aligned_end = 0, block_aligned_end = 0, value4 = 0;
@@ -937,6 +990,18 @@ LibraryManager.library = {
     end = (ptr + num)|0;
 
     value = value & 0xff;
+#if SPLIT_MEMORY == 0
+    // Test against a benchmarked cutoff limit for when emscripten_memset_big() becomes faster to use.
+    if ((num|0) >=
+#if SIMD
+      196608
+#else
+      1024
+#endif
+    ) {
+      return _emscripten_memset_big(ptr|0, value|0, num|0)|0;
+    }
+#endif
     if ((num|0) >= 67 /* 64 bytes for an unrolled loop + 3 bytes for unaligned head*/) {
       while ((ptr&3) != 0) {
         {{{ makeSetValueAsm('ptr', 0, 'value', 'i8') }}};
@@ -2901,15 +2966,21 @@ LibraryManager.library = {
     // Not particularly fast: slow table lookup of setjmpId to label. But setjmp
     // prevents relooping anyhow, so slowness is to be expected. And typical case
     // is 1 setjmp per invocation, or less.
+    // The table is per invocation of the function that calls setjmp, and only
+    // grows when needed, so that calling setjmp again at the same place into the
+    // same jmp_buf, as in a loop, reuses the entry of the previous call, which
+    // can no longer be jumped to, as the jmp_buf now has the new id.
     env = env|0;
     label = label|0;
     table = table|0;
     size = size|0;
-    var i = 0;
+    var i = 0, prevId = 0, curr = 0;
+    prevId = {{{ makeGetValueAsm('env', '0', 'i32') }}};
     setjmpId = (setjmpId+1)|0;
     {{{ makeSetValueAsm('env', '0', 'setjmpId', 'i32') }}};
     while ((i|0) < (size|0)) {
-      if ({{{ makeGetValueAsm('table', '(i<<3)', 'i32') }}} == 0) {
+      curr = {{{ makeGetValueAsm('table', '(i<<3)', 'i32') }}};
+      if ((curr|0) == 0) {
         {{{ makeSetValueAsm('table', '(i<<3)', 'setjmpId', 'i32') }}};
         {{{ makeSetValueAsm('table', '(i<<3)+4', 'label', 'i32') }}};
         // prepare next slot
@@ -2917,12 +2988,21 @@ LibraryManager.library = {
         {{{ makeSetTempRet0('size') }}};
         return table | 0;
       }
+      if ((curr|0) == (prevId|0)) {
+        if (({{{ makeGetValueAsm('table', '(i<<3)+4', 'i32') }}}|0) == (label|0)) {
+          {{{ makeSetValueAsm('table', '(i<<3)', 'setjmpId', 'i32') }}};
+          {{{ makeSetTempRet0('size') }}};
+          return table | 0;
+        }
+      }
       i = i+1|0;
     }
     // grow the table
     size = (size*2)|0;
     table = _realloc(table|0, 8*(size+1|0)|0) | 0;
-    table = _saveSetjmp(env|0, label|0, table|0, size|0) | 0;
+    {{{ makeSetValueAsm('table', '(i<<3)', 'setjmpId', 'i32') }}};
+    {{{ makeSetValueAsm('table', '(i<<3)+4', 'label', 'i32') }}};
+    {{{ makeSetValueAsm('table', '(i<<3)+8', '0', 'i32') }}};
     {{{ makeSetTempRet0('size') }}};
     return table | 0;
   },
@@ -4261,6 +4341,34 @@ LibraryManager.library = {
     return cache[fullname] = allocate(intArrayFromString(ret + ''), 'i8', ALLOC_NORMAL);
   },
 
+  emscripten_reserve_heap: function(bytes) {
+    var top = HEAP32[DYNAMICTOP_PTR>>2];
+    if (top + bytes <= TOTAL_MEMORY) return 1;
+#if ALLOW_MEMORY_GROWTH
+    return enlargeMemory(top + bytes) ? 1 : 0;
+#else
+    return 0;
+#endif
+  },
+
+  emscripten_trim_heap__deps: ['malloc_trim'],
+  emscripten_trim_heap: function(pad) {
+    var oldTop = HEAP32[DYNAMICTOP_PTR>>2];
+    if (!_malloc_trim(pad)) return 0;
+    shrinkMemory(oldTop);
+    return 1;
+  },
+
+  emscripten_get_heap_stats__deps: ['emscripten_malloc_heap_stats'],
+  emscripten_get_heap_stats: function(stats) {
+    // The fields of the heap as a whole come first in emscripten_heap_stats, and the malloc library fills in the rest.
+    {{{ makeSetValue('stats', '0', 'TOTAL_MEMORY', 'i32') }}};
+    {{{ makeSetValue('stats', '4', 'HEAP32[DYNAMICTOP_PTR>>2]', 'i32') }}};
+    {{{ makeSetValue('stats', '8', 'STACK_MAX - STACK_BASE', 'i32') }}};
+    {{{ makeSetValue('stats', '12', 'stackSave() - STACK_BASE', 'i32') }}};
+    _emscripten_malloc_heap_stats(stats);
+  },
+
   emscripten_debugger: function() {
     debugger;
   },
@@ -4504,19 +4612,24 @@ LibraryManager.library = {
   },
   __muldi3__sig: 'iiiii',
   __muldi3__asm: true,
-  __muldi3__deps: ['__muldsi3'],
   __muldi3: function($a$0, $a$1, $b$0, $b$1) {
     $a$0 = $a$0 | 0;
     $a$1 = $a$1 | 0;
     $b$0 = $b$0 | 0;
     $b$1 = $b$1 | 0;
-    var $x_sroa_0_0_extract_trunc = 0, $y_sroa_0_0_extract_trunc = 0, $1$0 = 0, $1$1 = 0, $2 = 0;
-    $x_sroa_0_0_extract_trunc = $a$0;
-    $y_sroa_0_0_extract_trunc = $b$0;
-    $1$0 = ___muldsi3($x_sroa_0_0_extract_trunc, $y_sroa_0_0_extract_trunc) | 0;
-    $1$1 = {{{ makeGetTempRet0() }}};
-    $2 = Math_imul($a$1, $y_sroa_0_0_extract_trunc) | 0;
-    return ({{{ makeSetTempRet0('((Math_imul($b$1, $x_sroa_0_0_extract_trunc) | 0) + $2 | 0) + $1$1 | $1$1 & 0') }}}, 0 | $1$0 & -1) | 0;
+    var $al = 0, $ah = 0, $bl = 0, $bh = 0, $ll = 0, $mid = 0, $lh = 0;
+    // The 32x32->64 product of the low words is done inline in 16-bit halves, instead of by calling __muldsi3, as
+    // the call is not inlined in asm.js and costs about as much as the arithmetic. The cross products only affect
+    // the high word.
+    $al = $a$0 & 65535;
+    $ah = $a$0 >>> 16;
+    $bl = $b$0 & 65535;
+    $bh = $b$0 >>> 16;
+    $ll = Math_imul($al, $bl) | 0;
+    $mid = ($ll >>> 16) + (Math_imul($ah, $bl) | 0) | 0;
+    $lh = Math_imul($al, $bh) | 0;
+    {{{ makeSetTempRet0('($mid >>> 16) + (Math_imul($ah, $bh) | 0) + (($mid & 65535) + $lh >>> 16) + (Math_imul($a$1, $b$0) | 0) + (Math_imul($a$0, $b$1) | 0) | 0') }}};
+    return Math_imul($a$0, $b$0) | 0;
   },
   __udivdi3__sig: 'iiiii',
   __udivdi3__asm: true,
@@ -4556,6 +4669,23 @@ LibraryManager.library = {
     $b$1 = $b$1 | 0;
     $rem = $rem | 0;
     var $n_sroa_0_0_extract_trunc = 0, $n_sroa_1_4_extract_shift$0 = 0, $n_sroa_1_4_extract_trunc = 0, $d_sroa_0_0_extract_trunc = 0, $d_sroa_1_4_extract_shift$0 = 0, $d_sroa_1_4_extract_trunc = 0, $4 = 0, $17 = 0, $37 = 0, $49 = 0, $51 = 0, $57 = 0, $58 = 0, $66 = 0, $78 = 0, $86 = 0, $88 = 0, $89 = 0, $91 = 0, $92 = 0, $95 = 0, $105 = 0, $117 = 0, $119 = 0, $125 = 0, $126 = 0, $130 = 0, $q_sroa_1_1_ph = 0, $q_sroa_0_1_ph = 0, $r_sroa_1_1_ph = 0, $r_sroa_0_1_ph = 0, $sr_1_ph = 0, $d_sroa_0_0_insert_insert99$0 = 0, $d_sroa_0_0_insert_insert99$1 = 0, $137$0 = 0, $137$1 = 0, $carry_0203 = 0, $sr_1202 = 0, $r_sroa_0_1201 = 0, $r_sroa_1_1200 = 0, $q_sroa_0_1199 = 0, $q_sroa_1_1198 = 0, $147 = 0, $149 = 0, $r_sroa_0_0_insert_insert42$0 = 0, $r_sroa_0_0_insert_insert42$1 = 0, $150$1 = 0, $151$0 = 0, $152 = 0, $154$0 = 0, $r_sroa_0_0_extract_trunc = 0, $r_sroa_1_4_extract_trunc = 0, $155 = 0, $carry_0_lcssa$0 = 0, $carry_0_lcssa$1 = 0, $r_sroa_0_1_lcssa = 0, $r_sroa_1_1_lcssa = 0, $q_sroa_0_1_lcssa = 0, $q_sroa_1_1_lcssa = 0, $q_sroa_0_0_insert_ext75$0 = 0, $q_sroa_0_0_insert_ext75$1 = 0, $q_sroa_0_0_insert_insert77$1 = 0, $_0$0 = 0, $_0$1 = 0;
+    var $d = 0.0, $r = 0.0, $q1 = 0.0, $q2 = 0.0, $q3 = 0.0;
+    if ((($b$1 | 0) == 0) & (($b$0 | 0) != 0) & (($a$1 | 0) != 0)) {
+      // A 64-bit dividend over a 32-bit divisor (like hashes modulo a table size): long division in 16-bit steps,
+      // whose partial dividends stay below 2^48, so each double division is exact. This avoids the bit-at-a-time
+      // loop below.
+      $d = +($b$0 >>> 0);
+      $q1 = +Math_floor(+($a$1 >>> 0) / $d);
+      $r = (+($a$1 >>> 0) - $q1 * $d) * 65536.0 + +($a$0 >>> 16);
+      $q2 = +Math_floor($r / $d);
+      $r = ($r - $q2 * $d) * 65536.0 + +($a$0 & 65535);
+      $q3 = +Math_floor($r / $d);
+      if (($rem | 0) != 0) {
+        HEAP32[$rem >> 2] = ~~($r - $q3 * $d);
+        HEAP32[$rem + 4 >> 2] = 0;
+      }
+      return ({{{ makeSetTempRet0('~~$q1') }}}, ~~$q2 << 16 | ~~$q3) | 0;
+    }
     $n_sroa_0_0_extract_trunc = $a$0;
     $n_sroa_1_4_extract_shift$0 = $a$1;
     $n_sroa_1_4_extract_trunc = $n_sroa_1_4_extract_shift$0;
@@ -214,6 +214,13 @@ mergeInto(LibraryManager.library, {
     );
   },
 
+  emscripten_fiber_create: function() {
+    throw 'Fibers need -s EMTERPRETIFY_ASYNC=1, and do not support ASYNCIFY';
+  },
+  emscripten_fiber_swap: function() {
+    throw 'Fibers need -s EMTERPRETIFY_ASYNC=1, and do not support ASYNCIFY';
+  },
+
 #else // ASYNCIFY
 
 #if EMTERPRETIFY_ASYNC
@@ -263,6 +270,9 @@ mergeInto(LibraryManager.library, {
         // save the stack we want to resume. this lets other code run in between
         // XXX this assumes that this stack top never ever leak! exceptions might violate that
         var stack = new Int32Array(HEAP32.subarray(EMTSTACKTOP>>2, Module['emtStackSave']()>>2));
+#if EMTERPRETIFY_PROFILE
+        EmterpreterProfile.notePause(stack);
+#endif
         var stacktop = Module['stackSave']();
 
         var resumedCallbacksForYield = false;
@@ -509,6 +519,121 @@ mergeInto(LibraryManager.library, {
     }
   },
 
+  /*
+   * Layout of an EMTERPRETIFY_ASYNC fiber structure:
+   *
+   *  0 my EMTSTACKTOP
+   *  4 my EMTSTACKTOP from the compiled code
+   *  8 my EMT_STACK_MAX
+   * 12 my STACKTOP
+   * 16 my STACK_MAX
+   * 20 entry function (0 if already started)
+   * 24 entry arg
+   * 28 whether the entry function returned
+   * 32 my emterpreter stack:
+   *    ...
+   *    my C stack (aligned):
+   *    ...
+   *
+   * Only the main context runs fibers: switching away from a fiber unwinds it (as emscripten_yield does) back to
+   * the loop in emscripten_fiber_swap in the main context, which then rewinds the next one, or returns.
+   */
+  $EmterpreterFibers: {
+    current: 0, // the fiber being run, or 0 in the main context
+    next: 0, // the fiber to run once the current one has unwound, or 0 to return to the main context
+  },
+
+  emscripten_fiber_create__sig: 'iiiii',
+  emscripten_fiber_create__asm: true,
+  emscripten_fiber_create__deps: ['malloc'],
+  emscripten_fiber_create: function(f, arg, c_stack_size, emt_stack_size) {
+    f = f|0;
+    arg = arg|0;
+    c_stack_size = c_stack_size|0;
+    emt_stack_size = emt_stack_size|0;
+    var fiber = 0, stack = 0;
+
+    if ((c_stack_size|0) <= 0) c_stack_size = 16384;
+    if ((emt_stack_size|0) <= 0) emt_stack_size = 16384;
+    c_stack_size = (c_stack_size + 15) & -16;
+    emt_stack_size = (emt_stack_size + 7) & -8;
+
+    fiber = _malloc(32 + emt_stack_size + c_stack_size + 16 | 0)|0;
+    if (!fiber) return 0;
+    {{{ makeSetValueAsm('fiber', 0, '(fiber+32)', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 4, '(fiber+32)', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 8, '(fiber+32+emt_stack_size)', 'i32') }}};
+    stack = (fiber + 32 + emt_stack_size + 15) & -16;
+    {{{ makeSetValueAsm('fiber', 12, 'stack', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 16, '(stack+c_stack_size)', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 20, 'f', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 24, 'arg', 'i32') }}};
+    {{{ makeSetValueAsm('fiber', 28, 0, 'i32') }}};
+    return fiber|0;
+  },
+
+  emscripten_fiber_swap__sig: 'vi',
+  emscripten_fiber_swap__deps: ['$EmterpreterAsync', '$EmterpreterFibers'],
+  emscripten_fiber_swap: function(fiber) {
+    if (EmterpreterFibers.current) {
+      // in a fiber: unwind it, or, if we are rewinding into it, carry on where it left off
+      if (EmterpreterAsync.state === 2) {
+        EmterpreterAsync.setState(0);
+      } else if (fiber !== EmterpreterFibers.current) {
+        EmterpreterFibers.next = fiber;
+        EmterpreterAsync.setState(1);
+      }
+      return;
+    }
+
+    // in the main context: run fibers until one switches back to it
+    var mainEmtStackTop = EMTSTACKTOP;
+    var mainEmtStackSave = Module['emtStackSave']();
+    var mainEmtStackMax = Module['getEmtStackMax']();
+    var mainStackTop = stackSave();
+    EmterpreterFibers.next = fiber;
+    while (EmterpreterFibers.next) {
+      fiber = EmterpreterFibers.current = EmterpreterFibers.next;
+      EmterpreterFibers.next = 0;
+#if ASSERTIONS
+      assert(!{{{ makeGetValue('fiber', 28, 'i32') }}}, 'cannot switch to a fiber whose entry function has returned');
+#endif
+
+      // switch context
+      EMTSTACKTOP = {{{ makeGetValue('fiber', 0, 'i32') }}};
+      Module['emtStackRestore']({{{ makeGetValue('fiber', 4, 'i32') }}});
+      Module['setEmtStackMax']({{{ makeGetValue('fiber', 8, 'i32') }}});
+      establishStackSpace({{{ makeGetValue('fiber', 12, 'i32') }}}, {{{ makeGetValue('fiber', 16, 'i32') }}});
+
+      var func = {{{ makeGetValue('fiber', 20, 'i32') }}};
+      if (func !== 0) {
+        // first run
+        {{{ makeSetValue('fiber', 20, 0, 'i32') }}};
+        {{{ makeDynCall('vi') }}}(func, {{{ makeGetValue('fiber', 24, 'i32') }}});
+      } else {
+        EmterpreterAsync.setState(2);
+        Module['emterpret']({{{ makeGetValue('EMTSTACKTOP', 0, 'i32')}}});
+      }
+      if (EmterpreterAsync.state === 0) {
+        // the entry function returned, which switches back to the main context
+        {{{ makeSetValue('fiber', 28, 1, 'i32') }}};
+      }
+#if ASSERTIONS
+      else assert(EmterpreterAsync.state === 1 && EmterpreterFibers.next !== fiber, 'a fiber can only be unwound by emscripten_fiber_swap');
+#endif
+      EmterpreterAsync.setState(0);
+
+      // switch context
+      {{{ makeSetValue('fiber', 4, "Module['emtStackSave']()", 'i32') }}};
+      {{{ makeSetValue('fiber', 12, 'stackSave()', 'i32') }}};
+    }
+    EmterpreterFibers.current = 0;
+    EMTSTACKTOP = mainEmtStackTop;
+    Module['emtStackRestore'](mainEmtStackSave);
+    Module['setEmtStackMax'](mainEmtStackMax);
+    establishStackSpace(mainStackTop, STACK_MAX);
+  },
+
 #else // EMTERPRETIFY_ASYNC
 
   emscripten_sleep: function() {
@@ -523,6 +648,12 @@ mergeInto(LibraryManager.library, {
   emscripten_yield: function() {
     throw 'Please compile your program with async support in order to use asynchronous operations like emscripten_yield';
   },
+  emscripten_fiber_create: function() {
+    throw 'Please compile your program with -s EMTERPRETIFY_ASYNC=1 in order to use fibers, like emscripten_fiber_create';
+  },
+  emscripten_fiber_swap: function() {
+    throw 'Please compile your program with -s EMTERPRETIFY_ASYNC=1 in order to use fibers, like emscripten_fiber_swap';
+  },
   emscripten_wget: function(url, file) {
     throw 'Please compile your program with async support in order to use asynchronous operations like emscripten_wget';
   },
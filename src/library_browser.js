@@ -75,6 +75,59 @@ var LibraryBrowser = {
         if (Module['postMainLoop']) Module['postMainLoop']();
       }
     },
+    // Work registered with emscripten_set_idle_callback. It runs from requestIdleCallback where available; otherwise
+    // it runs after each main loop frame in whatever is left of the measured frame interval.
+    idle: {
+      func: 0,
+      arg: 0,
+      scheduled: false,
+      frameStart: 0,
+      frameBudget: 1000 / 60, // moving average of the interval between main loop frames, in ms
+      schedule: function() {
+        if (Browser.idle.scheduled || !Browser.idle.func) return;
+        if (typeof requestIdleCallback !== 'undefined') {
+          Browser.idle.scheduled = true;
+          requestIdleCallback(function Browser_idle_requestIdleCallback(deadline) {
+            Browser.idle.scheduled = false;
+            Browser.idle.run(deadline.timeRemaining());
+          });
+        } else if (!Browser.mainLoop.func) {
+          // No main loop to measure frames against: run in a separate task, with a whole frame as the budget.
+          Browser.idle.scheduled = true;
+          setTimeout(function Browser_idle_setTimeout() {
+            Browser.idle.scheduled = false;
+            Browser.idle.run(Browser.idle.frameBudget);
+          }, 0);
+        }
+      },
+      // Called by the main loop runner at the start of each frame it renders.
+      frameStarted: function(now) {
+        var idle = Browser.idle;
+        if (idle.frameStart) {
+          var interval = now - idle.frameStart;
+          if (interval < 1000) idle.frameBudget += (interval - idle.frameBudget) * 0.1;
+        }
+        idle.frameStart = now;
+      },
+      // Called by the main loop runner after each frame it renders.
+      frameEnded: function(now) {
+        var idle = Browser.idle;
+        if (!idle.func || typeof requestIdleCallback !== 'undefined') return;
+        var remaining = idle.frameStart + idle.frameBudget - now - 1; // leave a little slack for the browser
+        if (remaining > 1) idle.run(remaining);
+      },
+      run: function(timeRemaining) {
+        var idle = Browser.idle;
+        if (!idle.func || ABORT) return;
+        var func = idle.func;
+        if (!Module['dynCall_idi'](func, timeRemaining, idle.arg)) {
+          // unless a new callback was set from inside this one, we are done
+          if (idle.func === func) idle.func = 0;
+          return;
+        }
+        Browser.idle.schedule();
+      }
+    },
     isFullscreen: false,
     pointerLock: false,
     moduleContextCreatedCallbacks: [],
@@ -130,6 +183,19 @@ var LibraryBrowser = {
           bb.append((new Uint8Array(byteArray)).buffer); // we need to pass a buffer, and must copy the array to get the right data range
           b = bb.getBlob();
         }
+#if PRELOAD_IMAGE_WORKERS
+        if (Browser.canDecodeImagesInWorkers()) {
+          // the preloaded image is an ImageData rather than a canvas, see decodeImageInWorker
+          Browser.decodeImageInWorker(b, function(image) {
+            Module["preloadedImages"][name] = image;
+            if (onload) onload(byteArray);
+          }, function(error) {
+            console.log('Image ' + name + ' could not be decoded: ' + error);
+            if (onerror) onerror();
+          });
+          return;
+        }
+#endif
         var url = Browser.URLObject.createObjectURL(b);
 #if ASSERTIONS
         assert(typeof url == 'string', 'createObjectURL must return a url as a string');
@@ -473,6 +539,69 @@ var LibraryBrowser = {
       }, timeout);
     },
 
+#if PRELOAD_IMAGE_WORKERS
+    // Decoding of preloaded images in workers, with createImageBitmap and an
+    // OffscreenCanvas, so that the main thread only receives the RGBA pixels
+    // (as an ImageData). Each image goes to the worker with the fewest images
+    // pending, starting new ones up to PRELOAD_IMAGE_WORKERS, so images are
+    // decoded in parallel. The workers are stopped once all are done.
+    imageWorkers: [],
+    imageWorkerCallbacks: {},
+    imageWorkerPending: 0,
+    nextImageWorkerRequest: 0,
+    canDecodeImagesInWorkers: function() {
+      return typeof Worker !== 'undefined' && typeof createImageBitmap === 'function' &&
+             typeof OffscreenCanvas !== 'undefined' && typeof ImageData !== 'undefined';
+    },
+    imageWorkerSource: [
+      'onmessage = function(e) {',
+      '  var id = e.data.id;',
+      '  createImageBitmap(e.data.blob).then(function(bitmap) {',
+      '    var canvas = new OffscreenCanvas(bitmap.width, bitmap.height);',
+      '    var ctx = canvas.getContext("2d");',
+      '    ctx.drawImage(bitmap, 0, 0);',
+      '    var data = ctx.getImageData(0, 0, bitmap.width, bitmap.height).data;',
+      '    postMessage({ id: id, width: bitmap.width, height: bitmap.height, data: data.buffer }, [data.buffer]);',
+      '  }, function(error) {',
+      '    postMessage({ id: id, error: "" + error });',
+      '  });',
+      '};'
+    ].join('\n'),
+    decodeImageInWorker: function(blob, onload, onerror) {
+      var workers = Browser.imageWorkers;
+      var worker = null;
+      for (var i = 0; i < workers.length; i++) {
+        if (!worker || workers[i].pending < worker.pending) worker = workers[i];
+      }
+      if (!worker || (worker.pending > 0 && workers.length < {{{ PRELOAD_IMAGE_WORKERS }}})) {
+        var url = Browser.URLObject.createObjectURL(new Blob([Browser.imageWorkerSource], { type: 'application/javascript' }));
+        worker = new Worker(url);
+        Browser.URLObject.revokeObjectURL(url);
+        worker.pending = 0;
+        worker.onmessage = function(e) {
+          var callbacks = Browser.imageWorkerCallbacks[e.data.id];
+          delete Browser.imageWorkerCallbacks[e.data.id];
+          this.pending--;
+          if (--Browser.imageWorkerPending === 0) {
+            Browser.imageWorkers.forEach(function(worker) { worker.terminate() });
+            Browser.imageWorkers = [];
+          }
+          if (e.data.error) {
+            callbacks.onerror(e.data.error);
+          } else {
+            callbacks.onload(new ImageData(new Uint8ClampedArray(e.data.data), e.data.width, e.data.height));
+          }
+        };
+        workers.push(worker);
+      }
+      var id = Browser.nextImageWorkerRequest++;
+      Browser.imageWorkerCallbacks[id] = { onload: onload, onerror: onerror };
+      worker.pending++;
+      Browser.imageWorkerPending++;
+      worker.postMessage({ id: id, blob: blob });
+    },
+
+#endif
     getMimetype: function(name) {
       return {
         'jpg': 'image/jpeg',
@@ -1059,7 +1188,20 @@ var LibraryBrowser = {
       };
       Browser.mainLoop.method = 'rAF';
     } else if (mode == 2 /*EM_TIMING_SETIMMEDIATE*/) {
-      if (typeof setImmediate === 'undefined') {
+      if (typeof setImmediate === 'undefined' && typeof MessageChannel !== 'undefined') {
+        // Emulate setImmediate with a private MessageChannel. Its messages skip the global message event dispatch
+        // (and in a worker the round trip through the main thread), so they arrive with less latency than
+        // postMessage to ourselves.
+        var setImmediates = [];
+        var channel = new MessageChannel();
+        channel.port1.onmessage = function Browser_setImmediate_channelHandler() {
+          setImmediates.shift()();
+        };
+        setImmediate = function Browser_channel_setImmediate(func) {
+          setImmediates.push(func);
+          channel.port2.postMessage(0);
+        }
+      } else if (typeof setImmediate === 'undefined') {
         // Emulate setImmediate. (note: not a complete polyfill, we don't emulate clearImmediate() to keep code size to minimum, since not needed)
         var setImmediates = [];
         var emscriptenMainLoopMessageId = 'setimmediate';
@@ -1151,6 +1293,7 @@ var LibraryBrowser = {
       } else if (Browser.mainLoop.timingMode == 0/*EM_TIMING_SETTIMEOUT*/) {
         Browser.mainLoop.tickStartTime = _emscripten_get_now();
       }
+      if (Browser.idle.func) Browser.idle.frameStarted(_emscripten_get_now());
 
       // Signal GL rendering layer that processing of a new frame is about to start. This helps it optimize
       // VBO double-buffering and reduce GPU stalls.
@@ -1186,6 +1329,11 @@ var LibraryBrowser = {
       //       do not need to be hardcoded into this function, but can be more generic.
       if (typeof SDL === 'object' && SDL.audio && SDL.audio.queueNewAudioData) SDL.audio.queueNewAudioData();
 
+      if (Browser.idle.func) Browser.idle.frameEnded(_emscripten_get_now());
+
+      // catch pauses from the idle callback
+      if (thisMainLoopId < Browser.mainLoop.currentlyRunningMainloop) return;
+
       Browser.mainLoop.scheduler();
     }
 
@@ -1211,6 +1359,7 @@ var LibraryBrowser = {
   emscripten_cancel_main_loop: function() {
     Browser.mainLoop.pause();
     Browser.mainLoop.func = null;
+    Browser.idle.schedule(); // idle work that followed the frames now needs its own scheduling
   },
 
   // Runs natively in pthread, no __proxy needed.
@@ -1223,6 +1372,14 @@ var LibraryBrowser = {
     Browser.mainLoop.resume();
   },
 
+  // Runs natively in pthread, no __proxy needed.
+  emscripten_set_idle_callback: function(func, arg) {
+    Browser.idle.func = func;
+    Browser.idle.arg = arg;
+    Browser.idle.frameStart = 0;
+    Browser.idle.schedule();
+  },
+
   // Runs natively in pthread, no __proxy needed.
   _emscripten_push_main_loop_blocker: function(func, arg, name) {
     Browser.mainLoop.queue.push({ func: function() {
@@ -1251,7 +1408,7 @@ var LibraryBrowser = {
     Module['noExitRuntime'] = true;
 
     function wrapper() {
-      getFuncWrapper(func, 'vi')(arg);
+      {{{ makeDynCall('vi') }}}(func, arg);
     }
 
     if (millis >= 0) {
@@ -1279,6 +1436,69 @@ var LibraryBrowser = {
     Module['exit'](status);
   },
 
+#if SNAPSHOT
+  emscripten_snapshot_point__deps: ['$FS', '$MEMFS', '$PATH'],
+#endif
+  emscripten_snapshot_point: function(resume) {
+#if SNAPSHOT
+    if (Module['snapshotCapture']) {
+      // Taking the snapshot at build time, see tools/snapshot.py. Memory up to the top of the dynamic heap becomes the
+      // memory initializer.
+      var end = HEAP32[DYNAMICTOP_PTR>>2];
+      while (end > GLOBAL_BASE && HEAPU8[end - 1] === 0) end--;
+      // The .snapshot file is the length of a JSON description of the rest of the state, the JSON, and then the
+      // contents of the files, which the JSON refers to by their offsets.
+      var files = [];
+      var contents = [];
+      var size = 0;
+      (function walk(path) {
+        FS.readdir(path).forEach(function(name) {
+          if (name === '.' || name === '..') return;
+          var child = PATH.join2(path, name);
+          if (child === '/dev' || child === '/proc') return;
+          var node = FS.lookupPath(child, { follow: false }).node;
+          if (node.mount.type !== MEMFS) return;
+          if (FS.isDir(node.mode)) {
+            files.push([child, node.mode]);
+            walk(child);
+          } else if (FS.isLink(node.mode)) {
+            files.push([child, node.mode, node.link]);
+          } else if (FS.isFile(node.mode)) {
+            var data = MEMFS.getFileDataAsTypedArray(node);
+            files.push([child, node.mode, size, size + data.length]);
+            contents.push(data);
+            size += data.length;
+          }
+        });
+      })('/');
+      for (var fd = 3; fd < FS.streams.length; fd++) {
+        if (FS.streams[fd]) Module.printErr('warning: ' + FS.streams[fd].path + ' is open at the snapshot point, but will not be when starting from the snapshot');
+      }
+      var atexits = __ATEXIT__.filter(function(atexit) {
+        return typeof atexit.func === 'number';
+      }).map(function(atexit) {
+        return [atexit.func, atexit.arg];
+      });
+      var json = intArrayFromString(JSON.stringify({ resume: resume, cwd: FS.cwd(), files: files, atexits: atexits }), true);
+      var snapshot = new Uint8Array(4 + json.length + size);
+      snapshot[0] = json.length;
+      snapshot[1] = json.length >> 8;
+      snapshot[2] = json.length >> 16;
+      snapshot[3] = json.length >> 24;
+      snapshot.set(json, 4);
+      var offset = 4 + json.length;
+      contents.forEach(function(data) {
+        snapshot.set(data, offset);
+        offset += data.length;
+      });
+      Module['snapshotCapture'](HEAPU8.subarray(GLOBAL_BASE, end), snapshot);
+      Module['noExitRuntime'] = true;
+      throw 'SimulateInfiniteLoop';
+    }
+#endif
+    {{{ makeDynCall('v') }}}(resume);
+  },
+
   emscripten_get_device_pixel_ratio__proxy: 'sync',
   emscripten_get_device_pixel_ratio__sig: 'd',
   emscripten_get_device_pixel_ratio: function() {
@@ -1446,6 +1666,16 @@ var LibraryBrowser = {
     path = PATH.resolve(path);
 
     var canvas = Module["preloadedImages"][path];
+#if PRELOAD_IMAGE_WORKERS
+    if (canvas && typeof ImageData !== 'undefined' && canvas instanceof ImageData) {
+      // decoded in a worker, we already have the pixels
+      var buf = _malloc(canvas.width * canvas.height * 4);
+      HEAPU8.set(canvas.data, buf);
+      {{{ makeSetValue('w', '0', 'canvas.width', 'i32') }}};
+      {{{ makeSetValue('h', '0', 'canvas.height', 'i32') }}};
+      return buf;
+    }
+#endif
     if (canvas) {
       var ctx = canvas.getContext("2d");
       var image = ctx.getImageData(0, 0, canvas.width, canvas.height);
@@ -347,11 +347,34 @@ var CyberDWARFHeapPrinter = function(cdFileLocation) {
 
   var symbols = {};
 
-  function install_cyberdwarf(data_cd) {
-    cyberdwarf = JSON.parse(data_cd)["cyberdwarf"];
+  // The debug data is an index, which we parse up front, and a record for each type and function, which we only read
+  // and parse when it is first used, see tools/emdebug_cd_merger.py. read_cd(offset, length) returns those bytes of the
+  // file.
+  var read_cd;
+  var cd_records_start = 0;
+  var cd_parsed = { "types": {}, "functions": {} };
+
+  function install_cyberdwarf(read) {
+    var header = read(0, 12);
+    if (String.fromCharCode(header[0], header[1], header[2], header[3]) !== "CDWF") {
+      throw 'invalid debug data ' + cdFileLocation;
+    }
+    var index_length = header[8] | (header[9] << 8) | (header[10] << 16) | (header[11] << 24);
+    read_cd = read;
+    cd_records_start = 12 + index_length;
+    cyberdwarf = JSON.parse(UTF8ArrayToString(read(12, index_length), 0, index_length));
     invert_vtables();
   }
 
+  function get_cd_record(kind, name) {
+    var parsed = cd_parsed[kind];
+    if (!parsed.hasOwnProperty(name)) {
+      var location = cyberdwarf[kind][name];
+      parsed[name] = location ? JSON.parse(UTF8ArrayToString(read_cd(cd_records_start + location[0], location[1]), 0, location[1])) : undefined;
+    }
+    return parsed[name];
+  }
+
   function type_descriptor_to_heap_id(type_descriptor) {
     var id = "";
     switch (type_descriptor[TAG_IDX]) {
@@ -365,7 +388,7 @@ var CyberDWARFHeapPrinter = function(cdFileLocation) {
 
   function type_id_to_type_descriptor(type_id, ptr, dit) {
     if (!isNaN(+type_id)) {
-      return cyberdwarf["types"][type_id];
+      return get_cd_record("types", type_id);
     }
     if (typeof(type_id) === "string") {
       if (dit) {
@@ -373,7 +396,7 @@ var CyberDWARFHeapPrinter = function(cdFileLocation) {
       }
       type_id = cyberdwarf["type_name_map"][type_id];
     }
-    return cyberdwarf["types"][type_id];
+    return get_cd_record("types", type_id);
   }
 
   function invert_vtables() {
@@ -403,7 +426,7 @@ var CyberDWARFHeapPrinter = function(cdFileLocation) {
     if (func_name.substring(0,1) == "_") {
       func_name = func_name.substring(1);
     }
-    current_function = cyberdwarf["functions"][func_name];
+    current_function = get_cd_record("functions", func_name);
   }
 
   function pretty_print_to_object(val, type_id, depth) {
@@ -451,13 +474,25 @@ var CyberDWARFHeapPrinter = function(cdFileLocation) {
     } else if (Module['cdInitializerPrefixURL']) {
       cdFileLocation = Module['cdInitializerPrefixURL'] + cdFileLocation;
     }
-    if (ENVIRONMENT_IS_NODE || ENVIRONMENT_IS_SHELL) {
-      var data = Module['read'](cdFileLocation);
-      install_cyberdwarf(data);
+    if (ENVIRONMENT_IS_NODE) {
+      // read the records from the file as they are needed
+      var fd = require('fs').openSync(cdFileLocation, 'r');
+      install_cyberdwarf(function(offset, length) {
+        var bytes = new Uint8Array(length);
+        require('fs').readSync(fd, bytes, 0, length, offset);
+        return bytes;
+      });
+    } else if (ENVIRONMENT_IS_SHELL) {
+      var data = Module['readBinary'](cdFileLocation);
+      install_cyberdwarf(function(offset, length) {
+        return data.subarray(offset, offset + length);
+      });
     } else {
       var applyCDFile = function(data) {
-        var decoder = new TextDecoder("utf8");
-        install_cyberdwarf(decoder.decode(data));
+        data = new Uint8Array(data);
+        install_cyberdwarf(function(offset, length) {
+          return data.subarray(offset, offset + length);
+        });
         console.info("Debugger ready");
         if (typeof(cb) !== "undefined") {
           cb();
@@ -3,12 +3,15 @@
 var LibraryFetch = {
 #if USE_PTHREADS
   $Fetch__postset: 'if (!ENVIRONMENT_IS_PTHREAD) Fetch.staticInit();',
-  fetch_work_queue: '; if (ENVIRONMENT_IS_PTHREAD) _fetch_work_queue = PthreadWorkerInit._fetch_work_queue; else PthreadWorkerInit._fetch_work_queue = _fetch_work_queue = allocate(12, "i32*", ALLOC_STATIC)',
+  fetch_work_queue: '; if (ENVIRONMENT_IS_PTHREAD) _fetch_work_queue = PthreadWorkerInit._fetch_work_queue; else PthreadWorkerInit._fetch_work_queue = _fetch_work_queue = allocate(20, "i32*", ALLOC_STATIC)',
 #else
   $Fetch__postset: 'Fetch.staticInit();',
-  fetch_work_queue: 'allocate(12, "i32*", ALLOC_STATIC)',
+  fetch_work_queue: 'allocate(20, "i32*", ALLOC_STATIC)',
 #endif
   $Fetch: Fetch,
+#if EMSCRIPTEN_TRACING
+  $Fetch__deps: ['emscripten_trace_js_log_message'],
+#endif
   _emscripten_get_fetch_work_queue__deps: ['fetch_work_queue'],
   _emscripten_get_fetch_work_queue: function() {
     return _fetch_work_queue;
@@ -18,8 +21,47 @@ var LibraryFetch = {
   $__emscripten_fetch_load_cached_data: __emscripten_fetch_load_cached_data,
   $__emscripten_fetch_cache_data: __emscripten_fetch_cache_data,
   $__emscripten_fetch_xhr: __emscripten_fetch_xhr,
-  emscripten_start_fetch__deps: ['$Fetch', '$__emscripten_fetch_xhr', '$__emscripten_fetch_cache_data', '$__emscripten_fetch_load_cached_data', '$__emscripten_fetch_delete_cached_data', '_emscripten_get_fetch_work_queue', 'emscripten_is_main_runtime_thread', 'pthread_mutex_lock', 'pthread_mutex_unlock'],
-  emscripten_start_fetch: emscripten_start_fetch
+  $__emscripten_fetch_resumable_xhr: __emscripten_fetch_resumable_xhr,
+  emscripten_start_fetch__deps: ['$Fetch', '$__emscripten_fetch_xhr', '$__emscripten_fetch_resumable_xhr', '$__emscripten_fetch_cache_data', '$__emscripten_fetch_load_cached_data', '$__emscripten_fetch_delete_cached_data', '_emscripten_get_fetch_work_queue', 'emscripten_is_main_runtime_thread', 'pthread_mutex_lock', 'pthread_mutex_unlock'],
+  emscripten_start_fetch: emscripten_start_fetch,
+
+  emscripten_fetch_batch_begin__deps: ['$Fetch'],
+  emscripten_fetch_batch_begin: function() {
+    Fetch.batchBegin();
+  },
+
+  emscripten_fetch_batch_end__deps: ['$Fetch'],
+  emscripten_fetch_batch_end: function() {
+    Fetch.batchEnd();
+  },
+
+  emscripten_fetch_preload_cached_data__deps: ['$Fetch'],
+  emscripten_fetch_preload_cached_data: function(paths, numPaths, onfinished, userData) {
+    var pathStrs = [];
+    for(var i = 0; i < numPaths; ++i) pathStrs.push(Pointer_stringify(HEAPU32[paths + 4*i >> 2]));
+    var preload = function() {
+      Fetch.preloadCachedData(Fetch.dbInstance, pathStrs, function(numLoaded) {
+        if (onfinished) Module['dynCall_vii'](onfinished, userData, numLoaded);
+      });
+    };
+#if USE_PTHREADS
+    if (ENVIRONMENT_IS_PTHREAD) {
+      Fetch.openThreadDatabase(preload);
+      return;
+    }
+#endif
+    preload();
+  },
+
+  emscripten_fetch_set_cache_budget__deps: ['$Fetch', 'malloc', 'free'],
+  emscripten_fetch_set_cache_budget: function(budgetLow, budgetHigh, onfinished, userData) {
+    Fetch.reportCacheUsage((budgetLow >>> 0) + (budgetHigh >>> 0) * 4294967296, onfinished, userData);
+  },
+
+  emscripten_fetch_get_cache_usage__deps: ['$Fetch', 'malloc', 'free'],
+  emscripten_fetch_get_cache_usage: function(onfinished, userData) {
+    Fetch.reportCacheUsage(undefined, onfinished, userData);
+  }
 };
 
 mergeInto(LibraryManager.library, LibraryFetch);
@@ -11,6 +11,9 @@ mergeInto(LibraryManager.library, {
 #endif
 #if __EMSCRIPTEN_HAS_noderawfs_js__
     '$NODERAWFS',
+#endif
+#if __EMSCRIPTEN_HAS_opfs_js__
+    '$OPFS',
 #endif
     'stdin', 'stdout', 'stderr'],
   $FS__postset: 'FS.staticInit();' +
@@ -44,6 +47,12 @@ mergeInto(LibraryManager.library, {
     genericErrors: {},
     filesystems: null,
     syncFSRequests: 0, // we warn if there are multiple in flight at once
+    // Results of lookupPath() with the default options or just opts.follow, by the path as it was given, and the current
+    // directory if it is relative. It is cleared whenever a path may stop resolving to the same node: when a node is removed
+    // from the name table (unlink, rmdir, rename), on mount and unmount, and on chmod, which can change lookup permissions.
+    lookupCache: {},
+    lookupCacheSize: 0,
+    LOOKUP_CACHE_MAX_SIZE: 4096,
 
     handleFSError: function(e) {
       if (!(e instanceof FS.ErrnoError)) throw e + ' : ' + stackTrace();
@@ -53,7 +62,20 @@ mergeInto(LibraryManager.library, {
     //
     // paths
     //
+    clearLookupCache: function() {
+      if (FS.lookupCacheSize) {
+        FS.lookupCache = {};
+        FS.lookupCacheSize = 0;
+      }
+    },
     lookupPath: function(path, opts) {
+      var cacheKey;
+      if (path && (!opts || (!opts.parent && opts.follow_mount !== false && !opts.recurse_count))) {
+        cacheKey = (opts && opts.follow ? 'f' : 'n') + (FS.ignorePermissions ? 'i' : 'p') + (path[0] === '/' ? path : FS.currentPath + '\0' + path);
+        var cached = FS.lookupCache[cacheKey];
+        if (cached) return { path: cached.path, node: cached.node };
+      }
+
       path = PATH.resolve(FS.cwd(), path);
       opts = opts || {};
 
@@ -117,6 +139,11 @@ mergeInto(LibraryManager.library, {
         }
       }
 
+      if (cacheKey !== undefined) {
+        if (FS.lookupCacheSize >= FS.LOOKUP_CACHE_MAX_SIZE) FS.clearLookupCache();
+        FS.lookupCache[cacheKey] = { path: current_path, node: current };
+        ++FS.lookupCacheSize;
+      }
       return { path: current_path, node: current };
     },
     getPath: function(node) {
@@ -153,6 +180,7 @@ mergeInto(LibraryManager.library, {
       FS.nameTable[hash] = node;
     },
     hashRemoveNode: function(node) {
+      FS.clearLookupCache();
       var hash = FS.hashName(node.parent.id, node.name);
       if (FS.nameTable[hash] === node) {
         FS.nameTable[hash] = node.name_next;
@@ -560,6 +588,7 @@ mergeInto(LibraryManager.library, {
       mountRoot.mount = mount;
       mount.root = mountRoot;
 
+      FS.clearLookupCache();
       if (root) {
         FS.root = mountRoot;
       } else if (node) {
@@ -586,6 +615,11 @@ mergeInto(LibraryManager.library, {
       var mount = node.mounted;
       var mounts = FS.getMounts(mount);
 
+      // let the file systems release what they hold open
+      mounts.forEach(function (m) {
+        if (m.type.unmount) m.type.unmount(m);
+      });
+
       Object.keys(FS.nameTable).forEach(function (hash) {
         var current = FS.nameTable[hash];
 
@@ -602,6 +636,7 @@ mergeInto(LibraryManager.library, {
 
       // no longer a mountpoint
       node.mounted = null;
+      FS.clearLookupCache();
 
       // remove this mount from the child mounts
       var idx = node.mount.mounts.indexOf(mount);
@@ -884,6 +919,7 @@ mergeInto(LibraryManager.library, {
       if (!node.node_ops.setattr) {
         throw new FS.ErrnoError(ERRNO_CODES.EPERM);
       }
+      FS.clearLookupCache();
       node.node_ops.setattr(node, {
         mode: (mode & {{{ cDefine('S_IALLUGO') }}}) | (node.mode & ~{{{ cDefine('S_IALLUGO') }}}),
         timestamp: Date.now()
@@ -1151,7 +1187,8 @@ mergeInto(LibraryManager.library, {
       }
       return bytesWritten;
     },
-    allocate: function(stream, offset, length) {
+    // If keepSize is set, the file size does not change, and the space is only reserved for later writes.
+    allocate: function(stream, offset, length, keepSize) {
       if (offset < 0 || length <= 0) {
         throw new FS.ErrnoError(ERRNO_CODES.EINVAL);
       }
@@ -1164,7 +1201,7 @@ mergeInto(LibraryManager.library, {
       if (!stream.stream_ops.allocate) {
         throw new FS.ErrnoError(ERRNO_CODES.EOPNOTSUPP);
       }
-      stream.stream_ops.allocate(stream, offset, length);
+      stream.stream_ops.allocate(stream, offset, length, keepSize);
     },
     mmap: function(stream, buffer, offset, length, position, prot, flags) {
       // TODO if PROT is PROT_WRITE, make sure we have write access
@@ -1401,6 +1438,9 @@ mergeInto(LibraryManager.library, {
 #endif
 #if __EMSCRIPTEN_HAS_workerfs_js__
         'WORKERFS': WORKERFS,
+#endif
+#if __EMSCRIPTEN_HAS_opfs_js__
+        'OPFS': OPFS,
 #endif
       };
     },
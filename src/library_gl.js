@@ -67,6 +67,9 @@ var LibraryGL = {
 
     packAlignment: 4,   // default alignment is 4 bytes
     unpackAlignment: 4, // default alignment is 4 bytes
+#if USE_WEBGL2 && GL_PBO_UPLOAD_THRESHOLD
+    unpackStateChanged: false, // Whether a pixel unpack parameter that stops uploads from being staged has been set, see emscriptenWebGLStageTexUpload
+#endif
 
     init: function() {
 #if USES_GL_EMULATION
@@ -105,6 +108,22 @@ var LibraryGL = {
     miniTempBuffer: null,
     miniTempBufferViews: [0], // index i has the view of size i+1
 
+    // Views of the heap for uniform data that is not copied to the mini temp buffer, one per uniform location and type of
+    // heap. A view is reused for as long as the data stays at the same address with the same length, so that uploading
+    // the same uniform array each frame does not create a new view each time. Memory growth replaces the heap, and the
+    // views of the old one are recreated on their next use.
+    uniformHeapViewsF32: [],
+    uniformHeapViews32: [],
+    uniformHeapViewsU32: [],
+
+    getUniformHeapView: function(views, heap, location, ptr, length) {
+      var view = views[location];
+      if (!view || view.buffer !== heap.buffer || view.byteOffset !== ptr || view.length !== length) {
+        view = views[location] = heap.subarray(ptr>>2, (ptr>>2)+length);
+      }
+      return view;
+    },
+
 #if USES_GL_EMULATION
     // When user GL code wants to render from client-side memory, we need to upload the vertex data to a temp VBO
     // for rendering. Maintain a set of temp VBOs that are created-on-demand to appropriate sizes, and never destroyed.
@@ -268,6 +287,70 @@ var LibraryGL = {
     },
 #endif
 
+#if GL_PROGRAM_CACHE
+    // Identifies a set of attribute bindings, given as an object from attribute name to location.
+    attribBindingsKey: function(bindings) {
+      return Object.keys(bindings).sort().map(function(name) { return name + '=' + bindings[name]; }).join(',');
+    },
+
+    // Identifies a program by the sources of its shaders and its attribute bindings.
+    programKey: function(vertexSource, fragmentSource, bindings) {
+      return vertexSource + '\0' + fragmentSource + '\0' + GL.attribBindingsKey(bindings);
+    },
+
+    // Compiles and links a program in the current context without waiting for the result, for glCompileShader() and
+    // glLinkProgram() to take over later. The browser does the work in the background until something asks for the
+    // status or the log of the shaders or the program.
+    prefetchProgram: function(vertexSource, fragmentSource, attribs) {
+      var program = GLctx.createProgram();
+      var types = [0x8B31 /*GL_VERTEX_SHADER*/, 0x8B30 /*GL_FRAGMENT_SHADER*/];
+      var sources = [vertexSource, fragmentSource];
+      var shaders = [];
+      for (var i = 0; i < 2; ++i) {
+        var shader = shaders[i] = GLctx.createShader(types[i]);
+        GLctx.shaderSource(shader, sources[i]);
+        GLctx.compileShader(shader);
+        GLctx.attachShader(program, shader);
+        var key = types[i] + sources[i];
+        (GL.currentContext.prefetchedShaders[key] = GL.currentContext.prefetchedShaders[key] || []).push(shader);
+      }
+      var bindings = {};
+      for (var i = 0; i < attribs.length; ++i) {
+        GLctx.bindAttribLocation(program, i, attribs[i]);
+        bindings[attribs[i]] = i;
+      }
+      GLctx.linkProgram(program);
+      var key = GL.programKey(vertexSource, fragmentSource, bindings);
+      (GL.currentContext.prefetchedPrograms[key] = GL.currentContext.prefetchedPrograms[key] || []).push({ program: program, shaders: shaders });
+    },
+
+    // If the given program has never been linked, and a program with the same shader sources and attribute bindings has
+    // been prefetched, replaces it with the prefetched program, which is linked already. Returns whether it did.
+    takeOverPrefetchedProgram: function(program) {
+      var p = GL.programs[program];
+      if (GL.programInfos[program]) return false; // Linked before, and maybe in use.
+      var attached = GLctx.getAttachedShaders(p);
+      if (!attached || attached.length != 2) return false;
+      var sources = {};
+      attached.forEach(function(shader) {
+        sources[GLctx.getShaderParameter(shader, 0x8B4F /*GL_SHADER_TYPE*/)] = GLctx.getShaderSource(shader);
+      });
+      var prefetched = GL.currentContext.prefetchedPrograms[GL.programKey(sources[0x8B31], sources[0x8B30], p.attribBindings || {})];
+      if (!prefetched || !prefetched.length) return false;
+      var entry = prefetched.pop();
+      // The prefetched program keeps working as linked when its shaders are swapped for the ones the application
+      // attached, which it may ask for with glGetAttachedShaders(). Its own shaders may still be taken over by
+      // glCompileShader(), so they are not deleted.
+      entry.shaders.forEach(function(shader) { GLctx.detachShader(entry.program, shader); });
+      attached.forEach(function(shader) { GLctx.attachShader(entry.program, shader); });
+      GLctx.deleteProgram(p);
+      p.name = 0;
+      entry.program.name = program;
+      GL.programs[program] = entry.program;
+      return true;
+    },
+#endif
+
     getSource: function(shader, count, string, length) {
       var source = '';
       for (var i = 0; i < count; ++i) {
@@ -331,26 +414,61 @@ var LibraryGL = {
 
     usedTempBuffers: [],
 
+    // The client-side vertex data of each draw is appended to a streaming buffer of the current context, which must be
+    // bound to GL_ARRAY_BUFFER. When the buffer is full, its storage is orphaned with bufferData(), so that uploading
+    // more data does not have to wait for the draws that still read from the old storage. Returns the offset in the
+    // buffer that HEAPU8[begin, end) was uploaded to.
+    streamClientVertexData: function streamClientVertexData(begin, end) {
+      var context = GL.currentContext;
+      var size = end - begin;
+      var offset = (context.clientVertexStreamOffset + 3) & ~3; // Keeps the alignment of the data, for vertexAttribPointer().
+      if (offset + size > context.clientVertexStreamSize) {
+        context.clientVertexStreamSize = Math.max(context.clientVertexStreamSize, GL.MAX_TEMP_BUFFER_SIZE, size);
+        GLctx.bufferData(GLctx.ARRAY_BUFFER, context.clientVertexStreamSize, GLctx.STREAM_DRAW);
+        offset = 0;
+      }
+      GLctx.bufferSubData(GLctx.ARRAY_BUFFER, offset, HEAPU8.subarray(begin, end));
+      context.clientVertexStreamOffset = offset + size;
+      return offset;
+    },
+
     preDrawHandleClientVertexAttribBindings: function preDrawHandleClientVertexAttribBindings(count) {
       GL.resetBufferBinding = false;
 
-      // TODO: initial pass to detect ranges we need to upload, might not need an upload per attrib
-      for (var i = 0; i < GL.currentContext.maxVertexAttribs; ++i) {
-        var cb = GL.currentContext.clientBuffers[i];
+      var context = GL.currentContext;
+      // Find the range of memory that the client-side attributes read from. When they are interleaved, or close enough
+      // together, the whole range is uploaded at once, instead of once per attribute.
+      var begin = -1, end = 0, total = 0;
+      for (var i = 0; i < context.maxVertexAttribs; ++i) {
+        var cb = context.clientBuffers[i];
         if (!cb.clientside || !cb.enabled) continue;
+        var size = GL.calcBufLength(cb.size, cb.type, cb.stride, count);
+        if (begin < 0 || cb.ptr < begin) begin = cb.ptr;
+        end = Math.max(end, cb.ptr + size);
+        total += size;
+      }
+      if (begin < 0) return;
 
-        GL.resetBufferBinding = true;
+      GL.resetBufferBinding = true;
+      if (!context.clientVertexStream) context.clientVertexStream = GLctx.createBuffer();
+      GLctx.bindBuffer(GLctx.ARRAY_BUFFER, context.clientVertexStream);
 
-        var size = GL.calcBufLength(cb.size, cb.type, cb.stride, count);
-        var buf = GL.getTempVertexBuffer(size);
-        GLctx.bindBuffer(GLctx.ARRAY_BUFFER, buf);
-        GLctx.bufferSubData(GLctx.ARRAY_BUFFER,
-                                 0,
-                                 HEAPU8.subarray(cb.ptr, cb.ptr + size));
+      begin &= ~3; // So that the attributes keep the alignment of their pointers within the upload.
+      var coalesce = end - begin <= 2 * total;
+      var rangeOffset = coalesce ? GL.streamClientVertexData(begin, end) - begin : 0;
+      for (var i = 0; i < context.maxVertexAttribs; ++i) {
+        var cb = context.clientBuffers[i];
+        if (!cb.clientside || !cb.enabled) continue;
+
+        var offset = cb.ptr + rangeOffset;
+        // WebGL requires the offset to be a multiple of the size of the type, which unaligned pointers are not.
+        if (!coalesce || offset % (GL.byteSizeByType[cb.type - GL.byteSizeByTypeRoot] || 4)) {
+          offset = GL.streamClientVertexData(cb.ptr, cb.ptr + GL.calcBufLength(cb.size, cb.type, cb.stride, count));
+        }
 #if GL_ASSERTIONS
-        GL.validateVertexAttribPointer(cb.size, cb.type, cb.stride, 0);
+        GL.validateVertexAttribPointer(cb.size, cb.type, cb.stride, offset);
 #endif
-        GLctx.vertexAttribPointer(i, cb.size, cb.type, cb.normalized, cb.stride, 0);
+        GLctx.vertexAttribPointer(i, cb.size, cb.type, cb.normalized, cb.stride, offset);
       }
     },
 
@@ -551,6 +669,28 @@ var LibraryGL = {
         GLctx: ctx
       };
 
+#if GL_STATE_CACHE
+      // The state that the application last set through this context, so that calls which would not change it can be
+      // dropped before they reach WebGL. An undefined entry means the state is not known, and the next call goes through.
+      context.stateCache = {
+        buffers: {}, // Bound buffer of each target.
+        program: undefined,
+        activeTexture: 0x84C0 /*GL_TEXTURE0*/,
+        textures: [], // Bound texture of each target, for each texture unit.
+        caps: {}, // Whether each capability is enabled.
+        uniforms: {} // Value of each uniform location set with glUniform1i() or glUniform1f().
+      };
+      // The number of calls that were dropped, see emscripten_webgl_get_redundant_state_changes().
+      context.redundantStateChanges = 0;
+#endif
+#if GL_PROGRAM_CACHE
+      // Programs that emscripten_webgl_prefetch_program() has compiled and linked ahead of time, and that glLinkProgram()
+      // has not taken over yet, by GL.programKey(), and their shaders that glCompileShader() has not taken over yet, by
+      // type and source.
+      context.prefetchedPrograms = {};
+      context.prefetchedShaders = {};
+#endif
+
 #if USE_WEBGL2
       // BUG: Workaround Chrome WebGL 2 issue: the first shipped versions of WebGL 2 in Chrome did not actually implement the new WebGL 2 functions.
       //      Those are supported only in Chrome 58 and newer.
@@ -609,6 +749,9 @@ var LibraryGL = {
       }
 
       GL.generateTempBuffers(false, context);
+      context.clientVertexStream = null; // Created on-demand by streamClientVertexData()
+      context.clientVertexStreamSize = 0;
+      context.clientVertexStreamOffset = 0;
 #endif
 
       // Detect the presence of a few extensions manually, this GL interop layer itself will need to know if they exist.
@@ -642,6 +785,10 @@ var LibraryGL = {
       }
 
       GLctx.disjointTimerQueryExt = GLctx.getExtension("EXT_disjoint_timer_query");
+#if GL_PROGRAM_CACHE
+      // Lets emscripten_webgl_get_pending_program_prefetches() ask whether a program has been linked without waiting for it.
+      GLctx.parallelShaderCompileExt = GLctx.getExtension("KHR_parallel_shader_compile");
+#endif
 
       // These are the 'safe' feature-enabling extensions that don't add any performance impact related to e.g. debugging, and
       // should be enabled by default so that client GLES2/GL code will not need to go through extra hoops to get its stuff working.
@@ -741,6 +888,13 @@ var LibraryGL = {
     } else if (pname == 0x0cf5 /* GL_UNPACK_ALIGNMENT */) {
       GL.unpackAlignment = param;
     }
+#if USE_WEBGL2 && GL_PBO_UPLOAD_THRESHOLD
+    // Row lengths and skips change how many bytes an upload reads, and WebGL does not allow flipping or premultiplying uploads from buffers.
+    else if (param && (pname == 0x0CF2 /* GL_UNPACK_ROW_LENGTH */ || pname == 0x0CF3 /* GL_UNPACK_SKIP_ROWS */ || pname == 0x0CF4 /* GL_UNPACK_SKIP_PIXELS */
+          || pname == 0x9240 /* UNPACK_FLIP_Y_WEBGL */ || pname == 0x9241 /* UNPACK_PREMULTIPLY_ALPHA_WEBGL */)) {
+      GL.unpackStateChanged = true;
+    }
+#endif
     GLctx.pixelStorei(pname, param);
   },
 
@@ -1047,6 +1201,14 @@ var LibraryGL = {
       GLctx.deleteTexture(texture);
       texture.name = 0;
       GL.textures[id] = null;
+#if GL_STATE_CACHE
+      // Deleting a texture unbinds it from every unit of the current context.
+      GL.currentContext.stateCache.textures.forEach(function(unit) {
+        for (var target in unit) {
+          if (unit[target] === id) unit[target] = 0;
+        }
+      });
+#endif
     }
   },
 
@@ -1307,10 +1469,31 @@ var LibraryGL = {
   },
 #endif
 
+#if USE_WEBGL2 && GL_PBO_UPLOAD_THRESHOLD
+  // Stages a large texture upload from memory through a pixel unpack buffer of the context: the pixels are copied into the
+  // buffer, and the texture is filled from it on the GPU, where it does not have to wait for the draws that use the texture to
+  // finish. Returns true with the buffer bound if the caller should upload from offset 0 of it, and then unbind it.
+  $emscriptenWebGLStageTexUpload__deps: ['$emscriptenWebGLGetTexPixelData'],
+  $emscriptenWebGLStageTexUpload: function(type, format, width, height, pixels, internalFormat) {
+    // No pixel is larger than 16 bytes, so most uploads are ruled out without computing their size.
+    if (width * height * 16 < {{{ GL_PBO_UPLOAD_THRESHOLD }}} || GL.unpackStateChanged) return false;
+    var pixelData = emscriptenWebGLGetTexPixelData(type, format, width, height, pixels, internalFormat);
+    if (!pixelData || pixelData.byteLength < {{{ GL_PBO_UPLOAD_THRESHOLD }}}) return false;
+    var context = GL.currentContext;
+    if (!context.stagingUnpackBuffer) context.stagingUnpackBuffer = GLctx.createBuffer();
+    GLctx.bindBuffer(0x88EC /*GL_PIXEL_UNPACK_BUFFER*/, context.stagingUnpackBuffer);
+    GLctx.bufferData(0x88EC /*GL_PIXEL_UNPACK_BUFFER*/, pixelData, 0x88E0 /*GL_STREAM_DRAW*/); // Orphans the previous contents, which may still be in use.
+    return true;
+  },
+
+#endif
   glTexImage2D__sig: 'viiiiiiiii',
   glTexImage2D__deps: ['$emscriptenWebGLGetTexPixelData'
 #if USE_WEBGL2
                        , '$emscriptenWebGLGetHeapForType', '$emscriptenWebGLGetShiftForType'
+#if GL_PBO_UPLOAD_THRESHOLD
+                       , '$emscriptenWebGLStageTexUpload'
+#endif
 #endif
   ],
   glTexImage2D: function(target, level, internalFormat, width, height, border, format, type, pixels) {
@@ -1338,6 +1521,13 @@ var LibraryGL = {
       if (GLctx.currentPixelUnpackBufferBinding) {
         GLctx.texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
       } else if (pixels != 0) {
+#if GL_PBO_UPLOAD_THRESHOLD
+        if (emscriptenWebGLStageTexUpload(type, format, width, height, pixels, internalFormat)) {
+          GLctx.texImage2D(target, level, internalFormat, width, height, border, format, type, 0);
+          GLctx.bindBuffer(0x88EC /*GL_PIXEL_UNPACK_BUFFER*/, null);
+          return;
+        }
+#endif
         GLctx.texImage2D(target, level, internalFormat, width, height, border, format, type, emscriptenWebGLGetHeapForType(type), pixels >> emscriptenWebGLGetShiftForType(type));
       } else {
         GLctx.texImage2D(target, level, internalFormat, width, height, border, format, type, null);
@@ -1355,6 +1545,9 @@ var LibraryGL = {
   glTexSubImage2D__deps: ['$emscriptenWebGLGetTexPixelData'
 #if USE_WEBGL2
                           , '$emscriptenWebGLGetHeapForType', '$emscriptenWebGLGetShiftForType'
+#if GL_PBO_UPLOAD_THRESHOLD
+                          , '$emscriptenWebGLStageTexUpload'
+#endif
 #endif
   ],
   glTexSubImage2D: function(target, level, xoffset, yoffset, width, height, format, type, pixels) {
@@ -1372,6 +1565,13 @@ var LibraryGL = {
       if (GLctx.currentPixelUnpackBufferBinding) {
         GLctx.texSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
       } else if (pixels != 0) {
+#if GL_PBO_UPLOAD_THRESHOLD
+        if (emscriptenWebGLStageTexUpload(type, format, width, height, pixels, 0)) {
+          GLctx.texSubImage2D(target, level, xoffset, yoffset, width, height, format, type, 0);
+          GLctx.bindBuffer(0x88EC /*GL_PIXEL_UNPACK_BUFFER*/, null);
+          return;
+        }
+#endif
         GLctx.texSubImage2D(target, level, xoffset, yoffset, width, height, format, type, emscriptenWebGLGetHeapForType(type), pixels >> emscriptenWebGLGetShiftForType(type));
       } else {
         GLctx.texSubImage2D(target, level, xoffset, yoffset, width, height, format, type, null);
@@ -1416,6 +1616,15 @@ var LibraryGL = {
   glBindTexture: function(target, texture) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.textures, texture, 'glBindTexture', 'texture');
+#endif
+#if GL_STATE_CACHE
+    var cache = GL.currentContext.stateCache;
+    var unit = cache.textures[cache.activeTexture] || (cache.textures[cache.activeTexture] = {});
+    if (unit[target] === texture) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    unit[target] = texture;
 #endif
     GLctx.bindTexture(target, texture ? GL.textures[texture] : null);
   },
@@ -1502,6 +1711,12 @@ var LibraryGL = {
 
       if (id == GL.currArrayBuffer) GL.currArrayBuffer = 0;
       if (id == GL.currElementArrayBuffer) GL.currElementArrayBuffer = 0;
+#if GL_STATE_CACHE
+      var buffers = GL.currentContext.stateCache.buffers;
+      for (var target in buffers) {
+        if (buffers[target] === id) buffers[target] = 0;
+      }
+#endif
     }
   },
 
@@ -2137,6 +2352,9 @@ var LibraryGL = {
       GL.recordError(0x0502 /* GL_INVALID_OPERATION */);
       return;
     }
+#if GL_STATE_CACHE
+    GL.currentContext.stateCache.buffers[0x8C8E /*GL_TRANSFORM_FEEDBACK_BUFFER*/] = undefined;
+#endif
     GLctx['bindTransformFeedback'](target, transformFeedback);
   },
 
@@ -2253,6 +2471,10 @@ var LibraryGL = {
     GL.validateGLObjectID(GL.buffers, buffer, 'glBindBufferBase', 'buffer');
 #endif
     var bufferObj = buffer ? GL.buffers[buffer] : null;
+#if GL_STATE_CACHE
+    // Also binds the buffer to the generic binding point of the target.
+    GL.currentContext.stateCache.buffers[target] = buffer;
+#endif
     GLctx['bindBufferBase'](target, index, bufferObj);
   },
 
@@ -2262,6 +2484,10 @@ var LibraryGL = {
     GL.validateGLObjectID(GL.buffers, buffer, 'glBindBufferRange', 'buffer');
 #endif
     var bufferObj = buffer ? GL.buffers[buffer] : null;
+#if GL_STATE_CACHE
+    // Also binds the buffer to the generic binding point of the target.
+    GL.currentContext.stateCache.buffers[target] = buffer;
+#endif
     GLctx['bindBufferRange'](target, index, bufferObj, offset, ptrsize);
   },
 
@@ -2808,6 +3034,14 @@ var LibraryGL = {
   glUniform1f: function(location, v0) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.uniforms, location, 'glUniform1f', 'location');
+#endif
+#if GL_STATE_CACHE
+    var uniforms = GL.currentContext.stateCache.uniforms;
+    if (uniforms[location] === v0) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    uniforms[location] = v0;
 #endif
     GLctx.uniform1f(GL.uniforms[location], v0);
   },
@@ -2840,6 +3074,14 @@ var LibraryGL = {
   glUniform1i: function(location, v0) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.uniforms, location, 'glUniform1i', 'location');
+#endif
+#if GL_STATE_CACHE
+    var uniforms = GL.currentContext.stateCache.uniforms;
+    if (uniforms[location] === v0) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    uniforms[location] = v0;
 #endif
     GLctx.uniform1i(GL.uniforms[location], v0);
   },
@@ -2874,6 +3116,10 @@ var LibraryGL = {
     GL.validateGLObjectID(GL.uniforms, location, 'glUniform1iv', 'location');
     assert((value & 3) == 0, 'Pointer to integer data passed to glUniform1iv must be aligned to four bytes!');
 #endif
+#if GL_STATE_CACHE
+    // The elements of a uniform array have consecutive locations.
+    for (var i = 0; i < count; ++i) GL.currentContext.stateCache.uniforms[location+i] = undefined;
+#endif
 
 #if USE_WEBGL2
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
@@ -2882,7 +3128,7 @@ var LibraryGL = {
     }
 #endif
 
-    GLctx.uniform1iv(GL.uniforms[location], {{{ makeHEAPView('32', 'value', 'value+count*4') }}});
+    GLctx.uniform1iv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViews32, HEAP32, location, value, count));
   },
 
   glUniform2iv__sig: 'viii',
@@ -2899,7 +3145,7 @@ var LibraryGL = {
     }
 #endif
 
-    GLctx.uniform2iv(GL.uniforms[location], {{{ makeHEAPView('32', 'value', 'value+count*8') }}});
+    GLctx.uniform2iv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViews32, HEAP32, location, value, count*2));
   },
 
   glUniform3iv__sig: 'viii',
@@ -2916,7 +3162,7 @@ var LibraryGL = {
     }
 #endif
 
-    GLctx.uniform3iv(GL.uniforms[location], {{{ makeHEAPView('32', 'value', 'value+count*12') }}});
+    GLctx.uniform3iv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViews32, HEAP32, location, value, count*3));
   },
 
   glUniform4iv__sig: 'viii',
@@ -2933,7 +3179,7 @@ var LibraryGL = {
     }
 #endif
 
-    GLctx.uniform4iv(GL.uniforms[location], {{{ makeHEAPView('32', 'value', 'value+count*16') }}});
+    GLctx.uniform4iv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViews32, HEAP32, location, value, count*4));
   },
 
   glUniform1fv__sig: 'viii',
@@ -2942,6 +3188,10 @@ var LibraryGL = {
     GL.validateGLObjectID(GL.uniforms, location, 'glUniform1fv', 'location');
     assert((value & 3) == 0, 'Pointer to float data passed to glUniform1fv must be aligned to four bytes!');
 #endif
+#if GL_STATE_CACHE
+    // The elements of a uniform array have consecutive locations.
+    for (var i = 0; i < count; ++i) GL.currentContext.stateCache.uniforms[location+i] = undefined;
+#endif
 
 #if USE_WEBGL2
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
@@ -2958,7 +3208,7 @@ var LibraryGL = {
         view[i] = {{{ makeGetValue('value', '4*i', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*4') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count);
     }
     GLctx.uniform1fv(GL.uniforms[location], view);
   },
@@ -2986,7 +3236,7 @@ var LibraryGL = {
         view[i+1] = {{{ makeGetValue('value', '4*i+4', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*8') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*2);
     }
     GLctx.uniform2fv(GL.uniforms[location], view);
   },
@@ -3015,7 +3265,7 @@ var LibraryGL = {
         view[i+2] = {{{ makeGetValue('value', '4*i+8', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*12') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*3);
     }
     GLctx.uniform3fv(GL.uniforms[location], view);
   },
@@ -3045,7 +3295,7 @@ var LibraryGL = {
         view[i+3] = {{{ makeGetValue('value', '4*i+12', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*16') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*4);
     }
     GLctx.uniform4fv(GL.uniforms[location], view);
   },
@@ -3092,7 +3342,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniform1uiv(GL.uniforms[location], HEAPU32, value>>2, count);
     } else {
-      GLctx.uniform1uiv(GL.uniforms[location], {{{ makeHEAPView('U32', 'value', 'value+count*4') }}});
+      GLctx.uniform1uiv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViewsU32, HEAPU32, location, value, count));
     }
   },
 
@@ -3105,7 +3355,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniform2uiv(GL.uniforms[location], HEAPU32, value>>2, count*2);
     } else {
-      GLctx.uniform2uiv(GL.uniforms[location], {{{ makeHEAPView('U32', 'value', 'value+count*8') }}});
+      GLctx.uniform2uiv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViewsU32, HEAPU32, location, value, count*2));
     }
   },
 
@@ -3118,7 +3368,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniform3uiv(GL.uniforms[location], HEAPU32, value>>2, count*3);
     } else {
-      GLctx.uniform3uiv(GL.uniforms[location], {{{ makeHEAPView('U32', 'value', 'value+count*12') }}});
+      GLctx.uniform3uiv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViewsU32, HEAPU32, location, value, count*3));
     }
   },
 
@@ -3131,7 +3381,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniform4uiv(GL.uniforms[location], HEAPU32, value>>2, count*4);
     } else {
-      GLctx.uniform4uiv(GL.uniforms[location], {{{ makeHEAPView('U32', 'value', 'value+count*16') }}});
+      GLctx.uniform4uiv(GL.uniforms[location], GL.getUniformHeapView(GL.uniformHeapViewsU32, HEAPU32, location, value, count*4));
     }
   },
 #endif
@@ -3161,7 +3411,7 @@ var LibraryGL = {
         view[i+3] = {{{ makeGetValue('value', '4*i+12', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*16') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*4);
     }
     GLctx.uniformMatrix2fv(GL.uniforms[location], !!transpose, view);
   },
@@ -3196,7 +3446,7 @@ var LibraryGL = {
         view[i+8] = {{{ makeGetValue('value', '4*i+32', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*36') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*9);
     }
     GLctx.uniformMatrix3fv(GL.uniforms[location], !!transpose, view);
   },
@@ -3238,7 +3488,7 @@ var LibraryGL = {
         view[i+15] = {{{ makeGetValue('value', '4*i+60', 'float') }}};
       }
     } else {
-      view = {{{ makeHEAPView('F32', 'value', 'value+count*64') }}};
+      view = GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*16);
     }
     GLctx.uniformMatrix4fv(GL.uniforms[location], !!transpose, view);
   },
@@ -3253,7 +3503,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix2x3fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*6);
     } else {
-      GLctx.uniformMatrix2x3fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*24') }}});
+      GLctx.uniformMatrix2x3fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*6));
     }
   },
 
@@ -3266,7 +3516,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix3x2fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*6);
     } else {
-      GLctx.uniformMatrix3x2fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*24') }}});
+      GLctx.uniformMatrix3x2fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*6));
     }
   },
 
@@ -3279,7 +3529,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix2x4fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*8);
     } else {
-      GLctx.uniformMatrix2x4fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*32') }}});
+      GLctx.uniformMatrix2x4fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*8));
     }
   },
 
@@ -3292,7 +3542,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix4x2fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*8);
     } else {
-      GLctx.uniformMatrix4x2fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*32') }}});
+      GLctx.uniformMatrix4x2fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*8));
     }
   },
 
@@ -3305,7 +3555,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix3x4fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*12);
     } else {
-      GLctx.uniformMatrix3x4fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*48') }}});
+      GLctx.uniformMatrix3x4fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*12));
     }
   },
 
@@ -3318,7 +3568,7 @@ var LibraryGL = {
     if (GL.currentContext.supportsWebGL2EntryPoints) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
       GLctx.uniformMatrix4x3fv(GL.uniforms[location], !!transpose, HEAPF32, value>>2, count*12);
     } else {
-      GLctx.uniformMatrix4x3fv(GL.uniforms[location], !!transpose, {{{ makeHEAPView('F32', 'value', 'value+count*48') }}});
+      GLctx.uniformMatrix4x3fv(GL.uniforms[location], !!transpose, GL.getUniformHeapView(GL.uniformHeapViewsF32, HEAPF32, location, value, count*12));
     }
   },
 #endif
@@ -3327,6 +3577,14 @@ var LibraryGL = {
   glBindBuffer: function(target, buffer) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.buffers, buffer, 'glBindBuffer', 'buffer');
+#endif
+#if GL_STATE_CACHE
+    var buffers = GL.currentContext.stateCache.buffers;
+    if (buffers[target] === buffer) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    buffers[target] = buffer;
 #endif
     var bufferObj = buffer ? GL.buffers[buffer] : null;
 
@@ -3554,6 +3812,17 @@ var LibraryGL = {
   glCompileShader: function(shader) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.shaders, shader, 'glCompileShader', 'shader');
+#endif
+#if GL_PROGRAM_CACHE
+    // Take over a shader with the same type and source that emscripten_webgl_prefetch_program() has compiled already,
+    // unless this one is attached to a program, which would keep using it.
+    var s = GL.shaders[shader];
+    var prefetched = !s.attached && GL.currentContext.prefetchedShaders[GLctx.getShaderParameter(s, 0x8B4F /*GL_SHADER_TYPE*/) + GLctx.getShaderSource(s)];
+    if (prefetched && prefetched.length) {
+      GLctx.deleteShader(s);
+      GL.shaders[shader] = prefetched.pop();
+      return;
+    }
 #endif
     GLctx.compileShader(GL.shaders[shader]);
 #if GL_DEBUG
@@ -3697,6 +3966,10 @@ var LibraryGL = {
     program.name = 0;
     GL.programs[id] = null;
     GL.programInfos[id] = null;
+#if GL_STATE_CACHE
+    // A program that is in use stays in use after it was deleted, but its name no longer refers to it.
+    if (GL.currentContext.stateCache.program === id) GL.currentContext.stateCache.program = undefined;
+#endif
   },
 
   glAttachShader__sig: 'vii',
@@ -3704,6 +3977,9 @@ var LibraryGL = {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.programs, program, 'glAttachShader', 'program');
     GL.validateGLObjectID(GL.shaders, shader, 'glAttachShader', 'shader');
+#endif
+#if GL_PROGRAM_CACHE
+    GL.shaders[shader].attached = true;
 #endif
     GLctx.attachShader(GL.programs[program],
                             GL.shaders[shader]);
@@ -3731,7 +4007,13 @@ var LibraryGL = {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.programs, program, 'glLinkProgram', 'program');
 #endif
+#if GL_PROGRAM_CACHE
+    if (!GL.takeOverPrefetchedProgram(program)) {
+      GLctx.linkProgram(GL.programs[program]);
+    }
+#else
     GLctx.linkProgram(GL.programs[program]);
+#endif
 #if GL_DEBUG
     var log = (GLctx.getProgramInfoLog(GL.programs[program]) || '').trim();
     if (log) console.error('glLinkProgram: ' + log);
@@ -3760,6 +4042,14 @@ var LibraryGL = {
   glUseProgram: function(program) {
 #if GL_ASSERTIONS
     GL.validateGLObjectID(GL.programs, program, 'glUseProgram', 'program');
+#endif
+#if GL_STATE_CACHE
+    var cache = GL.currentContext.stateCache;
+    if (cache.program === program) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    cache.program = program;
 #endif
     GLctx.useProgram(program ? GL.programs[program] : null);
   },
@@ -3811,6 +4101,10 @@ var LibraryGL = {
     GL.validateGLObjectID(GL.programs, program, 'glBindAttribLocation', 'program');
 #endif
     name = Pointer_stringify(name);
+#if GL_PROGRAM_CACHE
+    var p = GL.programs[program];
+    (p.attribBindings = p.attribBindings || {})[name] = index;
+#endif
     GLctx.bindAttribLocation(GL.programs[program], index, name);
   },
 
@@ -3940,6 +4234,10 @@ var LibraryGL = {
       GLctx['deleteVertexArray'](GL.vaos[id]);
       GL.vaos[id] = null;
     }
+#if GL_STATE_CACHE
+    // Deleting the bound vertex array object binds the default one, with its own element array buffer binding.
+    if (n) GL.currentContext.stateCache.buffers[0x8893 /*GL_ELEMENT_ARRAY_BUFFER*/] = undefined;
+#endif
 #endif
   },
 
@@ -3956,6 +4254,10 @@ var LibraryGL = {
 #endif
     GLctx['bindVertexArray'](GL.vaos[vao]);
 #endif
+#if GL_STATE_CACHE
+    // The element array buffer binding is part of the vertex array object.
+    GL.currentContext.stateCache.buffers[0x8893 /*GL_ELEMENT_ARRAY_BUFFER*/] = undefined;
+#endif
 #if USES_GL_EMULATION
     var ibo = GLctx.getParameter(GLctx.ELEMENT_ARRAY_BUFFER_BINDING);
     GL.currElementArrayBuffer = ibo ? (ibo.name | 0) : 0;
@@ -4052,6 +4354,7 @@ var LibraryGL = {
 
       var glEnable = _glEnable;
       _glEnable = _emscripten_glEnable = function _glEnable(cap) {
+        GLImmediate.flushBatch();
         // Clean up the renderer on any change to the rendering state. The optimization of
         // skipping renderer setup is aimed at the case of multiple glDraw* right after each other
         if (GLImmediate.lastRenderer) GLImmediate.lastRenderer.cleanup();
@@ -4078,6 +4381,7 @@ var LibraryGL = {
 
       var glDisable = _glDisable;
       _glDisable = _emscripten_glDisable = function _glDisable(cap) {
+        GLImmediate.flushBatch();
         if (GLImmediate.lastRenderer) GLImmediate.lastRenderer.cleanup();
         if (cap == 0x0B60 /* GL_FOG */) {
           if (GLEmulation.fogEnabled != false) {
@@ -4389,6 +4693,7 @@ var LibraryGL = {
 
       var glUseProgram = _glUseProgram;
       _glUseProgram = _emscripten_glUseProgram = function _glUseProgram(program) {
+        GLImmediate.flushBatch();
 #if GL_DEBUG
         if (GL.debug) {
           Module.printErr('[using program with shaders]');
@@ -4411,6 +4716,7 @@ var LibraryGL = {
 
       var glDeleteProgram = _glDeleteProgram;
       _glDeleteProgram = _emscripten_glDeleteProgram = function _glDeleteProgram(program) {
+        GLImmediate.flushBatch();
         glDeleteProgram(program);
         if (program == GL.currProgram) {
           GLImmediate.currentRenderer = null; // This changes the FFP emulation shader program, need to recompute that.
@@ -4430,6 +4736,7 @@ var LibraryGL = {
 
       var glLinkProgram = _glLinkProgram;
       _glLinkProgram = _emscripten_glLinkProgram = function _glLinkProgram(program) {
+        GLImmediate.flushBatch();
         if (!(program in zeroUsedPrograms)) {
           GLctx.bindAttribLocation(GL.programs[program], 0, 'a_position');
         }
@@ -4439,6 +4746,7 @@ var LibraryGL = {
 
       var glBindBuffer = _glBindBuffer;
       _glBindBuffer = _emscripten_glBindBuffer = function _glBindBuffer(target, buffer) {
+        GLImmediate.flushBatch();
         glBindBuffer(target, buffer);
         if (target == GLctx.ARRAY_BUFFER) {
           if (GLEmulation.currentVao) {
@@ -4479,6 +4787,7 @@ var LibraryGL = {
 
       var glHint = _glHint;
       _glHint = _emscripten_glHint = function _glHint(target, mode) {
+        GLImmediate.flushBatch();
         if (target == 0x84EF) { // GL_TEXTURE_COMPRESSION_HINT
           return;
         }
@@ -4488,6 +4797,7 @@ var LibraryGL = {
 
       var glEnableVertexAttribArray = _glEnableVertexAttribArray;
       _glEnableVertexAttribArray = _emscripten_glEnableVertexAttribArray = function _glEnableVertexAttribArray(index) {
+        GLImmediate.flushBatch();
         glEnableVertexAttribArray(index);
         GLEmulation.enabledVertexAttribArrays[index] = 1;
         if (GLEmulation.currentVao) GLEmulation.currentVao.enabledVertexAttribArrays[index] = 1;
@@ -4496,6 +4806,7 @@ var LibraryGL = {
 
       var glDisableVertexAttribArray = _glDisableVertexAttribArray;
       _glDisableVertexAttribArray = _emscripten_glDisableVertexAttribArray = function _glDisableVertexAttribArray(index) {
+        GLImmediate.flushBatch();
         glDisableVertexAttribArray(index);
         delete GLEmulation.enabledVertexAttribArrays[index];
         if (GLEmulation.currentVao) delete GLEmulation.currentVao.enabledVertexAttribArrays[index];
@@ -4504,6 +4815,7 @@ var LibraryGL = {
 
       var glVertexAttribPointer = _glVertexAttribPointer;
       _glVertexAttribPointer = _emscripten_glVertexAttribPointer = function _glVertexAttribPointer(index, size, type, normalized, stride, pointer) {
+        GLImmediate.flushBatch();
         glVertexAttribPointer(index, size, type, normalized, stride, pointer);
         if (GLEmulation.currentVao) { // TODO: avoid object creation here? likely not hot though
           GLEmulation.currentVao.vertexAttribPointers[index] = [index, size, type, normalized, stride, pointer];
@@ -5771,6 +6083,20 @@ var LibraryGL = {
     vertexCounter: 0,
     mode: -1,
 
+    // glBegin()/glEnd() blocks that draw lists of the same primitive, with the same vertex layout, are not drawn one by
+    // one, but collected into a batch that is drawn with a single call. The batch is drawn before any other GL function
+    // runs, as those may change the state that it is drawn with (see the end of this file), and at the latest when the
+    // current JS task is done.
+    batchData: null, // The vertex data of the batch, laid out like tempData.
+    batchVertexCounter: 0, // Like vertexCounter, 0 when there is no batch.
+    batchMode: -1,
+    batchLayout: [], // The stride and the name, size, type and offset of each attribute in the vertex data.
+    batchLayoutScratch: [],
+    batchEnabledClientAttributes: null, // The glBegin()/glEnd() state that the batch is drawn with.
+    batchClientAttributes: null,
+    batchRendererComponents: null,
+    batchFlushScheduled: false,
+
     rendererCache: null,
     rendererComponents: [], // small cache for calls inside glBegin/end. counts how many times the element was seen
     rendererComponentPointer: 0, // next place to start a glBegin/end component
@@ -6347,6 +6673,7 @@ var LibraryGL = {
       // attributes enabled, and we use webgl-friendly modes (no GL_QUADS), then no need
       // for emulation
       _glDrawArrays = _emscripten_glDrawArrays = function _glDrawArrays(mode, first, count) {
+        GLImmediate.flushBatch();
         if (GLImmediate.totalEnabledClientAttributes == 0 && mode <= 6) {
           GLctx.drawArrays(mode, first, count);
           return;
@@ -6364,6 +6691,7 @@ var LibraryGL = {
       {{{ updateExport('glDrawArrays') }}}
 
       _glDrawElements = _emscripten_glDrawElements = function _glDrawElements(mode, count, type, indices, start, end) { // start, end are given if we come from glDrawRangeElements
+        GLImmediate.flushBatch();
         if (GLImmediate.totalEnabledClientAttributes == 0 && mode <= 6 && GL.currElementArrayBuffer) {
           GLctx.drawElements(mode, count, type, indices);
           return;
@@ -6405,6 +6733,7 @@ var LibraryGL = {
 
       var glActiveTexture = _glActiveTexture;
       _glActiveTexture = _emscripten_glActiveTexture = function _glActiveTexture(texture) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_activeTexture(texture);
         glActiveTexture(texture);
       };
@@ -6412,6 +6741,7 @@ var LibraryGL = {
 
       var glEnable = _glEnable;
       _glEnable = _emscripten_glEnable = function _glEnable(cap) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_enable(cap);
         glEnable(cap);
       };
@@ -6419,6 +6749,7 @@ var LibraryGL = {
 
       var glDisable = _glDisable;
       _glDisable = _emscripten_glDisable = function _glDisable(cap) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_disable(cap);
         glDisable(cap);
       };
@@ -6426,6 +6757,7 @@ var LibraryGL = {
 
       var glTexEnvf = (typeof(_glTexEnvf) != 'undefined') ? _glTexEnvf : function(){};
       _glTexEnvf = _emscripten_glTexEnvf = function _glTexEnvf(target, pname, param) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_texEnvf(target, pname, param);
         // Don't call old func, since we are the implementor.
         //glTexEnvf(target, pname, param);
@@ -6434,6 +6766,7 @@ var LibraryGL = {
 
       var glTexEnvi = (typeof(_glTexEnvi) != 'undefined') ? _glTexEnvi : function(){};
       _glTexEnvi = _emscripten_glTexEnvi = function _glTexEnvi(target, pname, param) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_texEnvi(target, pname, param);
         // Don't call old func, since we are the implementor.
         //glTexEnvi(target, pname, param);
@@ -6442,6 +6775,7 @@ var LibraryGL = {
 
       var glTexEnvfv = (typeof(_glTexEnvfv) != 'undefined') ? _glTexEnvfv : function(){};
       _glTexEnvfv = _emscripten_glTexEnvfv = function _glTexEnvfv(target, pname, param) {
+        GLImmediate.flushBatch();
         GLImmediate.TexEnvJIT.hook_texEnvfv(target, pname, param);
         // Don't call old func, since we are the implementor.
         //glTexEnvfv(target, pname, param);
@@ -6520,6 +6854,7 @@ var LibraryGL = {
       GLImmediate.indexData = new Uint16Array(GL.MAX_TEMP_BUFFER_SIZE >> 1);
 
       GLImmediate.vertexDataU8 = new Uint8Array(GLImmediate.tempData.buffer);
+      GLImmediate.batchData = new Float32Array(GL.MAX_TEMP_BUFFER_SIZE >> 2);
 
       GL.generateTempBuffers(true, GL.currentContext);
 
@@ -6721,6 +7056,90 @@ var LibraryGL = {
       renderer.cleanup();
 #endif
 #endif
+    },
+
+    // Draws the glBegin()/glEnd() block that was just ended, or the batch, from its prepared client attributes.
+    drawBeginEnd: function drawBeginEnd() {
+      GLImmediate.firstVertex = 0;
+      GLImmediate.lastVertex = GLImmediate.vertexCounter / (GLImmediate.stride >> 2);
+      GLImmediate.flush();
+      GLImmediate.disableBeginEndClientAttributes();
+    },
+
+    // Whether the glBegin()/glEnd() block that was just ended, and whose client attributes were prepared, can be drawn
+    // together with the batch. Computes the vertex layout of the block into batchLayoutScratch.
+    matchesBatch: function matchesBatch() {
+      var layout = GLImmediate.batchLayoutScratch;
+      var attributes = GLImmediate.liveClientAttributes;
+      layout.length = 0;
+      layout.push(GLImmediate.stride);
+      for (var i = 0; i < attributes.length; i++) {
+        var attr = attributes[i];
+        layout.push(attr.name, attr.size, attr.type, attr.offset);
+      }
+      if (!GLImmediate.batchVertexCounter || GLImmediate.batchMode != GLImmediate.mode) return false;
+      if (GLImmediate.batchVertexCounter + GLImmediate.vertexCounter > GLImmediate.batchData.length) return false;
+      var batchLayout = GLImmediate.batchLayout;
+      if (layout.length != batchLayout.length) return false;
+      for (var i = 0; i < layout.length; i++) {
+        if (layout[i] !== batchLayout[i]) return false;
+      }
+      return true;
+    },
+
+    // Adds the glBegin()/glEnd() block that was just ended to the batch. If matchesBatch() was false, the batch must
+    // have been flushed first.
+    addToBatch: function addToBatch() {
+      if (!GLImmediate.batchVertexCounter) {
+        GLImmediate.batchMode = GLImmediate.mode;
+        var layout = GLImmediate.batchLayout;
+        GLImmediate.batchLayout = GLImmediate.batchLayoutScratch;
+        GLImmediate.batchLayoutScratch = layout;
+        GLImmediate.batchEnabledClientAttributes = GLImmediate.enabledClientAttributes;
+        GLImmediate.batchClientAttributes = GLImmediate.clientAttributes;
+        GLImmediate.batchRendererComponents = GLImmediate.rendererComponents;
+        if (!GLImmediate.batchFlushScheduled) {
+          GLImmediate.batchFlushScheduled = true;
+          Promise.resolve().then(function() {
+            GLImmediate.batchFlushScheduled = false;
+            GLImmediate.flushBatch();
+          });
+        }
+      }
+      GLImmediate.batchData.set(GLImmediate.tempData.subarray(0, GLImmediate.vertexCounter), GLImmediate.batchVertexCounter);
+      GLImmediate.batchVertexCounter += GLImmediate.vertexCounter;
+    },
+
+    // Draws the batch, if there is one.
+    flushBatch: function flushBatch() {
+      if (!GLImmediate.batchVertexCounter) return;
+      var enabledClientAttributes = GLImmediate.enabledClientAttributes;
+      var clientAttributes = GLImmediate.clientAttributes;
+      var rendererComponents = GLImmediate.rendererComponents;
+      var mode = GLImmediate.mode;
+      var vertexData = GLImmediate.vertexData;
+      var vertexCounter = GLImmediate.vertexCounter;
+
+      GLImmediate.enabledClientAttributes = GLImmediate.batchEnabledClientAttributes;
+      GLImmediate.clientAttributes = GLImmediate.batchClientAttributes;
+      GLImmediate.rendererComponents = GLImmediate.batchRendererComponents;
+      GLImmediate.mode = GLImmediate.batchMode;
+      GLImmediate.vertexData = GLImmediate.batchData;
+      GLImmediate.vertexCounter = GLImmediate.batchVertexCounter;
+      GLImmediate.batchVertexCounter = 0;
+      GLImmediate.currentRenderer = null;
+      GLImmediate.modifiedClientAttributes = true;
+      GLImmediate.prepareClientAttributes(GLImmediate.rendererComponents[GLImmediate.VERTEX], true);
+      GLImmediate.drawBeginEnd();
+
+      GLImmediate.enabledClientAttributes = enabledClientAttributes;
+      GLImmediate.clientAttributes = clientAttributes;
+      GLImmediate.rendererComponents = rendererComponents;
+      GLImmediate.mode = mode;
+      GLImmediate.vertexData = vertexData;
+      GLImmediate.vertexCounter = vertexCounter;
+      GLImmediate.currentRenderer = null;
+      GLImmediate.modifiedClientAttributes = true;
     }
   },
 
@@ -6752,10 +7171,19 @@ var LibraryGL = {
 
   glEnd: function() {
     GLImmediate.prepareClientAttributes(GLImmediate.rendererComponents[GLImmediate.VERTEX], true);
-    GLImmediate.firstVertex = 0;
-    GLImmediate.lastVertex = GLImmediate.vertexCounter / (GLImmediate.stride >> 2);
-    GLImmediate.flush();
-    GLImmediate.disableBeginEndClientAttributes();
+    // Lists of points, lines, triangles and quads can be drawn together, unlike strips, loops and fans. Vertex data in
+    // a bound array buffer is not uploaded, so it is not batched either.
+    var batchable = (GLImmediate.mode == 0 /*GL_POINTS*/ || GLImmediate.mode == 1 /*GL_LINES*/ ||
+                     GLImmediate.mode == 4 /*GL_TRIANGLES*/ || GLImmediate.mode == 7 /*GL_QUADS*/) &&
+                    !GL.currArrayBuffer && typeof Promise !== 'undefined';
+    if (!GLImmediate.matchesBatch()) {
+      if (GLImmediate.batchVertexCounter) {
+        GLImmediate.flushBatch();
+        GLImmediate.prepareClientAttributes(GLImmediate.rendererComponents[GLImmediate.VERTEX], true);
+      }
+      if (!batchable) GLImmediate.drawBeginEnd();
+    }
+    if (batchable) GLImmediate.addToBatch();
     GLImmediate.mode = -1;
 
     // Pop the old state:
@@ -6825,6 +7253,7 @@ var LibraryGL = {
       GLImmediate.vertexCounter++;
       GLImmediate.addRendererComponent(GLImmediate.COLOR, 4, GLctx.UNSIGNED_BYTE);
     } else {
+      GLImmediate.flushBatch();
       GLImmediate.clientColor[0] = r;
       GLImmediate.clientColor[1] = g;
       GLImmediate.clientColor[2] = b;
@@ -7609,9 +8038,47 @@ var LibraryGL = {
     GLctx.sampleCoverage(value, !!invert);
   },
 
-  // signatures of simple pass-through functions, see later
+  glEnable__sig: 'vi',
+  glEnable: function(cap) {
+#if GL_STATE_CACHE
+    var caps = GL.currentContext.stateCache.caps;
+    if (caps[cap] === true) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    caps[cap] = true;
+#endif
+    GLctx.enable(cap);
+  },
+
+  glDisable__sig: 'vi',
+  glDisable: function(cap) {
+#if GL_STATE_CACHE
+    var caps = GL.currentContext.stateCache.caps;
+    if (caps[cap] === false) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    caps[cap] = false;
+#endif
+    GLctx.disable(cap);
+  },
 
   glActiveTexture__sig: 'vi',
+  glActiveTexture: function(texture) {
+#if GL_STATE_CACHE
+    var cache = GL.currentContext.stateCache;
+    if (cache.activeTexture === texture) {
+      ++GL.currentContext.redundantStateChanges;
+      return;
+    }
+    cache.activeTexture = texture;
+#endif
+    GLctx.activeTexture(texture);
+  },
+
+  // signatures of simple pass-through functions, see later
+
   glCheckFramebufferStatus__sig: 'ii',
   glRenderbufferStorage__sig: 'viiii',
   glClearStencil__sig: 'vi',
@@ -7663,7 +8130,7 @@ var LibraryGL = {
 
 // Simple pass-through functions. Starred ones have return values. [X] ones have X in the C name but not in the JS name
 var glFuncs = [[0, 'finish flush'],
- [1, 'clearDepth clearDepth[f] depthFunc enable disable frontFace cullFace clear lineWidth clearStencil stencilMask checkFramebufferStatus* generateMipmap activeTexture blendEquation isEnabled*'],
+ [1, 'clearDepth clearDepth[f] depthFunc frontFace cullFace clear lineWidth clearStencil stencilMask checkFramebufferStatus* generateMipmap blendEquation isEnabled*'],
  [2, 'blendFunc blendEquationSeparate depthRange depthRange[f] stencilMaskSeparate hint polygonOffset vertexAttrib1f'],
  [3, 'texParameteri texParameterf vertexAttrib2f stencilFunc stencilOp'],
  [4, 'viewport clearColor scissor vertexAttrib3f renderbufferStorage blendFuncSeparate blendColor stencilFuncSeparate stencilOpSeparate'],
@@ -7721,6 +8188,18 @@ autoAddDeps(LibraryGL, '$GL');
 // Legacy GL emulation
 if (LEGACY_GL_EMULATION) {
   DEFAULT_LIBRARY_FUNCS_TO_INCLUDE.push('$GLEmulation');
+
+  // Batched immediate mode draws must be drawn before any other GL function changes the state they are drawn with, or
+  // reads what they draw. Queries do not need to wait for them, nor do the functions that specify vertices, which are
+  // what gets batched.
+  keys(LibraryGL).forEach(function(x) {
+    if (x.substr(0, 2) != 'gl' || x.indexOf('__') >= 0 || typeof LibraryGL[x] !== 'function') return;
+    if (/^gl(Get|Is)[A-Z]/.test(x) || /^gl(Begin|End|Vertex[234]|TexCoord[1234]|Color[34]|Normal3)[a-z]*$/.test(x)) return;
+    var src = LibraryGL[x].toString();
+    var bodyStart = src.indexOf('{') + 1;
+    LibraryGL[x] = eval('(' + src.substr(0, bodyStart) + ' GLImmediate.flushBatch();' + src.substr(bodyStart) + ')');
+    LibraryGL[x + '__deps'] = LibraryGL[x + '__deps'].concat('$GLImmediate'); // The deps array may be shared, see autoAddDeps().
+  });
 }
 
 function copyLibEntry(a, b) {
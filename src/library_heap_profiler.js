@@ -0,0 +1,227 @@
+// The JavaScript side of the sampling heap profiler of -s HEAP_PROFILER, see emscripten/heap_profiler.h and
+// system/lib/heap_profiler.c.
+
+var LibraryHeapProfiler = {
+  $HeapProfiler__postset: 'HeapProfiler.init();',
+  $HeapProfiler: {
+    // The average number of bytes between two samples, 0 if sampling is stopped.
+    interval: {{{ HEAP_PROFILER }}},
+    // The most frames that are kept of the stack of a sampled allocation.
+    MAX_FRAMES: 32,
+
+    // Call stacks of sampled allocations, by their frames joined with newlines. Each site holds the location ids of its
+    // frames, innermost first, and the estimated number of objects and bytes allocated at it, in total and still live.
+    sites: {},
+    siteList: [],
+    // Location ids by the text of their frame, and the frames by id - 1.
+    locationIds: {},
+    locations: [],
+    // The site and the estimated objects and bytes of each live sampled allocation, by address.
+    liveSamples: {},
+    // The number of sampled allocations that could not be tracked because too many were live.
+    dropped: 0,
+    // Set while the profile is encoded, since demangling calls malloc.
+    busy: false,
+
+    init: function() {
+      Module['getHeapProfile'] = HeapProfiler.encode;
+    },
+
+    nextInterval: function() {
+      if (!HeapProfiler.interval) return 0x7FFFFFFF;
+      // Exponentially distributed intervals sample each byte with the same probability, without aliasing on
+      // allocation patterns that repeat with a fixed period.
+      return Math.min(Math.max(1, Math.round(-Math.log(1 - Math.random()) * HeapProfiler.interval)), 0x7FFFFFFF);
+    },
+
+    // Returns the site of the current call stack, minus the frames of the profiler and of the allocator.
+    captureSite: function() {
+      var oldLimit = Error.stackTraceLimit;
+      Error.stackTraceLimit = HeapProfiler.MAX_FRAMES + 16;
+      var lines = jsStackTrace().split('\n');
+      Error.stackTraceLimit = oldLimit;
+      var frames = [];
+      for (var i = 0; i < lines.length; i++) {
+        var frame = HeapProfiler.parseFrame(lines[i]);
+        if (!frame) continue;
+        // Everything up to the outermost frame of the profiler or the allocator is not of interest.
+        if (/heap_profiler|^_+(malloc|calloc|realloc|memalign|posix_memalign|valloc|pvalloc|internal_memalign|dl(malloc|calloc|realloc|memalign|posix_memalign|valloc|pvalloc)|emscripten_builtin_malloc|_Zn[wa]j\w*)$/.test(frame.name)) {
+          frames = [];
+        } else {
+          frames.push(frame);
+        }
+      }
+      frames = frames.slice(0, HeapProfiler.MAX_FRAMES);
+      var key = frames.map(function(frame) { return frame.text }).join('\n');
+      var site = HeapProfiler.sites[key];
+      if (!site) {
+        site = HeapProfiler.sites[key] = {
+          locationIds: frames.map(HeapProfiler.locationId),
+          allocObjects: 0, allocBytes: 0, inuseObjects: 0, inuseBytes: 0
+        };
+        HeapProfiler.siteList.push(site);
+      }
+      return site;
+    },
+
+    // Parses a line of a stack trace of V8 ('    at Object._foo (file.js:12:34)') or of SpiderMonkey
+    // ('_foo@file.js:12:34') into the function name and the line in the file.
+    parseFrame: function(line) {
+      var parts = /^\s*at (?:(.*?) \()?(.*?)(?::(\d+))?(?::\d+)?\)?$/.exec(line);
+      if (!parts) parts = /^\s*(.*?)@(.*?)(?::(\d+))?(?::\d+)?$/.exec(line);
+      if (!parts || (!parts[1] && !parts[2])) return null;
+      var name = (parts[1] || parts[2]).replace(/^Object\./, '');
+      return { name: name, file: parts[2], line: parts[3]|0, text: name + ' ' + parts[2] + ':' + (parts[3]|0) };
+    },
+
+    locationId: function(frame) {
+      var id = HeapProfiler.locationIds[frame.text];
+      if (!id) {
+        HeapProfiler.locations.push(frame);
+        id = HeapProfiler.locationIds[frame.text] = HeapProfiler.locations.length;
+      }
+      return id;
+    },
+
+    // Encodes the profile in the protocol buffer format of pprof, see
+    // https://github.com/google/pprof/blob/master/proto/profile.proto
+    encode: function() {
+      HeapProfiler.busy = true;
+      var strings = [''], stringIds = { '': 0 };
+      function str(s) {
+        if (!(s in stringIds)) {
+          stringIds[s] = strings.length;
+          strings.push(s);
+        }
+        return stringIds[s];
+      }
+      function varint(out, value) {
+        value = Math.max(0, Math.round(value));
+        while (value >= 128) {
+          out.push((value % 128) | 128);
+          value = Math.floor(value / 128);
+        }
+        out.push(value);
+      }
+      function int(out, field, value) {
+        if (!value) return;
+        varint(out, field << 3);
+        varint(out, value);
+      }
+      function bytes(out, field, data) {
+        varint(out, (field << 3) | 2);
+        varint(out, data.length);
+        for (var i = 0; i < data.length; i++) out.push(data[i]);
+      }
+      function packed(out, field, values) {
+        var data = [];
+        for (var i = 0; i < values.length; i++) varint(data, values[i]);
+        bytes(out, field, data);
+      }
+      function valueType(type, unit) {
+        var data = [];
+        int(data, 1, str(type));
+        int(data, 2, str(unit));
+        return data;
+      }
+
+      var out = [];
+      bytes(out, 1, valueType('alloc_objects', 'count'));
+      bytes(out, 1, valueType('alloc_space', 'bytes'));
+      bytes(out, 1, valueType('inuse_objects', 'count'));
+      bytes(out, 1, valueType('inuse_space', 'bytes'));
+      HeapProfiler.siteList.forEach(function(site) {
+        var sample = [];
+        packed(sample, 1, site.locationIds);
+        packed(sample, 2, [site.allocObjects, site.allocBytes, site.inuseObjects, site.inuseBytes]);
+        bytes(out, 2, sample);
+      });
+      // One location and one function for each distinct frame.
+      HeapProfiler.locations.forEach(function(frame, i) {
+        var line = [];
+        int(line, 1, i + 1);
+        int(line, 2, frame.line);
+        var location = [];
+        int(location, 1, i + 1);
+        bytes(location, 4, line);
+        bytes(out, 4, location);
+      });
+      HeapProfiler.locations.forEach(function(frame, i) {
+        var func = [];
+        int(func, 1, i + 1);
+        int(func, 2, str(demangleAll(frame.name)));
+        int(func, 3, str(frame.name));
+        int(func, 4, str(frame.file));
+        bytes(out, 5, func);
+      });
+      bytes(out, 11, valueType('space', 'bytes'));
+      int(out, 12, HeapProfiler.interval);
+      int(out, 14, str('inuse_space')); // default_sample_type
+      if (HeapProfiler.dropped) {
+        int(out, 13, str(HeapProfiler.dropped + ' sampled allocations were not tracked, too many were live')); // comment
+      }
+      // The string table goes last, once all strings are known.
+      strings.forEach(function(s) {
+        bytes(out, 6, intArrayFromString(s, true));
+      });
+      HeapProfiler.busy = false;
+      return new Uint8Array(out);
+    }
+  },
+
+  emscripten_heap_profiler_js_sample__deps: ['$HeapProfiler'],
+  emscripten_heap_profiler_js_sample: function(address, size) {
+    if (HeapProfiler.busy) return HeapProfiler.nextInterval();
+    if (!address) {
+      HeapProfiler.dropped++;
+      return HeapProfiler.nextInterval();
+    }
+    // An allocation of size bytes is sampled with probability 1 - exp(-size / interval), so it stands for the inverse
+    // of that many allocations.
+    var interval = HeapProfiler.interval || 1;
+    var scale = 1 / (1 - Math.exp(-size / interval));
+    var site = HeapProfiler.captureSite();
+    var sample = { site: site, objects: scale, bytes: size * scale };
+    HeapProfiler.liveSamples[address] = sample;
+    site.allocObjects += sample.objects;
+    site.allocBytes += sample.bytes;
+    site.inuseObjects += sample.objects;
+    site.inuseBytes += sample.bytes;
+    return HeapProfiler.nextInterval();
+  },
+
+  emscripten_heap_profiler_js_free__deps: ['$HeapProfiler'],
+  emscripten_heap_profiler_js_free: function(address) {
+    var sample = HeapProfiler.liveSamples[address];
+    if (!sample) return; // sampled while the profile was encoded
+    delete HeapProfiler.liveSamples[address];
+    sample.site.inuseObjects -= sample.objects;
+    sample.site.inuseBytes -= sample.bytes;
+  },
+
+  emscripten_heap_profiler_set_sample_interval__deps: ['$HeapProfiler'],
+  emscripten_heap_profiler_set_sample_interval: function(bytes) {
+    HeapProfiler.interval = bytes;
+  },
+
+  emscripten_heap_profiler_write__deps: [
+#if NO_FILESYSTEM == 0
+    '$FS',
+#endif
+    '$HeapProfiler'
+  ],
+  emscripten_heap_profiler_write: function(filename) {
+#if NO_FILESYSTEM == 0
+    try {
+      FS.writeFile(Pointer_stringify(filename), HeapProfiler.encode(), { encoding: 'binary' });
+      return 0;
+    } catch (e) {
+      return -1;
+    }
+#else
+    return -1;
+#endif
+  }
+};
+
+mergeInto(LibraryManager.library, LibraryHeapProfiler);
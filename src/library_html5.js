@@ -162,6 +162,12 @@ var LibraryJSEvents = {
       var h = JSEvents.eventHandlers[i];
       h.target.removeEventListener(h.eventTypeString, h.eventListenerFunc, h.useCapture);
       JSEvents.eventHandlers.splice(i, 1);
+#if HTML5_COALESCE_EVENTS
+      if (h.coalescedEvents) {
+        _free(h.coalescedEvents);
+        h.coalescedEvents = 0;
+      }
+#endif
     },
     
     registerOrRemoveHandler: function(eventHandler) {
@@ -180,8 +186,18 @@ var LibraryJSEvents = {
       }
       
       if (eventHandler.callbackfunc) {
+#if HTML5_COALESCE_EVENTS
+        if (eventHandler.fillEventData) {
+          jsEventHandler = JSEvents.createCoalescingEventHandler(eventHandler, jsEventHandler);
+        }
+        eventHandler.eventListenerFunc = jsEventHandler;
+        // Only the capture flag of the options identifies the listener to removeEventListener(), so this can be removed like the others.
+        eventHandler.target.addEventListener(eventHandler.eventTypeString, jsEventHandler,
+          (eventHandler.passive && JSEvents.supportsPassiveEventListeners()) ? { 'capture': eventHandler.useCapture, 'passive': true } : eventHandler.useCapture);
+#else
         eventHandler.eventListenerFunc = jsEventHandler;
         eventHandler.target.addEventListener(eventHandler.eventTypeString, jsEventHandler, eventHandler.useCapture);
+#endif
         JSEvents.eventHandlers.push(eventHandler);
         JSEvents.registerRemoveEventListeners();
       } else {
@@ -194,6 +210,94 @@ var LibraryJSEvents = {
       }
     },
 
+#if HTML5_COALESCE_EVENTS
+    // Maximum number of events that are kept for a single coalesced callback. If the page does not render, e.g. when it is
+    // hidden, the oldest events are dropped after this.
+    MAX_COALESCED_EVENTS: 256,
+
+    // The handler whose coalesced callback is currently running, if any.
+    coalescingEventHandler: null,
+
+    isCoalescedCall: function(eventHandler) {
+      return JSEvents.coalescingEventHandler === eventHandler && eventHandler.numCoalescedEvents > 0;
+    },
+
+    // Sums up the movementX and movementY fields of the coalesced events of the given handler into the given mouse or wheel event structure.
+    accumulateMouseMovement: function(eventStruct, eventHandler) {
+      var movementX = 0, movementY = 0;
+      for(var i = 0; i < eventHandler.numCoalescedEvents; ++i) {
+        var e = eventHandler.coalescedEvents + i * eventHandler.eventStructSize;
+        movementX += {{{ makeGetValue('e', C_STRUCTS.EmscriptenMouseEvent.movementX, 'i32') }}};
+        movementY += {{{ makeGetValue('e', C_STRUCTS.EmscriptenMouseEvent.movementY, 'i32') }}};
+      }
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenMouseEvent.movementX, 'movementX', 'i32') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenMouseEvent.movementY, 'movementY', 'i32') }}};
+    },
+
+    supportsPassiveEventListeners: function() {
+      if (JSEvents.passiveEventListenersSupported === undefined) {
+        JSEvents.passiveEventListenersSupported = false;
+        try {
+          var options = Object.defineProperty({}, 'passive', { get: function() { JSEvents.passiveEventListenersSupported = true; } });
+          window.addEventListener('test', null, options);
+          window.removeEventListener('test', null, options);
+        } catch(e) {}
+      }
+      return JSEvents.passiveEventListenersSupported;
+    },
+
+    // Returns a listener that records each event to an array in the HEAP with eventHandler.fillEventData(), and calls
+    // handleEvent() only once per animation frame, for the last of the events. During that call, the handler's accumulateEvents()
+    // can sum up the relative fields of the recorded events, and the C callback can read them with emscripten_get_coalesced_events().
+    createCoalescingEventHandler: function(eventHandler, handleEvent) {
+      var size = eventHandler.eventStructSize;
+      var lastEvent = null;
+      eventHandler.coalescedEvents = 0;
+      eventHandler.numCoalescedEvents = 0;
+      eventHandler.coalescedEventsCapacity = 0;
+      var flush = function() {
+        var e = lastEvent;
+        lastEvent = null;
+        if (JSEvents.eventHandlers.indexOf(eventHandler) == -1) return; // The handler was removed in the meanwhile.
+        var previousHandler = JSEvents.coalescingEventHandler;
+        JSEvents.coalescingEventHandler = eventHandler;
+        handleEvent(e);
+        JSEvents.coalescingEventHandler = previousHandler;
+        eventHandler.numCoalescedEvents = 0;
+      };
+      return function jsCoalescingEventHandler(event) {
+        var e = event || window.event;
+        // The callback runs only after the event has been dispatched, so cancel the events for as long as it asked to cancel the
+        // previous one.
+        if (eventHandler.shouldCancel) {
+          e.preventDefault();
+        }
+        if (eventHandler.numCoalescedEvents == eventHandler.coalescedEventsCapacity) {
+          if (eventHandler.coalescedEventsCapacity < JSEvents.MAX_COALESCED_EVENTS) {
+            var capacity = Math.min(Math.max(eventHandler.coalescedEventsCapacity * 2, 4), JSEvents.MAX_COALESCED_EVENTS);
+            var events = _malloc(capacity * size);
+            if (eventHandler.coalescedEvents) {
+              HEAPU8.set(HEAPU8.subarray(eventHandler.coalescedEvents, eventHandler.coalescedEvents + eventHandler.numCoalescedEvents * size), events);
+              _free(eventHandler.coalescedEvents);
+            }
+            eventHandler.coalescedEvents = events;
+            eventHandler.coalescedEventsCapacity = capacity;
+          } else {
+            HEAPU8.copyWithin(eventHandler.coalescedEvents, eventHandler.coalescedEvents + size, eventHandler.coalescedEvents + eventHandler.numCoalescedEvents * size);
+            --eventHandler.numCoalescedEvents;
+          }
+        }
+        eventHandler.fillEventData(eventHandler.coalescedEvents + eventHandler.numCoalescedEvents * size, e);
+        ++eventHandler.numCoalescedEvents;
+        if (!lastEvent) {
+          if (window.requestAnimationFrame) window.requestAnimationFrame(flush);
+          else setTimeout(flush, 1000/60);
+        }
+        lastEvent = e;
+      };
+    },
+
+#endif
     registerKeyEventCallback: function(target, userData, useCapture, callbackfunc, eventTypeId, eventTypeString) {
       if (!JSEvents.keyEvent) {
         JSEvents.keyEvent = _malloc( {{{ C_STRUCTS.EmscriptenKeyboardEvent.__size__ }}} );
@@ -286,6 +390,9 @@ var LibraryJSEvents = {
       var handlerFunc = function(event) {
         var e = event || window.event;
         JSEvents.fillMouseEventData(JSEvents.mouseEvent, e, target);
+#if HTML5_COALESCE_EVENTS
+        if (JSEvents.isCoalescedCall(eventHandler)) JSEvents.accumulateMouseMovement(JSEvents.mouseEvent, eventHandler);
+#endif
         var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.mouseEvent, userData);
         if (shouldCancel) {
           e.preventDefault();
@@ -302,6 +409,13 @@ var LibraryJSEvents = {
       };
       // In IE, mousedown events don't either allow deferred calls to be run!
       if (JSEvents.isInternetExplorer() && eventTypeString == 'mousedown') eventHandler.allowsDeferredCalls = false;
+#if HTML5_COALESCE_EVENTS
+      if (eventTypeString == 'mousemove') {
+        eventHandler.eventStructSize = {{{ C_STRUCTS.EmscriptenMouseEvent.__size__ }}};
+        eventHandler.fillEventData = function(eventStruct, e) { JSEvents.fillMouseEventData(eventStruct, e, target); };
+        eventHandler.passive = true;
+      }
+#endif
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
@@ -311,27 +425,45 @@ var LibraryJSEvents = {
       }
       target = JSEvents.findEventTarget(target);
       // The DOM Level 3 events spec event 'wheel'
-      var wheelHandlerFunc = function(event) {
-        var e = event || window.event;
-        JSEvents.fillMouseEventData(JSEvents.wheelEvent, e, target);
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'e["deltaX"]', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaY, 'e["deltaY"]', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaZ, 'e["deltaZ"]', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaMode, 'e["deltaMode"]', 'i32') }}};
-        var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.wheelEvent, userData);
-        if (shouldCancel) {
-          e.preventDefault();
-        }
+      var fillWheelEventData = function(eventStruct, e) {
+        JSEvents.fillMouseEventData(eventStruct, e, target);
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'e["deltaX"]', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaY, 'e["deltaY"]', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaZ, 'e["deltaZ"]', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaMode, 'e["deltaMode"]', 'i32') }}};
       };
       // The 'mousewheel' event as implemented in Safari 6.0.5
-      var mouseWheelHandlerFunc = function(event) {
+      var fillMouseWheelEventData = function(eventStruct, e) {
+        JSEvents.fillMouseEventData(eventStruct, e, target);
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'e["wheelDeltaX"] || 0', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaY, '-(e["wheelDeltaY"] ? e["wheelDeltaY"] : e["wheelDelta"]) /* 1. Invert to unify direction with the DOM Level 3 wheel event. 2. MSIE does not provide wheelDeltaY, so wheelDelta is used as a fallback. */', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaZ, '0 /* Not available */', 'double') }}};
+        {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenWheelEvent.deltaMode, '0 /* DOM_DELTA_PIXEL */', 'i32') }}};
+      };
+      var fillEventData = (eventTypeString == 'wheel') ? fillWheelEventData : fillMouseWheelEventData;
+      var handlerFunc = function(event) {
         var e = event || window.event;
-        JSEvents.fillMouseEventData(JSEvents.wheelEvent, e, target);
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'e["wheelDeltaX"] || 0', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaY, '-(e["wheelDeltaY"] ? e["wheelDeltaY"] : e["wheelDelta"]) /* 1. Invert to unify direction with the DOM Level 3 wheel event. 2. MSIE does not provide wheelDeltaY, so wheelDelta is used as a fallback. */', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaZ, '0 /* Not available */', 'double') }}};
-        {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaMode, '0 /* DOM_DELTA_PIXEL */', 'i32') }}};
+        fillEventData(JSEvents.wheelEvent, e);
+#if HTML5_COALESCE_EVENTS
+        if (JSEvents.isCoalescedCall(eventHandler)) {
+          // The scroll amounts of all the coalesced events, in the delta mode of the last one.
+          JSEvents.accumulateMouseMovement(JSEvents.wheelEvent, eventHandler);
+          var deltaX = 0, deltaY = 0, deltaZ = 0;
+          for(var i = 0; i < eventHandler.numCoalescedEvents; ++i) {
+            var w = eventHandler.coalescedEvents + i * eventHandler.eventStructSize;
+            deltaX += {{{ makeGetValue('w', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'double') }}};
+            deltaY += {{{ makeGetValue('w', C_STRUCTS.EmscriptenWheelEvent.deltaY, 'double') }}};
+            deltaZ += {{{ makeGetValue('w', C_STRUCTS.EmscriptenWheelEvent.deltaZ, 'double') }}};
+          }
+          {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaX, 'deltaX', 'double') }}};
+          {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaY, 'deltaY', 'double') }}};
+          {{{ makeSetValue('JSEvents.wheelEvent', C_STRUCTS.EmscriptenWheelEvent.deltaZ, 'deltaZ', 'double') }}};
+        }
+#endif
         var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.wheelEvent, userData);
+#if HTML5_COALESCE_EVENTS
+        eventHandler.shouldCancel = shouldCancel;
+#endif
         if (shouldCancel) {
           e.preventDefault();
         }
@@ -342,9 +474,14 @@ var LibraryJSEvents = {
         allowsDeferredCalls: true,
         eventTypeString: eventTypeString,
         callbackfunc: callbackfunc,
-        handlerFunc: (eventTypeString == 'wheel') ? wheelHandlerFunc : mouseWheelHandlerFunc,
+        handlerFunc: handlerFunc,
         useCapture: useCapture
       };
+#if HTML5_COALESCE_EVENTS
+      // Wheel events are not passive, as they scroll the page unless canceled.
+      eventHandler.eventStructSize = {{{ C_STRUCTS.EmscriptenWheelEvent.__size__ }}};
+      eventHandler.fillEventData = fillEventData;
+#endif
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
@@ -445,18 +582,34 @@ var LibraryJSEvents = {
       else return Date.now();
     },
 
+    fillDeviceOrientationEventData: function(eventStruct, e) {
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceOrientationEvent.timestamp, 'JSEvents.tick()', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceOrientationEvent.alpha, 'e.alpha', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceOrientationEvent.beta, 'e.beta', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceOrientationEvent.gamma, 'e.gamma', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceOrientationEvent.absolute, 'e.absolute', 'i32') }}};
+    },
+
+    fillDeviceMotionEventData: function(eventStruct, e) {
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.timestamp, 'JSEvents.tick()', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationX, 'e.acceleration.x', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationY, 'e.acceleration.y', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationZ, 'e.acceleration.z', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityX, 'e.accelerationIncludingGravity.x', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityY, 'e.accelerationIncludingGravity.y', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityZ, 'e.accelerationIncludingGravity.z', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateAlpha, 'e.rotationRate.alpha', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateBeta, 'e.rotationRate.beta', 'double') }}};
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateGamma, 'e.rotationRate.gamma', 'double') }}};
+    },
+
     registerDeviceOrientationEventCallback: function(target, userData, useCapture, callbackfunc, eventTypeId, eventTypeString) {
       if (!JSEvents.deviceOrientationEvent) {
         JSEvents.deviceOrientationEvent = _malloc( {{{ C_STRUCTS.EmscriptenDeviceOrientationEvent.__size__ }}} );
       }
       var handlerFunc = function(event) {
         var e = event || window.event;
-
-        {{{ makeSetValue('JSEvents.deviceOrientationEvent', C_STRUCTS.EmscriptenDeviceOrientationEvent.timestamp, 'JSEvents.tick()', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceOrientationEvent', C_STRUCTS.EmscriptenDeviceOrientationEvent.alpha, 'e.alpha', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceOrientationEvent', C_STRUCTS.EmscriptenDeviceOrientationEvent.beta, 'e.beta', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceOrientationEvent', C_STRUCTS.EmscriptenDeviceOrientationEvent.gamma, 'e.gamma', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceOrientationEvent', C_STRUCTS.EmscriptenDeviceOrientationEvent.absolute, 'e.absolute', 'i32') }}};
+        JSEvents.fillDeviceOrientationEventData(JSEvents.deviceOrientationEvent, e);
 
         var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.deviceOrientationEvent, userData);
         if (shouldCancel) {
@@ -472,6 +625,11 @@ var LibraryJSEvents = {
         handlerFunc: handlerFunc,
         useCapture: useCapture
       };
+#if HTML5_COALESCE_EVENTS
+      eventHandler.eventStructSize = {{{ C_STRUCTS.EmscriptenDeviceOrientationEvent.__size__ }}};
+      eventHandler.fillEventData = JSEvents.fillDeviceOrientationEventData;
+      eventHandler.passive = true; // Device orientation events are not cancelable.
+#endif
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
@@ -481,17 +639,7 @@ var LibraryJSEvents = {
       }
       var handlerFunc = function(event) {
         var e = event || window.event;
-
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.timestamp, 'JSEvents.tick()', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationX, 'e.acceleration.x', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationY, 'e.acceleration.y', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationZ, 'e.acceleration.z', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityX, 'e.accelerationIncludingGravity.x', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityY, 'e.accelerationIncludingGravity.y', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.accelerationIncludingGravityZ, 'e.accelerationIncludingGravity.z', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateAlpha, 'e.rotationRate.alpha', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateBeta, 'e.rotationRate.beta', 'double') }}};
-        {{{ makeSetValue('JSEvents.deviceMotionEvent', C_STRUCTS.EmscriptenDeviceMotionEvent.rotationRateGamma, 'e.rotationRate.gamma', 'double') }}};
+        JSEvents.fillDeviceMotionEventData(JSEvents.deviceMotionEvent, e);
 
         var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.deviceMotionEvent, userData);
         if (shouldCancel) {
@@ -507,6 +655,11 @@ var LibraryJSEvents = {
         handlerFunc: handlerFunc,
         useCapture: useCapture
       };
+#if HTML5_COALESCE_EVENTS
+      eventHandler.eventStructSize = {{{ C_STRUCTS.EmscriptenDeviceMotionEvent.__size__ }}};
+      eventHandler.fillEventData = JSEvents.fillDeviceMotionEventData;
+      eventHandler.passive = true; // Device motion events are not cancelable.
+#endif
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
@@ -842,6 +995,61 @@ var LibraryJSEvents = {
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
+    fillTouchEventData: function(eventStruct, e, target) {
+      var touches = {};
+      for(var i = 0; i < e.touches.length; ++i) {
+        var touch = e.touches[i];
+        touches[touch.identifier] = touch;
+      }
+      for(var i = 0; i < e.changedTouches.length; ++i) {
+        var touch = e.changedTouches[i];
+        touches[touch.identifier] = touch;
+        touch.changed = true;
+      }
+      for(var i = 0; i < e.targetTouches.length; ++i) {
+        var touch = e.targetTouches[i];
+        touches[touch.identifier].onTarget = true;
+      }
+      
+      var ptr = eventStruct;
+      {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.ctrlKey, 'e.ctrlKey', 'i32') }}};
+      {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.shiftKey, 'e.shiftKey', 'i32') }}};
+      {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.altKey, 'e.altKey', 'i32') }}};
+      {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.metaKey, 'e.metaKey', 'i32') }}};
+      ptr += {{{ C_STRUCTS.EmscriptenTouchEvent.touches }}}; // Advance to the start of the touch array.
+      var canvasRect = Module['canvas'] ? Module['canvas'].getBoundingClientRect() : undefined;
+      var targetRect = JSEvents.getBoundingClientRectOrZeros(target);
+      var numTouches = 0;
+      for(var i in touches) {
+        var t = touches[i];
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.identifier, 't.identifier', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.screenX, 't.screenX', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.screenY, 't.screenY', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.clientX, 't.clientX', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.clientY, 't.clientY', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.pageX, 't.pageX', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.pageY, 't.pageY', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.isChanged, 't.changed', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.onTarget, 't.onTarget', 'i32') }}};
+        if (canvasRect) {
+          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasX, 't.clientX - canvasRect.left', 'i32') }}};
+          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasY, 't.clientY - canvasRect.top', 'i32') }}};
+        } else {
+          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasX, '0', 'i32') }}};
+          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasY, '0', 'i32') }}};            
+        }
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.targetX, 't.clientX - targetRect.left', 'i32') }}};
+        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.targetY, 't.clientY - targetRect.top', 'i32') }}};
+        
+        ptr += {{{ C_STRUCTS.EmscriptenTouchPoint.__size__ }}};
+
+        if (++numTouches >= 32) {
+          break;
+        }
+      }
+      {{{ makeSetValue('eventStruct', C_STRUCTS.EmscriptenTouchEvent.numTouches, 'numTouches', 'i32') }}};
+    },
+
     registerTouchEventCallback: function(target, userData, useCapture, callbackfunc, eventTypeId, eventTypeString) {
       if (!JSEvents.touchEvent) {
         JSEvents.touchEvent = _malloc( {{{ C_STRUCTS.EmscriptenTouchEvent.__size__ }}} );
@@ -851,61 +1059,12 @@ var LibraryJSEvents = {
 
       var handlerFunc = function(event) {
         var e = event || window.event;
-
-        var touches = {};
-        for(var i = 0; i < e.touches.length; ++i) {
-          var touch = e.touches[i];
-          touches[touch.identifier] = touch;
-        }
-        for(var i = 0; i < e.changedTouches.length; ++i) {
-          var touch = e.changedTouches[i];
-          touches[touch.identifier] = touch;
-          touch.changed = true;
-        }
-        for(var i = 0; i < e.targetTouches.length; ++i) {
-          var touch = e.targetTouches[i];
-          touches[touch.identifier].onTarget = true;
-        }
-        
-        var ptr = JSEvents.touchEvent;
-        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.ctrlKey, 'e.ctrlKey', 'i32') }}};
-        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.shiftKey, 'e.shiftKey', 'i32') }}};
-        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.altKey, 'e.altKey', 'i32') }}};
-        {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchEvent.metaKey, 'e.metaKey', 'i32') }}};
-        ptr += {{{ C_STRUCTS.EmscriptenTouchEvent.touches }}}; // Advance to the start of the touch array.
-        var canvasRect = Module['canvas'] ? Module['canvas'].getBoundingClientRect() : undefined;
-        var targetRect = JSEvents.getBoundingClientRectOrZeros(target);
-        var numTouches = 0;
-        for(var i in touches) {
-          var t = touches[i];
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.identifier, 't.identifier', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.screenX, 't.screenX', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.screenY, 't.screenY', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.clientX, 't.clientX', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.clientY, 't.clientY', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.pageX, 't.pageX', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.pageY, 't.pageY', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.isChanged, 't.changed', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.onTarget, 't.onTarget', 'i32') }}};
-          if (canvasRect) {
-            {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasX, 't.clientX - canvasRect.left', 'i32') }}};
-            {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasY, 't.clientY - canvasRect.top', 'i32') }}};
-          } else {
-            {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasX, '0', 'i32') }}};
-            {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.canvasY, '0', 'i32') }}};            
-          }
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.targetX, 't.clientX - targetRect.left', 'i32') }}};
-          {{{ makeSetValue('ptr', C_STRUCTS.EmscriptenTouchPoint.targetY, 't.clientY - targetRect.top', 'i32') }}};
-          
-          ptr += {{{ C_STRUCTS.EmscriptenTouchPoint.__size__ }}};
-
-          if (++numTouches >= 32) {
-            break;
-          }
-        }
-        {{{ makeSetValue('JSEvents.touchEvent', C_STRUCTS.EmscriptenTouchEvent.numTouches, 'numTouches', 'i32') }}};
+        JSEvents.fillTouchEventData(JSEvents.touchEvent, e, target);
 
         var shouldCancel = Module['dynCall_iiii'](callbackfunc, eventTypeId, JSEvents.touchEvent, userData);
+#if HTML5_COALESCE_EVENTS
+        eventHandler.shouldCancel = shouldCancel;
+#endif
         if (shouldCancel) {
           e.preventDefault();
         }
@@ -919,6 +1078,13 @@ var LibraryJSEvents = {
         handlerFunc: handlerFunc,
         useCapture: useCapture
       };
+#if HTML5_COALESCE_EVENTS
+      // Touch move events are not passive, as they scroll the page unless canceled.
+      if (eventTypeString == 'touchmove') {
+        eventHandler.eventStructSize = {{{ C_STRUCTS.EmscriptenTouchEvent.__size__ }}};
+        eventHandler.fillEventData = function(eventStruct, e) { JSEvents.fillTouchEventData(eventStruct, e, target); };
+      }
+#endif
       JSEvents.registerOrRemoveHandler(eventHandler);
     },
 
@@ -1124,6 +1290,20 @@ var LibraryJSEvents = {
     return {{{ cDefine('EMSCRIPTEN_RESULT_SUCCESS') }}};
   },
 
+  emscripten_get_coalesced_events: function(events, numEvents) {
+#if HTML5_COALESCE_EVENTS
+    var h = JSEvents.coalescingEventHandler;
+    if (h) {
+      {{{ makeSetValue('events', 0, 'h.coalescedEvents', 'i32') }}};
+      {{{ makeSetValue('numEvents', 0, 'h.numCoalescedEvents', 'i32') }}};
+      return {{{ cDefine('EMSCRIPTEN_RESULT_SUCCESS') }}};
+    }
+#endif
+    {{{ makeSetValue('events', 0, '0', 'i32') }}};
+    {{{ makeSetValue('numEvents', 0, '0', 'i32') }}};
+    return {{{ cDefine('EMSCRIPTEN_RESULT_NO_DATA') }}};
+  },
+
   emscripten_get_mouse_status: function(mouseState) {
     if (!JSEvents.mouseEvent) return {{{ cDefine('EMSCRIPTEN_RESULT_NO_DATA') }}};
     // HTML5 does not really have a polling API for mouse events, so implement one manually by
@@ -1874,6 +2054,44 @@ var LibraryJSEvents = {
     return {{{ cDefine('EMSCRIPTEN_RESULT_SUCCESS') }}};
   },
 
+  emscripten_webgl_get_redundant_state_changes: function(contextHandle) {
+#if GL_STATE_CACHE
+    var GLContext = GL.getContext(contextHandle);
+    return GLContext ? GLContext.redundantStateChanges : 0;
+#else
+    return 0;
+#endif
+  },
+
+  emscripten_webgl_prefetch_program: function(vertexSource, fragmentSource, attribs, numAttribs) {
+#if GL_PROGRAM_CACHE
+    if (!GL.currentContext) return {{{ cDefine('EMSCRIPTEN_RESULT_INVALID_TARGET') }}};
+    var names = [];
+    for (var i = 0; i < numAttribs; ++i) {
+      names.push(Pointer_stringify({{{ makeGetValue('attribs', 'i*4', 'i32') }}}));
+    }
+    GL.prefetchProgram(Pointer_stringify(vertexSource), Pointer_stringify(fragmentSource), names);
+    return {{{ cDefine('EMSCRIPTEN_RESULT_SUCCESS') }}};
+#else
+    return {{{ cDefine('EMSCRIPTEN_RESULT_NOT_SUPPORTED') }}};
+#endif
+  },
+
+  emscripten_webgl_get_pending_program_prefetches: function() {
+#if GL_PROGRAM_CACHE
+    if (!GL.currentContext || !GLctx.parallelShaderCompileExt) return 0;
+    var pending = 0;
+    for (var key in GL.currentContext.prefetchedPrograms) {
+      GL.currentContext.prefetchedPrograms[key].forEach(function(entry) {
+        if (!GLctx.getProgramParameter(entry.program, 0x91B1 /*GL_COMPLETION_STATUS_KHR*/)) ++pending;
+      });
+    }
+    return pending;
+#else
+    return 0;
+#endif
+  },
+
   emscripten_webgl_commit_frame: function() {
     if (!GL.currentContext || !GL.currentContext.GLctx) {
 #if GL_DEBUG
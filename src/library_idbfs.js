@@ -11,21 +11,154 @@ mergeInto(LibraryManager.library, {
     },
     DB_VERSION: 21,
     DB_STORE_NAME: 'FILE_DATA',
+    ops_table: null,
     mount: function(mount) {
       // reuse all of the core MEMFS functionality
-      return MEMFS.mount.apply(null, arguments);
+      var root = MEMFS.mount.apply(null, arguments);
+      // paths changed since the last sync, or null until the first sync, when the state of the database is not known.
+      mount.dirtyPaths = null;
+      IDBFS.adoptNode(root);
+      return root;
+    },
+    // Switches a node created by MEMFS to the ops of IDBFS, which are those of MEMFS, but track the paths that change.
+    adoptNode: function(node) {
+      if (!IDBFS.ops_table) {
+        IDBFS.ops_table = {};
+        Object.keys(MEMFS.ops_table).forEach(function(type) {
+          var ops = MEMFS.ops_table[type];
+          var node_ops = {}, stream_ops = {};
+          Object.keys(ops.node).forEach(function(name) { node_ops[name] = ops.node[name]; });
+          Object.keys(ops.stream).forEach(function(name) { stream_ops[name] = ops.stream[name]; });
+          IDBFS.ops_table[type] = { node: node_ops, stream: stream_ops };
+        });
+        var ops = IDBFS.ops_table;
+        ops.dir.node.mknod = function(parent, name, mode, dev) {
+          var node = MEMFS.node_ops.mknod(parent, name, mode, dev);
+          IDBFS.adoptNode(node);
+          IDBFS.markDirty(node);
+          return node;
+        };
+        ops.dir.node.symlink = function(parent, newname, oldpath) {
+          var node = MEMFS.node_ops.symlink(parent, newname, oldpath);
+          IDBFS.adoptNode(node);
+          IDBFS.markDirty(node);
+          return node;
+        };
+        ops.dir.node.rename = function(old_node, new_dir, new_name) {
+          var dirty = old_node.mount.dirtyPaths;
+          var old_path = dirty && FS.getPath(old_node);
+          MEMFS.node_ops.rename(old_node, new_dir, new_name);
+          if (dirty) {
+            // everything under the old path is gone, and everything under the new one is new.
+            IDBFS.markTreeDirty(dirty, old_node, old_path);
+            IDBFS.markTreeDirty(dirty, old_node, PATH.join2(FS.getPath(new_dir), new_name));
+          }
+        };
+        ops.dir.node.unlink = function(parent, name) {
+          MEMFS.node_ops.unlink(parent, name);
+          IDBFS.markDirty(parent, name);
+        };
+        ops.dir.node.rmdir = function(parent, name) {
+          MEMFS.node_ops.rmdir(parent, name);
+          IDBFS.markDirty(parent, name);
+        };
+        ['dir', 'file', 'link', 'chrdev'].forEach(function(type) {
+          ops[type].node.setattr = function(node, attr) {
+            MEMFS.node_ops.setattr(node, attr);
+            IDBFS.markDirty(node);
+          };
+        });
+        ops.file.stream.write = function(stream, buffer, offset, length, position, canOwn) {
+          var bytesWritten = MEMFS.stream_ops.write(stream, buffer, offset, length, position, canOwn);
+          if (bytesWritten) IDBFS.markDirty(stream.node);
+          return bytesWritten;
+        };
+        ops.file.stream.allocate = function(stream, offset, length, keepSize) {
+          MEMFS.stream_ops.allocate(stream, offset, length, keepSize);
+          IDBFS.markDirty(stream.node);
+        };
+        ops.file.stream.msync = function(stream, buffer, offset, length, mmapFlags) {
+          var ret = MEMFS.stream_ops.msync(stream, buffer, offset, length, mmapFlags);
+          IDBFS.markDirty(stream.node);
+          return ret;
+        };
+      }
+      Object.keys(MEMFS.ops_table).forEach(function(type) {
+        if (node.node_ops === MEMFS.ops_table[type].node) {
+          node.node_ops = IDBFS.ops_table[type].node;
+          node.stream_ops = IDBFS.ops_table[type].stream;
+        }
+      });
+    },
+    // Marks the path of the given node, or of its child with the given name, to be written to the database on the next sync.
+    markDirty: function(node, name) {
+      var dirty = node.mount.dirtyPaths;
+      if (!dirty) return;
+      var path = FS.getPath(node);
+      dirty[name === undefined ? path : PATH.join2(path, name)] = true;
+    },
+    markTreeDirty: function(dirty, node, path) {
+      dirty[path] = true;
+      if (FS.isDir(node.mode)) {
+        for (var name in node.contents) {
+          IDBFS.markTreeDirty(dirty, node.contents[name], PATH.join2(path, name));
+        }
+      }
     },
     syncfs: function(mount, populate, callback) {
+      if (!populate && mount.dirtyPaths) {
+        return IDBFS.syncDirtyPaths(mount, callback);
+      }
+
+      // track the changes that are made from now on, which the full sync might not see. When populating, the changes that the
+      // sync itself makes are already in the database, but older local changes, which it leaves in place, still need to be written.
+      var dirty = populate ? mount.dirtyPaths : null;
+      mount.dirtyPaths = populate ? null : {};
+
       IDBFS.getLocalSet(mount, function(err, local) {
-        if (err) return callback(err);
+        if (err) return IDBFS.syncFailed(mount, callback, err);
 
         IDBFS.getRemoteSet(mount, function(err, remote) {
-          if (err) return callback(err);
+          if (err) return IDBFS.syncFailed(mount, callback, err);
 
           var src = populate ? remote : local;
           var dst = populate ? local : remote;
 
-          IDBFS.reconcile(src, dst, callback);
+          IDBFS.reconcile(src, dst, function(err) {
+            if (err) return IDBFS.syncFailed(mount, callback, err);
+            if (populate) mount.dirtyPaths = dirty || {};
+            callback(null);
+          });
+        });
+      });
+    },
+    syncFailed: function(mount, callback, err) {
+      // the database may have been partially updated, so the next sync needs to compare everything again.
+      mount.dirtyPaths = null;
+      callback(err);
+    },
+    // Writes only the paths that changed since the last sync to the database, instead of comparing all of them.
+    syncDirtyPaths: function(mount, callback) {
+      var dirty = mount.dirtyPaths;
+      mount.dirtyPaths = {};
+
+      IDBFS.getDB(mount.mountpoint, function(err, db) {
+        if (err) return IDBFS.syncFailed(mount, callback, err);
+
+        // the paths that exist locally are written, and the others are removed from the database.
+        var local = { type: 'local', entries: {} };
+        var remote = { type: 'remote', db: db, entries: {} };
+        Object.keys(dirty).forEach(function(path) {
+          if (FS.analyzePath(path, true).exists) {
+            local.entries[path] = {};
+          } else {
+            remote.entries[path] = {};
+          }
+        });
+
+        IDBFS.reconcile(local, remote, function(err) {
+          if (err) return IDBFS.syncFailed(mount, callback, err);
+          callback(null);
         });
       });
     },
@@ -154,8 +287,13 @@ mergeInto(LibraryManager.library, {
       } else if (FS.isFile(stat.mode)) {
         // Performance consideration: storing a normal JavaScript array to a IndexedDB is much slower than storing a typed array.
         // Therefore always convert the file contents to a typed array first before writing the data to IndexedDB.
-        node.contents = MEMFS.getFileDataAsTypedArray(node);
-        return callback(null, { timestamp: stat.mtime, mode: stat.mode, contents: node.contents });
+        var contents = MEMFS.getFileDataAsTypedArray(node);
+#if MEMFS_HEAP_FILE_SIZE
+        if (!node.heapStorage) node.contents = contents; // Files in the heap already are typed arrays, and are given a copy to store.
+#else
+        node.contents = contents;
+#endif
+        return callback(null, { timestamp: stat.mtime, mode: stat.mode, contents: contents });
       } else {
         return callback(new Error('node type not supported'));
       }
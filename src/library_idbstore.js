@@ -48,6 +48,62 @@ var LibraryIDBStore = {
       if (oncheck) Module['dynCall_vii'](oncheck, arg, exists);
     });
   },
+  emscripten_idb_async_load_into: function(db, id, buffer, size, arg, onload, onerror) {
+    IDBStore.getFile(Pointer_stringify(db), Pointer_stringify(id), function(error, byteArray) {
+      if (error) {
+        if (onerror) Module['dynCall_vi'](onerror, arg);
+        return;
+      }
+      // report the full size even if it does not fit, so the caller can retry with a bigger buffer
+      HEAPU8.set(byteArray.length > size ? byteArray.subarray(0, size) : byteArray, buffer);
+      Module['dynCall_vii'](onload, arg, byteArray.length);
+    });
+  },
+  emscripten_idb_async_load_many: function(db, ids, num, arg, onload, onerror) {
+    var names = [];
+    for (var i = 0; i < num; i++) {
+      names.push(Pointer_stringify({{{ makeGetValue('ids', 'i*4', 'i32') }}}));
+    }
+    IDBStore.getFiles(Pointer_stringify(db), names, function(error, byteArrays) {
+      if (error) {
+        if (onerror) Module['dynCall_vi'](onerror, arg);
+        return;
+      }
+      // one buffer, big enough for the largest, is reused for all of them
+      var size = 0;
+      for (var i = 0; i < num; i++) {
+        if (byteArrays[i]) size = Math.max(size, byteArrays[i].length);
+      }
+      var buffer = _malloc(size);
+      for (var i = 0; i < num; i++) {
+        var byteArray = byteArrays[i];
+        if (!byteArray) {
+          Module['dynCall_viiii'](onload, arg, i, 0, -1);
+          continue;
+        }
+        HEAPU8.set(byteArray, buffer);
+        Module['dynCall_viiii'](onload, arg, i, buffer, byteArray.length);
+      }
+      _free(buffer);
+    });
+  },
+  emscripten_idb_async_store_many: function(db, ids, ptrs, nums, num, arg, onstore, onerror) {
+    var names = [];
+    var datas = [];
+    for (var i = 0; i < num; i++) {
+      names.push(Pointer_stringify({{{ makeGetValue('ids', 'i*4', 'i32') }}}));
+      var ptr = {{{ makeGetValue('ptrs', 'i*4', 'i32') }}};
+      // copied, as in emscripten_idb_async_store
+      datas.push(new Uint8Array(HEAPU8.subarray(ptr, ptr+{{{ makeGetValue('nums', 'i*4', 'i32') }}})));
+    }
+    IDBStore.setFiles(Pointer_stringify(db), names, datas, function(error) {
+      if (error) {
+        if (onerror) Module['dynCall_vi'](onerror, arg);
+        return;
+      }
+      if (onstore) Module['dynCall_vi'](onstore, arg);
+    });
+  },
 
 #if EMTERPRETIFY_ASYNC
   emscripten_idb_load__deps: ['$EmterpreterAsync'],
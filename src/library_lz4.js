@@ -17,7 +17,7 @@ mergeInto(LibraryManager.library, {
     loadPackage: function (pack) {
       LZ4.init();
       var compressedData = pack['compressedData'];
-      if (!compressedData) compressedData = LZ4.codec.compressPackage(pack['data']);
+      if (!compressedData) compressedData = LZ4.codec.compressPackage(pack['data'], false, pack['metadata'].files);
       assert(compressedData.cachedIndexes.length === compressedData.cachedChunks.length);
       for (var i = 0; i < compressedData.cachedIndexes.length; i++) {
         compressedData.cachedIndexes[i] = -1;
@@ -25,15 +25,18 @@ mergeInto(LibraryManager.library, {
                                                                       compressedData.cachedOffset + (i+1)*LZ4.CHUNK_SIZE);
         assert(compressedData.cachedChunks[i].length === LZ4.CHUNK_SIZE);
       }
-      pack['metadata'].files.forEach(function(file) {
+      var fileChunks = compressedData.fileChunks;
+      pack['metadata'].files.forEach(function(file, i) {
         var dir = PATH.dirname(file.filename);
         var name = PATH.basename(file.filename);
         FS.createPath('', dir, true, true);
         var parent = FS.analyzePath(dir).object;
+        // with a per-file chunk index, positions are counted from the first chunk of the file itself
         LZ4.createNode(parent, name, LZ4.FILE_MODE, 0, {
           compressedData: compressedData,
-          start: file.start,
-          end: file.end,
+          start: fileChunks ? 0 : file.start,
+          end: fileChunks ? file.end - file.start : file.end,
+          firstChunk: fileChunks ? fileChunks[i] : 0,
         });
       });
     },
@@ -119,10 +122,24 @@ mergeInto(LibraryManager.library, {
           var start = contents.start + position + written; // start index in uncompressed data
           var desired = length - written;
           //console.log('current read: ' + ['start', start, 'desired', desired]);
-          var chunkIndex = Math.floor(start / LZ4.CHUNK_SIZE);
+          var chunkIndex = contents.firstChunk + Math.floor(start / LZ4.CHUNK_SIZE);
           var compressedStart = compressedData.offsets[chunkIndex];
           var compressedSize = compressedData.sizes[chunkIndex];
+          var startInChunk = start % LZ4.CHUNK_SIZE;
           var currChunk;
+          if (compressedData.successes[chunkIndex] && startInChunk === 0 && desired >= LZ4.CHUNK_SIZE &&
+              compressedData.cachedIndexes.indexOf(chunkIndex) < 0) {
+            // the whole chunk is wanted, decompress it straight into the output instead of through the cache
+            if (compressedData.debug) {
+              console.log('decompressing chunk ' + chunkIndex);
+              Module['decompressedChunks'] = (Module['decompressedChunks'] || 0) + 1;
+            }
+            var compressed = compressedData.data.subarray(compressedStart, compressedStart + compressedSize);
+            var originalSize = LZ4.codec.uncompress(compressed, buffer, 0, 0, offset + written) - (offset + written);
+            assert(originalSize === LZ4.CHUNK_SIZE);
+            written += LZ4.CHUNK_SIZE;
+            continue;
+          }
           if (compressedData.successes[chunkIndex]) {
             var found = compressedData.cachedIndexes.indexOf(chunkIndex);
             if (found >= 0) {
@@ -141,13 +158,12 @@ mergeInto(LibraryManager.library, {
               //var t = Date.now();
               var originalSize = LZ4.codec.uncompress(compressed, currChunk);
               //console.log('decompress time: ' + (Date.now() - t));
-              if (chunkIndex < compressedData.successes.length-1) assert(originalSize === LZ4.CHUNK_SIZE); // all but the last chunk must be full-size
+              if (!compressedData.fileChunks && chunkIndex < compressedData.successes.length-1) assert(originalSize === LZ4.CHUNK_SIZE); // all but the last chunk must be full-size
             }
           } else {
             // uncompressed
             currChunk = compressedData.data.subarray(compressedStart, compressedStart + LZ4.CHUNK_SIZE);
           }
-          var startInChunk = start % LZ4.CHUNK_SIZE;
           var endInChunk = Math.min(startInChunk + desired, LZ4.CHUNK_SIZE);
           buffer.set(currChunk.subarray(startInChunk, endInChunk), offset + written);
           var currWritten = endInChunk - startInChunk;
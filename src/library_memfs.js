@@ -100,44 +100,71 @@ mergeInto(LibraryManager.library, {
     // Given a file node, returns its file data converted to a typed array.
     getFileDataAsTypedArray: function(node) {
       if (!node.contents) return new Uint8Array;
+#if MEMFS_HEAP_FILE_SIZE
+      if (node.heapStorage) return new Uint8Array(node.contents.subarray(0, node.usedBytes)); // Copy, as the heap storage can be freed, and a view would keep the whole heap alive.
+#endif
       if (node.contents.subarray) return node.contents.subarray(0, node.usedBytes); // Make sure to not return excess unused bytes.
       return new Uint8Array(node.contents);
     },
 
+#if MEMFS_HEAP_FILE_SIZE
+    // Moves the contents of the given file into memory allocated from the heap, so that reads copy within the heap, and mmap()
+    // can return a pointer to them. The contents become a property that refreshes the heap view when the heap has changed, and
+    // assigning any other storage to them frees the heap memory, once it is no longer mapped.
+    moveToHeap: function(node) {
+      var size = node.usedBytes;
+      var ptr = _malloc(size);
+      if (!ptr) return; // Keep the file outside the heap.
+      HEAPU8.set(node.contents.subarray(0, size), ptr);
+      var storage = node.heapStorage = { ptr: ptr, size: size, view: HEAPU8.subarray(ptr, ptr + size), mappings: 0, released: false };
+      Object.defineProperty(node, 'contents', {
+        configurable: true,
+        enumerable: true,
+        get: function() {
+          if (storage.view.buffer !== HEAPU8.buffer) storage.view = HEAPU8.subarray(storage.ptr, storage.ptr + storage.size);
+          return storage.view;
+        },
+        set: function(contents) {
+          if (contents && contents.buffer === HEAPU8.buffer && contents.byteOffset >= storage.ptr && contents.byteOffset < storage.ptr + storage.size) {
+            contents = new Uint8Array(contents); // Keep the data of a view into the storage that is about to be freed.
+          }
+          MEMFS.releaseHeapStorage(this);
+          this.contents = contents;
+        }
+      });
+    },
+
+    releaseHeapStorage: function(node) {
+      var storage = node.heapStorage;
+      if (!storage) return;
+      delete node.contents;
+      node.heapStorage = null;
+      storage.released = true;
+      if (!storage.mappings) _free(storage.ptr);
+    },
+#endif
+
     // Allocates a new backing store for the given node so that it can fit at least newSize amount of bytes.
     // May allocate more, to provide automatic geometric increase and amortized linear performance appending writes.
-    // Never shrinks the storage.
+    // Never shrinks the storage. The new storage is always a typed array, also if the file was backed by a regular JS array.
     expandFileStorage: function(node, newCapacity) {
-#if !MEMFS_APPEND_TO_TYPED_ARRAYS
-      // If we are asked to expand the size of a file that already exists, revert to using a standard JS array to store the file
-      // instead of a typed array. This makes resizing the array more flexible because we can just .push() elements at the back to
-      // increase the size.
-      if (node.contents && node.contents.subarray && newCapacity > node.contents.length) {
-        node.contents = MEMFS.getFileDataAsRegularArray(node);
-        node.usedBytes = node.contents.length; // We might be writing to a lazy-loaded file which had overridden this property, so force-reset it.
-      }
-#endif
-
-      if (!node.contents || node.contents.subarray) { // Keep using a typed array if creating a new storage, or if old one was a typed array as well.
-        var prevCapacity = node.contents ? node.contents.length : 0;
-        if (prevCapacity >= newCapacity) return; // No need to expand, the storage was already large enough.
-        // Don't expand strictly to the given requested limit if it's only a very small increase, but instead geometrically grow capacity.
-        // For small filesizes (<1MB), perform size*2 geometric increase, but for large sizes, do a much more conservative size*1.125 increase to
-        // avoid overshooting the allocation cap by a very large margin.
-        var CAPACITY_DOUBLING_MAX = 1024 * 1024;
-        newCapacity = Math.max(newCapacity, (prevCapacity * (prevCapacity < CAPACITY_DOUBLING_MAX ? 2.0 : 1.125)) | 0);
-        if (prevCapacity != 0) newCapacity = Math.max(newCapacity, 256); // At minimum allocate 256b for each file when expanding.
-        var oldContents = node.contents;
-        node.contents = new Uint8Array(newCapacity); // Allocate new storage.
-        if (node.usedBytes > 0) node.contents.set(oldContents.subarray(0, node.usedBytes), 0); // Copy old data over to the new storage.
-        return;
-      }
-      // Not using a typed array to back the file storage. Use a standard JS array instead.
-      if (!node.contents && newCapacity > 0) node.contents = [];
-      while (node.contents.length < newCapacity) node.contents.push(0);
+      var prevCapacity = node.contents ? node.contents.length : 0;
+      if (prevCapacity >= newCapacity && (!node.contents || node.contents.subarray)) return; // No need to expand, the storage was already large enough.
+      // Don't expand strictly to the given requested limit if it's only a very small increase, but instead geometrically grow capacity.
+      // For small filesizes (<1MB), perform size*2 geometric increase, but for large sizes, do a much more conservative size*1.125 increase to
+      // avoid overshooting the allocation cap by a very large margin.
+      var CAPACITY_DOUBLING_MAX = 1024 * 1024;
+      newCapacity = Math.max(newCapacity, (prevCapacity * (prevCapacity < CAPACITY_DOUBLING_MAX ? 2.0 : 1.125)) | 0);
+      if (prevCapacity != 0) newCapacity = Math.max(newCapacity, 256); // At minimum allocate 256b for each file when expanding.
+      var oldContents = node.contents;
+      var newContents = new Uint8Array(newCapacity); // Allocate new storage.
+      if (node.usedBytes > 0) newContents.set(oldContents.subarray ? oldContents.subarray(0, node.usedBytes) : oldContents.slice(0, node.usedBytes), 0); // Copy old data over to the new storage.
+      node.contents = newContents;
     },
 
-    // Performs an exact resize of the backing file storage to the given size, if the size is not exactly this, the storage is fully reallocated.
+    // Resizes the file to the given size. Growing within the capacity of the backing store only clears the new bytes, so a file
+    // that is first truncated to its final size can then be written to without reallocating. Shrinking fully reallocates the
+    // storage to release the memory.
     resizeFileStorage: function(node, newSize) {
       if (node.usedBytes == newSize) return;
       if (newSize == 0) {
@@ -145,19 +172,18 @@ mergeInto(LibraryManager.library, {
         node.usedBytes = 0;
         return;
       }
-      if (!node.contents || node.contents.subarray) { // Resize a typed array if that is being used as the backing store.
-        var oldContents = node.contents;
-        node.contents = new Uint8Array(new ArrayBuffer(newSize)); // Allocate new storage.
-        if (oldContents) {
-          node.contents.set(oldContents.subarray(0, Math.min(newSize, node.usedBytes))); // Copy old data over to the new storage.
-        }
+      if (newSize > node.usedBytes && node.contents && node.contents.subarray && newSize <= node.contents.length) {
+        for (var i = node.usedBytes; i < newSize; ++i) node.contents[i] = 0;
         node.usedBytes = newSize;
         return;
       }
-      // Backing with a JS array.
-      if (!node.contents) node.contents = [];
-      if (node.contents.length > newSize) node.contents.length = newSize;
-      else while (node.contents.length < newSize) node.contents.push(0);
+      var oldContents = node.contents;
+      var newContents = new Uint8Array(new ArrayBuffer(newSize)); // Allocate new storage.
+      if (oldContents) {
+        var size = Math.min(newSize, node.usedBytes);
+        newContents.set(oldContents.subarray ? oldContents.subarray(0, size) : oldContents.slice(0, size)); // Copy old data over to the new storage.
+      }
+      node.contents = newContents;
       node.usedBytes = newSize;
     },
 
@@ -221,6 +247,10 @@ mergeInto(LibraryManager.library, {
             }
           }
         }
+#if MEMFS_HEAP_FILE_SIZE
+        var replaced = new_dir.contents[new_name];
+        if (replaced && replaced !== old_node) MEMFS.releaseHeapStorage(replaced);
+#endif
         // do the internal rewiring
         delete old_node.parent.contents[old_node.name];
         old_node.name = new_name;
@@ -228,6 +258,9 @@ mergeInto(LibraryManager.library, {
         old_node.parent = new_dir;
       },
       unlink: function(parent, name) {
+#if MEMFS_HEAP_FILE_SIZE
+        MEMFS.releaseHeapStorage(parent.contents[name]);
+#endif
         delete parent.contents[name];
       },
       rmdir: function(parent, name) {
@@ -261,10 +294,20 @@ mergeInto(LibraryManager.library, {
     },
     stream_ops: {
       read: function(stream, buffer, offset, length, position) {
+#if MEMFS_HEAP_FILE_SIZE
+        var node = stream.node;
+        if (!node.heapStorage && node.usedBytes >= {{{ MEMFS_HEAP_FILE_SIZE }}} && node.contents && node.contents.subarray && buffer.buffer === HEAPU8.buffer) MEMFS.moveToHeap(node);
+#endif
         var contents = stream.node.contents;
         if (position >= stream.node.usedBytes) return 0;
         var size = Math.min(stream.node.usedBytes - position, length);
         assert(size >= 0);
+#if MEMFS_HEAP_FILE_SIZE
+        if (contents.buffer === buffer.buffer && buffer.BYTES_PER_ELEMENT === 1) { // Both in the heap, so this is a memcpy.
+          buffer.copyWithin(offset, contents.byteOffset - buffer.byteOffset + position, contents.byteOffset - buffer.byteOffset + position + size);
+          return size;
+        }
+#endif
         if (size > 8 && contents.subarray) { // non-trivial, and typed array
           buffer.set(contents.subarray(position, position + size), offset);
         } else {
@@ -292,24 +335,21 @@ mergeInto(LibraryManager.library, {
             node.contents = buffer.subarray(offset, offset + length);
             node.usedBytes = length;
             return length;
+          } else if (node.contents && position + length <= node.contents.length) { // Writing within the allocated storage, e.g. to an already used subrange of the file, or to space that was reserved for it?
+            node.contents.set(buffer.subarray(offset, offset + length), position);
+            node.usedBytes = Math.max(node.usedBytes, position + length);
+            return length;
           } else if (node.usedBytes === 0 && position === 0) { // If this is a simple first write to an empty file, do a fast set since we don't need to care about old data.
             node.contents = new Uint8Array(buffer.subarray(offset, offset + length));
             node.usedBytes = length;
             return length;
-          } else if (position + length <= node.usedBytes) { // Writing to an already allocated and used subrange of the file?
-            node.contents.set(buffer.subarray(offset, offset + length), position);
-            return length;
           }
         }
 
         // Appending to an existing file and we need to reallocate, or source data did not come as a typed array.
         MEMFS.expandFileStorage(node, position+length);
-        if (node.contents.subarray && buffer.subarray) node.contents.set(buffer.subarray(offset, offset + length), position); // Use typed array write if available.
-        else {
-          for (var i = 0; i < length; i++) {
-           node.contents[position + i] = buffer[offset + i]; // Or fall back to manual write if not.
-          }
-        }
+        if (buffer.subarray) node.contents.set(buffer.subarray(offset, offset + length), position);
+        else node.contents.set((offset == 0 && length == buffer.length) ? buffer : buffer.slice(offset, offset + length), position);
         node.usedBytes = Math.max(node.usedBytes, position+length);
         return length;
       },
@@ -328,9 +368,14 @@ mergeInto(LibraryManager.library, {
         }
         return position;
       },
-      allocate: function(stream, offset, length) {
-        MEMFS.expandFileStorage(stream.node, offset + length);
-        stream.node.usedBytes = Math.max(stream.node.usedBytes, offset + length);
+      // With keepSize, only reserves the storage, so that writes up to offset+length do not need to reallocate it.
+      allocate: function(stream, offset, length, keepSize) {
+        var node = stream.node;
+        if (!keepSize && offset + length > node.usedBytes) {
+          MEMFS.resizeFileStorage(node, offset + length);
+        } else {
+          MEMFS.expandFileStorage(node, offset + length);
+        }
       },
       mmap: function(stream, buffer, offset, length, position, prot, flags) {
         if (!FS.isFile(stream.node.mode)) {
@@ -338,6 +383,19 @@ mergeInto(LibraryManager.library, {
         }
         var ptr;
         var allocated;
+#if MEMFS_HEAP_FILE_SIZE
+        var node = stream.node;
+        if (!node.heapStorage && node.usedBytes >= {{{ MEMFS_HEAP_FILE_SIZE }}} && node.contents && node.contents.subarray && (buffer === HEAPU8 || buffer.buffer === HEAPU8.buffer)) MEMFS.moveToHeap(node);
+        var storage = node.heapStorage;
+        if (storage && position + length <= storage.size && (!(flags & {{{ cDefine('MAP_PRIVATE') }}}) || !(prot & 2 /* PROT_WRITE */))) {
+          // The file is in the heap, so shared mappings, and private ones that cannot be written to, can point right at it.
+          // The memory stays allocated until the mapping is gone, even if the file changes its storage or is removed.
+          ++storage.mappings;
+          return { ptr: storage.ptr + position, allocated: false, unmap: function() {
+            if (!--storage.mappings && storage.released) _free(storage.ptr);
+          } };
+        }
+#endif
         var contents = stream.node.contents;
         // Only make a new copy when MAP_PRIVATE is specified.
         if ( !(flags & {{{ cDefine('MAP_PRIVATE') }}}) &&
@@ -345,7 +403,7 @@ mergeInto(LibraryManager.library, {
           // We can't emulate MAP_SHARED when the file is not backed by the buffer
           // we're mapping to (e.g. the HEAP buffer).
           allocated = false;
-          ptr = contents.byteOffset;
+          ptr = contents.byteOffset + position;
         } else {
           // Try to avoid unnecessary slices.
           if (position > 0 || position + length < stream.node.usedBytes) {
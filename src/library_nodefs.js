@@ -27,6 +27,18 @@ mergeInto(LibraryManager.library, {
       // Buffer.alloc has been added with Buffer.from together, so check it instead
       return Buffer.alloc ? Buffer.from(arrayBuffer) : new Buffer(arrayBuffer);
     },
+    // Buffer over the whole ArrayBuffer behind the last typed array that was read into or written from. Reads and writes
+    // almost always go to the heap, so this avoids creating a new Buffer object per syscall; the Buffer shares the memory
+    // of the ArrayBuffer, so node reads and writes the data in place.
+    lastArrayBuffer: null,
+    lastBuffer: null,
+    bufferFor: function (array) {
+      if (array.buffer !== NODEFS.lastArrayBuffer) {
+        NODEFS.lastBuffer = NODEFS.bufferFrom(array.buffer);
+        NODEFS.lastArrayBuffer = array.buffer;
+      }
+      return NODEFS.lastBuffer;
+    },
     mount: function (mount) {
       assert(ENVIRONMENT_IS_NODE);
       return NODEFS.createNode(null, '/', NODEFS.getMode(mount.opts.root), 0);
@@ -245,14 +257,14 @@ mergeInto(LibraryManager.library, {
         // Node.js < 6 compatibility: node errors on 0 length reads
         if (length === 0) return 0;
         try {
-          return fs.readSync(stream.nfd, NODEFS.bufferFrom(buffer.buffer), offset, length, position);
+          return fs.readSync(stream.nfd, NODEFS.bufferFor(buffer), buffer.byteOffset + offset, length, position);
         } catch (e) {
           throw new FS.ErrnoError(ERRNO_CODES[e.code]);
         }
       },
       write: function (stream, buffer, offset, length, position) {
         try {
-          return fs.writeSync(stream.nfd, NODEFS.bufferFrom(buffer.buffer), offset, length, position);
+          return fs.writeSync(stream.nfd, NODEFS.bufferFor(buffer), buffer.byteOffset + offset, length, position);
         } catch (e) {
           throw new FS.ErrnoError(ERRNO_CODES[e.code]);
         }
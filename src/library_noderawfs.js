@@ -82,7 +82,7 @@ mergeInto(LibraryManager.library, {
         // this stream is created by in-memory filesystem
         return VFS.read(stream, buffer, offset, length, position);
       }
-      var bytesRead = fs.readSync(stream.nfd, NODEFS.bufferFrom(buffer.buffer), offset, length, position);
+      var bytesRead = fs.readSync(stream.nfd, NODEFS.bufferFor(buffer), buffer.byteOffset + offset, length, position);
       // update position marker when non-seeking
       if (typeof position === 'undefined') stream.position += bytesRead;
       return bytesRead;
@@ -96,7 +96,7 @@ mergeInto(LibraryManager.library, {
         // seek to the end before writing in append mode
         FS.llseek(stream, 0, +"{{{ cDefine('SEEK_END') }}}");
       }
-      var bytesWritten = fs.writeSync(stream.nfd, NODEFS.bufferFrom(buffer.buffer), offset, length, position);
+      var bytesWritten = fs.writeSync(stream.nfd, NODEFS.bufferFor(buffer), buffer.byteOffset + offset, length, position);
       // update position marker when non-seeking
       if (typeof position === 'undefined') stream.position += bytesWritten;
       return bytesWritten;
@@ -100,6 +100,9 @@ var LibraryOpenAL = {
     // distinct because of the differing semantics of OpenAL and web audio. Some changes
     // to OpenAL parameters, such as pitch, may require the web audio queue to be flushed and rescheduled.
     scheduleSourceAudio: function(src, lookahead) {
+#if OPENAL_MIXER
+      return; // AL.mixContextAudio() plays the sources.
+#endif
       // See comment on scheduleContextAudio above.
       if (Browser.mainLoop.timingMode === 1 /*EM_TIMING_RAF*/ && document['visibilityState'] != 'visible') {
         return;
@@ -209,6 +212,9 @@ var LibraryOpenAL = {
     // Advance the state of a source forward to the current time
     updateSourceTime: function(src) {
       var currentTime = src.context.audioCtx.currentTime;
+#if OPENAL_MIXER
+      return currentTime; // AL.mixContextAudio() advances the sources as it plays them.
+#endif
       if (src.state !== 0x1012 /* AL_PLAYING */) {
         return currentTime;
       }
@@ -312,6 +318,183 @@ var LibraryOpenAL = {
       return currentTime;
     },
 
+#if OPENAL_MIXER
+    // With OPENAL_MIXER, the sources of each context are mixed into a single ScriptProcessorNode, instead of scheduling
+    // an AudioBufferSourceNode for each buffer that they play. The mixer advances src.bufsProcessed and src.bufOffset
+    // as it goes, and does the distance attenuation and stereo panning of spatialized sources itself.
+    MIXER_BUFFER_SIZE: 2048,
+
+    createMixer: function(ctx) {
+      var ac = ctx.audioCtx;
+      var createScriptProcessor = ac.createScriptProcessor || ac.createJavaScriptNode;
+      // Keep a reference to the node, otherwise some browsers garbage collect it, and it stops calling back.
+      ctx.mixer = createScriptProcessor.call(ac, AL.MIXER_BUFFER_SIZE, 0, 2);
+      ctx.mixer.onaudioprocess = function(e) {
+        AL.mixContextAudio(ctx, e.outputBuffer.getChannelData(0), e.outputBuffer.getChannelData(1));
+      };
+      ctx.mixer.connect(ctx.gain);
+    },
+
+    mixContextAudio: function(ctx, left, right) {
+      for (var i = 0; i < left.length; i++) {
+        left[i] = 0.0;
+        right[i] = 0.0;
+      }
+      for (var i in ctx.sources) {
+        var src = ctx.sources[i];
+        if (src.state === 0x1012 /* AL_PLAYING */) {
+          AL.updateMixerGains(src);
+          AL.mixSourceAudio(src, left, right);
+        }
+      }
+    },
+
+    // Adds the next left.length frames of the given playing source to the output, and advances the source past them.
+    mixSourceAudio: function(src, left, right) {
+      var outputRate = src.context.audioCtx.sampleRate;
+      var gainL = src.mixerGainL;
+      var gainR = src.mixerGainR;
+      var frame = 0;
+      var skipCount = 0;
+      while (frame < left.length) {
+        if (src.bufsProcessed >= src.bufQueue.length) {
+          if (src.looping) {
+            src.bufsProcessed %= src.bufQueue.length;
+          } else {
+            AL.setSourceState(src, 0x1014 /* AL_STOPPED */);
+            return;
+          }
+        }
+
+        var buf = src.bufQueue[src.bufsProcessed];
+        // If the buffer contains no data, skip it
+        if (buf.length === 0) {
+          src.bufsProcessed++;
+          src.bufOffset = 0.0;
+          // If we've gone through the whole queue and everything is 0 length, just give up
+          if (++skipCount >= src.bufQueue.length) {
+            return;
+          }
+          continue;
+        }
+        skipCount = 0;
+
+        var audioBuf = buf.audioBuf;
+        var data0 = audioBuf.getChannelData(0);
+        var data1 = audioBuf.numberOfChannels > 1 ? audioBuf.getChannelData(1) : data0;
+        var last = audioBuf.length - 1;
+        // Positions and steps are in frames of the buffer, and are interpolated linearly between them.
+        var step = src.playbackRate * audioBuf.sampleRate / outputRate;
+        var pos = src.bufOffset * audioBuf.sampleRate;
+        var end = audioBuf.length;
+        var loopStart = 0;
+        var loop = src.type === 0x1028 /* AL_STATIC */ && src.looping;
+        if (loop && (audioBuf._loopStart || audioBuf._loopEnd)) {
+          loopStart = (audioBuf._loopStart || 0.0) * audioBuf.sampleRate;
+          if (audioBuf._loopEnd > audioBuf._loopStart) {
+            end = Math.min(audioBuf._loopEnd * audioBuf.sampleRate, end);
+          }
+        }
+
+        for (; frame < left.length; frame++) {
+          if (pos >= end) {
+            if (!loop) {
+              break;
+            }
+            pos = loopStart + (pos - end) % (end - loopStart);
+          }
+          var i0 = pos | 0;
+          var i1 = i0 < last ? i0 + 1 : last;
+          var frac = pos - i0;
+          var s0 = data0[i0] + (data0[i1] - data0[i0]) * frac;
+          var s1 = data1[i0] + (data1[i1] - data1[i0]) * frac;
+          if (src.mixerSpatialized) {
+            // Spatialized sources are mixed down to mono, and panned by their position.
+            s0 = s1 = (s0 + s1) * 0.5;
+          }
+          left[frame] += s0 * gainL;
+          right[frame] += s1 * gainR;
+          pos += step;
+        }
+
+        if (pos >= end && !loop) {
+          src.bufsProcessed++;
+          src.bufOffset = 0.0;
+        } else {
+          src.bufOffset = pos / audioBuf.sampleRate;
+        }
+      }
+    },
+
+    // Computes the gains of the left and right channels of the given source, from its gain and, if it is spatialized,
+    // its distance and direction from the listener.
+    updateMixerGains: function(src) {
+      var gain = src.gain.gain.value;
+      src.mixerSpatialized = src.spatialize === 1 /* AL_TRUE */ || (src.spatialize === 2 /* AL_AUTO_SOFT */ && src.mixerMono);
+      if (!src.mixerSpatialized) {
+        src.mixerGainL = src.mixerGainR = gain;
+        return;
+      }
+
+      var listener = src.context.audioCtx.listener;
+      var dX = src.mixerPosition[0] - listener._position[0];
+      var dY = src.mixerPosition[1] - listener._position[1];
+      var dZ = src.mixerPosition[2] - listener._position[2];
+      var dist = Math.sqrt(dX * dX + dY * dY + dZ * dZ);
+
+      // Distance attenuation as specified by OpenAL 1.1.
+      // Use the source's distance model if AL_SOURCE_DISTANCE_MODEL is enabled
+      var distanceModel = src.context.sourceDistanceModel ? src.distanceModel : src.context.distanceModel;
+      var refDistance = src.refDistance;
+      var maxDistance = src.maxDistance;
+      var rolloff = src.rolloffFactor;
+      var d = dist;
+      switch (distanceModel) {
+      case 0xd002 /* AL_INVERSE_DISTANCE_CLAMPED */:
+      case 0xd004 /* AL_LINEAR_DISTANCE_CLAMPED */:
+      case 0xd006 /* AL_EXPONENT_DISTANCE_CLAMPED */:
+        d = Math.min(Math.max(d, refDistance), maxDistance);
+        break;
+      }
+      switch (distanceModel) {
+      case 0xd001 /* AL_INVERSE_DISTANCE */:
+      case 0xd002 /* AL_INVERSE_DISTANCE_CLAMPED */:
+        if (refDistance > 0.0) {
+          gain *= refDistance / (refDistance + rolloff * (d - refDistance));
+        }
+        break;
+      case 0xd003 /* AL_LINEAR_DISTANCE */:
+      case 0xd004 /* AL_LINEAR_DISTANCE_CLAMPED */:
+        if (maxDistance > refDistance) {
+          gain *= Math.max(0.0, 1.0 - rolloff * (d - refDistance) / (maxDistance - refDistance));
+        }
+        break;
+      case 0xd005 /* AL_EXPONENT_DISTANCE */:
+      case 0xd006 /* AL_EXPONENT_DISTANCE_CLAMPED */:
+        if (refDistance > 0.0 && d > 0.0) {
+          gain *= Math.pow(d / refDistance, -rolloff);
+        }
+        break;
+      }
+
+      // Equal power panning by how far to the right of the listener the source is.
+      var fX = listener._direction[0];
+      var fY = listener._direction[1];
+      var fZ = listener._direction[2];
+      var uX = listener._up[0];
+      var uY = listener._up[1];
+      var uZ = listener._up[2];
+      var rX = fY * uZ - fZ * uY;
+      var rY = fZ * uX - fX * uZ;
+      var rZ = fX * uY - fY * uX;
+      var mag = dist * Math.sqrt(rX * rX + rY * rY + rZ * rZ);
+      var pan = mag > 0.0 ? (dX * rX + dY * rY + dZ * rZ) / mag : 0.0;
+      var angle = (Math.min(Math.max(pan, -1.0), 1.0) + 1.0) * Math.PI / 4.0;
+      src.mixerGainL = gain * Math.cos(angle);
+      src.mixerGainR = gain * Math.sin(angle);
+    },
+#endif
+
     cancelPendingSourceAudio: function(src) {
       AL.updateSourceTime(src);
 
@@ -400,6 +583,12 @@ var LibraryOpenAL = {
           break;
         }
       }
+#if OPENAL_MIXER
+      // AL.updateMixerGains() does the panning.
+      src.mixerMono = templateBuf.channels === 1;
+      AL.updateSourceSpace(src);
+      return;
+#endif
       // Create a panner if AL_SOURCE_SPATIALIZE_SOFT is set to true, or alternatively if it's set to auto and the source is mono
       if (src.spatialize === 1 /* AL_TRUE */ || (src.spatialize === 2 /* AL_AUTO_SOFT */ && templateBuf.channels === 1)) {
         if (src.panner) {
@@ -500,10 +689,16 @@ var LibraryOpenAL = {
     },
 
     updateSourceSpace: function(src) {
+#if OPENAL_MIXER
+      if (src.type === 0x1030 /* AL_UNDETERMINED */) {
+        return;
+      }
+#else
       if (!src.panner) {
         return;
       }
       var panner = src.panner;
+#endif
 
       var posX = src.position[0];
       var posY = src.position[1];
@@ -592,6 +787,11 @@ var LibraryOpenAL = {
         posZ += lPosZ;
       }
 
+#if OPENAL_MIXER
+      src.mixerPosition[0] = posX;
+      src.mixerPosition[1] = posY;
+      src.mixerPosition[2] = posZ;
+#else
       if (panner.positionX) {
         panner.positionX.value = posX;
         panner.positionY.value = posY;
@@ -612,6 +812,7 @@ var LibraryOpenAL = {
 #endif
         panner.setOrientation(dirX, dirY, dirZ);
       }
+#endif
 
       var oldShift = src.dopplerShift;
       var velX = src.velocity[0];
@@ -2179,7 +2380,12 @@ var LibraryOpenAL = {
       attrs: attrs,
       audioCtx: ac,
       sources: [],
+#if OPENAL_MIXER
+      interval: null,
+      mixer: null,
+#else
       interval: setInterval(function() { AL.scheduleContextAudio(ctx); }, AL.QUEUE_INTERVAL),
+#endif
       gain: gain,
       distanceModel: 0xd002 /* AL_INVERSE_DISTANCE_CLAMPED */,
       speedOfSound: 343.3,
@@ -2200,6 +2406,9 @@ var LibraryOpenAL = {
     };
     AL.deviceRefCounts[deviceId]++;
     AL.contexts[ctx.id] = ctx;
+#if OPENAL_MIXER
+    AL.createMixer(ctx);
+#endif
 
     if (hrtf !== null) {
       // Apply hrtf attrib to all contexts for this device
@@ -2231,6 +2440,10 @@ var LibraryOpenAL = {
     if (AL.contexts[contextId].interval) {
       clearInterval(AL.contexts[contextId].interval);
     }
+#if OPENAL_MIXER
+    ctx.mixer.disconnect();
+    ctx.mixer.onaudioprocess = null;
+#endif
     AL.deviceRefCounts[ctx.deviceId]--;
     delete AL.contexts[contextId];
     AL.freeIds.push(contextId);
@@ -2621,7 +2834,9 @@ var LibraryOpenAL = {
         continue;
       }
 
+#if !OPENAL_MIXER
       ctx.interval = setInterval(function() { AL.scheduleContextAudio(ctx); }, AL.QUEUE_INTERVAL);
+#endif
       ctx.audioCtx.resume();
     }
   },
@@ -2843,6 +3058,13 @@ var LibraryOpenAL = {
         coneOuterAngle: 360.0,
         distanceModel: 0xd002 /* AL_INVERSE_DISTANCE_CLAMPED */,
         spatialize: 2 /* AL_AUTO_SOFT */,
+#if OPENAL_MIXER
+        mixerPosition: [0.0, 0.0, 0.0],
+        mixerMono: false,
+        mixerSpatialized: false,
+        mixerGainL: 0.0,
+        mixerGainR: 0.0,
+#endif
 
         get playbackRate() {
           return this.pitch * this.dopplerShift;
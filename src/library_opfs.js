@@ -0,0 +1,268 @@
+mergeInto(LibraryManager.library, {
+  $OPFS__deps: ['$FS', '$MEMFS', '$PATH'],
+  $OPFS: {
+    DIR_MODE: {{{ cDefine('S_IFDIR') }}} | 511 /* 0777 */,
+    FILE_MODE: {{{ cDefine('S_IFREG') }}} | 438 /* 0666 */,
+    ops_table: null,
+    mount: function(mount) {
+      assert(ENVIRONMENT_IS_WORKER, 'OPFS uses synchronous access handles, which are only available in workers');
+      // reuse all of the core MEMFS functionality
+      var root = MEMFS.mount.apply(null, arguments);
+      // access handles of persisted files that were removed or replaced since the last sync, which must be closed
+      // before their entries can be removed.
+      mount.removedHandles = [];
+      OPFS.adoptNode(root);
+      return root;
+    },
+    unmount: function(mount) {
+      mount.removedHandles.forEach(function(handle) { handle['close'](); });
+      mount.removedHandles = [];
+      (function closeHandles(dir) {
+        for (var name in dir.contents) {
+          var node = dir.contents[name];
+          if (FS.isDir(node.mode)) {
+            closeHandles(node);
+          } else if (node.handle) {
+            node.handle['close']();
+            node.handle = null;
+          }
+        }
+      })(mount.root);
+    },
+    // Switches a node created by MEMFS to the ops of OPFS. Directories, and files that have not been persisted yet, behave
+    // as in MEMFS. Persisted files have an access handle in node.handle, and are read and written through it in place.
+    adoptNode: function(node) {
+      if (!OPFS.ops_table) {
+        OPFS.ops_table = {};
+        Object.keys(MEMFS.ops_table).forEach(function(type) {
+          var ops = MEMFS.ops_table[type];
+          var node_ops = {}, stream_ops = {};
+          Object.keys(ops.node).forEach(function(name) { node_ops[name] = ops.node[name]; });
+          Object.keys(ops.stream).forEach(function(name) { stream_ops[name] = ops.stream[name]; });
+          OPFS.ops_table[type] = { node: node_ops, stream: stream_ops };
+        });
+        var ops = OPFS.ops_table;
+        ops.dir.node.mknod = function(parent, name, mode, dev) {
+          var node = MEMFS.node_ops.mknod(parent, name, mode, dev);
+          OPFS.adoptNode(node);
+          return node;
+        };
+        ops.dir.node.symlink = function(parent, newname, oldpath) {
+          var node = MEMFS.node_ops.symlink(parent, newname, oldpath);
+          OPFS.adoptNode(node);
+          return node;
+        };
+        ops.dir.node.rename = function(old_node, new_dir, new_name) {
+          var replaced = new_dir.contents[new_name];
+          MEMFS.node_ops.rename(old_node, new_dir, new_name);
+          if (replaced && replaced !== old_node) OPFS.removeHandle(replaced);
+        };
+        ops.dir.node.unlink = function(parent, name) {
+          var node = parent.contents[name];
+          MEMFS.node_ops.unlink(parent, name);
+          OPFS.removeHandle(node);
+        };
+        for (var name in OPFS.file_node_ops) ops.file.node[name] = OPFS.file_node_ops[name];
+        for (var name in OPFS.file_stream_ops) ops.file.stream[name] = OPFS.file_stream_ops[name];
+      }
+      var ops = OPFS.ops_table[FS.isDir(node.mode) ? 'dir' : FS.isFile(node.mode) ? 'file' : FS.isLink(node.mode) ? 'link' : 'chrdev'];
+      node.node_ops = ops.node;
+      node.stream_ops = ops.stream;
+    },
+    removeHandle: function(node) {
+      // the handle stays open, so streams that are still open on the file keep working until the next sync.
+      if (node.handle) node.mount.removedHandles.push(node.handle);
+    },
+    file_node_ops: {
+      getattr: function(node) {
+        var attr = MEMFS.node_ops.getattr(node);
+        if (node.handle) {
+          attr.size = node.handle['getSize']();
+          attr.blocks = Math.ceil(attr.size / attr.blksize);
+        }
+        return attr;
+      },
+      setattr: function(node, attr) {
+        if (node.handle && attr.size !== undefined) {
+          node.handle['truncate'](attr.size);
+          attr = { mode: attr.mode, timestamp: attr.timestamp };
+        }
+        MEMFS.node_ops.setattr(node, attr);
+      },
+    },
+    file_stream_ops: {
+      read: function(stream, buffer, offset, length, position) {
+        var handle = stream.node.handle;
+        if (!handle) return MEMFS.stream_ops.read(stream, buffer, offset, length, position);
+        return handle['read'](buffer.subarray(offset, offset + length), { 'at': position });
+      },
+      write: function(stream, buffer, offset, length, position, canOwn) {
+        var handle = stream.node.handle;
+        if (!handle) return MEMFS.stream_ops.write(stream, buffer, offset, length, position, canOwn);
+        stream.node.timestamp = Date.now();
+        return handle['write'](buffer.subarray(offset, offset + length), { 'at': position });
+      },
+      llseek: function(stream, offset, whence) {
+        var handle = stream.node.handle;
+        if (!handle) return MEMFS.stream_ops.llseek(stream, offset, whence);
+        var position = offset;
+        if (whence === 1) {  // SEEK_CUR.
+          position += stream.position;
+        } else if (whence === 2) {  // SEEK_END.
+          position += handle['getSize']();
+        }
+        if (position < 0) {
+          throw new FS.ErrnoError(ERRNO_CODES.EINVAL);
+        }
+        return position;
+      },
+      allocate: function(stream, offset, length, keepSize) {
+        var handle = stream.node.handle;
+        if (!handle) return MEMFS.stream_ops.allocate(stream, offset, length, keepSize);
+        // space is not reserved in advance, so only growing the file is meaningful
+        if (!keepSize && offset + length > handle['getSize']()) handle['truncate'](offset + length);
+      },
+      mmap: function(stream, buffer, offset, length, position, prot, flags) {
+        var handle = stream.node.handle;
+        if (!handle) return MEMFS.stream_ops.mmap(stream, buffer, offset, length, position, prot, flags);
+        var ptr = _malloc(length);
+        if (!ptr) {
+          throw new FS.ErrnoError(ERRNO_CODES.ENOMEM);
+        }
+        var read = handle['read'](buffer.subarray(ptr, ptr + length), { 'at': position });
+        buffer.fill(0, ptr + read, ptr + length);
+        return { ptr: ptr, allocated: true };
+      },
+      msync: function(stream, buffer, offset, length, mmapFlags) {
+        if (!stream.node.handle) return MEMFS.stream_ops.msync(stream, buffer, offset, length, mmapFlags);
+        if (mmapFlags & {{{ cDefine('MAP_PRIVATE') }}}) {
+          // MAP_PRIVATE calls need not to be synced back to underlying fs
+          return 0;
+        }
+        OPFS.file_stream_ops.write(stream, buffer, 0, length, offset);
+        return 0;
+      },
+      fsync: function(stream) {
+        if (stream.node.handle) stream.node.handle['flush']();
+      },
+    },
+
+    // Returns a promise of the entries of an OPFS directory.
+    entries: function(dirHandle) {
+      var iterator = dirHandle['values']();
+      var entries = [];
+      function next() {
+        return iterator.next().then(function(result) {
+          if (result.done) return entries;
+          entries.push(result.value);
+          return next();
+        });
+      }
+      return next();
+    },
+    // Returns a promise that opens an access handle for a file in OPFS, and makes the node read and write through it.
+    openHandle: function(node, fileHandle, path) {
+      return fileHandle['createSyncAccessHandle']().then(function(handle) {
+        node.handle = handle;
+        node.opfsPath = path;
+        node.contents = null;
+        node.usedBytes = 0;
+        return handle;
+      });
+    },
+    syncfs: function(mount, populate, callback) {
+      var root = mount.opts.root ? Promise.resolve(mount.opts.root) : navigator['storage']['getDirectory']();
+      root.then(function(root) {
+        return populate ? OPFS.populate(root, mount.root, '') : OPFS.persist(mount, root);
+      }).then(function() {
+        callback(null);
+      }, function(e) {
+        callback(e);
+      });
+    },
+    // Creates the nodes of the files and directories in an OPFS directory that are not in memory yet. The data of the
+    // files is not read, they are opened and read and written through their access handles from then on.
+    populate: function(dirHandle, dir, path) {
+      return OPFS.entries(dirHandle).then(function(entries) {
+        return Promise.all(entries.map(function(entry) {
+          var name = entry.name;
+          var entryPath = PATH.join2(path, name);
+          var node = dir.contents[name];
+          if (entry['kind'] === 'directory') {
+            if (node && !FS.isDir(node.mode)) return;
+            if (!node) node = dir.node_ops.mknod(dir, name, OPFS.DIR_MODE, 0);
+            return OPFS.populate(entry, node, entryPath);
+          }
+          if (node && (!FS.isFile(node.mode) || node.handle)) return;
+          if (!node) node = dir.node_ops.mknod(dir, name, OPFS.FILE_MODE, 0);
+          // what is in OPFS wins over a file of the same name that was only in memory
+          return OPFS.openHandle(node, entry, entryPath);
+        }));
+      });
+    },
+    // Makes OPFS match what is in memory: removes what is not there any more, creates the new directories, and writes the
+    // files that were only in memory, which are read and written through their access handles from then on.
+    persist: function(mount, root) {
+      mount.removedHandles.forEach(function(handle) { handle['close'](); });
+      mount.removedHandles = [];
+      OPFS.detachMovedFiles(mount.root, '');
+      return OPFS.removeStale(root, mount.root).then(function() {
+        return OPFS.writeTree(root, mount.root, '');
+      });
+    },
+    // Files renamed since they were persisted are read back into memory and closed, to be written at their new path.
+    detachMovedFiles: function(dir, path) {
+      for (var name in dir.contents) {
+        var node = dir.contents[name];
+        var nodePath = PATH.join2(path, name);
+        if (FS.isDir(node.mode)) {
+          OPFS.detachMovedFiles(node, nodePath);
+        } else if (node.handle && node.opfsPath !== nodePath) {
+          var handle = node.handle;
+          var contents = new Uint8Array(handle['getSize']());
+          handle['read'](contents, { 'at': 0 });
+          handle['close']();
+          node.handle = null;
+          node.contents = contents;
+          node.usedBytes = contents.length;
+        }
+      }
+    },
+    removeStale: function(dirHandle, dir) {
+      return OPFS.entries(dirHandle).then(function(entries) {
+        return Promise.all(entries.map(function(entry) {
+          var node = dir && dir.contents[entry.name];
+          var isDir = entry['kind'] === 'directory';
+          if (node && isDir && FS.isDir(node.mode)) return OPFS.removeStale(entry, node);
+          if (node && !isDir && FS.isFile(node.mode)) return;
+          return dirHandle['removeEntry'](entry.name, { 'recursive': true });
+        }));
+      });
+    },
+    writeTree: function(dirHandle, dir, path) {
+      return Promise.all(Object.keys(dir.contents).map(function(name) {
+        var node = dir.contents[name];
+        var nodePath = PATH.join2(path, name);
+        if (FS.isDir(node.mode)) {
+          return dirHandle['getDirectoryHandle'](name, { 'create': true }).then(function(subdirHandle) {
+            return OPFS.writeTree(subdirHandle, node, nodePath);
+          });
+        }
+        // symlinks and devices only live in memory
+        if (!FS.isFile(node.mode)) return;
+        if (node.handle) {
+          node.handle['flush']();
+          return;
+        }
+        return dirHandle['getFileHandle'](name, { 'create': true }).then(function(fileHandle) {
+          var contents = MEMFS.getFileDataAsTypedArray(node);
+          return OPFS.openHandle(node, fileHandle, nodePath).then(function(handle) {
+            handle['truncate'](0);
+            handle['write'](contents, { 'at': 0 });
+            handle['flush']();
+          });
+        });
+      }));
+    },
+  }
+});
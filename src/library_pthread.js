@@ -1,6 +1,10 @@
 var LibraryPThread = {
   $PThread__postset: 'if (!ENVIRONMENT_IS_PTHREAD) PThread.initMainThreadBlock();',
+#if PTHREADS_PROFILING
+  $PThread__deps: ['$PROCINFO', '_register_pthread_ptr', 'emscripten_main_thread_process_queued_calls', 'emscripten_get_now'],
+#else
   $PThread__deps: ['$PROCINFO', '_register_pthread_ptr', 'emscripten_main_thread_process_queued_calls'],
+#endif
   $PThread: {
     MAIN_THREAD_ID: 1, // A special constant that identifies the main JS thread ID.
     mainThreadInfo: {
@@ -10,6 +14,8 @@ var LibraryPThread = {
     // Since creating a new Web Worker is so heavy (it must reload the whole compiled script page!), maintain a pool of such
     // workers that have already parsed and loaded the scripts.
     unusedWorkerPool: [],
+    // True when an event loop callback is pending to top up the pool, see replenishUnusedWorkers().
+    replenishScheduled: false,
     // The currently executing pthreads.
     runningWorkers: [],
     // Points to a pthread_t structure in the Emscripten main heap, allocated on demand if/when first needed.
@@ -34,8 +40,14 @@ var LibraryPThread = {
       Atomics.store(HEAPU32, (PThread.mainThreadBlock + {{{ C_STRUCTS.pthread.tsd }}} ) >> 2, tlsMemory); // Init thread-local-storage memory array.
       Atomics.store(HEAPU32, (PThread.mainThreadBlock + {{{ C_STRUCTS.pthread.tid }}} ) >> 2, PThread.mainThreadBlock); // Main thread ID.
       Atomics.store(HEAPU32, (PThread.mainThreadBlock + {{{ C_STRUCTS.pthread.pid }}} ) >> 2, PROCINFO.pid); // Process ID.
+      Atomics.store(HEAPU32, (PThread.mainThreadBlock + {{{ C_STRUCTS.pthread.isMainRuntimeThread }}} ) >> 2, 1);
 
 #if PTHREADS_PROFILING
+#if PTHREADS_PROFILING_TIMELINE
+      PthreadWorkerInit.threadTimeline = PThread.timeline = allocate(8 + {{{ PTHREADS_PROFILING_TIMELINE }}} * 24, "i32*", ALLOC_STATIC);
+      Module['getThreadTimeline'] = PThread.getThreadTimeline;
+      Module['getThreadTimelineTrace'] = PThread.getThreadTimelineTrace;
+#endif
       PThread.createProfilerBlock(PThread.mainThreadBlock);
       PThread.setThreadName(PThread.mainThreadBlock, "Browser main thread");
       PThread.setThreadStatus(PThread.mainThreadBlock, {{{ cDefine('EM_THREAD_STATUS_RUNNING') }}});
@@ -73,9 +85,74 @@ var LibraryPThread = {
         HEAPF64[((profilerBlock + {{{ C_STRUCTS.thread_profiler_block.timeSpentInStatus }}} ) >> 3) + prevStatus] += duration;
         Atomics.store(HEAPU32, (profilerBlock + {{{ C_STRUCTS.thread_profiler_block.threadStatus }}} ) >> 2, newStatus);
         HEAPF64[(profilerBlock + {{{ C_STRUCTS.thread_profiler_block.currentStatusStartTime }}} ) >> 3] = now;
+#if PTHREADS_PROFILING_TIMELINE
+        PThread.recordThreadStatus(pthreadPtr, newStatus);
+#endif
+      }
+    },
+
+#if PTHREADS_PROFILING_TIMELINE
+    // The timeline of the status changes of all threads, a ring of PTHREADS_PROFILING_TIMELINE records in the heap
+    // that keeps the most recent ones. A header of the number of records written and a padding word is followed by
+    // records of 24 bytes (seq, pthread_t, status, padding, time). Any thread may write a record: it reserves one by
+    // incrementing the count, and publishes it by storing its sequence number, so that readers skip the records that
+    // are being written. Times are from emscripten_get_now(), which agrees between threads.
+    timeline: 0,
+
+    recordThreadStatus: function(pthreadPtr, status) {
+      if (!PThread.timeline) PThread.timeline = PthreadWorkerInit.threadTimeline;
+      var index = Atomics.add(HEAPU32, PThread.timeline >> 2, 1);
+      var r = PThread.timeline + 8 + (index % {{{ PTHREADS_PROFILING_TIMELINE }}}) * 24;
+      Atomics.store(HEAPU32, r >> 2, 0);
+      Atomics.store(HEAPU32, (r >> 2) + 1, pthreadPtr);
+      Atomics.store(HEAPU32, (r >> 2) + 2, status);
+      HEAPF64[(r >> 3) + 2] = _emscripten_get_now();
+      Atomics.store(HEAPU32, r >> 2, index + 1);
+    },
+
+    // Returns the recorded status changes, oldest first, as objects { time, thread, name, status }.
+    getThreadTimeline: function() {
+      var timeline = PThread.timeline;
+      var count = Atomics.load(HEAPU32, timeline >> 2);
+      var first = Math.max(0, count - {{{ PTHREADS_PROFILING_TIMELINE }}});
+      var records = [];
+      var names = {};
+      for (var i = first; i < count; ++i) {
+        var r = timeline + 8 + (i % {{{ PTHREADS_PROFILING_TIMELINE }}}) * 24;
+        if (Atomics.load(HEAPU32, r >> 2) !== i + 1) continue; // being written, or already overwritten
+        var thread = Atomics.load(HEAPU32, (r >> 2) + 1);
+        var status = Atomics.load(HEAPU32, (r >> 2) + 2);
+        var time = HEAPF64[(r >> 3) + 2];
+        if (Atomics.load(HEAPU32, r >> 2) !== i + 1) continue;
+        if (!(thread in names)) names[thread] = PThread.getThreadName(thread);
+        records.push({ 'time': time, 'thread': thread, 'name': names[thread], 'status': PThread.threadStatusToString(status) });
       }
+      return records;
     },
 
+    // Returns the timeline as the JSON of the Chrome trace event format, with a track for each thread and a slice
+    // for each status, which loads into chrome://tracing and Perfetto (ui.perfetto.dev).
+    getThreadTimelineTrace: function() {
+      var records = PThread.getThreadTimeline();
+      var events = [];
+      var open = {};
+      for (var i = 0; i < records.length; ++i) {
+        var r = records[i];
+        if (!(r['thread'] in open)) {
+          events.push({ 'ph': 'M', 'name': 'thread_name', 'pid': 1, 'tid': r['thread'],
+                        'args': { 'name': r['name'] || '0x' + r['thread'].toString(16) } });
+        }
+        var prev = open[r['thread']];
+        if (prev) {
+          events.push({ 'ph': 'X', 'name': prev['status'], 'pid': 1, 'tid': r['thread'],
+                        'ts': prev['time'] * 1000, 'dur': (r['time'] - prev['time']) * 1000 });
+        }
+        open[r['thread']] = r;
+      }
+      return JSON.stringify({ 'traceEvents': events, 'displayTimeUnit': 'ms' });
+    },
+#endif
+
     // Unconditionally sets the thread status.
     setThreadStatus: function(pthreadPtr, newStatus) {
       PThread.setThreadStatusConditional(pthreadPtr, -1, newStatus);
@@ -136,6 +213,9 @@ var LibraryPThread = {
         var profilerBlock = Atomics.load(HEAPU32, (threadInfoStruct + {{{ C_STRUCTS.pthread.profilerBlock }}} ) >> 2);
         Atomics.store(HEAPU32, (threadInfoStruct + {{{ C_STRUCTS.pthread.profilerBlock }}} ) >> 2, 0);
         _free(profilerBlock);
+#endif
+#if SAMPLING_PROFILER
+        SamplingProfiler.threadExit();
 #endif
         Atomics.store(HEAPU32, (tb + {{{ C_STRUCTS.pthread.threadExitCode }}} ) >> 2, exitCode);
         // When we publish this, the main thread is free to deallocate the thread object and we are done.
@@ -184,6 +264,9 @@ var LibraryPThread = {
 
     threadCancel: function() {
       PThread.runExitHandlers();
+#if SAMPLING_PROFILER
+      SamplingProfiler.threadExit();
+#endif
       Atomics.store(HEAPU32, (threadInfoStruct + {{{ C_STRUCTS.pthread.threadExitCode }}} ) >> 2, -1/*PTHREAD_CANCELED*/);
       Atomics.store(HEAPU32, (threadInfoStruct + {{{ C_STRUCTS.pthread.threadStatus }}} ) >> 2, 1); // Mark the thread as no longer running.
       _emscripten_futex_wake(threadInfoStruct + {{{ C_STRUCTS.pthread.threadStatus }}}, {{{ cDefine('INT_MAX') }}}); // wake all threads
@@ -244,6 +327,30 @@ var LibraryPThread = {
 #endif
     },
 
+    // Delivers a message of emscripten_channel_post() to the JS handler of its channel.
+    receiveChannelMessage: function(d) {
+      var handler = Module['pthreadChannelHandlers'] && Module['pthreadChannelHandlers'][d.channel];
+      var bytes = d.buffer ? new Uint8Array(d.buffer) : HEAPU8.subarray(d.ptr, d.ptr + d.numBytes);
+      try {
+        if (handler) handler(bytes);
+        else Module['printErr']('No handler in Module.pthreadChannelHandlers for channel ' + d.channel + ', dropping a message of ' + bytes.length + ' bytes!');
+      } finally {
+        if (!d.buffer) _free(d.ptr);
+      }
+    },
+
+#if ALLOW_MEMORY_GROWTH
+    // Called on the main thread after memory has grown, to have the JS views of memory refreshed in all threads.
+    // Each worker does so when it handles the message (see src/pthread-main.js), which a busy worker does
+    // only once it returns to its event loop; until then, its JS code sees the heap at its old size.
+    refreshWorkerMemoryViews: function() {
+      for (var t in PThread.pthreads) {
+        var pthread = PThread.pthreads[t];
+        if (pthread && pthread.worker) pthread.worker.postMessage({ cmd: 'refreshMemoryViews' });
+      }
+    },
+
+#endif
     // Allocates the given amount of new web workers and stores them in the pool of unused workers.
     // onFinishedLoading: A callback function that will be called once all of the workers have been initialized and are
     //                    ready to host pthreads. Optional. This is used to mitigate bug https://bugzilla.mozilla.org/show_bug.cgi?id=1049079
@@ -265,6 +372,9 @@ var LibraryPThread = {
         (function(worker) {
           worker.onmessage = function(e) {
             var d = e.data;
+#if ALLOW_MEMORY_GROWTH
+            refreshMemoryViews(); // The worker may pass pointers into memory that it has grown.
+#endif
             // TODO: Move the proxied call mechanism into a queue inside heap.
             if (d.proxiedCall) {
               var returnValue;
@@ -348,6 +458,12 @@ var LibraryPThread = {
               PThread.unusedWorkerPool.push(worker);
               // TODO: Free if detached.
               PThread.runningWorkers.splice(PThread.runningWorkers.indexOf(worker.pthread), 1); // Not a running Worker anymore.
+#if ALLOW_MEMORY_GROWTH
+            } else if (d.cmd === 'memoryGrown') {
+              PThread.refreshWorkerMemoryViews();
+#endif
+            } else if (d.cmd === 'channelMessage') {
+              PThread.receiveChannelMessage(d);
             } else if (d.cmd === 'objectTransfer') {
               PThread.receiveObjectTransfer(e.data);
             } else if (e.data.target === 'setimmediate') {
@@ -394,8 +510,29 @@ var LibraryPThread = {
 
     getNewWorker: function() {
       if (PThread.unusedWorkerPool.length == 0) PThread.allocateUnusedWorkers(1);
-      if (PThread.unusedWorkerPool.length > 0) return PThread.unusedWorkerPool.pop();
-      else return null;
+      if (PThread.unusedWorkerPool.length == 0) return null;
+      // Prefer a worker that has already loaded, so that the thread can start running right away.
+      var i = PThread.unusedWorkerPool.length - 1;
+      while(i >= 0 && !PThread.unusedWorkerPool[i].loaded) --i;
+      if (i < 0) i = PThread.unusedWorkerPool.length - 1;
+      var worker = PThread.unusedWorkerPool.splice(i, 1)[0];
+      PThread.replenishUnusedWorkers();
+      return worker;
+    },
+
+    // Tops the pool of unused workers back up to PTHREAD_POOL_LOW_WATER_MARK workers. The new workers are allocated from an
+    // event loop callback, off the path of pthread_create(), and load in the background, so that a later burst of
+    // pthread_create() calls finds workers that are ready to run threads.
+    replenishUnusedWorkers: function() {
+#if PTHREAD_POOL_LOW_WATER_MARK > 0
+      if (PThread.replenishScheduled || PThread.unusedWorkerPool.length >= {{{ PTHREAD_POOL_LOW_WATER_MARK }}}) return;
+      PThread.replenishScheduled = true;
+      setTimeout(function() {
+        PThread.replenishScheduled = false;
+        var numMissing = {{{ PTHREAD_POOL_LOW_WATER_MARK }}} - PThread.unusedWorkerPool.length;
+        if (numMissing > 0) PThread.allocateUnusedWorkers(numMissing);
+      }, 0);
+#endif
     },
 
     busySpinWait: function(msecs) {
@@ -531,6 +668,16 @@ var LibraryPThread = {
     return {{{ makeGetValue('__num_logical_cores', 0, 'i32') }}};
   },
 
+  // Returns the number of Workers that -s PTHREAD_POOL_SIZE=N creates before the application starts, or 0 if the
+  // Workers are created on demand.
+  _emscripten_pthread_pool_size: function() {
+#if PTHREAD_POOL_SIZE > 0
+    return {{{ PTHREAD_POOL_SIZE }}};
+#else
+    return 0;
+#endif
+  },
+
   emscripten_force_num_logical_cores: function(cores) {
     {{{ makeSetValue('__num_logical_cores', 0, 'cores', 'i32') }}};
   },
@@ -743,7 +890,7 @@ var LibraryPThread = {
       // In main runtime thread (the thread that initialized the Emscripten C runtime and launched main()), assist pthreads in performing operations
       // that they need to access the Emscripten main runtime for.
       if (!ENVIRONMENT_IS_PTHREAD) _emscripten_main_thread_process_queued_calls();
-      _emscripten_futex_wait(thread + {{{ C_STRUCTS.pthread.threadStatus }}}, threadStatus, ENVIRONMENT_IS_PTHREAD ? 100 : 1);
+      _emscripten_futex_wait(thread + {{{ C_STRUCTS.pthread.threadStatus }}}, threadStatus, ENVIRONMENT_IS_PTHREAD ? 100 : 1, /*noAsync=*/true);
     }
   },
 
@@ -815,10 +962,11 @@ var LibraryPThread = {
   },
 
   _pthread_ptr: 0,
+  _pthread_tsd: 0,
   _pthread_is_main_runtime_thread: 0,
   _pthread_is_main_browser_thread: 0,
 
-  _register_pthread_ptr__deps: ['_pthread_ptr', '_pthread_is_main_runtime_thread', '_pthread_is_main_browser_thread'],
+  _register_pthread_ptr__deps: ['_pthread_ptr', '_pthread_tsd', '_pthread_is_main_runtime_thread', '_pthread_is_main_browser_thread'],
   _register_pthread_ptr__asm: true,
   _register_pthread_ptr__sig: 'viii',
   _register_pthread_ptr: function(pthreadPtr, isMainBrowserThread, isMainRuntimeThread) {
@@ -826,6 +974,9 @@ var LibraryPThread = {
     isMainBrowserThread = isMainBrowserThread|0;
     isMainRuntimeThread = isMainRuntimeThread|0;
     __pthread_ptr = pthreadPtr;
+    // The thread-local storage array of a thread is allocated before the thread starts and stays in place until it
+    // exits, so cache its address for pthread_getspecific() and pthread_setspecific().
+    __pthread_tsd = pthreadPtr ? (HEAP32[(pthreadPtr + {{{ C_STRUCTS.pthread.tsd }}})>>2]|0) : 0;
     __pthread_is_main_browser_thread = isMainBrowserThread;
     __pthread_is_main_runtime_thread = isMainRuntimeThread;
   },
@@ -838,6 +989,32 @@ var LibraryPThread = {
     return __pthread_ptr|0;
   },
 
+  // Thread-specific data is read and written with no FFI call out of the asm.js scope, straight from the cached
+  // thread-local storage array of the calling thread.
+  pthread_getspecific__deps: ['_pthread_tsd'],
+  pthread_getspecific__asm: true,
+  pthread_getspecific__sig: 'ii',
+  pthread_getspecific: function(key) {
+    key = key|0;
+    return HEAP32[(__pthread_tsd + (key << 2))>>2]|0;
+  },
+
+  pthread_setspecific__deps: ['_pthread_ptr', '_pthread_tsd'],
+  pthread_setspecific__asm: true,
+  pthread_setspecific__sig: 'iii',
+  pthread_setspecific: function(key, value) {
+    key = key|0;
+    value = value|0;
+    var slot = 0;
+    slot = (__pthread_tsd + (key << 2))|0;
+    // Avoid dirtying the thread on a redundant store, like musl does.
+    if ((HEAP32[slot>>2]|0) != (value|0)) {
+      HEAP32[slot>>2] = value;
+      HEAP32[(__pthread_ptr + {{{ C_STRUCTS.pthread.tsd_used }}})>>2] = 1;
+    }
+    return 0;
+  },
+
   emscripten_is_main_runtime_thread__asm: true,
   emscripten_is_main_runtime_thread__sig: 'i',
   emscripten_is_main_runtime_thread__deps: ['_pthread_is_main_runtime_thread'],
@@ -948,6 +1125,44 @@ var LibraryPThread = {
     return 0;
   },
 
+  // Calls a function that was proxied with a generic signature (EM_FUNC_SIG_GENERIC), through the dynCall of the
+  // signature that the function has in the function tables. 64-bit arguments are passed to it as two 32-bit halves.
+  _emscripten_call_generic: function(sig, funcPtr, args, returnValue) {
+    var numArgs = sig & 1023;
+    var dynCallSig = '';
+    var dynCallArgs = [funcPtr];
+    for (var i = 0; i < numArgs; ++i) {
+      var arg = args + 8*i;
+      switch ((sig >>> (16 + 2*i)) & 3) {
+        case 0/*EM_FUNC_SIG_TYPE_I*/: dynCallSig += 'i'; dynCallArgs.push(HEAP32[arg >> 2]); break;
+        case 1/*EM_FUNC_SIG_TYPE_J*/: dynCallSig += 'ii'; dynCallArgs.push(HEAP32[arg >> 2], HEAP32[(arg + 4) >> 2]); break;
+#if PRECISE_F32
+        case 2/*EM_FUNC_SIG_TYPE_F*/: dynCallSig += 'f'; dynCallArgs.push(HEAPF32[arg >> 2]); break;
+#else
+        case 2/*EM_FUNC_SIG_TYPE_F*/: dynCallSig += 'd'; dynCallArgs.push(HEAPF32[arg >> 2]); break;
+#endif
+        case 3/*EM_FUNC_SIG_TYPE_D*/: dynCallSig += 'd'; dynCallArgs.push(HEAPF64[arg >> 3]); break;
+      }
+    }
+    if (sig & 1024/*void return*/) {
+      Module['dynCall_v' + dynCallSig].apply(null, dynCallArgs);
+      return;
+    }
+    switch ((sig >> 14) & 3) {
+      case 0/*EM_FUNC_SIG_TYPE_I*/: HEAP32[returnValue >> 2] = Module['dynCall_i' + dynCallSig].apply(null, dynCallArgs); break;
+      case 1/*EM_FUNC_SIG_TYPE_J*/:
+        HEAP32[returnValue >> 2] = Module['dynCall_i' + dynCallSig].apply(null, dynCallArgs);
+        HEAP32[(returnValue + 4) >> 2] = getTempRet0();
+        break;
+#if PRECISE_F32
+      case 2/*EM_FUNC_SIG_TYPE_F*/: HEAPF32[returnValue >> 2] = Module['dynCall_f' + dynCallSig].apply(null, dynCallArgs); break;
+#else
+      case 2/*EM_FUNC_SIG_TYPE_F*/: HEAPF32[returnValue >> 2] = Module['dynCall_d' + dynCallSig].apply(null, dynCallArgs); break;
+#endif
+      case 3/*EM_FUNC_SIG_TYPE_D*/: HEAPF64[returnValue >> 3] = Module['dynCall_d' + dynCallSig].apply(null, dynCallArgs); break;
+    }
+  },
+
   pthread_cleanup_push: function(routine, arg) {
     if (PThread.exitHandlers === null) {
       PThread.exitHandlers = [];
@@ -977,9 +1192,19 @@ var LibraryPThread = {
   // Stores the memory address that the main thread is waiting on, if any.
   _main_thread_futex_wait_address: '; if (ENVIRONMENT_IS_PTHREAD) __main_thread_futex_wait_address = PthreadWorkerInit.__main_thread_futex_wait_address; else PthreadWorkerInit.__main_thread_futex_wait_address = __main_thread_futex_wait_address = allocate(1, "i32*", ALLOC_STATIC)',
 
+  // Per futex address statistics of the waits that the main browser thread has performed, as objects { numWaits, numTimeouts,
+  // numAsyncWaits, totalMsecs, maxMsecs, avgSpins }. Only accessed on the main browser thread.
+  _main_thread_futex_wait_stats: '{}',
+
   // Returns 0 on success, or one of the values -ETIMEDOUT, -EWOULDBLOCK or -EINVAL on error.
-  emscripten_futex_wait__deps: ['_main_thread_futex_wait_address', 'emscripten_main_thread_process_queued_calls'],
-  emscripten_futex_wait: function(addr, val, timeout) {
+  // On the main browser thread, noAsync can be passed to keep the wait synchronous even if PTHREADS_MAIN_THREAD_ASYNC_WAIT is
+  // enabled. Waits started from JS code must pass it, since the async continuation can only resume compiled code.
+#if ASYNCIFY && PTHREADS_MAIN_THREAD_ASYNC_WAIT
+  emscripten_futex_wait__deps: ['_main_thread_futex_wait_address', '_main_thread_futex_wait_stats', 'emscripten_main_thread_process_queued_calls', 'emscripten_async_resume', '__async_retval', '$Browser'],
+#else
+  emscripten_futex_wait__deps: ['_main_thread_futex_wait_address', '_main_thread_futex_wait_stats', 'emscripten_main_thread_process_queued_calls'],
+#endif
+  emscripten_futex_wait: function(addr, val, timeout, noAsync) {
     if (addr <= 0 || addr > HEAP8.length || addr&3 != 0) return -{{{ cDefine('EINVAL') }}};
 //    dump('futex_wait addr:' + addr + ' by thread: ' + _pthread_self() + (ENVIRONMENT_IS_PTHREAD?'(pthread)':'') + '\n');
     if (ENVIRONMENT_IS_WORKER) {
@@ -1000,8 +1225,23 @@ var LibraryPThread = {
       var loadedVal = Atomics.load(HEAP32, addr >> 2);
       if (val != loadedVal) return -{{{ cDefine('EWOULDBLOCK') }}};
 
-      var tNow = performance.now();
-      var tEnd = tNow + timeout;
+      var tStart = performance.now();
+      var tEnd = tStart + timeout;
+
+      var stats = __main_thread_futex_wait_stats[addr];
+      if (!stats) stats = __main_thread_futex_wait_stats[addr] = { numWaits: 0, numTimeouts: 0, numAsyncWaits: 0, totalMsecs: 0, maxMsecs: 0, avgSpins: 0 };
+      var finishWait = function(ret, spins) {
+        var msecs = performance.now() - tStart;
+        ++stats.numWaits;
+        if (ret) ++stats.numTimeouts;
+        stats.totalMsecs += msecs;
+        stats.maxMsecs = Math.max(stats.maxMsecs, msecs);
+        stats.avgSpins += (spins - stats.avgSpins) / 8; // Running average that favors the recent waits.
+#if PTHREADS_PROFILING
+        PThread.setThreadStatusConditional(_pthread_self(), {{{ cDefine('EM_THREAD_STATUS_WAITFUTEX') }}}, {{{ cDefine('EM_THREAD_STATUS_RUNNING') }}});
+#endif
+        return ret;
+      };
 
 #if PTHREADS_PROFILING
       PThread.setThreadStatusConditional(_pthread_self(), {{{ cDefine('EM_THREAD_STATUS_RUNNING') }}}, {{{ cDefine('EM_THREAD_STATUS_WAITFUTEX') }}});
@@ -1011,22 +1251,78 @@ var LibraryPThread = {
       // and on nonzero, the contents of address pointed by __main_thread_futex_wait_address tell which address the main thread is simulating its wait on.
       Atomics.store(HEAP32, __main_thread_futex_wait_address >> 2, addr);
       var ourWaitAddress = addr; // We may recursively re-enter this function while processing queued calls, in which case we'll do a spurious wakeup of the older wait operation.
-      while (addr == ourWaitAddress) {
-        tNow = performance.now();
-        if (tNow > tEnd) {
-#if PTHREADS_PROFILING
-          PThread.setThreadStatusConditional(_pthread_self(), {{{ cDefine('EM_THREAD_STATUS_RUNNING') }}}, {{{ cDefine('EM_THREAD_STATUS_WAITFUTEX') }}});
+#if ASYNCIFY && PTHREADS_MAIN_THREAD_ASYNC_WAIT
+      // Spin only for a bounded number of iterations before yielding to the event loop. The bound adapts to the number of
+      // iterations that the recent waits on this futex needed, so that short critical sections are still waited for synchronously.
+      var maxSpins = noAsync ? Infinity : Math.min(2 * stats.avgSpins + {{{ PTHREADS_MAIN_THREAD_ASYNC_WAIT }}}, 100 * {{{ PTHREADS_MAIN_THREAD_ASYNC_WAIT }}});
 #endif
-          return -{{{ cDefine('ETIMEDOUT') }}};
+      var spins = 0;
+      for (;;) {
+        if (performance.now() > tEnd) {
+          Atomics.compareExchange(HEAP32, __main_thread_futex_wait_address >> 2, ourWaitAddress, 0);
+          return finishWait(-{{{ cDefine('ETIMEDOUT') }}}, spins);
         }
         _emscripten_main_thread_process_queued_calls(); // We are performing a blocking loop here, so must pump any pthreads if they want to perform operations that are proxied.
         addr = Atomics.load(HEAP32, __main_thread_futex_wait_address >> 2); // Look for a worker thread waking us up.
-      }
-#if PTHREADS_PROFILING
-      PThread.setThreadStatusConditional(_pthread_self(), {{{ cDefine('EM_THREAD_STATUS_RUNNING') }}}, {{{ cDefine('EM_THREAD_STATUS_WAITFUTEX') }}});
+        if (!addr) break;
+        ourWaitAddress = addr; // emscripten_futex_wake_or_requeue() may have moved the wait to another address.
+        ++spins;
+#if ASYNCIFY && PTHREADS_MAIN_THREAD_ASYNC_WAIT
+        if (spins >= maxSpins) {
+          // Unwind the calling code, and keep polling the futex from the event loop, until it is woken or the wait times out.
+          ++stats.numAsyncWaits;
+          Module['setAsync']();
+          var pollWait = function() {
+            _emscripten_main_thread_process_queued_calls();
+            var ret = 0;
+            var waitAddress = Atomics.load(HEAP32, __main_thread_futex_wait_address >> 2);
+            if (waitAddress) {
+              if (performance.now() <= tEnd) {
+                Browser.safeSetTimeout(pollWait, 0);
+                return;
+              }
+              Atomics.compareExchange(HEAP32, __main_thread_futex_wait_address >> 2, waitAddress, 0);
+              ret = -{{{ cDefine('ETIMEDOUT') }}};
+            }
+            {{{ makeSetValue('___async_retval', 0, 'finishWait(ret, spins)', 'i32') }}};
+            _emscripten_async_resume();
+          };
+          Browser.safeSetTimeout(pollWait, 0);
+          return 0;
+        }
 #endif
-      return 0;
+      }
+      return finishWait(0, spins);
+    }
+  },
+
+  // Sums up the statistics of the main browser thread futex waits on the addresses in the range [addr, addr+numBytes).
+  emscripten_main_thread_futex_wait_stats__deps: ['_main_thread_futex_wait_stats'],
+  emscripten_main_thread_futex_wait_stats__proxy: 'sync',
+  emscripten_main_thread_futex_wait_stats__sig: 'viii',
+  emscripten_main_thread_futex_wait_stats: function(addr, numBytes, outStats) {
+    var numWaits = 0, numTimeouts = 0, numAsyncWaits = 0, totalMsecs = 0, maxMsecs = 0;
+    for (var a in __main_thread_futex_wait_stats) {
+      if (+a < addr || +a >= addr + numBytes) continue;
+      var stats = __main_thread_futex_wait_stats[a];
+      numWaits += stats.numWaits;
+      numTimeouts += stats.numTimeouts;
+      numAsyncWaits += stats.numAsyncWaits;
+      totalMsecs += stats.totalMsecs;
+      maxMsecs = Math.max(maxMsecs, stats.maxMsecs);
     }
+    {{{ makeSetValue('outStats', C_STRUCTS.em_futex_wait_stats.numWaits, 'numWaits', 'i32') }}};
+    {{{ makeSetValue('outStats', C_STRUCTS.em_futex_wait_stats.numTimeouts, 'numTimeouts', 'i32') }}};
+    {{{ makeSetValue('outStats', C_STRUCTS.em_futex_wait_stats.numAsyncWaits, 'numAsyncWaits', 'i32') }}};
+    {{{ makeSetValue('outStats', C_STRUCTS.em_futex_wait_stats.totalMsecs, 'totalMsecs', 'double') }}};
+    {{{ makeSetValue('outStats', C_STRUCTS.em_futex_wait_stats.maxMsecs, 'maxMsecs', 'double') }}};
+  },
+
+  emscripten_main_thread_reset_futex_wait_stats__deps: ['_main_thread_futex_wait_stats'],
+  emscripten_main_thread_reset_futex_wait_stats__proxy: 'sync',
+  emscripten_main_thread_reset_futex_wait_stats__sig: 'v',
+  emscripten_main_thread_reset_futex_wait_stats: function() {
+    for (var a in __main_thread_futex_wait_stats) delete __main_thread_futex_wait_stats[a];
   },
 
   // Returns the number of threads (>= 0) woken up, or the value -EINVAL on error.
@@ -1057,6 +1353,10 @@ var LibraryPThread = {
     throw 'Atomics.wake returned an unexpected value ' + ret;
   },
 
+  // Wakes up to count waiters on addr, and moves the others to wait on addr2, if the value at addr is cmpValue. This is how
+  // condition variables hand their waiters over to the mutex one at a time, instead of waking them all to contend on it.
+  // SharedArrayBuffer has no requeue operation, so only the wait of the main browser thread, which is simulated, can be moved
+  // to addr2. Workers that would be requeued are woken instead, which futex users must handle like any spurious wakeup.
   // Returns the number of threads (>= 0) woken up, or one of the values -EINVAL or -EAGAIN on error.
   emscripten_futex_wake_or_requeue__deps: ['_main_thread_futex_wait_address'],
   emscripten_futex_wake_or_requeue: function(addr, count, addr2, cmpValue) {
@@ -1064,35 +1364,66 @@ var LibraryPThread = {
       || addr&3 != 0 || addr2&3 != 0) {
       return -{{{ cDefine('EINVAL') }}};
     }
+    if (Atomics.load(HEAP32, addr >> 2) != cmpValue) return -{{{ cDefine('EAGAIN') }}};
 
     // See if main thread is waiting on this address? If so, wake it up by resetting its wake location to zero,
     // or move it to wait on addr2. Note that this is not a fair procedure, since we always wake main thread first before
     // any workers, so this scheme does not adhere to real queue-based waiting.
-    var mainThreadWaitAddress = Atomics.load(HEAP32, __main_thread_futex_wait_address >> 2);
     var mainThreadWoken = 0;
-    if (mainThreadWaitAddress == addr) {
-      // Check cmpValue precondition before taking any action.
-      var val1 = Atomics.load(HEAP32, addr >> 2);
-      if (val1 != cmpValue) return -{{{ cDefine('EAGAIN') }}};
-
-      // If we are actually waking any waiters, then new main thread wait location is reset, otherwise requeue it to wait on addr2.
-      var newMainThreadWaitAddress = (count > 0) ? 0 : addr2;
-      var loadedAddr = Atomics.compareExchange(HEAP32, __main_thread_futex_wait_address >> 2, mainThreadWaitAddress, newMainThreadWaitAddress);
-      if (loadedAddr == mainThreadWaitAddress && count > 0) {
-        --count; // Main thread was woken, so one less workers to wake up.
-        mainThreadWoken = 1;
-      }
+    var newMainThreadWaitAddress = (count > 0) ? 0 : addr2;
+    if (Atomics.compareExchange(HEAP32, __main_thread_futex_wait_address >> 2, addr, newMainThreadWaitAddress) == addr && count > 0) {
+      --count; // Main thread was woken, so one less workers to wake up.
+      mainThreadWoken = 1;
     }
 
-    // Wake any workers waiting on this address.
-    var ret = Atomics.wakeOrRequeue(HEAP32, addr >> 2, count, addr2 >> 2, cmpValue);
-    if (ret == Atomics.NOTEQUAL) return -{{{ cDefine('EAGAIN') }}};
+    // Wake the workers waiting on this address, both the ones to wake and the ones to requeue.
+    var ret = Atomics.wake(HEAP32, addr >> 2, {{{ cDefine('INT_MAX') }}});
     if (ret >= 0) return ret + mainThreadWoken;
-    throw 'Atomics.wakeOrRequeue returned an unexpected value ' + ret;
+    throw 'Atomics.wake returned an unexpected value ' + ret;
   },
 
+  __atomic_is_lock_free__deps: ['_emscripten_has_bigint_atomics'],
   __atomic_is_lock_free: function(size, ptr) {
-    return size <= 4 && (size & (size-1)) == 0 && (ptr&(size-1)) == 0;
+    return (size <= 4 || (size == 8 && __emscripten_has_bigint_atomics())) && (size & (size-1)) == 0 && (ptr&(size-1)) == 0;
+  },
+
+  // A BigUint64Array view of the heap, for the 64-bit atomics of library_pthread_asmjs.c.
+  _bigint_atomics_heap: 'null',
+
+  // Returns 1 if the browser can perform Atomics operations on a BigUint64Array view of the heap.
+  _emscripten_has_bigint_atomics__deps: ['_bigint_atomics_heap'],
+  _emscripten_has_bigint_atomics: function() {
+    if (typeof BigUint64Array === 'undefined') return 0;
+    try {
+      __bigint_atomics_heap = new BigUint64Array(HEAP8.buffer);
+      Atomics.load(__bigint_atomics_heap, 0);
+      return 1;
+    } catch(e) {
+      return 0;
+    }
+  },
+
+  // Performs the 64-bit atomic operation op, one of the EM_ATOMIC_OP_* values in library_pthread_asmjs.c, on the value at addr,
+  // and returns the old value. The compare-exchange operation replaces the value val with val2.
+  _emscripten_atomic_bigint_u64__deps: ['_bigint_atomics_heap'],
+  _emscripten_atomic_bigint_u64: function(op, addr, vall, valh, val2l, val2h) {
+    if (!__bigint_atomics_heap || __bigint_atomics_heap.buffer !== HEAP8.buffer) __bigint_atomics_heap = new BigUint64Array(HEAP8.buffer);
+    var heap = __bigint_atomics_heap, i = addr >> 3, shift = BigInt(32);
+    var val = (BigInt(valh >>> 0) << shift) | BigInt(vall >>> 0);
+    var old;
+    switch(op) {
+      case 0: old = Atomics.load(heap, i); break;
+      case 1: Atomics.store(heap, i, val); old = val; break;
+      case 2: old = Atomics.exchange(heap, i, val); break;
+      case 3: old = Atomics.compareExchange(heap, i, val, (BigInt(val2h >>> 0) << shift) | BigInt(val2l >>> 0)); break;
+      case 4: old = Atomics.add(heap, i, val); break;
+      case 5: old = Atomics.sub(heap, i, val); break;
+      case 6: old = Atomics.and(heap, i, val); break;
+      case 7: old = Atomics.or(heap, i, val); break;
+      case 8: old = Atomics.xor(heap, i, val); break;
+      default: throw 'Invalid 64-bit atomic operation ' + op;
+    }
+    {{{ makeStructuralReturn(['Number(old & BigInt(0xFFFFFFFF)) | 0', 'Number(old >> shift) | 0']) }}};
   },
 
   __call_main: function(argc, argv) {
@@ -1111,6 +1442,23 @@ var LibraryPThread = {
 #endif
   },
 
+  emscripten_channel_post__deps: ['free'],
+  emscripten_channel_post: function(channel, data, numBytes, mode) {
+    var msg = { cmd: 'channelMessage', channel: channel };
+    if (mode == {{{ cDefine('EM_CHANNEL_TRANSFER') }}}) {
+      msg.buffer = new ArrayBuffer(numBytes);
+      new Uint8Array(msg.buffer).set(HEAPU8.subarray(data, data + numBytes));
+    } else if (mode == {{{ cDefine('EM_CHANNEL_HEAP_VIEW') }}}) {
+      msg.ptr = data;
+      msg.numBytes = numBytes;
+    } else {
+      return {{{ cDefine('EMSCRIPTEN_RESULT_INVALID_PARAM') }}};
+    }
+    if (ENVIRONMENT_IS_PTHREAD) postMessage(msg, msg.buffer ? [msg.buffer] : []);
+    else setTimeout(function() { PThread.receiveChannelMessage(msg); }, 0);
+    return {{{ cDefine('EMSCRIPTEN_RESULT_SUCCESS') }}};
+  },
+
   emscripten_set_thread_name_js: function(threadId, name) {
 #if PTHREADS_PROFILING
     PThread.setThreadName(threadId, UTF8ToString(name));
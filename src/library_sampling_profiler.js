@@ -0,0 +1,141 @@
+// The runtime of the sampling CPU profiler of -s SAMPLING_PROFILER.
+//
+// The instrumentShadowStack pass of the native optimizer makes every compiled function push its id on the shadow
+// stack of its thread when called, and pop it when returning. A shadow stack is an int depth followed by a ring of
+// DEPTH ids, so deep recursion overwrites the outermost frames instead of running out of the ring. A sampler worker
+// reads the shadow stacks of all threads through the shared heap every SAMPLING_PROFILER milliseconds, and counts
+// the stacks it sees. The reads are not synchronized with the threads, so a sample may rarely mix up two stacks.
+//
+// Module['getSamplingProfile'](callback) calls back with the counts in the collapsed stack format of flame graph
+// tools (one 'thread;outer;...;inner count' line per stack), which flamegraph.pl and speedscope load directly.
+
+var LibrarySamplingProfiler = {
+  $SamplingProfiler__postset: 'SamplingProfiler.init();',
+  $SamplingProfiler: {
+    // The number of ids in the ring of a shadow stack, which tools/optimizer/optimizer.cpp relies on too.
+    DEPTH: 1024,
+    // The bytes taken by a shadow stack, rounded up to keep thread stacks aligned.
+    STACK_BYTES: 4112,
+    // How many threads can be sampled at the same time, including the main thread.
+    MAX_THREADS: 64,
+
+    // Function id => name, filled in by the js optimizer.
+    names: [],
+    // MAX_THREADS words that hold the shadow stack of each sampled thread, or 0, followed by a word the sampler
+    // waits on between samples. The main thread has the first slot.
+    registry: 0,
+    // The slot of this thread, or -1.
+    slot: -1,
+    worker: null,
+    callbacks: [],
+
+    init: function() {
+      if (ENVIRONMENT_IS_PTHREAD) {
+        SamplingProfiler.registry = PthreadWorkerInit.samplingProfilerRegistry;
+        return;
+      }
+      PthreadWorkerInit.samplingProfilerRegistry = SamplingProfiler.registry = staticAlloc(4 * (SamplingProfiler.MAX_THREADS + 1));
+      shadowStack = staticAlloc(SamplingProfiler.STACK_BYTES);
+      HEAP32[SamplingProfiler.registry >> 2] = shadowStack;
+      SamplingProfiler.slot = 0;
+      Module['getSamplingProfile'] = SamplingProfiler.getProfile;
+      Module['dumpSamplingProfile'] = function() {
+        SamplingProfiler.getProfile(function(profile) { Module.print(profile); });
+      };
+      SamplingProfiler.start();
+    },
+
+    // Called when a pthread starts to run in this worker. Takes the shadow stack off the top of the stack of the
+    // thread, and returns the new stack max.
+    threadStart: function(stackMax) {
+      var stack = (stackMax - SamplingProfiler.STACK_BYTES) & -16;
+      HEAP32[stack >> 2] = 0;
+      shadowStack = stack;
+      setShadowStack(stack);
+      var registry = SamplingProfiler.registry >> 2;
+      for (var i = 1; i < SamplingProfiler.MAX_THREADS; i++) {
+        if (Atomics.compareExchange(HEAP32, registry + i, 0, stack) === 0) {
+          SamplingProfiler.slot = i;
+          break;
+        }
+      }
+      return stack;
+    },
+
+    threadExit: function() {
+      if (SamplingProfiler.slot > 0) {
+        Atomics.store(HEAP32, (SamplingProfiler.registry >> 2) + SamplingProfiler.slot, 0);
+        SamplingProfiler.slot = -1;
+      }
+    },
+
+    start: function() {
+      var source = '(' + SamplingProfiler.sampler.toString() + ')();';
+      var worker = SamplingProfiler.worker = new Worker(URL.createObjectURL(new Blob([source], { type: 'text/javascript' })));
+      worker.onmessage = function(e) {
+        var callback = SamplingProfiler.callbacks.shift();
+        if (callback) callback(SamplingProfiler.collapse(e.data['counts']));
+      };
+      worker.postMessage({ 'buffer': HEAP32.buffer, 'registry': SamplingProfiler.registry, 'threads': SamplingProfiler.MAX_THREADS,
+                           'depth': SamplingProfiler.DEPTH, 'interval': {{{ SAMPLING_PROFILER }}} });
+    },
+
+    // The code of the sampler worker. Samples in slices of 50ms, so that the worker gets to answer requests for the
+    // profile in between.
+    sampler: function() {
+      var heap, registry, threads, depth, interval, counts = {};
+      function sample() {
+        for (var i = 0; i < threads; i++) {
+          var stack = heap[registry + i] >> 2;
+          if (!stack) continue;
+          var top = heap[stack];
+          if (top <= 0) continue;
+          var ids = [i];
+          for (var j = Math.max(0, top - depth); j < top; j++) ids.push(heap[stack + 1 + (j & (depth - 1))]);
+          var key = ids.join(',');
+          counts[key] = (counts[key] | 0) + 1;
+        }
+      }
+      function run() {
+        var end = performance.now() + 50;
+        while (performance.now() < end) {
+          Atomics.wait(heap, registry + threads, 0, interval);
+          sample();
+        }
+        setTimeout(run, 0);
+      }
+      onmessage = function(e) {
+        if (e.data['buffer']) {
+          heap = new Int32Array(e.data['buffer']);
+          registry = e.data['registry'] >> 2;
+          threads = e.data['threads'];
+          depth = e.data['depth'];
+          interval = e.data['interval'];
+          run();
+        } else {
+          postMessage({ 'counts': counts });
+        }
+      };
+    },
+
+    // Turns the counts of the sampler, keyed by the slot and the function ids of each stack, into collapsed stacks.
+    collapse: function(counts) {
+      var names = SamplingProfiler.names;
+      var lines = [];
+      for (var key in counts) {
+        var ids = key.split(',');
+        var frames = [ids[0] == 0 ? 'main' : 'thread ' + ids[0]];
+        for (var i = 1; i < ids.length; i++) frames.push(names[ids[i]] || ('?' + ids[i]));
+        lines.push(frames.join(';') + ' ' + counts[key]);
+      }
+      return lines.join('\n');
+    },
+
+    getProfile: function(callback) {
+      SamplingProfiler.callbacks.push(callback);
+      SamplingProfiler.worker.postMessage({});
+    }
+  }
+};
+
+mergeInto(LibraryManager.library, LibrarySamplingProfiler);
@@ -37,6 +37,8 @@ var LibrarySDL = {
     surfaces: {},
     // A pool of freed canvas elements. Reusing them avoids GC pauses.
     canvasPool: [],
+    // Set when SDL.getHeapImage() finds that the browser cannot create an ImageData over the heap.
+    heapImagesUnsupported: false,
     events: [],
     fonts: [null],
 
@@ -452,6 +454,22 @@ var LibrarySDL = {
       }
     },
 
+    // Returns an ImageData that views the pixels of the given 32bpp surface in the heap, so that putImageData() can read
+    // them from there without copying them to an image first, or null if the browser cannot create one. That is the case
+    // when the heap is a SharedArrayBuffer, for example. Memory growth replaces the heap, and with it the view.
+    getHeapImage: function(surfData) {
+      if (SDL.heapImagesUnsupported) return null;
+      var image = surfData.heapImage;
+      if (image && image.data.buffer === HEAPU8.buffer) return image;
+      try {
+        image = new ImageData(new Uint8ClampedArray(HEAPU8.buffer, surfData.buffer, surfData.width * surfData.height * 4), surfData.width, surfData.height);
+      } catch (e) {
+        SDL.heapImagesUnsupported = true;
+        image = null;
+      }
+      return surfData.heapImage = image;
+    },
+
     freeSurface: function(surf) {
       var refcountPointer = surf + {{{ C_STRUCTS.SDL_Surface.refcount }}};
       var refcount = {{{ makeGetValue('refcountPointer', '0', 'i32') }}};
@@ -1604,6 +1622,13 @@ var LibrarySDL = {
       var dst = 0;
       var isScreen = surf == SDL.screen;
       var num;
+      // Unless the alpha of the screen needs to be overwritten, the pixels are in the format that the canvas takes, so
+      // put them from the heap directly.
+      var heapImage = !(isScreen && SDL.defaults.opaqueFrontBuffer) && SDL.getHeapImage(surfData);
+      if (heapImage) {
+        surfData.ctx.putImageData(heapImage, 0, 0);
+        return;
+      }
       if (typeof CanvasPixelArray !== 'undefined' && data instanceof CanvasPixelArray) {
         // IE10/IE11: ImageData objects are backed by the deprecated CanvasPixelArray,
         // not UInt8ClampedArray. These don't have buffers, so we need to revert
@@ -1620,7 +1645,10 @@ var LibrarySDL = {
           dst += 4;
         }
       } else {
-        var data32 = new Uint32Array(data.buffer);
+        if (!surfData.image.data32) {
+          surfData.image.data32 = new Uint32Array(data.buffer);
+        }
+        var data32 = surfData.image.data32;
         if (isScreen && SDL.defaults.opaqueFrontBuffer) {
           num = data32.length;
           // logically we need to do
@@ -1632,7 +1660,7 @@ var LibrarySDL = {
           // native memcpy efficiencies, and the remaining loop
           // just stores, not load + store, so it is faster
           data32.set(HEAP32.subarray(src, src + num));
-          var data8 = new Uint8Array(data.buffer);
+          var data8 = data;
           var i = 3;
           var j = i + 4*num;
           if (num % 8 == 0) {
@@ -2289,6 +2317,12 @@ var LibrarySDL = {
       var surf = SDL.makeSurface(raw.width, raw.height, 0, false, 'load:' + filename);
       var surfData = SDL.surfaces[surf];
       surfData.ctx.globalCompositeOperation = "copy";
+#if PRELOAD_IMAGE_WORKERS
+      if (typeof ImageData !== 'undefined' && raw instanceof ImageData) {
+        // decoded in a worker by the preload plugin
+        surfData.ctx.putImageData(raw, 0, 0);
+      } else
+#endif
       if (!raw.rawData) {
         surfData.ctx.drawImage(raw, 0, 0, raw.width, raw.height, 0, 0, raw.width, raw.height);
       } else {
@@ -23,6 +23,10 @@ mergeInto(LibraryManager.library, {
 	    if ('function' === typeof this._callbacks[event]) {
 		  this._callbacks[event].call(this, param);
         }
+        // let the waiters of emscripten_socket_wait*() check their sockets again. a listener may remove itself.
+        for (var i = SOCKFS.eventListeners.length - 1; i >= 0; i--) {
+          SOCKFS.eventListeners[i](event, param);
+        }
       };
 
       // If debug is enabled register simple default logging callbacks for each Event.
@@ -52,7 +56,16 @@ mergeInto(LibraryManager.library, {
         error: null, // Used in getsockopt for SOL_SOCKET/SO_ERROR test
         peers: {},
         pending: [],
-        recv_queue: [],
+        // received data waits in a ring buffer in the heap, and is read out of it with a copy inside the heap. each
+        // message (or, for stream sockets, each run of data from the same peer) is a record, with its length in
+        // recv_lengths and the peer it came from in recv_peers.
+        recv_ring: null,
+        recv_lengths: [],
+        recv_peers: [],
+        // the peer that the data returned by the last recvmsg came from
+        recv_peer: null,
+        // set by TCP_NODELAY: stream writes are sent right away instead of being coalesced until the end of the tick
+        nodelay: false,
 #if SOCKET_WEBRTC
 #else
         sock_ops: SOCKFS.websocket_sock_ops
@@ -99,13 +112,8 @@ mergeInto(LibraryManager.library, {
       },
       read: function(stream, buffer, offset, length, position /* ignored */) {
         var sock = stream.node.sock;
-        var msg = sock.sock_ops.recvmsg(sock, length);
-        if (!msg) {
-          // socket is closed
-          return 0;
-        }
-        buffer.set(msg.buffer, offset);
-        return msg.buffer.length;
+        // returns 0 if the socket is closed
+        return sock.sock_ops.recvmsg(sock, buffer, offset, length);
       },
       write: function(stream, buffer, offset, length, position /* ignored */) {
         var sock = stream.node.sock;
@@ -122,6 +130,18 @@ mergeInto(LibraryManager.library, {
       }
       return 'socket[' + (SOCKFS.nextname.current++) + ']';
     },
+    // the WebSockets that logical connections are multiplexed over, by url
+    multiplexers: {},
+    // functions called after every socket event, see emscripten_socket_wait()
+    eventListeners: [],
+    // how often waits for POLLOUT check the sockets again, since a send buffer draining is not an event
+    WAIT_RECHECK_MSECS: 50,
+    // initial size of the receive ring of a socket, which grows when a message does not fit
+    RECV_RING_SIZE: 65536,
+    // coalesced stream writes are sent once this much is pending, without waiting for the end of the tick
+    SEND_COALESCE_SIZE: 65536,
+    // writes fail with EAGAIN, and poll() stops reporting POLLOUT, once this much data is waiting to go out on a peer
+    SEND_BUFFER_SIZE: 1048576,
     // backend-specific stream ops
     websocket_sock_ops: {
       //
@@ -131,7 +151,7 @@ mergeInto(LibraryManager.library, {
       // these functions aren't actually sock_ops members, but we're
       // abusing the namespace to organize them
       //
-      createPeer: function(sock, addr, port) {
+      createPeer: function(sock, addr, port, channel) {
         var ws;
 
         if (typeof addr === 'object') {
@@ -140,7 +160,10 @@ mergeInto(LibraryManager.library, {
           port = null;
         }
 
-        if (ws) {
+        if (channel) {
+          // an incoming RTCDataChannel (or a promise of one) from addr:port, see Module['datachannel']
+          ws = SOCKFS.websocket_sock_ops.createDataChannelSocket(channel);
+        } else if (ws) {
           // for sockets that've already connected (e.g. we're the server)
           // we can inspect the _socket property for the address
           if (ws._socket) {
@@ -157,6 +180,17 @@ mergeInto(LibraryManager.library, {
             addr = result[1];
             port = parseInt(result[2], 10);
           }
+        } else if (sock.type === {{{ cDefine('SOCK_DGRAM') }}} && Module['datachannel'] && Module['datachannel']['connect']) {
+          // datagrams go over an unreliable, unordered RTCDataChannel when the application provides the signaling, to
+          // avoid the head-of-line blocking of a WebSocket
+#if SOCKET_DEBUG
+          Module.print('connect: datachannel to ' + addr + ':' + port);
+#endif
+          try {
+            ws = SOCKFS.websocket_sock_ops.createDataChannelSocket(Module['datachannel']['connect'](addr, port));
+          } catch (e) {
+            throw new FS.ErrnoError(ERRNO_CODES.EHOSTUNREACH);
+          }
         } else {
           // create the actual websocket object and connect
           try {
@@ -212,8 +246,12 @@ mergeInto(LibraryManager.library, {
             } else {
               WebSocketConstructor = WebSocket;
             }
-            ws = new WebSocketConstructor(url, opts);
-            ws.binaryType = 'arraybuffer';
+            if (runtimeConfig && Module['websocket']['multiplex'] && sock.type === {{{ cDefine('SOCK_STREAM') }}}) {
+              ws = SOCKFS.websocket_sock_ops.createMultiplexedSocket(WebSocketConstructor, url, opts, addr, port);
+            } else {
+              ws = new WebSocketConstructor(url, opts);
+              ws.binaryType = 'arraybuffer';
+            }
           } catch (e) {
             throw new FS.ErrnoError(ERRNO_CODES.EHOSTUNREACH);
           }
@@ -227,7 +265,11 @@ mergeInto(LibraryManager.library, {
           addr: addr,
           port: port,
           socket: ws,
-          dgram_send_queue: []
+          dgram_send_queue: [],
+          // coalesced stream writes that have not been handed to the WebSocket yet
+          send_buffer: null,
+          send_length: 0,
+          flush_scheduled: false
         };
 
         SOCKFS.websocket_sock_ops.addPeer(sock, peer);
@@ -249,6 +291,162 @@ mergeInto(LibraryManager.library, {
 
         return peer;
       },
+      // Wraps an RTCDataChannel, or a promise of one, in the parts of the WebSocket interface that peers use.
+      createDataChannelSocket: function(channel) {
+        var STATES = { 'connecting': 0, 'open': 1, 'closing': 2, 'closed': 3 };
+        var socket = {
+          CONNECTING: 0,
+          OPEN: 1,
+          CLOSING: 2,
+          CLOSED: 3,
+          emulated: true,
+          channel: null,
+          failed: false,
+          send: function(data) {
+            socket.channel['send'](data);
+          },
+          close: function() {
+            if (socket.channel) socket.channel['close']();
+            else socket.failed = true;  // don't open it when it arrives
+          }
+        };
+        Object.defineProperty(socket, 'readyState', {
+          get: function() {
+            if (socket.failed) return socket.CLOSED;
+            return socket.channel ? STATES[socket.channel['readyState']] : socket.CONNECTING;
+          }
+        });
+        Object.defineProperty(socket, 'bufferedAmount', {
+          get: function() {
+            return socket.channel ? socket.channel['bufferedAmount'] : 0;
+          }
+        });
+        // the handlers are set on the socket after this returns, and the channel is attached after that
+        Promise.resolve(channel).then(function(channel) {
+          if (socket.failed) {
+            channel['close']();
+            return;
+          }
+          socket.channel = channel;
+          channel['binaryType'] = 'arraybuffer';
+          channel['onopen'] = function() { socket.onopen(); };
+          channel['onmessage'] = function(event) { socket.onmessage(event); };
+          channel['onclose'] = function() { socket.onclose(); };
+          channel['onerror'] = function(error) { socket.onerror(error); };
+          if (channel['readyState'] === 'open') socket.onopen();
+        }, function(error) {
+          socket.failed = true;
+          socket.onerror(error);
+        });
+        return socket;
+      },
+      // Returns a logical connection to addr:port, which shares one WebSocket with the other connections to the same
+      // url, in the parts of the WebSocket interface that peers use. The other end is websockify with --multiplex.
+      // Each WebSocket message is one frame: a type byte, a 32 bit big-endian connection id, and the payload.
+      // MUX_OPEN carries the port (16 bit big-endian) and the host to connect to, MUX_DATA carries data, and the
+      // proxy answers MUX_OPEN with MUX_OPENED, or MUX_CLOSE if the connection failed.
+      MUX_OPEN: 0,
+      MUX_DATA: 1,
+      MUX_CLOSE: 2,
+      MUX_OPENED: 3,
+      createMultiplexedSocket: function(WebSocketConstructor, url, opts, addr, port) {
+        var ops = SOCKFS.websocket_sock_ops;
+        var mux = SOCKFS.multiplexers[url];
+        if (!mux || mux.ws.readyState === mux.ws.CLOSING || mux.ws.readyState === mux.ws.CLOSED) {
+          mux = SOCKFS.multiplexers[url] = { ws: new WebSocketConstructor(url, opts), nextId: 1, connections: {}, pending: [] };
+          var ws = mux.ws;
+          ws.binaryType = 'arraybuffer';
+          var handleOpen = function() {
+            for (var i = 0; i < mux.pending.length; i++) ws.send(mux.pending[i]);
+            mux.pending = null;
+          };
+          var handleFrame = function(frame) {
+            var id = ((frame[1] << 24) | (frame[2] << 16) | (frame[3] << 8) | frame[4]) >>> 0;
+            var connection = mux.connections[id];
+            if (!connection) return;
+            switch (frame[0]) {
+              case ops.MUX_OPENED:
+                connection.state = connection.OPEN;
+                connection.onopen();
+                break;
+              case ops.MUX_DATA:
+                // a view, which the receive ring copies from
+                connection.onmessage({ data: frame.subarray(5) });
+                break;
+              case ops.MUX_CLOSE:
+                var wasOpen = connection.state === connection.OPEN;
+                connection.state = connection.CLOSED;
+                delete mux.connections[id];
+                if (!wasOpen) connection.onerror();
+                connection.onclose();
+                break;
+            }
+          };
+          var handleClose = function() {
+            if (SOCKFS.multiplexers[url] === mux) delete SOCKFS.multiplexers[url];
+            for (var id in mux.connections) {
+              var connection = mux.connections[id];
+              var wasOpen = connection.state === connection.OPEN;
+              connection.state = connection.CLOSED;
+              if (!wasOpen) connection.onerror();
+              connection.onclose();
+            }
+            mux.connections = {};
+          };
+          if (ENVIRONMENT_IS_NODE) {
+            ws.on('open', handleOpen);
+            ws.on('message', function(data, flags) {
+              if (flags.binary) handleFrame(new Uint8Array(data.buffer, data.byteOffset, data.length));
+            });
+            ws.on('close', handleClose);
+            ws.on('error', function() {});  // followed by close
+          } else {
+            ws.onopen = handleOpen;
+            ws.onmessage = function(event) {
+              if (typeof event.data !== 'string') handleFrame(new Uint8Array(event.data));
+            };
+            ws.onclose = handleClose;
+          }
+        }
+
+        var sendFrame = function(type, id, payload) {
+          var frame = new Uint8Array(5 + (payload ? payload.length : 0));
+          frame[0] = type;
+          frame[1] = id >>> 24; frame[2] = id >>> 16; frame[3] = id >>> 8; frame[4] = id;
+          if (payload) frame.set(payload, 5);
+          if (mux.pending) mux.pending.push(frame.buffer);
+          else mux.ws.send(frame.buffer);
+        };
+
+        var id = mux.nextId++;
+        var connection = {
+          CONNECTING: 0,
+          OPEN: 1,
+          CLOSING: 2,
+          CLOSED: 3,
+          emulated: true,
+          state: 0,
+          send: function(data) {
+            sendFrame(ops.MUX_DATA, id, new Uint8Array(data));
+          },
+          close: function() {
+            if (connection.state === connection.CLOSED) return;
+            connection.state = connection.CLOSED;
+            delete mux.connections[id];
+            if (mux.ws.readyState === mux.ws.CONNECTING || mux.ws.readyState === mux.ws.OPEN) sendFrame(ops.MUX_CLOSE, id, null);
+          }
+        };
+        Object.defineProperty(connection, 'readyState', {
+          get: function() { return connection.state; }
+        });
+        Object.defineProperty(connection, 'bufferedAmount', {
+          get: function() { return mux.ws.bufferedAmount || 0; }
+        });
+        mux.connections[id] = connection;
+        var host = intArrayFromString(addr, true);
+        sendFrame(ops.MUX_OPEN, id, [port >> 8, port & 0xff].concat(host));
+        return connection;
+      },
       getPeer: function(sock, addr, port) {
         return sock.peers[addr + ':' + port];
       },
@@ -258,6 +456,93 @@ mergeInto(LibraryManager.library, {
       removePeer: function(sock, peer) {
         delete sock.peers[peer.addr + ':' + peer.port];
       },
+      // hands the coalesced stream writes of a peer to its WebSocket as a single message.
+      flush: function(peer) {
+        peer.flush_scheduled = false;
+        if (!peer.send_length) {
+          return;
+        }
+        var data = peer.send_buffer.buffer.slice(0, peer.send_length);
+        peer.send_length = 0;
+        if (peer.socket.readyState !== peer.socket.OPEN) {
+          return;  // the connection went away, and the data with it
+        }
+#if SOCKET_DEBUG
+        Module.print('websocket send (' + data.byteLength + ' bytes): ' + [Array.prototype.slice.call(new Uint8Array(data))]);
+#endif
+        try {
+          peer.socket.send(data);
+        } catch (e) {
+          // as with a send that fails right away, the data was already reported as sent
+          peer.socket.close();
+        }
+      },
+      // the number of bytes that may still be written to a peer before writes fail with EAGAIN
+      sendSpace: function(peer) {
+        return SOCKFS.SEND_BUFFER_SIZE - (peer.socket.bufferedAmount || 0) - peer.send_length;
+      },
+      // copies received data into the receive ring of the socket, growing it when there is not enough space.
+      enqueue: function(sock, peer, data) {
+        if (SOCKFS.websocket_sock_ops.getPeer(sock, peer.addr, peer.port) !== peer) {
+          return;  // the socket was closed
+        }
+        var ring = sock.recv_ring;
+        var length = data.length;
+        if (!ring || ring.used + length > ring.size) {
+          ring = SOCKFS.websocket_sock_ops.growRing(sock, (ring ? ring.used : 0) + length);
+        }
+        var end = (ring.start + ring.used) % ring.size;
+        var first = Math.min(length, ring.size - end);
+        HEAPU8.set(first === length ? data : data.subarray(0, first), ring.ptr + end);
+        if (first < length) {
+          HEAPU8.set(data.subarray(first), ring.ptr);
+        }
+        ring.used += length;
+
+        var records = sock.recv_lengths.length;
+        if (sock.type === {{{ cDefine('SOCK_STREAM') }}} && records && sock.recv_peers[records - 1] === peer) {
+          // stream data has no message boundaries, so it joins the last record
+          sock.recv_lengths[records - 1] += length;
+        } else {
+          sock.recv_lengths.push(length);
+          sock.recv_peers.push(peer);
+        }
+      },
+      growRing: function(sock, needed) {
+        var old = sock.recv_ring;
+        var size = old ? old.size * 2 : SOCKFS.RECV_RING_SIZE;
+        while (size < needed) size *= 2;
+        var ptr = _malloc(size);
+        assert(ptr, 'out of memory for the receive buffer of a socket');
+        var ring = { ptr: ptr, size: size, start: 0, used: 0 };
+        if (old) {
+          // move the queued data to the start of the new ring
+          var first = Math.min(old.used, old.size - old.start);
+          HEAPU8.copyWithin(ptr, old.ptr + old.start, old.ptr + old.start + first);
+          HEAPU8.copyWithin(ptr + first, old.ptr, old.ptr + old.used - first);
+          ring.used = old.used;
+          _free(old.ptr);
+        }
+        sock.recv_ring = ring;
+        return ring;
+      },
+      // copies bytes from the start of the receive ring to buffer (without a temporary view when buffer is on the heap),
+      // and then drops skip more bytes after them.
+      dequeue: function(sock, buffer, offset, length, skip) {
+        var ring = sock.recv_ring;
+        var first = Math.min(length, ring.size - ring.start);
+        var start = ring.ptr + ring.start;
+        if (buffer.buffer === HEAPU8.buffer) {
+          offset += buffer.byteOffset;
+          HEAPU8.copyWithin(offset, start, start + first);
+          HEAPU8.copyWithin(offset + first, ring.ptr, ring.ptr + length - first);
+        } else {
+          buffer.set(HEAPU8.subarray(start, start + first), offset);
+          if (first < length) buffer.set(HEAPU8.subarray(ring.ptr, ring.ptr + length - first), offset + first);
+        }
+        ring.start = (ring.start + length + skip) % ring.size;
+        ring.used -= length + skip;
+      },
       handlePeerEvents: function(sock, peer) {
         var first = true;
 
@@ -285,7 +570,7 @@ mergeInto(LibraryManager.library, {
         };
 
         function handleMessage(data) {
-          assert(typeof data !== 'string' && data.byteLength !== undefined);  // must receive an ArrayBuffer
+          assert(typeof data !== 'string' && data.byteLength !== undefined);  // must receive an ArrayBuffer or a view
 
           // An empty ArrayBuffer will emit a pseudo disconnect event
           // as recv/recvmsg will return zero which indicates that a socket
@@ -293,7 +578,9 @@ mergeInto(LibraryManager.library, {
           if (data.byteLength == 0) {
             return;
           }
-          data = new Uint8Array(data);  // make a typed array view on the array buffer
+          if (!ArrayBuffer.isView(data)) {
+            data = new Uint8Array(data);  // make a typed array view on the array buffer
+          }
 
 #if SOCKET_DEBUG
           Module.print('websocket handle message (' + data.byteLength + ' bytes): ' + [Array.prototype.slice.call(data)]);
@@ -314,17 +601,18 @@ mergeInto(LibraryManager.library, {
             return;
           }
 
-          sock.recv_queue.push({ addr: peer.addr, port: peer.port, data: data });
+          SOCKFS.websocket_sock_ops.enqueue(sock, peer, data);
           Module['websocket'].emit('message', sock.stream.fd);
         };
 
-        if (ENVIRONMENT_IS_NODE) {
+        // emulated sockets take the handlers of a browser WebSocket, in node too
+        if (ENVIRONMENT_IS_NODE && !peer.socket.emulated) {
           peer.socket.on('open', handleOpen);
           peer.socket.on('message', function(data, flags) {
             if (!flags.binary) {
               return;
             }
-            handleMessage((new Uint8Array(data)).buffer);  // copy from node Buffer -> ArrayBuffer
+            handleMessage(data);  // a node Buffer is a Uint8Array, which is copied straight into the receive ring
           });
           peer.socket.on('close', function() {
             Module['websocket'].emit('close', sock.stream.fd);
@@ -370,7 +658,7 @@ mergeInto(LibraryManager.library, {
           SOCKFS.websocket_sock_ops.getPeer(sock, sock.daddr, sock.dport) :
           null;
 
-        if (sock.recv_queue.length ||
+        if (sock.recv_lengths.length ||
             !dest ||  // connection-less sockets are always ready to read
             (dest && dest.socket.readyState === dest.socket.CLOSING) ||
             (dest && dest.socket.readyState === dest.socket.CLOSED)) {  // let recv return 0 once closed
@@ -378,7 +666,8 @@ mergeInto(LibraryManager.library, {
         }
 
         if (!dest ||  // connection-less sockets are always ready to write
-            (dest && dest.socket.readyState === dest.socket.OPEN)) {
+            (dest && dest.socket.readyState === dest.socket.OPEN &&
+             SOCKFS.websocket_sock_ops.sendSpace(dest) > 0)) {  // unless a slow peer has too much data waiting
           mask |= {{{ cDefine('POLLOUT') }}};
         }
 
@@ -393,8 +682,8 @@ mergeInto(LibraryManager.library, {
         switch (request) {
           case {{{ cDefine('FIONREAD') }}}:
             var bytes = 0;
-            if (sock.recv_queue.length) {
-              bytes = sock.recv_queue[0].data.length;
+            if (sock.recv_lengths.length) {
+              bytes = sock.recv_lengths[0];
             }
             {{{ makeSetValue('arg', '0', 'bytes', 'i32') }}};
             return 0;
@@ -403,6 +692,11 @@ mergeInto(LibraryManager.library, {
         }
       },
       close: function(sock) {
+        // stop accepting data channels
+        if (typeof sock.stopListening === 'function') {
+          sock.stopListening();
+          sock.stopListening = null;
+        }
         // if we've spawned a listen server, close it
         if (sock.server) {
           try {
@@ -411,16 +705,23 @@ mergeInto(LibraryManager.library, {
           }
           sock.server = null;
         }
-        // close any peer connections
+        // close any peer connections, after sending what is still coalesced
         var peers = Object.keys(sock.peers);
         for (var i = 0; i < peers.length; i++) {
           var peer = sock.peers[peers[i]];
+          SOCKFS.websocket_sock_ops.flush(peer);
           try {
             peer.socket.close();
           } catch (e) {
           }
           SOCKFS.websocket_sock_ops.removePeer(sock, peer);
         }
+        if (sock.recv_ring) {
+          _free(sock.recv_ring.ptr);
+          sock.recv_ring = null;
+        }
+        sock.recv_lengths = [];
+        sock.recv_peers = [];
         return 0;
       },
       bind: function(sock, addr, port) {
@@ -438,6 +739,14 @@ mergeInto(LibraryManager.library, {
             sock.server.close();
             sock.server = null;
           }
+          if (Module['datachannel'] && Module['datachannel']['listen']) {
+            // the application's signaling delivers the RTCDataChannels of the peers that connect to this port
+            sock.stopListening = Module['datachannel']['listen'](port, function(channel, remoteAddr, remotePort) {
+              SOCKFS.websocket_sock_ops.createPeer(sock, remoteAddr, remotePort, channel);
+              Module['websocket'].emit('connection', sock.stream.fd);
+            });
+            return;
+          }
           // swallow error operation not supported error that occurs when binding in the
           // browser where this isn't supported
           try {
@@ -590,6 +899,16 @@ mergeInto(LibraryManager.library, {
           }
         }
 
+        // don't let a slow peer grow the data waiting to be sent without bound
+        if (dest && dest.socket.readyState === dest.socket.OPEN) {
+          var space = SOCKFS.websocket_sock_ops.sendSpace(dest);
+          if (space <= 0 || (sock.type === {{{ cDefine('SOCK_DGRAM') }}} && space < length)) {
+            throw new FS.ErrnoError(ERRNO_CODES.EAGAIN);
+          }
+          // a stream write is accepted up to the space, like a partial write to a full non-blocking socket
+          length = Math.min(length, space);
+        }
+
         // create a copy of the incoming data to send, as the WebSocket API
         // doesn't work entirely with an ArrayBufferView, it'll just send
         // the entire underlying buffer
@@ -598,6 +917,29 @@ mergeInto(LibraryManager.library, {
           buffer = buffer.buffer;
         }
 
+        if (sock.type === {{{ cDefine('SOCK_STREAM') }}} &&
+            (dest.send_length || (!sock.nodelay && length < SOCKFS.SEND_COALESCE_SIZE))) {
+          // coalesce the writes of a tick into one message, like Nagle's algorithm does for small TCP segments. large
+          // writes, and writes with TCP_NODELAY, are sent right away unless they must follow data that is pending.
+          var needed = dest.send_length + length;
+          if (!dest.send_buffer || dest.send_buffer.length < needed) {
+            var grown = new Uint8Array(Math.max(needed, dest.send_buffer ? dest.send_buffer.length * 2 : 1024));
+            if (dest.send_buffer) grown.set(dest.send_buffer.subarray(0, dest.send_length));
+            dest.send_buffer = grown;
+          }
+          dest.send_buffer.set(new Uint8Array(buffer, offset, length), dest.send_length);
+          dest.send_length = needed;
+          if (sock.nodelay || dest.send_length >= SOCKFS.SEND_COALESCE_SIZE) {
+            SOCKFS.websocket_sock_ops.flush(dest);
+          } else if (!dest.flush_scheduled) {
+            dest.flush_scheduled = true;
+            Promise.resolve().then(function() {
+              SOCKFS.websocket_sock_ops.flush(dest);
+            });
+          }
+          return length;
+        }
+
         var data;
 #if USE_PTHREADS
         // WebSockets .send() does not allow passing a SharedArrayBuffer, so clone the portion of the SharedArrayBuffer as a regular
@@ -639,15 +981,16 @@ mergeInto(LibraryManager.library, {
           throw new FS.ErrnoError(ERRNO_CODES.EINVAL);
         }
       },
-      recvmsg: function(sock, length) {
+      // reads up to length bytes of the next message into buffer at offset, and returns how many were read, or 0 if the
+      // socket has closed. the peer they came from is left in sock.recv_peer.
+      recvmsg: function(sock, buffer, offset, length) {
         // http://pubs.opengroup.org/onlinepubs/7908799/xns/recvmsg.html
         if (sock.type === {{{ cDefine('SOCK_STREAM') }}} && sock.server) {
           // tcp servers should not be recv()'ing on the listen socket
           throw new FS.ErrnoError(ERRNO_CODES.ENOTCONN);
         }
 
-        var queued = sock.recv_queue.shift();
-        if (!queued) {
+        if (!sock.recv_lengths.length) {
           if (sock.type === {{{ cDefine('SOCK_STREAM') }}}) {
             var dest = SOCKFS.websocket_sock_ops.getPeer(sock, sock.daddr, sock.dport);
 
@@ -656,8 +999,8 @@ mergeInto(LibraryManager.library, {
               throw new FS.ErrnoError(ERRNO_CODES.ENOTCONN);
             }
             else if (dest.socket.readyState === dest.socket.CLOSING || dest.socket.readyState === dest.socket.CLOSED) {
-              // return null if the socket has closed
-              return null;
+              // return 0 if the socket has closed
+              return 0;
             }
             else {
               // else, our socket is in a valid state but truly has nothing available
@@ -668,33 +1011,29 @@ mergeInto(LibraryManager.library, {
           }
         }
 
-        // queued.data will be an ArrayBuffer if it's unadulterated, but if it's
-        // requeued TCP data it'll be an ArrayBufferView
-        var queuedLength = queued.data.byteLength || queued.data.length;
-        var queuedOffset = queued.data.byteOffset || 0;
-        var queuedBuffer = queued.data.buffer || queued.data;
+        var queuedLength = sock.recv_lengths[0];
         var bytesRead = Math.min(length, queuedLength);
-        var res = {
-          buffer: new Uint8Array(queuedBuffer, queuedOffset, bytesRead),
-          addr: queued.addr,
-          port: queued.port
-        };
+        sock.recv_peer = sock.recv_peers[0];
 
+        if (sock.type === {{{ cDefine('SOCK_STREAM') }}} && bytesRead < queuedLength) {
+          // leave any unread data for TCP connections
 #if SOCKET_DEBUG
-        Module.print('websocket read (' + bytesRead + ' bytes): ' + [Array.prototype.slice.call(res.buffer)]);
+          Module.print('websocket read: leaving ' + (queuedLength - bytesRead) + ' bytes');
 #endif
+          SOCKFS.websocket_sock_ops.dequeue(sock, buffer, offset, bytesRead, 0);
+          sock.recv_lengths[0] -= bytesRead;
+        } else {
+          // the part of a datagram that does not fit is discarded
+          SOCKFS.websocket_sock_ops.dequeue(sock, buffer, offset, bytesRead, queuedLength - bytesRead);
+          sock.recv_lengths.shift();
+          sock.recv_peers.shift();
+        }
 
-        // push back any unread data for TCP connections
-        if (sock.type === {{{ cDefine('SOCK_STREAM') }}} && bytesRead < queuedLength) {
-          var bytesRemaining = queuedLength - bytesRead;
 #if SOCKET_DEBUG
-          Module.print('websocket read: put back ' + bytesRemaining + ' bytes');
+        Module.print('websocket read (' + bytesRead + ' bytes): ' + [Array.prototype.slice.call(buffer.subarray(offset, offset + bytesRead))]);
 #endif
-          queued.data = new Uint8Array(queuedBuffer, queuedOffset + bytesRead, bytesRemaining);
-          sock.recv_queue.unshift(queued);
-        }
 
-        return res;
+        return bytesRead;
       }
     }
   },
@@ -757,5 +1096,108 @@ mergeInto(LibraryManager.library, {
   emscripten_set_socket_close_callback__deps: ['__set_network_callback'],
   emscripten_set_socket_close_callback: function(userData, callback) {
     ___set_network_callback('close', userData, callback);
+  },
+
+  // Incremented, and woken as a futex, after every socket event, so that pthreads can sleep in emscripten_socket_wait()
+  // until something happens on a socket.
+  _socket_event_counter: '; if (ENVIRONMENT_IS_PTHREAD) __socket_event_counter = PthreadWorkerInit.__socket_event_counter; else PthreadWorkerInit.__socket_event_counter = __socket_event_counter = allocate(1, "i32*", ALLOC_STATIC)',
+
+  // A poll() that does not wait, run on the main thread where the sockets are. The first call starts incrementing the
+  // event counter.
+#if USE_PTHREADS
+  _socket_poll__deps: ['$SOCKFS', '$SYSCALLS', '_socket_event_counter', 'emscripten_futex_wake'],
+#else
+  _socket_poll__deps: ['$SOCKFS', '$SYSCALLS'],
+#endif
+  _socket_poll__proxy: 'sync',
+  _socket_poll__sig: 'iii',
+  _socket_poll: function(fds, nfds) {
+#if USE_PTHREADS
+    if (!SOCKFS.wakingThreads) {
+      SOCKFS.wakingThreads = true;
+      SOCKFS.eventListeners.push(function() {
+        Atomics.add(HEAP32, __socket_event_counter >> 2, 1);
+        _emscripten_futex_wake(__socket_event_counter, {{{ cDefine('INT_MAX') }}});
+      });
+    }
+#endif
+    return SYSCALLS.doPoll(fds, nfds);
+  },
+
+  // Returns whether any of an array of pollfds asks for POLLOUT.
+  _socket_wants_pollout: function(fds, nfds) {
+    for (var i = 0; i < nfds; i++) {
+      var events = {{{ makeGetValue('fds', C_STRUCTS.pollfd.__size__ + ' * i + ' + C_STRUCTS.pollfd.events, 'i16') }}};
+      if (events & {{{ cDefine('POLLOUT') }}}) return true;
+    }
+    return false;
+  },
+
+#if USE_PTHREADS
+  emscripten_socket_wait__deps: ['$SOCKFS', '_socket_poll', '_socket_wants_pollout', '_socket_event_counter', 'emscripten_get_now', 'emscripten_futex_wait'],
+#else
+  emscripten_socket_wait__deps: ['_socket_poll'],
+#endif
+  emscripten_socket_wait: function(fds, nfds, timeout) {
+#if USE_PTHREADS
+    if (ENVIRONMENT_IS_PTHREAD) {
+      var end = _emscripten_get_now() + timeout;
+      var wantsPollout = __socket_wants_pollout(fds, nfds);
+      while (1) {
+        // read the counter before polling, so that an event in between makes the wait return right away
+        var seen = Atomics.load(HEAP32, __socket_event_counter >> 2);
+        var ready = __socket_poll(fds, nfds);
+        if (ready) return ready;
+        var remaining = timeout < 0 ? Infinity : end - _emscripten_get_now();
+        if (remaining <= 0) return 0;
+        if (wantsPollout) remaining = Math.min(remaining, SOCKFS.WAIT_RECHECK_MSECS);
+        _emscripten_futex_wait(__socket_event_counter, seen, remaining);
+      }
+    }
+#endif
+    // the main thread cannot block, so it only polls once; emscripten_socket_wait_async waits there
+    return __socket_poll(fds, nfds);
+  },
+
+  emscripten_socket_wait_async__deps: ['$SOCKFS', '$SYSCALLS', '_socket_wants_pollout', 'emscripten_get_now'],
+  emscripten_socket_wait_async: function(fds, nfds, timeout, userData, callback) {
+#if USE_PTHREADS
+    assert(!ENVIRONMENT_IS_PTHREAD, 'emscripten_socket_wait_async() is only for the main thread, pthreads can use emscripten_socket_wait()');
+#endif
+    var end = _emscripten_get_now() + timeout;
+    var wantsPollout = __socket_wants_pollout(fds, nfds);
+    var timer = null;
+    function check() {
+      var ready = SYSCALLS.doPoll(fds, nfds);
+      var remaining = timeout < 0 ? Infinity : end - _emscripten_get_now();
+      if (!ready && remaining > 0) {
+        if (timer === null && (remaining !== Infinity || wantsPollout)) {
+          timer = setTimeout(function() {
+            timer = null;
+            check();
+          }, wantsPollout ? Math.min(remaining, SOCKFS.WAIT_RECHECK_MSECS) : remaining);
+        }
+        return;
+      }
+      SOCKFS.eventListeners.splice(SOCKFS.eventListeners.indexOf(check), 1);
+      if (timer !== null) clearTimeout(timer);
+      try {
+        Module['dynCall_vii'](callback, ready, userData);
+      } catch (e) {
+        if (e instanceof ExitStatus) {
+          return;
+        } else {
+          if (e && typeof e === 'object' && e.stack) Module.printErr('exception thrown: ' + [e, e.stack]);
+          throw e;
+        }
+      }
+    }
+    Module['noExitRuntime'] = true;
+    SOCKFS.eventListeners.push(check);
+    // like an event, the callback is never called before this returns
+    timer = setTimeout(function() {
+      timer = null;
+      check();
+    }, 0);
   }
 });
@@ -33,6 +33,28 @@ var SyscallsLibrary = {
       return path;
     },
 
+    // fills in the revents of an array of pollfds, and returns how many are ready. it never waits.
+    doPoll: function(fds, nfds) {
+      var nonzero = 0;
+      for (var i = 0; i < nfds; i++) {
+        var pollfd = fds + {{{ C_STRUCTS.pollfd.__size__ }}} * i;
+        var fd = {{{ makeGetValue('pollfd', C_STRUCTS.pollfd.fd, 'i32') }}};
+        var events = {{{ makeGetValue('pollfd', C_STRUCTS.pollfd.events, 'i16') }}};
+        var mask = {{{ cDefine('POLLNVAL') }}};
+        var stream = FS.getStream(fd);
+        if (stream) {
+          mask = SYSCALLS.DEFAULT_POLLMASK;
+          if (stream.stream_ops.poll) {
+            mask = stream.stream_ops.poll(stream);
+          }
+        }
+        mask &= events | {{{ cDefine('POLLERR') }}} | {{{ cDefine('POLLHUP') }}};
+        if (mask) nonzero++;
+        {{{ makeSetValue('pollfd', C_STRUCTS.pollfd.revents, 'mask', 'i16') }}};
+      }
+      return nonzero;
+    },
+
     doStat: function(func, path, buf) {
       try {
         var stat = func(path);
@@ -422,12 +444,15 @@ var SyscallsLibrary = {
     if (!info) return 0;
     if (len === info.len) {
       var stream = FS.getStream(info.fd);
-      SYSCALLS.doMsync(addr, stream, len, info.flags)
+      if (!info.unmap) SYSCALLS.doMsync(addr, stream, len, info.flags) // Mappings with unmap() point right at the file data.
       FS.munmap(stream);
       SYSCALLS.mappings[addr] = null;
       if (info.allocated) {
         _free(info.malloc);
       }
+      if (info.unmap) {
+        info.unmap(); // Lets the file system release memory that the file was mapped from.
+      }
     }
     return 0;
   },
@@ -506,22 +531,28 @@ var SyscallsLibrary = {
       }
       case 12: { // recvfrom
         var sock = SYSCALLS.getSocketFromFD(), buf = SYSCALLS.get(), len = SYSCALLS.get(), flags = SYSCALLS.get(), addr = SYSCALLS.get(), addrlen = SYSCALLS.get();
-        var msg = sock.sock_ops.recvmsg(sock, len);
-        if (!msg) return 0; // socket is closed
+        var bytesRead = sock.sock_ops.recvmsg(sock, HEAPU8, buf, len);
+        if (!bytesRead) return 0; // socket is closed
         if (addr) {
-          var res = __write_sockaddr(addr, sock.family, DNS.lookup_name(msg.addr), msg.port);
+          var res = __write_sockaddr(addr, sock.family, DNS.lookup_name(sock.recv_peer.addr), sock.recv_peer.port);
           assert(!res.errno);
         }
-        HEAPU8.set(msg.buffer, buf);
-        return msg.buffer.byteLength;
+        return bytesRead;
       }
       case 14: { // setsockopt
+        var sock = SYSCALLS.getSocketFromFD(), level = SYSCALLS.get(), optname = SYSCALLS.get(), optval = SYSCALLS.get(), optlen = SYSCALLS.get();
+        // only TCP_NODELAY is supported, which turns off the coalescing of small writes on stream sockets.
+        if (level === {{{ cDefine('IPPROTO_TCP') }}} && optname === {{{ cDefine('TCP_NODELAY') }}} && sock.type === {{{ cDefine('SOCK_STREAM') }}}) {
+          if (optlen < 4) return -ERRNO_CODES.EINVAL;
+          sock.nodelay = !!{{{ makeGetValue('optval', 0, 'i32') }}};
+          return 0;
+        }
         return -ERRNO_CODES.ENOPROTOOPT; // The option is unknown at the level indicated.
       }
       case 15: { // getsockopt
         var sock = SYSCALLS.getSocketFromFD(), level = SYSCALLS.get(), optname = SYSCALLS.get(), optval = SYSCALLS.get(), optlen = SYSCALLS.get();
         // Minimal getsockopt aimed at resolving https://github.com/kripken/emscripten/issues/2211
-        // so only supports SOL_SOCKET with SO_ERROR.
+        // so only supports SOL_SOCKET with SO_ERROR, and IPPROTO_TCP with TCP_NODELAY.
         if (level === {{{ cDefine('SOL_SOCKET') }}}) {
           if (optname === {{{ cDefine('SO_ERROR') }}}) {
             {{{ makeSetValue('optval', 0, 'sock.error', 'i32') }}};
@@ -529,6 +560,10 @@ var SyscallsLibrary = {
             sock.error = null; // Clear the error (The SO_ERROR option obtains and then clears this field).
             return 0;
           }
+        } else if (level === {{{ cDefine('IPPROTO_TCP') }}} && optname === {{{ cDefine('TCP_NODELAY') }}} && sock.type === {{{ cDefine('SOCK_STREAM') }}}) {
+          {{{ makeSetValue('optval', 0, 'sock.nodelay ? 1 : 0', 'i32') }}};
+          {{{ makeSetValue('optlen', 0, 4, 'i32') }}};
+          return 0;
         }
         return -ERRNO_CODES.ENOPROTOOPT; // The option is unknown at the level indicated.
       }
@@ -572,9 +607,11 @@ var SyscallsLibrary = {
         for (var i = 0; i < num; i++) {
           total += {{{ makeGetValue('iov', '(' + C_STRUCTS.iovec.__size__ + ' * i) + ' + C_STRUCTS.iovec.iov_len, 'i32') }}};
         }
-        // try to read total data
-        var msg = sock.sock_ops.recvmsg(sock, total);
-        if (!msg) return 0; // socket is closed
+        // try to read total data. a single array is read into directly, several go through a temporary buffer.
+        var view = num === 1 ? HEAPU8 : new Uint8Array(total);
+        var viewOffset = num === 1 ? {{{ makeGetValue('iov', C_STRUCTS.iovec.iov_base, 'i8*') }}} : 0;
+        var bytesRead = sock.sock_ops.recvmsg(sock, view, viewOffset, total);
+        if (!bytesRead) return 0; // socket is closed
 
         // TODO honor flags:
         // MSG_OOB
@@ -587,12 +624,15 @@ var SyscallsLibrary = {
         // write the source address out
         var name = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_name, '*') }}};
         if (name) {
-          var res = __write_sockaddr(name, sock.family, DNS.lookup_name(msg.addr), msg.port);
+          var res = __write_sockaddr(name, sock.family, DNS.lookup_name(sock.recv_peer.addr), sock.recv_peer.port);
           assert(!res.errno);
         }
+        if (num === 1) {
+          return bytesRead;
+        }
         // write the buffer out to the scatter-gather arrays
-        var bytesRead = 0;
-        var bytesRemaining = msg.buffer.byteLength;
+        var bytesRemaining = bytesRead;
+        bytesRead = 0;
         for (var i = 0; bytesRemaining > 0 && i < num; i++) {
           var iovbase = {{{ makeGetValue('iov', '(' + C_STRUCTS.iovec.__size__ + ' * i) + ' + C_STRUCTS.iovec.iov_base, 'i8*') }}};
           var iovlen = {{{ makeGetValue('iov', '(' + C_STRUCTS.iovec.__size__ + ' * i) + ' + C_STRUCTS.iovec.iov_len, 'i32') }}};
@@ -600,8 +640,7 @@ var SyscallsLibrary = {
             continue;
           }
           var length = Math.min(iovlen, bytesRemaining);
-          var buf = msg.buffer.subarray(bytesRead, bytesRead + length);
-          HEAPU8.set(buf, iovbase + bytesRead);
+          HEAPU8.set(view.subarray(bytesRead, bytesRead + length), iovbase);
           bytesRead += length;
           bytesRemaining -= length;
         }
@@ -631,6 +670,8 @@ var SyscallsLibrary = {
 #endif
   __syscall118: function(which, varargs) { // fsync
     var stream = SYSCALLS.getStreamFromFD();
+    // file systems that write through to persistent storage can flush it synchronously
+    if (stream.stream_ops.fsync) stream.stream_ops.fsync(stream);
 #if EMTERPRETIFY_ASYNC
     return EmterpreterAsync.handle(function(resume) {
       var mount = stream.node.mount;
@@ -840,6 +881,7 @@ var SyscallsLibrary = {
   },
   __syscall148: function(which, varargs) { // fdatasync
     var stream = SYSCALLS.getStreamFromFD();
+    if (stream.stream_ops.fsync) stream.stream_ops.fsync(stream);
     return 0; // we can't do anything synchronously; the in-memory FS is already synced to
   },
   __syscall150: '__syscall153',     // mlock
@@ -853,24 +895,7 @@ var SyscallsLibrary = {
   },
   __syscall168: function(which, varargs) { // poll
     var fds = SYSCALLS.get(), nfds = SYSCALLS.get(), timeout = SYSCALLS.get();
-    var nonzero = 0;
-    for (var i = 0; i < nfds; i++) {
-      var pollfd = fds + {{{ C_STRUCTS.pollfd.__size__ }}} * i;
-      var fd = {{{ makeGetValue('pollfd', C_STRUCTS.pollfd.fd, 'i32') }}};
-      var events = {{{ makeGetValue('pollfd', C_STRUCTS.pollfd.events, 'i16') }}};
-      var mask = {{{ cDefine('POLLNVAL') }}};
-      var stream = FS.getStream(fd);
-      if (stream) {
-        mask = SYSCALLS.DEFAULT_POLLMASK;
-        if (stream.stream_ops.poll) {
-          mask = stream.stream_ops.poll(stream);
-        }
-      }
-      mask &= events | {{{ cDefine('POLLERR') }}} | {{{ cDefine('POLLHUP') }}};
-      if (mask) nonzero++;
-      {{{ makeSetValue('pollfd', C_STRUCTS.pollfd.revents, 'mask', 'i16') }}};
-    }
-    return nonzero;
+    return SYSCALLS.doPoll(fds, nfds);
   },
   __syscall178: function(which, varargs) { // rt_sigqueueinfo
 #if SYSCALL_DEBUG
@@ -922,8 +947,9 @@ var SyscallsLibrary = {
       var res = FS.mmap(info, HEAPU8, addr, len, off, prot, flags);
       ptr = res.ptr;
       allocated = res.allocated;
+      var unmap = res.unmap;
     }
-    SYSCALLS.mappings[ptr] = { malloc: ptr, len: len, allocated: allocated, fd: fd, flags: flags };
+    SYSCALLS.mappings[ptr] = { malloc: ptr, len: len, allocated: allocated, fd: fd, flags: flags, unmap: unmap };
     return ptr;
   },
   __syscall193: function(which, varargs) { // truncate64
@@ -1250,8 +1276,8 @@ var SyscallsLibrary = {
   },
   __syscall324: function(which, varargs) { // fallocate
     var stream = SYSCALLS.getStreamFromFD(), mode = SYSCALLS.get(), offset = SYSCALLS.get64(), len = SYSCALLS.get64();
-    assert(mode === 0);
-    FS.allocate(stream, offset, len);
+    assert(mode === 0 || mode === 1 /* FALLOC_FL_KEEP_SIZE */);
+    FS.allocate(stream, offset, len, mode === 1);
     return 0;
   },
   __syscall330: function(which, varargs) { // dup3
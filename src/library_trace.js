@@ -1,6 +1,7 @@
 var LibraryTracing = {
   $EmscriptenTrace__deps: [
     'emscripten_trace_js_configure', 'emscripten_trace_configure_for_google_wtf',
+    'emscripten_trace_configure_for_chrome_tracing',
     'emscripten_trace_js_enter_context', 'emscripten_trace_exit_context',
     'emscripten_trace_js_log_message', 'emscripten_trace_js_mark',
     'emscripten_get_now'
@@ -10,6 +11,7 @@ var LibraryTracing = {
     worker: null,
     collectorEnabled: false,
     googleWTFEnabled: false,
+    chromeTracingEnabled: false,
     testingEnabled: false,
 
     googleWTFData: {
@@ -45,10 +47,30 @@ var LibraryTracing = {
     init: function() {
       Module['emscripten_trace_configure'] = _emscripten_trace_js_configure;
       Module['emscripten_trace_configure_for_google_wtf'] = _emscripten_trace_configure_for_google_wtf;
+      Module['emscripten_trace_configure_for_chrome_tracing'] = _emscripten_trace_configure_for_chrome_tracing;
+      Module['getChromeTrace'] = EmscriptenTrace.getChromeTrace;
       Module['emscripten_trace_enter_context'] = _emscripten_trace_js_enter_context;
       Module['emscripten_trace_exit_context'] = _emscripten_trace_exit_context;
       Module['emscripten_trace_log_message'] = _emscripten_trace_js_log_message;
       Module['emscripten_trace_mark'] = _emscripten_trace_js_mark;
+#if TRACE_BUFFER
+      // The ring that trace_buffer.c writes memory events into. A header of 32 bytes (head, tail, capacity, dropped,
+      // enabled, padding, now) is followed by records of 32 bytes (seq, type, a, b, c, padding, time).
+      var capacity = 2;
+      while (capacity * 2 * 32 <= {{{ TRACE_BUFFER }}}) capacity *= 2;
+#if USE_PTHREADS
+      if (ENVIRONMENT_IS_PTHREAD) {
+        EmscriptenTrace.buffer = PthreadWorkerInit.traceBuffer;
+      } else {
+        PthreadWorkerInit.traceBuffer = EmscriptenTrace.buffer = staticAlloc(32 + capacity * 32);
+        HEAPU32[(EmscriptenTrace.buffer >> 2) + 2] = capacity;
+      }
+#else
+      EmscriptenTrace.buffer = staticAlloc(32 + capacity * 32);
+      HEAPU32[(EmscriptenTrace.buffer >> 2) + 2] = capacity;
+#endif
+      Module['drainTraceBuffer'] = EmscriptenTrace.drainBuffer;
+#endif
     },
 
     // Work around CORS issues ...
@@ -83,6 +105,9 @@ var LibraryTracing = {
         EmscriptenTrace.configured = true;
         EmscriptenTrace.collectorEnabled = true;
         EmscriptenTrace.postEnabled = true;
+#if TRACE_BUFFER
+        EmscriptenTrace.drainBuffer();
+#endif
       });
       EmscriptenTrace.post([EmscriptenTrace.EVENT_APPLICATION_NAME, application]);
       EmscriptenTrace.post([EmscriptenTrace.EVENT_SESSION_NAME, now.toISOString()]);
@@ -92,6 +117,9 @@ var LibraryTracing = {
       EmscriptenTrace.postEnabled = true;
       EmscriptenTrace.testingEnabled = true;
       EmscriptenTrace.now = function() { return 0.0; };
+#if TRACE_BUFFER
+      EmscriptenTrace.drainBuffer();
+#endif
     },
 
     configureForGoogleWTF: function() {
@@ -103,7 +131,13 @@ var LibraryTracing = {
     },
 
     post: function(entry) {
-      if (EmscriptenTrace.postEnabled && EmscriptenTrace.collectorEnabled) {
+#if TRACE_BUFFER
+      // Keep the buffered events in order with this one.
+      EmscriptenTrace.drainBuffer();
+#endif
+      if (EmscriptenTrace.postEnabled && EmscriptenTrace.chromeTracingEnabled) {
+        EmscriptenTrace.chromeTraceAdd(entry);
+      } else if (EmscriptenTrace.postEnabled && EmscriptenTrace.collectorEnabled) {
         EmscriptenTrace.worker.postMessage({ 'cmd': 'post',
                                              'entry': entry });
       } else if (EmscriptenTrace.postEnabled && EmscriptenTrace.testingEnabled) {
@@ -111,6 +145,233 @@ var LibraryTracing = {
       }
     },
 
+#if TRACE_BUFFER
+    buffer: 0,
+    bufferDropped: 0,
+    bufferTimer: null,
+
+    // Hands the events in the trace buffer to the memory profiler hooks, and posts them to the collector in one
+    // message. Called periodically, before other events are posted, and by trace_buffer.c when the buffer fills up
+    // half way.
+    drainBuffer: function() {
+#if USE_PTHREADS
+      if (ENVIRONMENT_IS_PTHREAD) return; // the main thread is the only reader
+#endif
+      var header = EmscriptenTrace.buffer >> 2;
+      var onMalloc = Module['onMalloc'], onRealloc = Module['onRealloc'], onFree = Module['onFree'];
+      var hooked = typeof onMalloc === 'function';
+      var enabled = EmscriptenTrace.postEnabled || hooked;
+      HEAPU32[header + 4] = enabled ? 1 : 0;
+      if (!enabled) return;
+      if (!EmscriptenTrace.bufferTimer) {
+        EmscriptenTrace.bufferTimer = setInterval(EmscriptenTrace.drainBuffer, 100);
+        if (EmscriptenTrace.bufferTimer.unref) EmscriptenTrace.bufferTimer.unref(); // don't keep node alive
+      }
+      if (EmscriptenTrace.now) HEAPF64[(header >> 1) + 3] = EmscriptenTrace.now();
+
+      var entries = [];
+      var capacity = HEAPU32[header + 2];
+#if USE_PTHREADS
+      var tail = Atomics.load(HEAPU32, header + 1);
+#else
+      var tail = HEAPU32[header + 1];
+#endif
+      while (1) {
+        var r = (EmscriptenTrace.buffer + 32 + (tail & (capacity - 1)) * 32) >> 2;
+#if USE_PTHREADS
+        if (Atomics.load(HEAPU32, r) !== ((tail + 1) >>> 0)) break;
+#else
+        if (HEAPU32[r] !== ((tail + 1) >>> 0)) break;
+#endif
+        var a = HEAPU32[r + 2], b = HEAPU32[r + 3], c = HEAPU32[r + 4], time = HEAPF64[(r >> 1) + 3];
+        switch (HEAPU32[r + 1]) {
+          case 1:
+            if (hooked) onMalloc(a, b|0);
+            entries.push([EmscriptenTrace.EVENT_ALLOCATE, time, a, b|0]);
+            break;
+          case 2:
+            if (hooked) onRealloc(a, b, c|0);
+            entries.push([EmscriptenTrace.EVENT_REALLOCATE, time, a, b, c|0]);
+            break;
+          case 3:
+            if (hooked) onFree(a);
+            entries.push([EmscriptenTrace.EVENT_FREE, time, a]);
+            break;
+          case 4:
+            entries.push([EmscriptenTrace.EVENT_ASSOCIATE_STORAGE_SIZE, a, b|0]);
+            break;
+        }
+        tail = (tail + 1) >>> 0;
+      }
+#if USE_PTHREADS
+      Atomics.store(HEAPU32, header + 1, tail);
+      var dropped = Atomics.load(HEAPU32, header + 3);
+#else
+      HEAPU32[header + 1] = tail;
+      var dropped = HEAPU32[header + 3];
+#endif
+      if (dropped !== EmscriptenTrace.bufferDropped) {
+        entries.push([EmscriptenTrace.EVENT_LOG_MESSAGE, HEAPF64[(header >> 1) + 3], 'Emscripten',
+                      'Trace buffer full, dropped ' + (dropped - EmscriptenTrace.bufferDropped) + ' events']);
+        EmscriptenTrace.bufferDropped = dropped;
+      }
+      if (!entries.length || !EmscriptenTrace.postEnabled) return;
+      if (EmscriptenTrace.chromeTracingEnabled) {
+        for (var i = 0; i < entries.length; i++) EmscriptenTrace.chromeTraceAdd(entries[i]);
+      } else if (EmscriptenTrace.collectorEnabled) {
+        EmscriptenTrace.worker.postMessage({ 'cmd': 'post-batch',
+                                             'entries': entries });
+      } else if (EmscriptenTrace.testingEnabled) {
+        for (var i = 0; i < entries.length; i++) Module.print('Tracing ' + entries[i]);
+      }
+    },
+#endif
+
+    // The events of the Chrome trace event format, see
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    // The trace loads into chrome://tracing, Perfetto (ui.perfetto.dev) and the performance panel of the devtools.
+    chromeTrace: {
+      'events': [],
+      'task': null, // the id of the current task
+      'taskNames': {}, // the name of each task, which its async events pair up by
+      'sizes': {}, // the size of each live allocation
+      'allocated': 0
+    },
+
+    // The pid and tids of the events. Frames get a track of their own, since they need not nest with contexts.
+    CHROME_PID: 1,
+    CHROME_TID_MAIN: 1,
+    CHROME_TID_FRAMES: 2,
+
+    configureForChromeTracing: function() {
+      EmscriptenTrace.now = _emscripten_get_now;
+      EmscriptenTrace.postEnabled = true;
+      EmscriptenTrace.chromeTracingEnabled = true;
+      var events = EmscriptenTrace.chromeTrace['events'];
+      events.push({ 'ph': 'M', 'name': 'thread_name', 'pid': EmscriptenTrace.CHROME_PID, 'tid': EmscriptenTrace.CHROME_TID_MAIN,
+                    'args': { 'name': 'Main thread' } });
+      events.push({ 'ph': 'M', 'name': 'thread_name', 'pid': EmscriptenTrace.CHROME_PID, 'tid': EmscriptenTrace.CHROME_TID_FRAMES,
+                    'args': { 'name': 'Frames' } });
+#if TRACE_BUFFER
+      EmscriptenTrace.drainBuffer();
+#endif
+    },
+
+    // Turns a trace entry into Chrome trace events. Times are in microseconds there.
+    chromeTraceAdd: function(entry) {
+      var trace = EmscriptenTrace.chromeTrace;
+      var type = entry[0];
+      var e = { 'pid': EmscriptenTrace.CHROME_PID, 'tid': EmscriptenTrace.CHROME_TID_MAIN };
+      if (typeof entry[1] === 'number') e['ts'] = entry[1] * 1000;
+      switch (type) {
+        case EmscriptenTrace.EVENT_ENTER_CONTEXT:
+          e['ph'] = 'B';
+          e['name'] = entry[2];
+          break;
+        case EmscriptenTrace.EVENT_EXIT_CONTEXT:
+          e['ph'] = 'E';
+          break;
+        case EmscriptenTrace.EVENT_FRAME_START:
+        case EmscriptenTrace.EVENT_FRAME_END:
+          e['ph'] = type === EmscriptenTrace.EVENT_FRAME_START ? 'B' : 'E';
+          e['name'] = 'Frame';
+          e['tid'] = EmscriptenTrace.CHROME_TID_FRAMES;
+          break;
+        case EmscriptenTrace.EVENT_LOG_MESSAGE:
+          e['ph'] = 'i';
+          e['s'] = 't';
+          e['cat'] = entry[2];
+          e['name'] = entry[3];
+          break;
+        case EmscriptenTrace.EVENT_REPORT_ERROR:
+          e['ph'] = 'i';
+          e['s'] = 'g';
+          e['cat'] = 'error';
+          e['name'] = entry[2];
+          e['args'] = { 'callstack': entry[3] };
+          break;
+        case EmscriptenTrace.EVENT_ALLOCATE:
+        case EmscriptenTrace.EVENT_REALLOCATE:
+        case EmscriptenTrace.EVENT_FREE:
+          var sizes = trace['sizes'];
+          var address = entry[2];
+          if (address in sizes) {
+            trace['allocated'] -= sizes[address];
+            delete sizes[address];
+          }
+          if (type !== EmscriptenTrace.EVENT_FREE) {
+            if (type === EmscriptenTrace.EVENT_REALLOCATE) address = entry[3];
+            sizes[address] = entry[entry.length - 1];
+            trace['allocated'] += sizes[address];
+          }
+          e['ph'] = 'C';
+          e['name'] = 'Heap';
+          e['args'] = { 'allocated': trace['allocated'] };
+          break;
+        case EmscriptenTrace.EVENT_MEMORY_LAYOUT:
+        case EmscriptenTrace.EVENT_OFF_HEAP:
+          e['ph'] = 'C';
+          e['name'] = type === EmscriptenTrace.EVENT_OFF_HEAP ? 'Off heap' : 'Memory layout';
+          e['args'] = entry[2];
+          break;
+        case EmscriptenTrace.EVENT_TASK_START:
+        case EmscriptenTrace.EVENT_TASK_RESUME:
+          if (trace['task'] !== null) EmscriptenTrace.chromeTraceAdd([EmscriptenTrace.EVENT_TASK_SUSPEND, entry[1]]);
+          trace['task'] = entry[2];
+          if (type === EmscriptenTrace.EVENT_TASK_START) trace['taskNames'][entry[2]] = entry[3];
+          e['ph'] = 'b';
+          e['cat'] = 'task';
+          e['id'] = entry[2];
+          e['name'] = trace['taskNames'][entry[2]] || 'Task ' + entry[2];
+          if (type === EmscriptenTrace.EVENT_TASK_RESUME) e['args'] = { 'resumed': entry[3] };
+          break;
+        case EmscriptenTrace.EVENT_TASK_SUSPEND:
+        case EmscriptenTrace.EVENT_TASK_END:
+          if (trace['task'] === null) return;
+          e['ph'] = 'e';
+          e['cat'] = 'task';
+          e['id'] = trace['task'];
+          e['name'] = trace['taskNames'][trace['task']] || 'Task ' + trace['task'];
+          if (type === EmscriptenTrace.EVENT_TASK_END) delete trace['taskNames'][trace['task']];
+          if (type === EmscriptenTrace.EVENT_TASK_SUSPEND) e['args'] = { 'suspended': entry[2] };
+          trace['task'] = null;
+          break;
+        case EmscriptenTrace.EVENT_APPLICATION_NAME:
+          e['ph'] = 'M';
+          e['name'] = 'process_name';
+          e['args'] = { 'name': entry[1] };
+          break;
+        default:
+          return; // no counterpart in the trace event format
+      }
+      trace['events'].push(e);
+    },
+
+    // Returns the trace so far as the JSON of the Chrome trace event format.
+    getChromeTrace: function() {
+#if TRACE_BUFFER
+      EmscriptenTrace.drainBuffer();
+#endif
+      return JSON.stringify({ 'traceEvents': EmscriptenTrace.chromeTrace['events'], 'displayTimeUnit': 'ms' });
+    },
+
+    // Writes the trace to a file with node, or offers it as a download in a browser.
+    saveChromeTrace: function(filename) {
+      var json = EmscriptenTrace.getChromeTrace();
+      if (ENVIRONMENT_IS_NODE) {
+        require('fs').writeFileSync(filename, json);
+      } else if (ENVIRONMENT_IS_WEB) {
+        var a = document.createElement('a');
+        a.href = URL.createObjectURL(new Blob([json], { type: 'application/json' }));
+        a.download = filename;
+        document.body.appendChild(a);
+        a.click();
+        document.body.removeChild(a);
+      } else {
+        Module.print(json);
+      }
+    },
+
     googleWTFEnterScope: function(name) {
       var scopeEvent = EmscriptenTrace.googleWTFData['cachedScopes'][name];
       if (!scopeEvent) {
@@ -144,8 +405,19 @@ var LibraryTracing = {
     EmscriptenTrace.configureForGoogleWTF();
   },
 
+  emscripten_trace_configure_for_chrome_tracing: function() {
+    EmscriptenTrace.configureForChromeTracing();
+  },
+
+  emscripten_trace_save_chrome_tracing: function(filename) {
+    EmscriptenTrace.saveChromeTrace(Pointer_stringify(filename));
+  },
+
   emscripten_trace_set_enabled: function(enabled) {
     EmscriptenTrace.postEnabled = !!enabled;
+#if TRACE_BUFFER
+    EmscriptenTrace.drainBuffer();
+#endif
   },
 
   emscripten_trace_set_session_username: function(username) {
@@ -365,13 +637,30 @@ var LibraryTracing = {
     }
   },
 
+#if TRACE_BUFFER
+  emscripten_trace_js_buffer: function() {
+    EmscriptenTrace.drainBuffer(); // sets enabled
+    return EmscriptenTrace.buffer;
+  },
+
+  emscripten_trace_js_drain_buffer: function() {
+    EmscriptenTrace.drainBuffer();
+  },
+#endif
+
   emscripten_trace_close: function() {
+#if TRACE_BUFFER
+    EmscriptenTrace.drainBuffer();
+#endif
     EmscriptenTrace.collectorEnabled = false;
     EmscriptenTrace.googleWTFEnabled = false;
+    EmscriptenTrace.chromeTracingEnabled = false;
     EmscriptenTrace.postEnabled = false;
     EmscriptenTrace.testingEnabled = false;
-    EmscriptenTrace.worker.postMessage({ 'cmd': 'close' });
-    EmscriptenTrace.worker = null;
+    if (EmscriptenTrace.worker) {
+      EmscriptenTrace.worker.postMessage({ 'cmd': 'close' });
+      EmscriptenTrace.worker = null;
+    }
   },
 };
 
@@ -73,6 +73,18 @@ mergeInto(LibraryManager.library, {
         if (!stream.tty || !stream.tty.ops.put_char) {
           throw new FS.ErrnoError(ERRNO_CODES.ENXIO);
         }
+        if (stream.tty.ops.put_buffer) {
+          // ops that can take the whole buffer at once, see TTY.putBuffer
+          try {
+            stream.tty.ops.put_buffer(stream.tty, buffer, offset, length);
+          } catch (e) {
+            throw new FS.ErrnoError(ERRNO_CODES.EIO);
+          }
+          if (length) {
+            stream.node.timestamp = Date.now();
+          }
+          return length;
+        }
         for (var i = 0; i < length; i++) {
           try {
             stream.tty.ops.put_char(stream.tty, buffer[offset+i]);
@@ -86,6 +98,78 @@ mergeInto(LibraryManager.library, {
         return i;
       }
     },
+    // Writes bytes to a tty that prints whole lines with |print|. Each line is
+    // decoded in one go, instead of being built up a character at a time as
+    // put_char does; only an incomplete last line is kept in tty.output.
+    putBuffer: function(tty, buffer, offset, length, print, batch) {
+      var start = offset, end = offset + length;
+      for (var i = offset; i < end; i++) {
+        var c = buffer[i];
+        if (c === {{{ charCode('\n') }}}) {
+          var line;
+          if (tty.output.length) {
+            for (var j = start; j < i; j++) tty.output.push(buffer[j]);
+            line = UTF8ArrayToString(tty.output, 0);
+            tty.output = [];
+          } else {
+            line = TTY.decode(buffer, start, i);
+          }
+          TTY.printLine(tty, line, print, batch);
+          start = i + 1;
+        } else if (c === 0) {
+          // a 0 would cut text output off in the middle, drop it like put_char does
+          for (var j = start; j < i; j++) tty.output.push(buffer[j]);
+          start = i + 1;
+        }
+      }
+      for (var j = start; j < end; j++) tty.output.push(buffer[j]);
+    },
+    // Decodes the UTF-8 bytes in buffer[start..end), which has no 0 bytes.
+    decode: function(buffer, start, end) {
+#if TEXTDECODER
+      if (end - start > 16 && buffer.subarray && UTF8Decoder) {
+        return UTF8Decoder.decode(buffer.subarray(start, end));
+      }
+#endif
+      var bytes = [];
+      for (var i = start; i < end; i++) bytes.push(buffer[i]);
+      return UTF8ArrayToString(bytes, 0);
+    },
+    printLine: function(tty, line, print, batch) {
+#if TTY_BATCH_OUTPUT
+      if (batch) {
+        // Queue the line, and print the queue as a single string when we are
+        // next idle (or when it gets long, or the stream is flushed).
+        if (!tty.lines) {
+          tty.lines = [];
+          process['on']('exit', function() { TTY.flushLines(tty) });
+        }
+        tty.lines.push(line);
+        tty.linesPrint = print;
+        if (tty.lines.length >= 1000) {
+          TTY.flushLines(tty);
+        } else if (tty.lines.length === 1) {
+          setTimeout(function() { TTY.flushLines(tty) }, 0);
+        }
+        return;
+      }
+#endif
+      print(line);
+    },
+#if TTY_BATCH_OUTPUT
+    // Whether output to the node stream |name| should be batched: only when
+    // it is not a terminal, so that interactive output still shows line by line.
+    isBatched: function(name) {
+      return ENVIRONMENT_IS_NODE && !process[name]['isTTY'];
+    },
+    flushLines: function(tty) {
+      if (tty.lines && tty.lines.length) {
+        var text = tty.lines.join('\n');
+        tty.lines.length = 0;
+        tty.linesPrint(text);
+      }
+    },
+#endif
     default_tty_ops: {
       // get_char has 3 particular return values:
       // a.) the next character represented as an integer
@@ -157,7 +241,13 @@ mergeInto(LibraryManager.library, {
           if (val != 0) tty.output.push(val); // val == 0 would cut text output off in the middle.
         }
       },
+      put_buffer: function(tty, buffer, offset, length) {
+        TTY.putBuffer(tty, buffer, offset, length, Module['print'], {{{ TTY_BATCH_OUTPUT ? "TTY.isBatched('stdout')" : 'false' }}});
+      },
       flush: function(tty) {
+#if TTY_BATCH_OUTPUT
+        TTY.flushLines(tty);
+#endif
         if (tty.output && tty.output.length > 0) {
           Module['print'](UTF8ArrayToString(tty.output, 0));
           tty.output = [];
@@ -173,7 +263,13 @@ mergeInto(LibraryManager.library, {
           if (val != 0) tty.output.push(val);
         }
       },
+      put_buffer: function(tty, buffer, offset, length) {
+        TTY.putBuffer(tty, buffer, offset, length, Module['printErr'], {{{ TTY_BATCH_OUTPUT ? "TTY.isBatched('stderr')" : 'false' }}});
+      },
       flush: function(tty) {
+#if TTY_BATCH_OUTPUT
+        TTY.flushLines(tty);
+#endif
         if (tty.output && tty.output.length > 0) {
           Module['printErr'](UTF8ArrayToString(tty.output, 0));
           tty.output = [];
@@ -61,7 +61,7 @@ var LibraryWebVR = {
 
   emscripten_vr_init: function(func, userData) {
     return WebVR.init(function() {
-      Runtime.dynCall('vi', func, [userData]);
+      {{{ makeDynCall('vi') }}}(func, userData);
     });
   },
 
@@ -171,11 +171,11 @@ var LibraryWebVR = {
     var displayIterationFunc;
     if (typeof arg !== 'undefined') {
       displayIterationFunc = function() {
-        dynCall('vi', func, [arg]);
+        {{{ makeDynCall('vi') }}}(func, arg);
       };
     } else {
       displayIterationFunc = function() {
-        dynCall('v', func);
+        {{{ makeDynCall('v') }}}(func);
       };
     }
 
@@ -281,7 +281,7 @@ var LibraryWebVR = {
 
     display.requestPresent(layerInit).then(function() {
       if (!func) return;
-      dynCall('vi', func, [userData]);
+      {{{ makeDynCall('vi') }}}(func, userData);
     });
 
     return 1;
@@ -4,6 +4,7 @@ mergeInto(LibraryManager.library, {
     DIR_MODE: {{{ cDefine('S_IFDIR') }}} | 511 /* 0777 */,
     FILE_MODE: {{{ cDefine('S_IFREG') }}} | 511 /* 0777 */,
     reader: null,
+    READ_AHEAD_SIZE: 64 * 1024,
     mount: function (mount) {
       assert(ENVIRONMENT_IS_WORKER);
       if (!WORKERFS.reader) WORKERFS.reader = new FileReaderSync();
@@ -128,10 +129,25 @@ mergeInto(LibraryManager.library, {
     stream_ops: {
       read: function (stream, buffer, offset, length, position) {
         if (position >= stream.node.size) return 0;
-        var chunk = stream.node.contents.slice(position, position + length);
-        var ab = WORKERFS.reader.readAsArrayBuffer(chunk);
-        buffer.set(new Uint8Array(ab), offset);
-        return chunk.size;
+        if (length >= WORKERFS.READ_AHEAD_SIZE) {
+          // big reads go straight to the blob
+          var chunk = stream.node.contents.slice(position, position + length);
+          var ab = WORKERFS.reader.readAsArrayBuffer(chunk);
+          buffer.set(new Uint8Array(ab), offset);
+          return chunk.size;
+        }
+        // small reads are served from a buffer of the data after them, so that sequential reads take one
+        // synchronous blob read per READ_AHEAD_SIZE bytes instead of one each
+        var readAhead = stream.readAhead;
+        var end = readAhead ? readAhead.position + readAhead.data.length : 0;
+        if (!readAhead || position < readAhead.position || position >= end || (position + length > end && end < stream.node.size)) {
+          var data = new Uint8Array(WORKERFS.reader.readAsArrayBuffer(stream.node.contents.slice(position, position + WORKERFS.READ_AHEAD_SIZE)));
+          readAhead = stream.readAhead = { position: position, data: data };
+        }
+        var start = position - readAhead.position;
+        var size = Math.min(length, readAhead.data.length - start);
+        buffer.set(readAhead.data.subarray(start, start + size), offset);
+        return size;
       },
       write: function (stream, buffer, offset, length, position) {
         throw new FS.ErrnoError(ERRNO_CODES.EIO);
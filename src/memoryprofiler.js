@@ -162,6 +162,13 @@ var emscriptenMemoryProfiler = {
     Module['onRealloc'] = function onRealloc(oldAddress, newAddress, size) { emscriptenMemoryProfiler.onRealloc(oldAddress, newAddress, size); };
     Module['onFree'] = function onFree(ptr) { emscriptenMemoryProfiler.onFree(ptr); };
 
+    // With -s TRACE_BUFFER, the hooks are called when the trace buffer is drained, long after the allocation, so
+    // callstacks cannot be captured.
+    if (Module['drainTraceBuffer']) {
+      this.trackedCallstackMinSizeBytes = 1024*1024*1024*4;
+      Module['drainTraceBuffer']();
+    }
+
     // Add a tracking mechanism to detect when VFS loading is complete.
     Module['preRun'].push(function() { emscriptenMemoryProfiler.onPreloadComplete(); });
 
@@ -266,6 +273,8 @@ var emscriptenMemoryProfiler = {
 
   // Main UI update entry point.
   updateUi: function updateUi() {
+    if (Module['drainTraceBuffer']) Module['drainTraceBuffer']();
+
     function colorBar(color) {
       return '<span style="padding:0px; border:solid 1px black; width:28px;height:14px; vertical-align:middle; display:inline-block; background-color:'+color+';"></span>';
     }
@@ -38,16 +38,19 @@ var exports = {};
  * If the output buffer is too small, an error will be thrown.
  * If the returned value is negative, an error occured at the returned offset.
  *
+ * The decoded data is written to output from oIdx on, and matches may refer
+ * back to the data before it, as the linked blocks of an LZ4 frame do.
+ *
  * @param input {Buffer} input data
  * @param output {Buffer} output data
- * @return {Number} number of decoded bytes
+ * @return {Number} offset in output after the decoded bytes
  * @private
  */
-exports.uncompress = function (input, output, sIdx, eIdx) {
+exports.uncompress = function (input, output, sIdx, eIdx, oIdx) {
 	sIdx = sIdx || 0
 	eIdx = eIdx || (input.length - sIdx)
 	// Process each sequence in the incoming data
-	for (var i = sIdx, n = eIdx, j = 0; i < n;) {
+	for (var i = sIdx, n = eIdx, j = oIdx || 0; i < n;) {
 		var token = input[i++]
 
 		// Literals
@@ -271,7 +274,10 @@ function compressBlock (src, dst, pos, sIdx, eIdx) {
 
 exports.CHUNK_SIZE = 2048; // musl libc does readaheads of 1024 bytes, so a multiple of that is a good idea
 
-exports.compressPackage = function(data, verify) {
+// If the files of the package are given, as a list of { start, end } ranges in the data, each file is compressed
+// in chunks of its own, and fileChunks holds the index of the first chunk of each file, so that reading a file
+// never decompresses the data of its neighbours. Otherwise the data is compressed in chunks as a whole.
+exports.compressPackage = function(data, verify, files) {
   if (verify) {
     var temp = new Uint8Array(exports.CHUNK_SIZE);
   }
@@ -281,34 +287,40 @@ exports.compressPackage = function(data, verify) {
   console.log('compressing package of size ' + data.length);
   var compressedChunks = [];
   var successes = [];
-  var offset = 0;
+  var fileChunks = files ? [] : null;
+  var ranges = files || [{ start: 0, end: data.length }];
   var total = 0;
-  while (offset < data.length) {
-    var chunk = data.subarray(offset, offset + exports.CHUNK_SIZE);
-    //console.log('compress a chunk ' + [offset, total, data.length]);
-    offset += exports.CHUNK_SIZE;
-    var bound = exports.compressBound(chunk.length);
-    var compressed = new Uint8Array(bound);
-    var compressedSize = exports.compress(chunk, compressed);
-    if (compressedSize > 0) {
-      assert(compressedSize <= bound);
-      compressed = compressed.subarray(0, compressedSize);
-      compressedChunks.push(compressed);
-      total += compressedSize;
-      successes.push(1);
-      if (verify) {
-        var back = exports.uncompress(compressed, temp);
-        assert(back === chunk.length, [back, chunk.length]);
-        for (var i = 0; i < chunk.length; i++) {
-          assert(chunk[i] === temp[i]);
+  for (var r = 0; r < ranges.length; r++) {
+    var offset = ranges[r].start;
+    var end = ranges[r].end;
+    if (fileChunks) fileChunks.push(compressedChunks.length);
+    while (offset < end) {
+      var chunk = data.subarray(offset, Math.min(offset + exports.CHUNK_SIZE, end));
+      //console.log('compress a chunk ' + [offset, total, data.length]);
+      offset += exports.CHUNK_SIZE;
+      var bound = exports.compressBound(chunk.length);
+      var compressed = new Uint8Array(bound);
+      var compressedSize = exports.compress(chunk, compressed);
+      if (compressedSize > 0) {
+        assert(compressedSize <= bound);
+        compressed = compressed.subarray(0, compressedSize);
+        compressedChunks.push(compressed);
+        total += compressedSize;
+        successes.push(1);
+        if (verify) {
+          var back = exports.uncompress(compressed, temp);
+          assert(back === chunk.length, [back, chunk.length]);
+          for (var i = 0; i < chunk.length; i++) {
+            assert(chunk[i] === temp[i]);
+          }
         }
+      } else {
+        assert(compressedSize === 0);
+        // failure to compress :(
+        compressedChunks.push(chunk);
+        total += chunk.length; // last chunk may not be the full exports.CHUNK_SIZE size
+        successes.push(0);
       }
-    } else {
-      assert(compressedSize === 0);
-      // failure to compress :(
-      compressedChunks.push(chunk);
-      total += chunk.length; // last chunk may not be the full exports.CHUNK_SIZE size
-      successes.push(0);
     }
   }
   data = null; // XXX null out pack['data'] too?
@@ -321,6 +333,7 @@ exports.compressPackage = function(data, verify) {
     sizes: [],
     successes: successes, // 1 if chunk is compressed
   };
+  if (fileChunks) compressedData.fileChunks = fileChunks; // file# => its first chunk
   offset = 0;
   for (var i = 0; i < compressedChunks.length; i++) {
     compressedData.data.set(compressedChunks[i], offset);
@@ -14,8 +14,44 @@ function processMacros(text) {
   });
 }
 
+// Evaluates a single condition of an #if, like FOO, !FOO or FOO == 1.
+function evaluatePreprocessorCondition(condition) {
+  var parts = condition.split(' ');
+  var ident = parts[0];
+  var op = parts[1];
+  var value = parts[2];
+  if (typeof value === 'string') {
+    // when writing
+    // #if option == 'stringValue'
+    // we need to get rid of the quotes
+    if (value[0] === '"' || value[0] === "'") {
+      assert(value[value.length - 1] == '"' || value[value.length - 1] == "'");
+      value = value.substring(1, value.length - 1);
+    }
+  }
+  if (op) {
+    if (op === '==') {
+      return ident in this && this[ident] == value;
+    } else if (op === '!=') {
+      return !(ident in this && this[ident] == value);
+    } else if (op === '<') {
+      return ident in this && this[ident] < value;
+    } else if (op === '>') {
+      return ident in this && this[ident] > value;
+    } else {
+      error('unsupported preprocessor op ' + op);
+    }
+  } else {
+    if (ident[0] === '!') {
+      return !(this[ident.substr(1)] > 0);
+    } else {
+      return ident in this && this[ident] > 0;
+    }
+  }
+}
+
 // Simple #if/else/endif preprocessing for a file. Checks if the
-// ident checked is true in our global.
+// ident checked is true in our global, or if all those joined by && are.
 // Also handles #include x.js (similar to C #include <file>)
 // Param filenameHint can be passed as a description to identify the file that is being processed, used
 // to locate errors for reporting.
@@ -36,38 +72,13 @@ function preprocess(text, filenameHint) {
       } else {
         if (line[1] == 'i') {
           if (line[2] == 'f') { // if
-            var parts = line.split(' ');
-            var ident = parts[1];
-            var op = parts[2];
-            var value = parts[3];
-            if (typeof value === 'string') {
-              // when writing
-              // #if option == 'stringValue'
-              // we need to get rid of the quotes
-              if (value[0] === '"' || value[0] === "'") {
-                assert(value[value.length - 1] == '"' || value[value.length - 1] == "'");
-                value = value.substring(1, value.length - 1);
-              }
-            }
-            if (op) {
-              if (op === '==') {
-                showStack.push(ident in this && this[ident] == value);
-              } else if (op === '!=') {
-                showStack.push(!(ident in this && this[ident] == value));
-              } else if (op === '<') {
-                showStack.push(ident in this && this[ident] < value);
-              } else if (op === '>') {
-                showStack.push(ident in this && this[ident] > value);
-              } else {
-                error('unsupported preprocessor op ' + op);
-              }
-            } else {
-              if (ident[0] === '!') {
-                showStack.push(!(this[ident.substr(1)] > 0));
-              } else {
-                showStack.push(ident in this && this[ident] > 0);
-              }
+            // #if a && b .. is true if all the conditions are
+            var conditions = line.substr(line.indexOf(' ') + 1).split('&&');
+            var show = true;
+            for (var j = 0; j < conditions.length; j++) {
+              show = evaluatePreprocessorCondition.call(this, conditions[j].trim()) && show;
             }
+            showStack.push(show);
           } else if (line[2] == 'n') { // include
             var filename = line.substr(line.indexOf(' ')+1);
             if (filename.indexOf('"') === 0) {
@@ -1468,6 +1479,52 @@ function makeEval(code) {
   return ret;
 }
 
+// Returns the source of embind's invoker factories for NO_DYNAMIC_EXECUTION, one for each number of arguments up to
+// maxArgs. Each builds the same kind of invoker that craftInvokerFunction otherwise generates with new Function,
+// so that calls neither loop over the argument types nor go through apply.
+function makeEmbindStaticInvokers(maxArgs) {
+  var factories = [];
+  for (var argCount = 0; argCount <= maxArgs; argCount++) {
+    var args = [], argsWired = [], setup = '', wire = '', dtors = '';
+    for (var i = 0; i < argCount; i++) {
+      args.push('arg' + i);
+      argsWired.push('arg' + i + 'Wired');
+      setup += 'var argType' + i + ' = argTypes[' + (i + 2) + '];\n' +
+               'var arg' + i + 'Dtor = needsDestructorStack ? null : argType' + i + '.destructorFunction;\n';
+      wire += 'var arg' + i + 'Wired = argType' + i + '.toWireType(destructors, arg' + i + ');\n';
+      dtors += 'if (arg' + i + 'Dtor) arg' + i + 'Dtor(arg' + i + 'Wired);\n';
+    }
+    var invoker = function(isClassMethod) {
+      return 'function(' + args.join(', ') + ') {\n' +
+        'if (arguments.length !== ' + argCount + ') {\n' +
+        "throwBindingError('function ' + humanName + ' called with ' + arguments.length + ' arguments, expected " + argCount + " args!');\n" +
+        '}\n' +
+        (EMSCRIPTEN_TRACING ? "Module.emscripten_trace_enter_context('embind::' + humanName);\n" : '') +
+        'var destructors = needsDestructorStack ? [] : null;\n' +
+        (isClassMethod ? 'var thisWired = classParam.toWireType(destructors, this);\n' : '') +
+        wire +
+        'var rv = invoker(' + ['fn'].concat(isClassMethod ? ['thisWired'] : [], argsWired).join(', ') + ');\n' +
+        'if (needsDestructorStack) {\n' +
+        'runDestructors(destructors);\n' +
+        '} else {\n' +
+        (isClassMethod ? 'if (thisDtor) thisDtor(thisWired);\n' : '') +
+        dtors +
+        '}\n' +
+        (EMSCRIPTEN_TRACING ? 'Module.emscripten_trace_exit_context();\n' : '') +
+        'if (returns) return retType.fromWireType(rv);\n' +
+        '}';
+    };
+    factories.push('function(humanName, argTypes, isClassMethodFunc, needsDestructorStack, returns, invoker, fn) {\n' +
+      'var retType = argTypes[0];\n' +
+      'var classParam = argTypes[1];\n' +
+      'var thisDtor = isClassMethodFunc && !needsDestructorStack ? classParam.destructorFunction : null;\n' +
+      setup +
+      'return isClassMethodFunc ? ' + invoker(true) + ' : ' + invoker(false) + ';\n' +
+      '}');
+  }
+  return factories.join(',\n');
+}
+
 function makeStaticAlloc(size) {
   size = (size + (STACK_ALIGN-1)) & -STACK_ALIGN;
   return 'STATICTOP; STATICTOP += ' + size + ';';
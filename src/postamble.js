@@ -3,9 +3,58 @@
 
 Module['asm'] = asm;
 
+#if STARTUP_TIMING
+markStartup('compile'); // the rest of the script, including creating the asm.js or wasm module (when that is synchronous)
+#endif
+
 {{{ exportRuntime() }}}
 
 #if MEM_INIT_IN_WASM == 0
+#if MEM_INIT_COMPRESSION
+#if MEM_INIT_COMPRESSION == 2
+#include "mini-lz4.js"
+#endif
+// Decodes the segments of [offset, length, data] of a memory initializer encoded with
+// MEM_INIT_COMPRESSION (see JS.compress_memory_initializer in tools/shared.py) straight into memory.
+function decodeMemoryInitializer(data) {
+  function readU32(pos) {
+    return (data[pos] | (data[pos+1] << 8) | (data[pos+2] << 16) | (data[pos+3] << 24)) >>> 0;
+  }
+  var pos = 0;
+  while (pos < data.length) {
+    var offset = GLOBAL_BASE + readU32(pos);
+    var end = offset + readU32(pos + 4);
+    pos += 8;
+#if ASSERTIONS && !SNAPSHOT
+    for (var i = offset; i < end; i++) {
+      assert(HEAPU8[i] === 0, "area for memory initializer should not have been touched before it's loaded");
+    }
+#endif
+#if MEM_INIT_COMPRESSION == 2
+    // blocks of up to 16K, each its compressed size (or 0 if stored as is) and data, see tools/lz4-meminit.js
+    for (; offset < end; offset += 16384) {
+      var size = Math.min(16384, end - offset);
+      var compressedSize = readU32(pos);
+      pos += 4;
+      if (compressedSize) {
+#if ASSERTIONS
+        assert(MiniLZ4.uncompress(data, HEAPU8, pos, pos + compressedSize, offset) === offset + size, 'memory initializer LZ4 block');
+#else
+        MiniLZ4.uncompress(data, HEAPU8, pos, pos + compressedSize, offset);
+#endif
+        pos += compressedSize;
+      } else {
+        HEAPU8.set(data.subarray(pos, pos + size), offset);
+        pos += size;
+      }
+    }
+#else
+    HEAPU8.set(data.subarray(pos, pos + end - offset), offset);
+    pos += end - offset;
+#endif
+  }
+}
+#endif
 #if MEM_INIT_METHOD == 2
 #if USE_PTHREADS
 if (memoryInitializer && !ENVIRONMENT_IS_PTHREAD) (function(s) {
@@ -29,15 +78,53 @@ if (memoryInitializer) (function(s) {
   }
   assert(crc === 0, "memory initializer checksum");
 #endif
+#if MEM_INIT_COMPRESSION
+  var data = new Uint8Array(n);
+  for (i = 0; i < n; ++i) {
+    data[i] = s.charCodeAt(i);
+  }
+  decodeMemoryInitializer(data);
+#else
   for (i = 0; i < n; ++i) {
     HEAPU8[GLOBAL_BASE + i] = s.charCodeAt(i);
   }
+#endif
+#if STARTUP_TIMING
+  markStartup('meminit');
+#endif
 })(memoryInitializer);
 #else
 #if USE_PTHREADS
 if (memoryInitializer && !ENVIRONMENT_IS_PTHREAD) {
 #else
 if (memoryInitializer) {
+#endif
+#if SNAPSHOT
+  if (!Module['snapshotCapture']) {
+    var snapshotFile = memoryInitializer.replace(/\.mem$/, '.snapshot');
+    if (typeof Module['locateFile'] === 'function') {
+      snapshotFile = Module['locateFile'](snapshotFile);
+    } else if (Module['memoryInitializerPrefixURL']) {
+      snapshotFile = Module['memoryInitializerPrefixURL'] + snapshotFile;
+    }
+    var applySnapshot = function(data) {
+      data = new Uint8Array(data);
+      var length = data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+      snapshotState = JSON.parse(UTF8ArrayToString(data.subarray(0, 4 + length), 4));
+      snapshotState.data = data.subarray(4 + length);
+    };
+    if (ENVIRONMENT_IS_NODE || ENVIRONMENT_IS_SHELL) {
+      applySnapshot(Module['readBinary'](snapshotFile));
+    } else {
+      addRunDependency('snapshot');
+      Module['readAsync'](snapshotFile, function(data) {
+        applySnapshot(data);
+        removeRunDependency('snapshot');
+      }, function() {
+        throw 'could not load snapshot ' + snapshotFile;
+      });
+    }
+  }
 #endif
   if (!isDataURI(memoryInitializer)) {
     if (typeof Module['locateFile'] === 'function') {
@@ -48,17 +135,31 @@ if (memoryInitializer) {
   }
   if (ENVIRONMENT_IS_NODE || ENVIRONMENT_IS_SHELL) {
     var data = Module['readBinary'](memoryInitializer);
+#if MEM_INIT_COMPRESSION
+    decodeMemoryInitializer(data);
+#else
     HEAPU8.set(data, GLOBAL_BASE);
+#endif
+#if STARTUP_TIMING
+    markStartup('meminit');
+#endif
   } else {
     addRunDependency('memory initializer');
     var applyMemoryInitializer = function(data) {
       if (data.byteLength) data = new Uint8Array(data);
-#if ASSERTIONS
+#if MEM_INIT_COMPRESSION
+      decodeMemoryInitializer(data);
+#else
+#if ASSERTIONS && !SNAPSHOT
       for (var i = 0; i < data.length; i++) {
         assert(HEAPU8[GLOBAL_BASE + i] === 0, "area for memory initializer should not have been touched before it's loaded");
       }
 #endif
       HEAPU8.set(data, GLOBAL_BASE);
+#endif
+#if STARTUP_TIMING
+      markStartup('meminit');
+#endif
       // Delete the typed array that contains the large blob of the memory initializer request response so that
       // we won't keep unnecessary memory lying around. However, keep the XHR object itself alive so that e.g.
       // its .status field can still be accessed later.
@@ -161,6 +262,43 @@ ExitStatus.prototype.constructor = ExitStatus;
 var initialStackTop;
 var calledMain = false;
 
+#if SNAPSHOT
+// Restores the files and atexits that tools/snapshot.py saved at emscripten_snapshot_point() (memory is already
+// restored, as it is the memory initializer), and continues from there, instead of calling main().
+function startFromSnapshot() {
+  snapshotState.files.forEach(function(file) {
+    var path = file[0], mode = file[1];
+    if (FS.isDir(mode)) {
+      if (!FS.analyzePath(path).exists) FS.mkdir(path, mode);
+    } else if (FS.isLink(mode)) {
+      FS.symlink(file[2], path);
+    } else {
+      FS.writeFile(path, snapshotState.data.subarray(file[2], file[3]), { encoding: 'binary' });
+      FS.chmod(path, mode);
+    }
+  });
+  FS.chdir(snapshotState.cwd);
+  __ATEXIT__.unshift.apply(__ATEXIT__, snapshotState.atexits.map(function(atexit) {
+    return { func: atexit[0], arg: atexit[1] };
+  }));
+  var resume = snapshotState.resume;
+  snapshotState = null;
+
+  try {
+    {{{ makeDynCall('v') }}}(resume);
+    exit(0, /* implicit = */ true);
+  } catch(e) {
+    if (e instanceof ExitStatus) {
+      return;
+    } else if (e == 'SimulateInfiniteLoop') {
+      Module['noExitRuntime'] = true;
+      return;
+    }
+    throw e;
+  }
+}
+#endif
+
 dependenciesFulfilled = function runCaller() {
   // If run has never been called, and we should call run (INVOKE_RUN is true, and Module.noInitialRun is not false)
   if (!Module['calledRun']) run();
@@ -273,12 +411,25 @@ function run(args) {
 
     if (ABORT) return;
 
+#if STARTUP_TIMING
+    markStartup('prerun'); // waiting for run dependencies (e.g. preloaded files) and preRun callbacks
+#endif
+
     ensureInitRuntime();
 
     preMain();
 
+#if STARTUP_TIMING
+    reportStartup();
+#endif
+
     if (Module['onRuntimeInitialized']) Module['onRuntimeInitialized']();
 
+#if SNAPSHOT
+    if (snapshotState) {
+      startFromSnapshot();
+    } else
+#endif
 #if HAS_MAIN
     if (Module['_main'] && shouldRunNow) Module['callMain'](args);
 #else
@@ -13,6 +13,29 @@ Module.realPrint = Module.print;
 Module.print = Module.printErr = function(){};
 #endif
 
+#if STARTUP_TIMING
+// Startup phases, as [name, end time] pairs. Each phase lasts from the end of
+// the previous one; the first, 'script', from when the process or page began
+// to when this code starts to run (0 if performance.now() is not available).
+var startupDateBase = Date.now();
+function startupNow() {
+  return (typeof performance === 'object' && performance && typeof performance['now'] === 'function') ? performance['now']() : Date.now() - startupDateBase;
+}
+var startupTimes = Module['startupTimes'] = [['script', startupNow()]];
+function markStartup(name) {
+  startupTimes.push([name, startupNow()]);
+}
+function reportStartup() {
+  var parts = [], last = 0;
+  for (var i = 0; i < startupTimes.length; i++) {
+    parts.push(startupTimes[i][0] + ': ' + (startupTimes[i][1] - last).toFixed(2));
+    last = startupTimes[i][1];
+  }
+  parts.push('total: ' + last.toFixed(2));
+  ({{{ BENCHMARK ? 'Module.realPrint' : "Module['printErr']" }}})('startup (ms): ' + parts.join(', '));
+}
+#endif
+
 #if SAFE_HEAP
 function getSafeHeapType(bytes, isFloat) {
   switch (bytes) {
@@ -194,9 +217,38 @@ function cwrap (ident, returnType, argTypes) {
   if (numericRet && numericArgs) {
     return cfunc;
   }
-  return function() {
-    return ccall(ident, returnType, argTypes, arguments);
+#if ASSERTIONS
+  assert(returnType !== 'array', 'Return type should not be "array".');
+#endif
+  // Otherwise, look up the conversions once here rather than on each call as
+  // ccall does, and only touch the stack if some argument needs it.
+  var converters = argTypes.map(function(type) { return toC[type] });
+  var hasConverters = converters.some(function(converter) { return !!converter });
+  var stringRet = returnType === 'string';
+  if (!hasConverters) {
+    return function() {
+#if ASSERTIONS && EMTERPRETIFY_ASYNC
+      assert(typeof EmterpreterAsync !== 'object' || !EmterpreterAsync.state, 'cannot start async op with normal JS calling cwrap');
+#endif
+      var ret = cfunc.apply(null, arguments);
+      return stringRet ? Pointer_stringify(ret) : ret;
+    };
   }
+  return function() {
+#if ASSERTIONS && EMTERPRETIFY_ASYNC
+    assert(typeof EmterpreterAsync !== 'object' || !EmterpreterAsync.state, 'cannot start async op with normal JS calling cwrap');
+#endif
+    var stack = stackSave();
+    var cArgs = new Array(arguments.length);
+    for (var i = 0; i < arguments.length; i++) {
+      var converter = converters[i];
+      cArgs[i] = converter ? converter(arguments[i]) : arguments[i];
+    }
+    var ret = cfunc.apply(null, cArgs);
+    if (stringRet) ret = Pointer_stringify(ret);
+    stackRestore(stack);
+    return ret;
+  };
 }
 
 /** @type {function(number, number, string, boolean=)} */
@@ -364,10 +416,38 @@ function getMemory(size) {
   return _malloc(size);
 }
 
+#if POINTER_STRINGIFY_CACHE
+// The strings decoded from static memory, by pointer. See POINTER_STRINGIFY_CACHE in settings.js
+var stringifyCache = {};
+
+/** @type {function(number, number=)} */
+function Pointer_stringify(ptr, length) {
+  if (length === undefined && ptr >= STATIC_BASE && ptr < STATIC_BASE + STATIC_BUMP) {
+    var ret = stringifyCache[ptr];
+    if (ret === undefined) ret = stringifyCache[ptr] = Pointer_stringify_uncached(ptr);
+    return ret;
+  }
+  return Pointer_stringify_uncached(ptr, length);
+}
+
+/** @type {function(number, number=)} */
+function Pointer_stringify_uncached(ptr, length) {
+#else
 /** @type {function(number, number=)} */
 function Pointer_stringify(ptr, length) {
+#endif
   if (length === 0 || !ptr) return '';
-  // TODO: use TextDecoder
+#if TEXTDECODER && SPLIT_MEMORY == 0
+  // TextDecoder needs the byte length in advance, which for a null-terminated string indexOf finds natively.
+  // Tiny strings are quicker in JS, as in UTF8ArrayToString.
+  if (UTF8Decoder) {
+    var end = length ? ptr + length : HEAPU8.indexOf(0, ptr);
+#if ASSERTIONS
+    assert(end >= 0 && end <= TOTAL_MEMORY);
+#endif
+    if (end - ptr > 16) return UTF8Decoder.decode(HEAPU8.subarray(ptr, end));
+  }
+#endif
   // Find the length, and check for UTF while doing so
   var hasUtf = 0;
   var t;
@@ -397,7 +477,7 @@ function Pointer_stringify(ptr, length) {
     }
     return ret;
   }
-  return UTF8ToString(ptr);
+  return UTF8ToString(ptr, length);
 }
 
 // Given a pointer 'ptr' to a null-terminated ASCII-encoded string in the emscripten HEAP, returns
@@ -420,17 +500,19 @@ function stringToAscii(str, outPtr) {
 }
 
 // Given a pointer 'ptr' to a null-terminated UTF8-encoded string in the given array that contains uint8 values, returns
-// a copy of that string as a Javascript String object.
+// a copy of that string as a Javascript String object. If maxBytesToRead is given, at most that many bytes are read,
+// so the string need not be null-terminated.
 
 #if TEXTDECODER
 var UTF8Decoder = typeof TextDecoder !== 'undefined' ? new TextDecoder('utf8') : undefined;
 #endif
-function UTF8ArrayToString(u8Array, idx) {
+function UTF8ArrayToString(u8Array, idx, maxBytesToRead) {
+  var endIdx = maxBytesToRead ? idx + maxBytesToRead : Infinity;
 #if TEXTDECODER
   var endPtr = idx;
   // TextDecoder needs to know the byte length in advance, it doesn't stop on null terminator by itself.
   // Also, use the length info to avoid running tiny strings through TextDecoder, since .subarray() allocates garbage.
-  while (u8Array[endPtr]) ++endPtr;
+  while (u8Array[endPtr] && endPtr < endIdx) ++endPtr;
 
   if (endPtr - idx > 16 && u8Array.subarray && UTF8Decoder) {
     return UTF8Decoder.decode(u8Array.subarray(idx, endPtr));
@@ -441,6 +523,7 @@ function UTF8ArrayToString(u8Array, idx) {
     var str = '';
     while (1) {
       // For UTF8 byte structure, see http://en.wikipedia.org/wiki/UTF-8#Description and https://www.ietf.org/rfc/rfc2279.txt and https://tools.ietf.org/html/rfc3629
+      if (idx >= endIdx) return str;
       u0 = u8Array[idx++];
       if (!u0) return str;
       if (!(u0 & 0x80)) { str += String.fromCharCode(u0); continue; }
@@ -476,10 +559,10 @@ function UTF8ArrayToString(u8Array, idx) {
 }
 
 // Given a pointer 'ptr' to a null-terminated UTF8-encoded string in the emscripten HEAP, returns
-// a copy of that string as a Javascript String object.
+// a copy of that string as a Javascript String object. If maxBytesToRead is given, at most that many bytes are read.
 
-function UTF8ToString(ptr) {
-  return UTF8ArrayToString({{{ heapAndOffset('HEAPU8', 'ptr') }}});
+function UTF8ToString(ptr, maxBytesToRead) {
+  return UTF8ArrayToString({{{ heapAndOffset('HEAPU8', 'ptr') }}}, maxBytesToRead);
 }
 
 // Copies the given Javascript String object 'str' to the given byte array at address 'outIdx',
@@ -947,7 +1030,7 @@ if (!Module['reallocBuffer']) Module['reallocBuffer'] = function(size) {
       var oldHEAP8 = HEAP8;
       ret = new ArrayBuffer(size);
       var temp = new Int8Array(ret);
-      temp.set(oldHEAP8);
+      temp.set(size < oldHEAP8.length ? oldHEAP8.subarray(0, size) : oldHEAP8); // Shrinks too, see shrinkMemory().
     }
   } catch(e) {
     return false;
@@ -958,9 +1041,83 @@ if (!Module['reallocBuffer']) Module['reallocBuffer'] = function(size) {
 };
 #endif
 
-function enlargeMemory() {
+#if ALLOW_MEMORY_GROWTH
+// Returns the heap size to grow to from size, so that it holds requested bytes.
+function growMemorySize(size, requested, PAGE_MULTIPLE, LIMIT) {
+  while (size < requested) { // Keep incrementing the heap size as long as it's less than what is requested.
+    var newSize;
+    if (size <= 536870912) {
+      newSize = size * {{{ MEMORY_GROWTH_FACTOR }}}; // Grow geometrically until 1GB...
+    } else {
+      newSize = (3 * size + 2147483648) / 4; // ..., but after that, add smaller increments towards 2GB, which we cannot reach
+    }
+#if MEMORY_GROWTH_MAX_STEP
+    newSize = Math.min(newSize, size + {{{ MEMORY_GROWTH_MAX_STEP }}});
+#endif
+    size = Math.min(alignUp(Math.max(newSize, size + PAGE_MULTIPLE), PAGE_MULTIPLE), LIMIT);
+  }
+  return size;
+}
+#endif
+
+#if USE_PTHREADS && ALLOW_MEMORY_GROWTH
+// All threads share one WebAssembly.Memory, and when any of them grows it, the compiled code of every thread sees
+// the new size right away. The JS views of each thread still point to the old, shorter buffer though, so each
+// thread calls this before it uses them after memory may have grown: when it grows memory itself, and when it
+// receives a message from another thread (growing memory posts one to every thread, see library_pthread.js).
+function refreshMemoryViews() {
+  var current = Module['wasmMemory'].buffer;
+  if (current.byteLength != buffer.byteLength) {
+    TOTAL_MEMORY = current.byteLength;
+    updateGlobalBuffer(current);
+    updateGlobalBufferViews();
+  }
+}
+#endif
+
+// Grows the heap so that it can hold the top of the dynamic heap, or minSize bytes if given. Returns whether it did.
+function enlargeMemory(minSize) {
 #if USE_PTHREADS
-  abort('Cannot enlarge memory arrays, since compiling with pthreads support enabled (-s USE_PTHREADS=1).');
+#if ALLOW_MEMORY_GROWTH
+  // Another thread may have grown memory already, or may be growing it right now. Growing is done by the
+  // missing amount, and it is the resulting size that tells whether this succeeded.
+  refreshMemoryViews();
+  var requested = minSize || Atomics.load(HEAP32, DYNAMICTOP_PTR>>2);
+  var LIMIT = Math.min({{{ WASM_MEM_MAX }}}, 2147483648 - WASM_PAGE_SIZE);
+  if (requested > LIMIT) {
+#if ASSERTIONS
+    Module.printErr('Cannot enlarge memory, asked to go up to ' + requested + ' bytes, but the limit is ' + LIMIT + ' bytes!');
+#endif
+    return false;
+  }
+  if (TOTAL_MEMORY >= requested) return true;
+
+  var OLD_TOTAL_MEMORY = TOTAL_MEMORY;
+  var start = Date.now();
+  var newSize = growMemorySize(TOTAL_MEMORY, requested, WASM_PAGE_SIZE, LIMIT);
+  try {
+    Module['wasmMemory'].grow(Math.max(newSize - Module['wasmMemory'].buffer.byteLength, 0) / WASM_PAGE_SIZE);
+  } catch(e) {
+#if ASSERTIONS
+    Module.printErr('Failed to grow the heap from ' + OLD_TOTAL_MEMORY + ' bytes to ' + newSize + ' bytes: ' + e);
+#endif
+  }
+  refreshMemoryViews();
+  if (TOTAL_MEMORY < requested) return false;
+
+  // Let the other threads refresh their views too.
+  if (ENVIRONMENT_IS_PTHREAD) postMessage({ cmd: 'memoryGrown' });
+  else PThread.refreshWorkerMemoryViews();
+
+  var msecs = Date.now() - start;
+  if (Module['onMemoryGrowth']) Module['onMemoryGrowth'](OLD_TOTAL_MEMORY, TOTAL_MEMORY, msecs);
+#if ASSERTIONS
+  Module.printErr('enlarged memory arrays from ' + OLD_TOTAL_MEMORY + ' to ' + TOTAL_MEMORY + ', took ' + msecs + ' ms');
+#endif
+  return true;
+#else
+  abort('Cannot enlarge memory arrays, since compiling with pthreads support enabled (-s USE_PTHREADS=1) without -s ALLOW_MEMORY_GROWTH=1.');
+#endif
 #else
 #if ALLOW_MEMORY_GROWTH == 0
 #if ABORTING_MALLOC
@@ -970,8 +1127,9 @@ function enlargeMemory() {
 #endif
 #else
   // TOTAL_MEMORY is the current size of the actual array, and DYNAMICTOP is the new top.
+  var requested = minSize || HEAP32[DYNAMICTOP_PTR>>2];
 #if ASSERTIONS
-  assert(HEAP32[DYNAMICTOP_PTR>>2] > TOTAL_MEMORY); // This function should only ever be called after the ceiling of the dynamic heap has already been bumped to exceed the current total size of the asm.js heap.
+  assert(requested > TOTAL_MEMORY); // This function should only ever be called after the ceiling of the dynamic heap has already been bumped to exceed the current total size of the asm.js heap.
 #endif
 
 #if EMSCRIPTEN_TRACING
@@ -982,27 +1140,19 @@ function enlargeMemory() {
   var PAGE_MULTIPLE = Module["usingWasm"] ? WASM_PAGE_SIZE : ASMJS_PAGE_SIZE; // In wasm, heap size must be a multiple of 64KB. In asm.js, they need to be multiples of 16MB.
   var LIMIT = 2147483648 - PAGE_MULTIPLE; // We can do one page short of 2GB as theoretical maximum.
 
-  if (HEAP32[DYNAMICTOP_PTR>>2] > LIMIT) {
+  if (requested > LIMIT) {
 #if ASSERTIONS
-    Module.printErr('Cannot enlarge memory, asked to go up to ' + HEAP32[DYNAMICTOP_PTR>>2] + ' bytes, but the limit is ' + LIMIT + ' bytes!');
+    Module.printErr('Cannot enlarge memory, asked to go up to ' + requested + ' bytes, but the limit is ' + LIMIT + ' bytes!');
 #endif
     return false;
   }
 
   var OLD_TOTAL_MEMORY = TOTAL_MEMORY;
-  TOTAL_MEMORY = Math.max(TOTAL_MEMORY, MIN_TOTAL_MEMORY); // So the loop below will not be infinite, and minimum asm.js memory size is 16MB.
+  TOTAL_MEMORY = Math.max(TOTAL_MEMORY, MIN_TOTAL_MEMORY); // So that growMemorySize() terminates, and minimum asm.js memory size is 16MB.
 
-  while (TOTAL_MEMORY < HEAP32[DYNAMICTOP_PTR>>2]) { // Keep incrementing the heap size as long as it's less than what is requested.
-    if (TOTAL_MEMORY <= 536870912) {
-      TOTAL_MEMORY = alignUp(2 * TOTAL_MEMORY, PAGE_MULTIPLE); // Simple heuristic: double until 1GB...
-    } else {
-      TOTAL_MEMORY = Math.min(alignUp((3 * TOTAL_MEMORY + 2147483648) / 4, PAGE_MULTIPLE), LIMIT); // ..., but after that, add smaller increments towards 2GB, which we cannot reach
-    }
-  }
+  TOTAL_MEMORY = growMemorySize(TOTAL_MEMORY, requested, PAGE_MULTIPLE, LIMIT);
 
-#if ASSERTIONS
   var start = Date.now();
-#endif
 
   var replacement = Module['reallocBuffer'](TOTAL_MEMORY);
   if (!replacement || replacement.byteLength != TOTAL_MEMORY) {
@@ -1022,8 +1172,11 @@ function enlargeMemory() {
   updateGlobalBuffer(replacement);
   updateGlobalBufferViews();
 
+  var msecs = Date.now() - start;
+  if (Module['onMemoryGrowth']) Module['onMemoryGrowth'](OLD_TOTAL_MEMORY, TOTAL_MEMORY, msecs);
+
 #if ASSERTIONS
-  Module.printErr('enlarged memory arrays from ' + OLD_TOTAL_MEMORY + ' to ' + TOTAL_MEMORY + ', took ' + (Date.now() - start) + ' ms (has ArrayBuffer.transfer? ' + (!!ArrayBuffer.transfer) + ')');
+  Module.printErr('enlarged memory arrays from ' + OLD_TOTAL_MEMORY + ' to ' + TOTAL_MEMORY + ', took ' + msecs + ' ms (has ArrayBuffer.transfer? ' + (!!ArrayBuffer.transfer) + ')');
 #endif
 
 #if ASSERTIONS
@@ -1043,6 +1196,38 @@ function enlargeMemory() {
 #endif // USE_PTHREADS
 }
 
+// Called by emscripten_trim_heap() after malloc_trim() has lowered the top of the dynamic heap from oldTop. Makes the
+// heap smaller if possible, and otherwise zeroes the released memory. Returns whether the heap was made smaller.
+function shrinkMemory(oldTop) {
+  var top = HEAP32[DYNAMICTOP_PTR>>2];
+#if ALLOW_MEMORY_GROWTH && !USE_PTHREADS && !BINARYEN
+  // Never go below the size that the application started with.
+  var newSize = Math.max(alignUp(top, ASMJS_PAGE_SIZE), Module['TOTAL_MEMORY'] || {{{ TOTAL_MEMORY }}}, MIN_TOTAL_MEMORY);
+  if (newSize < TOTAL_MEMORY) {
+    var OLD_TOTAL_MEMORY = TOTAL_MEMORY;
+    var replacement = Module['reallocBuffer'](newSize);
+    if (replacement && replacement.byteLength == newSize) {
+      TOTAL_MEMORY = newSize;
+      updateGlobalBuffer(replacement);
+      updateGlobalBufferViews();
+#if ASSERTIONS
+      Module.printErr('shrank memory arrays from ' + OLD_TOTAL_MEMORY + ' to ' + TOTAL_MEMORY);
+#endif
+      return true;
+    }
+  }
+#endif
+#if !USE_PTHREADS
+  // Wasm memory and SharedArrayBuffers cannot shrink. Zeroed pages are the cheapest ones to keep: engines and operating
+  // systems that lazily commit or deduplicate zero pages can reclaim them. (With pthreads another thread may already
+  // have taken this memory back with sbrk(), so it is left as is.)
+  var end = Math.min(oldTop, TOTAL_MEMORY);
+  if (HEAPU8.fill) HEAPU8.fill(0, top, end);
+  else for (var i = top; i < end; ++i) HEAPU8[i] = 0;
+#endif
+  return false;
+}
+
 #if ALLOW_MEMORY_GROWTH
 var byteLength;
 try {
@@ -1544,6 +1729,9 @@ function ensureInitRuntime() {
   __register_pthread_ptr(PThread.mainThreadBlock, /*isMainBrowserThread=*/!ENVIRONMENT_IS_WORKER, /*isMainRuntimeThread=*/1);
 #endif
   callRuntimeCallbacks(__ATINIT__);
+#if STARTUP_TIMING
+  markStartup('ctors'); // global constructors, which include embind's registrations, and the FS init
+#endif
 }
 
 function preMain() {
@@ -1825,6 +2013,28 @@ __ATEXIT__.push(function() { PGOMonitor.dump() });
 addOnPreRun(function() { addRunDependency('pgo') });
 #endif
 
+#if PROFILE_FUNCTION_ORDER
+var functionOrderProfiler = {
+  names: [], // function id => name, filled in by the js optimizer
+  counts: [], // function id => number of calls
+  order: [], // function ids, in the order they were first called
+  dump: function() {
+    var names = functionOrderProfiler.names;
+    Module.print(JSON.stringify(functionOrderProfiler.order.map(function(id) { return names[id] })));
+  }
+};
+function profileFunctionCall(id) {
+  var counts = functionOrderProfiler.counts;
+  if (!counts[id]) {
+    counts[id] = 0;
+    functionOrderProfiler.order.push(id);
+  }
+  counts[id]++;
+}
+Module['dumpFunctionOrder'] = functionOrderProfiler.dump;
+__ATEXIT__.push(function() { functionOrderProfiler.dump() });
+#endif
+
 #if RELOCATABLE
 {{{
 (function() {
@@ -1889,6 +2099,10 @@ function lookupSymbol(ptr) { // for a pointer, print out all symbols that resolv
 
 var memoryInitializer = null;
 
+#if SNAPSHOT
+var snapshotState = null; // set when the .snapshot file is loaded, see startFromSnapshot()
+#endif
+
 #if USE_PTHREADS
 #if PTHREAD_HINT_NUM_CORES < 0
 if (!ENVIRONMENT_IS_PTHREAD) addOnPreRun(function() {
@@ -1933,6 +2147,11 @@ if (!ENVIRONMENT_IS_PTHREAD) addOnPreRun(function() {
 if (!ENVIRONMENT_IS_PTHREAD) addOnPreRun(function() { if (typeof SharedArrayBuffer !== 'undefined') { addRunDependency('pthreads'); PThread.allocateUnusedWorkers({{{PTHREAD_POOL_SIZE}}}, function() { removeRunDependency('pthreads'); }); }});
 #endif
 
+#if PTHREAD_POOL_LOW_WATER_MARK > 0
+// Fill the pool up to its low-water mark in the background, without holding up the startup of the application.
+if (!ENVIRONMENT_IS_PTHREAD) addOnPreRun(function() { if (typeof SharedArrayBuffer !== 'undefined') PThread.replenishUnusedWorkers(); });
+#endif
+
 #if ASSERTIONS
 #if NO_FILESYSTEM
 var /* show errors on likely calls to FS when it was not included */ FS = {
@@ -2113,11 +2332,22 @@ function integrateWasmJS() {
     }
   }
 
+  // Returns a fetch of the wasm binary. The HTML may have started one already, in parallel with the JS (see
+  // Module['wasmBinaryRequest'] in emcc.py); a response can only be read once, so later calls fetch again.
+  function fetchWasmBinary() {
+    var request = Module['wasmBinaryRequest'];
+    if (request) {
+      delete Module['wasmBinaryRequest'];
+      return request;
+    }
+    return fetch(wasmBinaryFile, { credentials: 'same-origin' });
+  }
+
   function getBinaryPromise() {
     // if we don't have the binary yet, and have the Fetch api, use that
     // in some environments, like Electron's render process, Fetch api may be present, but have a different context than expected, let's only use it on the Web
     if (!Module['wasmBinary'] && (ENVIRONMENT_IS_WEB || ENVIRONMENT_IS_WORKER) && typeof fetch === 'function') {
-      return fetch(wasmBinaryFile, { credentials: 'same-origin' }).then(function(response) {
+      return fetchWasmBinary().then(function(response) {
         if (!response['ok']) {
           throw "failed to load wasm binary file at '" + wasmBinaryFile + "'";
         }
@@ -2240,7 +2470,7 @@ function integrateWasmJS() {
         typeof WebAssembly.instantiateStreaming === 'function' &&
         !isDataURI(wasmBinaryFile) &&
         typeof fetch === 'function') {
-      WebAssembly.instantiateStreaming(fetch(wasmBinaryFile, { credentials: 'same-origin' }), info)
+      WebAssembly.instantiateStreaming(fetchWasmBinary(), info)
         .then(receiveInstantiatedSource)
         .catch(function(reason) {
           // We expect the most common failure cause to be a bad MIME type for the binary,
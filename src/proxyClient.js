@@ -99,6 +99,8 @@ var frameId = 0;
 
 var SUPPORT_BASE64_EMBEDDING;
 
+var OFFSCREENCANVAS_SUPPORT = {{{ OFFSCREENCANVAS_SUPPORT }}};
+
 // Worker
 
 var filename;
@@ -118,6 +120,13 @@ var worker = new Worker(workerURL);
 WebGLClient.prefetch();
 
 setTimeout(function() {
+  // When the browser can, hand the canvas itself to the worker, which then renders to it directly instead of proxying
+  // each GL call and frame back here.
+  var offscreenCanvas = null;
+  if (OFFSCREENCANVAS_SUPPORT && Module.canvas.transferControlToOffscreen) {
+    offscreenCanvas = Module.canvas.transferControlToOffscreen();
+    Module.canvasTransferred = true;
+  }
   worker.postMessage({
     target: 'worker-init',
     width: Module.canvas.width,
@@ -125,7 +134,8 @@ setTimeout(function() {
     boundingClientRect: cloneObject(Module.canvas.getBoundingClientRect()),
     URL: document.URL,
     currentScriptUrl: filename,
-    preMain: true });
+    offscreenCanvas: offscreenCanvas,
+    preMain: true }, offscreenCanvas ? [offscreenCanvas] : []);
 }, 0); // delay til next frame, to make sure html is ready
 
 var workerResponded = false;
@@ -163,8 +173,10 @@ worker.onmessage = function worker_onmessage(event) {
           break;
         }
         case 'resize': {
-          Module.canvas.width = data.width;
-          Module.canvas.height = data.height;
+          if (!Module.canvasTransferred) { // otherwise the worker sizes the canvas itself
+            Module.canvas.width = data.width;
+            Module.canvas.height = data.height;
+          }
           if (Module.ctx && Module.ctx.getImageData) Module.canvasData = Module.ctx.getImageData(0, 0, data.width, data.height);
           worker.postMessage({ target: 'canvas', boundingClientRect: cloneObject(Module.canvas.getBoundingClientRect()) });
           break;
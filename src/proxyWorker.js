@@ -176,6 +176,12 @@ document.createElement = function document_createElement(what) {
         }
       };
       canvas.getContext = function canvas_getContext(type, attributes) {
+#if OFFSCREENCANVAS_SUPPORT
+        if (canvas.offscreenCanvas) {
+          // the client transferred us the real canvas, so render to it directly
+          return canvas.offscreenCanvas.getContext(type, attributes);
+        }
+#endif
         if (canvas === Module['canvas']) {
           postMessage({ target: 'canvas', op: 'getContext', type: type, attributes: attributes });
         }
@@ -234,6 +240,9 @@ document.createElement = function document_createElement(what) {
       Object.defineProperty(canvas, 'width', {
         set: function(value) {
           canvas.width_ = value;
+#if OFFSCREENCANVAS_SUPPORT
+          if (canvas.offscreenCanvas) canvas.offscreenCanvas.width = value;
+#endif
           if (canvas === Module['canvas']) {
             postMessage({ target: 'canvas', op: 'resize', width: canvas.width_, height: canvas.height_ });
           }
@@ -245,6 +254,9 @@ document.createElement = function document_createElement(what) {
       Object.defineProperty(canvas, 'height', {
         set: function(value) {
           canvas.height_ = value;
+#if OFFSCREENCANVAS_SUPPORT
+          if (canvas.offscreenCanvas) canvas.offscreenCanvas.height = value;
+#endif
           if (canvas === Module['canvas']) {
             postMessage({ target: 'canvas', op: 'resize', width: canvas.width_, height: canvas.height_ });
           }
@@ -462,6 +474,9 @@ function onMessageFromMainEmscriptenThread(message) {
     }
     case 'worker-init': {
       Module.canvas = document.createElement('canvas');
+#if OFFSCREENCANVAS_SUPPORT
+      Module.canvas.offscreenCanvas = message.data.offscreenCanvas;
+#endif
       screen.width = Module.canvas.width_ = message.data.width;
       screen.height = Module.canvas.height_ = message.data.height;
       Module.canvas.boundingClientRect = message.data.boundingClientRect;
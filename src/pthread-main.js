@@ -13,7 +13,8 @@ var STACK_BASE = 0;
 var STACKTOP = 0;
 var STACK_MAX = 0;
 
-// These are system-wide memory area parameters that are set at main runtime startup in main thread, and stay constant throughout the application.
+// These are system-wide memory area parameters that are set at main runtime startup in main thread, and stay constant throughout the application
+// (except for buffer and TOTAL_MEMORY, when memory can grow).
 var buffer; // All pthreads share the same Emscripten HEAP as SharedArrayBuffer with the main execution thread.
 var DYNAMICTOP_PTR = 0;
 var TOTAL_MEMORY = 0;
@@ -74,6 +75,10 @@ Module['instantiateWasm'] = function(info, receiveInstance) {
 
 this.onmessage = function(e) {
   try {
+//#if ALLOW_MEMORY_GROWTH
+    // Another thread may have grown memory since this one last looked at it.
+    if (typeof refreshMemoryViews === 'function') refreshMemoryViews();
+//#endif
     if (e.data.cmd === 'load') { // Preload command that is called once per worker to parse and load the Emscripten code.
       // Initialize the thread-local field(s):
       tempDoublePtr = e.data.tempDoublePtr;
@@ -124,9 +129,11 @@ this.onmessage = function(e) {
       //       Review why that is? Can those get out of sync?
       STACK_BASE = STACKTOP = e.data.stackBase;
       STACK_MAX = STACK_BASE + e.data.stackSize;
+      // With -s SAMPLING_PROFILER, the shadow stack of the thread is taken off the top of its stack.
+      if (typeof SamplingProfiler !== 'undefined') STACK_MAX = SamplingProfiler.threadStart(STACK_MAX);
       assert(STACK_BASE != 0);
       assert(STACK_MAX > STACK_BASE);
-      establishStackSpace(e.data.stackBase, e.data.stackBase + e.data.stackSize);
+      establishStackSpace(STACK_BASE, STACK_MAX);
       var result = 0;
 //#if STACK_OVERFLOW_CHECK
       if (typeof writeStackCookie === 'function') writeStackCookie();
@@ -171,6 +178,8 @@ this.onmessage = function(e) {
       }
     } else if (e.data.target === 'setimmediate') {
       // no-op
+    } else if (e.data.cmd === 'refreshMemoryViews') {
+      // Memory has grown, and the views were refreshed above.
     } else if (e.data.cmd === 'processThreadQueue') {
       if (threadInfoStruct) { // If this thread is actually running?
         _emscripten_current_thread_process_queued_calls();
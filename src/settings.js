@@ -55,6 +55,13 @@ var MEM_INIT_METHOD = 0; // How to represent the initial memory content.
                          // 1: create a *.mem file containing the binary data of the initial memory;
                          //    use the --memory-init-file command line switch to select this method
                          // 2: embed a string literal representing that initial memory data
+var MEM_INIT_COMPRESSION = 0; // How to encode the initial memory content in MEM_INIT_METHOD 1 and 2 (and in
+                              // the base64 data URI that method 0 uses with -O0 and SINGLE_FILE):
+                              // 0: the raw memory image
+                              // 1: segments of the nonzero data, skipping the runs of zeros in between,
+                              //    decoded straight into memory
+                              // 2: like 1, and also compress the segments with LZ4 (adds the MiniLZ4
+                              //    decoder to the output)
 var TOTAL_STACK = 5*1024*1024; // The total stack size. There is no way to enlarge the stack, so this
                                // value must be large enough for the program's requirements. If
                                // assertions are on, we will assert on not exceeding this, otherwise,
@@ -81,6 +88,20 @@ var ALLOW_MEMORY_GROWTH = 0; // If false, we abort with an error if we try to al
                              // ALLOW_MEMORY_GROWTH enables fully standard behavior, of both malloc
                              // returning 0 when it fails, and also of being able to allocate more
                              // memory from the system as necessary.
+                             // Every growth copies the heap, so to grow fewer times and at points of your
+                             // choosing, call emscripten_reserve_heap() ahead of large allocations. Set
+                             // Module['onMemoryGrowth'] = function(oldSize, newSize, msecs) to be told about
+                             // each growth and how long it took.
+                             // With USE_PTHREADS, memory growth requires WASM and WASM_MEM_MAX, and all
+                             // threads share the growable memory. A thread refreshes its JS views of the
+                             // heap when it grows memory or receives a message from another thread, so
+                             // JS code in a thread that is busy sees the old size until it yields.
+var MEMORY_GROWTH_FACTOR = 2; // When the heap grows, its size is multiplied by this factor until it is enough
+                              // for the new allocation, up to 1GB; after that, it grows towards 2GB in smaller
+                              // steps. Larger factors mean fewer copies of the heap, and more unused memory.
+var MEMORY_GROWTH_MAX_STEP = 0; // If > 0, the most bytes that a single step of heap growth adds, so that large
+                                // heaps grow in steps of this size, rather than geometrically. A single growth
+                                // still takes as many steps as needed for the allocation.
 
 var GLOBAL_BASE = -1; // where global data begins; the start of static memory. -1 means use the
                       // default, any other value will be used as an override
@@ -182,6 +203,11 @@ var OUTLINING_LIMIT = 0; // A function size above which we try to automatically
                          // it).
 
 var AGGRESSIVE_VARIABLE_ELIMINATION = 0; // Run aggressiveVariableElimination in js-optimizer.js
+var INLINE_SMALL_FUNCTIONS = 0; // If greater than 0, inline calls to small non-recursive functions
+                                // in the asm.js code, after LLVM has run. The value is the
+                                // largest function size to inline, as measured by the native
+                                // optimizer (20 is a reasonable setting). Each function can
+                                // grow by a limited amount. Requires the native optimizer.
 var SIMPLIFY_IFS = 1; // Whether to simplify ifs in js-optimizer.js
 
 // Generated code debugging options
@@ -189,6 +215,10 @@ var SAFE_HEAP = 0; // Check each write to the heap, for example, this will give
                    // error on what would be segfaults in a native build (like dereferencing
                    // 0). See preamble.js for the actual checks performed.
 var SAFE_HEAP_LOG = 0; // Log out all SAFE_HEAP operations
+var SAFE_HEAP_SKIP_REDUNDANT = 0; // With SAFE_HEAP, do not check an access that an earlier check in the same basic
+                                  // block covers (the same base pointer, not assigned in between, at an offset in the
+                                  // checked range that keeps the alignment). Faster to link and to run. Has no effect
+                                  // with SAFE_HEAP_LOG, which logs every access.
 
 var RESERVED_FUNCTION_POINTERS = 0; // In asm.js mode, we cannot simply add function pointers to
                                     // function tables, so we reserve some slots for them. An
@@ -247,6 +277,19 @@ var SOCKET_WEBRTC = 0; // Select socket backend, either webrtc or websockets. XX
 // Module['websocket'] = {url: 'wss://', subprotocol: 'base64'};
 // You can set 'subprotocol' to null, if you don't want to specify it
 // Run time configuration may be useful as it lets an application select multiple different services.
+//
+// With Module['websocket'] = {multiplex: true}, stream sockets that connect to the same WebSocket url share one
+// WebSocket, which saves a handshake per connection. This needs the bundled websockify run with --multiplex.
+//
+// Datagram sockets can use unreliable, unordered RTCDataChannels instead of WebSockets, which avoids head-of-line
+// blocking under packet loss. The application does the signaling, configured at run time like this:
+// Module['datachannel'] = {
+//   connect: function(addr, port) { ... }, // returns an RTCDataChannel (or a promise of one) to addr:port, ideally
+//                                          // created with { ordered: false, maxRetransmits: 0 }
+//   listen: function(port, accept) { ... } // optional, called when a datagram socket binds to port. calls
+//                                          // accept(channel, addr, port) for each peer that connects, and may
+//                                          // return a function that stops listening, called when the socket closes
+// };
 var WEBSOCKET_URL = 'ws://'; // A string containing either a WebSocket URL prefix (ws:// or wss://) or a complete
                              // RFC 6455 URL - "ws[s]:" "//" host [ ":" port ] path [ "?" query ].
                              // In the (default) case of only a prefix being specified the URL will be constructed from
@@ -256,10 +299,38 @@ var WEBSOCKET_SUBPROTOCOL = 'binary'; // A string containing a comma separated l
                                       // as would be present in the Sec-WebSocket-Protocol header.
 
 var OPENAL_DEBUG = 0; // Print out debugging information from our OpenAL implementation.
+var OPENAL_MIXER = 0; // If enabled, the OpenAL implementation mixes all the sources of a context into a single
+                      // ScriptProcessorNode, instead of scheduling a Web Audio buffer source node for each buffer
+                      // that a source plays from a timer. This avoids creating nodes while playing many sources,
+                      // and underruns when the timer is delayed, at the cost of doing the mixing in JS. Spatialized
+                      // sources get distance attenuation and equal power stereo panning, but no HRTF or source cones.
+
+var HTML5_COALESCE_EVENTS = 0; // If enabled, the html5.h callbacks of mousemove, wheel, touchmove, deviceorientation
+                               // and devicemotion events are called once per animation frame for the most recent of
+                               // the events, with the relative mouse movement and wheel deltas summed up, instead of
+                               // once for each event. The individual events are available from the callback with
+                               // emscripten_get_coalesced_events(). The mousemove and device event listeners are
+                               // registered as passive, so that they do not delay scrolling.
 
 var GL_ASSERTIONS = 0; // Adds extra checks for error situations in the GL library. Can impact performance.
 var TRACE_WEBGL_CALLS = 0; // If enabled, prints out all API calls to WebGL contexts. (*very* verbose)
 var GL_DEBUG = 0; // Enables more verbose debug printing of WebGL related operations. As with LIBRARY_DEBUG, this is toggleable at runtime with option GL.debug.
+var GL_STATE_CACHE = 0; // If enabled, keeps a copy of the buffer, texture, program, capability and glUniform1i/1f
+                        // state that the application sets through each context, and drops calls to glBindBuffer,
+                        // glBindTexture, glActiveTexture, glUseProgram, glEnable, glDisable, glUniform1i and glUniform1f
+                        // that would not change it, instead of passing them on to WebGL. The number of dropped calls is
+                        // returned by emscripten_webgl_get_redundant_state_changes(). The state must only be changed
+                        // through the GL functions, and not directly on the WebGL context from JS. Not compatible with
+                        // LEGACY_GL_EMULATION.
+var GL_PROGRAM_CACHE = 0; // If enabled, emscripten_webgl_prefetch_program() compiles and links shader programs ahead
+                          // of time, and glCompileShader() and glLinkProgram() take over the prefetched shaders and
+                          // programs that have the same sources and attribute bindings instead of compiling them again.
+var GL_PBO_UPLOAD_THRESHOLD = 0; // If nonzero, on WebGL 2 contexts, glTexImage2D and glTexSubImage2D calls that upload at
+                                 // least this many bytes from memory stage the pixels through a pixel unpack buffer, so that
+                                 // the browser fills the texture on the GPU asynchronously, instead of possibly waiting for the
+                                 // draws that use it. Smaller uploads, and all uploads on WebGL 1, pass the pixels directly,
+                                 // which on WebGL 2 does not create any garbage. Does not apply once GL_UNPACK_ROW_LENGTH or
+                                 // the unpack skips have been set.
 var GL_TESTING = 0; // When enabled, sets preserveDrawingBuffer in the context, to allow tests to work (but adds overhead)
 var GL_MAX_TEMP_BUFFER_SIZE = 2097152; // How large GL emulation temp buffers are
 var GL_UNSAFE_OPTS = 1; // Enables some potentially-unsafe optimizations in GL emulation code
@@ -320,6 +391,24 @@ var DISABLE_EXCEPTION_CATCHING = 0; // Disables generating code to actually catc
 var EXCEPTION_CATCHING_WHITELIST = [];  // Enables catching exception in the listed functions only, if
                                         // DISABLE_EXCEPTION_CATCHING = 2 is set
 
+var REMOVE_NOTHROW_INVOKES = 0; // With exception catching, calls that might throw go through invoke_* JS
+                                // functions that catch, which are slow and cannot be inlined. The same goes
+                                // for all calls in functions that call setjmp, as longjmp throws. If set, we
+                                // find at link time the functions that cannot throw or longjmp, by following
+                                // the whole call graph from what does (which treats JS library functions that
+                                // we cannot analyze as throwing), and call them directly instead. If 2, also
+                                // print a report of how many invokes were removed, and why the rest may throw.
+                                // Requires the asm.js optimizer, which this enables.
+
+var DEVIRTUALIZE_CALLS = 0; // Calls through function pointers, including virtual calls, are indirect calls
+                            // through a function table for their signature, which JS engines cannot inline.
+                            // If set to N, we find at link time the tables that hold at most N functions
+                            // (the rest being the entries for bad function pointers), and call those
+                            // functions directly at each call site through them, after checking the index.
+                            // Worth it for code with few implementations of each virtual method signature,
+                            // at some cost in code size. Requires the native optimizer, and is not done with
+                            // EMULATED_FUNCTION_POINTERS or RELOCATABLE, where tables change at runtime.
+
 var NODEJS_CATCH_EXIT = 1; // By default we handle exit() in node, by catching the Exit exception. However,
                            // this means we catch all process exceptions. If you disable this, then we no
                            // longer do that, and exceptions work normally, which can be useful for libraries
@@ -339,6 +428,14 @@ var ASYNCIFY_WHITELIST = ['qsort',   // Functions in this list are never conside
                           '__uflow',  // currently this link contains some functions in libc
                           '__fwritex',
                           'MUSL_vfprintf'];
+var ASYNCIFY_PRUNE_INDIRECT_CALLS = 0; // If 1, analyzes which functions each call through a function pointer can reach,
+                                       // and adds the functions that cannot reach an async function to the whitelist.
+                                       // Otherwise every function that calls through a function pointer, and all of
+                                       // their callers, are transformed. A call through a function pointer is assumed to
+                                       // reach the functions whose address is taken somewhere, and whose signature in the
+                                       // function tables matches the call (any of them, with
+                                       // EMULATE_FUNCTION_POINTER_CASTS), as well as exported functions. Not supported
+                                       // with dynamic linking, since other modules may add functions.
 
 var EXPORTED_RUNTIME_METHODS = [ // Runtime elements that are exported on Module by default. We used to export quite a lot here,
                                  // but have removed them all, so this option is redundant given that EXTRA_EXPORTED_RUNTIME_METHODS
@@ -361,10 +458,14 @@ var FS_LOG = 0; // Log all FS operations.  This is especially helpful when you'r
                 // so that you can create a virtual file system with all of the required files.
 var CASE_INSENSITIVE_FS = 0; // If set to nonzero, the provided virtual filesystem if treated case-insensitive, like
                              // Windows and OSX do. If set to 0, the VFS is case-sensitive, like on Linux.
-var MEMFS_APPEND_TO_TYPED_ARRAYS = 0; // If set to nonzero, MEMFS will always utilize typed arrays as the backing store
-                                      // for appending data to files. The default behavior is to use typed arrays for files
-                                      // when the file size doesn't change after initial creation, and for files that do
-                                      // change size, use normal JS arrays instead.
+var MEMFS_APPEND_TO_TYPED_ARRAYS = 0; // Has no effect, MEMFS now always uses typed arrays as the backing store of files,
+                                      // and grows them geometrically when appending. Previously, setting this was needed to
+                                      // avoid switching files that change size to normal JS arrays.
+var MEMFS_HEAP_FILE_SIZE = 0; // If > 0, MEMFS moves files of at least this many bytes into memory allocated from the
+                              // heap the first time they are read or mmap()ed. Reads from them are then a memcpy within
+                              // the heap, and mmap() of them returns a pointer to the file data instead of allocating a
+                              // copy, for shared mappings and for private ones without PROT_WRITE. The heap memory is
+                              // freed when the file is removed or reallocated, and is no longer mapped.
 var NO_FILESYSTEM = 0; // If set, does not build in any filesystem support. Useful if you are just doing pure
                        // computation, but not reading files or using any streams (including fprintf, and other
                        // stdio.h things) or anything related. The one exception is there is partial support for printf,
@@ -592,6 +693,12 @@ var MODULARIZE_INSTANCE = 0; // Similar to MODULARIZE, but while that mode expor
 var BENCHMARK = 0; // If 1, will just time how long main() takes to execute, and not
                    // print out anything at all whatsoever. This is useful for benchmarking.
 
+var STARTUP_TIMING = 0; // If 1, records when each phase of startup ends (the script starting to run,
+                        // the asm.js/wasm module being created, the memory initializer being applied,
+                        // run dependencies and preRun, and global constructors), keeps them in
+                        // Module.startupTimes, and prints how long each phase took to stderr before
+                        // main() is called. Used by the startup benchmarks in test_benchmark.py.
+
 var ASM_JS = 1; // If 1, generate code in asm.js format. If 2, emits the same code except
                 // for omitting 'use asm'
 var FINALIZE_ASM_JS = 1; // If 1, will finalize the final emitted code, including operations
@@ -624,6 +731,23 @@ var DEAD_FUNCTIONS = []; // JS library functions on this list are not converted
                          // error.
                          // TODO: make this work on compiled methods as well, perhaps by
                          //       adding a JS optimizer pass?
+var PROFILE_FUNCTION_ORDER = 0; // Instruments compiled functions to record the order in which they are
+                                // first called, and how often. When the runtime exits (see NO_EXIT_RUNTIME)
+                                // this prints the functions in first-call order (you can also print it by calling
+                                // Module['dumpFunctionOrder']()), which you can pass to FUNCTION_ORDER
+                                // in a build of the same code. Requires the native optimizer.
+var SAMPLING_PROFILER = 0; // If > 0, instruments compiled functions to keep a shadow stack of the functions that are
+                           // running on each thread, and a worker samples the shadow stacks every this many
+                           // milliseconds. Module['getSamplingProfile'](callback) passes the samples to callback as
+                           // collapsed stacks, the input format of flame graph tools, and
+                           // Module['dumpSamplingProfile']() prints them. The function names are those before
+                           // minification. Requires USE_PTHREADS, since the worker reads the shared heap, and the
+                           // native optimizer. Only applies to asm.js output.
+var FUNCTION_ORDER = []; // Compiled functions in the order they should appear in the output, usually the
+                         // list printed by a PROFILE_FUNCTION_ORDER build (-s FUNCTION_ORDER=@profile.json).
+                         // Functions not on the list are considered cold, and are placed after all others,
+                         // so engines that parse lazily can start running the hot ones sooner. This is
+                         // applied when the js optimizer runs.
 
 var EXPLICIT_ZEXT = 0; // If 1, generate an explicit conversion of zext i1 to i32, using ?:
 
@@ -657,6 +781,13 @@ var EMTERPRETIFY_FILE = ''; // If defined, a file to write bytecode to, otherwis
                             // When emitting HTML, we automatically generate code to load this file and set it to Module.emterpreterFile. If you
                             // emit JS, you need to make sure that Module.emterpreterFile contains an ArrayBuffer with the bytecode, when the code loads.
                             // Note: You might need to quote twice in the shell, something like     -s 'EMTERPRETIFY_FILE="waka"'
+var EMTERPRETIFY_FILE_SEGMENT_SIZE = 0; // If > 0, EMTERPRETIFY_FILE is split into segments of whole functions of at
+                                        // least this many bytes, which are loaded the first time one of their functions
+                                        // is called, so startup does not wait for all the bytecode. Each segment is
+                                        // fetched with a synchronous range request (or read from the file in node, or
+                                        // from Module.emterpreterFile, if set) and copied straight to where the
+                                        // emterpreter runs it. Synchronous requests for binary data only work well in
+                                        // workers; on the main thread the data is fetched as text and converted.
 var EMTERPRETIFY_BLACKLIST = []; // Functions to not emterpret, that is, to run normally at full speed
 var EMTERPRETIFY_WHITELIST = []; // If this contains any functions, then only the functions in this list
                                  // are emterpreted (as if all the rest are blacklisted; this overrides the BLACKLIST)
@@ -667,6 +798,40 @@ var EMTERPRETIFY_ADVISE = 0; // Performs a static analysis to suggest which func
                              // emcc argument when compiling later.
 var EMTERPRETIFY_SYNCLIST = []; // If you have additional custom synchronous functions, add them to this list and the advise mode
                                 // will include them in its analysis.
+var EMTERPRETIFY_PROFILE = 0; // Profiles which functions actually need to be emterpreted, at runtime, which is more
+                              // precise than EMTERPRETIFY_ADVISE. Counts the calls to each function, and with
+                              // EMTERPRETIFY_ASYNC, records which functions are on the stack each time the code pauses
+                              // for an async operation. After running the code through all the paths that matter, call
+                              // Module.printEmterpreterProfile() to get an EMTERPRETIFY_WHITELIST of the functions that
+                              // were on the stack, and an EMTERPRETIFY_BLACKLIST of the rest of the functions that were
+                              // called, most called first (Module.getEmterpreterProfile() returns them as arrays, which
+                              // can be saved as JSON and passed as -s EMTERPRETIFY_WHITELIST=@file).
+                              // Without EMTERPRETIFY_ASYNC only the blacklist is printed: the hot code, which can be
+                              // blacklisted while the cold code that was never called is emterpreted and, with
+                              // EMTERPRETIFY_FILE_SEGMENT_SIZE, only downloaded if it is ever called.
+var EMTERPRETIFY_SUPERINSTRUCTIONS = 0; // If > 0, adds up to this many superinstructions to the emterpreter, each of
+                                        // which runs a pair of instructions that often follow each other (like a load
+                                        // and the operation on its result, or an operation and the compare and branch
+                                        // on it) with one dispatch instead of two. The pairs are picked by how often
+                                        // they appear in the bytecode, weighing those inside loops more. Makes the
+                                        // emterpreter larger, but the emterpreted code faster.
+
+var COMPACT_MALLOC = 0; // If true, link in a small malloc with power-of-two size classes instead of dlmalloc. It is a
+                        // fraction of the code size of dlmalloc, and its malloc and free run in constant time, but it
+                        // never splits, merges or gives back blocks, so allocations take up to twice their size.
+                        // Useful for small modules that allocate little, and care about code size and startup time.
+                        // Not thread-safe, so it cannot be used with USE_PTHREADS, nor with SPLIT_MEMORY.
+
+var FAST_FLOAT_CONVERSION = 0; // If true, link in a libc whose printf (%e, %f, %g) and strtod/atof first try fast
+                               // conversions that work in 64-bit integer arithmetic (Grisu-style digit generation and
+                               // Eisel-Lemire parsing), and fall back to musl's exact big-number code in the rare cases
+                               // those cannot decide. Results are identical either way. Adds about 11KB of tables.
+
+var LIBCXX_C_LOCALE_ONLY = 0; // If true, link in a libc++ whose ostreams format numbers as the "C" locale does,
+                              // without looking up facets in the stream's locale: num_put is found once, and digits
+                              // are neither widened through ctype nor grouped through numpunct. Integers in decimal
+                              // are written without snprintf. Faster for code that logs a lot through std::ostream,
+                              // but an imbued locale no longer affects how numbers are printed.
 
 var SPLIT_MEMORY = 0; // If > 0, we split memory into chunks, of the size given in this parameter.
                       //  * TOTAL_MEMORY becomes the maximum amount of memory, as chunks are allocated on
@@ -684,6 +849,18 @@ var BOOTSTRAPPING_STRUCT_INFO = 0; // whether we are in the generate struct_info
 
 var EMSCRIPTEN_TRACING = 0; // Add some calls to emscripten tracing APIs
 
+var TRACE_BUFFER = 0; // If > 0, with --tracing or --memoryprofiler, the malloc library writes allocation, reallocation
+                      // and free events into a ring buffer of this many bytes in the heap, instead of calling out to
+                      // JS for each one. The memory profiler and the trace collector drain it in batches, every
+                      // 100ms and whenever another event is traced. Each event takes 32 bytes, and events are dropped
+                      // when the buffer is full. Event times are those of the last drain. 262144 is a good start.
+
+var HEAP_PROFILER = 0; // If > 0, link in a sampling heap profiler in the malloc library. On average one allocation is
+                       // sampled for every this many bytes allocated, and its call stack is captured. The profile of
+                       // the sampled allocations can be written in the format of pprof, see emscripten/heap_profiler.h.
+                       // 524288 keeps the overhead low enough for release builds. Not supported with USE_PTHREADS,
+                       // SPLIT_MEMORY or COMPACT_MALLOC.
+
 var USE_GLFW = 2; // Specify the GLFW version that is being linked against.
                   // Only relevant, if you are linking against the GLFW library.
                   // Valid options are 2 for GLFW2 and 3 for GLFW3.
@@ -791,6 +968,11 @@ var USE_PTHREADS = 0; // If true, enables support for pthreads.
 
 var PTHREAD_POOL_SIZE = 0; // Specifies the number of web workers that are preallocated before runtime is initialized. If 0, workers are created on demand.
 
+var PTHREAD_POOL_LOW_WATER_MARK = 0; // If > 0, the pool of unused web workers is kept at least this large: whenever pthread_create() takes
+                                     // a worker from the pool and fewer than this many remain, new workers are created and loaded in the
+                                     // background. Unlike PTHREAD_POOL_SIZE, this does not delay the startup of the application. Use it to
+                                     // keep pthread_create() fast when threads are created in bursts.
+
 var DEFAULT_PTHREAD_STACK_SIZE = 2*1024*1024; // If not explicitly specified, this is the stack size to use for newly created pthreads.
                                               // According to http://man7.org/linux/man-pages/man3/pthread_create.3.html, default stack size on
                                               // Linux/x86-32 for a new thread is 2 megabytes, so follow the same convention. Use
@@ -804,7 +986,25 @@ var DEFAULT_PTHREAD_STACK_SIZE = 2*1024*1024; // If not explicitly specified, th
 // to show a popup dialog at startup so the user can configure this dynamically.
 var PTHREAD_HINT_NUM_CORES = 4;
 
+// If nonzero, and building with -s ASYNCIFY=1, a futex wait on the main browser thread (e.g. in a contended
+// pthread_mutex_lock()) spins for a bounded number of iterations, and then yields to the browser event loop and resumes the
+// waiting code when the futex is woken, instead of blocking the page. The spin starts at this many iterations, and adapts to
+// the number of iterations that the recent waits on the same futex needed, up to 100 times the value. Adds
+// emscripten_futex_wait to ASYNCIFY_FUNCTIONS, so the usual restrictions of asyncify apply to the code that locks on the
+// main thread. (EMTERPRETIFY_ASYNC does not work here, since the emterpreter is not supported with pthreads.)
+var PTHREADS_MAIN_THREAD_ASYNC_WAIT = 0;
+
+var MALLOC_THREAD_CACHE = 0; // If true, malloc() and free() keep a small cache of free blocks of up to 512 bytes for each
+                             // thread in front of dlmalloc, so that most small allocations do not take the global malloc
+                             // lock. Helps allocation heavy code that runs on many threads, at the cost of some memory
+                             // held in the caches of the threads. Requires -s USE_PTHREADS=1/2.
+
 var PTHREADS_PROFILING = 0; // True when building with --threadprofiler
+var PTHREADS_PROFILING_TIMELINE = 16384; // With --threadprofiler, how many of the most recent thread status changes
+                                         // (running, waiting for a futex, a mutex or a proxied operation, ...) to keep
+                                         // in a timeline of all threads. Module['getThreadTimeline']() returns the
+                                         // timeline, and Module['getThreadTimelineTrace']() returns it in the Chrome
+                                         // trace event format. 0 disables the timeline.
 
 var PTHREADS_DEBUG = 0; // If true, add in debug traces for diagnosing pthreads related issues.
 
@@ -814,10 +1014,13 @@ var MAX_GLOBAL_ALIGN = -1; // received from the backend
 // identical, which can happen e.g. if two methods have different C/C++
 // or LLVM types, but end up identical at the asm.js level (all pointers
 // are the same as int32_t in asm.js, for example).
-// This option is quite slow to run, as it processes and hashes all methods
-// in the codebase in multiple passes.
+// When the native optimizer is available, this is done in one pass over the
+// call graph, which also removes functions that are not reachable from the
+// exports and function tables, and folds functions that only differ in the
+// names of their locals. Otherwise this is quite slow to run, as it processes
+// and hashes all methods in the codebase in multiple passes.
 var ELIMINATE_DUPLICATE_FUNCTIONS = 0; // disabled by default
-var ELIMINATE_DUPLICATE_FUNCTIONS_PASSES = 5;
+var ELIMINATE_DUPLICATE_FUNCTIONS_PASSES = 5; // the native pass instead runs until nothing changes
 var ELIMINATE_DUPLICATE_FUNCTIONS_DUMP_EQUIVALENT_FUNCTIONS = 0;
 
 var EVAL_CTORS = 0; // This tries to evaluate global ctors at compile-time, applying their
@@ -858,6 +1061,37 @@ var EVAL_CTORS = 0; // This tries to evaluate global ctors at compile-time, appl
                     // issue for LLVM is that it doesn't know that we will not link in
                     // further code, so it only tries to optimize ctors with lowest
                     // priority. We do know that, and can optimize all the ctors.
+                    //
+                    // Evaluation normally stops at the first ctor that cannot be evaluated.
+                    // With EVAL_CTORS=2, the ones after it are still evaluated, as long as
+                    // they do not touch memory that it touched before it failed; the ctors
+                    // that are left run at startup, in their original order. When there are
+                    // many ctors, they are first evaluated each on its own, in parallel, and
+                    // only those that depend on the effects of earlier ones are then
+                    // evaluated one after the other.
+var EVAL_CTORS_PURE_IMPORTS = ['___lock', '___unlock', '___lockfile', '___unlockfile',
+                               '_pthread_mutex_init', '_pthread_mutex_destroy',
+                               '_pthread_cond_signal', '_pthread_cond_broadcast'];
+                    // JS library functions that ctors may call while they are evaluated. Their
+                    // JS is run in the sandbox too, so one that uses anything but its arguments
+                    // and HEAP* still fails the ctor, but one that does something nondeterministic
+                    // or that has side effects outside of memory should not be added here.
+var EVAL_CTORS_MAX_ALLOCATION = 1048576; // How much memory ctors may malloc while they are evaluated. It
+                                         // is taken from right after the static data, which
+                                         // grows by what was used, and malloc continues in the
+                                         // dynamic heap at runtime. A ctor that needs more is not
+                                         // evaluated.
+
+var SNAPSHOT = 0; // Starts the program from a snapshot of its state taken at build time, which goes
+                  // further than EVAL_CTORS: after compiling, the program is run in node until it
+                  // calls emscripten_snapshot_point(resume) (see emscripten.h), and its memory
+                  // (including the dynamic heap) becomes the memory init file, while its files
+                  // and atexits go to a .snapshot file next to it. When the program is then
+                  // loaded, it skips the global ctors and main(), restores the files, and calls
+                  // resume() instead. Everything up to the snapshot point must be deterministic,
+                  // must not depend on the environment it runs in, and must leave its state in
+                  // memory or in files, as the stack and JS state (other than those files) are
+                  // not part of the snapshot. Requires a memory init file.
 
 var CYBERDWARF = 0; // see http://kripken.github.io/emscripten-site/docs/debugging/CyberDWARF.html
 
@@ -866,15 +1100,53 @@ var BUNDLED_CD_DEBUG_FILE = ""; // Path to the CyberDWARF debug file passed to t
 var TEXTDECODER = 1; // Is enabled, use the JavaScript TextDecoder API for string marshalling.
                      // Enabled by default, set this to 0 to disable.
 
+var POINTER_STRINGIFY_CACHE = 0; // If 1, Pointer_stringify remembers the strings it decodes from static memory, where the
+                                 // string constants of the program are, and returns them again for the same pointer
+                                 // without decoding. This helps libraries that decode the same constants over and over,
+                                 // like GL extension names and html5 event target selectors. Only enable this if the
+                                 // program does not change strings in static memory after passing them to JS, for
+                                 // example a global char array that it writes names into.
+
+var PRELOAD_IMAGE_WORKERS = 0; // If nonzero, the image preload plugin (see --use-preload-plugins) decodes
+                               // images in up to this many workers, in parallel, using createImageBitmap
+                               // and OffscreenCanvas, when the browser supports them. Module.preloadedImages
+                               // then holds ImageData objects (with the RGBA pixels) instead of canvases;
+                               // IMG_Load and emscripten_get_preloaded_image_data accept both.
+
+var TTY_BATCH_OUTPUT = 0; // In node, when stdout or stderr is not a terminal (e.g. a pipe or a file),
+                          // queue up complete lines written to it and print them with a single
+                          // Module.print/printErr call when the runtime is next idle, when many have
+                          // queued up, on fflush(), or when node exits. Module.print/printErr then get
+                          // several lines at once, separated by newlines. Terminals are still
+                          // written line by line. (Output is decoded a line at a time, instead of a
+                          // character at a time, regardless of this setting.)
+
+var EMBIND_STD_STRING_IS_UTF8 = 0; // With embind, marshall std::string and std::string_view as UTF-8 instead of
+                                   // Latin-1, so that strings from JavaScript can have any character, and strings
+                                   // from C++ are decoded with TextDecoder when it is available.
+
 var OFFSCREENCANVAS_SUPPORT = 0; // If set to 1, enables support for transferring canvases to pthreads and creating WebGL contexts in them,
                                  // as well as explicit swap control for GL contexts. This needs browser support for the OffscreenCanvas
-                                 // specification.
+                                 // specification. With --proxy-to-worker, it also transfers the canvas to the worker when the browser
+                                 // supports it, so the worker renders to it directly instead of proxying GL calls to the main thread.
 
 var FETCH_DEBUG = 0; // If nonzero, prints out debugging information in library_fetch.js
 
 var FETCH = 0; // If nonzero, enables emscripten_fetch API.
 
 var ASMFS = 0; // If set to 1, uses the multithreaded filesystem that is implemented within the asm.js module, using emscripten_fetch. Implies -s FETCH=1.
+               // Files packaged with --preload-file are imported to ASMFS in one pass over a manifest in the package, and read
+               // straight from the package data. --embed-file is not supported.
+var ASMFS_TRACE = 0; // If set to 1, ASMFS logs to the console the errors that its syscalls return. If set to 2, it also logs
+                     // every syscall and every change to the filesystem tree. Independent of this, counts of the file
+                     // operations can be printed out with emscripten_asmfs_dump_stats().
+var ASMFS_LAZY_LOAD = 0; // If set to 1, ASMFS downloads only the parts of a file that are read, using HTTP Range requests,
+                         // instead of downloading the whole file when it is opened. Sequential reads fetch ahead of
+                         // themselves. If the server does not support Range requests, whole files are downloaded as before.
+var ASMFS_WRITEBACK = 0; // If set to 1, ASMFS stores the files that are written to in IndexedDB, where they are found again
+                         // by open() after the page is reloaded. Files are stored when they are closed, fsync()ed or
+                         // sync()ed, and otherwise at most once every ASMFS_WRITEBACK_DELAY msecs while they are written to.
+var ASMFS_WRITEBACK_DELAY = 1000; // How many msecs a file may be written to before ASMFS_WRITEBACK stores it.
 
 var SINGLE_FILE = 0; // If set to 1, embeds all subresources in the emitted file as base64 string
                      // literals. Embedded subresources may include (but aren't limited to)
@@ -113,28 +113,39 @@ function loadWebAssemblyModule(binary) {
   assert(binary[next] === 'k'.charCodeAt(0)); next++;
   var memorySize = getLEB();
   var tableSize = getLEB();
-  var env = Module['asmLibraryArg'];
-  // TODO: use only memoryBase and tableBase, need to update asm.js backend
+  var module = new WebAssembly.Module(binary);
   var table = Module['wasmTable'];
   var oldTableSize = table.length;
-  env['memoryBase'] = env['gb'] = alignMemory(getMemory(memorySize + STACK_ALIGN), STACK_ALIGN); // TODO: add to cleanups
-  env['tableBase'] = env['fb'] = oldTableSize;
+  // TODO: use only memoryBase and tableBase, need to update asm.js backend
+  var memoryBase = alignMemory(getMemory(memorySize + STACK_ALIGN), STACK_ALIGN); // TODO: add to cleanups
+  var tableBase = oldTableSize;
   var originalTable = table;
   table.grow(tableSize);
   assert(table === originalTable);
   // zero-initialize memory and table TODO: in some cases we can tell it is already zero initialized
-  for (var i = env['memoryBase']; i < env['memoryBase'] + memorySize; i++) {
-    HEAP8[i] = 0;
+  if (HEAP8.fill) {
+    HEAP8.fill(0, memoryBase, memoryBase + memorySize);
+  } else {
+    for (var i = memoryBase; i < memoryBase + memorySize; i++) {
+      HEAP8[i] = 0;
+    }
   }
-  for (var i = env['tableBase']; i < env['tableBase'] + tableSize; i++) {
+  for (var i = tableBase; i < tableBase + tableSize; i++) {
     table.set(i, null);
   }
-  // copy currently exported symbols so the new module can import them
-  for (var x in Module) {
-    if (!(x in env)) {
-      env[x] = Module[x];
+  // resolve just the symbols this module imports, from the runtime or from what is exported so far (by the main
+  // module and the side modules loaded before this one), rather than copying all of Module for each module
+  var libraryArg = Module['asmLibraryArg'];
+  var env = {};
+  var imports = WebAssembly.Module.imports(module);
+  for (var i = 0; i < imports.length; i++) {
+    var name = imports[i].name;
+    if (imports[i].module === 'env' && !(name in env)) {
+      env[name] = name in libraryArg ? libraryArg[name] : Module[name];
     }
   }
+  env['memoryBase'] = env['gb'] = memoryBase;
+  env['tableBase'] = env['fb'] = tableBase;
   var info = {
     global: {
       'NaN': NaN,
@@ -150,7 +161,7 @@ function loadWebAssemblyModule(binary) {
   }
 #endif
   // create a module from the instance
-  var instance = new WebAssembly.Instance(new WebAssembly.Module(binary), info);
+  var instance = new WebAssembly.Instance(module, info);
 #if ASSERTIONS
   // the table should be unchanged
   assert(table === originalTable);
@@ -172,7 +183,7 @@ function loadWebAssemblyModule(binary) {
     var value = instance.exports[e];
     if (typeof value === 'number') {
       // relocate it - modules export the absolute value, they can't relocate before they export
-      value = value + env['memoryBase'];
+      value = value + memoryBase;
     }
     exports[e] = value;
   }
@@ -327,19 +338,34 @@ function getFuncWrapper(func, sig) {
   }
   var sigCache = funcWrappers[sig];
   if (!sigCache[func]) {
+    // find the dynCall for the signature once, here, instead of on each call
+    var dc = Module['dynCall_' + sig];
+#if ASSERTIONS
+    assert(dc, 'bad function pointer type - no table for sig \'' + sig + '\'');
+#endif
     // optimize away arguments usage in common cases
     if (sig.length === 1) {
       sigCache[func] = function dynCall_wrapper() {
-        return dynCall(sig, func);
+        return dc(func);
       };
     } else if (sig.length === 2) {
       sigCache[func] = function dynCall_wrapper(arg) {
-        return dynCall(sig, func, [arg]);
+        return dc(func, arg);
+      };
+    } else if (sig.length === 3) {
+      sigCache[func] = function dynCall_wrapper(arg1, arg2) {
+        return dc(func, arg1, arg2);
+      };
+    } else if (sig.length === 4) {
+      sigCache[func] = function dynCall_wrapper(arg1, arg2, arg3) {
+        return dc(func, arg1, arg2, arg3);
       };
     } else {
       // general case
       sigCache[func] = function dynCall_wrapper() {
-        return dynCall(sig, func, Array.prototype.slice.call(arguments));
+        var args = [func];
+        for (var i = 0; i < arguments.length; i++) args.push(arguments[i]);
+        return dc.apply(null, args);
       };
     }
   }
@@ -5,6 +5,9 @@ var emscriptenThreadProfiler = {
   // UI div element.
   threadProfilerDiv: null,
 
+  // UI div element of the current status of each thread, below the link that saves the timeline.
+  threadStatusDiv: null,
+
   // Installs startup hook and periodic UI update timer.
   initialize: function initialize() {
     this.threadProfilerDiv = document.getElementById('threadprofiler');
@@ -14,6 +17,15 @@ var emscriptenThreadProfiler = {
       document.body.appendChild(div);
       this.threadProfilerDiv = document.getElementById('threadprofiler');
     }
+    if (typeof Module['getThreadTimelineTrace'] === 'function') {
+      var save = document.createElement('a');
+      save.href = '#';
+      save.textContent = 'Save timeline of all threads (Chrome trace event format)';
+      save.onclick = function() { emscriptenThreadProfiler.saveTimeline(); return false; };
+      this.threadProfilerDiv.appendChild(save);
+    }
+    this.threadStatusDiv = document.createElement('div');
+    this.threadProfilerDiv.appendChild(this.threadStatusDiv);
     setInterval(function() { emscriptenThreadProfiler.updateUi() }, this.uiUpdateIntervalMsecs);
   },
 
@@ -49,7 +61,17 @@ var emscriptenThreadProfiler = {
       if (recent.length > 0) str += 'Recent activity: ' + recent;
       str += '<br />';
     }
-    this.threadProfilerDiv.innerHTML = str;
+    this.threadStatusDiv.innerHTML = str;
+  },
+
+  // Downloads the timeline that library_pthread.js records, which loads into chrome://tracing and Perfetto.
+  saveTimeline: function saveTimeline() {
+    var a = document.createElement('a');
+    a.href = URL.createObjectURL(new Blob([Module['getThreadTimelineTrace']()], { type: 'application/json' }));
+    a.download = 'thread-timeline.json';
+    document.body.appendChild(a);
+    a.click();
+    document.body.removeChild(a);
   }
 };
 
@@ -8,7 +8,8 @@ function WebGLClient() {
   var objects = {};
 
   var ctx = null;
-  var buffer = null;
+  var buffer = null; // Float64Array of opcodes and numeric arguments, see the encoding in webGLWorker.js
+  var payloads = null; // the non-numeric arguments, referred to by index from the buffer
   var i = 0;
   var skippable = false;
   var currFrameBuffer = null;
@@ -40,24 +41,46 @@ function WebGLClient() {
     ctx[name](buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5]);
     i += 6;
   }
-  function func7(name) {
-    ctx[name](buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5], buffer[i+6]);
+
+  // the last argument is a payload
+  function func1P(name) {
+    ctx[name](payloads[buffer[i]]);
+    i++;
+  }
+  function func3P(name) {
+    ctx[name](buffer[i], buffer[i+1], payloads[buffer[i+2]]);
+    i += 3;
+  }
+  function func7P(name) {
+    ctx[name](buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5], payloads[buffer[i+6]]);
     i += 7;
   }
-  function func9(name) {
-    ctx[name](buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5], buffer[i+6], buffer[i+7], buffer[i+8]);
+  function func9P(name) {
+    ctx[name](buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5], buffer[i+6], buffer[i+7], payloads[buffer[i+8]]);
     i += 9;
   }
 
+  // inline arrays, a length followed by the elements, are read into scratch typed arrays of that length
+  var float32Arrays = [];
+  var int32Arrays = [];
+  function floatArray() {
+    var n = buffer[i++];
+    var array = float32Arrays[n] || (float32Arrays[n] = new Float32Array(n));
+    for (var j = 0; j < n; j++) array[j] = buffer[i++];
+    return array;
+  }
+  function intArray() {
+    var n = buffer[i++];
+    var array = int32Arrays[n] || (int32Arrays[n] = new Int32Array(n));
+    for (var j = 0; j < n; j++) array[j] = buffer[i++];
+    return array;
+  }
+
   // lookuppers, convert integer ids to cached objects for some args
   function func1L0(name) {
     ctx[name](objects[buffer[i]]);
     i++;
   }
-  function func2L0(name) {
-    ctx[name](objects[buffer[i]], buffer[i+1]);
-    i += 2;
-  }
   function func2L0L1(name) {
     ctx[name](objects[buffer[i]], objects[buffer[i+1]]);
     i += 2;
@@ -66,8 +89,12 @@ function WebGLClient() {
     ctx[name](buffer[i], buffer[i+1] ? objects[buffer[i+1]] : null);
     i += 2;
   }
-  function func3L0(name) {
-    ctx[name](objects[buffer[i]], buffer[i+1], buffer[i+2]);
+  function func2L0P(name) {
+    ctx[name](objects[buffer[i]], payloads[buffer[i+1]]);
+    i += 2;
+  }
+  function func3L0P(name) {
+    ctx[name](objects[buffer[i]], buffer[i+1], payloads[buffer[i+2]]);
     i += 3;
   }
   function func4L3_(name) {
@@ -95,8 +122,8 @@ function WebGLClient() {
     var id = buffer[i++];
     objects[id] = object;
   }
-  function funcC2L0(name) {
-    var object = ctx[name](objects[buffer[i++]], buffer[i++]);
+  function funcC2L0P(name) {
+    var object = ctx[name](objects[buffer[i++]], payloads[buffer[i++]]);
     var id = buffer[i++];
     objects[id] = object;
   }
@@ -151,28 +178,36 @@ function WebGLClient() {
     i += 2;
   }
   function uniform1fv() {
-    ctx.uniform1fv(objects[buffer[i]], buffer[i+1]);
-    i += 2;
+    ctx.uniform1fv(objects[buffer[i++]], floatArray());
   }
   function uniform2fv() {
-    ctx.uniform2fv(objects[buffer[i]], buffer[i+1]);
-    i += 2;
+    ctx.uniform2fv(objects[buffer[i++]], floatArray());
   }
   function uniform1iv() {
-    ctx.uniform1iv(objects[buffer[i]], buffer[i+1]);
-    i += 2;
+    ctx.uniform1iv(objects[buffer[i++]], intArray());
   }
   function uniform3f() {
     ctx.uniform3f(objects[buffer[i]], buffer[i+1], buffer[i+2], buffer[i+3]);
     i += 4;
   }
   function uniform3fv() {
-    ctx.uniform3fv(objects[buffer[i]], buffer[i+1]);
-    i += 2;
+    ctx.uniform3fv(objects[buffer[i++]], floatArray());
   }
   function uniform4fv() {
-    ctx.uniform4fv(objects[buffer[i]], buffer[i+1]);
-    i += 2;
+    ctx.uniform4fv(objects[buffer[i++]], floatArray());
+  }
+  function uniformMatrix3fv() {
+    ctx.uniformMatrix3fv(objects[buffer[i++]], !!buffer[i++], floatArray());
+  }
+  function uniformMatrix4fv() {
+    ctx.uniformMatrix4fv(objects[buffer[i++]], !!buffer[i++], floatArray());
+  }
+  function vertexAttrib4fv() {
+    ctx.vertexAttrib4fv(buffer[i++], floatArray());
+  }
+  function bufferData() {
+    ctx.bufferData(buffer[i], payloads[buffer[i+1]], buffer[i+2]);
+    i += 3;
   }
   function vertexAttribPointer() {
     ctx.vertexAttribPointer(buffer[i], buffer[i+1], buffer[i+2], buffer[i+3], buffer[i+4], buffer[i+5]);
@@ -181,34 +216,34 @@ function WebGLClient() {
 
   var calls = {
     0: { name: 'NULL', func: func0 },
-    1: { name: 'getExtension', func: func1 },
+    1: { name: 'getExtension', func: func1P },
     2: { name: 'enable', func: enable },
     3: { name: 'disable', func: disable },
     4: { name: 'clear', func: func1 },
     5: { name: 'clearColor', func: func4 },
     6: { name: 'createShader', func: funcC1 },
     7: { name: 'deleteShader', func: funcD0 },
-    8: { name: 'shaderSource', func: func2L0 },
+    8: { name: 'shaderSource', func: func2L0P },
     9: { name: 'compileShader', func: func1L0 },
     10: { name: 'createProgram', func: funcC0 },
     11: { name: 'deleteProgram', func: funcD0 },
     12: { name: 'attachShader', func: func2L0L1 },
-    13: { name: 'bindAttribLocation', func: func3L0 },
+    13: { name: 'bindAttribLocation', func: func3L0P },
     14: { name: 'linkProgram', func: func1L0 },
     15: { name: 'getProgramParameter', func: function() { assert(ctx.getProgramParameter(objects[buffer[i++]], buffer[i++]), 'we cannot handle errors, we are async proxied WebGL'); } },
-    16: { name: 'getUniformLocation', func: funcC2L0 },
+    16: { name: 'getUniformLocation', func: funcC2L0P },
     17: { name: 'useProgram', func: func1L0 },
     18: { name: 'uniform1i', func: uniform1i },
     19: { name: 'uniform1f', func: uniform1f },
     20: { name: 'uniform3fv', func: uniform3fv },
     21: { name: 'uniform4fv', func: uniform4fv },
-    22: { name: 'uniformMatrix4fv', func: func3L0 },
-    23: { name: 'vertexAttrib4fv', func: func2 },
+    22: { name: 'uniformMatrix4fv', func: uniformMatrix4fv },
+    23: { name: 'vertexAttrib4fv', func: vertexAttrib4fv },
     24: { name: 'createBuffer', func: funcC0 },
     25: { name: 'deleteBuffer', func: funcD0 },
     26: { name: 'bindBuffer', func: func2L1_ },
-    27: { name: 'bufferData', func: func3 },
-    28: { name: 'bufferSubData', func: func3 },
+    27: { name: 'bufferData', func: bufferData },
+    28: { name: 'bufferSubData', func: func3P },
     29: { name: 'viewport', func: func4 },
     30: { name: 'vertexAttribPointer', func: vertexAttribPointer },
     31: { name: 'enableVertexAttribArray', func: enableVertexAttribArray },
@@ -220,8 +255,8 @@ function WebGLClient() {
     37: { name: 'deleteTexture', func: funcD0 },
     38: { name: 'bindTexture', func: func2L1_ },
     39: { name: 'texParameteri', func: func3 },
-    40: { name: 'texImage2D', func: func9 },
-    41: { name: 'compressedTexImage2D', func: func7 },
+    40: { name: 'texImage2D', func: func9P },
+    41: { name: 'compressedTexImage2D', func: func7P },
     42: { name: 'activeTexture', func: activeTexture },
     43: { name: 'getShaderParameter', func: function() { assert(ctx.getShaderParameter(objects[buffer[i++]], buffer[i++]), 'we cannot handle errors, we are async proxied WebGL'); } },
     44: { name: 'clearDepth', func: func1 },
@@ -244,14 +279,14 @@ function WebGLClient() {
     61: { name: 'bindRenderbuffer', func: func2L1_ },
     62: { name: 'renderbufferStorage', func: func4 },
     63: { name: 'framebufferRenderbuffer', func: func4L3_ },
-    64: { name: 'debugPrint', func: func1 },
+    64: { name: 'debugPrint', func: func1P },
     65: { name: 'hint', func: func2 },
     66: { name: 'blendEquation', func: func1 },
     67: { name: 'generateMipmap', func: func1 },
-    68: { name: 'uniformMatrix3fv', func: func3L0 },
+    68: { name: 'uniformMatrix3fv', func: uniformMatrix3fv },
     69: { name: 'stencilMask', func: func1 },
     70: { name: 'clearStencil', func: func1 },
-    71: { name: 'texSubImage2D', func: func9 },
+    71: { name: 'texSubImage2D', func: func9P },
     72: { name: 'uniform3f', func: uniform3f },
     73: { name: 'blendFuncSeparate', func: func4 },
     74: { name: 'uniform2fv', func: uniform2fv },
@@ -260,15 +295,16 @@ function WebGLClient() {
     77: { name: 'blendEquationSeparate', func: func2 },
     78: { name: 'stencilFuncSeparate', func: func4 },
     79: { name: 'stencilOpSeparate', func: func4 },
-    80: { name: 'drawBuffersWEBGL', func: func1 },
+    80: { name: 'drawBuffersWEBGL', func: func1P },
     81: { name: 'uniform1iv', func: uniform1iv },
     82: { name: 'uniform1fv', func: uniform1fv },
   };
 
-  function renderCommands(buf) {
+  function renderCommands(commands) {
     ctx = Module.ctx;
     i = 0;
-    buffer = buf;
+    buffer = commands.commandBuffer;
+    payloads = commands.payloads;
     var len = buffer.length;
     //dump('issuing commands, buffer len: ' + len + '\n');
     while (i < len) {
@@ -293,7 +329,13 @@ function WebGLClient() {
     }
     skippable = false;
     renderCommands(commandBuffers[commandBuffers.length-1]);
+    // hand the command buffers back to the worker to be reused
+    for (var i = 0; i < commandBuffers.length; i++) {
+      var arrayBuffer = commandBuffers[i].commandBuffer.buffer;
+      worker.postMessage({ target: 'gl', op: 'recycleCommandBuffer', buffer: arrayBuffer }, [arrayBuffer]);
+    }
     commandBuffers.length = 0;
+    payloads = null;
   }
 
   this.onmessage = function(msg) {
@@ -304,7 +346,7 @@ function WebGLClient() {
           // requestion a new frame, we will clear the buffers after rendering them
           window.requestAnimationFrame(renderAllCommands);
         }
-        commandBuffers.push(msg.commandBuffer);
+        commandBuffers.push(msg);
         break;
       }
       default: throw 'weird gl onmessage ' + JSON.stringify(msg);
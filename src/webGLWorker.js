@@ -457,7 +457,59 @@ function WebGLWorker() {
   // State
   //=======
 
-  var commandBuffer = [];
+  // GL calls are encoded as numbers (an opcode, then its arguments) into a Float64Array, whose memory is transferred to
+  // the client each frame instead of cloning a JS array. Small uniform arrays are written inline, prefixed by their
+  // length. Other arguments that are not numbers (strings, buffer and texture data) are kept in a side array of
+  // payloads, and the stream holds their index there. The client hands the arrays back after rendering, so they are
+  // reused rather than reallocated.
+  var commandBuffer = {
+    data: new Float64Array(4096),
+    length: 0,
+    payloads: [],
+    transfers: [],
+    free: [],
+    push: function() {
+      var n = arguments.length;
+      if (this.length + n > this.data.length) this.grow(n);
+      var data = this.data;
+      for (var j = 0; j < n; j++) data[this.length++] = arguments[j];
+    },
+    pushArray: function(array) {
+      var n = array.length;
+      if (this.length + n + 1 > this.data.length) this.grow(n + 1);
+      var data = this.data;
+      data[this.length++] = n;
+      for (var j = 0; j < n; j++) data[this.length++] = array[j];
+    },
+    payload: function(value) {
+      this.payloads.push(value);
+      return this.payloads.length - 1;
+    },
+    // A payload that only the command stream refers to, such as a duplicate() copy, whose memory can be transferred too
+    ownedPayload: function(value) {
+      if (value instanceof ArrayBuffer) this.transfers.push(value);
+      else if (value && value.buffer instanceof ArrayBuffer) this.transfers.push(value.buffer);
+      return this.payload(value);
+    },
+    grow: function(n) {
+      var data = new Float64Array(Math.max(this.data.length * 2, this.length + n));
+      data.set(this.data.subarray(0, this.length));
+      this.data = data;
+      this.free.length = 0; // smaller than what we need now
+    },
+    send: function() {
+      var data = this.data;
+      this.transfers.push(data.buffer);
+      postMessage({ target: 'gl', op: 'render', commandBuffer: data.subarray(0, this.length), payloads: this.payloads }, this.transfers);
+      this.data = this.free.pop() || new Float64Array(data.length);
+      this.length = 0;
+      this.payloads = [];
+      this.transfers = [];
+    },
+    recycle: function(buffer) {
+      if (buffer.byteLength === this.data.byteLength) this.free.push(new Float64Array(buffer));
+    }
+  };
 
   var nextId = 1; // valid ids are > 0
 
@@ -493,6 +545,10 @@ function WebGLWorker() {
   this.onmessage = function(msg) {
     //dump('worker GL got ' + JSON.stringify(msg) + '\n');
     switch(msg.op) {
+      case 'recycleCommandBuffer': {
+        commandBuffer.recycle(msg.buffer);
+        break;
+      }
       case 'setPrefetched': {
         WebGLWorker.prototype.prefetchedParameters = msg.parameters;
         WebGLWorker.prototype.prefetchedExtensions = msg.extensions;
@@ -563,7 +619,7 @@ function WebGLWorker() {
   this.getExtension = function(name) {
     var i = this.prefetchedExtensions.indexOf(name);
     if (i < 0) return null;
-    commandBuffer.push(1, name);
+    commandBuffer.push(1, commandBuffer.payload(name));
     switch (name) {
       case 'EXT_texture_filter_anisotropic': {
         return {
@@ -655,7 +711,7 @@ function WebGLWorker() {
   };
   this.shaderSource = function(shader, source) {
     shader.source = source;
-    commandBuffer.push(8, shader.id, source);
+    commandBuffer.push(8, shader.id, commandBuffer.payload(source));
   };
   this.compileShader = function(shader) {
     commandBuffer.push(9, shader.id);
@@ -679,7 +735,7 @@ function WebGLWorker() {
   this.bindAttribLocation = function(program, index, name) {
     program.nextAttributes[name] = { what: 'attribute', name: name, size: -1, location: index, type: '?' }; // fill in size, type later
     program.nextAttributeVec[index] = name;
-    commandBuffer.push(13, program.id, index, name);
+    commandBuffer.push(13, program.id, index, commandBuffer.payload(name));
   };
   this.getAttribLocation = function(program, name) {
     // all existing attribs are cached locally
@@ -759,7 +815,7 @@ function WebGLWorker() {
         var index = program.attributeVec.length;
         program.attributes[attr] = { what: 'attribute', name: attr, size: -1, location: index, type: '?' }; // fill in size, type later
         program.attributeVec[index] = attr;
-        commandBuffer.push(13, program.id, index, attr); // do a bindAttribLocation as well, so this takes effect in the link we are about to do
+        commandBuffer.push(13, program.id, index, commandBuffer.payload(attr)); // do a bindAttribLocation as well, so this takes effect in the link we are about to do
       }
       program.attributes[attr].size = existingAttributes[attr].size;
       program.attributes[attr].type = existingAttributes[attr].type;
@@ -800,7 +856,7 @@ function WebGLWorker() {
     }
     if (!(name in program.uniforms)) return null;
     var id = nextId++;
-    commandBuffer.push(16, program.id, fullname, id);
+    commandBuffer.push(16, program.id, commandBuffer.payload(fullname), id);
     return { what: 'location', uniform: program.uniforms[name], id: id, index: index };
   };
   this.getProgramInfoLog = function(shader) {
@@ -820,22 +876,26 @@ function WebGLWorker() {
   };
   this.uniform3fv = function(location, data) {
     if (!location) return;
-    commandBuffer.push(20, location.id, new Float32Array(data));
+    commandBuffer.push(20, location.id);
+    commandBuffer.pushArray(data);
   };
   this.uniform4f = function(location, x, y, z, w) {
     if (!location) return;
-    commandBuffer.push(21, location.id, new Float32Array([x, y, z, w]));
+    commandBuffer.push(21, location.id, 4, x, y, z, w);
   };
   this.uniform4fv = function(location, data) {
     if (!location) return;
-    commandBuffer.push(21, location.id, new Float32Array(data));
+    commandBuffer.push(21, location.id);
+    commandBuffer.pushArray(data);
   };
   this.uniformMatrix4fv = function(location, transpose, data) {
     if (!location) return;
-    commandBuffer.push(22, location.id, transpose, new Float32Array(data));
+    commandBuffer.push(22, location.id, transpose);
+    commandBuffer.pushArray(data);
   };
   this.vertexAttrib4fv = function(index, values) {
-    commandBuffer.push(23, index, new Float32Array(values));
+    commandBuffer.push(23, index);
+    commandBuffer.pushArray(values);
   };
   this.createBuffer = function() {
     var id = nextId++;
@@ -866,10 +926,10 @@ function WebGLWorker() {
     return new something.constructor(something); // typed array
   }
   this.bufferData = function(target, something, usage) {
-    commandBuffer.push(27, target, duplicate(something), usage);
+    commandBuffer.push(27, target, commandBuffer.ownedPayload(duplicate(something)), usage);
   };
   this.bufferSubData = function(target, offset, something) {
-    commandBuffer.push(28, target, offset, duplicate(something));
+    commandBuffer.push(28, target, offset, commandBuffer.ownedPayload(duplicate(something)));
   };
   this.viewport = function(x, y, w, h) {
     commandBuffer.push(29, x, y, w, h);
@@ -934,10 +994,10 @@ function WebGLWorker() {
       border = 0;
       pixels = new Uint8Array(data.data); // XXX transform from clamped to normal, could have been done in duplicate
     }
-    commandBuffer.push(40, target, level, internalformat, width, height, border, format, type, duplicate(pixels));
+    commandBuffer.push(40, target, level, internalformat, width, height, border, format, type, commandBuffer.ownedPayload(duplicate(pixels)));
   };
   this.compressedTexImage2D = function(target, level, internalformat, width, height, border, pixels) {
-    commandBuffer.push(41, target, level, internalformat, width, height, border, duplicate(pixels));
+    commandBuffer.push(41, target, level, internalformat, width, height, border, commandBuffer.ownedPayload(duplicate(pixels)));
   };
   this.activeTexture = function(texture) {
     commandBuffer.push(42, texture);
@@ -1030,7 +1090,7 @@ function WebGLWorker() {
     commandBuffer.push(63, target, attachment, renderbuffertarget, renderbuffer ? renderbuffer.id : 0);
   };
   this.debugPrint = function(text) { // useful to interleave debug output properly with client GL commands
-    commandBuffer.push(64, text);
+    commandBuffer.push(64, commandBuffer.payload(text));
   };
   this.hint = function(target, mode) {
     commandBuffer.push(65, target, mode);
@@ -1045,7 +1105,8 @@ function WebGLWorker() {
   };
   this.uniformMatrix3fv = function(location, transpose, data) {
     if (!location) return;
-    commandBuffer.push(68, location.id, transpose, new Float32Array(data));
+    commandBuffer.push(68, location.id, transpose);
+    commandBuffer.pushArray(data);
   };
   this.stencilMask = function(mask) {
     commandBuffer.push(69, mask);
@@ -1068,7 +1129,7 @@ function WebGLWorker() {
       height = data.height;
       pixels = new Uint8Array(data.data); // XXX transform from clamped to normal, could have been done in duplicate
     }
-    commandBuffer.push(71, target, level, xoffset, yoffset, width, height, format, type, duplicate(pixels));
+    commandBuffer.push(71, target, level, xoffset, yoffset, width, height, format, type, commandBuffer.ownedPayload(duplicate(pixels)));
   };
   this.uniform3f = function(location, x, y, z) {
     if (!location) return;
@@ -1083,7 +1144,8 @@ function WebGLWorker() {
   }
   this.uniform2fv = function(location, data) {
     if (!location) return;
-    commandBuffer.push(74, location.id, new Float32Array(data));
+    commandBuffer.push(74, location.id);
+    commandBuffer.pushArray(data);
   };
   this.texParameterf = function(target, pname, param) {
     commandBuffer.push(75, target, pname, param);
@@ -1108,15 +1170,17 @@ function WebGLWorker() {
     commandBuffer.push(79, face, fail, zfail, zpass);
   };
   this.drawBuffersWEBGL = function(buffers) {
-    commandBuffer.push(80, buffers);
+    commandBuffer.push(80, commandBuffer.payload(buffers));
   };
   this.uniform1iv = function(location, data) {
     if (!location) return;
-    commandBuffer.push(81, location.id, new Int32Array(data));
+    commandBuffer.push(81, location.id);
+    commandBuffer.pushArray(data);
   };
   this.uniform1fv = function(location, data) {
     if (!location) return;
-    commandBuffer.push(82, location.id, new Float32Array(data));
+    commandBuffer.push(82, location.id);
+    commandBuffer.pushArray(data);
   };
 
   // Setup
@@ -1137,8 +1201,7 @@ function WebGLWorker() {
 
   function postRAF() {
     if (commandBuffer.length > 0) {
-      postMessage({ target: 'gl', op: 'render', commandBuffer: commandBuffer });
-      commandBuffer = [];
+      commandBuffer.send();
     }
     postRAFed = true;
   }
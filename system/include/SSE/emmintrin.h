@@ -31,10 +31,6 @@
 
 #include <emscripten/emscripten.h>
 
-#define __SATURATE(x, Min, Max) ((x) >= Min ? ((x) <= Max ? (x) : Max) : Min)
-#define __MIN(x, y) ((x) <= (y) ? (x) : (y))
-#define __MAX(x, y) ((x) >= (y) ? (x) : (y))
-
 // Alias different (functionally) equivalent intrinsics.
 #define _mm_cvtsd_si64x _mm_cvtsd_si64
 #define _mm_cvtsi128_si64x _mm_cvtsi128_si64
@@ -949,15 +945,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_adds_epi8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __SATURATE(src.x[i] + src2.x[i], -128, 127);
-  return dst.m;
+  // 1 SIMD.js op: Int8x16.addSaturate.
+  return (__m128i)emscripten_int8x16_addSaturate((int8x16)__a, (int8x16)__b);
 #else
   return (__m128i)__builtin_ia32_paddsb128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -967,15 +956,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_adds_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __SATURATE(src.x[i] + src2.x[i], -32768, 32767);
-  return dst.m;
+  // 1 SIMD.js op: Int16x8.addSaturate.
+  return (__m128i)emscripten_int16x8_addSaturate((int16x8)__a, (int16x8)__b);
 #else
   return (__m128i)__builtin_ia32_paddsw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -985,15 +967,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_adds_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __SATURATE(src.x[i] + src2.x[i], 0, 255);
-  return dst.m;
+  // 1 SIMD.js op: Uint8x16.addSaturate.
+  return (__m128i)emscripten_uint8x16_addSaturate((uint8x16)__a, (uint8x16)__b);
 #else
   return (__m128i)__builtin_ia32_paddusb128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1003,15 +978,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_adds_epu16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __SATURATE(src.x[i] + src2.x[i], 0, 65535);
-  return dst.m;
+  // 1 SIMD.js op: Uint16x8.addSaturate.
+  return (__m128i)emscripten_uint16x8_addSaturate((uint16x8)__a, (uint16x8)__b);
 #else
   return (__m128i)__builtin_ia32_paddusw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1021,15 +989,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_avg_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = (src.x[i] + src2.x[i] + 1) >> 1;
-  return dst.m;
+  // 3 SIMD.js ops: (a|b) - ((a^b)>>1) rounds up without widening.
+  return (__m128i)((uint8x16)(__a | __b) - emscripten_uint8x16_shiftRightByScalar((uint8x16)(__a ^ __b), 1));
 #else
   return (__m128i)__builtin_ia32_pavgb128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1039,15 +1000,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_avg_epu16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = (src.x[i] + src2.x[i] + 1) >> 1;
-  return dst.m;
+  // 3 SIMD.js ops: (a|b) - ((a^b)>>1) rounds up without widening.
+  return (__m128i)((uint16x8)(__a | __b) - emscripten_uint16x8_shiftRightByScalar((uint16x8)(__a ^ __b), 1));
 #else
   return (__m128i)__builtin_ia32_pavgw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1057,19 +1011,12 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_madd_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2;
-  union {
-    signed int x[4];
-    __m128i m;
-  } dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 4; ++i)
-    dst.x[i] = src.x[i*2] * src2.x[i*2] + src.x[i*2+1] * src2.x[i*2+1];
-  return dst.m;
+  // 9 SIMD.js ops: sign-extend the even and odd 16-bit lanes to 32 bits, then multiply and add.
+  int32x4 __ae = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__a, 16), 16);
+  int32x4 __be = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__b, 16), 16);
+  int32x4 __ao = emscripten_int32x4_shiftRightByScalar(__a, 16);
+  int32x4 __bo = emscripten_int32x4_shiftRightByScalar(__b, 16);
+  return __ae * __be + __ao * __bo;
 #else
   return (__m128i)__builtin_ia32_pmaddwd128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1079,15 +1026,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_max_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __MAX(src.x[i], src2.x[i]);
-  return dst.m;
+  // 2 SIMD.js ops: compare and select.
+  return (__m128i)emscripten_int16x8_select(emscripten_int16x8_greaterThan((int16x8)__a, (int16x8)__b), (int16x8)__a, (int16x8)__b);
 #else
   return (__m128i)__builtin_ia32_pmaxsw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1097,15 +1037,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_max_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __MAX(src.x[i], src2.x[i]);
-  return dst.m;
+  // 2 SIMD.js ops: compare and select.
+  return (__m128i)emscripten_uint8x16_select(emscripten_uint8x16_greaterThan((uint8x16)__a, (uint8x16)__b), (uint8x16)__a, (uint8x16)__b);
 #else
   return (__m128i)__builtin_ia32_pmaxub128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1115,15 +1048,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_min_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __MIN(src.x[i], src2.x[i]);
-  return dst.m;
+  // 2 SIMD.js ops: compare and select.
+  return (__m128i)emscripten_int16x8_select(emscripten_int16x8_lessThan((int16x8)__a, (int16x8)__b), (int16x8)__a, (int16x8)__b);
 #else
   return (__m128i)__builtin_ia32_pminsw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1133,15 +1059,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_min_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __MIN(src.x[i], src2.x[i]);
-  return dst.m;
+  // 2 SIMD.js ops: compare and select.
+  return (__m128i)emscripten_uint8x16_select(emscripten_uint8x16_lessThan((uint8x16)__a, (uint8x16)__b), (uint8x16)__a, (uint8x16)__b);
 #else
   return (__m128i)__builtin_ia32_pminub128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1151,15 +1070,12 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_mulhi_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = (signed short)(((int)src.x[i] * (int)src2.x[i]) >> 16);
-  return dst.m;
+  // 11 SIMD.js ops: multiply the sign-extended even and odd lanes in 32 bits, and merge the high halves.
+  int32x4 __ae = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__a, 16), 16);
+  int32x4 __be = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__b, 16), 16);
+  int32x4 __ao = emscripten_int32x4_shiftRightByScalar(__a, 16);
+  int32x4 __bo = emscripten_int32x4_shiftRightByScalar(__b, 16);
+  return (__m128i)emscripten_uint32x4_shiftRightByScalar((uint32x4)(__ae * __be), 16) | ((__ao * __bo) & emscripten_int32x4_splat((int)0xFFFF0000U));
 #else
   return (__m128i)__builtin_ia32_pmulhw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1169,15 +1085,11 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_mulhi_epu16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = (unsigned short)(((int)src.x[i] * (int)src2.x[i]) >> 16);
-  return dst.m;
+  // 9 SIMD.js ops: multiply the zero-extended even and odd lanes in 32 bits, and merge the high halves.
+  int32x4 __lo = emscripten_int32x4_splat(0xFFFF);
+  int32x4 __ao = (int32x4)emscripten_uint32x4_shiftRightByScalar((uint32x4)__a, 16);
+  int32x4 __bo = (int32x4)emscripten_uint32x4_shiftRightByScalar((uint32x4)__b, 16);
+  return (__m128i)emscripten_uint32x4_shiftRightByScalar((uint32x4)((__a & __lo) * (__b & __lo)), 16) | ((__ao * __bo) & ~__lo);
 #else
   return (__m128i)__builtin_ia32_pmulhuw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1221,26 +1133,12 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_sad_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2;
-  src.m = __a;
-  src2.m = __b;
-  union {
-    unsigned short x[8];
-    __m128i m;
-  } dst;
-#define __ABS(a) ((a) < 0 ? -(a) : (a))
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = 0;
-  for(int i = 0; i < 8; ++i)
-  {
-    dst.x[0] += __ABS(src.x[i] - src2.x[i]);
-    dst.x[4] += __ABS(src.x[8+i] - src2.x[8+i]);
-  }
-  return dst.m;
-#undef __ABS
+  // 13 SIMD.js ops: absolute differences from two saturating subtracts, then sum adjacent lanes at 16, 32 and 64 bits.
+  uint8x16 __d = emscripten_uint8x16_subSaturate((uint8x16)__a, (uint8x16)__b) | emscripten_uint8x16_subSaturate((uint8x16)__b, (uint8x16)__a);
+  uint16x8 __s16 = ((uint16x8)__d & emscripten_uint16x8_splat(0xFF)) + emscripten_uint16x8_shiftRightByScalar((uint16x8)__d, 8);
+  uint32x4 __s32 = ((uint32x4)__s16 & emscripten_uint32x4_splat(0xFFFF)) + emscripten_uint32x4_shiftRightByScalar((uint32x4)__s16, 16);
+  __s32 += __builtin_shufflevector(__s32, __s32, 1, 0, 3, 2);
+  return (__m128i)__builtin_shufflevector(__s32, ((uint32x4){ 0, 0, 0, 0 }), 0, 4, 2, 6);
 #else
   return __builtin_ia32_psadbw128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1294,15 +1192,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_subs_epi8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __SATURATE(src.x[i] - src2.x[i], -128, 127);
-  return dst.m;
+  // 1 SIMD.js op: Int8x16.subSaturate.
+  return (__m128i)emscripten_int8x16_subSaturate((int8x16)__a, (int8x16)__b);
 #else
   return (__m128i)__builtin_ia32_psubsb128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1312,15 +1203,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_subs_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __SATURATE(src.x[i] - src2.x[i], -32768, 32767);
-  return dst.m;
+  // 1 SIMD.js op: Int16x8.subSaturate.
+  return (__m128i)emscripten_int16x8_subSaturate((int16x8)__a, (int16x8)__b);
 #else
   return (__m128i)__builtin_ia32_psubsw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -1330,15 +1214,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_subs_epu8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 16; ++i)
-    dst.x[i] = __SATURATE(src.x[i] - src2.x[i], 0, 255);
-  return dst.m;
+  // 1 SIMD.js op: Uint8x16.subSaturate.
+  return (__m128i)emscripten_uint8x16_subSaturate((uint8x16)__a, (uint8x16)__b);
 #else
   return (__m128i)__builtin_ia32_psubusb128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -1348,15 +1225,8 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_subs_epu16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    unsigned short x[8];
-    __m128i m;
-  } src, src2, dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-    dst.x[i] = __SATURATE(src.x[i] - src2.x[i], 0, 65535);
-  return dst.m;
+  // 1 SIMD.js op: Uint16x8.subSaturate.
+  return (__m128i)emscripten_uint16x8_subSaturate((uint16x8)__a, (uint16x8)__b);
 #else
   return (__m128i)__builtin_ia32_psubusw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -2132,22 +2002,13 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_packs_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2;
-  union {
-    signed char x[16];
-    __m128i m;
-  } dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-  {
-    dst.x[i] = __SATURATE(src.x[i], -128, 127);
-    dst.x[8+i] = __SATURATE(src2.x[i], -128, 127);
-  }
-  return dst.m;
+  // 9 SIMD.js ops: clamp each input with two compares and selects, then a single shuffle of the low bytes.
+  int16x8 __min = emscripten_int16x8_splat(-128), __max = emscripten_int16x8_splat(127);
+  int16x8 __a2 = emscripten_int16x8_select(emscripten_int16x8_lessThan((int16x8)__a, __min), __min, (int16x8)__a);
+  int16x8 __b2 = emscripten_int16x8_select(emscripten_int16x8_lessThan((int16x8)__b, __min), __min, (int16x8)__b);
+  __a2 = emscripten_int16x8_select(emscripten_int16x8_greaterThan(__a2, __max), __max, __a2);
+  __b2 = emscripten_int16x8_select(emscripten_int16x8_greaterThan(__b2, __max), __max, __b2);
+  return (__m128i)__builtin_shufflevector((__v16qi)__a2, (__v16qi)__b2, 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
 #else
   return (__m128i)__builtin_ia32_packsswb128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -2157,22 +2018,13 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_packs_epi32(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed int x[4];
-    __m128i m;
-  } src, src2;
-  union {
-    signed short x[8];
-    __m128i m;
-  } dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 4; ++i)
-  {
-    dst.x[i] = __SATURATE(src.x[i], -32768, 32767);
-    dst.x[4+i] = __SATURATE(src2.x[i], -32768, 32767);
-  }
-  return dst.m;
+  // 9 SIMD.js ops: clamp each input with two compares and selects, then a single shuffle of the low halves.
+  int32x4 __min = emscripten_int32x4_splat(-32768), __max = emscripten_int32x4_splat(32767);
+  int32x4 __a2 = emscripten_int32x4_select(emscripten_int32x4_lessThan(__a, __min), __min, __a);
+  int32x4 __b2 = emscripten_int32x4_select(emscripten_int32x4_lessThan(__b, __min), __min, __b);
+  __a2 = emscripten_int32x4_select(emscripten_int32x4_greaterThan(__a2, __max), __max, __a2);
+  __b2 = emscripten_int32x4_select(emscripten_int32x4_greaterThan(__b2, __max), __max, __b2);
+  return (__m128i)__builtin_shufflevector((__v8hi)__a2, (__v8hi)__b2, 0, 2, 4, 6, 8, 10, 12, 14);
 #else
   return (__m128i)__builtin_ia32_packssdw128((__v4si)__a, (__v4si)__b);
 #endif
@@ -2182,22 +2034,13 @@ static __inline__ __m128i __attribute__((__always_inline__, __nodebug__))
 _mm_packus_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-  union {
-    signed short x[8];
-    __m128i m;
-  } src, src2;
-  union {
-    unsigned char x[16];
-    __m128i m;
-  } dst;
-  src.m = __a;
-  src2.m = __b;
-  for(int i = 0; i < 8; ++i)
-  {
-    dst.x[i] = __SATURATE(src.x[i], 0, 255);
-    dst.x[8+i] = __SATURATE(src2.x[i], 0, 255);
-  }
-  return dst.m;
+  // 9 SIMD.js ops: clamp each input with two compares and selects, then a single shuffle of the low bytes.
+  int16x8 __min = emscripten_int16x8_splat(0), __max = emscripten_int16x8_splat(255);
+  int16x8 __a2 = emscripten_int16x8_select(emscripten_int16x8_lessThan((int16x8)__a, __min), __min, (int16x8)__a);
+  int16x8 __b2 = emscripten_int16x8_select(emscripten_int16x8_lessThan((int16x8)__b, __min), __min, (int16x8)__b);
+  __a2 = emscripten_int16x8_select(emscripten_int16x8_greaterThan(__a2, __max), __max, __a2);
+  __b2 = emscripten_int16x8_select(emscripten_int16x8_greaterThan(__b2, __max), __max, __b2);
+  return (__m128i)__builtin_shufflevector((__v16qi)__a2, (__v16qi)__b2, 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
 #else
   return (__m128i)__builtin_ia32_packuswb128((__v8hi)__a, (__v8hi)__b);
 #endif
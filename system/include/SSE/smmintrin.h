@@ -92,7 +92,8 @@ static __inline__ __m128d __DEFAULT_FN_ATTRS
 _mm_blendv_pd (__m128d __V1, __m128d __V2, __m128d __M)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 2 SIMD.js ops: broadcast the high word of each mask lane, then blend as floats.
+  return (__m128d)_mm_blendv_ps((__m128)__V1, (__m128)__V2, (__m128)_mm_shuffle_epi32((__m128i)__M, _MM_SHUFFLE(3, 3, 1, 1)));
 #else
   return (__m128d) __builtin_ia32_blendvpd ((__v2df)__V1, (__v2df)__V2,
                                             (__v2df)__M);
@@ -103,7 +104,8 @@ static __inline__ __m128 __DEFAULT_FN_ATTRS
 _mm_blendv_ps (__m128 __V1, __m128 __V2, __m128 __M)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 2 SIMD.js ops: compare the mask sign bits and select.
+  return emscripten_float32x4_select(emscripten_int32x4_lessThan((int32x4)__M, emscripten_int32x4_splat(0)), __V2, __V1);
 #else
   return (__m128) __builtin_ia32_blendvps ((__v4sf)__V1, (__v4sf)__V2,
                                            (__v4sf)__M);
@@ -114,7 +116,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_blendv_epi8 (__m128i __V1, __m128i __V2, __m128i __M)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 2 SIMD.js ops: compare the mask sign bits and select.
+  return (__m128i)emscripten_int8x16_select(emscripten_int8x16_lessThan((int8x16)__M, emscripten_int8x16_splat(0)), (int8x16)__V2, (int8x16)__V1);
 #else
   return (__m128i) __builtin_ia32_pblendvb128 ((__v16qi)__V1, (__v16qi)__V2,
                                                (__v16qi)__M);
@@ -144,7 +147,14 @@ static __inline__  __m128i __DEFAULT_FN_ATTRS
 _mm_mul_epi32 (__m128i __V1, __m128i __V2)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // SIMD.js has no 64-bit lanes, so this costs 2 scalar 64-bit multiplies.
+  union {
+    long long x[2];
+    __m128i m;
+  } u;
+  u.x[0] = (long long)__V1[0] * __V2[0];
+  u.x[1] = (long long)__V1[2] * __V2[2];
+  return u.m;
 #else  
   return (__m128i) __builtin_ia32_pmuldq128 ((__v4si)__V1, (__v4si)__V2);
 #endif
@@ -164,7 +174,7 @@ static __inline__  __m128i __DEFAULT_FN_ATTRS
 _mm_stream_load_si128 (__m128i const *__V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  return *__V;
 #else
   return (__m128i) __builtin_ia32_movntdqa ((const __v2di *) __V);
 #endif
@@ -238,7 +248,7 @@ _mm_min_epu32 (__m128i __V1, __m128i __V2)
 {
 #ifdef __EMSCRIPTEN__
   __m128 __shift = (__m128)emscripten_int32x4_splat((int)0x80000000U);
-  return _mm_xor_si128(__V2, _mm_and_si128(_mm_xor_si128(__V1, __V2), _mm_cmplt_epi32(_mm_sub_epi16(__V1, __shift), _mm_sub_epi32(__V2, __shift))));
+  return _mm_xor_si128(__V2, _mm_and_si128(_mm_xor_si128(__V1, __V2), _mm_cmplt_epi32(_mm_sub_epi32(__V1, __shift), _mm_sub_epi32(__V2, __shift))));
 #else
   return (__m128i) __builtin_ia32_pminud128((__v4si) __V1, (__v4si) __V2);
 #endif
@@ -249,7 +259,7 @@ _mm_max_epu32 (__m128i __V1, __m128i __V2)
 {
 #ifdef __EMSCRIPTEN__
   __m128 __shift = (__m128)emscripten_int32x4_splat((int)0x80000000U);
-  return _mm_xor_si128(__V1, _mm_and_si128(_mm_xor_si128(__V1, __V2), _mm_cmplt_epi32(_mm_sub_epi16(__V1, __shift), _mm_sub_epi32(__V2, __shift))));
+  return _mm_xor_si128(__V1, _mm_and_si128(_mm_xor_si128(__V1, __V2), _mm_cmplt_epi32(_mm_sub_epi32(__V1, __shift), _mm_sub_epi32(__V2, __shift))));
 #else
   return (__m128i) __builtin_ia32_pmaxud128((__v4si) __V1, (__v4si) __V2);
 #endif
@@ -312,7 +322,8 @@ static __inline__ int __DEFAULT_FN_ATTRS
 _mm_testz_si128(__m128i __M, __m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  __m128i __t = __M & __V;
+  return (__t[0] | __t[1] | __t[2] | __t[3]) == 0;
 #else
   return __builtin_ia32_ptestz128((__v2di)__M, (__v2di)__V);
 #endif
@@ -322,7 +333,8 @@ static __inline__ int __DEFAULT_FN_ATTRS
 _mm_testc_si128(__m128i __M, __m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  __m128i __t = ~__M & __V;
+  return (__t[0] | __t[1] | __t[2] | __t[3]) == 0;
 #else
   return __builtin_ia32_ptestc128((__v2di)__M, (__v2di)__V);
 #endif
@@ -332,7 +344,7 @@ static __inline__ int __DEFAULT_FN_ATTRS
 _mm_testnzc_si128(__m128i __M, __m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  return !_mm_testz_si128(__M, __V) && !_mm_testc_si128(__M, __V);
 #else
   return __builtin_ia32_ptestnzc128((__v2di)__M, (__v2di)__V);
 #endif
@@ -398,7 +410,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu8_epi16(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v16qi)__V, (__v16qi)_mm_setzero_si128(), 0, 16, 1, 16, 2, 16, 3, 16, 4, 16, 5, 16, 6, 16, 7, 16);
 #else
   return (__m128i) __builtin_ia32_pmovzxbw128((__v16qi) __V);
 #endif
@@ -408,7 +421,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu8_epi32(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v16qi)__V, (__v16qi)_mm_setzero_si128(), 0, 16, 16, 16, 1, 16, 16, 16, 2, 16, 16, 16, 3, 16, 16, 16);
 #else
   return (__m128i) __builtin_ia32_pmovzxbd128((__v16qi)__V);
 #endif
@@ -418,7 +432,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu8_epi64(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v16qi)__V, (__v16qi)_mm_setzero_si128(), 0, 16, 16, 16, 16, 16, 16, 16, 1, 16, 16, 16, 16, 16, 16, 16);
 #else
   return (__m128i) __builtin_ia32_pmovzxbq128((__v16qi)__V);
 #endif
@@ -428,7 +443,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu16_epi32(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v8hi)__V, (__v8hi)_mm_setzero_si128(), 0, 8, 1, 8, 2, 8, 3, 8);
 #else
   return (__m128i) __builtin_ia32_pmovzxwd128((__v8hi)__V);
 #endif
@@ -438,7 +454,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu16_epi64(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v8hi)__V, (__v8hi)_mm_setzero_si128(), 0, 8, 8, 8, 1, 8, 8, 8);
 #else
   return (__m128i) __builtin_ia32_pmovzxwq128((__v8hi)__V);
 #endif
@@ -448,7 +465,8 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_cvtepu32_epi64(__m128i __V)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 1 SIMD.js op: a shuffle against zero.
+  return (__m128i)__builtin_shufflevector((__v4si)__V, (__v4si)_mm_setzero_si128(), 0, 4, 1, 4);
 #else
   return (__m128i) __builtin_ia32_pmovzxdq128((__v4si)__V);
 #endif
@@ -459,7 +477,13 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_packus_epi32(__m128i __V1, __m128i __V2)
 {
 #ifdef __EMSCRIPTEN__
-  //
+  // 9 SIMD.js ops: clamp each input with two compares and selects, then a single shuffle of the low halves.
+  int32x4 __min = emscripten_int32x4_splat(0), __max = emscripten_int32x4_splat(65535);
+  int32x4 __a = emscripten_int32x4_select(emscripten_int32x4_lessThan(__V1, __min), __min, __V1);
+  int32x4 __b = emscripten_int32x4_select(emscripten_int32x4_lessThan(__V2, __min), __min, __V2);
+  __a = emscripten_int32x4_select(emscripten_int32x4_greaterThan(__a, __max), __max, __a);
+  __b = emscripten_int32x4_select(emscripten_int32x4_greaterThan(__b, __max), __max, __b);
+  return (__m128i)__builtin_shufflevector((__v8hi)__a, (__v8hi)__b, 0, 2, 4, 6, 8, 10, 12, 14);
 #else
   return (__m128i) __builtin_ia32_packusdw128((__v4si)__V1, (__v4si)__V2);
 #endif
@@ -214,28 +214,16 @@ _mm_hsubs_pi16(__m64 __a, __m64 __b)
 }
 #endif
 
-#ifdef __EMSCRIPTEN__
-static __inline__ short __DEFAULT_FN_ATTRS
-__Saturate_To_Int16(int __x)
-{
-    return __x <= -32768 ? -32768 : (__x >= 32767 ? 32767 : __x);
-}
-#endif
-
 static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_maddubs_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-    union {
-      char __x[16];
-      short __s[8];
-      __m128i __m;
-    } __src, __src2, __dst;
-    __src.__m = __a;
-    __src2.__m = __b;
-    for(int __i = 0; __i < 16; __i += 2)
-        __dst.__s[__i>>1] = __Saturate_To_Int16((unsigned char)__src.__x[__i+1] * __src2.__x[__i+1] + (unsigned char)__src.__x[__i] * __src2.__x[__i]);
-    return __dst.__m;
+    // 8 SIMD.js ops: widen the even and odd bytes to 16 bits (unsigned for __a, signed for __b), then Int16x8.addSaturate the products.
+    int16x8 __ae = (int16x8)((uint16x8)__a & emscripten_uint16x8_splat(0xFF));
+    int16x8 __ao = (int16x8)emscripten_uint16x8_shiftRightByScalar((uint16x8)__a, 8);
+    int16x8 __be = emscripten_int16x8_shiftRightByScalar(emscripten_int16x8_shiftLeftByScalar((int16x8)__b, 8), 8);
+    int16x8 __bo = emscripten_int16x8_shiftRightByScalar((int16x8)__b, 8);
+    return (__m128i)emscripten_int16x8_addSaturate(__ae * __be, __ao * __bo);
 #else
     return (__m128i)__builtin_ia32_pmaddubsw128((__v16qi)__a, (__v16qi)__b);
 #endif
@@ -253,15 +241,15 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_mulhrs_epi16(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
-    union {
-      short __x[8];
-      __m128i __m;
-    } __src, __src2, __dst;
-    __src.__m = __a;
-    __src2.__m = __b;
-    for(int __i = 0; __i < 8; ++__i)
-        __dst.__x[__i] = (((__src.__x[__i] * __src2.__x[__i]) >> 14) + 1) >> 1;
-    return __dst.__m;
+    // 15 SIMD.js ops: multiply the sign-extended even and odd lanes in 32 bits, round, and merge the low halves.
+    int32x4 __round = emscripten_int32x4_splat(0x4000);
+    int32x4 __ae = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__a, 16), 16);
+    int32x4 __be = emscripten_int32x4_shiftRightByScalar(emscripten_int32x4_shiftLeftByScalar(__b, 16), 16);
+    int32x4 __ao = emscripten_int32x4_shiftRightByScalar(__a, 16);
+    int32x4 __bo = emscripten_int32x4_shiftRightByScalar(__b, 16);
+    int32x4 __e = emscripten_int32x4_shiftRightByScalar(__ae * __be + __round, 15);
+    int32x4 __o = emscripten_int32x4_shiftRightByScalar(__ao * __bo + __round, 15);
+    return (__m128i)((__e & emscripten_int32x4_splat(0xFFFF)) | emscripten_int32x4_shiftLeftByScalar(__o, 16));
 #else
     return (__m128i)__builtin_ia32_pmulhrsw128((__v8hi)__a, (__v8hi)__b);
 #endif
@@ -279,6 +267,7 @@ static __inline__ __m128i __DEFAULT_FN_ATTRS
 _mm_shuffle_epi8(__m128i __a, __m128i __b)
 {
 #ifdef __EMSCRIPTEN__
+    // SIMD.js has no shuffle with variable indices, so this costs 16 scalar lane extracts and replaces.
     union {
       unsigned char __x[16];
       __m128i __m;
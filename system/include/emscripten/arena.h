@@ -0,0 +1,61 @@
+#ifndef __emscripten_arena_h__
+#define __emscripten_arena_h__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocators for memory that is freed all at once, like per-frame or per-request temporaries.
+//  - An arena hands out memory from a fixed block by bumping a pointer, and is emptied in constant time with
+//    emscripten_arena_reset(). Allocations cannot be freed one by one.
+//  - A region is a separate dlmalloc heap (a dlmalloc "mspace") in a fixed block. Its allocations can be freed one by
+//    one, and whatever is left is freed at once when the region is destroyed.
+// Neither grows: when the block is full, allocations return 0. With pthreads, arenas and regions can be allocated from
+// on several threads at the same time, but emscripten_arena_reset() and the destroy functions must not run at the same
+// time as other calls on the same arena or region. With --tracing, the block of each arena and region shows up as one
+// allocation, and its type is annotated as "emscripten_arena" or "emscripten_region". Regions need dlmalloc, so with
+// -s COMPACT_MALLOC=1 emscripten_region_create() returns 0.
+
+typedef struct em_arena em_arena;
+
+// Creates an arena that can hold capacity bytes of allocations. Returns 0 if there is not enough memory.
+em_arena *emscripten_arena_create(size_t capacity);
+
+// Frees the arena and all memory allocated from it.
+void emscripten_arena_destroy(em_arena *arena);
+
+// Returns bytes bytes from the arena, 8-byte aligned, or 0 if the arena is full.
+void *emscripten_arena_alloc(em_arena *arena, size_t bytes);
+
+// Like emscripten_arena_alloc(), but aligned to alignment bytes, which must be a power of two.
+void *emscripten_arena_alloc_aligned(em_arena *arena, size_t bytes, size_t alignment);
+
+// Frees all allocations of the arena at once.
+void emscripten_arena_reset(em_arena *arena);
+
+// Returns the number of bytes allocated from the arena since it was created or last reset, padding included.
+size_t emscripten_arena_bytes_used(em_arena *arena);
+
+typedef struct em_region em_region;
+
+// Creates a region of capacity bytes. Some of the capacity is used for the bookkeeping of the region. Returns 0 if there
+// is not enough memory.
+em_region *emscripten_region_create(size_t capacity);
+
+// Frees the region, and all allocations in it that were not freed yet.
+void emscripten_region_destroy(em_region *region);
+
+// The malloc() family of functions, in a region. Memory of one region must not be freed or reallocated in another.
+void *emscripten_region_malloc(em_region *region, size_t bytes);
+void *emscripten_region_calloc(em_region *region, size_t n_elements, size_t elem_size);
+void *emscripten_region_realloc(em_region *region, void *ptr, size_t bytes);
+void *emscripten_region_memalign(em_region *region, size_t alignment, size_t bytes);
+void emscripten_region_free(em_region *region, void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -60,6 +60,10 @@ namespace emscripten {
                 TYPEID stringType,
                 const char* name);
 
+            void _embind_register_std_string_view(
+                TYPEID stringViewType,
+                const char* name);
+
             void _embind_register_std_wstring(
                 TYPEID stringType,
                 size_t charSize,
@@ -99,7 +103,8 @@ namespace emscripten {
                 TYPEID setterArgumentType,
                 const char* setterSignature,
                 GenericFunction setter,
-                void* setterContext);
+                void* setterContext,
+                int fieldOffset);
 
             void _embind_finalize_value_array(TYPEID tupleType);
 
@@ -121,7 +126,8 @@ namespace emscripten {
                 TYPEID setterArgumentType,
                 const char* setterSignature,
                 GenericFunction setter,
-                void* setterContext);
+                void* setterContext,
+                int fieldOffset);
 
             void _embind_finalize_value_object(TYPEID structType);
 
@@ -158,6 +164,15 @@ namespace emscripten {
                 void* context,
                 unsigned isPureVirtual);
 
+            void _embind_register_class_batch_function(
+                TYPEID classType,
+                const char* methodName,
+                unsigned argCount,
+                bool returnsValue,
+                const char* invokerSignature,
+                GenericFunction invoker,
+                void* context);
+
             void _embind_register_class_property(
                 TYPEID classType,
                 const char* fieldName,
@@ -513,6 +528,91 @@ namespace emscripten {
             }
         };
 
+        template<typename... Types>
+        struct AllArithmetic : std::true_type {
+        };
+
+        template<typename T, typename... Types>
+        struct AllArithmetic<T, Types...> : std::integral_constant<bool,
+            std::is_arithmetic<typename std::decay<T>::type>::value &&
+            AllArithmetic<Types...>::value> {
+        };
+
+        template<size_t... Indices>
+        struct BatchIndices {
+        };
+
+        template<size_t Count, size_t... Indices>
+        struct MakeBatchIndices : MakeBatchIndices<Count - 1, Count - 1, Indices...> {
+        };
+
+        template<size_t... Indices>
+        struct MakeBatchIndices<0, Indices...> {
+            typedef BatchIndices<Indices...> type;
+        };
+
+        // Calls a method on count objects, for class_::function_batch. Call i
+        // takes its arguments from args[i * sizeof...(Args)] on, and stores
+        // its result in results[i].
+        template<typename MemberPointer,
+                 typename ReturnType,
+                 typename ThisType,
+                 typename... Args>
+        struct MethodBatchInvoker {
+            static void invoke(
+                const MemberPointer& method,
+                unsigned count,
+                ThisType* objects,
+                const double* args,
+                double* results
+            ) {
+                typename MakeBatchIndices<sizeof...(Args)>::type indices;
+                for (unsigned i = 0; i < count; ++i, args += sizeof...(Args)) {
+                    results[i] = call(method, objects[i], args, indices);
+                }
+            }
+
+            template<size_t... Indices>
+            static ReturnType call(
+                const MemberPointer& method,
+                ThisType object,
+                const double* args,
+                BatchIndices<Indices...>
+            ) {
+                return (object->*method)(
+                    static_cast<typename std::decay<Args>::type>(args[Indices])...);
+            }
+        };
+
+        template<typename MemberPointer,
+                 typename ThisType,
+                 typename... Args>
+        struct MethodBatchInvoker<MemberPointer, void, ThisType, Args...> {
+            static void invoke(
+                const MemberPointer& method,
+                unsigned count,
+                ThisType* objects,
+                const double* args,
+                double*
+            ) {
+                typename MakeBatchIndices<sizeof...(Args)>::type indices;
+                for (unsigned i = 0; i < count; ++i, args += sizeof...(Args)) {
+                    call(method, objects[i], args, indices);
+                }
+            }
+
+            template<size_t... Indices>
+            static void call(
+                const MemberPointer& method,
+                ThisType object,
+                const double* args,
+                BatchIndices<Indices...>
+            ) {
+                (object->*method)(
+                    static_cast<typename std::decay<Args>::type>(args[Indices])...);
+            }
+        };
+
         template<typename InstanceType, typename MemberType>
         struct MemberAccess {
             typedef MemberType InstanceType::*MemberPointer;
@@ -537,6 +637,20 @@ namespace emscripten {
             }
         };
 
+        // The byte offset of an arithmetic member of a trivially copyable
+        // value type, through which JS reads and writes it in place, or -1 if
+        // it has to go through its getter and setter.
+        template<typename ClassType, typename InstanceType, typename MemberType>
+        int getFieldOffset(MemberType InstanceType::*field) {
+            if (!std::is_arithmetic<MemberType>::value ||
+                !std::is_trivially_copyable<ClassType>::value) {
+                return -1;
+            }
+            typename std::aligned_storage<sizeof(ClassType), alignof(ClassType)>::type storage;
+            ClassType* object = reinterpret_cast<ClassType*>(&storage);
+            return reinterpret_cast<char*>(&(object->*field)) - reinterpret_cast<char*>(object);
+        }
+
         template<typename FieldType>
         struct GlobalAccess {
             typedef internal::BindingType<FieldType> MemberBinding;
@@ -706,7 +820,8 @@ namespace emscripten {
                 TypeID<ElementType>::get(),
                 getSignature(setter),
                 reinterpret_cast<GenericFunction>(setter),
-                getContext(field));
+                getContext(field),
+                getFieldOffset<ClassType>(field));
             return *this;
         }
 
@@ -728,7 +843,8 @@ namespace emscripten {
                 TypeID<typename SP::ArgumentType>::get(),
                 getSignature(s),
                 reinterpret_cast<GenericFunction>(s),
-                SP::getContext(setter));
+                SP::getContext(setter),
+                -1);
             return *this;
         }
 
@@ -749,7 +865,8 @@ namespace emscripten {
                 TypeID<ElementType>::get(),
                 getSignature(setter),
                 reinterpret_cast<GenericFunction>(setter),
-                reinterpret_cast<void*>(Index));
+                reinterpret_cast<void*>(Index),
+                -1);
             return *this;
         }
     };
@@ -802,7 +919,8 @@ namespace emscripten {
                 TypeID<FieldType>::get(),
                 getSignature(setter),
                 reinterpret_cast<GenericFunction>(setter),
-                getContext(field));
+                getContext(field),
+                getFieldOffset<ClassType>(field));
             return *this;
         }
 
@@ -828,7 +946,8 @@ namespace emscripten {
                 TypeID<FieldType>::get(),
                 getSignature(setter),
                 reinterpret_cast<GenericFunction>(setter),
-                getContext(field));
+                getContext(field),
+                -1);
             return *this;
         }
 
@@ -855,7 +974,8 @@ namespace emscripten {
                 TypeID<typename SP::ArgumentType>::get(),
                 getSignature(s),
                 reinterpret_cast<GenericFunction>(s),
-                SP::getContext(setter));
+                SP::getContext(setter),
+                -1);
             return *this;
         }
 
@@ -878,7 +998,8 @@ namespace emscripten {
                 TypeID<ElementType>::get(),
                 getSignature(setter),
                 reinterpret_cast<GenericFunction>(setter),
-                reinterpret_cast<void*>(Index));
+                reinterpret_cast<void*>(Index),
+                -1);
             return *this;
         }
     };
@@ -1301,6 +1422,48 @@ namespace emscripten {
             return *this;
         }
 
+        // Registers ClassName.methodName(objects, args) in JavaScript, which
+        // calls memberFunction on each of an array of objects, with one call
+        // into C++ for all of them rather than one each. Its arguments and
+        // result must be numbers: args holds the arguments of all the calls
+        // one after the other, and the results are returned in a
+        // Float64Array.
+        template<typename ReturnType, typename... Args>
+        EMSCRIPTEN_ALWAYS_INLINE const class_& function_batch(const char* methodName, ReturnType (ClassType::*memberFunction)(Args...)) const {
+            using namespace internal;
+
+            static_assert(AllArithmetic<Args...>::value && (std::is_void<ReturnType>::value || std::is_arithmetic<ReturnType>::value),
+                "function_batch only supports methods that take and return numbers");
+            auto invoker = &MethodBatchInvoker<decltype(memberFunction), ReturnType, ClassType*, Args...>::invoke;
+            _embind_register_class_batch_function(
+                TypeID<ClassType>::get(),
+                methodName,
+                sizeof...(Args),
+                !std::is_void<ReturnType>::value,
+                getSignature(invoker),
+                reinterpret_cast<GenericFunction>(invoker),
+                getContext(memberFunction));
+            return *this;
+        }
+
+        template<typename ReturnType, typename... Args>
+        EMSCRIPTEN_ALWAYS_INLINE const class_& function_batch(const char* methodName, ReturnType (ClassType::*memberFunction)(Args...) const) const {
+            using namespace internal;
+
+            static_assert(AllArithmetic<Args...>::value && (std::is_void<ReturnType>::value || std::is_arithmetic<ReturnType>::value),
+                "function_batch only supports methods that take and return numbers");
+            auto invoker = &MethodBatchInvoker<decltype(memberFunction), ReturnType, const ClassType*, Args...>::invoke;
+            _embind_register_class_batch_function(
+                TypeID<ClassType>::get(),
+                methodName,
+                sizeof...(Args),
+                !std::is_void<ReturnType>::value,
+                getSignature(invoker),
+                reinterpret_cast<GenericFunction>(invoker),
+                getContext(memberFunction));
+            return *this;
+        }
+
         template<typename ReturnType, typename ThisType, typename... Args, typename... Policies>
         EMSCRIPTEN_ALWAYS_INLINE const class_& function(const char* methodName, ReturnType (*function)(ThisType, Args...), Policies...) const {
             using namespace internal;
@@ -1480,6 +1643,39 @@ namespace emscripten {
                 return true;
             }
         };
+
+        template<
+            typename VectorType,
+            bool = typeSupportsMemoryView<typename VectorType::value_type>() &&
+                !std::is_same<typename VectorType::value_type, bool>::value>
+        struct VectorViews {
+            static void bind(const class_<VectorType>&) {
+            }
+        };
+
+        // Vectors of numbers can also be read and written from JavaScript
+        // in bulk, through a typed array that aliases their storage.
+        template<typename VectorType>
+        struct VectorViews<VectorType, true> {
+            // The view is only valid until the vector reallocates or the
+            // heap grows, so get a new one rather than keeping it.
+            static val view(VectorType& v) {
+                return val(typed_memory_view(v.size(), v.data()));
+            }
+
+            static void assignFrom(VectorType& v, val array) {
+                v.resize(array["length"].as<size_t>());
+                val typedArray = view(v);
+                typedArray.call<void>("set", array);
+            }
+
+            static void bind(const class_<VectorType>& c) {
+                c
+                    .function("view", &view)
+                    .function("assignFrom", &assignFrom)
+                    ;
+            }
+        };
     }
 
     template<typename T>
@@ -1488,7 +1684,8 @@ namespace emscripten {
 
         void (VecType::*push_back)(const T&) = &VecType::push_back;
         void (VecType::*resize)(const size_t, const T&) = &VecType::resize;
-        return class_<std::vector<T>>(name)
+        class_<VecType> vectorClass(name);
+        vectorClass
             .template constructor<>()
             .function("push_back", push_back)
             .function("resize", resize)
@@ -1496,6 +1693,8 @@ namespace emscripten {
             .function("get", &internal::VectorAccess<VecType>::get)
             .function("set", &internal::VectorAccess<VecType>::set)
             ;
+        internal::VectorViews<VecType>::bind(vectorClass);
+        return vectorClass;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
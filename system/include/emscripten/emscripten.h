@@ -76,6 +76,9 @@ extern void emscripten_set_main_loop_arg(em_arg_callback_func func, void *arg, i
 extern void emscripten_pause_main_loop(void);
 extern void emscripten_resume_main_loop(void);
 extern void emscripten_cancel_main_loop(void);
+
+typedef int (*em_idle_callback_func)(double time_remaining, void *arg);
+extern void emscripten_set_idle_callback(em_idle_callback_func func, void *arg);
 #else
 #define emscripten_set_main_loop(func, fps, simulateInfiniteLoop) \
   while (1) { func(); usleep(1000000/fps); }
@@ -93,6 +96,11 @@ extern void emscripten_set_socket_connection_callback(void *userData, em_socket_
 extern void emscripten_set_socket_message_callback(void *userData, em_socket_callback callback);
 extern void emscripten_set_socket_close_callback(void *userData, em_socket_callback callback);
 
+struct pollfd;
+typedef void (*em_socket_wait_callback)(int ready, void *userData);
+extern int emscripten_socket_wait(struct pollfd *fds, unsigned int nfds, int timeout);
+extern void emscripten_socket_wait_async(struct pollfd *fds, unsigned int nfds, int timeout, void *userData, em_socket_wait_callback callback);
+
 
 #if __EMSCRIPTEN__
 extern void _emscripten_push_main_loop_blocker(em_arg_callback_func func, void *arg, const char *name);
@@ -130,6 +138,10 @@ inline void emscripten_async_call(em_arg_callback_func func, void *arg, int mill
 extern void emscripten_exit_with_live_runtime(void);
 extern void emscripten_force_exit(int status);
 
+// With -s SNAPSHOT=1, the state of the program here is saved at build time, and the program starts from it, calling
+// resume(). Otherwise, just calls resume().
+extern void emscripten_snapshot_point(em_callback_func resume);
+
 double emscripten_get_device_pixel_ratio(void);
 
 void emscripten_hide_mouse(void);
@@ -182,6 +194,11 @@ void emscripten_idb_async_store(const char *db_name, const char *file_id, void*
 void emscripten_idb_async_delete(const char *db_name, const char *file_id, void* arg, em_arg_callback_func ondelete, em_arg_callback_func onerror);
 typedef void (*em_idb_exists_func)(void*, int);
 void emscripten_idb_async_exists(const char *db_name, const char *file_id, void* arg, em_idb_exists_func oncheck, em_arg_callback_func onerror);
+typedef void (*em_idb_load_into_func)(void*, int);
+void emscripten_idb_async_load_into(const char *db_name, const char *file_id, void* buffer, int size, void* arg, em_idb_load_into_func onload, em_arg_callback_func onerror);
+typedef void (*em_idb_load_many_func)(void*, int, void*, int);
+void emscripten_idb_async_load_many(const char *db_name, const char **file_ids, int num_files, void* arg, em_idb_load_many_func onload, em_arg_callback_func onerror);
+void emscripten_idb_async_store_many(const char *db_name, const char **file_ids, void **ptrs, int *nums, int num_files, void* arg, em_arg_callback_func onstore, em_arg_callback_func onerror);
 
 // IDB "sync" (EMTERPRETIFY_ASYNC)
 
@@ -244,6 +261,49 @@ int emscripten_get_callstack(int flags, char *out, int maxbytes);
 
 int emscripten_print_double(double x, char *to, signed max);
 
+// Grows the heap now, if needed, so that bytes more can be allocated without growing it later. Call this before large
+// allocations to choose when the heap is copied, with -s ALLOW_MEMORY_GROWTH=1. Returns 1 if the heap has room for bytes
+// more bytes, and 0 if it could not be grown.
+int emscripten_reserve_heap(size_t bytes);
+
+// Gives the free memory at the top of the malloc heap back, keeping pad bytes of it for future allocations. The heap is
+// made smaller with -s ALLOW_MEMORY_GROWTH=1 in asm.js builds; elsewhere the released pages are zeroed. Returns 1 if any
+// memory was released.
+int emscripten_trim_heap(size_t pad);
+
+// Allocates count blocks of size bytes each, that each start at a multiple of alignment, a power of two, and stores them
+// in ptrs. The blocks are carved out of one allocation, back to back, so a batch takes far less time and memory than
+// count calls to memalign(); each block only takes its size plus 4 bytes of bookkeeping, rounded up to the alignment.
+// Every block is freed with free() on its own. Returns 0 on success, EINVAL if alignment is not a power of two, or
+// ENOMEM if there is not enough memory, in which case nothing is allocated.
+int emscripten_malloc_aligned_batch(size_t count, size_t size, size_t alignment, void **ptrs);
+
+typedef struct emscripten_heap_stats {
+  // The heap as a whole
+  size_t heap_size;           // TOTAL_MEMORY
+  size_t dynamic_top;         // the end of the memory handed out by sbrk(); the rest up to heap_size is unused
+  size_t stack_size;          // the stack of the calling thread
+  size_t stack_used;
+  // malloc()
+  size_t malloc_footprint;    // the bytes that malloc took from sbrk()
+  size_t in_use_bytes;        // bytes in allocated blocks, including the bookkeeping of malloc
+  size_t in_use_blocks;
+  size_t free_bytes;          // bytes in free blocks, including the top of the malloc heap that was not split up yet
+  size_t free_blocks;
+  size_t largest_free_block;  // the largest allocation that fits without taking more memory from sbrk()
+  float fragmentation;        // 1 - largest_free_block / free_bytes: 0 when all free memory is one block, near 1 when
+                              // it is spread over many small ones
+  // Histograms of the blocks by size: index k counts the blocks of at least 2^k and less than 2^(k+1) bytes.
+  size_t in_use_blocks_by_size[32];
+  size_t free_blocks_by_size[32];
+} emscripten_heap_stats;
+
+// Fills in stats, for the heap and for malloc. Walks all blocks of the heap under the malloc lock, so this is safe to
+// call with pthreads, but takes time proportional to the number of blocks. With -s MALLOC_THREAD_CACHE=1, the blocks in
+// the caches of the threads count as in use. With SPLIT_MEMORY, the histograms and largest_free_block are not filled
+// in.
+void emscripten_get_heap_stats(emscripten_heap_stats *stats);
+
 /* ===================================== */
 /* Internal APIs. Be careful with these. */
 /* ===================================== */
@@ -260,6 +320,10 @@ emscripten_coroutine emscripten_coroutine_create(em_arg_callback_func func, void
 int emscripten_coroutine_next(emscripten_coroutine);
 void emscripten_yield(void);
 
+typedef void * emscripten_fiber;
+emscripten_fiber emscripten_fiber_create(em_arg_callback_func func, void *arg, int c_stack_size, int emt_stack_size);
+void emscripten_fiber_swap(emscripten_fiber fiber);
+
 
 #ifdef __cplusplus
 }
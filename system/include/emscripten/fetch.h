@@ -22,7 +22,10 @@ extern "C" {
 #define EMSCRIPTEN_FETCH_PERSIST_FILE 4
 
 // If the file already exists in IndexedDB, it is returned without redownload. If a partial transfer exists in IndexedDB,
-// the download will resume from where it left off and run to completion.
+// the download will resume from where it left off and run to completion. The file is downloaded in a sequence of Range
+// requests of a few megabytes each, and every part that has been received is stored to IndexedDB, so a download that
+// is interrupted only transfers the missing parts when it is started again. Once the download completes, the whole file
+// is stored to IndexedDB.
 // EMSCRIPTEN_FETCH_APPEND, EMSCRIPTEN_FETCH_REPLACE and EMSCRIPTEN_FETCH_NO_DOWNLOAD are mutually exclusive.
 #define EMSCRIPTEN_FETCH_APPEND 8
 
@@ -43,6 +46,18 @@ extern "C" {
 // to test or wair for its completion.
 #define EMSCRIPTEN_FETCH_WAITABLE 128
 
+// If specified, the response body is an LZ4 frame (the format of the lz4 command line tool), and the fetch delivers the
+// decoded bytes. With EMSCRIPTEN_FETCH_STREAM_DATA, each block is decoded as soon as it has arrived, and the onprogress()
+// handler receives the decoded bytes. Files are stored to IndexedDB as they were downloaded, and decoded again each time
+// they are loaded from there. If the body can not be decoded, the fetch fails with status 415.
+// Content and block checksums are not verified, and frames that need a dictionary are not supported.
+#define EMSCRIPTEN_FETCH_DECODE_LZ4 256
+
+// Like EMSCRIPTEN_FETCH_DECODE_LZ4, but the response body is gzip data. This is decoded with the DecompressionStream of
+// the browser, and fails with status 415 where that is not available.
+// EMSCRIPTEN_FETCH_DECODE_LZ4 and EMSCRIPTEN_FETCH_DECODE_GZIP are mutually exclusive.
+#define EMSCRIPTEN_FETCH_DECODE_GZIP 512
+
 struct emscripten_fetch_t;
 
 // Specifies the parameters for a newly initiated fetch operation.
@@ -99,8 +114,67 @@ typedef struct emscripten_fetch_attr_t
 
 	// Specifies the length of the buffer pointed by 'requestData'. Leave as 0 if no request body needs to be sent.
 	size_t requestDataSize;
+
+	// If non-zero, EMSCRIPTEN_FETCH_LOAD_TO_MEMORY places the body of the response to this buffer instead of allocating
+	// memory for it, and fetch->data will point inside this buffer. With EMSCRIPTEN_FETCH_STREAM_DATA, each chunk is
+	// placed at its offset from the start of the response. If the response does not fit in the buffer, the fetch fails
+	// with status 413, and totalBytes reports the size that would have been needed.
+	// The memory pointed to by this field is owned by the user, and needs to remain valid until the fetch finishes.
+	// emscripten_fetch_close() does not free it.
+	char *destinationBuffer;
+
+	// Specifies the length of the buffer pointed by 'destinationBuffer'.
+	size_t destinationBufferSize;
+
+	// XHRs are sent in the order of decreasing priority, and in the order they were started for equal priorities.
+	// Defaults to 0, and may also be negative, e.g. for prefetches that should not delay anything else.
+	int priority;
+
+	// If non-zero, the XHR of this fetch waits to be sent until fewer than this many XHRs of the calling thread are in
+	// flight. (Fetches that are proxied to the fetch worker count against the XHRs of the fetch worker instead.)
+	// Fetches started after it with the same or lower priority also wait for it to be sent.
+	unsigned int maxConcurrentRequests;
+
+	// If either is non-zero, only the bytes [rangeStart, rangeEnd[ of the file are fetched, with an HTTP Range request.
+	// A rangeEnd of 0 fetches everything from rangeStart to the end of the file. If the server sends the whole file
+	// instead, the range is cut out of it. Files that are loaded from IndexedDB are cut the same way, and partial fetches
+	// are never stored to IndexedDB. With EMSCRIPTEN_FETCH_DECODE_LZ4 or EMSCRIPTEN_FETCH_DECODE_GZIP, the range selects
+	// bytes of the encoded file, so it needs to start at a frame or member boundary.
+	uint64_t rangeStart;
+	uint64_t rangeEnd;
 } emscripten_fetch_attr_t;
 
+// Values of emscripten_fetch_timing_t::cacheResult.
+#define EMSCRIPTEN_FETCH_CACHE_NOT_USED 0 // The fetch did not look the file up in IndexedDB.
+#define EMSCRIPTEN_FETCH_CACHE_HIT 1      // The file was loaded from IndexedDB.
+#define EMSCRIPTEN_FETCH_CACHE_MISS 2     // The file was not found in IndexedDB.
+
+// Describes where the time of a fetch went, see emscripten_fetch_get_timing(). The times are measured in the thread that
+// runs the fetch (the fetch worker for proxied fetches), from the time it starts the fetch. Phases that the fetch did
+// not go through, e.g. the XHR of a file that was found in IndexedDB, take 0 msecs.
+typedef struct emscripten_fetch_timing_t
+{
+	// The time from the start of the fetch until its XHR was sent. This includes looking the file up in IndexedDB, and
+	// waiting behind XHRs of a higher priority or for the maxConcurrentRequests limit.
+	double queuedMSecs;
+
+	// The time from sending the XHR until the headers of the response arrived.
+	double timeToFirstByteMSecs;
+
+	// The time from the arrival of the headers until the fetch finished, including decoding the response, and storing it
+	// to IndexedDB with EMSCRIPTEN_FETCH_PERSIST_FILE.
+	double downloadMSecs;
+
+	// The time from the start of the fetch until it finished. Stays 0 while the fetch is in flight.
+	double totalMSecs;
+
+	// The number of bytes that the fetch has copied into the heap, i.e. to fetch->data.
+	uint64_t numBytesCopiedToHeap;
+
+	// One of the EMSCRIPTEN_FETCH_CACHE_* values.
+	uint32_t cacheResult;
+} emscripten_fetch_timing_t;
+
 typedef struct emscripten_fetch_t
 {
 	// Unique identifier for this fetch in progress.
@@ -119,7 +193,8 @@ typedef struct emscripten_fetch_t
 	//   - If the EMSCRIPTEN_FETCH_STREAM_DATA attribute was specified for the transfer, this points to a partial
 	//     chunk of bytes related to the transfer. Otherwise this will be null.
 	// The data buffer provided here has identical lifetime with the emscripten_fetch_t object itself, and is freed by
-	// calling emscripten_fetch_close() on the emscripten_fetch_t pointer.
+	// calling emscripten_fetch_close() on the emscripten_fetch_t pointer, unless it points to the destinationBuffer
+	// that was passed in the fetch attributes.
 	const char *data;
 
 	// Specifies the length of the above data block in bytes. When the download finishes, this field will be valid even if
@@ -132,6 +207,8 @@ typedef struct emscripten_fetch_t
 
 	// Specifies the total number of bytes that the response body will be.
 	// Note: This field may be zero, if the server does not report the Content-Length field.
+	// For a 206 Partial Content response to a Range request, this is the size of the whole resource, as reported in
+	// the Content-Range field.
 	uint64_t totalBytes;
 
 	// Specifies the readyState of the XHR request:
@@ -153,21 +230,86 @@ typedef struct emscripten_fetch_t
 
 	// For internal use only.
 	emscripten_fetch_attr_t __attributes;
+
+	// For internal use only, see emscripten_fetch_get_timing().
+	emscripten_fetch_timing_t __timing;
 } emscripten_fetch_t;
 
 // Clears the fields of an emscripten_fetch_attr_t structure to their default values in a future-compatible manner.
 void emscripten_fetch_attr_init(emscripten_fetch_attr_t *fetch_attr);
 
 // Initiates a new Emscripten fetch operation, which downloads data from the given URL or from IndexedDB database.
+// A fetch that is started on a pthread runs on that thread from start to finish, including its IndexedDB accesses (each
+// thread opens its own connection to the database), so threads that fetch in parallel do not wait for each other or for
+// the main thread. Its handlers are called from the event loop of the thread, which the thread needs to return to, e.g.
+// with emscripten_exit_with_live_runtime(). EMSCRIPTEN_FETCH_WAITABLE fetches, and EMSCRIPTEN_FETCH_SYNCHRONOUS fetches
+// that access IndexedDB, are run by the fetch worker instead.
 emscripten_fetch_t *emscripten_fetch(emscripten_fetch_attr_t *fetch_attr, const char *url);
 
 // Synchronously blocks to wait for the given fetch operation to complete. This operation is not allowed in the main browser
 // thread, in which case it will return EMSCRIPTEN_RESULT_NOT_SUPPORTED. Pass timeoutMSecs=infinite to wait indefinitely. If
 // the wait times out, the return value will be EMSCRIPTEN_RESULT_TIMEOUT.
-// The onsuccess()/onerror()/onprogress() handlers will be called in the calling thread from within this function before
-// this function returns.
+// The onsuccess()/onerror() handler will be called in the calling thread from within this function before this function
+// returns. onprogress() is not called for fetches that the fetch worker runs. A fetch that failed returns
+// EMSCRIPTEN_RESULT_FAILED.
 EMSCRIPTEN_RESULT emscripten_fetch_wait(emscripten_fetch_t *fetch, double timeoutMSecs);
 
+// Like emscripten_fetch_wait(), but waits until any one of the given fetches has completed, and returns its index in the
+// array after calling its onsuccess()/onerror() handler. The calling thread sleeps until a fetch completes, however many
+// fetches it waits for. Null entries and fetches that have been closed or are not waitable are skipped. A fetch whose
+// handler has already been called is returned immediately, so remove each fetch from the array (e.g. by setting its entry
+// to null) once it has been returned. Returns EMSCRIPTEN_RESULT_TIMED_OUT if the wait times out, and
+// EMSCRIPTEN_RESULT_INVALID_PARAM if none of the entries is a fetch that is still in flight.
+int emscripten_fetch_wait_any(emscripten_fetch_t * const *fetches, int numFetches, double timeoutMSecs);
+
+// Starts a batch of fetches: the IndexedDB accesses of the fetches that the calling thread performs until the matching
+// emscripten_fetch_batch_end() call share one IndexedDB transaction, which is much faster than a transaction for each
+// access when there are many small files. Batches can be nested. IndexedDB accesses that are issued during the same
+// tick of the browser event loop share a transaction even without a batch.
+// Fetches that are proxied to the fetch worker are not affected by a batch of the calling thread.
+void emscripten_fetch_batch_begin(void);
+
+// Ends the batch started by emscripten_fetch_batch_begin(), and issues its IndexedDB accesses.
+void emscripten_fetch_batch_end(void);
+
+// Reads the given files from IndexedDB in one transaction and keeps them in browser memory, so that the next fetch that
+// loads each of them from IndexedDB finishes without accessing IndexedDB. The paths are the destinationPath (or URL)
+// that the files were persisted with. Calls onfinished(userData, numLoaded) with the number of files that were found,
+// once all of them have been read. The array of paths needs to be valid only until this function returns.
+void emscripten_fetch_preload_cached_data(const char * const *paths, int numPaths, void (*onfinished)(void *userData, int numLoaded), void *userData);
+
+// Describes the files that fetches have stored to IndexedDB with EMSCRIPTEN_FETCH_PERSIST_FILE.
+typedef struct emscripten_fetch_cache_usage_t
+{
+	// The total size of the stored files, in bytes.
+	uint64_t numBytes;
+
+	// The budget set by emscripten_fetch_set_cache_budget(), or 0 if there is none.
+	uint64_t budget;
+
+	// The number of stored files.
+	uint32_t numFiles;
+} emscripten_fetch_cache_usage_t;
+
+// Limits the total size of the files in the IndexedDB cache to maxBytes, or lifts the limit if maxBytes is 0. The
+// budget is stored in IndexedDB, so it applies to all threads, and to later visits of the page. Whenever storing a file
+// takes the cache over its budget, the files that were stored or loaded least recently are deleted until it fits again. The file
+// that was just stored is kept even if it is larger than the budget on its own. If the browser runs out of quota for
+// the page, files are evicted the same way to make room, whether there is a budget or not. Files are evicted right
+// away if they already exceed the new budget. Then calls onfinished(userData, usage) with the usage afterwards, or
+// with a null pointer if IndexedDB is not available. The usage is valid only during the call. onfinished may be null.
+// The parts of interrupted resumable downloads are not counted.
+void emscripten_fetch_set_cache_budget(uint64_t maxBytes, void (*onfinished)(void *userData, const emscripten_fetch_cache_usage_t *usage), void *userData);
+
+// Reads the size of the IndexedDB cache and its budget, and calls onfinished(userData, usage) like
+// emscripten_fetch_set_cache_budget() does.
+void emscripten_fetch_get_cache_usage(void (*onfinished)(void *userData, const emscripten_fetch_cache_usage_t *usage), void *userData);
+
+// Copies the timing of the given fetch to *timing. This can be called at any point, e.g. from the onsuccess() or
+// onerror() handler, and the fields report the phases that have ended so far. When built with --tracing, the timing of
+// each fetch is also logged to the "fetch" channel of the trace once the fetch finishes.
+EMSCRIPTEN_RESULT emscripten_fetch_get_timing(const emscripten_fetch_t *fetch, emscripten_fetch_timing_t *timing);
+
 // Closes a finished or an executing fetch operation and frees up all memory. If the fetch operation was still executing, the
 // onerror() handler will be called in the calling thread before this function returns.
 EMSCRIPTEN_RESULT emscripten_fetch_close(emscripten_fetch_t *fetch);
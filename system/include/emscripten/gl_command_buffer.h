@@ -0,0 +1,74 @@
+#ifndef __emscripten_gl_command_buffer_h__
+#define __emscripten_gl_command_buffer_h__
+
+#include <stddef.h>
+#include <emscripten/threading.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Records GL calls that a pthread makes into a ring of calls in the shared heap, for the main browser thread, which owns
+// the WebGL context, to replay them in one batch, instead of proxying and waiting for every call on its own:
+//
+//   em_gl_command_buffer *gl = emscripten_gl_command_buffer_create(4096);
+//   ...
+//   void render_frame() { // On the render thread.
+//     emscripten_gl_command_buffer_record(gl, EM_FUNC_SIG_VII, glBindBuffer, GL_ARRAY_BUFFER, vbo);
+//     emscripten_gl_command_buffer_cache_integer(gl, GL_ARRAY_BUFFER_BINDING, vbo);
+//     void *data = emscripten_gl_command_buffer_copy(gl, vertices, size);
+//     emscripten_gl_command_buffer_record(gl, EM_FUNC_SIG_GENERIC_V(4), glBufferSubData, GL_ARRAY_BUFFER, 0, size, data);
+//     emscripten_gl_command_buffer_record(gl, EM_FUNC_SIG_VIII, glDrawArrays, GL_TRIANGLES, 0, count);
+//     emscripten_gl_command_buffer_submit(gl); // Once per frame.
+//   }
+//
+// Only calls that return nothing and only read memory that stays valid until they are replayed can be recorded. Calls
+// that return a result or write through a pointer, like glGetError() or glGenBuffers(), go through
+// emscripten_gl_command_buffer_call_sync(), which waits for the main thread. To answer queries without waiting, the
+// buffer has a cache of integer state that the recording thread can fill in as it records the calls that change it.
+//  - Requires building with -s USE_PTHREADS=1/2.
+//  - A command buffer must be recorded into by one thread at a time. When that is the main runtime thread, the calls
+//    are made right away.
+
+typedef struct em_gl_command_buffer em_gl_command_buffer;
+
+// Creates a command buffer that holds up to capacity recorded calls, rounded up to a power of two. Returns 0 if there is
+// not enough memory.
+em_gl_command_buffer *emscripten_gl_command_buffer_create(int capacity);
+
+// Replays the calls that were recorded and waits for them, then frees the buffer.
+void emscripten_gl_command_buffer_destroy(em_gl_command_buffer *buffer);
+
+// Records a call of func_ptr with the given signature and arguments, which are read as by
+// emscripten_async_run_in_main_runtime_thread_(). If the buffer is full, submits it and waits until the main thread has
+// replayed enough calls to make room.
+void emscripten_gl_command_buffer_record(em_gl_command_buffer *buffer, EM_FUNC_SIGNATURE sig, void *func_ptr, ...);
+
+// Copies size bytes of data for the next call recorded into the buffer, for example the vertices of glBufferSubData().
+// The copy is freed after that call was replayed. Up to EM_QUEUED_CALL_MAX_ARGS copies can be made for one call. Returns
+// 0 if there is not enough memory.
+void *emscripten_gl_command_buffer_copy(em_gl_command_buffer *buffer, const void *data, size_t size);
+
+// Hands the calls recorded so far to the main thread, which replays them the next time it processes its queue of
+// proxied calls. Does not wait.
+void emscripten_gl_command_buffer_submit(em_gl_command_buffer *buffer);
+
+// Makes a call on the main thread and waits for it, after the calls recorded before it were replayed. Returns the
+// result of calls that return an int or a pointer.
+int emscripten_gl_command_buffer_call_sync(em_gl_command_buffer *buffer, EM_FUNC_SIGNATURE sig, void *func_ptr, ...);
+
+// Remembers the value of an integer piece of state, such as GL_ARRAY_BUFFER_BINDING, so that it can be looked up
+// without asking the main thread. The cache is only used by the thread that records into the buffer.
+void emscripten_gl_command_buffer_cache_integer(em_gl_command_buffer *buffer, unsigned pname, int value);
+
+// Stores the cached value of pname to *value and returns 1, or returns 0 if it is not in the cache.
+int emscripten_gl_command_buffer_get_cached_integer(em_gl_command_buffer *buffer, unsigned pname, int *value);
+
+// Forgets all cached state, for example after the GL context was lost.
+void emscripten_gl_command_buffer_clear_cache(em_gl_command_buffer *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __emscripten_handle_heap_h__
+#define __emscripten_handle_heap_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A heap of relocatable blocks, for long-lived data in applications that run for a long time, where the holes that
+// frees leave in the malloc heap would otherwise add up until memory runs out.
+//
+// Blocks are referred to by handles instead of pointers, and a table maps each handle to the current address of its
+// block. That lets emscripten_handle_heap_compact() slide blocks together to close the holes between them, a little at
+// a time, for example at the end of each frame of an emscripten_set_main_loop() callback, or whenever the application is
+// idle:
+//
+//   void frame() {
+//     render();
+//     emscripten_handle_heap_compact(heap, 64*1024); // move at most 64KB per frame
+//   }
+//
+// A pointer from emscripten_handle_get() stays valid until the next call to emscripten_handle_heap_compact() or
+// emscripten_handle_alloc() on the same heap, since both can move blocks. To keep a pointer for longer, lock the block:
+// locked blocks are not moved.
+//
+// The heap does not grow: allocations fail when its capacity is used up even after compacting. A handle heap is not
+// thread-safe, so each heap must only be used on one thread at a time.
+
+typedef struct em_handle_heap em_handle_heap;
+
+// Handles are nonzero. 0 is returned when an allocation fails.
+typedef uint32_t em_handle;
+
+// Creates a handle heap for capacity bytes of blocks, of which each block uses 8 bytes for bookkeeping. Returns 0 if
+// there is not enough memory.
+em_handle_heap *emscripten_handle_heap_create(size_t capacity);
+
+// Frees the heap and all blocks in it. The handles of the blocks become invalid.
+void emscripten_handle_heap_destroy(em_handle_heap *heap);
+
+// Allocates a block of bytes bytes, 8-byte aligned. If there is no room at the end of the heap, but enough free memory
+// between blocks, compacts the whole heap first. Returns 0 if there is not enough memory.
+em_handle emscripten_handle_alloc(em_handle_heap *heap, size_t bytes);
+
+// Frees a block. The handle may be reused by a later allocation.
+void emscripten_handle_free(em_handle_heap *heap, em_handle handle);
+
+// Returns the current address of the block of handle.
+void *emscripten_handle_get(em_handle_heap *heap, em_handle handle);
+
+// Returns the number of bytes of the block of handle, which can be more than were requested.
+size_t emscripten_handle_size(em_handle_heap *heap, em_handle handle);
+
+// Pins the block of handle so it is not moved, and returns its address. Locks nest: the block can move again once
+// emscripten_handle_unlock() was called as often as emscripten_handle_lock(). Free space right below a locked block is
+// not given back by compacting until the block is unlocked, so unlock blocks when possible.
+void *emscripten_handle_lock(em_handle_heap *heap, em_handle handle);
+void emscripten_handle_unlock(em_handle_heap *heap, em_handle handle);
+
+// Moves blocks to close holes, so that the time spent is bounded: once max_bytes bytes were copied, no further block is
+// moved, and each call continues where the last one stopped. Returns 1 if there are holes left to close, and 0 once
+// the heap is compacted, except for space below locked blocks.
+int emscripten_handle_heap_compact(em_handle_heap *heap, size_t max_bytes);
+
+// Returns the number of bytes in free space between blocks, that compacting the heap would give back.
+size_t emscripten_handle_heap_fragmented_bytes(em_handle_heap *heap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
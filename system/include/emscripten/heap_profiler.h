@@ -0,0 +1,49 @@
+#ifndef __emscripten_heap_profiler_h__
+#define __emscripten_heap_profiler_h__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A sampling heap profiler in the malloc library, enabled by linking with -s HEAP_PROFILER=<bytes>. On average one
+// allocation is sampled for every that many bytes allocated, so the overhead is low enough for release builds. The
+// JavaScript call stack of each sampled allocation is captured, and samples are aggregated by call stack. The profile
+// is written in the protocol buffer format of pprof (https://github.com/google/pprof), with the sample types
+// alloc_objects, alloc_space, inuse_objects and inuse_space, and can be opened with "pprof -top file.pb" and the
+// other views of pprof. Values are scaled by the sampling probability, so they estimate the totals of the program.
+// From JavaScript, Module['getHeapProfile']() returns the same profile as a Uint8Array.
+//
+// Stacks contain the names of the compiled functions, so build with --profiling-funcs or -g2 to get readable names
+// in optimized builds. Not supported with pthreads, SPLIT_MEMORY or COMPACT_MALLOC.
+//
+// Without -s HEAP_PROFILER, these functions do nothing.
+
+#ifdef __EMSCRIPTEN_HEAP_PROFILER__
+
+// Changes the average number of bytes between two samples. 0 stops sampling; allocations that were already sampled
+// stay in the profile until they are freed.
+void emscripten_heap_profiler_set_sample_interval(size_t bytes);
+
+// Writes the current profile to the given file. Returns 0 on success, or -1 if the file could not be written.
+int emscripten_heap_profiler_write(const char *filename);
+
+// Called by the malloc library for each allocation and free.
+void emscripten_heap_profiler_record_allocation(const void *address, size_t size);
+void emscripten_heap_profiler_record_free(const void *address);
+
+#else
+
+#define emscripten_heap_profiler_set_sample_interval(bytes)
+#define emscripten_heap_profiler_write(filename) (-1)
+#define emscripten_heap_profiler_record_allocation(address, size)
+#define emscripten_heap_profiler_record_free(address)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
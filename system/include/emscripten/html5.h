@@ -397,6 +397,8 @@ extern EMSCRIPTEN_RESULT emscripten_vibrate_pattern(int *msecsArray, int numEntr
 typedef const char *(*em_beforeunload_callback)(int eventType, const void *reserved, void *userData);
 extern EMSCRIPTEN_RESULT emscripten_set_beforeunload_callback(void *userData, em_beforeunload_callback callback);
 
+extern EMSCRIPTEN_RESULT emscripten_get_coalesced_events(const void **events, int *numEvents);
+
 typedef int EMSCRIPTEN_WEBGL_CONTEXT_HANDLE;
 
 typedef struct EmscriptenWebGLContextAttributes {
@@ -426,6 +428,12 @@ extern EMSCRIPTEN_WEBGL_CONTEXT_HANDLE emscripten_webgl_get_current_context(void
 
 extern EMSCRIPTEN_RESULT emscripten_webgl_get_drawing_buffer_size(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, int *width, int *height);
 
+extern int emscripten_webgl_get_redundant_state_changes(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context);
+
+extern EMSCRIPTEN_RESULT emscripten_webgl_prefetch_program(const char *vertexSource, const char *fragmentSource, const char * const *attribs, int numAttribs);
+
+extern int emscripten_webgl_get_pending_program_prefetches(void);
+
 extern EMSCRIPTEN_RESULT emscripten_webgl_destroy_context(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context);
 
 extern EM_BOOL emscripten_webgl_enable_extension(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, const char *extension);
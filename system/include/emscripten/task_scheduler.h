@@ -0,0 +1,56 @@
+#ifndef __emscripten_task_scheduler_h__
+#define __emscripten_task_scheduler_h__
+
+#include <emscripten/threading.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A work-stealing scheduler of small tasks, run by a fixed set of pthreads. Every worker thread has a deque of its own:
+// it pushes and pops the tasks it spawns at one end, and idle workers steal from the other end of the deques of the
+// others. Workers that find no work park themselves on a futex until new tasks are spawned.
+//  - Requires building with -s USE_PTHREADS=1/2. With -s PTHREAD_POOL_SIZE=N, the scheduler starts N workers by default,
+//    so that the pre-spawned Workers of the pool are used.
+//  - Tasks can be spawned and waited for on any thread. A thread that waits for a group runs tasks while it waits.
+//    Waiting on the main browser thread busy-spins like the other blocking calls do there, so prefer to wait on pthreads.
+
+typedef void (*em_task_func)(void *arg);
+
+// Counts the tasks of a group that have not finished yet. Initialize with EM_TASK_GROUP_INIT, or zero it.
+typedef struct em_task_group
+{
+  volatile int numPending;
+} em_task_group;
+
+#define EM_TASK_GROUP_INIT { 0 }
+
+// Starts the worker threads of the scheduler. If numThreads is 0, the number of threads is PTHREAD_POOL_SIZE, or the
+// number of logical cores if there is no pool. The scheduler is started on first use if this is not called. Returns
+// EMSCRIPTEN_RESULT_SUCCESS, or EMSCRIPTEN_RESULT_NOT_SUPPORTED if the scheduler was already started or the browser has
+// no threading support.
+EMSCRIPTEN_RESULT emscripten_task_scheduler_init(int numThreads);
+
+// Waits for the spawned tasks to finish, and stops the worker threads. The scheduler can be started again afterwards.
+void emscripten_task_scheduler_shutdown(void);
+
+// Returns the number of worker threads of the scheduler, or 0 if it is not running.
+int emscripten_task_scheduler_num_threads(void);
+
+// Spawns a task that calls func(arg), as part of the given group. If there is no room for the task in the queue of the
+// calling thread, the task is run right away.
+void emscripten_task_spawn(em_task_group *group, em_task_func func, void *arg);
+
+// Runs tasks until all tasks of the given group, including the ones that those tasks spawn to it, have finished.
+void emscripten_task_group_wait(em_task_group *group);
+
+// Calls body(rangeBegin, rangeEnd, arg) over consecutive ranges that cover [begin, end), in parallel. The ranges are
+// split in halves down to at most grainSize elements; if grainSize is 0, it is chosen from the number of threads.
+// Returns when all ranges have been processed.
+void emscripten_parallel_for(int begin, int end, int grainSize, void (*body)(int rangeBegin, int rangeEnd, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,7 +27,7 @@ void emscripten_force_num_logical_cores(int cores);
 uint8_t emscripten_atomic_exchange_u8(void/*uint8_t*/ *addr, uint8_t newVal);
 uint16_t emscripten_atomic_exchange_u16(void/*uint16_t*/ *addr, uint16_t newVal);
 uint32_t emscripten_atomic_exchange_u32(void/*uint32_t*/ *addr, uint32_t newVal);
-uint64_t emscripten_atomic_exchange_u64(void/*uint64_t*/ *addr, uint64_t newVal); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_exchange_u64(void/*uint64_t*/ *addr, uint64_t newVal); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 // CAS returns the *old* value that was in the memory location before the operation took place.
 // That is, if the return value when calling this function equals to 'oldVal', then the operation succeeded,
@@ -35,22 +35,22 @@ uint64_t emscripten_atomic_exchange_u64(void/*uint64_t*/ *addr, uint64_t newVal)
 uint8_t emscripten_atomic_cas_u8(void/*uint8_t*/ *addr, uint8_t oldVal, uint8_t newVal);
 uint16_t emscripten_atomic_cas_u16(void/*uint16_t*/ *addr, uint16_t oldVal, uint16_t newVal);
 uint32_t emscripten_atomic_cas_u32(void/*uint32_t*/ *addr, uint32_t oldVal, uint32_t newVal);
-uint64_t emscripten_atomic_cas_u64(void/*uint64_t*/ *addr, uint64_t oldVal, uint64_t newVal); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_cas_u64(void/*uint64_t*/ *addr, uint64_t oldVal, uint64_t newVal); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 uint8_t emscripten_atomic_load_u8(const void/*uint8_t*/ *addr);
 uint16_t emscripten_atomic_load_u16(const void/*uint16_t*/ *addr);
 uint32_t emscripten_atomic_load_u32(const void/*uint32_t*/ *addr);
 float emscripten_atomic_load_f32(const void/*float*/ *addr);
-uint64_t emscripten_atomic_load_u64(const void/*uint64_t*/ *addr); // Emulated with locks, very slow!!
-double emscripten_atomic_load_f64(const void/*double*/ *addr); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_load_u64(const void/*uint64_t*/ *addr); // Emulated with locks if the browser has no 64-bit Atomics, slow!
+double emscripten_atomic_load_f64(const void/*double*/ *addr); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 // Returns the value that was stored (i.e. 'val')
 uint8_t emscripten_atomic_store_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_store_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_store_u32(void/*uint32_t*/ *addr, uint32_t val);
 float emscripten_atomic_store_f32(void/*float*/ *addr, float val);
-uint64_t emscripten_atomic_store_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
-double emscripten_atomic_store_f64(void/*double*/ *addr, double val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_store_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
+double emscripten_atomic_store_f64(void/*double*/ *addr, double val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 void emscripten_atomic_fence(void);
 
@@ -58,35 +58,55 @@ void emscripten_atomic_fence(void);
 uint8_t emscripten_atomic_add_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_add_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_add_u32(void/*uint32_t*/ *addr, uint32_t val);
-uint64_t emscripten_atomic_add_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_add_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 uint8_t emscripten_atomic_sub_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_sub_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_sub_u32(void/*uint32_t*/ *addr, uint32_t val);
-uint64_t emscripten_atomic_sub_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_sub_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 uint8_t emscripten_atomic_and_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_and_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_and_u32(void/*uint32_t*/ *addr, uint32_t val);
-uint64_t emscripten_atomic_and_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_and_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 uint8_t emscripten_atomic_or_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_or_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_or_u32(void/*uint32_t*/ *addr, uint32_t val);
-uint64_t emscripten_atomic_or_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_or_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 uint8_t emscripten_atomic_xor_u8(void/*uint8_t*/ *addr, uint8_t val);
 uint16_t emscripten_atomic_xor_u16(void/*uint16_t*/ *addr, uint16_t val);
 uint32_t emscripten_atomic_xor_u32(void/*uint32_t*/ *addr, uint32_t val);
-uint64_t emscripten_atomic_xor_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks, very slow!!
+uint64_t emscripten_atomic_xor_u64(void/*uint64_t*/ *addr, uint64_t val); // Emulated with locks if the browser has no 64-bit Atomics, slow!
 
 int emscripten_futex_wait(volatile void/*uint32_t*/ *addr, uint32_t val, double maxWaitMilliseconds);
 int emscripten_futex_wake(volatile void/*uint32_t*/ *addr, int count);
+// Wakes up to count waiters on addr and moves the rest to wait on addr2, or returns -EAGAIN if *addr != cmpValue. Only a wait
+// of the main browser thread can be moved: waiters in workers that would be moved are woken instead, as a spurious wakeup.
 int emscripten_futex_wake_or_requeue(volatile void/*uint32_t*/ *addr, int count, volatile void/*uint32_t*/ *addr2, int cmpValue);
 
+// Statistics of the futex waits that the main browser thread has performed, for finding the locks that it contends on.
+typedef struct em_futex_wait_stats
+{
+  double totalMsecs; // Total time spent waiting.
+  double maxMsecs; // The longest single wait.
+  int numWaits; // Number of waits, including the ones that timed out.
+  int numTimeouts; // Number of waits that timed out.
+  int numAsyncWaits; // Number of waits that yielded to the browser event loop, see -s PTHREADS_MAIN_THREAD_ASYNC_WAIT.
+} em_futex_wait_stats;
+
+// Sums up the statistics of the main browser thread waits on all futexes in the address range [addr, addr+numBytes).
+// Pass the address and size of a lock object, e.g. of a pthread_mutex_t, to get the stats of that lock.
+void emscripten_main_thread_futex_wait_stats(const void *addr, size_t numBytes, em_futex_wait_stats *stats);
+
+// Clears the statistics of all futexes.
+void emscripten_main_thread_reset_futex_wait_stats(void);
+
 typedef union em_variant_val
 {
   int i;
+  int64_t i64;
   float f;
   double d;
   void *vp;
@@ -107,6 +127,10 @@ typedef struct em_queued_call
   // this em_queued_call object after it has been executed. If
   // false, the caller is in control of the memory.
   int calleeDelete;
+
+  // Links the calls in the queue of the main runtime thread, and the
+  // free call objects in the pool that they are allocated from.
+  struct em_queued_call *next;
 } em_queued_call;
 
 void emscripten_sync_run_in_main_thread(em_queued_call *call);
@@ -138,6 +162,27 @@ typedef int (*em_func_iiii)(int, int, int);
 
 #define EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(x) ((x) & 1023)
 
+// Besides the fixed signatures above, a signature can spell out the type of the return value and of each of up to
+// EM_QUEUED_CALL_MAX_ARGS arguments. For example, the signature of a function void f(float x, double y, int64_t z) is
+//   EM_FUNC_SIG_GENERIC_V(3) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_F) | EM_FUNC_SIG_ARG(1, EM_FUNC_SIG_TYPE_D) | EM_FUNC_SIG_ARG(2, EM_FUNC_SIG_TYPE_J)
+// and the signature of a function double g(void *p) is
+//   EM_FUNC_SIG_GENERIC_R(EM_FUNC_SIG_TYPE_D, 1) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_I)
+// The arguments are passed to the run_in_main_runtime_thread functions as they are. The result of a call made with
+// emscripten_async_waitable_run_in_main_runtime_thread() is stored to the field of call->returnValue that matches
+// its type.
+#define EM_FUNC_SIG_TYPE_I 0 // int, or a pointer
+#define EM_FUNC_SIG_TYPE_J 1 // int64_t
+#define EM_FUNC_SIG_TYPE_F 2 // float
+#define EM_FUNC_SIG_TYPE_D 3 // double
+
+#define EM_FUNC_SIG_GENERIC 4096
+#define EM_FUNC_SIG_GENERIC_V(numArgs) (EM_FUNC_SIG_GENERIC | 1024 | (numArgs))
+#define EM_FUNC_SIG_GENERIC_R(returnType, numArgs) (EM_FUNC_SIG_GENERIC | 2048 | ((returnType) << 14) | (numArgs))
+#define EM_FUNC_SIG_ARG(index, type) ((EM_FUNC_SIGNATURE)((unsigned)(type) << (16 + 2*(index))))
+
+#define EM_FUNC_SIG_RETURN_TYPE(x) (((x) >> 14) & 3)
+#define EM_FUNC_SIG_ARG_TYPE(x, index) (((unsigned)(x) >> (16 + 2*(index))) & 3)
+
 // Runs the given function synchronously on the main Emscripten runtime thread.
 // If this thread is the main thread, the operation is immediately performed, and the result is returned.
 // If the current thread is not the main Emscripten runtime thread (but a pthread), the function
@@ -161,7 +206,17 @@ void emscripten_async_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *f
 //    to emscripten_async_waitable_close() after the wait has been performed.
 em_queued_call *emscripten_async_waitable_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *func_ptr, ...);
 
+// Posts the given function to be called on the given thread, in a fire and forget manner like the 'async' variant of the
+// run_in_main_runtime_thread functions. The call is placed to the mailbox of the target thread, which runs it the next
+// time that it calls emscripten_current_thread_process_queued_calls() or emscripten_current_thread_wait_for_queued_calls()
+// from its own loop. Calls to the main runtime thread go to its command queue, and calls to the calling thread itself
+// are performed immediately.
+//  - Multiple calls dispatched from a single thread to another one are executed in the order they were dispatched in.
+//  - Calls that are still in the mailbox of a thread when it exits are never run.
+void emscripten_dispatch_to_thread_(pthread_t thread, EM_FUNC_SIGNATURE sig, void *func_ptr, ...);
+
 // Since we can't validate the function pointer type, allow implicit casting of functions to void* without complaining.
+#define emscripten_dispatch_to_thread(thread, sig, func_ptr, ...) emscripten_dispatch_to_thread_((thread), (sig), (void*)(func_ptr),##__VA_ARGS__)
 #define emscripten_sync_run_in_main_runtime_thread(sig, func_ptr, ...) emscripten_sync_run_in_main_runtime_thread_((sig), (void*)(func_ptr),##__VA_ARGS__)
 #define emscripten_async_run_in_main_runtime_thread(sig, func_ptr, ...) emscripten_async_run_in_main_runtime_thread_((sig), (void*)(func_ptr),##__VA_ARGS__)
 #define emscripten_async_waitable_run_in_main_runtime_thread(sig, func_ptr, ...) emscripten_async_waitable_run_in_main_runtime_thread_((sig), (void*)(func_ptr),##__VA_ARGS__)
@@ -183,6 +238,29 @@ int emscripten_is_main_browser_thread(void);
 // that are considered cancellation points.
 void emscripten_main_thread_process_queued_calls(void);
 
+// Runs the calls that other threads have dispatched to the calling thread with emscripten_dispatch_to_thread().
+// Must not be called from inside one of these calls.
+void emscripten_current_thread_process_queued_calls(void);
+
+// Waits until at least one call has been dispatched to the calling thread, or the timeout passes, and then runs the
+// dispatched calls. Returns EMSCRIPTEN_RESULT_TIMED_OUT if no call arrived in time. The main runtime thread cannot
+// wait, and gets EMSCRIPTEN_RESULT_NOT_SUPPORTED.
+EMSCRIPTEN_RESULT emscripten_current_thread_wait_for_queued_calls(double timeoutMSecs);
+
+// Message channels carry binary data from any thread to JS code on the main browser thread, e.g. for uploading to a canvas or
+// sending over the network. The JS handler of a channel is registered on the main browser thread with
+//   Module['pthreadChannelHandlers'][channel] = function(bytes) { ... };
+// where bytes is a Uint8Array. Messages are delivered asynchronously, in the order they were posted from each thread.
+#define EM_CHANNEL_TRANSFER 0 // Copy the data into a new ArrayBuffer on the calling thread, and transfer it to the
+                              // main thread without copying it again. The data can be reused as soon as the post returns.
+#define EM_CHANNEL_HEAP_VIEW 1 // Hand the handler a view of the data in the heap, without any copies. The channel takes
+                               // ownership of the data, which must have been allocated with malloc(), and frees it after
+                               // the handler returns, so the handler must not hold on to the view.
+
+// Posts numBytes of data to the given channel with one of the EM_CHANNEL_* modes. Returns EMSCRIPTEN_RESULT_SUCCESS, or
+// EMSCRIPTEN_RESULT_INVALID_PARAM if the mode is unknown.
+EMSCRIPTEN_RESULT emscripten_channel_post(int channel, void *data, size_t numBytes, int mode);
+
 // Direct syscall access, second argument is a varargs pointer. used in proxying
 int emscripten_syscall(int, void*);
 
@@ -239,4 +317,74 @@ struct thread_profiler_block
 }
 #endif
 
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace emscripten {
+
+namespace internal {
+
+template<typename R>
+struct ProxiedResult
+{
+  typename std::aligned_storage<sizeof(R), alignof(R)>::type storage;
+  template<typename F> void call(F &f) { new (&storage) R(f()); }
+  R get() { R *r = reinterpret_cast<R*>(&storage); R value(std::move(*r)); r->~R(); return value; }
+};
+
+template<>
+struct ProxiedResult<void>
+{
+  template<typename F> void call(F &f) { f(); }
+  void get() {}
+};
+
+template<typename F, typename R>
+struct ProxiedCall
+{
+  F *f;
+  ProxiedResult<R> result;
+  static void run(void *call) { ProxiedCall *c = (ProxiedCall*)call; c->result.call(*c->f); }
+};
+
+template<typename F>
+void runProxiedAsync(void *f)
+{
+  F *fn = (F*)f;
+  (*fn)();
+  delete fn;
+}
+
+} // namespace internal
+
+// Calls the given function object, such as a lambda, on the main runtime thread, waits for it to finish, and returns
+// its result. The function object is not copied, since it lives on the stack of the waiting thread for the whole call.
+template<typename F>
+typename std::decay<decltype(std::declval<F&>()())>::type proxy(F &&f)
+{
+  typedef typename std::remove_reference<F>::type Fn;
+  typedef typename std::decay<decltype(std::declval<F&>()())>::type R;
+  internal::ProxiedCall<Fn, R> call;
+  call.f = &f;
+  em_queued_call q = { EM_FUNC_SIG_VI, (void*)&internal::ProxiedCall<Fn, R>::run };
+  q.args[0].vp = &call;
+  emscripten_sync_run_in_main_thread(&q);
+  return call.result.get();
+}
+
+// Posts the given function object to be called on the main runtime thread, without waiting for it. The function
+// object is moved to the heap, since it has to outlive the caller's scope. Calls posted from one thread are run in
+// the order they were posted in.
+template<typename F>
+void proxy_async(F &&f)
+{
+  typedef typename std::decay<F>::type Fn;
+  emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI, &internal::runProxiedAsync<Fn>, new Fn(std::forward<F>(f)));
+}
+
+} // namespace emscripten
+#endif
+
 #endif
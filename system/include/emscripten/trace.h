@@ -16,6 +16,10 @@ void emscripten_trace_configure_for_google_wtf(void);
 
 void emscripten_trace_configure_for_test(void);
 
+void emscripten_trace_configure_for_chrome_tracing(void);
+
+void emscripten_trace_save_chrome_tracing(const char *filename);
+
 void emscripten_trace_set_enabled(bool enabled);
 
 void emscripten_trace_set_session_username(const char *username);
@@ -30,6 +34,8 @@ void emscripten_trace_log_message(const char *channel, const char *message);
 
 void emscripten_trace_report_error(const char *error);
 
+// With -s TRACE_BUFFER, the allocation, reallocation, free and storage size events are written into a ring buffer in
+// the heap, and are drained in batches, instead of calling out to JavaScript for each.
 void emscripten_trace_record_allocation(const void *address, int32_t size);
 
 void emscripten_trace_record_reallocation(const void *old_address, const void *new_address, int32_t size);
@@ -65,6 +71,8 @@ void emscripten_trace_close(void);
 #define emscripten_trace_configure(collector_url, application)
 #define emscripten_trace_configure_for_google_wtf()
 #define emscripten_trace_configure_for_test()
+#define emscripten_trace_configure_for_chrome_tracing()
+#define emscripten_trace_save_chrome_tracing(filename)
 #define emscripten_trace_set_enabled(enabled)
 #define emscripten_trace_set_session_username(username)
 #define emscripten_trace_record_frame_start()
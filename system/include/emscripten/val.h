@@ -38,6 +38,7 @@ namespace emscripten {
 
             void _emval_incref(EM_VAL value);
             void _emval_decref(EM_VAL value);
+            void _emval_decref_all(const EM_VAL* values, unsigned count);
 
             void _emval_run_destructors(EM_DESTRUCTORS handle);
 
@@ -57,6 +58,8 @@ namespace emscripten {
             EM_VAL _emval_get_module_property(const char* name);
             EM_VAL _emval_get_property(EM_VAL object, EM_VAL key);
             void _emval_set_property(EM_VAL object, EM_VAL key, EM_VAL value);
+            EM_VAL _emval_get_symbol_property(EM_VAL object, const char* key);
+            void _emval_set_symbol_property(EM_VAL object, const char* key, EM_VAL value);
             EM_GENERIC_WIRE_TYPE _emval_as(EM_VAL value, TYPEID returnType, EM_DESTRUCTORS* destructors);
 
             bool _emval_equals(EM_VAL first, EM_VAL second);
@@ -230,12 +233,28 @@ namespace emscripten {
             std::array<GenericWireType, PackSize<Args...>::value> elements;
         };
 
+        // Arithmetic values are converted without allocating anything on the
+        // JS side, so results of these types are returned without a list of
+        // destructors to run afterwards.
+        template<typename T>
+        struct NeedsResultDestructors {
+            static constexpr bool value = !std::is_arithmetic<T>::value;
+        };
+
         template<typename ReturnType, typename... Args>
         struct MethodCaller {
             static ReturnType call(EM_VAL handle, const char* methodName, Args&&... args) {
                 auto caller = Signature<ReturnType, Args...>::get_method_caller();
 
                 WireTypePack<Args...> argv(std::forward<Args>(args)...);
+                if (!NeedsResultDestructors<ReturnType>::value) {
+                    return fromGenericWireType<ReturnType>(_emval_call_method(
+                        caller,
+                        handle,
+                        methodName,
+                        nullptr,
+                        argv));
+                }
                 EM_DESTRUCTORS destructors;
                 EM_GENERIC_WIRE_TYPE result = _emval_call_method(
                     caller,
@@ -261,12 +280,79 @@ namespace emscripten {
                     argv);
             }
         };
+
+        // The handles of vals that were destroyed while a val_scope was
+        // active, to be released together when it ends.
+        struct DeferredReleases {
+            enum { CAPACITY = 256 };
+
+            unsigned scopes;
+            unsigned count;
+            EM_VAL handles[CAPACITY];
+
+            void flush() {
+                if (count) {
+                    _emval_decref_all(handles, count);
+                    count = 0;
+                }
+            }
+        };
+
+        inline DeferredReleases& deferredReleases() {
+            static DeferredReleases releases;
+            return releases;
+        }
+
+        inline void releaseHandle(EM_VAL handle) {
+            // undefined, null, true and false are not reference counted,
+            // and neither is the 0 of a moved-from val.
+            if (reinterpret_cast<uintptr_t>(handle) <= _EMVAL_FALSE) {
+                return;
+            }
+            DeferredReleases& releases = deferredReleases();
+            if (!releases.scopes) {
+                _emval_decref(handle);
+                return;
+            }
+            if (releases.count == DeferredReleases::CAPACITY) {
+                releases.flush();
+            }
+            releases.handles[releases.count++] = handle;
+        }
     }
 
 #define EMSCRIPTEN_SYMBOL(name)                                         \
     static const char name##_symbol[] = #name;                          \
     static const ::emscripten::internal::symbol_registrar<name##_symbol> name##_registrar
 
+    // A property or method name that is registered with JavaScript once, so
+    // that using it as a key to val::operator[], val::set or val::call looks
+    // up the JavaScript string instead of decoding the C string each time,
+    // and a property access is one call into JavaScript instead of three.
+    // The name must stay valid as long as the key is used, as a string
+    // literal does. Keys are usually static, see EMSCRIPTEN_KEY.
+    class val_key {
+    public:
+        explicit val_key(const char* name)
+            : name(name)
+        {
+            internal::_emval_register_symbol(name);
+        }
+
+        const char* const name;
+    };
+
+// The val_key of a string literal, created the first time the expression is
+// evaluated:
+//
+//   unsigned length = array[EMSCRIPTEN_KEY("length")].as<unsigned>();
+//   context.call<void>(EMSCRIPTEN_KEY("drawArrays"), mode, first, count);
+#define EMSCRIPTEN_KEY(name)                                            \
+    ([]() -> const ::emscripten::val_key& {                             \
+        static const ::emscripten::val_key key(name);                   \
+        return key;                                                     \
+    }())
+
     class val {
     public:
         // missing operators:
@@ -342,11 +428,11 @@ namespace emscripten {
         }
 
         ~val() {
-            internal::_emval_decref(handle);
+            internal::releaseHandle(handle);
         }
 
         val& operator=(val&& v) {
-            internal::_emval_decref(handle);
+            internal::releaseHandle(handle);
             handle = v.handle;
             v.handle = 0;
             return *this;
@@ -354,7 +440,7 @@ namespace emscripten {
 
         val& operator=(const val& v) {
             internal::_emval_incref(v.handle);
-            internal::_emval_decref(handle);
+            internal::releaseHandle(handle);
             handle = v.handle;
             return *this;
         }
@@ -397,6 +483,19 @@ namespace emscripten {
             return val(internal::_emval_get_property(handle, val(key).handle));
         }
 
+        val operator[](const val_key& key) const {
+            return val(internal::_emval_get_symbol_property(handle, key.name));
+        }
+
+        void set(const val_key& key, const val& v) {
+            internal::_emval_set_symbol_property(handle, key.name, v.handle);
+        }
+
+        template<typename V>
+        void set(const val_key& key, const V& value) {
+            internal::_emval_set_symbol_property(handle, key.name, val(value).handle);
+        }
+
         template<typename K>
         void set(const K& key, const val& v) {
             internal::_emval_set_property(handle, val(key).handle, v.handle);
@@ -419,6 +518,13 @@ namespace emscripten {
             return MethodCaller<ReturnValue, Args...>::call(handle, name, std::forward<Args>(args)...);
         }
 
+        template<typename ReturnValue, typename... Args>
+        ReturnValue call(const val_key& name, Args&&... args) const {
+            using namespace internal;
+
+            return MethodCaller<ReturnValue, Args...>::call(handle, name.name, std::forward<Args>(args)...);
+        }
+
         template<typename T, typename ...Policies>
         T as(Policies...) const {
             using namespace internal;
@@ -426,6 +532,12 @@ namespace emscripten {
             typedef BindingType<T> BT;
             typename WithPolicies<Policies...>::template ArgTypeList<T> targetType;
 
+            if (!NeedsResultDestructors<T>::value) {
+                return fromGenericWireType<T>(_emval_as(
+                    handle,
+                    targetType.getTypes()[0],
+                    nullptr));
+            }
             EM_DESTRUCTORS destructors;
             EM_GENERIC_WIRE_TYPE result = _emval_as(
                 handle,
@@ -479,6 +591,28 @@ namespace emscripten {
         friend struct internal::BindingType<val>;
     };
 
+    // While a val_scope is alive, vals that are destroyed do not release
+    // their JavaScript values right away: the values are released together
+    // when the scope ends, in one call into JavaScript instead of one for
+    // each val. Put one around code that creates many temporary vals, such
+    // as the body of a loop. Scopes nest. They are not thread-safe: while
+    // one is alive, vals must only be used on the thread that created it.
+    class val_scope {
+    public:
+        val_scope() {
+            ++internal::deferredReleases().scopes;
+        }
+
+        ~val_scope() {
+            internal::DeferredReleases& releases = internal::deferredReleases();
+            releases.flush();
+            --releases.scopes;
+        }
+
+        val_scope(const val_scope&) = delete;
+        val_scope& operator=(const val_scope&) = delete;
+    };
+
     namespace internal {
         template<>
         struct BindingType<val> {
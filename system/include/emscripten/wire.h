@@ -15,6 +15,7 @@
 #include <cstdlib>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #define EMSCRIPTEN_ALWAYS_INLINE __attribute__((always_inline))
 
@@ -294,6 +295,28 @@ namespace emscripten {
             }
         };
 
+        // A std::string_view that is passed to JavaScript must refer to
+        // memory that outlives the call, since JavaScript reads the string
+        // from it. One that is passed from JavaScript refers to a copy of
+        // the string that is freed when the call returns, so it is for
+        // parameters, not for keeping.
+        template<>
+        struct BindingType<std::string_view> {
+            typedef struct {
+                size_t length;
+                const char* data;
+            }* WireType;
+            static WireType toWireType(std::string_view v) {
+                WireType wt = (WireType)malloc(sizeof(*wt));
+                wt->length = v.length();
+                wt->data = v.data();
+                return wt;
+            }
+            static std::string_view fromWireType(WireType v) {
+                return std::string_view(v->data, v->length);
+            }
+        };
+
         template<>
         struct BindingType<std::wstring> {
             typedef struct {
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <emscripten.h>
 
+#include "proc_address.h"
+
 #include <AL/alc.h>
 #include <AL/al.h>
 
@@ -15,34 +17,45 @@ const ALCchar *emscripten_alcGetStringiSOFT(ALCdevice *device, ALCenum paramName
 ALCboolean emscripten_alcResetDeviceSOFT(ALCdevice *device, const ALCint *attrList);
 
 
-void* emscripten_GetAlcProcAddress(ALCchar *name) {
+static const proc_address_entry alc_procs[] = {
   // Base API
-  if (!strcmp(name, "alcCreateContext")) { return alcCreateContext; }
-  else if (!strcmp(name, "alcMakeContextCurrent")) { return alcMakeContextCurrent; }
-  else if (!strcmp(name, "alcProcessContext")) { return alcProcessContext; }
-  else if (!strcmp(name, "alcSuspendContext")) { return alcSuspendContext; }
-  else if (!strcmp(name, "alcDestroyContext")) { return alcDestroyContext; }
-  else if (!strcmp(name, "alcGetCurrentContext")) { return alcGetCurrentContext; }
-  else if (!strcmp(name, "alcGetContextsDevice")) { return alcGetContextsDevice; }
-  else if (!strcmp(name, "alcOpenDevice")) { return alcOpenDevice; }
-  else if (!strcmp(name, "alcCloseDevice")) { return alcCloseDevice; }
-  else if (!strcmp(name, "alcGetError")) { return alcGetError; }
-  else if (!strcmp(name, "alcIsExtensionPresent")) { return alcIsExtensionPresent; }
-  else if (!strcmp(name, "alcGetProcAddress")) { return alcGetProcAddress; }
-  else if (!strcmp(name, "alcGetEnumValue")) { return alcGetEnumValue; }
-  else if (!strcmp(name, "alcGetString")) { return alcGetString; }
-  else if (!strcmp(name, "alcGetIntegerv")) { return alcGetIntegerv; }
-  else if (!strcmp(name, "alcCaptureOpenDevice")) { return alcCaptureOpenDevice; }
-  else if (!strcmp(name, "alcCaptureCloseDevice")) { return alcCaptureCloseDevice; }
-  else if (!strcmp(name, "alcCaptureStart")) { return alcCaptureStart; }
-  else if (!strcmp(name, "alcCaptureStop")) { return alcCaptureStop; }
-  else if (!strcmp(name, "alcCaptureSamples")) { return alcCaptureSamples; }
+  { "alcCreateContext", alcCreateContext },
+  { "alcMakeContextCurrent", alcMakeContextCurrent },
+  { "alcProcessContext", alcProcessContext },
+  { "alcSuspendContext", alcSuspendContext },
+  { "alcDestroyContext", alcDestroyContext },
+  { "alcGetCurrentContext", alcGetCurrentContext },
+  { "alcGetContextsDevice", alcGetContextsDevice },
+  { "alcOpenDevice", alcOpenDevice },
+  { "alcCloseDevice", alcCloseDevice },
+  { "alcGetError", alcGetError },
+  { "alcIsExtensionPresent", alcIsExtensionPresent },
+  { "alcGetProcAddress", alcGetProcAddress },
+  { "alcGetEnumValue", alcGetEnumValue },
+  { "alcGetString", alcGetString },
+  { "alcGetIntegerv", alcGetIntegerv },
+  { "alcCaptureOpenDevice", alcCaptureOpenDevice },
+  { "alcCaptureCloseDevice", alcCaptureCloseDevice },
+  { "alcCaptureStart", alcCaptureStart },
+  { "alcCaptureStop", alcCaptureStop },
+  { "alcCaptureSamples", alcCaptureSamples },
 
   // Extensions
-  else if (!strcmp(name, "alcDevicePauseSOFT")) { return emscripten_alcDevicePauseSOFT; }
-  else if (!strcmp(name, "alcDeviceResumeSOFT")) { return emscripten_alcDeviceResumeSOFT; }
-  else if (!strcmp(name, "alcGetStringiSOFT")) { return emscripten_alcGetStringiSOFT; }
-  else if (!strcmp(name, "alcResetDeviceSOFT")) { return emscripten_alcResetDeviceSOFT; }
+  { "alcDevicePauseSOFT", emscripten_alcDevicePauseSOFT },
+  { "alcDeviceResumeSOFT", emscripten_alcDeviceResumeSOFT },
+  { "alcGetStringiSOFT", emscripten_alcGetStringiSOFT },
+  { "alcResetDeviceSOFT", emscripten_alcResetDeviceSOFT },
+};
+
+static unsigned short alc_proc_slots[64];
+
+static proc_address_table alc_proc_table = {
+  alc_procs, sizeof(alc_procs) / sizeof(alc_procs[0]), alc_proc_slots, sizeof(alc_proc_slots) / sizeof(alc_proc_slots[0]), 0
+};
+
+void* emscripten_GetAlcProcAddress(ALCchar *name) {
+  void *func = proc_address_lookup(&alc_proc_table, name);
+  if (func) return func;
 
   EM_ASM_({
     Module.printErr("bad name in alcGetProcAddress: " + Pointer_stringify($0));
@@ -51,85 +64,94 @@ void* emscripten_GetAlcProcAddress(ALCchar *name) {
 }
 
 
-void* emscripten_GetAlProcAddress(ALchar *name) {
+static const proc_address_entry al_procs[] = {
   // Base API
-  if (!strcmp(name, "alDopplerFactor")) { return alDopplerFactor; }
-  else if (!strcmp(name, "alDopplerVelocity")) { return alDopplerVelocity; }
-  else if (!strcmp(name, "alSpeedOfSound")) { return alSpeedOfSound; }
-  else if (!strcmp(name, "alDistanceModel")) { return alDistanceModel; }
-  else if (!strcmp(name, "alEnable")) { return alEnable; }
-  else if (!strcmp(name, "alDisable")) { return alDisable; }
-  else if (!strcmp(name, "alIsEnabled")) { return alIsEnabled; }
-  else if (!strcmp(name, "alGetString")) { return alGetString; }
-  else if (!strcmp(name, "alGetBooleanv")) { return alGetBooleanv; }
-  else if (!strcmp(name, "alGetIntegerv")) { return alGetIntegerv; }
-  else if (!strcmp(name, "alGetFloatv")) { return alGetFloatv; }
-  else if (!strcmp(name, "alGetDoublev")) { return alGetDoublev; }
-  else if (!strcmp(name, "alGetBoolean")) { return alGetBoolean; }
-  else if (!strcmp(name, "alGetInteger")) { return alGetInteger; }
-  else if (!strcmp(name, "alGetFloat")) { return alGetFloat; }
-  else if (!strcmp(name, "alGetDouble")) { return alGetDouble; }
-  else if (!strcmp(name, "alGetError")) { return alGetError; }
-  else if (!strcmp(name, "alIsExtensionPresent")) { return alIsExtensionPresent; }
-  else if (!strcmp(name, "alGetProcAddress")) { return alGetProcAddress; }
-  else if (!strcmp(name, "alGetEnumValue")) { return alGetEnumValue; }
-  else if (!strcmp(name, "alListenerf")) { return alListenerf; }
-  else if (!strcmp(name, "alListener3f")) { return alListener3f; }
-  else if (!strcmp(name, "alListenerfv")) { return alListenerfv; }
-  else if (!strcmp(name, "alListeneri")) { return alListeneri; }
-  else if (!strcmp(name, "alListener3i")) { return alListener3i; }
-  else if (!strcmp(name, "alListeneriv")) { return alListeneriv; }
-  else if (!strcmp(name, "alGetListenerf")) { return alGetListenerf; }
-  else if (!strcmp(name, "alGetListener3f")) { return alGetListener3f; }
-  else if (!strcmp(name, "alGetListenerfv")) { return alGetListenerfv; }
-  else if (!strcmp(name, "alGetListeneri")) { return alGetListeneri; }
-  else if (!strcmp(name, "alGetListener3i")) { return alGetListener3i; }
-  else if (!strcmp(name, "alGetListeneriv")) { return alGetListeneriv; }
-  else if (!strcmp(name, "alGenSources")) { return alGenSources; }
-  else if (!strcmp(name, "alDeleteSources")) { return alDeleteSources; }
-  else if (!strcmp(name, "alIsSource")) { return alIsSource; }
-  else if (!strcmp(name, "alIsSource")) { return alIsSource; }
-  else if (!strcmp(name, "alSourcef")) { return alSourcef; }
-  else if (!strcmp(name, "alSource3f")) { return alSource3f; }
-  else if (!strcmp(name, "alSourcefv")) { return alSourcefv; }
-  else if (!strcmp(name, "alSourcei")) { return alSourcei; }
-  else if (!strcmp(name, "alSource3i")) { return alSource3i; }
-  else if (!strcmp(name, "alSourceiv")) { return alSourceiv; }
-  else if (!strcmp(name, "alGetSourcef")) { return alGetSourcef; }
-  else if (!strcmp(name, "alGetSource3f")) { return alGetSource3f; }
-  else if (!strcmp(name, "alGetSourcefv")) { return alGetSourcefv; }
-  else if (!strcmp(name, "alGetSourcei")) { return alGetSourcei; }
-  else if (!strcmp(name, "alGetSource3i")) { return alGetSource3i; }
-  else if (!strcmp(name, "alGetSourceiv")) { return alGetSourceiv; }
-  else if (!strcmp(name, "alSourcePlayv")) { return alSourcePlayv; }
-  else if (!strcmp(name, "alSourceStopv")) { return alSourceStopv; }
-  else if (!strcmp(name, "alSourceRewindv")) { return alSourceRewindv; }
-  else if (!strcmp(name, "alSourcePausev")) { return alSourcePausev; }
-  else if (!strcmp(name, "alSourcePlay")) { return alSourcePlay; }
-  else if (!strcmp(name, "alSourceStop")) { return alSourceStop; }
-  else if (!strcmp(name, "alSourceRewind")) { return alSourceRewind; }
-  else if (!strcmp(name, "alSourcePause")) { return alSourcePause; }
-  else if (!strcmp(name, "alSourceQueueBuffers")) { return alSourceQueueBuffers; }
-  else if (!strcmp(name, "alSourceUnqueueBuffers")) { return alSourceUnqueueBuffers; }
-  else if (!strcmp(name, "alGenBuffers")) { return alGenBuffers; }
-  else if (!strcmp(name, "alDeleteBuffers")) { return alDeleteBuffers; }
-  else if (!strcmp(name, "alIsBuffer")) { return alIsBuffer; }
-  else if (!strcmp(name, "alBufferData")) { return alBufferData; }
-  else if (!strcmp(name, "alBufferData")) { return alBufferData; }
-  else if (!strcmp(name, "alBufferf")) { return alBufferf; }
-  else if (!strcmp(name, "alBuffer3f")) { return alBuffer3f; }
-  else if (!strcmp(name, "alBufferfv")) { return alBufferfv; }
-  else if (!strcmp(name, "alBufferi")) { return alBufferi; }
-  else if (!strcmp(name, "alBuffer3i")) { return alBuffer3i; }
-  else if (!strcmp(name, "alBufferiv")) { return alBufferiv; }
-  else if (!strcmp(name, "alGetBufferf")) { return alGetBufferf; }
-  else if (!strcmp(name, "alGetBuffer3f")) { return alGetBuffer3f; }
-  else if (!strcmp(name, "alGetBufferfv")) { return alGetBufferfv; }
-  else if (!strcmp(name, "alGetBufferi")) { return alGetBufferi; }
-  else if (!strcmp(name, "alGetBuffer3i")) { return alGetBuffer3i; }
-  else if (!strcmp(name, "alGetBufferiv")) { return alGetBufferiv; }
+  { "alDopplerFactor", alDopplerFactor },
+  { "alDopplerVelocity", alDopplerVelocity },
+  { "alSpeedOfSound", alSpeedOfSound },
+  { "alDistanceModel", alDistanceModel },
+  { "alEnable", alEnable },
+  { "alDisable", alDisable },
+  { "alIsEnabled", alIsEnabled },
+  { "alGetString", alGetString },
+  { "alGetBooleanv", alGetBooleanv },
+  { "alGetIntegerv", alGetIntegerv },
+  { "alGetFloatv", alGetFloatv },
+  { "alGetDoublev", alGetDoublev },
+  { "alGetBoolean", alGetBoolean },
+  { "alGetInteger", alGetInteger },
+  { "alGetFloat", alGetFloat },
+  { "alGetDouble", alGetDouble },
+  { "alGetError", alGetError },
+  { "alIsExtensionPresent", alIsExtensionPresent },
+  { "alGetProcAddress", alGetProcAddress },
+  { "alGetEnumValue", alGetEnumValue },
+  { "alListenerf", alListenerf },
+  { "alListener3f", alListener3f },
+  { "alListenerfv", alListenerfv },
+  { "alListeneri", alListeneri },
+  { "alListener3i", alListener3i },
+  { "alListeneriv", alListeneriv },
+  { "alGetListenerf", alGetListenerf },
+  { "alGetListener3f", alGetListener3f },
+  { "alGetListenerfv", alGetListenerfv },
+  { "alGetListeneri", alGetListeneri },
+  { "alGetListener3i", alGetListener3i },
+  { "alGetListeneriv", alGetListeneriv },
+  { "alGenSources", alGenSources },
+  { "alDeleteSources", alDeleteSources },
+  { "alIsSource", alIsSource },
+  { "alIsSource", alIsSource },
+  { "alSourcef", alSourcef },
+  { "alSource3f", alSource3f },
+  { "alSourcefv", alSourcefv },
+  { "alSourcei", alSourcei },
+  { "alSource3i", alSource3i },
+  { "alSourceiv", alSourceiv },
+  { "alGetSourcef", alGetSourcef },
+  { "alGetSource3f", alGetSource3f },
+  { "alGetSourcefv", alGetSourcefv },
+  { "alGetSourcei", alGetSourcei },
+  { "alGetSource3i", alGetSource3i },
+  { "alGetSourceiv", alGetSourceiv },
+  { "alSourcePlayv", alSourcePlayv },
+  { "alSourceStopv", alSourceStopv },
+  { "alSourceRewindv", alSourceRewindv },
+  { "alSourcePausev", alSourcePausev },
+  { "alSourcePlay", alSourcePlay },
+  { "alSourceStop", alSourceStop },
+  { "alSourceRewind", alSourceRewind },
+  { "alSourcePause", alSourcePause },
+  { "alSourceQueueBuffers", alSourceQueueBuffers },
+  { "alSourceUnqueueBuffers", alSourceUnqueueBuffers },
+  { "alGenBuffers", alGenBuffers },
+  { "alDeleteBuffers", alDeleteBuffers },
+  { "alIsBuffer", alIsBuffer },
+  { "alBufferData", alBufferData },
+  { "alBufferData", alBufferData },
+  { "alBufferf", alBufferf },
+  { "alBuffer3f", alBuffer3f },
+  { "alBufferfv", alBufferfv },
+  { "alBufferi", alBufferi },
+  { "alBuffer3i", alBuffer3i },
+  { "alBufferiv", alBufferiv },
+  { "alGetBufferf", alGetBufferf },
+  { "alGetBuffer3f", alGetBuffer3f },
+  { "alGetBufferfv", alGetBufferfv },
+  { "alGetBufferi", alGetBufferi },
+  { "alGetBuffer3i", alGetBuffer3i },
+  { "alGetBufferiv", alGetBufferiv },
+};
 
-  // Extensions
+static unsigned short al_proc_slots[256];
+
+static proc_address_table al_proc_table = {
+  al_procs, sizeof(al_procs) / sizeof(al_procs[0]), al_proc_slots, sizeof(al_proc_slots) / sizeof(al_proc_slots[0]), 0
+};
+
+void* emscripten_GetAlProcAddress(ALchar *name) {
+  void *func = proc_address_lookup(&al_proc_table, name);
+  if (func) return func;
 
   EM_ASM_({
     Module.printErr("bad name in alGetProcAddress: " + Pointer_stringify($0));
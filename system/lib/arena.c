@@ -0,0 +1,165 @@
+/*
+   Arenas and regions, see emscripten/arena.h
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <emscripten/arena.h>
+#include <emscripten/trace.h>
+
+#ifndef ARENA_NO_REGIONS
+// The mspace API of dlmalloc.c
+typedef void* mspace;
+mspace create_mspace_with_base(void* base, size_t capacity, int locked);
+size_t destroy_mspace(mspace msp);
+size_t mspace_set_footprint_limit(mspace msp, size_t bytes);
+void* mspace_malloc(mspace msp, size_t bytes);
+void* mspace_calloc(mspace msp, size_t n_elements, size_t elem_size);
+void* mspace_realloc(mspace msp, void* oldmem, size_t bytes);
+void* mspace_memalign(mspace msp, size_t alignment, size_t bytes);
+void mspace_free(mspace msp, void* mem);
+#endif
+
+#define ARENA_ALIGNMENT 8
+
+struct em_arena
+{
+	uintptr_t base;
+	size_t capacity;
+	// The number of bytes handed out from base. Bumped with a compare-and-swap in pthreads builds, so that several
+	// threads can allocate at the same time.
+	volatile size_t used;
+};
+
+em_arena *emscripten_arena_create(size_t capacity)
+{
+	size_t headerSize = (sizeof(em_arena) + 15) & ~15;
+	if (capacity > SIZE_MAX - headerSize) return 0;
+	em_arena *arena = (em_arena*)malloc(headerSize + capacity);
+	if (!arena) return 0;
+	arena->base = (uintptr_t)arena + headerSize;
+	arena->capacity = capacity;
+	arena->used = 0;
+	emscripten_trace_annotate_address_type(arena, "emscripten_arena");
+	return arena;
+}
+
+void emscripten_arena_destroy(em_arena *arena)
+{
+	free(arena);
+}
+
+void *emscripten_arena_alloc_aligned(em_arena *arena, size_t bytes, size_t alignment)
+{
+	if (alignment < ARENA_ALIGNMENT) alignment = ARENA_ALIGNMENT;
+	size_t used, start;
+#ifdef __EMSCRIPTEN_PTHREADS__
+	do
+	{
+#endif
+		used = arena->used;
+		start = ((arena->base + used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - arena->base;
+		if (start < used || start > arena->capacity || bytes > arena->capacity - start) return 0;
+#ifdef __EMSCRIPTEN_PTHREADS__
+	} while (__sync_val_compare_and_swap(&arena->used, used, start + bytes) != used);
+#else
+	arena->used = start + bytes;
+#endif
+	return (void*)(arena->base + start);
+}
+
+void *emscripten_arena_alloc(em_arena *arena, size_t bytes)
+{
+	return emscripten_arena_alloc_aligned(arena, bytes, ARENA_ALIGNMENT);
+}
+
+void emscripten_arena_reset(em_arena *arena)
+{
+	// Report how much of the arena was used, since its allocations do not show up in traces one by one.
+	emscripten_trace_associate_storage_size(arena, arena->used);
+	arena->used = 0;
+}
+
+size_t emscripten_arena_bytes_used(em_arena *arena)
+{
+	return arena->used;
+}
+
+#ifndef ARENA_NO_REGIONS
+
+struct em_region
+{
+	mspace space;
+};
+
+em_region *emscripten_region_create(size_t capacity)
+{
+	size_t headerSize = (sizeof(em_region) + 15) & ~15;
+	if (capacity > SIZE_MAX - headerSize) return 0;
+	em_region *region = (em_region*)malloc(headerSize + capacity);
+	if (!region) return 0;
+#ifdef __EMSCRIPTEN_PTHREADS__
+	int locked = 1;
+#else
+	int locked = 0;
+#endif
+	region->space = create_mspace_with_base((char*)region + headerSize, capacity, locked);
+	if (!region->space)
+	{
+		free(region);
+		return 0;
+	}
+	// Keep the region in its block: without a limit, dlmalloc would take more memory for it from sbrk() when it is full,
+	// and that memory would not be freed with the region.
+	mspace_set_footprint_limit(region->space, capacity);
+	emscripten_trace_annotate_address_type(region, "emscripten_region");
+	return region;
+}
+
+void emscripten_region_destroy(em_region *region)
+{
+	destroy_mspace(region->space);
+	free(region);
+}
+
+void *emscripten_region_malloc(em_region *region, size_t bytes)
+{
+	return mspace_malloc(region->space, bytes);
+}
+
+void *emscripten_region_calloc(em_region *region, size_t n_elements, size_t elem_size)
+{
+	return mspace_calloc(region->space, n_elements, elem_size);
+}
+
+void *emscripten_region_realloc(em_region *region, void *ptr, size_t bytes)
+{
+	return mspace_realloc(region->space, ptr, bytes);
+}
+
+void *emscripten_region_memalign(em_region *region, size_t alignment, size_t bytes)
+{
+	return mspace_memalign(region->space, alignment, bytes);
+}
+
+void emscripten_region_free(em_region *region, void *ptr)
+{
+	mspace_free(region->space, ptr);
+}
+
+#else
+
+em_region *emscripten_region_create(size_t capacity)
+{
+	return 0;
+}
+
+void emscripten_region_destroy(em_region *region) {}
+void *emscripten_region_malloc(em_region *region, size_t bytes) { return 0; }
+void *emscripten_region_calloc(em_region *region, size_t n_elements, size_t elem_size) { return 0; }
+void *emscripten_region_realloc(em_region *region, void *ptr, size_t bytes) { return 0; }
+void *emscripten_region_memalign(em_region *region, size_t alignment, size_t bytes) { return 0; }
+void emscripten_region_free(em_region *region, void *ptr) {}
+
+#endif
@@ -0,0 +1,278 @@
+/*
+   A small malloc/free with segregated power-of-two size classes, for -s COMPACT_MALLOC=1
+
+   Every block is a power of two of at least 16 bytes, and starts with an 8-byte header that stores its size class.
+   Free blocks are kept in one singly linked list per size class, so malloc pops from a list and free pushes to one,
+   both in constant time. When a list is empty, a new block is carved out of memory taken from sbrk(). Blocks are never
+   split or coalesced, and memory is never given back to sbrk(); in exchange the allocator is a fraction of the size
+   of dlmalloc, and has no bins to search. Allocations waste up to half of their block to rounding, so prefer dlmalloc
+   for code that allocates many large, odd-sized blocks.
+
+   Not thread-safe: it is only built for builds without pthreads.
+*/
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+#define EXPORT __attribute__((__weak__, __visibility__("default")))
+
+// Size class k holds blocks of (1 << (k + MIN_BLOCK_SHIFT)) bytes, header included.
+#define MIN_BLOCK_SHIFT 4
+#define NUM_CLASSES (32 - MIN_BLOCK_SHIFT)
+
+// The least amount of memory that is taken from sbrk() at once.
+#define SBRK_CHUNK_SIZE (64 * 1024)
+
+typedef struct block_header
+{
+	uint32_t sizeClass;
+	// For blocks of memalign() whose payload was moved forward to align it, the distance in bytes from the header at
+	// the start of the block to this header. 0 otherwise.
+	uint32_t offset;
+} block_header;
+
+typedef struct free_block
+{
+	block_header header;
+	struct free_block *next;
+} free_block;
+
+static free_block *freeLists[NUM_CLASSES];
+
+// The number of allocated blocks in each size class, and the bytes taken from sbrk(), for emscripten_get_heap_stats().
+static size_t inUseCounts[NUM_CLASSES];
+static size_t footprint = 0;
+
+// The part of the memory taken from sbrk() that has not been carved into blocks yet.
+static uintptr_t bumpPtr = 0;
+static uintptr_t bumpEnd = 0;
+
+static inline uint32_t block_size(int sizeClass)
+{
+	return 1u << (sizeClass + MIN_BLOCK_SHIFT);
+}
+
+// Returns the size class of the smallest block that can hold bytes bytes after its header, or -1 if none can.
+static inline int class_for(size_t bytes)
+{
+	if (bytes > (1u << 31) - sizeof(block_header)) return -1;
+	uint32_t total = bytes + sizeof(block_header);
+	if (total <= (1u << MIN_BLOCK_SHIFT)) return 0;
+	return 32 - __builtin_clz(total - 1) - MIN_BLOCK_SHIFT;
+}
+
+static inline void push_free(free_block *b, int sizeClass)
+{
+	b->header.sizeClass = sizeClass;
+	b->header.offset = 0;
+	b->next = freeLists[sizeClass];
+	freeLists[sizeClass] = b;
+}
+
+// Takes at least numBytes more bytes from sbrk() for carving. Returns 0 if there is no more memory.
+static int grow(uint32_t numBytes)
+{
+	if (numBytes < SBRK_CHUNK_SIZE) numBytes = SBRK_CHUNK_SIZE;
+	uintptr_t start = (uintptr_t)sbrk(0);
+	// Keep blocks 16-byte aligned, also if something else moved the break to an odd address.
+	uint32_t pad = (16 - (start & 15)) & 15;
+	if ((intptr_t)sbrk(pad + numBytes) == -1) return 0;
+	footprint += pad + numBytes;
+	start += pad;
+	if (start != bumpEnd)
+	{
+		// The new memory does not continue the old, so give the rest of the old to the free lists as the largest
+		// blocks that fit. It is always a multiple of the smallest block size.
+		while (bumpEnd - bumpPtr >= (1u << MIN_BLOCK_SHIFT))
+		{
+			int sizeClass = 31 - __builtin_clz(bumpEnd - bumpPtr) - MIN_BLOCK_SHIFT;
+			push_free((free_block*)bumpPtr, sizeClass);
+			bumpPtr += block_size(sizeClass);
+		}
+		bumpPtr = start;
+	}
+	bumpEnd = start + numBytes;
+	return 1;
+}
+
+EXPORT void *malloc(size_t bytes)
+{
+	int sizeClass = class_for(bytes);
+	if (sizeClass < 0)
+	{
+		errno = ENOMEM;
+		return 0;
+	}
+	free_block *b = freeLists[sizeClass];
+	if (b)
+	{
+		freeLists[sizeClass] = b->next;
+		++inUseCounts[sizeClass];
+		return (block_header*)b + 1;
+	}
+
+	uint32_t size = block_size(sizeClass);
+	if (bumpEnd - bumpPtr < size && !grow(size))
+	{
+		errno = ENOMEM;
+		return 0;
+	}
+	block_header *h = (block_header*)bumpPtr;
+	bumpPtr += size;
+	h->sizeClass = sizeClass;
+	h->offset = 0;
+	++inUseCounts[sizeClass];
+	return h + 1;
+}
+
+EXPORT void free(void *ptr)
+{
+	if (!ptr) return;
+	block_header *h = (block_header*)ptr - 1;
+	int sizeClass = h->sizeClass;
+	--inUseCounts[sizeClass];
+	push_free((free_block*)((uintptr_t)h - h->offset), sizeClass);
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+	if (!ptr) return 0;
+	block_header *h = (block_header*)ptr - 1;
+	return block_size(h->sizeClass) - sizeof(block_header) - h->offset;
+}
+
+EXPORT void *calloc(size_t n_elements, size_t elem_size)
+{
+	size_t bytes = n_elements * elem_size;
+	if (n_elements != 0 && bytes / n_elements != elem_size)
+	{
+		errno = ENOMEM;
+		return 0;
+	}
+	void *ptr = malloc(bytes);
+	if (ptr) memset(ptr, 0, bytes);
+	return ptr;
+}
+
+EXPORT void *realloc(void *ptr, size_t bytes)
+{
+	if (!ptr) return malloc(bytes);
+	if (bytes == 0)
+	{
+		free(ptr);
+		return 0;
+	}
+	size_t usable = malloc_usable_size(ptr);
+	if (bytes <= usable) return ptr;
+	void *newPtr = malloc(bytes);
+	if (!newPtr) return 0;
+	memcpy(newPtr, ptr, usable);
+	free(ptr);
+	return newPtr;
+}
+
+EXPORT void *memalign(size_t alignment, size_t bytes)
+{
+	if (alignment <= sizeof(block_header)) return malloc(bytes);
+	if (alignment & (alignment - 1))
+	{
+		errno = EINVAL;
+		return 0;
+	}
+	if (bytes > SIZE_MAX - alignment)
+	{
+		errno = ENOMEM;
+		return 0;
+	}
+	uintptr_t ptr = (uintptr_t)malloc(bytes + alignment);
+	if (!ptr) return 0;
+	uintptr_t aligned = (ptr + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (aligned != ptr)
+	{
+		// Payloads are 8-byte aligned, so there is room for a second header in front of the aligned payload.
+		block_header *h = (block_header*)aligned - 1;
+		h->sizeClass = ((block_header*)ptr - 1)->sizeClass;
+		h->offset = aligned - ptr;
+	}
+	return (void*)aligned;
+}
+
+EXPORT int posix_memalign(void **pp, size_t alignment, size_t bytes)
+{
+	if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)))
+		return EINVAL;
+	void *ptr = memalign(alignment, bytes);
+	if (!ptr) return ENOMEM;
+	*pp = ptr;
+	return 0;
+}
+
+// Memory is never given back to sbrk(), see above.
+EXPORT int malloc_trim(size_t pad)
+{
+	return 0;
+}
+
+EXPORT void *valloc(size_t bytes)
+{
+	return memalign(getpagesize(), bytes);
+}
+
+// Blocks are not split, so the batch cannot be carved out of one block; allocate the elements one by one instead.
+EXPORT int emscripten_malloc_aligned_batch(size_t count, size_t size, size_t alignment, void **ptrs)
+{
+	if (alignment & (alignment - 1)) return EINVAL;
+	for(size_t i = 0; i < count; ++i)
+	{
+		ptrs[i] = memalign(alignment, size);
+		if (!ptrs[i])
+		{
+			while (i > 0) free(ptrs[--i]);
+			return ENOMEM;
+		}
+	}
+	return 0;
+}
+
+// The malloc part of emscripten_get_heap_stats() in library.js.
+void emscripten_malloc_heap_stats(emscripten_heap_stats *stats)
+{
+	size_t heapFields = offsetof(emscripten_heap_stats, malloc_footprint);
+	memset((char*)stats + heapFields, 0, sizeof(*stats) - heapFields);
+	stats->malloc_footprint = footprint;
+	for(int c = 0; c < NUM_CLASSES; ++c)
+	{
+		uint32_t size = block_size(c);
+		int k = c + MIN_BLOCK_SHIFT;
+		stats->in_use_blocks += inUseCounts[c];
+		stats->in_use_bytes += inUseCounts[c] * size;
+		stats->in_use_blocks_by_size[k] = inUseCounts[c];
+		for(free_block *b = freeLists[c]; b; b = b->next)
+		{
+			++stats->free_blocks;
+			stats->free_bytes += size;
+			++stats->free_blocks_by_size[k];
+			stats->largest_free_block = size;
+		}
+	}
+	// The memory that was not carved into blocks yet is free as well.
+	size_t uncarved = bumpEnd - bumpPtr;
+	if (uncarved)
+	{
+		++stats->free_blocks;
+		stats->free_bytes += uncarved;
+		++stats->free_blocks_by_size[31 - __builtin_clz(uncarved)];
+		if (uncarved > stats->largest_free_block) stats->largest_free_block = uncarved;
+	}
+	if (stats->free_bytes) stats->fragmentation = 1.0f - (float)stats->largest_free_block / stats->free_bytes;
+}
+
+// Like dlmalloc.c, export malloc and free under these names as well, so that applications that replace malloc and free
+// can call the originals.
+extern __typeof(malloc) emscripten_builtin_malloc __attribute__((weak, alias("malloc")));
+extern __typeof(free) emscripten_builtin_free __attribute__((weak, alias("free")));
@@ -4,15 +4,24 @@
 #define DLMALLOC_EXPORT __attribute__((__weak__, __visibility__("default")))
 /* mmap uses malloc, so malloc can't use mmap */
 #define HAVE_MMAP 0
-/* we can only grow the heap up anyhow, so don't try to trim */
-#define MORECORE_CANNOT_TRIM 1
+/* sbrk() can shrink the heap, but only trim when asked to with malloc_trim() or
+   emscripten_trim_heap(), since the JS side has to copy the heap to make it smaller */
+#define DEFAULT_TRIM_THRESHOLD MAX_SIZE_T
 #ifndef DLMALLOC_DEBUG
 /* dlmalloc has many checks, calls to abort() increase code size,
    leave them only in debug builds */
 #define ABORT __builtin_unreachable()
 #endif
-/* XXX Emscripten Tracing API. This defines away the code if tracing is disabled. */
+/* XXX Emscripten Tracing API and heap profiler. These define away the code if they are disabled. */
 #include <emscripten/trace.h>
+#include <emscripten/heap_profiler.h>
+/* For emscripten_heap_stats */
+#include <emscripten/emscripten.h>
+
+/* mspaces back the regions of emscripten/arena.h */
+#ifndef MSPACES
+#define MSPACES 1
+#endif
 
 /* Make malloc() and free() threadsafe by securing the memory allocations with pthread mutexes. */
 #if __EMSCRIPTEN_PTHREADS__
@@ -872,6 +881,8 @@ extern "C" {
 #define dlindependent_calloc   independent_calloc
 #define dlindependent_comalloc independent_comalloc
 #define dlbulk_free            bulk_free
+#define dlmalloc_aligned_batch emscripten_malloc_aligned_batch
+#define dlmalloc_heap_stats    emscripten_malloc_heap_stats
 #endif /* USE_DL_PREFIX */
     
     /*
@@ -3562,6 +3573,54 @@ static struct mallinfo internal_mallinfo(mstate m) {
 }
 #endif /* !NO_MALLINFO */
 
+#if __EMSCRIPTEN__
+static void add_heap_stats_block(size_t histogram[], size_t sz) {
+    histogram[31 - __builtin_clz(sz)]++;
+}
+
+/* The malloc part of emscripten_get_heap_stats(), like internal_mallinfo */
+static void internal_heap_stats(mstate m, emscripten_heap_stats* stats) {
+    ensure_initialization();
+    if (!PREACTION(m)) {
+        check_malloc_state(m);
+        if (is_initialized(m)) {
+            msegmentptr s = &m->seg;
+            stats->malloc_footprint = m->footprint;
+            if (m->topsize) { /* top is free, and can be split up */
+                stats->free_bytes = m->topsize;
+                stats->free_blocks = 1;
+                stats->largest_free_block = m->topsize;
+                add_heap_stats_block(stats->free_blocks_by_size, m->topsize);
+            }
+            while (s != 0) {
+                mchunkptr q = align_as_chunk(s->base);
+                while (segment_holds(s, q) &&
+                       q != m->top && q->head != FENCEPOST_HEAD) {
+                    size_t sz = chunksize(q);
+                    if (is_inuse(q)) {
+                        stats->in_use_bytes += sz;
+                        stats->in_use_blocks++;
+                        add_heap_stats_block(stats->in_use_blocks_by_size, sz);
+                    }
+                    else {
+                        stats->free_bytes += sz;
+                        stats->free_blocks++;
+                        if (sz > stats->largest_free_block)
+                            stats->largest_free_block = sz;
+                        add_heap_stats_block(stats->free_blocks_by_size, sz);
+                    }
+                    q = next_chunk(q);
+                }
+                s = s->next;
+            }
+        }
+        POSTACTION(m);
+    }
+    if (stats->free_bytes)
+        stats->fragmentation = 1.0f - (float)stats->largest_free_block / stats->free_bytes;
+}
+#endif /* __EMSCRIPTEN__ */
+
 #if !NO_MALLOC_STATS
 static void internal_malloc_stats(mstate m) {
     ensure_initialization();
@@ -4712,6 +4771,7 @@ void* dlmalloc(size_t bytes) {
 #if __EMSCRIPTEN__
         /* XXX Emscripten Tracing API. */
         emscripten_trace_record_allocation(mem, bytes);
+        emscripten_heap_profiler_record_allocation(mem, bytes);
 #endif
         return mem;
     }
@@ -4732,6 +4792,7 @@ void dlfree(void* mem) {
 #if __EMSCRIPTEN__
         /* XXX Emscripten Tracing API. */
         emscripten_trace_record_free(mem);
+        emscripten_heap_profiler_record_free(mem);
 #endif
         mchunkptr p  = mem2chunk(mem);
 #if FOOTERS
@@ -5013,12 +5074,15 @@ static void* internal_memalign(mstate m, size_t alignment, size_t bytes) {
  The opts arg has:
  bit 0 set if all elements are same size (using sizes[0])
  bit 1 set if elements should be zeroed
+ If alignment is larger than MALLOC_ALIGNMENT, all elements must be the
+ same size, and each starts at a multiple of alignment.
  */
 static void** ialloc(mstate m,
                      size_t n_elements,
                      size_t* sizes,
                      int opts,
-                     void* chunks[]) {
+                     void* chunks[],
+                     size_t alignment) {
     
     size_t    element_size;   /* chunksize of each element, if all same */
     size_t    contents_size;  /* total size of elements */
@@ -5051,6 +5115,10 @@ static void** ialloc(mstate m,
     /* compute total element size */
     if (opts & 0x1) { /* all-same-size */
         element_size = request2size(*sizes);
+        /* elements follow each other, so if the first one is aligned, a
+           multiple of alignment as chunk size keeps the others aligned */
+        if (alignment > MALLOC_ALIGNMENT)
+            element_size = (element_size + alignment - SIZE_T_ONE) & ~(alignment - SIZE_T_ONE);
         contents_size = n_elements * element_size;
     }
     else { /* add up all the sizes */
@@ -5069,7 +5137,10 @@ static void** ialloc(mstate m,
      */
     was_enabled = use_mmap(m);
     disable_mmap(m);
-    mem = internal_malloc(m, size - CHUNK_OVERHEAD);
+    if (alignment > MALLOC_ALIGNMENT)
+        mem = internal_memalign(m, alignment, size - CHUNK_OVERHEAD);
+    else
+        mem = internal_malloc(m, size - CHUNK_OVERHEAD);
     if (was_enabled)
         enable_mmap(m);
     if (mem == 0)
@@ -5095,7 +5166,8 @@ static void** ialloc(mstate m,
         remainder_size = contents_size;
     }
     
-    /* split out elements */
+    /* split out elements. set_inuse keeps the pinuse bit of the first
+       one, which is clear if memalign freed space in front of it */
     for (i = 0; ; ++i) {
         marray[i] = chunk2mem(p);
         if (i != n_elements-1) {
@@ -5104,11 +5176,11 @@ static void** ialloc(mstate m,
             else
                 size = request2size(sizes[i]);
             remainder_size -= size;
-            set_size_and_pinuse_of_inuse_chunk(m, p, size);
+            set_inuse(m, p, size);
             p = chunk_plus_offset(p, size);
         }
         else { /* the final element absorbs any overallocation slop */
-            set_size_and_pinuse_of_inuse_chunk(m, p, remainder_size);
+            set_inuse(m, p, remainder_size);
             break;
         }
     }
@@ -5259,6 +5331,12 @@ void* dlrealloc(void* oldmem, size_t bytes) {
             if (newp != 0) {
                 check_inuse_chunk(m, newp);
                 mem = chunk2mem(newp);
+#if __EMSCRIPTEN__
+                /* Resized in place, so the heap profiler sees it as a new
+                   allocation. Moves go through dlmalloc and dlfree. */
+                emscripten_heap_profiler_record_free(mem);
+                emscripten_heap_profiler_record_allocation(mem, bytes);
+#endif
             }
             else {
                 mem = internal_malloc(m, bytes);
@@ -5355,18 +5433,32 @@ void* dlpvalloc(size_t bytes) {
 void** dlindependent_calloc(size_t n_elements, size_t elem_size,
                             void* chunks[]) {
     size_t sz = elem_size; /* serves as 1-element array */
-    return ialloc(gm, n_elements, &sz, 3, chunks);
+    return ialloc(gm, n_elements, &sz, 3, chunks, 0);
 }
 
 void** dlindependent_comalloc(size_t n_elements, size_t sizes[],
                               void* chunks[]) {
-    return ialloc(gm, n_elements, sizes, 0, chunks);
+    return ialloc(gm, n_elements, sizes, 0, chunks, 0);
 }
 
 size_t dlbulk_free(void* array[], size_t nelem) {
     return internal_bulk_free(gm, array, nelem);
 }
 
+#if __EMSCRIPTEN__
+/* emscripten_malloc_aligned_batch(), see emscripten/emscripten.h */
+int dlmalloc_aligned_batch(size_t count, size_t size, size_t alignment, void* ptrs[]) {
+    if (alignment & (alignment - SIZE_T_ONE))
+        return EINVAL;
+    if (count == 0)
+        return 0;
+    if (size >= MAX_REQUEST || alignment >= MAX_REQUEST ||
+        count > (MAX_REQUEST - alignment) / (request2size(size) + alignment))
+        return ENOMEM;
+    return ialloc(gm, count, &size, 1, ptrs, alignment) ? 0 : ENOMEM;
+}
+#endif /* __EMSCRIPTEN__ */
+
 #if MALLOC_INSPECT_ALL
 void dlmalloc_inspect_all(void(*handler)(void *start,
                                          void *end,
@@ -5421,6 +5513,16 @@ struct mallinfo dlmallinfo(void) {
 }
 #endif /* NO_MALLINFO */
 
+#if __EMSCRIPTEN__
+/* The malloc part of emscripten_get_heap_stats() in library.js. stats has
+   the heap-level fields filled in already. */
+void dlmalloc_heap_stats(emscripten_heap_stats* stats) {
+    size_t heapFields = offsetof(emscripten_heap_stats, malloc_footprint);
+    memset((char*)stats + heapFields, 0, sizeof(*stats) - heapFields);
+    internal_heap_stats(gm, stats);
+}
+#endif /* __EMSCRIPTEN__ */
+
 #if !NO_MALLOC_STATS
 void dlmalloc_stats() {
     internal_malloc_stats(gm);
@@ -5878,7 +5980,7 @@ void** mspace_independent_calloc(mspace msp, size_t n_elements,
         USAGE_ERROR_ACTION(ms,ms);
         return 0;
     }
-    return ialloc(ms, n_elements, &sz, 3, chunks);
+    return ialloc(ms, n_elements, &sz, 3, chunks, 0);
 }
 
 void** mspace_independent_comalloc(mspace msp, size_t n_elements,
@@ -5888,7 +5990,7 @@ void** mspace_independent_comalloc(mspace msp, size_t n_elements,
         USAGE_ERROR_ACTION(ms,ms);
         return 0;
     }
-    return ialloc(ms, n_elements, sizes, 0, chunks);
+    return ialloc(ms, n_elements, sizes, 0, chunks, 0);
 }
 
 size_t mspace_bulk_free(mspace msp, void* array[], size_t nelem) {
@@ -6028,9 +6130,15 @@ int mspace_mallopt(int param_number, int value) {
 // and dlfree from this file.
 // This allows an easy mechanism for hooking into memory allocation.
 #if defined(__EMSCRIPTEN__) && !ONLY_MSPACES
+#ifdef USE_DL_PREFIX
+// With -s MALLOC_THREAD_CACHE=1, malloc and free are defined in thread_cache_malloc.c.
+extern __typeof(dlmalloc) emscripten_builtin_malloc __attribute__((weak, alias("dlmalloc")));
+extern __typeof(dlfree) emscripten_builtin_free __attribute__((weak, alias("dlfree")));
+#else
 extern __typeof(malloc) emscripten_builtin_malloc __attribute__((weak, alias("malloc")));
 extern __typeof(free) emscripten_builtin_free __attribute__((weak, alias("free")));
 #endif
+#endif
 
 /* -------------------- Alternative MORECORE functions ------------------- */
 
@@ -1,6 +1,8 @@
+#include <aio.h>
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <malloc.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -9,8 +11,10 @@
 #include <emscripten/emscripten.h>
 #include <emscripten/fetch.h>
 #include <math.h>
+#include <pthread.h>
 #include <libc/fcntl.h>
 #include <time.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <ctype.h>
 #include "syscall_arch.h"
@@ -20,16 +24,49 @@ extern "C" {
 // http://stackoverflow.com/questions/417142/what-is-the-maximum-length-of-a-url-in-different-browsers
 #define MAX_PATHNAME_LENGTH 2000
 
-#define INODE_TYPE uint32_t
+// With -s ASMFS_TRACE=1, the errors that syscalls return are logged to the console, and with -s ASMFS_TRACE=2, also every
+// syscall and change to the filesystem tree. Logging calls out to JS, so it is compiled out by default.
+#ifndef __EMSCRIPTEN_ASMFS_TRACE__
+#define __EMSCRIPTEN_ASMFS_TRACE__ 0
+#endif
+
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 2
+#define TRACE(...) EM_ASM(__VA_ARGS__)
+#else
+#define TRACE(...) ((void)0)
+#endif
+
+// Counts of the file operations, which are cheap enough to always keep, to diagnose I/O patterns without tracing.
+// See emscripten_asmfs_dump_stats().
+struct asmfs_stats
+{
+	uint32_t opens, closes, reads, writes, seeks, fetches, stores, errors;
+	uint64_t bytes_read, bytes_written, bytes_fetched, bytes_stored;
+};
+static asmfs_stats stats;
+#define COUNT(counter, n) __atomic_fetch_add(&stats.counter, (n), __ATOMIC_RELAXED)
+
+#define INODE_TYPE uint8_t
 #define INODE_FILE 1
 #define INODE_DIR  2
 
+struct inode_writeback;
+
+// Inodes are kept small, since there can be hundreds of thousands of them: names are interned in a pool (see
+// intern_inode_name()), and state that only some files need is allocated separately.
 struct inode
 {
-	char name[NAME_MAX+1]; // NAME_MAX actual bytes + one byte for null termination.
+	const char *name; // Name of the node in the name pool, which is never freed. Names never change once set.
+	pthread_rwlock_t lock; // Guards the contents of the file: size, chunks, url and fetch. Reads of the file share it, and whatever changes the contents or how they are stored holds it exclusively.
 	inode *parent; // ID of the parent node
-	inode *sibling; // ID of a sibling node (these form a singular linked list that specifies the content under a directory)
+	inode *sibling; // ID of a sibling node (these form a doubly linked list that specifies the content under a directory)
+	inode *prev_sibling; // ID of the previous sibling node, or 0 if this is the first child of the parent
 	inode *child; // ID of the first child node in a chain of children (the root of a linked list of inodes)
+	inode *hash_next; // ID of the next node in the same bucket of the parent's children hash table
+	inode **children; // Hash table of the child nodes by name, or 0 if this directory has only a few children
+	uint32_t children_table_size; // Number of buckets in the children hash table, a power of two
+	uint32_t num_children; // Number of child nodes
+	uint32_t name_hash; // Hash of the name, computed when the node is linked to its parent
 	uint32_t uid; // User ID of the owner
 	uint32_t gid; // Group ID of the owning group
 	uint32_t mode; // r/w/x modes
@@ -37,12 +74,30 @@ struct inode
 	time_t mtime; // Time when the content was last modified
 	time_t atime; // Time when the content was last accessed
 	size_t size; // Size of the file in bytes
-	size_t capacity; // Amount of bytes allocated to pointer data
-	uint8_t *data; // The actual file contents.
+	uint8_t **chunks; // The file contents written to this inode, in chunks of FILE_CHUNK_SIZE bytes. Chunks that have not been written to are 0, and read from the fetched data, or as zeroes.
+	size_t num_chunks; // Number of entries in the chunks array
+	char *url; // URI-encoded path of the file on the server, if the rest of its contents are downloaded with Range requests as they are read, or 0
+	const uint8_t *preloaded_data; // Contents of the file in a preloaded package, which the file does not own, or 0
+	size_t preloaded_size; // Number of bytes at preloaded_data
+	emscripten_fetch_t *fetch;
+	inode_writeback *writeback; // State of storing the file to IndexedDB, or 0 if it is not stored
+	uint32_t num_open_fds; // Number of file descriptors that are open to the file. The downloaded data of the file is dropped when the last one is closed.
 
 	INODE_TYPE type;
+	bool fetch_pending; // The fetch was started by a non-blocking open() and has not finished yet, so the size of the file is not known
+	bool fetch_failed; // The fetch started by a non-blocking open() did not find the file, so it was removed from the filesystem
+};
 
-	emscripten_fetch_t *fetch;
+// State of a file that is stored to IndexedDB with -s ASMFS_WRITEBACK=1, allocated when it is first opened.
+struct inode_writeback
+{
+	char *url; // URI-encoded path that the file was opened with, under which it is stored to IndexedDB, or 0
+	double dirty_time; // Time when the file was first written to after it was last stored, from emscripten_get_now()
+	inode *next_dirty; // Next file in the list of dirty files
+	emscripten_fetch_t *store_fetch; // Ongoing store of the file to IndexedDB, or 0
+	uint8_t *store_data; // Copy of the file contents that store_fetch stores
+	inode *next_storing; // Next file in the list of files that are being stored
+	bool dirty; // The file has been written to since it was last stored to IndexedDB
 };
 
 #define EM_FILEDESCRIPTOR_MAGIC 0x64666d65U // 'emfd'
@@ -52,14 +107,115 @@ struct FileDescriptor
 	ssize_t file_pos;
 	uint32_t mode;
 	uint32_t flags;
+	size_t read_end; // File position where the previous read ended, to detect sequential reads
+	size_t readahead; // Number of bytes to download ahead of sequential reads of a lazily loaded file
+	pthread_mutex_t pos_lock; // Serializes the reads, writes and seeks that use and move file_pos. pread() and pwrite() do not take it.
 
 	inode *node;
 };
 
-static inode *create_inode(INODE_TYPE type, int mode)
+// Guards the name pool and the inode slabs.
+static bool inode_alloc_lock = false;
+
+// Names of inodes are interned: the pool keeps one copy of each distinct name, packed into blocks of
+// NAME_POOL_BLOCK_SIZE bytes, and a hash table of them. Names are never freed, so the pool only grows, by the
+// distinct names, which for the files of most applications are much fewer than the files.
+#define NAME_POOL_BLOCK_SIZE 65536
+static char *name_pool_block = 0;
+static uint32_t name_pool_block_used = NAME_POOL_BLOCK_SIZE;
+static const char **name_pool_table = 0; // Open addressing with linear probing
+static uint32_t name_pool_table_size = 0; // A power of two
+static uint32_t name_pool_count = 0;
+
+// Returns the interned copy of the len bytes at name, which need not be null-terminated. Called with
+// inode_alloc_lock held.
+static const char *intern_inode_name(const char *name, int len)
+{
+	if (len > NAME_MAX) len = NAME_MAX;
+	uint32_t hash = 2166136261u;
+	for(int i = 0; i < len; ++i) hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+
+	uint32_t mask = name_pool_table_size - 1;
+	if (name_pool_table)
+	{
+		for(uint32_t i = hash & mask; name_pool_table[i]; i = (i + 1) & mask)
+		{
+			const char *n = name_pool_table[i];
+			if (!strncmp(n, name, len) && !n[len]) return n;
+		}
+	}
+
+	if ((name_pool_count + 1) * 4 > name_pool_table_size * 3)
+	{
+		uint32_t size = name_pool_table_size ? name_pool_table_size * 2 : 1024;
+		const char **table = (const char**)calloc(size, sizeof(const char*));
+		if (!table) return 0;
+		for(uint32_t i = 0; i < name_pool_table_size; ++i)
+		{
+			const char *n = name_pool_table[i];
+			if (!n) continue;
+			uint32_t h = 2166136261u;
+			for(const char *c = n; *c; ++c) h = (h ^ (uint8_t)*c) * 16777619u;
+			uint32_t j = h & (size - 1);
+			while(table[j]) j = (j + 1) & (size - 1);
+			table[j] = n;
+		}
+		free(name_pool_table);
+		name_pool_table = table;
+		name_pool_table_size = size;
+		mask = size - 1;
+	}
+
+	if (name_pool_block_used + len + 1 > NAME_POOL_BLOCK_SIZE)
+	{
+		char *block = (char*)malloc(NAME_POOL_BLOCK_SIZE);
+		if (!block) return 0;
+		name_pool_block = block;
+		name_pool_block_used = 0;
+	}
+	char *n = name_pool_block + name_pool_block_used;
+	memcpy(n, name, len);
+	n[len] = '\0';
+	name_pool_block_used += len + 1;
+
+	uint32_t i = hash & mask;
+	while(name_pool_table[i]) i = (i + 1) & mask;
+	name_pool_table[i] = n;
+	++name_pool_count;
+	return n;
+}
+
+// Inodes are allocated in slabs of INODES_PER_SLAB, which saves the overhead of a malloc() per inode and keeps
+// the inodes of a tree that is created at once, like a preloaded package, next to each other. Inodes are only
+// deleted before they are linked to the tree, and go to a free list to be reused.
+#define INODES_PER_SLAB 256
+static inode *inode_slab = 0;
+static uint32_t inode_slab_used = INODES_PER_SLAB;
+static inode *free_inodes = 0; // Linked through their sibling field
+
+// Creates an inode named by the len bytes at name, which is not linked to the tree yet.
+static inode *create_inode(INODE_TYPE type, int mode, const char *name, int len)
 {
-	inode *i = (inode*)malloc(sizeof(inode));
+	while(__atomic_test_and_set(&inode_alloc_lock, __ATOMIC_ACQUIRE))
+		;
+	inode *i = free_inodes;
+	if (i) free_inodes = i->sibling;
+	else
+	{
+		if (inode_slab_used == INODES_PER_SLAB)
+		{
+			inode *slab = (inode*)malloc(INODES_PER_SLAB * sizeof(inode));
+			if (slab) inode_slab = slab, inode_slab_used = 0;
+		}
+		if (inode_slab_used < INODES_PER_SLAB) i = &inode_slab[inode_slab_used++];
+	}
+	const char *interned = i ? intern_inode_name(name, len) : 0;
+	__atomic_clear(&inode_alloc_lock, __ATOMIC_RELEASE);
+	if (!interned) abort(); // Out of memory for the metadata of the filesystem
+
 	memset(i, 0, sizeof(inode));
+	i->name = interned;
+	pthread_rwlock_init(&i->lock, 0);
 	i->ctime = i->mtime = i->atime = time(0);
 	i->type = type;
 	i->mode = mode;
@@ -71,19 +227,19 @@ static inode *cwd_inode = 0;
 
 static inode *filesystem_root()
 {
-	static inode *root_node = create_inode(INODE_DIR, 0777);
+	static inode *root_node = create_inode(INODE_DIR, 0777, "", 0);
 	return root_node;
 }
 
 static inode *get_cwd()
 {
-	if (!cwd_inode) cwd_inode = filesystem_root();
-	return cwd_inode;
+	inode *cwd = __atomic_load_n(&cwd_inode, __ATOMIC_ACQUIRE);
+	return cwd ? cwd : filesystem_root();
 }
 
 static void set_cwd(inode *node)
 {
-	cwd_inode = node;
+	__atomic_store_n(&cwd_inode, node, __ATOMIC_RELEASE);
 }
 
 static void inode_abspath(inode *node, char *dst, int dstLen)
@@ -108,8 +264,7 @@ static void inode_abspath(inode *node, char *dst, int dstLen)
 		stack[depth++] = node;
 		node = node->parent;
 	}
-	char *dstEnd = dst + dstLen;
-	*dstEnd-- = '\0';
+	char *dstEnd = dst + dstLen - 1; // Leave room for the null terminator.
 	while(depth > 0 && dst < dstEnd)
 	{
 		if (dst < dstEnd) *dst++ = '/';
@@ -119,65 +274,757 @@ static void inode_abspath(inode *node, char *dst, int dstLen)
 		strncpy(dst, stack[depth]->name, len);
 		dst += len;
 	}
+	*dst = '\0';
+}
+
+// File contents are stored in fixed size chunks that are allocated when first written to, so that writing
+// never copies the existing contents of the file, and holes in sparse files take no memory.
+#define FILE_CHUNK_SIZE (16*1024)
+
+static void free_file_chunks(inode *node)
+{
+	for(size_t i = 0; i < node->num_chunks; ++i) free(node->chunks[i]);
+	free(node->chunks);
+	node->chunks = 0;
+	node->num_chunks = 0;
+}
+
+// Returns the fetched or preloaded data of the file from offset on, and stores its length to *out_len, or returns 0 if there is none.
+static uint8_t *fetched_data(inode *node, size_t offset, size_t *out_len)
+{
+	*out_len = 0;
+	if (node->preloaded_data)
+	{
+		if (offset >= node->preloaded_size) return 0;
+		*out_len = node->preloaded_size - offset;
+		return (uint8_t*)node->preloaded_data + offset;
+	}
+	if (!node->fetch || !node->fetch->data || offset >= node->fetch->numBytes) return 0;
+	*out_len = node->fetch->numBytes - offset;
+	return (uint8_t*)node->fetch->data + offset;
+}
+
+// Returns the contents of the file from offset on, at most to the end of the chunk that offset is in, and stores their length
+// to *out_len. Returns 0 if the bytes are neither written nor fetched, which read as zeroes.
+static const uint8_t *file_data_extent(inode *node, size_t offset, size_t *out_len)
+{
+	size_t index = offset / FILE_CHUNK_SIZE;
+	size_t offset_in_chunk = offset % FILE_CHUNK_SIZE;
+	*out_len = FILE_CHUNK_SIZE - offset_in_chunk;
+	if (index < node->num_chunks && node->chunks[index]) return node->chunks[index] + offset_in_chunk;
+	size_t fetched_len;
+	uint8_t *fetched = fetched_data(node, offset, &fetched_len);
+	if (!fetched) return 0;
+	if (fetched_len < *out_len) *out_len = fetched_len;
+	return fetched;
+}
+
+// Copies num_bytes of the file contents, starting at offset, to dst.
+static void read_file_data(inode *node, size_t offset, uint8_t *dst, size_t num_bytes)
+{
+	while(num_bytes > 0)
+	{
+		size_t n;
+		const uint8_t *src = file_data_extent(node, offset, &n);
+		if (n > num_bytes) n = num_bytes;
+		if (src) memcpy(dst, src, n);
+		else memset(dst, 0, n);
+		dst += n;
+		offset += n;
+		num_bytes -= n;
+	}
+}
+
+// Returns true if all the bytes in [begin, end[ have been written to the file, so they can be read without waiting for a fetch.
+static bool file_data_is_stored(inode *node, size_t begin, size_t end)
+{
+	if (begin >= end) return true;
+	for(size_t index = begin / FILE_CHUNK_SIZE; index * FILE_CHUNK_SIZE < end; ++index)
+		if (index >= node->num_chunks || !node->chunks[index]) return false;
+	return true;
+}
+
+// Grows the array of chunks to have at least num_chunks entries. Returns false if out of memory.
+static bool reserve_file_chunks(inode *node, size_t num_chunks)
+{
+	if (num_chunks <= node->num_chunks) return true;
+	size_t new_num_chunks = node->num_chunks + node->num_chunks / 2; // Geometric increases in size for amortized O(1) behavior
+	if (new_num_chunks < num_chunks) new_num_chunks = num_chunks;
+	uint8_t **chunks = (uint8_t**)realloc(node->chunks, new_num_chunks * sizeof(uint8_t*));
+	if (!chunks) return false;
+	memset(chunks + node->num_chunks, 0, (new_num_chunks - node->num_chunks) * sizeof(uint8_t*));
+	node->chunks = chunks;
+	node->num_chunks = new_num_chunks;
+	return true;
+}
+
+// Allocates the chunks that cover the bytes [begin, end[ of the file. New chunks start out with the fetched data of the file.
+// Returns false if out of memory.
+static bool allocate_file_chunks(inode *node, size_t begin, size_t end)
+{
+	if (begin >= end) return true;
+	size_t num_chunks = (end + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+	if (!reserve_file_chunks(node, num_chunks)) return false;
+	for(size_t index = begin / FILE_CHUNK_SIZE; index < num_chunks; ++index)
+	{
+		if (node->chunks[index]) continue;
+		uint8_t *chunk = (uint8_t*)malloc(FILE_CHUNK_SIZE);
+		if (!chunk) return false;
+		read_file_data(node, index * FILE_CHUNK_SIZE, chunk, FILE_CHUNK_SIZE);
+		node->chunks[index] = chunk;
+	}
+	return true;
+}
+
+// Copies num_bytes from src to the file contents at offset. The chunks for them must have been allocated.
+static void write_file_data(inode *node, size_t offset, const uint8_t *src, size_t num_bytes)
+{
+	while(num_bytes > 0)
+	{
+		size_t offset_in_chunk = offset % FILE_CHUNK_SIZE;
+		size_t n = FILE_CHUNK_SIZE - offset_in_chunk;
+		if (n > num_bytes) n = num_bytes;
+		memcpy(node->chunks[offset / FILE_CHUNK_SIZE] + offset_in_chunk, src, n);
+		src += n;
+		offset += n;
+		num_bytes -= n;
+	}
+}
+
+#ifdef __EMSCRIPTEN_ASMFS_LAZY_LOAD__
+#define ASMFS_LAZY_LOAD 1
+#else
+#define ASMFS_LAZY_LOAD 0
+#endif
+
+// Sequential reads of a lazily loaded file download twice as much ahead of them each time, up to this many bytes.
+#define MAX_READAHEAD (1024*1024)
+
+// How many times open() looks up a file again when its contents were dropped while it was being opened.
+#define MAX_OPEN_RETRIES 4
+
+// Issues a Range request for the bytes [begin, end[ of the file at url.
+static emscripten_fetch_t *fetch_file_range(const char *url, size_t begin, size_t end)
+{
+	char range[64];
+	sprintf(range, "bytes=%zu-%zu", begin, end - 1); // The end of an HTTP byte range is inclusive.
+	const char *headers[] = { "Range", range, 0 };
+
+	emscripten_fetch_attr_t attr;
+	emscripten_fetch_attr_init(&attr);
+	strcpy(attr.requestMethod, "GET");
+	// Parts of files are not stored to IndexedDB, which would take them for the whole file.
+	attr.attributes = EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_WAITABLE;
+	attr.requestHeaders = headers;
+	COUNT(fetches, 1);
+	return emscripten_fetch(&attr, url);
+}
+
+// Stores the downloaded data of the file, which starts at offset data_begin, to the chunks [first_chunk, end_chunk[ that
+// have not been loaded or written to yet. Returns false if out of memory.
+static bool store_fetched_chunks(inode *node, const uint8_t *data, size_t data_begin, size_t data_len, size_t first_chunk, size_t end_chunk)
+{
+	if (!reserve_file_chunks(node, end_chunk)) return false;
+	for(size_t index = first_chunk; index < end_chunk; ++index)
+	{
+		if (node->chunks[index]) continue;
+		uint8_t *chunk = (uint8_t*)malloc(FILE_CHUNK_SIZE);
+		if (!chunk) return false;
+		size_t offset = index * FILE_CHUNK_SIZE - data_begin;
+		size_t n = offset < data_len ? data_len - offset : 0;
+		if (n > FILE_CHUNK_SIZE) n = FILE_CHUNK_SIZE;
+		if (n) memcpy(chunk, data + offset, n);
+		memset(chunk + n, 0, FILE_CHUNK_SIZE - n);
+		node->chunks[index] = chunk;
+	}
+	return true;
+}
+
+// Makes sure that the bytes [begin, end[ of a lazily loaded file are in memory, downloading each run of chunks that are missing
+// with one Range request. The last run is extended by up to readahead bytes, for as long as the chunks after it are missing.
+// Returns an errno, or 0 on success.
+static int load_file_range(inode *node, size_t begin, size_t end, size_t readahead)
+{
+	if (!node->url) return 0;
+	if (end > node->size) end = node->size;
+	if (begin >= end) return 0;
+	size_t end_chunk = (end + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+	size_t max_chunk = (node->size + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+	size_t readahead_chunk = (end + readahead + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+	if (readahead_chunk > max_chunk) readahead_chunk = max_chunk;
+
+	for(size_t index = begin / FILE_CHUNK_SIZE; index < end_chunk; ++index)
+	{
+		if (index < node->num_chunks && node->chunks[index]) continue;
+		size_t run_end = index + 1;
+		while(run_end < readahead_chunk && (run_end >= node->num_chunks || !node->chunks[run_end])) ++run_end;
+
+		size_t range_begin = index * FILE_CHUNK_SIZE;
+		size_t range_end = run_end * FILE_CHUNK_SIZE < node->size ? run_end * FILE_CHUNK_SIZE : node->size;
+		emscripten_fetch_t *fetch = fetch_file_range(node->url, range_begin, range_end);
+		emscripten_fetch_wait(fetch, INFINITY);
+		COUNT(bytes_fetched, fetch->numBytes);
+		bool stored;
+		if (fetch->status == 206)
+			stored = store_fetched_chunks(node, (const uint8_t*)fetch->data, range_begin, fetch->numBytes, index, run_end);
+		else if (fetch->status == 200)
+		{
+			// The server sent the whole file after all, so nothing more needs to be downloaded.
+			stored = store_fetched_chunks(node, (const uint8_t*)fetch->data, 0, fetch->numBytes, 0, max_chunk);
+			if (stored)
+			{
+				free(node->url);
+				node->url = 0;
+			}
+		}
+		else
+		{
+			emscripten_fetch_close(fetch);
+			return EIO;
+		}
+		emscripten_fetch_close(fetch);
+		if (!stored) return ENOMEM;
+		if (!node->url) return 0;
+		index = run_end - 1;
+	}
+	return 0;
 }
 
 static void delete_inode(inode *node)
 {
-	free(node);
+	free_file_chunks(node);
+	free(node->url);
+	free(node->children);
+	if (node->writeback) free(node->writeback->url);
+	free(node->writeback);
+	while(__atomic_test_and_set(&inode_alloc_lock, __ATOMIC_ACQUIRE))
+		;
+	node->sibling = free_inodes;
+	free_inodes = node;
+	__atomic_clear(&inode_alloc_lock, __ATOMIC_RELEASE);
+}
+
+// Guards the links between inodes, the children hash tables and the path lookup cache, which all threads share.
+// Only changes take the lock. Lookups in the tree run without it: changes make filesystem_tree_seq odd while they
+// are in progress, and lookups retry if it changed under them. Inodes are never freed, and neither are the children
+// hash tables that are replaced, so a lookup that races with a change still only reads valid memory.
+static bool filesystem_tree_lock = false;
+static uint32_t filesystem_tree_seq = 0;
+
+static void lock_filesystem_tree()
+{
+	while(__atomic_test_and_set(&filesystem_tree_lock, __ATOMIC_ACQUIRE))
+		; // Operations under the lock are short, so spin.
+}
+
+static void unlock_filesystem_tree()
+{
+	__atomic_clear(&filesystem_tree_lock, __ATOMIC_RELEASE);
+}
+
+// Brackets a change to the links between inodes, with the filesystem tree lock held.
+static void begin_tree_change()
+{
+	__atomic_store_n(&filesystem_tree_seq, filesystem_tree_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void end_tree_change()
+{
+	__atomic_store_n(&filesystem_tree_seq, filesystem_tree_seq + 1, __ATOMIC_RELEASE);
+}
+
+// Returns the sequence number to validate a lockless lookup with, once no change is in progress.
+static uint32_t begin_tree_lookup()
+{
+	for(;;)
+	{
+		uint32_t seq = __atomic_load_n(&filesystem_tree_seq, __ATOMIC_ACQUIRE);
+		if (!(seq & 1)) return seq;
+	}
+}
+
+// Returns true if no change was made to the tree since begin_tree_lookup() returned seq.
+static bool end_tree_lookup(uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&filesystem_tree_seq, __ATOMIC_RELAXED) == seq;
+}
+
+// Directories with more children than this get a hash table to look their children up by name.
+#define MIN_CHILDREN_FOR_HASH_TABLE 16
+
+// FNV-1a hash of an inode name that ends in a '\0' or a '/'. Stores the length of the name to *out_len.
+static uint32_t hash_inode_name(const char *name, int *out_len)
+{
+	uint32_t hash = 2166136261u;
+	const char *s = name;
+	while(*s && *s != '/') hash = (hash ^ (uint8_t)*s++) * 16777619u;
+	*out_len = s - name;
+	return hash;
+}
+
+// Adds node to the children hash table of its parent. Called with the filesystem tree lock held.
+static void insert_to_children_table(inode *parent, inode *node)
+{
+	inode **bucket = &parent->children[node->name_hash & (parent->children_table_size - 1)];
+	__atomic_store_n(&node->hash_next, *bucket, __ATOMIC_RELAXED);
+	__atomic_store_n(bucket, node, __ATOMIC_RELEASE);
+}
+
+// Creates or doubles the children hash table of a directory that has outgrown it. Called with the filesystem tree lock held,
+// inside a tree change. The old table is not freed, since lookups without the lock may still be reading it. The tables
+// double in size, so the old ones take at most as much memory as the current one.
+static void grow_children_table(inode *parent)
+{
+	uint32_t size = parent->children_table_size ? parent->children_table_size * 2 : 2 * MIN_CHILDREN_FOR_HASH_TABLE;
+	inode **children = (inode**)calloc(size, sizeof(inode*));
+	for(inode *child = parent->child; child; child = child->sibling)
+	{
+		inode **bucket = &children[child->name_hash & (size - 1)];
+		__atomic_store_n(&child->hash_next, *bucket, __ATOMIC_RELAXED);
+		*bucket = child;
+	}
+	// A lookup that sees the new size also sees the new table, so it never indexes the old, smaller table with it.
+	__atomic_store_n(&parent->children, children, __ATOMIC_RELEASE);
+	__atomic_store_n(&parent->children_table_size, size, __ATOMIC_RELEASE);
+}
+
+// Returns the child of the directory node 'dir' with the name that 'name' begins with (up to the first '\0' or '/'), or 0 if there is none.
+// Does not take the filesystem tree lock. The names of linked inodes do not change, and the lists that are walked never have cycles.
+static inode *find_child(inode *dir, const char *name)
+{
+	int len;
+	uint32_t hash = hash_inode_name(name, &len);
+	for(;;)
+	{
+		uint32_t seq = begin_tree_lookup();
+		uint32_t table_size = __atomic_load_n(&dir->children_table_size, __ATOMIC_ACQUIRE);
+		inode **children = __atomic_load_n(&dir->children, __ATOMIC_ACQUIRE);
+		inode *node;
+		if (children && table_size) // The first table may be seen before its size, then the children are still linked as siblings.
+		{
+			node = __atomic_load_n(&children[hash & (table_size - 1)], __ATOMIC_ACQUIRE);
+			while(node && (__atomic_load_n(&node->name_hash, __ATOMIC_RELAXED) != hash || strncmp(node->name, name, len) || node->name[len])) node = __atomic_load_n(&node->hash_next, __ATOMIC_ACQUIRE);
+		}
+		else
+		{
+			node = __atomic_load_n(&dir->child, __ATOMIC_ACQUIRE);
+			while(node && (strncmp(node->name, name, len) || node->name[len])) node = __atomic_load_n(&node->sibling, __ATOMIC_ACQUIRE);
+		}
+		if (end_tree_lookup(seq)) return node;
+	}
+}
+
+// Caches the results of successful path lookups. Creating new inodes does not change what an existing path
+// refers to, but unlinking does, so unlink_inode() invalidates every entry. Entries are updated with the filesystem
+// tree lock held and read without it: an update makes the seq of the entry odd while it is in progress, and a read
+// that sees seq change is a miss.
+#define PATH_CACHE_SIZE 1024 // Must be a power of two.
+#define PATH_CACHE_MAX_PATH 100 // Longer paths are not cached.
+
+struct path_cache_entry
+{
+	uint32_t seq;
+	inode *root; // The directory the path was looked up in
+	uint32_t hash;
+	uint32_t generation; // The entry is valid if this is equal to path_cache_generation
+	inode *node; // The inode that the path refers to
+	char path[PATH_CACHE_MAX_PATH]; // The path relative to root
+};
+
+static path_cache_entry path_cache[PATH_CACHE_SIZE];
+static uint32_t path_cache_generation = 1;
+
+static uint32_t hash_path(inode *root, const char *path)
+{
+	uint32_t hash = 2166136261u ^ (uint32_t)(uintptr_t)root;
+	while(*path) hash = (hash ^ (uint8_t)*path++) * 16777619u;
+	return hash;
+}
+
+static inode *find_in_path_cache(inode *root, const char *path)
+{
+	if (!root || !path) return 0;
+	size_t len = strlen(path);
+	if (len >= PATH_CACHE_MAX_PATH) return 0;
+	uint32_t hash = hash_path(root, path);
+	path_cache_entry *e = &path_cache[hash & (PATH_CACHE_SIZE - 1)];
+	uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+	if (seq & 1) return 0;
+	inode *node = 0;
+	if (__atomic_load_n(&e->generation, __ATOMIC_RELAXED) == __atomic_load_n(&path_cache_generation, __ATOMIC_RELAXED)
+		&& __atomic_load_n(&e->hash, __ATOMIC_RELAXED) == hash && __atomic_load_n(&e->root, __ATOMIC_RELAXED) == root
+		&& !memcmp(e->path, path, len + 1)) // The path may be torn by an update, but then seq tells that it changed.
+		node = __atomic_load_n(&e->node, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == seq ? node : 0;
+}
+
+// Caches the result of a lookup that started when path_cache_generation was 'generation', so that an unlink that raced
+// with the lookup leaves the entry invalid.
+static void add_to_path_cache(inode *root, const char *path, inode *node, uint32_t generation)
+{
+	size_t len = strlen(path);
+	if (len >= PATH_CACHE_MAX_PATH) return;
+	uint32_t hash = hash_path(root, path);
+	path_cache_entry *e = &path_cache[hash & (PATH_CACHE_SIZE - 1)];
+	lock_filesystem_tree();
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&e->root, root, __ATOMIC_RELAXED);
+	memcpy(e->path, path, len + 1);
+	__atomic_store_n(&e->hash, hash, __ATOMIC_RELAXED);
+	__atomic_store_n(&e->generation, generation, __ATOMIC_RELAXED);
+	__atomic_store_n(&e->node, node, __ATOMIC_RELAXED);
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELEASE);
+	unlock_filesystem_tree();
+}
+
+// Finds the child of dir with the given name. Must be called with the filesystem tree locked.
+static inode *find_child_locked(inode *dir, const char *name, int len, uint32_t hash)
+{
+	inode *node = dir->children ? dir->children[hash & (dir->children_table_size - 1)] : dir->child;
+	while(node && (strncmp(node->name, name, len) || node->name[len])) node = dir->children ? node->hash_next : node->sibling;
+	return node;
 }
 
-// Makes node the child of parent.
-static void link_inode(inode *node, inode *parent)
+// Makes node the child of parent. If another thread linked a child with the same name first, node is not
+// linked, and that child is returned instead. Otherwise returns node.
+static inode *link_inode(inode *node, inode *parent)
 {
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 2
 	char parentName[PATH_MAX];
 	inode_abspath(parent, parentName, PATH_MAX);
-	EM_ASM(Module['printErr']('link_inode: node "' + Pointer_stringify($0) + '" to parent "' + Pointer_stringify($1) + '".'), node->name, parentName);
+	TRACE(Module['printErr']('link_inode: node "' + Pointer_stringify($0) + '" to parent "' + Pointer_stringify($1) + '".'), node->name, parentName);
+#endif
 	// When linking a node, it can't be part of the filesystem tree (but it can have children of its own)
 	assert(!node->parent);
 	assert(!node->sibling);
 
 	// The inode pointed by 'node' is not yet part of the filesystem, so it's not shared memory and only this thread
-	// is accessing it. Therefore setting the node's parent here is not yet racy, do that operation first.
+	// is accessing it. Therefore setting these fields here is not yet racy.
+	int len;
+	uint32_t hash = hash_inode_name(node->name, &len);
+
+	// This node becomes the first child of the parent. The node is 'published' to the filesystem tree for
+	// other threads to see once the lock is released.
+	lock_filesystem_tree();
+	inode *existing = find_child_locked(parent, node->name, len, hash);
+	if (existing)
+	{
+		unlock_filesystem_tree();
+		return existing;
+	}
+	begin_tree_change();
 	node->parent = parent;
+	__atomic_store_n(&node->name_hash, hash, __ATOMIC_RELAXED);
+	__atomic_store_n(&node->sibling, parent->child, __ATOMIC_RELAXED);
+	node->prev_sibling = 0;
+	if (parent->child) parent->child->prev_sibling = node;
+	__atomic_store_n(&parent->child, node, __ATOMIC_RELEASE);
+	++parent->num_children;
+	if (parent->children) insert_to_children_table(parent, node);
+	if (parent->num_children > (parent->children ? parent->children_table_size : MIN_CHILDREN_FOR_HASH_TABLE)) grow_children_table(parent);
+	end_tree_change();
+	unlock_filesystem_tree();
+	return node;
+}
+
+static void unlink_inode(inode *node)
+{
+	TRACE(Module['printErr']('unlink_inode: node ' + Pointer_stringify($0) + ' from its parent ' + Pointer_stringify($1) + '.'), node->name, node->parent->name);
+	inode *parent = node->parent;
+	if (!parent) return;
+
+	lock_filesystem_tree();
+	begin_tree_change();
+	if (node->prev_sibling) __atomic_store_n(&node->prev_sibling->sibling, node->sibling, __ATOMIC_RELAXED);
+	else __atomic_store_n(&parent->child, node->sibling, __ATOMIC_RELAXED);
+	if (node->sibling) node->sibling->prev_sibling = node->prev_sibling;
+	if (parent->children)
+	{
+		inode **n = &parent->children[node->name_hash & (parent->children_table_size - 1)];
+		while(*n != node) n = &(*n)->hash_next;
+		__atomic_store_n(n, node->hash_next, __ATOMIC_RELAXED);
+	}
+	--parent->num_children;
+	__atomic_store_n(&path_cache_generation, path_cache_generation + 1, __ATOMIC_RELAXED);
+	node->parent = node->prev_sibling = 0;
+	__atomic_store_n(&node->sibling, (inode*)0, __ATOMIC_RELAXED);
+	__atomic_store_n(&node->hash_next, (inode*)0, __ATOMIC_RELAXED);
+	end_tree_change();
+	unlock_filesystem_tree();
+}
 
-	// This node is to become the first child of the parent, and the old first child of the parent should
-	// become the sibling of this node, i.e.
-	//  1) node->sibling = parent->child;
-	//  2) parent->child = node;
-	// However these two operations need to occur atomically in order to be coherent. To ensure that, run the two
-	// operations in a CAS loop, which is possible because the first operation is not racy until the node is 'published'
-	// to the filesystem tree by the compare_exchange operation.
-	do { __atomic_load(&parent->child, &node->sibling, __ATOMIC_SEQ_CST); // node->sibling <- parent->child
-	} while (!__atomic_compare_exchange(&parent->child, &node->sibling, &node, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)); // parent->child <- node if it had not raced to change value in between
+// Takes the size of the file from its finished fetch. The fetch of a lazily loaded file only has the first chunk of it, which
+// is stored, and the rest of the file is downloaded as it is read. Returns false if out of memory.
+static bool take_fetched_file(inode *node)
+{
+	emscripten_fetch_t *fetch = node->fetch;
+	COUNT(bytes_fetched, fetch->numBytes);
+	node->size = fetch->totalBytes;
+	if (fetch->status != 206)
+	{
+		// The server sent the whole file, or there was no file to send.
+		free(node->url);
+		node->url = 0;
+		return true;
+	}
+	if (!store_fetched_chunks(node, (const uint8_t*)fetch->data, 0, fetch->numBytes, 0, 1)) return false;
+	emscripten_fetch_close(fetch);
+	node->fetch = 0;
+	return true;
 }
 
-// Traverse back in sibling linked list, or 0 if no such node exist.
-static inode *find_predecessor_sibling(inode *node, inode *parent)
+// Waits up to timeout_msecs for the fetch that a non-blocking open() started to finish, and takes the file from it.
+// Returns false if it is still going on. Call without the file locked.
+static bool finish_file_fetch(inode *node, double timeout_msecs)
 {
-	inode *child = parent->child;
-	if (child == node) return 0;
-	while(child && child->sibling != node) child = child->sibling;
-	if (!child->sibling) return 0;
-	return child;
+	if (!__atomic_load_n(&node->fetch_pending, __ATOMIC_ACQUIRE)) return true;
+	if (emscripten_fetch_wait(node->fetch, timeout_msecs) == EMSCRIPTEN_RESULT_TIMED_OUT) return false;
+	pthread_rwlock_wrlock(&node->lock);
+	if (node->fetch_pending) // Another thread may have taken the file already.
+	{
+		emscripten_fetch_t *fetch = node->fetch;
+		bool found = (fetch->status == 200 || fetch->status == 206) && fetch->totalBytes > 0;
+		if (!found || !take_fetched_file(node))
+		{
+			// Where a blocking open() would have failed, I/O on the file fails, and it no longer exists in the filesystem.
+			emscripten_fetch_close(node->fetch);
+			node->fetch = 0;
+			free(node->url);
+			node->url = 0;
+			node->fetch_failed = true;
+			unlink_inode(node);
+		}
+		__atomic_store_n(&node->fetch_pending, false, __ATOMIC_RELEASE);
+	}
+	pthread_rwlock_unlock(&node->lock);
+	return true;
 }
 
-static void unlink_inode(inode *node)
+// Memory mappings of files that mmap() has made. A read-only MAP_PRIVATE mapping of a file that was downloaded whole points
+// straight into the downloaded data, so mapping a large asset does not copy it. Closing the file then leaves the download
+// to the mapping, and munmap() closes it. Other mappings are copies of the file contents. The list is guarded by the
+// filesystem tree lock.
+struct FileMapping
 {
-	EM_ASM(Module['printErr']('unlink_inode: node ' + Pointer_stringify($0) + ' from its parent ' + Pointer_stringify($1) + '.'), node->name, node->parent->name);
-	inode *parent = node->parent;
-	if (!parent) return;
-	node->parent = 0;
+	uint8_t *addr; // Start address of the mapping
+	size_t len; // Length of the mapping in bytes
+	int prot; // PROT_* flags that the mapping was made with
+	int flags; // MAP_* flags that the mapping was made with
+	inode *node; // The mapped file, or 0 for an anonymous mapping
+	size_t offset; // Offset of the mapping in the file
+	emscripten_fetch_t *fetch; // The download that addr points into, or 0
+	bool allocated; // True if addr was allocated with memalign(), false if it points into the downloaded or preloaded data of the file
+	FileMapping *next; // Next mapping in the list of mappings
+};
+static FileMapping *file_mappings = 0;
+
+// musl passes the file offset to mmap2() in units of 4096 bytes.
+#define MMAP2_UNIT 4096
+// Mappings that are allocated are aligned like the pages that sysconf(_SC_PAGESIZE) reports.
+#define MMAP_ALIGNMENT 16384
+
+// Returns true if any mapping points into the data of the fetch. Call with the filesystem tree lock held.
+static bool fetch_is_mapped(emscripten_fetch_t *fetch)
+{
+	for(FileMapping *m = file_mappings; m; m = m->next)
+		if (m->fetch == fetch) return true;
+	return false;
+}
+
+// Drops the downloaded data of the file, which is closed once no mappings point into it. Call with the file locked exclusively.
+static void close_file_fetch(inode *node)
+{
+	emscripten_fetch_t *fetch = node->fetch;
+	if (!fetch) return;
+	node->fetch = 0;
+	lock_filesystem_tree();
+	bool mapped = fetch_is_mapped(fetch);
+	unlock_filesystem_tree();
+	if (!mapped) emscripten_fetch_close(fetch);
+}
 
-	if (parent->child == node)
+#ifdef __EMSCRIPTEN_ASMFS_WRITEBACK_DELAY__
+#define ASMFS_WRITEBACK 1
+#define WRITEBACK_DELAY __EMSCRIPTEN_ASMFS_WRITEBACK_DELAY__
+#else
+#define ASMFS_WRITEBACK 0
+#define WRITEBACK_DELAY 0
+#endif
+
+// With -s ASMFS_WRITEBACK=1, files that are written to are stored to IndexedDB in the background, under the path that they
+// were opened with, where open() finds them again after the page is reloaded. A file is stored when it is closed or synced,
+// or otherwise by the first write after it has been dirty for WRITEBACK_DELAY msecs, so files that are written to over and
+// over are stored at most that often. Both lists are guarded by the filesystem tree lock.
+static inode *dirty_files = 0; // Files that have been written to since they were last stored
+static inode *storing_files = 0; // Files that are being stored
+
+static void mark_file_dirty(inode *node)
+{
+	inode_writeback *wb = node->writeback;
+	if (!ASMFS_WRITEBACK || !wb || !wb->url || wb->dirty) return;
+	lock_filesystem_tree();
+	if (!wb->dirty)
 	{
-		parent->child = node->sibling;
+		wb->dirty = true;
+		wb->dirty_time = emscripten_get_now();
+		wb->next_dirty = dirty_files;
+		dirty_files = node;
 	}
-	else
+	unlock_filesystem_tree();
+}
+
+// Removes the file from the list of dirty files. Returns true if it was dirty.
+static bool take_dirty_file(inode *node)
+{
+	inode_writeback *wb = node->writeback;
+	if (!wb) return false;
+	lock_filesystem_tree();
+	bool dirty = wb->dirty;
+	if (dirty)
+	{
+		inode **n = &dirty_files;
+		while(*n != node) n = &(*n)->writeback->next_dirty;
+		*n = wb->next_dirty;
+		wb->next_dirty = 0;
+		wb->dirty = false;
+	}
+	unlock_filesystem_tree();
+	return dirty;
+}
+
+// Waits for the ongoing store of the file to IndexedDB to finish, if there is one. Returns false if it failed.
+static bool finish_file_store(inode *node)
+{
+	inode_writeback *wb = node->writeback;
+	if (!wb) return true;
+	lock_filesystem_tree();
+	emscripten_fetch_t *fetch = wb->store_fetch;
+	uint8_t *data = wb->store_data;
+	if (fetch)
+	{
+		inode **n = &storing_files;
+		while(*n != node) n = &(*n)->writeback->next_storing;
+		*n = wb->next_storing;
+		wb->next_storing = 0;
+		wb->store_fetch = 0;
+		wb->store_data = 0;
+	}
+	unlock_filesystem_tree();
+	if (!fetch) return true;
+
+	emscripten_fetch_wait(fetch, INFINITY);
+	bool stored = fetch->status == 200;
+	emscripten_fetch_close(fetch);
+	free(data);
+	return stored;
+}
+
+// Starts to store the contents of the file to IndexedDB, if it is dirty. Returns false if that is not possible.
+static bool store_file(inode *node)
+{
+	if (!take_dirty_file(node)) return true;
+	finish_file_store(node); // The stores of a file finish in order.
+
+	// The store needs all of the file, which may not have been downloaded yet.
+	finish_file_fetch(node, INFINITY);
+	pthread_rwlock_wrlock(&node->lock);
+	if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY);
+	// The data is copied, because it needs to stay the same until the store has finished.
+	size_t size = node->size;
+	uint8_t *data = load_file_range(node, 0, size, 0) ? 0 : (uint8_t*)malloc(size > 0 ? size : 1);
+	if (data) read_file_data(node, 0, data, size);
+	pthread_rwlock_unlock(&node->lock);
+	if (!data) return false;
+
+	emscripten_fetch_attr_t attr;
+	emscripten_fetch_attr_init(&attr);
+	strcpy(attr.requestMethod, "EM_IDB_STORE");
+	attr.attributes = EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_WAITABLE;
+	attr.requestData = (const char*)data;
+	attr.requestDataSize = size;
+	inode_writeback *wb = node->writeback;
+	emscripten_fetch_t *fetch = emscripten_fetch(&attr, wb->url);
+	COUNT(stores, 1);
+	COUNT(bytes_stored, size);
+
+	lock_filesystem_tree();
+	wb->store_fetch = fetch;
+	wb->store_data = data;
+	wb->next_storing = storing_files;
+	storing_files = node;
+	unlock_filesystem_tree();
+	return true;
+}
+
+// Starts to store the files that have been dirty for WRITEBACK_DELAY msecs, and cleans up after the stores that have finished.
+static void store_expired_files()
+{
+	if (!ASMFS_WRITEBACK) return;
+	double expired = emscripten_get_now() - WRITEBACK_DELAY;
+	for(;;)
+	{
+		lock_filesystem_tree();
+		inode *node = dirty_files;
+		while(node && node->writeback->dirty_time > expired) node = node->writeback->next_dirty;
+		unlock_filesystem_tree();
+		if (!node) break;
+		store_file(node);
+	}
+	for(;;)
+	{
+		lock_filesystem_tree();
+		inode *node = storing_files;
+		while(node && emscripten_fetch_wait(node->writeback->store_fetch, 0) == EMSCRIPTEN_RESULT_TIMED_OUT) node = node->writeback->next_storing;
+		unlock_filesystem_tree();
+		if (!node) break;
+		finish_file_store(node);
+	}
+}
+
+// Stores all the dirty files to IndexedDB, and waits for them to finish.
+static void store_all_files()
+{
+	if (!ASMFS_WRITEBACK) return;
+	for(;;)
+	{
+		lock_filesystem_tree();
+		inode *node = dirty_files;
+		unlock_filesystem_tree();
+		if (!node) break;
+		store_file(node);
+	}
+	for(;;)
 	{
-		inode *predecessor = find_predecessor_sibling(node, parent);
-		if (predecessor) predecessor->sibling = node->sibling;
+		lock_filesystem_tree();
+		inode *node = storing_files;
+		unlock_filesystem_tree();
+		if (!node) break;
+		finish_file_store(node);
 	}
-	node->parent = node->sibling = 0;
+}
+
+// Removes the file from IndexedDB, when it is deleted.
+static void delete_stored_file(inode *node)
+{
+	if (!ASMFS_WRITEBACK || !node->writeback || !node->writeback->url) return;
+	take_dirty_file(node);
+	finish_file_store(node);
+
+	emscripten_fetch_attr_t attr;
+	emscripten_fetch_attr_init(&attr);
+	strcpy(attr.requestMethod, "EM_IDB_DELETE");
+	attr.attributes = EMSCRIPTEN_FETCH_WAITABLE;
+	emscripten_fetch_t *fetch = emscripten_fetch(&attr, node->writeback->url);
+	emscripten_fetch_wait(fetch, INFINITY);
+	emscripten_fetch_close(fetch);
+
+	// Writes through file descriptors that are still open must not store the file again.
+	free(node->writeback->url);
+	node->writeback->url = 0;
 }
 
 // Compares two strings for equality until a '\0' or a '/' is hit. Returns 0 if the strings differ,
@@ -215,14 +1062,12 @@ static void uriEncode(char *dst, int dstLengthBytes, const char *src)
 	*dst = '\0';
 }
 
-// Copies string 'path' to 'dst', but stops on the first forward slash '/' character.
-// Returns number of bytes written, excluding null terminator
-static int strcpy_inodename(char *dst, const char *path)
+// Returns the length of the first component of 'path', up to the first forward slash '/' character.
+static int inodename_length(const char *path)
 {
-	char *d = dst;
-	while(*path && *path != '/') *dst++ = *path++;
-	*dst = '\0';
-	return dst - d;
+	const char *p = path;
+	while(*p && *p != '/') ++p;
+	return p - path;
 }
 
 // Returns a pointer to the basename part of the string, i.e. the string after the last occurrence of a forward slash character
@@ -258,52 +1103,53 @@ static inode *create_directory_hierarchy_for_file(inode *root, const char *path_
 	}
 	if (path_to_file[0] == '\0') return 0;
 
-	inode *node = root->child;
+	inode *node = find_child(root, path_to_file);
 	while(node)
 	{
 		bool is_directory = false;
 		const char *child_path = path_cmp(path_to_file, node->name, &is_directory);
-		EM_ASM_INT( { Module['printErr']('path_cmp ' + Pointer_stringify($0) + ', ' + Pointer_stringify($1) + ', ' + Pointer_stringify($2) + ' .') }, path_to_file, node->name, child_path);
-		if (child_path)
-		{
-			if (is_directory && node->type != INODE_DIR) return 0; // "A component used as a directory in pathname is not, in fact, a directory"
+		TRACE({ Module['printErr']('path_cmp ' + Pointer_stringify($0) + ', ' + Pointer_stringify($1) + ', ' + Pointer_stringify($2) + ' .') }, path_to_file, node->name, child_path);
+		if (is_directory && node->type != INODE_DIR) return 0; // "A component used as a directory in pathname is not, in fact, a directory"
 
-			// The directory name matches.
-			path_to_file = child_path;
+		// The directory name matches.
+		path_to_file = child_path;
 
-			// Traverse . and ..
-			while(path_to_file[0] == '.')
+		// Traverse . and ..
+		while(path_to_file[0] == '.')
+		{
+			if (path_to_file[1] == '/') path_to_file += 2; // Skip over redundant "./././././" blocks
+			else if (path_to_file[1] == '\0') path_to_file += 1;
+			else if (path_to_file[1] == '.' && (path_to_file[2] == '/' || path_to_file[2] == '\0')) // Go up to parent directories with ".."
 			{
-				if (path_to_file[1] == '/') path_to_file += 2; // Skip over redundant "./././././" blocks
-				else if (path_to_file[1] == '\0') path_to_file += 1;
-				else if (path_to_file[1] == '.' && (path_to_file[2] == '/' || path_to_file[2] == '\0')) // Go up to parent directories with ".."
-				{
-					node = node->parent;
-					if (!node) return 0;
-					assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
-					path_to_file += (path_to_file[2] == '/') ? 3 : 2;
-				}
-				else break;
+				node = node->parent;
+				if (!node) return 0;
+				assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
+				path_to_file += (path_to_file[2] == '/') ? 3 : 2;
 			}
-			if (path_to_file[0] == '\0') return node;
-			if (path_to_file[0] == '/' && path_to_file[1] == '\0' /* && node is a directory*/) return node;
-			root = node;
-			node = node->child;
-		}
-		else
-		{
-			node = node->sibling;
+			else break;
 		}
+		if (path_to_file[0] == '\0') return node;
+		if (path_to_file[0] == '/' && path_to_file[1] == '\0' /* && node is a directory*/) return node;
+		root = node;
+		node = find_child(node, path_to_file);
 	}
-	EM_ASM(Module['printErr']('path_to_file ' + Pointer_stringify($0) + ' .'), path_to_file);
+	TRACE(Module['printErr']('path_to_file ' + Pointer_stringify($0) + ' .'), path_to_file);
 	const char *basename_pos = basename_part(path_to_file);
-	EM_ASM(Module['printErr']('basename_pos ' + Pointer_stringify($0) + ' .'), basename_pos);
+	TRACE(Module['printErr']('basename_pos ' + Pointer_stringify($0) + ' .'), basename_pos);
 	while(*path_to_file && path_to_file < basename_pos)
 	{
-		node = create_inode(INODE_DIR, mode);
-		path_to_file += strcpy_inodename(node->name, path_to_file) + 1;
-		link_inode(node, root);
-		EM_ASM(Module['print']('create_directory_hierarchy_for_file: created directory ' + Pointer_stringify($0) + ' under parent ' + Pointer_stringify($1) + '.'), 
+		int len = inodename_length(path_to_file);
+		node = create_inode(INODE_DIR, mode, path_to_file, len);
+		path_to_file += len + 1;
+		inode *linked = link_inode(node, root);
+		if (linked != node)
+		{
+			// Another thread created an entry with this name first.
+			delete_inode(node);
+			if (linked->type != INODE_DIR) return 0;
+			node = linked;
+		}
+		TRACE(Module['print']('create_directory_hierarchy_for_file: created directory ' + Pointer_stringify($0) + ' under parent ' + Pointer_stringify($1) + '.'), 
 			node->name, node->parent->name);
 		root = node;
 	}
@@ -324,9 +1170,11 @@ static inode *create_directory_hierarchy_for_file(const char *path, unsigned int
 // Note that the file/directory pointed to by path does not need to exist, only its parent does.
 static inode *find_parent_inode(inode *root, const char *path, int *out_errno)
 {
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 2
 	char rootName[PATH_MAX];
 	inode_abspath(root, rootName, PATH_MAX);
-	EM_ASM(Module['printErr']('find_parent_inode(root="' + Pointer_stringify($0) + '", path="' + Pointer_stringify($1) + '")'), rootName, path);
+	TRACE(Module['printErr']('find_parent_inode(root="' + Pointer_stringify($0) + '", path="' + Pointer_stringify($1) + '")'), rootName, path);
+#endif
 
 	assert(out_errno); // Passing in error is mandatory.
 
@@ -356,42 +1204,34 @@ static inode *find_parent_inode(inode *root, const char *path, int *out_errno)
 
 	const char *basename = basename_part(path);
 	if (path == basename) RETURN_NODE_AND_ERRNO(root, 0);
-	inode *node = root->child;
+	inode *node = find_child(root, path);
 	while(node)
 	{
 		bool is_directory = false;
 		const char *child_path = path_cmp(path, node->name, &is_directory);
-		if (child_path)
-		{
-			if (is_directory && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
+		if (is_directory && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
 
-			// The directory name matches.
-			path = child_path;
+		// The directory name matches.
+		path = child_path;
 
-			// Traverse . and ..
-			while(path[0] == '.')
+		// Traverse . and ..
+		while(path[0] == '.')
+		{
+			if (path[1] == '/') path += 2; // Skip over redundant "./././././" blocks
+			else if (path[1] == '\0') path += 1;
+			else if (path[1] == '.' && (path[2] == '/' || path[2] == '\0')) // Go up to parent directories with ".."
 			{
-				if (path[1] == '/') path += 2; // Skip over redundant "./././././" blocks
-				else if (path[1] == '\0') path += 1;
-				else if (path[1] == '.' && (path[2] == '/' || path[2] == '\0')) // Go up to parent directories with ".."
-				{
-					node = node->parent;
-					if (!node) RETURN_NODE_AND_ERRNO(0, ENOENT);
-					assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
-					path += (path[2] == '/') ? 3 : 2;
-				}
-				else break;
+				node = node->parent;
+				if (!node) RETURN_NODE_AND_ERRNO(0, ENOENT);
+				assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
+				path += (path[2] == '/') ? 3 : 2;
 			}
-
-			if (path >= basename) RETURN_NODE_AND_ERRNO(node, 0);
-			if (!*path) RETURN_NODE_AND_ERRNO(0, ENOENT);
-			node = node->child;
-			if (node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
-		}
-		else
-		{
-			node = node->sibling;
+			else break;
 		}
+
+		if (path >= basename) RETURN_NODE_AND_ERRNO(node, 0);
+		if (!*path) RETURN_NODE_AND_ERRNO(0, ENOENT);
+		node = find_child(node, path);
 	}
 	RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
 }
@@ -399,11 +1239,13 @@ static inode *find_parent_inode(inode *root, const char *path, int *out_errno)
 // Given a root inode of the filesystem and a path relative to it, e.g. "some/directory/dir_or_file",
 // returns the inode that corresponds to "dir_or_file", or 0 if it doesn't exist.
 // If the parameter out_closest_parent is specified, the closest (grand)parent node will be returned.
-static inode *find_inode(inode *root, const char *path, int *out_errno)
+static inode *find_inode_in_tree(inode *root, const char *path, int *out_errno)
 {
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 2
 	char rootName[PATH_MAX];
 	inode_abspath(root, rootName, PATH_MAX);
-	EM_ASM(Module['printErr']('find_inode(root="' + Pointer_stringify($0) + '", path="' + Pointer_stringify($1) + '")'), rootName, path);
+	TRACE(Module['printErr']('find_inode(root="' + Pointer_stringify($0) + '", path="' + Pointer_stringify($1) + '")'), rootName, path);
+#endif
 
 	assert(out_errno); // Passing in error is mandatory.
 
@@ -432,47 +1274,51 @@ static inode *find_inode(inode *root, const char *path, int *out_errno)
 	}
 	if (path[0] == '\0') RETURN_NODE_AND_ERRNO(root, 0);
 
-	inode *node = root->child;
+	inode *node = find_child(root, path);
 	while(node)
 	{
 		bool is_directory = false;
 		const char *child_path = path_cmp(path, node->name, &is_directory);
-		if (child_path)
-		{
-			if (is_directory && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
+		if (is_directory && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
 
-			// The directory name matches.
-			path = child_path;
+		// The directory name matches.
+		path = child_path;
 
-			// Traverse . and ..
-			while(path[0] == '.')
+		// Traverse . and ..
+		while(path[0] == '.')
+		{
+			if (path[1] == '/') path += 2; // Skip over redundant "./././././" blocks
+			else if (path[1] == '\0') path += 1;
+			else if (path[1] == '.' && (path[2] == '/' || path[2] == '\0')) // Go up to parent directories with ".."
 			{
-				if (path[1] == '/') path += 2; // Skip over redundant "./././././" blocks
-				else if (path[1] == '\0') path += 1;
-				else if (path[1] == '.' && (path[2] == '/' || path[2] == '\0')) // Go up to parent directories with ".."
-				{
-					node = node->parent;
-					if (!node) RETURN_NODE_AND_ERRNO(0, ENOENT);
-					assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
-					path += (path[2] == '/') ? 3 : 2;
-				}
-				else break;
+				node = node->parent;
+				if (!node) RETURN_NODE_AND_ERRNO(0, ENOENT);
+				assert(node->type == INODE_DIR); // Anything that is a parent should automatically be a directory.
+				path += (path[2] == '/') ? 3 : 2;
 			}
-
-			// If we arrived to the end of the search, this is the node we were looking for.
-			if (path[0] == '\0') RETURN_NODE_AND_ERRNO(node, 0);
-			if (path[0] == '/' && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
-			if (path[0] == '/' && path[1] == '\0') RETURN_NODE_AND_ERRNO(node, 0);
-			node = node->child;
-		}
-		else
-		{
-			node = node->sibling;
+			else break;
 		}
+
+		// If we arrived to the end of the search, this is the node we were looking for.
+		if (path[0] == '\0') RETURN_NODE_AND_ERRNO(node, 0);
+		if (path[0] == '/' && node->type != INODE_DIR) RETURN_NODE_AND_ERRNO(0, ENOTDIR); // "A component used as a directory in pathname is not, in fact, a directory"
+		if (path[0] == '/' && path[1] == '\0') RETURN_NODE_AND_ERRNO(node, 0);
+		node = find_child(node, path);
 	}
 	RETURN_NODE_AND_ERRNO(0, ENOENT);
 }
 
+// Same as above, but first looks the path up in the path lookup cache.
+static inode *find_inode(inode *root, const char *path, int *out_errno)
+{
+	inode *node = find_in_path_cache(root, path);
+	if (node) RETURN_NODE_AND_ERRNO(node, 0);
+	uint32_t generation = __atomic_load_n(&path_cache_generation, __ATOMIC_ACQUIRE);
+	node = find_inode_in_tree(root, path, out_errno);
+	if (node && !*out_errno) add_to_path_cache(root, path, node, generation);
+	return node;
+}
+
 // Same as above, but the root node is deduced from 'path'. (either absolute if path starts with "/", or relative)
 static inode *find_inode(const char *path, int *out_errno)
 {
@@ -543,15 +1389,104 @@ void emscripten_dump_fs_root()
 	emscripten_dump_fs_tree(filesystem_root(), path);
 }
 
-#define RETURN_ERRNO(errno, error_reason) do { \
-		EM_ASM(Module['printErr'](Pointer_stringify($0) + '() returned errno ' + #errno + '(' + $1 + '): ' + error_reason + '!'), __FUNCTION__, errno); \
-		return -errno; \
-	} while(0)
+// Debug function that prints out the counts of file operations so far to console.
+void emscripten_asmfs_dump_stats()
+{
+	EM_ASM(Module['printErr']('ASMFS: ' + $0 + ' opens, ' + $1 + ' closes, ' + $2 + ' seeks, ' + $3 + ' failed syscalls'),
+		stats.opens, stats.closes, stats.seeks, stats.errors);
+	EM_ASM(Module['printErr']('ASMFS: ' + $0 + ' reads of ' + $1 + ' bytes, ' + $2 + ' writes of ' + $3 + ' bytes'),
+		stats.reads, (double)stats.bytes_read, stats.writes, (double)stats.bytes_written);
+	EM_ASM(Module['printErr']('ASMFS: ' + $0 + ' downloads of ' + $1 + ' bytes'), stats.fetches, (double)stats.bytes_fetched);
+	EM_ASM(Module['printErr']('ASMFS: ' + $0 + ' stores to IndexedDB of ' + $1 + ' bytes'), stats.stores, (double)stats.bytes_stored);
+}
 
-static char stdout_buffer[4096] = {};
-static int stdout_buffer_end = 0;
-static char stderr_buffer[4096] = {};
-static int stderr_buffer_end = 0;
+// file_packager.py --asmfs appends a manifest of the preloaded files to the package data. It lists the directories and files
+// in the package, each directory before its contents, followed by the names of the entries. All fields are little endian.
+#define ASMFS_PACKAGE_MAGIC 0x31736661U // 'afs1'
+#define ASMFS_PACKAGE_ROOT 0xFFFFFFFFU // Parent of the entries in the root directory
+#define ASMFS_PACKAGE_DIRECTORY 0xFFFFFFFFU // Size of the entries that are directories
+struct asmfs_package_entry
+{
+	uint32_t parent; // Index of the directory entry that contains this entry, or ASMFS_PACKAGE_ROOT
+	uint32_t name; // Offset of the name of the entry from the end of the entries
+	uint32_t name_length; // Length of the name in bytes
+	uint32_t offset; // Offset of the file contents in the package data
+	uint32_t size; // Size of the file in bytes, or ASMFS_PACKAGE_DIRECTORY
+};
+struct asmfs_package_manifest
+{
+	uint32_t magic;
+	uint32_t num_entries;
+	asmfs_package_entry entries[];
+};
+
+// Adds the directories and files of a preloaded package to the filesystem, in one pass over its manifest. The files point into
+// data, which must stay in memory for as long as they exist. Existing directories are merged with the ones in the package, and
+// existing files are replaced. Returns 0, or an errno if the manifest is not valid or clashes with the filesystem.
+int emscripten_asmfs_import_package(const uint8_t *data, const void *manifest_data)
+{
+	const asmfs_package_manifest *manifest = (const asmfs_package_manifest*)manifest_data;
+	if (manifest->magic != ASMFS_PACKAGE_MAGIC) return EINVAL;
+	const char *names = (const char*)(manifest->entries + manifest->num_entries);
+	inode **nodes = (inode**)malloc(manifest->num_entries * sizeof(inode*));
+	if (!nodes && manifest->num_entries) return ENOMEM;
+
+	int err = 0;
+	for(uint32_t i = 0; i < manifest->num_entries && !err; ++i)
+	{
+		const asmfs_package_entry *e = &manifest->entries[i];
+		if (e->name_length == 0 || e->name_length > NAME_MAX || (e->parent != ASMFS_PACKAGE_ROOT && e->parent >= i))
+		{
+			err = EINVAL;
+			break;
+		}
+		inode *parent = (e->parent == ASMFS_PACKAGE_ROOT) ? filesystem_root() : nodes[e->parent];
+		bool directory = (e->size == ASMFS_PACKAGE_DIRECTORY);
+		inode *node = create_inode(directory ? INODE_DIR : INODE_FILE, directory ? 0777 : 0666, names + e->name, e->name_length);
+		if (!directory)
+		{
+			node->preloaded_data = data + e->offset;
+			node->preloaded_size = node->size = e->size;
+		}
+		inode *linked = link_inode(node, parent);
+		if (linked != node)
+		{
+			if (directory && linked->type == INODE_DIR)
+			{
+				delete_inode(node);
+				node = linked;
+			}
+			else if (!directory && linked->type == INODE_FILE)
+			{
+				unlink_inode(linked);
+				if (link_inode(node, parent) != node) err = EEXIST; // Another thread created the file again.
+			}
+			else err = EEXIST;
+			if (err) delete_inode(node);
+		}
+		nodes[i] = node;
+	}
+	free(nodes);
+	return err;
+}
+
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 1
+#define RETURN_ERRNO(errno, error_reason) do { \
+		COUNT(errors, 1); \
+		EM_ASM(Module['printErr'](Pointer_stringify($0) + '() returned errno ' + #errno + '(' + $1 + '): ' + error_reason + '!'), __FUNCTION__, errno); \
+		return -errno; \
+	} while(0)
+#else
+#define RETURN_ERRNO(errno, error_reason) do { \
+		COUNT(errors, 1); \
+		return -errno; \
+	} while(0)
+#endif
+
+static char stdout_buffer[4096] = {};
+static int stdout_buffer_end = 0;
+static char stderr_buffer[4096] = {};
+static int stderr_buffer_end = 0;
 
 static void print_stream(void *bytes, int numBytes, bool stdout)
 {
@@ -583,7 +1518,7 @@ long __syscall3(int which, ...) // read
 	void *buf = va_arg(vl, void *);
 	size_t count = va_arg(vl, size_t);
 	va_end(vl);
-	EM_ASM(Module['printErr']('read(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, buf, count);
+	TRACE(Module['printErr']('read(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, buf, count);
 
 	iovec io = { buf, count };
 	return __syscall145(145/*readv*/, fd, &io, 1);
@@ -597,15 +1532,32 @@ long __syscall4(int which, ...) // write
 	void *buf = va_arg(vl, void *);
 	size_t count = va_arg(vl, size_t);
 	va_end(vl);
-	EM_ASM(Module['printErr']('write(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, buf, count);
+	TRACE(Module['printErr']('write(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, buf, count);
 
 	iovec io = { buf, count };
 	return __syscall146(146/*writev*/, fd, &io, 1);
 }
 
+// Returns true if the file has no contents, because it was never downloaded, or its download was dropped when it was closed.
+static bool file_needs_download(inode *node)
+{
+	pthread_rwlock_rdlock(&node->lock);
+	bool needs_download = !node->fetch && !node->chunks && !node->url && !node->preloaded_data;
+	pthread_rwlock_unlock(&node->lock);
+	return needs_download;
+}
+// Returns true if the contents of a file that is not empty are no longer in memory, nor can they be downloaded on demand.
+static bool file_data_dropped(inode *node)
+{
+	pthread_rwlock_rdlock(&node->lock);
+	bool dropped = node->size > 0 && !node->fetch && !node->chunks && !node->url && !node->preloaded_data;
+	pthread_rwlock_unlock(&node->lock);
+	return dropped;
+}
+
 static long open(const char *pathname, int flags, int mode)
 {
-	EM_ASM(Module['printErr']('open(pathname="' + Pointer_stringify($0) + '", flags=0x' + ($1).toString(16) + ', mode=0' + ($2).toString(8) + ')'),
+	TRACE(Module['printErr']('open(pathname="' + Pointer_stringify($0) + '", flags=0x' + ($1).toString(16) + ', mode=0' + ($2).toString(8) + ')'),
 		pathname, flags, mode);
 
 	int accessMode = (flags & O_ACCMODE);
@@ -619,11 +1571,13 @@ static long open(const char *pathname, int flags, int mode)
 //	if ((flags & O_EXCL) && !(flags & O_CREAT)) RETURN_ERRNO(EINVAL, "open() with O_EXCL flag needs to always be paired with O_CREAT");
 	// However existing earlier unit tests in Emscripten expect that O_EXCL is simply ignored when O_CREAT was not passed. So do that for now.
 	if ((flags & O_EXCL) && !(flags & O_CREAT)) {
-		EM_ASM(Module['printErr']('warning: open(pathname="' + Pointer_stringify($0) + '", flags=0x' + ($1).toString(16) + ', mode=0' + ($2).toString(8) + ': flag O_EXCL should always be paired with O_CREAT. Ignoring O_EXCL)'), pathname, flags, mode);
+		TRACE(Module['printErr']('warning: open(pathname="' + Pointer_stringify($0) + '", flags=0x' + ($1).toString(16) + ', mode=0' + ($2).toString(8) + ': flag O_EXCL should always be paired with O_CREAT. Ignoring O_EXCL)'), pathname, flags, mode);
 		flags &= ~O_EXCL;
 	}
 
-	if ((flags & (O_NONBLOCK|O_NDELAY))) RETURN_ERRNO(ENOTSUP, "TODO: Opening files with O_NONBLOCK or O_NDELAY flags is not supported in ASMFS");
+	// A non-blocking open() of a file that is not in the filesystem only starts to download it, and reads fail with EAGAIN until
+	// it has been downloaded. Creating a file needs to know whether it exists already, so O_CREAT still waits.
+	bool nonblocking = (flags & O_NONBLOCK) && !(flags & O_CREAT);
 	if ((flags & O_PATH)) RETURN_ERRNO(ENOTSUP, "TODO: Opening files with O_PATH flag is not supported in ASMFS");
 	if ((flags & O_SYNC)) RETURN_ERRNO(ENOTSUP, "TODO: Opening files with O_SYNC flag is not supported in ASMFS");
 
@@ -653,7 +1607,11 @@ static long open(const char *pathname, int flags, int mode)
 	const char *relpath = (pathname[0] == '/') ? pathname+1 : pathname;
 
 	int err;
+	int retries = 0;
+find_file:
 	inode *node = find_inode(root, relpath, &err);
+	// Whether this pass can bring back the contents of the file: it had them in memory when it looked the file up, or it downloads them.
+	bool can_retry = false;
 	if (err == ENOTDIR) RETURN_ERRNO(ENOTDIR, "A component used as a directory in pathname is not, in fact, a directory");
 	if (err == ELOOP) RETURN_ERRNO(ELOOP, "Too many symbolic links were encountered in resolving pathname");
 	if (err == EACCES) RETURN_ERRNO(EACCES, "Search permission is denied for one of the directories in the path prefix of pathname");
@@ -665,86 +1623,180 @@ static long open(const char *pathname, int flags, int mode)
 		if ((flags & O_CREAT) && (flags & O_EXCL)) RETURN_ERRNO(EEXIST, "pathname already exists and O_CREAT and O_EXCL were used");
 		if (node->type == INODE_DIR && accessMode != O_RDONLY) RETURN_ERRNO(EISDIR, "pathname refers to a directory and the access requested involved writing (that is, O_WRONLY or O_RDWR is set)");
 		if (node->type == INODE_DIR && (flags & O_TRUNC)) RETURN_ERRNO(EISDIR, "pathname refers to a directory and the access flags specified invalid flag O_TRUNC");
-		if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY);
+		if (!nonblocking) finish_file_fetch(node, INFINITY);
+		if (node->fetch_failed) RETURN_ERRNO(ENOENT, "O_CREAT is not set and the named file does not exist (attempted emscripten_fetch() XHR to download)");
+		can_retry = node->type == INODE_FILE && !file_data_dropped(node);
 	}
 
 	if ((flags & O_CREAT) && ((flags & O_TRUNC) || (flags & O_EXCL)))
 	{
 		// Create a new empty file or truncate existing one.
-		if (node)
+		bool truncate = node != 0;
+		if (!node)
 		{
-			if (node->fetch) emscripten_fetch_close(node->fetch);
-			node->fetch = 0;
-			node->size = 0;
+			inode *directory = create_directory_hierarchy_for_file(root, relpath, mode);
+			if (!directory) RETURN_ERRNO(ENOTDIR, "A component used as a directory in pathname is not, in fact, a directory");
+			const char *name = basename_part(pathname);
+			node = create_inode((flags & O_DIRECTORY) ? INODE_DIR : INODE_FILE, mode, name, strlen(name));
+			inode *linked = link_inode(node, directory);
+			if (linked != node)
+			{
+				// Another thread created the file first.
+				delete_inode(node);
+				if ((flags & O_EXCL)) RETURN_ERRNO(EEXIST, "pathname already exists and O_CREAT and O_EXCL were used");
+				if (linked->type == INODE_DIR) RETURN_ERRNO(EISDIR, "pathname refers to a directory and the access flags specified invalid flag O_TRUNC");
+				node = linked;
+				truncate = true;
+			}
 		}
-		else if ((flags & O_CREAT))
+		if (truncate)
 		{
-			inode *directory = create_directory_hierarchy_for_file(root, relpath, mode);
-			node = create_inode((flags & O_DIRECTORY) ? INODE_DIR : INODE_FILE, mode);
-			strcpy(node->name, basename_part(pathname));
-			link_inode(node, directory);
+			pthread_rwlock_wrlock(&node->lock);
+			close_file_fetch(node);
+			free_file_chunks(node);
+			free(node->url);
+			node->url = 0;
+			node->preloaded_data = 0;
+			node->preloaded_size = 0;
+			node->size = 0;
+			pthread_rwlock_unlock(&node->lock);
+			mark_file_dirty(node);
 		}
 	}
-	else if (!node || (node->type == INODE_FILE && !node->fetch && !node->data))
+	else if (!node || (node->type == INODE_FILE && file_needs_download(node)))
 	{
 		emscripten_fetch_t *fetch = 0;
-		if (!(flags & O_DIRECTORY) && accessMode != O_WRONLY)
+		bool locked = false; // True if this thread created the entry and holds its lock.
+		char uriEncodedPathName[3*PATH_MAX+4]; // times 3 because uri-encoding can expand the filename at most 3x.
+		// A write that does not truncate the file keeps the rest of its contents, so a file whose download was dropped is downloaded again.
+		bool redownload = node && node->type == INODE_FILE && file_data_dropped(node);
+		if (!(flags & O_DIRECTORY) && (accessMode != O_WRONLY || redownload))
 		{
 			// If not, we'll need to fetch it.
-			emscripten_fetch_attr_t attr;
-			emscripten_fetch_attr_init(&attr);
-			strcpy(attr.requestMethod, "GET");
-			attr.attributes = EMSCRIPTEN_FETCH_APPEND | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_WAITABLE | EMSCRIPTEN_FETCH_PERSIST_FILE;
-			char uriEncodedPathName[3*PATH_MAX+4]; // times 3 because uri-encoding can expand the filename at most 3x.
 			uriEncode(uriEncodedPathName, 3*PATH_MAX+4, pathname);
-			fetch = emscripten_fetch(&attr, uriEncodedPathName);
-
-		// switch(fopen_mode)
-		// {
-		// case synchronous_fopen:
-			emscripten_fetch_wait(fetch, INFINITY);
+			if (ASMFS_LAZY_LOAD)
+			{
+				// Only download the first chunk, which also tells the size of the file. If the server does not support
+				// Range requests, it responds with the whole file instead.
+				fetch = fetch_file_range(uriEncodedPathName, 0, FILE_CHUNK_SIZE);
+			}
+			else
+			{
+				emscripten_fetch_attr_t attr;
+				emscripten_fetch_attr_init(&attr);
+				strcpy(attr.requestMethod, "GET");
+				attr.attributes = EMSCRIPTEN_FETCH_APPEND | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_WAITABLE | EMSCRIPTEN_FETCH_PERSIST_FILE;
+				fetch = emscripten_fetch(&attr, uriEncodedPathName);
+				COUNT(fetches, 1);
+			}
+			can_retry = true;
 
-			if (!(flags & O_CREAT) && (fetch->status != 200 || fetch->totalBytes == 0))
+			if (!nonblocking)
 			{
-				emscripten_fetch_close(fetch);
-				RETURN_ERRNO(ENOENT, "O_CREAT is not set and the named file does not exist (attempted emscripten_fetch() XHR to download)");
+				emscripten_fetch_wait(fetch, INFINITY);
+
+				if (!(flags & O_CREAT) && ((fetch->status != 200 && fetch->status != 206) || fetch->totalBytes == 0))
+				{
+					emscripten_fetch_close(fetch);
+					RETURN_ERRNO(ENOENT, "O_CREAT is not set and the named file does not exist (attempted emscripten_fetch() XHR to download)");
+				}
 			}
-		//  break;
-		// case asynchronous_fopen:
-		//  break;
-		// }
 		}
 
 		if (node)
 		{
-			// If we had an existing inode entry, just associate the entry with the newly fetched data.
-			if (node->type == INODE_FILE) node->fetch = fetch;
+			// If we had an existing inode entry, just associate the entry with the newly fetched data, below.
 		}
 		else if ((flags & O_CREAT) // If the filesystem entry did not exist, but we have a create flag, ...
 			|| (!node && fetch)) // ... or if it did not exist in our fs, but it could be found via fetch(), ...
 		{
 			// ... add it as a new entry to the fs.
 			inode *directory = create_directory_hierarchy_for_file(root, relpath, mode);
-			node = create_inode((flags & O_DIRECTORY) ? INODE_DIR : INODE_FILE, mode);
-			strcpy(node->name, basename_part(pathname));
-			node->fetch = fetch;
-			link_inode(node, directory);
+			if (!directory)
+			{
+				if (fetch) emscripten_fetch_close(fetch);
+				RETURN_ERRNO(ENOTDIR, "A component used as a directory in pathname is not, in fact, a directory");
+			}
+			const char *name = basename_part(pathname);
+			node = create_inode((flags & O_DIRECTORY) ? INODE_DIR : INODE_FILE, mode, name, strlen(name));
+			// Other threads that find the new entry wait for its contents until the download is associated with it, below.
+			pthread_rwlock_wrlock(&node->lock);
+			inode *linked = link_inode(node, directory);
+			if (linked != node)
+			{
+				// Another thread added the file first, so associate the download with its entry instead.
+				pthread_rwlock_unlock(&node->lock);
+				delete_inode(node);
+				node = linked;
+			}
+			else locked = true;
 		}
 		else
 		{
 			if (fetch) emscripten_fetch_close(fetch);
 			RETURN_ERRNO(ENOENT, "O_CREAT is not set and the named file does not exist");
 		}
-		node->size = node->fetch->totalBytes;
+		if (fetch)
+		{
+			if (!locked) pthread_rwlock_wrlock(&node->lock);
+			// Another thread may have opened the existing file and associated it with its own download first.
+			if (!node->fetch && !node->chunks && !node->url && !node->preloaded_data) node->fetch = fetch;
+			bool associated = node->fetch == fetch, stored = true;
+			if (associated)
+			{
+				if (ASMFS_LAZY_LOAD) node->url = strdup(uriEncodedPathName);
+				if (nonblocking) __atomic_store_n(&node->fetch_pending, true, __ATOMIC_RELEASE);
+				else stored = take_fetched_file(node);
+			}
+			pthread_rwlock_unlock(&node->lock);
+			if (!associated)
+			{
+				emscripten_fetch_wait(fetch, INFINITY);
+				emscripten_fetch_close(fetch);
+			}
+			if (!stored) RETURN_ERRNO(ENOMEM, "Out of memory for the file data");
+		}
+		else if (locked) pthread_rwlock_unlock(&node->lock);
+#if __EMSCRIPTEN_ASMFS_TRACE__ >= 2
 		emscripten_dump_fs_root();
+#endif
+	}
+
+	// The download of a file is dropped when its last descriptor is closed, which another thread may have done after the file
+	// was looked up above. Then download it again, unless this pass could not have brought the contents back.
+	__atomic_add_fetch(&node->num_open_fds, 1, __ATOMIC_ACQ_REL);
+	if (node->type == INODE_FILE && file_data_dropped(node))
+	{
+		__atomic_sub_fetch(&node->num_open_fds, 1, __ATOMIC_ACQ_REL);
+		if (!can_retry || ++retries > MAX_OPEN_RETRIES) RETURN_ERRNO(EIO, "The contents of the file were dropped, and could not be downloaded again");
+		goto find_file;
+	}
+
+	if (ASMFS_WRITEBACK && node->type == INODE_FILE && !__atomic_load_n(&node->writeback, __ATOMIC_ACQUIRE))
+	{
+		char uriEncodedPathName[3*PATH_MAX+4]; // times 3 because uri-encoding can expand the filename at most 3x.
+		uriEncode(uriEncodedPathName, 3*PATH_MAX+4, pathname);
+		inode_writeback *wb = (inode_writeback*)calloc(1, sizeof(inode_writeback));
+		wb->url = strdup(uriEncodedPathName);
+		inode_writeback *expected = 0;
+		if (!__atomic_compare_exchange_n(&node->writeback, &expected, wb, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			// Another thread opened the file first.
+			free(wb->url);
+			free(wb);
+		}
 	}
 
 	FileDescriptor *desc = (FileDescriptor*)malloc(sizeof(FileDescriptor));
 	desc->magic = EM_FILEDESCRIPTOR_MAGIC;
 	desc->node = node;
-	desc->file_pos = ((flags & O_APPEND) && node->fetch) ? node->fetch->totalBytes : 0;
+	desc->file_pos = ((flags & O_APPEND) && (node->fetch || node->url || node->preloaded_data)) ? node->size : 0;
 	desc->mode = mode;
 	desc->flags = flags;
+	desc->read_end = 0;
+	desc->readahead = 0;
+	pthread_mutex_init(&desc->pos_lock, 0);
+	COUNT(opens, 1);
 
 	// TODO: The file descriptor needs to be a small number, man page:
 	// "a small, nonnegative integer for use in subsequent system calls
@@ -768,19 +1820,32 @@ long __syscall5(int which, ...) // open
 
 static long close(int fd)
 {
-	EM_ASM(Module['printErr']('close(fd=' + $0 + ')'), fd);
+	TRACE(Module['printErr']('close(fd=' + $0 + ')'), fd);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
 
-	if (desc->node && desc->node->fetch)
+	if (desc->node) finish_file_fetch(desc->node, INFINITY); // The fetch cannot be closed while it is still going on.
+	if (desc->node)
 	{
-		emscripten_fetch_wait(desc->node->fetch, INFINITY); // TODO: This should not be necessary- test this out
-		emscripten_fetch_close(desc->node->fetch);
-		desc->node->fetch = 0;
+		// Store the file while its contents are still all there.
+		store_file(desc->node);
+		store_expired_files();
+	}
+	if (desc->node && __atomic_sub_fetch(&desc->node->num_open_fds, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		pthread_rwlock_wrlock(&desc->node->lock);
+		if (desc->node->fetch && __atomic_load_n(&desc->node->num_open_fds, __ATOMIC_ACQUIRE) == 0) // Unless the file was opened again meanwhile
+		{
+			emscripten_fetch_wait(desc->node->fetch, INFINITY); // TODO: This should not be necessary- test this out
+			close_file_fetch(desc->node);
+		}
+		pthread_rwlock_unlock(&desc->node->lock);
 	}
+	pthread_mutex_destroy(&desc->pos_lock);
 	desc->magic = 0;
 	free(desc);
+	COUNT(closes, 1);
 	return 0;
 }
 
@@ -801,7 +1866,7 @@ long __syscall9(int which, ...) // link
 	const char *oldpath = va_arg(vl, const char *);
 	const char *newpath = va_arg(vl, const char *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('link(oldpath="' + Pointer_stringify($0) + '", newpath="' + Pointer_stringify($1) + '")'), oldpath, newpath);
+	TRACE(Module['printErr']('link(oldpath="' + Pointer_stringify($0) + '", newpath="' + Pointer_stringify($1) + '")'), oldpath, newpath);
 
 	RETURN_ERRNO(ENOTSUP, "TODO: link() is a stub and not yet implemented in ASMFS");
 }
@@ -812,7 +1877,7 @@ long __syscall10(int which, ...) // unlink
 	va_start(vl, which);
 	const char *pathname = va_arg(vl, const char *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('unlink(pathname="' + Pointer_stringify($0) + '")'), pathname);
+	TRACE(Module['printErr']('unlink(pathname="' + Pointer_stringify($0) + '")'), pathname);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -844,6 +1909,7 @@ long __syscall10(int which, ...) // unlink
 	if (node->child) RETURN_ERRNO(EISDIR, "directory is not empty"); // Linux quirk: Return EISDIR error if not being able to delete a nonempty directory.
 
 	unlink_inode(node);
+	delete_stored_file(node);
 
 	return 0;
 }
@@ -854,7 +1920,7 @@ long __syscall12(int which, ...) // chdir
 	va_start(vl, which);
 	const char *pathname = va_arg(vl, const char *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('chdir(pathname="' + Pointer_stringify($0) + '")'), pathname);
+	TRACE(Module['printErr']('chdir(pathname="' + Pointer_stringify($0) + '")'), pathname);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -882,7 +1948,7 @@ long __syscall14(int which, ...) // mknod
 	mode_t mode = va_arg(vl, mode_t);
 	int dev = va_arg(vl, int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('mknod(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ', dev=' + $2 + ')'), pathname, mode, dev);
+	TRACE(Module['printErr']('mknod(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ', dev=' + $2 + ')'), pathname, mode, dev);
 
 	RETURN_ERRNO(ENOTSUP, "TODO: mknod() is a stub and not yet implemented in ASMFS");
 }
@@ -894,7 +1960,7 @@ long __syscall15(int which, ...) // chmod
 	const char *pathname = va_arg(vl, const char *);
 	int mode = va_arg(vl, int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('chmod(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
+	TRACE(Module['printErr']('chmod(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -923,7 +1989,7 @@ long __syscall33(int which, ...) // access
 	const char *pathname = va_arg(vl, const char *);
 	int mode = va_arg(vl, int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('access(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
+	TRACE(Module['printErr']('access(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -954,7 +2020,9 @@ long __syscall33(int which, ...) // access
 
 long __syscall36(int which, ...) // sync
 {
-	EM_ASM(Module['printErr']('sync()'));
+	TRACE(Module['printErr']('sync()'));
+
+	store_all_files();
 
 	// Spec mandates that "sync() is always successful".
 	return 0;
@@ -969,7 +2037,7 @@ long __syscall39(int which, ...) // mkdir
 	const char *pathname = va_arg(vl, const char *);
 	mode_t mode = va_arg(vl, mode_t);
 	va_end(vl);
-	EM_ASM(Module['printErr']('mkdir(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
+	TRACE(Module['printErr']('mkdir(pathname="' + Pointer_stringify($0) + '", mode=0' + ($1).toString(8) + ')'), pathname, mode);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -997,9 +2065,13 @@ long __syscall39(int which, ...) // mkdir
 
 	// TODO: read-only filesystems: if (fs is read-only) RETURN_ERRNO(EROFS, "Pathname refers to a file on a read-only filesystem");
 
-	inode *directory = create_inode(INODE_DIR, mode);
-	strcpy(directory->name, basename_part(pathname));
-	link_inode(directory, parent_dir);
+	const char *name = basename_part(pathname);
+	inode *directory = create_inode(INODE_DIR, mode, name, strlen(name));
+	if (link_inode(directory, parent_dir) != directory)
+	{
+		delete_inode(directory);
+		RETURN_ERRNO(EEXIST, "pathname already exists (not necessarily as a directory)");
+	}
 	return 0;
 }
 
@@ -1009,7 +2081,7 @@ long __syscall40(int which, ...) // rmdir
 	va_start(vl, which);
 	const char *pathname = va_arg(vl, const char *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('rmdir(pathname="' + Pointer_stringify($0) + '")'), pathname);
+	TRACE(Module['printErr']('rmdir(pathname="' + Pointer_stringify($0) + '")'), pathname);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -1045,7 +2117,7 @@ long __syscall41(int which, ...) // dup
 	va_start(vl, which);
 	unsigned int fd = va_arg(vl, unsigned int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('dup(fd=' + $0 + ')'), fd);
+	TRACE(Module['printErr']('dup(fd=' + $0 + ')'), fd);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
@@ -1068,7 +2140,7 @@ long __syscall54(int which, ...) // ioctl/sysctl
 	int request = va_arg(vl, int);
 	char *argp = va_arg(vl, char *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('ioctl(fd=' + $0 + ', request=' + $1 + ', argp=0x' + $2 + ')'), fd, request, argp);
+	TRACE(Module['printErr']('ioctl(fd=' + $0 + ', request=' + $1 + ', argp=0x' + $2 + ')'), fd, request, argp);
 	RETURN_ERRNO(ENOTSUP, "TODO: ioctl() is a stub and not yet implemented in ASMFS");
 }
 
@@ -1076,7 +2148,60 @@ long __syscall54(int which, ...) // ioctl/sysctl
 // TODO: syscall63: dup2
 // TODO: syscall83: symlink
 // TODO: syscall85: readlink
-// TODO: syscall91: munmap
+// Writes the contents of a writable MAP_SHARED mapping back to the file. The mapping does not grow the file.
+// Called with the file locked exclusively. Returns an errno, or 0 on success.
+static int sync_file_mapping(FileMapping *m)
+{
+	if (!m->node || !(m->flags & MAP_SHARED) || !(m->prot & PROT_WRITE)) return 0;
+	inode *node = m->node;
+	if (m->offset >= node->size) return 0;
+	size_t len = node->size - m->offset < m->len ? node->size - m->offset : m->len;
+	if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY); // New chunks start out with the fetched data.
+	if (!allocate_file_chunks(node, m->offset, m->offset + len)) return ENOMEM;
+	write_file_data(node, m->offset, m->addr, len);
+	mark_file_dirty(node);
+	return 0;
+}
+
+long __syscall91(int which, ...) // munmap
+{
+	va_list vl;
+	va_start(vl, which);
+	uint8_t *addr = va_arg(vl, uint8_t*);
+	size_t len = va_arg(vl, size_t);
+	va_end(vl);
+	TRACE(Module['printErr']('munmap(addr=0x' + ($0).toString(16) + ', len=' + $1 + ')'), addr, len);
+
+	lock_filesystem_tree();
+	FileMapping *m = file_mappings;
+	while(m && (addr < m->addr || addr >= m->addr + m->len)) m = m->next;
+	bool partial = m && (addr != m->addr || len < m->len);
+	inode *node = m ? m->node : 0;
+	unlock_filesystem_tree();
+	if (!m) return 0;
+	// A mapping is a single allocation, or points into a download, so there is nothing to give back for a part of it.
+	if (partial) RETURN_ERRNO(EINVAL, "Unmapping a part of a mapping is not supported");
+
+	// Writing the mapping back, and closing the download that it points into, need the file to themselves.
+	if (node) pthread_rwlock_wrlock(&node->lock);
+	lock_filesystem_tree();
+	FileMapping **n = &file_mappings;
+	while(*n && ((*n)->addr != addr || (*n)->node != node)) n = &(*n)->next;
+	m = *n;
+	if (m) *n = m->next;
+	// If this was the last mapping into a download that the file has already dropped, close it.
+	bool close_fetch = m && m->fetch && node->fetch != m->fetch && !fetch_is_mapped(m->fetch);
+	unlock_filesystem_tree();
+	if (m) sync_file_mapping(m);
+	if (node) pthread_rwlock_unlock(&node->lock);
+	if (!m) return 0;
+
+	if (m->allocated) free(m->addr);
+	else if (close_fetch) emscripten_fetch_close(m->fetch);
+	free(m);
+	return 0;
+}
+
 // TODO: syscall94: fchmod
 // TODO: syscall102: socketcall
 
@@ -1094,11 +2219,43 @@ long __syscall118(int which, ...) // fsync
 	inode *node = desc->node;
 	if (!node) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
 
+	if (!store_file(node) || !finish_file_store(node)) RETURN_ERRNO(EIO, "Storing the file to IndexedDB failed");
+
 	return 0;
 }
 
 // TODO: syscall133: fchdir
 
+// Called with the position of the file descriptor locked.
+static long llseek_locked(FileDescriptor *desc, unsigned long offset_low, unsigned int whence, off_t *result)
+{
+// TODO: The following does not work, for some reason seek is getting called with 32-bit signed offsets?
+//	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | (uint64_t)offset_low);
+	int64_t offset = (int64_t)(int32_t)offset_low;
+	int64_t newPos;
+	switch(whence)
+	{
+		case SEEK_SET: newPos = offset; break;
+		case SEEK_CUR: newPos = desc->file_pos + offset; break;
+		case SEEK_END:
+			pthread_rwlock_rdlock(&desc->node->lock);
+			newPos = (desc->node->fetch ? desc->node->fetch->numBytes : desc->node->size) + offset;
+			pthread_rwlock_unlock(&desc->node->lock);
+			break;
+		case 3/*SEEK_DATA*/: RETURN_ERRNO(EINVAL, "whence is invalid (sparse files, whence=SEEK_DATA, is not supported");
+		case 4/*SEEK_HOLE*/: RETURN_ERRNO(EINVAL, "whence is invalid (sparse files, whence=SEEK_HOLE, is not supported");
+		default: RETURN_ERRNO(EINVAL, "whence is invalid");
+	}
+	if (newPos < 0) RETURN_ERRNO(EINVAL, "The resulting file offset would be negative");
+	if (newPos > 0x7FFFFFFFLL) RETURN_ERRNO(EOVERFLOW, "The resulting file offset cannot be represented in an off_t");
+
+	desc->file_pos = newPos;
+	COUNT(seeks, 1);
+
+	if (result) *result = desc->file_pos;
+	return 0;
+}
+
 long __syscall140(int which, ...) // llseek
 {
 	va_list vl;
@@ -1109,37 +2266,219 @@ long __syscall140(int which, ...) // llseek
 	off_t *result = va_arg(vl, off_t *);
 	unsigned int whence = va_arg(vl, unsigned int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('llseek(fd=' + $0 + ', offset_high=' + $1 + ', offset_low=' + $2 + ', result=0x' + ($3).toString(16) + ', whence=' + $4 + ')'),
+	TRACE(Module['printErr']('llseek(fd=' + $0 + ', offset_high=' + $1 + ', offset_low=' + $2 + ', result=0x' + ($3).toString(16) + ', whence=' + $4 + ')'),
 		fd, offset_high, offset_low, result, whence);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
 
-	if (desc->node->fetch) emscripten_fetch_wait(desc->node->fetch, INFINITY);
+	finish_file_fetch(desc->node, INFINITY);
+	pthread_mutex_lock(&desc->pos_lock);
+	long ret = llseek_locked(desc, offset_low, whence, result);
+	pthread_mutex_unlock(&desc->pos_lock);
+	return ret;
+}
 
-// TODO: The following does not work, for some reason seek is getting called with 32-bit signed offsets?
-//	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | (uint64_t)offset_low);
-	int64_t offset = (int64_t)(int32_t)offset_low;
-	int64_t newPos;
-	switch(whence)
+long __syscall144(int which, ...) // msync
+{
+	va_list vl;
+	va_start(vl, which);
+	uint8_t *addr = va_arg(vl, uint8_t*);
+	size_t len = va_arg(vl, size_t);
+	int flags = va_arg(vl, int);
+	va_end(vl);
+	TRACE(Module['printErr']('msync(addr=0x' + ($0).toString(16) + ', len=' + $1 + ', flags=' + $2 + ')'), addr, len, flags);
+
+	if ((flags & MS_ASYNC) && (flags & MS_SYNC)) RETURN_ERRNO(EINVAL, "Both MS_SYNC and MS_ASYNC are set in flags");
+
+	lock_filesystem_tree();
+	FileMapping *m = file_mappings;
+	while(m && (addr < m->addr || addr >= m->addr + m->len)) m = m->next;
+	unlock_filesystem_tree();
+	if (!m) RETURN_ERRNO(ENOMEM, "The indicated memory was not mapped");
+
+	// The whole mapping is written back, which also covers the [addr, addr+len[ range.
+	if (m->node) pthread_rwlock_wrlock(&m->node->lock);
+	int err = sync_file_mapping(m);
+	if (m->node) pthread_rwlock_unlock(&m->node->lock);
+	if (err) RETURN_ERRNO(ENOMEM, "Out of memory for the file data");
+	return 0;
+}
+
+
+// Copies the file contents from offset on to the iovcnt buffers of iov, which hold total_read_amount bytes, waiting for
+// the contents to be downloaded first. Returns the number of bytes read, or -errno.
+// Called with the file locked, exclusively if parts of a lazily loaded file need to be downloaded.
+// Returns the sum of the lengths of the buffers in iov, or -1 if it overflows an ssize_t, or a buffer with a length has no address.
+static ssize_t total_iovec_length(const iovec *iov, int iovcnt)
+{
+	ssize_t total = 0;
+	for(int i = 0; i < iovcnt; ++i)
 	{
-		case SEEK_SET: newPos = offset; break;
-		case SEEK_CUR: newPos = desc->file_pos + offset; break;
-		case SEEK_END: newPos = (desc->node->fetch ? desc->node->fetch->numBytes : desc->node->size) + offset; break;
-		case 3/*SEEK_DATA*/: RETURN_ERRNO(EINVAL, "whence is invalid (sparse files, whence=SEEK_DATA, is not supported");
-		case 4/*SEEK_HOLE*/: RETURN_ERRNO(EINVAL, "whence is invalid (sparse files, whence=SEEK_HOLE, is not supported");
-		default: RETURN_ERRNO(EINVAL, "whence is invalid");
+		ssize_t n = total + iov[i].iov_len;
+		if (n < total || (!iov[i].iov_base && iov[i].iov_len > 0)) return -1;
+		total = n;
 	}
-	if (newPos < 0) RETURN_ERRNO(EINVAL, "The resulting file offset would be negative");
-	if (newPos > 0x7FFFFFFFLL) RETURN_ERRNO(EOVERFLOW, "The resulting file offset cannot be represented in an off_t");
+	return total;
+}
 
-	desc->file_pos = newPos;
+// Waits for, or downloads, the contents of the file in [begin, end[ so that they can be read. Returns 0, or an errno.
+static int prepare_file_read(inode *node, size_t begin, size_t end, size_t readahead)
+{
+	// Reads of data that has all been written already do not need to wait for the file to finish downloading.
+	if (node->fetch && !file_data_is_stored(node, begin, end)) emscripten_fetch_wait(node->fetch, INFINITY);
+	return load_file_range(node, begin, end, readahead);
+}
+static ssize_t read_file_locked(inode *node, size_t offset, const iovec *iov, int iovcnt, size_t total_read_amount, size_t readahead)
+{
+	size_t begin = offset;
+	size_t end = offset + total_read_amount < node->size ? offset + total_read_amount : node->size;
+	int err = prepare_file_read(node, offset, end, readahead);
+	if (err == EIO) RETURN_ERRNO(EIO, "Downloading the file contents with a Range request failed");
+	if (err) RETURN_ERRNO(err, "Out of memory for the file data");
 
-	if (result) *result = desc->file_pos;
+	if (node->size > 0 && !node->chunks && !node->preloaded_data && (!node->fetch || !node->fetch->data)) RETURN_ERRNO(-1, "ASMFS internal error: no file data available");
+
+	for(int i = 0; i < iovcnt; ++i)
+	{
+		ssize_t dataLeft = node->size - offset;
+		if (dataLeft <= 0) break;
+		size_t bytesToCopy = (size_t)dataLeft < iov[i].iov_len ? dataLeft : iov[i].iov_len;
+		read_file_data(node, offset, (uint8_t*)iov[i].iov_base, bytesToCopy);
+		offset += bytesToCopy;
+	}
+	COUNT(reads, 1);
+	COUNT(bytes_read, offset - begin);
+	return offset - begin;
+}
+
+// Reads the file at offset to the iovecs. Reads from multiple threads run at the same time, unless they need to download
+// parts of a lazily loaded file. Returns the number of bytes read, or -errno.
+static ssize_t read_file(inode *node, size_t offset, const iovec *iov, int iovcnt, size_t total_read_amount, size_t readahead)
+{
+	pthread_rwlock_rdlock(&node->lock);
+	size_t end = offset + total_read_amount < node->size ? offset + total_read_amount : node->size;
+	if (node->url && !file_data_is_stored(node, offset, end))
+	{
+		// Downloading changes the chunks of the file, which needs the file to itself.
+		pthread_rwlock_unlock(&node->lock);
+		pthread_rwlock_wrlock(&node->lock);
+	}
+	ssize_t numRead = read_file_locked(node, offset, iov, iovcnt, total_read_amount, readahead);
+	pthread_rwlock_unlock(&node->lock);
+	return numRead;
+}
+
+// Writes the iovecs to the file at offset, growing the file if it ends before them. Called with the file locked exclusively.
+// Allocates the chunks of the file that num_bytes of new data at offset go to, and grows the file to cover them. The rest of
+// the file is not touched. Returns 0, or EIO if downloading the old contents failed, or ENOSPC if out of memory.
+static int prepare_file_write(inode *node, size_t offset, size_t num_bytes)
+{
+	size_t newSize = offset + num_bytes;
+	if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY); // New chunks start out with the fetched data.
+	// Of a lazily loaded file, only the chunks at either end of the write, and the one at the end of the file if it grows,
+	// keep some of their old contents, so only they need to be downloaded.
+	int err = load_file_range(node, offset, offset + 1, 0);
+	if (!err) err = load_file_range(node, newSize - 1, newSize, 0);
+	if (!err && newSize > node->size && node->size > 0) err = load_file_range(node, node->size - 1, node->size, 0);
+	if (err == EIO) return EIO;
+	if (err || !allocate_file_chunks(node, offset, newSize)) return ENOSPC;
+	if (node->size < newSize) node->size = newSize;
 	return 0;
 }
+static ssize_t write_file_locked(inode *node, size_t offset, const iovec *iov, int iovcnt, size_t total_write_amount)
+{
+	int err = prepare_file_write(node, offset, total_write_amount);
+	if (err == EIO) RETURN_ERRNO(EIO, "Downloading the file contents with a Range request failed");
+	if (err) RETURN_ERRNO(ENOSPC, "Out of memory for the file data");
+
+	for(int i = 0; i < iovcnt; ++i)
+	{
+		write_file_data(node, offset, (const uint8_t*)iov[i].iov_base, iov[i].iov_len);
+		offset += iov[i].iov_len;
+	}
+	COUNT(writes, 1);
+	COUNT(bytes_written, total_write_amount);
+	return total_write_amount;
+}
 
-// TODO: syscall144 msync
+// Writes the iovecs to the file at offset. Returns the number of bytes written, or -errno.
+static ssize_t write_file(inode *node, size_t offset, const iovec *iov, int iovcnt, size_t total_write_amount)
+{
+	pthread_rwlock_wrlock(&node->lock);
+	ssize_t numWritten = write_file_locked(node, offset, iov, iovcnt, total_write_amount);
+	pthread_rwlock_unlock(&node->lock);
+	if (numWritten < 0) return numWritten;
+	mark_file_dirty(node);
+	store_expired_files();
+	return numWritten;
+}
+
+// Copies count bytes of src from src_offset on to dst at dst_offset, straight from the chunks and downloaded or preloaded data
+// of src, with one memcpy() per extent of it. Stops at the end of src. Called with src locked for reading and dst exclusively.
+static ssize_t copy_file_locked(inode *src, size_t src_offset, inode *dst, size_t dst_offset, size_t count)
+{
+	size_t end = src_offset + count < src->size ? src_offset + count : src->size;
+	if (src_offset >= end) return 0;
+	count = end - src_offset;
+	int err = prepare_file_read(src, src_offset, end, 0);
+	if (!err) err = prepare_file_write(dst, dst_offset, count);
+	if (err == EIO) RETURN_ERRNO(EIO, "Downloading the file contents with a Range request failed");
+	if (err) RETURN_ERRNO(ENOSPC, "Out of memory for the file data");
+
+	for(size_t copied = 0; copied < count;)
+	{
+		size_t n;
+		const uint8_t *data = file_data_extent(src, src_offset + copied, &n);
+		size_t offset = dst_offset + copied;
+		size_t room = FILE_CHUNK_SIZE - offset % FILE_CHUNK_SIZE;
+		if (n > room) n = room;
+		if (n > count - copied) n = count - copied;
+		uint8_t *to = dst->chunks[offset / FILE_CHUNK_SIZE] + offset % FILE_CHUNK_SIZE;
+		if (data) memcpy(to, data, n);
+		else memset(to, 0, n);
+		copied += n;
+	}
+	COUNT(reads, 1);
+	COUNT(bytes_read, count);
+	COUNT(writes, 1);
+	COUNT(bytes_written, count);
+	return count;
+}
+// Locks src for reading, or exclusively if its contents need to be downloaded first, and dst exclusively. The two are locked
+// in address order, so that copies between the same two files in opposite directions do not deadlock.
+static void lock_file_pair(inode *src, bool src_exclusive, inode *dst)
+{
+	if (src < dst)
+	{
+		if (src_exclusive) pthread_rwlock_wrlock(&src->lock);
+		else pthread_rwlock_rdlock(&src->lock);
+	}
+	pthread_rwlock_wrlock(&dst->lock);
+	if (src > dst)
+	{
+		if (src_exclusive) pthread_rwlock_wrlock(&src->lock);
+		else pthread_rwlock_rdlock(&src->lock);
+	}
+}
+static ssize_t copy_file(inode *src, size_t src_offset, inode *dst, size_t dst_offset, size_t count)
+{
+	lock_file_pair(src, false, dst);
+	size_t end = src_offset + count < src->size ? src_offset + count : src->size;
+	if (src->url && !file_data_is_stored(src, src_offset, end))
+	{
+		pthread_rwlock_unlock(&src->lock);
+		pthread_rwlock_unlock(&dst->lock);
+		lock_file_pair(src, true, dst);
+	}
+	ssize_t numCopied = copy_file_locked(src, src_offset, dst, dst_offset, count);
+	pthread_rwlock_unlock(&src->lock);
+	pthread_rwlock_unlock(&dst->lock);
+	if (numCopied <= 0) return numCopied;
+	mark_file_dirty(dst);
+	store_expired_files();
+	return numCopied;
+}
 
 long __syscall145(int which, ...) // readv
 {
@@ -1149,7 +2488,7 @@ long __syscall145(int which, ...) // readv
 	const iovec *iov = va_arg(vl, const iovec*);
 	int iovcnt = va_arg(vl, int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('readv(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ')'), fd, iov, iovcnt);
+	TRACE(Module['printErr']('readv(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ')'), fd, iov, iovcnt);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
@@ -1159,35 +2498,30 @@ long __syscall145(int which, ...) // readv
 	if (node->type == INODE_DIR) RETURN_ERRNO(EISDIR, "fd refers to a directory");
 	if (node->type != INODE_FILE /* TODO: && node->type != socket */) RETURN_ERRNO(EINVAL, "fd is attached to an object which is unsuitable for reading");
 
-	// TODO: if (node->type == INODE_FILE && desc has O_NONBLOCK && read would block) RETURN_ERRNO(EAGAIN, "The file descriptor fd refers to a file other than a socket and has been marked nonblocking (O_NONBLOCK), and the read would block");
 	// TODO: if (node->type == socket && desc has O_NONBLOCK && read would block) RETURN_ERRNO(EWOULDBLOCK, "The file descriptor fd refers to a socket and has been marked nonblocking (O_NONBLOCK), and the read would block");
 
-	if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY);
-
-	if (node->size > 0 && !node->data && (!node->fetch || !node->fetch->data)) RETURN_ERRNO(-1, "ASMFS internal error: no file data available");
 	if (iovcnt < 0) RETURN_ERRNO(EINVAL, "The vector count, iovcnt, is less than zero");
 
-	ssize_t total_read_amount = 0;
-	for(int i = 0; i < iovcnt; ++i)
-	{
-		ssize_t n = total_read_amount + iov[i].iov_len;
-		if (n < total_read_amount) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value");
-		if (!iov[i].iov_base && iov[i].iov_len > 0) RETURN_ERRNO(EINVAL, "iov_len specifies a positive length buffer but iov_base is a null pointer");
-		total_read_amount = n;
-	}
+	ssize_t total_read_amount = total_iovec_length(iov, iovcnt);
+	if (total_read_amount < 0) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value, or iov_len specifies a positive length buffer but iov_base is a null pointer");
 
-	size_t offset = desc->file_pos;
-	uint8_t *data = node->data ? node->data : (node->fetch ? (uint8_t *)node->fetch->data : 0);
-	for(int i = 0; i < iovcnt; ++i)
+	if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	pthread_mutex_lock(&desc->pos_lock);
+	// Each sequential read downloads twice as much ahead of it as the previous one, so streaming through a lazily loaded file
+	// takes few requests.
+	if (desc->file_pos == desc->read_end) desc->readahead = desc->readahead < FILE_CHUNK_SIZE ? FILE_CHUNK_SIZE : desc->readahead * 2;
+	else desc->readahead = 0;
+	if (desc->readahead > MAX_READAHEAD) desc->readahead = MAX_READAHEAD;
+
+	ssize_t numRead = read_file(node, desc->file_pos, iov, iovcnt, total_read_amount, desc->readahead);
+	if (numRead >= 0)
 	{
-		ssize_t dataLeft = node->size - offset;
-		if (dataLeft <= 0) break;
-		size_t bytesToCopy = (size_t)dataLeft < iov[i].iov_len ? dataLeft : iov[i].iov_len;
-		memcpy(iov[i].iov_base, &data[offset], bytesToCopy);
-		offset += bytesToCopy;
+		desc->file_pos += numRead;
+		desc->read_end = desc->file_pos;
 	}
-	ssize_t numRead = offset - desc->file_pos;
-	desc->file_pos = offset;
+	pthread_mutex_unlock(&desc->pos_lock);
 	return numRead;
 }
 
@@ -1199,7 +2533,7 @@ long __syscall146(int which, ...) // writev
 	const iovec *iov = va_arg(vl, const iovec*);
 	int iovcnt = va_arg(vl, int);
 	va_end(vl);
-	EM_ASM(Module['printErr']('writev(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ')'), fd, iov, iovcnt);
+	TRACE(Module['printErr']('writev(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ')'), fd, iov, iovcnt);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (fd != 1/*stdout*/ && fd != 2/*stderr*/) // TODO: Resolve the hardcoding of stdin,stdout & stderr
@@ -1209,14 +2543,8 @@ long __syscall146(int which, ...) // writev
 
 	if (iovcnt < 0) RETURN_ERRNO(EINVAL, "The vector count, iovcnt, is less than zero");
 
-	ssize_t total_write_amount = 0;
-	for(int i = 0; i < iovcnt; ++i)
-	{
-		ssize_t n = total_write_amount + iov[i].iov_len;
-		if (n < total_write_amount) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value");
-		if (!iov[i].iov_base && iov[i].iov_len > 0) RETURN_ERRNO(EINVAL, "iov_len specifies a positive length buffer but iov_base is a null pointer");
-		total_write_amount = n;
-	}
+	ssize_t total_write_amount = total_iovec_length(iov, iovcnt);
+	if (total_write_amount < 0) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value, or iov_len specifies a positive length buffer but iov_base is a null pointer");
 
 	if (fd == 1/*stdout*/ || fd == 2/*stderr*/)
 	{
@@ -1230,39 +2558,205 @@ long __syscall146(int which, ...) // writev
 	}
 	else
 	{
-		// Enlarge the file in memory to fit space for the new data
-		size_t newSize = desc->file_pos + total_write_amount;
 		inode *node = desc->node;
-		if (node->capacity < newSize)
-		{
-			size_t newCapacity = (newSize > (size_t)(node->capacity*1.25) ? newSize : (size_t)(node->capacity*1.25)); // Geometric increases in size for amortized O(1) behavior
-			uint8_t *newData = (uint8_t *)realloc(node->data, newCapacity);
-			if (!newData)
-			{
-				newData = (uint8_t *)malloc(newCapacity);
-				memcpy(newData, node->data, node->size);
-				// TODO: init gaps with zeroes.
-				free(node->data);
-			}
-			node->data = newData;
-			node->size = newSize;
-			node->capacity = newCapacity;
-		}
-
-		for(int i = 0; i < iovcnt; ++i)
-		{
-			memcpy((uint8_t*)node->data + desc->file_pos, iov[i].iov_base, iov[i].iov_len);
-			desc->file_pos += iov[i].iov_len;
-		}
+		if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+		if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+		pthread_mutex_lock(&desc->pos_lock);
+		ssize_t numWritten = write_file(node, desc->file_pos, iov, iovcnt, total_write_amount);
+		if (numWritten > 0) desc->file_pos += numWritten;
+		pthread_mutex_unlock(&desc->pos_lock);
+		return numWritten;
 	}
-	return total_write_amount;
 }
 
 // TODO: syscall148: fdatasync
 // TODO: syscall168: poll
 
-// TODO: syscall180: pread64
-// TODO: syscall181: pwrite64
+// pread() and pwrite() do not use the position of the file descriptor, so threads that share one can use them at
+// the same time without serializing on it.
+long __syscall180(int which, ...) // pread64
+{
+	va_list vl;
+	va_start(vl, which);
+	int fd = va_arg(vl, int);
+	void *buf = va_arg(vl, void*);
+	size_t count = va_arg(vl, size_t);
+	va_arg(vl, int); // The 64-bit offset is aligned to an even argument.
+	uint32_t offset_low = va_arg(vl, uint32_t);
+	int32_t offset_high = va_arg(vl, int32_t);
+	va_end(vl);
+	TRACE(Module['printErr']('pread64(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ', offset=' + $3 + ')'), fd, buf, count, offset_low);
+
+	FileDescriptor *desc = (FileDescriptor*)fd;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
+	if ((desc->flags & O_ACCMODE) == O_WRONLY) RETURN_ERRNO(EBADF, "fd is not open for reading");
+
+	inode *node = desc->node;
+	if (!node) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
+	if (node->type == INODE_DIR) RETURN_ERRNO(EISDIR, "fd refers to a directory");
+	if (node->type != INODE_FILE) RETURN_ERRNO(EINVAL, "fd is attached to an object which is unsuitable for reading");
+
+	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | offset_low);
+	if (offset < 0) RETURN_ERRNO(EINVAL, "offset is negative");
+	if ((ssize_t)count < 0) RETURN_ERRNO(EINVAL, "count does not fit in an ssize_t");
+	if (!buf && count > 0) RETURN_ERRNO(EFAULT, "buf is outside the accessible address space");
+	if (offset > SIZE_MAX) return 0;
+
+	if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	iovec io = { buf, count };
+	return read_file(node, (size_t)offset, &io, 1, count, 0);
+}
+
+long __syscall181(int which, ...) // pwrite64
+{
+	va_list vl;
+	va_start(vl, which);
+	int fd = va_arg(vl, int);
+	const void *buf = va_arg(vl, const void*);
+	size_t count = va_arg(vl, size_t);
+	va_arg(vl, int); // The 64-bit offset is aligned to an even argument.
+	uint32_t offset_low = va_arg(vl, uint32_t);
+	int32_t offset_high = va_arg(vl, int32_t);
+	va_end(vl);
+	TRACE(Module['printErr']('pwrite64(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', count=' + $2 + ', offset=' + $3 + ')'), fd, buf, count, offset_low);
+
+	FileDescriptor *desc = (FileDescriptor*)fd;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
+	if ((desc->flags & O_ACCMODE) == O_RDONLY) RETURN_ERRNO(EBADF, "fd is not open for writing");
+
+	inode *node = desc->node;
+	if (!node) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
+	if (node->type != INODE_FILE) RETURN_ERRNO(EINVAL, "fd is attached to an object which is unsuitable for writing");
+
+	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | offset_low);
+	if (offset < 0) RETURN_ERRNO(EINVAL, "offset is negative");
+	if ((ssize_t)count < 0) RETURN_ERRNO(EINVAL, "count does not fit in an ssize_t");
+	if (!buf && count > 0) RETURN_ERRNO(EFAULT, "buf is outside the accessible address space");
+	if (offset + count > SIZE_MAX) RETURN_ERRNO(EFBIG, "The file would grow past the maximum file size");
+
+	if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	iovec io = { (void*)buf, count };
+	return write_file(node, (size_t)offset, &io, 1, count);
+}
+long __syscall333(int which, ...) // preadv
+{
+	va_list vl;
+	va_start(vl, which);
+	int fd = va_arg(vl, int);
+	const iovec *iov = va_arg(vl, const iovec*);
+	int iovcnt = va_arg(vl, int);
+	uint32_t offset_low = va_arg(vl, uint32_t);
+	int32_t offset_high = va_arg(vl, int32_t);
+	va_end(vl);
+	TRACE(Module['printErr']('preadv(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ', offset=' + $3 + ')'), fd, iov, iovcnt, offset_low);
+
+	FileDescriptor *desc = (FileDescriptor*)fd;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
+	if ((desc->flags & O_ACCMODE) == O_WRONLY) RETURN_ERRNO(EBADF, "fd is not open for reading");
+
+	inode *node = desc->node;
+	if (!node) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
+	if (node->type == INODE_DIR) RETURN_ERRNO(EISDIR, "fd refers to a directory");
+	if (node->type != INODE_FILE) RETURN_ERRNO(EINVAL, "fd is attached to an object which is unsuitable for reading");
+
+	if (iovcnt < 0) RETURN_ERRNO(EINVAL, "The vector count, iovcnt, is less than zero");
+	ssize_t total_read_amount = total_iovec_length(iov, iovcnt);
+	if (total_read_amount < 0) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value, or iov_len specifies a positive length buffer but iov_base is a null pointer");
+	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | offset_low);
+	if (offset < 0) RETURN_ERRNO(EINVAL, "offset is negative");
+	if (offset > SIZE_MAX) return 0;
+
+	if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	return read_file(node, (size_t)offset, iov, iovcnt, total_read_amount, 0);
+}
+long __syscall334(int which, ...) // pwritev
+{
+	va_list vl;
+	va_start(vl, which);
+	int fd = va_arg(vl, int);
+	const iovec *iov = va_arg(vl, const iovec*);
+	int iovcnt = va_arg(vl, int);
+	uint32_t offset_low = va_arg(vl, uint32_t);
+	int32_t offset_high = va_arg(vl, int32_t);
+	va_end(vl);
+	TRACE(Module['printErr']('pwritev(fd=' + $0 + ', iov=0x' + ($1).toString(16) + ', iovcnt=' + $2 + ', offset=' + $3 + ')'), fd, iov, iovcnt, offset_low);
+
+	FileDescriptor *desc = (FileDescriptor*)fd;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
+	if ((desc->flags & O_ACCMODE) == O_RDONLY) RETURN_ERRNO(EBADF, "fd is not open for writing");
+
+	inode *node = desc->node;
+	if (!node) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
+	if (node->type != INODE_FILE) RETURN_ERRNO(EINVAL, "fd is attached to an object which is unsuitable for writing");
+
+	if (iovcnt < 0) RETURN_ERRNO(EINVAL, "The vector count, iovcnt, is less than zero");
+	ssize_t total_write_amount = total_iovec_length(iov, iovcnt);
+	if (total_write_amount < 0) RETURN_ERRNO(EINVAL, "The sum of the iov_len values overflows an ssize_t value, or iov_len specifies a positive length buffer but iov_base is a null pointer");
+	int64_t offset = (int64_t)(((uint64_t)offset_high << 32) | offset_low);
+	if (offset < 0) RETURN_ERRNO(EINVAL, "offset is negative");
+	if (offset + total_write_amount > SIZE_MAX) RETURN_ERRNO(EFBIG, "The file would grow past the maximum file size");
+
+	if (!finish_file_fetch(node, (desc->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "The file descriptor fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	return write_file(node, (size_t)offset, iov, iovcnt, total_write_amount);
+}
+long __syscall187(int which, ...) // sendfile
+{
+	va_list vl;
+	va_start(vl, which);
+	int out_fd = va_arg(vl, int);
+	int in_fd = va_arg(vl, int);
+	off_t *offset = va_arg(vl, off_t*);
+	size_t count = va_arg(vl, size_t);
+	va_end(vl);
+	TRACE(Module['printErr']('sendfile(out_fd=' + $0 + ', in_fd=' + $1 + ', offset=0x' + ($2).toString(16) + ', count=' + $3 + ')'), out_fd, in_fd, offset, count);
+
+	FileDescriptor *in = (FileDescriptor*)in_fd;
+	FileDescriptor *out = (FileDescriptor*)out_fd;
+	if (!in || in->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "in_fd isn't a valid open file descriptor");
+	if ((in->flags & O_ACCMODE) == O_WRONLY) RETURN_ERRNO(EBADF, "in_fd is not open for reading");
+	// TODO: Support copying to stdout and stderr.
+	if (!out || out->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "out_fd isn't a valid open file descriptor");
+	if ((out->flags & O_ACCMODE) == O_RDONLY) RETURN_ERRNO(EBADF, "out_fd is not open for writing");
+
+	inode *src = in->node, *dst = out->node;
+	if (!src || !dst) RETURN_ERRNO(-1, "ASMFS internal error: file descriptor points to a non-file");
+	if (src->type != INODE_FILE) RETURN_ERRNO(EINVAL, "in_fd is attached to an object which is unsuitable for reading");
+	if (dst->type != INODE_FILE) RETURN_ERRNO(EINVAL, "out_fd is attached to an object which is unsuitable for writing");
+	if (src == dst) RETURN_ERRNO(EINVAL, "in_fd and out_fd refer to the same file");
+	if ((ssize_t)count < 0) RETURN_ERRNO(EINVAL, "count does not fit in an ssize_t");
+	if (offset && *offset < 0) RETURN_ERRNO(EINVAL, "offset is negative");
+
+	if (!finish_file_fetch(src, (in->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "in_fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (!finish_file_fetch(dst, (out->flags & O_NONBLOCK) ? 0 : INFINITY)) RETURN_ERRNO(EAGAIN, "out_fd has been marked nonblocking (O_NONBLOCK), and the file has not been downloaded yet");
+	if (src->fetch_failed || dst->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+
+	// Without an offset, the copy reads from the file position of in_fd and moves it. The positions of the two descriptors are
+	// locked in address order, like the files.
+	FileDescriptor *first = (offset || out < in) ? out : in;
+	FileDescriptor *second = offset ? 0 : (out < in ? in : out);
+	pthread_mutex_lock(&first->pos_lock);
+	if (second) pthread_mutex_lock(&second->pos_lock);
+	size_t src_offset = offset ? (size_t)*offset : in->file_pos;
+	ssize_t numCopied = (offset && (uint64_t)*offset > SIZE_MAX) ? 0 : copy_file(src, src_offset, dst, out->file_pos, count);
+	if (numCopied > 0)
+	{
+		if (offset) *offset += numCopied;
+		else in->file_pos += numCopied;
+		out->file_pos += numCopied;
+	}
+	if (second) pthread_mutex_unlock(&second->pos_lock);
+	pthread_mutex_unlock(&first->pos_lock);
+	return numCopied;
+}
 
 long __syscall183(int which, ...) // getcwd
 {
@@ -1271,7 +2765,7 @@ long __syscall183(int which, ...) // getcwd
 	char *buf = va_arg(vl, char *);
 	size_t size = va_arg(vl, size_t);
 	va_end(vl);
-	EM_ASM(Module['printErr']('getcwd(buf=0x' + $0 + ', size= ' + $1 + ')'), buf, size);
+	TRACE(Module['printErr']('getcwd(buf=0x' + $0 + ', size= ' + $1 + ')'), buf, size);
 
 	if (!buf && size > 0) RETURN_ERRNO(EFAULT, "buf points to a bad address");
 	if (buf && size == 0) RETURN_ERRNO(EINVAL, "The size argument is zero and buf is not a null pointer");
@@ -1286,12 +2780,113 @@ long __syscall183(int which, ...) // getcwd
 	return 0;
 }
 
-// TODO: syscall192: mmap2
+// Points a new mapping into the downloaded data of the file, or allocates it and copies the file contents to it.
+// Called with the file locked exclusively, unless the mapping is anonymous. Returns an errno, or 0 on success.
+static int fill_file_mapping(FileMapping *m)
+{
+	inode *node = m->node;
+	size_t offset = m->offset, len = m->len;
+	if (node)
+	{
+		if (node->fetch) emscripten_fetch_wait(node->fetch, INFINITY);
+		size_t end = offset + len < node->size ? offset + len : node->size;
+		int err = offset < end ? load_file_range(node, offset, end, 0) : 0;
+		if (err) return err;
+
+		// A private read-only mapping of downloaded data that has not been written to since can point straight into it.
+		size_t fetched_len;
+		uint8_t *fetched = fetched_data(node, offset, &fetched_len);
+		if (fetched && !(m->prot & PROT_WRITE) && (m->flags & MAP_PRIVATE) && fetched_len >= len && offset + len <= node->size)
+		{
+			size_t index = offset / FILE_CHUNK_SIZE;
+			while(index * FILE_CHUNK_SIZE < offset + len && (index >= node->num_chunks || !node->chunks[index])) ++index;
+			if (index * FILE_CHUNK_SIZE >= offset + len)
+			{
+				m->addr = fetched;
+				m->fetch = node->fetch; // Preloaded data stays in memory, so only a download needs to be kept for the mapping.
+				return 0;
+			}
+		}
+	}
+
+	m->addr = (uint8_t*)memalign(MMAP_ALIGNMENT, len);
+	if (!m->addr) return ENOMEM;
+	m->allocated = true;
+	size_t file_len = node && offset < node->size ? node->size - offset : 0;
+	if (file_len > len) file_len = len;
+	if (file_len) read_file_data(node, offset, m->addr, file_len);
+	memset(m->addr + file_len, 0, len - file_len);
+	return 0;
+}
+
+long __syscall192(int which, ...) // mmap2
+{
+	va_list vl;
+	va_start(vl, which);
+	void *addr = va_arg(vl, void*);
+	size_t len = va_arg(vl, size_t);
+	int prot = va_arg(vl, int);
+	int flags = va_arg(vl, int);
+	int fd = va_arg(vl, int);
+	size_t offset = (size_t)va_arg(vl, long) * MMAP2_UNIT;
+	va_end(vl);
+	TRACE(Module['printErr']('mmap2(addr=0x' + ($0).toString(16) + ', len=' + $1 + ', prot=' + $2 + ', flags=' + $3 + ', fd=' + $4 + ', offset=' + $5 + ')'), addr, len, prot, flags, fd, offset);
+
+	if (len == 0) RETURN_ERRNO(EINVAL, "length was 0");
+	if (!(flags & (MAP_PRIVATE | MAP_SHARED))) RETURN_ERRNO(EINVAL, "flags contained neither MAP_PRIVATE or MAP_SHARED");
+	if (flags & MAP_FIXED) RETURN_ERRNO(EINVAL, "MAP_FIXED is not supported"); // There is no virtual memory to place mappings to a given address.
+
+	inode *node = 0;
+	if (!(flags & MAP_ANONYMOUS))
+	{
+		FileDescriptor *desc = (FileDescriptor*)fd;
+		if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd is not a valid file descriptor");
+		node = desc->node;
+		if (!node || node->type != INODE_FILE) RETURN_ERRNO(ENODEV, "The underlying filesystem of the specified file does not support memory mapping");
+		int accessMode = (desc->flags & O_ACCMODE);
+		if (accessMode == O_WRONLY) RETURN_ERRNO(EACCES, "fd is not open for reading");
+		if ((flags & MAP_SHARED) && (prot & PROT_WRITE) && accessMode != O_RDWR) RETURN_ERRNO(EACCES, "MAP_SHARED was requested and PROT_WRITE is set, but fd is not open in read/write (O_RDWR) mode");
+
+		finish_file_fetch(node, INFINITY);
+		if (node->fetch_failed) RETURN_ERRNO(EIO, "The file was opened with O_NONBLOCK, and it turned out not to exist");
+	}
+
+	FileMapping *m = (FileMapping*)malloc(sizeof(FileMapping));
+	if (!m) RETURN_ERRNO(ENOMEM, "Out of memory for the mapping");
+	m->len = len;
+	m->prot = prot;
+	m->flags = flags;
+	m->node = node;
+	m->offset = offset;
+	m->fetch = 0;
+	m->allocated = false;
+
+	// The mapping is published before the file is unlocked, so that the file does not close a download that it points into.
+	if (node) pthread_rwlock_wrlock(&node->lock);
+	int err = fill_file_mapping(m);
+	if (!err)
+	{
+		lock_filesystem_tree();
+		m->next = file_mappings;
+		file_mappings = m;
+		unlock_filesystem_tree();
+	}
+	if (node) pthread_rwlock_unlock(&node->lock);
+	if (err)
+	{
+		free(m);
+		if (err == EIO) RETURN_ERRNO(EIO, "Downloading the file contents with a Range request failed");
+		RETURN_ERRNO(ENOMEM, "Out of memory for the mapping");
+	}
+	return (long)m->addr;
+}
+
 // TODO: syscall193: truncate64
 // TODO: syscall194: ftruncate64
 
 static long __stat64(inode *node, struct stat *buf)
 {
+	finish_file_fetch(node, INFINITY);
 	buf->st_dev = 1; // ID of device containing file: Hardcode 1 for now, no meaning at the moment for Emscripten.
 	buf->st_ino = (ino_t)node; // TODO: This needs to be an inode ID number proper.
 	buf->st_mode = node->mode;
@@ -1310,8 +2905,10 @@ static long __stat64(inode *node, struct stat *buf)
 	buf->st_uid = node->uid;
 	buf->st_gid = node->gid;
 	buf->st_rdev = 1; // Device ID (if special file) No meaning right now for Emscripten.
-	buf->st_size = node->fetch ? node->fetch->totalBytes : 0;
+	pthread_rwlock_rdlock(&node->lock);
+	buf->st_size = node->fetch ? node->fetch->totalBytes : (node->url ? node->size : 0);
 	if (node->size > buf->st_size) buf->st_size = node->size;
+	pthread_rwlock_unlock(&node->lock);
 	buf->st_blocks = (buf->st_size + 511) / 512; // The syscall docs state this is hardcoded to # of 512 byte blocks.
 	buf->st_blksize = 1024*1024; // Specifies the preferred blocksize for efficient disk I/O.
 	buf->st_atim.tv_sec = node->atime;
@@ -1327,7 +2924,7 @@ long __syscall195(int which, ...) // SYS_stat64
 	const char *pathname = va_arg(vl, const char *);
 	struct stat *buf = va_arg(vl, struct stat *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('SYS_stat64(pathname="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), pathname, buf);
+	TRACE(Module['printErr']('SYS_stat64(pathname="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), pathname, buf);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -1364,7 +2961,7 @@ long __syscall196(int which, ...) // SYS_lstat64
 	const char *pathname = va_arg(vl, const char *);
 	struct stat *buf = va_arg(vl, struct stat *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('SYS_lstat64(pathname="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), pathname, buf);
+	TRACE(Module['printErr']('SYS_lstat64(pathname="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), pathname, buf);
 
 	int len = strlen(pathname);
 	if (len > MAX_PATHNAME_LENGTH) RETURN_ERRNO(ENAMETOOLONG, "pathname was too long");
@@ -1393,7 +2990,7 @@ long __syscall197(int which, ...) // SYS_fstat64
 	int fd = va_arg(vl, int);
 	struct stat *buf = va_arg(vl, struct stat *);
 	va_end(vl);
-	EM_ASM(Module['printErr']('SYS_fstat64(fd="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), fd, buf);
+	TRACE(Module['printErr']('SYS_fstat64(fd="' + Pointer_stringify($0) + '", buf=0x' + ($1).toString(16) + ')'), fd, buf);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "fd isn't a valid open file descriptor");
@@ -1419,7 +3016,7 @@ long __syscall220(int which, ...) // getdents64 (get directory entries 64-bit)
 	va_end(vl);
 	unsigned int dirents_size = count / sizeof(dirent); // The number of dirent structures that can fit into the provided buffer.
 	dirent *de_end = de + dirents_size;
-	EM_ASM(Module['printErr']('getdents64(fd=' + $0 + ', de=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, de, count);
+	TRACE(Module['printErr']('getdents64(fd=' + $0 + ', de=0x' + ($1).toString(16) + ', count=' + $2 + ')'), fd, de, count);
 
 	FileDescriptor *desc = (FileDescriptor*)fd;
 	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) RETURN_ERRNO(EBADF, "Invalid file descriptor fd");
@@ -1500,7 +3097,92 @@ long __syscall220(int which, ...) // getdents64 (get directory entries 64-bit)
 // TODO: syscall324: fallocate
 // TODO: syscall330: dup3
 // TODO: syscall331: pipe2
-// TODO: syscall333: preadv
-// TODO: syscall334: pwritev
+
+// POSIX asynchronous reads. A read stays in progress for as long as the download that a non-blocking open() started for its
+// file, so a thread can keep many downloads going at once, and handle them in the order they finish. The read itself is
+// carried out when aio_error() or aio_suspend() finds that the download has finished. Completion is not notified with
+// signals or threads.
+
+// Carries out the read, if the download of its file finishes within timeout_msecs. Returns false if it is still in progress.
+static bool complete_aio(struct aiocb *cb, double timeout_msecs)
+{
+	if (cb->__err != EINPROGRESS) return true;
+	inode *node = ((FileDescriptor*)cb->aio_fildes)->node;
+	if (!finish_file_fetch(node, timeout_msecs)) return false;
+	ssize_t ret = -EIO;
+	if (!node->fetch_failed)
+	{
+		iovec io = { (void*)cb->aio_buf, cb->aio_nbytes };
+		ret = read_file(node, cb->aio_offset, &io, 1, cb->aio_nbytes, 0);
+	}
+	cb->__ret = ret < 0 ? -1 : ret;
+	cb->__err = ret < 0 ? -ret : 0;
+	return true;
+}
+
+int aio_read(struct aiocb *cb)
+{
+	TRACE(Module['printErr']('aio_read(fd=' + $0 + ', buf=0x' + ($1).toString(16) + ', nbytes=' + $2 + ', offset=' + $3 + ')'),
+		cb->aio_fildes, cb->aio_buf, cb->aio_nbytes, cb->aio_offset);
+
+	FileDescriptor *desc = (FileDescriptor*)cb->aio_fildes;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) { errno = EBADF; return -1; }
+	if (!desc->node || desc->node->type != INODE_FILE || cb->aio_offset < 0) { errno = EINVAL; return -1; }
+	// A zero initialized aiocb asks for signal 0, which is no signal.
+	if (cb->aio_sigevent.sigev_notify == SIGEV_THREAD || (cb->aio_sigevent.sigev_notify == SIGEV_SIGNAL && cb->aio_sigevent.sigev_signo != 0))
+	{
+		errno = EINVAL; // TODO: Notifying of completion with signals or threads is not supported in ASMFS
+		return -1;
+	}
+
+	cb->__ret = 0;
+	cb->__err = EINPROGRESS;
+	complete_aio(cb, 0);
+	return 0;
+}
+
+int aio_error(const struct aiocb *cb)
+{
+	complete_aio((struct aiocb*)cb, 0);
+	return cb->__err;
+}
+
+ssize_t aio_return(struct aiocb *cb)
+{
+	return cb->__ret;
+}
+
+int aio_suspend(const struct aiocb *const cbs[], int cnt, const struct timespec *timeout)
+{
+	double waitEnd = timeout ? emscripten_get_now() + timeout->tv_sec * 1000.0 + timeout->tv_nsec / 1000000.0 : INFINITY;
+	for(;;)
+	{
+		struct aiocb *pending = 0;
+		for(int i = 0; i < cnt; ++i)
+		{
+			if (!cbs[i]) continue;
+			if (complete_aio((struct aiocb*)cbs[i], 0)) return 0;
+			if (!pending) pending = (struct aiocb*)cbs[i];
+		}
+		double timeLeft = waitEnd - emscripten_get_now();
+		if (!pending || timeLeft <= 0)
+		{
+			errno = EAGAIN;
+			return -1;
+		}
+		// Wait for one of the downloads for a while, and then check all of them again.
+		complete_aio(pending, timeLeft < 10 ? timeLeft : 10);
+	}
+}
+
+int aio_cancel(int fd, struct aiocb *cb)
+{
+	FileDescriptor *desc = (FileDescriptor*)fd;
+	if (!desc || desc->magic != EM_FILEDESCRIPTOR_MAGIC) { errno = EBADF; return -1; }
+	if (cb && cb->aio_fildes != fd) { errno = EINVAL; return -1; }
+	// Downloads are shared by all the reads of a file, so they are never cancelled.
+	bool done = cb ? complete_aio(cb, 0) : finish_file_fetch(desc->node, 0);
+	return done ? AIO_ALLDONE : AIO_NOTCANCELED;
+}
 
 } // ~extern "C"
@@ -7,13 +7,25 @@
 #include <emscripten/emscripten.h>
 #include <math.h>
 
+// Fetches that are proxied to the fetch worker are passed to it through a bounded ring buffer that any number of threads
+// may push to, and that only src/fetch-worker.js pops from. Producers claim a slot by advancing head, and publish the fetch
+// by storing it in the slot. The fetch worker clears each slot it consumes before advancing tail, so a zero slot between
+// tail and head is one that a producer has claimed but not yet filled in.
+#define FETCH_WORK_QUEUE_SIZE 1024 // Must be a power of two.
+
 struct __emscripten_fetch_queue
 {
 	emscripten_fetch_t **queuedOperations;
-	int numQueuedItems;
-	int queueSize;
+	uint32_t head; // Next slot to be claimed by a producer.
+	uint32_t tail; // Next slot to be consumed by the fetch worker.
+	uint32_t queueSize;
+	// Incremented by the fetch worker each time it finishes a fetch, after it has updated the __proxyState of the fetch.
+	// Threads that wait for fetches sleep on this, so that one wait covers any number of fetches.
+	uint32_t numFinished;
 };
 
+static emscripten_fetch_t *fetchWorkQueueStorage[FETCH_WORK_QUEUE_SIZE];
+
 extern "C" {
 	void emscripten_start_fetch(emscripten_fetch_t *fetch);
 	__emscripten_fetch_queue *_emscripten_get_fetch_work_queue();
@@ -21,11 +33,11 @@ extern "C" {
 	__emscripten_fetch_queue *_emscripten_get_fetch_queue()
 	{
 		__emscripten_fetch_queue *queue = _emscripten_get_fetch_work_queue();
-		if (!queue->queuedOperations)
+		if (!emscripten_atomic_load_u32(&queue->queuedOperations))
 		{
-			queue->queueSize = 64;
-			queue->numQueuedItems = 0;
-			queue->queuedOperations = (emscripten_fetch_t**)malloc(sizeof(emscripten_fetch_t*) * queue->queueSize);
+			// The fetch worker ignores the queue until the storage pointer is set, so the size needs to be there first.
+			emscripten_atomic_store_u32(&queue->queueSize, FETCH_WORK_QUEUE_SIZE);
+			emscripten_atomic_cas_u32(&queue->queuedOperations, 0, (uint32_t)fetchWorkQueueStorage);
 		}
 		return queue;
 	}
@@ -33,13 +45,23 @@ extern "C" {
 
 void emscripten_proxy_fetch(emscripten_fetch_t *fetch)
 {
-	// TODO: mutex lock
 	__emscripten_fetch_queue *queue = _emscripten_get_fetch_queue();
-//	TODO handle case when queue->numQueuedItems >= queue->queueSize
-	queue->queuedOperations[queue->numQueuedItems++] = fetch;
-	EM_ASM(console.log('Queued fetch to fetch-worker to process. There are now ' + $0 + ' operations in the queue.'),
-		queue->numQueuedItems);
-	// TODO: mutex unlock
+	uint32_t head;
+	for(;;)
+	{
+		head = emscripten_atomic_load_u32(&queue->head);
+		uint32_t tail = emscripten_atomic_load_u32(&queue->tail);
+		if (head - tail >= FETCH_WORK_QUEUE_SIZE)
+		{
+			// The queue is full: wait for the fetch worker to consume something. It wakes us up when it advances tail,
+			// but also poll in case we went to sleep just after it did.
+			emscripten_futex_wait(&queue->tail, tail, 10);
+			continue;
+		}
+		if (emscripten_atomic_cas_u32(&queue->head, head, head + 1) == head)
+			break;
+	}
+	emscripten_atomic_store_u32(&queue->queuedOperations[head & (FETCH_WORK_QUEUE_SIZE - 1)], (uint32_t)fetch);
 }
 
 void emscripten_fetch_attr_init(emscripten_fetch_attr_t *fetch_attr)
@@ -47,7 +69,7 @@ void emscripten_fetch_attr_init(emscripten_fetch_attr_t *fetch_attr)
 	memset(fetch_attr, 0, sizeof(emscripten_fetch_attr_t));
 }
 
-static int globalFetchIdCounter = 1;
+static uint32_t globalFetchIdCounter = 1;
 emscripten_fetch_t *emscripten_fetch(emscripten_fetch_attr_t *fetch_attr, const char *url)
 {
 	if (!fetch_attr) return 0;
@@ -68,14 +90,23 @@ emscripten_fetch_t *emscripten_fetch(emscripten_fetch_attr_t *fetch_attr, const
 
 	emscripten_fetch_t *fetch = (emscripten_fetch_t *)malloc(sizeof(emscripten_fetch_t));
 	memset(fetch, 0, sizeof(emscripten_fetch_t));
-	fetch->id = globalFetchIdCounter++; // TODO: make this thread-safe!
+	fetch->id = emscripten_atomic_add_u32(&globalFetchIdCounter, 1);
 	fetch->userData = fetch_attr->userData;
 	fetch->url = strdup(url); // TODO: free
 	fetch->__attributes = *fetch_attr;
 	fetch->__attributes.destinationPath = fetch->__attributes.destinationPath ? strdup(fetch->__attributes.destinationPath) : 0; // TODO: free
 	fetch->__attributes.userName = fetch->__attributes.userName ? strdup(fetch->__attributes.userName) : 0; // TODO: free
 	fetch->__attributes.password = fetch->__attributes.password ? strdup(fetch->__attributes.password) : 0; // TODO: free
-	fetch->__attributes.requestHeaders = 0;// TODO:strdup(fetch->__attributes.requestHeaders);
+	if (fetch_attr->requestHeaders)
+	{
+		// The caller's array of headers may not outlive this call, so it is copied along with the other attributes.
+		int numHeaders = 0;
+		while(fetch_attr->requestHeaders[numHeaders]) ++numHeaders;
+		char **requestHeaders = (char**)malloc((numHeaders + 1) * sizeof(char*));
+		for(int i = 0; i < numHeaders; ++i) requestHeaders[i] = strdup(fetch_attr->requestHeaders[i]);
+		requestHeaders[numHeaders] = 0;
+		fetch->__attributes.requestHeaders = requestHeaders;
+	}
 	fetch->__attributes.overriddenMimeType = fetch->__attributes.overriddenMimeType ? strdup(fetch->__attributes.overriddenMimeType) : 0; // TODO: free
 
 #if __EMSCRIPTEN_PTHREADS__
@@ -97,34 +128,90 @@ emscripten_fetch_t *emscripten_fetch(emscripten_fetch_attr_t *fetch_attr, const
 	return fetch;
 }
 
-EMSCRIPTEN_RESULT emscripten_fetch_wait(emscripten_fetch_t *fetch, double timeoutMsecs)
+#if __EMSCRIPTEN_PTHREADS__
+// The fetch worker finishes a fetch by setting its __proxyState to 2 if it succeeded, or to 3 if it failed. The first
+// thread that waits for it afterwards runs its onsuccess() or onerror() handler, and moves it to 4 or 5, respectively,
+// so the handlers run on a thread of the application instead of on the fetch worker.
+static EMSCRIPTEN_RESULT fetch_finished(emscripten_fetch_t *fetch, uint32_t proxyState)
 {
+	if (proxyState == 2 || proxyState == 3)
+	{
+		if (emscripten_atomic_cas_u32(&fetch->__proxyState, proxyState, proxyState + 2) == proxyState)
+		{
+			void (*handler)(emscripten_fetch_t *fetch) = (proxyState == 2) ? fetch->__attributes.onsuccess : fetch->__attributes.onerror;
+			if (handler) handler(fetch); // This may close the fetch, so it is not accessed afterwards.
+		}
+		proxyState += 2;
+	}
+	return (proxyState == 4) ? EMSCRIPTEN_RESULT_SUCCESS : EMSCRIPTEN_RESULT_FAILED;
+}
+#endif
+
 #if __EMSCRIPTEN_PTHREADS__
-	if (!fetch) return EMSCRIPTEN_RESULT_INVALID_PARAM;
-	uint32_t proxyState = emscripten_atomic_load_u32(&fetch->__proxyState);
-	if (proxyState == 2) return EMSCRIPTEN_RESULT_SUCCESS; // already finished.
-	if (proxyState != 1) return EMSCRIPTEN_RESULT_INVALID_PARAM; // the fetch should be ongoing?
-// #ifdef FETCH_DEBUG
-	EM_ASM(console.log('fetch: emscripten_fetch_wait..'));
-// #endif
-	// TODO: timeoutMsecs is currently ignored. Return EMSCRIPTEN_RESULT_TIMED_OUT on timeout.
-	while(proxyState == 1/*sent to proxy worker*/)
+// Returns the index of the first of the given fetches that has finished, after running its handler, and stores its
+// result. Returns EMSCRIPTEN_RESULT_TIMED_OUT if none of them finishes in time, and EMSCRIPTEN_RESULT_INVALID_PARAM if
+// none of them is being run by the fetch worker.
+static int fetch_wait_any(emscripten_fetch_t * const *fetches, int numFetches, double timeoutMsecs, EMSCRIPTEN_RESULT *result)
+{
+	if (!fetches || numFetches <= 0) return EMSCRIPTEN_RESULT_INVALID_PARAM;
+	__emscripten_fetch_queue *queue = _emscripten_get_fetch_queue();
+	double waitEnd = emscripten_get_now() + timeoutMsecs;
+	for(;;)
 	{
-		emscripten_futex_wait(&fetch->__proxyState, proxyState, 100 /*TODO HACK:Sleep sometimes doesn't wake up?*/);//timeoutMsecs);
-		proxyState = emscripten_atomic_load_u32(&fetch->__proxyState);
+		// Read the counter before looking at the fetches: if one of them finishes after this, the wait below returns
+		// immediately.
+		uint32_t numFinished = emscripten_atomic_load_u32(&queue->numFinished);
+		bool pending = false;
+		for(int i = 0; i < numFetches; ++i)
+		{
+			if (!fetches[i]) continue;
+			uint32_t proxyState = emscripten_atomic_load_u32(&fetches[i]->__proxyState);
+			if (proxyState >= 2 && proxyState <= 5)
+			{
+				*result = fetch_finished(fetches[i], proxyState);
+				return i;
+			}
+			if (proxyState == 1/*sent to proxy worker*/) pending = true;
+		}
+		if (!pending) return EMSCRIPTEN_RESULT_INVALID_PARAM; // None of the fetches is waitable, or all of them have been closed.
+		double timeLeft = waitEnd - emscripten_get_now();
+		if (timeLeft <= 0) return EMSCRIPTEN_RESULT_TIMED_OUT;
+		emscripten_futex_wait(&queue->numFinished, numFinished, timeLeft);
 	}
-// #ifdef FETCH_DEBUG
-	EM_ASM(console.log('fetch: emscripten_fetch_wait done..'));
-// #endif
+}
+#endif
 
-	if (proxyState == 2) return EMSCRIPTEN_RESULT_SUCCESS;
-	else return EMSCRIPTEN_RESULT_FAILED;
+EMSCRIPTEN_RESULT emscripten_fetch_wait(emscripten_fetch_t *fetch, double timeoutMsecs)
+{
+#if __EMSCRIPTEN_PTHREADS__
+	if (!fetch) return EMSCRIPTEN_RESULT_INVALID_PARAM;
+	EMSCRIPTEN_RESULT result;
+	int ret = fetch_wait_any(&fetch, 1, timeoutMsecs, &result);
+	return (ret < 0) ? ret : result;
 #else
 	EM_ASM(console.error('fetch: emscripten_fetch_wait is not available when building without pthreads!'));
 	return EMSCRIPTEN_RESULT_FAILED;
 #endif
 }
 
+int emscripten_fetch_wait_any(emscripten_fetch_t * const *fetches, int numFetches, double timeoutMsecs)
+{
+#if __EMSCRIPTEN_PTHREADS__
+	EMSCRIPTEN_RESULT result;
+	return fetch_wait_any(fetches, numFetches, timeoutMsecs, &result);
+#else
+	EM_ASM(console.error('fetch: emscripten_fetch_wait_any is not available when building without pthreads!'));
+	return EMSCRIPTEN_RESULT_FAILED;
+#endif
+}
+
+EMSCRIPTEN_RESULT emscripten_fetch_get_timing(const emscripten_fetch_t *fetch, emscripten_fetch_timing_t *timing)
+{
+	if (!fetch || !timing) return EMSCRIPTEN_RESULT_INVALID_PARAM;
+	*timing = fetch->__timing;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
 EMSCRIPTEN_RESULT emscripten_fetch_close(emscripten_fetch_t *fetch)
 {
 	if (!fetch) return EMSCRIPTEN_RESULT_SUCCESS; // Closing null pointer is ok, same as with free().
@@ -145,7 +232,12 @@ EMSCRIPTEN_RESULT emscripten_fetch_close(emscripten_fetch_t *fetch)
 		fetch->__attributes.onerror(fetch);
 	}
 	fetch->id = 0;
-	free((void*)fetch->data);
+	if (!fetch->__attributes.destinationBuffer) free((void*)fetch->data);
+	if (fetch->__attributes.requestHeaders)
+	{
+		for(const char * const *header = fetch->__attributes.requestHeaders; *header; ++header) free((void*)*header);
+		free((void*)fetch->__attributes.requestHeaders);
+	}
 	free(fetch);
 	return EMSCRIPTEN_RESULT_SUCCESS;
 }
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <emscripten.h>
 
+#include "proc_address.h"
+
 #define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #include <GL/glext.h>
@@ -1540,8 +1542,196 @@ GLAPI void APIENTRY emscripten_glClearDepthf (GLclampf d);
 GLAPI void APIENTRY emscripten_glVertexAttribDivisor (GLuint index, GLuint divisor);
 
 
+static const proc_address_entry gl_procs[] = {
+  { "glPixelStorei", emscripten_glPixelStorei },
+  { "glGetString", emscripten_glGetString },
+  { "glGetIntegerv", emscripten_glGetIntegerv },
+  { "glGetFloatv", emscripten_glGetFloatv },
+  { "glGetBooleanv", emscripten_glGetBooleanv },
+  { "glGenTextures", emscripten_glGenTextures },
+  { "glDeleteTextures", emscripten_glDeleteTextures },
+  { "glCompressedTexImage2D", emscripten_glCompressedTexImage2D },
+  { "glCompressedTexSubImage2D", emscripten_glCompressedTexSubImage2D },
+  { "glTexImage2D", emscripten_glTexImage2D },
+  { "glTexSubImage2D", emscripten_glTexSubImage2D },
+  { "glReadPixels", emscripten_glReadPixels },
+  { "glBindTexture", emscripten_glBindTexture },
+  { "glGetTexParameterfv", emscripten_glGetTexParameterfv },
+  { "glGetTexParameteriv", emscripten_glGetTexParameteriv },
+  { "glTexParameterfv", emscripten_glTexParameterfv },
+  { "glTexParameteriv", emscripten_glTexParameteriv },
+  { "glIsTexture", emscripten_glIsTexture },
+  { "glGenBuffers", emscripten_glGenBuffers },
+  { "glDeleteBuffers", emscripten_glDeleteBuffers },
+  { "glGetBufferParameteriv", emscripten_glGetBufferParameteriv },
+  { "glBufferData", emscripten_glBufferData },
+  { "glBufferSubData", emscripten_glBufferSubData },
+  { "glIsBuffer", emscripten_glIsBuffer },
+  { "glGenRenderbuffers", emscripten_glGenRenderbuffers },
+  { "glDeleteRenderbuffers", emscripten_glDeleteRenderbuffers },
+  { "glBindRenderbuffer", emscripten_glBindRenderbuffer },
+  { "glGetRenderbufferParameteriv", emscripten_glGetRenderbufferParameteriv },
+  { "glIsRenderbuffer", emscripten_glIsRenderbuffer },
+  { "glGetUniformfv", emscripten_glGetUniformfv },
+  { "glGetUniformiv", emscripten_glGetUniformiv },
+  { "glGetUniformLocation", emscripten_glGetUniformLocation },
+  { "glGetVertexAttribfv", emscripten_glGetVertexAttribfv },
+  { "glGetVertexAttribiv", emscripten_glGetVertexAttribiv },
+  { "glGetVertexAttribPointerv", emscripten_glGetVertexAttribPointerv },
+  { "glGetActiveUniform", emscripten_glGetActiveUniform },
+  { "glUniform1f", emscripten_glUniform1f },
+  { "glUniform2f", emscripten_glUniform2f },
+  { "glUniform3f", emscripten_glUniform3f },
+  { "glUniform4f", emscripten_glUniform4f },
+  { "glUniform1i", emscripten_glUniform1i },
+  { "glUniform2i", emscripten_glUniform2i },
+  { "glUniform3i", emscripten_glUniform3i },
+  { "glUniform4i", emscripten_glUniform4i },
+  { "glUniform1iv", emscripten_glUniform1iv },
+  { "glUniform2iv", emscripten_glUniform2iv },
+  { "glUniform3iv", emscripten_glUniform3iv },
+  { "glUniform4iv", emscripten_glUniform4iv },
+  { "glUniform1fv", emscripten_glUniform1fv },
+  { "glUniform2fv", emscripten_glUniform2fv },
+  { "glUniform3fv", emscripten_glUniform3fv },
+  { "glUniform4fv", emscripten_glUniform4fv },
+  { "glUniformMatrix2fv", emscripten_glUniformMatrix2fv },
+  { "glUniformMatrix3fv", emscripten_glUniformMatrix3fv },
+  { "glUniformMatrix4fv", emscripten_glUniformMatrix4fv },
+  { "glBindBuffer", emscripten_glBindBuffer },
+  { "glVertexAttrib1fv", emscripten_glVertexAttrib1fv },
+  { "glVertexAttrib2fv", emscripten_glVertexAttrib2fv },
+  { "glVertexAttrib3fv", emscripten_glVertexAttrib3fv },
+  { "glVertexAttrib4fv", emscripten_glVertexAttrib4fv },
+  { "glGetAttribLocation", emscripten_glGetAttribLocation },
+  { "glGetActiveAttrib", emscripten_glGetActiveAttrib },
+  { "glCreateShader", emscripten_glCreateShader },
+  { "glDeleteShader", emscripten_glDeleteShader },
+  { "glGetAttachedShaders", emscripten_glGetAttachedShaders },
+  { "glShaderSource", emscripten_glShaderSource },
+  { "glGetShaderSource", emscripten_glGetShaderSource },
+  { "glCompileShader", emscripten_glCompileShader },
+  { "glGetShaderInfoLog", emscripten_glGetShaderInfoLog },
+  { "glGetShaderiv", emscripten_glGetShaderiv },
+  { "glGetProgramiv", emscripten_glGetProgramiv },
+  { "glIsShader", emscripten_glIsShader },
+  { "glCreateProgram", emscripten_glCreateProgram },
+  { "glDeleteProgram", emscripten_glDeleteProgram },
+  { "glAttachShader", emscripten_glAttachShader },
+  { "glDetachShader", emscripten_glDetachShader },
+  { "glGetShaderPrecisionFormat", emscripten_glGetShaderPrecisionFormat },
+  { "glLinkProgram", emscripten_glLinkProgram },
+  { "glGetProgramInfoLog", emscripten_glGetProgramInfoLog },
+  { "glUseProgram", emscripten_glUseProgram },
+  { "glValidateProgram", emscripten_glValidateProgram },
+  { "glIsProgram", emscripten_glIsProgram },
+  { "glBindAttribLocation", emscripten_glBindAttribLocation },
+  { "glBindFramebuffer", emscripten_glBindFramebuffer },
+  { "glGenFramebuffers", emscripten_glGenFramebuffers },
+  { "glDeleteFramebuffers", emscripten_glDeleteFramebuffers },
+  { "glFramebufferRenderbuffer", emscripten_glFramebufferRenderbuffer },
+  { "glFramebufferTexture2D", emscripten_glFramebufferTexture2D },
+  { "glGetFramebufferAttachmentParameteriv", emscripten_glGetFramebufferAttachmentParameteriv },
+  { "glIsFramebuffer", emscripten_glIsFramebuffer },
+  { "glDeleteObject", emscripten_glDeleteObjectARB },
+  { "glGetObjectParameteriv", emscripten_glGetObjectParameterivARB },
+  { "glGetInfoLog", emscripten_glGetInfoLogARB },
+  { "glBindProgram", emscripten_glBindProgramARB },
+  { "glGetPointerv", emscripten_glGetPointerv },
+  { "glDrawRangeElements", emscripten_glDrawRangeElements },
+  { "glEnableClientState", emscripten_glEnableClientState },
+  { "glVertexPointer", emscripten_glVertexPointer },
+  { "glTexCoordPointer", emscripten_glTexCoordPointer },
+  { "glNormalPointer", emscripten_glNormalPointer },
+  { "glColorPointer", emscripten_glColorPointer },
+  { "glClientActiveTexture", emscripten_glClientActiveTexture },
+  { "glIsVertexArray", emscripten_glIsVertexArray },
+  { "glGenVertexArrays", emscripten_glGenVertexArrays },
+  { "glDeleteVertexArrays", emscripten_glDeleteVertexArrays },
+  { "glBindVertexArray", emscripten_glBindVertexArray },
+  { "glMatrixMode", emscripten_glMatrixMode },
+  { "glLoadIdentity", emscripten_glLoadIdentity },
+  { "glLoadMatrixf", emscripten_glLoadMatrixf },
+  { "glFrustum", emscripten_glFrustum },
+  { "glRotatef", emscripten_glRotatef },
+  { "glVertexAttribPointer", emscripten_glVertexAttribPointer },
+  { "glEnableVertexAttribArray", emscripten_glEnableVertexAttribArray },
+  { "glDisableVertexAttribArray", emscripten_glDisableVertexAttribArray },
+  { "glDrawArrays", emscripten_glDrawArrays },
+  { "glDrawElements", emscripten_glDrawElements },
+  { "glShaderBinary", emscripten_glShaderBinary },
+  { "glReleaseShaderCompiler", emscripten_glReleaseShaderCompiler },
+  { "glGetError", emscripten_glGetError },
+  { "glVertexAttribDivisor", emscripten_glVertexAttribDivisor },
+  { "glDrawArraysInstanced", emscripten_glDrawArraysInstanced },
+  { "glDrawElementsInstanced", emscripten_glDrawElementsInstanced },
+  { "glFinish", emscripten_glFinish },
+  { "glFlush", emscripten_glFlush },
+  { "glClearDepth", emscripten_glClearDepth },
+  { "glClearDepthf", emscripten_glClearDepthf },
+  { "glDepthFunc", emscripten_glDepthFunc },
+  { "glEnable", emscripten_glEnable },
+  { "glDisable", emscripten_glDisable },
+  { "glFrontFace", emscripten_glFrontFace },
+  { "glCullFace", emscripten_glCullFace },
+  { "glClear", emscripten_glClear },
+  { "glLineWidth", emscripten_glLineWidth },
+  { "glClearStencil", emscripten_glClearStencil },
+  { "glDepthMask", emscripten_glDepthMask },
+  { "glStencilMask", emscripten_glStencilMask },
+  { "glCheckFramebufferStatus", emscripten_glCheckFramebufferStatus },
+  { "glGenerateMipmap", emscripten_glGenerateMipmap },
+  { "glActiveTexture", emscripten_glActiveTexture },
+  { "glBlendEquation", emscripten_glBlendEquation },
+  { "glIsEnabled", emscripten_glIsEnabled },
+  { "glBlendFunc", emscripten_glBlendFunc },
+  { "glBlendEquationSeparate", emscripten_glBlendEquationSeparate },
+  { "glDepthRange", emscripten_glDepthRange },
+  { "glDepthRangef", emscripten_glDepthRangef },
+  { "glStencilMaskSeparate", emscripten_glStencilMaskSeparate },
+  { "glHint", emscripten_glHint },
+  { "glPolygonOffset", emscripten_glPolygonOffset },
+  { "glVertexAttrib1f", emscripten_glVertexAttrib1f },
+  { "glSampleCoverage", emscripten_glSampleCoverage },
+  { "glTexParameteri", emscripten_glTexParameteri },
+  { "glTexParameterf", emscripten_glTexParameterf },
+  { "glVertexAttrib2f", emscripten_glVertexAttrib2f },
+  { "glStencilFunc", emscripten_glStencilFunc },
+  { "glStencilOp", emscripten_glStencilOp },
+  { "glViewport", emscripten_glViewport },
+  { "glClearColor", emscripten_glClearColor },
+  { "glScissor", emscripten_glScissor },
+  { "glVertexAttrib3f", emscripten_glVertexAttrib3f },
+  { "glColorMask", emscripten_glColorMask },
+  { "glRenderbufferStorage", emscripten_glRenderbufferStorage },
+  { "glBlendFuncSeparate", emscripten_glBlendFuncSeparate },
+  { "glBlendColor", emscripten_glBlendColor },
+  { "glStencilFuncSeparate", emscripten_glStencilFuncSeparate },
+  { "glStencilOpSeparate", emscripten_glStencilOpSeparate },
+  { "glVertexAttrib4f", emscripten_glVertexAttrib4f },
+  { "glCopyTexImage2D", emscripten_glCopyTexImage2D },
+  { "glCopyTexSubImage2D", emscripten_glCopyTexSubImage2D },
+  { "glDrawBuffers", emscripten_glDrawBuffers },
+  // misc renamings
+  { "glCreateProgramObject", emscripten_glCreateProgram },
+  { "glUseProgramObject", emscripten_glUseProgram },
+  { "glCreateShaderObject", emscripten_glCreateShader },
+  { "glAttachObject", emscripten_glAttachShader },
+  { "glDetachObject", emscripten_glDetachShader },
+};
+
+static unsigned short gl_proc_slots[512];
+
+static proc_address_table gl_proc_table = {
+  gl_procs, sizeof(gl_procs) / sizeof(gl_procs[0]), gl_proc_slots, sizeof(gl_proc_slots) / sizeof(gl_proc_slots[0]), 0
+};
+
 void* emscripten_GetProcAddress(const char *name_) {
-  char *name = malloc(strlen(name_)+1);
+  char name[128];
+  if (strlen(name_) >= sizeof(name)) {
+    EM_ASM(Module.printErr('bad name in getProcAddress: ' + Pointer_stringify($0)), name_);
+    return 0;
+  }
   strcpy(name, name_);
   // remove EXT|ARB|OES|ANGLE suffixes
   char *end = strstr(name, "EXT");
@@ -1552,184 +1742,9 @@ void* emscripten_GetProcAddress(const char *name_) {
   if (end) *end = 0;
   end = strstr(name, "ANGLE");
   if (end) *end = 0;
-  // misc renamings
-  if (!strcmp(name, "glCreateProgramObject")) name = "glCreateProgram";
-  else if (!strcmp(name, "glUseProgramObject")) name = "glUseProgram";
-  else if (!strcmp(name, "glCreateShaderObject")) name = "glCreateShader";
-  else if (!strcmp(name, "glAttachObject")) name = "glAttachShader";
-  else if (!strcmp(name, "glDetachObject")) name = "glDetachShader";
-  // main list
-  if (!strcmp(name, "glPixelStorei")) return emscripten_glPixelStorei;
-  else if (!strcmp(name, "glGetString")) return emscripten_glGetString;
-  else if (!strcmp(name, "glGetIntegerv")) return emscripten_glGetIntegerv;
-  else if (!strcmp(name, "glGetFloatv")) return emscripten_glGetFloatv;
-  else if (!strcmp(name, "glGetBooleanv")) return emscripten_glGetBooleanv;
-  else if (!strcmp(name, "glGenTextures")) return emscripten_glGenTextures;
-  else if (!strcmp(name, "glDeleteTextures")) return emscripten_glDeleteTextures;
-  else if (!strcmp(name, "glCompressedTexImage2D")) return emscripten_glCompressedTexImage2D;
-  else if (!strcmp(name, "glCompressedTexSubImage2D")) return emscripten_glCompressedTexSubImage2D;
-  else if (!strcmp(name, "glTexImage2D")) return emscripten_glTexImage2D;
-  else if (!strcmp(name, "glTexSubImage2D")) return emscripten_glTexSubImage2D;
-  else if (!strcmp(name, "glReadPixels")) return emscripten_glReadPixels;
-  else if (!strcmp(name, "glBindTexture")) return emscripten_glBindTexture;
-  else if (!strcmp(name, "glGetTexParameterfv")) return emscripten_glGetTexParameterfv;
-  else if (!strcmp(name, "glGetTexParameteriv")) return emscripten_glGetTexParameteriv;
-  else if (!strcmp(name, "glTexParameterfv")) return emscripten_glTexParameterfv;
-  else if (!strcmp(name, "glTexParameteriv")) return emscripten_glTexParameteriv;
-  else if (!strcmp(name, "glIsTexture")) return emscripten_glIsTexture;
-  else if (!strcmp(name, "glGenBuffers")) return emscripten_glGenBuffers;
-  else if (!strcmp(name, "glDeleteBuffers")) return emscripten_glDeleteBuffers;
-  else if (!strcmp(name, "glGetBufferParameteriv")) return emscripten_glGetBufferParameteriv;
-  else if (!strcmp(name, "glBufferData")) return emscripten_glBufferData;
-  else if (!strcmp(name, "glBufferSubData")) return emscripten_glBufferSubData;
-  else if (!strcmp(name, "glIsBuffer")) return emscripten_glIsBuffer;
-  else if (!strcmp(name, "glGenRenderbuffers")) return emscripten_glGenRenderbuffers;
-  else if (!strcmp(name, "glDeleteRenderbuffers")) return emscripten_glDeleteRenderbuffers;
-  else if (!strcmp(name, "glBindRenderbuffer")) return emscripten_glBindRenderbuffer;
-  else if (!strcmp(name, "glGetRenderbufferParameteriv")) return emscripten_glGetRenderbufferParameteriv;
-  else if (!strcmp(name, "glIsRenderbuffer")) return emscripten_glIsRenderbuffer;
-  else if (!strcmp(name, "glGetUniformfv")) return emscripten_glGetUniformfv;
-  else if (!strcmp(name, "glGetUniformiv")) return emscripten_glGetUniformiv;
-  else if (!strcmp(name, "glGetUniformLocation")) return emscripten_glGetUniformLocation;
-  else if (!strcmp(name, "glGetVertexAttribfv")) return emscripten_glGetVertexAttribfv;
-  else if (!strcmp(name, "glGetVertexAttribiv")) return emscripten_glGetVertexAttribiv;
-  else if (!strcmp(name, "glGetVertexAttribPointerv")) return emscripten_glGetVertexAttribPointerv;
-  else if (!strcmp(name, "glGetActiveUniform")) return emscripten_glGetActiveUniform;
-  else if (!strcmp(name, "glUniform1f")) return emscripten_glUniform1f;
-  else if (!strcmp(name, "glUniform2f")) return emscripten_glUniform2f;
-  else if (!strcmp(name, "glUniform3f")) return emscripten_glUniform3f;
-  else if (!strcmp(name, "glUniform4f")) return emscripten_glUniform4f;
-  else if (!strcmp(name, "glUniform1i")) return emscripten_glUniform1i;
-  else if (!strcmp(name, "glUniform2i")) return emscripten_glUniform2i;
-  else if (!strcmp(name, "glUniform3i")) return emscripten_glUniform3i;
-  else if (!strcmp(name, "glUniform4i")) return emscripten_glUniform4i;
-  else if (!strcmp(name, "glUniform1iv")) return emscripten_glUniform1iv;
-  else if (!strcmp(name, "glUniform2iv")) return emscripten_glUniform2iv;
-  else if (!strcmp(name, "glUniform3iv")) return emscripten_glUniform3iv;
-  else if (!strcmp(name, "glUniform4iv")) return emscripten_glUniform4iv;
-  else if (!strcmp(name, "glUniform1fv")) return emscripten_glUniform1fv;
-  else if (!strcmp(name, "glUniform2fv")) return emscripten_glUniform2fv;
-  else if (!strcmp(name, "glUniform3fv")) return emscripten_glUniform3fv;
-  else if (!strcmp(name, "glUniform4fv")) return emscripten_glUniform4fv;
-  else if (!strcmp(name, "glUniformMatrix2fv")) return emscripten_glUniformMatrix2fv;
-  else if (!strcmp(name, "glUniformMatrix3fv")) return emscripten_glUniformMatrix3fv;
-  else if (!strcmp(name, "glUniformMatrix4fv")) return emscripten_glUniformMatrix4fv;
-  else if (!strcmp(name, "glBindBuffer")) return emscripten_glBindBuffer;
-  else if (!strcmp(name, "glVertexAttrib1fv")) return emscripten_glVertexAttrib1fv;
-  else if (!strcmp(name, "glVertexAttrib2fv")) return emscripten_glVertexAttrib2fv;
-  else if (!strcmp(name, "glVertexAttrib3fv")) return emscripten_glVertexAttrib3fv;
-  else if (!strcmp(name, "glVertexAttrib4fv")) return emscripten_glVertexAttrib4fv;
-  else if (!strcmp(name, "glGetAttribLocation")) return emscripten_glGetAttribLocation;
-  else if (!strcmp(name, "glGetActiveAttrib")) return emscripten_glGetActiveAttrib;
-  else if (!strcmp(name, "glCreateShader")) return emscripten_glCreateShader;
-  else if (!strcmp(name, "glDeleteShader")) return emscripten_glDeleteShader;
-  else if (!strcmp(name, "glGetAttachedShaders")) return emscripten_glGetAttachedShaders;
-  else if (!strcmp(name, "glShaderSource")) return emscripten_glShaderSource;
-  else if (!strcmp(name, "glGetShaderSource")) return emscripten_glGetShaderSource;
-  else if (!strcmp(name, "glCompileShader")) return emscripten_glCompileShader;
-  else if (!strcmp(name, "glGetShaderInfoLog")) return emscripten_glGetShaderInfoLog;
-  else if (!strcmp(name, "glGetShaderiv")) return emscripten_glGetShaderiv;
-  else if (!strcmp(name, "glGetProgramiv")) return emscripten_glGetProgramiv;
-  else if (!strcmp(name, "glIsShader")) return emscripten_glIsShader;
-  else if (!strcmp(name, "glCreateProgram")) return emscripten_glCreateProgram;
-  else if (!strcmp(name, "glDeleteProgram")) return emscripten_glDeleteProgram;
-  else if (!strcmp(name, "glAttachShader")) return emscripten_glAttachShader;
-  else if (!strcmp(name, "glDetachShader")) return emscripten_glDetachShader;
-  else if (!strcmp(name, "glGetShaderPrecisionFormat")) return emscripten_glGetShaderPrecisionFormat;
-  else if (!strcmp(name, "glLinkProgram")) return emscripten_glLinkProgram;
-  else if (!strcmp(name, "glGetProgramInfoLog")) return emscripten_glGetProgramInfoLog;
-  else if (!strcmp(name, "glUseProgram")) return emscripten_glUseProgram;
-  else if (!strcmp(name, "glValidateProgram")) return emscripten_glValidateProgram;
-  else if (!strcmp(name, "glIsProgram")) return emscripten_glIsProgram;
-  else if (!strcmp(name, "glBindAttribLocation")) return emscripten_glBindAttribLocation;
-  else if (!strcmp(name, "glBindFramebuffer")) return emscripten_glBindFramebuffer;
-  else if (!strcmp(name, "glGenFramebuffers")) return emscripten_glGenFramebuffers;
-  else if (!strcmp(name, "glDeleteFramebuffers")) return emscripten_glDeleteFramebuffers;
-  else if (!strcmp(name, "glFramebufferRenderbuffer")) return emscripten_glFramebufferRenderbuffer;
-  else if (!strcmp(name, "glFramebufferTexture2D")) return emscripten_glFramebufferTexture2D;
-  else if (!strcmp(name, "glGetFramebufferAttachmentParameteriv")) return emscripten_glGetFramebufferAttachmentParameteriv;
-  else if (!strcmp(name, "glIsFramebuffer")) return emscripten_glIsFramebuffer;
-  else if (!strcmp(name, "glDeleteObject")) return emscripten_glDeleteObjectARB;
-  else if (!strcmp(name, "glGetObjectParameteriv")) return emscripten_glGetObjectParameterivARB;
-  else if (!strcmp(name, "glGetInfoLog")) return emscripten_glGetInfoLogARB;
-  else if (!strcmp(name, "glBindProgram")) return emscripten_glBindProgramARB;
-  else if (!strcmp(name, "glGetPointerv")) return emscripten_glGetPointerv;
-  else if (!strcmp(name, "glDrawRangeElements")) return emscripten_glDrawRangeElements;
-  else if (!strcmp(name, "glEnableClientState")) return emscripten_glEnableClientState;
-  else if (!strcmp(name, "glVertexPointer")) return emscripten_glVertexPointer;
-  else if (!strcmp(name, "glTexCoordPointer")) return emscripten_glTexCoordPointer;
-  else if (!strcmp(name, "glNormalPointer")) return emscripten_glNormalPointer;
-  else if (!strcmp(name, "glColorPointer")) return emscripten_glColorPointer;
-  else if (!strcmp(name, "glClientActiveTexture")) return emscripten_glClientActiveTexture;
-  else if (!strcmp(name, "glIsVertexArray")) return emscripten_glIsVertexArray;
-  else if (!strcmp(name, "glGenVertexArrays")) return emscripten_glGenVertexArrays;
-  else if (!strcmp(name, "glDeleteVertexArrays")) return emscripten_glDeleteVertexArrays;
-  else if (!strcmp(name, "glBindVertexArray")) return emscripten_glBindVertexArray;
-  else if (!strcmp(name, "glMatrixMode")) return emscripten_glMatrixMode;
-  else if (!strcmp(name, "glLoadIdentity")) return emscripten_glLoadIdentity;
-  else if (!strcmp(name, "glLoadMatrixf")) return emscripten_glLoadMatrixf;
-  else if (!strcmp(name, "glFrustum")) return emscripten_glFrustum;
-  else if (!strcmp(name, "glRotatef")) return emscripten_glRotatef;
-  else if (!strcmp(name, "glVertexAttribPointer")) return emscripten_glVertexAttribPointer;
-  else if (!strcmp(name, "glEnableVertexAttribArray")) return emscripten_glEnableVertexAttribArray;
-  else if (!strcmp(name, "glDisableVertexAttribArray")) return emscripten_glDisableVertexAttribArray;
-  else if (!strcmp(name, "glDrawArrays")) return emscripten_glDrawArrays;
-  else if (!strcmp(name, "glDrawElements")) return emscripten_glDrawElements;
-  else if (!strcmp(name, "glShaderBinary")) return emscripten_glShaderBinary;
-  else if (!strcmp(name, "glReleaseShaderCompiler")) return emscripten_glReleaseShaderCompiler;
-  else if (!strcmp(name, "glGetError")) return emscripten_glGetError;
-  else if (!strcmp(name, "glVertexAttribDivisor")) return emscripten_glVertexAttribDivisor;
-  else if (!strcmp(name, "glDrawArraysInstanced")) return emscripten_glDrawArraysInstanced;
-  else if (!strcmp(name, "glDrawElementsInstanced")) return emscripten_glDrawElementsInstanced;
-  else if (!strcmp(name, "glFinish")) return emscripten_glFinish;
-  else if (!strcmp(name, "glFlush")) return emscripten_glFlush;
-  else if (!strcmp(name, "glClearDepth")) return emscripten_glClearDepth;
-  else if (!strcmp(name, "glClearDepthf")) return emscripten_glClearDepthf;
-  else if (!strcmp(name, "glDepthFunc")) return emscripten_glDepthFunc;
-  else if (!strcmp(name, "glEnable")) return emscripten_glEnable;
-  else if (!strcmp(name, "glDisable")) return emscripten_glDisable;
-  else if (!strcmp(name, "glFrontFace")) return emscripten_glFrontFace;
-  else if (!strcmp(name, "glCullFace")) return emscripten_glCullFace;
-  else if (!strcmp(name, "glClear")) return emscripten_glClear;
-  else if (!strcmp(name, "glLineWidth")) return emscripten_glLineWidth;
-  else if (!strcmp(name, "glClearStencil")) return emscripten_glClearStencil;
-  else if (!strcmp(name, "glDepthMask")) return emscripten_glDepthMask;
-  else if (!strcmp(name, "glStencilMask")) return emscripten_glStencilMask;
-  else if (!strcmp(name, "glCheckFramebufferStatus")) return emscripten_glCheckFramebufferStatus;
-  else if (!strcmp(name, "glGenerateMipmap")) return emscripten_glGenerateMipmap;
-  else if (!strcmp(name, "glActiveTexture")) return emscripten_glActiveTexture;
-  else if (!strcmp(name, "glBlendEquation")) return emscripten_glBlendEquation;
-  else if (!strcmp(name, "glIsEnabled")) return emscripten_glIsEnabled;
-  else if (!strcmp(name, "glBlendFunc")) return emscripten_glBlendFunc;
-  else if (!strcmp(name, "glBlendEquationSeparate")) return emscripten_glBlendEquationSeparate;
-  else if (!strcmp(name, "glDepthRange")) return emscripten_glDepthRange;
-  else if (!strcmp(name, "glDepthRangef")) return emscripten_glDepthRangef;
-  else if (!strcmp(name, "glStencilMaskSeparate")) return emscripten_glStencilMaskSeparate;
-  else if (!strcmp(name, "glHint")) return emscripten_glHint;
-  else if (!strcmp(name, "glPolygonOffset")) return emscripten_glPolygonOffset;
-  else if (!strcmp(name, "glVertexAttrib1f")) return emscripten_glVertexAttrib1f;
-  else if (!strcmp(name, "glSampleCoverage")) return emscripten_glSampleCoverage;
-  else if (!strcmp(name, "glTexParameteri")) return emscripten_glTexParameteri;
-  else if (!strcmp(name, "glTexParameterf")) return emscripten_glTexParameterf;
-  else if (!strcmp(name, "glVertexAttrib2f")) return emscripten_glVertexAttrib2f;
-  else if (!strcmp(name, "glStencilFunc")) return emscripten_glStencilFunc;
-  else if (!strcmp(name, "glStencilOp")) return emscripten_glStencilOp;
-  else if (!strcmp(name, "glViewport")) return emscripten_glViewport;
-  else if (!strcmp(name, "glClearColor")) return emscripten_glClearColor;
-  else if (!strcmp(name, "glScissor")) return emscripten_glScissor;
-  else if (!strcmp(name, "glVertexAttrib3f")) return emscripten_glVertexAttrib3f;
-  else if (!strcmp(name, "glColorMask")) return emscripten_glColorMask;
-  else if (!strcmp(name, "glRenderbufferStorage")) return emscripten_glRenderbufferStorage;
-  else if (!strcmp(name, "glBlendFuncSeparate")) return emscripten_glBlendFuncSeparate;
-  else if (!strcmp(name, "glBlendColor")) return emscripten_glBlendColor;
-  else if (!strcmp(name, "glStencilFuncSeparate")) return emscripten_glStencilFuncSeparate;
-  else if (!strcmp(name, "glStencilOpSeparate")) return emscripten_glStencilOpSeparate;
-  else if (!strcmp(name, "glVertexAttrib4f")) return emscripten_glVertexAttrib4f;
-  else if (!strcmp(name, "glCopyTexImage2D")) return emscripten_glCopyTexImage2D;
-  else if (!strcmp(name, "glCopyTexSubImage2D")) return emscripten_glCopyTexSubImage2D;
-  else if (!strcmp(name, "glDrawBuffers")) return emscripten_glDrawBuffers;
+  void *func = proc_address_lookup(&gl_proc_table, name);
+  if (func) return func;
 
   EM_ASM(Module.printErr('bad name in getProcAddress: ' + [Pointer_stringify($0), Pointer_stringify($1)]), name_, name);
   return 0;
 }
-
@@ -0,0 +1,218 @@
+/*
+   Heaps of relocatable blocks, see emscripten/handle_heap.h
+
+   Blocks are laid out back to back in one fixed area, each behind an 8-byte header with its size and handle, and new
+   blocks are allocated at the top. Freeing a block only marks it as free space. Compaction slides the blocks above
+   free space down over it, in address order, and fixes up the handle table as it goes: blocks below the compaction
+   cursor have no free space between them, and once a pass reaches the top, the free space it gathered joins the unused
+   area above the top again.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <emscripten/handle_heap.h>
+
+#define BLOCK_ALIGNMENT 8
+
+typedef struct block_header
+{
+	// Of the whole block, header included, a multiple of BLOCK_ALIGNMENT.
+	uint32_t size;
+	// 0 for free space.
+	em_handle handle;
+} block_header;
+
+typedef struct handle_entry
+{
+	// 0 if the handle is not in use.
+	block_header *block;
+	uint32_t locks;
+	// For handles that are not in use, the next one that is not in use either, or 0.
+	em_handle nextFree;
+} handle_entry;
+
+struct em_handle_heap
+{
+	// Blocks are in [base, top), and [top, end) is unused.
+	char *base;
+	char *top;
+	char *end;
+	// The state of compaction. Blocks below compacted have no free space between them, except before locked blocks,
+	// [compacted, scan) is free space that the current pass found, and the blocks from scan on were not visited yet.
+	char *compacted;
+	char *scan;
+	// The bytes of free space below top.
+	size_t fragmentedBytes;
+	// Handle h is at handles[h-1].
+	handle_entry *handles;
+	uint32_t numHandles;
+	uint32_t maxHandles;
+	em_handle firstFreeHandle;
+};
+
+em_handle_heap *emscripten_handle_heap_create(size_t capacity)
+{
+	size_t headerSize = (sizeof(em_handle_heap) + 15) & ~15;
+	capacity &= ~(size_t)(BLOCK_ALIGNMENT - 1);
+	if (capacity > UINT32_MAX || capacity > SIZE_MAX - headerSize) return 0;
+	em_handle_heap *heap = (em_handle_heap*)malloc(headerSize + capacity);
+	if (!heap) return 0;
+	memset(heap, 0, sizeof(em_handle_heap));
+	heap->base = heap->top = heap->compacted = heap->scan = (char*)heap + headerSize;
+	heap->end = heap->base + capacity;
+	return heap;
+}
+
+void emscripten_handle_heap_destroy(em_handle_heap *heap)
+{
+	free(heap->handles);
+	free(heap);
+}
+
+static em_handle new_handle(em_handle_heap *heap)
+{
+	em_handle handle = heap->firstFreeHandle;
+	if (handle)
+	{
+		heap->firstFreeHandle = heap->handles[handle-1].nextFree;
+		return handle;
+	}
+	if (heap->numHandles == heap->maxHandles)
+	{
+		uint32_t maxHandles = heap->maxHandles ? heap->maxHandles * 2 : 64;
+		handle_entry *handles = (handle_entry*)realloc(heap->handles, maxHandles * sizeof(handle_entry));
+		if (!handles) return 0;
+		heap->handles = handles;
+		heap->maxHandles = maxHandles;
+	}
+	return ++heap->numHandles;
+}
+
+em_handle emscripten_handle_alloc(em_handle_heap *heap, size_t bytes)
+{
+	if (bytes > (size_t)(heap->end - heap->base)) return 0;
+	uint32_t size = (bytes + sizeof(block_header) + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+	if ((size_t)(heap->end - heap->top) < size)
+	{
+		if (heap->fragmentedBytes + (heap->end - heap->top) < size) return 0;
+		while (emscripten_handle_heap_compact(heap, SIZE_MAX)) {}
+		if ((size_t)(heap->end - heap->top) < size) return 0;
+	}
+	em_handle handle = new_handle(heap);
+	if (!handle) return 0;
+	block_header *block = (block_header*)heap->top;
+	block->size = size;
+	block->handle = handle;
+	heap->top += size;
+	handle_entry *entry = &heap->handles[handle-1];
+	entry->block = block;
+	entry->locks = 0;
+	return handle;
+}
+
+void emscripten_handle_free(em_handle_heap *heap, em_handle handle)
+{
+	handle_entry *entry = &heap->handles[handle-1];
+	block_header *block = entry->block;
+	char *start = (char*)block;
+	block->handle = 0;
+	entry->block = 0;
+	entry->nextFree = heap->firstFreeHandle;
+	heap->firstFreeHandle = handle;
+	if (start + block->size == heap->top)
+	{
+		// The last block goes straight back to the unused area.
+		heap->top = start;
+		if (heap->scan > heap->top) heap->scan = heap->top;
+		if (heap->compacted > heap->top) heap->compacted = heap->top;
+		return;
+	}
+	heap->fragmentedBytes += block->size;
+	// Space between compacted blocks: the next pass has to start here.
+	if (start < heap->compacted) heap->compacted = heap->scan = start;
+}
+
+void *emscripten_handle_get(em_handle_heap *heap, em_handle handle)
+{
+	return heap->handles[handle-1].block + 1;
+}
+
+size_t emscripten_handle_size(em_handle_heap *heap, em_handle handle)
+{
+	return heap->handles[handle-1].block->size - sizeof(block_header);
+}
+
+void *emscripten_handle_lock(em_handle_heap *heap, em_handle handle)
+{
+	++heap->handles[handle-1].locks;
+	return emscripten_handle_get(heap, handle);
+}
+
+void emscripten_handle_unlock(em_handle_heap *heap, em_handle handle)
+{
+	handle_entry *entry = &heap->handles[handle-1];
+	// Compaction may have left free space in front of the block while it was locked, so start over from the bottom.
+	if (--entry->locks == 0 && (char*)entry->block < heap->compacted)
+		heap->compacted = heap->scan = heap->base;
+}
+
+static void mark_free_space(char *start, char *end)
+{
+	block_header *space = (block_header*)start;
+	space->size = end - start;
+	space->handle = 0;
+}
+
+int emscripten_handle_heap_compact(em_handle_heap *heap, size_t max_bytes)
+{
+	char *compacted = heap->compacted;
+	char *scan = heap->scan;
+	size_t moved = 0;
+	while (scan < heap->top)
+	{
+		block_header *block = (block_header*)scan;
+		uint32_t size = block->size;
+		if (!block->handle)
+		{
+			scan += size;
+			continue;
+		}
+		if (compacted == scan)
+		{
+			compacted = scan = scan + size;
+			continue;
+		}
+		handle_entry *entry = &heap->handles[block->handle-1];
+		if (entry->locks)
+		{
+			// The block cannot move, so the space in front of it stays free until it is unlocked.
+			mark_free_space(compacted, scan);
+			compacted = scan = scan + size;
+			continue;
+		}
+		if (moved >= max_bytes) break;
+		memmove(compacted, block, size);
+		entry->block = (block_header*)compacted;
+		compacted += size;
+		scan += size;
+		moved += size;
+	}
+	if (scan >= heap->top)
+	{
+		// The pass is done: the space that it gathered at the end is unused now.
+		heap->fragmentedBytes -= scan - compacted;
+		heap->top = heap->compacted = heap->scan = compacted;
+		return 0;
+	}
+	// Keep the heap walkable for the next pass, and for a free before it.
+	if (compacted < scan) mark_free_space(compacted, scan);
+	heap->compacted = compacted;
+	heap->scan = scan;
+	return 1;
+}
+
+size_t emscripten_handle_heap_fragmented_bytes(em_handle_heap *heap)
+{
+	return heap->fragmentedBytes;
+}
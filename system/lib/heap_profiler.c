@@ -0,0 +1,80 @@
+/*
+   Allocation sampling for -s HEAP_PROFILER, see emscripten/heap_profiler.h
+
+   dlmalloc calls in here for every allocation and free, so both paths are kept cheap: an allocation only decrements a
+   byte countdown, and a free only looks its address up in a small hash set of the sampled allocations that are still
+   live. Only sampled allocations, and frees of them, call out to library_heap_profiler.js, which captures the call
+   stack, picks the next countdown and aggregates the profile.
+
+   Not thread-safe: it is only built for builds without pthreads.
+*/
+
+#include <stdint.h>
+#include <emscripten/heap_profiler.h>
+
+// In library_heap_profiler.js. Records a sampled allocation, or only counts it if address is 0, and returns the number
+// of bytes until the next sample.
+size_t emscripten_heap_profiler_js_sample(const void *address, size_t size);
+void emscripten_heap_profiler_js_free(const void *address);
+
+// The hash set of live sampled allocations, with linear probing. At most half of the slots are used, and allocations
+// that are sampled while it is that full are only counted, not tracked.
+#define LIVE_SAMPLES_SHIFT 14
+#define LIVE_SAMPLES_SIZE (1 << LIVE_SAMPLES_SHIFT)
+#define LIVE_SAMPLES_MASK (LIVE_SAMPLES_SIZE - 1)
+
+static const void *liveSamples[LIVE_SAMPLES_SIZE];
+static int numLiveSamples = 0;
+
+// The first allocation is sampled, and the JavaScript side then picks the intervals.
+static size_t bytesUntilSample = 0;
+
+static inline uint32_t home_slot(const void *address)
+{
+	return (((uint32_t)(uintptr_t)address >> 3) * 2654435761u) >> (32 - LIVE_SAMPLES_SHIFT);
+}
+
+void emscripten_heap_profiler_record_allocation(const void *address, size_t size)
+{
+	if (!address) return;
+	if (bytesUntilSample > size)
+	{
+		bytesUntilSample -= size;
+		return;
+	}
+	if (numLiveSamples >= LIVE_SAMPLES_SIZE / 2)
+	{
+		bytesUntilSample = emscripten_heap_profiler_js_sample(0, size);
+		return;
+	}
+	uint32_t i = home_slot(address);
+	while (liveSamples[i]) i = (i + 1) & LIVE_SAMPLES_MASK;
+	liveSamples[i] = address;
+	++numLiveSamples;
+	bytesUntilSample = emscripten_heap_profiler_js_sample(address, size);
+}
+
+void emscripten_heap_profiler_record_free(const void *address)
+{
+	if (!numLiveSamples || !address) return;
+	uint32_t i = home_slot(address);
+	while (liveSamples[i] != address)
+	{
+		if (!liveSamples[i]) return; // not sampled
+		i = (i + 1) & LIVE_SAMPLES_MASK;
+	}
+	// Close the gap by moving back the entries after it that probed past slot i, so lookups never need tombstones.
+	for(uint32_t j = (i + 1) & LIVE_SAMPLES_MASK; liveSamples[j]; j = (j + 1) & LIVE_SAMPLES_MASK)
+	{
+		uint32_t home = home_slot(liveSamples[j]);
+		int homeInGap = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+		if (homeInGap)
+		{
+			liveSamples[i] = liveSamples[j];
+			i = j;
+		}
+	}
+	liveSamples[i] = 0;
+	--numLiveSamples;
+	emscripten_heap_profiler_js_free(address);
+}
@@ -0,0 +1,11 @@
+#ifndef FASTFLOAT_H
+#define FASTFLOAT_H
+
+#include <stdint.h>
+
+#define FAST_DTOA_DIGITS 18
+
+int __fast_dtoa(double, int, int, char *, int *);
+int __eisel_lemire(uint64_t, int, double *);
+
+#endif
@@ -8,6 +8,9 @@
 
 #include "shgetc.h"
 #include "floatscan.h"
+#ifdef EMSCRIPTEN_FAST_FLOAT_CONVERSION
+#include "fastfloat.h"
+#endif
 
 #if LDBL_MANT_DIG == 53 && LDBL_MAX_EXP == 1024
 
@@ -172,6 +175,19 @@ static long double decfloat(FILE *f, int c, int bits, int emin, int sign, int po
 			return sign * (long double)x[0] * p10s[rp-10];
 	}
 
+#ifdef EMSCRIPTEN_FAST_FLOAT_CONVERSION
+	/* XXX EMSCRIPTEN: up to 19 significant digits fit in 64 bits, which
+	 * Eisel-Lemire can almost always round exactly without big numbers */
+	if (bits==DBL_MANT_DIG && lnz<=19 && dc<=9*(KMAX-3)) {
+		uint64_t w = x[0];
+		int q = lrp-9;
+		double d;
+		if (k>1) w = w*1000000000 + x[1], q -= 9;
+		if (k>2) w = w*10 + x[2]/100000000, q -= 1;
+		if (__eisel_lemire(w, q, &d)) return sign * (long double)d;
+	}
+#endif
+
 	/* Align radix point to B1B digit boundary */
 	if (rp % 9) {
 		int rpm9 = rp>=0 ? rp%9 : rp%9+9;
@@ -62,6 +62,12 @@ struct pthread {
 	void *stdio_locks;
 	uintptr_t canary_at_end;
 	void **dtv_copy;
+#ifdef __EMSCRIPTEN__
+	// The em_queued_calls that other threads have dispatched to this thread, newest first.
+	void * volatile mailbox;
+	// 1 for the thread that hosts the Emscripten runtime, whose calls go to the call queue of the main runtime thread instead.
+	int isMainRuntimeThread;
+#endif
 };
 
 struct __timer {
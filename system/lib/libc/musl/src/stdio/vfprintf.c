@@ -8,6 +8,9 @@
 #include <inttypes.h>
 #include <math.h>
 #include <float.h>
+#ifdef EMSCRIPTEN_FAST_FLOAT_CONVERSION
+#include "fastfloat.h"
+#endif
 
 /* Some useful macros */
 
@@ -233,6 +236,33 @@ static int fmt_fp(FILE *f, long double y, int w, int p, int fl, int t)
 		return MAX(w, 3+pl);
 	}
 
+#if defined(EMSCRIPTEN_FAST_FLOAT_CONVERSION) && LDBL_MANT_DIG==53
+	/* XXX EMSCRIPTEN: try generating the rounded digits directly, and only
+	 * fall back to the exact big-number conversion when that is unsure */
+	if (y && (t|32)!='a') {
+		int n, lo;
+		if (p<0) p=6;
+		if ((t|32)=='f') n = __fast_dtoa(y, p, 1, buf, &e);
+		else n = __fast_dtoa(y, (t|32)=='e' ? p+1 : p ? p : 1, 0, buf, &e);
+		if (n) {
+			/* Lay the digits out in base 1e9 slots around r, as below */
+			r = big + sizeof(big)/sizeof(*big)/2;
+			a = r - ((e+9*LDBL_MAX_EXP)/9 - LDBL_MAX_EXP);
+			lo = e-n+1;
+			z = r + 1 - ((lo+9*LDBL_MAX_EXP)/9 - LDBL_MAX_EXP);
+			for (d=a, i=9*(r-a)+8; d<z; d++) {
+				uint32_t x=0;
+				for (j=0; j<9; j++, i--)
+					x = 10*x + (i<=e && i>=lo ? buf[e-i]-'0' : 0);
+				*d = x;
+			}
+			for (d=r; d<a; d++) *d=0;
+			for (d=z; d<=r; d++) *d=0;
+			goto digits_done;
+		}
+	}
+#endif
+
 	y = frexpl(y, &e2) * 2;
 	if (y) e2--;
 
@@ -362,6 +392,9 @@ static int fmt_fp(FILE *f, long double y, int w, int p, int fl, int t)
 		}
 		if (z>d+1) z=d+1;
 	}
+#if defined(EMSCRIPTEN_FAST_FLOAT_CONVERSION) && LDBL_MANT_DIG==53
+digits_done:
+#endif
 	for (; z>a && !z[-1]; z--);
 	
 	if ((t|32)=='g') {
@@ -1,8 +1,26 @@
 #include <string.h>
+#ifdef __EMSCRIPTEN__
+#include <stdint.h>
+
+#define SS (sizeof(size_t))
+#define ALIGN (sizeof(size_t)-1)
+#endif
 
 int memcmp(const void *vl, const void *vr, size_t n)
 {
 	const unsigned char *l=vl, *r=vr;
+#ifdef __EMSCRIPTEN__
+	/* Compare a word at a time when both sides can be aligned together.
+	 * Otherwise asm.js has no unaligned word loads, so stay bytewise. */
+	if (!(((uintptr_t)l ^ (uintptr_t)r) & ALIGN)) {
+		const size_t *wl, *wr;
+		for (; ((uintptr_t)l & ALIGN) && n && *l == *r; n--, l++, r++);
+		if (!((uintptr_t)l & ALIGN)) {
+			for (wl = (const void *)l, wr = (const void *)r; n>=SS && *wl == *wr; wl++, wr++, n-=SS);
+			l = (const void *)wl, r = (const void *)wr;
+		}
+	}
+#endif
 	for (; n && *l == *r; n--, l++, r++);
 	return n ? *l-*r : 0;
 }
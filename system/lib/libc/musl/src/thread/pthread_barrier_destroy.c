@@ -11,5 +11,14 @@ int pthread_barrier_destroy(pthread_barrier_t *b)
 		}
 		__vm_wait();
 	}
+#ifdef __EMSCRIPTEN__
+	/* Wait for the threads that were released to leave the barrier,
+	 * see sense_reversing_barrier_wait(). */
+	else {
+		int v;
+		while ((v = b->_b_waiters))
+			__wait(&b->_b_waiters, 0, v, 1);
+	}
+#endif
 	return 0;
 }
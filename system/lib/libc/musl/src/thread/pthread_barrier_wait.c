@@ -53,6 +53,36 @@ static int pshared_barrier_wait(pthread_barrier_t *b)
 	return ret;
 }
 
+#ifdef __EMSCRIPTEN__
+/* A sense-reversing barrier: each thread notes the generation of the
+ * barrier that it arrives in, and waits for it to end, which the last
+ * thread to arrive does by starting the next one and waking them all.
+ * Unlike the instances below, no thread waits for the others to leave,
+ * which would take another futex round trip, or spinning on the main
+ * browser thread. _b_waiters counts the threads in the barrier, for
+ * pthread_barrier_destroy to wait for. */
+#define _b_seq _b_waiters2
+
+static int sense_reversing_barrier_wait(pthread_barrier_t *b, int limit)
+{
+	int seq = b->_b_seq;
+	a_inc(&b->_b_waiters);
+	if (a_fetch_add(&b->_b_count, 1) == limit) {
+		a_store(&b->_b_count, 0);
+		a_store(&b->_b_seq, seq + 1);
+		__wake(&b->_b_seq, -1, 1);
+		if (a_fetch_add(&b->_b_waiters, -1) == 1)
+			__wake(&b->_b_waiters, 1, 1);
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+	}
+	while (b->_b_seq == seq)
+		__wait(&b->_b_seq, 0, seq, 1);
+	if (a_fetch_add(&b->_b_waiters, -1) == 1)
+		__wake(&b->_b_waiters, 1, 1);
+	return 0;
+}
+#endif
+
 struct instance
 {
 	volatile int count;
@@ -72,6 +102,10 @@ int pthread_barrier_wait(pthread_barrier_t *b)
 	/* Process-shared barriers require a separate, inefficient wait */
 	if (limit < 0) return pshared_barrier_wait(b);
 
+#ifdef __EMSCRIPTEN__
+	return sense_reversing_barrier_wait(b, limit);
+#endif
+
 	/* Otherwise we need a lock on the barrier object */
 	while (a_swap(&b->_b_lock, 1))
 		__wait(&b->_b_lock, &b->_b_waiters, 1, 1);
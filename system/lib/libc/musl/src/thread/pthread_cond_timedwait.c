@@ -54,10 +54,15 @@ static inline void unlock_requeue(volatile int *l, volatile int *r, int w)
 {
 	a_store(l, 0);
 #ifdef __EMSCRIPTEN__
+	if (w) {
+		__wake(l, 1, 1);
+		return;
+	}
 	int futexResult;
 	do {
-		// We want to wake one and requeue all others, without comparing the value, but SAB spec doesn't
-		// have requeue without comparing, so implement it by spinning instead.
+		// We want to requeue the waiter without comparing the value, but emscripten_futex_wake_or_requeue
+		// compares it, so retry if the waiter changed it meanwhile. A waiter on the main browser thread is
+		// moved to the mutex, and one in a worker is woken, to block on the mutex on its own.
 		futexResult = emscripten_futex_wake_or_requeue(l, 0, r, *l);
 	} while(futexResult == -EAGAIN);
 #else
@@ -0,0 +1,48 @@
+// Lookup of functions by name, for the GetProcAddress functions of system/lib/gl.c and system/lib/al.c.
+//
+// The names are kept in a plain table, as they are easy to maintain that way. On the first lookup, they are indexed in
+// an open addressing hash table, so that each lookup costs a hash of the name and usually a single strcmp(), instead of
+// one strcmp() for each entry before the one that is asked for. Loaders such as glad or GLEW ask for every function.
+
+#include <string.h>
+
+typedef struct proc_address_entry {
+  const char *name;
+  void *func;
+} proc_address_entry;
+
+typedef struct proc_address_table {
+  const proc_address_entry *entries;
+  unsigned int num_entries;
+  // One more than the index of the entry in each slot, or 0 for an empty slot. The number of slots must be a power of
+  // two, and at least twice the number of entries to keep the probe sequences short.
+  unsigned short *slots;
+  unsigned int num_slots;
+  int indexed;
+} proc_address_table;
+
+// FNV-1a
+static unsigned int proc_address_hash(const char *name) {
+  unsigned int hash = 2166136261u;
+  for (; *name; ++name) {
+    hash = (hash ^ (unsigned char)*name) * 16777619u;
+  }
+  return hash;
+}
+
+static void *proc_address_lookup(proc_address_table *table, const char *name) {
+  unsigned int mask = table->num_slots - 1;
+  if (!table->indexed) {
+    for (unsigned int i = 0; i < table->num_entries; ++i) {
+      unsigned int slot = proc_address_hash(table->entries[i].name) & mask;
+      while (table->slots[slot]) slot = (slot + 1) & mask;
+      table->slots[slot] = i + 1;
+    }
+    table->indexed = 1;
+  }
+  for (unsigned int slot = proc_address_hash(name) & mask; table->slots[slot]; slot = (slot + 1) & mask) {
+    const proc_address_entry *entry = &table->entries[table->slots[slot] - 1];
+    if (!strcmp(entry->name, name)) return entry->func;
+  }
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <math.h>
+#include <assert.h>
+#include <emscripten/threading.h>
+#include <emscripten/gl_command_buffer.h>
+
+// In library_pthread.c.
+extern void _emscripten_invoke_queued_call(em_queued_call *q);
+extern void _emscripten_read_queued_call_args(em_queued_call *q, va_list args);
+
+// The number of entries of the cache of integer state. Must be a power of two.
+#define CACHE_SIZE 64
+
+typedef struct cached_integer
+{
+	// 0 for an unused entry.
+	unsigned pname;
+	int value;
+} cached_integer;
+
+// The calls are counted as they are recorded, submitted and replayed, and call n is in calls[n & (capacity-1)]. The
+// recording thread owns the calls from replayed on, and the main thread the ones in [replayed, submitted).
+struct em_gl_command_buffer
+{
+	em_queued_call *calls;
+	uint32_t capacity;
+	// Only accessed by the recording thread.
+	uint32_t recorded;
+	// Written by the recording thread, read by the main thread.
+	volatile uint32_t submitted;
+	// Written by the main thread, read by the recording thread, which waits on it when the buffer is full.
+	volatile uint32_t replayed;
+	// 1 while a replay is queued to the main thread, so that submitting again does not queue another one.
+	volatile uint32_t replayQueued;
+	// The copies for the next recorded call.
+	void *copies[EM_QUEUED_CALL_MAX_ARGS];
+	int numCopies;
+	cached_integer cache[CACHE_SIZE];
+};
+
+em_gl_command_buffer *emscripten_gl_command_buffer_create(int capacity)
+{
+	uint32_t size = 1;
+	while(size < (uint32_t)capacity && size < (1u << 30) / sizeof(em_queued_call)) size <<= 1;
+	em_gl_command_buffer *buffer = (em_gl_command_buffer*)calloc(1, sizeof(em_gl_command_buffer));
+	if (!buffer) return 0;
+	buffer->calls = (em_queued_call*)malloc(size * sizeof(em_queued_call));
+	if (!buffer->calls)
+	{
+		free(buffer);
+		return 0;
+	}
+	buffer->capacity = size;
+	return buffer;
+}
+
+// Runs on the main thread: replays the calls that were submitted, in order.
+static void replay(em_gl_command_buffer *buffer)
+{
+	uint32_t end = emscripten_atomic_load_u32((void*)&buffer->submitted);
+	uint32_t i = buffer->replayed;
+	if (i == end) return;
+	for(; i != end; ++i)
+		_emscripten_invoke_queued_call(&buffer->calls[i & (buffer->capacity - 1)]);
+	emscripten_atomic_store_u32((void*)&buffer->replayed, end);
+	emscripten_futex_wake(&buffer->replayed, INT_MAX);
+}
+
+static void replay_queued(em_gl_command_buffer *buffer)
+{
+	// Cleared first, so that calls submitted while this replays queue a replay of their own.
+	emscripten_atomic_store_u32((void*)&buffer->replayQueued, 0);
+	replay(buffer);
+}
+
+static void replay_and_call(em_gl_command_buffer *buffer, em_queued_call *call)
+{
+	replay(buffer);
+	_emscripten_invoke_queued_call(call);
+}
+
+void emscripten_gl_command_buffer_destroy(em_gl_command_buffer *buffer)
+{
+	if (!emscripten_is_main_runtime_thread())
+	{
+		// Also waits for a queued replay, as the main thread runs the calls of this thread in order.
+		emscripten_atomic_store_u32((void*)&buffer->submitted, buffer->recorded);
+		emscripten_sync_run_in_main_runtime_thread_(EM_FUNC_SIG_VI, replay, buffer);
+	}
+	for(int i = 0; i < buffer->numCopies; ++i)
+		free(buffer->copies[i]);
+	free(buffer->calls);
+	free(buffer);
+}
+
+static void append(em_gl_command_buffer *buffer, const em_queued_call *call)
+{
+	for(;;)
+	{
+		uint32_t replayed = emscripten_atomic_load_u32((void*)&buffer->replayed);
+		if (buffer->recorded - replayed < buffer->capacity) break;
+		// Full: let the main thread replay what there is, and wait for it to make room.
+		emscripten_gl_command_buffer_submit(buffer);
+		emscripten_futex_wait(&buffer->replayed, replayed, INFINITY);
+	}
+	buffer->calls[buffer->recorded & (buffer->capacity - 1)] = *call;
+	++buffer->recorded;
+}
+
+void emscripten_gl_command_buffer_record(em_gl_command_buffer *buffer, EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
+{
+	em_queued_call q = { sig, func_ptr };
+	va_list args;
+	va_start(args, func_ptr);
+	_emscripten_read_queued_call_args(&q, args);
+	va_end(args);
+
+	if (emscripten_is_main_runtime_thread())
+	{
+		_emscripten_invoke_queued_call(&q);
+		for(int i = 0; i < buffer->numCopies; ++i)
+			free(buffer->copies[i]);
+		buffer->numCopies = 0;
+		return;
+	}
+
+	append(buffer, &q);
+	for(int i = 0; i < buffer->numCopies; ++i)
+	{
+		em_queued_call freeCopy = { EM_FUNC_SIG_VI, (void*)free };
+		freeCopy.args[0].vp = buffer->copies[i];
+		append(buffer, &freeCopy);
+	}
+	buffer->numCopies = 0;
+}
+
+void *emscripten_gl_command_buffer_copy(em_gl_command_buffer *buffer, const void *data, size_t size)
+{
+	assert(buffer->numCopies < EM_QUEUED_CALL_MAX_ARGS);
+	void *copy = malloc(size);
+	if (!copy) return 0;
+	memcpy(copy, data, size);
+	buffer->copies[buffer->numCopies++] = copy;
+	return copy;
+}
+
+void emscripten_gl_command_buffer_submit(em_gl_command_buffer *buffer)
+{
+	if (emscripten_is_main_runtime_thread()) return;
+	emscripten_atomic_store_u32((void*)&buffer->submitted, buffer->recorded);
+	if (emscripten_atomic_cas_u32((void*)&buffer->replayQueued, 0, 1) == 0)
+		emscripten_async_run_in_main_runtime_thread_(EM_FUNC_SIG_VI, replay_queued, buffer);
+}
+
+int emscripten_gl_command_buffer_call_sync(em_gl_command_buffer *buffer, EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
+{
+	em_queued_call q = { sig, func_ptr };
+	va_list args;
+	va_start(args, func_ptr);
+	_emscripten_read_queued_call_args(&q, args);
+	va_end(args);
+
+	if (emscripten_is_main_runtime_thread())
+	{
+		_emscripten_invoke_queued_call(&q);
+		return q.returnValue.i;
+	}
+
+	// The recorded calls are replayed right before this one, rather than by a queued replay, which may already have run
+	// past them.
+	emscripten_atomic_store_u32((void*)&buffer->submitted, buffer->recorded);
+	emscripten_sync_run_in_main_runtime_thread_(EM_FUNC_SIG_VII, replay_and_call, buffer, &q);
+	return q.returnValue.i;
+}
+
+static cached_integer *find_cached_integer(em_gl_command_buffer *buffer, unsigned pname)
+{
+	unsigned i = (pname * 2654435761u) & (CACHE_SIZE - 1);
+	for(int n = 0; n < CACHE_SIZE; ++n, i = (i + 1) & (CACHE_SIZE - 1))
+		if (buffer->cache[i].pname == pname || buffer->cache[i].pname == 0) return &buffer->cache[i];
+	return 0;
+}
+
+void emscripten_gl_command_buffer_cache_integer(em_gl_command_buffer *buffer, unsigned pname, int value)
+{
+	assert(pname != 0);
+	cached_integer *entry = find_cached_integer(buffer, pname);
+	// When the cache is full, forget everything else rather than this value.
+	if (!entry)
+	{
+		emscripten_gl_command_buffer_clear_cache(buffer);
+		entry = find_cached_integer(buffer, pname);
+	}
+	entry->pname = pname;
+	entry->value = value;
+}
+
+int emscripten_gl_command_buffer_get_cached_integer(em_gl_command_buffer *buffer, unsigned pname, int *value)
+{
+	cached_integer *entry = find_cached_integer(buffer, pname);
+	if (!entry || entry->pname != pname) return 0;
+	*value = entry->value;
+	return 1;
+}
+
+void emscripten_gl_command_buffer_clear_cache(em_gl_command_buffer *buffer)
+{
+	memset(buffer->cache, 0, sizeof(buffer->cache));
+}
@@ -163,21 +163,60 @@ int usleep(unsigned usec)
 	return 0;
 }
 
+// em_queued_call objects are pooled, so that proxying a call does not take the lock of the global allocator.
+// Each thread allocates from a cache of its own, kept in a thread-specific value. The objects are most often freed by
+// the main runtime thread, so they are freed to a shared list instead, and a thread whose cache has run empty takes
+// that whole list over to its cache in one atomic exchange. Since no thread pops a single object from the shared list,
+// pushing to it with a compare-and-swap is free of ABA problems.
+static em_queued_call * volatile free_calls = 0;
+static pthread_key_t call_cache_key;
+static pthread_once_t call_cache_key_once = PTHREAD_ONCE_INIT;
+
+// Pushes the chain of call objects from first to last to the shared list of free objects.
+static void free_calls_push(em_queued_call *first, em_queued_call *last)
+{
+	em_queued_call *head;
+	do {
+		head = (em_queued_call*)emscripten_atomic_load_u32((void*)&free_calls);
+		last->next = head;
+	} while(emscripten_atomic_cas_u32((void*)&free_calls, (uint32_t)head, (uint32_t)first) != (uint32_t)head);
+}
+
+// Returns the cache of an exiting thread to the shared list, so that the objects in it are not lost.
+static void call_cache_destructor(void *cache)
+{
+	em_queued_call *last = (em_queued_call*)cache;
+	while(last->next) last = last->next;
+	free_calls_push((em_queued_call*)cache, last);
+}
+
+static void create_call_cache_key()
+{
+	pthread_key_create(&call_cache_key, call_cache_destructor);
+}
+
 // Allocator and deallocator for em_queued_call objects.
 static em_queued_call *em_queued_call_malloc()
 {
-	em_queued_call *call = (em_queued_call*)malloc(sizeof(em_queued_call));
+	pthread_once(&call_cache_key_once, create_call_cache_key);
+	em_queued_call *call = (em_queued_call*)pthread_getspecific(call_cache_key);
+	if (!call) call = (em_queued_call*)emscripten_atomic_exchange_u32((void*)&free_calls, 0);
+	if (call)
+		pthread_setspecific(call_cache_key, call->next);
+	else
+		call = (em_queued_call*)malloc(sizeof(em_queued_call));
 	assert(call); // Not a programming error, but use assert() in debug builds to catch OOM scenarios.
 	if (call)
 	{
 		call->operationDone = 0;
 		call->functionPtr = 0;
+		call->next = 0;
 	}
 	return call;
 }
 static void em_queued_call_free(em_queued_call *call)
 {
-	free(call);
+	free_calls_push(call, call);
 }
 
 void emscripten_async_waitable_close(em_queued_call *call)
@@ -185,9 +224,14 @@ void emscripten_async_waitable_close(em_queued_call *call)
 	em_queued_call_free(call);
 }
 
-static void _do_call(em_queued_call *q)
+extern void _emscripten_call_generic(EM_FUNC_SIGNATURE sig, void *func_ptr, em_variant_val *args, em_variant_val *returnValue);
+
+// Makes the call, and stores its result in q->returnValue. Also used to replay the calls recorded in GL command buffers.
+void _emscripten_invoke_queued_call(em_queued_call *q)
 {
-	switch(q->functionEnum)
+	// Calls with a generic signature go through the table of functions of their exact signature.
+	if (q->functionEnum & EM_FUNC_SIG_GENERIC) _emscripten_call_generic(q->functionEnum, q->functionPtr, q->args, &q->returnValue);
+	else switch(q->functionEnum)
 	{
 		case EM_PROXIED_PTHREAD_CREATE: q->returnValue.i = pthread_create(q->args[0].vp, q->args[1].vp, q->args[2].vp, q->args[3].vp); break;
 		case EM_PROXIED_SYSCALL: q->returnValue.i = emscripten_syscall(q->args[0].i, q->args[1].vp); break;
@@ -201,6 +245,11 @@ static void _do_call(em_queued_call *q)
 		case EM_FUNC_SIG_IIII: q->returnValue.i = ((em_func_iiii)q->functionPtr)(q->args[0].i, q->args[1].i, q->args[2].i); break;
 		default: assert(0 && "Invalid Emscripten pthread _do_call opcode!");
 	}
+}
+
+static void _do_call(em_queued_call *q)
+{
+	_emscripten_invoke_queued_call(q);
 
 	// If the caller is detached from this operation, it is the main thread's responsibility to free up the call object.
 	if (q->calleeDelete) {
@@ -213,11 +262,51 @@ static void _do_call(em_queued_call *q)
 	}
 }
 
-#define CALL_QUEUE_SIZE 128
-static em_queued_call **call_queue = 0;
-static volatile int call_queue_head = 0; // Shared data synchronized by call_queue_lock.
-static volatile int call_queue_tail = 0;
-static pthread_mutex_t call_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+// The calls that other threads have posted to the main runtime thread, newest first. Producers push a call to the front
+// of this list with a compare-and-swap, so posting a call never takes a lock, and the queue never fills up. The main
+// runtime thread takes all of the queued calls at once with an exchange, and runs them in the order they were posted.
+// The mailboxes of other threads, in the mailbox field of their pthread structure, work the same way.
+static em_queued_call * volatile call_queue_head = 0;
+
+// Pushes the call to the front of the given queue, and returns the call that was at the front before it.
+static em_queued_call *queued_calls_push(em_queued_call * volatile *queue, em_queued_call *call)
+{
+	em_queued_call *head;
+	do {
+		head = (em_queued_call*)emscripten_atomic_load_u32((void*)queue);
+		call->next = head;
+	} while(emscripten_atomic_cas_u32((void*)queue, (uint32_t)head, (uint32_t)call) != (uint32_t)head);
+	return head;
+}
+
+// Runs the calls in the given queue until it is empty, in the order they were pushed in.
+static void queued_calls_run(em_queued_call * volatile *queue)
+{
+	for(;;)
+	{
+		// Take the whole batch of calls that has been posted so far. Threads that post calls while the batch is being run
+		// start a new one.
+		em_queued_call *calls = (em_queued_call*)emscripten_atomic_exchange_u32((void*)queue, 0);
+		if (!calls) break;
+
+		// The calls are in the reverse order of posting.
+		em_queued_call *first = 0;
+		while(calls)
+		{
+			em_queued_call *next = calls->next;
+			calls->next = first;
+			first = calls;
+			calls = next;
+		}
+		while(first)
+		{
+			// The call object may be freed, or go out of scope in the thread that waits for it, as soon as it has been run.
+			em_queued_call *next = first->next;
+			_do_call(first);
+			first = next;
+		}
+	}
+}
 
 EMSCRIPTEN_RESULT emscripten_wait_for_call_v(em_queued_call *call, double timeoutMSecs)
 {
@@ -256,33 +345,13 @@ void EMSCRIPTEN_KEEPALIVE emscripten_async_run_in_main_thread(em_queued_call *ca
 	}
 
 	// Add the operation to the call queue of the main runtime thread.
-	pthread_mutex_lock(&call_queue_lock);
-	if (!call_queue) call_queue = malloc(sizeof(em_queued_call*) * CALL_QUEUE_SIZE); // Shared data synchronized by call_queue_lock.
-
-	int head = emscripten_atomic_load_u32((void*)&call_queue_head);
-	int tail = emscripten_atomic_load_u32((void*)&call_queue_tail);
-	int new_tail = (tail + 1) % CALL_QUEUE_SIZE;
-
-	while(new_tail == head) { // Queue is full?
-		pthread_mutex_unlock(&call_queue_lock);
-		emscripten_futex_wait((void*)&call_queue_head, head, INFINITY);
-		pthread_mutex_lock(&call_queue_lock);
-		head = emscripten_atomic_load_u32((void*)&call_queue_head);
-		tail = emscripten_atomic_load_u32((void*)&call_queue_tail);
-		new_tail = (tail + 1) % CALL_QUEUE_SIZE;
-	}
-
-	call_queue[tail] = call;
+	em_queued_call *head = queued_calls_push(&call_queue_head, call);
 
 	// If the call queue was empty, the main runtime thread is likely idle in the browser event loop,
 	// so send a message to it to ensure that it wakes up to start processing the command we have posted.
-	if (head == tail) {
+	if (!head) {
 		EM_ASM(postMessage({ cmd: 'processQueuedMainThreadWork' }));
 	}
-
-	emscripten_atomic_store_u32((void*)&call_queue_tail, new_tail);
-
-	pthread_mutex_unlock(&call_queue_lock);
 }
 
 void EMSCRIPTEN_KEEPALIVE emscripten_sync_run_in_main_thread(em_queued_call *call)
@@ -419,39 +488,82 @@ void EMSCRIPTEN_KEEPALIVE emscripten_main_thread_process_queued_calls()
 	// Therefore this scenario must explicitly be detected, and processing the queue must be avoided if we are nesting, or otherwise
 	// the same queued calls would be processed again and again.
 	if (bool_inside_nested_process_queued_calls) return;
-	// This must be before pthread_mutex_lock(), since pthread_mutex_lock() can call back to this function.
 	bool_inside_nested_process_queued_calls = 1;
-	pthread_mutex_lock(&call_queue_lock);
-	int head = emscripten_atomic_load_u32((void*)&call_queue_head);
-	int tail = emscripten_atomic_load_u32((void*)&call_queue_tail);
-	while (head != tail)
-	{
-		// Assume that the call is heavy, so unlock access to the call queue while it is being performed.
-		pthread_mutex_unlock(&call_queue_lock);
-		_do_call(call_queue[head]);
-		pthread_mutex_lock(&call_queue_lock);
-
-		head = (head + 1) % CALL_QUEUE_SIZE;
-		emscripten_atomic_store_u32((void*)&call_queue_head, head);
-		tail = emscripten_atomic_load_u32((void*)&call_queue_tail);
+	queued_calls_run(&call_queue_head);
+	bool_inside_nested_process_queued_calls = 0;
+}
+
+static void dispatch_to_thread(pthread_t thread, em_queued_call *call)
+{
+	// A thread that dispatches a call to itself runs it directly, like the main runtime thread does.
+	if (thread == pthread_self()) {
+		_do_call(call);
+		return;
+	}
+	if (thread->isMainRuntimeThread) {
+		emscripten_async_run_in_main_thread(call);
+		return;
 	}
-	pthread_mutex_unlock(&call_queue_lock);
 
-	// If the queue was full and we had waiters pending to get to put data to queue, wake them up.
-	emscripten_futex_wake((void*)&call_queue_head, 0x7FFFFFFF);
+	// If the mailbox was empty, the thread may be waiting for calls in emscripten_current_thread_wait_for_queued_calls().
+	if (!queued_calls_push((em_queued_call * volatile *)&thread->mailbox, call))
+		emscripten_futex_wake(&thread->mailbox, INT_MAX);
+}
 
-	bool_inside_nested_process_queued_calls = 0;
+void emscripten_current_thread_process_queued_calls(void)
+{
+	if (emscripten_is_main_runtime_thread()) emscripten_main_thread_process_queued_calls();
+	else queued_calls_run((em_queued_call * volatile *)&pthread_self()->mailbox);
+}
+
+EMSCRIPTEN_RESULT emscripten_current_thread_wait_for_queued_calls(double timeoutMSecs)
+{
+	// The main runtime thread is woken up by a message to it when calls are queued for it.
+	if (emscripten_is_main_runtime_thread()) return EMSCRIPTEN_RESULT_NOT_SUPPORTED;
+
+	volatile void *mailbox = &pthread_self()->mailbox;
+	if (!emscripten_atomic_load_u32((void*)mailbox)) {
+		double now = emscripten_get_now();
+		double waitEndTime = now + timeoutMSecs;
+		while(!emscripten_atomic_load_u32((void*)mailbox) && now < waitEndTime) {
+			emscripten_futex_wait(mailbox, 0, waitEndTime - now);
+			now = emscripten_get_now();
+		}
+		if (!emscripten_atomic_load_u32((void*)mailbox)) return EMSCRIPTEN_RESULT_TIMED_OUT;
+	}
+	emscripten_current_thread_process_queued_calls();
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+// Reads the arguments of the call from the variadic parameter list, as the signature of the call dictates.
+void _emscripten_read_queued_call_args(em_queued_call *q, va_list args)
+{
+	int numArguments = EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(q->functionEnum);
+	assert(numArguments <= EM_QUEUED_CALL_MAX_ARGS);
+	for(int i = 0; i < numArguments; ++i)
+	{
+		if (!(q->functionEnum & EM_FUNC_SIG_GENERIC))
+		{
+			q->args[i].i = va_arg(args, int);
+			continue;
+		}
+		switch(EM_FUNC_SIG_ARG_TYPE(q->functionEnum, i))
+		{
+			case EM_FUNC_SIG_TYPE_I: q->args[i].i = va_arg(args, int); break;
+			case EM_FUNC_SIG_TYPE_J: q->args[i].i64 = va_arg(args, int64_t); break;
+			case EM_FUNC_SIG_TYPE_F: q->args[i].f = (float)va_arg(args, double); break; // floats are promoted to double in variadic calls.
+			case EM_FUNC_SIG_TYPE_D: q->args[i].d = va_arg(args, double); break;
+		}
+	}
 }
 
 int emscripten_sync_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
 {
-	int numArguments = EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(sig);
 	em_queued_call q = { sig, func_ptr };
 
 	va_list args;
 	va_start(args, func_ptr);
-	for(int i = 0; i < numArguments; ++i)
-		q.args[i].i = va_arg(args, int);
+	_emscripten_read_queued_call_args(&q, args);
 	va_end(args);
 	emscripten_sync_run_in_main_thread(&q);
 	return q.returnValue.i;
@@ -459,7 +571,6 @@ int emscripten_sync_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *fun
 
 void emscripten_async_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
 {
-	int numArguments = EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(sig);
 	em_queued_call *q = em_queued_call_malloc();
 	if (!q) return;
 	q->functionEnum = sig;
@@ -467,8 +578,7 @@ void emscripten_async_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *f
 
 	va_list args;
 	va_start(args, func_ptr);
-	for(int i = 0; i < numArguments; ++i)
-		q->args[i].i = va_arg(args, int);
+	_emscripten_read_queued_call_args(q, args);
 	va_end(args);
 	// 'async' runs are fire and forget, where the caller detaches itself from the call object after returning here,
 	// and it is the callee's responsibility to free up the memory after the call has been performed.
@@ -478,7 +588,6 @@ void emscripten_async_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *f
 
 em_queued_call *emscripten_async_waitable_run_in_main_runtime_thread_(EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
 {
-	int numArguments = EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(sig);
 	em_queued_call *q = em_queued_call_malloc();
 	if (!q) return;
 	q->functionEnum = sig;
@@ -486,8 +595,7 @@ em_queued_call *emscripten_async_waitable_run_in_main_runtime_thread_(EM_FUNC_SI
 
 	va_list args;
 	va_start(args, func_ptr);
-	for(int i = 0; i < numArguments; ++i)
-		q->args[i].i = va_arg(args, int);
+	_emscripten_read_queued_call_args(q, args);
 	va_end(args);
 	// 'async waitable' runs are waited on by the caller, so the call object needs to remain alive for the caller to
 	// access it after the operation is done. The caller is responsible in cleaning up the object after done.
@@ -496,6 +604,22 @@ em_queued_call *emscripten_async_waitable_run_in_main_runtime_thread_(EM_FUNC_SI
 	return q;
 }
 
+void emscripten_dispatch_to_thread_(pthread_t thread, EM_FUNC_SIGNATURE sig, void *func_ptr, ...)
+{
+	em_queued_call *q = em_queued_call_malloc();
+	if (!q) return;
+	q->functionEnum = sig;
+	q->functionPtr = func_ptr;
+
+	va_list args;
+	va_start(args, func_ptr);
+	_emscripten_read_queued_call_args(q, args);
+	va_end(args);
+	// Like 'async' runs to the main runtime thread, the dispatched calls are fire and forget.
+	q->calleeDelete = 1;
+	dispatch_to_thread(thread, q);
+}
+
 int llvm_memory_barrier()
 {
 	emscripten_atomic_fence();
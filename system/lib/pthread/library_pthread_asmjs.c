@@ -6,15 +6,90 @@
 #include <emscripten/threading.h>
 #include <emscripten.h>
 
-// Use an array of multiple interleaved spinlock mutexes to separate memory addresses to ease pressure when locking.
-// This is outright horrible, but enables easily porting code that does require 64-bit atomics.
-// Eventually in the long run we'd hope to have real support for 64-bit atomics in the browser, after
-// which this emulation can be removed.
-#define NUM_64BIT_LOCKS 256
-static int emulated64BitAtomicsLocks[NUM_64BIT_LOCKS] = {};
+// 64-bit atomics. If the browser supports Atomics on a BigUint64Array, these are performed lock-free with it in JS.
+// Otherwise, they are emulated with an array of spinlocks, where the lock of each address is picked by a hash of it,
+// so that operations on unrelated addresses seldom contend with each other. The choice is made once at startup, and
+// it is the same on all threads, since they all run in the same browser.
+#define NUM_64BIT_LOCKS 256 // A power of two, see lock_for_address().
+#define CACHE_LINE_SIZE 64
 
-#define SPINLOCK_ACQUIRE(addr) do { while(emscripten_atomic_exchange_u32((void*)(addr), 1)) /*nop*/; } while(0)
-#define SPINLOCK_RELEASE(addr) emscripten_atomic_store_u32((void*)(addr), 0)
+// Each lock sits on a cache line of its own, so that threads spinning on one lock do not slow down the others.
+static struct
+{
+	volatile uint32_t lock;
+	uint8_t padding[CACHE_LINE_SIZE - sizeof(uint32_t)];
+} __attribute__((aligned(CACHE_LINE_SIZE))) emulated64BitAtomicsLocks[NUM_64BIT_LOCKS];
+
+static volatile uint32_t *lock_for_address(const void *addr)
+{
+	// Fibonacci hashing, so that variables at power-of-two strides from each other do not all share a lock.
+	uint32_t h = (uint32_t)((uintptr_t)addr >> 3) * 2654435769u;
+	return &emulated64BitAtomicsLocks[h >> (32 - 8)].lock;
+}
+
+// Spins on plain loads while the lock is taken (test and test-and-set), so that the waiting threads do not keep
+// pulling the cache line of the lock away from the thread that holds it.
+static void spinlock_acquire(volatile uint32_t *lock)
+{
+	while(emscripten_atomic_exchange_u32((void*)lock, 1))
+		while(emscripten_atomic_load_u32((void*)lock)) /*nop*/;
+}
+
+static void spinlock_release(volatile uint32_t *lock)
+{
+	emscripten_atomic_store_u32((void*)lock, 0);
+}
+
+// Keep in sync with _emscripten_atomic_bigint_u64() in library_pthread.js.
+#define EM_ATOMIC_OP_LOAD 0
+#define EM_ATOMIC_OP_STORE 1
+#define EM_ATOMIC_OP_EXCHANGE 2
+#define EM_ATOMIC_OP_CAS 3
+#define EM_ATOMIC_OP_ADD 4
+#define EM_ATOMIC_OP_SUB 5
+#define EM_ATOMIC_OP_AND 6
+#define EM_ATOMIC_OP_OR 7
+#define EM_ATOMIC_OP_XOR 8
+
+// Implemented in library_pthread.js.
+int _emscripten_has_bigint_atomics(void);
+uint64_t _emscripten_atomic_bigint_u64(int op, const void *addr, uint64_t val, uint64_t val2);
+
+// -1 until the first 64-bit atomic operation checks for the browser support. All threads compute the same value.
+static int hasBigIntAtomics = -1;
+
+// Performs the given operation on the 64-bit value at addr, and returns the value that was there before. For
+// EM_ATOMIC_OP_CAS, val is the expected old value and val2 the new one.
+static uint64_t atomic_op_u64(int op, const void *addr, uint64_t val, uint64_t val2)
+{
+	if (hasBigIntAtomics < 0) hasBigIntAtomics = _emscripten_has_bigint_atomics();
+	if (hasBigIntAtomics) return _emscripten_atomic_bigint_u64(op, addr, val, val2);
+
+	volatile uint32_t *lock = lock_for_address(addr);
+	spinlock_acquire(lock);
+	uint64_t *a = (uint64_t*)addr;
+	uint64_t oldVal = *a;
+	switch(op)
+	{
+		case EM_ATOMIC_OP_LOAD: break;
+		case EM_ATOMIC_OP_STORE:
+		case EM_ATOMIC_OP_EXCHANGE: *a = val; break;
+		case EM_ATOMIC_OP_CAS: if (oldVal == val) *a = val2; break;
+		case EM_ATOMIC_OP_ADD: *a = oldVal + val; break;
+		case EM_ATOMIC_OP_SUB: *a = oldVal - val; break;
+		case EM_ATOMIC_OP_AND: *a = oldVal & val; break;
+		case EM_ATOMIC_OP_OR: *a = oldVal | val; break;
+		case EM_ATOMIC_OP_XOR: *a = oldVal ^ val; break;
+	}
+	spinlock_release(lock);
+	return oldVal;
+}
+
+typedef union
+{
+	double d;
+	uint64_t u;
+} f64_bits;
 
 float EMSCRIPTEN_KEEPALIVE emscripten_atomic_load_f32(const void *addr)
 {
@@ -28,41 +103,24 @@ float EMSCRIPTEN_KEEPALIVE emscripten_atomic_load_f32(const void *addr)
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_exchange_u64(void/*uint64_t*/ *addr, uint64_t newVal)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldValInMemory = *(uint64_t*)addr;
-	*(uint64_t*)addr = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldValInMemory;
+	return atomic_op_u64(EM_ATOMIC_OP_EXCHANGE, addr, newVal, 0);
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_cas_u64(void/*uint64_t*/ *addr, uint64_t oldVal, uint64_t newVal)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldValInMemory = *(uint64_t*)addr;
-	if (oldValInMemory == oldVal)
-		*(uint64_t*)addr = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldValInMemory;
+	return atomic_op_u64(EM_ATOMIC_OP_CAS, addr, oldVal, newVal);
 }
 
 double EMSCRIPTEN_KEEPALIVE emscripten_atomic_load_f64(const void *addr)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	double val = *(double*)addr;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return val;
+	f64_bits v;
+	v.u = atomic_op_u64(EM_ATOMIC_OP_LOAD, addr, 0, 0);
+	return v.d;
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_load_u64(const void *addr)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t val = *(uint64_t*)addr;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return val;
+	return atomic_op_u64(EM_ATOMIC_OP_LOAD, addr, 0, 0);
 }
 
 float EMSCRIPTEN_KEEPALIVE emscripten_atomic_store_f32(void *addr, float val)
@@ -77,132 +135,71 @@ float EMSCRIPTEN_KEEPALIVE emscripten_atomic_store_f32(void *addr, float val)
 
 double EMSCRIPTEN_KEEPALIVE emscripten_atomic_store_f64(void *addr, double val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	double *a = (double*)addr;
-	*a = val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
+	f64_bits v;
+	v.d = val;
+	atomic_op_u64(EM_ATOMIC_OP_STORE, addr, v.u, 0);
 	return val;
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_store_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t*)addr;
-	*a = val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
+	atomic_op_u64(EM_ATOMIC_OP_STORE, addr, val, 0);
 	return val;
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_add_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t *)addr;
-	uint64_t newVal = *a + val;
-	*a = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return newVal;
+	return atomic_op_u64(EM_ATOMIC_OP_ADD, addr, val, 0) + val;
 }
 
 // This variant is implemented for emulating GCC 64-bit __sync_fetch_and_add. Not to be called directly.
 uint64_t EMSCRIPTEN_KEEPALIVE _emscripten_atomic_fetch_and_add_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldVal = *(uint64_t *)addr;
-	*(uint64_t *)addr = oldVal + val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldVal;
+	return atomic_op_u64(EM_ATOMIC_OP_ADD, addr, val, 0);
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_sub_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t *)addr;
-	uint64_t newVal = *a - val;
-	*a = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return newVal;
+	return atomic_op_u64(EM_ATOMIC_OP_SUB, addr, val, 0) - val;
 }
 
 // This variant is implemented for emulating GCC 64-bit __sync_fetch_and_sub. Not to be called directly.
 uint64_t EMSCRIPTEN_KEEPALIVE _emscripten_atomic_fetch_and_sub_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldVal = *(uint64_t *)addr;
-	*(uint64_t *)addr = oldVal - val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldVal;
+	return atomic_op_u64(EM_ATOMIC_OP_SUB, addr, val, 0);
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_and_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t *)addr;
-	uint64_t newVal = *a & val;
-	*a = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return newVal;
+	return atomic_op_u64(EM_ATOMIC_OP_AND, addr, val, 0) & val;
 }
 
 // This variant is implemented for emulating GCC 64-bit __sync_fetch_and_and. Not to be called directly.
 uint64_t EMSCRIPTEN_KEEPALIVE _emscripten_atomic_fetch_and_and_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldVal = *(uint64_t *)addr;
-	*(uint64_t *)addr = oldVal & val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldVal;
+	return atomic_op_u64(EM_ATOMIC_OP_AND, addr, val, 0);
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_or_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t *)addr;
-	uint64_t newVal = *a | val;
-	*a = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return newVal;
+	return atomic_op_u64(EM_ATOMIC_OP_OR, addr, val, 0) | val;
 }
 
 // This variant is implemented for emulating GCC 64-bit __sync_fetch_and_or. Not to be called directly.
 uint64_t EMSCRIPTEN_KEEPALIVE _emscripten_atomic_fetch_and_or_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldVal = *(uint64_t *)addr;
-	*(uint64_t *)addr = oldVal | val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldVal;
+	return atomic_op_u64(EM_ATOMIC_OP_OR, addr, val, 0);
 }
 
 uint64_t EMSCRIPTEN_KEEPALIVE emscripten_atomic_xor_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t *a = (uint64_t *)addr;
-	uint64_t newVal = *a ^ val;
-	*a = newVal;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return newVal;
+	return atomic_op_u64(EM_ATOMIC_OP_XOR, addr, val, 0) ^ val;
 }
 
 // This variant is implemented for emulating GCC 64-bit __sync_fetch_and_xor. Not to be called directly.
 uint64_t EMSCRIPTEN_KEEPALIVE _emscripten_atomic_fetch_and_xor_u64(void *addr, uint64_t val)
 {
-	uintptr_t m = (uintptr_t)addr >> 3;
-	SPINLOCK_ACQUIRE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	uint64_t oldVal = *(uint64_t *)addr;
-	*(uint64_t *)addr = oldVal ^ val;
-	SPINLOCK_RELEASE(&emulated64BitAtomicsLocks[m&(NUM_64BIT_LOCKS-1)]);
-	return oldVal;
+	return atomic_op_u64(EM_ATOMIC_OP_XOR, addr, val, 0);
 }
 
 uint64_t __atomic_load_8(void *ptr, int memmodel)
@@ -220,9 +217,12 @@ uint64_t __atomic_exchange_8(void *ptr, uint64_t value, int memmodel)
   return emscripten_atomic_exchange_u64(ptr, value);
 }
 
-uint64_t __atomic_compare_exchange_8(void *ptr, uint64_t *expected, uint64_t desired, int weak, int success_memmodel, int failure_memmodel)
+_Bool __atomic_compare_exchange_8(void *ptr, uint64_t *expected, uint64_t desired, _Bool weak, int success_memmodel, int failure_memmodel)
 {
-  return emscripten_atomic_cas_u64(ptr, *expected, desired);
+  uint64_t oldVal = emscripten_atomic_cas_u64(ptr, *expected, desired);
+  if (oldVal == *expected) return 1;
+  *expected = oldVal;
+  return 0;
 }
 
 uint64_t __atomic_fetch_add_8(void *ptr, uint64_t value, int memmodel)
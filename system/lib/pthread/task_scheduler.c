@@ -0,0 +1,355 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <assert.h>
+#include <emscripten/threading.h>
+#include <emscripten/task_scheduler.h>
+
+// Returns the PTHREAD_POOL_SIZE that the application was built with, or 0 if the Workers are created on demand.
+extern int _emscripten_pthread_pool_size(void);
+
+// The number of tasks that fit in the deque of a worker, and in the queue of tasks from other threads. Must be a power
+// of two. Tasks that do not fit are run right away by the thread that spawns them.
+#define TASK_QUEUE_SIZE 1024
+
+// How many times an idle worker looks for work before it parks itself.
+#define SPINS_BEFORE_PARKING 32
+
+typedef struct task
+{
+	em_task_func func;
+	void *arg;
+	em_task_group *group;
+	// If set, this is a task of emscripten_parallel_for(), which calls body over the range [begin, end) instead of func.
+	void (*body)(int, int, void*);
+	int begin;
+	int end;
+	int grainSize;
+} task;
+
+// A Chase-Lev deque. The owner thread pushes and pops tasks at the bottom, and other threads steal them from the top.
+// The deque does not grow, so a slot is never overwritten while a thief might still be reading it: the owner only
+// writes to the slot of the top after the top has moved on.
+typedef struct task_deque
+{
+	volatile int top;
+	volatile int bottom;
+	task tasks[TASK_QUEUE_SIZE];
+} task_deque;
+
+typedef struct worker
+{
+	pthread_t thread;
+	uint32_t random;
+	task_deque deque;
+} worker;
+
+static pthread_mutex_t scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+static worker *workers = 0;
+static int num_workers = 0;
+static volatile int running = 0;
+static volatile int shutting_down = 0;
+
+// Incremented whenever tasks are made available. Parked workers futex-wait on it.
+static volatile int task_epoch = 0;
+static volatile int num_parked = 0;
+
+// The tasks that threads other than the workers spawn go to this queue.
+static pthread_mutex_t injected_lock = PTHREAD_MUTEX_INITIALIZER;
+static task injected[TASK_QUEUE_SIZE];
+static int injected_head = 0;
+static volatile int num_injected = 0;
+
+// Holds the index of the worker, plus one, on the worker threads.
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+
+static void create_worker_key()
+{
+	pthread_key_create(&worker_key, 0);
+}
+
+// Returns the index of the calling worker thread, or -1 if the calling thread is not a worker of the scheduler.
+static int current_worker()
+{
+	return (int)(long)pthread_getspecific(worker_key) - 1;
+}
+
+static int deque_push(task_deque *d, const task *t)
+{
+	int b = emscripten_atomic_load_u32((void*)&d->bottom);
+	int top = emscripten_atomic_load_u32((void*)&d->top);
+	if (b - top >= TASK_QUEUE_SIZE) return 0;
+	d->tasks[b & (TASK_QUEUE_SIZE-1)] = *t;
+	emscripten_atomic_store_u32((void*)&d->bottom, b + 1);
+	return 1;
+}
+
+static int deque_pop(task_deque *d, task *t)
+{
+	int b = emscripten_atomic_load_u32((void*)&d->bottom) - 1;
+	emscripten_atomic_store_u32((void*)&d->bottom, b);
+	int top = emscripten_atomic_load_u32((void*)&d->top);
+	if (top > b) {
+		// The deque was empty.
+		emscripten_atomic_store_u32((void*)&d->bottom, b + 1);
+		return 0;
+	}
+	*t = d->tasks[b & (TASK_QUEUE_SIZE-1)];
+	if (top == b) {
+		// This was the last task, so race the thieves for it.
+		int won = emscripten_atomic_cas_u32((void*)&d->top, top, top + 1) == (uint32_t)top;
+		emscripten_atomic_store_u32((void*)&d->bottom, b + 1);
+		return won;
+	}
+	return 1;
+}
+
+static int deque_steal(task_deque *d, task *t)
+{
+	int top = emscripten_atomic_load_u32((void*)&d->top);
+	int b = emscripten_atomic_load_u32((void*)&d->bottom);
+	if (top >= b) return 0;
+	task stolen = d->tasks[top & (TASK_QUEUE_SIZE-1)];
+	if (emscripten_atomic_cas_u32((void*)&d->top, top, top + 1) != (uint32_t)top) return 0;
+	*t = stolen;
+	return 1;
+}
+
+static int deque_size(task_deque *d)
+{
+	return (int)emscripten_atomic_load_u32((void*)&d->bottom) - (int)emscripten_atomic_load_u32((void*)&d->top);
+}
+
+static int inject(const task *t)
+{
+	pthread_mutex_lock(&injected_lock);
+	int count = num_injected;
+	if (count < TASK_QUEUE_SIZE) {
+		injected[(injected_head + count) & (TASK_QUEUE_SIZE-1)] = *t;
+		emscripten_atomic_store_u32((void*)&num_injected, count + 1);
+	}
+	pthread_mutex_unlock(&injected_lock);
+	return count < TASK_QUEUE_SIZE;
+}
+
+static int take_injected(task *t)
+{
+	if (!emscripten_atomic_load_u32((void*)&num_injected)) return 0;
+	pthread_mutex_lock(&injected_lock);
+	int count = num_injected;
+	if (count > 0) {
+		*t = injected[injected_head];
+		injected_head = (injected_head + 1) & (TASK_QUEUE_SIZE-1);
+		emscripten_atomic_store_u32((void*)&num_injected, count - 1);
+	}
+	pthread_mutex_unlock(&injected_lock);
+	return count > 0;
+}
+
+static int find_task(int self, task *t)
+{
+	if (self >= 0 && deque_pop(&workers[self].deque, t)) return 1;
+	if (take_injected(t)) return 1;
+
+	// Steal from the other workers, starting from a random one so that the thieves spread out.
+	static volatile int external_random = 0;
+	uint32_t r;
+	if (self >= 0) {
+		r = workers[self].random;
+		r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+		workers[self].random = r;
+	} else {
+		r = emscripten_atomic_add_u32((void*)&external_random, 1);
+	}
+	for(int i = 0; i < num_workers; ++i) {
+		int victim = (r + i) % num_workers;
+		if (victim != self && deque_steal(&workers[victim].deque, t)) return 1;
+	}
+	return 0;
+}
+
+static int has_tasks()
+{
+	if (emscripten_atomic_load_u32((void*)&num_injected)) return 1;
+	for(int i = 0; i < num_workers; ++i)
+		if (deque_size(&workers[i].deque) > 0) return 1;
+	return 0;
+}
+
+static void tasks_available()
+{
+	emscripten_atomic_add_u32((void*)&task_epoch, 1);
+	if (emscripten_atomic_load_u32((void*)&num_parked)) emscripten_futex_wake(&task_epoch, 1);
+}
+
+static void park()
+{
+	int epoch = emscripten_atomic_load_u32((void*)&task_epoch);
+	emscripten_atomic_add_u32((void*)&num_parked, 1);
+	// A task may have been spawned between the last look and reading the epoch, so look once more before sleeping.
+	// Tasks spawned after this bump the epoch, and the wait returns right away.
+	if (!has_tasks() && !emscripten_atomic_load_u32((void*)&shutting_down))
+		emscripten_futex_wait(&task_epoch, epoch, INFINITY);
+	emscripten_atomic_sub_u32((void*)&num_parked, 1);
+}
+
+static void spawn(const task *t);
+
+static void run_task(task *t)
+{
+	if (t->body) {
+		// Split off the upper halves of the range as new tasks, until the rest is small enough to process here.
+		int begin = t->begin;
+		int end = t->end;
+		while(end - begin > t->grainSize) {
+			task upper = *t;
+			upper.begin = begin + (end - begin) / 2;
+			upper.end = end;
+			spawn(&upper);
+			end = upper.begin;
+		}
+		t->body(begin, end, t->arg);
+	} else {
+		t->func(t->arg);
+	}
+
+	// The group may be freed as soon as its count reaches zero, so read nothing from it after the decrement.
+	em_task_group *group = t->group;
+	int pending;
+	do {
+		pending = emscripten_atomic_load_u32((void*)&group->numPending);
+	} while(emscripten_atomic_cas_u32((void*)&group->numPending, pending, pending - 1) != (uint32_t)pending);
+	if (pending == 1) emscripten_futex_wake(&group->numPending, INT_MAX);
+}
+
+static void spawn(const task *t)
+{
+	emscripten_atomic_add_u32((void*)&t->group->numPending, 1);
+	int queued = 0;
+	if (emscripten_atomic_load_u32((void*)&running)) {
+		int self = current_worker();
+		queued = (self >= 0) ? deque_push(&workers[self].deque, t) : inject(t);
+	}
+	if (queued) {
+		tasks_available();
+	} else {
+		task copy = *t;
+		run_task(&copy);
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	int self = (int)(long)arg;
+	pthread_setspecific(worker_key, (void*)(long)(self + 1));
+	emscripten_set_thread_name(pthread_self(), "Task scheduler worker");
+	task t;
+	for(;;) {
+		int found = 0;
+		for(int i = 0; i < SPINS_BEFORE_PARKING && !found; ++i) found = find_task(self, &t);
+		if (found) {
+			run_task(&t);
+			continue;
+		}
+		// Exit only after all the tasks that were spawned have been run.
+		if (emscripten_atomic_load_u32((void*)&shutting_down)) break;
+		park();
+	}
+	return 0;
+}
+
+EMSCRIPTEN_RESULT emscripten_task_scheduler_init(int numThreads)
+{
+	pthread_once(&worker_key_once, create_worker_key);
+	if (!emscripten_has_threading_support()) return EMSCRIPTEN_RESULT_NOT_SUPPORTED;
+
+	pthread_mutex_lock(&scheduler_lock);
+	if (running) {
+		pthread_mutex_unlock(&scheduler_lock);
+		return EMSCRIPTEN_RESULT_NOT_SUPPORTED;
+	}
+	if (numThreads <= 0) numThreads = _emscripten_pthread_pool_size();
+	if (numThreads <= 0) numThreads = emscripten_num_logical_cores();
+	if (numThreads <= 0) numThreads = 1;
+
+	workers = (worker*)calloc(numThreads, sizeof(worker));
+	if (!workers) {
+		pthread_mutex_unlock(&scheduler_lock);
+		return EMSCRIPTEN_RESULT_FAILED;
+	}
+	num_workers = numThreads;
+	for(int i = 0; i < numThreads; ++i) workers[i].random = 2654435761u * (i + 1);
+	emscripten_atomic_store_u32((void*)&shutting_down, 0);
+	emscripten_atomic_store_u32((void*)&running, 1);
+
+	for(int i = 0; i < numThreads; ++i) {
+		int rc = pthread_create(&workers[i].thread, 0, worker_main, (void*)(long)i);
+		assert(rc == 0);
+	}
+	pthread_mutex_unlock(&scheduler_lock);
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+void emscripten_task_scheduler_shutdown(void)
+{
+	pthread_mutex_lock(&scheduler_lock);
+	if (!running) {
+		pthread_mutex_unlock(&scheduler_lock);
+		return;
+	}
+	assert(current_worker() < 0 && "emscripten_task_scheduler_shutdown() cannot be called from a task!");
+	emscripten_atomic_store_u32((void*)&shutting_down, 1);
+	emscripten_atomic_add_u32((void*)&task_epoch, 1);
+	emscripten_futex_wake(&task_epoch, INT_MAX);
+	for(int i = 0; i < num_workers; ++i) pthread_join(workers[i].thread, 0);
+
+	// The workers have run every queued task, so no other thread can be looking at them any more.
+	emscripten_atomic_store_u32((void*)&running, 0);
+	free(workers);
+	workers = 0;
+	num_workers = 0;
+	pthread_mutex_unlock(&scheduler_lock);
+}
+
+int emscripten_task_scheduler_num_threads(void)
+{
+	return emscripten_atomic_load_u32((void*)&running) ? num_workers : 0;
+}
+
+void emscripten_task_spawn(em_task_group *group, em_task_func func, void *arg)
+{
+	if (!emscripten_atomic_load_u32((void*)&running)) emscripten_task_scheduler_init(0);
+	task t = { func, arg, group };
+	spawn(&t);
+}
+
+void emscripten_task_group_wait(em_task_group *group)
+{
+	int self = emscripten_atomic_load_u32((void*)&running) ? current_worker() : -1;
+	for(;;) {
+		int pending = emscripten_atomic_load_u32((void*)&group->numPending);
+		if (!pending) return;
+		task t;
+		if (emscripten_atomic_load_u32((void*)&running) && find_task(self, &t)) run_task(&t);
+		else emscripten_futex_wait(&group->numPending, pending, INFINITY);
+	}
+}
+
+void emscripten_parallel_for(int begin, int end, int grainSize, void (*body)(int rangeBegin, int rangeEnd, void *arg), void *arg)
+{
+	if (begin >= end) return;
+	if (!emscripten_atomic_load_u32((void*)&running)) emscripten_task_scheduler_init(0);
+	if (grainSize <= 0) {
+		// Aim for a few ranges per thread, so that the threads that finish early can steal the rest.
+		int numThreads = emscripten_task_scheduler_num_threads() + 1;
+		grainSize = (end - begin) / (8 * numThreads);
+		if (grainSize < 1) grainSize = 1;
+	}
+	em_task_group group = EM_TASK_GROUP_INIT;
+	task t = { 0, arg, &group, body, begin, end, grainSize };
+	emscripten_atomic_add_u32((void*)&group.numPending, 1);
+	run_task(&t);
+	emscripten_task_group_wait(&group);
+}
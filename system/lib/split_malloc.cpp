@@ -3,9 +3,12 @@
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <errno.h>
+#include <malloc.h>
 
 #include <emscripten.h>
 
@@ -19,6 +22,8 @@ void* mspace_malloc(mspace space, size_t size);
 void mspace_free(mspace space, void* ptr);
 void* mspace_realloc(mspace msp, void* oldmem, size_t bytes);
 void* mspace_memalign(mspace msp, size_t alignment, size_t bytes);
+struct mallinfo mspace_mallinfo(mspace msp);
+size_t mspace_footprint(mspace msp);
 
 }
 
@@ -27,6 +32,7 @@ void* mspace_memalign(mspace msp, size_t alignment, size_t bytes);
 static bool initialized = false;
 static size_t total_memory = 0;
 static size_t split_memory = 0;
+static unsigned split_shift = 0; // log2(split_memory)
 static size_t num_spaces = 0;
 
 enum AllocateResult {
@@ -40,12 +46,14 @@ struct Space {
   bool allocated; // whether storage is allocated for this chunk, both an ArrayBuffer in JS and an mspace here
   size_t count; // how many allocations are in the space
   size_t index; // the index of this space, it then represents memory at SPLIT_MEMORY*index
+  size_t failed_size; // when the space is marked as full, the smallest allocation that did not fit in it
 
   void init(int i) {
     space = 0;
     allocated = false;
     count = 0;
     index = i;
+    failed_size = 0;
   }
 
   AllocateResult allocate() {
@@ -99,21 +107,52 @@ struct Space {
 
 static Space spaces[MAX_SPACES];
 
+// One bit per space, set while the space may have room for more allocations. A bit is cleared when an allocation
+// fails in its space, and set again when something is freed there, so that malloc finds a space with room without
+// visiting the full ones.
+static unsigned has_room[(MAX_SPACES + 31) / 32];
+
+static void mark_room(int i) {
+  has_room[i >> 5] |= 1u << (i & 31);
+  spaces[i].failed_size = 0;
+}
+
+static void mark_full(int i, size_t size) {
+  has_room[i >> 5] &= ~(1u << (i & 31));
+  spaces[i].failed_size = size;
+}
+
+// Returns the first space at or after start, wrapping around, that may have room, or -1 if all are marked full.
+static int find_room(int start) {
+  int words = (num_spaces + 31) >> 5;
+  int w = start >> 5;
+  unsigned bits = has_room[w] & (~0u << (start & 31));
+  for (int n = 0; n <= words; n++) { // one more than words, for the bits of the first word that are before start
+    if (bits) return (w << 5) + __builtin_ctz(bits); // bits past num_spaces are never set
+    w++;
+    if (w == words) w = 0;
+    bits = has_room[w];
+  }
+  return -1;
+}
+
 static void init() {
   total_memory = EM_ASM_INT({ return TOTAL_MEMORY; });
   split_memory = EM_ASM_INT({ return SPLIT_MEMORY; });
+  assert((split_memory & (split_memory - 1)) == 0); // emcc makes sure SPLIT_MEMORY is a power of 2
+  split_shift = __builtin_ctz(split_memory);
   num_spaces = EM_ASM_INT({ return HEAPU8s.length; });
   if (num_spaces >= MAX_SPACES) abort();
   for (int i = 0; i < num_spaces; i++) {
     spaces[i].init(i);
+    mark_room(i);
   }
   initialized = true;
 }
 
-// TODO: optimize, these are powers of 2
 // TODO: add optional asserts in these
-#define space_index(ptr) (((unsigned)ptr) / split_memory)
-#define space_relative(ptr) (((unsigned)ptr) % split_memory)
+#define space_index(ptr) (((unsigned)ptr) >> split_shift)
+#define space_relative(ptr) (((unsigned)ptr) & (split_memory - 1))
 
 static mspace get_space(void* ptr) { // for a valid pointer, so the space must already exist
   int index = space_index(ptr);
@@ -123,6 +162,24 @@ static mspace get_space(void* ptr) { // for a valid pointer, so the space must a
   return space.space;
 }
 
+// allocates in space i, allocating storage for the space first if it has none yet
+static void* allocate_in(int i, size_t size, bool malloc, size_t alignment, AllocateResult* result) {
+  Space& space = spaces[i];
+  *result = OK;
+  if (!space.allocated) {
+    *result = space.allocate();
+    if (*result != OK) return 0;
+  }
+  void *ret;
+  if (malloc) {
+    ret = mspace_malloc(space.space, size);
+  } else {
+    ret = mspace_memalign(space.space, alignment, size);
+  }
+  if (ret) space.count++;
+  return ret;
+}
+
 static void* get_memory(size_t size, bool malloc=true, size_t alignment=-1, bool must_succeed=false) {
   if (!initialized) {
     init();
@@ -138,34 +195,34 @@ static void* get_memory(size_t size, bool malloc=true, size_t alignment=-1, bool
     return 0;
   }
   static int next = 0;
-  int start = next;
-  while (1) { // simple round-robin, while keeping to use the same one as long as it keeps succeeding
-    AllocateResult result = OK;
-    if (!spaces[next].allocated) {
-      result = spaces[next].allocate();
-      if (result == NO_MEMORY) return 0; // mallocation failure
+  while (1) { // keep to use the same space as long as it keeps succeeding, then move on to the next one with room
+    int i = find_room(next);
+    if (i < 0) break;
+    next = i;
+    AllocateResult result;
+    void *ret = allocate_in(i, size, malloc, alignment, &result);
+    if (ret) return ret;
+    if (result == NO_MEMORY) return 0; // mallocation failure
+    if (must_succeed) {
+      EM_ASM({ Module.printErr("failed to allocate in a new space after memory growth, perhaps increase SPLIT_MEMORY?"); });
+      abort();
     }
-    if (result == OK) {
-      void *ret;
-      if (malloc) {
-        ret = mspace_malloc(spaces[next].space, size);
-      } else {
-        ret = mspace_memalign(spaces[next].space, alignment, size);
-      }
-      if (ret) {
-        spaces[next].count++;
-        return ret;
-      }
-      if (must_succeed) {
-        EM_ASM({ Module.printErr("failed to allocate in a new space after memory growth, perhaps increase SPLIT_MEMORY?"); });
-        abort();
-      }
-    } else {
-      assert(result == ALREADY_USED); // continue on to the next space
+    // if the chunk is already used by other code, we cannot allocate in it at all
+    mark_full(i, result == ALREADY_USED ? 0 : size);
+  }
+  // all spaces are marked full, but an allocation smaller than the ones that failed in a space may still fit there, and
+  // chunks that other code used may have been freed since. try those before adding another chunk
+  for (int i = 0; i < num_spaces; i++) {
+    if (spaces[i].allocated && size >= spaces[i].failed_size) continue;
+    AllocateResult result;
+    void *ret = allocate_in(i, size, malloc, alignment, &result);
+    if (ret) {
+      mark_room(i);
+      next = i;
+      return ret;
     }
-    next++;
-    if (next == num_spaces) next = 0;
-    if (next == start) break;
+    if (result == NO_MEMORY) return 0;
+    mark_full(i, result == ALREADY_USED ? 0 : size);
   }
   // we cycled, so none of them can allocate
   int returnNull = EM_ASM_INT({
@@ -179,6 +236,7 @@ static void* get_memory(size_t size, bool malloc=true, size_t alignment=-1, bool
   // memory growth is on, add another chunk
   if (num_spaces + 1 >= MAX_SPACES) abort();
   spaces[num_spaces].init(num_spaces);
+  mark_room(num_spaces);
   next = num_spaces;
   num_spaces++;
   return get_memory(size, malloc, alignment, true);
@@ -204,6 +262,7 @@ void free(void* ptr) {
   if (space.count == 0) {
     spaces[index].free();
   }
+  mark_room(index);
 }
 
 void* realloc(void* ptr, size_t newsize) {
@@ -227,6 +286,36 @@ void* calloc(size_t num, size_t size) {
   return ret;
 }
 
+// the elements of a batch can end up in different spaces, so they are allocated one by one
+int emscripten_malloc_aligned_batch(size_t count, size_t size, size_t alignment, void** ptrs) {
+  if (alignment & (alignment - 1)) return EINVAL;
+  for (size_t i = 0; i < count; i++) {
+    ptrs[i] = memalign(alignment, size);
+    if (!ptrs[i]) {
+      while (i > 0) free(ptrs[--i]);
+      return ENOMEM;
+    }
+  }
+  return 0;
+}
+
+// the malloc part of emscripten_get_heap_stats() in library.js. mallinfo does not give the sizes of blocks, so only
+// the totals are filled in
+void emscripten_malloc_heap_stats(emscripten_heap_stats* stats) {
+  size_t heapFields = offsetof(emscripten_heap_stats, malloc_footprint);
+  memset((char*)stats + heapFields, 0, sizeof(*stats) - heapFields);
+  if (!initialized) return;
+  for (int i = 0; i < num_spaces; i++) {
+    if (!spaces[i].allocated) continue;
+    struct mallinfo info = mspace_mallinfo(spaces[i].space);
+    stats->malloc_footprint += mspace_footprint(spaces[i].space);
+    stats->in_use_bytes += info.uordblks;
+    stats->in_use_blocks += spaces[i].count;
+    stats->free_bytes += info.fordblks;
+    stats->free_blocks += info.ordblks;
+  }
+}
+
 // very minimal sbrk, within one chunk
 void* sbrk(intptr_t increment) {
   if (!initialized) {
@@ -0,0 +1,191 @@
+/*
+   malloc/free with per-thread caches, for -s MALLOC_THREAD_CACHE=1
+
+   This includes dlmalloc with USE_DL_PREFIX, and the functions here put a small cache of free blocks for each thread in
+   front of it. Most allocations and frees of small blocks are then served from the cache of the calling thread without
+   taking the global dlmalloc lock. Blocks move between a cache and dlmalloc in batches, so that the lock is taken once
+   per batch.
+
+   A cached block is an ordinary dlmalloc chunk, so it can be freed on any thread: it goes to the cache of the thread
+   that frees it, and no block is ever handed back to the thread that allocated it.
+*/
+
+#define USE_DL_PREFIX 1
+#include "dlmalloc.c"
+
+#include <errno.h>
+#include <pthread.h>
+
+#define EXPORT __attribute__((__weak__, __visibility__("default")))
+
+// Size class c holds blocks of at least c*CLASS_GRANULARITY usable bytes. Larger requests go to dlmalloc directly.
+#define CLASS_GRANULARITY 16
+#define NUM_CLASSES 32
+#define MAX_CACHED_SIZE (NUM_CLASSES * CLASS_GRANULARITY)
+
+// The most free blocks that a thread keeps in one size class. When a class is full, half of it goes back to dlmalloc.
+#define CLASS_CAPACITY 32
+
+// The number of blocks that are allocated from dlmalloc at once when a size class of a thread runs empty.
+#define REFILL_BATCH 8
+
+typedef struct cached_block
+{
+	struct cached_block *next;
+} cached_block;
+
+typedef struct thread_cache
+{
+	cached_block *head[NUM_CLASSES + 1];
+	int count[NUM_CLASSES + 1];
+} thread_cache;
+
+static pthread_key_t cacheKey;
+static pthread_once_t cacheKeyOnce = PTHREAD_ONCE_INIT;
+// 1 when cacheKey is usable, -1 if it could not be created, in which case every call goes to dlmalloc.
+static volatile int cacheKeyState = 0;
+
+static void release_blocks(thread_cache *cache, int c, int numBlocks)
+{
+	void *blocks[CLASS_CAPACITY];
+	int n = 0;
+	while (n < numBlocks && cache->head[c])
+	{
+		blocks[n++] = cache->head[c];
+		cache->head[c] = cache->head[c]->next;
+	}
+	cache->count[c] -= n;
+	dlbulk_free(blocks, n);
+}
+
+// Called when a thread exits: gives all blocks of its cache back to dlmalloc.
+static void destroy_cache(void *arg)
+{
+	thread_cache *cache = (thread_cache*)arg;
+	for(int c = 1; c <= NUM_CLASSES; ++c)
+		release_blocks(cache, c, cache->count[c]);
+	dlfree(cache);
+}
+
+static void create_cache_key(void)
+{
+	cacheKeyState = (pthread_key_create(&cacheKey, destroy_cache) == 0) ? 1 : -1;
+}
+
+// Returns the cache of the calling thread, creating it if needed, or 0 if the thread cannot have a cache.
+static thread_cache *get_cache(void)
+{
+	// Before the runtime registers the main thread, and after a thread has unregistered itself, there is no thread
+	// block to keep the cache in.
+	if (!pthread_self()) return 0;
+	if (cacheKeyState == 0) pthread_once(&cacheKeyOnce, create_cache_key);
+	if (cacheKeyState < 0) return 0;
+	thread_cache *cache = (thread_cache*)pthread_getspecific(cacheKey);
+	if (!cache)
+	{
+		cache = (thread_cache*)dlcalloc(1, sizeof(thread_cache));
+		if (cache && pthread_setspecific(cacheKey, cache) != 0)
+		{
+			dlfree(cache);
+			cache = 0;
+		}
+	}
+	return cache;
+}
+
+// Fills an empty size class with a batch of blocks carved out of one dlmalloc chunk, under a single lock.
+static void refill(thread_cache *cache, int c)
+{
+	size_t sizes[REFILL_BATCH];
+	void *chunks[REFILL_BATCH];
+	for(int i = 0; i < REFILL_BATCH; ++i)
+		sizes[i] = c * CLASS_GRANULARITY;
+	if (!dlindependent_comalloc(REFILL_BATCH, sizes, chunks))
+		return;
+	for(int i = 0; i < REFILL_BATCH; ++i)
+	{
+		cached_block *b = (cached_block*)chunks[i];
+		b->next = cache->head[c];
+		cache->head[c] = b;
+	}
+	cache->count[c] += REFILL_BATCH;
+}
+
+EXPORT void *malloc(size_t bytes)
+{
+	if (bytes > MAX_CACHED_SIZE) return dlmalloc(bytes);
+	thread_cache *cache = get_cache();
+	if (!cache) return dlmalloc(bytes);
+
+	int c = bytes ? (bytes + CLASS_GRANULARITY - 1) / CLASS_GRANULARITY : 1;
+	if (!cache->head[c]) refill(cache, c);
+	cached_block *b = cache->head[c];
+	if (!b) return dlmalloc(bytes);
+	cache->head[c] = b->next;
+	--cache->count[c];
+	emscripten_trace_record_allocation(b, bytes);
+	return b;
+}
+
+EXPORT void free(void *mem)
+{
+	if (!mem) return;
+	// The class of a block follows from its usable size, so blocks that were not allocated through the cache are
+	// cached as well. Blocks that are too small or too large for any class go back to dlmalloc.
+	size_t usable = dlmalloc_usable_size(mem);
+	int c = usable / CLASS_GRANULARITY;
+	thread_cache *cache = (c >= 1 && c <= NUM_CLASSES) ? get_cache() : 0;
+	if (!cache)
+	{
+		dlfree(mem);
+		return;
+	}
+	emscripten_trace_record_free(mem);
+	if (cache->count[c] >= CLASS_CAPACITY)
+		release_blocks(cache, c, CLASS_CAPACITY / 2);
+	cached_block *b = (cached_block*)mem;
+	b->next = cache->head[c];
+	cache->head[c] = b;
+	++cache->count[c];
+}
+
+EXPORT void *calloc(size_t n_elements, size_t elem_size)
+{
+	size_t bytes = n_elements * elem_size;
+	if (n_elements != 0 && bytes / n_elements != elem_size)
+	{
+		errno = ENOMEM;
+		return 0;
+	}
+	if (bytes > MAX_CACHED_SIZE) return dlcalloc(n_elements, elem_size);
+	void *mem = malloc(bytes);
+	if (mem) memset(mem, 0, bytes);
+	return mem;
+}
+
+EXPORT void *realloc(void *oldmem, size_t bytes)
+{
+	if (!oldmem) return malloc(bytes);
+	return dlrealloc(oldmem, bytes);
+}
+
+// The rest of the API does not involve the caches.
+extern __typeof(dlrealloc_in_place) realloc_in_place __attribute__((weak, alias("dlrealloc_in_place")));
+extern __typeof(dlmemalign) memalign __attribute__((weak, alias("dlmemalign")));
+extern __typeof(dlposix_memalign) posix_memalign __attribute__((weak, alias("dlposix_memalign")));
+extern __typeof(dlvalloc) valloc __attribute__((weak, alias("dlvalloc")));
+extern __typeof(dlpvalloc) pvalloc __attribute__((weak, alias("dlpvalloc")));
+extern __typeof(dlmallinfo) mallinfo __attribute__((weak, alias("dlmallinfo")));
+extern __typeof(dlmallopt) mallopt __attribute__((weak, alias("dlmallopt")));
+extern __typeof(dlmalloc_trim) malloc_trim __attribute__((weak, alias("dlmalloc_trim")));
+extern __typeof(dlmalloc_stats) malloc_stats __attribute__((weak, alias("dlmalloc_stats")));
+extern __typeof(dlmalloc_usable_size) malloc_usable_size __attribute__((weak, alias("dlmalloc_usable_size")));
+extern __typeof(dlmalloc_footprint) malloc_footprint __attribute__((weak, alias("dlmalloc_footprint")));
+extern __typeof(dlmalloc_max_footprint) malloc_max_footprint __attribute__((weak, alias("dlmalloc_max_footprint")));
+extern __typeof(dlmalloc_footprint_limit) malloc_footprint_limit __attribute__((weak, alias("dlmalloc_footprint_limit")));
+extern __typeof(dlmalloc_set_footprint_limit) malloc_set_footprint_limit __attribute__((weak, alias("dlmalloc_set_footprint_limit")));
+extern __typeof(dlindependent_calloc) independent_calloc __attribute__((weak, alias("dlindependent_calloc")));
+extern __typeof(dlindependent_comalloc) independent_comalloc __attribute__((weak, alias("dlindependent_comalloc")));
+extern __typeof(dlbulk_free) bulk_free __attribute__((weak, alias("dlbulk_free")));
+extern __typeof(dlmalloc_aligned_batch) emscripten_malloc_aligned_batch __attribute__((weak, alias("dlmalloc_aligned_batch")));
+extern __typeof(dlmalloc_heap_stats) emscripten_malloc_heap_stats __attribute__((weak, alias("dlmalloc_heap_stats")));
@@ -0,0 +1,101 @@
+/*
+   The trace buffer of -s TRACE_BUFFER, see emscripten/trace.h
+
+   With tracing on, the malloc library reports every allocation, reallocation and free. Without the buffer, each of
+   them calls into library_trace.js, which hands the event to the memory profiler and posts one message to the trace
+   collector. Here they are written into a ring of fixed size records in the heap instead, with no call out of
+   compiled code, and library_trace.js drains the ring in batches.
+
+   Any thread may write events. A writer reserves a record by advancing head with a compare-and-swap, fills it in,
+   and then publishes it by storing its sequence number, so the reader stops at records that are reserved but not
+   written yet. When the ring is full, events are dropped and counted rather than waiting for the reader.
+*/
+
+#include <stdint.h>
+#include <emscripten/trace.h>
+
+#define TRACE_BUFFER_ALLOCATE 1
+#define TRACE_BUFFER_REALLOCATE 2
+#define TRACE_BUFFER_FREE 3
+#define TRACE_BUFFER_ASSOCIATE_STORAGE_SIZE 4
+
+// The layout is shared with EmscriptenTrace.drainBuffer() in library_trace.js.
+typedef struct trace_record
+{
+	volatile uint32_t seq; // index + 1 once the record is written
+	uint32_t type;
+	uint32_t a, b, c;
+	uint32_t padding;
+	double time;
+} trace_record;
+
+typedef struct trace_buffer
+{
+	volatile uint32_t head; // records reserved by writers
+	volatile uint32_t tail; // records drained by the reader
+	uint32_t capacity; // a power of two
+	volatile uint32_t dropped;
+	volatile uint32_t enabled; // set while something consumes the events
+	uint32_t padding;
+	volatile double now; // a recent time, updated by the reader, since getting the time needs a call out
+	trace_record records[];
+} trace_buffer;
+
+// In library_trace.js. Returns the buffer, which is allocated statically at startup.
+trace_buffer *emscripten_trace_js_buffer(void);
+// Drains the buffer early when it fills up half way.
+void emscripten_trace_js_drain_buffer(void);
+
+static trace_buffer *buffer = 0;
+
+static void record(uint32_t type, uint32_t a, uint32_t b, uint32_t c)
+{
+	trace_buffer *buf = buffer;
+	if (!buf) buf = buffer = emscripten_trace_js_buffer();
+	if (!buf->enabled) return;
+
+	uint32_t head;
+	do
+	{
+		head = buf->head;
+		if (head - buf->tail >= buf->capacity)
+		{
+			__sync_fetch_and_add(&buf->dropped, 1);
+			return;
+		}
+	} while (__sync_val_compare_and_swap(&buf->head, head, head + 1) != head);
+
+	trace_record *r = &buf->records[head & (buf->capacity - 1)];
+	r->type = type;
+	r->a = a;
+	r->b = b;
+	r->c = c;
+	r->time = buf->now;
+	__sync_synchronize();
+	r->seq = head + 1;
+
+#ifndef __EMSCRIPTEN_PTHREADS__
+	// Only the main thread can drain, so with threads the periodic drains have to keep up.
+	if (head + 1 - buf->tail == buf->capacity / 2) emscripten_trace_js_drain_buffer();
+#endif
+}
+
+void emscripten_trace_record_allocation(const void *address, int32_t size)
+{
+	record(TRACE_BUFFER_ALLOCATE, (uint32_t)address, (uint32_t)size, 0);
+}
+
+void emscripten_trace_record_reallocation(const void *old_address, const void *new_address, int32_t size)
+{
+	record(TRACE_BUFFER_REALLOCATE, (uint32_t)old_address, (uint32_t)new_address, (uint32_t)size);
+}
+
+void emscripten_trace_record_free(const void *address)
+{
+	record(TRACE_BUFFER_FREE, (uint32_t)address, 0, 0);
+}
+
+void emscripten_trace_associate_storage_size(const void *address, int32_t size)
+{
+	record(TRACE_BUFFER_ASSOCIATE_STORAGE_SIZE, (uint32_t)address, (uint32_t)size, 0);
+}
@@ -0,0 +1,59 @@
+#include <aio.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+int main()
+{
+  // Start downloading the file without waiting, and queue two reads of it.
+  int fd = open("hello_file.txt", O_RDONLY | O_NONBLOCK);
+  assert(fd >= 0);
+  char buffers[2][16];
+  struct aiocb cbs[2];
+  for(int i = 0; i < 2; ++i)
+  {
+    memset(&cbs[i], 0, sizeof(cbs[i]));
+    memset(buffers[i], 0, sizeof(buffers[i]));
+    cbs[i].aio_fildes = fd;
+    cbs[i].aio_buf = buffers[i];
+    cbs[i].aio_nbytes = sizeof(buffers[i]) - 1;
+    cbs[i].aio_offset = i; // The second read skips the first byte.
+    int ret = aio_read(&cbs[i]);
+    assert(ret == 0);
+  }
+
+  const struct aiocb *list[2] = { &cbs[0], &cbs[1] };
+  for(int done = 0; done < 2;)
+  {
+    int ret = aio_suspend(list, 2, 0);
+    assert(ret == 0);
+    for(int i = 0; i < 2; ++i)
+    {
+      if (!list[i] || aio_error(&cbs[i]) == EINPROGRESS) continue;
+      assert(aio_error(&cbs[i]) == 0);
+      printf("read %d: %s\n", i, buffers[i]);
+      assert(aio_return(&cbs[i]) == 6 - i);
+      assert(!strcmp(buffers[i], i == 0 ? "Hello!" : "ello!"));
+      list[i] = 0;
+      ++done;
+    }
+  }
+  close(fd);
+
+  // A file that does not exist fails the reads.
+  fd = open("does_not_exist.txt", O_RDONLY | O_NONBLOCK);
+  assert(fd >= 0);
+  char c;
+  ssize_t n;
+  while((n = read(fd, &c, 1)) < 0 && errno == EAGAIN) {}
+  assert(n < 0 && errno == EIO);
+  close(fd);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+int main()
+{
+  int fd = open("hello_file.txt", O_RDONLY);
+  assert(fd >= 0);
+  const size_t len = strlen("Hello!");
+
+  // A read-only private mapping points to the downloaded file, and stays valid after the file is closed.
+  char *data = (char*)mmap(0, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  assert(data != MAP_FAILED);
+  char *copy = (char*)mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  assert(copy != MAP_FAILED);
+  assert(copy != data);
+  int ret = close(fd);
+  assert(ret == 0);
+  printf("mapped: %.*s\n", (int)len, data);
+  assert(!memcmp(data, "Hello!", len));
+
+  // Writing to a writable private mapping does not change the file.
+  copy[0] = 'J';
+  assert(!memcmp(copy, "Jello!", len));
+  assert(!memcmp(data, "Hello!", len));
+
+  // Parts of a mapping cannot be unmapped, and leave it in place.
+  ret = munmap(copy, 2);
+  assert(ret == -1 && errno == EINVAL);
+  ret = munmap(copy + 2, len - 2);
+  assert(ret == -1 && errno == EINVAL);
+  assert(!memcmp(copy, "Jello!", len));
+
+  ret = munmap(copy, len);
+  assert(ret == 0);
+  ret = munmap(data, len);
+  assert(ret == 0);
+
+  // A writable shared mapping writes back to the file.
+  fd = open("hello_file.txt", O_RDWR);
+  assert(fd >= 0);
+  char *shared = (char*)mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  assert(shared != MAP_FAILED);
+  shared[0] = 'C';
+  ret = msync(shared, len, MS_SYNC);
+  assert(ret == 0);
+  char buffer[16] = {};
+  ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+  assert(n == (ssize_t)len);
+  assert(!strcmp(buffer, "Cello!"));
+  munmap(shared, len);
+  close(fd);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
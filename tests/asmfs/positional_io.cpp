@@ -0,0 +1,50 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+int main()
+{
+  int fd = open("hello_file.txt", O_RDONLY);
+  assert(fd >= 0);
+
+  // preadv() reads into several buffers at an offset, and does not move the file position.
+  char a[3] = {}, b[3] = {};
+  struct iovec iov[2] = { { a, 2 }, { b, 2 } };
+  ssize_t n = preadv(fd, iov, 2, 1);
+  assert(n == 4);
+  assert(!strcmp(a, "el") && !strcmp(b, "lo"));
+  assert(lseek(fd, 0, SEEK_CUR) == 0);
+
+  // pwritev() writes from several buffers at an offset.
+  int out = open("copy.txt", O_RDWR | O_CREAT | O_TRUNC, 0644);
+  assert(out >= 0);
+  struct iovec wiov[2] = { { (void*)"<<", 2 }, { (void*)">>", 2 } };
+  n = pwritev(out, wiov, 2, 6);
+  assert(n == 4);
+  assert(lseek(out, 0, SEEK_CUR) == 0);
+
+  // sendfile() copies from one file to the other.
+  off_t offset = 0;
+  n = sendfile(out, fd, &offset, 100);
+  assert(n == 6);
+  assert(offset == 6);
+  assert(lseek(fd, 0, SEEK_CUR) == 0);
+  assert(lseek(out, 0, SEEK_CUR) == 6);
+
+  char buffer[16] = {};
+  n = pread(out, buffer, sizeof(buffer) - 1, 0);
+  assert(n == 10);
+  printf("copy: %s\n", buffer);
+  assert(!strcmp(buffer, "Hello!<<>>"));
+  close(out);
+  close(fd);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
@@ -0,0 +1,49 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+int main()
+{
+  // The files of the package are in the filesystem before main() runs.
+  struct stat st;
+  int ret = stat("/assets/sub/hello_file.txt", &st);
+  assert(ret == 0);
+  assert(st.st_size == 6);
+
+  int fd = open("/assets/sub/hello_file.txt", O_RDONLY);
+  assert(fd >= 0);
+  char buffer[16] = {};
+  ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+  assert(n == 6);
+  printf("read: %s\n", buffer);
+  assert(!strcmp(buffer, "Hello!"));
+
+  // A read-only mapping points straight into the package.
+  char *data = (char*)mmap(0, 6, PROT_READ, MAP_PRIVATE, fd, 0);
+  assert(data != MAP_FAILED);
+  assert(!memcmp(data, "Hello!", 6));
+  munmap(data, 6);
+  close(fd);
+
+  // Writing to a preloaded file copies the parts that are written to.
+  fd = open("/assets/sub/hello_file.txt", O_RDWR);
+  assert(fd >= 0);
+  n = write(fd, "J", 1);
+  assert(n == 1);
+  close(fd);
+  fd = open("/assets/sub/hello_file.txt", O_RDONLY);
+  memset(buffer, 0, sizeof(buffer));
+  n = read(fd, buffer, sizeof(buffer) - 1);
+  assert(n == 6);
+  assert(!strcmp(buffer, "Jello!"));
+  close(fd);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
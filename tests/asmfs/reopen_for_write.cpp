@@ -0,0 +1,34 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+int main()
+{
+  // Closing the file drops its download.
+  int fd = open("hello_file.txt", O_RDONLY);
+  assert(fd >= 0);
+  close(fd);
+
+  // A write that does not truncate the file downloads it again, and keeps the rest of its contents.
+  fd = open("hello_file.txt", O_WRONLY);
+  assert(fd >= 0);
+  ssize_t n = write(fd, "J", 1);
+  assert(n == 1);
+  close(fd);
+
+  char buffer[7] = {};
+  fd = open("hello_file.txt", O_RDONLY);
+  assert(fd >= 0);
+  n = read(fd, buffer, 6);
+  printf("File contents: %s\n", buffer);
+  assert(n == 6);
+  assert(!strcmp(buffer, "Jello!"));
+  close(fd);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+#define NUM_THREADS 4
+
+static int shared_fd;
+
+static void *thread_main(void *arg)
+{
+  int t = (int)(long)arg;
+
+  // Reads at an explicit offset do not disturb each other, even when the threads share the file descriptor.
+  for(int i = 0; i < 100; ++i)
+  {
+    char c = 0;
+    ssize_t n = pread(shared_fd, &c, 1, (t + i) % 6);
+    assert(n == 1);
+    assert(c == "Hello!"[(t + i) % 6]);
+  }
+
+  // Files are created in the same directories at the same time.
+  for(int i = 0; i < 20; ++i)
+  {
+    char name[64];
+    sprintf(name, "dir%d/sub/file%d_%d", i % 2, t, i);
+    int fd = open(name, O_WRONLY | O_CREAT, 0644);
+    assert(fd >= 0);
+    ssize_t n = pwrite(fd, name, strlen(name), 0);
+    assert(n == (ssize_t)strlen(name));
+    close(fd);
+    struct stat st;
+    int ret = stat(name, &st);
+    assert(ret == 0);
+    assert(st.st_size == (off_t)strlen(name));
+  }
+  return 0;
+}
+
+int main()
+{
+  shared_fd = open("hello_file.txt", O_RDONLY);
+  assert(shared_fd >= 0);
+
+  pthread_t threads[NUM_THREADS];
+  for(int i = 0; i < NUM_THREADS; ++i)
+  {
+    int ret = pthread_create(&threads[i], 0, thread_main, (void*)(long)i);
+    assert(ret == 0);
+  }
+  for(int i = 0; i < NUM_THREADS; ++i)
+    pthread_join(threads[i], 0);
+
+  // pread() did not move the file position.
+  char buffer[16] = {};
+  ssize_t n = read(shared_fd, buffer, sizeof(buffer) - 1);
+  assert(n == 6);
+  assert(!strcmp(buffer, "Hello!"));
+  close(shared_fd);
+  printf("ok\n");
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
@@ -0,0 +1,36 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <emscripten/emscripten.h>
+
+// Run twice: the first run writes the file, which ASMFS_WRITEBACK stores to IndexedDB.
+// The second run, with the page reloaded, finds it there instead of on the server.
+
+int main()
+{
+#ifdef FIRST
+  int fd = open("written_file.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  assert(fd >= 0);
+  ssize_t n = write(fd, SECRET, strlen(SECRET));
+  assert(n == (ssize_t)strlen(SECRET));
+  int ret = fsync(fd);
+  assert(ret == 0);
+  ret = close(fd);
+  assert(ret == 0);
+#else
+  int fd = open("written_file.txt", O_RDONLY);
+  assert(fd >= 0);
+  char buffer[128] = {};
+  ssize_t n = read(fd, buffer, sizeof(buffer));
+  printf("read %d bytes. Result: %s\n", (int)n, buffer);
+  assert(n == (ssize_t)strlen(SECRET));
+  assert(!strcmp(buffer, SECRET));
+  close(fd);
+#endif
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
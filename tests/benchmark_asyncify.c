@@ -0,0 +1,75 @@
+// Measures the overhead of the asyncify transformation on code that calls through function pointers. Only the
+// callbacks of type void (*)(void) can sleep, so the calls through int (*)(int, int) do not need to be transformed,
+// but without -s ASYNCIFY_PRUNE_INDIRECT_CALLS=1 they are.
+
+#include <stdio.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+typedef int (*op_t)(int, int);
+typedef void (*callback_t)(void);
+
+static int __attribute__((noinline)) op_add(int a, int b) { return a + b; }
+static int __attribute__((noinline)) op_sub(int a, int b) { return a - b; }
+static int __attribute__((noinline)) op_mul(int a, int b) { return a * b | 1; }
+static int __attribute__((noinline)) op_xor(int a, int b) { return a ^ b; }
+
+static op_t ops[] = { op_add, op_sub, op_mul, op_xor };
+
+static int __attribute__((noinline)) apply(op_t op, int a, int b)
+{
+  return op(a, b);
+}
+
+static int __attribute__((noinline)) run(int n)
+{
+  int acc = 1;
+  for (int i = 0; i < n; i++)
+  {
+    acc = apply(ops[(acc ^ i) & 3], acc, i);
+  }
+  return acc;
+}
+
+static void __attribute__((noinline)) yield(void)
+{
+#ifdef __EMSCRIPTEN__
+  emscripten_sleep(0);
+#endif
+}
+
+static void __attribute__((noinline)) nothing(void)
+{
+}
+
+static volatile callback_t callbacks[] = { yield, nothing };
+
+int main(int argc, char **argv)
+{
+  int arg = argc > 1 ? argv[1][0] - '0' : 3;
+  int n;
+  switch (arg)
+  {
+    case 0: return 0; break;
+    case 1: n = 1000000; break;
+    case 2: n = 10000000; break;
+    case 3: n = 20000000; break;
+    case 4: n = 100000000; break;
+    case 5: n = 200000000; break;
+    default: printf("error: %d\n", arg); return -1;
+  }
+
+  // Sleeping needs setTimeout, which not all shells have, so the callback that sleeps is never actually picked. It
+  // can be as far as the compiler knows, so everything that can call it is transformed all the same.
+  int which = argc > 100 ? 0 : 1;
+  int result = 0;
+  for (int i = 0; i < 10; i++)
+  {
+    callbacks[which]();
+    result += run(n / 10);
+  }
+  printf("Result: %d\n", result);
+  return 0;
+}
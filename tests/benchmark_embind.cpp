@@ -0,0 +1,168 @@
+// Measures the overhead of embind, one kind of binding at a time, selected by BENCHMARK_EMBIND:
+//   0: free function calls          4: val property get/set
+//   1: method calls                 5: passing std::shared_ptr
+//   2: std::string marshalling      6: value_object round-trips
+//   3: std::vector marshalling
+// The JS side of the calls is in benchmark_embind.js. Native builds make the same calls directly in C++, as a baseline.
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/bind.h>
+#include <emscripten/val.h>
+#endif
+
+#include "tick.h"
+
+#ifndef BENCHMARK_EMBIND
+#define BENCHMARK_EMBIND 0
+#endif
+
+int __attribute__((noinline)) add(int a, int b)
+{
+  return a + b;
+}
+
+class Counter
+{
+public:
+  Counter() : count(0) {}
+  int __attribute__((noinline)) add(int n)
+  {
+    count += n;
+    return count;
+  }
+  int count;
+};
+
+int __attribute__((noinline)) stringLength(const std::string &s)
+{
+  return s.size();
+}
+
+std::string __attribute__((noinline)) makeString(int length)
+{
+  return std::string(length, 'x');
+}
+
+std::vector<int> __attribute__((noinline)) makeVector(int size)
+{
+  return std::vector<int>(size, 1);
+}
+
+int __attribute__((noinline)) takeShared(std::shared_ptr<Counter> counter)
+{
+  return counter->add(1);
+}
+
+struct Point
+{
+  int x;
+  double y;
+};
+
+Point __attribute__((noinline)) movePoint(Point p)
+{
+  p.x += 1;
+  p.y += 0.5;
+  return p;
+}
+
+#ifdef __EMSCRIPTEN__
+using namespace emscripten;
+
+EMSCRIPTEN_BINDINGS(benchmark)
+{
+  function("add", &add);
+  class_<Counter>("Counter")
+    .smart_ptr_constructor("Counter", &std::make_shared<Counter>)
+    .function("add", &Counter::add);
+  function("stringLength", &stringLength);
+  function("makeString", &makeString);
+  register_vector<int>("VectorInt");
+  function("makeVector", &makeVector);
+  function("takeShared", &takeShared);
+  value_object<Point>("Point")
+    .field("x", &Point::x)
+    .field("y", &Point::y);
+  function("movePoint", &movePoint);
+}
+
+extern "C"
+{
+  // Makes iterations calls of the kind of binding from JS, and returns a checksum of their results.
+  double benchmarkEmbind(int kind, int iterations);
+}
+
+double runBenchmark(int iterations)
+{
+#if BENCHMARK_EMBIND == 4
+  // The calls go the other way around here, from C++ into JS.
+  val object = val::object();
+  double sum = 0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    object.set("x", i);
+    sum += object["x"].as<int>();
+  }
+  return sum;
+#else
+  return benchmarkEmbind(BENCHMARK_EMBIND, iterations);
+#endif
+}
+#else
+struct Object
+{
+  int x;
+};
+
+Object * volatile object = new Object();
+
+double runBenchmark(int iterations)
+{
+  double sum = 0;
+  Counter counter;
+  std::shared_ptr<Counter> shared = std::make_shared<Counter>();
+  std::string s(16, 'x');
+  Point p = { 0, 0 };
+  for (int i = 0; i < iterations; ++i)
+  {
+    switch (BENCHMARK_EMBIND)
+    {
+      case 0: sum += add(i, 1); break;
+      case 1: sum += counter.add(1); break;
+      case 2: sum += stringLength(s) + makeString(16).size(); break;
+      case 3: sum += makeVector(16).size(); break;
+      case 4: object->x = i; sum += object->x; break;
+      case 5: sum += takeShared(shared); break;
+      case 6: p.x = i; p = movePoint(p); sum += p.x + p.y; break;
+    }
+  }
+  return sum;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  int arg = argc > 1 ? argv[1][0] - '0' : 3;
+  int iterations;
+  switch(arg) {
+    case 0: return 0; break;
+    case 1: iterations = 10000; break;
+    case 2: iterations = 100000; break;
+    case 3: iterations = 500000; break;
+    case 4: iterations = 1000000; break;
+    case 5: iterations = 2000000; break;
+    default: printf("error: %d\n", arg); return -1;
+  }
+
+  tick_t t0 = tick();
+  double sum = runBenchmark(iterations);
+  tick_t t1 = tick();
+  printf("Sum: %f\n", sum);
+  printf("Total time: %f\n", (t1 - t0) * 1000.0 / ticks_per_sec());
+  return 0;
+}
@@ -0,0 +1,53 @@
+mergeInto(LibraryManager.library, {
+  // The JS side of benchmark_embind.cpp. Bound names are quoted, as the benchmarks are built with closure.
+  benchmarkEmbind: function(kind, iterations) {
+    var sum = 0;
+    var i;
+    switch (kind) {
+      case 0:
+        var add = Module['add'];
+        for (i = 0; i < iterations; ++i) {
+          sum += add(i, 1);
+        }
+        break;
+      case 1:
+        var counter = new Module['Counter']();
+        for (i = 0; i < iterations; ++i) {
+          sum += counter['add'](1);
+        }
+        counter['delete']();
+        break;
+      case 2:
+        var s = 'xxxxxxxxxxxxxxxx';
+        for (i = 0; i < iterations; ++i) {
+          sum += Module['stringLength'](s) + Module['makeString'](16).length;
+        }
+        break;
+      case 3:
+        for (i = 0; i < iterations; ++i) {
+          var v = Module['makeVector'](16);
+          sum += v['size']();
+          v['delete']();
+        }
+        break;
+      case 5:
+        var shared = new Module['Counter']();
+        for (i = 0; i < iterations; ++i) {
+          sum += Module['takeShared'](shared);
+        }
+        shared['delete']();
+        break;
+      case 6:
+        var p = { 'x': 0, 'y': 0 };
+        for (i = 0; i < iterations; ++i) {
+          p['x'] = i;
+          p = Module['movePoint'](p);
+          sum += p['x'] + p['y'];
+        }
+        break;
+      default:
+        throw 'unknown embind benchmark: ' + kind;
+    }
+    return sum;
+  }
+});
@@ -0,0 +1,111 @@
+// Measures the cost of a context switch: two fibers that each do a little work and switch to the other. With
+// -DUSE_COROUTINES the same is done with emscripten_coroutine_next and emscripten_yield, and natively with
+// swapcontext.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include <ucontext.h>
+#endif
+
+static int n;
+static volatile int counter;
+
+#ifdef __EMSCRIPTEN__
+
+#ifdef USE_COROUTINES
+
+static void worker(void *arg)
+{
+  for (int i = 0; i < n; i++)
+  {
+    counter += (int)(long)arg;
+    emscripten_yield();
+  }
+}
+
+static void run(void)
+{
+  emscripten_coroutine a = emscripten_coroutine_create(worker, (void*)1, 0);
+  emscripten_coroutine b = emscripten_coroutine_create(worker, (void*)2, 0);
+  while (emscripten_coroutine_next(a) && emscripten_coroutine_next(b)) {}
+}
+
+#else
+
+static emscripten_fiber fibers[2];
+
+static void worker(void *arg)
+{
+  int self = (int)(long)arg;
+  for (int i = 0; i < n; i++)
+  {
+    counter += self + 1;
+    emscripten_fiber_swap(fibers[1 - self]);
+  }
+  emscripten_fiber_swap(0);
+}
+
+static void run(void)
+{
+  fibers[0] = emscripten_fiber_create(worker, (void*)0, 0, 0);
+  fibers[1] = emscripten_fiber_create(worker, (void*)1, 0, 0);
+  emscripten_fiber_swap(fibers[0]);
+  free(fibers[0]);
+  free(fibers[1]);
+}
+
+#endif
+
+#else
+
+static ucontext_t main_context, contexts[2];
+
+static void worker(int self)
+{
+  for (int i = 0; i < n; i++)
+  {
+    counter += self + 1;
+    swapcontext(&contexts[self], &contexts[1 - self]);
+  }
+  swapcontext(&contexts[self], &main_context);
+}
+
+static void run(void)
+{
+  for (int i = 0; i < 2; i++)
+  {
+    getcontext(&contexts[i]);
+    contexts[i].uc_stack.ss_sp = malloc(65536);
+    contexts[i].uc_stack.ss_size = 65536;
+    contexts[i].uc_link = &main_context;
+    makecontext(&contexts[i], (void (*)(void))worker, 1, i);
+  }
+  swapcontext(&main_context, &contexts[0]);
+  free(contexts[0].uc_stack.ss_sp);
+  free(contexts[1].uc_stack.ss_sp);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+  int arg = argc > 1 ? argv[1][0] - '0' : 3;
+  switch (arg)
+  {
+    case 0: return 0; break;
+    case 1: n = 100000; break;
+    case 2: n = 500000; break;
+    case 3: n = 1000000; break;
+    case 4: n = 5000000; break;
+    case 5: n = 10000000; break;
+    default: printf("error: %d\n", arg); return -1;
+  }
+
+  run();
+  printf("Result: %d\n", counter);
+  return 0;
+}
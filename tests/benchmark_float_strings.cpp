@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+
+#include "tick.h"
+
+// Benchmarks converting doubles to text with printf's %.17g, %e, %g and %f, and back with strtod (select with
+// -DTEST_FORMAT or -DTEST_PARSE), on values of random magnitudes up to 10^MAX_EXP.
+
+#define NUM_VALUES 1024
+double values[NUM_VALUES];
+char strings[NUM_VALUES][320];
+
+size_t resultCheckSum = 0;
+
+static const char *formats[] = { "%.17g", "%e", "%g", "%.3f" };
+
+void __attribute__((noinline)) test_convert(const char *format, int numTimes)
+{
+	char buf[512];
+	for(int i = 0; i < numTimes; ++i)
+	{
+		int r = i & (NUM_VALUES-1);
+#if defined(TEST_FORMAT)
+		resultCheckSum += snprintf(buf, sizeof(buf), format, values[r]);
+#elif defined(TEST_PARSE)
+		double d = strtod(strings[r], 0);
+		resultCheckSum += (size_t)(d != values[r]);
+#else
+#error "select a conversion to benchmark"
+#endif
+	}
+}
+
+std::vector<const char *> testFormats;
+std::vector<double> results;
+
+double totalTimeSecs = 0.0;
+
+#ifndef MAX_EXP
+#define MAX_EXP 300
+#endif
+
+void test_case(const char *format)
+{
+	for(int i = 0; i < NUM_VALUES; ++i)
+	{
+		values[i] = (double)rand() / RAND_MAX;
+		int e = rand() % (2*MAX_EXP+1) - MAX_EXP;
+		for(; e > 0; e--) values[i] *= 10;
+		for(; e < 0; e++) values[i] /= 10;
+		snprintf(strings[i], sizeof(strings[i]), format, values[i]);
+#if defined(TEST_PARSE)
+		values[i] = strtod(strings[i], 0);
+#endif
+	}
+
+	const int numTimes = NUM_VALUES * 256;
+
+	tick_t bestResult = 1e9;
+
+#ifndef NUM_TRIALS
+#define NUM_TRIALS 5
+#endif
+
+	for(int i = 0; i < NUM_TRIALS; ++i)
+	{
+		double t0 = tick();
+		test_convert(format, numTimes);
+		double t1 = tick();
+		if (t1 - t0 < bestResult) bestResult = t1 - t0;
+		totalTimeSecs += (double)(t1 - t0) / ticks_per_sec();
+	}
+
+	testFormats.push_back(format);
+	double seconds = (double)bestResult / ticks_per_sec();
+	results.push_back(seconds > 0 ? numTimes / seconds / 1000000.0 : 0.0);
+}
+
+int main()
+{
+	for(size_t i = 0; i < sizeof(formats)/sizeof(formats[0]); ++i)
+		test_case(formats[i]);
+
+	std::cout << "Test cases: " << std::endl;
+	for(size_t i = 0; i < testFormats.size(); ++i)
+		std::cout << testFormats[i] << (i != testFormats.size()-1 ? "," : "\n");
+	std::cout << "Test results (M conversions/s): " << std::endl;
+	for(size_t i = 0; i < results.size(); ++i)
+		std::cout << results[i] << (i != results.size()-1 ? "," : "\n");
+
+	std::cout << "Result checksum: " << resultCheckSum << std::endl;
+	std::cout << "Total time: " << totalTimeSecs << std::endl;
+}
@@ -21,8 +21,45 @@ char src[1024*1024*64+16] = {};
 
 uint8_t resultCheckSum = 0;
 
+#ifdef RANDOM_SIZES
+// Each copy has a different size, up to the size of the test case, and different alignments, so that no single path
+// of the implementation is always taken. They are picked before timing.
+#define NUM_RANDOM 4096
+int randomSizes[NUM_RANDOM];
+int randomDstOffsets[NUM_RANDOM];
+int randomSrcOffsets[NUM_RANDOM];
+
+void pick_random(int copySize)
+{
+	for(int i = 0; i < NUM_RANDOM; ++i)
+	{
+		randomSizes[i] = 1 + rand() % copySize;
+		randomDstOffsets[i] = rand() & 15;
+		randomSrcOffsets[i] = rand() & 15;
+	}
+}
+#endif
+
+#ifdef TEST_MEMMOVE
+#ifndef RANDOM_SIZES
+#error "TEST_MEMMOVE needs RANDOM_SIZES, to copy between different offsets"
+#endif
+// copy within the same buffer, so that the source and destination overlap, in both directions
+#define COPY(dstOffset, srcOffset, size) memmove(dst + (dstOffset), dst + (srcOffset), (size))
+#else
+#define COPY(dstOffset, srcOffset, size) memcpy(dst + (dstOffset), src + (srcOffset), (size))
+#endif
+
 void __attribute__((noinline)) test_memcpy(int numTimes, int copySize)
 {
+#ifdef RANDOM_SIZES
+	for(int i = 0; i < numTimes; ++i)
+	{
+		int r = i & (NUM_RANDOM-1);
+		COPY(randomDstOffsets[r], randomSrcOffsets[r], randomSizes[r]); resultCheckSum += dst[randomSizes[r] >> 1];
+	}
+	return;
+#endif
 	for(int i = 0; i < numTimes - 8; i += 8)
 	{
 		memcpy(dst, src, copySize); resultCheckSum += dst[copySize >> 1];
@@ -54,6 +91,10 @@ void test_case(int copySize)
 
 	int numTimes = (minimumCopyBytes + copySize-1) / copySize;
 	if (numTimes < 8) numTimes = 8;
+#ifdef RANDOM_SIZES
+	numTimes *= 2; // copies are half the size on average
+	pick_random(copySize);
+#endif
 
 	tick_t bestResult = 1e9;
 
@@ -20,8 +20,33 @@ char dst[1024*1024*64+16] = {};
 
 uint8_t resultCheckSum = 0;
 
+#ifdef RANDOM_SIZES
+// Each memset has a different size, up to the size of the test case, and a different alignment, so that no single
+// path of the implementation is always taken. They are picked before timing.
+#define NUM_RANDOM 4096
+int randomSizes[NUM_RANDOM];
+int randomOffsets[NUM_RANDOM];
+
+void pick_random(int copySize)
+{
+	for(int i = 0; i < NUM_RANDOM; ++i)
+	{
+		randomSizes[i] = 1 + rand() % copySize;
+		randomOffsets[i] = rand() & 15;
+	}
+}
+#endif
+
 void __attribute__((noinline)) test_memset(int numTimes, int copySize)
 {
+#ifdef RANDOM_SIZES
+	for(int i = 0; i < numTimes; ++i)
+	{
+		int r = i & (NUM_RANDOM-1);
+		memset(dst + randomOffsets[r], i ^ 0xAA, randomSizes[r]); resultCheckSum += dst[randomSizes[r] >> 1];
+	}
+	return;
+#endif
 	for(int i = 0; i < numTimes - 8; i += 8)
 	{
 		memset(dst, i ^ 0xAA, copySize); resultCheckSum += dst[copySize >> 1];
@@ -53,6 +78,10 @@ void test_case(int copySize)
 
 	int numTimes = (minimumCopyBytes + copySize-1) / copySize;
 	if (numTimes < 8) numTimes = 8;
+#ifdef RANDOM_SIZES
+	numTimes *= 2; // memsets are half the size on average
+	pick_random(copySize);
+#endif
 
 	tick_t bestResult = 1e9;
 
@@ -0,0 +1,215 @@
+// Measures the costs of threading, one kind of operation at a time, selected by BENCHMARK_PTHREADS:
+//   0: a mutex contended by THREADS threads     3: syscalls proxied to the main thread
+//   1: futex ping-pong between two threads      4: a parallel for over THREADS threads
+//   2: round trips to the main thread           5: an atomic counter shared by THREADS threads
+// Native builds do the same with the host's pthreads. They have no main thread to proxy to, so 2 makes round trips to
+// a server thread through a condition variable instead, and 3 calls the syscall directly.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/threading.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
+
+#include "tick.h"
+
+#ifndef BENCHMARK_PTHREADS
+#define BENCHMARK_PTHREADS 0
+#endif
+
+#ifndef THREADS
+#define THREADS 4
+#endif
+
+static int iterations;
+
+static void futex_wait(volatile int *addr, int val)
+{
+#ifdef __EMSCRIPTEN__
+  emscripten_futex_wait(addr, val, INFINITY);
+#elif defined(__linux__)
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+  while (__atomic_load_n(addr, __ATOMIC_SEQ_CST) == val) sched_yield();
+#endif
+}
+
+static void futex_wake(volatile int *addr)
+{
+#ifdef __EMSCRIPTEN__
+  emscripten_futex_wake(addr, 1);
+#elif defined(__linux__)
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int shared_counter = 0;
+
+static void *mutex_contention(void *arg)
+{
+  for (int i = 0; i < iterations; ++i)
+  {
+    pthread_mutex_lock(&mutex);
+    shared_counter += i & 7;
+    pthread_mutex_unlock(&mutex);
+  }
+  return 0;
+}
+
+static volatile int turn = 0;
+
+static void *futex_ping_pong(void *arg)
+{
+  int self = (int)(long)arg;
+  for (int i = 0; i < iterations; ++i)
+  {
+    int t;
+    while ((t = __atomic_load_n(&turn, __ATOMIC_SEQ_CST)) != self) futex_wait(&turn, t);
+    __atomic_store_n(&turn, 1 - self, __ATOMIC_SEQ_CST);
+    futex_wake(&turn);
+  }
+  return 0;
+}
+
+static int __attribute__((noinline)) increment()
+{
+  return ++shared_counter;
+}
+
+#ifndef __EMSCRIPTEN__
+static pthread_cond_t request_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t response_cond = PTHREAD_COND_INITIALIZER;
+static int requests = 0, responses = 0;
+
+// Stands in for the main thread of the browser in native builds.
+static void *server(void *arg)
+{
+  pthread_mutex_lock(&mutex);
+  for (int i = 0; i < iterations; ++i)
+  {
+    while (requests == responses) pthread_cond_wait(&request_cond, &mutex);
+    increment();
+    ++responses;
+    pthread_cond_signal(&response_cond);
+  }
+  pthread_mutex_unlock(&mutex);
+  return 0;
+}
+#endif
+
+static void *main_thread_round_trip(void *arg)
+{
+  for (int i = 0; i < iterations; ++i)
+  {
+#ifdef __EMSCRIPTEN__
+    emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_I, increment);
+#else
+    pthread_mutex_lock(&mutex);
+    ++requests;
+    pthread_cond_signal(&request_cond);
+    while (requests != responses) pthread_cond_wait(&response_cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+#endif
+  }
+  return 0;
+}
+
+static void *proxied_syscall(void *arg)
+{
+  for (int i = 0; i < iterations; ++i)
+    shared_counter += fpathconf(1, _PC_NAME_MAX) & 1;
+  return 0;
+}
+
+static double results[THREADS];
+
+static void *parallel_for(void *arg)
+{
+  int self = (int)(long)arg;
+  // Each thread takes an equal share of the same total work, so the time should drop as threads are added.
+  int begin = (int)((long long)iterations * self / THREADS);
+  int end = (int)((long long)iterations * (self + 1) / THREADS);
+  double sum = 0;
+  for (int i = begin; i < end; ++i)
+    sum += sqrt((double)i) * sin((double)i);
+  results[self] = sum;
+  return 0;
+}
+
+static void *atomic_counter(void *arg)
+{
+  for (int i = 0; i < iterations; ++i)
+    __atomic_fetch_add(&shared_counter, 1, __ATOMIC_SEQ_CST);
+  return 0;
+}
+
+static void run_threads(void *(*func)(void *), int count)
+{
+  pthread_t threads[THREADS > 2 ? THREADS : 2];
+  for (int i = 0; i < count; ++i) pthread_create(&threads[i], 0, func, (void *)(long)i);
+  for (int i = 0; i < count; ++i) pthread_join(threads[i], 0);
+}
+
+int main(int argc, char **argv)
+{
+  int arg = argc > 1 ? argv[1][0] - '0' : 3;
+  int scale;
+  switch (arg)
+  {
+    case 0: return 0; break;
+    case 1: scale = 1; break;
+    case 2: scale = 5; break;
+    case 3: scale = 10; break;
+    case 4: scale = 50; break;
+    case 5: scale = 100; break;
+    default: printf("error: %d\n", arg); return -1;
+  }
+
+  // The base number of iterations of each kind takes roughly the same time natively.
+  static const int base[] = { 20000, 10000, 2000, 5000, 400000, 100000 };
+  iterations = base[BENCHMARK_PTHREADS] * scale;
+
+  tick_t start = tick();
+  switch (BENCHMARK_PTHREADS)
+  {
+    case 0: run_threads(mutex_contention, THREADS); break;
+    case 1: run_threads(futex_ping_pong, 2); break;
+    case 2:
+    {
+#ifdef __EMSCRIPTEN__
+      run_threads(main_thread_round_trip, 1);
+#else
+      pthread_t server_thread;
+      pthread_create(&server_thread, 0, server, 0);
+      run_threads(main_thread_round_trip, 1);
+      pthread_join(server_thread, 0);
+#endif
+      break;
+    }
+    case 3: run_threads(proxied_syscall, 1); break;
+    case 4:
+    {
+      run_threads(parallel_for, THREADS);
+      double sum = 0;
+      for (int i = 0; i < THREADS; ++i) sum += results[i];
+      shared_counter = (int)sum;
+      break;
+    }
+    case 5: run_threads(atomic_counter, THREADS); break;
+  }
+  tick_t end = tick();
+
+  printf("Result: %d\n", shared_counter);
+  printf("Total time: %f\n", (double)(end - start) / ticks_per_sec());
+  return 0;
+}
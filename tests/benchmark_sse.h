@@ -176,8 +176,30 @@ double ucastd(uint64_t t) { return *(double*)&t; }
 		_mm_store_pd(dst, o0); \
 	END(checksum_dst(dst), msg);
 
+#define BINARYOP_TEST_I(msg, instr, op0, op1) \
+	START(); \
+		__m128i o0 = op0; \
+		__m128i o1 = op1; \
+		for(int i = 0; i < N; i += 8) \
+			o0 = instr(o0, o1); \
+		_mm_store_si128((__m128i*)dst, o0); \
+	END(checksum_dst(dst), msg);
+
+// Scalar counterpart of BINARYOP_TEST_I: evaluates expr on each lane of one 128-bit register, as many times as the SIMD loop runs.
+#define SCALAR_I_TEST(msg, type, lanes, expr) \
+	START(); \
+		type *d = (type*)dst; \
+		const type *s = (const type*)src2; \
+		for(int j = 0; j < (lanes); ++j) \
+			d[j] = ((const type*)src)[j]; \
+		for(int i = 0; i < N; i += 8) \
+			for(int j = 0; j < (lanes); ++j) \
+				d[j] = (expr); \
+	ENDSCALAR(checksum_dst(dst), msg);
+
 #define Max(a,b) ((a) >= (b) ? (a) : (b))
 #define Min(a,b) ((a) <= (b) ? (a) : (b))
+#define Saturate(x, lo, hi) Min(Max((x), (lo)), (hi))
 
 static INLINE int Isnan(float __f)
 {
@@ -92,22 +92,34 @@ int main()
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] += src2[0]; dst[1] += src2[1]; dst[2] += src2[2]; dst[3] += src2[3]; } ENDSCALAR(checksum_dst(dst), "scalar add");
 	BINARYOP_TEST_D("_mm_add_pd", _mm_add_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_add_sd", _mm_add_sd, _mm_load_pd(src), _mm_load_pd(src2));
-	// _mm_adds_epi16
-	// _mm_adds_epi8
-	// _mm_adds_epu16
-	// _mm_adds_epu8
+	SCALAR_I_TEST("scalar adds_epi16", int16_t, 8, Saturate(d[j] + s[j], -32768, 32767));
+	BINARYOP_TEST_I("_mm_adds_epi16", _mm_adds_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar adds_epi8", int8_t, 16, Saturate(d[j] + s[j], -128, 127));
+	BINARYOP_TEST_I("_mm_adds_epi8", _mm_adds_epi8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar adds_epu16", uint16_t, 8, Saturate(d[j] + s[j], 0, 65535));
+	BINARYOP_TEST_I("_mm_adds_epu16", _mm_adds_epu16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar adds_epu8", uint8_t, 16, Saturate(d[j] + s[j], 0, 255));
+	BINARYOP_TEST_I("_mm_adds_epu8", _mm_adds_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar avg_epu16", uint16_t, 8, (d[j] + s[j] + 1) >> 1);
+	BINARYOP_TEST_I("_mm_avg_epu16", _mm_avg_epu16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar avg_epu8", uint8_t, 16, (d[j] + s[j] + 1) >> 1);
+	BINARYOP_TEST_I("_mm_avg_epu8", _mm_avg_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] /= src2[0]; dst[1] /= src2[1]; dst[2] /= src2[2]; dst[3] /= src2[3]; } ENDSCALAR(checksum_dst(dst), "scalar div");
 	BINARYOP_TEST_D("_mm_div_pd", _mm_div_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_div_sd", _mm_div_sd, _mm_load_pd(src), _mm_load_pd(src2));
-	// _mm_madd_epi16
+	SCALAR_I_TEST("scalar madd_epi16", int32_t, 4, (int16_t)d[j] * (int16_t)s[j] + (int16_t)(d[j] >> 16) * (int16_t)(s[j] >> 16));
+	BINARYOP_TEST_I("_mm_madd_epi16", _mm_madd_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	// _mm_mul_epu32
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] *= src2[0]; dst[1] *= src2[1]; dst[2] *= src2[2]; dst[3] *= src2[3]; } ENDSCALAR(checksum_dst(dst), "scalar mul");
 	BINARYOP_TEST_D("_mm_mul_pd", _mm_mul_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_mul_sd", _mm_mul_sd, _mm_load_pd(src), _mm_load_pd(src2));
-	// _mm_mulhi_epi16
-	// _mm_mulhi_epu16
+	SCALAR_I_TEST("scalar mulhi_epi16", int16_t, 8, (int16_t)((d[j] * s[j]) >> 16));
+	BINARYOP_TEST_I("_mm_mulhi_epi16", _mm_mulhi_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar mulhi_epu16", uint16_t, 8, (uint16_t)(((uint32_t)d[j] * s[j]) >> 16));
+	BINARYOP_TEST_I("_mm_mulhi_epu16", _mm_mulhi_epu16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	// _mm_mullo_epi16
-	// _mm_sad_epu8
+	START(); uint8_t *d = (uint8_t*)dst; const uint8_t *s = (const uint8_t*)src2; for(int i = 0; i < N; i += 8) { for(int h = 0; h < 16; h += 8) { unsigned int sum = 0; for(int j = h; j < h+8; ++j) sum += abs(d[j] - s[j]); for(int j = h; j < h+8; ++j) d[j] = 0; d[h] = sum; d[h+1] = sum >> 8; } } ENDSCALAR(checksum_dst(dst), "scalar sad_epu8");
+	BINARYOP_TEST_I("_mm_sad_epu8", _mm_sad_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	// _mm_sub_epi16
 	// _mm_sub_epi32
 	// _mm_sub_epi64
@@ -115,10 +127,14 @@ int main()
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] -= src2[0]; dst[1] -= src2[1]; dst[2] -= src2[2]; dst[3] -= src2[3]; } ENDSCALAR(checksum_dst(dst), "scalar sub");
 	BINARYOP_TEST_D("_mm_sub_pd", _mm_sub_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_sub_sd", _mm_sub_sd, _mm_load_pd(src), _mm_load_pd(src2));
-	// _mm_subs_epi16
-	// _mm_subs_epi8
-	// _mm_subs_epu16
-	// _mm_subs_epu8
+	SCALAR_I_TEST("scalar subs_epi16", int16_t, 8, Saturate(d[j] - s[j], -32768, 32767));
+	BINARYOP_TEST_I("_mm_subs_epi16", _mm_subs_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar subs_epi8", int8_t, 16, Saturate(d[j] - s[j], -128, 127));
+	BINARYOP_TEST_I("_mm_subs_epi8", _mm_subs_epi8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar subs_epu16", uint16_t, 8, Saturate(d[j] - s[j], 0, 65535));
+	BINARYOP_TEST_I("_mm_subs_epu16", _mm_subs_epu16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar subs_epu8", uint8_t, 16, Saturate(d[j] - s[j], 0, 255));
+	BINARYOP_TEST_I("_mm_subs_epu8", _mm_subs_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 
 	SETCHART("roots");
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] = sqrt(dst[0]); dst[1] = sqrt(dst[1]); dst[2] = sqrt(dst[2]); dst[3] = sqrt(dst[3]); } ENDSCALAR(checksum_dst(dst), "scalar sqrt");
@@ -184,17 +200,29 @@ int main()
 	BINARYOP_TEST_D("_mm_cmpunord_sd", _mm_cmpunord_sd, _mm_load_pd(src), _mm_load_pd(src2));
 
 	SETCHART("max");
-	// _mm_max_epi16
-	// _mm_max_epu8
+	SCALAR_I_TEST("scalar max_epi16", int16_t, 8, Max(d[j], s[j]));
+	BINARYOP_TEST_I("_mm_max_epi16", _mm_max_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar max_epu8", uint8_t, 16, Max(d[j], s[j]));
+	BINARYOP_TEST_I("_mm_max_epu8", _mm_max_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] = Max(dst[0], src2[0]); dst[1] = Max(dst[1], src2[1]); dst[2] = Max(dst[2], src2[2]); dst[3] = Max(dst[3], src2[3]); } ENDSCALAR(checksum_dst(dst), "scalar max");
 	BINARYOP_TEST_D("_mm_max_pd", _mm_max_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_max_sd", _mm_max_sd, _mm_load_pd(src), _mm_load_pd(src2));
-	// _mm_min_epi16
-	// _mm_min_epu8
+	SCALAR_I_TEST("scalar min_epi16", int16_t, 8, Min(d[j], s[j]));
+	BINARYOP_TEST_I("_mm_min_epi16", _mm_min_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	SCALAR_I_TEST("scalar min_epu8", uint8_t, 16, Min(d[j], s[j]));
+	BINARYOP_TEST_I("_mm_min_epu8", _mm_min_epu8, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
 	START(); dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; for(int i = 0; i < N; ++i) { dst[0] = Min(dst[0], src2[0]); dst[1] = Min(dst[1], src2[1]); dst[2] = Min(dst[2], src2[2]); dst[3] = Min(dst[3], src2[3]); } ENDSCALAR(checksum_dst(dst), "scalar min");
 	BINARYOP_TEST_D("_mm_min_pd", _mm_min_pd, _mm_load_pd(src), _mm_load_pd(src2));
 	BINARYOP_TEST_D("_mm_min_sd", _mm_min_sd, _mm_load_pd(src), _mm_load_pd(src2));
 
+	SETCHART("pack");
+	START(); int16_t *d = (int16_t*)dst; const int16_t *s = (const int16_t*)src2; for(int i = 0; i < N; i += 8) { int8_t t[16]; for(int j = 0; j < 8; ++j) { t[j] = Saturate(d[j], -128, 127); t[8+j] = Saturate(s[j], -128, 127); } for(int j = 0; j < 16; ++j) ((int8_t*)d)[j] = t[j]; } ENDSCALAR(checksum_dst(dst), "scalar packs_epi16");
+	BINARYOP_TEST_I("_mm_packs_epi16", _mm_packs_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	START(); int32_t *d = (int32_t*)dst; const int32_t *s = (const int32_t*)src2; for(int i = 0; i < N; i += 8) { int16_t t[8]; for(int j = 0; j < 4; ++j) { t[j] = Saturate(d[j], -32768, 32767); t[4+j] = Saturate(s[j], -32768, 32767); } for(int j = 0; j < 8; ++j) ((int16_t*)d)[j] = t[j]; } ENDSCALAR(checksum_dst(dst), "scalar packs_epi32");
+	BINARYOP_TEST_I("_mm_packs_epi32", _mm_packs_epi32, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+	START(); int16_t *d = (int16_t*)dst; const int16_t *s = (const int16_t*)src2; for(int i = 0; i < N; i += 8) { uint8_t t[16]; for(int j = 0; j < 8; ++j) { t[j] = Saturate(d[j], 0, 255); t[8+j] = Saturate(s[j], 0, 255); } for(int j = 0; j < 16; ++j) ((uint8_t*)d)[j] = t[j]; } ENDSCALAR(checksum_dst(dst), "scalar packus_epi16");
+	BINARYOP_TEST_I("_mm_packus_epi16", _mm_packus_epi16, _mm_load_si128((__m128i*)src), _mm_load_si128((__m128i*)src2));
+
 	SETCHART("shuffle");
 	// _mm_extract_epi16
 	// _mm_insert_epi16
@@ -0,0 +1,111 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+#include "tick.h"
+
+// Benchmarks strlen, memchr or memcmp (select with -DTEST_STRLEN, -DTEST_MEMCHR or -DTEST_MEMCMP) on strings of
+// random lengths, up to the size of each test case, starting at random offsets.
+
+#define NUM_STRINGS 1024
+char text[1024*1024*2+64] = {};
+char other[1024*1024*2+64] = {};
+int offsets[NUM_STRINGS];
+int otherOffsets[NUM_STRINGS];
+int lengths[NUM_STRINGS];
+
+size_t resultCheckSum = 0;
+
+void __attribute__((noinline)) test_string(int numTimes)
+{
+	for(int i = 0; i < numTimes; ++i)
+	{
+		int r = i & (NUM_STRINGS-1);
+#if defined(TEST_STRLEN)
+		resultCheckSum += strlen(text + offsets[r]);
+#elif defined(TEST_MEMCHR)
+		resultCheckSum += (char *)memchr(text + offsets[r], 0, lengths[r] + 1) - text;
+#elif defined(TEST_MEMCMP)
+		resultCheckSum += memcmp(text + offsets[r], other + otherOffsets[r], lengths[r] + 1) > 0;
+#else
+#error "select a function to benchmark"
+#endif
+	}
+}
+
+std::vector<int> stringSizes;
+std::vector<double> results;
+
+double totalTimeSecs = 0.0;
+
+void test_case(int stringSize)
+{
+	// The strings are runs of 'a' ended by a 0 in text, and by 0 or 1 in other, so that they compare equal until the
+	// last byte.
+	memset(text, 'a', sizeof(text));
+	memset(other, 'a', sizeof(other));
+	long long totalBytes = 0;
+	for(int i = 0; i < NUM_STRINGS; ++i)
+	{
+		offsets[i] = rand() % (int)(sizeof(text) - stringSize - 1);
+		otherOffsets[i] = (offsets[i] & ~15) + (rand() & 15); // sometimes aligned the same way, sometimes not
+		if (otherOffsets[i] + stringSize >= (int)sizeof(other)) otherOffsets[i] = offsets[i];
+		lengths[i] = rand() % stringSize;
+		totalBytes += lengths[i];
+	}
+	for(int i = 0; i < NUM_STRINGS; ++i)
+	{
+		text[offsets[i] + lengths[i]] = 0;
+		other[otherOffsets[i] + lengths[i]] = rand() & 1;
+	}
+
+	const long long minimumBytes = 1024*1024*64;
+	int numTimes = (int)((minimumBytes * NUM_STRINGS + totalBytes - 1) / (totalBytes + NUM_STRINGS));
+	if (numTimes < NUM_STRINGS) numTimes = NUM_STRINGS;
+
+	tick_t bestResult = 1e9;
+
+#ifndef NUM_TRIALS
+#define NUM_TRIALS 5
+#endif
+
+	for(int i = 0; i < NUM_TRIALS; ++i)
+	{
+		double t0 = tick();
+		test_string(numTimes);
+		double t1 = tick();
+		if (t1 - t0 < bestResult) bestResult = t1 - t0;
+		totalTimeSecs += (double)(t1 - t0) / ticks_per_sec();
+	}
+
+	stringSizes.push_back(stringSize);
+	double seconds = (double)bestResult / ticks_per_sec();
+	results.push_back(seconds > 0 ? (double)totalBytes * numTimes / NUM_STRINGS / seconds / (1024.0*1024.0) : 0.0);
+}
+
+#ifndef MAX_SIZE
+#define MAX_SIZE 1024*1024
+#endif
+
+#ifndef MIN_SIZE
+#define MIN_SIZE 4
+#endif
+
+int main()
+{
+	for(int stringSize = MIN_SIZE; stringSize <= MAX_SIZE; stringSize <<= 1)
+		test_case(stringSize);
+
+	std::cout << "Test cases: " << std::endl;
+	for(size_t i = 0; i < stringSizes.size(); ++i)
+		std::cout << stringSizes[i] << (i != stringSizes.size()-1 ? "," : "\n");
+	std::cout << "Test results (MB/s): " << std::endl;
+	for(size_t i = 0; i < results.size(); ++i)
+		std::cout << results[i] << (i != results.size()-1 ? "," : "\n");
+
+	std::cout << "Result checksum: " << resultCheckSum << std::endl;
+	std::cout << "Total time: " << totalTimeSecs << std::endl;
+}
@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <emscripten/arena.h>
+int main() {
+  em_arena *a = emscripten_arena_create(1000);
+  char *p = emscripten_arena_alloc(a, 10); assert(p && ((uintptr_t)p & 7) == 0);
+  char *q = emscripten_arena_alloc_aligned(a, 100, 64); assert(q && ((uintptr_t)q & 63) == 0 && q >= p + 10);
+  assert(!emscripten_arena_alloc(a, 2000));
+  emscripten_arena_reset(a); assert(emscripten_arena_bytes_used(a) == 0);
+  assert(emscripten_arena_alloc(a, 10) == p);
+  emscripten_arena_destroy(a);
+  em_region *r = emscripten_region_create(256*1024); assert(r);
+  void *ptrs[10000]; int n = 0;
+  while (n < 10000 && (ptrs[n] = emscripten_region_malloc(r, 100))) { memset(ptrs[n], 1, 100); ++n; }
+  assert(n > 1000 && n < 10000);
+  for (int i = 0; i < n; i += 2) emscripten_region_free(r, ptrs[i]);
+  assert(emscripten_region_malloc(r, 100));
+  void *al = emscripten_region_memalign(r, 256, 10); assert(!al || ((uintptr_t)al & 255) == 0);
+  emscripten_region_destroy(r);
+  puts("ok");
+}
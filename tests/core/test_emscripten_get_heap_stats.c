@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <emscripten.h>
+int main() {
+  static void *ptrs[1000];
+  emscripten_heap_stats before, after;
+  for (int i = 0; i < 1000; i++) ptrs[i] = malloc(100);
+  emscripten_get_heap_stats(&before);
+  assert(before.heap_size == EM_ASM_INT({ return TOTAL_MEMORY }));
+  assert(before.dynamic_top <= before.heap_size);
+  assert(before.stack_used > 0 && before.stack_used < before.stack_size);
+  assert(before.in_use_bytes >= 1000 * 100 && before.in_use_blocks >= 1000);
+  assert(before.in_use_bytes + before.free_bytes <= before.malloc_footprint);
+  // Freeing every other block leaves holes that cannot be merged.
+  for (int i = 0; i < 1000; i += 2) free(ptrs[i]);
+  emscripten_get_heap_stats(&after);
+  printf("in use: %d\n", before.in_use_blocks - after.in_use_blocks);
+  printf("free: %d\n", after.free_blocks - before.free_blocks);
+  printf("holes: %d\n", after.free_blocks_by_size[6] - before.free_blocks_by_size[6]);
+  printf("fragmented: %d\n", before.fragmentation < 0.5f && after.fragmentation > 0.5f);
+  return 0;
+}
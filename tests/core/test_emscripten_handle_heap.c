@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <emscripten/handle_heap.h>
+int main() {
+  em_handle_heap *heap = emscripten_handle_heap_create(64 * 1024);
+  em_handle handles[100];
+  for (int i = 0; i < 100; i++) {
+    handles[i] = emscripten_handle_alloc(heap, 500);
+    assert(handles[i]);
+    memset(emscripten_handle_get(heap, handles[i]), i, 500);
+  }
+  printf("full: %d\n", emscripten_handle_alloc(heap, 16 * 1024) == 0);
+  // Freeing every other block leaves holes, and a locked block in the middle stays put.
+  for (int i = 0; i < 100; i += 2) emscripten_handle_free(heap, handles[i]);
+  printf("fragmented: %d\n", (int)emscripten_handle_heap_fragmented_bytes(heap));
+  char *locked = emscripten_handle_lock(heap, handles[51]);
+  int steps = 0;
+  while (emscripten_handle_heap_compact(heap, 2048)) steps++;
+  printf("steps: %d\n", steps > 1);
+  printf("locked: %d\n", emscripten_handle_get(heap, handles[51]) == locked);
+  printf("left below the locked block: %d\n", (int)emscripten_handle_heap_fragmented_bytes(heap));
+  emscripten_handle_unlock(heap, handles[51]);
+  while (emscripten_handle_heap_compact(heap, 2048)) {}
+  printf("fragmented: %d\n", (int)emscripten_handle_heap_fragmented_bytes(heap));
+  for (int i = 1; i < 100; i += 2) {
+    char *data = emscripten_handle_get(heap, handles[i]);
+    for (int j = 0; j < 500; j++) assert(data[j] == i);
+  }
+  // Allocating compacts on its own when the holes are needed.
+  for (int i = 1; i < 100; i += 4) emscripten_handle_free(heap, handles[i]);
+  em_handle big = emscripten_handle_alloc(heap, 48 * 1024);
+  printf("big: %d, fragmented: %d\n", big != 0, (int)emscripten_handle_heap_fragmented_bytes(heap));
+  emscripten_handle_heap_destroy(heap);
+  return 0;
+}
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <emscripten.h>
+int main() {
+  static void *ptrs[1000];
+  for (size_t align = 16; align <= 64; align *= 2) {
+    assert(emscripten_malloc_aligned_batch(1000, 52, align, ptrs) == 0);
+    for (int i = 0; i < 1000; i++) { assert(((uintptr_t)ptrs[i] & (align - 1)) == 0); memset(ptrs[i], i, 52); }
+    for (int i = 0; i < 1000; i++) assert(((unsigned char*)ptrs[i])[51] == (unsigned char)i);
+    // Packed back to back: nothing more than the bookkeeping of each block, rounded up to the alignment.
+    printf("%d: %d\n", (int)align, (int)((char*)ptrs[1] - (char*)ptrs[0]));
+    for (int i = 0; i < 1000; i += 2) free(ptrs[i]);
+    for (int i = 1; i < 1000; i += 2) free(ptrs[i]);
+  }
+  assert(emscripten_malloc_aligned_batch(10, 10, 24, ptrs) == EINVAL);
+  assert(emscripten_malloc_aligned_batch(0x10000000, 100, 16, ptrs) == ENOMEM);
+  puts("ok");
+}
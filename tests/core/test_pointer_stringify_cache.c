@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emscripten.h>
+
+char name[32] = "before";
+
+int main() {
+  const char *constant = "a constant, long enough for TextDecoder";
+  char *heap = strdup("on the heap");
+  for (int i = 0; i < 2; i++) {
+    // strings in static memory are decoded once, so the change to name is not seen, unless the length is given
+    EM_ASM({
+      Module.print(Pointer_stringify($0) + ' / ' + Pointer_stringify($1) + ' / ' + Pointer_stringify($1, 5) + ' / ' + Pointer_stringify($2));
+    }, constant, name, heap);
+    strcpy(name, "after");
+    heap[0] = 'O';
+  }
+  free(heap);
+  return 0;
+}
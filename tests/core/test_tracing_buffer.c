@@ -0,0 +1,17 @@
+#include <emscripten/trace.h>
+
+int main(int argc, const char* argv[]) {
+
+  emscripten_trace_configure_for_test();
+
+  // Buffered, and posted in a batch before the frame start.
+  emscripten_trace_record_allocation((void*)16, 32);
+  emscripten_trace_record_reallocation((void*)16, (void*)48, 64);
+  emscripten_trace_associate_storage_size((void*)48, 8);
+  emscripten_trace_record_free((void*)48);
+
+  emscripten_trace_record_frame_start();
+  emscripten_trace_record_frame_end();
+
+  return 0;
+}
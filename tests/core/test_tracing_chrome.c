@@ -0,0 +1,31 @@
+#include <emscripten.h>
+#include <emscripten/trace.h>
+
+int main(int argc, const char* argv[]) {
+
+  emscripten_trace_configure_for_chrome_tracing();
+
+  emscripten_trace_record_frame_start();
+  emscripten_trace_enter_context("Application Startup");
+  emscripten_trace_log_message("Application", "starting up");
+  emscripten_trace_record_allocation((void*)16, 32);
+  emscripten_trace_record_reallocation((void*)16, (void*)48, 64);
+  emscripten_trace_task_start(7, "Load");
+  emscripten_trace_task_suspend("waiting");
+  emscripten_trace_record_free((void*)48);
+  emscripten_trace_task_resume(7, "loaded");
+  emscripten_trace_task_end();
+  emscripten_trace_exit_context();
+  emscripten_trace_record_frame_end();
+
+  // The timestamps vary, so print the rest.
+  EM_ASM({
+    var trace = JSON.parse(Module['getChromeTrace']());
+    trace['traceEvents'].forEach(function(e) {
+      Module.print([e['ph'], e['tid'], e['name'] || '', e['id'] || '', JSON.stringify(e['args'] || {}), typeof e['ts']].join(' '));
+    });
+  });
+
+  emscripten_trace_close();
+  return 0;
+}
@@ -598,6 +598,25 @@ module({
             assert.equal(0, cm.count_emval_handles());
         });
 
+        test("val_keys get, set and call", function() {
+            var o = {x: 1, add: function(n) { return this.x + this.y + n; }};
+            assert.equal(7, cm.emval_test_keys(o));
+            assert.equal(2, o.y);
+            assert.equal(0, cm.count_emval_handles());
+        });
+
+        test("val_scope releases temporaries when it ends", function() {
+            var array = [];
+            for (var i = 0; i < 1000; ++i) {
+                array.push(i);
+            }
+            var unscoped = cm.emval_test_count_temporaries(array, false);
+            assert.equal(0, cm.count_emval_handles());
+            var scoped = cm.emval_test_count_temporaries(array, true);
+            assert.equal(0, cm.count_emval_handles());
+            assert.true(scoped > unscoped);
+        });
+
         test("strings", function() {
             assert.equal("foobar", "foo" + "bar");
             assert.equal("foobar", cm.emval_test_take_and_return_std_string("foobar"));
@@ -609,6 +628,24 @@ module({
             assert.equal("foo\0bar", cm.emval_test_take_and_return_std_string("foo\0bar"));
         });
 
+        test("long strings pass through strings", function() {
+            var s = "";
+            for (var i = 0; i < 5000; ++i) {
+                s += String.fromCharCode(i % 256);
+            }
+            assert.equal(s, cm.emval_test_take_and_return_std_string(s));
+            assert.equal(s, cm.emval_test_take_and_return_std_string_const_ref(s));
+        });
+
+        test("strings pass to std::string_view", function() {
+            assert.equal(3, cm.emval_test_take_std_string_view("aaab"));
+            assert.equal(1, cm.emval_test_take_std_string_view(new Uint8Array([97, 98])));
+        });
+
+        test("std::string_view returns as a string", function() {
+            assert.equal("view\0 o", cm.emval_test_return_std_string_view());
+        });
+
         test("no memory leak when passing strings in by const reference", function() {
             cm.emval_test_take_and_return_std_string_const_ref("foobar");
         });
@@ -822,6 +859,19 @@ module({
             assert.throws(cm.BindingError, function() { cm.overloaded_function(30, 30, 30); });
         });
 
+        test("functions and methods can be called through references taken before their first call", function() {
+            var sum = cm.emval_test_sum;
+            assert.equal(6, sum([1, 2, 3]));
+            assert.equal(10, sum([1, 2, 3, 4]));
+
+            var getVal = cm.ValHolder.prototype.getVal;
+            var v = new cm.ValHolder(42);
+            assert.equal(42, getVal.call(v));
+            assert.equal(42, v.getVal());
+            assert.equal(42, getVal.call(v));
+            v.delete();
+        });
+
         test("overloading of class member functions", function() {
             var foo = new cm.MultipleOverloads();
             assert.equal(foo.Func(10), 1);
@@ -1014,6 +1064,66 @@ module({
             assert.equal(20, vec.get(1));
             vec.delete();
         });
+
+        test("vectors of numbers have a typed array view of their storage", function() {
+            var vec = new cm.FloatVector();
+            vec.push_back(1.5);
+            vec.push_back(2.5);
+
+            var view = vec.view();
+            assert.true(view instanceof Float32Array);
+            assert.equal(2, view.length);
+            assert.equal(2.5, view[1]);
+            view[0] = 4;
+            assert.equal(4, vec.get(0));
+            vec.delete();
+        });
+
+        test("vectors of numbers can be assigned from an array in bulk", function() {
+            var vec = cm.emval_test_return_vector();
+
+            vec.assignFrom(new Int32Array([1, 2, 3, 4]));
+            assert.equal(4, vec.size());
+            assert.equal(4, vec.get(3));
+            vec.assignFrom([5]);
+            assert.equal(1, vec.size());
+            assert.equal(5, vec.view()[0]);
+            vec.delete();
+        });
+
+        test("vectors of other types have no view", function() {
+            assert.equal(undefined, cm.StringVector.prototype.view);
+            assert.equal(undefined, cm.StringVector.prototype.assignFrom);
+        });
+    });
+
+    BaseFixture.extend("batch functions", function() {
+        test("calls the method on each object", function() {
+            var a = new cm.BatchCounter();
+            var b = new cm.BatchCounter();
+
+            var results = cm.BatchCounter.addAll([a, b, a], new Float32Array([1, 2, 3, 4, 5, 0.5]));
+            assert.true(results instanceof Float64Array);
+            assert.deepEqual([2, 12, 4.5], Array.prototype.slice.call(results));
+            assert.equal(4.5, a.total);
+
+            assert.equal(undefined, cm.BatchCounter.resetAll([a, b]));
+            assert.equal(0, a.total);
+            assert.equal(0, b.total);
+            a.delete();
+            b.delete();
+        });
+
+        test("checks the arguments and objects", function() {
+            var a = new cm.BatchCounter();
+            assert.throws(cm.BindingError, function() {
+                cm.BatchCounter.addAll([a], [1]);
+            });
+            assert.throws(cm.BindingError, function() {
+                cm.BatchCounter.addAll([a, {}], [1, 2, 3, 4]);
+            });
+            a.delete();
+        });
     });
 
     BaseFixture.extend("map", function() {
@@ -1303,6 +1413,24 @@ module({
             }, d);
         });
 
+        test("can pass and return arithmetic fields of trivially copyable structs", function() {
+            var v = cm.emval_test_take_and_return_PackedValues({
+                i8: -128, u8: 255, i16: -32768, u16: 65535,
+                i32: -2, u32: 4294967295, f32: 0.5, f64: 1.25, b: false});
+            assert.deepEqual({
+                i8: -128, u8: 255, i16: -32768, u16: 65535,
+                i32: -1, u32: 4294967295, f32: 0.5, f64: 2.5, b: true}, v);
+
+            assert.throws(TypeError, function() {
+                cm.emval_test_take_and_return_PackedValues({
+                    i8: 128, u8: 0, i16: 0, u16: 0, i32: 0, u32: 0, f32: 0, f64: 0, b: false});
+            });
+        });
+
+        test("can pass and return arithmetic elements of trivially copyable tuples", function() {
+            assert.deepEqual([3.5, 8], cm.emval_test_take_and_return_PackedPair([2.5, 7]));
+        });
+
         test("can clone handles", function() {
             var a = new cm.ValHolder({});
             assert.equal(1, cm.count_emval_handles());
@@ -120,6 +120,29 @@ unsigned emval_test_sum(val v) {
     return rv;
 }
 
+// Returns how many vals are alive after reading the elements of array,
+// which is more if the temporaries were deferred by a val_scope.
+unsigned emval_test_count_temporaries(val array, bool scoped) {
+    val count_emval_handles = val::module_property("count_emval_handles");
+    unsigned length = array["length"].as<unsigned>();
+    if (!scoped) {
+        for (unsigned i = 0; i < length; ++i) {
+            array[i].as<double>();
+        }
+        return count_emval_handles().as<unsigned>();
+    }
+    val_scope scope;
+    for (unsigned i = 0; i < length; ++i) {
+        array[i].as<double>();
+    }
+    return count_emval_handles().as<unsigned>();
+}
+
+int emval_test_keys(val o) {
+    o.set(EMSCRIPTEN_KEY("y"), 2);
+    return o[EMSCRIPTEN_KEY("x")].as<int>() + o.call<int>(EMSCRIPTEN_KEY("add"), 3);
+}
+
 std::string get_non_ascii_string() {
     char c[128 + 1];
     c[128] = 0;
@@ -155,6 +178,15 @@ std::string emval_test_take_and_return_std_string(std::string str) {
     return str;
 }
 
+size_t emval_test_take_std_string_view(std::string_view str) {
+    return str.find('b');
+}
+
+std::string_view emval_test_return_std_string_view() {
+    static const std::string str("view\0 of a string", 18);
+    return std::string_view(str).substr(0, 7);
+}
+
 std::string emval_test_take_and_return_std_string_const_ref(const std::string& str) {
     return str;
 }
@@ -902,6 +934,34 @@ ArrayInStruct emval_test_take_and_return_ArrayInStruct(ArrayInStruct cs) {
     return cs;
 }
 
+struct PackedValues {
+    signed char i8;
+    unsigned char u8;
+    short i16;
+    unsigned short u16;
+    int i32;
+    unsigned u32;
+    float f32;
+    double f64;
+    bool b;
+};
+
+struct PackedPair {
+    double first;
+    int second;
+};
+
+PackedValues emval_test_take_and_return_PackedValues(PackedValues v) {
+    v.i32 += 1;
+    v.f64 *= 2;
+    v.b = !v.b;
+    return v;
+}
+
+PackedPair emval_test_take_and_return_PackedPair(PackedPair p) {
+    return PackedPair{p.first + 1, p.second + 1};
+}
+
 enum Enum { ONE, TWO };
 
 Enum emval_test_take_and_return_Enum(Enum e) {
@@ -1696,6 +1756,8 @@ EMSCRIPTEN_BINDINGS(tests) {
     function("emval_test_add", &emval_test_add);
     function("const_ref_adder", &const_ref_adder);
     function("emval_test_sum", &emval_test_sum);
+    function("emval_test_count_temporaries", &emval_test_count_temporaries);
+    function("emval_test_keys", &emval_test_keys);
 
     function("get_non_ascii_string", &get_non_ascii_string);
     function("get_non_ascii_wstring", &get_non_ascii_wstring);
@@ -1704,6 +1766,8 @@ EMSCRIPTEN_BINDINGS(tests) {
 
     //function("emval_test_take_and_return_const_char_star", &emval_test_take_and_return_const_char_star);
     function("emval_test_take_and_return_std_string", &emval_test_take_and_return_std_string);
+    function("emval_test_take_std_string_view", &emval_test_take_std_string_view);
+    function("emval_test_return_std_string_view", &emval_test_return_std_string_view);
     function("emval_test_take_and_return_std_string_const_ref", &emval_test_take_and_return_std_string_const_ref);
     function("emval_test_take_and_return_std_basic_string_unsigned_char", &emval_test_take_and_return_std_basic_string_unsigned_char);
     function("take_and_return_std_wstring", &take_and_return_std_wstring);
@@ -1762,6 +1826,25 @@ EMSCRIPTEN_BINDINGS(tests) {
         ;
     function("emval_test_take_and_return_ArrayInStruct", &emval_test_take_and_return_ArrayInStruct);
 
+    value_object<PackedValues>("PackedValues")
+        .field("i8", &PackedValues::i8)
+        .field("u8", &PackedValues::u8)
+        .field("i16", &PackedValues::i16)
+        .field("u16", &PackedValues::u16)
+        .field("i32", &PackedValues::i32)
+        .field("u32", &PackedValues::u32)
+        .field("f32", &PackedValues::f32)
+        .field("f64", &PackedValues::f64)
+        .field("b", &PackedValues::b)
+        ;
+    function("emval_test_take_and_return_PackedValues", &emval_test_take_and_return_PackedValues);
+
+    value_array<PackedPair>("PackedPair")
+        .element(&PackedPair::first)
+        .element(&PackedPair::second)
+        ;
+    function("emval_test_take_and_return_PackedPair", &emval_test_take_and_return_PackedPair);
+
     class_<ValHolder>("ValHolder")
         .smart_ptr<std::shared_ptr<ValHolder>>("std::shared_ptr<ValHolder>")
         .constructor<val>()
@@ -2891,3 +2974,30 @@ EMSCRIPTEN_BINDINGS(static_member) {
         .class_property("v", &HasStaticMember::v)
         ;
 }
+
+class BatchCounter {
+public:
+    BatchCounter()
+        : total(0)
+    {}
+
+    double add(int a, float b) {
+        total += a * b;
+        return total;
+    }
+
+    void reset() {
+        total = 0;
+    }
+
+    double total;
+};
+
+EMSCRIPTEN_BINDINGS(batch_functions) {
+    class_<BatchCounter>("BatchCounter")
+        .constructor<>()
+        .function_batch("addAll", &BatchCounter::add)
+        .function_batch("resetAll", &BatchCounter::reset)
+        .property("total", &BatchCounter::total)
+        ;
+}
@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten.h>
+
+int numFrames = 0;
+int numIdleCalls = 0;
+int workLeft = 1000000;
+
+int idle(double timeRemaining, void *arg) {
+  assert(arg == &workLeft);
+  assert(timeRemaining >= 0);
+  ++numIdleCalls;
+  // Do work in small steps until the idle period is used up
+  double end = emscripten_get_now() + timeRemaining;
+  while (workLeft > 0 && emscripten_get_now() < end) {
+    workLeft -= 1000;
+  }
+  if (workLeft <= 0) printf("Idle work done after %d calls, in frame %d\n", numIdleCalls, numFrames);
+  return workLeft > 0;
+}
+
+void looper() {
+  ++numFrames;
+  if (workLeft <= 0 || numFrames == 600) {
+    printf("Frames: %d, idle calls: %d\n", numFrames, numIdleCalls);
+#ifdef REPORT_RESULT
+    int result = (workLeft <= 0 && numIdleCalls > 0); // All work finished from idle time, while frames kept running
+    REPORT_RESULT(result);
+#endif
+    emscripten_cancel_main_loop();
+  }
+}
+
+int main() {
+  emscripten_set_main_loop(looper, 0, 0);
+  emscripten_set_idle_callback(idle, &workLeft);
+}
@@ -0,0 +1,121 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+// Room for two copies of gears.png, but not for three.
+#define BUDGET (2 * 6407 + 100)
+
+void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+void fetchFile(const char *destinationPath, unsigned int attributes, void (*onsuccess)(emscripten_fetch_t *), void (*onerror)(emscripten_fetch_t *))
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = attributes;
+  attr.destinationPath = destinationPath;
+  attr.onsuccess = onsuccess;
+  attr.onerror = onerror;
+  emscripten_fetch(&attr, (attributes & EMSCRIPTEN_FETCH_NO_DOWNLOAD) ? destinationPath : "gears.png");
+}
+
+void budgetLifted(void *userData, const emscripten_fetch_cache_usage_t *usage)
+{
+  assert(usage);
+  assert(usage->budget == 0);
+  printf("Cache usage after the test: %llu bytes in %u files\n", usage->numBytes, usage->numFiles);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
+
+void cLoaded(emscripten_fetch_t *fetch)
+{
+  assert(fetch->numBytes == 6407);
+  emscripten_fetch_close(fetch);
+  emscripten_fetch_set_cache_budget(0, budgetLifted, 0);
+}
+
+void aLoadedAgain(emscripten_fetch_t *fetch)
+{
+  assert(fetch->numBytes == 6407);
+  emscripten_fetch_close(fetch);
+  fetchFile("cache_budget_c.png", EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY, cLoaded, failed);
+}
+
+void bNotFound(emscripten_fetch_t *fetch)
+{
+  // b.png was the least recently used file when c.png was stored.
+  assert(fetch->status == 404);
+  emscripten_fetch_close(fetch);
+  fetchFile("cache_budget_a.png", EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY, aLoadedAgain, failed);
+}
+
+void bLoaded(emscripten_fetch_t *fetch)
+{
+  printf("cache_budget_b.png should have been evicted\n");
+  assert(false);
+}
+
+void usageAfterC(void *userData, const emscripten_fetch_cache_usage_t *usage)
+{
+  assert(usage);
+  printf("Cache usage: %llu bytes in %u files\n", usage->numBytes, usage->numFiles);
+  assert(usage->budget == BUDGET);
+  assert(usage->numBytes <= BUDGET);
+  assert(usage->numFiles == 2);
+  fetchFile("cache_budget_b.png", EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY, bLoaded, bNotFound);
+}
+
+void cStored(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_close(fetch);
+  emscripten_fetch_get_cache_usage(usageAfterC, 0);
+}
+
+void aLoaded(emscripten_fetch_t *fetch)
+{
+  // Loading a.png makes b.png the least recently used file.
+  emscripten_fetch_close(fetch);
+  fetchFile("cache_budget_c.png", EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_REPLACE, cStored, failed);
+}
+
+void bStored(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_close(fetch);
+  fetchFile("cache_budget_a.png", EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY, aLoaded, failed);
+}
+
+void aStored(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_close(fetch);
+  fetchFile("cache_budget_b.png", EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_REPLACE, bStored, failed);
+}
+
+void budgetSet(void *userData, const emscripten_fetch_cache_usage_t *usage)
+{
+  assert(userData == (void*)0x1234);
+  assert(usage);
+  assert(usage->budget == BUDGET);
+  assert(usage->numBytes == 0);
+  assert(usage->numFiles == 0);
+  fetchFile("cache_budget_a.png", EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_REPLACE, aStored, failed);
+}
+
+void cacheCleared(void *userData, const emscripten_fetch_cache_usage_t *usage)
+{
+  // A budget of one byte evicts every file that earlier runs of the page have stored.
+  assert(usage);
+  assert(usage->numBytes == 0);
+  emscripten_fetch_set_cache_budget(BUDGET, budgetSet, (void*)0x1234);
+}
+
+int main()
+{
+  emscripten_fetch_set_cache_budget(1, cacheCleared, 0);
+}
@@ -0,0 +1,61 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+// The order in which the fetches finish, by their userData.
+char order[8];
+int numFinished = 0;
+
+void finished(emscripten_fetch_t *fetch)
+{
+  assert(fetch->numBytes == 6407);
+  assert(fetch->data != 0);
+  // Compute rudimentary checksum of data
+  uint8_t checksum = 0;
+  for(int i = 0; i < fetch->numBytes; ++i)
+    checksum ^= fetch->data[i];
+  assert(checksum == 0x08);
+  order[numFinished++] = *(const char*)fetch->userData;
+  emscripten_fetch_close(fetch);
+
+  if (numFinished == 4)
+  {
+    printf("Fetches finished in order %s\n", order);
+    // D shared the XHR of A, and C was sent before B because of its higher priority.
+    assert(!strcmp(order, "ADCB"));
+#ifdef REPORT_RESULT
+    REPORT_RESULT(1);
+#endif
+  }
+}
+
+void failed(emscripten_fetch_t *fetch)
+{
+  assert(false && "onerror handler called, but the transfer should have succeeded!");
+}
+
+emscripten_fetch_t *start(const char *name, const char *url, int priority)
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.userData = (void*)name;
+  attr.priority = priority;
+  attr.maxConcurrentRequests = 1;
+  attr.onsuccess = finished;
+  attr.onerror = failed;
+  return emscripten_fetch(&attr, url);
+}
+
+int main()
+{
+  emscripten_fetch_t *a = start("A", "gears.png", 0);
+  emscripten_fetch_t *b = start("B", "gears2.png", 0);
+  emscripten_fetch_t *c = start("C", "gears3.png", 1);
+  emscripten_fetch_t *d = start("D", "gears.png", 0);
+  assert(a && b && c && d);
+  // The fetches that share an XHR still get their own data buffers.
+  assert(a != d);
+}
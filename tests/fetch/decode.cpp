@@ -0,0 +1,102 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+// data.lz4 and data.gz both hold "0123456789" repeated 100 times.
+
+void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+void checkData(emscripten_fetch_t *fetch)
+{
+  assert(fetch->numBytes == 1000);
+  for(int i = 0; i < 1000; ++i) assert(fetch->data[i] == '0' + i % 10);
+}
+
+void finish()
+{
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
+
+void gzipDecoded(emscripten_fetch_t *fetch)
+{
+  checkData(fetch);
+  emscripten_fetch_close(fetch);
+  finish();
+}
+
+void gzipFailed(emscripten_fetch_t *fetch)
+{
+  // Browsers without DecompressionStream can not decode gzip.
+  printf("Fetch of %s failed with status %d: %s\n", fetch->url, fetch->status, fetch->statusText);
+  assert(fetch->status == 415);
+  emscripten_fetch_close(fetch);
+  finish();
+}
+
+void loadedFromIndexedDB(emscripten_fetch_t *fetch)
+{
+  // The file was stored as it was downloaded, and is decoded again.
+  checkData(fetch);
+  emscripten_fetch_close(fetch);
+
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_DECODE_GZIP;
+  attr.onsuccess = gzipDecoded;
+  attr.onerror = gzipFailed;
+  emscripten_fetch(&attr, "data.gz");
+}
+
+void downloaded(emscripten_fetch_t *fetch)
+{
+  checkData(fetch);
+  emscripten_fetch_close(fetch);
+
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_DECODE_LZ4;
+  attr.onsuccess = loadedFromIndexedDB;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "data.lz4");
+}
+
+void notDecoded(emscripten_fetch_t *fetch)
+{
+  // A file that is not an LZ4 frame fails to decode.
+  assert(fetch->status == 415);
+  emscripten_fetch_close(fetch);
+
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_DECODE_LZ4;
+  attr.onsuccess = downloaded;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "data.lz4");
+}
+
+void unexpectedlyDecoded(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s should have failed to decode\n", fetch->url);
+  assert(false);
+}
+
+int main()
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_DECODE_LZ4;
+  attr.onsuccess = unexpectedlyDecoded;
+  attr.onerror = notDecoded;
+  emscripten_fetch(&attr, "data.gz");
+}
@@ -0,0 +1,84 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+#define NUM_FILES 16
+
+char names[NUM_FILES][16];
+const char *paths[NUM_FILES + 1];
+char contents[NUM_FILES][32];
+int numStored = 0;
+int numLoaded = 0;
+
+void loaded(emscripten_fetch_t *fetch)
+{
+  int i = (int)(long)fetch->userData;
+  assert(fetch->numBytes == strlen(contents[i]));
+  assert(!memcmp(fetch->data, contents[i], fetch->numBytes));
+  emscripten_fetch_close(fetch);
+  if (++numLoaded == NUM_FILES)
+  {
+    printf("Loaded all files\n");
+#ifdef REPORT_RESULT
+    REPORT_RESULT(0);
+#endif
+  }
+}
+
+void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+void preloaded(void *userData, int numPreloaded)
+{
+  assert(userData == (void*)0x1234);
+  // The last path does not exist.
+  printf("Preloaded %d files\n", numPreloaded);
+  assert(numPreloaded == NUM_FILES);
+  for(int i = 0; i < NUM_FILES; ++i)
+  {
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    strcpy(attr.requestMethod, "GET");
+    attr.attributes = EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+    attr.userData = (void*)(long)i;
+    attr.onsuccess = loaded;
+    attr.onerror = failed;
+    emscripten_fetch(&attr, names[i]);
+  }
+}
+
+void stored(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_close(fetch);
+  if (++numStored == NUM_FILES)
+  {
+    paths[NUM_FILES] = "does_not_exist.dat";
+    emscripten_fetch_preload_cached_data(paths, NUM_FILES + 1, preloaded, (void*)0x1234);
+  }
+}
+
+int main()
+{
+  // Store all files to IndexedDB in one transaction.
+  emscripten_fetch_batch_begin();
+  for(int i = 0; i < NUM_FILES; ++i)
+  {
+    sprintf(names[i], "file%d.dat", i);
+    sprintf(contents[i], "contents of file %d", i);
+    paths[i] = names[i];
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    strcpy(attr.requestMethod, "EM_IDB_STORE");
+    attr.attributes = EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_PERSIST_FILE;
+    attr.requestData = contents[i];
+    attr.requestDataSize = strlen(contents[i]);
+    attr.onsuccess = stored;
+    attr.onerror = failed;
+    emscripten_fetch(&attr, names[i]);
+  }
+  emscripten_fetch_batch_end();
+}
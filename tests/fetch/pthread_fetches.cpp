@@ -0,0 +1,104 @@
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include <pthread.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/fetch.h>
+#include <emscripten/threading.h>
+
+#define NUM_THREADS 4
+
+static uint32_t numFinished = 0;
+
+struct ThreadState
+{
+  pthread_t thread;
+  bool waitableHandlerRan;
+};
+
+static uint8_t checksum(emscripten_fetch_t *fetch)
+{
+  uint8_t checksum = 0;
+  for(int i = 0; i < fetch->numBytes; ++i)
+    checksum ^= fetch->data[i];
+  return checksum;
+}
+
+static void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+static void asyncFinished(emscripten_fetch_t *fetch)
+{
+  // Fetches started on a pthread run on it, and so do their handlers.
+  ThreadState *state = (ThreadState*)fetch->userData;
+  assert(pthread_equal(pthread_self(), state->thread));
+  assert(checksum(fetch) == 0x08);
+  emscripten_fetch_close(fetch);
+  if (emscripten_atomic_add_u32(&numFinished, 1) == NUM_THREADS - 1)
+  {
+    printf("All fetches finished\n");
+#ifdef REPORT_RESULT
+    REPORT_RESULT(0);
+#endif
+  }
+}
+
+static void waitableFinished(emscripten_fetch_t *fetch)
+{
+  // The fetch worker runs waitable fetches, but their handlers run on the thread that waits for them.
+  ThreadState *state = (ThreadState*)fetch->userData;
+  assert(pthread_equal(pthread_self(), state->thread));
+  assert(checksum(fetch) == 0x08);
+  state->waitableHandlerRan = true;
+}
+
+static void *thread_main(void *arg)
+{
+  ThreadState *state = (ThreadState*)arg;
+  state->thread = pthread_self();
+  state->waitableHandlerRan = false;
+
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.userData = state;
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_WAITABLE;
+  attr.onsuccess = waitableFinished;
+  attr.onerror = failed;
+  emscripten_fetch_t *fetch = emscripten_fetch(&attr, "gears.png");
+  EMSCRIPTEN_RESULT ret = emscripten_fetch_wait(fetch, INFINITY);
+  assert(ret == EMSCRIPTEN_RESULT_SUCCESS);
+  assert(state->waitableHandlerRan);
+  emscripten_fetch_close(fetch);
+
+  // Looks up IndexedDB on this thread first, then downloads the file and stores it there.
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.userData = state;
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_PERSIST_FILE;
+  attr.onsuccess = asyncFinished;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "gears.png");
+
+  // Keep the thread alive, so that its event loop delivers the results.
+  emscripten_exit_with_live_runtime();
+  return 0;
+}
+
+static ThreadState threadStates[NUM_THREADS];
+
+int main()
+{
+  for(int i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_t thread;
+    int rc = pthread_create(&thread, 0, thread_main, &threadStates[i]);
+    assert(rc == 0);
+    pthread_detach(thread);
+  }
+  emscripten_exit_with_live_runtime();
+}
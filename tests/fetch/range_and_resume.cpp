@@ -0,0 +1,84 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+// range.txt contains "0123456789" repeated 100 times.
+
+void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+void loadedFromIndexedDB(emscripten_fetch_t *fetch)
+{
+  // The resumable download stored the whole file to IndexedDB.
+  assert(fetch->numBytes == 1000);
+  assert(!memcmp(fetch->data + 990, "0123456789", 10));
+  emscripten_fetch_close(fetch);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
+
+void downloaded(emscripten_fetch_t *fetch)
+{
+  assert(fetch->numBytes == 1000);
+  assert(fetch->totalBytes == 1000);
+  for(int i = 0; i < 1000; ++i) assert(fetch->data[i] == '0' + i % 10);
+  emscripten_fetch_close(fetch);
+
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_NO_DOWNLOAD | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.onsuccess = loadedFromIndexedDB;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "range.txt");
+}
+
+void resume()
+{
+  // The test server does not support Range requests, so this tests falling back to downloading the whole file.
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_APPEND | EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.onsuccess = downloaded;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "range.txt");
+}
+
+int numRangesDone = 0;
+
+void gotRange(emscripten_fetch_t *fetch)
+{
+  const char *expected = (const char *)fetch->userData;
+  printf("Got %llu bytes: %.*s\n", fetch->numBytes, (int)fetch->numBytes, fetch->data);
+  assert(fetch->numBytes == strlen(expected));
+  assert(!memcmp(fetch->data, expected, fetch->numBytes));
+  assert(fetch->totalBytes == 1000);
+  emscripten_fetch_close(fetch);
+  if (++numRangesDone == 2) resume();
+}
+
+void fetchRange(uint64_t rangeStart, uint64_t rangeEnd, const char *expected)
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_REPLACE | EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.rangeStart = rangeStart;
+  attr.rangeEnd = rangeEnd;
+  attr.userData = (void*)expected;
+  attr.onsuccess = gotRange;
+  attr.onerror = failed;
+  emscripten_fetch(&attr, "range.txt");
+}
+
+int main()
+{
+  fetchRange(13, 21, "34567890");
+  fetchRange(995, 0, "56789");
+}
@@ -0,0 +1,70 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+void failed(emscripten_fetch_t *fetch)
+{
+  printf("Fetch of %s failed with status %d\n", fetch->url, fetch->status);
+  assert(false);
+}
+
+void fetchFile(const char *url, unsigned int attributes, void (*onsuccess)(emscripten_fetch_t *), void (*onerror)(emscripten_fetch_t *))
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = attributes;
+  attr.onsuccess = onsuccess;
+  attr.onerror = onerror;
+  emscripten_fetch(&attr, url);
+}
+
+void missing(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_timing_t timing;
+  EMSCRIPTEN_RESULT ret = emscripten_fetch_get_timing(fetch, &timing);
+  assert(ret == EMSCRIPTEN_RESULT_SUCCESS);
+  assert(timing.cacheResult == EMSCRIPTEN_FETCH_CACHE_MISS);
+  assert(timing.numBytesCopiedToHeap == 0);
+  assert(timing.totalMSecs > 0);
+  emscripten_fetch_close(fetch);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
+
+void loadedFromIndexedDB(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_timing_t timing;
+  emscripten_fetch_get_timing(fetch, &timing);
+  printf("Loaded from IndexedDB in %f msecs\n", timing.totalMSecs);
+  assert(timing.cacheResult == EMSCRIPTEN_FETCH_CACHE_HIT);
+  assert(timing.numBytesCopiedToHeap == 6407);
+  // No XHR was sent.
+  assert(timing.queuedMSecs == 0);
+  assert(timing.timeToFirstByteMSecs == 0);
+  assert(timing.downloadMSecs == 0);
+  assert(timing.totalMSecs > 0);
+  emscripten_fetch_close(fetch);
+  fetchFile("timing_does_not_exist.png", EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_NO_DOWNLOAD, failed, missing);
+}
+
+void downloaded(emscripten_fetch_t *fetch)
+{
+  emscripten_fetch_timing_t timing;
+  emscripten_fetch_get_timing(fetch, &timing);
+  printf("Downloaded in %f msecs: queued %f msecs, time to first byte %f msecs, download %f msecs\n", timing.totalMSecs, timing.queuedMSecs, timing.timeToFirstByteMSecs, timing.downloadMSecs);
+  assert(timing.cacheResult == EMSCRIPTEN_FETCH_CACHE_NOT_USED);
+  assert(timing.numBytesCopiedToHeap == 6407);
+  assert(timing.timeToFirstByteMSecs >= 0);
+  assert(timing.totalMSecs > 0);
+  assert(timing.totalMSecs >= timing.queuedMSecs + timing.timeToFirstByteMSecs + timing.downloadMSecs - 0.001);
+  emscripten_fetch_close(fetch);
+  fetchFile("gears.png", EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_NO_DOWNLOAD, loadedFromIndexedDB, failed);
+}
+
+int main()
+{
+  fetchFile("gears.png", EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_PERSIST_FILE | EMSCRIPTEN_FETCH_REPLACE, downloaded, failed);
+}
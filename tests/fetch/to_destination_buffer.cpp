@@ -0,0 +1,69 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten/fetch.h>
+
+// The downloaded file is 6407 bytes, so it fits in the first buffer but not in the second one.
+char bigBuffer[8192];
+char smallBuffer[1024];
+int result = 0;
+
+void fetchToSmallBuffer()
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.destinationBuffer = smallBuffer;
+  attr.destinationBufferSize = sizeof(smallBuffer);
+  attr.onsuccess = [](emscripten_fetch_t *fetch) {
+    assert(false && "onsuccess handler called, but the file should not fit in the destination buffer");
+  };
+  attr.onerror = [](emscripten_fetch_t *fetch) {
+    printf("Download to a too small buffer failed with status %d.\n", fetch->status);
+    assert(fetch->status == 413);
+    assert(fetch->data == 0);
+    assert(fetch->numBytes == 0);
+    assert(fetch->totalBytes == 6407);
+    emscripten_fetch_close(fetch);
+
+#ifdef REPORT_RESULT
+    REPORT_RESULT(result);
+#endif
+  };
+  emscripten_fetch(&attr, "gears.png");
+}
+
+int main()
+{
+  emscripten_fetch_attr_t attr;
+  emscripten_fetch_attr_init(&attr);
+  strcpy(attr.requestMethod, "GET");
+  attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attr.destinationBuffer = bigBuffer;
+  attr.destinationBufferSize = sizeof(bigBuffer);
+  attr.onsuccess = [](emscripten_fetch_t *fetch) {
+    printf("Finished downloading %llu bytes\n", fetch->numBytes);
+    assert(fetch->numBytes == 6407);
+    assert(fetch->data == bigBuffer);
+    // Compute rudimentary checksum of data
+    uint8_t checksum = 0;
+    for(int i = 0; i < fetch->numBytes; ++i)
+      checksum ^= fetch->data[i];
+    printf("Data checksum: %02X\n", checksum);
+    assert(checksum == 0x08);
+    emscripten_fetch_close(fetch); // Must not free the destination buffer.
+
+    // The data remains in the buffer after the fetch has been closed.
+    checksum = 0;
+    for(int i = 0; i < 6407; ++i)
+      checksum ^= bigBuffer[i];
+    assert(checksum == 0x08);
+    result = 1;
+    fetchToSmallBuffer();
+  };
+  attr.onerror = [](emscripten_fetch_t *fetch) {
+    assert(false && "onerror handler called, but the transfer should have succeeded!");
+  };
+  emscripten_fetch(&attr, "gears.png");
+}
@@ -0,0 +1,72 @@
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/fetch.h>
+
+#define NUM_FETCHES 8
+
+static int numSucceeded = 0;
+static int numFailed = 0;
+
+static void succeeded(emscripten_fetch_t *fetch)
+{
+  // The handlers of waitable fetches run from within emscripten_fetch_wait_any().
+  ++numSucceeded;
+}
+
+static void failed(emscripten_fetch_t *fetch)
+{
+  ++numFailed;
+}
+
+int main()
+{
+  emscripten_fetch_t *fetches[NUM_FETCHES];
+  for(int i = 0; i < NUM_FETCHES; ++i)
+  {
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    strcpy(attr.requestMethod, "GET");
+    attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_WAITABLE;
+    attr.onsuccess = succeeded;
+    attr.onerror = failed;
+    // The last fetch fails, and is returned like the others.
+    fetches[i] = emscripten_fetch(&attr, (i == NUM_FETCHES - 1) ? "does_not_exist.png" : "gears.png");
+    assert(fetches[i]);
+  }
+
+  // Null entries are skipped.
+  emscripten_fetch_t *none[2] = { 0, 0 };
+  assert(emscripten_fetch_wait_any(none, 2, 0) == EMSCRIPTEN_RESULT_INVALID_PARAM);
+
+  bool done[NUM_FETCHES] = {};
+  for(int i = 0; i < NUM_FETCHES; ++i)
+  {
+    int ret = emscripten_fetch_wait_any(fetches, NUM_FETCHES, INFINITY);
+    assert(ret >= 0 && ret < NUM_FETCHES);
+    assert(!done[ret]);
+    done[ret] = true;
+    assert(numSucceeded + numFailed == i + 1);
+    if (ret == NUM_FETCHES - 1)
+      assert(fetches[ret]->status == 404);
+    else
+    {
+      assert(fetches[ret]->status == 200);
+      assert(fetches[ret]->numBytes == 6407);
+    }
+    emscripten_fetch_close(fetches[ret]);
+    fetches[ret] = 0;
+  }
+  assert(numSucceeded == NUM_FETCHES - 1);
+  assert(numFailed == 1);
+
+  // There is nothing left to wait for.
+  assert(emscripten_fetch_wait_any(fetches, NUM_FETCHES, INFINITY) == EMSCRIPTEN_RESULT_INVALID_PARAM);
+
+  printf("All fetches finished.\n");
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
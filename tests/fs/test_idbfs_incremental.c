@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <emscripten.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+int result = 1;
+
+void success()
+{
+  REPORT_RESULT(result);
+}
+
+void write_file(const char *path, const char *contents)
+{
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    result = -1000 - errno;
+  else
+  {
+    if (write(fd, contents, strlen(contents)) != strlen(contents))
+      result = -2000 - errno;
+    if (close(fd) != 0)
+      result = -3000 - errno;
+  }
+}
+
+void check_file(const char *path, const char *contents)
+{
+  char bf[256];
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    result = -4000 - errno;
+  else
+  {
+    int bytes_read = read(fd, bf, sizeof(bf) - 1);
+    if (bytes_read != strlen(contents))
+      result = -5000;
+    else
+    {
+      bf[bytes_read] = 0;
+      if (strcmp(bf, contents) != 0)
+        result = -6000;
+    }
+    if (close(fd) != 0)
+      result = -7000 - errno;
+  }
+}
+
+// Returns the number of paths that the next sync writes or removes.
+int num_dirty_paths()
+{
+  return EM_ASM_INT({
+    var dirty = FS.lookupPath('/working1').node.mount.dirtyPaths;
+    return dirty ? Object.keys(dirty).length : -1;
+  });
+}
+
+void sync_and_succeed()
+{
+  EM_ASM(
+    FS.syncfs(function (err) {
+      assert(!err);
+      ccall('success', 'v');
+    });
+  );
+}
+
+void second_sync()
+{
+  // after a sync, only the paths changed by the rename, the write and the unlink are written.
+  if (num_dirty_paths() != 0)
+    result = -8000;
+  if (rename("/working1/dir", "/working1/moved") != 0)
+    result = -9000 - errno;
+  write_file("/working1/moved/a.txt", SECRET);
+  if (unlink("/working1/moved/b.txt") != 0)
+    result = -10000 - errno;
+  // dir, dir/a.txt, dir/b.txt, moved, moved/a.txt and moved/b.txt.
+  if (num_dirty_paths() != 6)
+    result = -11000 - num_dirty_paths();
+  sync_and_succeed();
+}
+
+void test() {
+
+  struct stat st;
+
+#if FIRST
+
+  if ((stat("/working1/dir", &st) != -1) || (errno != ENOENT))
+    result = -12000 - errno;
+  if (mkdir("/working1/dir", 0777) != 0)
+    result = -13000 - errno;
+  write_file("/working1/dir/a.txt", "a");
+  write_file("/working1/dir/b.txt", "b");
+  // the dirty paths of the populated mount are tracked from the start.
+  if (num_dirty_paths() != 3)
+    result = -14000 - num_dirty_paths();
+
+  EM_ASM(
+    FS.syncfs(function (err) {
+      assert(!err);
+      ccall('second_sync', 'v');
+    });
+  );
+
+#else
+
+  // the rename and the removal reached the database.
+  if ((stat("/working1/dir", &st) != -1) || (errno != ENOENT))
+    result = -15000 - errno;
+  if ((stat("/working1/moved/b.txt", &st) != -1) || (errno != ENOENT))
+    result = -16000 - errno;
+  check_file("/working1/moved/a.txt", SECRET);
+
+  if (unlink("/working1/moved/a.txt") != 0)
+    result = -17000 - errno;
+  if (rmdir("/working1/moved") != 0)
+    result = -18000 - errno;
+  sync_and_succeed();
+
+#endif
+
+}
+
+int main() {
+
+  EM_ASM(
+    FS.mkdir('/working1');
+    FS.mount(IDBFS, {}, '/working1');
+
+    // sync from persisted state into memory and then
+    // run the 'test' function
+    FS.syncfs(true, function (err) {
+      assert(!err);
+      ccall('test', 'v');
+    });
+  );
+
+  emscripten_exit_with_live_runtime();
+
+  return 0;
+}
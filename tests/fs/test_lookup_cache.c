@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <emscripten.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Returns the inode that a path resolves to, looking it up twice so that the second lookup comes from the cache.
+int lookup(const char *path)
+{
+  return EM_ASM_INT({
+    var path = Pointer_stringify($0);
+    try {
+      var first = FS.lookupPath(path, { follow: true }).node;
+      var second = FS.lookupPath(path, { follow: true }).node;
+      assert(first === second);
+      return first.id;
+    } catch (e) {
+      return -1;
+    }
+  }, path);
+}
+
+int main()
+{
+  assert(mkdir("/dir", 0777) == 0);
+  close(open("/dir/file", O_CREAT | O_WRONLY, 0666));
+  int file = lookup("/dir/file");
+  assert(file > 0);
+
+  // Relative paths depend on the current directory.
+  assert(chdir("/dir") == 0);
+  assert(lookup("file") == file);
+  assert(chdir("/") == 0);
+  assert(lookup("file") == -1);
+
+  // Renames and unlinks are seen by later lookups.
+  assert(rename("/dir", "/moved") == 0);
+  assert(lookup("/dir/file") == -1);
+  assert(lookup("/moved/file") == file);
+  assert(unlink("/moved/file") == 0);
+  assert(lookup("/moved/file") == -1);
+
+  // Symlinks resolve to their current target.
+  close(open("/moved/a", O_CREAT | O_WRONLY, 0666));
+  close(open("/moved/b", O_CREAT | O_WRONLY, 0666));
+  assert(symlink("/moved/a", "/link") == 0);
+  assert(lookup("/link") == lookup("/moved/a"));
+  assert(unlink("/link") == 0);
+  assert(symlink("/moved/b", "/link") == 0);
+  assert(lookup("/link") == lookup("/moved/b"));
+
+  // Mounting hides the directory contents, and unmounting shows them again.
+  int before = lookup("/moved/a");
+  EM_ASM(FS.mount(MEMFS, {}, '/moved'));
+  assert(lookup("/moved/a") == -1);
+  EM_ASM(FS.unmount('/moved'));
+  assert(lookup("/moved/a") == before);
+
+  puts("success");
+  return 0;
+}
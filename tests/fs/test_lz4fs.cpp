@@ -105,6 +105,16 @@ void EMSCRIPTEN_KEEPALIVE finish() {
     assert(Module['decompressedChunks'] == 2, ['seeing', Module['decompressedChunks'], 'decompressed chunks']);
   ));
   printf("caching test ok\n");
+  printf("reads of whole chunks\n");
+  EM_ASM((
+    assert(Module.compressedData.fileChunks[1] == 640); // each file starts in a chunk of its own
+  ));
+  static char chunks[3*2048 + 100];
+  ret = fseek(f2, 123, SEEK_SET); assert(ret == 0);
+  num = fread(chunks, 1, sizeof(chunks), f2); assert(num == sizeof(chunks));
+  for (int i = 0; i < sizeof(chunks); i++) {
+    assert(chunks[i] == "1234567890"[(123 + i) % 10]);
+  }
 #endif
 
   fclose(f1);
@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <emscripten.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SIZE (1024 * 1024)
+
+// Returns the address of the file data in the heap, or 0 if it is not there.
+void *heap_storage(const char *path)
+{
+  return (void *)EM_ASM_INT({
+    var node = FS.lookupPath(Pointer_stringify($0)).node;
+    return node.heapStorage ? node.heapStorage.ptr : 0;
+  }, path);
+}
+
+int main()
+{
+  unsigned char *data = malloc(SIZE);
+  for (int i = 0; i < SIZE; ++i) data[i] = i * 7;
+  FILE *f = fopen("/big", "wb");
+  assert(fwrite(data, SIZE, 1, f) == 1);
+  fclose(f);
+  assert(!heap_storage("/big"));
+
+  // Reading the file moves it into the heap.
+  unsigned char *copy = malloc(SIZE);
+  int fd = open("/big", O_RDONLY);
+  assert(read(fd, copy, SIZE) == SIZE);
+  assert(memcmp(data, copy, SIZE) == 0);
+  unsigned char *storage = heap_storage("/big");
+  assert(storage);
+
+  // Read-only mappings point at the file data.
+  unsigned char *mapped = mmap(0, SIZE - 4096, PROT_READ, MAP_PRIVATE, fd, 4096);
+  assert(mapped == storage + 4096);
+  assert(memcmp(mapped, data + 4096, SIZE - 4096) == 0);
+  close(fd);
+
+  // Small files stay where they are.
+  f = fopen("/small", "wb");
+  assert(fwrite(data, 100, 1, f) == 1);
+  fclose(f);
+  fd = open("/small", O_RDONLY);
+  assert(read(fd, copy, 100) == 100);
+  close(fd);
+  assert(!heap_storage("/small"));
+
+  // The mapping stays valid when the file is removed.
+  assert(unlink("/big") == 0);
+  assert(memcmp(mapped, data + 4096, SIZE - 4096) == 0);
+  assert(munmap(mapped, SIZE - 4096) == 0);
+
+  // Appending to a file in the heap moves it out again, and keeps its data.
+  f = fopen("/big2", "wb");
+  assert(fwrite(data, SIZE, 1, f) == 1);
+  fclose(f);
+  fd = open("/big2", O_RDWR);
+  assert(read(fd, copy, SIZE) == SIZE);
+  assert(heap_storage("/big2"));
+  assert(write(fd, "tail", 4) == 4);
+  assert(!heap_storage("/big2"));
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  memset(copy, 0, SIZE);
+  assert(read(fd, copy, SIZE) == SIZE);
+  assert(memcmp(data, copy, SIZE) == 0);
+  close(fd);
+
+  puts("success");
+  return 0;
+}
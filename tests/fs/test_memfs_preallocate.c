@@ -0,0 +1,93 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <emscripten.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Returns a number identifying the backing store of the file, which changes when MEMFS reallocates it.
+int storage_id(const char *path)
+{
+  return EM_ASM_INT({
+    var node = FS.lookupPath(Pointer_stringify($0)).node;
+    if (!node.contents) return 0;
+    assert(node.contents.subarray, 'MEMFS files are backed by typed arrays');
+    if (!Module.storages) Module.storages = [];
+    var id = Module.storages.indexOf(node.contents.buffer);
+    if (id == -1) id = Module.storages.push(node.contents.buffer) - 1;
+    return id + 1;
+  }, path);
+}
+
+off_t file_size(int fd)
+{
+  struct stat st;
+  assert(fstat(fd, &st) == 0);
+  return st.st_size;
+}
+
+int main()
+{
+  char buf[4096];
+  memset(buf, 'x', sizeof(buf));
+
+  // Reserving space does not change the size, and the writes up to it do not reallocate.
+  int fd = open("/prealloc", O_RDWR | O_CREAT, 0666);
+  assert(fd != -1);
+  assert(fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 64 * sizeof(buf)) == 0);
+  assert(file_size(fd) == 0);
+  int id = storage_id("/prealloc");
+  for (int i = 0; i < 64; ++i)
+    assert(write(fd, buf, sizeof(buf)) == sizeof(buf));
+  assert(file_size(fd) == 64 * sizeof(buf));
+  assert(storage_id("/prealloc") == id);
+
+  // Truncating to a smaller size and growing again reads back zeros.
+  assert(ftruncate(fd, 10) == 0);
+  assert(ftruncate(fd, 20) == 0);
+  assert(file_size(fd) == 20);
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  char data[20];
+  assert(read(fd, data, sizeof(data)) == 20);
+  for (int i = 0; i < 20; ++i)
+    assert(data[i] == (i < 10 ? 'x' : 0));
+
+  // Truncating a file to its final size first, like posix_fallocate(), lets it be written without reallocating.
+  assert(ftruncate(fd, 0) == 0);
+  assert(posix_fallocate(fd, 0, 16 * sizeof(buf)) == 0);
+  assert(file_size(fd) == 16 * sizeof(buf));
+  id = storage_id("/prealloc");
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  for (int i = 0; i < 16; ++i)
+    assert(write(fd, buf, sizeof(buf)) == sizeof(buf));
+  assert(storage_id("/prealloc") == id);
+  assert(file_size(fd) == 16 * sizeof(buf));
+  close(fd);
+
+  // Appending small writes stays in a typed array, and grows it geometrically.
+  FILE *f = fopen("/append", "wb");
+  assert(f);
+  setvbuf(f, 0, _IONBF, 0);
+  int reallocations = 0;
+  int last = 0;
+  for (int i = 0; i < 10000; ++i)
+  {
+    assert(fwrite("0123456789", 10, 1, f) == 1);
+    int current = storage_id("/append");
+    if (current != last) ++reallocations;
+    last = current;
+  }
+  fclose(f);
+  assert(reallocations < 20);
+  f = fopen("/append", "rb");
+  fseek(f, 99990, SEEK_SET);
+  char tail[11] = {};
+  assert(fread(tail, 10, 1, f) == 1);
+  assert(strcmp(tail, "0123456789") == 0);
+  fclose(f);
+
+  puts("success");
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <emscripten.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+int result = 1;
+
+void success()
+{
+  REPORT_RESULT(result);
+}
+
+// Returns whether the file is read and written through an OPFS access handle.
+int has_handle(const char *path)
+{
+  return EM_ASM_INT({
+    return !!FS.lookupPath(Pointer_stringify($0)).node.handle;
+  }, path);
+}
+
+void test()
+{
+  struct stat st;
+  char buf[256];
+  int fd;
+
+#if FIRST
+
+  if ((stat("/opfs/moar.txt", &st) != -1) || (errno != ENOENT))
+    result = -1000 - errno;
+  fd = open("/opfs/moar.txt", O_RDWR | O_CREAT, 0666);
+  if (fd == -1)
+    result = -2000 - errno;
+  else
+  {
+    if (write(fd, SECRET, strlen(SECRET)) != strlen(SECRET))
+      result = -3000 - errno;
+    if (close(fd) != 0)
+      result = -4000 - errno;
+  }
+  if (mkdir("/opfs/dir", 0777) != 0)
+    result = -5000 - errno;
+  fd = open("/opfs/dir/waka.txt", O_RDWR | O_CREAT, 0666);
+  if (fd == -1 || write(fd, "az", 2) != 2 || close(fd) != 0)
+    result = -6000 - errno;
+  // new files stay in memory until the sync
+  if (has_handle("/opfs/moar.txt"))
+    result = -7000;
+
+#else
+
+  // persisted files are read in place
+  if (!has_handle("/opfs/moar.txt"))
+    result = -8000;
+  fd = open("/opfs/moar.txt", O_RDWR);
+  if (fd == -1)
+    result = -9000 - errno;
+  else
+  {
+    memset(buf, 0, sizeof(buf));
+    if (read(fd, buf, sizeof(buf)) != strlen(SECRET) || strcmp(buf, SECRET) != 0)
+      result = -10000;
+    // and written in place, without a sync
+    if (pwrite(fd, "!", 1, strlen(SECRET)) != 1 || fsync(fd) != 0)
+      result = -11000 - errno;
+    if (fstat(fd, &st) != 0 || st.st_size != strlen(SECRET) + 1)
+      result = -12000;
+    if (ftruncate(fd, 2) != 0 || fstat(fd, &st) != 0 || st.st_size != 2)
+      result = -13000;
+    if (close(fd) != 0)
+      result = -14000 - errno;
+  }
+  fd = open("/opfs/dir/waka.txt", O_RDONLY);
+  if (fd == -1 || read(fd, buf, sizeof(buf)) != 2 || strncmp(buf, "az", 2) != 0)
+    result = -15000 - errno;
+  close(fd);
+
+  // clean up, so that the next run starts out empty
+  if (unlink("/opfs/moar.txt") != 0 || unlink("/opfs/dir/waka.txt") != 0 || rmdir("/opfs/dir") != 0)
+    result = -16000 - errno;
+
+#endif
+
+  EM_ASM(
+    FS.syncfs(function (err) {
+      assert(!err);
+      ccall('success', 'v');
+    });
+  );
+}
+
+int main()
+{
+  EM_ASM(
+    FS.mkdir('/opfs');
+    FS.mount(OPFS, {}, '/opfs');
+    FS.syncfs(true, function (err) {
+      assert(!err);
+      ccall('test', 'v');
+    });
+  );
+
+  emscripten_exit_with_live_runtime();
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Draws from client-side vertex arrays, interleaved, separate and unaligned, and checks the rendered colors.
+#include <GLES2/gl2.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+
+typedef struct Vertex
+{
+  float x, y;
+  unsigned char r, g, b, a;
+} Vertex;
+
+GLuint compileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, 0);
+  glCompileShader(shader);
+  GLint ok = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  assert(ok);
+  return shader;
+}
+
+void checkPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b)
+{
+  unsigned char pixel[4];
+  glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  printf("pixel at %d,%d: %d %d %d\n", x, y, pixel[0], pixel[1], pixel[2]);
+  assert(pixel[0] == r && pixel[1] == g && pixel[2] == b);
+}
+
+// A quad covering the half of the viewport from x0 to x0+1, as two triangles.
+void quad(Vertex *v, float x0, unsigned char r, unsigned char g, unsigned char b)
+{
+  float xs[6] = { x0, x0 + 1, x0, x0, x0 + 1, x0 + 1 };
+  float ys[6] = { -1, -1, 1, 1, -1, 1 };
+  for(int i = 0; i < 6; ++i)
+  {
+    v[i].x = xs[i];
+    v[i].y = ys[i];
+    v[i].r = r; v[i].g = g; v[i].b = b; v[i].a = 255;
+  }
+}
+
+int main()
+{
+  emscripten_set_canvas_element_size("#canvas", 64, 64);
+  EmscriptenWebGLContextAttributes attrs;
+  emscripten_webgl_init_context_attributes(&attrs);
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_create_context(0, &attrs);
+  assert(context > 0);
+  emscripten_webgl_make_context_current(context);
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, compileShader(GL_VERTEX_SHADER,
+    "attribute vec2 pos; attribute vec4 color; varying vec4 c; void main() { c = color; gl_Position = vec4(pos, 0, 1); }"));
+  glAttachShader(program, compileShader(GL_FRAGMENT_SHADER,
+    "precision mediump float; varying vec4 c; void main() { gl_FragColor = c; }"));
+  glBindAttribLocation(program, 0, "pos");
+  glBindAttribLocation(program, 1, "color");
+  glLinkProgram(program);
+  glUseProgram(program);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glViewport(0, 0, 64, 64);
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // Interleaved: both attributes are uploaded at once.
+  Vertex interleaved[6];
+  quad(interleaved, -1, 255, 0, 0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &interleaved[0].x);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), &interleaved[0].r);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+  checkPixel(16, 32, 255, 0, 0);
+
+  // Separate, and with the colors at an odd address.
+  Vertex right[6];
+  quad(right, 0, 0, 255, 0);
+  float positions[12];
+  static unsigned char colorStorage[6*4+1];
+  unsigned char *colors = colorStorage + 1;
+  for(int i = 0; i < 6; ++i)
+  {
+    positions[i*2] = right[i].x;
+    positions[i*2+1] = right[i].y;
+    memcpy(colors + i*4, &right[i].r, 4);
+  }
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, positions);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, colors);
+  unsigned short indices[6] = { 0, 1, 2, 3, 4, 5 };
+  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+  checkPixel(48, 32, 0, 255, 0);
+  checkPixel(16, 32, 255, 0, 0);
+
+  // Draw enough to wrap around the streaming buffer.
+  for(int i = 0; i < 40000; ++i)
+  {
+    quad(interleaved, -1, 0, 0, i & 255);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &interleaved[0].x);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), &interleaved[0].r);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+  }
+  checkPixel(16, 32, 0, 0, 39999 & 255);
+  checkPixel(48, 32, 0, 255, 0);
+
+  assert(glGetError() == GL_NO_ERROR);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Draws many small glBegin()/glEnd() blocks, which the immediate mode emulation batches, mixed with blocks and state
+// changes that it cannot batch, and checks that everything is drawn in order and with the right state.
+#include "SDL/SDL.h"
+#include "SDL/SDL_opengl.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+void checkPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b)
+{
+  unsigned char pixel[4];
+  glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  printf("pixel at %d,%d: %d %d %d\n", x, y, pixel[0], pixel[1], pixel[2]);
+  assert(pixel[0] == r && pixel[1] == g && pixel[2] == b);
+}
+
+void quad(float x, float y, float size)
+{
+  glBegin(GL_QUADS);
+  glVertex2f(x, y);
+  glVertex2f(x + size, y);
+  glVertex2f(x + size, y + size);
+  glVertex2f(x, y + size);
+  glEnd();
+}
+
+int main()
+{
+  SDL_Init(SDL_INIT_VIDEO);
+  SDL_Surface *screen = SDL_SetVideoMode(64, 64, 32, SDL_OPENGL);
+  assert(screen);
+
+  glViewport(0, 0, 64, 64);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(0, 64, 0, 64, -1, 1);
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // A grid of red quads, each in its own block.
+  glColor3f(1, 0, 0);
+  for(int y = 0; y < 64; y += 4)
+    for(int x = 0; x < 64; x += 4)
+      quad(x, y, 4);
+
+  // Green over the left half, with a strip, which is not batched, so it must be drawn after the quads.
+  glColor3f(0, 1, 0);
+  glBegin(GL_TRIANGLE_STRIP);
+  glVertex2f(0, 0);
+  glVertex2f(32, 0);
+  glVertex2f(0, 64);
+  glVertex2f(32, 64);
+  glEnd();
+
+  // Blue over the bottom left quarter, with per-vertex colors, and moved by the modelview matrix, which must not apply
+  // to the quads drawn before it changed.
+  for(int y = 0; y < 32; y += 8)
+  {
+    glBegin(GL_TRIANGLES);
+    for(int x = 0; x < 32; x += 8)
+    {
+      glColor3f(0, 0, 1); glVertex2f(x, y);
+      glColor3f(0, 0, 1); glVertex2f(x + 8, y);
+      glColor3f(0, 0, 1); glVertex2f(x + 8, y + 8);
+      glColor3f(0, 0, 1); glVertex2f(x, y);
+      glColor3f(0, 0, 1); glVertex2f(x + 8, y + 8);
+      glColor3f(0, 0, 1); glVertex2f(x, y + 8);
+    }
+    glEnd();
+  }
+  glTranslatef(32, 32, 0);
+  glColor3f(1, 1, 1);
+  quad(0, 0, 16);
+  glLoadIdentity();
+
+  checkPixel(48, 8, 255, 0, 0);
+  checkPixel(8, 48, 0, 255, 0);
+  checkPixel(8, 8, 0, 0, 255);
+  checkPixel(40, 40, 255, 255, 255);
+  checkPixel(56, 56, 255, 0, 0);
+
+  assert(glGetError() == GL_NO_ERROR);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(1);
+#endif
+  return 0;
+}
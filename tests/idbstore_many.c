@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include <emscripten.h>
+
+#define DB "THE_DB"
+#define NUM 3
+
+const char *ids[NUM + 1] = { "many_0", "many_1", "many_2", "many_missing" };
+char secrets[NUM][64];
+int loaded = 0;
+
+void onerror(void* arg)
+{
+  REPORT_RESULT(999);
+}
+
+void onstore(void* arg)
+{
+  assert((int)arg == 12);
+  REPORT_RESULT(STAGE);
+}
+
+void onloadinto(void* arg, int num)
+{
+  char *buffer = arg;
+  printf("loaded into %s\n", buffer);
+  assert(num == strlen(secrets[1])+1);
+  assert(strcmp(buffer, secrets[1]) == 0);
+  REPORT_RESULT(STAGE);
+}
+
+void onload(void* arg, int index, void* ptr, int num)
+{
+  assert((int)arg == 31);
+  assert(index == loaded++);
+  if (index == NUM) {
+    // missing data is not an error
+    assert(ptr == NULL && num == -1);
+    static char buffer[64];
+    emscripten_idb_async_load_into(DB, ids[1], buffer, sizeof(buffer), buffer, onloadinto, onerror);
+    return;
+  }
+  printf("loaded %s\n", ptr);
+  assert(num == strlen(secrets[index])+1);
+  assert(strcmp(ptr, secrets[index]) == 0);
+}
+
+int main() {
+  void *ptrs[NUM];
+  int nums[NUM];
+  for (int i = 0; i < NUM; i++) {
+    sprintf(secrets[i], "%s_%d", SECRET, i);
+    ptrs[i] = secrets[i];
+    nums[i] = strlen(secrets[i])+1;
+  }
+#if STAGE == 0
+  emscripten_idb_async_store_many(DB, ids, ptrs, nums, NUM, (void*)12, onstore, onerror);
+  // the data was copied, so changing it now does not matter
+  memset(secrets, 0, sizeof(secrets));
+#elif STAGE == 1
+  emscripten_idb_async_load_many(DB, ids, NUM + 1, (void*)31, onload, onerror);
+#else
+  assert(0);
+#endif
+  emscripten_exit_with_live_runtime();
+  return 0;
+}
@@ -0,0 +1,21 @@
+function _a(x) {
+ x = x | 0;
+ _b(x) | 0;
+ _c(x) | 0;
+ _b(1) | 0;
+ return FUNCTION_TABLE_ii[x & 3](x) | 0;
+}
+function _b(x) {
+ x = x | 0;
+ return _c(x) | 0;
+}
+function _c(x) {
+ x = x | 0;
+ return x | 0;
+}
+function _d() {
+ _e();
+ FUNCTION_TABLE_v[0 & 1]();
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_a", "_b", "_c", "_d"]
+// EXTRA_INFO: { "blacklist": ["_a"] }
@@ -0,0 +1,19 @@
+function _calls(p, x) {
+ p = p | 0;
+ x = +x;
+ var i = 0, d = 0, f = Math_fround(0);
+ if ((HEAP32[p >> 2] & 7) == 2) __ZN1A1fEv(p); else if ((HEAP32[p >> 2] & 7) == 4 | (HEAP32[p >> 2] & 7) == 5) __ZN1B1fEv(p); else FUNCTION_TABLE_vi[HEAP32[p >> 2] & 7](p);
+ i = (HEAP32[(HEAP32[p >> 2] | 0) + 4 >> 2] & 15) == 1 ? _add(p, i + 1 | 0) | 0 : FUNCTION_TABLE_iii[HEAP32[(HEAP32[p >> 2] | 0) + 4 >> 2] & 15](p, i + 1 | 0) | 0;
+ d = (i & 3) == 3 ? +_sqr(x) : +FUNCTION_TABLE_dd[i & 3](x);
+ f = (i & 1) == 1 ? Math_fround(_half(f)) : Math_fround(FUNCTION_TABLE_ff[i & 1](f));
+ if ((i & 15) == 1) _add(p, 2) | 0; else FUNCTION_TABLE_iii[i & 15](p, 2) | 0;
+ return (i & 15) == 1 ? _add((p & 15) == 1 ? _add(i, 3) | 0 : FUNCTION_TABLE_iii[p & 15](i, 3) | 0, 4) | 0 : FUNCTION_TABLE_iii[i & 15]((p & 15) == 1 ? _add(i, 3) | 0 : FUNCTION_TABLE_iii[p & 15](i, 3) | 0, 4) | 0;
+}
+
+function _leftAlone(p) {
+ p = p | 0;
+ FUNCTION_TABLE_vi[(_next(p) | 0) & 7](p);
+ FUNCTION_TABLE_ii[p & 7](p) | 0;
+ HEAP32[p >> 2] = FUNCTION_TABLE_ii[p & 7](p) | 0;
+}
+
@@ -0,0 +1,19 @@
+function _calls(p, x) {
+ p = p | 0;
+ x = +x;
+ var i = 0, d = 0.0, f = Math_fround(0);
+ FUNCTION_TABLE_vi[HEAP32[p >> 2] & 7](p);
+ i = FUNCTION_TABLE_iii[HEAP32[(HEAP32[p >> 2] | 0) + 4 >> 2] & 15](p, i + 1 | 0) | 0;
+ d = +FUNCTION_TABLE_dd[i & 3](x);
+ f = Math_fround(FUNCTION_TABLE_ff[i & 1](f));
+ FUNCTION_TABLE_iii[i & 15](p, 2) | 0;
+ return FUNCTION_TABLE_iii[i & 15](FUNCTION_TABLE_iii[p & 15](i, 3) | 0, 4) | 0;
+}
+function _leftAlone(p) {
+ p = p | 0;
+ FUNCTION_TABLE_vi[(_next(p) | 0) & 7](p);
+ FUNCTION_TABLE_ii[p & 7](p) | 0;
+ HEAP32[p >> 2] = FUNCTION_TABLE_ii[p & 7](p) | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_calls", "_leftAlone"]
+// EXTRA_INFO: { "devirtualize": { "FUNCTION_TABLE_vi": [["__ZN1A1fEv", 2], ["__ZN1B1fEv", 4, 5]], "FUNCTION_TABLE_iii": [["_add", 1]], "FUNCTION_TABLE_dd": [["_sqr", 3]], "FUNCTION_TABLE_ff": [["_half", 1]] } }
@@ -0,0 +1,73 @@
+function _get(p) {
+ p = p | 0;
+ return HEAP32[p + 4 >> 2] | 0;
+}
+
+function _set(p, v) {
+ p = p | 0;
+ v = +v;
+ HEAPF64[p + 8 >> 3] = v;
+}
+
+function _abs(x) {
+ x = x | 0;
+ if ((x | 0) < 0) return 0 - x | 0;
+ return x | 0;
+}
+
+function _fact(n) {
+ n = n | 0;
+ if ((n | 0) < 2) return 1;
+ return Math_imul(n, _fact(n - 1 | 0) | 0) | 0;
+}
+
+function _bump() {
+ var t = 0;
+ t = HEAP32[16] | 0;
+ HEAP32[16] = t + 1;
+ return t | 0;
+}
+
+function _main(a, b) {
+ a = a | 0;
+ b = b | 0;
+ var x = 0, y = 0, $i0$p = 0, $i0$ret = 0, $i1$p = 0, $i1$v = +0, $i2$x = 0, $i2$ret = 0, $i3$t = 0, $i4$x = 0;
+ $i0$p = a;
+ $i0$ret = HEAP32[$i0$p + 4 >> 2] | 0;
+ x = $i0$ret | 0;
+ $i1$p = b;
+ $i1$v = +(x | 0);
+ HEAPF64[$i1$p + 8 >> 3] = $i1$v;
+ if (x) {
+  $i2$x = x - 5 | 0;
+  $i2$L : do {
+   if (($i2$x | 0) < 0) {
+    $i2$ret = 0 - $i2$x | 0;
+    break $i2$L;
+   }
+   $i2$ret = $i2$x | 0;
+  } while (0);
+  y = $i2$ret | 0;
+ }
+ while (1) {
+  x = (_get(x) | 0) + (_get(b) | 0) | 0;
+  if (!x) break;
+  y = _fact(y) | 0;
+ }
+ $i3$t = 0;
+ $i3$t = HEAP32[16] | 0;
+ HEAP32[16] = $i3$t + 1;
+ $i4$x = y;
+ $i4$L : do {
+  if (($i4$x | 0) < 0) {
+   break $i4$L;
+  }
+ } while (0);
+ return y | 0;
+}
+
+function _shadow(HEAP32) {
+ HEAP32 = HEAP32 | 0;
+ return _get(HEAP32) | 0;
+}
+
@@ -0,0 +1,46 @@
+function _get(p) {
+ p = p | 0;
+ return HEAP32[p + 4 >> 2] | 0;
+}
+function _set(p, v) {
+ p = p | 0;
+ v = +v;
+ HEAPF64[p + 8 >> 3] = v;
+}
+function _abs(x) {
+ x = x | 0;
+ if ((x | 0) < 0) return 0 - x | 0;
+ return x | 0;
+}
+function _fact(n) {
+ n = n | 0;
+ if ((n | 0) < 2) return 1;
+ return Math_imul(n, _fact(n - 1 | 0) | 0) | 0;
+}
+function _bump() {
+ var t = 0;
+ t = HEAP32[16] | 0;
+ HEAP32[16] = t + 1;
+ return t | 0;
+}
+function _main(a, b) {
+ a = a | 0;
+ b = b | 0;
+ var x = 0, y = 0;
+ x = _get(a) | 0;
+ _set(b, +(x | 0));
+ if (x) y = _abs(x - 5 | 0) | 0;
+ while (1) {
+  x = (_get(x) | 0) + (_get(b) | 0) | 0;
+  if (!x) break;
+  y = _fact(y) | 0;
+ }
+ _bump() | 0;
+ _abs(y) | 0;
+ return y | 0;
+}
+function _shadow(HEAP32) {
+ HEAP32 = HEAP32 | 0;
+ return _get(HEAP32) | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_get", "_set", "_abs", "_fact", "_bump", "_main", "_shadow"]
@@ -0,0 +1,24 @@
+function _noParams() {
+ profileFunctionCall(0);
+ HEAP32[4] = 1;
+}
+
+function _params(x, y) {
+ x = x | 0;
+ y = +y;
+ var z = 0, w = 0;
+ var v = 0;
+ profileFunctionCall(1);
+ z = x + 1 | 0;
+ return z | 0;
+}
+
+function _empty() {
+ profileFunctionCall(2);
+}
+
+function _unlisted(a) {
+ a = a | 0;
+ return a | 0;
+}
+
@@ -0,0 +1,19 @@
+function _noParams() {
+ HEAP32[4] = 1;
+}
+function _params(x, y) {
+ x = x | 0;
+ y = +y;
+ var z = 0, w = 0;
+ var v = 0;
+ z = x + 1 | 0;
+ return z | 0;
+}
+function _empty() {
+}
+function _unlisted(a) {
+ a = a | 0;
+ return a | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_noParams", "_params", "_empty", "_unlisted"]
+// EXTRA_INFO: { "functionIds": { "_noParams": 0, "_params": 1, "_empty": 2 } }
@@ -0,0 +1,56 @@
+function _sum(x, n) {
+ x = x | 0;
+ n = n | 0;
+ var i = 0, s = 0, $licm0 = 0;
+ $licm0 = HEAP32[x + 8 >> 2] | 0;
+ while (1) {
+  if ((i | 0) >= (n | 0)) break;
+  s = s + ($licm0 | 0) + (HEAP32[x + (i << 2) >> 2] | 0) | 0;
+  i = i + 1 | 0;
+ }
+ return s | 0;
+}
+
+function _store(x, n, d) {
+ x = x | 0;
+ n = n | 0;
+ d = +d;
+ var i = 0, $licm0 = 0, $licm1 = 0, $licm2 = 0;
+ $licm0 = n + 1 | 0;
+ $licm1 = x + 16 | 0;
+ $licm2 = x + 24 | 0;
+ L1 : while (1) {
+  if ((i | 0) >= ($licm0 | 0)) break L1;
+  HEAP32[$licm1 >> 2] = (HEAP32[$licm1 >> 2] | 0) + 1;
+  HEAPF64[x + (i << 3) >> 3] = +HEAPF64[$licm2 >> 3] * d;
+  i = i + 1 | 0;
+  if (i) continue L1;
+ }
+}
+
+function _nested(x, n, m) {
+ x = x | 0;
+ n = n | 0;
+ m = m | 0;
+ var i = 0, j = 0, s = 0, $licm0 = 0, $licm1 = 0;
+ $licm1 = n << 1;
+ do {
+  j = 0;
+  $licm0 = x + (Math_imul(i, m) | 0) + (n << 2) | 0;
+  do {
+   s = s + (HEAP32[$licm0 >> 2] | 0) + (j ^ $licm1) | 0;
+   _g(s);
+   j = j + 1 | 0;
+  } while ((j | 0) < (m | 0));
+  i = i + 1 | 0;
+ } while ((i | 0) < (n | 0));
+ return s | 0;
+}
+
+function _once(x) {
+ x = x | 0;
+ do {
+  HEAP32[x >> 2] = x + 4 >> 2;
+ } while (0);
+}
+
@@ -0,0 +1,62 @@
+var asm = (/** @suppress {uselessCode} */ function(global, env, buffer) {
+'use asm';
+
+  var HEAP8 = new global.Int8Array(buffer);
+  var HEAP32 = new global.Int32Array(buffer);
+  var HEAPF64 = new global.Float64Array(buffer);
+
+  var DYNAMICTOP_PTR=env.DYNAMICTOP_PTR|0;
+  var tempDoublePtr=env.tempDoublePtr|0;
+  var ABORT=env.ABORT|0;
+  var STACKTOP=env.STACKTOP|0;
+  var STACK_MAX=env.STACK_MAX|0;
+
+  var __THREW__ = 0;
+  var threwValue = 0;
+  var nan = global.NaN, inf = global.Infinity;
+  var tempInt = 0, tempBigInt = 0, tempDouble = 13371337;
+  var tempRet0 = 0;
+
+  var Math_floor=global.Math.floor;
+  var Math_imul=global.Math.imul;
+  var abort=env.abort;
+  var enlargeMemory=env.enlargeMemory;
+  var _printf=env._printf;
+  var ___setErrNo=env.___setErrNo;
+  var tempFloat = 13371337;
+
+// EMSCRIPTEN_START_FUNCS
+
+function stackAlloc(size) {
+  size = size|0;
+  var ret = 0;
+  ret = STACKTOP;
+  STACKTOP = (STACKTOP + size)|0;
+  STACKTOP = (STACKTOP + 15)&-16;
+
+  return ret|0;
+}
+function stackSave() {
+  return STACKTOP|0;
+}
+function setThrew(threw, value) {
+  threw = threw|0;
+  value = value|0;
+  if ((__THREW__|0) == 0) {
+    __THREW__ = threw;
+    threwValue = value;
+  }
+}
+function setTempRet0(value) {
+  value = value|0;
+  tempRet0 = value;
+}
+
+EMSCRIPTEN_FUNCS();
+
+  var FUNCTION_TABLE_ii = [b0,_main,b0,_foo];
+  var FUNCTION_TABLE_v = [b1];
+
+  return { _main: _main, _foo: _foo, stackAlloc: stackAlloc, stackSave: stackSave, setThrew: setThrew, setTempRet0: setTempRet0, dynCall_ii: dynCall_ii };
+})
+// EXTRA_INFO:{"globals": ["_main", "_foo", "b0", "b1", "dynCall_ii"]}
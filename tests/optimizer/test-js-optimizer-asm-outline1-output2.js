@@ -0,0 +1,817 @@
+function lin() {
+ lin$0();
+ lin$1();
+ lin$2();
+ lin$3();
+}
+
+function lin2() {
+ while (1) {
+  lin2$0();
+  lin2$1();
+  lin2$2();
+  lin2$3();
+ }
+}
+
+function lin3() {
+ var oc$ = 0, of$ = 0;
+ of$ = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ while (1) {
+  lin3$1();
+  lin3$2();
+  lin3$3();
+  {
+   oc$ = lin3$0(of$ | 0) | 0;
+   if ((oc$ | 0) == 1) {
+    STACKTOP = of$;
+    return HEAP32[of$ >> 2] | 0;
+   }
+  }
+ }
+ STACKTOP = of$;
+ return 20;
+}
+
+function lin4() {
+ var oc$ = 0;
+ while (1) {
+  lin4$1();
+  lin4$2();
+  lin4$3();
+  {
+   oc$ = lin4$0() | 0;
+   if ((oc$ | 0) == 1) break;
+  }
+ }
+ return 20;
+}
+
+function lin5() {
+ var oc$ = 0;
+ while (1) {
+  lin5$1();
+  lin5$2();
+  lin5$3();
+  {
+   oc$ = lin5$0() | 0;
+   if ((oc$ | 0) == 1) continue;
+  }
+ }
+ return 20;
+}
+
+function mix() {
+ var oc$ = 0;
+ main : while (1) {
+  mix$3();
+  {
+   oc$ = mix$0() | 0;
+   if ((oc$ | 0) == 1) break main;
+  }
+  c(18);
+  break;
+  while (1) {
+   break;
+  }
+  inner : while (1) {
+   break inner;
+  }
+  c(19);
+  continue;
+  c(20);
+  continue main;
+ }
+ return 20;
+}
+
+function vars(x, y) {
+ x = x | 0;
+ y = +y;
+ var a = 0, b = +0;
+ a = x + y;
+ b = y * x;
+ c(1 + a);
+ vars$0(a | 0, +b);
+ vars$1(a | 0, +b);
+ c(8 + b);
+}
+
+function vars2(x, y) {
+ x = x | 0;
+ y = +y;
+ var a = 0, b = +0;
+ a = x + y;
+ b = y * x;
+ a = c(1 + a);
+ b = c(2 + b);
+ a = c(3 + a);
+ b = c(4 + b);
+ a = c(5 + a);
+ b = c(6 + b);
+}
+
+function vars3(x, y) {
+ x = x | 0;
+ y = +y;
+ var a = 0, b = +0;
+ a = x + y;
+ b = y * x;
+ a = c(1 + a);
+ a = c(2 + b);
+ a = c(3 + a);
+ a = c(4 + b);
+ a = c(5 + a);
+ a = c(6 + b);
+ a = c(7 + a);
+}
+
+function vars4(x, y) {
+ x = x | 0;
+ y = +y;
+ var a = 0, b = +0;
+ a = x + y;
+ b = y * x;
+ a = c(1 + a);
+ a = c(2 + a);
+ a = c(3 + a);
+ a = c(4 + a);
+ a = c(5 + a);
+ a = c(6 + a);
+ b = c(7 + a + x);
+}
+
+function vars_w_stack(x, y) {
+ x = x | 0;
+ y = +y;
+ var a = 0, b = +0, sp = 0;
+ sp = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ a = x + y;
+ b = y * x;
+ a = c(1 + a);
+ a = c(2 + a);
+ a = c(3 + a);
+ a = c(4 + a);
+ a = c(5 + a);
+ a = c(6 + a);
+ b = c(7 + a);
+ STACKTOP = sp;
+}
+
+function stack_returns_a() {
+ var sp = 0;
+ sp = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ if (1) {
+  STACKTOP = sp;
+  return;
+ }
+ stack_returns_a$2();
+ STACKTOP = sp;
+}
+
+function stack_returns_b() {
+ if (1) {
+  return;
+ }
+ stack_returns_b$2();
+}
+
+function stack_returns_c() {
+ var oc$ = 0, of$ = 0;
+ of$ = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ {
+  oc$ = stack_returns_c$0(of$ | 0) | 0;
+  if ((oc$ | 0) == 1) {
+   STACKTOP = of$;
+   return HEAP32[of$ >> 2] | 0;
+  }
+ }
+ stack_returns_c$1();
+ stack_returns_c$2();
+ STACKTOP = of$;
+ return 12;
+}
+
+function chain() {
+ if (x == 1) {
+  print(1);
+ } else chain$5();
+}
+
+function switchh() {
+ switch (x) {
+ case 0:
+  {
+   f(0);
+   g();
+   break;
+  }
+ case 1:
+  {
+   f(1);
+   g();
+   return;
+  }
+ case 2:
+  {
+   f(2);
+   g();
+   break;
+  }
+ case 21:
+ case 22:
+ case 23:
+ case 24:
+ case 25:
+ case 26:
+ case 27:
+ case 28:
+ case 29:
+ case 3:
+  {
+   f(3);
+   g();
+   break;
+  }
+ case 4:
+  switchh$0();
+ case 5:
+  switchh$1();
+ case 6:
+  switchh$2();
+ default:
+  {
+   print(9);
+  }
+ }
+}
+
+function switchh2() {
+ while (1) switch (x) {
+ case 0:
+  f(0);
+  g();
+  break;
+ case 1:
+  f(1);
+  g();
+  return;
+ case 2:
+  f(2);
+  g();
+  break;
+ case 21:
+ case 22:
+ case 23:
+ case 24:
+ case 25:
+ case 26:
+ case 27:
+ case 28:
+ case 29:
+ case 3:
+  f(3);
+  g();
+  break;
+ case 4:
+  f(4);
+  g();
+ case 5:
+  f(5);
+  g();
+ case 6:
+  f(6);
+  g();
+ default:
+  print(9);
+ }
+}
+
+function stackSet(x1, x2, x3, x4, x5) {
+ x1 = x1 | 0;
+ x2 = x2 | 0;
+ x3 = x3 | 0;
+ x4 = x4 | 0;
+ x5 = x5 | 0;
+ var sp = 0;
+ sp = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ stackSet$0();
+ stackSet$1();
+ stackSet$2();
+ stackSet$3();
+ stackSet$4();
+ c(13);
+}
+
+function linf(d) {
+ d = +d;
+ while (1) {
+  linf$0();
+  linf$1();
+  linf$2();
+  linf$3();
+  return +d;
+ }
+ return +d;
+}
+
+function leaveLabelsMagic() {
+ var label = 0;
+ if (x) {
+  leaveLabelsMagic$0();
+  leaveLabelsMagic$1();
+  leaveLabelsMagic$2();
+  label = 1;
+ } else if (y) {
+  leaveLabelsMagic$3();
+  leaveLabelsMagic$4();
+  leaveLabelsMagic$5();
+ }
+ if ((label | 0) == 1) print(1);
+}
+
+function lin$0() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function lin$1() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function lin$2() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function lin$3() {
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+}
+
+function lin2$0() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function lin2$1() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function lin2$2() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function lin2$3() {
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+}
+
+function lin3$0(os$) {
+ os$ = os$ | 0;
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+ {
+  HEAP32[os$ >> 2] = 10;
+  return 1;
+ }
+ return 0;
+}
+
+function lin3$1() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function lin3$2() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function lin3$3() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function lin4$0() {
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+ {
+  return 1;
+ }
+ return 0;
+}
+
+function lin4$1() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function lin4$2() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function lin4$3() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function lin5$0() {
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+ {
+  return 1;
+ }
+ return 0;
+}
+
+function lin5$1() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function lin5$2() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function lin5$3() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function mix$0() {
+ c(13);
+ c(14);
+ c(15);
+ c(16);
+ c(17);
+ {
+  return 1;
+ }
+ return 0;
+}
+
+function mix$1() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function mix$2() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function mix$3() {
+ mix$1();
+ mix$2();
+ c(11);
+ c(12);
+}
+
+function vars$0(a, b) {
+ a = a | 0;
+ b = +b;
+ c(2 + b);
+ c(3 + a);
+ c(4 + b);
+}
+
+function vars$1(a, b) {
+ a = a | 0;
+ b = +b;
+ c(5 + a);
+ c(6 + b);
+ c(7 + a);
+}
+
+function stack_returns_a$0() {
+ a = c(1 + a);
+ a = c(2 + a);
+ a = c(3 + a);
+}
+
+function stack_returns_a$1() {
+ a = c(4 + a);
+ a = c(5 + a);
+ a = c(6 + a);
+}
+
+function stack_returns_a$2() {
+ a = x + y;
+ b = y * x;
+ stack_returns_a$0();
+ stack_returns_a$1();
+ b = c(7 + a);
+}
+
+function stack_returns_b$0() {
+ a = c(1 + a);
+ a = c(2 + a);
+ a = c(3 + a);
+}
+
+function stack_returns_b$1() {
+ a = c(4 + a);
+ a = c(5 + a);
+ a = c(6 + a);
+}
+
+function stack_returns_b$2() {
+ a = x + y;
+ b = y * x;
+ stack_returns_b$0();
+ stack_returns_b$1();
+ b = c(7 + a);
+}
+
+function stack_returns_c$0(os$) {
+ os$ = os$ | 0;
+ if (1) {
+  {
+   HEAP32[os$ >> 2] = 21;
+   return 1;
+  }
+ }
+ a = x + y;
+ b = y * x;
+ a = c(1 + a);
+ return 0;
+}
+
+function stack_returns_c$1() {
+ a = c(2 + a);
+ a = c(3 + a);
+ a = c(4 + a);
+}
+
+function stack_returns_c$2() {
+ a = c(5 + a);
+ a = c(6 + a);
+ b = c(7 + a);
+}
+
+function chain$0() {
+ if (x == 12) {
+  print(12);
+ } else {
+  print(99);
+ }
+}
+
+function chain$1() {
+ if (x == 10) {
+  print(10);
+ } else if (x == 11) {
+  print(11);
+ } else chain$0();
+}
+
+function chain$2() {
+ if (x == 8) {
+  print(8);
+ } else if (x == 9) {
+  print(9);
+ } else chain$1();
+}
+
+function chain$3() {
+ if (x == 6) {
+  print(6);
+ } else if (x == 7) {
+  print(7);
+ } else chain$2();
+}
+
+function chain$4() {
+ if (x == 4) {
+  print(4);
+ } else if (x == 5) {
+  print(5);
+ } else chain$3();
+}
+
+function chain$5() {
+ if (x == 2) {
+  print(2);
+ } else if (x == 3) {
+  print(3);
+ } else chain$4();
+}
+
+function switchh$0() {
+ {
+  f(4);
+  g();
+ }
+}
+
+function switchh$1() {
+ {
+  f(5);
+  g();
+ }
+}
+
+function switchh$2() {
+ {
+  f(6);
+  g();
+ }
+}
+
+function stackSet$0() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function stackSet$1() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function stackSet$2() {
+ c(11);
+ c(12);
+ c(13);
+ c(1);
+ c(2);
+}
+
+function stackSet$3() {
+ c(3);
+ c(4);
+ c(5);
+ c(6);
+ c(7);
+}
+
+function stackSet$4() {
+ c(8);
+ c(9);
+ c(10);
+ c(11);
+ c(12);
+}
+
+function linf$0() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function linf$1() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function linf$2() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function linf$3() {
+ c(16);
+ c(17);
+ c(18);
+ c(19);
+ c(20);
+}
+
+function leaveLabelsMagic$0() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function leaveLabelsMagic$1() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function leaveLabelsMagic$2() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
+function leaveLabelsMagic$3() {
+ c(1);
+ c(2);
+ c(3);
+ c(4);
+ c(5);
+}
+
+function leaveLabelsMagic$4() {
+ c(6);
+ c(7);
+ c(8);
+ c(9);
+ c(10);
+}
+
+function leaveLabelsMagic$5() {
+ c(11);
+ c(12);
+ c(13);
+ c(14);
+ c(15);
+}
+
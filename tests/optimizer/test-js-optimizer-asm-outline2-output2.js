@@ -0,0 +1,772 @@
+function linear() {
+ linear$2();
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+}
+
+function _free($mem) {
+ $mem = $mem | 0;
+ var $3 = 0, $4 = 0, $5 = 0, $10 = 0, $11 = 0, $14 = 0, $15 = 0, $16 = 0, $21 = 0, $_sum233 = 0, $24 = 0, $25 = 0, $26 = 0, $_pre_phi307 = 0, $RP_0 = 0, $R_0 = 0, $R_1 = 0, $151 = 0, $164 = 0, $psize_0 = 0, $p_0 = 0, $189 = 0, $193 = 0, $194 = 0, $204 = 0, $220 = 0, $227 = 0, $_pre_phi305 = 0, $RP9_0 = 0, $R7_0 = 0, $R7_1 = 0, $psize_1 = 0, $_pre_phi = 0, $F16_0 = 0, $I18_0 = 0, $472 = 0, $sp_0_in_i = 0, label = 0, sp = 0, oc$ = 0;
+ sp = STACKTOP;
+ STACKTOP = STACKTOP + 64 | 0;
+ if (($mem | 0) == 0) {
+  {
+   STACKTOP = sp;
+   return;
+  }
+ }
+ $3 = $mem - 8 | 0;
+ $4 = $3;
+ $5 = HEAP32[24] | 0;
+ if ($3 >>> 0 < $5 >>> 0) {
+  _abort();
+ }
+ $10 = HEAP32[$mem - 4 >> 2] | 0;
+ $11 = $10 & 3;
+ if (($11 | 0) == 1) {
+  _abort();
+ }
+ $14 = $10 & -8;
+ $15 = $mem + ($14 - 8) | 0;
+ $16 = $15;
+ L621 : do {
+  if (($10 & 1 | 0) == 0) {
+   $21 = HEAP32[$3 >> 2] | 0;
+   if (($11 | 0) == 0) {
+    {
+     STACKTOP = sp;
+     return;
+    }
+   }
+   $_sum233 = -8 - $21 | 0;
+   $24 = $mem + $_sum233 | 0;
+   {
+    oc$ = _free$1($mem | 0, $5 | 0, $14 | 0, $15 | 0, $21 | 0, $_sum233 | 0, $24 | 0, $25 | 0, $26 | 0, $_pre_phi307 | 0, $RP_0 | 0, $R_0 | 0, $R_1 | 0, $151 | 0, $psize_0 | 0, $p_0 | 0, sp | 0) | 0;
+    $25 = HEAP32[sp + 8 >> 2] | 0;
+    $26 = HEAP32[sp + 16 >> 2] | 0;
+    $R_1 = HEAP32[sp + 24 >> 2] | 0;
+    $151 = HEAP32[sp + 32 >> 2] | 0;
+    $psize_0 = HEAP32[sp + 40 >> 2] | 0;
+    $p_0 = HEAP32[sp + 48 >> 2] | 0;
+    if ((oc$ | 0) == 1) break;
+    if ((oc$ | 0) == 2) {
+     STACKTOP = sp;
+     return;
+    }
+    if ((oc$ | 0) == 3) break L621;
+   }
+   do {
+    if (($151 | 0) != 0) {
+     if ($151 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     } else {
+      HEAP32[$R_1 + 16 >> 2] = $151;
+      HEAP32[$151 + 24 >> 2] = $R_1;
+      break;
+     }
+    }
+   } while (0);
+   $164 = HEAP32[$mem + ($_sum233 + 20) >> 2] | 0;
+   if (($164 | 0) == 0) {
+    $p_0 = $25;
+    $psize_0 = $26;
+    break;
+   }
+   if ($164 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+    _abort();
+   } else {
+    HEAP32[$R_1 + 20 >> 2] = $164;
+    HEAP32[$164 + 24 >> 2] = $R_1;
+    $p_0 = $25;
+    $psize_0 = $26;
+    break;
+   }
+  } else {
+   $p_0 = $4;
+   $psize_0 = $14;
+  }
+ } while (0);
+ $189 = $p_0;
+ if ($189 >>> 0 >= $15 >>> 0) {
+  _abort();
+ }
+ $193 = $mem + ($14 - 4) | 0;
+ $194 = HEAP32[$193 >> 2] | 0;
+ if (($194 & 1 | 0) == 0) {
+  _abort();
+ }
+ do {
+  if (($194 & 2 | 0) == 0) {
+   if (($16 | 0) == (HEAP32[26] | 0)) {
+    $204 = (HEAP32[23] | 0) + $psize_0 | 0;
+    HEAP32[23] = $204;
+    HEAP32[26] = $p_0;
+    HEAP32[$p_0 + 4 >> 2] = $204 | 1;
+    if (($p_0 | 0) == (HEAP32[25] | 0)) {
+     HEAP32[25] = 0;
+     HEAP32[22] = 0;
+    }
+    if ($204 >>> 0 <= (HEAP32[27] | 0) >>> 0) {
+     {
+      STACKTOP = sp;
+      return;
+     }
+    }
+    _sys_trim(0) | 0;
+    {
+     STACKTOP = sp;
+     return;
+    }
+   }
+   if (($16 | 0) == (HEAP32[25] | 0)) {
+    $220 = (HEAP32[22] | 0) + $psize_0 | 0;
+    HEAP32[22] = $220;
+    HEAP32[25] = $p_0;
+    HEAP32[$p_0 + 4 >> 2] = $220 | 1;
+    HEAP32[$189 + $220 >> 2] = $220;
+    {
+     STACKTOP = sp;
+     return;
+    }
+   }
+   $227 = ($194 & -8) + $psize_0 | 0;
+   _free$0($mem | 0, $14 | 0, $15 | 0, $16 | 0, $p_0 | 0, $189 | 0, $194 | 0, $227 | 0, $_pre_phi305 | 0, $RP9_0 | 0, $R7_0 | 0, $R7_1 | 0);
+   if (($p_0 | 0) != (HEAP32[25] | 0)) {
+    $psize_1 = $227;
+    break;
+   }
+   HEAP32[22] = $227;
+   {
+    STACKTOP = sp;
+    return;
+   }
+  } else {
+   HEAP32[$193 >> 2] = $194 & -2;
+   HEAP32[$p_0 + 4 >> 2] = $psize_0 | 1;
+   HEAP32[$189 + $psize_0 >> 2] = $psize_0;
+   $psize_1 = $psize_0;
+  }
+ } while (0);
+ {
+  oc$ = _free$2($p_0 | 0, $psize_1 | 0, $_pre_phi | 0, $F16_0 | 0, $I18_0 | 0, $472 | 0, $sp_0_in_i | 0, label | 0) | 0;
+  if ((oc$ | 0) == 1) {
+   STACKTOP = sp;
+   return;
+  }
+ }
+ STACKTOP = sp;
+}
+
+function linear$0() {
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+}
+
+function linear$1() {
+ linear$0();
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+}
+
+function linear$2() {
+ linear$1();
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+ cheez(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0);
+}
+
+function _free$0($mem, $14, $15, $16, $p_0, $189, $194, $227, $_pre_phi305, $RP9_0, $R7_0, $R7_1) {
+ $mem = $mem | 0;
+ $14 = $14 | 0;
+ $15 = $15 | 0;
+ $16 = $16 | 0;
+ $p_0 = $p_0 | 0;
+ $189 = $189 | 0;
+ $194 = $194 | 0;
+ $227 = $227 | 0;
+ $_pre_phi305 = $_pre_phi305 | 0;
+ $RP9_0 = $RP9_0 | 0;
+ $R7_0 = $R7_0 | 0;
+ $R7_1 = $R7_1 | 0;
+ var $228 = 0, $233 = 0, $236 = 0, $239 = 0, $262 = 0, $267 = 0, $270 = 0, $273 = 0, $278 = 0, $283 = 0, $287 = 0, $293 = 0, $294 = 0, $298 = 0, $299 = 0, $301 = 0, $302 = 0, $305 = 0, $306 = 0, $318 = 0, $320 = 0, $334 = 0, $351 = 0, $364 = 0;
+ $228 = $194 >>> 3;
+ L726 : do {
+  if ($194 >>> 0 < 256) {
+   $233 = HEAP32[$mem + $14 >> 2] | 0;
+   $236 = HEAP32[$mem + ($14 | 4) >> 2] | 0;
+   $239 = 120 + ($228 << 1 << 2) | 0;
+   do {
+    if (($233 | 0) != ($239 | 0)) {
+     if ($233 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     }
+     if ((HEAP32[$233 + 12 >> 2] | 0) == ($16 | 0)) {
+      break;
+     }
+     _abort();
+    }
+   } while (0);
+   if (($236 | 0) == ($233 | 0)) {
+    HEAP32[20] = HEAP32[20] & (1 << $228 ^ -1);
+    break;
+   }
+   do {
+    if (($236 | 0) == ($239 | 0)) {
+     $_pre_phi305 = $236 + 8 | 0;
+    } else {
+     if ($236 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     }
+     $262 = $236 + 8 | 0;
+     if ((HEAP32[$262 >> 2] | 0) == ($16 | 0)) {
+      $_pre_phi305 = $262;
+      break;
+     }
+     _abort();
+    }
+   } while (0);
+   HEAP32[$233 + 12 >> 2] = $236;
+   HEAP32[$_pre_phi305 >> 2] = $233;
+  } else {
+   $267 = $15;
+   $270 = HEAP32[$mem + ($14 + 16) >> 2] | 0;
+   $273 = HEAP32[$mem + ($14 | 4) >> 2] | 0;
+   do {
+    if (($273 | 0) == ($267 | 0)) {
+     $293 = $mem + ($14 + 12) | 0;
+     $294 = HEAP32[$293 >> 2] | 0;
+     if (($294 | 0) == 0) {
+      $298 = $mem + ($14 + 8) | 0;
+      $299 = HEAP32[$298 >> 2] | 0;
+      if (($299 | 0) == 0) {
+       $R7_1 = 0;
+       break;
+      } else {
+       $R7_0 = $299;
+       $RP9_0 = $298;
+      }
+     } else {
+      $R7_0 = $294;
+      $RP9_0 = $293;
+     }
+     while (1) {
+      $301 = $R7_0 + 20 | 0;
+      $302 = HEAP32[$301 >> 2] | 0;
+      if (($302 | 0) != 0) {
+       $R7_0 = $302;
+       $RP9_0 = $301;
+       continue;
+      }
+      $305 = $R7_0 + 16 | 0;
+      $306 = HEAP32[$305 >> 2] | 0;
+      if (($306 | 0) == 0) {
+       break;
+      } else {
+       $R7_0 = $306;
+       $RP9_0 = $305;
+      }
+     }
+     if ($RP9_0 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     } else {
+      HEAP32[$RP9_0 >> 2] = 0;
+      $R7_1 = $R7_0;
+      break;
+     }
+    } else {
+     $278 = HEAP32[$mem + $14 >> 2] | 0;
+     if ($278 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     }
+     $283 = $278 + 12 | 0;
+     if ((HEAP32[$283 >> 2] | 0) != ($267 | 0)) {
+      _abort();
+     }
+     $287 = $273 + 8 | 0;
+     if ((HEAP32[$287 >> 2] | 0) == ($267 | 0)) {
+      HEAP32[$283 >> 2] = $273;
+      HEAP32[$287 >> 2] = $278;
+      $R7_1 = $273;
+      break;
+     } else {
+      _abort();
+     }
+    }
+   } while (0);
+   if (($270 | 0) == 0) {
+    break;
+   }
+   $318 = $mem + ($14 + 20) | 0;
+   $320 = 384 + (HEAP32[$318 >> 2] << 2) | 0;
+   do {
+    if (($267 | 0) == (HEAP32[$320 >> 2] | 0)) {
+     HEAP32[$320 >> 2] = $R7_1;
+     if (($R7_1 | 0) != 0) {
+      break;
+     }
+     HEAP32[21] = HEAP32[21] & (1 << HEAP32[$318 >> 2] ^ -1);
+     break L726;
+    } else {
+     if ($270 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     }
+     $334 = $270 + 16 | 0;
+     if ((HEAP32[$334 >> 2] | 0) == ($267 | 0)) {
+      HEAP32[$334 >> 2] = $R7_1;
+     } else {
+      HEAP32[$270 + 20 >> 2] = $R7_1;
+     }
+     if (($R7_1 | 0) == 0) {
+      break L726;
+     }
+    }
+   } while (0);
+   if ($R7_1 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+    _abort();
+   }
+   HEAP32[$R7_1 + 24 >> 2] = $270;
+   $351 = HEAP32[$mem + ($14 + 8) >> 2] | 0;
+   do {
+    if (($351 | 0) != 0) {
+     if ($351 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+      _abort();
+     } else {
+      HEAP32[$R7_1 + 16 >> 2] = $351;
+      HEAP32[$351 + 24 >> 2] = $R7_1;
+      break;
+     }
+    }
+   } while (0);
+   $364 = HEAP32[$mem + ($14 + 12) >> 2] | 0;
+   if (($364 | 0) == 0) {
+    break;
+   }
+   if ($364 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+    _abort();
+   } else {
+    HEAP32[$R7_1 + 20 >> 2] = $364;
+    HEAP32[$364 + 24 >> 2] = $R7_1;
+    break;
+   }
+  }
+ } while (0);
+ HEAP32[$p_0 + 4 >> 2] = $227 | 1;
+ HEAP32[$189 + $227 >> 2] = $227;
+}
+
+function _free$1($mem, $5, $14, $15, $21, $_sum233, $24, $25, $26, $_pre_phi307, $RP_0, $R_0, $R_1, $151, $psize_0, $p_0, os$) {
+ $mem = $mem | 0;
+ $5 = $5 | 0;
+ $14 = $14 | 0;
+ $15 = $15 | 0;
+ $21 = $21 | 0;
+ $_sum233 = $_sum233 | 0;
+ $24 = $24 | 0;
+ $25 = $25 | 0;
+ $26 = $26 | 0;
+ $_pre_phi307 = $_pre_phi307 | 0;
+ $RP_0 = $RP_0 | 0;
+ $R_0 = $R_0 | 0;
+ $R_1 = $R_1 | 0;
+ $151 = $151 | 0;
+ $psize_0 = $psize_0 | 0;
+ $p_0 = $p_0 | 0;
+ os$ = os$ | 0;
+ var $32 = 0, $37 = 0, $40 = 0, $43 = 0, $64 = 0, $69 = 0, $72 = 0, $75 = 0, $80 = 0, $84 = 0, $88 = 0, $94 = 0, $95 = 0, $99 = 0, $100 = 0, $102 = 0, $103 = 0, $106 = 0, $107 = 0, $118 = 0, $120 = 0, $134 = 0, $177 = 0;
+ $25 = $24;
+ $26 = $21 + $14 | 0;
+ if ($24 >>> 0 < $5 >>> 0) {
+  _abort();
+ }
+ if (($25 | 0) == (HEAP32[25] | 0)) {
+  $177 = $mem + ($14 - 4) | 0;
+  if ((HEAP32[$177 >> 2] & 3 | 0) != 3) {
+   $p_0 = $25;
+   $psize_0 = $26;
+   {
+    HEAP32[os$ + 8 >> 2] = $25;
+    HEAP32[os$ + 16 >> 2] = $26;
+    HEAP32[os$ + 24 >> 2] = $R_1;
+    HEAP32[os$ + 32 >> 2] = $151;
+    HEAP32[os$ + 40 >> 2] = $psize_0;
+    HEAP32[os$ + 48 >> 2] = $p_0;
+    return 1;
+   }
+  }
+  HEAP32[22] = $26;
+  HEAP32[$177 >> 2] = HEAP32[$177 >> 2] & -2;
+  HEAP32[$mem + ($_sum233 + 4) >> 2] = $26 | 1;
+  HEAP32[$15 >> 2] = $26;
+  {
+   return 2;
+  }
+ }
+ $32 = $21 >>> 3;
+ if ($21 >>> 0 < 256) {
+  $37 = HEAP32[$mem + ($_sum233 + 8) >> 2] | 0;
+  $40 = HEAP32[$mem + ($_sum233 + 12) >> 2] | 0;
+  $43 = 120 + ($32 << 1 << 2) | 0;
+  do {
+   if (($37 | 0) != ($43 | 0)) {
+    if ($37 >>> 0 < $5 >>> 0) {
+     _abort();
+    }
+    if ((HEAP32[$37 + 12 >> 2] | 0) == ($25 | 0)) {
+     break;
+    }
+    _abort();
+   }
+  } while (0);
+  if (($40 | 0) == ($37 | 0)) {
+   HEAP32[20] = HEAP32[20] & (1 << $32 ^ -1);
+   $p_0 = $25;
+   $psize_0 = $26;
+   {
+    HEAP32[os$ + 8 >> 2] = $25;
+    HEAP32[os$ + 16 >> 2] = $26;
+    HEAP32[os$ + 24 >> 2] = $R_1;
+    HEAP32[os$ + 32 >> 2] = $151;
+    HEAP32[os$ + 40 >> 2] = $psize_0;
+    HEAP32[os$ + 48 >> 2] = $p_0;
+    return 1;
+   }
+  }
+  do {
+   if (($40 | 0) == ($43 | 0)) {
+    $_pre_phi307 = $40 + 8 | 0;
+   } else {
+    if ($40 >>> 0 < $5 >>> 0) {
+     _abort();
+    }
+    $64 = $40 + 8 | 0;
+    if ((HEAP32[$64 >> 2] | 0) == ($25 | 0)) {
+     $_pre_phi307 = $64;
+     break;
+    }
+    _abort();
+   }
+  } while (0);
+  HEAP32[$37 + 12 >> 2] = $40;
+  HEAP32[$_pre_phi307 >> 2] = $37;
+  $p_0 = $25;
+  $psize_0 = $26;
+  {
+   HEAP32[os$ + 8 >> 2] = $25;
+   HEAP32[os$ + 16 >> 2] = $26;
+   HEAP32[os$ + 24 >> 2] = $R_1;
+   HEAP32[os$ + 32 >> 2] = $151;
+   HEAP32[os$ + 40 >> 2] = $psize_0;
+   HEAP32[os$ + 48 >> 2] = $p_0;
+   return 1;
+  }
+ }
+ $69 = $24;
+ $72 = HEAP32[$mem + ($_sum233 + 24) >> 2] | 0;
+ $75 = HEAP32[$mem + ($_sum233 + 12) >> 2] | 0;
+ do {
+  if (($75 | 0) == ($69 | 0)) {
+   $94 = $mem + ($_sum233 + 20) | 0;
+   $95 = HEAP32[$94 >> 2] | 0;
+   if (($95 | 0) == 0) {
+    $99 = $mem + ($_sum233 + 16) | 0;
+    $100 = HEAP32[$99 >> 2] | 0;
+    if (($100 | 0) == 0) {
+     $R_1 = 0;
+     break;
+    } else {
+     $R_0 = $100;
+     $RP_0 = $99;
+    }
+   } else {
+    $R_0 = $95;
+    $RP_0 = $94;
+   }
+   while (1) {
+    $102 = $R_0 + 20 | 0;
+    $103 = HEAP32[$102 >> 2] | 0;
+    if (($103 | 0) != 0) {
+     $R_0 = $103;
+     $RP_0 = $102;
+     continue;
+    }
+    $106 = $R_0 + 16 | 0;
+    $107 = HEAP32[$106 >> 2] | 0;
+    if (($107 | 0) == 0) {
+     break;
+    } else {
+     $R_0 = $107;
+     $RP_0 = $106;
+    }
+   }
+   if ($RP_0 >>> 0 < $5 >>> 0) {
+    _abort();
+   } else {
+    HEAP32[$RP_0 >> 2] = 0;
+    $R_1 = $R_0;
+    break;
+   }
+  } else {
+   $80 = HEAP32[$mem + ($_sum233 + 8) >> 2] | 0;
+   if ($80 >>> 0 < $5 >>> 0) {
+    _abort();
+   }
+   $84 = $80 + 12 | 0;
+   if ((HEAP32[$84 >> 2] | 0) != ($69 | 0)) {
+    _abort();
+   }
+   $88 = $75 + 8 | 0;
+   if ((HEAP32[$88 >> 2] | 0) == ($69 | 0)) {
+    HEAP32[$84 >> 2] = $75;
+    HEAP32[$88 >> 2] = $80;
+    $R_1 = $75;
+    break;
+   } else {
+    _abort();
+   }
+  }
+ } while (0);
+ if (($72 | 0) == 0) {
+  $p_0 = $25;
+  $psize_0 = $26;
+  {
+   HEAP32[os$ + 8 >> 2] = $25;
+   HEAP32[os$ + 16 >> 2] = $26;
+   HEAP32[os$ + 24 >> 2] = $R_1;
+   HEAP32[os$ + 32 >> 2] = $151;
+   HEAP32[os$ + 40 >> 2] = $psize_0;
+   HEAP32[os$ + 48 >> 2] = $p_0;
+   return 1;
+  }
+ }
+ $118 = $mem + ($_sum233 + 28) | 0;
+ $120 = 384 + (HEAP32[$118 >> 2] << 2) | 0;
+ do {
+  if (($69 | 0) == (HEAP32[$120 >> 2] | 0)) {
+   HEAP32[$120 >> 2] = $R_1;
+   if (($R_1 | 0) != 0) {
+    break;
+   }
+   HEAP32[21] = HEAP32[21] & (1 << HEAP32[$118 >> 2] ^ -1);
+   $p_0 = $25;
+   $psize_0 = $26;
+   {
+    HEAP32[os$ + 8 >> 2] = $25;
+    HEAP32[os$ + 16 >> 2] = $26;
+    HEAP32[os$ + 24 >> 2] = $R_1;
+    HEAP32[os$ + 32 >> 2] = $151;
+    HEAP32[os$ + 40 >> 2] = $psize_0;
+    HEAP32[os$ + 48 >> 2] = $p_0;
+    return 3;
+   }
+  } else {
+   if ($72 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+    _abort();
+   }
+   $134 = $72 + 16 | 0;
+   if ((HEAP32[$134 >> 2] | 0) == ($69 | 0)) {
+    HEAP32[$134 >> 2] = $R_1;
+   } else {
+    HEAP32[$72 + 20 >> 2] = $R_1;
+   }
+   if (($R_1 | 0) == 0) {
+    $p_0 = $25;
+    $psize_0 = $26;
+    {
+     HEAP32[os$ + 8 >> 2] = $25;
+     HEAP32[os$ + 16 >> 2] = $26;
+     HEAP32[os$ + 24 >> 2] = $R_1;
+     HEAP32[os$ + 32 >> 2] = $151;
+     HEAP32[os$ + 40 >> 2] = $psize_0;
+     HEAP32[os$ + 48 >> 2] = $p_0;
+     return 3;
+    }
+   }
+  }
+ } while (0);
+ if ($R_1 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+  _abort();
+ }
+ HEAP32[$R_1 + 24 >> 2] = $72;
+ $151 = HEAP32[$mem + ($_sum233 + 16) >> 2] | 0;
+ HEAP32[os$ + 8 >> 2] = $25;
+ HEAP32[os$ + 16 >> 2] = $26;
+ HEAP32[os$ + 24 >> 2] = $R_1;
+ HEAP32[os$ + 32 >> 2] = $151;
+ HEAP32[os$ + 40 >> 2] = $psize_0;
+ HEAP32[os$ + 48 >> 2] = $p_0;
+ return 0;
+}
+
+function _free$2($p_0, $psize_1, $_pre_phi, $F16_0, $I18_0, $472, $sp_0_in_i, label) {
+ $p_0 = $p_0 | 0;
+ $psize_1 = $psize_1 | 0;
+ $_pre_phi = $_pre_phi | 0;
+ $F16_0 = $F16_0 | 0;
+ $I18_0 = $I18_0 | 0;
+ $472 = $472 | 0;
+ $sp_0_in_i = $sp_0_in_i | 0;
+ label = label | 0;
+ var $390 = 0, $393 = 0, $395 = 0, $396 = 0, $397 = 0, $403 = 0, $404 = 0, $414 = 0, $415 = 0, $422 = 0, $423 = 0, $426 = 0, $428 = 0, $431 = 0, $436 = 0, $443 = 0, $447 = 0, $448 = 0, $463 = 0, $T_0 = 0, $K19_0 = 0, $473 = 0, $486 = 0, $487 = 0, $489 = 0, $501 = 0, $sp_0_i = 0;
+ $390 = $psize_1 >>> 3;
+ if ($psize_1 >>> 0 < 256) {
+  $393 = $390 << 1;
+  $395 = 120 + ($393 << 2) | 0;
+  $396 = HEAP32[20] | 0;
+  $397 = 1 << $390;
+  do {
+   if (($396 & $397 | 0) == 0) {
+    HEAP32[20] = $396 | $397;
+    $F16_0 = $395;
+    $_pre_phi = 120 + ($393 + 2 << 2) | 0;
+   } else {
+    $403 = 120 + ($393 + 2 << 2) | 0;
+    $404 = HEAP32[$403 >> 2] | 0;
+    if ($404 >>> 0 >= (HEAP32[24] | 0) >>> 0) {
+     $F16_0 = $404;
+     $_pre_phi = $403;
+     break;
+    }
+    _abort();
+   }
+  } while (0);
+  HEAP32[$_pre_phi >> 2] = $p_0;
+  HEAP32[$F16_0 + 12 >> 2] = $p_0;
+  HEAP32[$p_0 + 8 >> 2] = $F16_0;
+  HEAP32[$p_0 + 12 >> 2] = $395;
+  {
+   return 1;
+  }
+ }
+ $414 = $p_0;
+ $415 = $psize_1 >>> 8;
+ do {
+  if (($415 | 0) == 0) {
+   $I18_0 = 0;
+  } else {
+   if ($psize_1 >>> 0 > 16777215) {
+    $I18_0 = 31;
+    break;
+   }
+   $422 = ($415 + 1048320 | 0) >>> 16 & 8;
+   $423 = $415 << $422;
+   $426 = ($423 + 520192 | 0) >>> 16 & 4;
+   $428 = $423 << $426;
+   $431 = ($428 + 245760 | 0) >>> 16 & 2;
+   $436 = 14 - ($426 | $422 | $431) + ($428 << $431 >>> 15) | 0;
+   $I18_0 = $psize_1 >>> (($436 + 7 | 0) >>> 0) & 1 | $436 << 1;
+  }
+ } while (0);
+ $443 = 384 + ($I18_0 << 2) | 0;
+ HEAP32[$p_0 + 28 >> 2] = $I18_0;
+ HEAP32[$p_0 + 20 >> 2] = 0;
+ HEAP32[$p_0 + 16 >> 2] = 0;
+ $447 = HEAP32[21] | 0;
+ $448 = 1 << $I18_0;
+ do {
+  if (($447 & $448 | 0) == 0) {
+   HEAP32[21] = $447 | $448;
+   HEAP32[$443 >> 2] = $414;
+   HEAP32[$p_0 + 24 >> 2] = $443;
+   HEAP32[$p_0 + 12 >> 2] = $p_0;
+   HEAP32[$p_0 + 8 >> 2] = $p_0;
+  } else {
+   if (($I18_0 | 0) == 31) {
+    $463 = 0;
+   } else {
+    $463 = 25 - ($I18_0 >>> 1) | 0;
+   }
+   $K19_0 = $psize_1 << $463;
+   $T_0 = HEAP32[$443 >> 2] | 0;
+   while (1) {
+    if ((HEAP32[$T_0 + 4 >> 2] & -8 | 0) == ($psize_1 | 0)) {
+     break;
+    }
+    $472 = $T_0 + 16 + ($K19_0 >>> 31 << 2) | 0;
+    $473 = HEAP32[$472 >> 2] | 0;
+    if (($473 | 0) == 0) {
+     label = 569;
+     break;
+    } else {
+     $K19_0 = $K19_0 << 1;
+     $T_0 = $473;
+    }
+   }
+   if ((label | 0) == 569) {
+    if ($472 >>> 0 < (HEAP32[24] | 0) >>> 0) {
+     _abort();
+    } else {
+     HEAP32[$472 >> 2] = $414;
+     HEAP32[$p_0 + 24 >> 2] = $T_0;
+     HEAP32[$p_0 + 12 >> 2] = $p_0;
+     HEAP32[$p_0 + 8 >> 2] = $p_0;
+     break;
+    }
+   }
+   $486 = $T_0 + 8 | 0;
+   $487 = HEAP32[$486 >> 2] | 0;
+   $489 = HEAP32[24] | 0;
+   if ($T_0 >>> 0 < $489 >>> 0) {
+    _abort();
+   }
+   if ($487 >>> 0 < $489 >>> 0) {
+    _abort();
+   } else {
+    HEAP32[$487 + 12 >> 2] = $414;
+    HEAP32[$486 >> 2] = $414;
+    HEAP32[$p_0 + 8 >> 2] = $487;
+    HEAP32[$p_0 + 12 >> 2] = $T_0;
+    HEAP32[$p_0 + 24 >> 2] = 0;
+    break;
+   }
+  }
+ } while (0);
+ $501 = (HEAP32[28] | 0) - 1 | 0;
+ HEAP32[28] = $501;
+ if (($501 | 0) == 0) {
+  $sp_0_in_i = 536;
+ } else {
+  {
+   return 1;
+  }
+ }
+ while (1) {
+  $sp_0_i = HEAP32[$sp_0_in_i >> 2] | 0;
+  if (($sp_0_i | 0) == 0) {
+   break;
+  } else {
+   $sp_0_in_i = $sp_0_i + 8 | 0;
+  }
+ }
+ HEAP32[28] = -1;
+ {
+  return 1;
+ }
+ return 0;
+}
+
@@ -0,0 +1,46 @@
+function _memset(ptr, value, num) {
+ ptr = ptr | 0;
+ value = value | 0;
+ num = num | 0;
+ var stop = 0, unaligned = 0, of$ = 0;
+ of$ = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ stop = ptr + num | 0;
+ if ((num | 0) >= 20) {
+  value = value & 255;
+  unaligned = ptr & 3;
+  {
+   _memset$0(ptr | 0, value | 0, stop | 0, unaligned | 0, of$ | 0);
+   ptr = HEAP32[of$ + 8 >> 2] | 0;
+  }
+ }
+ while ((ptr | 0) < (stop | 0)) {
+  HEAP8[ptr] = value;
+  ptr = ptr + 1 | 0;
+ }
+ STACKTOP = of$;
+}
+
+function _memset$0(ptr, value, stop, unaligned, os$) {
+ ptr = ptr | 0;
+ value = value | 0;
+ stop = stop | 0;
+ unaligned = unaligned | 0;
+ os$ = os$ | 0;
+ var value4 = 0, stop4 = 0;
+ value4 = value | value << 8 | value << 16 | value << 24;
+ stop4 = stop & ~3;
+ if (unaligned) {
+  unaligned = ptr + 4 - unaligned | 0;
+  while ((ptr | 0) < (unaligned | 0)) {
+   HEAP8[ptr] = value;
+   ptr = ptr + 1 | 0;
+  }
+ }
+ while ((ptr | 0) < (stop4 | 0)) {
+  HEAP32[ptr >> 2] = value4;
+  ptr = ptr + 4 | 0;
+ }
+ HEAP32[os$ + 8 >> 2] = ptr;
+}
+
@@ -0,0 +1,60 @@
+function ___stdout_write($f, $buf, $len) {
+ $f = $f | 0;
+ $buf = $buf | 0;
+ $len = $len | 0;
+ var sp = 0, sp_a = 0, oc$ = 0;
+ sp = STACKTOP;
+ STACKTOP = STACKTOP + 16 | 0;
+ sp_a = STACKTOP = STACKTOP + 31 & -32;
+ STACKTOP = STACKTOP + 80 | 0;
+ if ((STACKTOP | 0) >= (STACK_MAX | 0)) abort();
+ ___stdout_write$3($f | 0);
+ {
+  oc$ = ___stdout_write$2($f | 0, $buf | 0, $len | 0, sp | 0, sp_a | 0, sp | 0) | 0;
+  if ((oc$ | 0) == 1) return HEAP32[sp >> 2] | 0;
+ }
+ return 0;
+}
+
+function ___stdout_write$0($f, sp_a) {
+ $f = $f | 0;
+ sp_a = sp_a | 0;
+ SAFE_HEAP_STORE(sp_a | 0, SAFE_HEAP_LOAD($f + 60 | 0, 4, 0, 0) | 0 | 0, 4, 0);
+ SAFE_HEAP_STORE(sp_a + 4 | 0, 21505 | 0, 4, 0);
+ SAFE_HEAP_STORE(sp_a + 8 | 0, sp_a + 12 | 0, 4, 0);
+}
+
+function ___stdout_write$1($f, sp_a) {
+ $f = $f | 0;
+ sp_a = sp_a | 0;
+ ___stdout_write$0($f | 0, sp_a | 0);
+ if ((___syscall(54, sp_a | 0) | 0) != 0) {
+  SAFE_HEAP_STORE($f + 75 >> 0 | 0, -1 | 0, 1, 0);
+ }
+}
+
+function ___stdout_write$2($f, $buf, $len, sp, sp_a, os$) {
+ $f = $f | 0;
+ $buf = $buf | 0;
+ $len = $len | 0;
+ sp = sp | 0;
+ sp_a = sp_a | 0;
+ os$ = os$ | 0;
+ var $10 = 0;
+ if (((SAFE_HEAP_LOAD($f | 0, 4, 0, 0) | 0) & 64 | 0) == 0) {
+  ___stdout_write$1($f | 0, sp_a | 0);
+ }
+ $10 = ___stdio_write($f, $buf, $len) | 0;
+ STACKTOP = sp;
+ {
+  HEAP32[os$ >> 2] = $10 | 0;
+  return 1;
+ }
+ return 0;
+}
+
+function ___stdout_write$3($f) {
+ $f = $f | 0;
+ SAFE_HEAP_STORE($f + 36 | 0, 3 | 0, 4, 0);
+}
+
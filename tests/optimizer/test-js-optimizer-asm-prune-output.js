@@ -0,0 +1,47 @@
+function _getA(p) {
+ p = p | 0;
+ return HEAP32[p + 4 >> 2] | 0;
+}
+
+function _getOther(p) {
+ p = p | 0;
+ return HEAP32[p + 8 >> 2] | 0;
+}
+
+function _useA(x) {
+ x = x | 0;
+ var y = 0;
+ y = _getA(x) | 0;
+ return y + 1 | 0;
+}
+
+function _countA(n) {
+ n = n | 0;
+ if (!n) return 0;
+ return (_countA(n - 1 | 0) | 0) + 1 | 0;
+}
+
+function _swapped(a, b) {
+ a = a | 0;
+ b = b | 0;
+ return a - b | 0;
+}
+
+function _ordered(b, a) {
+ b = b | 0;
+ a = a | 0;
+ return a - b | 0;
+}
+
+function _main() {
+ _useA(1) | 0;
+ _useA(2) | 0;
+ _getA(3) | 0;
+ _getOther(4) | 0;
+ _countA(5) | 0;
+ _countA(6) | 0;
+ _swapped(7, 8) | 0;
+ return _ordered(9, 10) | 0;
+}
+
+// EXTRA_INFO:{"equivalentFunctions": [["_countB", "_countA"], ["_getB", "_getA"], ["_getLonger", "_getA"], ["_useB", "_useA"]]}
@@ -0,0 +1,68 @@
+function _getA(p) {
+ p = p | 0;
+ return HEAP32[p + 4 >> 2] | 0;
+}
+function _getB(q) {
+ q = q | 0;
+ return HEAP32[q + 4 >> 2] | 0;
+}
+function _getLonger(r) {
+ r = r | 0;
+ return HEAP32[r + 4 >> 2] | 0;
+}
+function _getOther(p) {
+ p = p | 0;
+ return HEAP32[p + 8 >> 2] | 0;
+}
+function _useA(x) {
+ x = x | 0;
+ var y = 0;
+ y = _getA(x) | 0;
+ return y + 1 | 0;
+}
+function _useB(z) {
+ z = z | 0;
+ var w = 0;
+ w = _getB(z) | 0;
+ return w + 1 | 0;
+}
+function _countA(n) {
+ n = n | 0;
+ if (!n) return 0;
+ return (_countA(n - 1 | 0) | 0) + 1 | 0;
+}
+function _countB(m) {
+ m = m | 0;
+ if (!m) return 0;
+ return (_countB(m - 1 | 0) | 0) + 1 | 0;
+}
+function _swapped(a, b) {
+ a = a | 0;
+ b = b | 0;
+ return a - b | 0;
+}
+function _ordered(b, a) {
+ b = b | 0;
+ a = a | 0;
+ return a - b | 0;
+}
+function _unused(p) {
+ p = p | 0;
+ return _deadCallee(p) | 0;
+}
+function _deadCallee(p) {
+ p = p | 0;
+ return p + 3 | 0;
+}
+function _main() {
+ _useA(1) | 0;
+ _useB(2) | 0;
+ _getLonger(3) | 0;
+ _getOther(4) | 0;
+ _countA(5) | 0;
+ _countB(6) | 0;
+ _swapped(7, 8) | 0;
+ return _ordered(9, 10) | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_getA", "_getB", "_getLonger", "_getOther", "_useA", "_useB", "_countA", "_countB", "_swapped", "_ordered", "_unused", "_deadCallee", "_main"]
+// EXTRA_INFO: { "roots": ["_main"] }
@@ -0,0 +1,20 @@
+// REACHABLE ["_c","_e"]
+function _a(x) {
+ x = x | 0;
+ _b(x) | 0;
+ _c(x) | 0;
+ _b(1) | 0;
+ return FUNCTION_TABLE_ii[x & 3](x) | 0;
+}
+function _b(x) {
+ x = x | 0;
+ return _c(x) | 0;
+}
+function _c(x) {
+ x = x | 0;
+ return x | 0;
+}
+function _d() {
+ _e();
+ FUNCTION_TABLE_v[0 & 1]();
+}
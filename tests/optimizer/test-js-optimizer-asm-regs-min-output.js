@@ -38,4 +38,11 @@ function cl(b) {
  b = b + 4;
  a(b);
 }
+function useCountOrder(c) {
+ c = c | 0;
+ var b = 0;
+ b = a(c) | 0;
+ b = b + (b * b | 0) | 0;
+ return b | 0;
+}
 
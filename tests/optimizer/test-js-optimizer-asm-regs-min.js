@@ -38,5 +38,12 @@ function collideLocal(i1) {
  i1 = i1 + 4; // statement is of similar shape to a param coercion
  aGlobal(i1);
 }
+function useCountOrder(x) {
+ x = x | 0;
+ var y = 0;
+ y = aGlobal(x) | 0;
+ y = y + (y * y | 0) | 0;
+ return y | 0; // y is used more than x, so it gets the shorter name
+}
 // EMSCRIPTEN_GENERATED_FUNCTIONS
 // EXTRA_INFO: { "names": ["a", "b", "c", "d", "e", "f", "g", "h", "i", "i1", "cl"], "globals": { "aGlobal": "a", "bGlobal": "i1", "collideLocal": "cl" } }
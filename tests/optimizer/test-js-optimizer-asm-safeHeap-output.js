@@ -0,0 +1,39 @@
+function _loads(p) {
+ p = p | 0;
+ var x = 0, d = 0;
+ x = SAFE_HEAP_LOAD(p >> 0 | 0, 1, 0) | 0 | 0;
+ x = x + (SAFE_HEAP_LOAD(p + 1 >> 0 | 0, 1, 1) | 0 | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(p + 2 | 0, 2, 0) | 0 | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(p | 0, 2, 1) | 0 | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(p + 4 | 0, 4, 0) | 0 | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(p | 0, 4, 1) | 0 | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(16 * 4 | 0, 4, 0) | 0 | 0) | 0;
+ d = +(+SAFE_HEAP_LOAD_D(p + 8 | 0, 4)) + +(+SAFE_HEAP_LOAD_D(p + 16 | 0, 8));
+ x = x + (SAFE_HEAP_LOAD(SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0, 4, 0) | 0 | 0) | 0;
+ return x + ~~d | 0;
+}
+function _stores(p, v, d) {
+ p = p | 0;
+ v = v | 0;
+ d = +d;
+ SAFE_HEAP_STORE(p >> 0 | 0, v | 0, 1);
+ SAFE_HEAP_STORE(p >> 0 | 0, v | 0, 1);
+ SAFE_HEAP_STORE(p + 2 | 0, v | 0, 2);
+ SAFE_HEAP_STORE(p + 4 | 0, SAFE_HEAP_LOAD(v | 0, 4, 0) | 0 | 0 | 0, 4);
+ SAFE_HEAP_STORE(p | 0, v | 0, 4);
+ SAFE_HEAP_STORE_D(p + 8 | 0, +d, 4);
+ SAFE_HEAP_STORE_D(p + 16 | 0, +d, 8);
+ SAFE_HEAP_STORE(40 * 4 | 0, v | 0, 4);
+ SAFE_HEAP_STORE(p | 0, SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0 + 1 | 0, 4);
+}
+function _tables(p, f) {
+ p = p | 0;
+ f = f | 0;
+ return FUNCTION_TABLE_ii[(SAFE_FT_MASK(f | 0, 7 | 0) | 0) & 7](p) | 0;
+}
+function SAFE_HEAP_LOAD(dest, bytes, unsigned) {
+ dest = dest | 0;
+ bytes = bytes | 0;
+ unsigned = unsigned | 0;
+ return HEAP32[dest >> 2] | 0;
+}
@@ -0,0 +1,54 @@
+function _block(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = SAFE_HEAP_LOAD(p + 8 | 0, 4, 0) | 0 | 0;
+ x = x + (HEAP32[p + 8 >> 2] | 0) | 0;
+ x = x + (HEAP16[p + 10 >> 1] | 0) | 0;
+ x = x + (HEAPU8[p + 11 >> 0] | 0) | 0;
+ x = x + (SAFE_HEAP_LOAD(p + 12 | 0, 4, 0) | 0 | 0) | 0;
+ HEAP32[p + 8 >> 2] = x;
+ SAFE_HEAP_STORE_D(p + 16 | 0, +(+(x | 0)), 8);
+ HEAP32[p + 20 >> 2] = x;
+ SAFE_HEAP_STORE(p + 17 | 0, x | 0, 2);
+ return x | 0;
+}
+
+function _kills(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0;
+ _f() | 0;
+ x = x + (SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0) | 0;
+ p = p + 4 | 0;
+ x = x + (SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0) | 0;
+ SAFE_HEAP_STORE(p | 0, _f() | 0 | 0, 4);
+ SAFE_HEAP_STORE(p | 0, (p = p + 4096 | 0) | 0, 4);
+ x = x + (SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0) | 0;
+ return x | 0;
+}
+
+function _control(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0;
+ if (v) {
+  x = x + (HEAP32[p >> 2] | 0) | 0;
+  SAFE_HEAP_STORE(v | 0, 1 | 0, 4);
+ } else {
+  x = x + (SAFE_HEAP_LOAD(v | 0, 4, 0) | 0 | 0) | 0;
+ }
+ x = x + (SAFE_HEAP_LOAD(v | 0, 4, 0) | 0 | 0) | 0;
+ x = x + (HEAP32[v >> 2] | 0) | 0;
+ while (1) {
+  x = x + (SAFE_HEAP_LOAD(p | 0, 4, 0) | 0 | 0) | 0;
+  x = x + (HEAP32[p >> 2] | 0) | 0;
+  if (x) break;
+ }
+ x = v ? SAFE_HEAP_LOAD(p + 4 | 0, 4, 0) | 0 | 0 : 0;
+ x = x + (SAFE_HEAP_LOAD(p + 4 | 0, 4, 0) | 0 | 0) | 0;
+ return x | 0;
+}
+
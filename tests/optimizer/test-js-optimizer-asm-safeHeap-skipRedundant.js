@@ -0,0 +1,52 @@
+function _block(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = HEAP32[p + 8 >> 2] | 0;
+ x = x + (HEAP32[p + 8 >> 2] | 0) | 0;
+ x = x + (HEAP16[p + 10 >> 1] | 0) | 0;
+ x = x + (HEAPU8[p + 11 >> 0] | 0) | 0;
+ x = x + (HEAP32[p + 12 >> 2] | 0) | 0;
+ HEAP32[p + 8 >> 2] = x;
+ HEAPF64[p + 16 >> 3] = +(x | 0);
+ HEAP32[p + 20 >> 2] = x;
+ HEAP16[p + 17 >> 1] = x;
+ return x | 0;
+}
+function _kills(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = HEAP32[p >> 2] | 0;
+ _f() | 0;
+ x = x + (HEAP32[p >> 2] | 0) | 0;
+ p = p + 4 | 0;
+ x = x + (HEAP32[p >> 2] | 0) | 0;
+ HEAP32[p >> 2] = _f() | 0;
+ HEAP32[p >> 2] = (p = p + 4096 | 0);
+ x = x + (HEAP32[p >> 2] | 0) | 0;
+ return x | 0;
+}
+function _control(p, v) {
+ p = p | 0;
+ v = v | 0;
+ var x = 0;
+ x = HEAP32[p >> 2] | 0;
+ if (v) {
+  x = x + (HEAP32[p >> 2] | 0) | 0;
+  HEAP32[v >> 2] = 1;
+ } else {
+  x = x + (HEAP32[v >> 2] | 0) | 0;
+ }
+ x = x + (HEAP32[v >> 2] | 0) | 0;
+ x = x + (HEAP32[v >> 2] | 0) | 0;
+ while (1) {
+  x = x + (HEAP32[p >> 2] | 0) | 0;
+  x = x + (HEAP32[p >> 2] | 0) | 0;
+  if (x) break;
+ }
+ x = v ? HEAP32[p + 4 >> 2] | 0 : 0;
+ x = x + (HEAP32[p + 4 >> 2] | 0) | 0;
+ return x | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_block", "_kills", "_control"]
@@ -0,0 +1,40 @@
+function _loads(p) {
+ p = p | 0;
+ var x = 0, d = 0.0;
+ x = HEAP8[p >> 0] | 0;
+ x = x + (HEAPU8[p + 1 >> 0] | 0) | 0;
+ x = x + (HEAP16[p + 2 >> 1] | 0) | 0;
+ x = x + (HEAPU16[p >> 1] | 0) | 0;
+ x = x + (HEAP32[p + 4 >> 2] | 0) | 0;
+ x = x + (HEAPU32[p >> 2] | 0) | 0;
+ x = x + (HEAP32[16] | 0) | 0;
+ d = +HEAPF32[p + 8 >> 2] + +HEAPF64[p + 16 >> 3];
+ x = x + (HEAP32[HEAP32[p >> 2] >> 2] | 0) | 0;
+ return x + ~~d | 0;
+}
+function _stores(p, v, d) {
+ p = p | 0;
+ v = v | 0;
+ d = +d;
+ HEAP8[p >> 0] = v;
+ HEAPU8[p >> 0] = v;
+ HEAP16[p + 2 >> 1] = v;
+ HEAP32[p + 4 >> 2] = HEAP32[v >> 2] | 0;
+ HEAPU32[p >> 2] = v;
+ HEAPF32[p + 8 >> 2] = d;
+ HEAPF64[p + 16 >> 3] = d;
+ HEAP32[40] = v;
+ HEAP32[p >> 2] = HEAP32[p >> 2] | 0 + 1;
+}
+function _tables(p, f) {
+ p = p | 0;
+ f = f | 0;
+ return FUNCTION_TABLE_ii[f & 7](p) | 0;
+}
+function SAFE_HEAP_LOAD(dest, bytes, unsigned) {
+ dest = dest | 0;
+ bytes = bytes | 0;
+ unsigned = unsigned | 0;
+ return HEAP32[dest >> 2] | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_loads", "_stores", "_tables", "SAFE_HEAP_LOAD"]
@@ -0,0 +1,58 @@
+function _noParams() {
+ var ssd$ = 0;
+ ssd$ = HEAP32[shadowStack >> 2] | 0;
+ HEAP32[shadowStack + 4 + ((ssd$ & 1023) << 2) >> 2] = 0;
+ HEAP32[shadowStack >> 2] = ssd$ + 1 | 0;
+ HEAP32[4] = 1;
+ HEAP32[shadowStack >> 2] = ssd$;
+}
+
+function _params(x, y) {
+ x = x | 0;
+ y = +y;
+ var z = 0, ssd$ = 0, ssr$0 = 0;
+ ssd$ = HEAP32[shadowStack >> 2] | 0;
+ HEAP32[shadowStack + 4 + ((ssd$ & 1023) << 2) >> 2] = 1;
+ HEAP32[shadowStack >> 2] = ssd$ + 1 | 0;
+ z = x + 1 | 0;
+ if ((z | 0) == 2) {
+  HEAP32[shadowStack >> 2] = ssd$;
+  return 3;
+ }
+ ssr$0 = _other(z) | 0;
+ HEAP32[shadowStack >> 2] = ssd$;
+ return ssr$0 | 0;
+}
+
+function _dbl(x) {
+ x = +x;
+ var ssd$ = 0;
+ ssd$ = HEAP32[shadowStack >> 2] | 0;
+ HEAP32[shadowStack + 4 + ((ssd$ & 1023) << 2) >> 2] = 2;
+ HEAP32[shadowStack >> 2] = ssd$ + 1 | 0;
+ HEAP32[shadowStack >> 2] = ssd$;
+ return +(x * 2);
+}
+
+function _void(x) {
+ x = x | 0;
+ var ssd$ = 0;
+ ssd$ = HEAP32[shadowStack >> 2] | 0;
+ HEAP32[shadowStack + 4 + ((ssd$ & 1023) << 2) >> 2] = 3;
+ HEAP32[shadowStack >> 2] = ssd$ + 1 | 0;
+ if (x) {
+  _noParams();
+  {
+   HEAP32[shadowStack >> 2] = ssd$;
+   return;
+  }
+ }
+ HEAP32[x >> 2] = 1;
+ HEAP32[shadowStack >> 2] = ssd$;
+}
+
+function _unlisted(a) {
+ a = a | 0;
+ return a | 0;
+}
+
@@ -0,0 +1,29 @@
+function _noParams() {
+ HEAP32[4] = 1;
+}
+function _params(x, y) {
+ x = x | 0;
+ y = +y;
+ var z = 0;
+ z = x + 1 | 0;
+ if ((z | 0) == 2) return 3;
+ return _other(z) | 0;
+}
+function _dbl(x) {
+ x = +x;
+ return +(x * 2.0);
+}
+function _void(x) {
+ x = x | 0;
+ if (x) {
+  _noParams();
+  return;
+ }
+ HEAP32[x >> 2] = 1;
+}
+function _unlisted(a) {
+ a = a | 0;
+ return a | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["_noParams", "_params", "_dbl", "_void", "_unlisted"]
+// EXTRA_INFO: { "functionIds": { "_noParams": 0, "_params": 1, "_dbl": 2, "_void": 3 } }
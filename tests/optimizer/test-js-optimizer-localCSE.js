@@ -59,4 +59,13 @@ function ___towcase() {
  gb + gb + gb + gb;
  gb + gb + gb + gb;
 }
-// EMSCRIPTEN_GENERATED_FUNCTIONS: ["skinning", "_i64Subtract", "cubeMD5mesh", "___towcase"]
+function sideEffects(y, p) {
+ y = y | 0;
+ p = p | 0;
+ var x = 0;
+ x = ((_g() | 0) + y | 0) * 3 + (((_g() | 0) + y | 0) * 3) | 0;
+ x = (HEAP32[p >> 2] + y | 0) * 3 + (_g() | 0) + ((HEAP32[p >> 2] + y | 0) * 3) | 0;
+ x = (p + y | 0) * 3 + (p = p + 1 | 0) + ((p + y | 0) * 3) | 0;
+ return x | 0;
+}
+// EMSCRIPTEN_GENERATED_FUNCTIONS: ["skinning", "_i64Subtract", "cubeMD5mesh", "___towcase", "sideEffects"]
@@ -0,0 +1,4 @@
+var a = 'say "hi"';
+var b = "back\\";
+var c = 'say "hi" back\\';
+var d = "it's";
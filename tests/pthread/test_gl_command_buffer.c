@@ -0,0 +1,98 @@
+#include <emscripten/threading.h>
+#include <emscripten/gl_command_buffer.h>
+#include <emscripten/html5.h>
+#include <GLES2/gl2.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_FRAMES 100
+#define CALLS_PER_FRAME 50
+
+int next_call = 0;
+int sum = 0;
+em_gl_command_buffer *buffer;
+
+void count(int call)
+{
+	assert(emscripten_is_main_runtime_thread());
+	// The calls are replayed in the order they were recorded.
+	assert(call == next_call);
+	++next_call;
+}
+
+void add(const int *data, int call)
+{
+	assert(data[0] == call);
+	sum += data[1];
+}
+
+int calls_replayed()
+{
+	return next_call;
+}
+
+void *render_thread(void *arg)
+{
+	for(int frame = 0; frame < NUM_FRAMES; ++frame)
+	{
+		for(int i = 0; i < CALLS_PER_FRAME; ++i)
+		{
+			int call = frame * CALLS_PER_FRAME + i;
+			emscripten_gl_command_buffer_record(buffer, EM_FUNC_SIG_VI, count, call);
+			int data[2] = { call, 1 };
+			void *copy = emscripten_gl_command_buffer_copy(buffer, data, sizeof(data));
+			// The call reads the copy, not the data it was made from.
+			memset(data, 0, sizeof(data));
+			emscripten_gl_command_buffer_record(buffer, EM_FUNC_SIG_VII, add, copy, call);
+		}
+		// Synchronous calls see all the calls recorded before them.
+		if (frame % 10 == 0)
+			assert(emscripten_gl_command_buffer_call_sync(buffer, EM_FUNC_SIG_I, calls_replayed) == (frame + 1) * CALLS_PER_FRAME);
+		emscripten_gl_command_buffer_submit(buffer);
+	}
+
+	// GL calls go to the context of the main thread.
+	emscripten_gl_command_buffer_record(buffer, EM_FUNC_SIG_GENERIC_V(4) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_F) | EM_FUNC_SIG_ARG(1, EM_FUNC_SIG_TYPE_F)
+		| EM_FUNC_SIG_ARG(2, EM_FUNC_SIG_TYPE_F) | EM_FUNC_SIG_ARG(3, EM_FUNC_SIG_TYPE_F), glClearColor, 0.0f, 0.5f, 1.0f, 1.0f);
+	emscripten_gl_command_buffer_record(buffer, EM_FUNC_SIG_VI, glClear, GL_COLOR_BUFFER_BIT);
+	emscripten_gl_command_buffer_cache_integer(buffer, GL_ARRAY_BUFFER_BINDING, 0);
+	int binding = -1;
+	assert(emscripten_gl_command_buffer_get_cached_integer(buffer, GL_ARRAY_BUFFER_BINDING, &binding));
+	assert(binding == 0);
+	assert(!emscripten_gl_command_buffer_get_cached_integer(buffer, GL_ELEMENT_ARRAY_BUFFER_BINDING, &binding));
+	assert(emscripten_gl_command_buffer_call_sync(buffer, EM_FUNC_SIG_I, glGetError) == GL_NO_ERROR);
+
+	emscripten_gl_command_buffer_destroy(buffer);
+	return 0;
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		EmscriptenWebGLContextAttributes attr;
+		emscripten_webgl_init_context_attributes(&attr);
+		EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_create_context(0, &attr);
+		assert(context > 0);
+		emscripten_webgl_make_context_current(context);
+
+		// Smaller than the calls of one frame, so that recording waits for the main thread to make room.
+		buffer = emscripten_gl_command_buffer_create(64);
+		assert(buffer);
+		pthread_t thread;
+		int rc = pthread_create(&thread, 0, render_thread, 0);
+		assert(rc == 0);
+		rc = pthread_join(thread, 0);
+		assert(rc == 0);
+
+		assert(next_call == NUM_FRAMES * CALLS_PER_FRAME);
+		assert(sum == NUM_FRAMES * CALLS_PER_FRAME);
+		printf("ok\n");
+	}
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
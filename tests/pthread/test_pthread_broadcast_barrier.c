@@ -0,0 +1,69 @@
+// Tests that a condition variable broadcast hands all of its waiters over to the mutex, including the main browser
+// thread, whose wait is moved to the mutex by emscripten_futex_wake_or_requeue(), and that a barrier can be waited on
+// back to back by the same threads.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <emscripten.h>
+#include <emscripten/threading.h>
+
+#define THREADS 6
+#define ROUNDS 50
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static pthread_barrier_t barrier;
+static int generation = 0;
+static int arrived = 0;
+static int serial = 0;
+static volatile int rounds_done[THREADS+1];
+
+static void run_rounds(int id)
+{
+	for(int r = 0; r < ROUNDS; ++r)
+	{
+		// The last thread to arrive wakes up all the others at once.
+		pthread_mutex_lock(&mutex);
+		int gen = generation;
+		if (++arrived == THREADS + 1)
+		{
+			arrived = 0;
+			++generation;
+			pthread_cond_broadcast(&cond);
+		}
+		else while(generation == gen) pthread_cond_wait(&cond, &mutex);
+		pthread_mutex_unlock(&mutex);
+
+		rounds_done[id] = r + 1;
+		if (pthread_barrier_wait(&barrier) == PTHREAD_BARRIER_SERIAL_THREAD) __sync_fetch_and_add(&serial, 1);
+		// Between the two barriers, every thread has finished this round, and none has started the next.
+		for(int i = 0; i <= THREADS; ++i) assert(rounds_done[i] == r + 1);
+		if (pthread_barrier_wait(&barrier) == PTHREAD_BARRIER_SERIAL_THREAD) __sync_fetch_and_add(&serial, 1);
+	}
+}
+
+static void *thread_main(void *arg)
+{
+	run_rounds((int)arg);
+	return 0;
+}
+
+int main()
+{
+	int result = 0;
+	if (emscripten_has_threading_support())
+	{
+		pthread_barrier_init(&barrier, 0, THREADS + 1);
+		pthread_t threads[THREADS];
+		for(int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, thread_main, (void*)i);
+		run_rounds(THREADS);
+		for(int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+		pthread_barrier_destroy(&barrier);
+		printf("serial threads: %d\n", serial);
+		result = (serial == 2 * ROUNDS) ? 0 : 1;
+	}
+#ifdef REPORT_RESULT
+	REPORT_RESULT(result);
+#endif
+}
@@ -0,0 +1,68 @@
+#include <emscripten.h>
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define NUM_BYTES 4096
+
+void EMSCRIPTEN_KEEPALIVE finish(int result)
+{
+	printf("result: %d\n", result);
+#ifdef REPORT_RESULT
+	REPORT_RESULT(result);
+#endif
+}
+
+void *thread_main(void *arg)
+{
+	unsigned char buffer[NUM_BYTES];
+	for(int i = 0; i < NUM_BYTES; ++i) buffer[i] = (unsigned char)i;
+	EMSCRIPTEN_RESULT r = emscripten_channel_post(1, buffer, NUM_BYTES, EM_CHANNEL_TRANSFER);
+	assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+	memset(buffer, 0, NUM_BYTES); // The transferred copy is not affected.
+
+	unsigned char *owned = (unsigned char*)malloc(NUM_BYTES);
+	for(int i = 0; i < NUM_BYTES; ++i) owned[i] = (unsigned char)(255 - i);
+	r = emscripten_channel_post(1, owned, NUM_BYTES, EM_CHANNEL_HEAP_VIEW);
+	assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+
+	r = emscripten_channel_post(1, buffer, NUM_BYTES, 42);
+	assert(r == EMSCRIPTEN_RESULT_INVALID_PARAM);
+	return 0;
+}
+
+int main()
+{
+	if (!emscripten_has_threading_support())
+	{
+		finish(0);
+		printf("Skipped: Threading is not supported.\n");
+		return 0;
+	}
+
+	EM_ASM({
+		var numMessages = 0;
+		Module['pthreadChannelHandlers'] = {};
+		Module['pthreadChannelHandlers'][1] = function(bytes) {
+			var transferred = (numMessages++ == 0);
+			// The first message arrives in an ArrayBuffer of its own, the second one as a view of the heap.
+			var ok = bytes.length == 4096 && (transferred ? bytes.buffer !== HEAPU8.buffer : bytes.buffer === HEAPU8.buffer);
+			for (var i = 0; i < bytes.length; ++i) {
+				if (bytes[i] != (transferred ? i & 255 : 255 - (i & 255))) ok = false;
+			}
+			if (!ok) _finish(numMessages);
+			else if (numMessages == 2) _finish(0);
+		};
+	});
+
+	pthread_t thread;
+	int rc = pthread_create(&thread, 0, thread_main, 0);
+	assert(rc == 0);
+	rc = pthread_join(thread, 0);
+	assert(rc == 0);
+	EM_ASM(Module['noExitRuntime'] = true);
+	return 0;
+}
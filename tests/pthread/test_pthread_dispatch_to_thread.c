@@ -0,0 +1,87 @@
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+
+#define NUM_CALLS 1000
+
+pthread_t main_thread;
+pthread_t receiver;
+volatile int quit = 0;
+volatile int main_thread_calls = 0;
+int next_call[2] = {}; // Only accessed on the receiver thread.
+
+void count(int sender, int call)
+{
+	assert(pthread_equal(pthread_self(), receiver));
+	// The calls that one thread dispatches are run in the order it dispatched them.
+	assert(call == next_call[sender]);
+	++next_call[sender];
+}
+
+void stop()
+{
+	assert(pthread_equal(pthread_self(), receiver));
+	quit = 1;
+}
+
+void on_main_thread(int x)
+{
+	assert(emscripten_is_main_runtime_thread());
+	assert(x == 42);
+	emscripten_atomic_add_u32((void*)&main_thread_calls, 1);
+}
+
+void *receiver_main(void *arg)
+{
+	// Nothing has been dispatched to this thread yet.
+	EMSCRIPTEN_RESULT r = emscripten_current_thread_wait_for_queued_calls(0);
+	assert(r == EMSCRIPTEN_RESULT_TIMED_OUT);
+
+	while(!quit)
+		emscripten_current_thread_wait_for_queued_calls(INFINITY);
+
+	// Calls dispatched by a pthread to the main runtime thread go to its command queue.
+	emscripten_dispatch_to_thread(main_thread, EM_FUNC_SIG_VI, on_main_thread, 42);
+	return 0;
+}
+
+void *sender_main(void *arg)
+{
+	for(int i = 0; i < NUM_CALLS; ++i)
+		emscripten_dispatch_to_thread(receiver, EM_FUNC_SIG_VII, count, 1, i);
+	return 0;
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		main_thread = pthread_self();
+		int rc = pthread_create(&receiver, 0, receiver_main, 0);
+		assert(rc == 0);
+		pthread_t sender;
+		rc = pthread_create(&sender, 0, sender_main, 0);
+		assert(rc == 0);
+
+		// The main runtime thread and the sender thread dispatch calls to the receiver at the same time.
+		for(int i = 0; i < NUM_CALLS; ++i)
+			emscripten_dispatch_to_thread(receiver, EM_FUNC_SIG_VII, count, 0, i);
+		rc = pthread_join(sender, 0);
+		assert(rc == 0);
+		emscripten_dispatch_to_thread(receiver, EM_FUNC_SIG_V, stop);
+		rc = pthread_join(receiver, 0);
+		assert(rc == 0);
+
+		assert(next_call[0] == NUM_CALLS);
+		assert(next_call[1] == NUM_CALLS);
+		emscripten_main_thread_process_queued_calls();
+		assert(main_thread_calls == 1);
+		printf("ok\n");
+	}
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
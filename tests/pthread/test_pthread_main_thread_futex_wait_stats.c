@@ -0,0 +1,60 @@
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t other_mutex = PTHREAD_MUTEX_INITIALIZER;
+volatile int locked = 0;
+
+void *holder_main(void *arg)
+{
+	pthread_mutex_lock(&mutex);
+	emscripten_atomic_store_u32((void*)&locked, 1);
+	usleep(100 * 1000);
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		pthread_t holder;
+		int rc = pthread_create(&holder, 0, holder_main, 0);
+		assert(rc == 0);
+		while(!emscripten_atomic_load_u32((void*)&locked))
+			emscripten_main_thread_process_queued_calls();
+
+		// The mutex is held by the other thread, so the main thread has to wait for it.
+		pthread_mutex_lock(&mutex);
+		pthread_mutex_unlock(&mutex);
+		rc = pthread_join(holder, 0);
+		assert(rc == 0);
+
+		em_futex_wait_stats stats;
+		emscripten_main_thread_futex_wait_stats(&mutex, sizeof(mutex), &stats);
+		printf("waits: %d, timeouts: %d, async waits: %d, total: %f msecs, max: %f msecs\n", stats.numWaits, stats.numTimeouts, stats.numAsyncWaits, stats.totalMsecs, stats.maxMsecs);
+		assert(stats.numWaits >= 1);
+		assert(stats.totalMsecs > 0 && stats.maxMsecs > 0 && stats.maxMsecs <= stats.totalMsecs);
+#ifdef EXPECT_ASYNC_WAITS
+		assert(stats.numAsyncWaits >= 1);
+#else
+		assert(stats.numAsyncWaits == 0);
+#endif
+
+		// Waits on one lock are not counted for the others.
+		emscripten_main_thread_futex_wait_stats(&other_mutex, sizeof(other_mutex), &stats);
+		assert(stats.numWaits == 0);
+
+		emscripten_main_thread_reset_futex_wait_stats();
+		emscripten_main_thread_futex_wait_stats(&mutex, sizeof(mutex), &stats);
+		assert(stats.numWaits == 0 && stats.totalMsecs == 0);
+		printf("ok\n");
+	}
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
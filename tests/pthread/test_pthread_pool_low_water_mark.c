@@ -0,0 +1,72 @@
+#include <emscripten.h>
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define NUM_THREADS 6
+#define LOW_WATER_MARK 4
+
+pthread_t threads[NUM_THREADS];
+volatile int quit = 0;
+volatile int num_started = 0;
+
+void *thread_main(void *arg)
+{
+	emscripten_atomic_add_u32((void*)&num_started, 1);
+	while(!emscripten_atomic_load_u32((void*)&quit))
+		emscripten_futex_wait((void*)&quit, 0, 100);
+	return 0;
+}
+
+int num_unused_workers()
+{
+	return EM_ASM_INT(return PThread.unusedWorkerPool.length);
+}
+
+void finish(void *arg)
+{
+	// The pool was topped back up to its low-water mark while the threads are running.
+	printf("unused workers after the burst: %d\n", num_unused_workers());
+	assert(num_unused_workers() >= LOW_WATER_MARK);
+	assert(num_started == NUM_THREADS);
+
+	emscripten_atomic_store_u32((void*)&quit, 1);
+	emscripten_futex_wake((void*)&quit, NUM_THREADS);
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		int rc = pthread_join(threads[i], 0);
+		assert(rc == 0);
+	}
+	printf("ok\n");
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
+
+void burst(void *arg)
+{
+	// The pool was filled up to the low-water mark in the background at startup.
+	printf("unused workers before the burst: %d\n", num_unused_workers());
+	assert(num_unused_workers() >= LOW_WATER_MARK);
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		int rc = pthread_create(&threads[i], 0, thread_main, 0);
+		assert(rc == 0);
+	}
+	emscripten_async_call(finish, 0, 2000);
+}
+
+int main()
+{
+	if (!emscripten_has_threading_support())
+	{
+#ifdef REPORT_RESULT
+		REPORT_RESULT(0);
+#endif
+		printf("Skipped: Threading is not supported.\n");
+		return 0;
+	}
+	emscripten_async_call(burst, 0, 2000);
+	return 0;
+}
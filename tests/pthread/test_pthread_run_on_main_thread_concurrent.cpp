@@ -0,0 +1,57 @@
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define NUM_THREADS 4
+#define NUM_CALLS 1000
+
+// Only accessed on the main thread.
+int next_call[NUM_THREADS] = {};
+
+void v(int thread, int call)
+{
+	assert(emscripten_is_main_runtime_thread());
+	// The calls that one thread posts are run in the order that it posted them.
+	assert(call == next_call[thread]);
+	++next_call[thread];
+}
+
+void *thread_main(void *arg)
+{
+	int thread = (int)(long)arg;
+	// All threads post to the queue of the main thread at the same time.
+	for(int i = 0; i < NUM_CALLS; ++i)
+		emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VII, v, thread, i);
+	pthread_exit(0);
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		pthread_t threads[NUM_THREADS];
+		for(int i = 0; i < NUM_THREADS; ++i)
+		{
+			int rc = pthread_create(&threads[i], 0, thread_main, (void*)(long)i);
+			assert(rc == 0);
+		}
+		for(int i = 0; i < NUM_THREADS; ++i)
+		{
+			int rc = pthread_join(threads[i], 0);
+			assert(rc == 0);
+		}
+
+		// Run the calls that were posted after the main thread last looked at its queue.
+		emscripten_main_thread_process_queued_calls();
+		for(int i = 0; i < NUM_THREADS; ++i)
+		{
+			printf("Thread %d: %d calls run.\n", i, next_call[i]);
+			assert(next_call[i] == NUM_CALLS);
+		}
+	}
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
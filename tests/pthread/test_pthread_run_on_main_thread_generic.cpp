@@ -0,0 +1,120 @@
+#include <emscripten/threading.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <string>
+
+volatile int func_called = 0;
+
+void vfdj(float f, double d, int64_t j)
+{
+	assert(emscripten_is_main_runtime_thread());
+	assert(f == 1.5f);
+	assert(d == 2.25);
+	assert(j == 0x123456789LL);
+	emscripten_atomic_add_u32((void*)&func_called, 1);
+}
+
+double dfiiiiiid(float f, int a, int b, int c, int d, int e, int g, double h)
+{
+	assert(emscripten_is_main_runtime_thread());
+	return f + a + b + c + d + e + g + h;
+}
+
+int64_t jjj(int64_t a, int64_t b)
+{
+	assert(emscripten_is_main_runtime_thread());
+	return a * b;
+}
+
+float ff(float f)
+{
+	assert(emscripten_is_main_runtime_thread());
+	return f * 2.f;
+}
+
+void test_c()
+{
+	printf("Testing generic signatures:\n");
+	emscripten_atomic_store_u32((void*)&func_called, 0);
+	EM_FUNC_SIGNATURE sig = EM_FUNC_SIG_GENERIC_V(3) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_F) | EM_FUNC_SIG_ARG(1, EM_FUNC_SIG_TYPE_D)
+		| EM_FUNC_SIG_ARG(2, EM_FUNC_SIG_TYPE_J);
+	emscripten_sync_run_in_main_runtime_thread(sig, vfdj, 1.5f, 2.25, (int64_t)0x123456789LL);
+	assert(func_called == 1);
+	emscripten_async_run_in_main_runtime_thread(sig, vfdj, 1.5f, 2.25, (int64_t)0x123456789LL);
+
+	// All EM_QUEUED_CALL_MAX_ARGS arguments.
+	sig = EM_FUNC_SIG_GENERIC_R(EM_FUNC_SIG_TYPE_D, 8) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_F) | EM_FUNC_SIG_ARG(7, EM_FUNC_SIG_TYPE_D);
+	em_queued_call *c = emscripten_async_waitable_run_in_main_runtime_thread(sig, dfiiiiiid, 0.5f, 1, 2, 3, 4, 5, 6, 0.25);
+	EMSCRIPTEN_RESULT r = emscripten_wait_for_call_v(c, INFINITY);
+	assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+	assert(c->returnValue.d == 21.75);
+	emscripten_async_waitable_close(c);
+
+	sig = EM_FUNC_SIG_GENERIC_R(EM_FUNC_SIG_TYPE_J, 2) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_J) | EM_FUNC_SIG_ARG(1, EM_FUNC_SIG_TYPE_J);
+	c = emscripten_async_waitable_run_in_main_runtime_thread(sig, jjj, (int64_t)0x100000000LL, (int64_t)3);
+	r = emscripten_wait_for_call_v(c, INFINITY);
+	assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+	assert(c->returnValue.i64 == 0x300000000LL);
+	emscripten_async_waitable_close(c);
+
+	sig = EM_FUNC_SIG_GENERIC_R(EM_FUNC_SIG_TYPE_F, 1) | EM_FUNC_SIG_ARG(0, EM_FUNC_SIG_TYPE_F);
+	c = emscripten_async_waitable_run_in_main_runtime_thread(sig, ff, 1.25f);
+	r = emscripten_wait_for_call_v(c, INFINITY);
+	assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+	assert(c->returnValue.f == 2.5f);
+	emscripten_async_waitable_close(c);
+
+	while(emscripten_atomic_load_u32((void*)&func_called) != 2)
+		;
+}
+
+void test_cpp()
+{
+	printf("Testing C++ lambdas:\n");
+	std::string s = "hello";
+	// The result is returned by value, whatever its type.
+	std::string t = emscripten::proxy([&]() {
+		assert(emscripten_is_main_runtime_thread());
+		return s + " world";
+	});
+	assert(t == "hello world");
+
+	int x = 0;
+	emscripten::proxy([&]() { x = 42; });
+	assert(x == 42);
+
+	// The captures of an asynchronous call are copied.
+	emscripten_atomic_store_u32((void*)&func_called, 0);
+	for(int i = 0; i < 10; ++i)
+		emscripten::proxy_async([s, i]() {
+			assert(emscripten_is_main_runtime_thread());
+			assert(s == "hello");
+			emscripten_atomic_add_u32((void*)&func_called, 1);
+		});
+	while(emscripten_atomic_load_u32((void*)&func_called) != 10)
+		;
+}
+
+void *thread_main(void*)
+{
+	test_c();
+	test_cpp();
+	pthread_exit(0);
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		pthread_t thread;
+		int rc = pthread_create(&thread, 0, thread_main, 0);
+		assert(rc == 0);
+		rc = pthread_join(thread, 0);
+		assert(rc == 0);
+	}
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
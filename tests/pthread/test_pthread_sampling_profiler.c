@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+
+// Spins for the given number of milliseconds, long enough to be sampled many times.
+__attribute__((noinline))
+int hot(double ms)
+{
+	int x = 0;
+	double end = emscripten_get_now() + ms;
+	while (emscripten_get_now() < end)
+		++x;
+	return x;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void report(int ok)
+{
+	printf("hot %s sampled\n", ok ? "was" : "was not");
+#ifdef REPORT_RESULT
+	REPORT_RESULT(ok);
+#endif
+}
+
+int main()
+{
+	printf("%d\n", hot(300) > 0);
+	EM_ASM(
+		Module['getSamplingProfile'](function(profile) {
+			console.log(profile);
+			Module['_report'](/^main;.*_hot \d+$/m.test(profile));
+		});
+	);
+	emscripten_exit_with_live_runtime();
+	return 0;
+}
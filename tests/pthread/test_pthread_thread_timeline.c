@@ -0,0 +1,48 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <emscripten.h>
+#include <emscripten/threading.h>
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *thread_main(void *arg)
+{
+	emscripten_set_thread_name(pthread_self(), (const char *)arg);
+	// Each thread sleeps while holding the mutex, so the other waits for it.
+	pthread_mutex_lock(&mutex);
+	usleep(50 * 1000);
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+int main()
+{
+	if (!emscripten_has_threading_support())
+	{
+#ifdef REPORT_RESULT
+		REPORT_RESULT(1);
+#endif
+		return 0;
+	}
+
+	pthread_t a, b;
+	pthread_create(&a, 0, thread_main, (void *)"first");
+	pthread_create(&b, 0, thread_main, (void *)"second");
+	pthread_join(a, 0);
+	pthread_join(b, 0);
+
+	int ok = EM_ASM_INT({
+		var timeline = Module['getThreadTimeline']();
+		var slept = timeline.filter(function(r) { return r.status == 'sleeping'; });
+		var threads = {};
+		slept.forEach(function(r) { threads[r.thread] = true; });
+		var trace = JSON.parse(Module['getThreadTimelineTrace']());
+		var slices = trace['traceEvents'].filter(function(e) { return e['ph'] == 'X'; });
+		console.log(JSON.stringify(timeline));
+		return Object.keys(threads).length >= 2 && slices.length > 0;
+	});
+#ifdef REPORT_RESULT
+	REPORT_RESULT(ok);
+#endif
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <emscripten/task_scheduler.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define N 100000
+
+int data[N];
+volatile int num_ranges = 0;
+
+void square(int begin, int end, void *arg)
+{
+	assert(begin < end);
+	assert(end - begin <= *(int*)arg);
+	for(int i = begin; i < end; ++i)
+		data[i] = i * 2;
+	emscripten_atomic_add_u32((void*)&num_ranges, 1);
+}
+
+typedef struct fib_args
+{
+	int n;
+	int result;
+} fib_args;
+
+// Fork/join: each task spawns its subproblems to a group of its own, and waits for them.
+void fib(void *arg)
+{
+	fib_args *a = (fib_args*)arg;
+	if (a->n < 2)
+	{
+		a->result = a->n;
+		return;
+	}
+	fib_args x = { a->n - 1 };
+	fib_args y = { a->n - 2 };
+	em_task_group group = EM_TASK_GROUP_INIT;
+	emscripten_task_spawn(&group, fib, &x);
+	emscripten_task_spawn(&group, fib, &y);
+	emscripten_task_group_wait(&group);
+	a->result = x.result + y.result;
+}
+
+int main()
+{
+	if (emscripten_has_threading_support())
+	{
+		EMSCRIPTEN_RESULT r = emscripten_task_scheduler_init(0);
+		assert(r == EMSCRIPTEN_RESULT_SUCCESS);
+		// The scheduler uses the Workers of the pool.
+		printf("%d threads\n", emscripten_task_scheduler_num_threads());
+		assert(emscripten_task_scheduler_num_threads() == 4);
+		r = emscripten_task_scheduler_init(0);
+		assert(r == EMSCRIPTEN_RESULT_NOT_SUPPORTED);
+	}
+
+	int grainSize = 1000;
+	emscripten_parallel_for(0, N, grainSize, square, &grainSize);
+	for(int i = 0; i < N; ++i)
+		assert(data[i] == i * 2);
+	assert(num_ranges >= N / grainSize);
+
+	fib_args a = { 20 };
+	em_task_group group = EM_TASK_GROUP_INIT;
+	emscripten_task_spawn(&group, fib, &a);
+	emscripten_task_group_wait(&group);
+	printf("fib(20) = %d\n", a.result);
+	assert(a.result == 6765);
+
+	emscripten_task_scheduler_shutdown();
+	assert(emscripten_task_scheduler_num_threads() == 0);
+
+#ifdef REPORT_RESULT
+	REPORT_RESULT(0);
+#endif
+}
@@ -0,0 +1,53 @@
+// Checks that the pixels of unlocked surfaces reach the canvas when SDL puts them from the heap directly, also after
+// memory growth replaced the heap.
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL/SDL.h>
+#include <emscripten.h>
+
+void fill(SDL_Surface *surface, Uint32 color)
+{
+  SDL_LockSurface(surface);
+  Uint32 *pixels = (Uint32*)surface->pixels;
+  for(int i = 0; i < surface->w * surface->h; ++i) pixels[i] = color;
+  SDL_UnlockSurface(surface);
+}
+
+// Returns the pixel at the given position of the page canvas as 0xAABBGGRR.
+Uint32 canvasPixel(int x, int y)
+{
+  return EM_ASM_INT({
+    var data = Module['canvas'].getContext('2d').getImageData($0, $1, 1, 1).data;
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+  }, x, y);
+}
+
+int main()
+{
+  SDL_Init(SDL_INIT_VIDEO);
+  EM_ASM(SDL.defaults.opaqueFrontBuffer = false);
+  SDL_Surface *screen = SDL_SetVideoMode(64, 64, 32, SDL_SWSURFACE);
+  SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, 16, 16, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+
+  fill(screen, 0xff0000ff);
+  assert(canvasPixel(32, 32) == 0xff0000ff);
+
+  fill(surface, 0xff00ff00);
+  SDL_BlitSurface(surface, NULL, screen, NULL);
+  assert(canvasPixel(8, 8) == 0xff00ff00);
+  assert(canvasPixel(32, 32) == 0xff0000ff);
+
+  void *growth = malloc(64*1024*1024);
+  assert(growth);
+  fill(surface, 0xffff0000);
+  SDL_BlitSurface(surface, NULL, screen, NULL);
+  assert(canvasPixel(8, 8) == 0xffff0000);
+  fill(screen, 0xff00ffff);
+  assert(canvasPixel(32, 32) == 0xff00ffff);
+  free(growth);
+
+  printf("ok\n");
+  REPORT_RESULT(1);
+  return 0;
+}
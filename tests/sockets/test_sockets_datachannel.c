@@ -0,0 +1,72 @@
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <emscripten.h>
+
+// Echoes a datagram between two sockets in the same page, over RTCDataChannels that the pre-js connects locally.
+
+#define SERVER_PORT 8000
+#define CLIENT_PORT 8001
+
+int server_fd, client_fd;
+
+void make_addr(struct sockaddr_in *addr, int port) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(port);
+  assert(inet_pton(AF_INET, "127.0.0.1", &addr->sin_addr) == 1);
+}
+
+int make_socket(int port) {
+  int fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  assert(fd != -1);
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  struct sockaddr_in addr;
+  make_addr(&addr, port);
+  assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+  return fd;
+}
+
+void main_loop() {
+  char buffer[16];
+  struct sockaddr_in from;
+  socklen_t fromlen = sizeof(from);
+
+  // the server sends back what it gets, to where it came from
+  int res = recvfrom(server_fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromlen);
+  if (res > 0) {
+    assert(res == 5 && strcmp(buffer, "ping") == 0);
+    assert(ntohs(from.sin_port) == CLIENT_PORT);
+    assert(sendto(server_fd, buffer, res, 0, (struct sockaddr *)&from, fromlen) == res);
+  } else {
+    assert(res == -1 && errno == EAGAIN);
+  }
+
+  fromlen = sizeof(from);
+  res = recvfrom(client_fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromlen);
+  if (res > 0) {
+    assert(res == 5 && strcmp(buffer, "ping") == 0);
+    assert(ntohs(from.sin_port) == SERVER_PORT);
+    emscripten_cancel_main_loop();
+    REPORT_RESULT(1);
+  }
+}
+
+int main() {
+  server_fd = make_socket(SERVER_PORT);
+  client_fd = make_socket(CLIENT_PORT);
+
+  // this is queued until the data channel is open
+  struct sockaddr_in addr;
+  make_addr(&addr, SERVER_PORT);
+  assert(sendto(client_fd, "ping", 5, 0, (struct sockaddr *)&addr, sizeof(addr)) == 5);
+
+  emscripten_set_main_loop(main_loop, 0, 0);
+  return 0;
+}
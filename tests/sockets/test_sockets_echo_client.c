@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <assert.h>
+#include <poll.h>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
@@ -132,6 +133,18 @@ void async_main_loop(int fd, void* userData) {
   main_loop();
 }
 
+#if TEST_WAIT
+struct pollfd wait_fd;
+
+// Sleeps until the socket is ready for what the current state needs, instead of running every frame.
+void wait_callback(int ready, void* userData) {
+  assert(ready == 1);
+  main_loop();
+  wait_fd.events = server.state == MSG_READ ? POLLIN : POLLOUT;
+  emscripten_socket_wait_async(&wait_fd, 1, -1, NULL, wait_callback);
+}
+#endif
+
 void error_callback(int fd, int err, const char* msg, void* userData) {
   int error;
   socklen_t len = sizeof(error);
@@ -233,6 +246,10 @@ int main() {
   emscripten_set_socket_error_callback("error", error_callback);
   emscripten_set_socket_open_callback("open", async_main_loop);
   emscripten_set_socket_message_callback("message", async_main_loop);
+#elif TEST_WAIT
+  wait_fd.fd = server.fd;
+  wait_fd.events = POLLOUT;
+  emscripten_socket_wait_async(&wait_fd, 1, -1, NULL, wait_callback);
 #else
   emscripten_set_main_loop(main_loop, 60, 0);
 #endif
@@ -1,5 +1,5 @@
 from __future__ import print_function
-import math, os, shutil, subprocess, zlib
+import json, math, os, shlex, shutil, subprocess, threading, zlib
 import runner
 from runner import RunnerCore, path_from_root
 from tools.shared import *
@@ -13,7 +13,19 @@ from tools.shared import *
 # 5: 10 seconds
 DEFAULT_ARG = '4'
 
-TEST_REPS = 3
+TEST_REPS = int(os.environ.get('BENCHMARK_REPS') or 3)
+
+# runs before the measured ones, to warm up caches, that are not counted
+WARMUP_REPS = int(os.environ.get('BENCHMARK_WARMUP') or 0)
+
+# if set, the results are written there as JSON, and compared to those in the
+# baseline file (written the same way by an earlier run), flagging the ones that
+# got slower, bigger or used more memory by more than the threshold (in percent)
+RESULTS_FILE = os.environ.get('BENCHMARK_JSON')
+BASELINE_FILE = os.environ.get('BENCHMARK_BASELINE')
+REGRESSION_THRESHOLD = float(os.environ.get('BENCHMARK_THRESHOLD') or 5)
+
+results = []
 
 # by default, run just core benchmarks
 CORE_BENCHMARKS = True
@@ -25,21 +37,56 @@ IGNORE_COMPILATION = 0
 
 OPTIMIZATIONS = '-O3'
 
+def run_measured(cmd):
+  # Runs a command and returns its output (stdout and stderr) and its peak
+  # RSS in bytes, or None if we cannot get it here
+  if not hasattr(os, 'wait4'):
+    output = Popen(cmd, stdout=PIPE, stderr=PIPE, universal_newlines=True).communicate()
+    return output[0] + output[1], None
+  proc = Popen(cmd, stdout=PIPE, stderr=PIPE, universal_newlines=True)
+  outputs = [None, None]
+  def read(i, f):
+    outputs[i] = f.read()
+  readers = [threading.Thread(target=read, args=(0, proc.stdout)), threading.Thread(target=read, args=(1, proc.stderr))]
+  for reader in readers: reader.start()
+  for reader in readers: reader.join()
+  # wait4 rather than wait, to get the child's own resource usage
+  pid, status, usage = os.wait4(proc.pid, 0)
+  proc.returncode = status
+  return outputs[0] + outputs[1], usage.ru_maxrss * (1 if sys.platform == 'darwin' else 1024)
+
+def reject_outliers(times):
+  # With enough runs, drop those more than 3 median absolute deviations from
+  # the median, which are usually the machine doing something else
+  if len(times) < 5: return times
+  median = sorted(times)[len(times)//2]
+  deviation = sorted([abs(t - median) for t in times])[len(times)//2]
+  if deviation == 0: return times
+  return [t for t in times if abs(t - median) <= 3 * deviation]
+
 class Benchmarker(object):
   def __init__(self, name):
     self.name = name
 
   def bench(self, args, output_parser=None, reps=TEST_REPS):
     self.times = []
+    self.peak_rss = None
     self.reps = reps
+    for i in range(WARMUP_REPS):
+      self.run(args)
     for i in range(reps):
       start = time.time()
+      self.last_rss = None
       output = self.run(args)
+      if self.last_rss is not None:
+        self.peak_rss = max(self.peak_rss or 0, self.last_rss)
       if not output_parser or args == ['0']: # if arg is 0, we are not running code, and have no output to parse
-        if IGNORE_COMPILATION:
-          curr = float(re.search('took +([\d\.]+) milliseconds', output).group(1)) / 1000
-        else:
-          curr = time.time() - start
+        curr = self.measured_time(output)
+        if curr is None:
+          if IGNORE_COMPILATION:
+            curr = float(re.search('took +([\d\.]+) milliseconds', output).group(1)) / 1000
+          else:
+            curr = time.time() - start
       else:
         try:
           curr = output_parser(output)
@@ -47,6 +94,8 @@ class Benchmarker(object):
           logging.error(str(e))
           logging.error('Parsing benchmark results failed, output was: ' + output)
       self.times.append(curr)
+    self.all_times = self.times
+    self.times = reject_outliers(self.times)
 
   def display(self, baseline=None):
     # speed
@@ -61,6 +110,8 @@ class Benchmarker(object):
     median = sum(sorted_times[len(sorted_times)//2 - 1:len(sorted_times)//2 + 1])/2
 
     print('   %10s: mean: %4.3f (+-%4.3f) secs  median: %4.3f  range: %4.3f-%4.3f  (noise: %4.3f%%)  (%d runs)' % (self.name, mean, std, median, min(self.times), max(self.times), 100*std/mean, self.reps), end=' ')
+    if len(self.times) < len(self.all_times):
+      print('(%d outliers)' % (len(self.all_times) - len(self.times)), end=' ')
 
     if baseline:
       mean_baseline = sum(baseline.times)/len(baseline.times)
@@ -77,11 +128,36 @@ class Benchmarker(object):
     print('        size: %8s, compressed: %8s' % (size, gzip_size), end=' ')
     if self.get_size_text():
       print('  (' + self.get_size_text() + ')', end=' ')
+    if self.peak_rss:
+      print('  peak RSS: %.1f MB' % (self.peak_rss / (1024.0 * 1024)), end=' ')
     print()
 
   def get_size_text(self):
     return ''
 
+  def measured_time(self, output):
+    # the time in seconds the benchmarker itself measured for the run that
+    # produced this output, or None to use the time the run took
+    return None
+
+  def record(self, benchmark):
+    # adds this benchmarker's last results to the ones written to RESULTS_FILE
+    sizes = {}
+    for f in self.get_output_files():
+      kind = os.path.splitext(f)[1][1:] or 'other'
+      sizes[kind] = sizes.get(kind, 0) + os.stat(f).st_size
+    results.append({
+      'benchmark': benchmark,
+      'benchmarker': self.name,
+      'times': self.all_times,
+      'mean': sum(self.times)/len(self.times),
+      'median': sorted(self.times)[len(self.times)//2],
+      'outliers': len(self.all_times) - len(self.times),
+      'peak_rss': self.peak_rss,
+      'sizes': sizes,
+      'compressed_size': sum([len(zlib.compress(open(f, 'rb').read())) for f in self.get_output_files()])
+    })
+
 class NativeBenchmarker(Benchmarker):
   def __init__(self, name, cc, cxx, args=[OPTIMIZATIONS]):
     self.name = name
@@ -114,8 +190,8 @@ class NativeBenchmarker(Benchmarker):
     self.filename = final
 
   def run(self, args):
-    process = Popen([self.filename] + args, stdout=PIPE, stderr=PIPE)
-    return process.communicate()[0]
+    output, self.last_rss = run_measured([self.filename] + args)
+    return output
 
   def get_output_files(self):
     return [self.filename]
@@ -131,6 +207,8 @@ def run_binaryen_opts(filename, opts):
   ] + opts)
 
 class EmscriptenBenchmarker(Benchmarker):
+  output_suffix = '.js'
+
   def __init__(self, name, engine, extra_args=[], env={}, binaryen_opts=[]):
     self.name = name
     self.engine = engine
@@ -156,7 +234,7 @@ process(sys.argv[1])
 ''' % str(args[:-1]) # do not hardcode in the last argument, the default arg
 )
 
-    final = os.path.dirname(filename) + os.path.sep + self.name + ('_' if self.name else '') + os.path.basename(filename) + '.js'
+    final = os.path.dirname(filename) + os.path.sep + self.name + ('_' if self.name else '') + os.path.basename(filename) + self.output_suffix
     final = final.replace('.cpp', '')
     try_delete(final)
     cmd = [
@@ -179,7 +257,8 @@ process(sys.argv[1])
     self.filename = final
 
   def run(self, args):
-    return run_js(self.filename, engine=self.engine, args=args, stderr=PIPE, full_output=True, assert_returncode=None)
+    output, self.last_rss = run_measured(jsrun.make_command(self.filename, self.engine, args))
+    return output
 
   def get_output_files(self):
     ret = [self.filename]
@@ -189,6 +268,39 @@ process(sys.argv[1])
       ret.append(self.filename + '.mem')
     return ret
 
+# Runs in a browser through emrun, which is where pthreads run. Used for the threaded benchmarks only.
+class EmscriptenBrowserBenchmarker(EmscriptenBenchmarker):
+  output_suffix = '.html'
+
+  def __init__(self, name, browser, extra_args=[], headless=False):
+    EmscriptenBenchmarker.__init__(self, name, None, extra_args + ['--emrun'])
+    self.browser = browser
+    self.headless = headless
+
+  def run(self, args):
+    browser = shlex.split(self.browser)
+    cmd = [PYTHON, path_from_root('emrun'), '--browser', browser[0], '--kill_start', '--kill_exit', '--silence_timeout', '60', '--report_timing']
+    if len(browser) > 1:
+      cmd += ['--browser_args', ' '.join(browser[1:])]
+    if self.headless:
+      cmd += ['--headless']
+    return Popen(cmd + [self.filename] + args, stdout=PIPE, stderr=PIPE, universal_newlines=True).communicate()[0]
+
+  def measured_time(self, output):
+    # the page reports how long main() ran, which leaves out starting up the
+    # browser and loading the page
+    m = re.search(r'emrun timing: startup [\d.]+ ms, main ([\d.]+) ms', output)
+    return float(m.group(1)) / 1000 if m else None
+
+  def get_output_files(self):
+    js = self.filename[:-5] + '.js'
+    ret = [js, os.path.join(os.path.dirname(js), 'pthread-main.js')]
+    if 'WASM=1' in self.extra_args:
+      ret.append(js[:-3] + '.wasm')
+    else:
+      ret.append(self.filename + '.mem')
+    return [f for f in ret if os.path.exists(f)]
+
 CHEERP_BIN = '/opt/cheerp/bin/'
 
 class CheerpBenchmarker(Benchmarker):
@@ -272,7 +384,8 @@ class CheerpBenchmarker(Benchmarker):
         try_delete(dir_)
 
   def run(self, args):
-    return run_js(self.filename, engine=self.engine, args=args, stderr=PIPE, full_output=True, assert_returncode=None)
+    output, self.last_rss = run_measured(jsrun.make_command(self.filename, self.engine, args))
+    return output
 
   def get_output_files(self):
     return [self.filename, self.filename + '.wasm']
@@ -322,6 +435,32 @@ class CheerpBenchmarker(Benchmarker):
       'files': []
     }
 
+def compare_to_baseline(baseline, current):
+  # Shows how each result changed since the baseline, and which regressed
+  old = dict(((r['benchmark'], r['benchmarker']), r) for r in baseline)
+  regressions = []
+  print()
+  print('Compared to baseline %s (threshold %.1f%%):' % (BASELINE_FILE, REGRESSION_THRESHOLD))
+  for r in current:
+    key = (r['benchmark'], r['benchmarker'])
+    if key not in old: continue
+    b = old[key]
+    changes = [('time', b['mean'], r['mean']),
+               ('compressed size', b['compressed_size'], r['compressed_size']),
+               ('peak RSS', b.get('peak_rss'), r.get('peak_rss'))]
+    line = []
+    for what, before, after in changes:
+      if not before or not after: continue
+      change = 100.0 * (after - before) / before
+      line.append('%s %+.1f%%' % (what, change))
+      if change > REGRESSION_THRESHOLD:
+        regressions.append('%s (%s): %s %+.1f%%' % (key[0], key[1], what, change))
+    print('   %s (%s): %s' % (key[0], key[1], ', '.join(line)))
+  if regressions:
+    print('REGRESSIONS:')
+    for regression in regressions:
+      print('   ' + regression)
+
 # Benchmarkers
 try:
   benchmarkers_error = ''
@@ -351,6 +490,33 @@ except Exception as e:
   benchmarkers_error = str(e)
   benchmarkers = []
 
+# Set EMSCRIPTEN_BENCHMARK_BROWSERS to a comma-separated list of emrun browser
+# names (see emrun --list_browsers), or to "all" for all the ones emrun finds,
+# to also run the benchmarks headlessly in those browsers.
+def find_benchmark_browsers():
+  browsers = os.environ.get('EMSCRIPTEN_BENCHMARK_BROWSERS')
+  if not browsers:
+    return []
+  if browsers != 'all':
+    return [b.strip() for b in browsers.split(',') if b.strip()]
+  output = Popen([PYTHON, path_from_root('emrun'), '--list_browsers'], stdout=PIPE, stderr=PIPE, universal_newlines=True).communicate()[0]
+  return re.findall(r'^  - (\w+):', output, re.MULTILINE)
+
+for browser in find_benchmark_browsers():
+  benchmarkers += [
+    EmscriptenBrowserBenchmarker(browser + '-asmjs', browser, headless=True),
+    EmscriptenBrowserBenchmarker(browser + '-wasm', browser, ['-s', 'WASM=1'], headless=True),
+  ]
+
+# The threaded benchmarks need a browser to run pthreads, set EMSCRIPTEN_BROWSER to run them there, and otherwise
+# just get the native baseline.
+threaded_benchmarkers = [b for b in benchmarkers if isinstance(b, NativeBenchmarker)]
+if os.environ.get('EMSCRIPTEN_BROWSER'):
+  threaded_benchmarkers += [
+    EmscriptenBrowserBenchmarker('browser-asmjs', os.environ['EMSCRIPTEN_BROWSER']),
+    EmscriptenBrowserBenchmarker('browser-wasm', os.environ['EMSCRIPTEN_BROWSER'], ['-s', 'WASM=1']),
+  ]
+
 class benchmark(RunnerCore):
   save_dir = True
 
@@ -385,8 +551,18 @@ class benchmark(RunnerCore):
     Building.COMPILER = CLANG
     Building.COMPILER_TEST_OPTS = [OPTIMIZATIONS]
 
-  def do_benchmark(self, name, src, expected_output='FAIL', args=[], emcc_args=[], native_args=[], shared_args=[], force_c=False, reps=TEST_REPS, native_exec=None, output_parser=None, args_processor=None, lib_builder=None):
+  @classmethod
+  def tearDownClass(self):
+    super(benchmark, self).tearDownClass()
+    if RESULTS_FILE:
+      with open(RESULTS_FILE, 'w') as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    if BASELINE_FILE:
+      compare_to_baseline(json.load(open(BASELINE_FILE)), results)
+
+  def do_benchmark(self, name, src, expected_output='FAIL', args=[], emcc_args=[], native_args=[], shared_args=[], force_c=False, reps=TEST_REPS, native_exec=None, output_parser=None, args_processor=None, lib_builder=None, threaded=False):
     if len(benchmarkers) == 0: raise Exception('error, no benchmarkers: ' + benchmarkers_error)
+    selected = threaded_benchmarkers if threaded else benchmarkers
 
     args = args or [DEFAULT_ARG]
     if args_processor: args = args_processor(args)
@@ -398,10 +574,37 @@ class benchmark(RunnerCore):
     f.close()
 
     print()
-    for b in benchmarkers:
+    for b in selected:
       b.build(self, filename, args, shared_args, emcc_args, native_args, native_exec, lib_builder, has_output_parser=output_parser is not None)
       b.bench(args, output_parser, reps)
-      b.display(benchmarkers[0])
+      b.display(selected[0])
+      b.record(name)
+
+  def do_startup_benchmark(self, name, src, shared_args=[], emcc_args=[], lib_builder=None, reps=TEST_REPS):
+    # Runs just the startup (argument 0) of the JS benchmarkers' builds, and shows how
+    # long each phase took, as measured by STARTUP_TIMING, rather than the process time.
+    selected = [b for b in benchmarkers if isinstance(b, EmscriptenBenchmarker)]
+    if len(selected) == 0: raise Exception('error, no JS benchmarkers: ' + benchmarkers_error)
+
+    filename = os.path.join(self.get_dir(), name + '.cpp')
+    open(filename, 'w').write(src)
+
+    print()
+    for b in selected:
+      b.build(self, filename, ['0'], shared_args, emcc_args + ['-s', 'STARTUP_TIMING=1'], [], None, lib_builder, has_output_parser=True)
+      phases = []
+      times = {}
+      for i in range(reps):
+        output = b.run(['0'])
+        line = re.search(r'startup \(ms\): (.*)', output).group(1)
+        for part in line.split(', '):
+          phase, ms = part.split(': ')
+          if phase not in times:
+            phases.append(phase)
+            times[phase] = []
+          times[phase].append(float(ms))
+      print('   %10s: startup (%d runs):' % (b.name, reps), end=' ')
+      print(', '.join('%s %.1f ms' % (phase, sum(times[phase]) / len(times[phase])) for phase in phases))
 
   def test_primes(self):
     src = r'''
@@ -810,6 +1013,15 @@ class benchmark(RunnerCore):
       return float(re.search('Total time: ([\d\.]+)', output).group(1))
     self.do_benchmark('foreign_functions', open(path_from_root('tests', 'benchmark_ffis.cpp')).read(), '''Total time:''', output_parser=output_parser, emcc_args=['--js-library', path_from_root('tests/benchmark_ffis.js')], shared_args=['-DBENCHMARK_FOREIGN_FUNCTION=1', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
 
+  # Benchmarks the overhead of embind for each kind of binding, against direct calls in a native build.
+  def test_embind(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    src = open(path_from_root('tests', 'benchmark_embind.cpp')).read()
+    for i, kind in enumerate(['functions', 'methods', 'strings', 'vectors', 'val_properties', 'smart_ptrs', 'value_objects']):
+      self.do_benchmark('embind_' + kind, src, 'Total time:', output_parser=output_parser, emcc_args=['--bind', '--js-library', path_from_root('tests', 'benchmark_embind.js')], shared_args=['-DBENCHMARK_EMBIND=%d' % i, '-std=c++11', '-I' + path_from_root('tests')])
+
   def test_memcpy_128b(self):
     if CORE_BENCHMARKS: return
     def output_parser(output):
@@ -870,11 +1082,305 @@ class benchmark(RunnerCore):
       return float(re.search('Total time: ([\d\.]+)', output).group(1))
     self.do_benchmark('memset_16mb', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DMIN_COPY=1048576', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
 
+  def test_memcpy_random_4k(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcpy_random_4k', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DMIN_COPY=16', '-DMAX_COPY=4096', '-DRANDOM_SIZES', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
+
+  def test_memcpy_random_64k(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcpy_random_64k', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DMIN_COPY=4096', '-DMAX_COPY=65536', '-DRANDOM_SIZES', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
+
+  def test_memmove_random_4k(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memmove_random_4k', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DMIN_COPY=16', '-DMAX_COPY=4096', '-DRANDOM_SIZES', '-DTEST_MEMMOVE', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
+
+  def test_memset_random_4k(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memset_random_4k', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DMIN_COPY=16', '-DMAX_COPY=4096', '-DRANDOM_SIZES', '-DBUILD_FOR_SHELL', '-I'+path_from_root('tests')])
+
+  def test_strlen(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('strlen', open(path_from_root('tests', 'benchmark_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_STRLEN', '-DMAX_SIZE=65536', '-I'+path_from_root('tests')])
+
+  def test_memchr(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memchr', open(path_from_root('tests', 'benchmark_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_MEMCHR', '-DMAX_SIZE=65536', '-I'+path_from_root('tests')])
+
+  def test_memcmp(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcmp', open(path_from_root('tests', 'benchmark_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_MEMCMP', '-DMAX_SIZE=65536', '-I'+path_from_root('tests')])
+
+  def test_float_format(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('float_format', open(path_from_root('tests', 'benchmark_float_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_FORMAT', '-DMAX_EXP=20', '-I'+path_from_root('tests')])
+
+  def test_float_format_fast(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('float_format_fast', open(path_from_root('tests', 'benchmark_float_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_FORMAT', '-DMAX_EXP=20', '-I'+path_from_root('tests')], emcc_args=['-s', 'FAST_FLOAT_CONVERSION=1'])
+
+  def test_float_parse(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('float_parse', open(path_from_root('tests', 'benchmark_float_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_PARSE', '-DMAX_EXP=20', '-I'+path_from_root('tests')])
+
+  def test_float_parse_fast(self):
+    if CORE_BENCHMARKS: return
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('float_parse_fast', open(path_from_root('tests', 'benchmark_float_strings.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-DTEST_PARSE', '-DMAX_EXP=20', '-I'+path_from_root('tests')], emcc_args=['-s', 'FAST_FLOAT_CONVERSION=1'])
+
   def test_matrix_multiply(self):
     def output_parser(output):
       return float(re.search('Total elapsed: ([\d\.]+)', output).group(1))
     self.do_benchmark('matrix_multiply', open(path_from_root('tests', 'matrix_multiply.cpp')).read(), '''Total time:''', output_parser=output_parser, shared_args=['-I'+path_from_root('tests')])
 
+  def test_atomic_u64(self):
+    if CORE_BENCHMARKS: return
+    src = r'''
+      #include <stdio.h>
+      #include <stdint.h>
+      int main(int argc, char **argv) {
+        int arg = argc > 1 ? argv[1][0] - '0' : 3;
+        switch(arg) {
+          case 0: return 0; break;
+          case 1: arg = 1000000; break;
+          case 2: arg = 5000000; break;
+          case 3: arg = 10000000; break;
+          case 4: arg = 20000000; break;
+          case 5: arg = 50000000; break;
+          default: printf("error: %d\\n", arg); return -1;
+        }
+
+        static uint64_t counters[64];
+        uint64_t seq = 0;
+        for (int i = 0; i < arg; i++) {
+          uint64_t *c = &counters[i & 63];
+          __atomic_fetch_add(c, ((uint64_t)i << 24) + 1, __ATOMIC_SEQ_CST);
+          uint64_t expected = __atomic_load_n(c, __ATOMIC_SEQ_CST);
+          __atomic_compare_exchange_n(c, &expected, expected ^ seq, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+          seq = __atomic_exchange_n(&counters[(i + 7) & 63], seq + expected, __ATOMIC_SEQ_CST);
+        }
+        uint64_t sum = seq;
+        for (int i = 0; i < 64; i++) sum += __atomic_load_n(&counters[i], __ATOMIC_SEQ_CST);
+        printf("sum: %llu.\n", (unsigned long long)sum);
+        return 0;
+      }
+    '''
+    self.do_benchmark('atomic_u64', src, 'sum:', emcc_args=['-s', 'USE_PTHREADS=1'], force_c=True)
+
+  def test_asyncify_overhead(self):
+    if CORE_BENCHMARKS: return
+    src = open(path_from_root('tests', 'benchmark_asyncify.c')).read()
+    for name, emcc_args in [('asyncify_none', []),
+                            ('asyncify', ['-s', 'ASYNCIFY=1']),
+                            ('asyncify_pruned', ['-s', 'ASYNCIFY=1', '-s', 'ASYNCIFY_PRUNE_INDIRECT_CALLS=1'])]:
+      self.do_benchmark(name, src, 'Result:', emcc_args=emcc_args, force_c=True)
+
+  def test_fibers(self):
+    if CORE_BENCHMARKS: return
+    src = open(path_from_root('tests', 'benchmark_fibers.c')).read()
+    emterpretify_async = ['-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_ASYNC=1']
+    self.do_benchmark('fibers', src, 'Result:', emcc_args=emterpretify_async, force_c=True)
+    self.do_benchmark('fibers_coroutines', src, 'Result:', emcc_args=emterpretify_async + ['-DUSE_COROUTINES'], force_c=True)
+
+  def do_pthreads_benchmark(self, kind, index, threads=4):
+    def output_parser(output):
+      return float(re.search('Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('pthreads_' + kind, open(path_from_root('tests', 'benchmark_pthreads.cpp')).read(), 'Total time:', output_parser=output_parser, threaded=True,
+                      emcc_args=['-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=8'], native_args=['-pthread'],
+                      shared_args=['-DBENCHMARK_PTHREADS=%d' % index, '-DTHREADS=%d' % threads, '-I' + path_from_root('tests')])
+
+  def test_pthreads_mutex_contention(self):
+    if CORE_BENCHMARKS: return
+    self.do_pthreads_benchmark('mutex_contention', 0)
+
+  def test_pthreads_futex_ping_pong(self):
+    if CORE_BENCHMARKS: return
+    self.do_pthreads_benchmark('futex_ping_pong', 1)
+
+  def test_pthreads_main_thread_round_trip(self):
+    if CORE_BENCHMARKS: return
+    self.do_pthreads_benchmark('main_thread_round_trip', 2)
+
+  def test_pthreads_proxied_syscall(self):
+    if CORE_BENCHMARKS: return
+    self.do_pthreads_benchmark('proxied_syscall', 3)
+
+  def test_pthreads_parallel_for(self):
+    if CORE_BENCHMARKS: return
+    for threads in [1, 2, 4, 8]:
+      self.do_pthreads_benchmark('parallel_for_%d' % threads, 4, threads)
+
+  def test_pthreads_atomic_counter(self):
+    if CORE_BENCHMARKS: return
+    for threads in [1, 2, 4, 8]:
+      self.do_pthreads_benchmark('atomic_counter_%d' % threads, 5, threads)
+
+  def test_malloc(self):
+    if CORE_BENCHMARKS: return
+    src = r'''
+      #include <stdio.h>
+      #include <stdlib.h>
+      int main(int argc, char **argv) {
+        int arg = argc > 1 ? argv[1][0] - '0' : 3;
+        switch(arg) {
+          case 0: return 0; break;
+          case 1: arg = 200; break;
+          case 2: arg = 1000; break;
+          case 3: arg = 2000; break;
+          case 4: arg = 4000; break;
+          case 5: arg = 10000; break;
+          default: printf("error: %d\n", arg); return -1;
+        }
+
+        // A mix of short-lived small objects and longer-lived buffers, like a typical workload.
+        static void *ptrs[4096];
+        unsigned seed = 1, sum = 0;
+        for (int i = 0; i < arg; i++) {
+          for (int j = 0; j < 4096; j++) {
+            seed = seed * 1103515245 + 12345;
+            int size = (seed >> 16) % ((j & 15) ? 128 : 4096);
+            if (ptrs[j]) free(ptrs[j]);
+            ptrs[j] = malloc(size + 1);
+            *(char*)ptrs[j] = j;
+          }
+          for (int j = 0; j < 4096; j += 3) sum += *(char*)ptrs[j];
+        }
+        for (int j = 0; j < 4096; j++) free(ptrs[j]);
+        printf("sum: %u.\n", sum);
+        return 0;
+      }
+    '''
+    self.do_benchmark('malloc', src, 'sum:', force_c=True)
+    self.do_benchmark('malloc_compact', src, 'sum:', emcc_args=['-s', 'COMPACT_MALLOC=1'], force_c=True)
+
+  def test_i64_hash(self):
+    if CORE_BENCHMARKS: return
+    src = r'''
+      #include <stdio.h>
+      #include <stdint.h>
+      #include <string.h>
+      #define P1 11400714785074694791ULL
+      #define P2 14029467366897019727ULL
+      #define P3 1609587929392839161ULL
+      #define P4 9650029242287828579ULL
+      #define P5 2870177450012600261ULL
+      static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+      static uint64_t read64(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+      static uint64_t round64(uint64_t acc, uint64_t in) { return rotl(acc + in * P2, 31) * P1; }
+      static uint64_t merge64(uint64_t acc, uint64_t v) { return (acc ^ round64(0, v)) * P1 + P4; }
+      // xxhash64, whose inner loop is 64-bit multiplies and rotates
+      static uint64_t xxh64(const unsigned char *p, size_t len, uint64_t seed) {
+        const unsigned char *end = p + len;
+        uint64_t h;
+        if (len >= 32) {
+          uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+          for (; p + 32 <= end; p += 32) {
+            v1 = round64(v1, read64(p)); v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16)); v4 = round64(v4, read64(p + 24));
+          }
+          h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+          h = merge64(merge64(merge64(merge64(h, v1), v2), v3), v4);
+        } else {
+          h = seed + P5;
+        }
+        h += len;
+        for (; p + 8 <= end; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * P1 + P4;
+        for (; p < end; p++) h = rotl(h ^ (*p * P5), 11) * P1;
+        h ^= h >> 33; h *= P2; h ^= h >> 29; h *= P3; h ^= h >> 32;
+        return h;
+      }
+      #define TABLE_SIZE 40009 // prime, so probing uses a 64-bit modulo
+      static uint64_t table[TABLE_SIZE];
+      int main(int argc, char **argv) {
+        int arg = argc > 1 ? argv[1][0] - '0' : 3;
+        switch(arg) {
+          case 0: return 0; break;
+          case 1: arg = 30; break;
+          case 2: arg = 150; break;
+          case 3: arg = 300; break;
+          case 4: arg = 800; break;
+          case 5: arg = 1500; break;
+          default: printf("error: %d\n", arg); return -1;
+        }
+
+        static unsigned char buf[1024];
+        for (int i = 0; i < sizeof(buf); i++) buf[i] = i * 131 + 7;
+        uint64_t sum = 0;
+        unsigned found = 0;
+        for (int i = 0; i < arg; i++) {
+          // hash keys of varying length, and insert or look them up in an open-addressing table
+          memset(table, 0, sizeof(table));
+          for (int j = 0; j < 30000; j++) {
+            int key = j % 20000; // each key is seen once or twice
+            uint64_t h = xxh64(buf + (key & 511), 8 + (key * 7 & 255), key) | 1;
+            uint64_t k = h % TABLE_SIZE;
+            while (table[k] && table[k] != h) k = (k + 1) % TABLE_SIZE;
+            if (table[k]) found++;
+            table[k] = h;
+            sum += h;
+          }
+        }
+        printf("sum: %llu, found: %u.\n", (unsigned long long)sum, found);
+        return 0;
+      }
+    '''
+    self.do_benchmark('i64_hash', src, 'sum:', force_c=True)
+
+  def test_ostream_numbers(self):
+    if CORE_BENCHMARKS: return
+    src = r'''
+      #include <stdio.h>
+      #include <sstream>
+      int main(int argc, char **argv) {
+        int arg = argc > 1 ? argv[1][0] - '0' : 3;
+        switch(arg) {
+          case 0: return 0; break;
+          case 1: arg = 20; break;
+          case 2: arg = 100; break;
+          case 3: arg = 200; break;
+          case 4: arg = 500; break;
+          case 5: arg = 1000; break;
+          default: printf("error: %d\n", arg); return -1;
+        }
+
+        // Log-style output: a few numbers per line into a reused stream
+        std::ostringstream out;
+        size_t total = 0;
+        for (int i = 0; i < arg; i++) {
+          for (int j = 0; j < 10000; j++) {
+            out << "frame " << i << " item " << j << " size " << (j * 37u) << " offset " << (long long)i * j * 1000003LL
+                << " ratio " << j * 0.25 << '\n';
+          }
+          total += out.str().size();
+          out.str("");
+        }
+        printf("total: %u.\n", (unsigned)total);
+        return 0;
+      }
+    '''
+    self.do_benchmark('ostream_numbers', src, 'total:')
+    self.do_benchmark('ostream_numbers_c_locale', src, 'total:', emcc_args=['-s', 'LIBCXX_C_LOCALE_ONLY=1'])
+
   def test_zzz_java_nbody(self): # tests xmlvm compiled java, including bitcasts of doubles, i64 math, etc.
     if CORE_BENCHMARKS: return
     args = [path_from_root('tests', 'nbody-java', x) for x in os.listdir(path_from_root('tests', 'nbody-java')) if x.endswith('.c')] + \
@@ -913,13 +1419,17 @@ class benchmark(RunnerCore):
     self.do_benchmark('zlib', src, '''ok.''',
                       force_c=True, shared_args=['-I' + path_from_root('tests', 'zlib')], lib_builder=lib_builder)
 
-  def test_zzz_box2d(self): # Called thus so it runs late in the alphabetical cycle... it is long
+  def box2d(self):
     src = open(path_from_root('tests', 'box2d', 'Benchmark.cpp'), 'r').read()
     def lib_builder(name, native, env_init):
       return self.get_library('box2d', [os.path.join('box2d.a')], configure=None, native=native, cache_name_extra=name, env_init=env_init)
-    self.do_benchmark('box2d', src, 'frame averages', shared_args=['-I' + path_from_root('tests', 'box2d')], lib_builder=lib_builder)
+    return src, ['-I' + path_from_root('tests', 'box2d')], lib_builder
 
-  def test_zzz_bullet(self): # Called thus so it runs late in the alphabetical cycle... it is long
+  def test_zzz_box2d(self): # Called thus so it runs late in the alphabetical cycle... it is long
+    src, shared_args, lib_builder = self.box2d()
+    self.do_benchmark('box2d', src, 'frame averages', shared_args=shared_args, lib_builder=lib_builder)
+
+  def bullet(self):
     src = open(path_from_root('tests', 'bullet', 'Demos', 'Benchmarks', 'BenchmarkDemo.cpp'), 'r').read() + \
           open(path_from_root('tests', 'bullet', 'Demos', 'Benchmarks', 'main.cpp'), 'r').read()
 
@@ -929,8 +1439,21 @@ class benchmark(RunnerCore):
                                          os.path.join('src', '.libs', 'libLinearMath.a')],
                               configure_args=['--disable-demos','--disable-dependency-tracking'], native=native, cache_name_extra=name, env_init=env_init)
 
-    self.do_benchmark('bullet', src, '\nok.\n', shared_args=['-I' + path_from_root('tests', 'bullet', 'src'),
-                                '-I' + path_from_root('tests', 'bullet', 'Demos', 'Benchmarks')], lib_builder=lib_builder)
+    return src, ['-I' + path_from_root('tests', 'bullet', 'src'), '-I' + path_from_root('tests', 'bullet', 'Demos', 'Benchmarks')], lib_builder
+
+  def test_zzz_bullet(self): # Called thus so it runs late in the alphabetical cycle... it is long
+    src, shared_args, lib_builder = self.bullet()
+    self.do_benchmark('bullet', src, '\nok.\n', shared_args=shared_args, lib_builder=lib_builder)
+
+  def test_zzz_startup_box2d(self):
+    if CORE_BENCHMARKS: return
+    src, shared_args, lib_builder = self.box2d()
+    self.do_startup_benchmark('startup_box2d', src, shared_args=shared_args, lib_builder=lib_builder)
+
+  def test_zzz_startup_bullet(self):
+    if CORE_BENCHMARKS: return
+    src, shared_args, lib_builder = self.bullet()
+    self.do_startup_benchmark('startup_bullet', src, shared_args=shared_args, lib_builder=lib_builder)
 
   def zzz_test_zzz_lzma(self):
     src = open(path_from_root('tests', 'lzma', 'benchmark.c'), 'r').read()
@@ -1,7 +1,7 @@
 # coding=utf-8
 
 from __future__ import print_function
-import multiprocessing, os, shutil, subprocess, unittest, zlib, webbrowser, time, shlex
+import multiprocessing, os, shutil, struct, subprocess, unittest, zlib, webbrowser, time, shlex
 from runner import BrowserCore, path_from_root, has_browser, get_browser
 from tools.shared import *
 
@@ -348,7 +348,9 @@ If manually bisecting:
     self.run_browser(page_file, '|load me right before|.', '/report_result?0')
 
   def test_preload_caching(self):
-    open(os.path.join(self.get_dir(), 'somefile.txt'), 'w').write('''load me right before running the code please''')
+    import random
+    # the package is cached by a hash of its contents, so make them unique to find it uncached on the first run
+    open(os.path.join(self.get_dir(), 'somefile.txt'), 'w').write('''load me right before running the code please''' + str(random.random()))
     def make_main(path):
       print(path)
       open(os.path.join(self.get_dir(), 'main.cpp'), 'w').write(self.with_report_result(r'''
@@ -399,7 +401,8 @@ If manually bisecting:
     self.run_browser('page.html', 'You should see |load me right before|.', '/report_result?2')
 
   def test_preload_caching_indexeddb_name(self):
-    open(os.path.join(self.get_dir(), 'somefile.txt'), 'w').write('''load me right before running the code please''')
+    import random
+    open(os.path.join(self.get_dir(), 'somefile.txt'), 'w').write('''load me right before running the code please''' + str(random.random()))
     def make_main(path):
       print(path)
       open(os.path.join(self.get_dir(), 'main.cpp'), 'w').write(self.with_report_result(r'''
@@ -596,6 +599,9 @@ If manually bisecting:
   def test_sdl_swsurface(self):
     self.btest('sdl_swsurface.c', args=['-lSDL', '-lGL'], expected='1')
 
+  def test_sdl_unlock_heap_image(self):
+    self.btest('sdl_unlock_heap_image.c', args=['-s', 'ALLOW_MEMORY_GROWTH=1', '-lSDL', '-lGL'], expected='1')
+
   def test_sdl_surface_lock_opts(self):
     # Test Emscripten-specific extensions to optimize SDL_LockSurface and SDL_UnlockSurface.
     self.btest('hello_world_sdl.cpp', reference='htmltest.png', message='You should see "hello, world!" and a colored cube.', args=['-DTEST_SDL_LOCK_OPTS', '-lSDL', '-lGL'])
@@ -614,6 +620,16 @@ If manually bisecting:
         ]).communicate()
         self.run_browser('page.html', '', '/report_result?600')
 
+  def test_sdl_image_workers(self):
+    # decode the preloaded image in a worker, when the browser can
+    shutil.copyfile(path_from_root('tests', 'screenshot.jpg'), os.path.join(self.get_dir(), 'screenshot.jpg'))
+    open(os.path.join(self.get_dir(), 'sdl_image.c'), 'w').write(self.with_report_result(open(path_from_root('tests', 'sdl_image.c')).read()))
+    Popen([
+      PYTHON, EMCC, os.path.join(self.get_dir(), 'sdl_image.c'), '-o', 'page.html', '-lSDL', '-lGL', '-s', 'PRELOAD_IMAGE_WORKERS=2',
+      '--preload-file', 'screenshot.jpg', '-DSCREENSHOT_DIRNAME="/"', '-DSCREENSHOT_BASENAME="screenshot.jpg"', '--use-preload-plugins'
+    ]).communicate()
+    self.run_browser('page.html', '', '/report_result?600')
+
   def test_sdl_image_jpeg(self):
     shutil.copyfile(path_from_root('tests', 'screenshot.jpg'), os.path.join(self.get_dir(), 'screenshot.jpeg'))
     open(os.path.join(self.get_dir(), 'sdl_image_jpeg.c'), 'w').write(self.with_report_result(open(path_from_root('tests', 'sdl_image.c')).read()))
@@ -740,6 +756,11 @@ window.close = function() {
     copy('three', lambda original: re.sub(r'function _main\(\$(.+),\$(.+)\) {', r'function _main($\1,$\2) { if (ENVIRONMENT_IS_WORKER) { var xhr = new XMLHttpRequest(); xhr.open("GET", "http://localhost:%s/report_result?999");xhr.send(); return; }' % self.test_port, original))
     self.run_browser('three.html?noProxy', None, ['/report_result?0']) # this is still cool
 
+  @requires_hardware
+  def test_glgears_proxy_offscreencanvas(self):
+    # the worker renders to the transferred canvas directly when the browser supports it, otherwise GL calls are proxied
+    self.btest('hello_world_gles_proxy.c', reference='gears.png', args=['--proxy-to-worker', '-s', 'OFFSCREENCANVAS_SUPPORT=1', '-s', 'GL_TESTING=1', '-DSTATIC_GEARS=1', '-lGL', '-lglut'], manual_reference=True, post_build=self.post_manual_reftest)
+
   @requires_hardware
   def test_glgears_proxy_jstarget(self):
     # test .js target with --proxy-worker; emits 2 js files, client and worker
@@ -1241,6 +1262,18 @@ keydown(100);keyup(100); // trigger the end
         self.btest(path_from_root('tests', 'fs', 'test_idbfs_sync.c'), '1', force_c=True, args=mode + ['-lidbfs.js', '-DFIRST', '-DSECRET=\"' + secret + '\"', '-s', '''EXPORTED_FUNCTIONS=['_main', '_test', '_success']'''])
         self.btest(path_from_root('tests', 'fs', 'test_idbfs_sync.c'), '1', force_c=True, args=mode + ['-lidbfs.js', '-DSECRET=\"' + secret + '\"', '-s', '''EXPORTED_FUNCTIONS=['_main', '_test', '_success']'''] + extra)
 
+  def test_fs_opfs_sync(self):
+    secret = str(time.time())
+    args = ['-lopfs.js', '--proxy-to-worker', '-DSECRET=\"' + secret + '\"', '-s', '''EXPORTED_FUNCTIONS=['_main', '_test', '_success']''']
+    self.btest(path_from_root('tests', 'fs', 'test_opfs_sync.c'), '1', force_c=True, args=args + ['-DFIRST'])
+    self.btest(path_from_root('tests', 'fs', 'test_opfs_sync.c'), '1', force_c=True, args=args)
+
+  def test_fs_idbfs_incremental(self):
+    for mode in [[], ['-s', 'MEMFS_APPEND_TO_TYPED_ARRAYS=1']]:
+      secret = str(time.time())
+      self.btest(path_from_root('tests', 'fs', 'test_idbfs_incremental.c'), '1', force_c=True, args=mode + ['-lidbfs.js', '-DFIRST', '-DSECRET=\"' + secret + '\"', '-s', '''EXPORTED_FUNCTIONS=['_main', '_test', '_second_sync', '_success']'''])
+      self.btest(path_from_root('tests', 'fs', 'test_idbfs_incremental.c'), '1', force_c=True, args=mode + ['-lidbfs.js', '-DSECRET=\"' + secret + '\"', '-s', '''EXPORTED_FUNCTIONS=['_main', '_test', '_second_sync', '_success']'''])
+
   def test_fs_idbfs_fsync(self):
     # sync from persisted state into memory before main()
     open(os.path.join(self.get_dir(), 'pre.js'), 'w').write('''
@@ -1346,6 +1379,12 @@ keydown(100);keyup(100); // trigger the end
       self.clear()
       self.btest(path_from_root('tests', 'idbstore.c'), str(stage), force_c=True, args=['-lidbstore.js', '-DSTAGE=' + str(stage), '-DSECRET=\"' + secret + '\"'])
 
+  def test_idbstore_many(self):
+    secret = str(time.time())
+    for stage in [0, 1]:
+      self.clear()
+      self.btest(path_from_root('tests', 'idbstore_many.c'), str(stage), force_c=True, args=['-lidbstore.js', '-DSTAGE=' + str(stage), '-DSECRET=\"' + secret + '\"'])
+
   def test_idbstore_sync(self):
     secret = str(time.time())
     self.clear()
@@ -1612,6 +1651,12 @@ keydown(100);keyup(100); // trigger the end
   def test_fulles2_sdlproc(self):
     self.btest('full_es2_sdlproc.c', '1', args=['-s', 'GL_TESTING=1', '-DHAVE_BUILTIN_SINCOS', '-s', 'FULL_ES2=1', '-lGL', '-lSDL', '-lglut'])
 
+  @requires_hardware
+  def test_fulles2_client_arrays(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1'], ['-s', 'GL_ASSERTIONS=1']]:
+      print(opts)
+      self.btest('full_es2_client_arrays.c', '0', args=opts + ['-s', 'FULL_ES2=1', '-lGL'])
+
   @requires_hardware
   def test_glgears_deriv(self):
     self.btest('hello_world_gles_deriv.c', reference='gears.png', reference_slack=2,
@@ -1725,6 +1770,10 @@ keydown(100);keyup(100); // trigger the end
     for args in [[], ['--proxy-to-worker'], ['-s', 'USE_PTHREADS=1', '-s', 'PROXY_TO_PTHREAD=1']]:
       self.btest('emscripten_main_loop_setimmediate.cpp', '1', args=args)
 
+  def test_emscripten_set_idle_callback(self):
+    for args in [[], ['--proxy-to-worker']]:
+      self.btest('emscripten_set_idle_callback.cpp', '1', args=args)
+
   def test_fs_after_main(self):
     for args in [[], ['-O1']]:
       self.btest('fs_after_main.cpp', '0', args=args)
@@ -1746,6 +1795,12 @@ keydown(100);keyup(100); // trigger the end
   def test_sdlglshader(self):
     self.btest('sdlglshader.c', reference='sdlglshader.png', args=['-O2', '--closure', '1', '-s', 'LEGACY_GL_EMULATION=1', '-lGL', '-lSDL'])
 
+  @requires_hardware
+  def test_gl_immediate_batching(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1'], ['-s', 'GL_FFP_ONLY=1']]:
+      print(opts)
+      self.btest('gl_immediate_batching.c', expected='1', args=opts + ['-s', 'LEGACY_GL_EMULATION=1', '-lGL', '-lSDL'])
+
   @requires_hardware
   def test_sdlglshader2(self):
     self.btest('sdlglshader2.c', expected='1', args=['-s', 'LEGACY_GL_EMULATION=1', '-lGL', '-lSDL'], also_proxied=True)
@@ -2149,6 +2204,35 @@ void *getBindBuffer() {
     test('test.html.mem', '1')
     test('nothing.nowhere', '0')
 
+  # The generated HTML starts downloading the wasm, the memory init file and the file package before the JS arrives.
+  def test_early_fetches(self):
+    open(os.path.join(self.get_dir(), 'somefile.txt'), 'w').write('load me early')
+    open(os.path.join(self.get_dir(), 'pre.js'), 'w').write('''
+      Module['preRun'].push(function() {
+        // the requests were there when the script started, and have been taken by now
+        Module['_earlyFetches'] = !!Module['dataFileRequests'] && !Module['dataFileRequests']['page.data'] && !Module['wasmBinaryRequest'];
+      });
+    ''')
+    open(os.path.join(self.get_dir(), 'main.cpp'), 'w').write(self.with_report_result(r'''
+      #include <stdio.h>
+      #include <string.h>
+      #include <emscripten.h>
+      int main() {
+        FILE *f = fopen("somefile.txt", "r");
+        char buf[100];
+        buf[fread(buf, 1, 99, f)] = 0;
+        fclose(f);
+        printf("|%s|\n", buf);
+        int result = !strcmp("load me early", buf) && EM_ASM_INT({ return Module['_earlyFetches'] });
+        REPORT_RESULT(result);
+        return 0;
+      }
+    '''))
+    for args in [[], ['-s', 'WASM=1'], ['-s', 'WASM=1', '-s', 'BINARYEN_ASYNC_COMPILATION=0']]:
+      print(args)
+      run_process([PYTHON, EMCC, 'main.cpp', '--preload-file', 'somefile.txt', '--pre-js', 'pre.js', '-O2', '-o', 'page.html'] + args)
+      self.run_browser('page.html', '', '/report_result?1')
+
   def test_runtime_misuse(self):
     post_prep = '''
       var expected_ok = false;
@@ -2405,6 +2489,22 @@ Module["preRun"].push(function () {
       print(opts)
       self.btest(path_from_root('tests', 'webgl_shader_source_length.cpp'), args=opts + ['-lGL'], expected='0', timeout=20)
 
+  @requires_hardware
+  def test_webgl_state_cache(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1'], ['-s', 'FULL_ES2=1']]:
+      print(opts)
+      self.btest(path_from_root('tests', 'webgl_state_cache.cpp'), args=opts + ['-s', 'GL_STATE_CACHE=1', '-lGL'], expected='0', timeout=20)
+
+  def test_webgl_program_prefetch(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1']]:
+      print(opts)
+      self.btest(path_from_root('tests', 'webgl_program_prefetch.c'), args=opts + ['-s', 'GL_PROGRAM_CACHE=1', '-lGL'], expected='0', timeout=20)
+
+  def test_webgl_large_uniform_arrays(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1'], ['-s', 'USE_WEBGL2=1']]:
+      print(opts)
+      self.btest(path_from_root('tests', 'webgl_large_uniform_arrays.c'), args=opts + ['-s', 'ALLOW_MEMORY_GROWTH=1', '-lGL'], expected='0', timeout=20)
+
   def test_webgl2(self):
     for opts in [[], ['-O2', '-g1', '--closure', '1'], ['-s', 'FULL_ES2=1']]:
       print(opts)
@@ -2421,6 +2521,12 @@ Module["preRun"].push(function () {
     self.btest(path_from_root('tests', 'webgl2_garbage_free_entrypoints.cpp'), args=['-s', 'USE_WEBGL2=1', '-DTEST_WEBGL2=1'], expected='1')
     self.btest(path_from_root('tests', 'webgl2_garbage_free_entrypoints.cpp'), expected='1')
 
+  @requires_hardware
+  def test_webgl2_pbo_upload(self):
+    for opts in [[], ['-s', 'GL_PBO_UPLOAD_THRESHOLD=4096']]:
+      print(opts)
+      self.btest(path_from_root('tests', 'webgl2_pbo_upload.c'), args=['-s', 'USE_WEBGL2=1', '-lGL'] + opts, expected='0')
+
   @requires_hardware
   def test_webgl2_backwards_compatibility_emulation(self):
     self.btest(path_from_root('tests', 'webgl2_backwards_compatibility_emulation.cpp'), args=['-s', 'USE_WEBGL2=1', '-s', 'WEBGL2_BACKWARDS_COMPATIBILITY_EMULATION=1'], expected='0')
@@ -2439,6 +2545,11 @@ Module["preRun"].push(function () {
       print(opts)
       self.btest(path_from_root('tests', 'test_html5_mouse.c'), args=opts + ['-DAUTOMATE_SUCCESS=1'], expected='0')
 
+  def test_html5_coalesced_events(self):
+    for opts in [[], ['-O2', '-g1', '--closure', '1']]:
+      print(opts)
+      self.btest(path_from_root('tests', 'test_html5_coalesced_events.c'), args=opts + ['-s', 'HTML5_COALESCE_EVENTS=1'], expected='0')
+
   def test_sdl_mousewheel(self):
     for opts in [[], ['-O2', '-g1', '--closure', '1']]:
       print(opts)
@@ -3321,6 +3432,11 @@ window.close = function() {
   def test_pthread_malloc_free(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_malloc_free.cpp'), expected='0', args=['-s', 'TOTAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'TOTAL_MEMORY=256MB'], timeout=30)
 
+  # Test the per-thread malloc caches with the same stress tests: blocks allocated on one thread are freed on others.
+  def test_pthread_malloc_thread_cache(self):
+    for test in ['test_pthread_malloc.cpp', 'test_pthread_malloc_free.cpp']:
+      self.btest(path_from_root('tests', 'pthread', test), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'TOTAL_MEMORY=256MB', '-s', 'MALLOC_THREAD_CACHE=1'], timeout=30)
+
   # Test that the pthread_barrier API works ok.
   def test_pthread_barrier(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_barrier.cpp'), expected='0', args=['-s', 'TOTAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=8'], timeout=30)
@@ -3347,6 +3463,10 @@ window.close = function() {
   def test_pthread_condition_variable(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_condition_variable.cpp'), expected='0', args=['-s', 'TOTAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=8'], timeout=30)
 
+  # Test that condition variable broadcasts and reused barriers wake all their waiters, the main browser thread among them.
+  def test_pthread_broadcast_barrier(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_broadcast_barrier.c'), expected='0', args=['-s', 'TOTAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=8'], timeout=30)
+
   # Test that pthreads are able to do printf.
   def test_pthread_printf(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_printf.cpp'), expected='0', args=['-s', 'TOTAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS=2', '--separate-asm', '-s', 'PTHREAD_POOL_SIZE=1'], timeout=30)
@@ -3432,6 +3552,10 @@ window.close = function() {
       # With aborting malloc = 0, allocate so much memory in threads that some of the allocations fail.
       self.btest(path_from_root('tests', 'pthread', 'test_pthread_sbrk.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=8', '--separate-asm', '-s', 'ABORTING_MALLOC=' + str(aborting_malloc), '-DABORTING_MALLOC=' + str(aborting_malloc), '-s', 'TOTAL_MEMORY=128MB'], timeout=30)
 
+  # Test that sbrk() grows the shared memory when threads allocate more than the initial heap
+  def test_pthread_sbrk_memory_growth(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_sbrk.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'WASM=1', '-s', 'ALLOW_MEMORY_GROWTH=1', '-s', 'TOTAL_MEMORY=32MB', '-s', 'WASM_MEM_MAX=256MB', '-DABORTING_MALLOC=1'], timeout=30)
+
   # Test that -s ABORTING_MALLOC=0 works in both pthreads and non-pthreads builds. (sbrk fails gracefully)
   def test_pthread_gauge_available_memory(self):
     for opts in [[], ['-O2']]:
@@ -3446,6 +3570,41 @@ window.close = function() {
   def test_pthread_run_on_main_thread_flood(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_run_on_main_thread_flood.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm'], timeout=30)
 
+  # Test proxying calls with generic signatures, and C++ lambdas, to the main thread.
+  def test_pthread_run_on_main_thread_generic(self):
+    for args in [[], ['-s', 'PRECISE_F32=1']]:
+      self.btest(path_from_root('tests', 'pthread', 'test_pthread_run_on_main_thread_generic.cpp'), expected='0', args=['-O3', '-std=c++11', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm'] + args, timeout=30)
+
+  # Test that many threads can post proxied calls to the main thread at the same time, without the calls of any one thread
+  # being reordered or lost.
+  def test_pthread_run_on_main_thread_concurrent(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_run_on_main_thread_concurrent.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=4', '--separate-asm'], timeout=30)
+
+  # Test that pthreads can dispatch calls to each other's mailboxes.
+  def test_pthread_dispatch_to_thread(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_dispatch_to_thread.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=2', '--separate-asm'], timeout=30)
+
+  # Test posting messages from a pthread to a JS handler on the main thread, both in transferred ArrayBuffers and as views of the heap.
+  def test_pthread_channel(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_channel.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm'], timeout=30)
+
+  # Test that the pool of unused workers is filled up to PTHREAD_POOL_LOW_WATER_MARK in the background, and topped back up after a burst of pthread_create() calls.
+  def test_pthread_pool_low_water_mark(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_pool_low_water_mark.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_LOW_WATER_MARK=4', '--separate-asm'], timeout=30)
+
+  # Test the statistics of the waits of the main thread on a contended mutex, with spinning and with async waits.
+  def test_pthread_main_thread_futex_wait_stats(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_main_thread_futex_wait_stats.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm'], timeout=30)
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_main_thread_futex_wait_stats.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm', '-s', 'ASYNCIFY=1', '-s', 'PTHREADS_MAIN_THREAD_ASYNC_WAIT=10', '-DEXPECT_ASYNC_WAITS'], timeout=30)
+
+  # Test that GL calls that a pthread records into a command buffer are replayed on the main thread in order, with the data they were recorded with.
+  def test_gl_command_buffer(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_gl_command_buffer.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=1', '--separate-asm'], timeout=30)
+
+  # Test the work-stealing task scheduler with parallel_for and recursive fork/join tasks.
+  def test_task_scheduler(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_task_scheduler.c'), expected='0', args=['-O3', '-s', 'USE_PTHREADS=2', '-s', 'PTHREAD_POOL_SIZE=4', '--separate-asm'], timeout=60)
+
   # Test that it is possible to synchronously call a JavaScript function on the main thread and get a return value back.
   def test_pthread_call_sync_on_main_thread(self):
     self.btest(path_from_root('tests', 'pthread', 'call_sync_on_main_thread.c'), expected='1', args=['-O3', '-s', 'USE_PTHREADS=1', '-s', 'PROXY_TO_PTHREAD=1', '-DPROXY_TO_PTHREAD=1', '--js-library', path_from_root('tests', 'pthread', 'call_sync_on_main_thread.js')])
@@ -3468,6 +3627,14 @@ window.close = function() {
   def test_pthread_clock_drift(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_clock_drift.cpp'), expected='1', args=['-O3', '-s', 'USE_PTHREADS=1', '-s', 'PROXY_TO_PTHREAD=1'])
 
+  # Test that --threadprofiler records a timeline of the status changes of each thread.
+  def test_pthread_thread_timeline(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_thread_timeline.c'), expected='1', args=['-O2', '-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=2', '--threadprofiler'])
+
+  # Test that -s SAMPLING_PROFILER samples the functions that run on the main thread.
+  def test_pthread_sampling_profiler(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_sampling_profiler.c'), expected='1', args=['-O2', '-s', 'USE_PTHREADS=1', '-s', 'SAMPLING_PROFILER=1', '--profiling-funcs'])
+
   # test atomicrmw i64
   def test_atomicrmw_i64(self):
     Popen([PYTHON, EMCC, path_from_root('tests', 'atomicrmw_i64.ll'), '-s', 'USE_PTHREADS=1', '-s', 'IN_TEST_HARNESS=1', '-o', 'test.html']).communicate()
@@ -3563,6 +3730,11 @@ window.close = function() {
     self.btest('browser_test_hello_world.c', expected='0', args=['-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_FILE="code.dat"', '-O2', '-g', '-s', 'ASSERTIONS=1'])
     assert os.path.exists('code.dat')
 
+    # loaded lazily, in segments, with synchronous range requests on the main thread
+    try_delete('code.dat');
+    self.btest('browser_test_hello_world.c', expected='0', args=['-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_FILE="code.dat"', '-s', 'EMTERPRETIFY_FILE_SEGMENT_SIZE=1024', '-O2', '-g', '-s', 'ASSERTIONS=1'])
+    assert os.path.exists('code.dat')
+
   def test_vanilla_html_when_proxying(self):
     for opts in [0, 1, 2]:
       print(opts)
@@ -3705,6 +3877,17 @@ window.close = function() {
     shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
     self.btest('fetch/to_memory.cpp', expected='1', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
 
+  # Tests emscripten_fetch() usage to XHR data to a buffer that the caller provides.
+  def test_fetch_to_destination_buffer(self):
+    shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
+    self.btest('fetch/to_destination_buffer.cpp', expected='1', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
+  # Tests that identical emscripten_fetch() GETs share an XHR, and that XHRs are sent in the order of their priority.
+  def test_fetch_coalesce_and_priority(self):
+    for name in ['gears.png', 'gears2.png', 'gears3.png']:
+      shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), name))
+    self.btest('fetch/coalesce_and_priority.cpp', expected='1', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
   # Tests emscripten_fetch() usage to persist an XHR into IndexedDB and subsequently load up from there.
   def test_fetch_cached_xhr(self):
     shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
@@ -3728,9 +3911,47 @@ window.close = function() {
     shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
     self.btest('fetch/sync_xhr.cpp', expected='1', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1', '-s', 'USE_PTHREADS=1', '-s', 'PROXY_TO_PTHREAD=1'])
 
+  # Tests that fetches started on pthreads run on them, and that the handlers of waitable fetches run on the waiting thread.
+  def test_fetch_pthread_fetches(self):
+    shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
+    self.btest('fetch/pthread_fetches.cpp', expected='0', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1', '-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=4'])
+
+  # Tests that emscripten_fetch_wait_any() returns each of a set of waitable fetches as it finishes.
+  def test_fetch_wait_any(self):
+    shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
+    self.btest('fetch/wait_any.cpp', expected='0', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1', '-s', 'USE_PTHREADS=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
   def test_fetch_idb_store(self):
     self.btest('fetch/idb_store.cpp', expected='0', args=['-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1', '-s', 'PROXY_TO_PTHREAD=1'])
 
+  # Tests emscripten_fetch() of byte ranges, and of resumable downloads with EMSCRIPTEN_FETCH_APPEND.
+  def test_fetch_range_and_resume(self):
+    open(os.path.join(self.get_dir(), 'range.txt'), 'w').write('0123456789' * 100)
+    self.btest('fetch/range_and_resume.cpp', expected='0', args=['--std=c++11', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
+  def test_fetch_decode(self):
+    data = b'0123456789' * 100
+    # An LZ4 frame of one block: ten literals, a match that repeats them, and the last five bytes as literals.
+    block = b'\xaf' + data[:10] + b'\x0a\x00' + b'\xff\xff\xff\xc9' + b'\x50' + data[-5:]
+    open(os.path.join(self.get_dir(), 'data.lz4'), 'wb').write(b'\x04\x22\x4d\x18\x60\x40\x82' + struct.pack('<I', len(block)) + block + struct.pack('<I', 0))
+    gzip = zlib.compressobj(9, zlib.DEFLATED, 31)
+    open(os.path.join(self.get_dir(), 'data.gz'), 'wb').write(gzip.compress(data) + gzip.flush())
+    self.btest('fetch/decode.cpp', expected='0', args=['-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
+  def test_fetch_idb_batch(self):
+    self.btest('fetch/idb_batch.cpp', expected='0', args=['-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
+  # Tests that the IndexedDB cache evicts the least recently used files to stay within the budget of emscripten_fetch_set_cache_budget().
+  def test_fetch_cache_budget(self):
+    shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
+    self.btest('fetch/cache_budget.cpp', expected='0', args=['-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'])
+
+  # Tests emscripten_fetch_get_timing(), also with the timings logged to the trace.
+  def test_fetch_timing(self):
+    shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
+    for args in [[], ['--tracing']]:
+      self.btest('fetch/timing.cpp', expected='0', args=['-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1'] + args)
+
   def test_fetch_idb_delete(self):
     shutil.copyfile(path_from_root('tests', 'gears.png'), os.path.join(self.get_dir(), 'gears.png'))
     self.btest('fetch/idb_delete.cpp', expected='0', args=['-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'FETCH=1', '-s', 'PROXY_TO_PTHREAD=1'])
@@ -3745,6 +3966,43 @@ window.close = function() {
     shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
     self.btest('asmfs/read_file_twice.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
 
+  def test_asmfs_reopen_for_write(self):
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/reopen_for_write.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_lazy_load(self):
+    # The test server does not support Range requests, so this tests falling back to downloading whole files.
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/read_file_twice.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'ASMFS_LAZY_LOAD=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_aio_read(self):
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/aio_read.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_mmap(self):
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/mmap.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_positional_io(self):
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/positional_io.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_preload(self):
+    os.makedirs(os.path.join(self.get_dir(), 'assets', 'sub'))
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'assets', 'sub', 'hello_file.txt'))
+    self.btest('asmfs/preload.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1', '--preload-file', 'assets'])
+
+  def test_asmfs_threads(self):
+    shutil.copyfile(path_from_root('tests', 'asmfs', 'hello_file.txt'), os.path.join(self.get_dir(), 'hello_file.txt'))
+    self.btest('asmfs/threads.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'PTHREAD_POOL_SIZE=4', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1'])
+
+  def test_asmfs_writeback(self):
+    # The file is not on the server, so the second run can only read it from IndexedDB.
+    secret = str(time.time())
+    args = ['-s', 'ASMFS=1', '-s', 'ASMFS_WRITEBACK=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1', '-s', 'PROXY_TO_PTHREAD=1', '-DSECRET=\"' + secret + '\"']
+    self.btest('asmfs/writeback.cpp', expected='0', args=args + ['-DFIRST'])
+    self.btest('asmfs/writeback.cpp', expected='0', args=args)
+
   def test_asmfs_fopen_write(self):
     self.btest('asmfs/fopen_write.cpp', expected='0', args=['-s', 'ASMFS=1', '-s', 'USE_PTHREADS=1', '-s', 'FETCH_DEBUG=1'])
 
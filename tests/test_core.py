@@ -872,6 +872,41 @@ int main()
 
     self.do_run(src, r'''d is at 24''')
 
+  def test_setjmp_nothrow_invokes(self):
+    # only the call to jump() can reach longjmp, and the repeated setjmp() reuses its table entry
+    src = r'''
+#include <setjmp.h>
+#include <stdio.h>
+
+jmp_buf buf;
+
+__attribute__((noinline)) int work(int x) {
+  return x * 3;
+}
+
+__attribute__((noinline)) void jump(int x) {
+  if (x % 3 == 0) longjmp(buf, x + 1);
+}
+
+int main() {
+  volatile int i, sum = 0, jumps = 0;
+  for (i = 0; i < 1000; i++) {
+    if (setjmp(buf)) {
+      jumps++;
+      continue;
+    }
+    sum += work(i);
+    jump(i);
+  }
+  printf("sum: %d, jumps: %d\n", sum, jumps);
+  return 0;
+}
+'''
+    for remove in [0, 1]:
+      print(remove)
+      Settings.REMOVE_NOTHROW_INVOKES = remove
+      self.do_run(src, 'sum: 1498500, jumps: 334')
+
   def test_setjmp_noleak(self):
     src = r'''
 #include <setjmp.h>
@@ -2242,6 +2277,9 @@ The current type of b is: 9
   def test_memcpy_alignment(self):
     self.do_run(open(path_from_root('tests', 'test_memcpy_alignment.cpp'), 'r').read(), 'OK.')
 
+  def test_memmove_alignment(self):
+    self.do_run(open(path_from_root('tests', 'test_memmove_alignment.cpp'), 'r').read(), 'OK.')
+
   def test_memset_alignment(self):
     self.do_run(open(path_from_root('tests', 'test_memset_alignment.cpp'), 'r').read(), 'OK.')
 
@@ -4533,6 +4571,10 @@ def process(filename):
     Settings.EXTRA_EXPORTED_RUNTIME_METHODS = ['getValue', 'setValue', 'UTF8ToString', 'stringToUTF8']
     self.do_run_in_out_file_test('tests', 'core', 'test_utf')
 
+  def test_pointer_stringify_cache(self):
+    Settings.POINTER_STRINGIFY_CACHE = 1
+    self.do_run_in_out_file_test('tests', 'core', 'test_pointer_stringify_cache')
+
   def test_utf32(self):
     Settings.EXTRA_EXPORTED_RUNTIME_METHODS = ['UTF32ToString', 'stringToUTF32', 'lengthBytesUTF32']
     self.do_run(open(path_from_root('tests', 'utf32.cpp')).read(), 'OK.')
@@ -4636,6 +4678,19 @@ def process(filename):
     out = path_from_root('tests', 'fs', 'test_write.out')
     self.do_run_from_file(src, out, js_engines=js_engines)
 
+  def test_fs_memfs_preallocate(self):
+    src = open(path_from_root('tests', 'fs', 'test_memfs_preallocate.c'), 'r').read()
+    self.do_run(src, 'success', force_c=True)
+
+  def test_fs_memfs_heap_files(self):
+    self.emcc_args += ['-s', 'MEMFS_HEAP_FILE_SIZE=65536']
+    src = open(path_from_root('tests', 'fs', 'test_memfs_heap_files.c'), 'r').read()
+    self.do_run(src, 'success', force_c=True)
+
+  def test_fs_lookup_cache(self):
+    src = open(path_from_root('tests', 'fs', 'test_lookup_cache.c'), 'r').read()
+    self.do_run(src, 'success', force_c=True)
+
   @also_with_noderawfs
   def test_fs_emptyPath(self, js_engines=None):
     src = path_from_root('tests', 'fs', 'test_emptyPath.c')
@@ -6065,12 +6120,20 @@ def process(filename):
       var multi = Module['cwrap']('multi', 'number', ['number', 'number', 'number', 'string']);
       Module.print(multi(2, 1.4, 3, 'atr'));
       Module.print(multi(8, 5.4, 4, 'bret'));
+      var getString = Module['cwrap']('get_string', 'string');
+      Module.print(getString());
+      var printArray = Module['cwrap']('print_string', null, ['array']);
+      printArray([97, 114, 114, 45, 97, 121, 0]);
       Module.print('*');
       // part 3: avoid stack explosion and check it's restored correctly
       for (var i = 0; i < TOTAL_STACK/60; i++) {
         ccall('multi', 'number', ['number', 'number', 'number', 'string'], [0, 0, 0, '123456789012345678901234567890123456789012345678901234567890']);
       }
       Module.print('stack is ok.');
+      for (var i = 0; i < TOTAL_STACK/60; i++) {
+        multi(0, 0, 0, '123456789012345678901234567890123456789012345678901234567890');
+      }
+      Module.print('cwrap stack is ok.');
       ccall('call_ccall_again', null);
   \'\'\'
   open(filename, 'w').write(src)
@@ -6489,6 +6552,17 @@ def process(filename):
 
     self.do_run_in_out_file_test('tests', 'core', 'test_tracing')
 
+  def test_tracing_buffer(self):
+    Building.COMPILER_TEST_OPTS += ['--tracing']
+    Settings.TRACE_BUFFER = 4096
+
+    self.do_run_in_out_file_test('tests', 'core', 'test_tracing_buffer')
+
+  def test_tracing_chrome(self):
+    Building.COMPILER_TEST_OPTS += ['--tracing']
+
+    self.do_run_in_out_file_test('tests', 'core', 'test_tracing_chrome')
+
   def test_eval_ctors(self):
     if '-O2' not in str(self.emcc_args) or '-O1' in str(self.emcc_args): return self.skip('need js optimizations')
 
@@ -6723,6 +6797,26 @@ someweirdtext
     '''
     self.do_run(src, '418')
 
+  def test_embind_utf8_strings(self):
+    self.emcc_args += ['--bind', '-s', 'EMBIND_STD_STRING_IS_UTF8=1']
+    src = r'''
+      #include <stdio.h>
+      #include <string>
+      #include <emscripten/val.h>
+      using namespace emscripten;
+
+      int main() {
+        std::string greek = "\xce\xb1\xce\xb2\xce\xb3";
+        printf("%d\n", val(greek)["length"].as<int>());
+        std::string upper = val(std::string("snowman: \xe2\x98\x83")).call<std::string>("toUpperCase");
+        printf("%s\n", upper.c_str());
+        printf("%d\n", val(std::string_view(greek.data(), 4))["length"].as<int>());
+        printf("%d\n", val(std::string(3000, 'x') + greek)["length"].as<int>());
+        return 0;
+      }
+    '''
+    self.do_run(src, '3\nSNOWMAN: \xe2\x98\x83\n2\n3003\n')
+
   @sync
   @no_wasm_backend()
   def test_webidl(self):
@@ -7347,6 +7441,50 @@ int main(int argc, char **argv) {
   def test_coroutine_emterpretify_async(self):
     self.do_test_coroutine({'EMTERPRETIFY': 1, 'EMTERPRETIFY_ASYNC': 1})
 
+  @no_wasm_backend('EMTERPRETIFY causes JSOptimizer to run, which is '
+                   'unsupported with Wasm backend')
+  def test_fibers_emterpretify_async(self):
+    Settings.NO_EXIT_RUNTIME = 0 # needs to flush stdio streams
+    Settings.EMTERPRETIFY = 1
+    Settings.EMTERPRETIFY_ASYNC = 1
+    src = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <emscripten.h>
+static emscripten_fiber ping_fiber, pong_fiber;
+void ping(void * arg) {
+    char buf[32]; // on the C stack of this fiber, which must survive switching
+    for(int i = 0; i < 3; ++i) {
+        sprintf(buf, "ping %d", i);
+        emscripten_fiber_swap(pong_fiber);
+        printf("%s\n", buf);
+    }
+    emscripten_fiber_swap(0);
+    printf("ping returns\n");
+}
+void pong(void * arg) {
+    char buf[32];
+    for(int i = 0; ; ++i) {
+        sprintf(buf, "pong %d (%d)", i, *(int*)arg);
+        emscripten_fiber_swap(ping_fiber);
+        printf("%s\n", buf); // printed when switched back to, after ping's next line
+    }
+}
+int main(int argc, char **argv) {
+    int x = 42;
+    ping_fiber = emscripten_fiber_create(ping, 0, 0, 0);
+    pong_fiber = emscripten_fiber_create(pong, &x, 1024, 0);
+    emscripten_fiber_swap(ping_fiber);
+    printf("main %d\n", x);
+    emscripten_fiber_swap(ping_fiber);
+    printf("done\n");
+    free(ping_fiber);
+    free(pong_fiber);
+    return 0;
+}
+'''
+    self.do_run(src, 'ping 0\npong 0 (42)\nping 1\npong 1 (42)\nping 2\nmain 42\nping returns\ndone\n')
+
   @no_emterpreter
   @no_wasm_backend('EMTERPRETIFY causes JSOptimizer to run, which is '
                    'unsupported with Wasm backend')
@@ -7480,6 +7618,18 @@ int main(int argc, char **argv) {
   def test_mallinfo(self):
     self.do_run(open(path_from_root('tests', 'mallinfo.cpp')).read(), 'OK.')
 
+  def test_emscripten_arena(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_emscripten_arena')
+
+  def test_emscripten_malloc_aligned_batch(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_emscripten_malloc_aligned_batch')
+
+  def test_emscripten_get_heap_stats(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_emscripten_get_heap_stats')
+
+  def test_emscripten_handle_heap(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_emscripten_handle_heap')
+
   def test_wrap_malloc(self):
     self.do_run(open(path_from_root('tests', 'wrap_malloc.cpp')).read(), 'OK.')
 
@@ -0,0 +1,95 @@
+// Dispatches bursts of mousemove and wheel events, and checks that with HTML5_COALESCE_EVENTS each burst is passed to the
+// callback once, with the movement summed up and the individual events available from emscripten_get_coalesced_events().
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+
+#define NUM_EVENTS 10
+
+int mouseCallbacks = 0;
+int wheelCallbacks = 0;
+int frames = 0;
+
+EM_BOOL mousemove_callback(int eventType, const EmscriptenMouseEvent *e, void *userData)
+{
+  ++mouseCallbacks;
+  const EmscriptenMouseEvent *events = 0;
+  int numEvents = 0;
+  assert(emscripten_get_coalesced_events((const void **)&events, &numEvents) == EMSCRIPTEN_RESULT_SUCCESS);
+  printf("mousemove: %d events, movement %ld,%ld\n", numEvents, e->movementX, e->movementY);
+  assert(numEvents == NUM_EVENTS);
+  for(int i = 0; i < numEvents; ++i)
+  {
+    assert(events[i].clientX == (i+1)*10);
+    assert(events[i].movementX == i+1);
+    assert(events[i].movementY == -1);
+  }
+  // The passed event is the last one, with the movement of all of them.
+  assert(e->clientX == NUM_EVENTS*10);
+  assert(e->movementX == NUM_EVENTS*(NUM_EVENTS+1)/2);
+  assert(e->movementY == -NUM_EVENTS);
+  return 0;
+}
+
+EM_BOOL wheel_callback(int eventType, const EmscriptenWheelEvent *e, void *userData)
+{
+  ++wheelCallbacks;
+  const EmscriptenWheelEvent *events = 0;
+  int numEvents = 0;
+  assert(emscripten_get_coalesced_events((const void **)&events, &numEvents) == EMSCRIPTEN_RESULT_SUCCESS);
+  printf("wheel: %d events, delta %f\n", numEvents, e->deltaY);
+  assert(numEvents == NUM_EVENTS);
+  for(int i = 0; i < numEvents; ++i)
+    assert(events[i].deltaY == i+1);
+  assert(e->deltaY == NUM_EVENTS*(NUM_EVENTS+1)/2);
+  return 0;
+}
+
+void dispatch_events()
+{
+  EM_ASM({
+    for(var i = 1; i <= $0; ++i) {
+      window.dispatchEvent(new MouseEvent('mousemove', { clientX: i*10, movementX: i, movementY: -1 }));
+      window.dispatchEvent(new WheelEvent('wheel', { deltaY: i, deltaMode: 0 }));
+    }
+  }, NUM_EVENTS);
+}
+
+void frame()
+{
+  ++frames;
+  if (frames == 1)
+  {
+    dispatch_events();
+    // The callbacks only run in the next animation frame.
+    assert(mouseCallbacks == 0 && wheelCallbacks == 0);
+    const void *events = 0;
+    int numEvents = -1;
+    assert(emscripten_get_coalesced_events(&events, &numEvents) == EMSCRIPTEN_RESULT_NO_DATA);
+    assert(!events && numEvents == 0);
+  }
+  else if (frames == 10)
+  {
+    dispatch_events();
+  }
+  else if (frames == 20)
+  {
+    assert(mouseCallbacks == 2);
+    assert(wheelCallbacks == 2);
+    emscripten_cancel_main_loop();
+#ifdef REPORT_RESULT
+    REPORT_RESULT(0);
+#endif
+  }
+}
+
+int main()
+{
+  EMSCRIPTEN_RESULT ret = emscripten_set_mousemove_callback("#window", 0, 1, mousemove_callback);
+  assert(ret == EMSCRIPTEN_RESULT_SUCCESS);
+  ret = emscripten_set_wheel_callback("#window", 0, 1, wheel_callback);
+  assert(ret == EMSCRIPTEN_RESULT_SUCCESS);
+  emscripten_set_main_loop(frame, 0, 0);
+  return 0;
+}
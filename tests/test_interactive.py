@@ -113,6 +113,9 @@ class interactive(BrowserCore):
   def test_openal_buffers(self):
     self.btest('openal_buffers.c', '0', args=['--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/'],)
 
+  def test_openal_buffers_mixer(self):
+    self.btest('openal_buffers.c', '0', args=['-s', 'OPENAL_MIXER=1', '--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/'],)
+
   def test_openal_buffers_animated_pitch(self):
     self.btest('openal_buffers.c', '0', args=['-DTEST_ANIMATED_PITCH=1', '--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/'],)
 
@@ -134,6 +137,9 @@ class interactive(BrowserCore):
   def test_openal_animated_looped_panned_playback(self):
     self.btest('openal_playback.cpp', '1', args=['-DTEST_ANIMATED_LOOPED_PANNED_PLAYBACK=1', '-DTEST_LOOPED_PLAYBACK=1', '--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/audio.wav'],)
 
+  def test_openal_animated_looped_panned_playback_mixer(self):
+    self.btest('openal_playback.cpp', '1', args=['-s', 'OPENAL_MIXER=1', '-DTEST_ANIMATED_LOOPED_PANNED_PLAYBACK=1', '-DTEST_LOOPED_PLAYBACK=1', '--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/audio.wav'],)
+
   def test_openal_animated_looped_relative_playback(self):
     self.btest('openal_playback.cpp', '1', args=['-DTEST_ANIMATED_LOOPED_RELATIVE_PLAYBACK=1', '-DTEST_LOOPED_PLAYBACK=1', '--preload-file', path_from_root('tests', 'sounds', 'the_entertainer.wav') + '@/audio.wav'],)
 
@@ -0,0 +1,46 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+char buf[1024*32+128] = {};
+char expected[1024*32+128] = {};
+
+// Moves within one buffer, so that the source and destination overlap, and compares with a move done byte by byte.
+void test_memmove(int moveSize, int srcOffset, int dstOffset)
+{
+	char s = (char)rand();
+	for(int i = 0; i < (int)sizeof(buf); ++i)
+		buf[i] = expected[i] = (char)(s - i);
+
+	if (dstOffset > srcOffset)
+		for(int i = moveSize - 1; i >= 0; --i) expected[dstOffset + i] = expected[srcOffset + i];
+	else
+		for(int i = 0; i < moveSize; ++i) expected[dstOffset + i] = expected[srcOffset + i];
+
+	if (memmove(buf + dstOffset, buf + srcOffset, moveSize) != buf + dstOffset || !!memcmp(buf, expected, sizeof(buf)))
+	{
+		printf("test_memmove(moveSize=%d, srcOffset=%d, dstOffset=%d) failed!\n", moveSize, srcOffset, dstOffset);
+		exit(1);
+	}
+}
+
+void test_movesize(int moveSize)
+{
+	int offsets[8] = { 0, 1, 3, 4, 5, 8, 11, 64 };
+
+	for(int srcOffset = 0; srcOffset < 8; ++srcOffset)
+		for(int dstOffset = 0; dstOffset < 8; ++dstOffset)
+			test_memmove(moveSize, offsets[srcOffset], offsets[dstOffset]);
+}
+
+int main()
+{
+	for(int moveSize = 0; moveSize < 128; ++moveSize)
+		test_movesize(moveSize);
+
+	for(int moveSizeI = 128; moveSizeI <= 32768; moveSizeI <<= 1)
+		for(int moveSizeJ = 1; moveSizeJ <= 16; moveSizeJ <<= 1)
+			test_movesize(moveSizeI | moveSizeJ);
+
+	printf("OK.\n");
+}
@@ -400,6 +400,41 @@ f.close()
     subprocess.check_call([PYTHON, EMCC, 'a.bc'])
     self.assertContained('hello, world!', run_js(self.in_dir('a.out.js')))
 
+  def test_emcc_compile_cache(self):
+    cache_dir = self.in_dir('objects')
+    env = os.environ.copy()
+    env['EMCC_COMPILE_CACHE'] = cache_dir
+    def entries():
+      return sorted(os.path.join(d, f) for d, _, files in os.walk(cache_dir) for f in files if not f.endswith('.lock'))
+    def build(project, value, args=[]):
+      if not os.path.exists(project): os.mkdir(project)
+      open(os.path.join(project, 'value.h'), 'w').write('#define VALUE %d\n' % value)
+      open(os.path.join(project, 'main.c'), 'w').write(r'''
+        #include <stdio.h>
+        #include "value.h"
+        int main() {
+          printf("value: %d\n", VALUE);
+          return 0;
+        }
+      ''')
+      # the include path differs between projects, but not the preprocessed source
+      run_process([PYTHON, EMCC, '-O2', '-I' + self.in_dir(project), os.path.join(project, 'main.c'), '-c', '-o', os.path.join(project, 'main.o')] + args, env=env)
+      run_process([PYTHON, EMCC, os.path.join(project, 'main.o'), '-o', os.path.join(project, 'main.js')])
+      self.assertContained('value: %d' % value, run_js(os.path.join(project, 'main.js')))
+      return open(os.path.join(project, 'main.o'), 'rb').read()
+    first = build('a', 1)
+    # the unoptimized and the optimized object
+    self.assertEqual(len(entries()), 2)
+    # the same source in another project is a cache hit
+    self.assertEqual(build('b', 1), first)
+    self.assertEqual(len(entries()), 2)
+    # a changed header is not
+    self.assertNotEqual(build('b', 2), first)
+    self.assertEqual(len(entries()), 4)
+    # dependency files would not be written for cached objects
+    build('c', 1, ['-MD'])
+    self.assertEqual(len(entries()), 4)
+
   def test_emar_em_config_flag(self):
     # We expand this in case the EM_CONFIG is ~/.emscripten (default)
     config = os.path.expanduser(EM_CONFIG)
@@ -1898,13 +1933,13 @@ int f() {
        ['asm', 'asmLastOpts', 'last']),
       (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-relocate.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-relocate-output.js')).read(),
        ['asm', 'relocate']),
-      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline1.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline1-output.js')).read(),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline1.js'), [open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline1-output.js')).read(), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline1-output2.js')).read()],
        ['asm', 'outline']),
-      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline2.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline2-output.js')).read(),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline2.js'), [open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline2-output.js')).read(), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline2-output2.js')).read()],
        ['asm', 'outline']),
-      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline3.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline3-output.js')).read(),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline3.js'), [open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline3-output.js')).read(), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline3-output2.js')).read()],
        ['asm', 'outline']),
-      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline4.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline4-output.js')).read(),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline4.js'), [open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline4-output.js')).read(), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-outline4-output2.js')).read()],
        ['asm', 'outline']),
       (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-minlast.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-minlast-output.js')).read(),
        ['asm', 'minifyWhitespace', 'asmLastOpts', 'last']),
@@ -1916,6 +1951,24 @@ int f() {
        ['asm', 'ensureLabelSet']),
       (path_from_root('tests', 'optimizer', '3154.js'), open(path_from_root('tests', 'optimizer', '3154-output.js')).read(),
        ['asm', 'eliminate', 'registerize', 'asmLastOpts', 'last']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-inline.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-inline-output.js')).read(),
+       ['asm', 'inlineSmallFunctions']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-licm.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-licm-output.js')).read(),
+       ['asm', 'hoistLoopInvariants']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-prune.js'), [open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-prune-output.js')).read(), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-prune-output2.js')).read()],
+       ['asm', 'pruneFunctions']), # output2 is without the report of folded functions, which js-optimizer.js does not print
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-instrument-order.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-instrument-order-output.js')).read(),
+       ['asm', 'instrumentFunctionOrder']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-shadow-stack.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-shadow-stack-output.js')).read(),
+       ['asm', 'instrumentShadowStack']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-devirtualize.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-devirtualize-output.js')).read(),
+       ['asm', 'devirtualize']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-safeHeap.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-safeHeap-output.js')).read(),
+       ['asm', 'safeHeap']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-callGraph.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-callGraph-output.js')).read(),
+       ['asm', 'dumpCallGraph']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-callGraph.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-reachable-output.js')).read(),
+       ['asm', 'findReachable']),
       (path_from_root('tests', 'optimizer', 'simd.js'), open(path_from_root('tests', 'optimizer', 'simd-output.js')).read(),
        ['asm', 'eliminate']), # eliminate, just enough to trigger asm normalization/denormalization
       (path_from_root('tests', 'optimizer', 'simd.js'), open(path_from_root('tests', 'optimizer', 'simd-output-memSafe.js')).read(),
@@ -1928,6 +1981,12 @@ int f() {
        ['asm', 'registerizeHarder', 'asmLastOpts', 'minifyWhitespace']), # issue 3549
       (path_from_root('tests', 'optimizer', 'test-js-optimizer-splitMemory.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-splitMemory-output.js')).read(),
        ['splitMemory']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-splitMemory.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-splitMemory-output.js')).read(),
+       ['asm', 'splitMemory']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-safeHeap-skipRedundant.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-safeHeap-skipRedundant-output.js')).read(),
+       ['asm', 'safeHeapSkipRedundant']),
+      (path_from_root('tests', 'optimizer', 'test-js-optimizer-strings.js'), open(path_from_root('tests', 'optimizer', 'test-js-optimizer-strings-output.js')).read(),
+       ['asm', 'noop']),
       (path_from_root('tests', 'optimizer', 'JSDCE.js'), open(path_from_root('tests', 'optimizer', 'JSDCE-output.js')).read(),
        ['JSDCE']),
       (path_from_root('tests', 'optimizer', 'JSDCE-uglifyjsNodeTypes.js'), open(path_from_root('tests', 'optimizer', 'JSDCE-uglifyjsNodeTypes-output.js')).read(),
@@ -1954,9 +2013,22 @@ int f() {
       if not isinstance(expected, list): expected = [expected]
       expected = [out.replace('\n\n', '\n').replace('\n\n', '\n') for out in expected]
 
+      native_only = input in [ # blacklist of tests that are native-optimizer only
+        path_from_root('tests', 'optimizer', 'asmLastOpts.js'),
+        path_from_root('tests', 'optimizer', '3154.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-inline.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-licm.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-prune.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-instrument-order.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-shadow-stack.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-devirtualize.js'),
+        path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-safeHeap-skipRedundant.js'),
+      ]
+
       # test calling js optimizer
-      print('  js')
-      output = run_process(NODE_JS + [path_from_root('tools', 'js-optimizer.js'), input] + passes, stdin=PIPE, stdout=PIPE).stdout
+      if not native_only:
+        print('  js')
+        output = run_process(NODE_JS + [path_from_root('tools', 'js-optimizer.js'), input] + passes, stdin=PIPE, stdout=PIPE).stdout
 
       def check_js(js, expected):
         #print >> sys.stderr, 'chak\n==========================\n', js, '\n===========================\n'
@@ -1986,10 +2058,7 @@ int f() {
           expected = fix(expected)
         self.assertIdentical(expected, js.replace('\r\n', '\n').replace('\n\n', '\n').replace('\n\n', '\n'))
 
-      if input not in [ # blacklist of tests that are native-optimizer only
-        path_from_root('tests', 'optimizer', 'asmLastOpts.js'),
-        path_from_root('tests', 'optimizer', '3154.js')
-      ]:
+      if not native_only:
         check_js(output, expected)
       else:
         print('(skip non-native)')
@@ -2001,20 +2070,28 @@ int f() {
           output = open(output_temp + '.js').read()
           check_js(output, expected)
 
+        def check_binary():
+          Popen(listify(NODE_JS) + [path_from_root('tools', 'js-optimizer.js'), output_temp, 'receiveBinary'], stdin=PIPE, stdout=open(output_temp + '.js', 'w')).communicate()
+          output = open(output_temp + '.js').read()
+          check_js(output, expected)
+
         self.clear()
         input_temp = 'temp.js'
         output_temp = 'output.js'
         shutil.copyfile(input, input_temp)
         Popen(listify(NODE_JS) + [path_from_root('tools', 'js-optimizer.js'), input_temp, 'emitJSON'], stdin=PIPE, stdout=open(input_temp + '.js', 'w')).communicate()
+        Popen(listify(NODE_JS) + [path_from_root('tools', 'js-optimizer.js'), input_temp, 'emitBinary'], stdin=PIPE, stdout=open(input_temp + '.ast', 'w')).communicate()
         original = open(input).read()
         if '// EXTRA_INFO:' in original:
-          json = open(input_temp + '.js').read()
-          json += '\n' + original[original.find('// EXTRA_INFO:'):]
-          open(input_temp + '.js', 'w').write(json)
+          for serialized in [input_temp + '.js', input_temp + '.ast']:
+            ast = open(serialized).read()
+            ast += '\n' + original[original.find('// EXTRA_INFO:'):]
+            open(serialized, 'w').write(ast)
 
         # last is only relevant when we emit JS
         if 'last' not in passes and \
-           'null_if' not in input and 'null_else' not in input:  # null-* tests are js optimizer or native, not a mixture (they mix badly)
+           'dumpCallGraph' not in passes and 'findReachable' not in passes and \
+           'null_if' not in input and 'null_else' not in input:  # null-* tests are js optimizer or native, not a mixture (they mix badly); call graph passes print their report before the AST
           print('  native (receiveJSON)')
           output = run_process([js_optimizer.get_native_optimizer(), input_temp + '.js'] + passes + ['receiveJSON', 'emitJSON'], stdin=PIPE, stdout=open(output_temp, 'w')).stdout
           check_json()
@@ -2023,10 +2100,88 @@ int f() {
           output = run_process([js_optimizer.get_native_optimizer(), input] + passes + ['emitJSON'], stdin=PIPE, stdout=open(output_temp, 'w')).stdout
           check_json()
 
+          print('  native (receiveBinary)')
+          output = run_process([js_optimizer.get_native_optimizer(), input_temp + '.ast'] + passes + ['receiveBinary', 'emitBinary'], stdin=PIPE, stdout=open(output_temp, 'w')).stdout
+          check_binary()
+
+          print('  native (parsing JS, emitting binary)')
+          output = run_process([js_optimizer.get_native_optimizer(), input] + passes + ['emitBinary'], stdin=PIPE, stdout=open(output_temp, 'w')).stdout
+          check_binary()
+
         print('  native (emitting JS)')
         output = run_process([js_optimizer.get_native_optimizer(), input] + passes, stdin=PIPE, stdout=PIPE).stdout
         check_js(output, expected)
 
+        if len(js_optimizer.NATIVE_FUNCTION_LOCAL_PASSES.intersection(passes)) == len(passes):
+          print('  native (emitting JS, on threads)')
+          output = run_process([js_optimizer.get_native_optimizer(), input] + passes + ['threads=2'], stdin=PIPE, stdout=PIPE).stdout
+          check_js(output, expected)
+
+          print('  native (emitting JS, streaming)')
+          output = run_process([js_optimizer.get_native_optimizer(), input] + passes + ['stream'], stdin=PIPE, stdout=PIPE).stdout
+          check_js(output, expected)
+
+  def test_native_minify_globals(self):
+    # the native optimizer minifies the globals of the asm.js shell just like js-optimizer.js, see Minifier.minify_shell
+    if not js_optimizer.get_native_optimizer(): return self.skip('native optimizer not available')
+    input = path_from_root('tests', 'optimizer', 'test-js-optimizer-asm-minifyGlobals.js')
+    def minify(command):
+      code, metadata = run_process(command, stdout=PIPE).stdout.split('// EXTRA_INFO:')
+      # normalize the code by printing it through js-optimizer.js
+      open('shell.js', 'w').write(code)
+      code = run_process(NODE_JS + [path_from_root('tools', 'js-optimizer.js'), os.path.abspath('shell.js'), 'noop', 'noPrintMetadata'], stdout=PIPE).stdout
+      return code, json.loads(metadata)
+    js_code, js_globals = minify(NODE_JS + [path_from_root('tools', 'js-optimizer.js'), input, 'minifyGlobals', 'noPrintMetadata'])
+    native_code, native_globals = minify([js_optimizer.get_native_optimizer(), input, 'minifyGlobals'])
+    self.assertEqual(js_globals, native_globals)
+    self.assertIdentical(js_code, native_code)
+    assert 'return {\n  _main: %s,' % native_globals['_main'] in native_code, 'asm.js exports must stay unquoted'
+    # the most used globals get the shortest names
+    self.assertEqual(native_globals['STACKTOP'], 'a')
+
+  def test_native_optimizer_pass_stats(self):
+    # passStats=FILE makes the native optimizer report the time, AST nodes and arena memory of each pass, without
+    # changing its output
+    if not js_optimizer.get_native_optimizer(): return self.skip('native optimizer not available')
+    command = [js_optimizer.get_native_optimizer(), path_from_root('tests', 'optimizer', 'asm-eliminator-test.js'), 'asm', 'eliminate', 'simplifyExpressions']
+    for args in [[], ['threads=2'], ['stream']]:
+      print(args)
+      expected = run_process(command + args, stdout=PIPE).stdout
+      self.assertIdentical(expected, run_process(command + args + ['passStats=stats.json'], stdout=PIPE).stdout)
+      stats = json.loads(open('stats.json').read())
+      assert stats['pid'] > 0 and stats['start'] > 0, stats
+      self.assertEqual([info['name'] for info in stats['passes']], ['parse', 'eliminate', 'simplifyExpressions', 'print'])
+      for info in stats['passes']:
+        assert info['time'] >= 0 and info['arenaBytes'] > 0, info
+      eliminate = stats['passes'][1]
+      assert eliminate['nodesBefore'] > eliminate['nodesAfter'] > 0, eliminate
+      self.assertEqual(eliminate['threads'], 2 if args == ['threads=2'] else 1)
+
+  def test_native_function_local_passes(self):
+    # the runner decides when to use threads and streaming from its own list of function-local passes, which must
+    # be the one that the native optimizer uses
+    optimizer = js_optimizer.get_native_optimizer()
+    if not optimizer: return self.skip('native optimizer not available')
+    native = run_process([optimizer, '--function-local-passes'], stdout=PIPE).stdout.split()
+    self.assertEqual(sorted(native), sorted(js_optimizer.NATIVE_FUNCTION_LOCAL_PASSES))
+
+  def test_native_optimizer_server(self):
+    # one optimizer server handles one run after another, with the same output as a process for each run, so
+    # nothing may leak from one run into the next
+    optimizer = js_optimizer.get_native_optimizer()
+    if not optimizer: return self.skip('native optimizer not available')
+    server = js_optimizer.OptimizerServer(optimizer)
+    for input, args in [('test-js-optimizer-asm-pre-f32.js', ['asm', 'asmPreciseF32', 'simplifyExpressions', 'optimizeFrounds']),
+                        ('test-js-optimizer-asm-pre.js', ['asm', 'simplifyExpressions', 'stream']),
+                        ('test-js-optimizer-asm-minlast.js', ['asm', 'minifyWhitespace', 'asmLastOpts', 'last']),
+                        ('test-js-optimizer-asm-pre.js', ['asm', 'simplifyExpressions'])]:
+      print(input, args)
+      filename = path_from_root('tests', 'optimizer', input)
+      expected = run_process([optimizer, filename] + args, stdout=PIPE).stdout
+      self.assertIdentical(expected, server.run(args, open(filename).read()))
+    server.process.stdin.close()
+    self.assertEqual(server.process.wait(), 0)
+
   def test_m_mm(self):
     open(os.path.join(self.get_dir(), 'foo.c'), 'w').write('''#include <emscripten.h>''')
     for opt in ['M', 'MM']:
@@ -2273,9 +2428,67 @@ seeked= file.
     assert metadata['remote_package_size'] == len('data1') + len('data2')
     import uuid
     try:
-      uuid = uuid.UUID(metadata['package_uuid'], version = 4) # can only assert the uuid format is correct, the uuid's value is expected to differ in between invocation
+      uuid = uuid.UUID(metadata['package_uuid'], version = 4)
     except ValueError:
       assert False
+    # the uuid is a hash of the package contents, so it only changes when they do
+    def package_uuid():
+      Popen([PYTHON, FILE_PACKAGER, 'test.data', '--preload', 'data1.txt', '--preload', 'subdir/data2.txt', '--js-output=immutable.js', '--separate-metadata']).communicate()
+      return json.load(open('immutable.js.metadata'))['package_uuid']
+    assert package_uuid() == metadata['package_uuid']
+    open('data1.txt', 'w').write('data3')
+    assert package_uuid() != metadata['package_uuid']
+
+  def test_file_packager_preload_cache_chunks(self):
+    os.mkdir('assets')
+    open(os.path.join('assets', 'a.txt'), 'w').write('first')
+    open(os.path.join('assets', 'b.bin'), 'wb').write(os.urandom(2*1024*1024 + 10))
+    open(os.path.join('assets', 'c.txt'), 'w').write('third')
+    def chunks():
+      run_process([PYTHON, FILE_PACKAGER, 'test.data', '--preload', 'assets', '--use-preload-cache', '--js-output=test.js', '--separate-metadata'], stderr=PIPE)
+      metadata = json.load(open('test.js.metadata'))
+      assert metadata['chunks'][-1][1] == metadata['remote_package_size']
+      return metadata['chunks']
+    before = chunks()
+    # each file starts a chunk, and big files are split
+    assert len(before) == 5, before
+    # changing the size of a file only changes its own chunk
+    open(os.path.join('assets', 'a.txt'), 'w').write('first, longer')
+    after = chunks()
+    assert len(after) == 5
+    hashes = lambda chunks: [chunk[2] for chunk in chunks]
+    changed = [i for i in range(5) if hashes(before)[i] != hashes(after)[i]]
+    assert len(changed) == 1, changed
+    assert after[changed[0]][1] - after[changed[0]][0] == len('first, longer')
+
+  def test_file_packager_asmfs(self):
+    import json, struct
+    os.makedirs(os.path.join('assets', 'sub'))
+    open(os.path.join('assets', 'a.txt'), 'w').write('hello')
+    open(os.path.join('assets', 'sub', 'b.txt'), 'w').write('world!')
+    run_process([PYTHON, FILE_PACKAGER, 'test.data', '--preload', 'assets', '--asmfs', '--js-output=test.js'], stderr=PIPE)
+    js = open('test.js').read()
+    assert '_emscripten_asmfs_import_package' in js
+    assert 'FS_createPath' not in js and 'FS_createDataFile' not in js
+    metadata = json.loads(re.search(r'loadPackage\((.*)\);', js).group(1))
+    assert metadata['files'] == []
+    # the manifest follows the file contents in the data file, and lists each directory before its contents
+    data = open('test.data', 'rb').read()
+    start = metadata['manifest_start']
+    assert start % 4 == 0 and start >= len('hello') + len('world!')
+    magic, num_entries = struct.unpack_from('<2I', data, start)
+    assert magic == 0x31736661
+    names = data[start + 8 + 20 * num_entries:]
+    entries = {}
+    for i in range(num_entries):
+      parent, name, name_length, offset, size = struct.unpack_from('<5I', data, start + 8 + 20 * i)
+      name = names[name:name + name_length].decode('utf-8')
+      path = name if parent == 0xFFFFFFFF else entries[parent][0] + '/' + name
+      entries[i] = (path, None if size == 0xFFFFFFFF else data[offset:offset + size].decode('utf-8'))
+    self.assertEqual(sorted(entries.values()), [('assets', None), ('assets/a.txt', 'hello'), ('assets/sub', None), ('assets/sub/b.txt', 'world!')])
+    # only --preload is supported
+    proc = run_process([PYTHON, FILE_PACKAGER, 'test.data', '--embed', 'assets', '--asmfs'], stdout=PIPE, stderr=PIPE, check=False)
+    assert proc.returncode != 0 and '--embed is not supported with --asmfs' in proc.stderr
 
   def test_file_packager_unicode(self):
     unicode_name = 'unicode…☃'
@@ -3600,6 +3813,37 @@ int main()
           symbols = open('a.out.js.symbols').read()
           assert ':_main' in symbols
 
+  def test_function_order(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+
+__attribute__((noinline)) int cold(int x) {
+  return x * 3 + 1;
+}
+
+__attribute__((noinline)) int hot(int x) {
+  return x * 2 + 1;
+}
+
+int main(int argc, char **argv) {
+  printf("%d\\n", argc > 5 ? cold(argc) : hot(argc));
+  return 0;
+}
+''')
+    run_process([PYTHON, EMCC, 'src.c', '-O2', '--profiling-funcs', '-s', 'PROFILE_FUNCTION_ORDER=1', '-s', 'NO_EXIT_RUNTIME=0'])
+    output = run_js('a.out.js')
+    profile = json.loads(output.strip().split('\n')[-1])
+    assert '_main' in profile and '_hot' in profile and '_cold' not in profile, profile
+    assert profile.index('_main') < profile.index('_hot'), profile
+    open('profile.json', 'w').write(json.dumps(profile))
+
+    run_process([PYTHON, EMCC, 'src.c', '-O2', '--profiling-funcs', '-s', 'FUNCTION_ORDER=@profile.json'])
+    self.assertContained('7\n', run_js('a.out.js', args=['a', 'b']))
+    js = open('a.out.js').read()
+    positions = [js.find('function ' + name + '(') for name in ['_main', '_hot', '_cold']]
+    assert 0 <= positions[0] < positions[1] < positions[2], positions
+
   def test_bc_to_bc(self):
     # emcc should 'process' bitcode to bitcode. build systems can request this if
     # e.g. they assume our 'executable' extension is bc, and compile an .o to a .bc
@@ -4908,6 +5152,245 @@ main(const int argc, const char * const * const argv)
     test([])
     test(['-O1'])
 
+  def test_emscripten_reserve_heap(self):
+    open('pre.js', 'w').write('''
+      Module['onMemoryGrowth'] = function(oldSize, newSize, msecs) {
+        Module.print('growth: ' + oldSize + ' -> ' + newSize);
+      };
+    ''')
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <emscripten.h>
+int main() {
+  printf("reserve: %d\n", emscripten_reserve_heap(100 * 1024 * 1024));
+  printf("reserved\n");
+  // Fits in the reserved memory, so there is no growth after this point.
+  char *p = malloc(90 * 1024 * 1024);
+  p[90 * 1024 * 1024 - 1] = 1;
+  printf("allocated %d\n", p != 0);
+  return 0;
+}
+''')
+    # A single growth to fit the reservation, of a size that depends on the growth policy.
+    for args, growth in [([], '16777216 -> 134217728'),
+                         (['-s', 'MEMORY_GROWTH_FACTOR=4'], '16777216 -> 268435456'),
+                         (['-s', 'MEMORY_GROWTH_MAX_STEP=16777216'], '16777216 -> 117440512')]:
+      print(args)
+      check_execute([PYTHON, EMCC, 'src.c', '-s', 'ALLOW_MEMORY_GROWTH=1', '--pre-js', 'pre.js'] + args)
+      self.assertContained('growth: %s\nreserve: 1\nreserved\nallocated 1\n' % growth, run_js('a.out.js'))
+
+  def test_emscripten_trim_heap(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <emscripten.h>
+int main() {
+  int initial = EM_ASM_INT({ return TOTAL_MEMORY });
+  char *big = malloc(100 * 1024 * 1024);
+  big[100 * 1024 * 1024 - 1] = 1;
+  int grown = EM_ASM_INT({ return TOTAL_MEMORY });
+  assert(grown > initial);
+  free(big);
+  int released = emscripten_trim_heap(0);
+  int trimmed = EM_ASM_INT({ return TOTAL_MEMORY });
+  printf("released: %d, shrank: %d\n", released, trimmed < grown);
+  // The heap can still grow again afterwards.
+  big = malloc(50 * 1024 * 1024);
+  big[50 * 1024 * 1024 - 1] = 1;
+  free(big);
+  printf("done\n");
+  return 0;
+}
+''')
+    for args, shrinks in [([], 1), (['-s', 'WASM=1'], 0)]:
+      print(args)
+      check_execute([PYTHON, EMCC, 'src.c', '-s', 'ALLOW_MEMORY_GROWTH=1'] + args)
+      self.assertContained('released: 1, shrank: %d\ndone\n' % shrinks, run_js('a.out.js'))
+
+  def test_compact_malloc(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+int main() {
+  void *ptrs[1000];
+  for (int i = 0; i < 1000; i++) {
+    int size = (i * 37) % 3000;
+    ptrs[i] = (i % 5 == 0) ? memalign(64, size) : malloc(size);
+    assert(malloc_usable_size(ptrs[i]) >= size);
+    if (i % 5 == 0) assert(((size_t)ptrs[i] & 63) == 0);
+    memset(ptrs[i], i, size);
+  }
+  for (int i = 0; i < 1000; i += 2) ptrs[i] = realloc(ptrs[i], 5000);
+  for (int i = 0; i < 1000; i++) free(ptrs[i]);
+  char *zeros = calloc(100, 10);
+  for (int i = 0; i < 1000; i++) assert(zeros[i] == 0);
+  free(zeros);
+  printf("ok\n");
+  return 0;
+}
+''')
+    sizes = {}
+    for compact in [0, 1]:
+      check_execute([PYTHON, EMCC, 'src.c', '-O2', '-s', 'COMPACT_MALLOC=%d' % compact])
+      sizes[compact] = os.stat('a.out.js').st_size
+      self.assertContained('ok', run_js('a.out.js'))
+    print('dlmalloc, compact:', sizes[0], sizes[1])
+    assert sizes[1] < sizes[0]
+    out, err = Popen([PYTHON, EMCC, 'src.c', '-s', 'COMPACT_MALLOC=1', '-s', 'USE_PTHREADS=1'], stdout=PIPE, stderr=PIPE).communicate()
+    self.assertContained('-s COMPACT_MALLOC=1 is not supported with -s USE_PTHREADS>0!', err)
+
+  def test_fast_float_conversion(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+static uint64_t state = 88172645463325252ULL;
+static uint64_t next() {
+  state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+  return state;
+}
+int main() {
+  const char *formats[] = { "%.17g", "%e", "%.0e", "%g", "%#.3g", "%.0f", "%.2f", "%.10f", "%.20e", "%a" };
+  const char *strings[] = { "0.5", "2.5", "1e23", "8.98846567431158e307", "2.2250738585072011e-308", "4.9e-324",
+                            "9007199254740993", "0.1000000000000000055511151231257827", "1e-400", "1e400",
+                            "123456789012345678901234567890e-20", "7.2057594037927933e16" };
+  char buf[512];
+  for (int i = 0; i < 5000; i++) {
+    union { uint64_t i; double d; } u;
+    u.i = next();
+    if (i % 2) u.i = (u.i & ~(0x7ffULL << 52)) | ((uint64_t)(1023 + (int)(next() % 80) - 40) << 52);
+    if (i % 3 == 0) u.d = (double)(int)(next() % 200000 - 100000) / (1 << (next() % 10));
+    if (u.d != u.d) continue;
+    for (int j = 0; j < sizeof(formats)/sizeof(formats[0]); j++) {
+      snprintf(buf, sizeof(buf), formats[j], u.d);
+      printf("%s %a\n", buf, strtod(buf, 0));
+    }
+  }
+  for (int i = 0; i < sizeof(strings)/sizeof(strings[0]); i++) {
+    printf("%s %a %a\n", strings[i], strtod(strings[i], 0), strtof(strings[i], 0));
+  }
+  return 0;
+}
+''')
+    outputs = {}
+    for fast in [0, 1]:
+      check_execute([PYTHON, EMCC, 'src.c', '-O2', '-s', 'FAST_FLOAT_CONVERSION=%d' % fast])
+      outputs[fast] = run_js('a.out.js')
+    self.assertContained('2.5 0x1.4p+1', outputs[0])
+    self.assertEqual(outputs[0], outputs[1])
+
+  def test_libcxx_c_locale_only(self):
+    open('src.cpp', 'w').write(r'''
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <climits>
+int main() {
+  std::ostringstream o;
+  o << 0 << ' ' << -5 << ' ' << INT_MIN << ' ' << LLONG_MIN << ' ' << ULLONG_MAX << ' ' << 42u << ' '
+    << std::showpos << 7 << ' ' << 7u << std::noshowpos << ' ' << std::hex << 255 << ' ' << std::showbase << 255
+    << std::dec << ' ' << std::setw(8) << std::setfill('*') << std::internal << -42 << ' ' << std::left
+    << std::setw(6) << 12 << '|' << std::right << std::setw(6) << 3.25 << ' ' << std::fixed << std::setprecision(3)
+    << -1.5 << ' ' << std::scientific << 12345.678 << ' ' << std::defaultfloat << 0.1 << ' ' << true << ' '
+    << std::boolalpha << false;
+  std::cout << o.str() << std::endl;
+  std::wostringstream w;
+  w << -123 << L' ' << 4.5;
+  std::wcout << w.str() << std::endl;
+  return 0;
+}
+''')
+    outputs = {}
+    for c_locale in [0, 1]:
+      check_execute([PYTHON, EMXX, 'src.cpp', '-O2', '-s', 'LIBCXX_C_LOCALE_ONLY=%d' % c_locale])
+      outputs[c_locale] = run_js('a.out.js')
+    self.assertContained('0 -5 -2147483648 -9223372036854775808 18446744073709551615 42 +7 7 ff 0xff -*****42 12****|**3.25 -1.500 1.235e+04 0.1 1 false\n-123 4.5\n', outputs[0])
+    self.assertEqual(outputs[0], outputs[1])
+
+  def test_heap_profiler(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <emscripten/heap_profiler.h>
+void *leaked[1000];
+__attribute__((noinline)) void leak_memory() {
+  for (int i = 0; i < 1000; i++) leaked[i] = malloc(1000);
+}
+__attribute__((noinline)) void churn_memory() {
+  for (int i = 0; i < 1000; i++) free(malloc(1000));
+}
+int main() {
+  leak_memory();
+  churn_memory();
+  printf("write: %d\n", emscripten_heap_profiler_write("heap.pb"));
+  return 0;
+}
+''')
+    open('post.js', 'w').write('''
+      require('fs').writeFileSync('heap.pb', Buffer.from(Module['getHeapProfile']()));
+    ''')
+    check_execute([PYTHON, EMCC, 'src.c', '-O2', '--profiling-funcs', '-s', 'HEAP_PROFILER=1024', '--post-js', 'post.js'])
+    self.assertContained('write: 0\n', run_js('a.out.js'))
+
+    # Decode the pprof profile, enough to sum up the in-use bytes by the innermost function of each sample.
+    def varint(data, pos):
+      value = shift = 0
+      while True:
+        b = ord(data[pos])
+        value |= (b & 127) << shift
+        shift += 7
+        pos += 1
+        if b < 128: return value, pos
+    def varints(data):
+      values = []
+      pos = 0
+      while pos < len(data):
+        value, pos = varint(data, pos)
+        values.append(value)
+      return values
+    def fields(data):
+      ret = []
+      pos = 0
+      while pos < len(data):
+        key, pos = varint(data, pos)
+        if key & 7 == 0:
+          value, pos = varint(data, pos)
+        else:
+          assert key & 7 == 2
+          length, pos = varint(data, pos)
+          value = data[pos:pos + length]
+          pos += length
+        ret.append((key >> 3, value))
+      return ret
+    profile = fields(open('heap.pb', 'rb').read())
+    strings = [value for field, value in profile if field == 6]
+    function_names = {}
+    location_functions = {}
+    for field, value in profile:
+      message = dict(fields(value)) if field in (4, 5) else None
+      if field == 5:
+        function_names[message[1]] = strings[message[2]]
+      elif field == 4:
+        location_functions[message[1]] = dict(fields(message[4]))[1]
+    inuse = {}
+    for field, value in profile:
+      if field == 2:
+        sample = dict(fields(value))
+        name = function_names[location_functions[varints(sample[1])[0]]]
+        inuse[name] = inuse.get(name, 0) + varints(sample[2])[3]
+    print(inuse)
+    assert 0.8 * 1000 * 1000 < inuse['_leak_memory'] < 1.2 * 1000 * 1000
+    assert inuse['_churn_memory'] == 0
+
+    out, err = Popen([PYTHON, EMCC, 'src.c', '-s', 'HEAP_PROFILER=1024', '-s', 'USE_PTHREADS=1'], stdout=PIPE, stderr=PIPE).communicate()
+    self.assertContained('-s HEAP_PROFILER is not supported with -s USE_PTHREADS>0!', err)
+
   def test_no_filesystem(self):
     FS_MARKER = 'var FS'
     # fopen forces full filesystem support
@@ -5339,6 +5822,17 @@ function _main() {
     do_log_test(path_from_root('tests', 'primes.cpp'), list(range(88, 94)), '_main')
     do_log_test(path_from_root('tests', 'fannkuch.cpp'), list(range(226, 235)), '__Z15fannkuch_workerPv')
 
+  def test_emterpreter_superinstructions(self):
+    def get_cases(args):
+      check_execute([PYTHON, EMCC, path_from_root('tests', 'fannkuch.cpp'), '-O2', '-s', 'EMTERPRETIFY=1'] + args)
+      self.assertContained('Pfannkuchen(5) = 7.', run_js('a.out.js', args=['5']))
+      src = open('a.out.js').read()
+      start = src.index('function emterpret(')
+      return src[start:src.index('\n}', start)].count('case ')
+    normal = get_cases([])
+    fused = get_cases(['-s', 'EMTERPRETIFY_SUPERINSTRUCTIONS=16'])
+    assert normal < fused <= normal + 16, [normal, fused]
+
   def test_emterpreter_advise(self):
     out = run_process([PYTHON, EMCC, path_from_root('tests', 'emterpreter_advise.cpp'), '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_ASYNC=1', '-s', 'EMTERPRETIFY_ADVISE=1'], stdout=PIPE).stdout
     self.assertContained('-s EMTERPRETIFY_WHITELIST=\'["__Z6middlev", "__Z7sleeperv", "__Z8recurserv", "_main"]\'', out)
@@ -5349,6 +5843,122 @@ function _main() {
     out = run_process([PYTHON, EMCC, path_from_root('tests', 'emterpreter_advise_synclist.c'), '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_ASYNC=1', '-s', 'EMTERPRETIFY_ADVISE=1', '-s', 'EMTERPRETIFY_SYNCLIST=["_j","_k"]'], stdout=PIPE).stdout
     self.assertContained('-s EMTERPRETIFY_WHITELIST=\'["_a", "_b", "_e", "_f", "_main"]\'', out)
 
+  def test_asyncify_prune_indirect_calls(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <emscripten.h>
+
+typedef int (*op_t)(int);
+typedef void (*callback_t)(void);
+
+int twice(int x) { return 2 * x; }
+void sleeper(void) { emscripten_sleep(1); printf("slept\n"); }
+
+op_t volatile op = twice;
+callback_t volatile callback = sleeper;
+
+__attribute__((noinline)) int call_op(int x) { return op(x); }
+__attribute__((noinline)) void call_callback(void) { callback(); }
+
+int main() {
+  printf("%d\n", call_op(21));
+  call_callback();
+  printf("%d\n", call_op(50));
+}
+''')
+    def get_body(js, name):
+      start = js.index('function ' + name + '(')
+      return js[start:js.index('\n}', start)]
+
+    for prune in [0, 1]:
+      print(prune)
+      run_process([PYTHON, EMCC, 'src.c', '-O1', '--profiling-funcs', '-s', 'ASYNCIFY=1', '-s', 'ASYNCIFY_PRUNE_INDIRECT_CALLS=%d' % prune])
+      self.assertContained('42\nslept\n100\n', run_js('a.out.js'))
+      js = open('a.out.js').read()
+      # the call through a callback can sleep, the call through an op cannot
+      self.assertContained('___async', get_body(js, '_call_callback'))
+      if prune:
+        self.assertNotContained('___async', get_body(js, '_call_op'))
+      else:
+        self.assertContained('___async', get_body(js, '_call_op'))
+
+  def test_emterpreter_file_segments(self):
+    for segment_size in [1, 1024, 1024*1024]:
+      print(segment_size)
+      run_process([PYTHON, EMCC, path_from_root('tests', 'fannkuch.cpp'), '-O2', '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_FILE="code.dat"', '-s', 'EMTERPRETIFY_FILE_SEGMENT_SIZE=%d' % segment_size, '-s', 'ASSERTIONS=1'])
+      self.assertContained('Pfannkuchen(5) = 7.', run_js('a.out.js', args=['5']))
+      # the bytecode is read from the file as it is needed, not at startup
+      self.assertNotContained('bad or missing emterpreter file', open('a.out.js').read())
+
+  def test_emterpreter_profile(self):
+    open('src.c', 'w').write(r'''
+#include <emscripten.h>
+
+volatile int sum = 0;
+
+__attribute__((noinline)) void leaf(int i) {
+  sum += i;
+}
+
+__attribute__((noinline)) void sleeper() {
+  emscripten_sleep(1);
+}
+
+int main() {
+  for (int i = 0; i < 10000; i++) leaf(i);
+  sleeper();
+  sleeper();
+  EM_ASM({
+    var profile = Module.getEmterpreterProfile();
+    Module.print('first blacklisted: ' + profile.blacklist[0] + ', ' + profile.calls[profile.blacklist[0]]);
+    Module.print('sleeper paused: ' + profile.paused['_sleeper']);
+    Module.printEmterpreterProfile();
+  });
+}
+''')
+    run_process([PYTHON, EMCC, 'src.c', '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_ASYNC=1', '-s', 'EMTERPRETIFY_PROFILE=1'])
+    out = run_js('a.out.js')
+    self.assertContained('-s EMTERPRETIFY_WHITELIST=\'["_main","_sleeper"]\'', out)
+    self.assertContained('first blacklisted: _leaf, 10000', out)
+    self.assertContained('sleeper paused: 2', out)
+
+  def test_emterpreter_profile_cold_code(self):
+    open('src.c', 'w').write(r'''
+#include <stdio.h>
+#include <emscripten.h>
+
+volatile int sum = 0;
+
+__attribute__((noinline)) void hot(int i) {
+  sum += i;
+}
+
+__attribute__((noinline)) void cold() {
+  printf("cold %d\n", sum);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < 100; i++) hot(i);
+  if (argc > 1) cold();
+  EM_ASM({
+    if (Module.printEmterpreterProfile) {
+      Module.printEmterpreterProfile();
+      require('fs').writeFileSync('hot.json', JSON.stringify(Module.getEmterpreterProfile().blacklist));
+    }
+  });
+}
+''')
+    # without async, the profile is just of the code that ran
+    run_process([PYTHON, EMCC, 'src.c', '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_PROFILE=1'])
+    out = run_js('a.out.js', engine=NODE_JS)
+    self.assertContained('-s EMTERPRETIFY_BLACKLIST=\'["_hot",', out)
+    self.assertContained('"_main"', out)
+    self.assertNotContained('_cold', out)
+    self.assertNotContained('EMTERPRETIFY_WHITELIST', out)
+    # the rest is emterpreted, and its bytecode is only loaded if it is called
+    run_process([PYTHON, EMCC, 'src.c', '-s', 'EMTERPRETIFY=1', '-s', 'EMTERPRETIFY_BLACKLIST=@hot.json', '-s', 'EMTERPRETIFY_FILE="cold.dat"', '-s', 'EMTERPRETIFY_FILE_SEGMENT_SIZE=1'])
+    self.assertContained('cold 4950', run_js('a.out.js', engine=NODE_JS, args=['x']))
+
   def test_link_with_a_static(self):
     for args in [[], ['-O2']]:
       print(args)
@@ -5456,7 +6066,114 @@ int main(void) {
       self.assertContained('hello, world!', run_js('a.out.js'))
 
     test([], 1)
-    test(['-s', 'OUTLINING_LIMIT=100000'], 2) # 2, because we run them before and after outline, which is non-native
+    test(['-s', 'OUTLINING_LIMIT=100000'], 1) # outline is native too, so it runs with the rest
+
+  def test_js_optimizer_cache(self):
+    try_delete(Cache.get_path('jsopt_funcs'))
+    def build():
+      old_debug = os.environ.get('EMCC_DEBUG')
+      try:
+        os.environ['EMCC_DEBUG'] = '1'
+        os.environ['EMCC_JSOPT_CACHE'] = '1'
+        with clean_write_access_to_canonical_temp_dir(self.canonical_temp_dir):
+          err = run_process([PYTHON, EMCC, path_from_root('tests', 'hello_libcxx.cpp'), '-O2'], stderr=PIPE).stderr
+      finally:
+        if old_debug: os.environ['EMCC_DEBUG'] = old_debug
+        else: del os.environ['EMCC_DEBUG']
+        del os.environ['EMCC_JSOPT_CACHE']
+      self.assertContained('hello, world!', run_js('a.out.js'))
+      return [(int(reused), int(total)) for reused, total in re.findall(r'js optimizer cache: reusing (\d+) of (\d+) functions', err)], open('a.out.js').read()
+
+    first, first_js = build()
+    assert len(first) > 0 and all([reused == 0 for reused, total in first]), first
+    # linking again finds every function in the cache, and emits the same code
+    second, second_js = build()
+    assert second == [(total, total) for reused, total in first], [first, second]
+    self.assertIdentical(first_js, second_js)
+
+  def test_jslib_cache(self):
+    try_delete(Cache.get_path('jslib'))
+    def build(args):
+      old_debug = os.environ.get('EMCC_DEBUG')
+      try:
+        os.environ['EMCC_DEBUG'] = '1'
+        os.environ['EMCC_JSLIB_CACHE'] = '1'
+        with clean_write_access_to_canonical_temp_dir(self.canonical_temp_dir):
+          err = run_process([PYTHON, EMCC, path_from_root('tests', 'hello_world.c')] + args, stderr=PIPE).stderr
+      finally:
+        if old_debug: os.environ['EMCC_DEBUG'] = old_debug
+        else: del os.environ['EMCC_DEBUG']
+        del os.environ['EMCC_JSLIB_CACHE']
+      self.assertContained('hello, world!', run_js('a.out.js'))
+      return 'reusing cached js compiler output' in err, open('a.out.js').read()
+
+    reused, first_js = build([])
+    assert not reused
+    # linking again with the same settings reuses the output, and emits the same code
+    reused, second_js = build([])
+    assert reused
+    self.assertIdentical(first_js, second_js)
+    # different settings are a different entry
+    reused, _ = build(['-s', 'ASSERTIONS=0'])
+    assert not reused
+
+  def test_nm_cache(self):
+    try_delete(Cache.get_path('nm_index'))
+    open('a.c', 'w').write('int a() { return 1; }')
+    open('b.c', 'w').write('int b() { return 2; }')
+    open('main.c', 'w').write('''
+      #include <stdio.h>
+      int a();
+      int main() { printf("a: %d\\n", a()); }
+    ''')
+    def make_archive():
+      run_process([PYTHON, EMCC, 'a.c', '-o', 'a.o'])
+      run_process([PYTHON, EMCC, 'b.c', '-o', 'b.o'])
+      try_delete('lib.a')
+      run_process([PYTHON, EMAR, 'cr', 'lib.a', 'a.o', 'b.o'])
+    def build():
+      old_debug = os.environ.get('EMCC_DEBUG')
+      try:
+        os.environ['EMCC_DEBUG'] = '1'
+        os.environ['EMCC_NM_CACHE'] = '1'
+        with clean_write_access_to_canonical_temp_dir(self.canonical_temp_dir):
+          err = run_process([PYTHON, EMCC, 'main.c', 'lib.a'], stderr=PIPE).stderr
+      finally:
+        if old_debug: os.environ['EMCC_DEBUG'] = old_debug
+        else: del os.environ['EMCC_DEBUG']
+        del os.environ['EMCC_NM_CACHE']
+      self.assertContained('a: 1', run_js('a.out.js'))
+      return 'archive index: reusing symbols of' in err
+
+    make_archive()
+    assert not build()
+    # linking against the same archive again resolves its members from the index
+    assert build()
+    # a rebuilt archive is scanned again
+    time.sleep(1)
+    make_archive()
+    assert not build()
+
+  def test_tty_batch_output(self):
+    open('src.c', 'w').write(r'''
+      #include <stdio.h>
+      int main() {
+        for (int i = 0; i < 2500; i++) printf("line %d, ünicode ✓\n", i);
+        printf("part");
+        fflush(stdout);
+        puts("ial");
+        fprintf(stderr, "to stderr\n");
+        printf("no newline at the end");
+        fflush(stdout);
+      }
+    ''')
+    expected = ''.join('line %d, ünicode ✓\n' % i for i in range(2500)) + 'partial\nno newline at the end\n'
+    for args in [[], ['-s', 'TTY_BATCH_OUTPUT=1']]:
+      print(args)
+      run_process([PYTHON, EMCC, 'src.c'] + args)
+      out = run_js('a.out.js', stderr=PIPE, full_output=True)
+      self.assertContained(expected, out)
+      self.assertContained('to stderr\n', out)
 
   def test_emconfigure_js_o(self):
     # issue 2994
@@ -5528,6 +6245,35 @@ int main(void) {
       test(['-Oz'], '-Oz')
       test(['-Os'], '-Os')
 
+  def test_emcc_c_multi_parallel(self):
+    # several sources are compiled in parallel, and what the compiler prints
+    # still comes out in the order of the inputs
+    names = ['f%d.c' % i for i in range(8)]
+    for i, name in enumerate(names):
+      open(name, 'w').write('int f%d() { int unused%d; return %d; }\n' % (i, i, i))
+    open('main.c', 'w').write(r'''
+      #include <stdio.h>
+      %s
+      int main() {
+        printf("sum: %%d\n", %s);
+        return 0;
+      }
+    ''' % (' '.join(['int f%d();' % i for i in range(len(names))]), ' + '.join(['f%d()' % i for i in range(len(names))])))
+    env = os.environ.copy()
+    env['EMCC_CORES'] = '4'
+    err = run_process([PYTHON, EMCC, '-c', '-Wunused-variable', 'main.c'] + names, stderr=PIPE, env=env).stderr
+    positions = [err.find("unused variable 'unused%d'" % i) for i in range(len(names))]
+    assert -1 not in positions and positions == sorted(positions), err
+    run_process([PYTHON, EMCC, 'main.o'] + [name.replace('.c', '.o') for name in names])
+    self.assertContained('sum: 28', run_js('a.out.js'))
+
+    # a failing source is reported, and emcc fails
+    open(names[3], 'w').write('int f3() { return }\n')
+    proc = run_process([PYTHON, EMCC, '-c', 'main.c'] + names, stderr=PIPE, env=env, check=False)
+    assert proc.returncode != 0
+    self.assertContained('f3.c:1:', proc.stderr)
+    self.assertContained('compiler frontend failed to generate LLVM bitcode', proc.stderr)
+
   def test_export_all_3142(self):
     open('src.cpp', 'w').write(r'''
 typedef unsigned int Bit32u;
@@ -6162,6 +6908,141 @@ int main() { printf("Mary had a little lamb.\n"); }
     out = run_js('a.out.js', assert_returncode=None, stderr=subprocess.STDOUT)
     self.assertContained('Assertion failed: memory initializer checksum', out)
 
+  def test_meminit_compression(self):
+    # a memory initializer with long runs of zeros and repetitive data in between
+    with open('src.c', 'w') as f:
+      f.write(r'''
+#include <stdio.h>
+int zeros[10000] = { 1 };
+int table[4096] = { %s };
+int main() {
+  int sum = 0;
+  for (int i = 0; i < 4096; i++) sum += table[i];
+  printf("sum: %%d %%d %%d\n", sum, zeros[0], zeros[9999]);
+}
+''' % ', '.join([str(i % 16) for i in range(4096)]))
+    sizes = {}
+    for compression in [0, 1, 2]:
+      for args in [['--memory-init-file', '1'], ['--memory-init-file', '0', '-s', 'MEM_INIT_METHOD=2'], ['-s', 'ASSERTIONS=1', '--memory-init-file', '1']]:
+        print(compression, args)
+        run_process([PYTHON, EMCC, 'src.c', '-O2', '-s', 'MEM_INIT_COMPRESSION=%d' % compression] + args)
+        self.assertContained('sum: 30720 1 0', run_js('a.out.js'))
+      sizes[compression] = os.path.getsize('a.out.js.mem')
+    print(sizes)
+    assert sizes[1] < sizes[0] / 2, sizes # the zeros are skipped
+    assert sizes[2] < sizes[1] / 2, sizes # the table compresses well
+
+  def test_remove_nothrow_invokes(self):
+    # work() and fail() are in another file, so that when compiling main() it is not known that work()
+    # cannot throw, and calls to both are invokes
+    with open('main.cpp', 'w') as f:
+      f.write(r'''
+#include <stdio.h>
+int work(int x);
+int fail(int x);
+int main(int argc, char **argv) {
+  int sum = 0, caught = 0;
+  for (int i = 0; i < argc * 10; i++) {
+    try {
+      sum += work(i);
+      sum += fail(i);
+    } catch (int e) {
+      caught += e;
+    }
+  }
+  printf("sum: %d, caught: %d\n", sum, caught);
+}
+''')
+    with open('lib.cpp', 'w') as f:
+      f.write(r'''
+int work(int x) {
+  return x * 2 + 1;
+}
+int fail(int x) {
+  if (x > 5) throw x;
+  return x;
+}
+''')
+    invokes = {}
+    for remove in [0, 1, 2]:
+      print(remove)
+      proc = run_process([PYTHON, EMCC, 'main.cpp', 'lib.cpp', '-O2', '-s', 'DISABLE_EXCEPTION_CATCHING=0', '-s', 'REMOVE_NOTHROW_INVOKES=%d' % remove], stderr=PIPE)
+      self.assertContained('sum: 115, caught: 30', run_js('a.out.js'))
+      with open('a.out.js') as f:
+        invokes[remove] = f.read().count('invoke_ii(')
+      if remove == 2:
+        self.assertContained('nothrow invokes: removed ', proc.stderr)
+        self.assertContained('__Z4faili  (___cxa_throw)', proc.stderr)
+      else:
+        self.assertNotContained('nothrow invokes', proc.stderr)
+    print(invokes)
+    assert invokes[1] < invokes[0], invokes
+    # also in wasm, where the optimizer runs on the asm.js before it is compiled to wasm
+    run_process([PYTHON, EMCC, 'main.cpp', 'lib.cpp', '-O2', '-s', 'WASM=1', '-s', 'DISABLE_EXCEPTION_CATCHING=0', '-s', 'REMOVE_NOTHROW_INVOKES=1'])
+    self.assertContained('sum: 115, caught: 30', run_js('a.out.js'))
+
+  def test_devirtualize_calls(self):
+    # the shapes are created in another file, so that when compiling main() it is not known what type they are,
+    # and area() and scale() are virtual calls. there are two implementations of each, and the tables for their
+    # signatures also hold a few functions of libc
+    with open('main.cpp', 'w') as f:
+      f.write(r'''
+#include <stdio.h>
+#include "shapes.h"
+int main(int argc, char **argv) {
+  int total = 0;
+  for (int i = 0; i < argc * 10; i++) {
+    Shape *shape = make(i);
+    shape->scale(2);
+    total += shape->area();
+    delete shape;
+  }
+  printf("total: %d\n", total);
+}
+''')
+    with open('shapes.h', 'w') as f:
+      f.write(r'''
+struct Shape {
+  virtual ~Shape() {}
+  virtual void scale(int by) = 0;
+  virtual int area() = 0;
+};
+Shape *make(int i);
+''')
+    with open('shapes.cpp', 'w') as f:
+      f.write(r'''
+#include "shapes.h"
+struct Square : Shape {
+  int side;
+  Square(int side) : side(side) {}
+  void scale(int by) { side *= by; }
+  int area() { return side * side; }
+};
+struct Circle : Shape {
+  int radius;
+  Circle(int radius) : radius(radius) {}
+  void scale(int by) { radius += by; }
+  int area() { return 3 * radius * radius; }
+};
+Shape *make(int i) {
+  if (i & 1) return new Square(i);
+  return new Circle(i);
+}
+''')
+    calls = {}
+    for targets in [0, 1, 4]:
+      print(targets)
+      run_process([PYTHON, EMCC, 'main.cpp', 'shapes.cpp', '-O2', '--profiling-funcs', '-s', 'DEVIRTUALIZE_CALLS=%d' % targets])
+      self.assertContained('total: 1320', run_js('a.out.js'))
+      with open('a.out.js') as f:
+        calls[targets] = f.read().count('__ZN6Square4areaEv(')
+    print(calls)
+    assert calls[0] == calls[1] == 1, calls # just the function itself
+    assert calls[4] > 1, calls
+    # also in wasm, where the optimizer runs on the asm.js before it is compiled to wasm
+    run_process([PYTHON, EMCC, 'main.cpp', 'shapes.cpp', '-O2', '-s', 'WASM=1', '-s', 'DEVIRTUALIZE_CALLS=4'])
+    self.assertContained('total: 1320', run_js('a.out.js'))
+
   def test_emscripten_print_double(self):
     with open('src.c', 'w') as f:
       f.write(r'''
@@ -7096,6 +7977,123 @@ int main() {}
     finally:
       del os.environ['EMCC_DEBUG']
 
+  def test_eval_ctors_keep_going(self):
+    # a bad ctor in the middle, ctors after it that do and do not depend on it, and one that mallocs. there are
+    # enough ctors to eval them in parallel first.
+    open('src.cpp', 'w').write(r'''
+      #include <stdio.h>
+      #include <stdlib.h>
+      volatile int values[8];
+      volatile int bad = 0;
+      int *allocated;
+      struct Set {
+        Set(int i) {
+          volatile int y = i;
+          values[i] = y * 10;
+        }
+      };
+      struct Bad {
+        Bad() {
+          bad = 5;
+          printf("you can't eval me ahead of time\n");
+        }
+      };
+      struct ReadsBad {
+        ReadsBad() {
+          values[7] = bad + 1;
+        }
+      };
+      struct Allocates {
+        Allocates() {
+          allocated = (int*)malloc(16);
+          allocated[3] = 42;
+        }
+      };
+      Set __attribute__((init_priority(1000))) s0(0);
+      Set __attribute__((init_priority(1001))) s1(1);
+      Bad __attribute__((init_priority(1002))) b;
+      Set __attribute__((init_priority(1003))) s2(2);
+      ReadsBad __attribute__((init_priority(1004))) r;
+      Set __attribute__((init_priority(1005))) s3(3);
+      Allocates __attribute__((init_priority(1006))) a;
+      Set __attribute__((init_priority(1007))) s4(4);
+      Set __attribute__((init_priority(1008))) s5(5);
+      int main() {
+        for (int i = 0; i < 8; i++) printf("%d ", values[i]);
+        int *more = (int*)malloc(16);
+        printf("\n%d %d\n", allocated[3], more != allocated);
+      }
+    ''')
+    expected = "you can't eval me ahead of time\n0 10 20 30 40 50 0 6 \n42 1\n"
+    sizes = {}
+    for mode in ['0', '1', '2']:
+      for cores in ['1', '4']:
+        print(mode, cores)
+        env = os.environ.copy()
+        env['EMCC_CORES'] = cores
+        check_execute([PYTHON, EMCC, 'src.cpp', '-O2', '-s', 'EVAL_CTORS=' + mode], env=env)
+        self.assertContained(expected, run_js('a.out.js'))
+        sizes[mode] = os.stat('a.out.js').st_size
+    assert sizes['2'] < sizes['1'] < sizes['0'], sizes
+
+  def test_snapshot(self):
+    open('src.cpp', 'w').write(r'''
+      #include <stdio.h>
+      #include <stdlib.h>
+      #include <string.h>
+      #include <sys/stat.h>
+      #include <emscripten.h>
+      struct Global {
+        int value;
+        Global() {
+          printf("ctor\n");
+          value = 17;
+        }
+      } global;
+      char *data;
+      void goodbye() {
+        printf("atexit %s\n", data);
+      }
+      void resume() {
+        printf("resumed %d %s\n", global.value, data);
+        FILE *f = fopen("/work/init.txt", "r");
+        char buffer[100] = {};
+        fread(buffer, 1, sizeof(buffer) - 1, f);
+        fclose(f);
+        printf("file: %s\n", buffer);
+        char *more = (char*)malloc(32);
+        printf("distinct: %d\n", more != data);
+      }
+      int main() {
+        printf("init\n");
+        data = strdup("from init");
+        global.value++;
+        mkdir("/work", 0777);
+        FILE *f = fopen("/work/init.txt", "w");
+        fputs("written in init", f);
+        fclose(f);
+        atexit(goodbye);
+        emscripten_snapshot_point(resume);
+        return 0;
+      }
+    ''')
+    expected = 'resumed 18 from init\nfile: written in init\ndistinct: 1\natexit from init\n'
+    print('without a snapshot')
+    check_execute([PYTHON, EMCC, 'src.cpp', '-O2', '-s', 'NO_EXIT_RUNTIME=0'])
+    self.assertContained('ctor\ninit\n' + expected, run_js('a.out.js'))
+    print('with a snapshot')
+    check_execute([PYTHON, EMCC, 'src.cpp', '-O2', '-s', 'NO_EXIT_RUNTIME=0', '-s', 'SNAPSHOT=1'])
+    assert os.path.exists('a.out.js.snapshot')
+    out = run_js('a.out.js')
+    self.assertContained(expected, out)
+    assert out.startswith('resumed'), 'the ctor and main do not run again'
+    print('errors')
+    err = run_process([PYTHON, EMCC, 'src.cpp', '-O2', '-s', 'SNAPSHOT=1', '--memory-init-file', '0'], stderr=PIPE, check=False).stderr
+    self.assertContained('-s SNAPSHOT=1 requires --memory-init-file 1', err)
+    open('never.c', 'w').write('int main() { return 0; }')
+    err = run_process([PYTHON, EMCC, 'never.c', '-O2', '-s', 'SNAPSHOT=1'], stderr=PIPE, check=False).stderr
+    self.assertContained('the program did not reach emscripten_snapshot_point()', err)
+
   def test_override_environment(self):
     open('main.cpp', 'w').write(r'''
       #include <emscripten.h>
@@ -7724,6 +8722,30 @@ int main() {
           assert proc.returncode != 0, proc.stderr
           assert 'hello, world!' not in proc.stdout, proc.stdout
 
+  def test_asm_metadce(self):
+    def get_sent(args):
+      run_process([PYTHON, EMCC, path_from_root('tests', 'hello_world.c'), '-g1'] + args)
+      self.assertContained('hello, world!', run_js('a.out.js'))
+      js = open('a.out.js').read()
+      start = js.find('Module.asmLibraryArg = ')
+      start = js.find('{', start)
+      end = js.find('}', start)
+      sent = [x.split(':')[0].strip().strip('"\'') for x in js[start + 1:end].split(',')]
+      return set([x for x in sent if x]), len(js)
+
+    # in -O3, -Os and -Oz we metadce the asm.js module and the JS around it together
+    no_metadce, no_metadce_size = get_sent(['-O2'])
+    for args in [['-O3'], ['-Os'], ['-Oz']]:
+      print(args)
+      sent, size = get_sent(args)
+      print('  sent %d imports, %d without metadce' % (len(sent), len(no_metadce)))
+      assert len(sent) < len(no_metadce), [sent, no_metadce]
+      assert sent.issubset(no_metadce), sent.difference(no_metadce)
+      assert size < no_metadce_size, [size, no_metadce_size]
+      # values the asm.js code reads, and functions it calls, are still sent
+      for name in ['abort', 'STACKTOP', 'tempDoublePtr']:
+        assert name in sent, name
+
   def test_binaryen_metadce(self):
     def test(filename, expectations):
       sizes = {}
@@ -8091,8 +9113,14 @@ end
   def test_toolchain_profiler(self):
     environ = os.environ.copy()
     environ['EM_PROFILE_TOOLCHAIN'] = '1'
+    run_process([PYTHON, path_from_root('tools', 'emprofile.py'), '--reset'])
     # replaced subprocess functions should not cause errors
     run_process([PYTHON, EMCC, path_from_root('tests', 'hello_world.c')], env=environ)
+    run_process([PYTHON, path_from_root('tools', 'emprofile.py'), '--graph', '--outfile=profile.html'])
+    # blocks record how much CPU they used, for telling it apart from waiting
+    results = json.load(open('profile.json'))
+    blocks = [r for r in results if r['op'] == 'exitBlock' and r['name'] == 'link']
+    assert len(blocks) == 1 and 'cpuMs' in blocks[0]['details'] and 'childCpuMs' in blocks[0]['details'], blocks
 
   def test_noderawfs(self):
     fopen_write = open(path_from_root('tests', 'asmfs', 'fopen_write.cpp'), 'r').read()
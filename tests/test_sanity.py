@@ -732,6 +732,7 @@ fi
       ([PYTHON, 'embuilder.py', 'build', 'binaryen'], ['building and verifying binaryen', 'success'], True, []),
       ([PYTHON, 'embuilder.py', 'build', 'cocos2d'], ['building and verifying cocos2d', 'success'], True, [os.path.join('ports-builds', 'Cocos2d', 'libCocos2d.bc')]),
       ([PYTHON, 'embuilder.py', 'build', 'wasm-libc'], ['building and verifying wasm-libc', 'success'], True, ['wasm-libc.bc']),
+      ([PYTHON, 'embuilder.py', 'build', 'VARIANTS'], ['building and verifying libc.bc', 'building and verifying wasm-libc.bc', 'success'], True, ['libc.bc', 'libcxx.a', 'libcxx.bc', 'libcxxabi.bc', 'gl.bc', 'al.bc', 'html5.bc', 'compiler-rt.a', 'libcxx_noexcept.a', 'dlmalloc_debug.bc', 'wasm-libc.bc']),
     ]
     if Settings.WASM_BACKEND:
       tests.append(([PYTHON, 'embuilder.py', 'build', 'wasm_compiler_rt'], ['building and verifying wasm_compiler_rt', 'success'], True, ['wasm_compiler_rt.a']),)
@@ -31,13 +31,14 @@ def make_relay_server(port1, port2):
   return proc
 
 class WebsockifyServerHarness(object):
-  def __init__(self, filename, args, listen_port, do_server_check=True):
+  def __init__(self, filename, args, listen_port, do_server_check=True, multiplex=False):
     self.processes = []
     self.filename = filename
     self.listen_port = listen_port
     self.target_port = listen_port-1
     self.args = args or []
     self.do_server_check = do_server_check
+    self.multiplex = multiplex
 
   def __enter__(self):
     import socket, websockify
@@ -55,7 +56,7 @@ class WebsockifyServerHarness(object):
 
     # start the websocket proxy
     print('running websockify on %d, forward to tcp %d' % (self.listen_port, self.target_port), file=sys.stderr)
-    wsp = websockify.WebSocketProxy(verbose=True, listen_port=self.listen_port, target_host="127.0.0.1", target_port=self.target_port, run_once=True)
+    wsp = websockify.WebSocketProxy(verbose=True, listen_port=self.listen_port, target_host="127.0.0.1", target_port=self.target_port, run_once=True, multiplex=self.multiplex)
     self.websockify = multiprocessing.Process(target=wsp.start_server)
     self.websockify.start()
     self.processes.append(self.websockify)
@@ -407,6 +408,61 @@ int main () {
     print('expect fail')
     self.btest(os.path.join('sockets', 'test_sockets_echo_client.c'), expected='0', args=['-DSOCKK=49169', '-DTEST_ASYNC=1', sockets_include])
 
+  def test_sockets_wait_echo(self):
+    sockets_include = '-I'+path_from_root('tests', 'sockets')
+
+    harnesses = [
+      (CompiledServerHarness(os.path.join('sockets', 'test_sockets_echo_server.c'), [sockets_include, '-DTEST_DGRAM=0'], 49211), 0),
+      (CompiledServerHarness(os.path.join('sockets', 'test_sockets_echo_server.c'), [sockets_include, '-DTEST_DGRAM=1'], 49212), 1)
+    ]
+
+    for harness, datagram in harnesses:
+      with harness:
+        self.btest(os.path.join('sockets', 'test_sockets_echo_client.c'), expected='0', args=['-DSOCKK=%d' % harness.listen_port, '-DTEST_DGRAM=%d' % datagram, '-DTEST_WAIT=1', sockets_include])
+
+  def test_sockets_multiplex_echo(self):
+    if WINDOWS: return self.skip('Python pickling bug causes WebsockifyServerHarness to not work on Windows')
+    sockets_include = '-I'+path_from_root('tests', 'sockets')
+    open(os.path.join(self.get_dir(), 'multiplex_pre.js'), 'w').write('''
+      var Module = { websocket: { multiplex: true } };
+    ''')
+    with WebsockifyServerHarness(os.path.join('sockets', 'test_sockets_echo_server.c'), [sockets_include], 49214, multiplex=True):
+      self.btest(os.path.join('sockets', 'test_sockets_echo_client.c'), expected='0', args=['-DSOCKK=49214', '-DTEST_DGRAM=0', sockets_include, '--pre-js', 'multiplex_pre.js'])
+
+  def test_sockets_datachannel(self):
+    # the signaling connects two RTCPeerConnections of the page to each other directly
+    open(os.path.join(self.get_dir(), 'datachannel_pre.js'), 'w').write('''
+      var listeners = {};
+      var Module = {
+        datachannel: {
+          connect: function(addr, port) {
+            var local = new RTCPeerConnection(), remote = new RTCPeerConnection();
+            local.onicecandidate = function(e) { if (e.candidate) remote.addIceCandidate(e.candidate); };
+            remote.onicecandidate = function(e) { if (e.candidate) local.addIceCandidate(e.candidate); };
+            remote.ondatachannel = function(e) { listeners[port](e.channel, addr, 0); };
+            var channel = local.createDataChannel('sockfs', { ordered: false, maxRetransmits: 0 });
+            local.createOffer().then(function(offer) {
+              return local.setLocalDescription(offer);
+            }).then(function() {
+              return remote.setRemoteDescription(local.localDescription);
+            }).then(function() {
+              return remote.createAnswer();
+            }).then(function(answer) {
+              return remote.setLocalDescription(answer);
+            }).then(function() {
+              return local.setRemoteDescription(remote.localDescription);
+            });
+            return channel;
+          },
+          listen: function(port, accept) {
+            listeners[port] = accept;
+            return function() { delete listeners[port]; };
+          }
+        }
+      };
+    ''')
+    self.btest(os.path.join('sockets', 'test_sockets_datachannel.c'), expected='1', args=['--pre-js', 'datachannel_pre.js'])
+
   def test_sockets_echo_bigdata(self):
     sockets_include = '-I'+path_from_root('tests', 'sockets')
 
@@ -0,0 +1,76 @@
+// Tests that texture uploads give the same texture contents whether they are staged through a pixel unpack buffer
+// (-s GL_PBO_UPLOAD_THRESHOLD=N) or not, and that staging leaves the pixel unpack buffer binding of the application alone.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+#include <GLES3/gl3.h>
+
+#define SIZE 128
+
+static unsigned char pixels[SIZE*SIZE*4];
+static unsigned char readback[SIZE*SIZE*4];
+
+static unsigned char expected(int x, int y, int c)
+{
+  // The bottom left 8x8 corner comes from a small upload, and the right half from a large one.
+  if (x < 8 && y < 8) return (unsigned char)(200 + c);
+  if (x >= SIZE/2) return (unsigned char)(x * 3 + y * 5 + c * 7 + 1);
+  return (unsigned char)(x + y * 2 + c * 50);
+}
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attr;
+  emscripten_webgl_init_context_attributes(&attr);
+  attr.majorVersion = 2;
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context(0, &attr);
+  int result = 0;
+  if (ctx > 0)
+  {
+    emscripten_webgl_make_context_current(ctx);
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    for(int y = 0; y < SIZE; ++y) for(int x = 0; x < SIZE; ++x) for(int c = 0; c < 4; ++c)
+      pixels[(y*SIZE + x)*4 + c] = (unsigned char)(x + y * 2 + c * 50);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SIZE, SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    for(int y = 0; y < SIZE; ++y) for(int x = 0; x < SIZE/2; ++x) for(int c = 0; c < 4; ++c)
+      pixels[(y*SIZE/2 + x)*4 + c] = (unsigned char)((x + SIZE/2) * 3 + y * 5 + c * 7 + 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, SIZE/2, 0, SIZE/2, SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    for(int i = 0; i < 8*8; ++i) for(int c = 0; c < 4; ++c) pixels[i*4 + c] = (unsigned char)(200 + c);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 8, 8, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    GLint unpackBuffer = -1;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+    assert(unpackBuffer == 0);
+    assert(glGetError() == GL_NO_ERROR);
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glReadPixels(0, 0, SIZE, SIZE, GL_RGBA, GL_UNSIGNED_BYTE, readback);
+    assert(glGetError() == GL_NO_ERROR);
+
+    for(int y = 0; y < SIZE; ++y) for(int x = 0; x < SIZE; ++x) for(int c = 0; c < 4; ++c)
+    {
+      if (readback[(y*SIZE + x)*4 + c] != expected(x, y, c))
+      {
+        printf("pixel %d,%d channel %d: %d, expected %d\n", x, y, c, readback[(y*SIZE + x)*4 + c], expected(x, y, c));
+        result = 1;
+        break;
+      }
+    }
+  }
+  else printf("WebGL 2 is not available, skipping the test.\n");
+#ifdef REPORT_RESULT
+  REPORT_RESULT(result);
+#endif
+}
@@ -0,0 +1,89 @@
+// Uploads a uniform array that is too large for the mini temp buffer, changing the data in place, from another address
+// and after the heap has grown, and checks that each draw sees the latest data.
+#include <GLES2/gl2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+
+#define NUM_VECTORS 80
+
+GLuint compileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, 0);
+  glCompileShader(shader);
+  GLint ok = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  assert(ok);
+  return shader;
+}
+
+void drawAndCheck(GLint location, const float *data, unsigned char r, unsigned char g, unsigned char b)
+{
+  glUniform4fv(location, NUM_VECTORS, data);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  unsigned char pixel[4];
+  glReadPixels(8, 8, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  printf("pixel: %d %d %d\n", pixel[0], pixel[1], pixel[2]);
+  assert(pixel[0] == r && pixel[1] == g && pixel[2] == b);
+}
+
+static float data[NUM_VECTORS*4];
+
+int main()
+{
+  emscripten_set_canvas_element_size("#canvas", 16, 16);
+  EmscriptenWebGLContextAttributes attrs;
+  emscripten_webgl_init_context_attributes(&attrs);
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_create_context(0, &attrs);
+  assert(context > 0);
+  emscripten_webgl_make_context_current(context);
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, compileShader(GL_VERTEX_SHADER,
+    "attribute vec2 pos; uniform vec4 data[80]; varying vec4 c;"
+    "void main() { c = vec4(0); for(int i = 0; i < 80; ++i) c += data[i]; gl_Position = vec4(pos, 0, 1); }"));
+  glAttachShader(program, compileShader(GL_FRAGMENT_SHADER,
+    "precision mediump float; varying vec4 c; void main() { gl_FragColor = c; }"));
+  glBindAttribLocation(program, 0, "pos");
+  glLinkProgram(program);
+  glUseProgram(program);
+  GLint location = glGetUniformLocation(program, "data");
+  assert(location >= 0);
+
+  static const float quad[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(0);
+  glViewport(0, 0, 16, 16);
+
+  data[79*4+0] = 1; data[79*4+3] = 1;
+  drawAndCheck(location, data, 255, 0, 0);
+
+  // The same address, with other contents.
+  memset(data, 0, sizeof(data));
+  data[40*4+1] = 1; data[40*4+3] = 1;
+  drawAndCheck(location, data, 0, 255, 0);
+
+  // Another address, in a heap that has grown since the last upload.
+  void *growth = malloc(64*1024*1024);
+  assert(growth);
+  float *moved = (float*)malloc(sizeof(data));
+  memset(moved, 0, sizeof(data));
+  moved[0*4+2] = 1; moved[0*4+3] = 1;
+  drawAndCheck(location, moved, 0, 0, 255);
+  free(moved);
+  free(growth);
+
+  assert(glGetError() == GL_NO_ERROR);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Prefetches two programs and checks that compiling and linking the same sources takes them over only when the
+// attribute bindings match, and that the programs work either way.
+#include <GLES2/gl2.h>
+#include <stdio.h>
+#include <assert.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+
+static const char *vertexSource = "attribute vec2 pos; void main() { gl_Position = vec4(pos, 0, 1); }";
+static const char *redSource = "precision mediump float; void main() { gl_FragColor = vec4(1, 0, 0, 1); }";
+static const char *greenSource = "precision mediump float; void main() { gl_FragColor = vec4(0, 1, 0, 1); }";
+
+int numPrefetchedPrograms()
+{
+  return EM_ASM_INT({
+    var programs = GL.currentContext.prefetchedPrograms;
+    var num = 0;
+    for (var key in programs) num += programs[key].length;
+    return num;
+  });
+}
+
+GLuint compileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, 0);
+  glCompileShader(shader);
+  GLint ok = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  assert(ok);
+  return shader;
+}
+
+GLuint linkProgram(const char *fragmentSource, const char *attrib)
+{
+  GLuint program = glCreateProgram();
+  GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource), fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glBindAttribLocation(program, 0, attrib);
+  glLinkProgram(program);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  GLint ok = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &ok);
+  assert(ok);
+  return program;
+}
+
+void drawAndCheck(GLuint program, unsigned char r, unsigned char g, unsigned char b)
+{
+  glUseProgram(program);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  unsigned char pixel[4];
+  glReadPixels(8, 8, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+  printf("pixel: %d %d %d\n", pixel[0], pixel[1], pixel[2]);
+  assert(pixel[0] == r && pixel[1] == g && pixel[2] == b);
+}
+
+int main()
+{
+  emscripten_set_canvas_element_size("#canvas", 16, 16);
+  EmscriptenWebGLContextAttributes attrs;
+  emscripten_webgl_init_context_attributes(&attrs);
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_create_context(0, &attrs);
+  assert(context > 0);
+  emscripten_webgl_make_context_current(context);
+
+  const char *attribs[] = { "pos" };
+  assert(emscripten_webgl_prefetch_program(vertexSource, redSource, attribs, 1) == EMSCRIPTEN_RESULT_SUCCESS);
+  assert(emscripten_webgl_prefetch_program(vertexSource, greenSource, attribs, 1) == EMSCRIPTEN_RESULT_SUCCESS);
+  assert(numPrefetchedPrograms() == 2);
+  int pending = emscripten_webgl_get_pending_program_prefetches();
+  assert(pending >= 0 && pending <= 2);
+
+  static const float quad[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(0);
+  glViewport(0, 0, 16, 16);
+
+  GLuint red = linkProgram(redSource, "pos");
+  assert(numPrefetchedPrograms() == 1);
+  drawAndCheck(red, 255, 0, 0);
+
+  // Another binding, so this one is linked from scratch.
+  GLuint green = linkProgram(greenSource, "position");
+  assert(numPrefetchedPrograms() == 1);
+  glDeleteProgram(green);
+  green = linkProgram(greenSource, "pos");
+  assert(numPrefetchedPrograms() == 0);
+  drawAndCheck(green, 0, 255, 0);
+
+  // Linking a taken over program again works as usual.
+  glLinkProgram(red);
+  drawAndCheck(red, 255, 0, 0);
+
+  assert(glGetError() == GL_NO_ERROR);
+  assert(emscripten_webgl_get_pending_program_prefetches() == 0);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
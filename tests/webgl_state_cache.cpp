@@ -0,0 +1,68 @@
+#include <GLES2/gl2.h>
+#include <stdio.h>
+#include <emscripten.h>
+#include <emscripten/html5.h>
+#include <assert.h>
+
+GLuint getInteger(GLenum pname)
+{
+  GLint value = -1;
+  glGetIntegerv(pname, &value);
+  return value;
+}
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attrs;
+  emscripten_webgl_init_context_attributes(&attrs);
+
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_create_context(0, &attrs);
+  assert(context > 0);
+  emscripten_webgl_make_context_current(context);
+  assert(emscripten_webgl_get_redundant_state_changes(context) == 0);
+
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]); // Dropped.
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  assert(getInteger(GL_ARRAY_BUFFER_BINDING) == buffers[1]);
+  assert(getInteger(GL_ELEMENT_ARRAY_BUFFER_BINDING) == buffers[0]);
+  // Deleting the bound buffer unbinds it.
+  glDeleteBuffers(1, &buffers[1]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0); // Dropped.
+  assert(getInteger(GL_ARRAY_BUFFER_BINDING) == 0);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  assert(getInteger(GL_ARRAY_BUFFER_BINDING) == buffers[0]);
+  assert(emscripten_webgl_get_redundant_state_changes(context) == 2);
+
+  GLuint textures[2];
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glActiveTexture(GL_TEXTURE1);
+  glActiveTexture(GL_TEXTURE1); // Dropped.
+  glBindTexture(GL_TEXTURE_2D, textures[1]); // Not dropped, as this is another unit.
+  glBindTexture(GL_TEXTURE_2D, textures[1]); // Dropped.
+  assert(getInteger(GL_TEXTURE_BINDING_2D) == textures[1]);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, textures[0]); // Dropped.
+  assert(getInteger(GL_TEXTURE_BINDING_2D) == textures[0]);
+  assert(emscripten_webgl_get_redundant_state_changes(context) == 5);
+
+  glEnable(GL_BLEND);
+  glEnable(GL_BLEND); // Dropped.
+  glDisable(GL_BLEND);
+  glDisable(GL_BLEND); // Dropped.
+  glEnable(GL_BLEND);
+  assert(glIsEnabled(GL_BLEND));
+  assert(emscripten_webgl_get_redundant_state_changes(context) == 7);
+
+  assert(glGetError() == GL_NO_ERROR);
+  printf("%d redundant state changes dropped\n", emscripten_webgl_get_redundant_state_changes(context));
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
@@ -211,6 +211,16 @@ TheModule.print('struct_ptr_array[0]->attr2 == ' + arrayClass.get_struct_ptr_arr
 var receiver = new TheModule.ReceiveArrays();
 receiver.giveMeArrays([0.5, 0.25, 0.01, -20.42], [1, 4, 9, 10], 4);
 
+// [Buffer] arrays that view the heap are passed without a copy, so writes are seen by the caller
+var bufferPtr = TheModule._malloc(3 * 4);
+var heapView = new Float32Array(TheModule['HEAPF32'].buffer, bufferPtr, 3);
+heapView.set([1, 2, 3]);
+receiver.scaleArray(heapView, 3, 2);
+TheModule.print('heap view: ' + Array.prototype.join.call(heapView, ','));
+var jsArray = new Float32Array([1, 2, 3]);
+receiver.scaleArray(jsArray, 3, 2);
+TheModule.print('js array: ' + Array.prototype.join.call(jsArray, ','));
+
 // Test IDL_CHECKS=ALL
 
 try {
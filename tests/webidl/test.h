@@ -152,6 +152,12 @@ struct ReceiveArrays {
       printf("%d : %.2f\n", triangles[i], vertices[i]);
     }
   }
+  void scaleArray(float* values, int num, float factor) {
+    for (int i = 0; i < num; i++) {
+      values[i] *= factor;
+      printf("%.2f\n", values[i]);
+    }
+  }
 };
 
 struct StoreArray {
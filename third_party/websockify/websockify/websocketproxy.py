@@ -11,7 +11,7 @@ as taken from http://docs.python.org/dev/library/ssl.html#certificates
 
 '''
 
-import signal, socket, optparse, time, os, sys, subprocess, logging, errno
+import signal, socket, optparse, time, os, sys, subprocess, logging, errno, struct
 try:    from socketserver import ForkingMixIn
 except: from SocketServer import ForkingMixIn
 try:    from http.server import HTTPServer
@@ -61,12 +61,20 @@ Traffic Legend:
                 self.send_auth_error(ex)
                 raise
 
+    # Frame types of the multiplexing protocol, see do_multiplex()
+    MUX_OPEN, MUX_DATA, MUX_CLOSE, MUX_OPENED = range(4)
+
     def new_websocket_client(self):
         """
         Called after a new WebSocket connection has been established.
         """
         # Checking for a token is done in validate_connection()
 
+        if self.server.multiplex:
+            self.print_traffic(self.traffic_legend)
+            self.do_multiplex()
+            return
+
         # Connect to the target
         if self.server.wrap_cmd:
             msg = "connecting to command: '%s' (port %s)" % (" ".join(self.server.wrap_cmd), self.server.target_port)
@@ -207,6 +215,120 @@ Traffic Legend:
                 cqueue.append(buf)
                 self.print_traffic("{")
 
+    def mux_frame(self, kind, conn_id, payload=b''):
+        return struct.pack(">BI", kind, conn_id) + payload
+
+    def do_multiplex(self):
+        """
+        Proxy many logical connections over the client WebSocket.
+
+        Each WebSocket message is one frame: a type byte, a 32 bit
+        big-endian connection id, and the payload. MUX_OPEN carries
+        the target port (16 bit big-endian) and host, MUX_DATA carries
+        data, and MUX_CLOSE closes the connection from either end. A
+        MUX_OPEN is answered with MUX_OPENED, or with MUX_CLOSE if the
+        target could not be reached. When websockify was given a
+        target, every connection goes there and the requested address
+        is ignored.
+        """
+        targets = {}    # connection id -> target socket
+        tqueues = {}    # connection id -> data queued for the target
+        ids = {}        # target socket -> connection id
+        cqueue = []
+        c_pend = 0
+
+        def close_target(conn_id):
+            target = targets.pop(conn_id)
+            del tqueues[conn_id]
+            del ids[target]
+            try:
+                target.shutdown(socket.SHUT_RDWR)
+            except socket.error:
+                pass
+            target.close()
+
+        try:
+            while True:
+                wlist = [t for i, t in targets.items() if tqueues[i]]
+                if cqueue or c_pend: wlist.append(self.request)
+                rlist = [self.request] + list(targets.values())
+                try:
+                    ins, outs, excepts = select.select(rlist, wlist, [], 1)
+                except (select.error, OSError):
+                    exc = sys.exc_info()[1]
+                    err = exc.errno if hasattr(exc, 'errno') else exc[0]
+                    if err != errno.EINTR:
+                        raise
+                    continue
+
+                if self.request in outs:
+                    c_pend = self.send_frames(cqueue)
+                    cqueue = []
+
+                if self.request in ins:
+                    bufs, closed = self.recv_frames()
+                    for buf in bufs:
+                        if len(buf) < 5:
+                            continue
+                        kind, conn_id = struct.unpack(">BI", buf[:5])
+                        payload = buf[5:]
+                        if kind == self.MUX_OPEN and conn_id not in targets and len(payload) >= 2:
+                            if self.server.target_host:
+                                host, port = self.server.target_host, self.server.target_port
+                            else:
+                                port = struct.unpack(">H", payload[:2])[0]
+                                host = payload[2:].decode('utf-8')
+                            try:
+                                target = websocket.WebSocketServer.socket(host, port,
+                                        connect=True, use_ssl=self.server.ssl_target, unix_socket=self.server.unix_target)
+                            except Exception:
+                                self.log_message("%d: failed to connect to %s:%s", conn_id, host, port)
+                                cqueue.append(self.mux_frame(self.MUX_CLOSE, conn_id))
+                                continue
+                            if self.verbose:
+                                self.log_message("%d: connected to %s:%s", conn_id, host, port)
+                            targets[conn_id] = target
+                            tqueues[conn_id] = []
+                            ids[target] = conn_id
+                            cqueue.append(self.mux_frame(self.MUX_OPENED, conn_id))
+                        elif kind == self.MUX_DATA and conn_id in targets:
+                            tqueues[conn_id].append(payload)
+                        elif kind == self.MUX_CLOSE and conn_id in targets:
+                            close_target(conn_id)
+                    if closed:
+                        if self.verbose:
+                            self.log_message("Client closed multiplexed connection")
+                        raise self.CClose(closed['code'], closed['reason'])
+
+                for target in outs:
+                    if target is self.request or target not in ids:
+                        continue
+                    queue = tqueues[ids[target]]
+                    dat = queue.pop(0)
+                    sent = target.send(dat)
+                    if sent == len(dat):
+                        self.print_traffic(">")
+                    else:
+                        queue.insert(0, dat[sent:])
+                        self.print_traffic(".>")
+
+                for target in ins:
+                    if target is self.request or target not in ids:
+                        continue
+                    conn_id = ids[target]
+                    buf = target.recv(self.buffer_size)
+                    if len(buf) == 0:
+                        if self.verbose:
+                            self.log_message("%d: target closed connection", conn_id)
+                        close_target(conn_id)
+                        cqueue.append(self.mux_frame(self.MUX_CLOSE, conn_id))
+                    else:
+                        cqueue.append(self.mux_frame(self.MUX_DATA, conn_id, buf))
+                        self.print_traffic("{")
+        finally:
+            for conn_id in list(targets.keys()):
+                close_target(conn_id)
+
 class WebSocketProxy(websocket.WebSocketServer):
     """
     Proxy traffic to and from a WebSockets client to a normal TCP
@@ -226,6 +348,7 @@ class WebSocketProxy(websocket.WebSocketServer):
         self.unix_target    = kwargs.pop('unix_target', None)
         self.ssl_target     = kwargs.pop('ssl_target', None)
         self.heartbeat      = kwargs.pop('heartbeat', None)
+        self.multiplex      = kwargs.pop('multiplex', False)
 
         self.token_plugin = kwargs.pop('token_plugin', None)
         self.auth_plugin = kwargs.pop('auth_plugin', None)
@@ -288,6 +411,9 @@ class WebSocketProxy(websocket.WebSocketServer):
         if self.token_plugin:
             msg = "  - proxying from %s:%s to targets generated by %s" % (
                 self.listen_host, self.listen_port, type(self.token_plugin).__name__)
+        elif self.multiplex and not self.target_host:
+            msg = "  - proxying from %s:%s to the targets requested by multiplexed connections" % (
+                self.listen_host, self.listen_port)
         else:
             msg = "  - proxying from %s:%s to %s" % (
                 self.listen_host, self.listen_port, dst_string)
@@ -414,6 +540,10 @@ def websockify_init():
     parser.add_option("--log-file", metavar="FILE",
             dest="log_file",
             help="File where logs will be saved")
+    parser.add_option("--multiplex", action="store_true",
+            help="carry many target connections over each WebSocket, "
+            "using the framing of emscripten's multiplexed sockets. "
+            "without a target, connect to the ones the client asks for")
 
 
     (opts, args) = parser.parse_args()
@@ -448,7 +578,7 @@ def websockify_init():
     del opts.target_cfg
 
     # Sanity checks
-    if len(args) < 2 and not (opts.token_plugin or opts.unix_target):
+    if len(args) < 2 and not (opts.token_plugin or opts.unix_target or opts.multiplex):
         parser.error("Too few arguments")
     if sys.argv.count('--'):
         opts.wrap_cmd = args[1:]
@@ -473,7 +603,7 @@ def websockify_init():
     try:    opts.listen_port = int(opts.listen_port)
     except: parser.error("Error parsing listen port")
 
-    if opts.wrap_cmd or opts.unix_target or opts.token_plugin:
+    if opts.wrap_cmd or opts.unix_target or opts.token_plugin or len(args) < 2:
         opts.target_host = None
         opts.target_port = None
     else:
@@ -542,6 +672,7 @@ class LibProxyServer(ForkingMixIn, HTTPServer):
         self.token_plugin   = kwargs.pop('token_plugin', None)
         self.auth_plugin    = kwargs.pop('auth_plugin', None)
         self.heartbeat      = kwargs.pop('heartbeat', None)
+        self.multiplex      = kwargs.pop('multiplex', False)
 
         self.token_plugin = None
         self.auth_plugin = None
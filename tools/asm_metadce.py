@@ -0,0 +1,132 @@
+
+"""Whole-program dead code elimination across an asm.js module and the JS around it.
+
+jsifier.js includes the library functions that the code called before it was optimized, and the runtime has
+helpers that only some builds use, while the functions of the asm.js module are pruned, by eliminateDeadFuncs
+and pruneFunctions, only among themselves. This builds one graph of the asm.js functions, the JS functions, and
+the imports and exports between them, with the same JS side as the meta-DCE of wasm (see emitDCEGraph in
+tools/js-optimizer.js), finds what is reachable from the roots (what JS uses at the top level, the exports the
+user asked for, and the function tables, which can be called through dynCall from anywhere), and removes the
+rest: asm.js functions, the exports and imports of them, and then the JS that only those reached.
+"""
+
+from __future__ import print_function
+import json, logging, re
+
+from . import shared, js_optimizer
+from .asm_module import AsmModule
+
+# a function imported from the JS, which we can remove when nothing calls it. other imports are values, which
+# asm.js code uses by name, and are always kept.
+FUNCTION_IMPORT_PATTERN = re.compile(r'^[ \t]*var ([\w$]+) *= *env(?:\.([\w$]+)|\[[\'"]([\w$]+)[\'"]\]);\n', re.M)
+IMPORT_PATTERN = re.compile(r'\benv(?:\.([\w$]+)|\[[\'"]([\w$]+)[\'"]\])')
+EXPORT_PATTERN = re.compile(r'^\s*[\'"]?([\w$]+)[\'"]?\s*:\s*([\w$]+)\s*$')
+
+# the line that the js optimizer looks for, which the JS passes do not keep, being a comment
+SUFFIX_PATTERN = re.compile(r'^// EMSCRIPTEN_GENERATED_FUNCTIONS.*\n', re.M)
+
+# replaces the asm.js module in the code we run the JS passes on, like run_on_shell in tools/js_optimizer.py
+ASM_PLACEHOLDER = 'wakaAsm'
+
+
+def graph_name(kind, name):
+  return 'emcc$' + kind + '$' + name
+
+
+def metadce(filename):
+  """Removes the unreachable parts of the asm.js module in filename and of the JS around it. Returns the name
+  of the new file."""
+  with shared.ToolchainProfiler.profile_block('asm_metadce'):
+    temp_files = shared.configuration.get_temp_files()
+    asm = AsmModule(filename)
+    temp = temp_files.get('.js').name
+    shared.Building.js_optimizer(filename, ['asm', 'dumpCallGraph'], output_filename=temp, just_concat=True)
+    can_call = {}
+    for line in AsmModule(temp).funcs_js.split('\n'):
+      if line.startswith('// REACHABLE '):
+        curr = json.loads(line[len('// REACHABLE '):])
+        can_call[curr[0]] = curr[2]
+    shared.try_delete(temp)
+
+    shell = temp_files.get('.js').name
+    with open(shell, 'w') as f:
+      f.write(asm.pre_js + 'var asm = %s(global, env, buffer)\n' % ASM_PLACEHOLDER + asm.post_js[len(js_optimizer.end_asm_marker):])
+    graph = json.loads(shared.Building.js_optimizer_no_asmjs(shell, ['emitDCEGraph', 'noEmitAst'], return_output=True))
+
+    # the JS side
+    reaches = {}
+    roots = set()
+    for item in graph:
+      reaches[item['name']] = set(item['reaches'])
+      if item.get('root') or ('export' in item and (item['export'] in shared.Building.user_requested_exports or shared.Settings.EXPORT_ALL)):
+        roots.add(item['name'])
+
+    # the asm.js side. the functions in the tables are roots, and so are the imports that are not functions
+    function_imports = {}
+    for m in FUNCTION_IMPORT_PATTERN.finditer(asm.imports_js):
+      function_imports[m.group(1)] = (m.group(0), m.group(2) or m.group(3))
+    for name, value in asm.imports.items():
+      m = IMPORT_PATTERN.search(value)
+      if m and name not in function_imports:
+        roots.add(graph_name('import', m.group(1) or m.group(2)))
+    for table in asm.tables.values():
+      for func in table[table.find('[') + 1:table.rfind(']')].split(','):
+        roots.add(graph_name('asm', func.strip()))
+    exports = []
+    for export in asm.exports_js[asm.exports_js.find('{') + 1:asm.exports_js.find('}')].split(','):
+      if not export.strip(): continue
+      m = EXPORT_PATTERN.match(export)
+      if not m:
+        logging.debug('asm.js meta-DCE cannot handle the export %s, skipping' % export)
+        return filename
+      exports.append((m.group(1), export))
+      reaches.setdefault(graph_name('export', m.group(1)), set()).add(graph_name('asm', m.group(2)))
+      if m.group(1) in shared.Building.user_requested_exports or shared.Settings.EXPORT_ALL:
+        roots.add(graph_name('export', m.group(1)))
+    for func in asm.funcs:
+      targets = reaches.setdefault(graph_name('asm', func), set())
+      for target in can_call.get(func, []):
+        if target in function_imports:
+          targets.add(graph_name('import', function_imports[target][1]))
+        elif target in asm.funcs:
+          targets.add(graph_name('asm', target))
+
+    reached = set(roots)
+    pending = list(roots)
+    while pending:
+      for target in reaches.get(pending.pop(), ()):
+        if target not in reached:
+          reached.add(target)
+          pending.append(target)
+
+    unused_funcs = set([func for func in asm.funcs if graph_name('asm', func) not in reached])
+    unused_imports = set([name for name, (statement, imported) in function_imports.items() if graph_name('import', imported) not in reached])
+    unused = [item['name'] for item in graph if item['name'] not in reached and ('import' in item or 'export' in item)]
+    logging.debug('asm.js meta-DCE removes %d of %d functions, %d of %d imported functions, and %d imports and exports in JS' %
+                  (len(unused_funcs), len(asm.funcs), len(unused_imports), len(function_imports), len(unused)))
+    if not unused_funcs and not unused_imports and not unused:
+      shared.try_delete(shell)
+      return filename
+
+    # remove them from the asm.js module
+    for name in unused_imports:
+      asm.imports_js = asm.imports_js.replace(function_imports[name][0], '')
+    funcs = js_optimizer.split_funcs(asm.funcs_js[len(js_optimizer.start_funcs_marker):])
+    asm.funcs_js = js_optimizer.start_funcs_marker + ''.join([func for name, func in funcs if name not in unused_funcs])
+    kept = [export.strip() for key, export in exports if graph_name('export', key) in reached]
+    asm.exports_js = 'return { ' + ', '.join(kept) + ' };\n' + asm.exports_js[asm.exports_js.find('}') + 1:].lstrip(' ;\n')
+
+    # and from the JS, along with what only they used
+    js = open(shared.Building.js_optimizer_no_asmjs(shell, ['noPrintMetadata', 'applyDCEGraphRemovals', 'AJSDCE'], extra_info=json.dumps({'unused': unused}))).read()
+    start = js.find(ASM_PLACEHOLDER + '(')
+    assert start > 0, 'cannot find the asm.js module after meta-DCE'
+    end = js.find(')', start)
+    suffix = SUFFIX_PATTERN.search(asm.pre_js + asm.post_js)
+    asm.pre_js = js[:js.rfind('var ', 0, start)] + (suffix.group(0) if suffix else '')
+    asm.post_js = js_optimizer.end_asm_marker + js[end + 1:]
+    shared.try_delete(shell)
+
+    output = filename + '.metadce.js'
+    temp_files.note(output)
+    asm.write(output)
+  return output
@@ -0,0 +1,223 @@
+'''
+Finds functions that the asyncify transformation would instrument, but that can never be on the stack when an async
+function is called.
+
+The asyncify pass in the backend treats every function that calls through a function pointer as async, and so every
+function that calls one of those, which adds up to most of the program in code that uses function pointers. Here the
+program's LLVM IR is read, and an indirect call is assumed to reach only functions whose address is taken and whose
+signature, as it appears in the function tables, matches the call. Functions that cannot reach an async function
+that way can be added to ASYNCIFY_WHITELIST.
+
+The analysis errs on the side of reaching: every mention of a function in another function counts as a call to it,
+every mention that is not a direct call counts as taking its address, and types it does not understand match
+anything.
+'''
+
+import re
+
+NAME = r'@(?:"((?:[^"\\]|\\.)*)"|([-\w$.]+))'
+NAME_RE = re.compile(NAME)
+DIRECT_CALLEE_RE = re.compile(NAME + r'\(')
+CALL_RE = re.compile(r'(?:^|[\s=])(?:call|invoke)\s')
+CALLEE_RE = re.compile(r'(%[-\w$.]+|' + NAME + r')\(')
+RETURN_ATTRIBUTES_RE = re.compile(r'\b(?:fastcc|coldcc|ccc|cc\s*\d+|zeroext|signext|inreg|noalias|nonnull|fast|nnan|ninf|nsz|arcp|(?:dereferenceable|dereferenceable_or_null|align)\s*\(?\s*\d+\s*\)?)\s+')
+
+ANY = '*'
+
+def split_top_level(text):
+  '''Splits on the commas that are not nested in brackets.'''
+  parts = []
+  depth = 0
+  start = 0
+  for i, c in enumerate(text):
+    if c in '([{<':
+      depth += 1
+    elif c in ')]}>':
+      depth -= 1
+    elif c == ',' and depth == 0:
+      parts.append(text[start:i])
+      start = i + 1
+  parts.append(text[start:])
+  return [part.strip() for part in parts if part.strip()]
+
+def matching_paren(text, start):
+  depth = 0
+  for i in range(start, len(text)):
+    if text[i] == '(':
+      depth += 1
+    elif text[i] == ')':
+      depth -= 1
+      if depth == 0:
+        return i
+  return len(text)
+
+def read_type(text):
+  '''Reads the type at the start of text. Returns the classes of the values it takes in the function tables (pointers
+  and integers up to 32 bits are 'i', i64 is split into two 'i's, floating point is 'd', void is nothing), or ANY if it
+  is not understood, and whether it is a function type, with the function's return and parameter types.'''
+  text = text.strip()
+  m = re.match(r'(void|float|double|i\d+|%[-\w$.]+|%"[^"]*"|[{<\[])', text)
+  if not m:
+    return ANY, None
+  base = m.group(1)
+  if base in '{<[':
+    end = text.find({'{': '}', '<': '>', '[': ']'}[base])
+    if end < 0:
+      return ANY, None
+    rest = text[end + 1:]
+    base = ANY
+  else:
+    rest = text[len(base):]
+  function = None
+  while True:
+    rest = rest.lstrip()
+    if rest.startswith('*'):
+      return 'i', None
+    if rest.startswith('(') and function is None:
+      end = matching_paren(rest, 0)
+      function = (base, rest[1:end])
+      rest = rest[end + 1:]
+      continue
+    break
+  if function:
+    return None, function
+  if base == 'void':
+    return '', None
+  if base in ('float', 'double'):
+    return 'd', None
+  m = re.match(r'i(\d+)$', base)
+  if m:
+    bits = int(m.group(1))
+    if bits <= 32: return 'i', None
+    if bits == 64: return 'ii', None
+  return ANY, None
+
+def value_class(text):
+  cls, function = read_type(text)
+  return ANY if cls is None else cls
+
+def signature(ret, params):
+  '''A signature is the class of the return value, the classes of the parameters, and whether it is varargs.'''
+  varargs = False
+  classes = []
+  for param in split_top_level(params):
+    if param == '...':
+      varargs = True
+    else:
+      classes.append(value_class(param))
+  ret = value_class(ret)
+  if ret == 'ii': ret = 'i' # the high bits of an i64 are returned in tempRet0
+  return (ret, ''.join(classes), varargs)
+
+def signatures_match(a, b):
+  if ANY in a[0] or ANY in b[0]:
+    return True
+  if a[0] != b[0]:
+    return False
+  if a[2] or b[2]:
+    return True # varargs are passed in a buffer, so the table can be any with the same fixed parameters, or more
+  return ANY in a[1] or ANY in b[1] or a[1] == b[1]
+
+def get_name(match):
+  return match.group(1) if match.group(1) is not None else match.group(2)
+
+def call_signature(line, callee_match):
+  '''The signature of the call whose callee is at callee_match.'''
+  before = line[CALL_RE.search(line).end():callee_match.start()]
+  before = RETURN_ATTRIBUTES_RE.sub('', before + ' ').strip()
+  args = line[callee_match.end() - 1:]
+  args = args[1:matching_paren(args, 0)]
+  cls, function = read_type(before)
+  if function:
+    # an explicit function type, which varargs calls have
+    return signature(function[0], function[1])
+  return signature(before, ', '.join(split_top_level(args)))
+
+def analyze(ll, async_funcs, whitelist, exported=[], match_signatures=True):
+  '''Returns the functions that the asyncify pass would instrument, but that can never be on the stack when one of
+  async_funcs is called.'''
+  signatures = {} # function => its signature
+  calls = {} # function => functions it mentions
+  indirect_calls = {} # function => signatures of its indirect calls
+  address_taken = set([name[1:] for name in exported if name.startswith('_')])
+  quoted = set()
+
+  current = None
+  for line in ll.split('\n'):
+    if not line.strip() or line.lstrip().startswith(';'):
+      continue
+    if line.startswith('define ') or line.startswith('declare '):
+      m = DIRECT_CALLEE_RE.search(line)
+      name = get_name(m)
+      if m.group(1) is not None:
+        quoted.add(name)
+      params = line[m.end() - 1:]
+      params = params[1:matching_paren(params, 0)]
+      ret = RETURN_ATTRIBUTES_RE.sub('', line[:m.start()] + ' ')
+      ret = ret.split()
+      signatures[name] = signature(ret[-1] if ret else 'void', params)
+      calls.setdefault(name, set())
+      indirect_calls.setdefault(name, [])
+      if line.startswith('define '):
+        current = name
+      continue
+    if current and line.startswith('}'):
+      current = None
+      continue
+    direct = set()
+    if current and CALL_RE.search(line):
+      callee = CALLEE_RE.search(line, CALL_RE.search(line).end())
+      if callee and callee.group(1).startswith('%'):
+        indirect_calls[current].append(call_signature(line, callee))
+      elif callee:
+        direct.add(callee.start())
+    m = re.match(r'\s*' + NAME + r'\s*=\s*(?:\w+\s+)*alias\b', line)
+    if m:
+      # an alias calls what it aliases
+      alias = get_name(m)
+      calls.setdefault(alias, set()).update([get_name(t) for t in NAME_RE.finditer(line, m.end())])
+      signatures.setdefault(alias, (ANY, '', True))
+      indirect_calls.setdefault(alias, [])
+    for mention in NAME_RE.finditer(line):
+      name = get_name(mention)
+      if current:
+        calls[current].add(name)
+      if mention.start() not in direct and not (m and mention.start() == m.start()):
+        address_taken.add(name)
+
+  funcs = set(signatures.keys())
+  address_taken &= funcs
+  async_funcs = set(async_funcs) & funcs
+  whitelist = set(whitelist)
+
+  def callers_of(edges):
+    callers = {}
+    for func, targets in edges.items():
+      for target in targets:
+        callers.setdefault(target, set()).add(func)
+    return callers
+
+  def reaching(initial, callers):
+    reached = set([func for func in initial if func not in whitelist])
+    to_check = list(reached)
+    while to_check:
+      for caller in callers.get(to_check.pop(), []):
+        if caller not in reached and caller not in whitelist:
+          reached.add(caller)
+          to_check.append(caller)
+    return reached
+
+  # what the pass does: any indirect call may be async
+  instrumented = reaching(async_funcs | set([func for func in funcs if indirect_calls[func]]), callers_of(calls))
+
+  # and what can actually happen
+  precise = dict([(func, set(targets)) for func, targets in calls.items()])
+  targets_by_signature = {}
+  for func in funcs:
+    for sig in indirect_calls[func]:
+      if sig not in targets_by_signature:
+        targets_by_signature[sig] = [target for target in address_taken if not match_signatures or signatures_match(sig, signatures[target])]
+      precise[func].update(targets_by_signature[sig])
+  needed = reaching(async_funcs, callers_of(precise))
+
+  return sorted([func for func in instrumented - needed - async_funcs if func not in quoted and ',' not in func])
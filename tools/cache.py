@@ -1,6 +1,6 @@
 from __future__ import print_function
 from .toolchain_profiler import ToolchainProfiler
-import os.path, sys, shutil, time, logging
+import os.path, sys, shutil, time, logging, hashlib, json, threading
 from . import tempfiles, filelock
 
 # Permanent cache for dlmalloc and stdlibc++
@@ -39,31 +39,36 @@ class Cache(object):
     self.dirname = dirname
     self.debug = debug
     self.acquired_count = 0
+    # system libraries are built in parallel on threads, which all use the one
+    # interprocess lock
+    self.thread_lock = threading.Lock()
 
   def acquire_cache_lock(self):
-    if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
-      logging.debug('Cache: PID %s acquiring multiprocess file lock to Emscripten cache at %s' % (str(os.getpid()), self.dirname))
-      try:
-        self.filelock.acquire(60)
-      except filelock.Timeout:
-        # The multiprocess cache locking can be disabled altogether by setting EM_EXCLUSIVE_CACHE_ACCESS=1 environment
-        # variable before building. (in that case, use "embuilder.py build ALL" to prepopulate the cache)
-        logging.warning('Accessing the Emscripten cache at "' + self.dirname + '" is taking a long time, another process should be writing to it. If there are none and you suspect this process has deadlocked, try deleting the lock file "' + self.filelock_name + '" and try again. If this occurs deterministically, consider filing a bug.')
-        self.filelock.acquire()
-
-      self.prev_EM_EXCLUSIVE_CACHE_ACCESS = os.environ.get('EM_EXCLUSIVE_CACHE_ACCESS')
-      os.environ['EM_EXCLUSIVE_CACHE_ACCESS'] = '1'
-      logging.debug('Cache: done')
-    self.acquired_count += 1
+    with self.thread_lock:
+      if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
+        logging.debug('Cache: PID %s acquiring multiprocess file lock to Emscripten cache at %s' % (str(os.getpid()), self.dirname))
+        try:
+          self.filelock.acquire(60)
+        except filelock.Timeout:
+          # The multiprocess cache locking can be disabled altogether by setting EM_EXCLUSIVE_CACHE_ACCESS=1 environment
+          # variable before building. (in that case, use "embuilder.py build ALL" to prepopulate the cache)
+          logging.warning('Accessing the Emscripten cache at "' + self.dirname + '" is taking a long time, another process should be writing to it. If there are none and you suspect this process has deadlocked, try deleting the lock file "' + self.filelock_name + '" and try again. If this occurs deterministically, consider filing a bug.')
+          self.filelock.acquire()
+
+        self.prev_EM_EXCLUSIVE_CACHE_ACCESS = os.environ.get('EM_EXCLUSIVE_CACHE_ACCESS')
+        os.environ['EM_EXCLUSIVE_CACHE_ACCESS'] = '1'
+        logging.debug('Cache: done')
+      self.acquired_count += 1
 
   def release_cache_lock(self):
-    self.acquired_count -= 1
-    assert self.acquired_count >= 0, "Called release more times than acquire"
-    if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
-      if self.prev_EM_EXCLUSIVE_CACHE_ACCESS: os.environ['EM_EXCLUSIVE_CACHE_ACCESS'] = self.prev_EM_EXCLUSIVE_CACHE_ACCESS
-      else: del os.environ['EM_EXCLUSIVE_CACHE_ACCESS']
-      self.filelock.release()
-      logging.debug('Cache: PID %s released multiprocess file lock to Emscripten cache at %s' % (str(os.getpid()), self.dirname))
+    with self.thread_lock:
+      self.acquired_count -= 1
+      assert self.acquired_count >= 0, "Called release more times than acquire"
+      if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
+        if self.prev_EM_EXCLUSIVE_CACHE_ACCESS: os.environ['EM_EXCLUSIVE_CACHE_ACCESS'] = self.prev_EM_EXCLUSIVE_CACHE_ACCESS
+        else: del os.environ['EM_EXCLUSIVE_CACHE_ACCESS']
+        self.filelock.release()
+        logging.debug('Cache: PID %s released multiprocess file lock to Emscripten cache at %s' % (str(os.getpid()), self.dirname))
 
   def ensure(self):
     self.acquire_cache_lock()
@@ -110,6 +115,122 @@ class Cache(object):
 
     return cachename
 
+# Content-addressed cache of optimized functions, so that relinking after a small
+# change only needs to optimize the functions that changed. Keys hash the source
+# of a function together with a salt that describes everything else its output
+# depends on (the passes, the extra info, and the optimizer itself).
+class FunctionCache(object):
+  def __init__(self, dirname, salt):
+    self.dirname = dirname
+    self.salt = hashlib.sha1(shared.asbytes(salt)).hexdigest()
+
+  def get_path(self, text):
+    key = hashlib.sha1(shared.asbytes(self.salt + text)).hexdigest()
+    return os.path.join(self.dirname, key[:2], key[2:])
+
+  # Returns the optimized form of a function, or None if we do not have it
+  def get(self, text):
+    try:
+      with open(self.get_path(text)) as f:
+        return f.read()
+    except IOError:
+      return None
+
+  def put(self, text, optimized):
+    path = self.get_path(text)
+    if os.path.exists(path): return
+    shared.safe_ensure_dirs(os.path.dirname(path))
+    # write to a temp file and move it into place, so that concurrent builds never see partial entries
+    temp = path + '.' + str(os.getpid())
+    with open(temp, 'w') as f:
+      f.write(optimized)
+    try:
+      os.rename(temp, path)
+    except OSError:
+      tempfiles.try_delete(temp) # another process added it first (on Windows, rename does not replace)
+
+# Symbol tables of the members of archives, so that linking against an archive
+# that did not change does not need to run llvm-nm on each of its members again.
+# Entries are keyed by the path, size and modification time of the archive,
+# together with a salt that describes the tools that read the symbols.
+class ArchiveIndex(object):
+  def __init__(self, dirname, salt):
+    self.dirname = dirname
+    self.salt = hashlib.sha1(shared.asbytes(salt)).hexdigest()
+
+  def get_path(self, archive):
+    stat = os.stat(archive)
+    key = hashlib.sha1(shared.asbytes(self.salt + json.dumps([os.path.abspath(archive), stat.st_size, repr(stat.st_mtime)]))).hexdigest()
+    return os.path.join(self.dirname, key[:2], key[2:] + '.json')
+
+  # Returns a dict of member name => [defs, undefs, commons], or None if we do not have the archive
+  def get(self, archive):
+    try:
+      with open(self.get_path(archive)) as f:
+        return json.load(f)
+    except (IOError, OSError, ValueError):
+      return None
+
+  def put(self, archive, index):
+    path = self.get_path(archive)
+    shared.safe_ensure_dirs(os.path.dirname(path))
+    # write to a temp file and move it into place, so that concurrent builds never see partial entries
+    temp = path + '.' + str(os.getpid())
+    with open(temp, 'w') as f:
+      json.dump(index, f)
+    try:
+      os.rename(temp, path)
+    except OSError:
+      tempfiles.try_delete(temp)
+
+# Content-addressed cache of compiled objects, shared by every build that uses
+# the same directory, including builds on other machines. Keys hash the
+# preprocessed source together with the compiler flags and versions, so one
+# entry serves the same translation unit in any project or target. Builds that
+# need the same object at the same time wait for one of them to compile it.
+class ObjectCache(object):
+  # How long to wait for another build that compiles the same object, before
+  # compiling it ourselves. Lock files of builds that died do not block us
+  # forever, in particular on network filesystems.
+  LOCK_TIMEOUT = 5 * 60
+
+  def __init__(self, dirname):
+    self.dirname = dirname
+
+  def get_path(self, key):
+    return os.path.join(self.dirname, key[:2], key[2:])
+
+  # Writes the object for key to output. If it is not cached, compile() is run
+  # to write it there, and it is added to the cache. Returns whether it was
+  # cached.
+  def get(self, key, output, compile):
+    path = self.get_path(key)
+    shared.safe_ensure_dirs(os.path.dirname(path))
+    lock = filelock.FileLock(path + '.lock')
+    try:
+      lock.acquire(self.LOCK_TIMEOUT)
+    except filelock.Timeout:
+      logging.warning('object cache: timed out waiting for ' + path + '.lock, compiling without the cache')
+      compile()
+      return False
+    try:
+      if os.path.exists(path):
+        shutil.copyfile(path, output)
+        return True
+      compile()
+      if not os.path.exists(output): return False # the compiler failed, and has reported it
+      # copy to a temp file and move it into place, so that a build that dies while copying does not leave a
+      # partial entry behind
+      temp = path + '.' + str(os.getpid())
+      shutil.copyfile(output, temp)
+      try:
+        os.rename(temp, path)
+      except OSError:
+        tempfiles.try_delete(temp)
+      return False
+    finally:
+      lock.release()
+
 # Given a set of functions of form (ident, text), and a preferred chunk size,
 # generates a set of chunks for parallel processing and caching.
 def chunkify(funcs, chunk_size, DEBUG=False):
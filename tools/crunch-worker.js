@@ -53,7 +53,9 @@
         dst.set(src.subarray(0, numBytes), dstByteOffset);
     }
 
-    function deCrunch(bytes, filename) {
+    // The result starts with |prefix| (if given), so that a caller that
+    // needs a header in front of the data does not have to copy it again.
+    function deCrunch(bytes, filename, prefix) {
         var srcSize = bytes.length;
         var src = Module._malloc(srcSize),
             format, internalFormat, dst, dstSize,
@@ -85,8 +87,10 @@
         width = Module._crn_get_width(src, srcSize);
         height = Module._crn_get_height(src, srcSize);
 
-        var ret = new Uint8Array(totalSize);
-        var retIndex = 0;
+        var prefixSize = prefix ? prefix.length : 0;
+        var ret = new Uint8Array(prefixSize + totalSize);
+        if (prefix) ret.set(prefix);
+        var retIndex = prefixSize;
 
         for(i = 0; i < levels; ++i) {
             if(i) {
@@ -113,12 +117,13 @@ function a(b){throw b}var aa=void 0,l=!0,pa=null,n=!1,za=[],Da="object"===typeof
 
 onmessage = function(msg) {
   var start = Date.now();
-  var data = deCrunch(new Uint8Array(msg.data.data), msg.data.filename);
+  var data = deCrunch(new Uint8Array(msg.data.data), msg.data.filename, msg.data.prefix);
+  // transfer the result, it is not used here any more
   postMessage({
     filename: msg.data.filename,
     data: data,
     callbackID: msg.data.callbackID,
     time: Date.now() - start
-  });
+  }, [data.buffer]);
 };
 
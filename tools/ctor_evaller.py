@@ -4,7 +4,7 @@ Tries to evaluate global constructors, applying their effects ahead of time.
 This is an LTO-like operation, and to avoid parsing the entire tree (we might fail to parse a massive project, we operate on the text in python.
 '''
 
-import os, sys, json, subprocess, time
+import os, sys, json, subprocess, time, re, multiprocessing
 
 sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
@@ -18,6 +18,9 @@ total_stack = int(sys.argv[4])
 global_base = int(sys.argv[5])
 binaryen_bin = sys.argv[6]
 debug_info = int(sys.argv[7])
+keep_going = int(sys.argv[8]) >= 2 # continue past ctors that cannot be evalled
+pure_imports = json.loads(sys.argv[9])
+max_allocation = int(sys.argv[10])
 
 wasm = not not binaryen_bin
 
@@ -49,12 +52,41 @@ def find_ctors_data(js, num):
   ctors = all_ctors[:num]
   return ctors_start, ctors_end, all_ctors, ctors
 
-def eval_ctors_js(js, mem_init, num):
-
-  def kill_func(asm, name):
-    before = len(asm)
-    asm = asm.replace('function ' + name + '(', 'function KILLED_' + name + '(', 1)
-    return asm
+# Each process that evals ctors on their own gets at least this many of them, fewer are not worth starting a shell for.
+MIN_CTORS_PER_PROCESS = 4
+
+def get_pure_imports(js, names):
+  '''Finds the JS library functions of the imports that ctors may call while they are evalled.'''
+  sources = {}
+  for name in names:
+    m = re.search(r'\bfunction ' + re.escape(name) + r'\(', js)
+    if not m:
+      continue
+    i = js.find('{', m.end())
+    depth = 0
+    quote = None
+    while i < len(js):
+      c = js[i]
+      if quote:
+        if c == '\\':
+          i += 1
+        elif c == quote:
+          quote = None
+      elif c in '\'"':
+        quote = c
+      elif c == '{':
+        depth += 1
+      elif c == '}':
+        depth -= 1
+        if depth == 0:
+          sources[name] = js[m.start():i + 1]
+          break
+      i += 1
+  return sources
+
+def make_sandbox(js, mem_init, pure_imports, max_allocation):
+  '''Returns a script that instantiates the asm module with only safe imports, and evals the ctors its params file
+  (the first argument) lists, and the size of the static memory that the ctors may write to.'''
 
   def add_func(asm, func):
     before = len(asm)
@@ -64,16 +96,14 @@ def eval_ctors_js(js, mem_init, num):
     asm = asm.replace('return {', 'return { ' + name + ': ' + name + ',')
     return asm
 
-  # Find the global ctors
-  ctors_start, ctors_end, all_ctors, ctors = find_ctors_data(js, num)
-  shared.logging.debug('trying to eval ctors: ' + ', '.join(ctors))
   # Find the asm module, and receive the mem init.
   asm = get_asm(js)
   assert len(asm) > 0
   asm = asm.replace('use asm', 'not asm') # don't try to validate this
-  # Substitute sbrk with a failing stub: the dynamic heap memory area shouldn't get increased during static ctor initialization.
-  asm = asm.replace('function _sbrk(', 'function _sbrk(increment) { throw "no sbrk when evalling ctors!"; } function KILLED_sbrk(', 1)
-  # find all global vars, and provide only safe ones. Also add dumping for those.
+  # Substitute sbrk with one that allocates from a bounded area after the static data: the dynamic heap memory area
+  # shouldn't get increased during static ctor initialization.
+  asm = asm.replace('function _sbrk(', 'function _sbrk(increment) { return evalSbrk(increment|0)|0; } function KILLED_sbrk(', 1)
+  # find all global vars, and provide only safe ones. Also add dumping and restoring for those.
   pre_funcs_start = asm.find(';') + 1
   pre_funcs_end = asm.find('function ', pre_funcs_start)
   pre_funcs_end = asm.rfind(';', pre_funcs_start, pre_funcs_end) + 1
@@ -93,30 +123,29 @@ def eval_ctors_js(js, mem_init, num):
         'HEAPF32', 'HEAPF64',
         'Int8View', 'Int16View', 'Int32View', 'Uint8View', 'Uint16View', 'Uint32View', 'Float32View', 'Float64View',
         'nan', 'inf',
-        '_emscripten_memcpy_big', '___dso_handle',
+        '_emscripten_memcpy_big', '_emscripten_memset_big', '___dso_handle',
         '_atexit', '___cxa_atexit',
-      ] or name.startswith('Math_'):
+      ] + pure_imports or name.startswith('Math_'):
         if 'new ' not in value:
           global_vars.append(name)
         new_globals += ' var ' + name + ' = ' + value + ';\n'
   asm = asm[:pre_funcs_start] + new_globals + asm[pre_funcs_end:]
   asm = add_func(asm, 'function dumpGlobals() { return [ ' + ', '.join(global_vars) + '] }')
+  asm = add_func(asm, 'function restoreGlobals(g) { ' + ' '.join(['%s = g[%d];' % (name, i) for i, name in enumerate(global_vars)]) + ' }')
   # find static bump. this is the maximum area we'll write to during startup.
   static_bump_op = 'STATICTOP = STATIC_BASE + '
   static_bump_start = js.find(static_bump_op)
   static_bump_end = js.find(';', static_bump_start)
   static_bump = int(js[static_bump_start + len(static_bump_op):static_bump_end])
-  # Generate a safe sandboxed environment. We replace all ffis with errors. Otherwise,
+  # Generate a safe sandboxed environment. We replace all ffis with errors, except for the pure ones. Otherwise,
   # asm.js can't call outside, so we are ok.
-#  if shared.DEBUG:
-#    temp_file = os.path.join(shared.CANONICAL_TEMP_DIR, 'ctorEval.js')
-#    shared.safe_ensure_dirs(shared.CANONICAL_TEMP_DIR)
-#  else:
-#    temp_file = config.get_temp_files().get('.ctorEval.js').name
-  with config.get_temp_files().get_file('.ctorEval.js') as temp_file:
-    open(temp_file, 'w').write('''
+  return '''
+var params = JSON.parse(require('fs').readFileSync(process.argv[2], 'utf8'));
+var tracking = params.tracking;
+
 var totalMemory = %d;
 var totalStack = %d;
+var maxAllocation = %d;
 
 var buffer = new ArrayBuffer(totalMemory);
 var heap = new Uint8Array(buffer);
@@ -128,13 +157,19 @@ var globalBase = %d;
 var staticBump = %d;
 
 heap.set(memInit, globalBase);
+params.writes.forEach(function(write) {
+  heapi32[write[0]] = write[1];
+});
 
 var staticTop = globalBase + staticBump;
-var staticBase = staticTop;
 
-var stackTop = staticTop;
-while (stackTop %% 16 !== 0) stackTop--;
-var stackBase = stackTop;
+// What ctors malloc comes from right after the static data, and becomes part of it.
+var allocBase = (staticTop + 15) & -16;
+var allocMax = allocBase + maxAllocation;
+var brk = params.brk || allocBase;
+
+var stackBase = (allocMax + 15) & -16;
+var stackTop = stackBase;
 var stackMax = stackTop + totalStack;
 if (stackMax >= totalMemory) throw 'not enough room for stack';
 
@@ -157,31 +192,91 @@ if (!Math.fround) {
   Math.fround = function(x) { froundBuffer[0] = x; return froundBuffer[0] };
 }
 
+// When tracking, the words of memory outside of the stack that the current ctor reads and writes. 'brk' stands for the
+// break of evalSbrk.
+var reads = {};
+var writes = {};
+
+function track(words, start, end) {
+  for (var word = start >> 2; word < (end + 3) >> 2; word++) {
+    if (word < stackBase >> 2 || word >= stackMax >> 2) words[word] = 1;
+  }
+}
+
+function trackedView(View) {
+  if (!tracking) return View;
+  var size = View.BYTES_PER_ELEMENT;
+  return function(buffer) {
+    return new Proxy(new View(buffer), {
+      get: function(view, key) {
+        if (typeof key === 'string' && key.charCodeAt(0) <= 57) track(reads, key * size, key * size + size);
+        return view[key];
+      },
+      set: function(view, key, value) {
+        if (typeof key === 'string' && key.charCodeAt(0) <= 57) track(writes, key * size, key * size + size);
+        view[key] = value;
+        return true;
+      }
+    });
+  };
+}
+
+// Running out of memory fails the ctor, rather than having malloc return 0, which the ctor might handle by doing
+// something else than it does at runtime.
+function evalSbrk(increment) {
+  if (tracking) reads.brk = writes.brk = 1;
+  var old = brk;
+  if (increment < 0 || brk + increment > allocMax) throw 'ctors can only allocate ' + maxAllocation + ' bytes when evalled';
+  brk += increment;
+  return old;
+}
+
 var atexits = []; // we record and replay atexits
 
 var globalArg = {
-  Int8Array: Int8Array,
-  Int16Array: Int16Array,
-  Int32Array: Int32Array,
-  Uint8Array: Uint8Array,
-  Uint16Array: Uint16Array,
-  Uint32Array: Uint32Array,
-  Float32Array: Float32Array,
-  Float64Array: Float64Array,
+  Int8Array: trackedView(Int8Array),
+  Int16Array: trackedView(Int16Array),
+  Int32Array: trackedView(Int32Array),
+  Uint8Array: trackedView(Uint8Array),
+  Uint16Array: trackedView(Uint16Array),
+  Uint32Array: trackedView(Uint32Array),
+  Float32Array: trackedView(Float32Array),
+  Float64Array: trackedView(Float64Array),
   NaN: NaN,
   Infinity: Infinity,
   Math: Math,
 };
 
+// for the pure imports
+var HEAP8 = new globalArg.Int8Array(buffer);
+var HEAP16 = new globalArg.Int16Array(buffer);
+var HEAP32 = new globalArg.Int32Array(buffer);
+var HEAPU8 = new globalArg.Uint8Array(buffer);
+var HEAPU16 = new globalArg.Uint16Array(buffer);
+var HEAPU32 = new globalArg.Uint32Array(buffer);
+var HEAPF32 = new globalArg.Float32Array(buffer);
+var HEAPF64 = new globalArg.Float64Array(buffer);
+
 var libraryArg = {
   STACKTOP: stackTop,
   STACK_MAX: stackMax,
   DYNAMICTOP_PTR: dynamicTopPtr,
   ___dso_handle: 0, // used by atexit, value doesn't matter
   _emscripten_memcpy_big: function(dest, src, num) {
+    if (tracking) {
+      track(reads, src, src + num);
+      track(writes, dest, dest + num);
+    }
     heap.set(heap.subarray(src, src+num), dest);
     return dest;
   },
+  _emscripten_memset_big: function(ptr, value, num) {
+    if (tracking) {
+      track(writes, ptr, ptr + num);
+    }
+    heap.fill(value, ptr, ptr+num);
+    return ptr;
+  },
   _atexit: function(x) {
     atexits.push([x, 0]);
     return 0;
@@ -192,96 +287,250 @@ var libraryArg = {
   },
 };
 
+var pureImports = %s;
+for (var name in pureImports) {
+  try {
+    libraryArg[name] = eval('(' + pureImports[name] + ')');
+  } catch (e) {
+    console.warn('cannot use ' + name + ' when evalling ctors: ' + e);
+  }
+}
+
 // Instantiate asm
 %s
 (globalArg, libraryArg, buffer);
 
-// Try to run the constructors
+function save() {
+  return {
+    memory: heap.slice(globalBase, stackBase),
+    brk: brk,
+    atexits: atexits.length,
+    globals: asm['dumpGlobals']()
+  };
+}
 
-var allCtors = %s;
-var numSuccessful = 0;
+function restore(saved) {
+  heap.set(saved.memory, globalBase);
+  brk = saved.brk;
+  atexits.length = saved.atexits;
+  asm['restoreGlobals'](saved.globals);
+}
 
-for (var i = 0; i < allCtors.length; i++) {
+// Runs a ctor, and returns why it cannot be evalled, if it cannot.
+function evalCtor(name, saved) {
+  reads = {};
+  writes = {};
   try {
-    var globalsBefore = asm['dumpGlobals']();
-
-    asm[allCtors[i]]();
+    asm[name]();
+  } catch (e) {
+    return e.stack || e;
+  }
+  if (JSON.stringify(saved.globals) !== JSON.stringify(asm['dumpGlobals']())) return 'globals modified';
+  if (heapi32[dynamicTopPtr >> 2] !== stackMax) return 'dynamic allocation was performed';
+  for (var word in writes) {
+    if (word !== 'brk' && (word < globalBase >> 2 || word >= stackBase >> 2)) return 'wrote outside of static memory';
+  }
+  return null;
+}
 
-    var globalsAfter = asm['dumpGlobals']();
-    if (JSON.stringify(globalsBefore) !== JSON.stringify(globalsAfter)) {
-      console.warn('globals modified');
-      break;
+if (params.isolated) {
+  // Run each ctor on its own, from the same state, and report what it did
+  var results = params.ctors.map(function(name) {
+    var saved = save();
+    var error = evalCtor(name, saved);
+    var written = Object.keys(writes);
+    var result = {
+      error: error,
+      reads: Object.keys(reads),
+      writes: written,
+      values: written.filter(function(word) { return word !== 'brk' }).map(function(word) { return [+word, heapi32[word]] }),
+      brk: brk,
+      atexits: atexits.slice(saved.atexits)
+    };
+    restore(saved);
+    return result;
+  });
+  console.log(JSON.stringify(results));
+} else {
+  // Run the ctors one after the other. One that fails is undone, and with keepGoing, the ones after it can still be
+  // evalled if they do not touch what it touched before it failed, or what was touched by a ctor that failed earlier.
+  var failedReads = {};
+  var failedWrites = {};
+  params.failedReads.forEach(function(word) { failedReads[word] = 1 });
+  params.failedWrites.forEach(function(word) { failedWrites[word] = 1 });
+  var evalled = [];
+  for (var i = 0; i < params.ctors.length; i++) {
+    var saved = save();
+    var error = evalCtor(params.ctors[i], saved);
+    if (!error && tracking) {
+      for (var word in reads) {
+        if (failedWrites[word]) error = 'depends on a ctor that was not evalled';
+      }
+      for (var word in writes) {
+        if (failedReads[word] || failedWrites[word]) error = 'depends on a ctor that was not evalled';
+      }
     }
-    if (heapi32[dynamicTopPtr >> 2] !== stackMax) {
-      console.warn('dynamic allocation was performend');
-      break;
+    if (!error) {
+      // this one was ok.
+      evalled.push(params.ctors[i]);
+      continue;
     }
-
-    // this one was ok.
-    numSuccessful = i + 1;
-
-  } catch (e) {
-    console.warn(e.stack);
-    break;
+    console.warn(params.ctors[i] + ': ' + error);
+    restore(saved);
+    if (!params.keepGoing) break;
+    for (var word in reads) failedReads[word] = 1;
+    for (var word in writes) failedWrites[word] = 1;
   }
-}
 
-// Write out new mem init. It might be bigger if we added to the zero section, look for zeros
-var newSize = globalBase + staticBump;
-while (newSize > globalBase && heap[newSize-1] == 0) newSize--;
-console.log(JSON.stringify([numSuccessful, Array.prototype.slice.call(heap.subarray(globalBase, newSize)), atexits]));
+  // Write out new mem init. It might be bigger if we added to the zero section, or allocated, look for zeros
+  var newStaticTop = brk > allocBase ? (brk + 15) & -16 : staticTop;
+  var newSize = newStaticTop;
+  while (newSize > globalBase && heap[newSize-1] == 0) newSize--;
+  console.log(JSON.stringify([evalled, Array.prototype.slice.call(heap.subarray(globalBase, newSize)), newStaticTop - globalBase, atexits]));
+}
+''' % (total_memory, total_stack, max_allocation, mem_init, global_base, static_bump, json.dumps(get_pure_imports(js, pure_imports)), asm), static_bump
 
-''' % (total_memory, total_stack, mem_init, global_base, static_bump, asm, json.dumps(ctors)))
+def run_sandboxes(sandbox_file, all_params):
+  '''Runs the sandbox once for each params, all at the same time, and returns their outputs, with None for those that
+  failed or timed out.'''
 
-    def read_and_delete(filename):
-      result = ''
-      try:
-        result = open(filename, 'r').read()
-      finally:
-        try_delete(filename)
-      return result
+  def read_and_delete(filename):
+    result = ''
+    try:
+      result = open(filename, 'r').read()
+    finally:
+      try_delete(filename)
+    return result
 
-    # Execute the sandboxed code. If an error happened due to calling an ffi, that's fine,
-    # us exiting with an error tells the caller that we failed. If it times out, give up.
+  runs = []
+  for params in all_params:
+    params_file = config.get_temp_files().get('.json').name
+    open(params_file, 'w').write(json.dumps(params))
     out_file = config.get_temp_files().get('.out').name
     err_file = config.get_temp_files().get('.err').name
     out_file_handle = open(out_file, 'w')
     err_file_handle = open(err_file, 'w')
-    proc = subprocess.Popen(shared.NODE_JS + [temp_file], stdout=out_file_handle, stderr=err_file_handle, universal_newlines=True)
+    proc = subprocess.Popen(shared.NODE_JS + [sandbox_file, params_file], stdout=out_file_handle, stderr=err_file_handle, universal_newlines=True)
+    runs.append((proc, params_file, out_file, err_file, out_file_handle, err_file_handle))
+
+  # Execute the sandboxed code. If an error happened due to calling an ffi, that's fine,
+  # us exiting with an error tells the caller that we failed. If it times out, give up.
+  deadline = time.time() + 10
+  results = []
+  for proc, params_file, out_file, err_file, out_file_handle, err_file_handle in runs:
     try:
-      shared.jsrun.timeout_run(proc, timeout=10, full_output=True, throw_on_failure=False)
+      shared.jsrun.timeout_run(proc, timeout=max(deadline - time.time(), 0.1), full_output=True, throw_on_failure=False)
     except Exception as e:
       if 'Timed out' not in str(e): raise e
       shared.logging.debug('ctors timed out\n')
-      return (0, 0, 0, 0)
+      results.append(None)
+      continue
     finally:
       time.sleep(0.5) # On Windows, there is some kind of race condition with Popen output stream related functions, where file handles are still in use a short period after the process has finished.
       out_file_handle.close()
       err_file_handle.close()
+      try_delete(params_file)
       out_result = read_and_delete(out_file)
       err_result = read_and_delete(err_file)
     if proc.returncode != 0:
       shared.logging.debug('unexpected error while trying to eval ctors:\n' + out_result + '\n' + err_result)
-      return (0, 0, 0, 0)
+      results.append(None)
+      continue
+    if err_result:
+      shared.logging.debug('not all ctors could be evalled, something was used that was not safe (and therefore was not defined, and caused an error):\n========\n' + err_result + '========')
+    results.append(json.loads(out_result))
+  return results
+
+def combine_isolated(ctors, results, keep_going, state):
+  '''Combines the effects of ctors that were evalled each on its own, in order, for as long as none could have seen the
+  effects of the ones before it, which makes them the same as if they had run one after the other. Returns the index
+  of the first ctor that has to be evalled after the ones before it.'''
+  evalled_reads = set()
+  evalled_writes = set()
+  for i in range(len(ctors)):
+    result = results[i]
+    reads = set(result['reads'])
+    writes = set(result['writes'])
+    if reads & evalled_writes or writes & (evalled_reads | evalled_writes):
+      return i
+    if result['error'] is None and not reads & state['failed_writes'] and not writes & (state['failed_reads'] | state['failed_writes']):
+      state['evalled'].append(ctors[i])
+      evalled_reads |= reads
+      evalled_writes |= writes
+      for word, value in result['values']:
+        state['writes'][word] = value
+      if 'brk' in writes:
+        state['brk'] = result['brk']
+      state['atexits'] += result['atexits']
+      continue
+    shared.logging.debug('ctor_evaller: %s cannot be evalled on its own: %s' % (ctors[i], result['error'] or 'depends on a ctor that was not evalled'))
+    if not keep_going:
+      return None
+    state['failed_reads'] |= reads
+    state['failed_writes'] |= writes
+  return len(ctors)
+
+def eval_ctors_js(js, mem_init, keep_going, pure_imports, max_allocation):
+  # Find the global ctors
+  ctors_start, ctors_end, all_ctors, ctors = find_ctors_data(js, None)
+  shared.logging.debug('trying to eval ctors: ' + ', '.join(all_ctors))
+  sandbox, static_bump = make_sandbox(js, mem_init, pure_imports, max_allocation)
+  state = {
+    'evalled': [],
+    'writes': {},
+    'brk': 0,
+    'atexits': [],
+    'failed_reads': set(),
+    'failed_writes': set(),
+  }
+  with config.get_temp_files().get_file('.ctorEval.js') as temp_file:
+    open(temp_file, 'w').write(sandbox)
+    # First eval the ctors each on its own, in parallel. As far as they turn out to be independent, that is all that
+    # is needed, and the rest are evalled one after the other.
+    first_dependent = 0
+    cores = int(os.environ.get('EMCC_CORES') or multiprocessing.cpu_count())
+    num_processes = min(cores, len(all_ctors) // MIN_CTORS_PER_PROCESS)
+    if num_processes > 1:
+      per_process = (len(all_ctors) + num_processes - 1) // num_processes
+      chunks = [all_ctors[i:i + per_process] for i in range(0, len(all_ctors), per_process)]
+      results = run_sandboxes(temp_file, [{ 'isolated': 1, 'tracking': 1, 'ctors': chunk, 'writes': [], 'brk': 0 } for chunk in chunks])
+      if None not in results:
+        first_dependent = combine_isolated(all_ctors, sum(results, []), keep_going, state)
+        shared.logging.debug('ctor_evaller: evalled %d independent ctors in parallel' % len(state['evalled']))
+    remaining = all_ctors[first_dependent:] if first_dependent is not None else []
+    result = run_sandboxes(temp_file, [{
+      'tracking': keep_going,
+      'keepGoing': keep_going,
+      'ctors': remaining,
+      'writes': [[word, value] for word, value in sorted(state['writes'].items())],
+      'brk': state['brk'],
+      'failedReads': list(state['failed_reads']),
+      'failedWrites': list(state['failed_writes']),
+    }])[0]
+    if result is None:
+      return [], js, None
 
   # out contains the new mem init and other info
-  num_successful, mem_init_raw, atexits = json.loads(out_result)
+  evalled, mem_init_raw, new_static_bump, atexits = result
+  evalled = state['evalled'] + evalled
+  atexits = state['atexits'] + atexits
   mem_init = bytes(bytearray(mem_init_raw))
-  total_ctors = len(all_ctors)
-  if num_successful < total_ctors:
-    shared.logging.debug('not all ctors could be evalled, something was used that was not safe (and therefore was not defined, and caused an error):\n========\n' + err_result + '========')
   # Remove the evalled ctors, add a new one for atexits if needed, and write that out
-  if len(ctors) == total_ctors and len(atexits) == 0:
+  if len(evalled) == len(all_ctors) and len(atexits) == 0:
     new_ctors = ''
   else:
     elements = []
     if len(atexits) > 0:
       elements.append('{ func: function() { %s } }' % '; '.join(['_atexit(' + str(x[0]) + ',' + str(x[1]) + ')' for x in atexits]))
-    for ctor in all_ctors[num:]:
-      elements.append('{ func: function() { %s() } }' % ctor)
+    for ctor in all_ctors:
+      if ctor not in evalled:
+        elements.append('{ func: function() { %s() } }' % ctor)
     new_ctors = '__ATINIT__.push(' + ', '.join(elements) + ');'
   js = js[:ctors_start] + new_ctors + js[ctors_end:]
-  return (num_successful, js, mem_init, ctors)
+  # what the ctors allocated is now static data
+  static_bump_op = 'STATICTOP = STATIC_BASE + '
+  js = js.replace(static_bump_op + str(static_bump) + ';', static_bump_op + str(new_static_bump) + ';', 1)
+  return evalled, js, mem_init
 
 def eval_ctors_wasm(js, wasm_file, num):
   ctors_start, ctors_end, all_ctors, ctors = find_ctors_data(js, num)
@@ -326,22 +575,13 @@ if __name__ == '__main__':
     else:
       mem_init = []
 
-    # find how many ctors we can remove, by bisection (if there are hundreds, running them sequentially is silly slow)
-
     shared.logging.debug('ctor_evaller: trying to eval %d global constructors' % num_ctors)
-    num_successful, new_js, new_mem_init, removed = eval_ctors_js(js, mem_init, num_ctors)
-    if num_successful == 0:
+    removed, js, mem_init = eval_ctors_js(js, mem_init, keep_going, pure_imports, max_allocation)
+    if len(removed) == 0:
       shared.logging.debug('ctor_evaller: not successful')
       sys.exit(0)
 
-    shared.logging.debug('ctor_evaller: we managed to remove %d ctors' % num_successful)
-    if num_successful == num_ctors:
-      js = new_js
-      mem_init = new_mem_init
-    else:
-      shared.logging.debug('ctor_evaller: final execution')
-      check, js, mem_init, removed = eval_ctors_js(js, mem_init, num_successful)
-      assert check == num_successful
+    shared.logging.debug('ctor_evaller: we managed to remove %d ctors' % len(removed))
     open(js_file, 'w').write(js)
     open(mem_init_file, 'wb').write(mem_init)
 
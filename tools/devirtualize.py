@@ -0,0 +1,38 @@
+
+"""Whole-program analysis of which indirect calls can be turned into direct calls.
+
+Calls through a function pointer, including virtual calls, are FUNCTION_TABLE_sig[index & mask](..) in asm.js,
+which engines cannot inline. There is a table for each signature, which is fixed at link time, and most of its
+entries are the b* functions that abort on a bad function pointer. Often only one or a few functions in it can
+actually be called, and then every call through it must reach one of them, so it can check the index against
+theirs and call them directly (see devirtualize in tools/optimizer/optimizer.cpp).
+"""
+
+from __future__ import print_function
+import logging, re
+
+from . import shared
+from .asm_module import AsmModule
+
+# the functions emscripten.py fills the empty entries of tables with, which abort
+NULL_FUNC_PATTERN = re.compile(r'^b\d+$')
+
+
+def find_devirtualizable_tables(filename, max_targets):
+  """Returns, for each function table in the asm.js module in filename through which at most max_targets
+  functions can be called, a list of those functions, each followed by the indexes it is at."""
+  with shared.ToolchainProfiler.profile_block('find_devirtualizable_tables'):
+    asm = AsmModule(filename)
+    funcs = set(asm.funcs)
+    ret = {}
+    for name, table in asm.tables.items():
+      targets = {}
+      for i, func in enumerate([x.strip() for x in table[1:-1].split(',')]):
+        if NULL_FUNC_PATTERN.match(func): continue
+        targets.setdefault(func, []).append(i)
+      # imports can be in the table, with wasm, and those we cannot call directly without changing coercions
+      if not targets or len(targets) > max_targets or not funcs.issuperset(targets): continue
+      ret[name] = [[func] + indexes for func, indexes in sorted(targets.items(), key=lambda t: t[1][0])]
+
+  logging.debug('devirtualizing calls through %d of %d function tables: %s', len(ret), len(asm.tables), ', '.join(sorted(ret.keys())))
+  return ret
@@ -1,7 +1,42 @@
 #!/usr/bin/env python2
 # -*- Mode: python -*-
 
-import logging, sys, json
+'''
+Merges the symbol map into the CyberDWARF data that emscripten.py wrote, and
+packs it into the indexed format that src/library_debugger_toolkit.js reads.
+
+The types and functions are most of the data, and a debugger session only looks
+at a few of them, so each is stored as a separate record, which the toolkit
+reads and parses when it is first used. The format is
+
+  'CDWF', then the version and the size of the index, as little-endian uint32s
+  the index, in JSON: the small maps (type_name_map, function_name_map and
+    vtable_offsets), and for each type and function, the offset of its record
+    after the index, and its size
+  the records, each a type or function in JSON
+'''
+
+import logging, sys, json, struct
+
+MAGIC = b'CDWF'
+VERSION = 1
+
+def pack(cd_data):
+    index = {}
+    records = []
+    offset = 0
+    for key, value in sorted(cd_data.items()):
+        if key not in ('types', 'functions'):
+            index[key] = value
+            continue
+        index[key] = {}
+        for name, entry in sorted(value.items()):
+            record = json.dumps(entry, separators=(',',':')).encode('utf-8')
+            index[key][name] = [offset, len(record)]
+            records.append(record)
+            offset += len(record)
+    index = json.dumps(index, separators=(',',':'), sort_keys=True).encode('utf-8')
+    return MAGIC + struct.pack('<II', VERSION, len(index)) + index + b''.join(records)
 
 def run():
     args = sys.argv[1:]
@@ -19,8 +54,8 @@ def run():
 
     cd_data['cyberdwarf']['function_name_map'] = symbol_list
 
-    with open(args[0],"w") as cd_f:
-        json.dump(cd_data, cd_f, separators=(',',':'))
+    with open(args[0],"wb") as cd_f:
+        cd_f.write(pack(cd_data['cyberdwarf']))
 
 
 if __name__ == '__main__':
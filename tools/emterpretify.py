@@ -30,9 +30,12 @@ FROUND = False
 ADVISE = False
 MEMORY_SAFE = False
 OUTPUT_FILE = None
+SUPERINSTRUCTIONS = 0
+PROFILE = False
+SEGMENT_SIZE = 0
 
 def handle_arg(arg):
-  global ZERO, ASYNC, ASSERTIONS, PROFILING, FROUND, ADVISE, MEMORY_SAFE, OUTPUT_FILE
+  global ZERO, ASYNC, ASSERTIONS, PROFILING, FROUND, ADVISE, MEMORY_SAFE, OUTPUT_FILE, SUPERINSTRUCTIONS, PROFILE, SEGMENT_SIZE
   if '=' in arg:
     l, r = arg.split('=', 1)
     if l == 'ZERO': ZERO = int(r)
@@ -43,6 +46,9 @@ def handle_arg(arg):
     elif l == 'ADVISE': ADVISE = int(r)
     elif l == 'MEMORY_SAFE': MEMORY_SAFE = int(r)
     elif l == 'FILE': OUTPUT_FILE = r[1:-1]
+    elif l == 'SUPERINSTRUCTIONS': SUPERINSTRUCTIONS = int(r)
+    elif l == 'PROFILE': PROFILE = int(r)
+    elif l == 'SEGMENT_SIZE': SEGMENT_SIZE = int(r)
     return False
   return True
 
@@ -64,7 +70,7 @@ sys.argv = list(filter(handle_arg, sys.argv))
 BLACKLIST = set(['_malloc', '_free', '_memcpy', '_memmove', '_memset', '_strlen', 'stackAlloc', 'setThrew', 'stackRestore', 'setTempRet0', 'getTempRet0', 'stackSave', '_emscripten_autodebug_double', '_emscripten_autodebug_float', '_emscripten_autodebug_i8', '_emscripten_autodebug_i16', '_emscripten_autodebug_i32', '_emscripten_autodebug_i64', '_strncpy', '_strcpy', '_strcat', '_saveSetjmp', '_testSetjmp', '_emscripten_replace_memory', '_bitshift64Shl', '_bitshift64Ashr', '_bitshift64Lshr', 'setAsyncState', 'emtStackSave', 'emtStackRestore', 'getEmtStackMax', 'setEmtStackMax'])
 WHITELIST = []
 
-SYNC_FUNCS = set(['_emscripten_sleep', '_emscripten_sleep_with_yield', '_emscripten_wget_data', '_emscripten_idb_load', '_emscripten_idb_store', '_emscripten_idb_delete'])
+SYNC_FUNCS = set(['_emscripten_sleep', '_emscripten_sleep_with_yield', '_emscripten_wget_data', '_emscripten_idb_load', '_emscripten_idb_store', '_emscripten_idb_delete', '_emscripten_fiber_swap'])
 
 OPCODES = [ # l, lx, ly etc - one of 256 locals
   'SET',     # [lx, ly, 0]          lx = ly (int or float, not double)
@@ -467,7 +473,12 @@ def handle_async_post_call():
   assert not ZERO
   return 'if ((asyncState|0) == 1) { ' + pop_stacktop(zero=False) + ' return }\n' if ASYNC else '' # save pc and exit immediately if currently saving state
 
+def ensure_loaded(func_pc):
+  # with a lazily loaded bytecode file, a function's bytecode is zeros until its segment is loaded
+  return ('if ((HEAPU8[%s >> 0] | 0) != %d) emtLoad(%s - eb | 0);' % (func_pc, ROPCODES['FUNC'], func_pc)) if SEGMENT_SIZE else ''
+
 CASES[ROPCODES['INTCALL']] = '''
+    %s
     lz = HEAPU8[(HEAP32[pc + 4 >> 2] | 0) + 1 | 0] | 0; // FUNC inst, see definition above; we read params here
     ly = 0;
     assert(((EMTSTACKTOP + 8|0) <= (EMT_STACK_MAX|0))|0); // for return value
@@ -487,6 +498,7 @@ CASES[ROPCODES['INTCALL']] = '''
     %s = HEAP32[EMTSTACKTOP + 4 >> 2] | 0;
     pc = pc + (((4 + lz + 3) >> 2) << 2) | 0;
 ''' % (
+  ensure_loaded('(HEAP32[pc + 4 >> 2] | 0)'),
   'if ((HEAPU8[(HEAP32[pc + 4 >> 2] | 0) + 4 | 0] | 0) == 0) {' if ZERO else '',
   'if ((asyncState|0) != 2) {' if ASYNC else '',
   get_access('ly', base='EMTSTACKTOP', offset=8 if ASYNC else 0),  get_coerced_access('HEAPU8[pc + 8 + ly >> 0]'),
@@ -527,6 +539,77 @@ opcode_used = {}
 for opcode in OPCODES:
   opcode_used[opcode] = False
 
+# superinstructions: a superinstruction runs a pair of instructions that are often executed one after the other with
+# a single dispatch. The pair keeps its layout, the superinstruction just replaces the opcode of the first, so the
+# second is still a normal instruction that branches can target, and no offsets change. The first must be a simple
+# one-word instruction that falls through to the next; the second can be anything except calls, returns and
+# switches, whose cases are generated per emterpreter or need more than the decoded instruction.
+
+SUPER_FIRST_EXCLUDED = set(['SETVIB', 'SETVDI', 'SETVDF', 'SETVDD', 'GETGLBI', 'GETGLBD', 'SETGLBI', 'SETGLBD'])
+SUPER_SECOND_EXCLUDED = set(['INTCALL', 'EXTCALL', 'RET', 'SWITCH', 'FUNC', 'GETGLBI', 'GETGLBD', 'SETGLBI', 'SETGLBD'])
+# relative and absolute branches, used to find loops
+RELATIVE_BRANCHES = set(['BR', 'BRT', 'BRF'])
+ABSOLUTE_BRANCHES = set(['BRA', 'BRTA', 'BRFA', 'LNOTBRF', 'EQBRF', 'NEBRF', 'SLTBRF', 'ULTBRF', 'SLEBRF', 'ULEBRF',
+                         'LNOTBRT', 'EQBRT', 'NEBRT', 'SLTBRT', 'ULTBRT', 'SLEBRT', 'ULEBRT'])
+
+SUPERS = [] # (superinstruction, first, second)
+
+def can_fuse_first(opcode):
+  if opcode in SUPER_FIRST_EXCLUDED or ROPCODES[opcode] not in CASES: return False
+  case = CASES[ROPCODES[opcode]]
+  return 'pc' not in case and 'PROCEED' not in case
+
+def can_fuse_second(opcode):
+  return opcode not in SUPER_SECOND_EXCLUDED and ROPCODES[opcode] in CASES
+
+def add_superinstructions(code):
+  # estimate how often each pair of instructions runs. lacking a runtime profile, weigh each pair by how many loops
+  # it is in, where a loop is code that a backwards branch jumps back over
+  words = len(code)//4
+  depth = [0]*(words + 1)
+  for i in range(words):
+    opcode = code[i*4]
+    target = None
+    if opcode in RELATIVE_BRANCHES:
+      offset = code[i*4+2] | (code[i*4+3] << 8)
+      if offset >= 32768: offset -= 65536
+      target = i + offset
+    elif opcode in ABSOLUTE_BRANCHES and i + 1 < words:
+      target = (code[i*4+4] | (code[i*4+5] << 8) | (code[i*4+6] << 16) | (code[i*4+7] << 24))//4
+    if target is not None and 0 <= target < i:
+      depth[target] += 1
+      depth[i + 1] -= 1
+  counts = {}
+  curr = 0
+  for i in range(words - 1):
+    curr += depth[i]
+    first = code[i*4]
+    second = code[i*4+4]
+    if type(first) not in (type(u''), bytes) or type(second) not in (type(u''), bytes): continue
+    if first not in ROPCODES or second not in ROPCODES: continue
+    if not can_fuse_first(first) or not can_fuse_second(second): continue
+    pair = (first, second)
+    counts[pair] = counts.get(pair, 0) + 8**min(curr, 3)
+
+  available = 255 - len(OPCODES)
+  pairs = sorted(counts.keys(), key=lambda pair: (-counts[pair], pair))[:min(SUPERINSTRUCTIONS, available)]
+  fused = {}
+  for first, second in pairs:
+    name = first + '_' + second
+    OPCODES.append(name)
+    ROPCODES[name] = len(OPCODES) - 1
+    opcode_used[name] = False
+    SUPERS.append((name, first, second))
+    fused[(first, second)] = name
+  if DEBUG: print('emterpreter superinstructions:', [(name, counts[(first, second)]) for name, first, second in SUPERS], file=sys.stderr)
+
+  # the second of a pair is left alone, so it may also start a pair of its own
+  for i in range(words - 1):
+    first = code[i*4]
+    second = code[i*4+4]
+    if (first, second) in fused:
+      code[i*4] = fused[(first, second)]
+
 def make_emterpreter(zero=False):
   # return is specialized per interpreter
   CASES[ROPCODES['RET']] = pop_stacktop(zero)
@@ -618,6 +701,10 @@ def make_emterpreter(zero=False):
     make_setglb('I', 'i')
     make_setglb('D', 'd')
 
+  for name, first, second in SUPERS:
+    # run the first, then decode and run the second, which is where pc points to when it branches or falls through
+    CASES[ROPCODES[name]] = CASES[ROPCODES[first]] + ' pc = pc + 4 | 0; inst = HEAP32[pc >> 2] | 0; lx = (inst >> 8) & 255; ly = (inst >> 16) & 255; lz = inst >>> 24; ' + CASES[ROPCODES[second]]
+
   def fix_case(case):
     # we increment pc at the top of the loop. to avoid a pc bump, we decrement it first; this is rare, most opcodes just continue; this avoids any code at the end of the loop
     return case.replace('PROCEED_WITH_PC_BUMP', 'continue').replace('PROCEED_WITHOUT_PC_BUMP', 'pc = pc - 4 | 0; continue').replace('continue; continue;', 'continue;')
@@ -689,11 +776,13 @@ function emterpret%s(pc) {
   'sp = 0, ' if not zero else '',
   '' if not ASYNC and not MEMORY_SAFE else 'var ld = +0;',
   '' if not ASYNC else 'HEAP32[EMTSTACKTOP>>2] = pc;\n',
-  push_stacktop(zero),
+  push_stacktop(zero) + ((' ' + ensure_loaded('pc')) if SEGMENT_SIZE else ''),
   ROPCODES['FUNC'],
   (''' EMTSTACKTOP = EMTSTACKTOP + (lx ''' + (' + 1 ' if ASYNC else '') + '''<< 3) | 0;
  assert(((EMTSTACKTOP|0) <= (EMT_STACK_MAX|0))|0);\n''' + (' if ((asyncState|0) != 2) {' if ASYNC else '')) if not zero else '',
-  ' } else { pc = (HEAP32[sp - 4 >> 2] | 0) - 8 | 0; }' if ASYNC else '',
+  # when profiling, count calls into each function in a table parallel to the bytecode, at ep
+  (' HEAP32[pc - eb + ep >> 2] = (HEAP32[pc - eb + ep >> 2] | 0) + 1 | 0;' if PROFILE and not zero else '') +
+  (' } else { pc = (HEAP32[sp - 4 >> 2] | 0) - 8 | 0; }' if ASYNC else ''),
   main_loop,
 ))
 
@@ -779,7 +868,7 @@ if __name__ == '__main__':
   # find emterpreted functions reachable by non-emterpreted ones, we will force a trampoline for them later
 
   with temp_files.get_file('.js') as temp: # infile + '.tmp.js'
-    shared.Building.js_optimizer(infile, ['findReachable'], extra_info={ 'blacklist': list(emterpreted_funcs) }, output_filename=temp, just_concat=True)
+    shared.Building.js_optimizer(infile, ['asm', 'findReachable'], extra_info={ 'blacklist': list(emterpreted_funcs) }, output_filename=temp, just_concat=True)
     asm = asm_module.AsmModule(temp)
   lines = asm.funcs_js.split('\n')
 
@@ -923,6 +1012,9 @@ if __name__ == '__main__':
 
   assert global_var_id < 256, [global_vars, global_var_id]
 
+  if SUPERINSTRUCTIONS:
+    add_superinstructions(all_code)
+
   def post_process_code(code):
     for i in range(len(code)//4):
       j = i*4
@@ -986,7 +1078,38 @@ assert(eb %% 8 === 0);
 __ATPRERUN__.push(function() {
 ''' % len(all_code)]
 
-  if OUTPUT_FILE:
+  if OUTPUT_FILE and SEGMENT_SIZE:
+    # split the file into segments of whole functions, each followed by its relocations, so that a segment can be
+    # fetched with one range request and copied into place when one of its functions is first called
+    bounds = [0]
+    for start in sorted(funcs.values()):
+      if start - bounds[-1] >= SEGMENT_SIZE:
+        bounds.append(start)
+    bounds.append(len(all_code))
+    relocations.sort()
+    segments = [] # [code start, file offset, number of relocations] for each segment, then the code size
+    file_offset = 0
+    r = 0
+    with open(OUTPUT_FILE, 'wb') as bytecode_file:
+      for i in range(len(bounds) - 1):
+        start = bounds[i]
+        end = bounds[i + 1]
+        bytecode_file.write(bytearray(all_code[start:end]))
+        first = r
+        while r < len(relocations) and relocations[r] < end:
+          bytecode_file.write(bytearray(bytify(relocations[r])))
+          r += 1
+        segments += [start, file_offset, r - first]
+        file_offset += end - start + 4 * (r - first)
+    segments.append(len(all_code))
+    assert r == len(relocations)
+
+    # nothing to load or relocate at startup
+    js += ['''
+  var relocations = [];
+''']
+
+  elif OUTPUT_FILE:
     bytecode_file = open(OUTPUT_FILE, 'wb')
     n = len(all_code)
     while n % 4 != 0:
@@ -1054,6 +1177,134 @@ __ATPRERUN__.push(function() {
 });
 ''' % len(all_code)]
 
+  if OUTPUT_FILE and SEGMENT_SIZE:
+    js += ['''
+var emterpreterSegments = %s;
+var emterpreterFD = null;
+
+// Returns an ArrayBuffer with the given range of the bytecode file, and the offset in the file where it starts, which
+// is 0 if it has the whole file.
+function emtFetch(fileOffset, size) {
+  var url = typeof Module['locateFile'] === 'function' ? Module['locateFile']('%s') : '%s';
+  if (!Module['emterpreterFile'] && ENVIRONMENT_IS_SHELL) {
+    Module['emterpreterFile'] = read(url, 'binary').buffer;
+  }
+  if (Module['emterpreterFile']) {
+    return [Module['emterpreterFile'], 0];
+  }
+  if (ENVIRONMENT_IS_NODE) {
+    var fs = require('fs');
+    if (!emterpreterFD) emterpreterFD = fs.openSync(url, 'r');
+    var data = new Uint8Array(size);
+    fs.readSync(emterpreterFD, Buffer.from(data.buffer), 0, size, fileOffset);
+    return [data.buffer, fileOffset];
+  }
+  // the function is being called, so we can only wait for it. workers can get binary data synchronously, while the
+  // main thread has to get it as text
+  var xhr = new XMLHttpRequest();
+  xhr.open('GET', url, false);
+  xhr.setRequestHeader('Range', 'bytes=' + fileOffset + '-' + (fileOffset + size - 1));
+  if (ENVIRONMENT_IS_WORKER) {
+    xhr.responseType = 'arraybuffer';
+  } else {
+    xhr.overrideMimeType('text/plain; charset=x-user-defined');
+  }
+  xhr.send(null);
+  if (xhr.status !== 200 && xhr.status !== 206 && xhr.status !== 0) {
+    throw 'failed to load emterpreter file ' + url + ': ' + xhr.status;
+  }
+  var data;
+  if (ENVIRONMENT_IS_WORKER) {
+    data = new Uint8Array(xhr.response);
+  } else {
+    var text = xhr.responseText;
+    data = new Uint8Array(text.length);
+    for (var i = 0; i < text.length; i++) {
+      data[i] = text.charCodeAt(i) & 0xff;
+    }
+  }
+  if (xhr.status !== 206) {
+    // the server ignored the range and sent the whole file, keep it for the other segments
+    Module['emterpreterFile'] = data.buffer;
+    return [data.buffer, 0];
+  }
+  return [data.buffer, fileOffset];
+}
+
+// Loads the segment of bytecode containing the function at the given offset, the first time it is called.
+function emtLoad(offset) {
+  var segments = emterpreterSegments;
+  var low = 0, high = (segments.length - 1) / 3 - 1;
+  while (low < high) {
+    var mid = (low + high + 1) >> 1;
+    if (segments[mid * 3] <= offset) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  var start = segments[low * 3], fileOffset = segments[low * 3 + 1], numRelocations = segments[low * 3 + 2];
+  var codeSize = segments[low * 3 + 3] - start;
+  var fetched = emtFetch(fileOffset, codeSize + 4 * numRelocations);
+  var position = fileOffset - fetched[1];
+  HEAPU8.set(new Uint8Array(fetched[0], position, codeSize), eb + start);
+  var relocations = new Uint32Array(fetched[0], position + codeSize, numRelocations);
+  for (var i = 0; i < numRelocations; i++) {
+    assert(relocations[i] >= start && relocations[i] < start + codeSize);
+    HEAPU32[eb + relocations[i] >> 2] = HEAPU32[eb + relocations[i] >> 2] + eb;
+  }
+  assert(HEAPU8[eb + offset] === %d);
+}
+''' % (json.dumps(segments), os.path.basename(OUTPUT_FILE), os.path.basename(OUTPUT_FILE), ROPCODES['FUNC'])]
+
+  if PROFILE:
+    # see which functions are on the stack when pausing for async operations, which must be emterpreted, and how often
+    # each function is called, so the rest can run at full speed, starting with the ones called most
+    js += ['''
+var ep = getMemory(%d);
+var EmterpreterProfile = {
+  funcs: %s, // bytecode offset => function
+  paused: {}, // function => number of pauses it was on the stack for
+  notePause: function(stack) {
+    // each frame has [pc of function, curr pc] and then its locals, see push_stacktop()
+    var seen = {};
+    for (var i = 0; i < stack.length; i += (HEAPU16[stack[i] + 2 >> 1] + 1) << 1) {
+      var func = EmterpreterProfile.funcs[stack[i] - eb];
+      if (seen[func]) continue; // recursion
+      seen[func] = true;
+      EmterpreterProfile.paused[func] = (EmterpreterProfile.paused[func] || 0) + 1;
+    }
+  },
+  get: function() {
+    var calls = {}, whitelist = [], blacklist = [];
+    for (var offset in EmterpreterProfile.funcs) {
+      var func = EmterpreterProfile.funcs[offset];
+      calls[func] = HEAP32[ep + (offset | 0) >> 2];
+      if (EmterpreterProfile.paused[func]) {
+        whitelist.push(func);
+      } else if (calls[func]) {
+        blacklist.push(func);
+      }
+    }
+    whitelist.sort();
+    blacklist.sort(function(a, b) { return calls[b] - calls[a] });
+    return { 'whitelist': whitelist, 'blacklist': blacklist, 'calls': calls, 'paused': EmterpreterProfile.paused };
+  }
+};
+Module['getEmterpreterProfile'] = EmterpreterProfile.get;
+Module['printEmterpreterProfile'] = function() {
+  var profile = EmterpreterProfile.get();
+%s
+};
+''' % (len(all_code), json.dumps(dict([(offset, func) for func, offset in funcs.items()]), sort_keys=True), '''
+  Module.print('Functions that were on the stack when pausing, to run in the emterpreter:');
+  Module.print("  -s EMTERPRETIFY_WHITELIST='" + JSON.stringify(profile['whitelist']) + "'");
+  Module.print('Functions that were called but never on the stack when pausing, most called first, to run normally:');
+  Module.print("  -s EMTERPRETIFY_BLACKLIST='" + JSON.stringify(profile['blacklist']) + "'");''' if ASYNC else '''
+  // nothing pauses, so this is just the code that ran: the rest is cold, and can be emterpreted and loaded lazily
+  Module.print('Functions that were called, most called first, to run normally:');
+  Module.print("  -s EMTERPRETIFY_BLACKLIST='" + JSON.stringify(profile['blacklist']) + "'");''')]
+
   js = ''.join(js)
   if not ASSERTIONS:
     js = js.replace('assert(', '//assert(')
@@ -1063,6 +1314,12 @@ __ATPRERUN__.push(function() {
   # send EMT vars into asm
   asm.pre_js += "Module.asmLibraryArg['EMTSTACKTOP'] = EMTSTACKTOP; Module.asmLibraryArg['EMT_STACK_MAX'] = EMT_STACK_MAX; Module.asmLibraryArg['eb'] = eb;\n"
   extra_vars = 'var EMTSTACKTOP = env.EMTSTACKTOP|0;\nvar EMT_STACK_MAX = env.EMT_STACK_MAX|0;\nvar eb = env.eb|0;\n'
+  if PROFILE:
+    asm.pre_js += "Module.asmLibraryArg['ep'] = ep;\n"
+    extra_vars += 'var ep = env.ep|0;\n'
+  if OUTPUT_FILE and SEGMENT_SIZE:
+    asm.pre_js += "Module.asmLibraryArg['emtLoad'] = emtLoad;\n"
+    extra_vars += 'var emtLoad = env.emtLoad;\n'
   first_func = asm.imports_js.find('function ')
   if first_func < 0:
     asm.imports_js += extra_vars
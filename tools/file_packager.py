@@ -16,7 +16,7 @@ data downloads.
 
 Usage:
 
-  file_packager.py TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]] [--crunch[=X]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--no-heap-copy] [--separate-metadata] [--lz4] [--use-preload-plugins]
+  file_packager.py TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]] [--crunch[=X]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--no-heap-copy] [--separate-metadata] [--lz4] [--use-preload-plugins] [--asmfs]
 
   --preload  ,
   --embed    See emcc --help for more details on those options.
@@ -40,7 +40,9 @@ Usage:
 
   --no-force Don't create output if no valid input file is specified.
 
-  --use-preload-cache Stores package in IndexedDB so that subsequent loads don't need to do XHR. Checks package version.
+  --use-preload-cache Stores package in IndexedDB so that subsequent loads don't need to do XHR. Checks package version, which is a hash
+                      of the package contents, so rebuilding a package from unchanged files keeps it cached. The package is cached in
+                      chunks by their hashes, and when it changes only the chunks that changed are fetched, with range requests.
 
   --indexedDB-name Use specified IndexedDB database name (Default: 'EM_PRELOAD_CACHE')
 
@@ -56,6 +58,10 @@ Usage:
   --use-preload-plugins Tells the file packager to run preload plugins on the files as they are loaded. This performs tasks like decoding images
                         and audio using the browser's codecs.
 
+  --asmfs Generates the package for ASMFS (see ASMFS in src/settings.js). A manifest of the directories and files is appended to the
+          data file, and the whole package is imported with one call into ASMFS, whose files then point into the package data in the
+          HEAP. Only --preload is supported, and the package is always copied into the HEAP.
+
 Notes:
 
   * The file packager generates unix-style file paths. So if you are on windows and a file is accessed at
@@ -66,7 +72,7 @@ TODO:        You can also provide .crn files yourself, pre-crunched. With this o
 '''
 
 from __future__ import print_function
-import os, sys, shutil, random, uuid, ctypes
+import os, sys, shutil, random, uuid, ctypes, struct, hashlib, multiprocessing
 
 sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
@@ -81,6 +87,7 @@ from tools.jsrun import run_js
 from subprocess import Popen, PIPE, STDOUT
 import fnmatch
 import json
+from multiprocessing.pool import ThreadPool
 
 if len(sys.argv) == 1:
   print('''Usage: file_packager.py TARGET [--preload A...] [--embed B...] [--exclude C...] [--no-closure] [--crunch[=X]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--no-heap-copy] [--separate-metadata]
@@ -99,6 +106,9 @@ CRUNCH_OUTPUT_SUFFIX = '.crn'
 
 DDS_HEADER_SIZE = 128
 
+# The preload cache stores packages in chunks of at most this size, see --use-preload-cache
+PRELOAD_CACHE_CHUNK_SIZE = 1024*1024
+
 AV_WORKAROUND = 0 # Set to 1 to randomize file order and add some padding, to work around silly av false positives
 
 data_files = []
@@ -124,6 +134,7 @@ no_heap_copy = True
 separate_metadata  = False
 lz4 = False
 use_preload_plugins = False
+asmfs = False
 
 for arg in sys.argv[2:]:
   if arg == '--preload':
@@ -154,6 +165,9 @@ for arg in sys.argv[2:]:
   elif arg == '--use-preload-plugins':
     use_preload_plugins = True
     leading = ''
+  elif arg == '--asmfs':
+    asmfs = True
+    leading = ''
   elif arg.startswith('--js-output'):
     jsoutput = arg.split('=', 1)[1] if '=' in arg else None
     leading = ''
@@ -201,8 +215,19 @@ if (not force) and len(data_files) == 0:
 if not has_preloaded or jsoutput == None:
   assert not separate_metadata, 'cannot separate-metadata without both --preloaded files and a specified --js-output'
 
+if asmfs:
+  if [file_ for file_ in data_files if file_['mode'] == 'embed']:
+    print('Error: --embed is not supported with --asmfs, use --preload instead', file=sys.stderr)
+    sys.exit(1)
+  if crunch or lz4 or use_preload_plugins:
+    print('Error: --crunch, --lz4 and --use-preload-plugins are not supported with --asmfs', file=sys.stderr)
+    sys.exit(1)
+
 if not from_emcc:
-  print('Remember to build the main file with  -s FORCE_FILESYSTEM=1  so that it includes support for loading this file package', file=sys.stderr)
+  if asmfs:
+    print('Remember to build the main file with  -s ASMFS=1 -s EXPORTED_FUNCTIONS=[..., "_emscripten_asmfs_import_package"]  so that it can import this file package', file=sys.stderr)
+  else:
+    print('Remember to build the main file with  -s FORCE_FILESYSTEM=1  so that it includes support for loading this file package', file=sys.stderr)
 
 ret = ''
 # emcc.py will add this to the output itself, so it is only needed for standalone calls
@@ -338,19 +363,37 @@ metadata = {'files': []}
 if crunch:
   shutil.copyfile(shared.path_from_root('tools', 'crunch-worker.js'), 'crunch-worker.js')
   ret += '''
-    var decrunchWorker = new Worker('crunch-worker.js');
+    // A pool of decrunch workers, one per core, created as files arrive. Each
+    // file goes to the worker with the fewest pending, so they are decompressed
+    // in parallel. Buffers are transferred both ways rather than copied.
+    var decrunchWorkers = [];
+    var maxDecrunchWorkers = Math.max(1, (typeof navigator !== 'undefined' && navigator.hardwareConcurrency) || 4);
     var decrunchCallbacks = [];
-    decrunchWorker.onmessage = function(msg) {
+    function onDecrunched(msg) {
+      this.pending--;
       decrunchCallbacks[msg.data.callbackID](msg.data.data);
       console.log('decrunched ' + msg.data.filename + ' in ' + msg.data.time + ' ms, ' + msg.data.data.length + ' bytes');
       decrunchCallbacks[msg.data.callbackID] = null;
-    };
-    function requestDecrunch(filename, data, callback) {
-      decrunchWorker.postMessage({
+    }
+    function requestDecrunch(filename, data, callback, prefix) {
+      var worker = null;
+      for (var i = 0; i < decrunchWorkers.length; i++) {
+        if (!worker || decrunchWorkers[i].pending < worker.pending) worker = decrunchWorkers[i];
+      }
+      if (!worker || (worker.pending > 0 && decrunchWorkers.length < maxDecrunchWorkers)) {
+        worker = new Worker('crunch-worker.js');
+        worker.pending = 0;
+        worker.onmessage = onDecrunched;
+        decrunchWorkers.push(worker);
+      }
+      worker.pending++;
+      var copy = new Uint8Array(data); // data is a view into the whole package
+      worker.postMessage({
         filename: filename,
-        data: new Uint8Array(data),
+        data: copy,
+        prefix: prefix,
         callbackID: decrunchCallbacks.length
-      });
+      }, [copy.buffer]);
       decrunchCallbacks.push(callback);
     }
 '''
@@ -394,9 +437,9 @@ if crunch:
       c.write(crunched)
       c.close()
 
-# Set up folders
+# Set up folders (ASMFS creates them from the manifest instead)
 partial_dirs = []
-for file_ in data_files:
+for file_ in data_files if not asmfs else []:
   dirname = os.path.dirname(file_['dstpath'])
   dirname = dirname.lstrip('/') # absolute paths start with '/', remove that
   if dirname != '':
@@ -407,20 +450,63 @@ for file_ in data_files:
         code += '''Module['FS_createPath']('/%s', '%s', true, true);\n''' % ('/'.join(parts[:i]), parts[i])
         partial_dirs.append(partial)
 
+# Reads a file to bundle, and hashes its contents. Both release the GIL, so this runs in parallel on a pool of threads.
+def read_and_hash(file_):
+  curr = open(file_['srcpath'], 'rb').read()
+  return curr, hashlib.sha256(curr).digest()
+
 if has_preloaded:
   # Bundle all datafiles into one archive. Avoids doing lots of simultaneous XHRs which has overhead.
   data = open(data_target, 'wb')
   start = 0
-  for file_ in data_files:
-    file_['data_start'] = start
-    curr = open(file_['srcpath'], 'rb').read()
-    file_['data_end'] = start + len(curr)
-    if AV_WORKAROUND: curr += '\x00'
-    #print >> sys.stderr, 'bundling', file_['srcpath'], file_['dstpath'], file_['data_start'], file_['data_end']
-    start += len(curr)
-    data.write(curr)
+  # The package is identified by a hash of its layout and contents, so it stays cached by --use-preload-cache when the
+  # packager is rerun on the same files, and is downloaded again as soon as any of them changes.
+  package_hash = hashlib.sha256()
+  if lz4: package_hash.update(shared.asbytes('lz4 ' + shared.EMSCRIPTEN_VERSION))
+  cores = int(os.environ.get('EMCC_CORES') or multiprocessing.cpu_count())
+  pool = ThreadPool(cores)
+  # Files are read a batch at a time, to bound how much data is held in memory, and written out in order.
+  for i in range(0, len(data_files), cores):
+    batch = data_files[i:i+cores]
+    for file_, (curr, digest) in zip(batch, pool.map(read_and_hash, batch)):
+      file_['data_start'] = start
+      file_['data_end'] = start + len(curr)
+      package_hash.update(shared.asbytes(file_['dstpath']) + b'\0' + struct.pack('<2Q', file_['data_start'], file_['data_end']) + digest)
+      if AV_WORKAROUND: curr += '\x00'
+      #print >> sys.stderr, 'bundling', file_['srcpath'], file_['dstpath'], file_['data_start'], file_['data_end']
+      start += len(curr)
+      data.write(curr)
+  pool.close()
+  if asmfs:
+    # The manifest that emscripten_asmfs_import_package() in system/lib/fetch/asmfs.cpp reads, see the format there. Each
+    # directory is listed once, before the first file in it.
+    ASMFS_PACKAGE_ROOT = ASMFS_PACKAGE_DIRECTORY = 0xFFFFFFFF
+    entries = []
+    names = b''
+    dir_indices = {}
+    def add_asmfs_entry(parent, name, offset, size):
+      global names
+      name = shared.asbytes(name)
+      entries.append(struct.pack('<5I', parent, len(names), len(name), offset, size))
+      names += name
+      return len(entries) - 1
+    for file_ in data_files:
+      parts = file_['dstpath'].lstrip('/').split('/')
+      parent = ASMFS_PACKAGE_ROOT
+      for i in range(len(parts) - 1):
+        dirname = '/'.join(parts[:i+1])
+        if dirname not in dir_indices:
+          dir_indices[dirname] = add_asmfs_entry(parent, parts[i], 0, ASMFS_PACKAGE_DIRECTORY)
+        parent = dir_indices[dirname]
+      add_asmfs_entry(parent, parts[-1], file_['data_start'], file_['data_end'] - file_['data_start'])
+    padding = (4 - start % 4) % 4
+    data.write(b'\0' * padding)
+    metadata['manifest_start'] = start + padding
+    data.write(struct.pack('<2I', 0x31736661, len(entries))) # 'afs1'
+    data.write(b''.join(entries))
+    data.write(names)
+    package_hash.update(b''.join(entries) + names)
   data.close()
-  # TODO: sha256sum on data_target
   if start > 256*1024*1024:
     print('warning: file packager is creating an asset bundle of %d MB. this is very large, and browsers might have trouble loading it. see https://hacks.mozilla.org/2015/02/synchronous-execution-and-filesystem-access-in-emscripten/' % (start/(1024*1024)), file=sys.stderr)
 
@@ -441,7 +527,7 @@ if has_preloaded:
 '''
 
   # Data requests - for getting a block of data out of the big archive - have a similar API to XHRs
-  code += '''
+  if not asmfs: code += '''
     function DataRequest(start, end, crunched, audio) {
       this.start = start;
       this.end = end;
@@ -471,14 +557,12 @@ if has_preloaded:
 %s
   ''' % ('' if not crunch else '''
         if (this.crunched) {
-          var ddsHeader = byteArray.subarray(0, 128);
+          var ddsHeader = new Uint8Array(byteArray.subarray(0, 128)); // a copy, so posting it does not clone the whole package
           var that = this;
+          // the worker puts the header in front of the decompressed data
           requestDecrunch(this.name, byteArray.subarray(128), function(ddsData) {
-            byteArray = new Uint8Array(ddsHeader.length + ddsData.length);
-            byteArray.set(ddsHeader, 0);
-            byteArray.set(ddsData, 128);
-            that.finish(byteArray);
-          });
+            that.finish(ddsData);
+          }, ddsHeader);
         } else {
 ''', '' if not crunch else '''
         }
@@ -508,6 +592,8 @@ for file_ in data_files:
       code += ''.join(parts)
     code += '''Module['FS_createDataFile']('%s', '%s', fileData%d, true, true, false);\n''' % (dirname, basename, counter)
     counter += 1
+  elif file_['mode'] == 'preload' and asmfs:
+    pass # listed in the manifest instead
   elif file_['mode'] == 'preload':
     # Preload
     varname = 'filePreload%d' % counter
@@ -523,7 +609,16 @@ for file_ in data_files:
     assert 0
 
 if has_preloaded:
-  if not lz4:
+  if asmfs:
+    use_data = '''
+        // ASMFS reads the files straight from the package, so it is copied into the heap, and never freed.
+        var ptr = Module['getMemory'](byteArray.length);
+        Module['HEAPU8'].set(byteArray, ptr);
+        var err = Module['_emscripten_asmfs_import_package'](ptr, ptr + metadata.manifest_start);
+        if (err) Module.printErr('Importing the package ' + PACKAGE_NAME + ' to ASMFS failed with errno ' + err);
+        Module['removeRunDependency']('datafile_%s');
+  ''' % escape_for_js_string(data_target)
+  elif not lz4:
     # Get the big archive and split it up
     if no_heap_copy:
       use_data = '''
@@ -551,8 +646,12 @@ if has_preloaded:
     # LZ4FS usage
     temp = data_target + '.orig'
     shutil.move(data_target, temp)
-    meta = run_js(shared.path_from_root('tools', 'lz4-compress.js'), shared.NODE_JS, [shared.path_from_root('src', 'mini-lz4.js'), temp, data_target], stdout=PIPE)
+    # compress each file in chunks of its own, so that reading it only decompresses its own data
+    files_temp = data_target + '.files'
+    open(files_temp, 'w').write(json.dumps([{'start': f['start'], 'end': f['end']} for f in metadata['files']]))
+    meta = run_js(shared.path_from_root('tools', 'lz4-compress.js'), shared.NODE_JS, [shared.path_from_root('src', 'mini-lz4.js'), temp, data_target, files_temp], stdout=PIPE)
     os.unlink(temp)
+    os.unlink(files_temp)
     use_data = '''
           var compressedData = %s;
           compressedData.data = byteArray;
@@ -561,11 +660,26 @@ if has_preloaded:
           Module['removeRunDependency']('datafile_%s');
     ''' % (meta, escape_for_js_string(data_target))
 
-  package_uuid = uuid.uuid4();
+  package_uuid = uuid.UUID(hex=package_hash.hexdigest()[:32], version=4)
   package_name = data_target
   statinfo = os.stat(package_name)
   remote_package_size = statinfo.st_size
   remote_package_name = os.path.basename(package_name)
+  if use_preload_cache:
+    # Split the package into chunks that are cached separately by their hashes, so that when it changes clients only
+    # download and store the chunks that changed. A new chunk starts at each file, so that a file changing size does not
+    # shift the chunks of the files after it (except with LZ4, where the files are not at their original offsets).
+    boundaries = [0] + ([file_['data_start'] for file_ in data_files] if not lz4 else [])
+    if 'manifest_start' in metadata:
+      boundaries.append(metadata['manifest_start'])
+    boundaries = sorted(set([b for b in boundaries if b < remote_package_size])) + [remote_package_size]
+    metadata['chunks'] = []
+    with open(package_name, 'rb') as f:
+      for start, end in zip(boundaries[:-1], boundaries[1:]):
+        for chunk_start in range(start, end, PRELOAD_CACHE_CHUNK_SIZE):
+          chunk_end = min(chunk_start + PRELOAD_CACHE_CHUNK_SIZE, end)
+          f.seek(chunk_start)
+          metadata['chunks'].append([chunk_start, chunk_end, hashlib.sha256(f.read(chunk_end - chunk_start)).hexdigest()[:32]])
   ret += r'''
     var PACKAGE_PATH;
     if (typeof window === 'object') {
@@ -592,6 +706,10 @@ if has_preloaded:
     var REMOTE_PACKAGE_SIZE = metadata.remote_package_size;
     var PACKAGE_UUID = metadata.package_uuid;
   '''
+  if use_preload_cache:
+    ret += '''
+    var CHUNKS = metadata.chunks; // [start, end, hash] of each chunk of the package that is cached separately
+  '''
 
   if use_preload_cache:
     code += r'''
@@ -630,68 +748,144 @@ if has_preloaded:
         };
       };
 
-      /* Check if there's a cached package, and if so whether it's the latest available */
-      function checkCachedPackage(db, packageName, callback, errback) {
+      /* The package is cached in chunks, stored by their hashes next to the metadata of the package, which lists them */
+      function chunkKey(packageName, chunk) {
+        return "chunk/" + packageName + "/" + chunk[2];
+      };
+
+      function fetchCachedMetadata(db, packageName, callback, errback) {
         var transaction = db.transaction([METADATA_STORE_NAME], IDB_RO);
         var metadata = transaction.objectStore(METADATA_STORE_NAME);
 
         var getRequest = metadata.get("metadata/" + packageName);
         getRequest.onsuccess = function(event) {
-          var result = event.target.result;
-          if (!result) {
-            return callback(false);
-          } else {
-            return callback(PACKAGE_UUID === result.uuid);
-          }
+          callback(event.target.result);
         };
         getRequest.onerror = function(error) {
           errback(error);
         };
       };
 
-      function fetchCachedPackage(db, packageName, callback, errback) {
+      /* Copies the cached chunks into packageData, and returns the indexes of the ones that are not cached */
+      function fetchCachedChunks(db, packageName, packageData, callback, errback) {
         var transaction = db.transaction([PACKAGE_STORE_NAME], IDB_RO);
         var packages = transaction.objectStore(PACKAGE_STORE_NAME);
-
-        var getRequest = packages.get("package/" + packageName);
-        getRequest.onsuccess = function(event) {
-          var result = event.target.result;
-          callback(result);
+        var missing = [];
+
+        CHUNKS.forEach(function(chunk, i) {
+          var getRequest = packages.get(chunkKey(packageName, chunk));
+          getRequest.onsuccess = function(event) {
+            var result = event.target.result;
+            if (result && result.byteLength === chunk[1] - chunk[0]) {
+              packageData.set(new Uint8Array(result), chunk[0]);
+            } else {
+              missing.push(i);
+            }
+          };
+        });
+        transaction.oncomplete = function(event) {
+          missing.sort(function(a, b) { return a - b });
+          callback(missing);
         };
-        getRequest.onerror = function(error) {
+        transaction.onerror = function(error) {
           errback(error);
         };
       };
 
-      function cacheRemotePackage(db, packageName, packageData, packageMeta, callback, errback) {
-        var transaction_packages = db.transaction([PACKAGE_STORE_NAME], IDB_RW);
-        var packages = transaction_packages.objectStore(PACKAGE_STORE_NAME);
-
-        var putPackageRequest = packages.put(packageData, "package/" + packageName);
-        putPackageRequest.onsuccess = function(event) {
-          var transaction_metadata = db.transaction([METADATA_STORE_NAME], IDB_RW);
-          var metadata = transaction_metadata.objectStore(METADATA_STORE_NAME);
-          var putMetadataRequest = metadata.put(packageMeta, "metadata/" + packageName);
-          putMetadataRequest.onsuccess = function(event) {
-            callback(packageData);
-          };
-          putMetadataRequest.onerror = function(error) {
-            errback(error);
-          };
+      /* Stores the given chunks, removes the chunks of the previously cached version that are not used any more, and
+         updates the metadata, all in one transaction */
+      function cacheChunks(db, packageName, packageData, chunks, cachedMeta, packageMeta, callback, errback) {
+        var transaction = db.transaction([PACKAGE_STORE_NAME, METADATA_STORE_NAME], IDB_RW);
+        var packages = transaction.objectStore(PACKAGE_STORE_NAME);
+        var metadata = transaction.objectStore(METADATA_STORE_NAME);
+
+        chunks.forEach(function(i) {
+          var chunk = CHUNKS[i];
+          packages.put(packageData.buffer.slice(chunk[0], chunk[1]), chunkKey(packageName, chunk));
+        });
+        if (cachedMeta) {
+          var used = {};
+          CHUNKS.forEach(function(chunk) {
+            used[chunk[2]] = 1;
+          });
+          (cachedMeta.chunks || []).forEach(function(chunk) {
+            if (!used[chunk[2]]) packages.delete(chunkKey(packageName, chunk));
+          });
+          if (!cachedMeta.chunks) packages.delete("package/" + packageName); // cached whole by older versions
+        }
+        metadata.put(packageMeta, "metadata/" + packageName);
+        transaction.oncomplete = function(event) {
+          callback();
         };
-        putPackageRequest.onerror = function(error) {
+        transaction.onerror = function(error) {
           errback(error);
         };
       };
+
+      /* Fetches the given chunks into packageData, with one range request for each run of consecutive ones */
+      function fetchRemoteChunks(packageData, chunks, callback, errback) {
+        var ranges = [];
+        chunks.forEach(function(i) {
+          var last = ranges[ranges.length - 1];
+          if (last && last[1] === CHUNKS[i][0]) {
+            last[1] = CHUNKS[i][1];
+          } else {
+            ranges.push([CHUNKS[i][0], CHUNKS[i][1]]);
+          }
+        });
+        var pending = ranges.length;
+        var done = false;
+        ranges.forEach(function(range) {
+          fetchRemotePackage(REMOTE_PACKAGE_NAME, range[1] - range[0], function(data) {
+            if (done) return;
+            if (data.byteLength === REMOTE_PACKAGE_SIZE && range[1] - range[0] !== REMOTE_PACKAGE_SIZE) {
+              // the server ignored the range, and sent the whole package
+              packageData.set(new Uint8Array(data));
+              done = true;
+              return callback();
+            }
+            if (data.byteLength !== range[1] - range[0]) {
+              done = true;
+              return errback('bad size of ranged response for ' + PACKAGE_NAME);
+            }
+            packageData.set(new Uint8Array(data), range[0]);
+            if (--pending === 0) {
+              done = true;
+              callback();
+            }
+          }, errback, range);
+        });
+      };
     '''
 
   ret += r'''
-    function fetchRemotePackage(packageName, packageSize, callback, errback) {
+    function fetchRemotePackage(packageName, packageSize, callback, errback, range) {
+      // The HTML may have started the download already, before this script arrived.
+      var request = !range && Module['dataFileRequests'] && Module['dataFileRequests'][packageName];
+      if (request) {
+        delete Module['dataFileRequests'][packageName];
+        var useRequest = function() {
+          if (request.status == 200 || request.status == 304 || (request.status == 0 && request.response)) {
+            callback(request.response);
+          } else {
+            fetchRemotePackage(packageName, packageSize, callback, errback); // try again ourselves
+          }
+        };
+        if (request.readyState === 4) {
+          useRequest();
+        } else {
+          if (Module['setStatus']) Module['setStatus']('Downloading data...');
+          request.addEventListener('load', useRequest);
+          request.addEventListener('error', useRequest);
+        }
+        return;
+      }
       var xhr = new XMLHttpRequest();
       xhr.open('GET', packageName, true);
       xhr.responseType = 'arraybuffer';
+      if (range) xhr.setRequestHeader('Range', 'bytes=' + range[0] + '-' + (range[1] - 1));
       xhr.onprogress = function(event) {
-        var url = packageName;
+        var url = range ? packageName + '#' + range : packageName;
         var size = packageSize;
         if (event.total) size = event.total;
         if (event.loaded) {
@@ -765,24 +959,33 @@ if has_preloaded:
 
       openDatabase(
         function(db) {
-          checkCachedPackage(db, PACKAGE_PATH + PACKAGE_NAME,
-            function(useCached) {
-              Module.preloadResults[PACKAGE_NAME] = {fromCache: useCached};
-              if (useCached) {
-                console.info('loading ' + PACKAGE_NAME + ' from cache');
-                fetchCachedPackage(db, PACKAGE_PATH + PACKAGE_NAME, processPackageData, preloadFallback);
-              } else {
-                console.info('loading ' + PACKAGE_NAME + ' from remote');
-                fetchRemotePackage(REMOTE_PACKAGE_NAME, REMOTE_PACKAGE_SIZE, 
-                  function(packageData) {
-                    cacheRemotePackage(db, PACKAGE_PATH + PACKAGE_NAME, packageData, {uuid:PACKAGE_UUID}, processPackageData,
-                      function(error) {
-                        console.error(error);
-                        processPackageData(packageData);
-                      });
+          var packageName = PACKAGE_PATH + PACKAGE_NAME;
+          fetchCachedMetadata(db, packageName,
+            function(cachedMeta) {
+              var packageData = new Uint8Array(REMOTE_PACKAGE_SIZE);
+              fetchCachedChunks(db, packageName, packageData,
+                function(missing) {
+                  Module.preloadResults[PACKAGE_NAME] = {fromCache: missing.length === 0};
+                  if (missing.length === 0) {
+                    console.info('loading ' + PACKAGE_NAME + ' from cache');
+                    processPackageData(packageData.buffer);
+                    return;
                   }
-                , preloadFallback);
-              }
+                  console.info('loading ' + PACKAGE_NAME + ' from remote (' + missing.length + ' of ' + CHUNKS.length + ' chunks)');
+                  fetchRemoteChunks(packageData, missing,
+                    function() {
+                      cacheChunks(db, packageName, packageData, missing, cachedMeta, {uuid:PACKAGE_UUID, chunks:CHUNKS},
+                        function() {
+                          processPackageData(packageData.buffer);
+                        },
+                        function(error) {
+                          console.error(error);
+                          processPackageData(packageData.buffer);
+                        });
+                    }
+                  , preloadFallback);
+                }
+              , preloadFallback);
             }
           , preloadFallback);
         }
@@ -177,6 +177,149 @@ function astToSrc(ast, minifyWhitespace) {
   });
 }
 
+// Compact AST serialization, shared with the native optimizer, which documents
+// the format in simple_ast.h. Strings are stored escaped as in a double-quoted JS
+// string, which is how the native optimizer keeps them.
+
+var binaryAstDoubles = new Float64Array(1);
+var binaryAstWords = new Uint32Array(binaryAstDoubles.buffer); // assumes little-endian
+
+function astToBinary(ast) {
+  // write bytes into a growable buffer, which is much faster than appending to a string
+  var buffer = new Uint8Array(1 << 16), pos = 0;
+  var strings = [], stringIndexes = Object.create(null);
+  function ensure(n) {
+    if (pos + n <= buffer.length) return;
+    var bigger = new Uint8Array(Math.max(buffer.length * 2, pos + n));
+    bigger.set(buffer);
+    buffer = bigger;
+  }
+  function varint(x) {
+    ensure(7);
+    while (x >= 32) {
+      buffer[pos++] = 0x60 | (x % 32);
+      x = Math.floor(x / 32);
+    }
+    buffer[pos++] = 0x40 | x;
+  }
+  function tag(c) {
+    ensure(1);
+    buffer[pos++] = c.charCodeAt(0);
+  }
+  function string(str) {
+    var index = stringIndexes[str];
+    if (index === undefined) {
+      index = stringIndexes[str] = strings.length;
+      strings.push(str);
+    }
+    varint(index);
+  }
+  function node(x) {
+    if (Array.isArray(x)) {
+      tag('(');
+      varint(x.length);
+      for (var i = 0; i < x.length; i++) node(x[i]);
+    } else if (typeof x === 'string') {
+      tag('$');
+      string(x);
+    } else if (typeof x === 'number') {
+      if (x >= 0 && x < 4294967296 && x === Math.floor(x) && 1/x > 0) {
+        tag('#');
+        varint(x);
+      } else {
+        binaryAstDoubles[0] = x;
+        tag('.');
+        varint(binaryAstWords[0]);
+        varint(binaryAstWords[1]);
+      }
+    } else if (x === null || x === undefined) { // as in JSON, undefined array elements are null
+      tag('0');
+    } else if (typeof x === 'boolean') {
+      tag(x ? '2' : '1');
+    } else {
+      var keys = Object.keys(x);
+      tag(':');
+      varint(keys.length);
+      keys.forEach(function(key) {
+        string(key);
+        node(x[key]);
+      });
+    }
+  }
+  node(ast);
+  var nodes = [];
+  for (var i = 0; i < pos; i += 8192) {
+    nodes.push(String.fromCharCode.apply(null, buffer.subarray(i, Math.min(pos, i + 8192))));
+  }
+  // the string table goes first, but is only known after the nodes are written
+  var nodeBytes = pos;
+  varint(strings.length);
+  var header = ['EMAST', String.fromCharCode.apply(null, buffer.subarray(nodeBytes, pos))];
+  strings.forEach(function(str) {
+    header.push(JSON.stringify(str).slice(1, -1), '"');
+  });
+  return header.join('') + nodes.join('');
+}
+
+function binaryToAst(src) {
+  var curr = src.indexOf('EMAST');
+  assert(curr >= 0, 'not a binary AST');
+  curr += 5;
+  function varint() {
+    var ret = 0, mul = 1;
+    while (1) {
+      var c = src.charCodeAt(curr++);
+      assert(c >= 0x40 && c < 0x80, 'bad binary AST varint');
+      ret += (c & 31) * mul;
+      if (c < 0x60) return ret;
+      mul *= 32;
+    }
+  }
+  var strings = [];
+  var num = varint();
+  for (var i = 0; i < num; i++) {
+    var start = curr, escaped = false;
+    while (src[curr] !== '"') {
+      if (src[curr] === '\\') {
+        curr++;
+        escaped = true;
+      }
+      curr++;
+    }
+    var str = src.substring(start, curr++);
+    strings.push(escaped ? JSON.parse('"' + str + '"') : str);
+  }
+  function node() {
+    switch (src[curr++]) {
+      case '(': {
+        var size = varint(), ret = new Array(size);
+        for (var i = 0; i < size; i++) ret[i] = node();
+        return ret;
+      }
+      case '$': return strings[varint()];
+      case '#': return varint();
+      case '.': {
+        binaryAstWords[0] = varint();
+        binaryAstWords[1] = varint();
+        return binaryAstDoubles[0];
+      }
+      case ':': {
+        var size = varint(), ret = {};
+        for (var i = 0; i < size; i++) {
+          var key = strings[varint()];
+          ret[key] = node();
+        }
+        return ret;
+      }
+      case '0': return null;
+      case '1': return false;
+      case '2': return true;
+      default: throw 'bad binary AST node tag: ' + src[curr-1];
+    }
+  }
+  return node();
+}
+
 function srcToStat(src) {
   return srcToAst(src)[1][0]; // look into toplevel
 }
@@ -1018,6 +1161,26 @@ function localCSE(ast) {
         }
         delete deps[what];
       }
+      function invalidateEffects(node, type) {
+        if (type === 'assign') {
+          var target = node[2];
+          if (target[0] === 'name') {
+            var name = target[1];
+            if (name in asmData.params || name in asmData.vars) {
+              invalidate(name);
+            } else {
+              invalidate('<global>');
+            }
+          } else {
+            assert(target[0] === 'sub');
+            invalidate('<memory>');
+          }
+        }
+        if (type === 'call') {
+          invalidate('<global>');
+          invalidate('<memory>');
+        }
+      }
       function doInvalidations(curr) {
         return traverse(curr, function(node, type) {
           if (type in CONTROL_FLOW) {
@@ -1025,24 +1188,7 @@ function localCSE(ast) {
             deps = {};
             return true; // abort everything
           }
-          if (type === 'assign') {
-            var target = node[2];
-            if (target[0] === 'name') {
-              var name = target[1];
-              if (name in asmData.params || name in asmData.vars) {
-                invalidate(name);
-              } else {
-                invalidate('<global>');
-              }
-            } else {
-              assert(target[0] === 'sub');
-              invalidate('<memory>');
-            }
-          }
-          if (type === 'call') {
-            invalidate('<global>');
-            invalidate('<memory>');
-          }
+          invalidateEffects(node, type);
         });
       }
       for (var i = 0; i < stats.length; i++) {
@@ -1062,6 +1208,7 @@ function localCSE(ast) {
           if (type === 'binary' || type === 'unary-prefix') {
             if (type === 'binary' && skips.indexOf(node) >= 0) return;
             if (measureCost(node) < MIN_COST) return;
+            if (hasSideEffects(node)) return; // e.g. a call must be evaluated each time
             if (detectType(node, asmData) === ASM_NONE) return; // if we can't figure it out locally, forget it
             var str = JSON.stringify(node);
             var lookup = exps[str];
@@ -1117,6 +1264,9 @@ function localCSE(ast) {
               return makeSignedAsmCoercion(['name', lookup[2]], type, sign);
             }
           }
+        }, function(node, type) {
+          // an assignment or a call inside this line can change what later parts of it read
+          invalidateEffects(node, type);
         });
         // finally, repeat invalidation processing, to not be sensitive to inter-line control flow
         doInvalidations(curr);
@@ -4544,8 +4694,16 @@ function eliminateMemSafe(ast) {
 }
 
 function minifyGlobals(ast) {
-  var minified = {};
-  var next = 0;
+  // the most used get the shortest names: extraInfo.counts has how often the functions refer to each global
+  var uses = {};
+  var names = [];
+  function add(name, declarations) {
+    if (!(name in uses)) {
+      names.push(name);
+      uses[name] = 0;
+    }
+    uses[name] += declarations;
+  }
   var first = true; // do not minify initial 'var asm ='
   // find the globals
   traverse(ast, function(node, type) {
@@ -4556,29 +4714,55 @@ function minifyGlobals(ast) {
       }
       var vars = node[1];
       for (var i = 0; i < vars.length; i++) {
-        var name = vars[i][0];
-        ensureMinifiedNames(next);
-        vars[i][0] = minified[name] = minifiedNames[next++];
+        add(vars[i][0], 1);
       }
     } else if (type === 'defun') {
-      var name = node[1];
-      ensureMinifiedNames(next);
-      node[1] = minified[name] = minifiedNames[next++];
+      add(node[1], 1);
     }
   });
   // add all globals in function chunks, i.e. not here but passed to us
   for (var i = 0; i < extraInfo.globals.length; i++) {
-    name = extraInfo.globals[i];
-    ensureMinifiedNames(next);
-    minified[name] = minifiedNames[next++];
+    add(extraInfo.globals[i], 0); // counted with their uses
+  }
+  // count the uses, and sort by them, breaking ties by the order we found them in, which keeps this deterministic
+  traverse(ast, function(node, type) {
+    if (type === 'name' && node[1] in uses) {
+      uses[node[1]]++;
+    }
+  });
+  if (extraInfo.counts) {
+    names.forEach(function(name) {
+      if (name in extraInfo.counts) uses[name] += extraInfo.counts[name];
+    });
+  }
+  var order = names.map(function(name, i) { return i });
+  order.sort(function(a, b) {
+    return (uses[names[b]] - uses[names[a]]) || (a - b);
+  });
+  var minified = {};
+  for (var i = 0; i < order.length; i++) {
+    ensureMinifiedNames(i);
+    minified[names[order[i]]] = minifiedNames[i];
   }
   // apply minification
+  first = true;
   traverse(ast, function(node, type) {
     if (type === 'name') {
       var name = node[1];
       if (name in minified) {
         node[1] = minified[name];
       }
+    } else if (type === 'var' || type === 'const') {
+      if (first) {
+        first = false;
+        return;
+      }
+      var vars = node[1];
+      for (var i = 0; i < vars.length; i++) {
+        vars[i][0] = minified[vars[i][0]];
+      }
+    } else if (type === 'defun') {
+      node[1] = minified[node[1]];
     }
   });
   suffix = '// EXTRA_INFO:' + JSON.stringify(minified);
@@ -4617,22 +4801,44 @@ function minifyLocals(ast) {
       }
     });
 
-    // The first time we encounter a local name, we assign it a
-    // minified name that's not currently in use.  Allocating on
-    // demand means they're processed in a predictable order,
-    // which is very handy for testing/debugging purposes.
+    // Count how often each local is referred to, and give the most used the
+    // shortest names that are not currently in use. Ties go to the first
+    // we encounter, so they are processed in a predictable order, which is
+    // very handy for testing/debugging purposes.
+    var uses = {};
+    var locals = [];
+    function use(name) {
+      if (!(name in uses)) {
+        locals.push(name);
+        uses[name] = 0;
+      }
+      uses[name]++;
+    }
+    if (fun[2]) fun[2].forEach(use);
+    traverse(fun[3], function(node, type) {
+      if (type === 'name') {
+        if (isLocalName(node[1])) use(node[1]);
+      } else if (type === 'var') {
+        node[1].forEach(function(defn) {
+          use(defn[0]);
+        });
+      }
+    });
+    var order = locals.map(function(name, i) { return i });
+    order.sort(function(a, b) {
+      return (uses[locals[b]] - uses[locals[a]]) || (a - b);
+    });
     var nextMinifiedName = 0;
-    function getNextMinifiedName() {
+    order.forEach(function(i) {
       var minified;
       while (1) {
         ensureMinifiedNames(nextMinifiedName);
         minified = minifiedNames[nextMinifiedName++];
         // TODO: we can probably remove !isLocalName here
-        if (!usedNames[minified] && !isLocalName(minified)) {
-          return minified;
-        }
+        if (!usedNames[minified] && !isLocalName(minified)) break;
       }
-    }
+      newNames[locals[i]] = minified;
+    });
 
     // We can also minify loop labels, using a separate namespace
     // to the variable declarations.
@@ -4650,29 +4856,18 @@ function minifyLocals(ast) {
     }
     if (fun[2]) {
       for (var i = 0; i < fun[2].length; i++) {
-        var minified = getNextMinifiedName();
-        newNames[fun[2][i]] = minified;
-        fun[2][i] = minified;
+        fun[2][i] = newNames[fun[2][i]];
       }
     }
     traverse(fun[3], function(node, type) {
       if (type === 'name') {
-        var name = node[1];
-        var minified = newNames[name];
+        var minified = newNames[node[1]];
         if (minified) {
           node[1] = minified;
-        } else if (isLocalName(name)) {
-          minified = getNextMinifiedName();
-          newNames[name] = minified;
-          node[1] = minified;
         }
       } else if (type === 'var') {
         node[1].forEach(function(defn) {
-          var name = defn[0];
-          if (!(name in newNames)) {
-            newNames[name] = getNextMinifiedName();
-          }
-          defn[0] = newNames[name];
+          defn[0] = newNames[defn[0]];
         });
       } else if (type === 'label') {
         if (!newLabels[node[1]]) {
@@ -7649,6 +7844,31 @@ function dumpCallGraph(ast) {
   });
 }
 
+// Replaces invoke_*(index, ..) calls of functions that cannot throw with direct calls to them. The analysis
+// is done in tools/nothrow_invokes.py, which gives us for each invoke_* the indexes to replace and their functions.
+function removeNothrowInvokes(ast) {
+  assert(asm);
+  var nothrowInvokes = extraInfo.nothrowInvokes;
+  function getIndex(node) {
+    if (node[0] === 'num') return node[1];
+    if (node[0] === 'binary' && node[1] === '|' && node[2][0] === 'num' && node[3][0] === 'num' && node[3][1] === 0) return node[2][1];
+    return -1;
+  }
+  traverseGeneratedFunctions(ast, function(func) {
+    traverse(func, function(node, type) {
+      if (type === 'call' && node[1][0] === 'name' && node[2].length > 0) {
+        var targets = nothrowInvokes[node[1][1]];
+        if (!targets) return;
+        var index = getIndex(node[2][0]);
+        if (index >= 0 && targets.hasOwnProperty(index)) {
+          node[1] = ['name', targets[index]];
+          node[2] = node[2].slice(1);
+        }
+      }
+    });
+  });
+}
+
 // Last pass utilities
 
 // Change +5 to DOT$ZERO(5). We then textually change 5 to 5.0 (uglify's ast cannot differentiate between 5 and 5.0 directly)
@@ -8281,7 +8501,7 @@ function removeFuncs(ast) {
 // Passes table
 
 var minifyWhitespace = false, printMetadata = true, asm = false,
-    asmPreciseF32 = false, emitJSON = false, last = false,
+    asmPreciseF32 = false, emitJSON = false, emitBinary = false, last = false,
     emitAst = true;
 
 var passes = {
@@ -8308,6 +8528,7 @@ var passes = {
   relocate: relocate,
   outline: outline,
   safeHeap: safeHeap,
+  safeHeapSkipRedundant: safeHeap, // the native optimizer skips redundant checks, here we check everything
   splitMemory: splitMemory,
   splitMemoryShell: splitMemoryShell,
   optimizeFrounds: optimizeFrounds,
@@ -8315,6 +8536,7 @@ var passes = {
   emterpretify: emterpretify,
   findReachable: findReachable,
   dumpCallGraph: dumpCallGraph,
+  removeNothrowInvokes: removeNothrowInvokes,
   asmLastOpts: asmLastOpts,
   JSDCE: JSDCE,
   AJSDCE: AJSDCE,
@@ -8330,6 +8552,8 @@ var passes = {
   asmPreciseF32: function() { asmPreciseF32 = true },
   emitJSON: function() { emitJSON = true },
   receiveJSON: function() { }, // handled in a special way, before passes are run
+  emitBinary: function() { emitBinary = true },
+  receiveBinary: function() { }, // handled in a special way, before passes are run
   last: function() { last = true },
   noEmitAst: function() { emitAst = false },
 };
@@ -8353,7 +8577,9 @@ if (extraInfoStart > 0) extraInfo = JSON.parse(src.substr(extraInfoStart + 14));
 //printErr(JSON.stringify(extraInfo));
 
 var ast;
-if (arguments_.indexOf('receiveJSON') < 0) {
+if (arguments_.indexOf('receiveBinary') >= 0) {
+  ast = binaryToAst(src);
+} else if (arguments_.indexOf('receiveJSON') < 0) {
   ast = srcToAst(src);
 } else {
   var commentStart = src.indexOf('//');
@@ -8372,7 +8598,9 @@ if (asm && last) {
 }
 
 if (emitAst) {
-  if (!emitJSON) {
+  if (emitBinary) {
+    print(astToBinary(ast));
+  } else if (!emitJSON) {
     var js = astToSrc(ast, minifyWhitespace), old;
     if (asm && last) {
       js = fixDotZero(js);
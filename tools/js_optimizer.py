@@ -1,10 +1,10 @@
 
 from __future__ import print_function
-import os, sys, subprocess, multiprocessing, re, string, json, shutil, logging
+import os, sys, subprocess, multiprocessing, re, string, json, shutil, logging, threading
 
 sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
-from tools.toolchain_profiler import ToolchainProfiler
+from tools.toolchain_profiler import ToolchainProfiler, EM_PROFILE_TOOLCHAIN
 if __name__ == '__main__':
   ToolchainProfiler.record_process_start()
 
@@ -21,7 +21,12 @@ __rootpath__ = os.path.abspath(os.path.dirname(os.path.dirname(__file__)))
 def path_from_root(*pathelems):
   return os.path.join(__rootpath__, *pathelems)
 
-NATIVE_PASSES = set(['asm', 'asmPreciseF32', 'receiveJSON', 'emitJSON', 'eliminateDeadFuncs', 'eliminate', 'eliminateMemSafe', 'simplifyExpressions', 'simplifyIfs', 'optimizeFrounds', 'registerize', 'registerizeHarder', 'minifyNames', 'minifyLocals', 'minifyWhitespace', 'cleanup', 'asmLastOpts', 'last', 'noop', 'closure'])
+NATIVE_PASSES = set(['asm', 'asmPreciseF32', 'receiveJSON', 'emitJSON', 'receiveBinary', 'emitBinary', 'eliminateDeadFuncs', 'pruneFunctions', 'inlineSmallFunctions', 'eliminate', 'eliminateMemSafe', 'simplifyExpressions', 'simplifyIfs', 'hoistLoopInvariants', 'localCSE', 'instrumentFunctionOrder', 'instrumentShadowStack', 'devirtualize', 'outline', 'optimizeFrounds', 'safeHeap', 'safeHeapSkipRedundant', 'splitMemory', 'findReachable', 'dumpCallGraph', 'minifyGlobals', 'registerize', 'registerizeHarder', 'minifyNames', 'minifyLocals', 'minifyWhitespace', 'cleanup', 'asmLastOpts', 'last', 'noop', 'closure'])
+
+# Native passes that only look at one function at a time. The native optimizer can run these on a pool of threads
+# (plus directives that are not passes at all). This must match what `optimizer --function-local-passes` reports,
+# which test_native_function_local_passes checks.
+NATIVE_FUNCTION_LOCAL_PASSES = set(['asm', 'asmPreciseF32', 'receiveJSON', 'emitJSON', 'receiveBinary', 'emitBinary', 'eliminate', 'eliminateMemSafe', 'simplifyExpressions', 'simplifyIfs', 'hoistLoopInvariants', 'localCSE', 'instrumentFunctionOrder', 'instrumentShadowStack', 'devirtualize', 'safeHeap', 'safeHeapSkipRedundant', 'splitMemory', 'registerize', 'registerizeHarder', 'minifyLocals', 'minifyWhitespace', 'asmLastOpts', 'last', 'noop'])
 
 JS_OPTIMIZER = path_from_root('tools', 'js-optimizer.js')
 
@@ -36,9 +41,28 @@ DEBUG = os.environ.get('EMCC_DEBUG')
 func_sig = re.compile('function ([_\w$]+)\(')
 func_sig_json = re.compile('\["defun", ?"([_\w$]+)",')
 import_sig = re.compile('(var|const) ([_\w$]+ *=[^;]+);')
+identifier_sig = re.compile('(?<![\w$.])[a-zA-Z_$][\w$]*')
 
 NATIVE_OPTIMIZER = os.environ.get('EMCC_NATIVE_OPTIMIZER') or '2' # use optimized native optimizer by default, unless disabled by EMCC_NATIVE_OPTIMIZER=0 in the env
 
+# EMCC_NATIVE_OPTIMIZER_THREADS=1 makes us parse each chunk once and run function-local passes on a thread pool inside
+# the native optimizer, instead of starting one optimizer process per chunk
+NATIVE_OPTIMIZER_THREADS = os.environ.get('EMCC_NATIVE_OPTIMIZER_THREADS') == '1'
+
+# By default each process that runs chunks on the native optimizer keeps one running as a server, which gets the chunks
+# through a pipe, across chunks and pass groups. EMCC_NATIVE_OPTIMIZER_SERVER=0 starts an optimizer process on a temp
+# file for each chunk instead
+NATIVE_OPTIMIZER_SERVER = os.environ.get('EMCC_NATIVE_OPTIMIZER_SERVER') != '0'
+
+# EMCC_JSOPT_CACHE=1 keeps optimized functions in the emscripten cache dir, and only optimizes functions that changed
+# since a previous run with the same passes. This applies to runs of function-local passes, whose output for a function
+# depends on nothing but that function (and the extra info).
+JSOPT_CACHE = os.environ.get('EMCC_JSOPT_CACHE') == '1'
+
+# When profiling the toolchain, or debugging, the native optimizer reports the time, AST node counts and arena memory of
+# each pass on each chunk. They appear in the toolchain profiler's results, and debug output has the totals.
+NATIVE_PASS_STATS = EM_PROFILE_TOOLCHAIN or DEBUG
+
 def split_funcs(js, just_split=False):
   if just_split: return [('(json)', line) for line in js.split('\n')]
   parts = [part for part in js.split('\n}\n')]
@@ -55,6 +79,11 @@ def split_funcs(js, just_split=False):
     funcs.append((ident, func))
   return funcs
 
+debug_line_comment = re.compile(r'//@line (\d+)')
+
+def rebase_debug_lines(js, offset):
+  return debug_line_comment.sub(lambda m: '//@line %d' % (int(m.group(1)) + offset), js)
+
 def get_native_optimizer():
   if os.environ.get('EMCC_FAST_COMPILER') == '0':
     logging.critical('Non-fastcomp compiler is no longer available, please use fastcomp or an older version of emscripten')
@@ -159,7 +188,7 @@ def get_native_optimizer():
                                          shared.path_from_root('tools', 'optimizer', 'optimizer.cpp'),
                                          shared.path_from_root('tools', 'optimizer', 'optimizer-shared.cpp'),
                                          shared.path_from_root('tools', 'optimizer', 'optimizer-main.cpp'),
-                                         '-O3', '-std=c++11', '-fno-exceptions', '-fno-rtti', '-o', output] + args, stdout=subprocess.PIPE, stderr=subprocess.PIPE).communicate()
+                                         '-O3', '-std=c++11', '-fno-exceptions', '-fno-rtti', '-pthread', '-o', output] + args, stdout=subprocess.PIPE, stderr=subprocess.PIPE).communicate()
             outs.append(out)
             errs.append(err)
           except OSError:
@@ -198,6 +227,10 @@ def use_native(x, source_map=False):
   if isinstance(x, list): return len(NATIVE_PASSES.intersection(x)) == len(x) and 'asm' in x
   return x in NATIVE_PASSES
 
+# Check if we should run a set of native passes on a thread pool inside a single optimizer process
+def use_native_threads(passes, source_map=False):
+  return NATIVE_OPTIMIZER_THREADS and use_native(passes, source_map) and len(NATIVE_FUNCTION_LOCAL_PASSES.intersection(passes)) == len(passes)
+
 class Minifier(object):
   '''
     asm.js minification support. We calculate minification of
@@ -212,7 +245,7 @@ class Minifier(object):
     self.profiling_funcs = False
 
   def minify_shell(self, shell, minify_whitespace, source_map=False):
-    # Run through js-optimizer.js to find and minify the global symbols
+    # Run through the optimizer to find and minify the global symbols
     # We send it the globals, which it parses at the proper time. JS decides how
     # to minify all global names, we receive a dictionary back, which is then
     # used by the function processors
@@ -232,13 +265,15 @@ class Minifier(object):
       f = open(temp_file, 'w')
       f.write(shell)
       f.write('\n')
-      f.write('// EXTRA_INFO:' + json.dumps(self.serialize()))
+      f.write('// EXTRA_INFO:' + json.dumps(dict(self.serialize(), counts=self.count_uses(shell))))
       f.close()
 
-      output = shared.run_process(self.js_engine +
-          [JS_OPTIMIZER, temp_file, 'minifyGlobals', 'noPrintMetadata'] +
-          (['minifyWhitespace'] if minify_whitespace else []) +
-          (['--debug'] if source_map else []),
+      if use_native('minifyGlobals', source_map) and get_native_optimizer():
+        optimizer = [get_native_optimizer(), temp_file, 'minifyGlobals']
+      else:
+        optimizer = self.js_engine + [JS_OPTIMIZER, temp_file, 'minifyGlobals', 'noPrintMetadata'] + (['--debug'] if source_map else [])
+      output = shared.run_process(optimizer +
+          (['minifyWhitespace'] if minify_whitespace else []),
           stdout=subprocess.PIPE).stdout
 
     assert len(output) > 0 and not output.startswith('Assertion failed'), 'Error in js optimizer: ' + output
@@ -256,6 +291,18 @@ class Minifier(object):
     return code.replace('13371337', '0.0')
 
 
+  def count_uses(self, shell):
+    # How often the functions refer to each global, so the most used get the
+    # shortest names. Counting the tokens is close enough, and a local that has
+    # the name of a global only makes that global look more used.
+    candidates = set(identifier_sig.findall(shell)).union(self.globs)
+    counts = {}
+    for m in identifier_sig.finditer(self.js):
+      name = m.group(0)
+      if name in candidates:
+        counts[name] = counts.get(name, 0) + 1
+    return counts
+
   def serialize(self):
     return {
       'globals': self.globs
@@ -266,6 +313,16 @@ end_funcs_marker = '// EMSCRIPTEN_END_FUNCS\n'
 start_asm_marker = '// EMSCRIPTEN_START_ASM\n'
 end_asm_marker = '// EMSCRIPTEN_END_ASM\n'
 
+def get_func_cache(passes, js_engine, serialized_extra_info):
+  if use_native(passes) and get_native_optimizer():
+    optimizer = [get_native_optimizer()]
+  else:
+    optimizer = js_engine + [JS_OPTIMIZER]
+  # a new build of the optimizer may optimize differently
+  optimizer_stamp = [(os.path.getmtime(path), os.path.getsize(path)) if os.path.exists(path) else None for path in optimizer]
+  salt = json.dumps([shared.EMSCRIPTEN_VERSION, optimizer, optimizer_stamp, passes, serialized_extra_info])
+  return shared.cache.FunctionCache(shared.Cache.get_path('jsopt_funcs'), salt)
+
 def run_on_chunk(command):
   try:
     if JS_OPTIMIZER in command: # XXX hackish
@@ -293,6 +350,95 @@ def run_on_chunk(command):
     # avoid throwing keyboard interrupts from a child process
     raise Exception()
 
+class OptimizerServer(object):
+  '''
+    A native optimizer started with --server, which optimizes one chunk after
+    another. See runServer in optimizer-main.cpp for how requests and replies
+    are framed.
+  '''
+
+  def __init__(self, optimizer):
+    self.optimizer = optimizer
+    self.process = None
+
+  def run(self, args, data):
+    if self.process is None:
+      self.process = subprocess.Popen([self.optimizer, '--server'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    if not isinstance(data, bytes): data = data.encode('utf-8')
+    header = '%d\n%s\n%d\n' % (len(args), '\n'.join(args), len(data))
+    try:
+      self.process.stdin.write(header.encode('utf-8') + data)
+      self.process.stdin.flush()
+      size = self.process.stdout.readline()
+    except IOError:
+      size = ''
+    if not size:
+      # the optimizer aborts on errors, after printing them to stderr. a later chunk gets a new server
+      returncode = self.process.wait()
+      self.process = None
+      assert False, 'Error in optimizer server (return code ' + str(returncode) + ')'
+    output = self.process.stdout.read(int(size))
+    if bytes is not str: output = output.decode('utf-8')
+    return output
+
+optimizer_servers = {} # in each process, by optimizer path
+
+def run_in_optimizer_server(job):
+  try:
+    optimizer, args, data = job
+    if optimizer not in optimizer_servers: optimizer_servers[optimizer] = OptimizerServer(optimizer)
+    output = optimizer_servers[optimizer].run(args, data)
+    assert len(output) > 0, 'Error in optimizer: no output'
+    if DEBUG and not shared.WINDOWS: print('.', file=sys.stderr)
+    return output
+  except KeyboardInterrupt:
+    # avoid throwing keyboard interrupts from a child process
+    raise Exception()
+
+def record_native_pass_stats(stats_files):
+  totals = []
+  for stats_file in stats_files:
+    if not os.path.exists(stats_file): continue
+    stats = json.loads(open(stats_file).read())
+    # lay out the passes one after the other, as they ran, from when the optimizer started. passes on threads
+    # report their time summed over the threads
+    blocks = []
+    start = stats['start']
+    for i, info in enumerate(stats['passes']):
+      end = start + info['time'] / info['threads']
+      blocks.append(('native_optimizer.' + info['name'], start, end, dict((key, info[key]) for key in ['nodesBefore', 'nodesAfter', 'arenaBytes'])))
+      start = end
+      if i >= len(totals): totals.append(dict(info))
+      else:
+        for key in ['time', 'nodesBefore', 'nodesAfter']: totals[i][key] += info[key]
+        totals[i]['arenaBytes'] = max(totals[i]['arenaBytes'], info['arenaBytes'])
+    ToolchainProfiler.record_subprocess_blocks(stats['pid'], blocks)
+  if DEBUG and totals:
+    print('native optimizer passes over %d chunks (time, AST nodes before -> after, most arena memory in a chunk):' % len(stats_files), file=sys.stderr)
+    for info in totals:
+      print('  %-24s %8.3fs  %10d -> %10d  %8.2f MB' % (info['name'], info['time'], info['nodesBefore'], info['nodesAfter'], info['arenaBytes'] / (1024 * 1024.)), file=sys.stderr)
+
+def run_in_background(func):
+  '''
+    Runs func on a thread, which is worthwhile when it mostly waits for a
+    subprocess. Returns a function that waits for func to finish, and returns
+    what it returned or raises what it raised.
+  '''
+  result = {}
+  def run():
+    try:
+      result['value'] = func()
+    except Exception as e:
+      result['error'] = e
+  thread = threading.Thread(target=run)
+  thread.daemon = True # do not keep a failed build waiting for closure
+  thread.start()
+  def wait():
+    thread.join()
+    if 'error' in result: raise result['error']
+    return result['value']
+  return wait
+
 def run_on_js(filename, passes, js_engine, source_map=False, extra_info=None, just_split=False, just_concat=False):
   with ToolchainProfiler.profile_block('js_optimizer.split_markers'):
     if not isinstance(passes, list):
@@ -336,6 +482,9 @@ def run_on_js(filename, passes, js_engine, source_map=False, extra_info=None, ju
 
     split_memory = 'splitMemory' in passes
 
+    prune_functions = 'pruneFunctions' in passes
+    assert not (prune_functions and minify_globals), 'pruneFunctions needs the unminified asm shell'
+
   if not minify_globals:
     with ToolchainProfiler.profile_block('js_optimizer.no_minify_globals'):
       pre = js[:start_funcs + len(start_funcs_marker)]
@@ -401,14 +550,110 @@ EMSCRIPTEN_FUNCS();
     funcs = split_funcs(js, just_split)
     js = None
 
-  with ToolchainProfiler.profile_block('js_optimizer.split_to_chunks'):
-    # if we are making source maps, we want our debug numbering to start from the
-    # top of the file, so avoid breaking the JS into chunks
-    cores = 1 if source_map else int(os.environ.get('EMCC_CORES') or multiprocessing.cpu_count())
+    if prune_functions and not just_split:
+      # functions referred to from outside of the functions, like exports and function
+      # tables, are the roots that everything else must be reachable from
+      idents = set(re.findall(r'[\w$]+', pre + post))
+      extra_info = dict(extra_info or {})
+      extra_info['roots'] = [func[0] for func in funcs if func[0] in idents]
+
+    profiled_names = None
+    profiler = None
+    if 'instrumentFunctionOrder' in passes:
+      profiler = 'functionOrderProfiler'
+    elif 'instrumentShadowStack' in passes:
+      profiler = 'SamplingProfiler'
+    if profiler and not just_split:
+      # functions report their index in this list, which the runtime needs to name them
+      assert not minify_globals
+      profiled_names = [func[0] for func in funcs]
+      extra_info = dict(extra_info or {})
+      extra_info['functionIds'] = dict((name, i) for i, name in enumerate(profiled_names))
+
+    serialized_extra_info = suffix_marker + '\n'
+    if minify_globals:
+      serialized_extra_info += '// EXTRA_INFO:' + json.dumps(minify_info)
+    elif extra_info:
+      serialized_extra_info += '// EXTRA_INFO:' + json.dumps(extra_info)
+
+  def run_on_shell(pre, post):
+    # run on the shell code, everything but what we js-optimize
+    start_asm = '// EMSCRIPTEN_START_ASM\n'
+    end_asm = '// EMSCRIPTEN_END_ASM\n'
+    cl_sep = 'wakaUnknownBefore(); var asm=wakaUnknownAfter(global,env,buffer)\n'
+
+    with temp_files.get_file('.cl.js') as cle:
+      c = open(cle, 'w')
+      pre_1, pre_2 = pre.split(start_asm)
+      post_1, post_2 = post.split(end_asm)
+      c.write(pre_1)
+      c.write(cl_sep)
+      c.write(post_2)
+      c.close()
+      cld = cle
+      if split_memory:
+        if DEBUG: print('running splitMemory on shell code', file=sys.stderr)
+        cld = run_on_chunk(js_engine + [JS_OPTIMIZER, cld, 'splitMemoryShell'])
+        f = open(cld, 'a')
+        f.write(suffix_marker)
+        f.close()
+      if closure:
+        if DEBUG: print('running closure on shell code', file=sys.stderr)
+        cld = shared.Building.closure_compiler(cld, pretty='minifyWhitespace' not in passes)
+        temp_files.note(cld)
+      elif cleanup:
+        if DEBUG: print('running cleanup on shell code', file=sys.stderr)
+        next = cld + '.cl.js'
+        temp_files.note(next)
+        proc = subprocess.Popen(js_engine + [JS_OPTIMIZER, cld, 'noPrintMetadata', 'JSDCE'] + (['minifyWhitespace'] if 'minifyWhitespace' in passes else []), stdout=open(next, 'w'))
+        proc.communicate()
+        assert proc.returncode == 0
+        cld = next
+      coutput = open(cld).read()
+
+    coutput = coutput.replace('wakaUnknownBefore();', start_asm)
+    after = 'wakaUnknownAfter'
+    start = coutput.find(after)
+    end = coutput.find(')', start)
+    # First brace is from Closure Compiler comment, thus we need a second one
+    pre_2_second_brace = pre_2.find('{', pre_2.find('{')+1)
+    pre = coutput[:start] + '(/** @suppress {uselessCode} */ function(global,env,buffer) {\n' + pre_2[pre_2_second_brace+1:]
+    post = post_1 + end_asm + coutput[end+1:]
+    return pre, post
+
+  with ToolchainProfiler.profile_block('js_optimizer.read_cache'):
+    func_cache = None
+    cached_funcs = []
+    if JSOPT_CACHE and not just_split and not just_concat and not source_map and \
+       len(NATIVE_FUNCTION_LOCAL_PASSES.intersection(passes)) == len(passes):
+      func_cache = get_func_cache(passes, js_engine, serialized_extra_info)
+      uncached_funcs = []
+      for func in funcs:
+        optimized = func_cache.get(func[1])
+        if optimized is None:
+          uncached_funcs.append(func)
+        else:
+          cached_funcs.append((func_sig.search(optimized).group(1), optimized))
+      if DEBUG: print('js optimizer cache: reusing %d of %d functions' % (len(cached_funcs), len(funcs)), file=sys.stderr)
+      funcs = uncached_funcs
+      total_size = sum([len(func[1]) for func in funcs])
 
-    if not just_split:
-      intended_num_chunks = int(round(cores * NUM_CHUNKS_PER_CORE))
+  with ToolchainProfiler.profile_block('js_optimizer.split_to_chunks'):
+    cores = int(os.environ.get('EMCC_CORES') or multiprocessing.cpu_count())
+    native_threads = use_native_threads(passes, source_map) and cores >= 2
+
+    if not just_split and ('inlineSmallFunctions' in passes or prune_functions):
+      # inlining and pruning look across functions, so they should see the whole module at once
+      chunks = [''.join([func[1] for func in funcs])]
+    elif not just_split:
+      # with native threads, a single process handles as much as it can at once
+      intended_num_chunks = 1 if native_threads else int(round(cores * NUM_CHUNKS_PER_CORE))
       chunk_size = min(MAX_CHUNK_SIZE, max(MIN_CHUNK_SIZE, total_size / intended_num_chunks))
+      # functions bigger than that get a chunk of their own anyhow, so size the chunks for the rest, which keeps
+      # a huge function from making all the other chunks huge too
+      big_size = sum([len(func[1]) for func in funcs if len(func[1]) >= chunk_size])
+      if big_size and intended_num_chunks > 1:
+        chunk_size = min(MAX_CHUNK_SIZE, max(MIN_CHUNK_SIZE, (total_size - big_size) / intended_num_chunks))
       chunks = shared.chunkify(funcs, chunk_size)
     else:
       # keep same chunks as before
@@ -418,12 +663,12 @@ EMSCRIPTEN_FUNCS();
     if DEBUG and len(chunks) > 0: print('chunkification: num funcs:', len(funcs), 'actual num chunks:', len(chunks), 'chunk size range:', max(map(len, chunks)), '-', min(map(len, chunks)), file=sys.stderr)
     funcs = None
 
-    if len(chunks) > 0:
-      serialized_extra_info = suffix_marker + '\n'
-      if minify_globals:
-        serialized_extra_info += '// EXTRA_INFO:' + json.dumps(minify_info)
-      elif extra_info:
-        serialized_extra_info += '// EXTRA_INFO:' + json.dumps(extra_info)
+    # the optimizer server is sent the chunks from memory, while other optimizer processes read them from temp files.
+    # running on threads needs a process of its own, see runServer in optimizer-main.cpp
+    use_server = NATIVE_OPTIMIZER_SERVER and not just_split and not just_concat and not native_threads and not prune_functions and \
+                 not (os.environ.get('EMCC_SAVE_OPT_TEMP') and os.environ.get('EMCC_SAVE_OPT_TEMP') != '0') and \
+                 use_native(passes, source_map) and get_native_optimizer()
+    if len(chunks) > 0 and not use_server:
       with ToolchainProfiler.profile_block('js_optimizer.write_chunks'):
         def write_chunk(chunk, i):
           temp_file = temp_files.get('.jsfunc_%d.js' % i).name
@@ -437,7 +682,16 @@ EMSCRIPTEN_FUNCS();
       filenames = []
 
   with ToolchainProfiler.profile_block('run_optimizer'):
-    if len(filenames) > 0:
+    stats_files = []
+    runner = run_on_chunk
+    if len(chunks) > 0 and use_server:
+      shared.logging.debug('js optimizer using native server')
+      extra_args = ['stream'] if len(NATIVE_FUNCTION_LOCAL_PASSES.intersection(passes)) == len(passes) else []
+      if NATIVE_PASS_STATS:
+        stats_files = [temp_files.get('.jsfunc_%d.passstats.json' % i).name for i in range(len(chunks))]
+      commands = [(get_native_optimizer(), passes + extra_args + (['passStats=' + stats_files[i]] if stats_files else []), chunks[i] + serialized_extra_info) for i in range(len(chunks))]
+      runner = run_in_optimizer_server
+    elif len(filenames) > 0:
       if not use_native(passes, source_map) or not get_native_optimizer():
         commands = [js_engine +
             [JS_OPTIMIZER, filename, 'noPrintMetadata'] +
@@ -446,69 +700,105 @@ EMSCRIPTEN_FUNCS();
         # use the native optimizer
         shared.logging.debug('js optimizer using native')
         assert not source_map # XXX need to use js optimizer
-        commands = [[get_native_optimizer(), filename] + passes for filename in filenames]
+        if native_threads or prune_functions:
+          extra_args = ['threads=%d' % cores]
+        elif len(NATIVE_FUNCTION_LOCAL_PASSES.intersection(passes)) == len(passes):
+          extra_args = ['stream'] # optimize and print one function at a time, to bound memory use
+        else:
+          extra_args = []
+        if NATIVE_PASS_STATS:
+          stats_files = [filename + '.passstats.json' for filename in filenames]
+          commands = [[get_native_optimizer(), filename] + passes + extra_args + ['passStats=' + stats_file] for filename, stats_file in zip(filenames, stats_files)]
+        else:
+          commands = [[get_native_optimizer(), filename] + passes + extra_args for filename in filenames]
       #print [' '.join(command) for command in commands]
-
-      cores = min(cores, len(filenames))
-      if len(chunks) > 1 and cores >= 2:
+    else:
+      commands = []
+
+    if len(commands) > 0:
+      cores = 1 if native_threads else min(cores, len(commands))
+    parallel = len(commands) > 0 and len(chunks) > 1 and cores >= 2
+    if parallel:
+      # the pool is started before the thread below, as its processes could fork off holding a lock that thread took
+      pool = shared.Building.get_multiprocessing_pool()
+
+    # closure and cleanup of the shell do not depend on the optimized functions, so they run while the functions are
+    # optimized, except with pruneFunctions, which renames things in the shell
+    shell_job = None
+    if (closure or cleanup or split_memory) and not prune_functions:
+      shell_job = run_in_background(lambda: run_on_shell(pre, post))
+
+    if len(commands) > 0:
+      if parallel:
         # We can parallelize
         if DEBUG: print('splitting up js optimization into %d chunks, using %d cores  (total: %.2f MB)' % (len(chunks), cores, total_size/(1024*1024.)), file=sys.stderr)
         with ToolchainProfiler.profile_block('optimizer_pool'):
-          pool = shared.Building.get_multiprocessing_pool()
-          filenames = pool.map(run_on_chunk, commands, chunksize=1)
+          # idle workers take the next chunk (chunksize=1), and we hand out the costliest chunks first, so that a
+          # huge function is not started last while the other cores have nothing left to do. the cost of a chunk
+          # is estimated by its size. outputs are kept in the original order
+          order = sorted(range(len(commands)), key=lambda i: len(chunks[i]), reverse=True)
+          results = pool.map(runner, [commands[i] for i in order], chunksize=1)
+          outputs = [None] * len(commands)
+          for i, result in zip(order, results):
+            outputs[i] = result
       else:
         # We can't parallize, but still break into chunks to avoid uglify/node memory issues
         if len(chunks) > 1 and DEBUG: print('splitting up js optimization into %d chunks' % (len(chunks)), file=sys.stderr)
-        filenames = [run_on_chunk(command) for command in commands]
+        outputs = [runner(command) for command in commands]
     else:
-      filenames = []
-
-    for filename in filenames: temp_files.note(filename)
+      outputs = []
+
+    if not use_server:
+      # the outputs were written to temp files
+      for filename in outputs: temp_files.note(filename)
+      outputs = [open(filename).read() for filename in outputs]
+
+    if stats_files:
+      for stats_file in stats_files: temp_files.note(stats_file)
+      record_native_pass_stats(stats_files)
+
+    if source_map and len(outputs) > 1:
+      # the optimizer numbers its //@line comments by the lines of the chunk it was given. the source mapper expects
+      # them to be numbered from the top of the functions, so rebase each chunk as if all were optimized at once
+      line_offset = 0
+      for i in range(len(outputs)):
+        if line_offset:
+          outputs[i] = rebase_debug_lines(outputs[i], line_offset)
+        line_offset += chunks[i].count('\n')
+
+  if func_cache:
+    with ToolchainProfiler.profile_block('js_optimizer.write_cache'):
+      for chunk, output in zip(chunks, outputs):
+        # functions are in the same order as in the inputs, as all the passes are function-local
+        inputs = split_funcs(chunk)
+        optimized_funcs = split_funcs(output)
+        if len(inputs) != len(optimized_funcs): continue
+        for func, optimized in zip(inputs, optimized_funcs):
+          func_cache.put(func[1], optimized[1])
+
+  if prune_functions and len(outputs) > 0:
+    with ToolchainProfiler.profile_block('js_optimizer.apply_equivalent_functions'):
+      # the optimizer reports which functions it folded into which, and references
+      # to them in the asm shell (exports, function tables) must follow
+      assert len(outputs) == 1
+      output = outputs[0]
+      info_start = output.rfind('// EXTRA_INFO:')
+      if info_start >= 0:
+        equivalents = dict(json.loads(output[info_start + len('// EXTRA_INFO:'):])['equivalentFunctions'])
+        outputs[0] = output[:info_start]
+        if DEBUG: print('pruneFunctions folded %d functions' % len(equivalents), file=sys.stderr)
+        if equivalents:
+          end_asm = post.find(end_asm_marker)
+          if end_asm < 0: end_asm = len(post)
+          # rename values, but not the keys in the exports object, nor strings
+          post = re.sub(r'''(?<![\w$.'"])([\w$]+)(?![\w$])(?!\s*:)''', lambda m: equivalents.get(m.group(1), m.group(1)), post[:end_asm]) + post[end_asm:]
+      output = None
 
   with ToolchainProfiler.profile_block('split_closure_cleanup'):
-    if closure or cleanup or split_memory:
-      # run on the shell code, everything but what we js-optimize
-      start_asm = '// EMSCRIPTEN_START_ASM\n'
-      end_asm = '// EMSCRIPTEN_END_ASM\n'
-      cl_sep = 'wakaUnknownBefore(); var asm=wakaUnknownAfter(global,env,buffer)\n'
-
-      with temp_files.get_file('.cl.js') as cle:
-        c = open(cle, 'w')
-        pre_1, pre_2 = pre.split(start_asm)
-        post_1, post_2 = post.split(end_asm)
-        c.write(pre_1)
-        c.write(cl_sep)
-        c.write(post_2)
-        c.close()
-        cld = cle
-        if split_memory:
-          if DEBUG: print('running splitMemory on shell code', file=sys.stderr)
-          cld = run_on_chunk(js_engine + [JS_OPTIMIZER, cld, 'splitMemoryShell'])
-          f = open(cld, 'a')
-          f.write(suffix_marker)
-          f.close()
-        if closure:
-          if DEBUG: print('running closure on shell code', file=sys.stderr)
-          cld = shared.Building.closure_compiler(cld, pretty='minifyWhitespace' not in passes)
-          temp_files.note(cld)
-        elif cleanup:
-          if DEBUG: print('running cleanup on shell code', file=sys.stderr)
-          next = cld + '.cl.js'
-          temp_files.note(next)
-          proc = subprocess.Popen(js_engine + [JS_OPTIMIZER, cld, 'noPrintMetadata', 'JSDCE'] + (['minifyWhitespace'] if 'minifyWhitespace' in passes else []), stdout=open(next, 'w'))
-          proc.communicate()
-          assert proc.returncode == 0
-          cld = next
-        coutput = open(cld).read()
-
-      coutput = coutput.replace('wakaUnknownBefore();', start_asm)
-      after = 'wakaUnknownAfter'
-      start = coutput.find(after)
-      end = coutput.find(')', start)
-      # First brace is from Closure Compiler comment, thus we need a second one
-      pre_2_second_brace = pre_2.find('{', pre_2.find('{')+1)
-      pre = coutput[:start] + '(/** @suppress {uselessCode} */ function(global,env,buffer) {\n' + pre_2[pre_2_second_brace+1:]
-      post = post_1 + end_asm + coutput[end+1:]
+    if shell_job:
+      pre, post = shell_job()
+    elif closure or cleanup or split_memory:
+      pre, post = run_on_shell(pre, post)
 
   with ToolchainProfiler.profile_block('write_pre'):
     filename += '.jo.js'
@@ -520,13 +810,24 @@ EMSCRIPTEN_FUNCS();
     if not just_concat:
       # sort functions by size, to make diffing easier and to improve aot times
       funcses = []
-      for out_file in filenames:
-        funcses.append(split_funcs(open(out_file).read(), False))
-      funcs = [item for sublist in funcses for item in sublist]
+      for output in outputs:
+        funcses.append(split_funcs(output, False))
+      funcs = [item for sublist in funcses for item in sublist] + cached_funcs
       funcses = None
+      cached_funcs = None
       if not os.environ.get('EMCC_NO_OPT_SORT'):
         funcs.sort(key=lambda x: (len(x[1]), x[0]), reverse=True)
 
+      function_order = shared.Settings.FUNCTION_ORDER
+      if function_order:
+        # hot functions first, in the order given, then the cold ones
+        if minify_globals:
+          function_order = [minify_info['globals'].get(name, name) for name in function_order]
+        positions = {}
+        for name in function_order:
+          positions.setdefault(name, len(positions))
+        funcs.sort(key=lambda x: positions.get(x[0], len(positions)))
+
       if 'last' in passes and len(funcs) > 0:
         count = funcs[0][1].count('\n')
         if count > 3000:
@@ -537,12 +838,14 @@ EMSCRIPTEN_FUNCS();
       funcs = None
     else:
       # just concat the outputs
-      for out_file in filenames:
-        f.write(open(out_file).read())
+      for output in outputs:
+        f.write(output)
 
   with ToolchainProfiler.profile_block('write_post'):
     f.write('\n')
     f.write(post);
+    if profiled_names is not None:
+      f.write('%s.names = %s;\n' % (profiler, json.dumps(profiled_names)))
     # No need to write suffix: if there was one, it is inside post which exists when suffix is there
     f.write('\n')
     f.close()
@@ -550,8 +853,8 @@ EMSCRIPTEN_FUNCS();
   return filename
 
 def run(filename, passes, js_engine=shared.NODE_JS, source_map=False, extra_info=None, just_split=False, just_concat=False):
-  if 'receiveJSON' in passes: just_split = True
-  if 'emitJSON' in passes: just_concat = True
+  if 'receiveJSON' in passes or 'receiveBinary' in passes: just_split = True
+  if 'emitJSON' in passes or 'emitBinary' in passes: just_concat = True
   js_engine = shared.listify(js_engine)
   with ToolchainProfiler.profile_block('js_optimizer.run_on_js'):
     return temp_files.run_and_clean(lambda: run_on_js(filename, passes, js_engine, source_map, extra_info, just_split, just_concat))
@@ -134,6 +134,7 @@ console.log = printErr;
 var lz4 = arguments_[0];
 var input = arguments_[1];
 var output = arguments_[2];
+var files = arguments_[3] ? JSON.parse(read(arguments_[3])) : undefined; // { start, end } of each file, to index them
 
 load(lz4);
 
@@ -144,7 +145,7 @@ if (!(data instanceof ArrayBuffer)) {
 }
 
 var start = Date.now();
-var compressedData = MiniLZ4.compressPackage(data);
+var compressedData = MiniLZ4.compressPackage(data, false, files);
 nodeFS['writeFileSync'](output, Buffer(compressedData.data));
 compressedData.data = null;
 printErr('compressed in ' + (Date.now() - start) + ' ms');
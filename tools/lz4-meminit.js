@@ -0,0 +1,62 @@
+// Compresses the segments of a memory initializer with LZ4, for MEM_INIT_COMPRESSION=2.
+//
+//   node lz4-meminit.js path/to/mini-lz4.js input output
+//
+// The input is the memory initializer as written for MEM_INIT_COMPRESSION=1, a sequence of segments of
+// [offset, length, data] (see JS.compress_memory_initializer in tools/shared.py). Each segment keeps its offset
+// and length, and its data becomes a sequence of blocks of up to BLOCK_SIZE bytes, each one stored as its
+// compressed size followed by the compressed data, or as 0 followed by the data itself if it did not compress.
+// Blocks are compressed independently, so they can be decoded straight into memory one after the other.
+
+var nodeFS = require('fs');
+
+var BLOCK_SIZE = 16384; // must match the decoder in src/postamble.js, and be less than 32K for MiniLZ4's hash table
+
+function assert(x, message) {
+  if (!x) throw 'assertion failed: ' + message;
+}
+
+eval(nodeFS.readFileSync(process.argv[2], 'utf8'));
+
+var input = new Uint8Array(nodeFS.readFileSync(process.argv[3]));
+// blocks are never stored larger than they are, but each adds 4 bytes, and each segment (of at least 9 bytes) at
+// least one block
+var output = new Uint8Array(input.length + Math.ceil(input.length / 2) + 4 * Math.ceil(input.length / BLOCK_SIZE) + 16);
+var pos = 0, outPos = 0;
+
+function readU32() {
+  var value = (input[pos] | (input[pos+1] << 8) | (input[pos+2] << 16) | (input[pos+3] << 24)) >>> 0;
+  pos += 4;
+  return value;
+}
+
+function writeU32(value) {
+  output[outPos++] = value & 0xff;
+  output[outPos++] = (value >> 8) & 0xff;
+  output[outPos++] = (value >> 16) & 0xff;
+  output[outPos++] = (value >> 24) & 0xff;
+}
+
+var compressed = new Uint8Array(MiniLZ4.compressBound(BLOCK_SIZE));
+while (pos < input.length) {
+  writeU32(readU32()); // offset
+  var length = readU32();
+  writeU32(length);
+  var end = pos + length;
+  while (pos < end) {
+    var block = input.subarray(pos, Math.min(pos + BLOCK_SIZE, end));
+    pos += block.length;
+    var size = MiniLZ4.compress(block, compressed);
+    if (size > 0 && size < block.length) {
+      writeU32(size);
+      output.set(compressed.subarray(0, size), outPos);
+      outPos += size;
+    } else {
+      writeU32(0);
+      output.set(block, outPos);
+      outPos += block.length;
+    }
+  }
+}
+
+nodeFS.writeFileSync(process.argv[4], Buffer.from(output.buffer, 0, outPos));
@@ -0,0 +1,177 @@
+
+"""Whole-program analysis of which invoke_* calls can be turned into direct calls.
+
+With exception catching enabled, a call that might throw is compiled into invoke_sig(index, ..), which
+calls the function at index in the function table through a JS try/catch, and so is every call in a
+function that calls setjmp, as longjmp throws too. If the function cannot throw, the invoke is pure
+overhead, so we find the functions that can throw, starting from the imports that do (___cxa_throw,
+longjmp and others) and following the call graph back to their callers, and the remaining targets of
+invokes can be called directly (see removeNothrowInvokes in tools/js-optimizer.js).
+
+Imports are JS, and a JS function can throw, or call back into compiled code which can. We look at the
+source of each imported JS function, and assume it can throw if it throws something other than a string
+(abort() and the like throw strings, which invokes do not catch anyway), calls into compiled code through
+a function pointer, or calls anything that we cannot follow.
+"""
+
+from __future__ import print_function
+import json, logging, re, sys
+
+from . import shared
+from .asm_module import AsmModule
+
+# Imports whose JS is known not to throw C++ exceptions, or known to throw them, regardless of what scanning
+# their source would say: the runtime of exception handling itself.
+KNOWN_NOTHROW = set(['abort', 'assert', '___cxa_allocate_exception', '___cxa_begin_catch', '___cxa_end_catch',
+                     '___cxa_free_exception', '___cxa_get_exception_ptr', '___gxx_personality_v0', 'setThrew'])
+KNOWN_THROW = set(['___cxa_throw', '___cxa_rethrow', '___resumeException', '___cxa_call_unexpected',
+                   '_emscripten_longjmp', '_longjmp', '_emscripten_longjmp_jmpbuf'])
+
+# Global functions of JS that JS library code calls, and that do not call back into compiled code.
+JS_GLOBALS = set(['assert', 'abort', 'parseInt', 'parseFloat', 'isNaN', 'isFinite', 'String', 'Number', 'Boolean',
+                  'Array', 'Object', 'Date', 'Error', 'RegExp', 'Symbol', 'encodeURIComponent', 'decodeURIComponent',
+                  'escape', 'unescape', 'setTimeout', 'clearTimeout', 'setInterval', 'clearInterval', 'ArrayBuffer',
+                  'SharedArrayBuffer', 'DataView', 'Int8Array', 'Uint8Array', 'Uint8ClampedArray', 'Int16Array',
+                  'Uint16Array', 'Int32Array', 'Uint32Array', 'Float32Array', 'Float64Array', 'TextDecoder',
+                  'TextEncoder', 'require', 'out', 'err'])
+JS_KEYWORDS = set(['if', 'for', 'while', 'switch', 'catch', 'function', 'return', 'typeof', 'new', 'with', 'do',
+                   'delete', 'void', 'in', 'instanceof', 'throw', 'else', 'case'])
+
+# Things in JS that call back into compiled code without us being able to tell what they call.
+UNKNOWN_CALL_PATTERN = re.compile(r'dynCall|invoke_|ASM_CONSTS|\beval\(|\bccall\(|\bcwrap\(|' +
+                                  r'Module\[[\'"](asm|dynCall|ccall|cwrap)|\basm\[|' +
+                                  r'(?<!fromCharCode)(?<!slice)(?<!hasOwnProperty)(?<!push)\.(apply|call)\(')
+NON_STRING_THROW_PATTERN = re.compile(r'\bthrow\s+(?![\'"])')
+IDENTIFIER_CALL_PATTERN = re.compile(r'(?<![\w$.])([A-Za-z_$][\w$]*)\s*\(')
+MODULE_CALL_PATTERN = re.compile(r'Module\[[\'"]([\w$]+)[\'"]\]\s*\(')
+FUNCTION_PATTERN = re.compile(r'^function ([\w$]+)\(', re.M)
+INVOKE_PATTERN = re.compile(r'\b(invoke_\w+)\((\d+)\b')
+
+
+def split_js_functions(js):
+  """Returns a map of the top-level function declarations in some JS to their source."""
+  ret = {}
+  for m in FUNCTION_PATTERN.finditer(js):
+    end = js.find('\n}', m.end())
+    if end < 0: continue
+    ret[m.group(1)] = js[m.end():end]
+  return ret
+
+
+def find_nothrow_invokes(filename):
+  """Returns, for each invoke_* in the asm.js module in filename, a map of the indexes it is called with to
+  the functions at them that cannot throw."""
+  with shared.ToolchainProfiler.profile_block('find_nothrow_invokes'):
+    temp = shared.configuration.get_temp_files().get('.js').name
+    shared.Building.js_optimizer(filename, ['asm', 'dumpCallGraph'], output_filename=temp, just_concat=True)
+    asm = AsmModule(temp)
+
+    exports = {}
+    for export in asm.exports:
+      if ':' in export:
+        key, value = export.split(':', 1)
+        exports[key.strip()] = value.strip()
+
+    # calls of each function in the asm.js module. invokes catch everything, so they are not edges.
+    can_call = {}
+    for line in asm.funcs_js.split('\n'):
+      if line.startswith('// REACHABLE '):
+        curr = json.loads(line[len('// REACHABLE '):])
+        can_call[curr[0]] = set([target for target in curr[2] if not target.startswith('invoke_')])
+    # an indirect call can reach anything in its table
+    table_funcs = {}
+    for name, funcs in asm.tables.items():
+      table_funcs[name] = [x.strip() for x in funcs[1:-1].split(',')]
+      can_call[name] = set(table_funcs[name])
+
+    # imports, and the JS functions they call, which we follow by their source
+    js_funcs = split_js_functions(asm.pre_js)
+    js_funcs.update(split_js_functions(asm.post_js))
+
+    def js_calls(name):
+      if name in KNOWN_NOTHROW: return set()
+      if name in KNOWN_THROW: return None
+      if name.startswith('Math_') or name.startswith('nullFunc_') or name.startswith('___cxa_find_matching_catch'): return set()
+      source = js_funcs.get(name)
+      if source is None: return None # not a function we know, like an import of a value
+      if NON_STRING_THROW_PATTERN.search(source) or UNKNOWN_CALL_PATTERN.search(source): return None
+      local_funcs = set(re.findall(r'function\s+([\w$]+)\s*\(', source))
+      calls = set()
+      for m in IDENTIFIER_CALL_PATTERN.finditer(source):
+        callee = m.group(1)
+        if callee in JS_KEYWORDS or callee in JS_GLOBALS or callee in local_funcs: continue
+        if callee in exports:
+          calls.add(exports[callee])
+        elif callee in js_funcs or callee in can_call:
+          calls.add(callee)
+        elif source[max(m.start() - 4, 0):m.start()] == 'new ':
+          continue # constructing a JS object
+        else:
+          return None # calling something we cannot follow, like a callback passed in
+      for m in MODULE_CALL_PATTERN.finditer(source):
+        if m.group(1) in exports:
+          calls.add(exports[m.group(1)])
+      return calls
+
+    # every function that calls something that may throw may throw too, which we propagate from the roots,
+    # noting through what for the report
+    callers = {}
+    throws = {}
+    to_check = []
+    pending = list(can_call.keys())
+    seen = set(pending)
+    while pending:
+      func = pending.pop()
+      targets = can_call.get(func)
+      if targets is None:
+        targets = js_calls(func)
+        if targets is None:
+          throws[func] = func
+          to_check.append(func)
+          continue
+      for target in targets:
+        callers.setdefault(target, set()).add(func)
+        if target not in seen:
+          seen.add(target)
+          pending.append(target)
+    while to_check:
+      func = to_check.pop()
+      for caller in callers.get(func, ()):
+        if caller not in throws:
+          throws[caller] = throws[func]
+          to_check.append(caller)
+
+    # the invokes to replace
+    nothrow_invokes = {}
+    total = 0
+    removed = 0
+    throwing_targets = {}
+    for m in INVOKE_PATTERN.finditer(asm.funcs_js):
+      total += 1
+      invoke, index = m.group(1), int(m.group(2))
+      table = table_funcs.get('FUNCTION_TABLE_' + invoke[len('invoke_'):])
+      if not table: continue
+      func = table[index & (len(table) - 1)]
+      if func in throws:
+        throwing_targets[func] = throwing_targets.get(func, 0) + 1
+        continue
+      nothrow_invokes.setdefault(invoke, {})[str(index)] = func
+      removed += 1
+
+    shared.try_delete(temp)
+
+  logging.debug('removing %d of %d invokes', removed, total)
+  if shared.Settings.REMOVE_NOTHROW_INVOKES == 2:
+    print_report(total, removed, len(asm.funcs), len([func for func in throws if func in asm.funcs]),
+                 [(func, count, throws[func]) for func, count in throwing_targets.items()], sys.stderr)
+  return nothrow_invokes
+
+
+def print_report(total, removed, funcs, throwing_funcs, throwing_targets, out):
+  print('nothrow invokes: removed %d of %d invokes (%.1f%%); %d of %d functions may throw' %
+        (removed, total, 100.0 * removed / max(total, 1), throwing_funcs, funcs), file=out)
+  throwing_targets = sorted(throwing_targets, key=lambda t: (-t[1], t[0]))
+  if throwing_targets:
+    print('most invoked functions that may throw, and what they may throw through:', file=out)
+    for func, count, root in throwing_targets[:20]:
+      print('  %6d  %s  (%s)' % (count, func, root), file=out)
@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <set>
+#include <mutex>
 
 #include <string.h>
 #include <stdint.h>
@@ -15,56 +16,129 @@
 
 namespace cashew {
 
-struct IString {
-  const char *str;
+// The table of all interned strings. It uses open addressing with linear
+// probing, and each slot keeps the hash of its string next to the pointer, so
+// probing rarely needs to compare characters. The strings themselves are
+// copied into large blocks, each one preceded by its hash, which lets an
+// IString find its hash later without hashing again.
+class IStringTable {
+  struct Slot {
+    const char *str;
+    uint32_t hash;
+  };
+
+  Slot *slots;
+  size_t mask; // capacity - 1, where capacity is a power of 2
+  size_t count;
+
+  char *block;
+  size_t blockLeft;
+  static const size_t BLOCK_SIZE = 64*1024;
 
-  static size_t hash_c(const char *str) { // see http://www.cse.yorku.ca/~oz/hash.html
-    unsigned int hash = 5381;
-    int c;
-    while ((c = *str++)) {
-      hash = ((hash << 5) + hash) ^ c;
+  std::mutex mutex; // passes may intern new names from several threads
+
+  IStringTable() : mask(1023), count(0), block(nullptr), blockLeft(0) {
+    slots = (Slot*)calloc(mask + 1, sizeof(Slot));
+  }
+
+  const char *copy(const char *s, size_t len, uint32_t hash) {
+    size_t size = sizeof(uint32_t) + len + 1;
+    size = (size + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1);
+    char *mem;
+    if (size > BLOCK_SIZE / 4) {
+      mem = (char*)malloc(size); // very long strings get their own allocation
+    } else {
+      if (size > blockLeft) {
+        block = (char*)malloc(BLOCK_SIZE);
+        blockLeft = BLOCK_SIZE;
+      }
+      mem = block;
+      block += size;
+      blockLeft -= size;
     }
-    return (size_t)hash;
+    memcpy(mem, &hash, sizeof(uint32_t));
+    char *ret = mem + sizeof(uint32_t);
+    memcpy(ret, s, len);
+    ret[len] = 0;
+    return ret;
   }
 
-  class CStringHash : public std::hash<const char *> {
-  public:
-    size_t operator()(const char *str) const {
-      return IString::hash_c(str);
+  void grow() {
+    size_t oldCapacity = mask + 1;
+    Slot *old = slots;
+    mask = oldCapacity * 2 - 1;
+    slots = (Slot*)calloc(mask + 1, sizeof(Slot));
+    for (size_t i = 0; i < oldCapacity; i++) {
+      if (!old[i].str) continue;
+      size_t j = old[i].hash & mask;
+      while (slots[j].str) j = (j + 1) & mask;
+      slots[j] = old[i];
     }
-  };
-  class CStringEqual : public std::equal_to<const char *> {
-  public:
-    bool operator()(const char *x, const char *y) const {
-      return strcmp(x, y) == 0;
+    free(old);
+  }
+
+public:
+  static IStringTable& get() {
+    static IStringTable* table = new IStringTable(); // never freed, as IStrings live forever
+    return *table;
+  }
+
+  // FNV-1a, which mixes well enough for linear probing
+  static uint32_t hash(const char *s, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+      hash ^= (unsigned char)s[i];
+      hash *= 16777619u;
     }
-  };
+    return hash;
+  }
+
+  // Returns the interned copy of the len characters at s, which need not be
+  // null-terminated
+  const char *intern(const char *s, size_t len) {
+    uint32_t h = hash(s, len);
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t i = h & mask;
+    while (slots[i].str) {
+      if (slots[i].hash == h && !strncmp(slots[i].str, s, len) && slots[i].str[len] == 0) {
+        return slots[i].str;
+      }
+      i = (i + 1) & mask;
+    }
+    const char *ret = copy(s, len, h);
+    slots[i].str = ret;
+    slots[i].hash = h;
+    if (++count * 2 > mask) grow(); // keep the load factor at most 1/2
+    return ret;
+  }
+};
+
+struct IString {
+  const char *str;
 
   IString() : str(nullptr) {}
-  IString(const char *s, bool reuse=true) { // if reuse=true, then input is assumed to remain alive; not copied
+  IString(const char *s) {
     assert(s);
-    set(s, reuse);
+    set(s);
+  }
+  IString(const char *s, const char *end) { // interns the characters in [s, end)
+    set(s, end);
   }
 
-  void set(const char *s, bool reuse=true) {
-    typedef std::unordered_set<const char *, CStringHash, CStringEqual> StringSet;
-    static StringSet* strings = new StringSet();
+  void set(const char *s) {
+    str = IStringTable::get().intern(s, strlen(s));
+  }
 
-    if (reuse) {
-      auto result = strings->insert(s); // if already present, does nothing
-      str = *(result.first);
-    } else {
-      auto existing = strings->find(s);
-      if (existing == strings->end()) {
-        char *copy = (char*)malloc(strlen(s)+1); // XXX leaked
-        strcpy(copy, s);
-        s = copy;
-      } else {
-        s = *existing;
-      }
-      strings->insert(s);
-      str = s;
-    }
+  void set(const char *s, const char *end) {
+    str = IStringTable::get().intern(s, end - s);
+  }
+
+  // The hash of the string contents, which was computed when it was interned
+  uint32_t hash() const {
+    if (!str) return 0;
+    uint32_t ret;
+    memcpy(&ret, str - sizeof(uint32_t), sizeof(uint32_t));
+    return ret;
   }
 
   void set(const IString &s) {
@@ -110,8 +184,7 @@ namespace std {
 
 template <> struct hash<cashew::IString> : public unary_function<cashew::IString, size_t> {
   size_t operator()(const cashew::IString& str) const {
-    size_t hash = size_t(str.str);
-    return hash = ((hash << 5) + hash) ^ 5381; /* (hash * 33) ^ c */
+    return str.hash(); // precomputed, so sets and maps of IStrings never hash characters
   }
 };
 
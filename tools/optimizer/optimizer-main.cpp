@@ -13,51 +13,318 @@
 
 #include <string.h> // only use this for param checking
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
 using namespace cashew;
 
-int main(int argc, char **argv) {
+// Whether to parse, optimize and print one toplevel element at a time, set by
+// the stream directive
+bool stream = false;
+
+// Where to write per-pass statistics, set by the passStats=FILE directive
+std::string passStatsFile;
+
+// What one pass (or parsing, or printing) did, summed over the functions or
+// elements it ran on. time is wall time in seconds, on each of threads threads.
+// arenaBytes is the most memory the AST arenas held when it finished.
+struct PassStats {
+  std::string name;
+  bool ran = false;
+  int threads = 1;
+  double time = 0;
+  size_t nodesBefore = 0, nodesAfter = 0, arenaBytes = 0;
+};
+
+double passStatsStart; // seconds since the epoch
+std::vector<PassStats> passStats;
+std::mutex passStatsMutex;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t countNodes(Ref ast) {
+  size_t count = 0;
+  traversePre(ast, [&count](Ref node) {
+    count++;
+  });
+  return count;
+}
+
+// Runs a single pass. Returns false if the argument is a directive and not a
+// pass that does any work.
+bool runPass(const std::string& str, Ref ast) {
+  if (str == "asm") return false; // the default for us
+  else if (str == "asmPreciseF32") return false;
+  else if (str == "receiveJSON" || str == "emitJSON") return false;
+  else if (str == "receiveBinary" || str == "emitBinary") return false;
+  else if (str == "eliminateDeadFuncs") eliminateDeadFuncs(ast);
+  else if (str == "pruneFunctions") pruneFunctions(ast);
+  else if (str == "eliminate") eliminate(ast);
+  else if (str == "eliminateMemSafe") eliminateMemSafe(ast);
+  else if (str == "simplifyExpressions") simplifyExpressions(ast);
+  else if (str == "optimizeFrounds") optimizeFrounds(ast);
+  else if (str == "simplifyIfs") simplifyIfs(ast);
+  else if (str == "registerize") registerize(ast);
+  else if (str == "registerizeHarder") registerizeHarder(ast);
+  else if (str == "minifyLocals") minifyLocals(ast);
+  else if (str == "minifyWhitespace") return false;
+  else if (str == "asmLastOpts") asmLastOpts(ast);
+  else if (str == "inlineSmallFunctions") inlineSmallFunctions(ast);
+  else if (str == "hoistLoopInvariants") hoistLoopInvariants(ast);
+  else if (str == "localCSE") localCSE(ast);
+  else if (str == "instrumentFunctionOrder") instrumentFunctionOrder(ast);
+  else if (str == "instrumentShadowStack") instrumentShadowStack(ast);
+  else if (str == "devirtualize") devirtualize(ast);
+  else if (str == "outline") outline(ast);
+  else if (str == "minifyGlobals") minifyGlobals(ast);
+  else if (str == "findReachable") findReachable(ast);
+  else if (str == "dumpCallGraph") dumpCallGraph(ast);
+  else if (str == "safeHeap") safeHeap(ast);
+  else if (str == "safeHeapSkipRedundant") safeHeap(ast, true);
+  else if (str == "splitMemory") splitMemory(ast);
+  else if (str == "last") return false;
+  else if (str == "noop") return false;
+  else if (str == "stream") return false;
+  else if (str.compare(0, 8, "threads=") == 0) return false;
+  else if (str.compare(0, 10, "passStats=") == 0) return false;
+  else {
+    fprintf(stderr, "unrecognized argument: %s\n", str.c_str());
+    abort();
+  }
+  return true;
+}
+
+// Runs a pass, adding what it did to stats if they are being collected
+bool runPass(const std::string& str, Ref ast, PassStats* stats) {
+  if (!stats) return runPass(str, ast);
+  size_t before = countNodes(ast);
+  auto start = std::chrono::steady_clock::now();
+  bool worked = runPass(str, ast);
+  stats->time += secondsSince(start);
+  stats->ran = stats->ran || worked;
+  stats->nodesBefore += before;
+  stats->nodesAfter += countNodes(ast);
+  stats->arenaBytes = std::max(stats->arenaBytes, arena.reservedBytes());
+  return worked;
+}
+
+// Stats for each pass, plus one for parsing and one for printing, if they are
+// being collected
+std::vector<PassStats> makePassStats(const std::vector<std::string>& passes) {
+  std::vector<PassStats> ret;
+  if (passStatsFile.empty()) return ret;
+  ret.resize(passes.size() + 2);
+  ret[0].name = "parse";
+  for (size_t i = 0; i < passes.size(); i++) ret[i + 1].name = passes[i];
+  ret.back().name = "print";
+  ret[0].ran = ret.back().ran = true;
+  return ret;
+}
+
+// Adds stats collected on a thread to the totals
+void mergePassStats(const std::vector<PassStats>& stats) {
+  std::lock_guard<std::mutex> lock(passStatsMutex);
+  if (passStats.empty()) {
+    passStats = stats;
+    return;
+  }
+  for (size_t i = 0; i < stats.size(); i++) {
+    PassStats& total = passStats[i];
+    total.ran = total.ran || stats[i].ran;
+    total.time += stats[i].time;
+    total.nodesBefore += stats[i].nodesBefore;
+    total.nodesAfter += stats[i].nodesAfter;
+    total.arenaBytes += stats[i].arenaBytes;
+  }
+}
+
+void writePassStats() {
+  std::ofstream out(passStatsFile.c_str());
+  assert(out);
+  out << "{\"pid\": " << getpid() << ", \"start\": " << std::fixed << std::setprecision(3) << passStatsStart << ", \"passes\": [";
+  bool first = true;
+  for (auto& stats : passStats) {
+    if (!stats.ran) continue; // directives
+    if (!first) out << ", ";
+    first = false;
+    out << "{\"name\": \"" << stats.name << "\", \"threads\": " << stats.threads << std::setprecision(6) << ", \"time\": " << stats.time <<
+           ", \"nodesBefore\": " << stats.nodesBefore << ", \"nodesAfter\": " << stats.nodesAfter << ", \"arenaBytes\": " << stats.arenaBytes << "}";
+  }
+  out << "]}\n";
+}
+
+// Passes that only look at and modify one function at a time, and so can be
+// run on different functions in parallel, and the directives that allow that.
+// --function-local-passes prints them, and a test checks that they are the
+// NATIVE_FUNCTION_LOCAL_PASSES of tools/js_optimizer.py.
+static const char* functionLocalPasses[] = {
+  "asm", "asmPreciseF32", "receiveJSON", "emitJSON", "receiveBinary", "emitBinary", "minifyWhitespace", "last", "noop",
+  "eliminate", "eliminateMemSafe", "simplifyExpressions", "simplifyIfs", "registerize", "registerizeHarder",
+  "minifyLocals", "asmLastOpts", "hoistLoopInvariants", "localCSE", "instrumentFunctionOrder", "instrumentShadowStack",
+  "devirtualize", "safeHeap", "safeHeapSkipRedundant", "splitMemory"
+};
+
+bool isFunctionLocal(const std::string& str) {
+  // directives about how to run the passes
+  if (str == "stream" || str.compare(0, 8, "threads=") == 0 || str.compare(0, 10, "passStats=") == 0) return true;
+  for (auto pass : functionLocalPasses) {
+    if (str == pass) return true;
+  }
+  return false;
+}
+
+// Runs all the passes on each function, with functions handed out to a pool
+// of threads. The output is the same as when running each pass on the whole
+// document in turn, as the passes are all function-local. The biggest
+// functions are handed out first, so that one does not start last and keep a
+// thread busy long after the others are done.
+void runPassesInParallel(Ref doc, const std::vector<std::string>& passes) {
+  std::vector<std::pair<size_t, Ref>> sized;
+  traverseFunctions(doc, [&sized](Ref func) {
+    sized.emplace_back(countNodes(func), func);
+  });
+  std::stable_sort(sized.begin(), sized.end(), [](const std::pair<size_t, Ref>& a, const std::pair<size_t, Ref>& b) {
+    return a.first > b.first;
+  });
+  std::vector<Ref> funcs;
+  for (auto& pair : sized) funcs.push_back(pair.second);
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    std::vector<PassStats> stats = makePassStats(passes);
+    while (1) {
+      size_t i = next++;
+      if (i >= funcs.size()) break;
+      for (size_t j = 0; j < passes.size(); j++) runPass(passes[j], funcs[i], stats.empty() ? nullptr : &stats[j + 1]);
+    }
+    if (!stats.empty()) {
+      for (size_t j = 0; j < passes.size(); j++) stats[j + 1].threads = numThreads;
+      mergePassStats(stats);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < numThreads; i++) threads.emplace_back(work);
+  work();
+  for (auto& thread : threads) thread.join();
+}
+
+// Parses, optimizes and prints one toplevel element at a time, freeing each
+// one's nodes once it is printed, so memory use is bounded by the largest
+// function and not the whole input. The output is the same as printing the
+// whole document at the end.
+void runPassesStreaming(char* input, const std::vector<std::string>& passes) {
+  cashew::Parser<Ref, ValueBuilder> builder;
+  builder.startToplevel(input);
+  char* curr = input;
+  bool first = true;
+  std::vector<PassStats> stats = makePassStats(passes);
+  while (1) {
+    ArenaScope scope;
+    auto start = std::chrono::steady_clock::now();
+    Ref element = builder.parseToplevelElement(curr);
+    if (!element) break;
+    Ref doc = ValueBuilder::makeToplevel();
+    doc[1]->push_back(element);
+    if (!stats.empty()) {
+      stats[0].time += secondsSince(start);
+      stats[0].nodesAfter += countNodes(doc);
+      stats[0].arenaBytes = std::max(stats[0].arenaBytes, arena.reservedBytes());
+    }
+    for (size_t i = 0; i < passes.size(); i++) runPass(passes[i], doc, stats.empty() ? nullptr : &stats[i + 1]);
+    if (!stats.empty()) stats.back().nodesBefore += countNodes(doc);
+    start = std::chrono::steady_clock::now();
+    JSPrinter jser(!minifyWhitespace, last, doc);
+    jser.printAst();
+    if (jser.used > 0) {
+      if (!first && !minifyWhitespace) std::cout << "\n"; // printStats puts a newline between statements
+      first = false;
+      std::cout << jser.buffer;
+    }
+    free(jser.buffer);
+    if (!stats.empty()) {
+      stats.back().time += secondsSince(start);
+      stats.back().arenaBytes = std::max(stats.back().arenaBytes, arena.reservedBytes());
+    }
+  }
+  std::cout << "\n";
+  if (!stats.empty()) mergePassStats(stats);
+}
+
+// Restores the directives and the rest of the state that a run of the
+// optimizer leaves behind, so that the server starts each run from scratch
+void resetState() {
+  preciseF32 = receiveJSON = emitJSON = receiveBinary = emitBinary = minifyWhitespace = last = false;
+  stream = false;
+  numThreads = 1;
+  passStatsFile.clear();
+  passStats.clear();
+  extraInfo = outputInfo = Ref();
+  ASM_FLOAT_ZERO = IString();
+}
+
+// Runs the passes and directives on the input, which is null-terminated, and
+// prints the result to std::cout
+void optimize(char *input, const std::vector<std::string>& passes) {
   // Read directives
-  for (int i = 2; i < argc; i++) {
-    std::string str(argv[i]);
+  bool allFunctionLocal = true;
+  for (auto& str : passes) {
+    if (!isFunctionLocal(str)) allFunctionLocal = false;
     if (str == "asm") {} // the only possibility for us
     else if (str == "asmPreciseF32") preciseF32 = true;
     else if (str == "receiveJSON") receiveJSON = true;
     else if (str == "emitJSON") emitJSON = true;
+    else if (str == "receiveBinary") receiveBinary = true;
+    else if (str == "emitBinary") emitBinary = true;
     else if (str == "minifyWhitespace") minifyWhitespace = true;
     else if (str == "last") last = true;
+    else if (str == "stream") stream = true;
+    else if (str.compare(0, 8, "threads=") == 0) {
+      numThreads = atoi(str.c_str() + 8);
+      if (numThreads <= 0) numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    else if (str.compare(0, 10, "passStats=") == 0) passStatsFile = str.substr(10);
   }
 
-#ifdef PROFILING
-    std::string str("reading and parsing");
-    clock_t start = clock();
-    errv("starting %s", str.c_str());
-#endif
+  passStatsStart = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+  auto start = std::chrono::steady_clock::now();
 
-  // Read input file
-  FILE *f = fopen(argv[1], "r");
-  assert(f);
-  fseek(f, 0, SEEK_END);
-  int size = ftell(f);
-  char *input = new char[size+1];
-  rewind(f);
-  int num = fread(input, 1, size, f);
-  // On Windows, ftell() gives the byte position (\r\n counts as two bytes), but when
-  // reading, fread() returns the number of characters read (\r\n is read as one char \n, and counted as one),
-  // so return value of fread can be less than size reported by ftell, and that is normal.
-  assert((num > 0 || size == 0) && num <= size);
-  fclose(f);
-  input[num] = 0;
+  // A binary AST is read first, as it is followed by the usual text
+  Ref doc;
+  char *afterDoc = input;
+  if (receiveBinary) doc = parseBinaryAst(afterDoc);
 
-  char *extraInfoStart = strstr(input, "// EXTRA_INFO:");
+  char *extraInfoStart = strstr(afterDoc, "// EXTRA_INFO:");
   if (extraInfoStart) {
     extraInfo = arena.alloc();
     extraInfo->parse(extraInfoStart + 14);
     *extraInfoStart = 0; // ignore extra info when parsing
   }
 
-  Ref doc;
+  // Streaming only makes sense when each element can be handled on its own, and
+  // running on threads needs the whole document at once
+  if (stream && allFunctionLocal && !receiveJSON && !emitJSON && !receiveBinary && !emitBinary && numThreads <= 1) {
+    runPassesStreaming(input, passes);
+    if (!passStatsFile.empty()) writePassStats();
+    return;
+  }
 
-  if (receiveJSON) {
+  if (receiveBinary) {
+    // already parsed
+  } else if (receiveJSON) {
     // Parse JSON source into the document
     doc = arena.alloc();
     doc->parse(input);
@@ -65,54 +332,38 @@ int main(int argc, char **argv) {
     cashew::Parser<Ref, ValueBuilder> builder;
     doc = builder.parseToplevel(input);
   }
-  // do not free input, its contents are used as strings
 
-#ifdef PROFILING
-    errv("    %s took %lu milliseconds", str.c_str(), (clock() - start)/1000);
-#endif
+  // Reading the binary AST and the extra info counts as parsing
+  std::vector<PassStats> stats = makePassStats(passes);
+  if (!stats.empty()) {
+    stats[0].time = secondsSince(start);
+    stats[0].nodesAfter = countNodes(doc);
+    stats[0].arenaBytes = arena.reservedBytes();
+  }
 
   // Run passes on the Document
-  for (int i = 2; i < argc; i++) {
-    std::string str(argv[i]);
-#ifdef PROFILING
-    clock_t start = clock();
-    errv("starting %s", str.c_str());
-#endif
-    bool worked = true;
-    if (str == "asm") { worked = false; } // the default for us
-    else if (str == "asmPreciseF32") { worked = false; }
-    else if (str == "receiveJSON" || str == "emitJSON") { worked = false; }
-    else if (str == "eliminateDeadFuncs") eliminateDeadFuncs(doc);
-    else if (str == "eliminate") eliminate(doc);
-    else if (str == "eliminateMemSafe") eliminateMemSafe(doc);
-    else if (str == "simplifyExpressions") simplifyExpressions(doc);
-    else if (str == "optimizeFrounds") optimizeFrounds(doc);
-    else if (str == "simplifyIfs") simplifyIfs(doc);
-    else if (str == "registerize") registerize(doc);
-    else if (str == "registerizeHarder") registerizeHarder(doc);
-    else if (str == "minifyLocals") minifyLocals(doc);
-    else if (str == "minifyWhitespace") { worked = false; }
-    else if (str == "asmLastOpts") asmLastOpts(doc);
-    else if (str == "last") { worked = false; }
-    else if (str == "noop") { worked = false; }
-    else {
-      fprintf(stderr, "unrecognized argument: %s\n", str.c_str());
-      abort();
-    }
-#ifdef PROFILING
-    errv("    %s took %lu milliseconds", str.c_str(), (clock() - start)/1000);
-#endif
+  if (numThreads > 1 && allFunctionLocal) {
+    runPassesInParallel(doc, passes);
+  } else {
+    for (size_t i = 0; i < passes.size(); i++) {
+      const std::string& str = passes[i];
+      bool worked = runPass(str, doc, stats.empty() ? nullptr : &stats[i + 1]);
 #ifdef DEBUGGING
-    if (worked) {
-      std::cerr << "ast after " << str << ":\n";
-      doc->stringify(std::cerr);
-      std::cerr << "\n";
-    }
+      if (worked) {
+        std::cerr << "ast after " << str << ":\n";
+        doc->stringify(std::cerr);
+        std::cerr << "\n";
+      }
 #endif
+    }
   }
 
   // Emit
-  if (emitJSON) {
+  start = std::chrono::steady_clock::now();
+  if (emitBinary) {
+    stringifyBinaryAst(doc, std::cout);
+    std::cout << "\n";
+  } else if (emitJSON) {
     doc->stringify(std::cout);
     std::cout << "\n";
   } else {
@@ -120,6 +371,86 @@ int main(int argc, char **argv) {
     jser.printAst();
     std::cout << jser.buffer << "\n";
   }
-  return 0;
+  if (!!outputInfo) {
+    std::cout << "// EXTRA_INFO:";
+    outputInfo->stringify(std::cout);
+    std::cout << "\n";
+  }
+  if (!stats.empty()) {
+    stats.back().time = secondsSince(start);
+    stats.back().nodesBefore = countNodes(doc);
+    stats.back().arenaBytes = arena.reservedBytes();
+    mergePassStats(stats);
+    writePassStats();
+  }
 }
 
+// Runs one request after another, each read from stdin as a line with the
+// number of arguments, then the arguments (passes and directives) one per
+// line, then a line with the size of the input in bytes and the input itself.
+// Each reply is a line with the size of the output, then the output. This
+// saves starting a process and writing temp files for each chunk. Runs that
+// use threads= leave behind what the threads allocated, so they are better
+// done by a process of their own.
+void runServer() {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  char line[4096];
+  while (fgets(line, sizeof(line), stdin)) {
+    std::vector<std::string> passes(atoi(line));
+    for (auto& str : passes) {
+      if (!fgets(line, sizeof(line), stdin)) abort();
+      str = line;
+      str.erase(str.find_last_not_of("\r\n") + 1);
+    }
+    if (!fgets(line, sizeof(line), stdin)) abort();
+    size_t size = strtoul(line, nullptr, 10);
+    char *input = new char[size+1];
+    if (fread(input, 1, size, stdin) != size) abort();
+    input[size] = 0;
+    std::ostringstream output;
+    {
+      ArenaScope scope;
+      std::streambuf *old = std::cout.rdbuf(output.rdbuf());
+      optimize(input, passes);
+      std::cout.rdbuf(old);
+      resetState();
+    }
+    delete[] input; // strings in the AST were copied when interned
+    std::string str = output.str();
+    std::cout << str.size() << "\n" << str;
+    std::cout.flush();
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && strcmp(argv[1], "--server") == 0) {
+    runServer();
+    return 0;
+  }
+  if (argc == 2 && strcmp(argv[1], "--function-local-passes") == 0) {
+    for (auto pass : functionLocalPasses) std::cout << pass << "\n";
+    return 0;
+  }
+
+  // Read input file
+  FILE *f = fopen(argv[1], "r");
+  assert(f);
+  fseek(f, 0, SEEK_END);
+  int size = ftell(f);
+  char *input = new char[size+1];
+  rewind(f);
+  int num = fread(input, 1, size, f);
+  // On Windows, ftell() gives the byte position (\r\n counts as two bytes), but when
+  // reading, fread() returns the number of characters read (\r\n is read as one char \n, and counted as one),
+  // so return value of fread can be less than size reported by ftell, and that is normal.
+  assert((num > 0 || size == 0) && num <= size);
+  fclose(f);
+  input[num] = 0;
+
+  optimize(input, std::vector<std::string>(argv + 2, argv + argc));
+  // do not free input, it is not worth the time when we are about to exit
+  return 0;
+}
@@ -1,4 +1,6 @@
 
+#include <mutex>
+
 #include "optimizer.h"
 
 using namespace cashew;
@@ -64,6 +66,8 @@ AsmType detectType(Ref node, AsmData *asmData, bool inVarDef) {
           return ASM_NONE;
         }
         // We are in a variable definition, where Math_fround(0) optimized into a global constant becomes f0 = Math_fround(0)
+        static std::mutex floatZeroMutex; // functions may be processed in parallel
+        std::lock_guard<std::mutex> lock(floatZeroMutex);
         if (ASM_FLOAT_ZERO.isNull()) ASM_FLOAT_ZERO = node[1]->getIString();
         else assert(node[1] == ASM_FLOAT_ZERO);
         return ASM_FLOAT;
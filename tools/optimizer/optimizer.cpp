@@ -4,6 +4,9 @@
 #include <string>
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
 
 #include "simple_ast.h"
 #include "optimizer.h"
@@ -18,6 +21,12 @@ typedef std::vector<IString> StringVec;
 
 Ref extraInfo;
 
+// Metadata a pass reports back together with its output
+Ref outputInfo;
+
+// Number of threads to run passes on, set by threads=N
+int numThreads = 1;
+
 //==================
 // Infrastructure
 //==================
@@ -581,6 +590,8 @@ int measureCost(Ref ast) {
 bool preciseF32 = false,
      receiveJSON = false,
      emitJSON = false,
+     receiveBinary = false,
+     emitBinary = false,
      minifyWhitespace = false,
      last = false;
 
@@ -631,7 +642,20 @@ StringSet BREAK_CAPTURERS("do while for switch"),
           CONTINUE_CAPTURERS("do while for"),
           FUNCTIONS_THAT_ALWAYS_THROW("abort ___resumeException ___cxa_throw ___cxa_rethrow");
 
-IString DCEABLE_TYPE_DECLS("__emscripten_dceable_type_decls");
+IString DCEABLE_TYPE_DECLS("__emscripten_dceable_type_decls"),
+        MATH_IMUL("Math_imul"),
+        FUNCTION_IDS("functionIds"),
+        PROFILE_FUNCTION_CALL("profileFunctionCall"),
+        SHADOW_STACK("shadowStack"),
+        SHADOW_STACK_DEPTH("ssd$"),
+        SHADOW_STACK_RESULT("ssr$"),
+        DEVIRTUALIZE("devirtualize"),
+        SIZE_TO_OUTLINE("sizeToOutline"),
+        STACKTOP("STACKTOP"),
+        SP("sp"),
+        OUTLINE_FRAME("of$"),
+        OUTLINE_CODE("oc$"),
+        OUTLINE_SCRATCH("os$");
 
 
 bool isFunctionTable(const char *name) {
@@ -2138,7 +2162,7 @@ IString getRegName(AsmType type, int num) {
   assert(written < size);
   temp[written] = 0;
   IString ret;
-  ret.set(temp, false);
+  ret.set(temp);
   return ret;
 }
 
@@ -2371,6 +2395,57 @@ void registerize(Ref ast) {
   });
 }
 
+// A set of local variable numbers, as a dense bitvector. registerizeHarder keeps
+// the live variables at each junction, and the conflicts of each variable, in
+// these, so that merging and comparing them costs a word per 64 locals.
+class LocalSet {
+  std::vector<uint64_t> words;
+
+public:
+  LocalSet() {}
+  explicit LocalSet(size_t size) : words((size + 63) / 64, 0) {}
+
+  bool has(size_t i) const {
+    return (words[i >> 6] >> (i & 63)) & 1;
+  }
+  void insert(size_t i) {
+    words[i >> 6] |= uint64_t(1) << (i & 63);
+  }
+  void erase(size_t i) {
+    words[i >> 6] &= ~(uint64_t(1) << (i & 63));
+  }
+  // Adds the members of other
+  void add(const LocalSet& other) {
+    for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i];
+  }
+  // Adds the members of other that are not in mask
+  void addExcept(const LocalSet& other, const LocalSet& mask) {
+    for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i] & ~mask.words[i];
+  }
+  size_t count() const {
+    size_t ret = 0;
+    for (auto word : words) ret += __builtin_popcountll(word);
+    return ret;
+  }
+  bool operator==(const LocalSet& other) const {
+    return words == other.words;
+  }
+  bool operator!=(const LocalSet& other) const {
+    return words != other.words;
+  }
+  // Calls f with each member, in increasing order
+  template<typename F>
+  void forEach(F f) const {
+    for (size_t i = 0; i < words.size(); i++) {
+      uint64_t word = words[i];
+      while (word) {
+        f((i << 6) + __builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  }
+};
+
 // Assign variables to 'registers', coalescing them onto a smaller number of shared
 // variables.
 //
@@ -2424,6 +2499,17 @@ void registerizeHarder(Ref ast) {
 
     AsmData asmData(fun);
 
+    // Number the locals, for the dense sets of them used in the analysis
+    size_t numLocals = asmData.locals.size();
+    std::unordered_map<IString, size_t> nameToNum;
+    std::vector<IString> numToName;
+    nameToNum.reserve(numLocals);
+    numToName.reserve(numLocals);
+    for (auto kv : asmData.locals) {
+      nameToNum[kv.first] = numToName.size();
+      numToName.push_back(kv.first);
+    }
+
 #ifdef PROFILING
     tasmdata += clock() - start;
     start = clock();
@@ -2465,8 +2551,8 @@ void registerizeHarder(Ref ast) {
     struct Junction {
       int id;
       std::set<int> inblocks, outblocks;
-      IOrderedStringSet live;
-      Junction(int id_) : id(id_) {}
+      LocalSet live;
+      Junction(int id_, size_t numLocals) : id(id_), live(numLocals) {}
     };
     struct Node {
     };
@@ -2477,13 +2563,21 @@ void registerizeHarder(Ref ast) {
       std::vector<bool> isexpr;
       StringIntMap use;
       StringSet kill;
+      LocalSet useSet, killSet; // use and kill, numbered
       StringStringMap link;
-      StringIntMap lastUseLoc;
       StringIntMap firstDeadLoc;
       StringIntMap firstKillLoc;
       StringIntMap lastKillLoc;
+      LocalSet liveOut;
+      int liveOutLoc;
+
+      Block() : id(-1), entry(-1), exit(-1), liveOutLoc(0) {}
 
-      Block() : id(-1), entry(-1), exit(-1) {}
+      int getFirstDeadLoc(IString name, size_t num) {
+        auto iter = firstDeadLoc.find(name);
+        if (iter != firstDeadLoc.end()) return iter->second;
+        return liveOut.has(num) ? liveOutLoc : 0;
+      }
     };
     struct ContinueBreak {
       int co, br;
@@ -2509,7 +2603,7 @@ void registerizeHarder(Ref ast) {
       // Create a new junction, without inserting it into the graph.
       // This is useful for e.g. pre-allocating an exit node.
       int id = junctions.size();
-      junctions.push_back(Junction(id));
+      junctions.push_back(Junction(id, numLocals));
       return id;
     };
 
@@ -3025,22 +3119,24 @@ void registerizeHarder(Ref ast) {
     // junction.  The outer phase uses this to try to eliminate redundant
     // stores in each basic block, which might in turn affect liveness info.
 
+    auto updateBlockSets = [&](Block* block) {
+      block->useSet = LocalSet(numLocals);
+      block->killSet = LocalSet(numLocals);
+      for (auto name : block->use) block->useSet.insert(nameToNum[name.first]);
+      for (auto name : block->kill) block->killSet.insert(nameToNum[name]);
+    };
+
     auto analyzeJunction = [&](Junction& junc) {
-      // Update the live set for this junction.
-      IOrderedStringSet live;
+      // Update the live set for this junction. Returns whether it changed.
+      LocalSet live(numLocals);
       for (auto b : junc.outblocks) {
         Block* block = blocks[b];
-        IOrderedStringSet& liveSucc = junctions[block->exit].live;
-        for (auto name : liveSucc) {
-          if (!block->kill.has(name)) {
-            live.insert(name);
-          }
-        }
-        for (auto name : block->use) {
-          live.insert(name.first);
-        }
+        live.addExcept(junctions[block->exit].live, block->killSet);
+        live.add(block->useSet);
       }
-      junc.live = live;
+      if (live == junc.live) return false;
+      std::swap(junc.live, live);
+      return true;
     };
 
     auto analyzeBlock = [&](Block* block) {
@@ -3050,39 +3146,42 @@ void registerizeHarder(Ref ast) {
       // to exit, possibly changing names via simple 'x=y' assignments.
       // As we go, we eliminate assignments if the variable is not
       // subsequently used.
-      auto live = junctions[block->exit].live;
+      // Variables live at the exit are used and dead at the end of the block,
+      // and link to themselves, unless the block says otherwise. That is left
+      // implicit, as there can be many more of them than nodes in the block.
+      block->liveOut = junctions[block->exit].live;
+      block->liveOutLoc = block->nodes.size();
+      LocalSet live = block->liveOut;
       StringIntMap use;
       StringSet kill;
       StringStringMap link;
+      StringSet unlinked;
       StringIntMap lastUseLoc;
       StringIntMap firstDeadLoc;
       StringIntMap firstKillLoc;
       StringIntMap lastKillLoc;
-      for (auto name : live) {
-        link[name] = name;
-        lastUseLoc[name] = block->nodes.size();
-        firstDeadLoc[name] = block->nodes.size();
-      }
       for (int j = block->nodes.size() - 1; j >= 0 ; j--) {
         Ref node = block->nodes[j];
         if (node[0] == NAME) {
           IString name = node[1]->getIString();
-          live.insert(name);
+          size_t num = nameToNum[name];
+          live.insert(num);
           use[name] = j;
-          if (lastUseLoc.count(name) == 0) {
+          if (lastUseLoc.count(name) == 0 && !block->liveOut.has(num)) {
             lastUseLoc[name] = j;
             firstDeadLoc[name] = j;
           }
         } else {
           IString name = node[2][1]->getIString();
+          size_t num = nameToNum[name];
           // We only keep assignments if they will be subsequently used.
-          if (live.has(name)) {
+          if (live.has(num)) {
             kill.insert(name);
             use.erase(name);
-            live.erase(name);
+            live.erase(num);
             firstDeadLoc[name] = j;
             firstKillLoc[name] = j;
-            if (lastUseLoc.count(name) == 0) {
+            if (lastUseLoc.count(name) == 0 && !block->liveOut.has(num)) {
               lastUseLoc[name] = j;
             }
             if (lastKillLoc.count(name) == 0) {
@@ -3091,9 +3190,11 @@ void registerizeHarder(Ref ast) {
             // If it's an "x=y" and "y" is not live, then we can create a
             // flow-through link from "y" to "x".  If not then there's no
             // flow-through link for "x".
-            if (link.has(name)) {
-              IString oldLink = link[name];
+            bool implicitLink = block->liveOut.has(num) && !unlinked.has(name);
+            if (link.has(name) || implicitLink) {
+              IString oldLink = link.has(name) ? link[name] : name;
               link.erase(name);
+              unlinked.insert(name);
               if (node[3][0] == NAME) {
                 if (asmData.isLocal(node[3][1]->getIString())) {
                   link[node[3][1]->getIString()] = oldLink;
@@ -3104,18 +3205,6 @@ void registerizeHarder(Ref ast) {
             // The result of this assignment is never used, so delete it.
             // We may need to keep the RHS for its value or its side-effects.
             auto removeUnusedNodes = [&](int j, int n) {
-              for (auto pair : lastUseLoc) {
-                pair.second -= n;
-              }
-              for (auto pair : firstKillLoc) {
-                pair.second -= n;
-              }
-              for (auto pair : lastKillLoc) {
-                pair.second -= n;
-              }
-              for (auto pair : firstDeadLoc) {
-                pair.second -= n;
-              }
               block->nodes.erase(block->nodes.begin() + j, block->nodes.begin() + j + n);
               block->isexpr.erase(block->isexpr.begin() + j, block->isexpr.begin() + j + n);
             };
@@ -3140,10 +3229,10 @@ void registerizeHarder(Ref ast) {
       block->use = use;
       block->kill = kill;
       block->link = link;
-      block->lastUseLoc = lastUseLoc;
       block->firstDeadLoc = firstDeadLoc;
       block->firstKillLoc = firstKillLoc;
       block->lastKillLoc = lastKillLoc;
+      updateBlockSets(block);
     };
 
     // Ordered map to work in approximate reverse order of junction appearance
@@ -3153,6 +3242,9 @@ void registerizeHarder(Ref ast) {
     // Be sure to visit every junction at least once.
     // This avoids missing some vars because we disconnected them
     // when processing the labelled jumps.
+    for (auto block : blocks) {
+      updateBlockSets(block);
+    }
     for (size_t i = EXIT_JUNCTION; i < junctions.size(); i++) {
       jWorkSet.insert(i);
       for (auto b : junctions[i].inblocks) {
@@ -3171,9 +3263,7 @@ void registerizeHarder(Ref ast) {
         --last;
         Junction& junc = junctions[*last];
         jWorkSet.erase(last);
-        IOrderedStringSet oldLive = junc.live; // copy it here, to check for changes later
-        analyzeJunction(junc);
-        if (oldLive != junc.live) {
+        if (analyzeJunction(junc)) {
           // Live set changed, updated predecessor blocks and junctions.
           for (auto b : junc.inblocks) {
             bWorkSet.insert(b);
@@ -3206,7 +3296,7 @@ void registerizeHarder(Ref ast) {
     // if they happen to be unused.
 
     for (auto name : asmData.params) {
-      junctions[ENTRY_JUNCTION].live.insert(name);
+      junctions[ENTRY_JUNCTION].live.insert(nameToNum[name]);
     }
 
     // For variables that are live at one or more junctions, we assign them
@@ -3216,32 +3306,24 @@ void registerizeHarder(Ref ast) {
     // (the "links").
 
     struct JuncVar {
-      std::vector<bool> conf;
+      LocalSet conf;
       IOrderedStringSet link;
       std::unordered_set<int> excl;
       int reg;
       bool used;
       JuncVar() : reg(-1), used(false) {}
     };
-    size_t numLocals = asmData.locals.size();
-    std::unordered_map<IString, size_t> nameToNum;
-    std::vector<IString> numToName;
-    nameToNum.reserve(numLocals);
-    numToName.reserve(numLocals);
-    for (auto kv : asmData.locals) {
-      nameToNum[kv.first] = numToName.size();
-      numToName.push_back(kv.first);
-    }
 
     std::vector<JuncVar> juncVars(numLocals);
     for (Junction& junc : junctions) {
-      for (IString name : junc.live) {
-        JuncVar& jVar = juncVars[nameToNum[name]];
-        jVar.used = true;
-        jVar.conf.assign(numLocals, false);
-      }
+      junc.live.forEach([&](size_t num) {
+        JuncVar& jVar = juncVars[num];
+        if (!jVar.used) {
+          jVar.used = true;
+          jVar.conf = LocalSet(numLocals);
+        }
+      });
     }
-    std::map<IString, std::vector<Block*>> possibleBlockConflictsMap;
     std::vector<std::pair<size_t, std::vector<Block*>>> possibleBlockConflicts;
     std::unordered_map<IString, std::vector<Block*>> possibleBlockLinks;
     possibleBlockConflicts.reserve(numLocals);
@@ -3250,53 +3332,51 @@ void registerizeHarder(Ref ast) {
     for (Junction& junc : junctions) {
       // Pre-compute the possible conflicts and links for each block rather
       // than checking potentially impossible options for each var
-      possibleBlockConflictsMap.clear();
       possibleBlockConflicts.clear();
       possibleBlockLinks.clear();
+      // Variables live at the exit of a successor block, but not here, are the
+      // ones that block assigns; we mark all live vars as conflicting later
+      LocalSet assigned(numLocals);
       for (auto b : junc.outblocks) {
-        Block* block = blocks[b];
-        Junction& jSucc = junctions[block->exit];
-        for (auto name : jSucc.live) {
-          possibleBlockConflictsMap[name].push_back(block);
+        assigned.addExcept(junctions[blocks[b]->exit].live, junc.live);
+      }
+      assigned.forEach([&](size_t num) {
+        std::vector<Block*> assigners;
+        for (auto b : junc.outblocks) {
+          if (junctions[blocks[b]->exit].live.has(num)) assigners.push_back(blocks[b]);
         }
+        possibleBlockConflicts.push_back(std::make_pair(num, std::move(assigners)));
+      });
+      for (auto b : junc.outblocks) {
+        Block* block = blocks[b];
         for (auto name_linkname : block->link) {
           if (name_linkname.first != name_linkname.second) {
             possibleBlockLinks[name_linkname.first].push_back(block);
           }
         }
       }
-      // Find the live variables in this block, mark them as unnecessary to
-      // check for conflicts (we mark all live vars as conflicting later)
       std::vector<size_t> liveJVarNums;
-      liveJVarNums.reserve(junc.live.size());
-      for (auto name : junc.live) {
-        size_t jVarNum = nameToNum[name];
+      junc.live.forEach([&](size_t jVarNum) {
         liveJVarNums.push_back(jVarNum);
-        possibleBlockConflictsMap.erase(name);
-      }
-      // Extract just the variables we might want to check for conflicts
-      for (auto kv : possibleBlockConflictsMap) {
-        possibleBlockConflicts.push_back(std::make_pair(nameToNum[kv.first], kv.second));
-      }
+      });
 
       for (size_t jVarNum : liveJVarNums) {
         JuncVar& jvar = juncVars[jVarNum];
         IString name = numToName[jVarNum];
         // It conflicts with all other names live at this junction.
-        for (size_t liveJVarNum : liveJVarNums) {
-          jvar.conf[liveJVarNum] = true;
-        }
-        jvar.conf[jVarNum] = false; // except for itself, of course
+        jvar.conf.add(junc.live);
+        jvar.conf.erase(jVarNum); // except for itself, of course
 
         // It conflicts with any output vars of successor blocks,
         // if they're assigned before it goes dead in that block.
-        for (auto jvarnum_blocks : possibleBlockConflicts) {
+        for (auto& jvarnum_blocks : possibleBlockConflicts) {
           size_t otherJVarNum = jvarnum_blocks.first;
+          if (jvar.conf.has(otherJVarNum)) continue; // already known
           IString otherName = numToName[otherJVarNum];
           for (auto block : jvarnum_blocks.second) {
-            if (block->lastKillLoc[otherName] < block->firstDeadLoc[name]) {
-              jvar.conf[otherJVarNum] = true;
-              juncVars[otherJVarNum].conf[jVarNum] = true;
+            if (block->lastKillLoc[otherName] < block->getFirstDeadLoc(name, jVarNum)) {
+              jvar.conf.insert(otherJVarNum);
+              juncVars[otherJVarNum].conf.insert(jVarNum);
               break;
             }
           }
@@ -3326,7 +3406,7 @@ void registerizeHarder(Ref ast) {
     for (size_t jVarNum = 0; jVarNum < juncVars.size(); jVarNum++) {
       JuncVar& jVar = juncVars[jVarNum];
       if (!jVar.used) continue;
-      jVarConfCounts[jVarNum] = std::count(jVar.conf.begin(), jVar.conf.end(), true);
+      jVarConfCounts[jVarNum] = jVar.conf.count();
       sortedJVarNums.push_back(jVarNum);
     }
     std::sort(sortedJVarNums.begin(), sortedJVarNums.end(), [&](const size_t vi1, const size_t vi2) {
@@ -3359,11 +3439,9 @@ void registerizeHarder(Ref ast) {
       }
       jv.reg = reg;
       // Exclude use of this register at all conflicting variables.
-      for (size_t confNameNum = 0; confNameNum < jv.conf.size(); confNameNum++) {
-        if (jv.conf[confNameNum]) {
-          juncVars[confNameNum].excl.insert(reg);
-        }
-      }
+      jv.conf.forEach([&](size_t confNameNum) {
+        juncVars[confNameNum].excl.insert(reg);
+      });
       // Try to propagate it into linked variables.
       // It's not an error if we can't.
       for (auto linkName : jv.link) {
@@ -3410,25 +3488,29 @@ void registerizeHarder(Ref ast) {
       // Mark the point at which each input reg becomes dead.
       // Variables alive before this point must not be assigned
       // to that register.
-      StringSet inputVars;
-      std::unordered_map<int, int> inputDeadLoc;
-      std::unordered_map<int, IString> inputVarsByReg;
-      for (auto name : jExit.live) {
-        if (!block->kill.has(name)) {
-          inputVars.insert(name);
-          int reg = juncVars[nameToNum[name]].reg;
+      // These are indexed by register, or by variable number, as most
+      // variables are live through most blocks of a large function.
+      LocalSet inputVars(numLocals);
+      std::vector<int> inputDeadLoc(nextReg, -1);
+      std::vector<IString> inputVarsByReg(nextReg);
+      jExit.live.forEach([&](size_t num) {
+        if (!block->killSet.has(num)) {
+          IString name = numToName[num];
+          inputVars.insert(num);
+          int reg = juncVars[num].reg;
           assert(reg > 0); // 'input variable doesnt have a register');
-          inputDeadLoc[reg] = block->firstDeadLoc[name];
+          inputDeadLoc[reg] = block->getFirstDeadLoc(name, num);
           inputVarsByReg[reg] = name;
         }
-      }
+      });
       for (auto pair : block->use) {
         IString name = pair.first;
-        if (!inputVars.has(name)) {
-          inputVars.insert(name);
-          int reg = juncVars[nameToNum[name]].reg;
+        size_t num = nameToNum[name];
+        if (!inputVars.has(num)) {
+          inputVars.insert(num);
+          int reg = juncVars[num].reg;
           assert(reg > 0); // 'input variable doesnt have a register');
-          inputDeadLoc[reg] = block->firstDeadLoc[name];
+          inputDeadLoc[reg] = block->getFirstDeadLoc(name, num);
           inputVarsByReg[reg] = name;
         }
       }
@@ -3437,20 +3519,20 @@ void registerizeHarder(Ref ast) {
       // Be careful to avoid conflicts with the input registers.
       // We consume free registers in last-used order, which helps to
       // eliminate "x=y" assignments that are the last use of "y".
-      StringIntMap assignedRegs;
-      auto freeRegsByTypePre = allRegsByType; // XXX copy
+      std::vector<int> assignedRegs(numLocals); // 0 if none
       // Begin with all live vars assigned per the exit junction.
-      for (auto name : jExit.live) {
-        int reg = juncVars[nameToNum[name]].reg;
+      std::vector<bool> exitRegs(nextReg);
+      jExit.live.forEach([&](size_t num) {
+        int reg = juncVars[num].reg;
         assert(reg > 0); // 'output variable doesnt have a register');
-        assignedRegs[name] = reg;
-        freeRegsByTypePre[asmData.getType(name)].erase(reg); // XXX assert?
-      }
+        assignedRegs[num] = reg;
+        exitRegs[reg] = true;
+      });
       std::vector<std::vector<int>> freeRegsByType;
-      freeRegsByType.resize(freeRegsByTypePre.size());
-      for (size_t j = 0; j < freeRegsByTypePre.size(); j++) {
-        for (auto pair : freeRegsByTypePre[j]) {
-          freeRegsByType[j].push_back(pair.first);
+      freeRegsByType.resize(allRegsByType.size());
+      for (size_t j = 0; j < allRegsByType.size(); j++) {
+        for (auto pair : allRegsByType[j]) {
+          if (!exitRegs[pair.first]) freeRegsByType[j].push_back(pair.first);
         }
       }
       // Scan through the nodes in sequence, modifying each node in-place
@@ -3459,16 +3541,17 @@ void registerizeHarder(Ref ast) {
       for (int j = block->nodes.size() - 1; j >= 0; j--) {
         Ref node = block->nodes[j];
         IString name = (node[0] == ASSIGN ? node[2][1] : node[1])->getIString();
+        size_t num = nameToNum[name];
         IntStringMap& allRegs = allRegsByType[asmData.getType(name)];
         std::vector<int>& freeRegs = freeRegsByType[asmData.getType(name)];
-        int reg = assignedRegs[name]; // XXX may insert a zero
+        int reg = assignedRegs[num];
         if (node[0] == NAME) {
           // A use.  Grab a register if it doesn't have one.
           if (reg <= 0) {
-            if (inputVars.has(name) && j <= block->firstDeadLoc[name]) {
+            if (inputVars.has(num) && j <= block->getFirstDeadLoc(name, num)) {
               // Assignment to an input variable, must use pre-assigned reg.
-              reg = juncVars[nameToNum[name]].reg;
-              assignedRegs[name] = reg;
+              reg = juncVars[num].reg;
+              assignedRegs[num] = reg;
               for (int k = freeRegs.size() - 1; k >= 0; k--) {
                 if (freeRegs[k] == reg) {
                   freeRegs.erase(freeRegs.begin() + k);
@@ -3481,7 +3564,7 @@ void registerizeHarder(Ref ast) {
               for (int k = freeRegs.size() - 1; k >= 0; k--) {
                 reg = freeRegs[k];
                 // Check for conflict with input registers.
-                if (inputDeadLoc.count(reg) > 0) {
+                if (reg < (int)inputDeadLoc.size() && inputDeadLoc[reg] >= 0) {
                   if (block->firstKillLoc[name] <= inputDeadLoc[reg]) {
                     if (name != inputVarsByReg[reg]) {
                       continue;
@@ -3489,15 +3572,15 @@ void registerizeHarder(Ref ast) {
                   }
                 }
                 // Found one!
-                assignedRegs[name] = reg;
+                assignedRegs[num] = reg;
                 assert(reg > 0);
                 freeRegs.erase(freeRegs.begin() + k);
                 break;
               }
               // If we didn't find a suitable register, create a new one.
-              if (assignedRegs[name] <= 0) {
+              if (assignedRegs[num] <= 0) {
                 reg = createReg(name);
-                assignedRegs[name] = reg;
+                assignedRegs[num] = reg;
               }
             }
           }
@@ -3507,7 +3590,7 @@ void registerizeHarder(Ref ast) {
           assert(reg > 0); //, 'live variable doesnt have a reg?')
           node[2][1]->setString(allRegs[reg]);
           freeRegs.push_back(reg);
-          assignedRegs.erase(name);
+          assignedRegs[num] = 0;
           if (node[3][0] == NAME && asmData.isLocal(node[3][1]->getIString())) {
             maybeRemoveNodes.push_back(std::pair<int, Ref>(j, node));
           }
@@ -3585,11 +3668,14 @@ const char *VALID_MIN_LATERS = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUV
 
 StringVec minifiedNames;
 std::vector<int> minifiedState;
+std::mutex minifiedNamesMutex; // minifyLocals may run on several functions in parallel
 
 void ensureMinifiedNames(int n) { // make sure the nth index in minifiedNames exists. done 100% deterministically
   static int VALID_MIN_INITS_LEN = strlen(VALID_MIN_INITS);
   static int VALID_MIN_LATERS_LEN = strlen(VALID_MIN_LATERS);
 
+  if (minifiedState.size() == 0) minifiedState.push_back(0);
+
   while ((int)minifiedNames.size() < n+1) {
     // generate the current name
     std::string name;
@@ -3612,14 +3698,93 @@ void ensureMinifiedNames(int n) { // make sure the nth index in minifiedNames ex
   }
 }
 
+IString getMinifiedName(int n) {
+  std::lock_guard<std::mutex> lock(minifiedNamesMutex);
+  ensureMinifiedNames(n);
+  return minifiedNames[n];
+}
+
+// Minifies the globals declared in the asm.js shell (which has a placeholder
+// where the functions are), and those of the functions, which extraInfo lists.
+// The most used get the shortest names: extraInfo counts how often the
+// functions refer to each, to which we add the uses here. The mapping is
+// reported in outputInfo, for minifyLocals to use on the functions.
+void minifyGlobals(Ref ast) {
+  assert(!!extraInfo);
+  IString GLOBALS("globals"), COUNTS("counts");
+  assert(extraInfo->has(GLOBALS));
+  StringIntMap uses;
+  StringVec names;
+  auto add = [&](IString name, int declarations) {
+    if (uses.count(name) == 0) names.push_back(name);
+    uses[name] += declarations;
+  };
+  bool first = true; // do not minify initial 'var asm ='
+  // find the globals
+  traversePre(ast, [&](Ref node) {
+    if (node[0] == VAR || node[0] == CONST) {
+      if (first) {
+        first = false;
+        return;
+      }
+      Ref vars = node[1];
+      for (size_t i = 0; i < vars->size(); i++) add(vars[i][0]->getIString(), 1);
+    } else if (node[0] == DEFUN && !!node[1]->getIString()) { // not the anonymous asm function itself
+      add(node[1]->getIString(), 1);
+    }
+  });
+  // add all globals in function chunks, i.e. not here but passed to us
+  Ref globals = extraInfo[GLOBALS];
+  for (size_t i = 0; i < globals->size(); i++) add(globals[i]->getIString(), 0); // counted with their uses
+  // count the uses, and sort by them, breaking ties by the order we found them in, which keeps this deterministic
+  traversePre(ast, [&](Ref node) {
+    if (node[0] == NAME) {
+      auto found = uses.find(node[1]->getIString());
+      if (found != uses.end()) found->second++;
+    }
+  });
+  if (extraInfo->has(COUNTS)) {
+    Ref counts = extraInfo[COUNTS];
+    for (auto& name : names) {
+      if (counts->has(name)) uses[name] += counts[name]->getInteger();
+    }
+  }
+  std::vector<size_t> order(names.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    int ua = uses[names[a]], ub = uses[names[b]];
+    return ua != ub ? ua > ub : a < b;
+  });
+  std::unordered_map<IString, IString> minified;
+  for (size_t i = 0; i < order.size(); i++) minified[names[order[i]]] = getMinifiedName(i);
+  // apply minification
+  first = true;
+  traversePre(ast, [&](Ref node) {
+    if (node[0] == NAME) {
+      auto found = minified.find(node[1]->getIString());
+      if (found != minified.end()) node[1]->setString(found->second);
+    } else if (node[0] == VAR || node[0] == CONST) {
+      if (first) {
+        first = false;
+        return;
+      }
+      Ref vars = node[1];
+      for (size_t i = 0; i < vars->size(); i++) vars[i][0]->setString(minified[vars[i][0]->getIString()]);
+    } else if (node[0] == DEFUN && !!node[1]->getIString()) {
+      node[1]->setString(minified[node[1]->getIString()]);
+    }
+  });
+  outputInfo = arena.alloc();
+  outputInfo->setObject();
+  for (auto& pair : minified) outputInfo[pair.first] = makeString(pair.second);
+}
+
 void minifyLocals(Ref ast) {
   assert(!!extraInfo);
   IString GLOBALS("globals");
   assert(extraInfo->has(GLOBALS));
   Ref globals = extraInfo[GLOBALS];
 
-  if (minifiedState.size() == 0) minifiedState.push_back(0);
-
   traverseFunctions(ast, [&globals](Ref fun) {
     // Analyse the asmjs to figure out local variable names,
     // but operate on the original source tree so that we don't
@@ -3647,30 +3812,51 @@ void minifyLocals(Ref ast) {
       }
     });
 
-    // The first time we encounter a local name, we assign it a
-    // minified name that's not currently in use.  Allocating on
-    // demand means they're processed in a predictable order,
-    // which is very handy for testing/debugging purposes.
+    // Count how often each local is referred to, and give the most used the
+    // shortest names that are not currently in use. Ties go to the first
+    // we encounter, so they are processed in a predictable order, which is
+    // very handy for testing/debugging purposes.
+    StringIntMap uses;
+    StringVec locals;
+    auto use = [&](IString name) {
+      if (uses.count(name) == 0) locals.push_back(name);
+      uses[name]++;
+    };
+    if (!!fun[2]) {
+      for (size_t i = 0; i < fun[2]->size(); i++) use(fun[2][i]->getIString());
+    }
+    traversePre(fun[3], [&](Ref node) {
+      Ref type = node[0];
+      if (type == NAME) {
+        IString name = node[1]->getIString();
+        if (asmData.isLocal(name)) use(name);
+      } else if (type == VAR) {
+        for (size_t i = 0; i < node[1]->size(); i++) use(node[1][i][0]->getIString());
+      }
+    });
+    std::vector<size_t> order(locals.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      int ua = uses[locals[a]], ub = uses[locals[b]];
+      return ua != ub ? ua > ub : a < b;
+    });
     int nextMinifiedName = 0;
-    auto getNextMinifiedName = [&]() {
+    for (size_t i = 0; i < order.size(); i++) {
       IString minified;
       while (1) {
-        ensureMinifiedNames(nextMinifiedName);
-        minified = minifiedNames[nextMinifiedName++];
+        minified = getMinifiedName(nextMinifiedName++);
         // TODO: we can probably remove !isLocalName here
-        if (!usedNames.has(minified) && !asmData.isLocal(minified)) {
-          return minified;
-        }
+        if (!usedNames.has(minified) && !asmData.isLocal(minified)) break;
       }
-    };
+      newNames[locals[order[i]]] = minified;
+    }
 
     // We can also minify loop labels, using a separate namespace
     // to the variable declarations.
     StringStringMap newLabels;
     int nextMinifiedLabel = 0;
     auto getNextMinifiedLabel = [&]() {
-      ensureMinifiedNames(nextMinifiedLabel);
-      return minifiedNames[nextMinifiedLabel++];
+      return getMinifiedName(nextMinifiedLabel++);
     };
 
     // Traverse and minify all names.
@@ -3680,31 +3866,18 @@ void minifyLocals(Ref ast) {
     }
     if (!!fun[2]) {
       for (size_t i = 0; i < fun[2]->size(); i++) {
-        IString minified = getNextMinifiedName();
-        newNames[fun[2][i]->getIString()] = minified;
-        fun[2][i]->setString(minified);
+        fun[2][i]->setString(newNames[fun[2][i]->getIString()]);
       }
     }
     traversePre(fun[3], [&](Ref node) {
       Ref type = node[0];
       if (type == NAME) {
-        IString name = node[1]->getIString();
-        IString minified = newNames[name];
-        if (!!minified) {
-          node[1]->setString(minified);
-        } else if (asmData.isLocal(name)) {
-          minified = getNextMinifiedName();
-          newNames[name] = minified;
-          node[1]->setString(minified);
-        }
+        IString minified = newNames[node[1]->getIString()];
+        if (!!minified) node[1]->setString(minified);
       } else if (type == VAR) {
         for (size_t i = 0; i < node[1]->size(); i++) {
           Ref defn = node[1][i];
-          IString name = defn[0]->getIString();
-          if (!(newNames.has(name))) {
-            newNames[name] = getNextMinifiedName();
-          }
-          defn[0]->setString(newNames[name]);
+          defn[0]->setString(newNames[defn[0]->getIString()]);
         }
       } else if (type == LABEL) {
         IString name = node[1]->getIString();
@@ -3861,26 +4034,2096 @@ void asmLastOpts(Ref ast) {
   });
 }
 
-// Contrary to the name this does not eliminate actual dead functions, only
-// those marked as such with DEAD_FUNCTIONS
-void eliminateDeadFuncs(Ref ast) {
-  assert(!!extraInfo);
-  IString DEAD_FUNCTIONS("dead_functions");
-  IString ABORT("abort");
-  assert(extraInfo->has(DEAD_FUNCTIONS));
-  StringSet deadFunctions;
-  for (size_t i = 0; i < extraInfo[DEAD_FUNCTIONS]->size(); i++) {
-    deadFunctions.insert(extraInfo[DEAD_FUNCTIONS][i]->getIString());
+// Inlines calls to small, non-recursive functions in the module. The body of
+// the callee is copied to the call site, with its params, locals and labels
+// renamed to fresh ones in the caller. Its returns become writes to a result
+// local, and if it returns other than at the very end, breaks out of a labeled
+// do-while(0) around the copy. We inline only one level deep, from the
+// original bodies, and limit how much each caller can grow.
+
+#define INLINE_DEFAULT_SIZE_LIMIT 20 // callees larger than this, per measureCost, are not inlined
+#define INLINE_MIN_GROWTH 100 // every caller can grow by this much, or half its size if that is more
+
+Ref deepCopy(Ref node) {
+  if (!node || !node->isArray()) {
+    if (!node) return node;
+    Ref ret = arena.alloc();
+    *ret = *node;
+    return ret;
+  }
+  Ref ret = makeArray(node->size());
+  for (size_t i = 0; i < node->size(); i++) ret->push_back(deepCopy(node[i]));
+  return ret;
+}
+
+struct InlineCandidate {
+  Ref stats; // the normalized body, without param coercions and var definitions
+  std::vector<std::pair<IString, AsmType>> params, vars;
+  AsmType ret;
+  int cost;
+  std::vector<IString> globals; // names the body uses that are not its own, which a local in the caller could shadow
+  bool onlyFinalReturn; // if so, we do not need a labeled block to return from
+};
+
+// Finds the call in the forms of statement we inline into, f(..); x = f(..)
+// with or without a coercion, and a dropped coercion like f(..)|0; Returns the
+// node and index that hold the call, or a null node.
+static Ref getInlinableCallHolder(Ref stat, int& index) {
+  if (stat[0] != STAT) return Ref();
+  Ref holder = stat;
+  index = 1;
+  Ref node = stat[1];
+  if (node[0] == ASSIGN && node[1]->isBool(true) && node[2][0] == NAME) {
+    holder = node;
+    index = 3;
+    node = node[3];
+  }
+  if (node[0] == BINARY && node[1] == OR && node[3][0] == NUM && node[3][1]->getNumber() == 0) {
+    holder = node;
+    index = 2;
+  } else if (node[0] == UNARY_PREFIX && node[1] == PLUS) {
+    holder = node;
+    index = 2;
+  } else if (node[0] == CALL && node[1][0] == NAME && node[1][1] == MATH_FROUND && node[2]->size() == 1) {
+    holder = node[2];
+    index = 0;
+  }
+  Ref call = holder[index];
+  if (call[0] != CALL || call[1][0] != NAME) return Ref();
+  return holder;
+}
+
+void inlineSmallFunctions(Ref ast) {
+  int sizeLimit = INLINE_DEFAULT_SIZE_LIMIT;
+  IString SIZE_TO_INLINE("sizeToInline");
+  if (!!extraInfo && extraInfo->isObject() && extraInfo->has(SIZE_TO_INLINE)) {
+    sizeLimit = extraInfo[SIZE_TO_INLINE]->getInteger();
   }
+
+  // Find the candidates, from copies of the original functions
+  std::unordered_map<IString, InlineCandidate> candidates;
   traverseFunctions(ast, [&](Ref fun) {
-    if (!deadFunctions.has(fun[1].get()->getIString())) {
-      return;
+    IString name = fun[1]->getIString();
+    Ref copy = deepCopy(fun);
+    AsmData asmData(copy);
+    // the var definitions are stripped; the vars are re-declared, zeroed, in the caller
+    Ref stats = makeArray(copy[3]->size());
+    for (auto stat : copy[3]->getArray()) {
+      if (!!stat && stat->isArray() && stat->size() > 0 && !(stat[0] == VAR)) stats->push_back(stat);
     }
+    clearEmptyNodes(stats);
+    int cost = measureCost(stats);
+    if (cost > sizeLimit) return;
+    bool ok = true;
+    int returns = 0;
+    std::unordered_set<IString> globals;
+    for (auto stat : stats->getArray()) traversePre(stat, [&](Ref node) {
+      Ref type = node[0];
+      if (type == CALL && node[1][0] == NAME && node[1][1] == name) ok = false; // recursive
+      else if (type == DEFUN) ok = false;
+      else if (type == RETURN) returns++;
+      else if (type == NAME && !asmData.isLocal(node[1]->getIString())) globals.insert(node[1]->getIString());
+    });
+    if (!ok) return;
+    InlineCandidate& candidate = candidates[name];
+    candidate.globals.assign(globals.begin(), globals.end());
+    candidate.stats = stats;
+    for (auto param : asmData.params) candidate.params.push_back(std::make_pair(param, asmData.getType(param)));
+    for (auto var : asmData.vars) candidate.vars.push_back(std::make_pair(var, asmData.getType(var)));
+    candidate.ret = asmData.ret;
+    candidate.cost = cost;
+    Ref last = stats->size() > 0 ? stats->back() : Ref();
+    candidate.onlyFinalReturn = returns == 0 || (returns == 1 && !!last && last[0] == RETURN);
+  });
+  if (candidates.empty()) return;
+
+  traverseFunctions(ast, [&](Ref fun) {
+    IString funName = fun[1]->getIString();
     AsmData asmData(fun);
-    fun[3]->setSize(1);
-    fun[3][0] = make1(STAT, make2(CALL, makeName(ABORT), &(makeArray(1))->push_back(makeNum(-1))));
-    asmData.vars.clear();
+    int budget = std::max(INLINE_MIN_GROWTH, measureCost(fun[3]) / 2);
+    int inlined = 0;
+
+    // Returns the statements to replace stat with, or a null node if we do not inline there
+    auto tryInline = [&](Ref stat) -> Ref {
+      int index = 0;
+      Ref holder = getInlinableCallHolder(stat, index);
+      if (!holder) return Ref();
+      Ref call = holder[index];
+      IString calleeName = call[1][1]->getIString();
+      if (calleeName == funName || asmData.isLocal(calleeName)) return Ref(); // a local would shadow the function
+      auto iter = candidates.find(calleeName);
+      if (iter == candidates.end()) return Ref();
+      InlineCandidate& callee = iter->second;
+      bool wantsResult = stat[1][0] == ASSIGN;
+      if (call[2]->size() != callee.params.size() || (wantsResult && callee.ret == ASM_NONE)) return Ref();
+      if (callee.cost > budget) return Ref();
+      for (auto global : callee.globals) {
+        if (asmData.isLocal(global)) return Ref();
+      }
+      budget -= callee.cost;
+
+      // Pick fresh names for everything local to the callee
+      std::string prefix = std::string("$i") + std::to_string(inlined++) + "$";
+      auto fresh = [&](IString name) {
+        std::string str = prefix + name.c_str();
+        while (asmData.isLocal(IString(str.c_str(), str.c_str() + str.size()))) str += "$";
+        return IString(str.c_str(), str.c_str() + str.size());
+      };
+      std::unordered_map<IString, IString> renames, labels;
+      Ref ret = makeArray(callee.params.size() + callee.vars.size() + 2);
+      for (size_t i = 0; i < callee.params.size(); i++) {
+        IString local = fresh(callee.params[i].first);
+        renames[callee.params[i].first] = local;
+        asmData.addVar(local, callee.params[i].second);
+        ret->push_back(make1(STAT, make3(ASSIGN, makeBool(true), makeName(local), call[2][i])));
+      }
+      for (auto& var : callee.vars) {
+        IString local = fresh(var.first);
+        renames[var.first] = local;
+        asmData.addVar(local, var.second);
+        // locals start out as zero in each call
+        ret->push_back(make1(STAT, make3(ASSIGN, makeBool(true), makeName(local), makeAsmCoercedZero(var.second))));
+      }
+      IString result, label;
+      if (wantsResult) {
+        result = fresh(IString("ret"));
+        asmData.addVar(result, callee.ret);
+      }
+      if (!callee.onlyFinalReturn) label = fresh(IString("L"));
+
+      Ref body = deepCopy(callee.stats);
+      for (auto s : body->getArray()) traversePre(s, [&](Ref node) {
+        Ref type = node[0];
+        if (type == NAME) {
+          auto rename = renames.find(node[1]->getIString());
+          if (rename != renames.end()) node[1]->setString(rename->second);
+        } else if (type == LABEL || ((type == BREAK || type == CONTINUE) && !!node[1])) {
+          IString& name = labels[node[1]->getIString()];
+          if (!name) name = fresh(node[1]->getIString());
+          node[1]->setString(name);
+        }
+      });
+      auto returnToSet = [&](Ref node) {
+        Ref value = node->size() > 1 ? node[1] : Ref();
+        if (!value) return makeEmpty();
+        if (!!result) return make1(STAT, make3(ASSIGN, makeBool(true), makeName(result), value));
+        return hasSideEffects(value) ? make1(STAT, value) : makeEmpty();
+      };
+      if (body->size() > 0 && body->back()[0] == RETURN) {
+        // falling out of the end is enough here, no break is needed
+        safeCopy(body->back(), returnToSet(body->back()));
+      }
+      for (auto s : body->getArray()) traversePre(s, [&](Ref node) {
+        if (!(node[0] == RETURN)) return;
+        Ref set = returnToSet(node);
+        if (!label) {
+          safeCopy(node, set);
+        } else {
+          Ref block = makeBlock();
+          block[1]->push_back(set);
+          block[1]->push_back(make1(BREAK, makeString(label)));
+          safeCopy(node, block);
+        }
+      });
+      if (!label) {
+        for (auto s : body->getArray()) ret->push_back(s);
+      } else {
+        Ref block = makeBlock();
+        block[1]->setArray(body->getArray());
+        ret->push_back(make2(LABEL, label, make2(DO, makeNum(0), block)));
+      }
+      if (wantsResult) {
+        holder[index] = makeName(result);
+        ret->push_back(stat);
+      }
+      return ret;
+    };
+
+    std::function<void (Ref)> processStatements;
+    std::function<void (Ref, int)> processSlot;
+    auto processChildren = [&](Ref stat) {
+      Ref type = stat[0];
+      if (type == BLOCK) {
+        if (stat->size() > 1 && !!stat[1]) processStatements(stat[1]);
+      } else if (type == IF) {
+        processSlot(stat, 2);
+        if (stat->size() > 3 && !!stat[3]) processSlot(stat, 3);
+      } else if (type == DO || type == WHILE || type == LABEL) {
+        processSlot(stat, 2);
+      } else if (type == FOR) {
+        processSlot(stat, 4);
+      } else if (type == SWITCH) {
+        for (auto c : stat[2]->getArray()) processStatements(c[1]);
+      }
+    };
+    processStatements = [&](Ref stats) {
+      for (size_t i = 0; i < stats->size(); i++) {
+        Ref stat = stats[i];
+        if (!stat || !stat->isArray() || stat->size() == 0) continue;
+        processChildren(stat);
+        Ref replacement = tryInline(stat);
+        if (!replacement) continue;
+        stats->splice(i, 1);
+        stats->insert(i, replacement->size());
+        for (size_t j = 0; j < replacement->size(); j++) stats[i + j] = replacement[j];
+        i += replacement->size() - 1; // do not inline into the inlined code
+      }
+    };
+    processSlot = [&](Ref parent, int index) {
+      Ref stat = parent[index];
+      if (!stat || !stat->isArray() || stat->size() == 0) return;
+      processChildren(stat);
+      Ref replacement = tryInline(stat);
+      if (!replacement) return;
+      Ref block = makeBlock();
+      block[1]->setArray(replacement->getArray());
+      parent[index] = block;
+    };
+
+    processStatements(fun[3]);
+    asmData.denormalize();
+  });
+}
+
+// Hoists loop-invariant computations out of loops. We look at the operands of
+// coercions and bitwise operations, as those can be computed into a local with
+// the same coercion applied and read back in place, which keeps the code valid
+// asm.js. For example a heap index x + 8 >> 2 with x not changing in the loop
+// becomes $licm0 >> 2, with $licm0 = x + 8 | 0 before the loop. Computations
+// are pure and cannot trap in asm.js, so hoisting them out of code that may not
+// run is safe. Heap reads are hoisted only if the loop does not write to the
+// heap or call anything. Inner loops are done first, and their hoisted
+// computations can move further out if they are invariant in outer loops too.
+
+static bool isSignedIntExpression(Ref node) {
+  if (node[0] == BINARY) {
+    Ref op = node[1];
+    return op == OR || op == AND || op == XOR || op == LSHIFT || op == RSHIFT;
+  }
+  return node[0] == CALL && node[1][0] == NAME && node[1][1] == MATH_IMUL;
+}
+
+void hoistLoopInvariants(Ref ast) {
+  traverseFunctions(ast, [&](Ref fun) {
+    AsmData asmData(fun);
+    std::unordered_set<IString> temps; // every temp is assigned exactly once, before the loop it was hoisted from
+    int numTemps = 0;
+
+    // Returns the statements to put before the loop
+    auto hoistFrom = [&](Ref loop) -> Ref {
+      Ref type = loop[0];
+      if (type == DO && loop[1][0] == NUM && loop[1][1]->getNumber() == 0) return Ref(); // runs once
+
+      std::unordered_set<IString> assigned;
+      bool writesHeap = false, hasCalls = false;
+      traversePre(loop, [&](Ref node) {
+        Ref type = node[0];
+        if (type == ASSIGN) {
+          Ref target = node[2];
+          if (target[0] == NAME) assigned.insert(target[1]->getIString());
+          else if (target[0] == SUB) writesHeap = true;
+        } else if (type == CALL) {
+          if (callHasSideEffects(node)) hasCalls = true;
+        }
+      });
+
+      std::function<bool (Ref)> isInvariant = [&](Ref node) {
+        Ref type = node[0];
+        if (type == NUM) return true;
+        if (type == NAME) {
+          IString name = node[1]->getIString();
+          if (assigned.count(name) > 0) return false;
+          return asmData.isLocal(name) || !hasCalls; // a call could modify a global
+        }
+        if (type == SUB) {
+          return !writesHeap && !hasCalls && node[1][0] == NAME && isInvariant(node[2]);
+        }
+        if (type == BINARY) return isInvariant(node[2]) && isInvariant(node[3]);
+        if (type == UNARY_PREFIX) return isInvariant(node[2]);
+        if (type == CONDITIONAL) return isInvariant(node[1]) && isInvariant(node[2]) && isInvariant(node[3]);
+        if (type == CALL) {
+          if (callHasSideEffects(node)) return false;
+          for (auto arg : node[2]->getArray()) {
+            if (!isInvariant(arg)) return false;
+          }
+          return true;
+        }
+        return false;
+      };
+
+      Ref pre = makeArray(0);
+
+      // Temps hoisted out of inner loops may be invariant here as well. They
+      // are assigned once, so ignore those assignments when checking, and
+      // drop the temps that turn out to depend on things that do change.
+      std::vector<Ref> movable;
+      traversePre(loop, [&](Ref node) {
+        if (node[0] == STAT && node[1][0] == ASSIGN && node[1][2][0] == NAME && temps.count(node[1][2][1]->getIString()) > 0) {
+          movable.push_back(node);
+          assigned.erase(node[1][2][1]->getIString());
+        }
+      });
+      bool changed = true;
+      while (changed) {
+        changed = false;
+        for (size_t i = 0; i < movable.size(); i++) {
+          if (isInvariant(movable[i][1][3])) continue;
+          assigned.insert(movable[i][1][2][1]->getIString());
+          movable.erase(movable.begin() + i);
+          i--;
+          changed = true;
+        }
+      }
+      for (auto stat : movable) {
+        pre->push_back(make1(STAT, stat[1]));
+        safeCopy(stat, makeEmpty());
+      }
+
+      // Hoist the invariant operands, reusing a temp for identical ones
+      std::vector<std::pair<Ref, IString>> hoisted;
+      auto isWorthHoisting = [](Ref node) {
+        Ref value = node;
+        if (value[0] == BINARY && value[1] == OR && value[3][0] == NUM && value[3][1]->getNumber() == 0) value = value[2];
+        else if (value[0] == UNARY_PREFIX) value = value[2];
+        if (value[0] == NUM || value[0] == NAME) return false;
+        bool readsSomething = false;
+        traversePre(value, [&](Ref node) {
+          if (node[0] == NAME || node[0] == SUB) readsSomething = true;
+        });
+        return readsSomething; // constant expressions are left to simplifyExpressions
+      };
+      auto tryHoist = [&](Ref parent, int index, AsmType type) {
+        Ref node = parent[index];
+        if (!isWorthHoisting(node) || !isInvariant(node)) return false;
+        AsmType nodeType = node[0] == SUB ? (parseHeap(node[1][1]->getCString()).floaty ? ASM_DOUBLE : ASM_INT) : detectType(node, &asmData);
+        if (nodeType != type) return false;
+        for (auto& prev : hoisted) {
+          if (prev.first->deepCompare(node)) {
+            parent[index] = makeName(prev.second);
+            return true;
+          }
+        }
+        std::string str;
+        IString temp;
+        do {
+          str = std::string("$licm") + std::to_string(numTemps++);
+          temp = IString(str.c_str(), str.c_str() + str.size());
+        } while (asmData.isLocal(temp));
+        asmData.addVar(temp, type);
+        temps.insert(temp);
+        hoisted.push_back(std::make_pair(node, temp));
+        Ref value = type == ASM_DOUBLE ? make2(UNARY_PREFIX, PLUS, node) :
+                    isSignedIntExpression(node) ? node : make3(BINARY, OR, node, makeNum(0));
+        pre->push_back(make1(STAT, make3(ASSIGN, makeBool(true), makeName(temp), value)));
+        parent[index] = makeName(temp);
+        return true;
+      };
+      std::function<void (Ref)> walk = [&](Ref node) {
+        if (!node || !node->isArray() || node->size() == 0) return;
+        if (!node[0]->isString()) {
+          for (auto child : node->getArray()) walk(child);
+          return;
+        }
+        Ref type = node[0];
+        if (type == BINARY && (node[1] == OR || node[1] == AND || node[1] == XOR || node[1] == LSHIFT || node[1] == RSHIFT || node[1] == TRSHIFT)) {
+          if (!tryHoist(node, 2, ASM_INT)) walk(node[2]);
+          if (!tryHoist(node, 3, ASM_INT)) walk(node[3]);
+        } else if (type == UNARY_PREFIX && node[1] == PLUS) {
+          if (!tryHoist(node, 2, ASM_DOUBLE)) walk(node[2]);
+        } else {
+          for (size_t i = 1; i < node->size(); i++) walk(node[i]);
+        }
+      };
+      if (type == FOR) {
+        // the init runs just once, before the loop
+        walk(loop[2]);
+        walk(loop[3]);
+        walk(loop[4]);
+      } else {
+        walk(loop[1]);
+        walk(loop[2]);
+      }
+      return pre;
+    };
+
+    auto getLoop = [](Ref stat) {
+      if (stat[0] == LABEL) stat = stat[2];
+      Ref type = stat[0];
+      return type == WHILE || type == DO || type == FOR ? stat : Ref();
+    };
+    std::function<void (Ref)> processStatements;
+    std::function<void (Ref, int)> processSlot;
+    std::function<void (Ref)> processChildren = [&](Ref stat) {
+      Ref type = stat[0];
+      if (type == BLOCK) {
+        if (stat->size() > 1 && !!stat[1]) processStatements(stat[1]);
+      } else if (type == IF) {
+        processSlot(stat, 2);
+        if (stat->size() > 3 && !!stat[3]) processSlot(stat, 3);
+      } else if (type == DO || type == WHILE) {
+        processSlot(stat, 2);
+      } else if (type == FOR) {
+        processSlot(stat, 4);
+      } else if (type == LABEL) {
+        // keep the label right on its loop, continues need that
+        if (!!getLoop(stat)) processChildren(stat[2]);
+        else processSlot(stat, 2);
+      } else if (type == SWITCH) {
+        for (auto c : stat[2]->getArray()) processStatements(c[1]);
+      }
+    };
+    processStatements = [&](Ref stats) {
+      for (size_t i = 0; i < stats->size(); i++) {
+        Ref stat = stats[i];
+        if (!stat || !stat->isArray() || stat->size() == 0) continue;
+        processChildren(stat);
+        Ref loop = getLoop(stat);
+        if (!loop) continue;
+        Ref pre = hoistFrom(loop);
+        if (!pre || pre->size() == 0) continue;
+        stats->insert(i, pre->size());
+        for (size_t j = 0; j < pre->size(); j++) stats[i + j] = pre[j];
+        i += pre->size();
+      }
+    };
+    processSlot = [&](Ref parent, int index) {
+      Ref stat = parent[index];
+      if (!stat || !stat->isArray() || stat->size() == 0) return;
+      processChildren(stat);
+      Ref loop = getLoop(stat);
+      if (!loop) return;
+      Ref pre = hoistFrom(loop);
+      if (!pre || pre->size() == 0) return;
+      Ref block = makeBlock();
+      block[1]->setArray(pre->getArray());
+      block[1]->push_back(stat);
+      parent[index] = block;
+    };
+
+    processStatements(fun[3]);
+    if (numTemps > 0) {
+      // remove the places temps were moved out from
+      traversePre(fun, [](Ref node) {
+        if (node[0] == BLOCK && node->size() > 1 && !!node[1]) clearEmptyNodes(node[1]);
+        else if (node[0] == SWITCH) {
+          for (auto c : node[2]->getArray()) clearEmptyNodes(c[1]);
+        }
+      });
+      clearEmptyNodes(fun[3]);
+    }
     asmData.denormalize();
   });
 }
 
+// A simple CSE/GVN type optimization: factors out common expressions in a
+// single basic block, that is, a list of statements without control flow.
+// Expressions are hashed, and compared fully on a hash match. An expression
+// is forgotten when a local it reads is assigned, when a global is assigned or
+// anything called (for expressions reading globals), and when memory is
+// written or anything called (for expressions reading memory).
+
+#define CSE_MIN_COST 3
+
+static size_t hashExpression(Ref node) {
+  size_t hash;
+  if (node->isString()) hash = node->getIString().hash();
+  else if (node->isNumber()) hash = std::hash<double>()(node->getNumber());
+  else if (node->isArray()) {
+    hash = node->size();
+    for (size_t i = 0; i < node->size(); i++) hash = hash * 31 + hashExpression(node[i]);
+  } else if (node->isBool()) hash = node->getBool() ? 1 : 2;
+  else hash = 3;
+  return hash;
+}
+
+// As detectType, but + - * / % look at their right operand if the left one is
+// unknown, and heap reads have the type of the heap
+static AsmType detectCSEType(Ref node, AsmData& asmData) {
+  if (node[0] == BINARY) {
+    IString op = node[1]->getIString();
+    if (op == PLUS || op == MINUS || op == MUL || op == DIV || op == MOD) {
+      AsmType ret = detectCSEType(node[2], asmData);
+      if (ret != ASM_NONE) return ret;
+      return detectCSEType(node[3], asmData);
+    }
+  } else if (node[0] == UNARY_PREFIX && node[1] == MINUS) {
+    return detectCSEType(node[2], asmData);
+  } else if (node[0] == SUB) {
+    HeapInfo info = parseHeap(node[1][1]->getCString());
+    if (!info.valid) return ASM_NONE;
+    return info.floaty ? ASM_DOUBLE : ASM_INT;
+  }
+  return detectType(node, &asmData);
+}
+
+static Ref makeSignedAsmCoercion(Ref node, AsmType type, AsmSign sign) {
+  if (type != ASM_INT || sign == ASM_SIGNED) return makeAsmCoercion(node, type);
+  assert(sign == ASM_UNSIGNED);
+  return make3(BINARY, TRSHIFT, node, makeNum(0));
+}
+
+void localCSE(Ref ast) {
+  traverseFunctions(ast, [](Ref fun) {
+    AsmData asmData(fun);
+    int counter = 0;
+    bool optimized = false;
+    IString MEMORY("<memory>"), GLOBAL("<global>");
+
+    auto processStatements = [&](Ref stats) {
+      struct Expression {
+        size_t index; // the statement it first appears in
+        Ref key, node; // a copy of the expression, and its first appearance
+        IString var; // the local it is saved in, once seen a second time
+        AsmType type;
+        AsmSign sign;
+        bool valid;
+      };
+      std::vector<Expression> exps;
+      std::unordered_multimap<size_t, size_t> hashes; // hash => index in exps
+      std::unordered_map<IString, std::vector<size_t>> deps; // local name, or memory or global => indexes in exps
+
+      auto invalidate = [&](IString what) {
+        auto iter = deps.find(what);
+        if (iter == deps.end()) return;
+        for (auto e : iter->second) exps[e].valid = false;
+        deps.erase(iter);
+      };
+      auto reset = [&]() {
+        exps.clear();
+        hashes.clear();
+        deps.clear();
+      };
+      // invalidates what an assignment or a call can change
+      auto invalidateEffects = [&](Ref node) {
+        Ref type = node[0];
+        if (type == ASSIGN) {
+          Ref target = node[2];
+          if (target[0] == NAME) {
+            IString name = target[1]->getIString();
+            invalidate(asmData.isLocal(name) ? name : GLOBAL);
+          } else {
+            assert(target[0] == SUB);
+            invalidate(MEMORY);
+          }
+        } else if (type == CALL) {
+          invalidate(GLOBAL);
+          invalidate(MEMORY);
+        }
+      };
+      // returns whether we saw control flow
+      auto doInvalidations = [&](Ref curr) {
+        bool controlFlow = false;
+        traversePre(curr, [&](Ref node) {
+          Ref type = node[0];
+          if (type == DO || type == WHILE || type == FOR || type == IF || type == SWITCH) {
+            controlFlow = true;
+          } else {
+            invalidateEffects(node);
+          }
+        });
+        if (controlFlow) reset();
+        return controlFlow;
+      };
+
+      for (size_t i = 0; i < stats->size(); i++) {
+        Ref curr = stats[i];
+        if (!curr || !curr->isArray() || curr->size() == 0) continue;
+        // first, look at the entire line and invalidate what we need to
+        if (doInvalidations(curr)) continue;
+        // next, process the line and try to find useful expressions
+        Ref skip; // the shift in a heap access, which we can't cse
+        std::function<void (Ref, size_t)> seek;
+        auto seekChildren = [&](Ref node) {
+          for (size_t j = node[0]->isString() ? 1 : 0; j < node->size(); j++) seek(node, j);
+        };
+        seek = [&](Ref parent, size_t index) {
+          Ref node = parent[index];
+          if (!node || !node->isArray() || node->size() == 0 || !node[0]) return;
+          Ref type = node[0];
+          if (type == SUB && node[1][0] == NAME && node[2][0] == BINARY && node[2][1] == RSHIFT) {
+            skip = node[2];
+          } else if ((type == BINARY && node.get() != skip.get()) || type == UNARY_PREFIX) {
+            // an expression with side effects, like a call, must be evaluated each time
+            if (measureCost(node) >= CSE_MIN_COST && !hasSideEffects(node) && detectCSEType(node, asmData) != ASM_NONE) {
+              size_t hash = hashExpression(node);
+              Expression* lookup = nullptr;
+              auto range = hashes.equal_range(hash);
+              for (auto iter = range.first; iter != range.second; iter++) {
+                Expression& exp = exps[iter->second];
+                if (exp.valid && exp.key->deepCompare(node)) {
+                  lookup = &exp;
+                  break;
+                }
+              }
+              if (!lookup) {
+                // add ourselves, and set up our deps
+                size_t e = exps.size();
+                exps.push_back(Expression{i, deepCopy(node), node, IString(), ASM_NONE, ASM_FLEXIBLE, true});
+                hashes.emplace(hash, e);
+                traversePre(node, [&](Ref node) {
+                  Ref type = node[0];
+                  if (type == NAME) {
+                    IString name = node[1]->getIString();
+                    deps[asmData.isLocal(name) ? name : GLOBAL].push_back(e);
+                  } else if (type == SUB) {
+                    deps[MEMORY].push_back(e);
+                  } else if (type == CALL) {
+                    deps[MEMORY].push_back(e);
+                    deps[GLOBAL].push_back(e);
+                  }
+                });
+              } else {
+                if (!lookup->var) {
+                  AsmType cseType = detectCSEType(node, asmData);
+                  AsmSign sign = node[0] == BINARY && node[1] == MUL && (node[2][0] == NUM || node[3][0] == NUM) ? ASM_FLEXIBLE :
+                                 node[0] == BINARY && node[1] == MOD ? ASM_NONSIGNED : detectSign(node);
+                  if (sign == ASM_FLEXIBLE) sign = ASM_SIGNED;
+                  if (cseType == ASM_INT && sign == ASM_NONSIGNED) {
+                    // not something we can keep in an int local, like a division that is a double
+                    lookup->valid = false;
+                    seekChildren(node);
+                    return;
+                  }
+                  // with the original node plus us, this is worth optimizing out. generate
+                  // the saved var, and optimize out the original
+                  std::string str;
+                  do {
+                    str = std::string("CSE$") + std::to_string(counter++);
+                    lookup->var = IString(str.c_str(), str.c_str() + str.size());
+                  } while (asmData.isLocal(lookup->var));
+                  lookup->type = cseType;
+                  lookup->sign = sign;
+                  asmData.addVar(lookup->var, cseType);
+                  safeCopy(lookup->node, makeSignedAsmCoercion(makeName(lookup->var), cseType, sign));
+                  stats->insert(lookup->index, make1(STAT, make3(ASSIGN, makeBool(true), makeName(lookup->var), makeSignedAsmCoercion(node, cseType, sign))));
+                  // adjust indexes after that insertion
+                  i++; // i must be after lookup->index
+                  for (auto& exp : exps) {
+                    if (!exp.var && exp.index >= lookup->index) exp.index++;
+                  }
+                  optimized = true;
+                }
+                // optimize out ourselves
+                parent[index] = makeSignedAsmCoercion(makeName(lookup->var), lookup->type, lookup->sign);
+                return;
+              }
+            }
+          }
+          seekChildren(node);
+          // an assignment or a call inside this line can change what later parts of it read
+          invalidateEffects(node);
+        };
+        seekChildren(curr);
+        // finally, repeat invalidation processing, to not be sensitive to inter-line control flow
+        doInvalidations(curr);
+      }
+    };
+
+    traversePre(fun, [&](Ref node) {
+      if (node[0] == DEFUN) processStatements(node[3]);
+      else if (node[0] == BLOCK && node->size() > 1 && !!node[1]) processStatements(node[1]);
+    });
+    asmData.denormalize();
+    if (optimized) simplifyExpressions(fun); // remove double coercions, etc.
+  });
+}
+
+// Contrary to the name this does not eliminate actual dead functions, only
+// those marked as such with DEAD_FUNCTIONS
+void eliminateDeadFuncs(Ref ast) {
+  assert(!!extraInfo);
+  IString DEAD_FUNCTIONS("dead_functions");
+  IString ABORT("abort");
+  assert(extraInfo->has(DEAD_FUNCTIONS));
+  StringSet deadFunctions;
+  for (size_t i = 0; i < extraInfo[DEAD_FUNCTIONS]->size(); i++) {
+    deadFunctions.insert(extraInfo[DEAD_FUNCTIONS][i]->getIString());
+  }
+  traverseFunctions(ast, [&](Ref fun) {
+    if (!deadFunctions.has(fun[1].get()->getIString())) {
+      return;
+    }
+    AsmData asmData(fun);
+    fun[3]->setSize(1);
+    fun[3][0] = make1(STAT, make2(CALL, makeName(ABORT), &(makeArray(1))->push_back(makeNum(-1))));
+    asmData.vars.clear();
+    asmData.denormalize();
+  });
+}
+
+// Runs work(i) for each i in [0, count) on numThreads threads
+template<typename Work>
+static void parallelFor(size_t count, Work work) {
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    while (1) {
+      size_t i = next++;
+      if (i >= count) break;
+      work(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < numThreads && (size_t)i < count; i++) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+}
+
+// Flattens a function into a token stream that leaves out its name and numbers
+// its locals in order of appearance, so that two functions get the same tokens
+// exactly when one is a renaming of the other. Recursive calls are kept apart
+// from calls to other functions, so recursive duplicates fold too.
+static void canonicalizeFunction(Ref fun, std::vector<uint64_t>& out) {
+  enum {
+    TOKEN_NULL, TOKEN_ARRAY, TOKEN_STRING, TOKEN_NUMBER, TOKEN_BOOL,
+    TOKEN_LOCAL, TOKEN_GLOBAL, TOKEN_SELF, TOKEN_VAR
+  };
+  IString self = fun[1]->getIString();
+  std::unordered_map<IString, uint64_t> locals; // local => index, or -1 if not yet seen
+  uint64_t nextLocal = 0;
+  Ref params = fun[2];
+  for (size_t i = 0; i < params->size(); i++) locals[params[i]->getIString()] = uint64_t(-1);
+  traversePre(fun[3], [&](Ref node) {
+    if (node[0] == VAR) {
+      for (size_t i = 0; i < node[1]->size(); i++) locals[node[1][i][0]->getIString()] = uint64_t(-1);
+    }
+  });
+  auto addName = [&](IString name) {
+    auto found = locals.find(name);
+    if (found != locals.end()) {
+      if (found->second == uint64_t(-1)) found->second = nextLocal++;
+      out.push_back(TOKEN_LOCAL);
+      out.push_back(found->second);
+    } else if (name == self) {
+      out.push_back(TOKEN_SELF);
+    } else {
+      out.push_back(TOKEN_GLOBAL);
+      out.push_back((uint64_t)(uintptr_t)name.c_str()); // interned, so the pointer identifies the string
+    }
+  };
+  std::function<void (Ref)> add = [&](Ref node) {
+    if (!node) {
+      out.push_back(TOKEN_NULL);
+    } else if (node->isArray()) {
+      if (node->size() >= 2 && node[0] == NAME) {
+        addName(node[1]->getIString());
+      } else if (node->size() >= 2 && node[0] == VAR) {
+        out.push_back(TOKEN_VAR);
+        out.push_back(node[1]->size());
+        for (size_t i = 0; i < node[1]->size(); i++) {
+          Ref def = node[1][i];
+          addName(def[0]->getIString());
+          add(def->size() > 1 ? def[1] : Ref());
+        }
+      } else {
+        out.push_back(TOKEN_ARRAY);
+        out.push_back(node->size());
+        for (size_t i = 0; i < node->size(); i++) add(node[i]);
+      }
+    } else if (node->isString()) {
+      out.push_back(TOKEN_STRING);
+      out.push_back((uint64_t)(uintptr_t)node->getCString());
+    } else if (node->isNumber()) {
+      double num = node->getNumber();
+      uint64_t bits;
+      memcpy(&bits, &num, sizeof(bits));
+      out.push_back(TOKEN_NUMBER);
+      out.push_back(bits);
+    } else if (node->isBool()) {
+      out.push_back(TOKEN_BOOL);
+      out.push_back(node->getBool());
+    } else {
+      out.push_back(TOKEN_NULL);
+    }
+  };
+  out.push_back(params->size());
+  for (size_t i = 0; i < params->size(); i++) addName(params[i]->getIString());
+  add(fun[3]);
+}
+
+// Whole-module call graph optimizations. If extraInfo has a list of roots,
+// the functions referred to from outside of the functions (exports, function
+// tables), anything not reachable from them is removed. Then functions that
+// are renamings of each other are folded into the one with the shortest name,
+// repeating until nothing changes, as folding callees can make their callers
+// identical. Functions are canonicalized and rewritten on numThreads threads.
+// The folded functions are reported in outputInfo, so that references to them
+// outside of the functions can be updated.
+void pruneFunctions(Ref ast) {
+  IString ROOTS("roots"), EQUIVALENT_FUNCTIONS("equivalentFunctions");
+  assert(ast[0] == TOPLEVEL);
+  Ref stats = ast[1];
+
+  std::vector<Ref> funcs;
+  std::unordered_map<IString, size_t> funcIndexes;
+  auto collectFunctions = [&]() {
+    funcs.clear();
+    funcIndexes.clear();
+    for (size_t i = 0; i < stats->size(); i++) {
+      if (stats[i][0] == DEFUN) {
+        funcIndexes[stats[i][1]->getIString()] = funcs.size();
+        funcs.push_back(stats[i]);
+      }
+    }
+  };
+  // Keeps only the functions for which keep(index) holds
+  auto removeFunctions = [&](std::function<bool (size_t)> keep) {
+    size_t j = 0;
+    for (size_t i = 0; i < stats->size(); i++) {
+      Ref curr = stats[i];
+      if (curr[0] == DEFUN && !keep(funcIndexes[curr[1]->getIString()])) continue;
+      stats[j++] = curr;
+    }
+    stats->setSize(j);
+    collectFunctions();
+  };
+  collectFunctions();
+
+  if (!!extraInfo && extraInfo->isObject() && extraInfo->has(ROOTS)) {
+    // the call graph: the functions each one refers to
+    std::vector<std::vector<size_t>> callees(funcs.size());
+    parallelFor(funcs.size(), [&](size_t i) {
+      traversePre(funcs[i][3], [&](Ref node) {
+        if (node[0] == NAME) {
+          auto found = funcIndexes.find(node[1]->getIString());
+          if (found != funcIndexes.end()) callees[i].push_back(found->second);
+        }
+      });
+    });
+    std::vector<bool> reached(funcs.size());
+    std::vector<size_t> work;
+    Ref roots = extraInfo[ROOTS];
+    for (size_t i = 0; i < roots->size(); i++) {
+      auto found = funcIndexes.find(roots[i]->getIString());
+      if (found != funcIndexes.end() && !reached[found->second]) {
+        reached[found->second] = true;
+        work.push_back(found->second);
+      }
+    }
+    while (work.size() > 0) {
+      size_t curr = work.back();
+      work.pop_back();
+      for (size_t callee : callees[curr]) {
+        if (!reached[callee]) {
+          reached[callee] = true;
+          work.push_back(callee);
+        }
+      }
+    }
+    removeFunctions([&](size_t i) { return reached[i]; });
+  }
+
+  std::unordered_map<IString, IString> equivalents; // folded function => the one it was folded into
+  while (1) {
+    std::vector<std::vector<uint64_t>> tokens(funcs.size());
+    std::vector<size_t> hashes(funcs.size());
+    parallelFor(funcs.size(), [&](size_t i) {
+      canonicalizeFunction(funcs[i], tokens[i]);
+      size_t hash = tokens[i].size();
+      for (uint64_t token : tokens[i]) hash = hash * 31 + std::hash<uint64_t>()(token);
+      hashes[i] = hash;
+    });
+    // function => the function it is folded into, in this round
+    std::unordered_map<IString, IString> renames;
+    std::unordered_map<size_t, std::vector<size_t>> byHash; // hash => the representatives with it
+    for (size_t i = 0; i < funcs.size(); i++) {
+      std::vector<size_t>& candidates = byHash[hashes[i]];
+      bool folded = false;
+      for (size_t& rep : candidates) {
+        if (tokens[rep] != tokens[i]) continue;
+        IString repName = funcs[rep][1]->getIString(), name = funcs[i][1]->getIString();
+        if (strlen(name.c_str()) < strlen(repName.c_str())) {
+          // the new one has a shorter name, so it becomes the representative
+          renames[repName] = name;
+          for (auto& rename : renames) {
+            if (rename.second == repName) rename.second = name;
+          }
+          rep = i;
+        } else {
+          renames[name] = repName;
+        }
+        folded = true;
+        break;
+      }
+      if (!folded) candidates.push_back(i);
+    }
+    if (renames.empty()) break;
+    removeFunctions([&](size_t i) { return renames.count(funcs[i][1]->getIString()) == 0; });
+    parallelFor(funcs.size(), [&](size_t i) {
+      traversePre(funcs[i][3], [&](Ref node) {
+        if (node[0] == NAME) {
+          auto found = renames.find(node[1]->getIString());
+          if (found != renames.end()) node[1]->setString(found->second);
+        }
+      });
+    });
+    for (auto& equivalent : equivalents) {
+      auto found = renames.find(equivalent.second);
+      if (found != renames.end()) equivalent.second = found->second;
+    }
+    for (auto& rename : renames) equivalents[rename.first] = rename.second;
+  }
+
+  // report [folded, representative] pairs, sorted so the output is stable
+  std::vector<std::pair<IString, IString>> sorted(equivalents.begin(), equivalents.end());
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<IString, IString>& a, const std::pair<IString, IString>& b) {
+    return strcmp(a.first.c_str(), b.first.c_str()) < 0;
+  });
+  Ref pairs = makeArray(sorted.size());
+  for (auto& equivalent : sorted) {
+    pairs->push_back(&(makeArray(2))->push_back(makeString(equivalent.first))
+                                     .push_back(makeString(equivalent.second)));
+  }
+  outputInfo = arena.alloc();
+  outputInfo->setObject();
+  outputInfo[EQUIVALENT_FUNCTIONS] = pairs;
+}
+
+// Prints the functions called from outside of the functions in
+// extraInfo.blacklist, for emterpretify
+void findReachable(Ref ast) {
+  IString BLACKLIST("blacklist");
+  StringSet blacklist;
+  if (!!extraInfo && extraInfo->has(BLACKLIST)) {
+    for (size_t i = 0; i < extraInfo[BLACKLIST]->size(); i++) blacklist.insert(extraInfo[BLACKLIST][i]->getIString());
+  }
+  std::vector<IString> reachable;
+  StringSet seen;
+  traverseFunctions(ast, [&](Ref func) {
+    if (blacklist.has(func[1]->getIString())) return;
+    traversePre(func, [&](Ref node) {
+      if (node[0] == CALL && node[1][0] == NAME) {
+        IString target = node[1][1]->getIString();
+        if (!seen.has(target)) {
+          seen.insert(target);
+          reachable.push_back(target);
+        }
+      }
+    });
+  });
+  std::cout << "// REACHABLE [";
+  for (size_t i = 0; i < reachable.size(); i++) {
+    if (i > 0) std::cout << ',';
+    std::cout << '"' << reachable[i].c_str() << '"';
+  }
+  std::cout << "]\n";
+}
+
+// Prints the functions each function calls directly, or through which
+// function tables
+void dumpCallGraph(Ref ast) {
+  traverseFunctions(ast, [&](Ref func) {
+    std::vector<IString> reachable;
+    StringSet seen;
+    traversePre(func, [&](Ref node) {
+      if (node[0] == CALL) {
+        IString target;
+        if (node[1][0] == NAME) {
+          target = node[1][1]->getIString();
+        } else {
+          // (FUNCTION_TABLE[..])(..)
+          assert(node[1][0] == SUB && node[1][1][0] == NAME);
+          target = node[1][1][1]->getIString();
+        }
+        if (!seen.has(target)) {
+          seen.insert(target);
+          reachable.push_back(target);
+        }
+      }
+    });
+    std::cout << "// REACHABLE [\"" << func[1]->getCString() << "\",\" => \",[";
+    for (size_t i = 0; i < reachable.size(); i++) {
+      if (i > 0) std::cout << ',';
+      std::cout << '"' << reachable[i].c_str() << '"';
+    }
+    std::cout << "]]\n";
+  });
+}
+
+// Makes each function with an id in extraInfo report it to the
+// PROFILE_FUNCTION_ORDER runtime when called. The call goes right after the
+// param coercions and var declarations, which asm.js requires to come first.
+void instrumentFunctionOrder(Ref ast) {
+  assert(!!extraInfo && extraInfo->isObject() && extraInfo->has(FUNCTION_IDS));
+  Ref ids = extraInfo[FUNCTION_IDS];
+  traverseFunctions(ast, [&](Ref fun) {
+    IString name = fun[1]->getIString();
+    if (!ids->has(name)) return;
+    Ref stats = fun[3];
+    size_t i = std::min(fun[2]->size(), stats->size());
+    while (i < stats->size() && stats[i][0] == VAR) i++;
+    stats->insert(i, make1(STAT, make2(CALL, makeName(PROFILE_FUNCTION_CALL), &(makeArray(1))->push_back(makeNum(ids[name]->getNumber())))));
+  });
+}
+
+// Makes each function with an id in extraInfo push it on the shadow stack of
+// the SAMPLING_PROFILER runtime when called, and pop it when returning. The
+// stack is an int depth at shadowStack, followed by a ring of 1024 ids:
+//
+//   ssd$ = HEAP32[shadowStack >> 2] | 0;
+//   HEAP32[shadowStack + 4 + ((ssd$ & 1023) << 2) >> 2] = id;
+//   HEAP32[shadowStack >> 2] = ssd$ + 1 | 0;
+//
+// and a pop stores ssd$ back. A returned value that calls other functions is
+// computed into a temp before the pop, so the callees are sampled under this
+// function.
+void instrumentShadowStack(Ref ast) {
+  assert(!!extraInfo && extraInfo->isObject() && extraInfo->has(FUNCTION_IDS));
+  Ref ids = extraInfo[FUNCTION_IDS];
+  auto depthSlot = []() {
+    return make2(SUB, makeName(HEAP32), make3(BINARY, RSHIFT, makeName(SHADOW_STACK), makeNum(2)));
+  };
+  auto makePop = [&]() {
+    return make1(STAT, make3(ASSIGN, makeBool(true), depthSlot(), makeName(SHADOW_STACK_DEPTH)));
+  };
+  auto hasCall = [](Ref node) {
+    bool ret = false;
+    traversePre(node, [&](Ref node) {
+      if (node[0] == CALL) ret = true;
+    });
+    return ret;
+  };
+  traverseFunctions(ast, [&](Ref fun) {
+    IString name = fun[1]->getIString();
+    if (!ids->has(name)) return;
+    AsmData asmData(fun);
+    asmData.addVar(SHADOW_STACK_DEPTH, ASM_INT);
+
+    Ref stats = fun[3];
+    bool fallsOut = stats->size() == 0 || stats->back()[0] != RETURN;
+    std::vector<Ref> returns;
+    traversePre(fun, [&](Ref node) {
+      if (node[0] == RETURN) returns.push_back(node);
+    });
+    StringSet resultTemps;
+    for (Ref node : returns) {
+      Ref value = node->size() > 1 ? node[1] : Ref();
+      Ref block = makeBlock();
+      if (!!value && hasCall(value)) {
+        AsmType type = detectType(value, &asmData);
+        std::string str = std::string(SHADOW_STACK_RESULT.c_str()) + std::to_string(int(type));
+        IString temp(str.c_str(), str.c_str() + str.size());
+        if (!resultTemps.has(temp)) {
+          resultTemps.insert(temp);
+          asmData.addVar(temp, type);
+        }
+        block[1]->push_back(make1(STAT, make3(ASSIGN, makeBool(true), makeName(temp), value)));
+        block[1]->push_back(makePop());
+        block[1]->push_back(make1(RETURN, makeAsmCoercion(makeName(temp), type)));
+      } else {
+        block[1]->push_back(makePop());
+        block[1]->push_back(ValueBuilder::makeReturn(value));
+      }
+      safeCopy(node, block);
+    }
+    if (fallsOut) {
+      stats->push_back(makePop());
+    } else {
+      // keep the final return at the top level, where asm.js looks for it
+      Ref last = stats->pop_back();
+      for (auto s : last[1]->getArray()) stats->push_back(s);
+    }
+
+    asmData.denormalize();
+    stats = fun[3];
+    size_t i = std::min(fun[2]->size(), stats->size());
+    while (i < stats->size() && stats[i][0] == VAR) i++;
+    Ref slot = make3(BINARY, PLUS, make3(BINARY, PLUS, makeName(SHADOW_STACK), makeNum(4)),
+                     make3(BINARY, LSHIFT, make3(BINARY, AND, makeName(SHADOW_STACK_DEPTH), makeNum(1023)), makeNum(2)));
+    stats->insert(i, make1(STAT, make3(ASSIGN, makeBool(true), depthSlot(), make3(BINARY, OR, make3(BINARY, PLUS, makeName(SHADOW_STACK_DEPTH), makeNum(1)), makeNum(0)))));
+    stats->insert(i, make1(STAT, make3(ASSIGN, makeBool(true), make2(SUB, makeName(HEAP32), make3(BINARY, RSHIFT, slot, makeNum(2))), makeNum(ids[name]->getNumber()))));
+    stats->insert(i, make1(STAT, make3(ASSIGN, makeBool(true), makeName(SHADOW_STACK_DEPTH), make3(BINARY, OR, depthSlot(), makeNum(0)))));
+  });
+}
+
+// Turns calls through the function tables that extraInfo lists into direct
+// calls of the functions in them, guarded by checks of the index, as computed
+// by tools/devirtualize.py. For each table we get a list of [function,
+// index, ..] for the functions that can be called through it, so
+//
+//   x = FUNCTION_TABLE_ii[i & 7](a) | 0;
+//
+// becomes
+//
+//   x = (i & 7) == 3 ? _f(a) | 0 : FUNCTION_TABLE_ii[i & 7](a) | 0;
+//
+// and a call whose result is unused an if. The indirect call is kept for any
+// other index, which can only be a bad function pointer that it reports. The
+// index is evaluated again on that path, so we leave calls alone if it has
+// side effects.
+void devirtualize(Ref ast) {
+  assert(!!extraInfo && extraInfo->isObject() && extraInfo->has(DEVIRTUALIZE));
+  Ref tables = extraInfo[DEVIRTUALIZE];
+  auto getTargets = [&](Ref call) {
+    if (call[0] != CALL || call[1][0] != SUB || call[1][1][0] != NAME) return Ref();
+    IString table = call[1][1][1]->getIString();
+    if (!isFunctionTable(table.c_str()) || !tables->has(table) || hasSideEffects(call[1][2])) return Ref();
+    return tables[table];
+  };
+  auto makeChecks = [&](Ref call, Ref targets, AsmType type, bool statement) {
+    auto wrap = [&](Ref call) {
+      Ref ret = makeAsmCoercion(call, type);
+      return statement ? make1(STAT, ret) : ret;
+    };
+    Ref index = call[1][2];
+    Ref ret = wrap(call);
+    for (int i = targets->size() - 1; i >= 0; i--) {
+      Ref target = targets[i];
+      Ref check;
+      for (size_t j = 1; j < target->size(); j++) {
+        Ref curr = make3(BINARY, EQ, deepCopy(index), makeNum(target[j]->getNumber()));
+        check = !check ? curr : make3(BINARY, OR, check, curr);
+      }
+      Ref direct = wrap(make2(CALL, makeName(target[0]->getIString()), deepCopy(call[2])));
+      ret = statement ? ValueBuilder::makeIf(check, direct, ret) : make3(CONDITIONAL, check, direct, ret);
+    }
+    return ret;
+  };
+  traverseFunctions(ast, [&](Ref fun) {
+    // coerced calls we made conditionals of, in case they turn out to be a
+    // whole statement, which we then make an if instead
+    std::unordered_map<Value*, std::pair<Ref, AsmType>> coerced;
+    traversePrePost(fun, [](Ref node) {}, [&](Ref node) {
+      Ref call;
+      AsmType type;
+      if (node[0] == STAT) {
+        auto it = coerced.find(node[1].get());
+        if (it != coerced.end()) {
+          safeCopy(node, makeChecks(it->second.first, getTargets(it->second.first), it->second.second, true));
+          return;
+        }
+        call = node[1];
+        type = ASM_NONE;
+      } else if (node[0] == BINARY && node[1] == OR && node[3][0] == NUM && node[3][1]->getNumber() == 0) {
+        call = node[2];
+        type = ASM_INT;
+      } else if (node[0] == UNARY_PREFIX && node[1] == PLUS) {
+        call = node[2];
+        type = ASM_DOUBLE;
+      } else if (node[0] == CALL && node[1][0] == NAME && node[1][1] == MATH_FROUND && node[2]->size() == 1) {
+        call = node[2][0];
+        type = ASM_FLOAT;
+      } else {
+        return;
+      }
+      Ref targets = getTargets(call);
+      if (!targets) return;
+      safeCopy(node, makeChecks(call, targets, type, node[0] == STAT));
+      if (type != ASM_NONE) coerced[node.get()] = std::make_pair(call, type);
+    });
+  });
+}
+
+// Breaks up functions of more than extraInfo.sizeToOutline AST nodes, which
+// engines compile slowly, or with fewer optimizations, by moving runs of their
+// statements into new functions until they are under it.
+//
+// The locals a run may read before it writes them become params of the new
+// function, and the ones it writes that are read after it are written back
+// through a scratch area at the end of the stack frame of the caller, which
+// loads them after the call. Returns, and breaks and continues to outside of
+// the run, leave the new function with a code that the caller checks for, and
+// then does them itself. We prefer runs that are not in loops, so that hot code
+// does not get a call, and loads and stores around it, on each iteration.
+class Outliner {
+  typedef std::unordered_map<IString, int> Counts;
+
+  // The locals code reads and writes, and those it may read before it writes
+  // them, whose values it needs from before it. Loops, switches and labels can
+  // be left early, so after one we only count on what was written before it,
+  // and after a branch on what both sides wrote.
+  struct Flow {
+    AsmData& asmData;
+    Counts reads, writes;
+    StringSet exposed;
+
+    Flow(AsmData& asmData) : asmData(asmData) {}
+
+    void walk(Ref node, StringSet& assigned) {
+      if (!node->isArray() || node->size() == 0) return;
+      if (!node[0]->isString()) {
+        for (auto child : node->getArray()) walk(child, assigned);
+        return;
+      }
+      IString type = node[0]->getIString();
+      if (type == NAME) {
+        IString name = node[1]->getIString();
+        if (!asmData.isLocal(name)) return;
+        reads[name]++;
+        if (!assigned.has(name)) exposed.insert(name);
+      } else if (type == ASSIGN && node[2][0] == NAME) {
+        walk(node[3], assigned);
+        IString name = node[2][1]->getIString();
+        if (!asmData.isLocal(name)) return;
+        writes[name]++;
+        assigned.insert(name);
+      } else if (type == IF || type == CONDITIONAL) {
+        walk(node[1], assigned);
+        StringSet ifTrue = assigned, ifFalse = assigned;
+        walk(node[2], ifTrue);
+        if (node->size() > 3) walk(node[3], ifFalse);
+        StringSet both;
+        for (auto name : ifTrue) {
+          if (ifFalse.has(name)) both.insert(name);
+        }
+        assigned = both;
+      } else if (type == WHILE) {
+        walk(node[1], assigned);
+        StringSet body = assigned;
+        walk(node[2], body);
+      } else if (type == DO) {
+        StringSet body = assigned, condition = assigned;
+        walk(node[2], body);
+        walk(node[1], condition);
+      } else if (type == FOR) {
+        walk(node[1], assigned);
+        walk(node[2], assigned);
+        StringSet body = assigned;
+        walk(node[4], body);
+        walk(node[3], body);
+      } else if (type == SWITCH) {
+        walk(node[1], assigned);
+        for (auto c : node[2]->getArray()) {
+          StringSet body = assigned;
+          walk(c[1], body);
+        }
+      } else if (type == LABEL) {
+        walk(node[2], assigned);
+      } else if (type != VAR) {
+        for (size_t i = 1; i < node->size(); i++) walk(node[i], assigned);
+      }
+    }
+  };
+
+  // A run of statements we can move out
+  struct Run {
+    Ref list; // the statements it is in, or null if it is
+    Ref single; // a statement by itself, the body of an if or a loop
+    size_t start, end;
+    int depth; // of the loops around it
+    size_t size; // not counting calls of code we outlined before
+  };
+
+  // What we find in code when we measure it
+  struct Measure {
+    bool fixed = false; // whether it writes the frame pointer, and must stay
+    size_t outlined = 0; // size of calls of code we outlined before
+  };
+
+  size_t sizeLimit, minSize, maxSize;
+  Ref toplevel;
+
+  // The function we are outlining from
+  Ref func;
+  AsmData* asmData;
+  IString frame; // points to its stack frame
+  bool ownFrame; // whether we need to add one
+  size_t frameBase; // where the scratch area begins in the frame
+  size_t scratchSize;
+  Ref bumpSize; // of the frame, if it has one
+  size_t frameIndex; // where the frame is set up, or we would set it up
+  size_t firstIndex; // of the statements, after the prologue
+  bool addPops;
+  IString code; // the local we check returned codes with
+  int outlined;
+  std::vector<Run> runs;
+  std::unordered_set<Value*> calls; // that we replaced code with
+
+  static bool isAssignTo(Ref node, IString target) {
+    return node[0] == STAT && node[1][0] == ASSIGN && node[1][2][0] == NAME && node[1][2][1] == target;
+  }
+
+  static IString makeFreshName(IString base, std::function<bool (IString)> taken) {
+    if (!taken(base)) return base;
+    for (int i = 1; ; i++) {
+      std::string str = std::string(base.c_str()) + std::to_string(i);
+      IString name(str.c_str(), str.c_str() + str.size());
+      if (!taken(name)) return name;
+    }
+  }
+
+  // Measures code, and notes the runs of statements in it that we might move
+  // out. Moving out only calls of code we outlined before would gain nothing,
+  // so we count what else runs contain.
+  size_t scan(Ref node, int depth, Measure& measure) {
+    if (!node->isArray() || node->size() == 0) return 0;
+    size_t size = 1;
+    if (calls.count(node.get())) {
+      size = 0;
+      traversePre(node, [&](Ref node) {
+        size++;
+      });
+      measure.outlined += size;
+      return size;
+    }
+    if (!node[0]->isString()) {
+      for (auto child : node->getArray()) size += scan(child, depth, measure);
+      return size;
+    }
+    IString type = node[0]->getIString();
+    if (type == BLOCK) {
+      size += scanList(node[1], depth, 0, measure);
+    } else if (type == IF) {
+      size += scan(node[1], depth, measure) + scanBody(node[2], depth, measure);
+      if (node->size() > 3 && !!node[3]) size += scanBody(node[3], depth, measure);
+    } else if (type == WHILE || type == DO) {
+      bool once = type == DO && node[1][0] == NUM && node[1][1]->getNumber() == 0;
+      size += scan(node[1], depth, measure) + scanBody(node[2], once ? depth : depth + 1, measure);
+    } else if (type == SWITCH) {
+      size += scan(node[1], depth, measure);
+      for (auto c : node[2]->getArray()) {
+        size += 1 + scan(c[0], depth, measure) + scanList(c[1], depth, 0, measure);
+      }
+    } else if (type == DEFUN) {
+      size += scanList(node[3], depth, firstIndex, measure);
+    } else {
+      if (type == ASSIGN && node[2][0] == NAME && (node[2][1] == frame || node[2][1] == SP)) measure.fixed = true;
+      if (type == FOR) depth++; // not emitted for asm.js, so we just measure it
+      for (size_t i = 1; i < node->size(); i++) size += scan(node[i], depth, measure);
+    }
+    return size;
+  }
+
+  size_t scanBody(Ref node, int depth, Measure& measure) {
+    if (node[0] == BLOCK) return scan(node, depth, measure);
+    Measure body;
+    size_t size = scan(node, depth, body);
+    if (!body.fixed && size <= maxSize && size - body.outlined >= minSize) {
+      runs.push_back({ Ref(), node, 0, 1, depth, size - body.outlined });
+    }
+    measure.fixed = measure.fixed || body.fixed;
+    measure.outlined += body.outlined;
+    return size;
+  }
+
+  size_t scanList(Ref list, int depth, size_t first, Measure& measure) {
+    size_t n = list->size(), size = 1;
+    std::vector<size_t> sizes(n), outlinedSizes(n);
+    std::vector<bool> movable(n);
+    for (size_t i = 0; i < n; i++) {
+      Measure curr;
+      sizes[i] = scan(list[i], depth, curr);
+      outlinedSizes[i] = curr.outlined;
+      movable[i] = !curr.fixed && i >= first;
+      measure.fixed = measure.fixed || curr.fixed;
+      measure.outlined += curr.outlined;
+      size += sizes[i];
+    }
+    // the longest run from each start that is not too big, unless it ends where
+    // the one from an earlier start does, which contains it
+    size_t end = first, runSize = 0, runOutlined = 0, lastEnd = first;
+    for (size_t start = first; start < n; start++) {
+      if (end < start) {
+        end = start;
+        runSize = runOutlined = 0;
+      }
+      while (end < n && movable[end] && runSize + sizes[end] <= maxSize) {
+        runSize += sizes[end];
+        runOutlined += outlinedSizes[end++];
+      }
+      if (end > start && end > lastEnd && runSize - runOutlined >= minSize) {
+        runs.push_back({ list, Ref(), start, end, depth, runSize - runOutlined });
+        lastEnd = end;
+      }
+      if (end > start) {
+        runSize -= sizes[start];
+        runOutlined -= outlinedSizes[start];
+      }
+    }
+    return size;
+  }
+
+  // Finds the returns, and breaks and continues to outside of node
+  static void findEscapes(Ref node, bool breakable, bool continuable, StringSet& labels, std::vector<Ref>& escapes) {
+    if (!node->isArray() || node->size() == 0) return;
+    if (!node[0]->isString()) {
+      for (auto child : node->getArray()) findEscapes(child, breakable, continuable, labels, escapes);
+      return;
+    }
+    IString type = node[0]->getIString();
+    if (type == RETURN) {
+      escapes.push_back(node);
+    } else if (type == BREAK || type == CONTINUE) {
+      if (!!node[1] ? !labels.has(node[1]->getIString()) : !(type == BREAK ? breakable : continuable)) {
+        escapes.push_back(node);
+      }
+    } else if (type == LABEL) {
+      IString label = node[1]->getIString();
+      labels.insert(label);
+      findEscapes(node[2], breakable, continuable, labels, escapes);
+      labels.erase(label);
+    } else if (type == DO || type == WHILE || type == FOR) {
+      for (size_t i = 1; i < node->size(); i++) findEscapes(node[i], true, true, labels, escapes);
+    } else if (type == SWITCH) {
+      findEscapes(node[1], breakable, continuable, labels, escapes);
+      findEscapes(node[2], true, continuable, labels, escapes);
+    } else if (type == BLOCK || type == IF) {
+      for (size_t i = 1; i < node->size(); i++) findEscapes(node[i], breakable, continuable, labels, escapes);
+    }
+  }
+
+  static Ref makeSlot(Ref base, size_t offset, AsmType type) {
+    Ref ptr = offset > 0 ? make3(BINARY, PLUS, base, makeNum(offset)) : base;
+    IString heap = type == ASM_INT ? HEAP32 : type == ASM_DOUBLE ? HEAPF64 : HEAPF32;
+    return make2(SUB, makeName(heap), make3(BINARY, RSHIFT, ptr, makeNum(type == ASM_DOUBLE ? 3 : 2)));
+  }
+
+  static Ref makeAssign(Ref target, Ref value) {
+    return make1(STAT, make3(ASSIGN, makeBool(true), target, value));
+  }
+
+  // Whether a statement moves the top of the stack, or checks it
+  static bool usesStackTop(Ref node) {
+    bool ret = false;
+    traversePre(node, [&](Ref node) {
+      if (node[0] == NAME && node[1] == STACKTOP) ret = true;
+    });
+    return ret;
+  }
+
+  // Finds the prologue of the function, which must stay, and its frame if it
+  // has one. A frame we add must be popped on the way out, and so must one
+  // that the function did not pop itself.
+  void findFrame() {
+    Ref stats = func[3];
+    firstIndex = 0;
+    while (firstIndex < stats->size() && (isEmpty(stats[firstIndex]) || stats[firstIndex][0] == VAR)) firstIndex++;
+    frameBase = 0;
+    bumpSize = Ref();
+    if (firstIndex < stats->size() && isAssignTo(stats[firstIndex], SP) && stats[firstIndex][1][3][0] == NAME && stats[firstIndex][1][3][1] == STACKTOP) {
+      ownFrame = false;
+      frame = SP;
+      frameIndex = ++firstIndex;
+      if (firstIndex < stats->size() && isAssignTo(stats[firstIndex], STACKTOP)) {
+        Ref value = stats[firstIndex][1][3];
+        if (value[0] == BINARY && value[1] == OR && value[2][0] == BINARY && value[2][1] == PLUS && value[2][3][0] == NUM) {
+          bumpSize = value[2][3];
+          frameBase = bumpSize[1]->getNumber();
+        }
+      }
+      // aligning the frame, bumping it and checking for overflow
+      while (firstIndex < stats->size() && (stats[firstIndex][0] == STAT || stats[firstIndex][0] == IF) && usesStackTop(stats[firstIndex])) firstIndex++;
+      addPops = true;
+      traversePre(func, [&](Ref node) {
+        if (node[0] == ASSIGN && node[2][0] == NAME && node[2][1] == STACKTOP && node[3][0] == NAME && node[3][1] == SP) addPops = false;
+      });
+    } else {
+      ownFrame = addPops = true;
+      frame = makeFreshName(OUTLINE_FRAME, [&](IString name) { return asmData->isLocal(name); });
+      frameIndex = firstIndex;
+    }
+  }
+
+  // Moves a run into a new function, if that is worth it
+  bool outline(Run& run, Flow& total) {
+    std::vector<Ref> stats;
+    if (!!run.single) {
+      stats.push_back(run.single);
+    } else {
+      for (size_t i = run.start; i < run.end; i++) stats.push_back(run.list[i]);
+    }
+
+    Flow inside(*asmData);
+    StringSet assigned, labels;
+    std::vector<Ref> escapes;
+    for (auto stat : stats) {
+      inside.walk(stat, assigned);
+      findEscapes(stat, false, false, labels, escapes);
+    }
+
+    // returns and breaks may leave before some outputs are written, and then
+    // they must keep their old values
+    std::vector<IString> ins, outs, vars;
+    auto addLocal = [&](IString name) {
+      bool read = inside.reads.count(name), written = inside.writes.count(name);
+      if (!read && !written) return;
+      if (name == code) {
+        // only ever checked right after the call that sets it
+        vars.push_back(name);
+        return;
+      }
+      bool out = written && (total.reads[name] > inside.reads[name] || (run.depth > 0 && inside.exposed.has(name)));
+      if (out) outs.push_back(name);
+      if (inside.exposed.has(name) || (out && (!escapes.empty() || !assigned.has(name)))) {
+        ins.push_back(name);
+      } else {
+        vars.push_back(name);
+      }
+    };
+    for (auto name : asmData->params) addLocal(name);
+    for (auto name : asmData->vars) addLocal(name);
+
+    // each kind of escape gets a code, and a return a slot for its value
+    std::vector<std::pair<IString, IString>> kinds;
+    std::vector<int> codes;
+    AsmType retType = ASM_NONE;
+    for (auto escape : escapes) {
+      std::pair<IString, IString> kind(escape[0]->getIString(), escape[0] != RETURN && !!escape[1] ? escape[1]->getIString() : IString());
+      size_t i = std::find(kinds.begin(), kinds.end(), kind) - kinds.begin();
+      if (i == kinds.size()) kinds.push_back(kind);
+      codes.push_back(i + 1);
+      if (escape[0] == RETURN && !!escape[1]) retType = detectType(escape[1], asmData);
+    }
+    bool needsScratch = !outs.empty() || retType != ASM_NONE;
+
+    size_t cost = 5 + ins.size() + 8 * outs.size() + 8 * kinds.size();
+    if (run.size < 2 * cost) return false;
+
+    auto usedInside = [&](IString name) {
+      return inside.reads.count(name) > 0 || inside.writes.count(name) > 0;
+    };
+    IString scratch = makeFreshName(OUTLINE_SCRATCH, usedInside);
+    if (!kinds.empty() && !code) {
+      code = makeFreshName(OUTLINE_CODE, [&](IString name) { return asmData->isLocal(name) || name == frame; });
+      asmData->addVar(code, ASM_INT);
+    }
+
+    // move the code out
+    Ref moved = makeArray(stats.size());
+    if (!!run.single) {
+      Ref copy = makeEmpty();
+      safeCopy(copy, run.single);
+      moved->push_back(copy);
+    } else {
+      for (auto stat : stats) moved->push_back(stat);
+    }
+    std::string str = std::string(func[1]->getIString().c_str()) + "$" + std::to_string(outlined++);
+    IString name(str.c_str(), str.c_str() + str.size());
+    Ref child = ValueBuilder::makeFunction(name);
+    AsmData childData;
+    childData.func = child;
+    childData.ret = kinds.empty() ? ASM_NONE : ASM_INT;
+    for (auto in : ins) {
+      childData.addParam(in, asmData->getType(in));
+      ValueBuilder::appendArgumentToFunction(child, in);
+    }
+    if (needsScratch) {
+      childData.addParam(scratch, ASM_INT);
+      ValueBuilder::appendArgumentToFunction(child, scratch);
+    }
+    for (auto var : vars) childData.addVar(var, asmData->getType(var));
+    // each way out stores the outputs and returns its code, so that no output is
+    // read on a path that did not pass where it was written, like the eliminator
+    // expects
+    auto storeOuts = [&](Ref block) {
+      for (size_t i = 0; i < outs.size(); i++) {
+        AsmType type = asmData->getType(outs[i]);
+        block->push_back(makeAssign(makeSlot(makeName(scratch), 8 * (i + 1), type), makeName(outs[i])));
+      }
+    };
+    for (size_t i = 0; i < escapes.size(); i++) {
+      Ref escape = escapes[i];
+      Ref block = makeBlock();
+      if (escape[0] == RETURN) {
+        // the caller returns right away, so the outputs are not needed
+        if (!!escape[1]) block[1]->push_back(makeAssign(makeSlot(makeName(scratch), 0, retType), escape[1]));
+      } else {
+        storeOuts(block[1]);
+      }
+      block[1]->push_back(make1(RETURN, makeNum(codes[i])));
+      safeCopy(escape, block);
+    }
+    Ref body = child[3];
+    for (auto stat : moved->getArray()) body->push_back(stat);
+    storeOuts(body);
+    if (!kinds.empty()) body->push_back(make1(RETURN, makeNum(0)));
+    childData.denormalize();
+    toplevel[1]->push_back(child);
+
+    // and call it
+    Ref call = ValueBuilder::makeCall(makeName(name));
+    for (auto in : ins) ValueBuilder::appendToCall(call, makeAsmCoercion(makeName(in), asmData->getType(in)));
+    if (needsScratch) {
+      if (ownFrame && !asmData->isLocal(frame)) asmData->addVar(frame, ASM_INT);
+      Ref ptr = frameBase > 0 ? make3(BINARY, PLUS, makeName(frame), makeNum(frameBase)) : makeName(frame);
+      ValueBuilder::appendToCall(call, makeAsmCoercion(ptr, ASM_INT));
+      scratchSize = std::max(scratchSize, 8 * (outs.size() + 1));
+    }
+    Ref replacement = makeBlock();
+    Ref list = replacement[1];
+    list->push_back(kinds.empty() ? make1(STAT, call) : makeAssign(makeName(code), makeAsmCoercion(call, ASM_INT)));
+    for (size_t i = 0; i < outs.size(); i++) {
+      AsmType type = asmData->getType(outs[i]);
+      list->push_back(makeAssign(makeName(outs[i]), makeAsmCoercion(makeSlot(makeName(frame), frameBase + 8 * (i + 1), type), type)));
+    }
+    for (size_t i = 0; i < kinds.size(); i++) {
+      Ref action;
+      if (kinds[i].first == RETURN) {
+        action = ValueBuilder::makeReturn(retType != ASM_NONE ? makeAsmCoercion(makeSlot(makeName(frame), frameBase, retType), retType) : Ref());
+      } else if (kinds[i].first == BREAK) {
+        action = ValueBuilder::makeBreak(kinds[i].second);
+      } else {
+        action = ValueBuilder::makeContinue(kinds[i].second);
+      }
+      list->push_back(ValueBuilder::makeIf(make3(BINARY, EQ, makeAsmCoercion(makeName(code), ASM_INT), makeNum(i + 1)), action, Ref()));
+    }
+    // keep the call together with what comes after it, as outlining between them
+    // would write the scratch area before we read it
+    if (list->size() == 1) replacement = list[0];
+    if (!!run.single) {
+      safeCopy(run.single, replacement);
+      replacement = run.single;
+    } else {
+      run.list->splice(run.start, run.end - run.start);
+      run.list->insert(run.start, replacement);
+    }
+    calls.insert(replacement.get());
+    return true;
+  }
+
+  // Adds the scratch area to the stack frame, or a frame if there was none
+  void addScratch() {
+    Ref stats = func[3];
+    size_t size = (scratchSize + 15) & -16;
+    if (!!bumpSize) {
+      bumpSize[1]->setNumber(frameBase + size);
+      return;
+    }
+    stats->insert(frameIndex, makeAssign(makeName(STACKTOP), make3(BINARY, OR, make3(BINARY, PLUS, makeName(STACKTOP), makeNum(size)), makeNum(0))));
+    if (ownFrame) stats->insert(frameIndex, makeAssign(makeName(frame), makeName(STACKTOP)));
+    if (!addPops) return;
+    bool fallsOut = stats->size() == 0 || stats->back()[0] != RETURN;
+    std::vector<Ref> returns;
+    traversePre(func, [&](Ref node) {
+      if (node[0] == RETURN) returns.push_back(node);
+    });
+    for (Ref node : returns) {
+      Ref block = makeBlock();
+      block[1]->push_back(makeAssign(makeName(STACKTOP), makeName(frame)));
+      block[1]->push_back(ValueBuilder::makeReturn(node[1]));
+      safeCopy(node, block);
+    }
+    if (fallsOut) {
+      stats->push_back(makeAssign(makeName(STACKTOP), makeName(frame)));
+    } else {
+      // keep the final return at the top level, where asm.js looks for it
+      Ref last = stats->pop_back();
+      for (auto s : last[1]->getArray()) stats->push_back(s);
+    }
+  }
+
+  void outlineFunction(Ref fun) {
+    func = fun;
+    if (func[1] == DCEABLE_TYPE_DECLS) return;
+    size_t size = 0;
+    traversePre(func, [&](Ref node) {
+      size++;
+    });
+    if (size <= sizeLimit) return;
+    AsmData data(func);
+    asmData = &data;
+    for (auto& local : data.locals) {
+      AsmType type = local.second.type;
+      if (type != ASM_INT && type != ASM_DOUBLE && type != ASM_FLOAT) return; // TODO: SIMD
+    }
+    findFrame();
+    scratchSize = 0;
+    code = IString();
+    outlined = 0;
+    calls.clear();
+    // a return type we need to keep, even if the final return moves out
+    if (data.ret == ASM_NONE) {
+      traversePre(func, [&](Ref node) {
+        if (node[0] == RETURN && !!node[1]) data.ret = detectType(node[1], &data);
+      });
+    }
+    for (size_t attempts = 3 * size / sizeLimit + 1; attempts > 0 && size > sizeLimit; attempts--) {
+      runs.clear();
+      Measure measure;
+      size = scan(func, 0, measure);
+      if (size <= sizeLimit) break;
+      // prefer runs outside of loops, and then big ones
+      std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) {
+        return a.depth != b.depth ? a.depth < b.depth : a.size > b.size;
+      });
+      Flow total(data);
+      StringSet assigned;
+      total.walk(func[3], assigned);
+      bool done = false;
+      for (size_t i = 0; i < runs.size() && i < 32 && !done; i++) done = outline(runs[i], total);
+      if (!done) break;
+    }
+    if (outlined == 0) {
+      data.denormalize();
+      return;
+    }
+    if (scratchSize > 0) addScratch();
+    // locals that were only used in code that moved out
+    Flow remaining(data);
+    StringSet assigned;
+    remaining.walk(func[3], assigned);
+    std::vector<IString> unused;
+    for (auto name : data.vars) {
+      if (!remaining.reads.count(name) && !remaining.writes.count(name)) unused.push_back(name);
+    }
+    for (auto name : unused) data.deleteVar(name);
+    data.denormalize();
+  }
+
+public:
+  Outliner(Ref ast, size_t sizeLimit) : sizeLimit(sizeLimit), toplevel(ast) {
+    minSize = std::max(sizeLimit / 16, size_t(10));
+    maxSize = sizeLimit * 9 / 10;
+    // the functions we add are about as big as the runs we move into them, which
+    // are under the limit, so we do not outline from them in turn
+    std::vector<Ref> funcs;
+    traverseFunctions(ast, [&](Ref func) {
+      funcs.push_back(func);
+    });
+    for (auto func : funcs) outlineFunction(func);
+  }
+};
+
+void outline(Ref ast) {
+  assert(!!extraInfo && extraInfo->isObject() && extraInfo->has(SIZE_TO_OUTLINE));
+  Outliner(ast, extraInfo[SIZE_TO_OUTLINE]->getInteger());
+}
+
+// Converts a heap index into an absolute address, for safeHeap
+static Ref fixSafeHeapPtr(Ref ptr, IString heap) {
+  int shift;
+  if (heap == HEAP8 || heap == HEAPU8) shift = 0;
+  else if (heap == HEAP16 || heap == HEAPU16) shift = 1;
+  else if (heap == HEAP32 || heap == HEAPU32 || heap == HEAPF32) shift = 2;
+  else if (heap == HEAPF64) shift = 3;
+  else return ptr; // unchanged
+  if (shift > 0) {
+    if (ptr[0] == BINARY && ptr[1] == RSHIFT && ptr[3][0] == NUM && ptr[3][1]->getNumber() == shift) {
+      ptr = ptr[2]; // skip the shift
+    } else {
+      ptr = make3(BINARY, MUL, ptr, makeNum(1 << shift)); // was unshifted, convert to absolute address
+    }
+  }
+  return make3(BINARY, OR, ptr, makeNum(0));
+}
+
+static int heapBytes(IString heap) {
+  if (heap == HEAP8 || heap == HEAPU8) return 1;
+  if (heap == HEAP16 || heap == HEAPU16) return 2;
+  if (heap == HEAP32 || heap == HEAPU32 || heap == HEAPF32) return 4;
+  if (heap == HEAPF64) return 8;
+  return 0;
+}
+
+// Finds heap accesses that need no SAFE_HEAP check, because an earlier access in
+// the same basic block already checked a range of memory that contains them:
+// the same base variable, not assigned in between, at an offset that keeps the
+// alignment. Calls end the block, as they can move the top of the heap.
+class RedundantHeapChecks {
+  struct Access {
+    IString base;
+    double offset;
+    int bytes;
+  };
+  typedef std::vector<Access> Checked;
+
+  std::unordered_set<Value*>& redundant;
+
+  // Returns whether an access is of the form base + constant, and what they are
+  static bool parseAccess(Ref node, IString heap, Access& access) {
+    access.bytes = heapBytes(heap);
+    if (!access.bytes) return false;
+    int shift = access.bytes == 1 ? 0 : access.bytes == 2 ? 1 : access.bytes == 4 ? 2 : 3;
+    Ref ptr = node;
+    if (ptr[0] == BINARY && ptr[1] == RSHIFT && ptr[3][0] == NUM && ptr[3][1]->getNumber() == shift) {
+      ptr = ptr[2];
+    } else if (shift > 0) {
+      return false;
+    }
+    access.offset = 0;
+    if (ptr[0] == BINARY && ptr[1] == PLUS) {
+      if (ptr[2][0] == NAME && ptr[3][0] == NUM) {
+        access.offset = ptr[3][1]->getNumber();
+        ptr = ptr[2];
+      } else if (ptr[2][0] == NUM && ptr[3][0] == NAME) {
+        access.offset = ptr[2][1]->getNumber();
+        ptr = ptr[3];
+      } else {
+        return false;
+      }
+    }
+    if (ptr[0] != NAME) return false;
+    access.base = ptr[1]->getIString();
+    return true;
+  }
+
+  // Notes an access as checked, and returns whether an earlier check covered it
+  static bool check(Checked& checked, const Access& access) {
+    for (auto& prev : checked) {
+      if (prev.base == access.base && access.bytes <= prev.bytes && access.offset >= prev.offset &&
+          access.offset + access.bytes <= prev.offset + prev.bytes &&
+          fmod(access.offset - prev.offset, access.bytes) == 0) {
+        return true;
+      }
+    }
+    if (checked.size() < 64) checked.push_back(access);
+    return false;
+  }
+
+  static void kill(Checked& checked, IString name) {
+    checked.erase(std::remove_if(checked.begin(), checked.end(), [&](const Access& access) {
+      return access.base == name;
+    }), checked.end());
+  }
+
+  static bool assigns(Ref node, IString name) {
+    bool ret = false;
+    traversePre(node, [&](Ref node) {
+      if (node[0] == ASSIGN && node[2][0] == NAME && node[2][1] == name) ret = true;
+    });
+    return ret;
+  }
+
+  // A store is checked after its value is evaluated, which may assign the base of its
+  // address. Then it is relative to the old value of the base, which nothing else can be.
+  void heapAccess(Ref node, Ref index, Checked& checked, Ref target, Ref value=Ref()) {
+    Access access;
+    if (!parseAccess(index, node[0] == ASSIGN ? target[1][1]->getIString() : node[1][1]->getIString(), access)) return;
+    if (!!value && assigns(value, access.base)) return;
+    if (check(checked, access)) {
+      redundant.insert(node.get());
+      if (!!target) redundant.insert(target.get());
+    }
+  }
+
+  // Expressions, in the order they are evaluated
+  void expression(Ref node, Checked& checked) {
+    if (!node->isArray() || node->size() == 0) return;
+    IString type = node[0]->getIString();
+    if (type == NAME || type == NUM || type == STRING) {
+      return;
+    } else if (type == SUB) {
+      expression(node[2], checked);
+      if (node[1][0] == NAME && HEAP_NAMES.has(node[1][1]->getIString())) heapAccess(node, node[2], checked, Ref());
+    } else if (type == ASSIGN) {
+      Ref target = node[2];
+      if (!node[1]->isBool() || !node[1]->getBool()) {
+        checked.clear();
+      } else if (target[0] == SUB && target[1][0] == NAME && HEAP_NAMES.has(target[1][1]->getIString())) {
+        // the address is evaluated before the value, and the store is checked after both
+        expression(target[2], checked);
+        expression(node[3], checked);
+        heapAccess(node, target[2], checked, target, node[3]);
+      } else if (target[0] == NAME) {
+        expression(node[3], checked);
+        kill(checked, target[1]->getIString());
+      } else {
+        checked.clear();
+      }
+    } else if (type == CALL) {
+      expression(node[1], checked);
+      for (auto arg : node[2]->getArray()) expression(arg, checked);
+      checked.clear();
+    } else if (type == CONDITIONAL) {
+      expression(node[1], checked);
+      Checked ifTrue = checked, ifFalse = checked;
+      expression(node[2], ifTrue);
+      expression(node[3], ifFalse);
+      checked.clear();
+    } else if (type == BINARY || type == UNARY_PREFIX || type == SEQ) {
+      for (size_t i = 1; i < node->size(); i++) expression(node[i], checked);
+    } else {
+      checked.clear();
+    }
+  }
+
+  void statements(Ref stats, Checked& checked) {
+    if (!stats) return;
+    for (auto stat : stats->getArray()) statement(stat, checked);
+  }
+
+  void statement(Ref node, Checked& checked) {
+    if (!node->isArray() || node->size() == 0) return;
+    IString type = node[0]->getIString();
+    if (type == STAT) {
+      expression(node[1], checked);
+    } else if (type == RETURN) {
+      if (!!node[1]) expression(node[1], checked);
+    } else if (type == VAR) {
+      for (auto var : node[1]->getArray()) {
+        if (var->size() > 1 && !!var[1]) expression(var[1], checked);
+        kill(checked, var[0]->getIString());
+      }
+    } else if (type == BLOCK) {
+      statements(getStatements(node), checked);
+    } else if (type == IF) {
+      // each branch continues the block of the condition, and a new block begins after them
+      expression(node[1], checked);
+      Checked ifTrue = checked;
+      statement(node[2], ifTrue);
+      if (node->size() > 3 && !!node[3]) {
+        Checked ifFalse = checked;
+        statement(node[3], ifFalse);
+      }
+      checked.clear();
+    } else if (type == DO && node[1][0] == NUM && node[1][1]->getNumber() == 0) {
+      // a one-time loop continues the block
+      statement(node[2], checked);
+      checked.clear();
+    } else if (type == WHILE || type == DO) {
+      Checked cond, body;
+      expression(node[1], cond);
+      statement(node[2], body);
+      checked.clear();
+    } else if (type == SWITCH) {
+      expression(node[1], checked);
+      for (auto c : node[2]->getArray()) {
+        Checked body; // cases can be entered by falling through from the previous one
+        statements(c[1], body);
+      }
+      checked.clear();
+    } else if (type == LABEL) {
+      checked.clear(); // breaks and continues can enter it
+      statement(node[2], checked);
+      checked.clear();
+    } else {
+      checked.clear();
+    }
+  }
+
+public:
+  RedundantHeapChecks(Ref func, std::unordered_set<Value*>& redundant) : redundant(redundant) {
+    Checked checked;
+    statements(getStatements(func), checked);
+  }
+};
+
+// Turns heap accesses into calls to the SAFE_HEAP_* runtime checks, and masks of
+// function table indexes into calls to SAFE_FT_MASK. With skipRedundant, accesses
+// that an earlier check in the same basic block covers are left as they are.
+void safeHeap(Ref ast, bool skipRedundant) {
+  IString SAFE_HEAP_LOAD("SAFE_HEAP_LOAD"), SAFE_HEAP_LOAD_D("SAFE_HEAP_LOAD_D"), SAFE_HEAP_STORE("SAFE_HEAP_STORE"),
+          SAFE_HEAP_STORE_D("SAFE_HEAP_STORE_D"), SAFE_FT_MASK("SAFE_FT_MASK");
+  StringSet SAFE_HEAP_FUNCS("SAFE_HEAP_LOAD SAFE_HEAP_LOAD_D SAFE_HEAP_STORE SAFE_HEAP_STORE_D SAFE_FT_MASK");
+  auto makeCall = [](IString target, Ref a, Ref b, Ref c) {
+    Ref args = makeArray(3);
+    args->push_back(a);
+    args->push_back(b);
+    if (!!c) args->push_back(c);
+    return make2(CALL, makeName(target), args);
+  };
+  traverseFunctions(ast, [&](Ref func) {
+    if (SAFE_HEAP_FUNCS.has(func[1]->getIString())) return;
+    std::unordered_set<Value*> redundant;
+    if (skipRedundant) RedundantHeapChecks(func, redundant);
+    traversePre(func, [&](Ref node) {
+      if (!redundant.empty() && redundant.count(node.get())) return;
+      if (node[0] == ASSIGN) {
+        if (node[1]->isBool() && node[1]->getBool() && node[2][0] == SUB) {
+          IString heap = node[2][1][1]->getIString();
+          Ref ptr = fixSafeHeapPtr(node[2][2], heap);
+          Ref value = node[3];
+          // SAFE_HEAP_STORE(ptr, value, bytes)
+          Ref call;
+          if (heap == HEAP8 || heap == HEAPU8) call = makeCall(SAFE_HEAP_STORE, ptr, makeAsmCoercion(value, ASM_INT), makeNum(1));
+          else if (heap == HEAP16 || heap == HEAPU16) call = makeCall(SAFE_HEAP_STORE, ptr, makeAsmCoercion(value, ASM_INT), makeNum(2));
+          else if (heap == HEAP32 || heap == HEAPU32) call = makeCall(SAFE_HEAP_STORE, ptr, makeAsmCoercion(value, ASM_INT), makeNum(4));
+          else if (heap == HEAPF32) call = makeCall(SAFE_HEAP_STORE_D, ptr, makeAsmCoercion(value, ASM_DOUBLE), makeNum(4));
+          else if (heap == HEAPF64) call = makeCall(SAFE_HEAP_STORE_D, ptr, makeAsmCoercion(value, ASM_DOUBLE), makeNum(8));
+          else {
+            fprintf(stderr, "bad heap %s\n", heap.c_str());
+            abort();
+          }
+          safeCopy(node, call);
+        }
+      } else if (node[0] == SUB && node[1][0] == NAME) {
+        IString target = node[1][1]->getIString();
+        if (target.c_str()[0] == 'H') {
+          // heap access
+          IString heap = target;
+          Ref ptr = fixSafeHeapPtr(node[2], heap);
+          // SAFE_HEAP_LOAD(ptr, bytes, unsigned)
+          Ref call;
+          if (heap == HEAP8) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(1), makeNum(0)), ASM_INT);
+          else if (heap == HEAPU8) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(1), makeNum(1)), ASM_INT);
+          else if (heap == HEAP16) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(2), makeNum(0)), ASM_INT);
+          else if (heap == HEAPU16) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(2), makeNum(1)), ASM_INT);
+          else if (heap == HEAP32) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(4), makeNum(0)), ASM_INT);
+          else if (heap == HEAPU32) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD, ptr, makeNum(4), makeNum(1)), ASM_INT);
+          else if (heap == HEAPF32) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD_D, ptr, makeNum(4), Ref()), ASM_DOUBLE);
+          else if (heap == HEAPF64) call = makeAsmCoercion(makeCall(SAFE_HEAP_LOAD_D, ptr, makeNum(8), Ref()), ASM_DOUBLE);
+          else {
+            fprintf(stderr, "bad heap %s\n", heap.c_str());
+            abort();
+          }
+          safeCopy(node, call);
+        } else {
+          assert(target.c_str()[0] == 'F');
+          // function table indexing mask
+          assert(node[2][0] == BINARY && node[2][1] == AND);
+          node[2][2] = makeAsmCoercion(makeCall(SAFE_FT_MASK, makeAsmCoercion(node[2][2], ASM_INT), makeAsmCoercion(node[2][3], ASM_INT), Ref()), ASM_INT);
+        }
+      }
+    });
+  });
+}
+
+// Converts a heap index into an absolute address, for splitMemory. Byte
+// addresses are kept as they are, as the split memory accessors coerce them.
+static Ref fixSplitMemoryPtr(Ref ptr, IString heap) {
+  int shift;
+  if (heap == HEAP8 || heap == HEAPU8) shift = 0;
+  else if (heap == HEAP16 || heap == HEAPU16) shift = 1;
+  else if (heap == HEAP32 || heap == HEAPU32 || heap == HEAPF32) shift = 2;
+  else if (heap == HEAPF64) shift = 3;
+  else {
+    fprintf(stderr, "bad heap %s\n", heap.c_str());
+    abort();
+  }
+  if (ptr[0] == BINARY && ptr[1] == RSHIFT && ptr[3][0] == NUM && ptr[3][1]->getNumber() == shift) {
+    if (shift == 0) return make3(BINARY, OR, ptr[2], makeNum(0)); // smaller
+    return ptr[2]; // skip the shift
+  }
+  if (shift == 0) return ptr;
+  return make3(BINARY, MUL, ptr, makeNum(1 << shift)); // was unshifted, convert to absolute address
+}
+
+// Turns heap accesses into calls to the split memory accessors (get8, set8, etc.)
+void splitMemory(Ref ast) {
+  StringStringMap GETS, SETS;
+  for (auto heap : { HEAP8, HEAP16, HEAP32, HEAPU8, HEAPU16, HEAPU32, HEAPF32, HEAPF64 }) {
+    std::string suffix = heap.c_str() + 4;
+    GETS[heap] = IString(("get" + suffix).c_str());
+    SETS[heap] = IString(("set" + suffix).c_str());
+  }
+  StringSet SPLIT_GETS("get8 get16 get32 getU8 getU16 getU32 getF32 getF64");
+  traverseFunctions(ast, [&](Ref func) {
+    traversePre(func, [&](Ref node) {
+      if (node[0] == ASSIGN) {
+        Ref target = node[2];
+        if (target[0] == SUB && target[1][0] == NAME && HEAP_NAMES.has(target[1][1]->getIString())) {
+          if (!node[1]->isBool() || !node[1]->getBool()) {
+            fprintf(stderr, "bad assign, split memory cannot handle a compound assignment to a HEAP\n");
+            abort();
+          }
+          IString heap = target[1][1]->getIString();
+          Ref args = makeArray(2);
+          args->push_back(fixSplitMemoryPtr(target[2], heap));
+          args->push_back(node[3]);
+          safeCopy(node, make2(CALL, makeName(SETS[heap]), args));
+        }
+      } else if (node[0] == SUB && node[1][0] == NAME) {
+        IString heap = node[1][1]->getIString();
+        if (heap.c_str()[0] == 'H') {
+          if (!HEAP_NAMES.has(heap)) {
+            fprintf(stderr, "bad heap %s\n", heap.c_str());
+            abort();
+          }
+          Ref args = makeArray(1);
+          args->push_back(fixSplitMemoryPtr(node[2], heap));
+          safeCopy(node, make2(CALL, makeName(GETS[heap]), args));
+        }
+      }
+    });
+    // the accessors return coerced values
+    traversePre(func, [&](Ref node) {
+      while (true) {
+        Ref inner;
+        if (node[0] == BINARY && node[1] == OR && node[3][0] == NUM && node[3][1]->getNumber() == 0) inner = node[2];
+        else if (node[0] == UNARY_PREFIX && node[1] == PLUS) inner = node[2];
+        else break;
+        if (inner[0] != CALL || inner[1][0] != NAME || !SPLIT_GETS.has(inner[1][1]->getIString())) break;
+        safeCopy(node, inner);
+      }
+    });
+  });
+}
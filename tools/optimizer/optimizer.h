@@ -7,12 +7,27 @@
 extern bool preciseF32,
             receiveJSON,
             emitJSON,
+            receiveBinary,
+            emitBinary,
             minifyWhitespace,
             last;
 
-extern cashew::Ref extraInfo;
+extern cashew::Ref extraInfo,
+                   outputInfo;
+
+extern int numThreads;
 
 void eliminateDeadFuncs(cashew::Ref ast);
+void pruneFunctions(cashew::Ref ast);
+void instrumentFunctionOrder(cashew::Ref ast);
+void instrumentShadowStack(cashew::Ref ast);
+void devirtualize(cashew::Ref ast);
+void outline(cashew::Ref ast);
+void minifyGlobals(cashew::Ref ast);
+void findReachable(cashew::Ref ast);
+void dumpCallGraph(cashew::Ref ast);
+void safeHeap(cashew::Ref ast, bool skipRedundant=false);
+void splitMemory(cashew::Ref ast);
 void eliminate(cashew::Ref ast, bool memSafe=false);
 void eliminateMemSafe(cashew::Ref ast);
 void simplifyExpressions(cashew::Ref ast);
@@ -22,6 +37,9 @@ void registerize(cashew::Ref ast);
 void registerizeHarder(cashew::Ref ast);
 void minifyLocals(cashew::Ref ast);
 void asmLastOpts(cashew::Ref ast);
+void inlineSmallFunctions(cashew::Ref ast);
+void hoistLoopInvariants(cashew::Ref ast);
+void localCSE(cashew::Ref ast);
 
 //
 
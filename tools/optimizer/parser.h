@@ -7,6 +7,7 @@
 #define __parser_h__
 
 #include <vector>
+#include <string>
 #include <iostream>
 #include <algorithm>
 
@@ -205,14 +206,7 @@ class Parser {
         while (isIdentPart(*src)) {
           src++;
         }
-        if (*src == 0) {
-          str.set(start);
-        } else {
-          char temp = *src;
-          *src = 0;
-          str.set(start, false);
-          *src = temp;
-        }
+        str.set(start, src);
         type = keywords.has(str) ? KEYWORD : IDENT;
       } else if (isDigit(*src) || (src[0] == '.' && isDigit(src[1]))) {
         if (src[0] == '0' && (src[1] == 'x' || src[1] == 'X')) {
@@ -270,15 +264,40 @@ class Parser {
         return;
       } else if (hasChar(SEPARATORS, *src)) {
         type = SEPARATOR;
-        char temp = src[1];
-        src[1] = 0;
-        str.set(src, false);
-        src[1] = temp;
+        str.set(src, src + 1);
         src++;
       } else if (*src == '"' || *src == '\'') {
-        char *end = strchr(src+1, *src);
-        *end = 0;
-        str.set(src+1);
+        // strings are kept escaped as in a double-quoted string, so a single-quoted
+        // one with a " in it, or anything with an escaped ', is rewritten
+        char quote = *src;
+        char *end = src+1;
+        bool rewrite = false;
+        while (*end != quote) {
+          assert(*end);
+          if (*end == '\\') {
+            if (end[1] == '\'') rewrite = true;
+            end++; // an escaped character, which may be a quote
+          } else if (*end == '"') {
+            rewrite = true;
+          }
+          end++;
+        }
+        if (rewrite) {
+          std::string escaped;
+          for (char *curr = src+1; curr < end; curr++) {
+            if (*curr == '\\') {
+              if (curr[1] != '\'') escaped += *curr;
+              escaped += *++curr;
+            } else {
+              if (*curr == '"') escaped += '\\';
+              escaped += *curr;
+            }
+          }
+          str.set(escaped.c_str(), escaped.c_str() + escaped.size());
+        } else {
+          *end = 0;
+          str.set(src+1);
+        }
         src = end+1;
         type = STRING;
       } else {
@@ -428,14 +447,14 @@ class Parser {
       }
       Builder::appendToVar(ret, name.str, value);
       skipSpace(src);
-      if (*src == ';') break;
+      if (*src == ';' || *src == 0) break; // the last statement in a file may omit its ;
       if (*src == ',') {
         src++;
         continue;
       }
       abort();
     }
-    src++;
+    if (*src) src++;
     return ret;
   }
 
@@ -647,6 +666,8 @@ class Parser {
       abort();
     }
     src++;
+    assert(expressionPartsStack.back().size() == 0);
+    expressionPartsStack.pop_back();
     return ret;
   }
 
@@ -664,7 +685,7 @@ class Parser {
       assert(*src == ':');
       src++;
       NodeRef value = parseElement(src, ",}");
-      Builder::appendToObject(ret, key.str, value);
+      Builder::appendToObject(ret, key.str, value, key.type == STRING);
       skipSpace(src);
       if (*src == '}') break;
       if (*src == ',') {
@@ -674,6 +695,8 @@ class Parser {
       abort();
     }
     src++;
+    assert(expressionPartsStack.back().size() == 0);
+    expressionPartsStack.pop_back();
     return ret;
   }
 
@@ -910,6 +933,24 @@ public:
     Builder::setBlockContent(toplevel, parseBlock(src));
     return toplevel;
   }
+
+  // Streaming alternative to parseToplevel: call startToplevel once, then
+  // parseToplevelElement returns one toplevel element at a time, and a null
+  // node at the end of the input.
+  void startToplevel(char* src) {
+    allSource = src;
+    allSize = strlen(src);
+  }
+
+  NodeRef parseToplevelElement(char*& src) {
+    while (1) {
+      skipSpace(src);
+      if (*src == 0) return NodeRef();
+      if (*src != ';') break;
+      src++; // skip an empty statement
+    }
+    return parseElementOrStatement(src, ";");
+  }
 };
 
 } // namespace cashew
@@ -1,4 +1,8 @@
 
+#include <ctype.h>
+#include <stdint.h>
+#include <cmath>
+
 #include "simple_ast.h"
 
 namespace cashew {
@@ -39,22 +43,41 @@ bool Ref::operator!() {
 
 // Arena
 
-Arena arena;
+thread_local Arena arena;
 
-Ref Arena::alloc() {
-  if (chunks.size() == 0 || index == CHUNK_SIZE) {
-    chunks.push_back(new Value[CHUNK_SIZE]);
-    index = 0;
-  }
-  return &chunks.back()[index++];
+Ref Arena::allocSlow() {
+  if (chunk == chunks.size()) chunks.push_back(new Value[CHUNK_SIZE]);
+  chunk++;
+  index = 0;
+  return &chunks[chunk-1][index++];
+}
+
+ArrayStorage* Arena::allocArraySlow() {
+  if (arr_chunk == arr_chunks.size()) arr_chunks.push_back(new ArrayStorage[CHUNK_SIZE]);
+  arr_chunk++;
+  arr_index = 0;
+  return &arr_chunks[arr_chunk-1][arr_index++];
 }
 
-ArrayStorage* Arena::allocArray() {
-  if (arr_chunks.size() == 0 || arr_index == CHUNK_SIZE) {
-    arr_chunks.push_back(new ArrayStorage[CHUNK_SIZE]);
-    arr_index = 0;
+void Arena::rewind(const Mark& m) {
+  // free values first, as they clear their arrays
+  for (size_t c = m.chunk > 0 ? m.chunk-1 : 0; c < chunk; c++) {
+    int start = c+1 == m.chunk ? m.index : 0;
+    int end = c+1 == chunk ? index : CHUNK_SIZE;
+    for (int i = start; i < end; i++) chunks[c][i].free();
+  }
+  for (size_t c = m.arr_chunk > 0 ? m.arr_chunk-1 : 0; c < arr_chunk; c++) {
+    int start = c+1 == m.arr_chunk ? m.arr_index : 0;
+    int end = c+1 == arr_chunk ? arr_index : CHUNK_SIZE;
+    for (int i = start; i < end; i++) {
+      arr_chunks[c][i].clear();
+      arr_chunks[c][i].shrink_to_fit();
+    }
   }
-  return &arr_chunks.back()[arr_index++];
+  chunk = m.chunk;
+  index = m.index;
+  arr_chunk = m.arr_chunk;
+  arr_index = m.arr_index;
 }
 
 // dump
@@ -66,189 +89,185 @@ void dump(const char *str, Ref node, bool pretty) {
   std::cerr << std::endl;
 }
 
-// AST traversals
+// Binary AST
 
-// Traversals
-
-struct TraverseInfo {
-  TraverseInfo() {}
-  TraverseInfo(Ref node, ArrayStorage* arr) : node(node), arr(arr), index(0) {}
-  Ref node;
-  ArrayStorage* arr;
-  int index;
-};
-
-template <class T, int init>
-struct StackedStack { // a stack, on the stack
-  T stackStorage[init];
-  T* storage;
-  int used, available; // used amount, available amount
-  bool alloced;
-
-  StackedStack() : used(0), available(init), alloced(false) {
-    storage = stackStorage;
-  }
-  ~StackedStack() {
-    if (alloced) free(storage);
+static unsigned readVarint(char*& curr) {
+  unsigned ret = 0, shift = 0;
+  while (1) {
+    unsigned char c = *curr++;
+    assert(c >= 0x40 && c < 0x80);
+    ret |= unsigned(c & 31) << shift;
+    if (c < 0x60) return ret;
+    shift += 5;
   }
+}
 
-  int size() { return used; }
-
-  void push_back(const T& t) {
-    assert(used <= available);
-    if (used == available) {
-      available *= 2;
-      if (!alloced) {
-        T* old = storage;
-        storage = (T*)malloc(sizeof(T)*available);
-        memcpy(storage, old, sizeof(T)*used);
-        alloced = true;
-      } else {
-        T *newStorage = (T*)realloc(storage, sizeof(T)*available);
-        assert(newStorage);
-        storage = newStorage;
+static Ref parseBinaryNode(char*& curr, std::vector<IString>& strings) {
+  Ref ret = arena.alloc();
+  switch (*curr++) {
+    case '(': {
+      unsigned size = readVarint(curr);
+      ret->setArray(size);
+      for (unsigned i = 0; i < size; i++) ret->push_back(parseBinaryNode(curr, strings));
+      break;
+    }
+    case '$': {
+      unsigned index = readVarint(curr);
+      assert(index < strings.size());
+      ret->setString(strings[index]);
+      break;
+    }
+    case '#': ret->setNumber(readVarint(curr)); break;
+    case '.': {
+      uint64_t lo = readVarint(curr), hi = readVarint(curr);
+      uint64_t bits = lo | (hi << 32);
+      double num;
+      memcpy(&num, &bits, sizeof(num));
+      ret->setNumber(num);
+      break;
+    }
+    case ':': {
+      unsigned size = readVarint(curr);
+      ret->setObject();
+      for (unsigned i = 0; i < size; i++) {
+        unsigned index = readVarint(curr);
+        assert(index < strings.size());
+        (*ret)[strings[index]] = parseBinaryNode(curr, strings);
       }
+      break;
+    }
+    case '0': ret->setNull(); break;
+    case '1': ret->setBool(false); break;
+    case '2': ret->setBool(true); break;
+    default: {
+      errv("bad binary AST node tag: %d", int(curr[-1]));
+      abort();
     }
-    assert(used < available);
-    assert(storage);
-    storage[used++] = t;
-  }
-
-  T& back() {
-    assert(used > 0);
-    return storage[used-1];
   }
+  return ret;
+}
 
-  void pop_back() {
-    assert(used > 0);
-    used--;
+Ref parseBinaryAst(char*& src) {
+  while (*src && isspace(*src)) src++;
+  assert(strncmp(src, "EMAST", 5) == 0);
+  src += 5;
+  unsigned num = readVarint(src);
+  std::vector<IString> strings;
+  strings.reserve(num);
+  for (unsigned i = 0; i < num; i++) {
+    char *start = src;
+    while (*src != '"') {
+      assert(*src);
+      if (*src == '\\') src++; // an escaped character, which may be a quote
+      src++;
+    }
+    strings.push_back(IString(start, src));
+    src++;
   }
-};
+  return parseBinaryNode(src, strings);
+}
 
-#define visitable(node) (node->isArray() && node->size() > 0)
+namespace {
 
-#define TRAV_STACK 40
+struct BinaryAstWriter {
+  std::string out;
+  std::unordered_map<IString, unsigned> stringIndexes;
+  std::vector<IString> strings;
 
-// Traverse, calling visit before the children
-void traversePre(Ref node, std::function<void (Ref)> visit) {
-  if (!visitable(node)) return;
-  visit(node);
-  StackedStack<TraverseInfo, TRAV_STACK> stack;
-  int index = 0;
-  ArrayStorage* arr = &node->getArray();
-  int arrsize = (int)arr->size();
-  Ref* arrdata = arr->data();
-  stack.push_back(TraverseInfo(node, arr));
-  while (1) {
-    if (index < arrsize) {
-      Ref sub = *(arrdata+index);
-      index++;
-      if (visitable(sub)) {
-        stack.back().index = index;
-        index = 0;
-        visit(sub);
-        arr = &sub->getArray();
-        arrsize = (int)arr->size();
-        arrdata = arr->data();
-        stack.push_back(TraverseInfo(sub, arr));
-      }
-    } else {
-      stack.pop_back();
-      if (stack.size() == 0) break;
-      TraverseInfo& back = stack.back();
-      index = back.index;
-      arr = back.arr;
-      arrsize = (int)arr->size();
-      arrdata = arr->data();
+  void varint(unsigned x) {
+    while (x >= 32) {
+      out += char(0x60 | (x & 31));
+      x >>= 5;
     }
+    out += char(0x40 | x);
   }
-}
 
-// Traverse, calling visitPre before the children and visitPost after
-void traversePrePost(Ref node, std::function<void (Ref)> visitPre, std::function<void (Ref)> visitPost) {
-  if (!visitable(node)) return;
-  visitPre(node);
-  StackedStack<TraverseInfo, TRAV_STACK> stack;
-  int index = 0;
-  ArrayStorage* arr = &node->getArray();
-  int arrsize = (int)arr->size();
-  Ref* arrdata = arr->data();
-  stack.push_back(TraverseInfo(node, arr));
-  while (1) {
-    if (index < arrsize) {
-      Ref sub = *(arrdata+index);
-      index++;
-      if (visitable(sub)) {
-        stack.back().index = index;
-        index = 0;
-        visitPre(sub);
-        arr = &sub->getArray();
-        arrsize = (int)arr->size();
-        arrdata = arr->data();
-        stack.push_back(TraverseInfo(sub, arr));
-      }
-    } else {
-      visitPost(stack.back().node);
-      stack.pop_back();
-      if (stack.size() == 0) break;
-      TraverseInfo& back = stack.back();
-      index = back.index;
-      arr = back.arr;
-      arrsize = (int)arr->size();
-      arrdata = arr->data();
+  void string(IString str) {
+    auto it = stringIndexes.find(str);
+    if (it != stringIndexes.end()) {
+      varint(it->second);
+      return;
     }
+    unsigned index = strings.size();
+    stringIndexes[str] = index;
+    strings.push_back(str);
+    varint(index);
   }
-}
 
-// Traverse, calling visitPre before the children and visitPost after. If pre returns false, do not traverse children
-void traversePrePostConditional(Ref node, std::function<bool (Ref)> visitPre, std::function<void (Ref)> visitPost) {
-  if (!visitable(node)) return;
-  if (!visitPre(node)) return;
-  StackedStack<TraverseInfo, TRAV_STACK> stack;
-  int index = 0;
-  ArrayStorage* arr = &node->getArray();
-  int arrsize = (int)arr->size();
-  Ref* arrdata = arr->data();
-  stack.push_back(TraverseInfo(node, arr));
-  while (1) {
-    if (index < arrsize) {
-      Ref sub = *(arrdata+index);
-      index++;
-      if (visitable(sub)) {
-        if (visitPre(sub)) {
-          stack.back().index = index;
-          index = 0;
-          arr = &sub->getArray();
-          arrsize = (int)arr->size();
-          arrdata = arr->data();
-          stack.push_back(TraverseInfo(sub, arr));
+  void node(Ref node) {
+    if (!node) { // a missing child is null, as in JSON
+      out += '0';
+      return;
+    }
+    Value& v = *node;
+    switch (v.type) {
+      case Value::Array: {
+        out += '(';
+        varint(v.arr->size());
+        for (auto child : *v.arr) this->node(child);
+        break;
+      }
+      case Value::String: {
+        out += '$';
+        string(v.str);
+        break;
+      }
+      case Value::Number: {
+        double num = v.num;
+        if (num >= 0 && num < 4294967296.0 && num == double(unsigned(num)) && !std::signbit(num)) {
+          out += '#';
+          varint(unsigned(num));
+        } else {
+          uint64_t bits;
+          memcpy(&bits, &num, sizeof(bits));
+          out += '.';
+          varint(unsigned(bits));
+          varint(unsigned(bits >> 32));
+        }
+        break;
+      }
+      case Value::Object: {
+        out += ':';
+        varint(v.obj->size());
+        for (auto& i : *v.obj) {
+          string(i.first);
+          this->node(i.second);
         }
+        break;
       }
-    } else {
-      visitPost(stack.back().node);
-      stack.pop_back();
-      if (stack.size() == 0) break;
-      TraverseInfo& back = stack.back();
-      index = back.index;
-      arr = back.arr;
-      arrsize = (int)arr->size();
-      arrdata = arr->data();
+      case Value::Null: out += '0'; break;
+      case Value::Bool: out += v.boo ? '2' : '1'; break;
     }
   }
-}
+};
 
-// Traverses all the top-level functions in the document
-void traverseFunctions(Ref ast, std::function<void (Ref)> visit) {
-  if (!ast || ast->size() == 0) return;
-  if (ast[0] == TOPLEVEL) {
-    Ref stats = ast[1];
-    for (size_t i = 0; i < stats->size(); i++) {
-      Ref curr = stats[i];
-      if (curr[0] == DEFUN) visit(curr);
+} // anonymous namespace
+
+void stringifyBinaryAst(Ref node, std::ostream &os) {
+  BinaryAstWriter writer;
+  writer.node(node);
+  // the string table goes first, but is only known after the nodes are written
+  std::string nodes;
+  std::swap(nodes, writer.out);
+  writer.out = "EMAST";
+  writer.varint(writer.strings.size());
+  for (auto& str : writer.strings) {
+    for (const char *curr = str.str; *curr; curr++) {
+      if (*curr == '\\') {
+        writer.out += '\\';
+        if (!curr[1]) { // a trailing backslash would escape the terminator
+          writer.out += '\\';
+          break;
+        }
+        writer.out += *++curr;
+      } else {
+        if (*curr == '"') writer.out += '\\';
+        writer.out += *curr;
+      }
     }
-  } else if (ast[0] == DEFUN) {
-    visit(ast);
+    writer.out += '"';
   }
+  os << writer.out << nodes;
 }
 
 // ValueBuilder
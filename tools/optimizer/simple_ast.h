@@ -56,25 +56,162 @@ struct Ref {
   bool operator!(); // check if null, in effect
 };
 
-// Arena allocation, free it all on process exit
+// Arena allocation, free it all on process exit, or rewind it to an earlier
+// mark when everything allocated since is no longer reachable. There is one
+// arena per thread, so passes can allocate nodes from several threads at once;
+// nodes stay valid after the thread that allocated them exits.
 
-typedef std::vector<Ref> ArrayStorage;
+// Storage for the children of an array node. The first few children are kept
+// inline, which covers most AST nodes (e.g. ["binary", op, left, right]), so
+// walking the tree touches one allocation per node instead of two. Only the
+// subset of the std::vector API that we use is provided. Refs are plain
+// pointers, so they are moved around with memcpy/memmove.
+
+class ArrayStorage {
+  enum { INLINE_SIZE = 4 };
+
+  Ref* data_;
+  unsigned size_, capacity_;
+  Ref inline_[INLINE_SIZE];
+
+  bool isInline() const { return data_ == inline_; }
+
+  void grow(unsigned wanted) {
+    unsigned newCapacity = std::max(wanted, capacity_ * 2);
+    Ref* newData = (Ref*)malloc(sizeof(Ref) * newCapacity);
+    assert(newData);
+    memcpy(newData, data_, sizeof(Ref) * size_);
+    if (!isInline()) ::free(data_);
+    data_ = newData;
+    capacity_ = newCapacity;
+  }
+
+public:
+  typedef Ref* iterator;
+
+  ArrayStorage() : data_(inline_), size_(0), capacity_(INLINE_SIZE) {}
+  ArrayStorage(const ArrayStorage& other) : data_(inline_), size_(0), capacity_(INLINE_SIZE) {
+    *this = other;
+  }
+  ~ArrayStorage() {
+    if (!isInline()) ::free(data_);
+  }
+
+  ArrayStorage& operator=(const ArrayStorage& other) {
+    if (this == &other) return *this;
+    size_ = 0;
+    reserve(other.size_);
+    memcpy(data_, other.data_, sizeof(Ref) * other.size_);
+    size_ = other.size_;
+    return *this;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  Ref* data() { return data_; }
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+
+  Ref& operator[](size_t x) { return data_[x]; }
+  Ref& at(size_t x) {
+    assert(x < size_);
+    return data_[x];
+  }
+  Ref& back() {
+    assert(size_ > 0);
+    return data_[size_-1];
+  }
+
+  void reserve(size_t wanted) {
+    if (wanted > capacity_) grow(wanted);
+  }
+  void push_back(Ref r) {
+    if (size_ == capacity_) grow(size_ + 1);
+    data_[size_++] = r;
+  }
+  void pop_back() {
+    assert(size_ > 0);
+    size_--;
+  }
+  void resize(size_t newSize) {
+    reserve(newSize);
+    for (size_t i = size_; i < newSize; i++) data_[i] = Ref();
+    size_ = newSize;
+  }
+  void clear() { size_ = 0; }
+  void shrink_to_fit() { // only gives back heap storage when it is no longer needed at all
+    if (!isInline() && size_ <= INLINE_SIZE) {
+      memcpy(inline_, data_, sizeof(Ref) * size_);
+      ::free(data_);
+      data_ = inline_;
+      capacity_ = INLINE_SIZE;
+    }
+  }
+
+  void erase(iterator first, iterator last) {
+    assert(first <= last && first >= begin() && last <= end());
+    memmove(first, last, sizeof(Ref) * (end() - last));
+    size_ -= last - first;
+  }
+  void insert(iterator pos, size_t num, Ref r) {
+    size_t x = pos - begin();
+    assert(x <= size_);
+    reserve(size_ + num);
+    memmove(data_ + x + num, data_ + x, sizeof(Ref) * (size_ - x));
+    for (size_t i = 0; i < num; i++) data_[x + i] = r;
+    size_ += num;
+  }
+};
 
 struct Arena {
   #define CHUNK_SIZE 1000
-  std::vector<Value*> chunks;
-  int index; // in last chunk
+  std::vector<Value*> chunks; // chunks are kept around after a rewind, for reuse
+  size_t chunk; // number of chunks in use
+  int index; // in last chunk in use
 
   std::vector<ArrayStorage*> arr_chunks;
+  size_t arr_chunk;
   int arr_index;
 
-  Arena() : index(0), arr_index(0) {}
+  // A position in the arena that it can be rewound to
+  struct Mark {
+    size_t chunk, arr_chunk;
+    int index, arr_index;
+  };
+
+  Arena() : chunk(0), index(CHUNK_SIZE), arr_chunk(0), arr_index(CHUNK_SIZE) {}
 
-  Ref alloc();
+  Ref alloc(); // fast path is inline, below
   ArrayStorage* allocArray();
+
+  Mark mark() {
+    Mark ret;
+    ret.chunk = chunk;
+    ret.index = index;
+    ret.arr_chunk = arr_chunk;
+    ret.arr_index = arr_index;
+    return ret;
+  }
+  // Frees everything allocated after the mark. Nothing allocated after it may
+  // be reachable any more, including from values allocated before it.
+  void rewind(const Mark& m);
+  void reset() {
+    Mark start;
+    start.chunk = start.arr_chunk = 0;
+    start.index = start.arr_index = CHUNK_SIZE;
+    rewind(start);
+  }
+  // Memory held by the chunks, including those kept for reuse after a
+  // rewind. Arrays that outgrow their inline storage also use the heap,
+  // which is not counted.
+  size_t reservedBytes();
+
+private:
+  Ref allocSlow();
+  ArrayStorage* allocArraySlow();
 };
 
-extern Arena arena;
+extern thread_local Arena arena;
 
 // Main value type
 struct Value {
@@ -280,6 +417,16 @@ struct Value {
     return false;
   }
 
+  // Returns the closing quote of the string that starts at curr, skipping escaped characters
+  static char* findStringEnd(char* curr) {
+    while (*curr != '"') {
+      assert(*curr);
+      if (*curr == '\\') curr++;
+      curr++;
+    }
+    return curr;
+  }
+
   char* parse(char* curr) {
     #define is_json_space(x) (x == 32 || x == 9 || x == 10 || x == 13) /* space, tab, linefeed/newline, or return */
     #define skip() { while (*curr && is_json_space(*curr)) curr++; }
@@ -287,8 +434,7 @@ struct Value {
     if (*curr == '"') {
       // String
       curr++;
-      char *close = strchr(curr, '"');
-      assert(close);
+      char *close = findStringEnd(curr);
       *close = 0; // end this string, and reuse it straight from the input
       setString(curr);
       curr = close+1;
@@ -331,8 +477,7 @@ struct Value {
       while (*curr != '}') {
         assert(*curr == '"');
         curr++;
-        char *close = strchr(curr, '"');
-        assert(close);
+        char *close = findStringEnd(curr);
         *close = 0; // end this string, and reuse it straight from the input
         IString key(curr);
         curr = close+1;
@@ -539,19 +684,244 @@ struct Value {
   }
 };
 
-// AST traversals
+// Arena fast paths, which must see the full Value type
+
+inline Ref Arena::alloc() {
+  if (index < CHUNK_SIZE) return &chunks[chunk-1][index++];
+  return allocSlow();
+}
+
+inline ArrayStorage* Arena::allocArray() {
+  if (arr_index < CHUNK_SIZE) return &arr_chunks[arr_chunk-1][arr_index++];
+  return allocArraySlow();
+}
+
+inline size_t Arena::reservedBytes() {
+  return CHUNK_SIZE * (chunks.size() * sizeof(Value) + arr_chunks.size() * sizeof(ArrayStorage));
+}
+
+// Rewinds the thread's arena when going out of scope, for temporary work whose
+// nodes are all dropped at the end, like one function that was printed
+struct ArenaScope {
+  Arena::Mark mark;
+  ArenaScope() : mark(arena.mark()) {}
+  ~ArenaScope() { arena.rewind(mark); }
+};
+
+// AST traversals. These are templates, so the visitors are inlined into the
+// traversal loops instead of being called through a std::function per node.
+
+struct TraverseInfo {
+  TraverseInfo() {}
+  TraverseInfo(Ref node, ArrayStorage* arr) : node(node), arr(arr), index(0) {}
+  Ref node;
+  ArrayStorage* arr;
+  int index;
+};
+
+template <class T, int init>
+struct StackedStack { // a stack, on the stack
+  T stackStorage[init];
+  T* storage;
+  int used, available; // used amount, available amount
+  bool alloced;
+
+  StackedStack() : used(0), available(init), alloced(false) {
+    storage = stackStorage;
+  }
+  ~StackedStack() {
+    if (alloced) free(storage);
+  }
+
+  int size() { return used; }
+
+  void push_back(const T& t) {
+    assert(used <= available);
+    if (used == available) {
+      available *= 2;
+      if (!alloced) {
+        T* old = storage;
+        storage = (T*)malloc(sizeof(T)*available);
+        memcpy(storage, old, sizeof(T)*used);
+        alloced = true;
+      } else {
+        T *newStorage = (T*)realloc(storage, sizeof(T)*available);
+        assert(newStorage);
+        storage = newStorage;
+      }
+    }
+    assert(used < available);
+    assert(storage);
+    storage[used++] = t;
+  }
+
+  T& back() {
+    assert(used > 0);
+    return storage[used-1];
+  }
+
+  void pop_back() {
+    assert(used > 0);
+    used--;
+  }
+};
+
+#define visitable(node) (node->isArray() && node->size() > 0)
+
+#define TRAV_STACK 40
 
 // Traverse, calling visit before the children
-void traversePre(Ref node, std::function<void (Ref)> visit);
+template<typename Visit>
+void traversePre(Ref node, Visit visit) {
+  if (!visitable(node)) return;
+  visit(node);
+  StackedStack<TraverseInfo, TRAV_STACK> stack;
+  int index = 0;
+  ArrayStorage* arr = &node->getArray();
+  int arrsize = (int)arr->size();
+  Ref* arrdata = arr->data();
+  stack.push_back(TraverseInfo(node, arr));
+  while (1) {
+    if (index < arrsize) {
+      Ref sub = *(arrdata+index);
+      index++;
+      if (visitable(sub)) {
+        stack.back().index = index;
+        index = 0;
+        visit(sub);
+        arr = &sub->getArray();
+        arrsize = (int)arr->size();
+        arrdata = arr->data();
+        stack.push_back(TraverseInfo(sub, arr));
+      }
+    } else {
+      stack.pop_back();
+      if (stack.size() == 0) break;
+      TraverseInfo& back = stack.back();
+      index = back.index;
+      arr = back.arr;
+      arrsize = (int)arr->size();
+      arrdata = arr->data();
+    }
+  }
+}
 
 // Traverse, calling visitPre before the children and visitPost after
-void traversePrePost(Ref node, std::function<void (Ref)> visitPre, std::function<void (Ref)> visitPost);
+template<typename VisitPre, typename VisitPost>
+void traversePrePost(Ref node, VisitPre visitPre, VisitPost visitPost) {
+  if (!visitable(node)) return;
+  visitPre(node);
+  StackedStack<TraverseInfo, TRAV_STACK> stack;
+  int index = 0;
+  ArrayStorage* arr = &node->getArray();
+  int arrsize = (int)arr->size();
+  Ref* arrdata = arr->data();
+  stack.push_back(TraverseInfo(node, arr));
+  while (1) {
+    if (index < arrsize) {
+      Ref sub = *(arrdata+index);
+      index++;
+      if (visitable(sub)) {
+        stack.back().index = index;
+        index = 0;
+        visitPre(sub);
+        arr = &sub->getArray();
+        arrsize = (int)arr->size();
+        arrdata = arr->data();
+        stack.push_back(TraverseInfo(sub, arr));
+      }
+    } else {
+      visitPost(stack.back().node);
+      stack.pop_back();
+      if (stack.size() == 0) break;
+      TraverseInfo& back = stack.back();
+      index = back.index;
+      arr = back.arr;
+      arrsize = (int)arr->size();
+      arrdata = arr->data();
+    }
+  }
+}
 
 // Traverse, calling visitPre before the children and visitPost after. If pre returns false, do not traverse children
-void traversePrePostConditional(Ref node, std::function<bool (Ref)> visitPre, std::function<void (Ref)> visitPost);
+template<typename VisitPre, typename VisitPost>
+void traversePrePostConditional(Ref node, VisitPre visitPre, VisitPost visitPost) {
+  if (!visitable(node)) return;
+  if (!visitPre(node)) return;
+  StackedStack<TraverseInfo, TRAV_STACK> stack;
+  int index = 0;
+  ArrayStorage* arr = &node->getArray();
+  int arrsize = (int)arr->size();
+  Ref* arrdata = arr->data();
+  stack.push_back(TraverseInfo(node, arr));
+  while (1) {
+    if (index < arrsize) {
+      Ref sub = *(arrdata+index);
+      index++;
+      if (visitable(sub)) {
+        if (visitPre(sub)) {
+          stack.back().index = index;
+          index = 0;
+          arr = &sub->getArray();
+          arrsize = (int)arr->size();
+          arrdata = arr->data();
+          stack.push_back(TraverseInfo(sub, arr));
+        }
+      }
+    } else {
+      visitPost(stack.back().node);
+      stack.pop_back();
+      if (stack.size() == 0) break;
+      TraverseInfo& back = stack.back();
+      index = back.index;
+      arr = back.arr;
+      arrsize = (int)arr->size();
+      arrdata = arr->data();
+    }
+  }
+}
 
 // Traverses all the top-level functions in the document
-void traverseFunctions(Ref ast, std::function<void (Ref)> visit);
+template<typename Visit>
+void traverseFunctions(Ref ast, Visit visit) {
+  if (!ast || ast->size() == 0) return;
+  if (ast[0] == TOPLEVEL) {
+    Ref stats = ast[1];
+    for (size_t i = 0; i < stats->size(); i++) {
+      Ref curr = stats[i];
+      if (curr[0] == DEFUN) visit(curr);
+    }
+  } else if (ast[0] == DEFUN) {
+    visit(ast);
+  }
+}
+
+#undef visitable
+#undef TRAV_STACK
+
+// Compact AST serialization, which js-optimizer.js can also read and write (see
+// astToBinary there). It is much cheaper to handle than JSON: strings are interned
+// once in a table up front, and nodes are a tag character followed by varints.
+// All bytes are printable ASCII and there are no newlines, so like JSON a
+// serialized AST is one line of a text file.
+//
+//   document := "EMAST" varint(#strings) (string '"')* node
+//   node     := '(' varint(size) node*     array
+//             | '$' varint(index)          string, from the table
+//             | '#' varint                 non-negative integer below 2^32
+//             | '.' varint(lo) varint(hi)  any other number, as IEEE 754 bits
+//             | ':' varint(size) (varint(key index) node)*  object
+//             | '0' | '1' | '2'            null, false, true
+//   varint   := 5 bits per byte, low bits first, in 0x60-0x7f if more follow
+//               and in 0x40-0x5f for the last one
+//
+// Strings are kept escaped as in a double-quoted JS string, as they are in our
+// AST, so a '"' ends one unless it follows a '\'. Writing one escapes any '"'
+// or trailing '\' that is not, so the table can always be read back.
+
+// Parses a document, and leaves src just after it
+Ref parseBinaryAst(char*& src);
+void stringifyBinaryAst(Ref node, std::ostream &os);
 
 // JS printer
 
@@ -767,8 +1137,12 @@ struct JSPrinter {
   }
 
   void printDefun(Ref node) {
-    emit("function ");
-    emit(node[1]->getCString());
+    bool named = !!node[1]->getIString(); // function expressions can be anonymous
+    emit("function");
+    if (named) {
+      emit(' ');
+      emit(node[1]->getCString());
+    }
     emit('(');
     Ref args = node[2];
     for (size_t i = 0; i < args->size(); i++) {
@@ -788,7 +1162,7 @@ struct JSPrinter {
     indent--;
     newline();
     emit('}');
-    newline();
+    if (named) newline();
   }
 
   bool isNothing(Ref node) {
@@ -940,9 +1314,27 @@ struct JSPrinter {
   }
 
   void printString(Ref node) {
-    emit('"');
-    emit(node[1]->getCString());
-    emit('"');
+    // like uglify, use single quotes if that needs fewer escapes
+    const char *str = node[1]->getCString();
+    int doubles = 0, singles = 0;
+    for (const char *curr = str; *curr; curr++) {
+      if (*curr == '\\' && curr[1]) doubles += *++curr == '"';
+      else singles += *curr == '\'';
+    }
+    if (doubles <= singles) {
+      emit('"');
+      emit(str);
+      emit('"');
+      return;
+    }
+    emit('\'');
+    for (const char *curr = str; *curr; curr++) {
+      if (*curr == '\\' && curr[1] == '"') continue;
+      if (*curr == '\'') emit('\\');
+      emit(*curr);
+      if (*curr == '\\' && curr[1]) emit(*++curr);
+    }
+    emit('\'');
   }
 
   // Parens optimizing
@@ -1130,7 +1522,15 @@ struct JSPrinter {
         space();
         emit('=');
         space();
-        print(args[i][1]);
+        Ref value = args[i][1];
+        if (value[0] == DEFUN) {
+          // keep function expressions wrapped, like the asm.js module is
+          emit('(');
+          print(value);
+          emit(')');
+        } else {
+          print(value);
+        }
       }
     }
     emit(';');
@@ -1268,9 +1668,11 @@ struct JSPrinter {
         pretty ? emit(", ") : emit(',');
         newline();
       }
-      emit('"');
+      bool quoted = args[i]->size() > 2;
+      if (quoted) emit('"');
       emit(args[i][0]->getCString());
-      emit("\":");
+      if (quoted) emit('"');
+      emit(':');
       space();
       print(args[i][1]);
     }
@@ -1521,10 +1923,12 @@ public:
                             .push_back(makeRawArray());
   }
 
-  static void appendToObject(Ref array, IString key, Ref value) {
+  static void appendToObject(Ref array, IString key, Ref value, bool quoted=false) {
     assert(array[0] == OBJECT);
-    array[1]->push_back(&makeRawArray(2)->push_back(makeRawString(key))
-                                         .push_back(value));
+    Ref pair = &makeRawArray(3)->push_back(makeRawString(key))
+                                .push_back(value);
+    if (quoted) pair->push_back(&arena.alloc()->setBool(true)); // keep "x": quoted, e.g. for closure
+    array[1]->push_back(pair);
   }
 };
 
@@ -31,9 +31,9 @@ def get(ports, settings, shared):
               includes.append(os.path.join(root, dir))
 
       final = os.path.join(ports.get_build_dir(), 'bullet', 'libbullet.bc')
-      ports.build_port(src_path, final, includes=includes, exclude_dirs=['MiniCL'])
+      ports.build_port(src_path, final, includes=includes, flags=ports.get_variant_flags(), exclude_dirs=['MiniCL'])
       return final
-    return [shared.Cache.get('bullet', create)]
+    return [shared.Cache.get(ports.get_lib_name('bullet'), create)]
   else:
     return []
 
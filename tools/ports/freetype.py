@@ -6,8 +6,9 @@ TAG = 'version_1'
 def get(ports, settings, shared):
   if settings.USE_FREETYPE == 1:
     ports.fetch_project('freetype', 'https://github.com/emscripten-ports/FreeType/archive/' + TAG + '.zip', 'FreeType-' + TAG)
-    def create():     
-      ports.clear_project_build('freetype')
+    name = ports.get_lib_name('freetype')
+    def create():
+      ports.clear_project_build(name)
 
       source_path = os.path.join(ports.get_dir(), 'freetype', 'FreeType-' + TAG)
       dest_path = os.path.join(shared.Cache.get_path('ports-builds'), 'freetype')
@@ -73,21 +74,21 @@ def get(ports, settings, shared):
       commands = []
       o_s = []
       for src in srcs:
-        o = os.path.join(ports.get_build_dir(), 'freetype', src + '.o')
+        o = os.path.join(ports.get_build_dir(), name, src + '.o')
         shared.safe_ensure_dirs(os.path.dirname(o))
         commands.append([shared.PYTHON, shared.EMCC, os.path.join(dest_path, src), '-DFT2_BUILD_LIBRARY', '-O2', '-o', o, '-I' + dest_path + '/include',
                          '-I' + dest_path + '/truetype', '-I' + dest_path + '/sfnt', '-I' + dest_path + '/autofit', '-I' + dest_path + '/smooth', 
                          '-I' + dest_path + '/raster', '-I' + dest_path + '/psaux', '-I' + dest_path + '/psnames', '-I' + dest_path + '/truetype', 
-                         '-w',])
+                         '-w',] + ports.get_variant_flags())
         o_s.append(o)
 
       ports.run_commands(commands)
-      final = os.path.join(ports.get_build_dir(), 'freetype', 'libfreetype.a')
+      final = os.path.join(ports.get_build_dir(), name, 'libfreetype.a')
       shared.try_delete(final)
       Popen([shared.LLVM_AR, 'rc', final] + o_s).communicate()
       assert os.path.exists(final)
       return final
-    return [shared.Cache.get('freetype', create, what='port')]
+    return [shared.Cache.get(name, create, what='port')]
   else:
     return []
 
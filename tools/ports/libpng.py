@@ -18,9 +18,9 @@ def get(ports, settings, shared):
       open(os.path.join(dest_path, 'pnglibconf.h'), 'w').write(pnglibconf_h)
 
       final = os.path.join(ports.get_build_dir(), 'libpng', 'libpng.bc')
-      ports.build_port(dest_path, final, flags=['-s', 'USE_ZLIB=1'], exclude_files=['pngtest'], exclude_dirs=['scripts', 'contrib'])
+      ports.build_port(dest_path, final, flags=['-s', 'USE_ZLIB=1'] + ports.get_variant_flags(), exclude_files=['pngtest'], exclude_dirs=['scripts', 'contrib'])
       return final
-    return [shared.Cache.get('libpng', create, what='port')]
+    return [shared.Cache.get(ports.get_lib_name('libpng'), create, what='port')]
   else:
     return []
 
@@ -15,8 +15,9 @@ def get_with_configure(ports, settings, shared):
 def get(ports, settings, shared):
   if settings.USE_ZLIB == 1:
     ports.fetch_project('zlib', 'https://github.com/emscripten-ports/zlib/archive/' + TAG + '.zip', 'zlib-' + TAG)
-    def create():     
-      ports.clear_project_build('zlib')
+    name = ports.get_lib_name('zlib')
+    def create():
+      ports.clear_project_build(name)
 
       source_path = os.path.join(ports.get_dir(), 'zlib', 'zlib-' + TAG)
       dest_path = os.path.join(shared.Cache.get_path('ports-builds'), 'zlib')
@@ -31,18 +32,18 @@ def get(ports, settings, shared):
       commands = []
       o_s = []
       for src in srcs:
-        o = os.path.join(ports.get_build_dir(), 'zlib', src + '.o')
+        o = os.path.join(ports.get_build_dir(), name, src + '.o')
         shared.safe_ensure_dirs(os.path.dirname(o))
-        commands.append([shared.PYTHON, shared.EMCC, os.path.join(dest_path, src), '-O2', '-o', o, '-I' + dest_path,'-w',])
+        commands.append([shared.PYTHON, shared.EMCC, os.path.join(dest_path, src), '-O2', '-o', o, '-I' + dest_path,'-w',] + ports.get_variant_flags())
         o_s.append(o)
 
       ports.run_commands(commands)
-      final = os.path.join(ports.get_build_dir(), 'zlib', 'libz.a')
+      final = os.path.join(ports.get_build_dir(), name, 'libz.a')
       shared.try_delete(final)
       Popen([shared.LLVM_AR, 'rc', final] + o_s).communicate()
       assert os.path.exists(final)
       return final
-    return [shared.Cache.get('zlib', create, what='port')]
+    return [shared.Cache.get(name, create, what='port')]
   else:
     return []
 
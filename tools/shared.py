@@ -1,6 +1,6 @@
 from __future__ import print_function
 from .toolchain_profiler import ToolchainProfiler
-import shutil, time, os, sys, base64, json, tempfile, copy, shlex, atexit, subprocess, hashlib, pickle, re, errno
+import shutil, time, os, sys, base64, json, tempfile, copy, shlex, atexit, subprocess, hashlib, pickle, re, errno, struct
 from subprocess import Popen, PIPE, STDOUT
 from tempfile import mkstemp
 from distutils.spawn import find_executable
@@ -1657,6 +1657,14 @@ class Building(object):
         Building.uninternal_nm_cache[files[i]] = object_contents[i]
       return object_contents
 
+  # EMCC_NM_CACHE=1 keeps the symbols of the members of each archive in the emscripten cache dir, so that linking
+  # against an archive that did not change (same path, size and modification time) does not run llvm-nm on it again
+  @staticmethod
+  def get_archive_index():
+    if os.environ.get('EMCC_NM_CACHE') != '1':
+      return None
+    return cache.ArchiveIndex(Cache.get_path('nm_index'), EMSCRIPTEN_VERSION + '|' + LLVM_NM)
+
   @staticmethod
   def read_link_inputs(files):
     with ToolchainProfiler.profile_block('read_link_inputs'):
@@ -1686,8 +1694,21 @@ class Building(object):
         Building.ar_contents[archive_names[n]] = object_names_in_archives[n]['files']
         clean_temporary_archive_contents_directory(object_names_in_archives[n]['dir'])
 
-      for o in object_names_in_archives:
-        for f in o['files']:
+      # Members of archives that we indexed before get their symbols from the index, the others need llvm-nm
+      archive_index = Building.get_archive_index()
+      unindexed_archives = []
+      for n in range(len(archive_names)):
+        o = object_names_in_archives[n]
+        members = [(os.path.relpath(f, o['dir']), f) for f in o['files']]
+        index = archive_index.get(archive_names[n]) if archive_index else None
+        if index is not None and all(name in index for name, f in members):
+          logging.debug('archive index: reusing symbols of ' + archive_names[n])
+          for name, f in members:
+            defs, undefs, commons = index[name]
+            Building.uninternal_nm_cache[f] = ObjectFileInfo(0, None, set(defs), set(undefs), set(commons))
+          continue
+        unindexed_archives.append((archive_names[n], members))
+        for name, f in members:
           if not f in Building.uninternal_nm_cache:
             object_names.append(f)
 
@@ -1695,6 +1716,12 @@ class Building(object):
       # The results are not used here directly, but populated to llvm-nm cache structure.
       Building.parallel_llvm_nm(object_names)
 
+      if archive_index:
+        for archive, members in unindexed_archives:
+          infos = [(name, Building.uninternal_nm_cache[f]) for name, f in members]
+          if all(info.is_valid() for name, info in infos):
+            archive_index.put(archive, dict((name, [sorted(info.defs), sorted(info.undefs), sorted(info.commons)]) for name, info in infos))
+
   @staticmethod
   def link(files, target, force_archive_contents=False, temp_files=None, just_calculate=False):
     if not temp_files:
@@ -2098,19 +2125,38 @@ class Building(object):
   # evals ctors. if binaryen_bin is provided, it is the dir of the binaryen tool for this, and we are in wasm mode
   @staticmethod
   def eval_ctors(js_file, binary_file, binaryen_bin='', debug_info=False):
-    subprocess.check_call([PYTHON, path_from_root('tools', 'ctor_evaller.py'), js_file, binary_file, str(Settings.TOTAL_MEMORY), str(Settings.TOTAL_STACK), str(Settings.GLOBAL_BASE), binaryen_bin, str(int(debug_info))])
+    subprocess.check_call([PYTHON, path_from_root('tools', 'ctor_evaller.py'), js_file, binary_file, str(Settings.TOTAL_MEMORY), str(Settings.TOTAL_STACK), str(Settings.GLOBAL_BASE), binaryen_bin, str(int(debug_info)), str(Settings.EVAL_CTORS), json.dumps(Settings.EVAL_CTORS_PURE_IMPORTS), str(Settings.EVAL_CTORS_MAX_ALLOCATION)])
+
+  @staticmethod
+  def snapshot(js_file, mem_file):
+    subprocess.check_call([PYTHON, path_from_root('tools', 'snapshot.py'), js_file, mem_file])
 
   @staticmethod
   def eliminate_duplicate_funcs(filename):
     from . import duplicate_function_eliminator
     duplicate_function_eliminator.eliminate_duplicate_funcs(filename)
 
+  @staticmethod
+  def find_nothrow_invokes(filename):
+    from . import nothrow_invokes
+    return nothrow_invokes.find_nothrow_invokes(filename)
+
+  @staticmethod
+  def find_devirtualizable_tables(filename, max_targets):
+    from . import devirtualize
+    return devirtualize.find_devirtualizable_tables(filename, max_targets)
+
+  @staticmethod
+  def asm_metadce(filename):
+    from . import asm_metadce
+    return asm_metadce.metadce(filename)
+
   @staticmethod
   def calculate_reachable_functions(infile, initial_list, can_reach=True):
     with ToolchainProfiler.profile_block('calculate_reachable_functions'):
       from . import asm_module
       temp = configuration.get_temp_files().get('.js').name
-      Building.js_optimizer(infile, ['dumpCallGraph'], output_filename=temp, just_concat=True)
+      Building.js_optimizer(infile, ['asm', 'dumpCallGraph'], output_filename=temp, just_concat=True)
       asm = asm_module.AsmModule(temp)
       lines = asm.funcs_js.split('\n')
       can_call = {}
@@ -2558,6 +2604,9 @@ class JS(object):
     Module["setThrew"](1, 0);
   }
 }''' % ((' invoke_' + sig) if named else '', args, 'return ' if sig[0] != 'v' else '', sig, args)
+    if Settings.SAMPLING_PROFILER:
+      # the functions that an exception unwinds do not pop themselves off the shadow stack
+      ret = ret.replace('  try {', '  var ssd = HEAP32[shadowStack >> 2];\n  try {', 1).replace('  } catch(e) {\n', '  } catch(e) {\n    HEAP32[shadowStack >> 2] = ssd;\n', 1)
     return ret
 
   @staticmethod
@@ -2590,6 +2639,35 @@ class JS(object):
     def escape(x): return '\\x{:02x}'.format(ord(x.group()))
     return re.sub('[\x1a\x80-\xff]', escape, s)
 
+  # Runs of at least this many zeros are skipped by MEM_INIT_COMPRESSION, as memory starts out zeroed. Shorter
+  # ones cost less than the 8 bytes of starting a new segment after them.
+  MEM_INIT_ZERO_RUN = 32
+
+  @staticmethod
+  def compress_memory_initializer(membytes):
+    # Encodes the memory initializer for MEM_INIT_COMPRESSION as a sequence of segments of [offset, length, data], with
+    # offset and length as little-endian 32-bit integers, skipping the runs of zeros in between. With
+    # MEM_INIT_COMPRESSION=2 the data of the segments is then compressed with LZ4, see tools/lz4-meminit.js.
+    data = bytes(bytearray(membytes))
+    segments = bytearray()
+    def add_segment(start, end):
+      if end > start:
+        segments.extend(struct.pack('<II', start, end - start))
+        segments.extend(data[start:end])
+    start = 0
+    for zeros in re.finditer(b'\0{%d,}' % JS.MEM_INIT_ZERO_RUN, data):
+      add_segment(start, zeros.start())
+      start = zeros.end()
+    add_segment(start, len(data))
+    if Settings.MEM_INIT_COMPRESSION == 2:
+      temp_files = configuration.get_temp_files()
+      segments_file = temp_files.get(suffix='.mem').name
+      compressed_file = temp_files.get(suffix='.mem').name
+      open(segments_file, 'wb').write(segments)
+      run_process(NODE_JS + [path_from_root('tools', 'lz4-meminit.js'), path_from_root('src', 'mini-lz4.js'), segments_file, compressed_file])
+      segments = bytearray(open(compressed_file, 'rb').read())
+    return segments
+
   @staticmethod
   def is_dyn_call(func):
     return func.startswith('dynCall_')
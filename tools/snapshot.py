@@ -0,0 +1,51 @@
+'''
+Runs a program in node until it calls emscripten_snapshot_point(), and saves its state there, so that it starts from
+that point when it is loaded (see SNAPSHOT in settings.js). Memory replaces the memory init file, and the files and
+atexits go to a .snapshot file next to it.
+'''
+
+import os, sys, json, shutil, subprocess
+
+sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from tools import shared
+from tools.tempfiles import try_delete
+
+def main():
+  js_file = sys.argv[1]
+  mem_file = sys.argv[2]
+  assert mem_file.endswith('.mem')
+  snapshot_file = mem_file[:-len('.mem')] + '.snapshot'
+
+  temp_files = shared.Configuration().get_temp_files()
+  runner = temp_files.get('.js').name
+  new_mem_file = temp_files.get('.mem').name
+  new_snapshot_file = temp_files.get('.snapshot').name
+  try:
+    # The program calls this at the snapshot point. It runs in the directory of the output, where it finds its files.
+    open(runner, 'w').write('''var Module = {
+  'snapshotCapture': function(memory, snapshot) {
+    var fs = require('fs');
+    fs.writeFileSync(%s, Buffer.from(memory.buffer, memory.byteOffset, memory.length));
+    fs.writeFileSync(%s, Buffer.from(snapshot.buffer, snapshot.byteOffset, snapshot.length));
+    process.exit(0);
+  }
+};
+''' % (json.dumps(new_mem_file), json.dumps(new_snapshot_file)) + open(js_file).read())
+    proc = shared.run_process(shared.NODE_JS + [runner], stdout=subprocess.PIPE, stderr=subprocess.PIPE, check=False,
+                              cwd=os.path.dirname(os.path.abspath(js_file)))
+    if proc.returncode != 0 or os.path.getsize(new_snapshot_file) == 0:
+      shared.logging.error('the program did not reach emscripten_snapshot_point() when taking the snapshot:\n' + proc.stdout + proc.stderr)
+      sys.exit(1)
+    if proc.stderr:
+      sys.stderr.write(proc.stderr)
+    shared.logging.debug('snapshot: %d bytes of memory, %d bytes of other state' % (os.path.getsize(new_mem_file), os.path.getsize(new_snapshot_file)))
+    shutil.move(new_mem_file, mem_file)
+    shutil.move(new_snapshot_file, snapshot_file)
+  finally:
+    try_delete(runner)
+    try_delete(new_mem_file)
+    try_delete(new_snapshot_file)
+
+if __name__ == '__main__':
+  main()
@@ -2,7 +2,7 @@ from __future__ import print_function
 import os, json, logging, zipfile, tarfile, glob, shutil
 from . import shared
 from subprocess import Popen, CalledProcessError
-import subprocess, multiprocessing, re
+import subprocess, multiprocessing, multiprocessing.pool, re
 from tools.shared import check_call
 
 stdout = None
@@ -29,6 +29,34 @@ def run_commands(commands):
     # and is smaller than the maximum timeout value 4294967.0 for Python 3 on Windows (threading.TIMEOUT_MAX)
     pool.map_async(call_process, commands, chunksize=1).get(999999)
 
+def build_libraries(libs):
+  '''
+    Gets the (name, create, suffix) libraries from the cache, and returns their
+    paths. They only depend on each other when linking, so the missing ones are
+    created in parallel, on threads that mostly wait for their compiles in the
+    shared process pool.
+  '''
+  def get(lib):
+    name, create, suffix = lib
+    return shared.Cache.get(name, lambda: create(name), extension=suffix)
+  missing = [lib for lib in libs if not os.path.exists(shared.Cache.get_path(lib[0]))]
+  if len(missing) > 1 and CORES > 1:
+    def try_get(lib):
+      try:
+        get(lib)
+      except BaseException as e: # a failed compile may sys.exit(), which would leave the pool waiting for it forever
+        return e
+    shared.Cache.acquire_cache_lock() # once for all of them, and before the threads read EM_EXCLUSIVE_CACHE_ACCESS
+    try:
+      shared.Building.get_multiprocessing_pool() # create it before the threads do
+      pool = multiprocessing.pool.ThreadPool(min(len(missing), CORES))
+      errors = [e for e in pool.map_async(try_get, missing, chunksize=1).get(999999) if e]
+      pool.close()
+      if errors: raise errors[0]
+    finally:
+      shared.Cache.release_cache_lock()
+  return [get(lib) for lib in libs]
+
 def files_in_path(path_components, filenames):
   srcdir = shared.path_from_root(*path_components)
   return [os.path.join(srcdir, f) for f in filenames]
@@ -68,6 +96,10 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
       '-I', shared.path_from_root('system', 'lib', 'libc', 'musl', 'arch', 'js'),
     ]
 
+  # libraries are built in parallel, and some have sources with the same names
+  def object_in_temp(lib_filename, src):
+    return in_temp(lib_filename + '.' + os.path.basename(src) + '.o')
+
   def build_libc(lib_filename, files, lib_opts):
     o_s = []
     commands = []
@@ -81,7 +113,7 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
               '-Wno-visibility', '-Wno-pointer-sign', '-Wno-absolute-value',
               '-Wno-empty-body']
     for src in files:
-      o = in_temp(os.path.basename(src) + '.o')
+      o = object_in_temp(lib_filename, src)
       commands.append([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', src), '-o', o] + musl_internal_includes() + default_opts + c_opts + lib_opts)
       o_s.append(o)
     run_commands(commands)
@@ -95,7 +127,7 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     if has_noexcept_version and shared.Settings.DISABLE_EXCEPTION_CATCHING:
       opts += ['-fno-exceptions']
     for src in files:
-      o = in_temp(src + '.o')
+      o = object_in_temp(lib_filename, src)
       srcfile = shared.path_from_root(src_dirname, src)
       commands.append([shared.PYTHON, shared.EMXX, srcfile, '-o', o, '-std=c++11'] + opts)
       o_s.append(o)
@@ -142,6 +174,11 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
       assert '-mt' in libname
     else:
       assert '-mt' not in libname
+    if shared.Settings.FAST_FLOAT_CONVERSION:
+      args += ['-DEMSCRIPTEN_FAST_FLOAT_CONVERSION']
+      assert '_fastfloat' in libname
+    else:
+      assert '_fastfloat' not in libname
     return build_libc(libname, libc_files, args)
 
   def create_pthreads(libname):
@@ -162,7 +199,7 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
         'pthread_once.c', 'sem_destroy.c', 'pthread_attr_setschedparam.c',
         'pthread_cond_wait.c', 'pthread_rwlockattr_destroy.c', 'sem_getvalue.c',
         'pthread_attr_setschedpolicy.c', 'pthread_equal.c', 'pthread_rwlockattr_init.c',
-        'sem_init.c', 'pthread_attr_setscope.c', 'pthread_getspecific.c',
+        'sem_init.c', 'pthread_attr_setscope.c',
         'pthread_rwlockattr_setpshared.c', 'sem_open.c', 'pthread_attr_setstack.c',
         'pthread_key_create.c', 'pthread_rwlock_destroy.c', 'sem_post.c',
         'pthread_attr_setstacksize.c', 'pthread_mutexattr_destroy.c',
@@ -180,9 +217,9 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
         'pthread_rwlock_wrlock.c', 'pthread_condattr_init.c',
         'pthread_mutex_getprioceiling.c', 'pthread_setcanceltype.c',
         'pthread_condattr_setclock.c', 'pthread_mutex_init.c',
-        'pthread_setspecific.c', 'pthread_setcancelstate.c'
+        'pthread_setcancelstate.c'
       ])
-    pthreads_files += [os.path.join('pthread', 'library_pthread.c')]
+    pthreads_files += [os.path.join('pthread', 'library_pthread.c'), os.path.join('pthread', 'task_scheduler.c'), os.path.join('pthread', 'gl_command_buffer.c')]
     return build_libc(libname, pthreads_files, ['-O2', '-s', 'USE_PTHREADS=1'])
 
   def create_pthreads_asmjs(libname):
@@ -236,9 +273,14 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
       'variant.cpp'
     ]
     libcxxabi_include = shared.path_from_root('system', 'lib', 'libcxxabi', 'include')
+    opts = ['-DLIBCXX_BUILDING_LIBCXXABI=1', '-D_LIBCPP_BUILDING_LIBRARY', '-Oz', '-I' + libcxxabi_include]
+    if shared.Settings.LIBCXX_C_LOCALE_ONLY:
+      opts += ['-D_LIBCPP_EMSCRIPTEN_C_LOCALE_ONLY']
+      assert '_clocale' in libname
+    else:
+      assert '_clocale' not in libname
     return build_libcxx(
-      os.path.join('system', 'lib', 'libcxx'), libname, libcxx_files,
-      ['-DLIBCXX_BUILDING_LIBCXXABI=1', '-D_LIBCPP_BUILDING_LIBRARY', '-Oz', '-I' + libcxxabi_include],
+      os.path.join('system', 'lib', 'libcxx'), libname, libcxx_files, opts,
       has_noexcept_version=True)
 
   # libcxxabi - just for dynamic_cast for now
@@ -290,7 +332,7 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     o_s = []
     commands = []
     for src in files:
-      o = in_temp(os.path.basename(src) + '.o')
+      o = object_in_temp(libname, src)
       commands.append([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', src), '-O2', '-o', o])
       o_s.append(o)
     run_commands(commands)
@@ -298,11 +340,19 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     return in_temp(libname)
 
   def dlmalloc_name():
+    if shared.Settings.COMPACT_MALLOC:
+      return 'compact_malloc'
     ret = 'dlmalloc'
     if shared.Settings.USE_PTHREADS:
       ret += '_threadsafe'
+    if shared.Settings.MALLOC_THREAD_CACHE:
+      ret += '_tcache'
     if shared.Settings.EMSCRIPTEN_TRACING:
       ret += '_tracing'
+      if shared.Settings.TRACE_BUFFER:
+        ret += '_buffered'
+    if shared.Settings.HEAP_PROFILER:
+      ret += '_heapprof'
     if shared.Settings.SPLIT_MEMORY:
       ret += '_split'
     if shared.Settings.DEBUG_LEVEL:
@@ -311,22 +361,57 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
 
   def create_dlmalloc(out_name):
     o = in_temp(out_name)
+    # The arenas and regions of emscripten/arena.h are built along with malloc, since regions are dlmalloc mspaces.
+    arena_o = in_temp('arena' + out_name)
+    arena_cflags = ['-O2']
+    if shared.Settings.USE_PTHREADS:
+      arena_cflags += ['-s', 'USE_PTHREADS=1']
+    if shared.Settings.EMSCRIPTEN_TRACING:
+      arena_cflags += ['--tracing']
+    if shared.Settings.COMPACT_MALLOC:
+      arena_cflags += ['-DARENA_NO_REGIONS']
+    check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'arena.c'), '-o', arena_o] + arena_cflags)
+    # The handle heaps of emscripten/handle_heap.h only need malloc, to get their memory.
+    handle_heap_o = in_temp('hh' + out_name)
+    check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'handle_heap.c'), '-o', handle_heap_o, '-O2'])
+    if shared.Settings.COMPACT_MALLOC:
+      malloc_o = in_temp('cm' + out_name)
+      check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'compact_malloc.c'), '-o', malloc_o, '-O2', '-fno-builtin'])
+      shared.Building.link([malloc_o, arena_o, handle_heap_o], o)
+      return o
     cflags = ['-O2', '-fno-builtin']
     if shared.Settings.USE_PTHREADS:
       cflags += ['-s', 'USE_PTHREADS=1']
     if shared.Settings.EMSCRIPTEN_TRACING:
       cflags += ['--tracing']
+    if shared.Settings.HEAP_PROFILER:
+      cflags += ['-D__EMSCRIPTEN_HEAP_PROFILER__=1']
     if shared.Settings.SPLIT_MEMORY:
       cflags += ['-DMSPACES', '-DONLY_MSPACES']
     if shared.Settings.DEBUG_LEVEL:
       cflags += ['-DDLMALLOC_DEBUG']
-    check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'dlmalloc.c'), '-o', o] + cflags)
+    # thread_cache_malloc.c includes dlmalloc.c, and puts per-thread caches in front of it.
+    src = 'thread_cache_malloc.c' if shared.Settings.MALLOC_THREAD_CACHE else 'dlmalloc.c'
+    check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', src), '-o', o] + cflags)
+    objects = [o, arena_o, handle_heap_o]
+    if shared.Settings.EMSCRIPTEN_TRACING and shared.Settings.TRACE_BUFFER:
+      trace_buffer_o = in_temp('tb' + out_name)
+      trace_buffer_cflags = ['-O2', '--tracing']
+      if shared.Settings.USE_PTHREADS:
+        trace_buffer_cflags += ['-s', 'USE_PTHREADS=1']
+      check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'trace_buffer.c'), '-o', trace_buffer_o] + trace_buffer_cflags)
+      objects.append(trace_buffer_o)
+    if shared.Settings.HEAP_PROFILER:
+      heap_profiler_o = in_temp('hp' + out_name)
+      check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'heap_profiler.c'), '-o', heap_profiler_o, '-O2', '-D__EMSCRIPTEN_HEAP_PROFILER__=1'])
+      objects.append(heap_profiler_o)
     if shared.Settings.SPLIT_MEMORY:
       split_malloc_o = in_temp('sm' + out_name)
       check_call([shared.PYTHON, shared.EMCC, shared.path_from_root('system', 'lib', 'split_malloc.cpp'), '-o', split_malloc_o, '-O2'])
-      lib = in_temp('lib' + out_name)
-      shared.Building.link([o, split_malloc_o], lib)
-      shutil.move(lib, o)
+      objects.append(split_malloc_o)
+    lib = in_temp('lib' + out_name)
+    shared.Building.link(objects, lib)
+    shutil.move(lib, o)
     return o
 
   def create_wasm_rt_lib(libname, files):
@@ -335,7 +420,7 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     # Output should be an object file with lld, otherwise text assembly
     output_flag = '-c' if shared.Settings.EXPERIMENTAL_USE_LLD else '-S'
     for src in files:
-      o = in_temp(os.path.basename(src) + '.o')
+      o = object_in_temp(libname, src)
       # Use clang directly instead of emcc. Since emcc's intermediate format (produced by -S) is LLVM IR, there's no way to
       # get emcc to output wasm .s files, which is what we archive in compiler_rt.
       commands.append([
@@ -487,12 +572,22 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     if shared.Settings.DISABLE_EXCEPTION_CATCHING:
       name += '_noexcept'
     return name
-  ret = []
+  def maybe_fast_float(name):
+    if shared.Settings.FAST_FLOAT_CONVERSION:
+      name += '_fastfloat'
+    return name
+  def maybe_c_locale(name):
+    if shared.Settings.LIBCXX_C_LOCALE_ONLY:
+      name += '_clocale'
+    return name
+  libs = []
   has = need = None
 
   for shortname, suffix, create, library_symbols, deps, can_noexcept in system_libs:
     force_this = force_all or shortname in force
     if can_noexcept: shortname = maybe_noexcept(shortname)
+    if create == create_libc: shortname = maybe_fast_float(shortname)
+    if create == create_libcxx: shortname = maybe_c_locale(shortname)
     if force_this:
       suffix = 'bc' # .a files do not always link in all their parts; don't use them when forced
     name = shortname + '.' + suffix
@@ -514,19 +609,18 @@ def calculate(temp_files, in_temp, stdout_, stderr_, forced=[]):
     if force_this or (len(need) > 0 and not only_forced):
       # We need to build and link the library in
       logging.debug('including %s' % name)
-      def do_create():
-        ret = create(name)
-        return ret
-      libfile = shared.Cache.get(name, do_create, extension=suffix)
-      ret.append(libfile)
+      libs.append((name, create, suffix))
       force = force.union(deps)
-  ret.sort(key=lambda x: x.endswith('.a')) # make sure to put .a files at the end.
 
   # Handle backend compiler_rt separately because it is not a bitcode system lib like the others.
   # Here, just ensure that it's in the cache.
+  backend_libs = []
   if shared.Settings.BINARYEN and shared.Settings.WASM_BACKEND:
-    shared.Cache.get('wasm_compiler_rt.a', lambda: create_wasm_compiler_rt('wasm_compiler_rt.a'), extension='a')
-    shared.Cache.get('wasm_libc_rt.a', lambda: create_wasm_libc_rt('wasm_libc_rt.a'), extension='a')
+    backend_libs = [('wasm_compiler_rt.a', create_wasm_compiler_rt, 'a'),
+                    ('wasm_libc_rt.a', create_wasm_libc_rt, 'a')]
+
+  ret = build_libraries(libs + backend_libs)[:len(libs)]
+  ret.sort(key=lambda x: x.endswith('.a')) # make sure to put .a files at the end.
 
   for actual in ret:
     if os.path.basename(actual) == 'libcxxabi.bc':
@@ -573,6 +667,27 @@ class Ports(object):
   def run_commands(commands): # make easily available for port objects
     run_commands(commands)
 
+  @staticmethod
+  def get_variant_flags():
+    # Flags that make a port match the app's build: with SIMD the LLVM
+    # vectorizers run on its code, and with pthreads it is built thread-aware.
+    # Ports that use these must also use get_lib_name for their cache entry.
+    flags = []
+    if shared.Settings.USE_PTHREADS:
+      flags += ['-s', 'USE_PTHREADS=1']
+    if shared.Settings.SIMD:
+      flags += ['-s', 'SIMD=1']
+    return flags
+
+  @staticmethod
+  def get_lib_name(name):
+    # The name of the variant of a port matching get_variant_flags, like libc-mt
+    if shared.Settings.USE_PTHREADS:
+      name += '-mt'
+    if shared.Settings.SIMD:
+      name += '-simd'
+    return name
+
   @staticmethod
   def get_dir():
     dirname = os.environ.get('EM_PORTS') or os.path.expanduser(os.path.join('~', '.emscripten_ports'))
@@ -1,4 +1,8 @@
 import subprocess, os, time, sys, tempfile
+try:
+  import resource
+except ImportError: # not available on Windows
+  resource = None
 
 sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
@@ -73,6 +77,8 @@ if EM_PROFILE_TOOLCHAIN:
     profiler_logs_path = None # Log file not opened yet
 
     block_stack = []
+    # For each open block, the CPU times when it was entered, from cpu_times()
+    block_cpu_stack = []
 
     # Because process spawns are tracked from multiple entry points, it is possible that record_process_start() and/or record_process_exit()
     # are called multiple times. Prevent recording multiple entries to the logs to keep them clean.
@@ -114,6 +120,7 @@ if EM_PROFILE_TOOLCHAIN:
       if ToolchainProfiler.process_start_recorded: return
       ToolchainProfiler.process_start_recorded = True
       ToolchainProfiler.block_stack = []
+      ToolchainProfiler.block_cpu_stack = []
 
       if write_log_entry:
         with ToolchainProfiler.log_access() as f:
@@ -126,7 +133,7 @@ if EM_PROFILE_TOOLCHAIN:
 
       ToolchainProfiler.exit_all_blocks()
       with ToolchainProfiler.log_access() as f:
-        f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"exit","time":' + ToolchainProfiler.timestamp() + ',"returncode":' + str(returncode) + '}\n]\n')
+        f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"exit","time":' + ToolchainProfiler.timestamp() + ',"returncode":' + str(returncode) + ',"details":' + ToolchainProfiler.block_details((0, 0)) + '}\n]\n')
 
     @staticmethod
     def record_subprocess_spawn(process_pid, process_cmdline):
@@ -148,26 +155,61 @@ if EM_PROFILE_TOOLCHAIN:
       with ToolchainProfiler.log_access() as f:
         f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"finish","targetPid":' + str(process_pid) + ',"time":' + ToolchainProfiler.timestamp() + ',"returncode":' + str(returncode) + '}')
 
+    @staticmethod
+    def record_subprocess_blocks(process_pid, blocks):
+      # Records blocks that a subprocess timed itself, e.g. the passes of the native optimizer, so that they show up
+      # inside of it. Each block is a (name, start time, end time, details) tuple, where details maps names to numbers.
+      with ToolchainProfiler.log_access() as f:
+        for name, start, end, details in blocks:
+          f.write(',\n{"pid":' + str(process_pid) + ',"subprocessPid":' + str(process_pid) + ',"op":"enterBlock","name":"' + name + '","time":' + '{0:.3f}'.format(start) + '}')
+          f.write(',\n{"pid":' + str(process_pid) + ',"subprocessPid":' + str(process_pid) + ',"op":"exitBlock","name":"' + name + '","time":' + '{0:.3f}'.format(end) + ',"details":{' + ','.join(['"' + key + '":' + str(details[key]) for key in sorted(details.keys())]) + '}}')
+
+    @staticmethod
+    def cpu_times():
+      # CPU time (user + system) used so far by this process, and by its subprocesses that have been waited for
+      t = os.times()
+      return (t[0] + t[1], t[2] + t[3])
+
+    @staticmethod
+    def peak_memory_mb():
+      # Peak resident memory of this process so far, and of the largest of its subprocesses that have been waited for
+      if not resource: return None
+      scale = 1024.0 * 1024 if sys.platform == 'darwin' else 1024.0 # ru_maxrss is in bytes on macOS, in KB elsewhere
+      return (resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / scale, resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss / scale)
+
+    @staticmethod
+    def block_details(cpu_start):
+      # How much CPU the block used, so that the time it spent waiting shows up, and the peak memory at its end
+      cpu_end = ToolchainProfiler.cpu_times()
+      details = '"cpuMs":' + '{0:.1f}'.format((cpu_end[0] - cpu_start[0]) * 1000) + ',"childCpuMs":' + '{0:.1f}'.format((cpu_end[1] - cpu_start[1]) * 1000)
+      memory = ToolchainProfiler.peak_memory_mb()
+      if memory:
+        details += ',"peakMB":' + '{0:.1f}'.format(memory[0]) + ',"childPeakMB":' + '{0:.1f}'.format(memory[1])
+      return '{' + details + '}'
+
     @staticmethod
     def enter_block(block_name):
       with ToolchainProfiler.log_access() as f:
         f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"enterBlock","name":"' + block_name + '","time":' + ToolchainProfiler.timestamp() + '}')
 
       ToolchainProfiler.block_stack.append(block_name)
+      ToolchainProfiler.block_cpu_stack.append(ToolchainProfiler.cpu_times())
 
     @staticmethod
-    def remove_last_occurrence_if_exists(lst, item):
-      for i in range(len(lst)):
+    def find_last_occurrence(lst, item):
+      for i in range(len(lst) - 1, -1, -1):
         if lst[i] == item:
-          lst.pop(i)
-          return True
-      return False
+          return i
+      return -1
 
     @staticmethod
     def exit_block(block_name):
-      if ToolchainProfiler.remove_last_occurrence_if_exists(ToolchainProfiler.block_stack, block_name):
+      i = ToolchainProfiler.find_last_occurrence(ToolchainProfiler.block_stack, block_name)
+      if i >= 0:
+        ToolchainProfiler.block_stack.pop(i)
+        cpu_start = ToolchainProfiler.block_cpu_stack.pop(i)
         with ToolchainProfiler.log_access() as f:
-          f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"exitBlock","name":"' + block_name + '","time":' + ToolchainProfiler.timestamp() + '}')
+          f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"exitBlock","name":"' + block_name + '","time":' + ToolchainProfiler.timestamp() + ',"details":' + ToolchainProfiler.block_details(cpu_start) + '}')
 
     @staticmethod
     def exit_all_blocks():
@@ -217,6 +259,10 @@ else:
     def record_subprocess_finish(process_pid, returncode):
       pass
 
+    @staticmethod
+    def record_subprocess_blocks(process_pid, blocks):
+      pass
+
     @staticmethod
     def enter_block(block_name):
       pass
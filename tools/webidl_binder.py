@@ -102,7 +102,7 @@ function getCache(__class__) {
 Module['getCache'] = getCache;
 
 function wrapPointer(ptr, __class__) {
-  var cache = getCache(__class__);
+  var cache = (__class__ || WrapperObject).__cache__;
   var ret = cache[ptr];
   if (ret) return ret;
   ret = Object.create((__class__ || WrapperObject).prototype);
@@ -141,7 +141,8 @@ function getClass(obj) {
 }
 Module['getClass'] = getClass;
 
-// Converts big (string or array) values into a C-style storage, in temporary space
+// Converts big (string or array) values into a C-style storage, in temporary space. They are written straight into
+// the heap, without building intermediate JS arrays, so passing them does not allocate once the buffer is big enough.
 
 var ensureCache = {
   buffer: 0,  // the main buffer of temporary storage
@@ -171,10 +172,10 @@ var ensureCache = {
     }
     ensureCache.pos = 0;
   },
-  alloc: function(array, view) {
+  alloc: function(count, view) {
     assert(ensureCache.buffer);
     var bytes = view.BYTES_PER_ELEMENT;
-    var len = array.length * bytes;
+    var len = count * bytes;
     len = (len + 7) & -8; // keep things aligned to 8 byte boundaries
     var ret;
     if (ensureCache.pos + len >= ensureCache.size) {
@@ -198,24 +199,32 @@ var ensureCache = {
       case 4: offsetShifted >>= 2; break;
       case 8: offsetShifted >>= 3; break;
     }
-    for (var i = 0; i < array.length; i++) {
-      view[offsetShifted + i] = array[i];
-    }
+    view.set(array, offsetShifted);
   },
 };
 
 function ensureString(value) {
   if (typeof value === 'string') {
-    var intArray = intArrayFromString(value);
-    var offset = ensureCache.alloc(intArray, HEAP8);
-    ensureCache.copy(intArray, HEAP8, offset);
+    var len = lengthBytesUTF8(value) + 1;
+    var offset = ensureCache.alloc(len, HEAP8);
+    stringToUTF8(value, offset, len);
     return offset;
   }
   return value;
 }
+// Passes a typed array that is already a view of the heap, of the matching type, by its address and without copying
+// it, so the callee reads (and can write) the caller's data directly. Anything else is staged like the above.
+function ensureBuffer(value, view) {
+  if (value.buffer === view.buffer && value.constructor === view.constructor) {
+    return value.byteOffset;
+  }
+  var offset = ensureCache.alloc(value.length, view);
+  ensureCache.copy(value, view, offset);
+  return offset;
+}
 function ensureInt8(value) {
   if (typeof value === 'object') {
-    var offset = ensureCache.alloc(value, HEAP8);
+    var offset = ensureCache.alloc(value.length, HEAP8);
     ensureCache.copy(value, HEAP8, offset);
     return offset;
   }
@@ -223,7 +232,7 @@ function ensureInt8(value) {
 }
 function ensureInt16(value) {
   if (typeof value === 'object') {
-    var offset = ensureCache.alloc(value, HEAP16);
+    var offset = ensureCache.alloc(value.length, HEAP16);
     ensureCache.copy(value, HEAP16, offset);
     return offset;
   }
@@ -231,7 +240,7 @@ function ensureInt16(value) {
 }
 function ensureInt32(value) {
   if (typeof value === 'object') {
-    var offset = ensureCache.alloc(value, HEAP32);
+    var offset = ensureCache.alloc(value.length, HEAP32);
     ensureCache.copy(value, HEAP32, offset);
     return offset;
   }
@@ -239,7 +248,7 @@ function ensureInt32(value) {
 }
 function ensureFloat32(value) {
   if (typeof value === 'object') {
-    var offset = ensureCache.alloc(value, HEAPF32);
+    var offset = ensureCache.alloc(value.length, HEAPF32);
     ensureCache.copy(value, HEAPF32, offset);
     return offset;
   }
@@ -247,7 +256,7 @@ function ensureFloat32(value) {
 }
 function ensureFloat64(value) {
   if (typeof value === 'object') {
-    var offset = ensureCache.alloc(value, HEAPF64);
+    var offset = ensureCache.alloc(value.length, HEAPF64);
     ensureCache.copy(value, HEAPF64, offset);
     return offset;
   }
@@ -443,7 +452,12 @@ def render_function(class_name, func_name, sigs, return_type, non_pointer, copy,
       else:
         # an array can be received here
         arg_type = arg.type.name
-        if arg_type in ['Byte', 'Octet']:
+        if arg.getExtendedAttribute('Buffer'):
+          # [Buffer] arrays that view the heap are passed in place, others are staged
+          view = {'Byte': 'HEAP8', 'Octet': 'HEAPU8', 'Short': 'HEAP16', 'UnsignedShort': 'HEAPU16',
+                  'Long': 'HEAP32', 'UnsignedLong': 'HEAPU32', 'Float': 'HEAPF32', 'Double': 'HEAPF64'}[arg_type]
+          body += "  if (typeof {0} == 'object') {{ {0} = ensureBuffer({0}, {1}); }}\n".format(js_arg, view)
+        elif arg_type in ['Byte', 'Octet']:
           body += "  if (typeof {0} == 'object') {{ {0} = ensureInt8({0}); }}\n".format(js_arg)
         elif arg_type in ['Short', 'UnsignedShort']:
           body += "  if (typeof {0} == 'object') {{ {0} = ensureInt16({0}); }}\n".format(js_arg)